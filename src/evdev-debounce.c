@@ -60,6 +60,18 @@
    the second event). These cases are currently unhandled.
 */
 
+/* Lazy mode: once a button has gone through DEBOUNCE_LAZY_THRESHOLD
+   debounce timeouts without bouncing, the timers are no longer armed on
+   press and release. In the neutral waiting states a timeout does not
+   send an event, so instead the timeouts are checked against the
+   timestamp of the next button event. If that event is within the
+   timeout, the button bounced: the timers are armed for what is left of
+   the timeout and the state machine is back to normal.
+ */
+#define DEBOUNCE_TIMEOUT_BOUNCE ms2us(25)
+#define DEBOUNCE_TIMEOUT_SPURIOUS ms2us(12)
+#define DEBOUNCE_LAZY_THRESHOLD 32
+
 enum debounce_event {
 	DEBOUNCE_EVENT_PRESS = 50,
 	DEBOUNCE_EVENT_RELEASE,
@@ -117,6 +129,18 @@ debounce_set_state(struct fallback_dispatch *fallback,
 	assert(new_state >= DEBOUNCE_STATE_IS_UP &&
 	       new_state <= DEBOUNCE_STATE_IS_DOWN_DELAYING);
 
+	switch (new_state) {
+	case DEBOUNCE_STATE_IS_UP_DELAYING:
+	case DEBOUNCE_STATE_IS_UP_DELAYING_SPURIOUS:
+	case DEBOUNCE_STATE_IS_DOWN_DETECTING_SPURIOUS:
+	case DEBOUNCE_STATE_IS_DOWN_DELAYING:
+		/* The button bounced */
+		fallback->debounce.clean_count = 0;
+		break;
+	default:
+		break;
+	}
+
 	fallback->debounce.state = new_state;
 }
 
@@ -124,7 +148,8 @@ static inline void
 debounce_set_timer(struct fallback_dispatch *fallback,
 		   uint64_t time)
 {
-	const int DEBOUNCE_TIMEOUT_BOUNCE = ms2us(25);
+	if (fallback->debounce.lazy)
+		return;
 
 	libinput_timer_set(&fallback->debounce.timer,
 			   time + DEBOUNCE_TIMEOUT_BOUNCE);
@@ -134,7 +159,8 @@ static inline void
 debounce_set_timer_short(struct fallback_dispatch *fallback,
 			 uint64_t time)
 {
-	const int DEBOUNCE_TIMEOUT_SPURIOUS = ms2us(12);
+	if (fallback->debounce.lazy)
+		return;
 
 	libinput_timer_set(&fallback->debounce.timer_short,
 			   time + DEBOUNCE_TIMEOUT_SPURIOUS);
@@ -166,8 +192,18 @@ debounce_enable_spurious(struct fallback_dispatch *fallback)
 		       HTTP_DOC_LINK);
 }
 
+/* A delayed state was cancelled by the opposite event, the press and
+ * release pair never reaches the caller */
+static inline void
+debounce_count_bounce(struct fallback_dispatch *fallback)
+{
+	libinput_device_stat_inc(&fallback->device->base,
+				 LIBINPUT_DEVICE_STAT_DISCARDED_BOUNCE);
+}
+
 static void
 debounce_notify_button(struct fallback_dispatch *fallback,
+		       uint64_t now,
 		       enum libinput_button_state state)
 {
 	struct evdev_device *device = fallback->device;
@@ -176,6 +212,14 @@ debounce_notify_button(struct fallback_dispatch *fallback,
 
 	code = evdev_to_left_handed(device, code);
 
+	/* Only the buttons sent after a timeout or another button were
+	 * held back */
+	if (now > time)
+		libinput_device_record_delay(&device->base,
+					     LIBINPUT_DELAY_SOURCE_DEBOUNCE,
+					     time,
+					     now);
+
 	evdev_pointer_notify_physical_button(device, time, code, state);
 }
 
@@ -188,6 +232,7 @@ debounce_is_up_handle_event(struct fallback_dispatch *fallback, enum debounce_ev
 		debounce_set_timer(fallback, time);
 		debounce_set_state(fallback, DEBOUNCE_STATE_IS_DOWN_WAITING);
 		debounce_notify_button(fallback,
+				       time,
 				       LIBINPUT_BUTTON_STATE_PRESSED);
 		break;
 	case DEBOUNCE_EVENT_RELEASE:
@@ -216,6 +261,7 @@ debounce_is_down_handle_event(struct fallback_dispatch *fallback, enum debounce_
 		} else {
 			debounce_set_state(fallback, DEBOUNCE_STATE_IS_UP_DETECTING_SPURIOUS);
 			debounce_notify_button(fallback,
+					       time,
 					       LIBINPUT_BUTTON_STATE_RELEASED);
 		}
 		break;
@@ -258,6 +304,7 @@ debounce_is_up_delaying_handle_event(struct fallback_dispatch *fallback, enum de
 {
 	switch (event) {
 	case DEBOUNCE_EVENT_PRESS:
+		debounce_count_bounce(fallback);
 		debounce_set_state(fallback, DEBOUNCE_STATE_IS_DOWN_WAITING);
 		break;
 	case DEBOUNCE_EVENT_RELEASE:
@@ -268,6 +315,7 @@ debounce_is_up_delaying_handle_event(struct fallback_dispatch *fallback, enum de
 	case DEBOUNCE_EVENT_OTHERBUTTON:
 		debounce_set_state(fallback, DEBOUNCE_STATE_IS_UP);
 		debounce_notify_button(fallback,
+				       time,
 				       LIBINPUT_BUTTON_STATE_RELEASED);
 		break;
 	}
@@ -278,6 +326,7 @@ debounce_is_up_delaying_spurious_handle_event(struct fallback_dispatch *fallback
 {
 	switch (event) {
 	case DEBOUNCE_EVENT_PRESS:
+		debounce_count_bounce(fallback);
 		debounce_set_state(fallback, DEBOUNCE_STATE_IS_DOWN);
 		debounce_cancel_timer(fallback);
 		debounce_cancel_timer_short(fallback);
@@ -289,11 +338,13 @@ debounce_is_up_delaying_spurious_handle_event(struct fallback_dispatch *fallback
 	case DEBOUNCE_EVENT_TIMEOUT_SHORT:
 		debounce_set_state(fallback, DEBOUNCE_STATE_IS_UP_WAITING);
 		debounce_notify_button(fallback,
+				       time,
 				       LIBINPUT_BUTTON_STATE_RELEASED);
 		break;
 	case DEBOUNCE_EVENT_OTHERBUTTON:
 		debounce_set_state(fallback, DEBOUNCE_STATE_IS_UP);
 		debounce_notify_button(fallback,
+				       time,
 				       LIBINPUT_BUTTON_STATE_RELEASED);
 		break;
 	}
@@ -332,6 +383,7 @@ debounce_is_down_detecting_spurious_handle_event(struct fallback_dispatch *fallb
 		log_debounce_bug(fallback, event);
 		break;
 	case DEBOUNCE_EVENT_RELEASE:
+		debounce_count_bounce(fallback);
 		debounce_set_state(fallback, DEBOUNCE_STATE_IS_UP_DETECTING_SPURIOUS);
 		break;
 	case DEBOUNCE_EVENT_TIMEOUT_SHORT:
@@ -339,12 +391,14 @@ debounce_is_down_detecting_spurious_handle_event(struct fallback_dispatch *fallb
 		debounce_set_state(fallback, DEBOUNCE_STATE_IS_DOWN);
 		debounce_enable_spurious(fallback);
 		debounce_notify_button(fallback,
+				       time,
 				       LIBINPUT_BUTTON_STATE_PRESSED);
 		break;
 	case DEBOUNCE_EVENT_TIMEOUT:
 	case DEBOUNCE_EVENT_OTHERBUTTON:
 		debounce_set_state(fallback, DEBOUNCE_STATE_IS_DOWN);
 		debounce_notify_button(fallback,
+				       time,
 				       LIBINPUT_BUTTON_STATE_PRESSED);
 		break;
 	}
@@ -379,6 +433,7 @@ debounce_is_down_delaying_handle_event(struct fallback_dispatch *fallback, enum
 		log_debounce_bug(fallback, event);
 		break;
 	case DEBOUNCE_EVENT_RELEASE:
+		debounce_count_bounce(fallback);
 		debounce_set_state(fallback, DEBOUNCE_STATE_IS_UP_WAITING);
 		break;
 	case DEBOUNCE_EVENT_TIMEOUT_SHORT:
@@ -388,6 +443,7 @@ debounce_is_down_delaying_handle_event(struct fallback_dispatch *fallback, enum
 	case DEBOUNCE_EVENT_OTHERBUTTON:
 		debounce_set_state(fallback, DEBOUNCE_STATE_IS_DOWN);
 		debounce_notify_button(fallback,
+				       time,
 				       LIBINPUT_BUTTON_STATE_PRESSED);
 		break;
 	}
@@ -402,11 +458,13 @@ debounce_disabled_handle_event(struct fallback_dispatch *fallback,
 	case DEBOUNCE_EVENT_PRESS:
 		fallback->debounce.button_time = time;
 		debounce_notify_button(fallback,
+				       time,
 				       LIBINPUT_BUTTON_STATE_PRESSED);
 		break;
 	case DEBOUNCE_EVENT_RELEASE:
 		fallback->debounce.button_time = time;
 		debounce_notify_button(fallback,
+				       time,
 				       LIBINPUT_BUTTON_STATE_RELEASED);
 		break;
 	case DEBOUNCE_EVENT_TIMEOUT_SHORT:
@@ -418,12 +476,81 @@ debounce_disabled_handle_event(struct fallback_dispatch *fallback,
 	}
 }
 
+static void
+debounce_handle_event(struct fallback_dispatch *fallback,
+		      enum debounce_event event,
+		      uint64_t time);
+
+/**
+ * Leave lazy mode and arm the timers that would have been armed by the
+ * last button event. The remaining timeout may already be in the past
+ * if we're processing events late.
+ */
+static void
+debounce_lazy_leave(struct fallback_dispatch *fallback, bool want_short)
+{
+	uint64_t time = fallback->debounce.button_time;
+
+	fallback->debounce.lazy = false;
+	fallback->debounce.clean_count = 0;
+
+	libinput_timer_set_flags(&fallback->debounce.timer,
+				 time + DEBOUNCE_TIMEOUT_BOUNCE,
+				 TIMER_FLAG_ALLOW_NEGATIVE);
+	if (want_short)
+		libinput_timer_set_flags(&fallback->debounce.timer_short,
+					 time + DEBOUNCE_TIMEOUT_SPURIOUS,
+					 TIMER_FLAG_ALLOW_NEGATIVE);
+}
+
+/**
+ * In lazy mode, process the timeouts that expired since the last button
+ * event before processing the button event at the given time.
+ */
+static void
+debounce_lazy_catch_up(struct fallback_dispatch *fallback, uint64_t time)
+{
+	uint64_t elapsed = time - fallback->debounce.button_time;
+
+	switch (fallback->debounce.state) {
+	case DEBOUNCE_STATE_IS_UP_DETECTING_SPURIOUS:
+		if (elapsed < DEBOUNCE_TIMEOUT_SPURIOUS) {
+			debounce_lazy_leave(fallback, true);
+			break;
+		}
+		debounce_handle_event(fallback,
+				      DEBOUNCE_EVENT_TIMEOUT_SHORT,
+				      fallback->debounce.button_time +
+				      DEBOUNCE_TIMEOUT_SPURIOUS);
+		/* fallthrough */
+	case DEBOUNCE_STATE_IS_UP_WAITING:
+	case DEBOUNCE_STATE_IS_DOWN_WAITING:
+		if (elapsed < DEBOUNCE_TIMEOUT_BOUNCE) {
+			debounce_lazy_leave(fallback, false);
+			break;
+		}
+		debounce_handle_event(fallback,
+				      DEBOUNCE_EVENT_TIMEOUT,
+				      fallback->debounce.button_time +
+				      DEBOUNCE_TIMEOUT_BOUNCE);
+		break;
+	default:
+		break;
+	}
+}
+
 static void
 debounce_handle_event(struct fallback_dispatch *fallback,
 		      enum debounce_event event,
 		      uint64_t time)
 {
-	enum debounce_state current = fallback->debounce.state;
+	enum debounce_state current;
+
+	if (fallback->debounce.lazy &&
+	    (event == DEBOUNCE_EVENT_PRESS || event == DEBOUNCE_EVENT_RELEASE))
+		debounce_lazy_catch_up(fallback, time);
+
+	current = fallback->debounce.state;
 
 	if (event == DEBOUNCE_EVENT_OTHERBUTTON) {
 		debounce_cancel_timer(fallback);
@@ -463,6 +590,20 @@ debounce_handle_event(struct fallback_dispatch *fallback,
 		break;
 	}
 
+	/* A timeout that brings us back to a neutral state means the
+	 * button didn't bounce. Spurious debouncing relies on the short
+	 * timer to send the release, it can't be lazy. */
+	if (event == DEBOUNCE_EVENT_TIMEOUT &&
+	    (fallback->debounce.state == DEBOUNCE_STATE_IS_UP ||
+	     fallback->debounce.state == DEBOUNCE_STATE_IS_DOWN) &&
+	    !fallback->debounce.spurious_enabled &&
+	    !fallback->debounce.lazy &&
+	    ++fallback->debounce.clean_count >= DEBOUNCE_LAZY_THRESHOLD) {
+		evdev_log_debug(fallback->device,
+				"debounce: no bounces seen, not arming timers\n");
+		fallback->debounce.lazy = true;
+	}
+
 	evdev_log_debug(fallback->device,
 			"debounce state: %s → %s → %s\n",
 			debounce_state_to_str(current),
@@ -565,7 +706,9 @@ fallback_init_debounce(struct fallback_dispatch *dispatch)
 	struct evdev_device *device = dispatch->device;
 	char timer_name[64];
 
-	if (evdev_device_has_model_quirk(device, QUIRK_MODEL_BOUNCING_KEYS)) {
+	/* Virtual devices don't have switches that could bounce */
+	if (evdev_device_has_model_quirk(device, QUIRK_MODEL_BOUNCING_KEYS) ||
+	    device->model_flags & EVDEV_MODEL_VIRTUAL_DEVICE) {
 		dispatch->debounce.state = DEBOUNCE_STATE_DISABLED;
 		return;
 	}
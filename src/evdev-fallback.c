@@ -26,7 +26,6 @@
 
 #include "config.h"
 
-#include <mtdev-plumbing.h>
 
 #include "evdev-fallback.h"
 #include "util-input-event.h"
@@ -185,10 +184,7 @@ fallback_flush_relative_motion(struct fallback_dispatch *dispatch,
 
 	if (device->pointer.filter) {
 		/* Apply pointer acceleration. */
-		accel = filter_dispatch(device->pointer.filter,
-					&raw,
-					device,
-					time);
+		accel = evdev_filter_dispatch(device, &raw, device, time);
 	} else {
 		evdev_log_bug_libinput(device,
 				       "accel filter missing\n");
@@ -284,6 +280,57 @@ fallback_flush_absolute_motion(struct fallback_dispatch *dispatch,
 	pointer_notify_motion_absolute(base, time, &point);
 }
 
+/**
+ * With touch frame batching enabled, add the touch point to the current
+ * frame instead of sending an event for it.
+ *
+ * @return true if the touch point was batched, false if the caller must
+ * send the individual touch event
+ */
+static inline bool
+fallback_batch_touch(struct fallback_dispatch *dispatch,
+		     struct evdev_device *device,
+		     enum libinput_event_type type,
+		     int32_t slot,
+		     int32_t seat_slot,
+		     const struct device_coords *point)
+{
+	struct touch_frame_point *p;
+
+	if (!evdev_libinput_context(device)->touch_frame_batching)
+		return false;
+
+	assert(dispatch->touch_frame.npoints < dispatch->touch_frame.size);
+
+	p = &dispatch->touch_frame.points[dispatch->touch_frame.npoints++];
+	*p = (struct touch_frame_point) {
+		.type = type,
+		.slot = slot,
+		.seat_slot = seat_slot,
+	};
+	if (point)
+		p->point = *point;
+
+	return true;
+}
+
+static inline void
+fallback_notify_touch_frame(struct fallback_dispatch *dispatch,
+			    struct evdev_device *device,
+			    uint64_t time)
+{
+	if (dispatch->touch_frame.npoints == 0) {
+		touch_notify_frame(&device->base, time);
+		return;
+	}
+
+	touch_notify_touch_frame(&device->base,
+				 time,
+				 dispatch->touch_frame.points,
+				 dispatch->touch_frame.npoints);
+	dispatch->touch_frame.npoints = 0;
+}
+
 static bool
 fallback_flush_mt_down(struct fallback_dispatch *dispatch,
 		       struct evdev_device *device,
@@ -306,19 +353,22 @@ fallback_flush_mt_down(struct fallback_dispatch *dispatch,
 		return false;
 	}
 
-	seat_slot = ffs(~seat->slot_map) - 1;
+	seat_slot = libinput_seat_alloc_slot(seat);
 	slot->seat_slot = seat_slot;
 
 	if (seat_slot == -1)
 		return false;
 
-	seat->slot_map |= bit(seat_slot);
+	long_set_bit(dispatch->mt.active_slots, slot_idx);
 	point = slot->point;
 	slot->hysteresis_center = point;
 	evdev_transform_absolute(device, &point);
 
-	touch_notify_touch_down(base, time, slot_idx, seat_slot,
-				&point);
+	if (!fallback_batch_touch(dispatch, device,
+				  LIBINPUT_EVENT_TOUCH_DOWN,
+				  slot_idx, seat_slot, &point))
+		touch_notify_touch_down(base, time, slot_idx, seat_slot,
+					&point);
 
 	return true;
 }
@@ -348,8 +398,11 @@ fallback_flush_mt_motion(struct fallback_dispatch *dispatch,
 		return false;
 
 	evdev_transform_absolute(device, &point);
-	touch_notify_touch_motion(base, time, slot_idx, seat_slot,
-				  &point);
+	if (!fallback_batch_touch(dispatch, device,
+				  LIBINPUT_EVENT_TOUCH_MOTION,
+				  slot_idx, seat_slot, &point))
+		touch_notify_touch_motion(base, time, slot_idx, seat_slot,
+					  &point);
 
 	return true;
 }
@@ -375,9 +428,13 @@ fallback_flush_mt_up(struct fallback_dispatch *dispatch,
 	if (seat_slot == -1)
 		return false;
 
-	seat->slot_map &= ~bit(seat_slot);
+	libinput_seat_release_slot(seat, seat_slot);
+	long_clear_bit(dispatch->mt.active_slots, slot_idx);
 
-	touch_notify_touch_up(base, time, slot_idx, seat_slot);
+	if (!fallback_batch_touch(dispatch, device,
+				  LIBINPUT_EVENT_TOUCH_UP,
+				  slot_idx, seat_slot, NULL))
+		touch_notify_touch_up(base, time, slot_idx, seat_slot);
 
 	return true;
 }
@@ -403,9 +460,13 @@ fallback_flush_mt_cancel(struct fallback_dispatch *dispatch,
 	if (seat_slot == -1)
 		return false;
 
-	seat->slot_map &= ~bit(seat_slot);
+	libinput_seat_release_slot(seat, seat_slot);
+	long_clear_bit(dispatch->mt.active_slots, slot_idx);
 
-	touch_notify_touch_cancel(base, time, slot_idx, seat_slot);
+	if (!fallback_batch_touch(dispatch, device,
+				  LIBINPUT_EVENT_TOUCH_CANCEL,
+				  slot_idx, seat_slot, NULL))
+		touch_notify_touch_cancel(base, time, slot_idx, seat_slot);
 
 	return true;
 }
@@ -429,18 +490,20 @@ fallback_flush_st_down(struct fallback_dispatch *dispatch,
 		return false;
 	}
 
-	seat_slot = ffs(~seat->slot_map) - 1;
+	seat_slot = libinput_seat_alloc_slot(seat);
 	dispatch->abs.seat_slot = seat_slot;
 
 	if (seat_slot == -1)
 		return false;
 
-	seat->slot_map |= bit(seat_slot);
 
 	point = dispatch->abs.point;
 	evdev_transform_absolute(device, &point);
 
-	touch_notify_touch_down(base, time, -1, seat_slot, &point);
+	if (!fallback_batch_touch(dispatch, device,
+				  LIBINPUT_EVENT_TOUCH_DOWN,
+				  -1, seat_slot, &point))
+		touch_notify_touch_down(base, time, -1, seat_slot, &point);
 
 	return true;
 }
@@ -462,7 +525,10 @@ fallback_flush_st_motion(struct fallback_dispatch *dispatch,
 	if (seat_slot == -1)
 		return false;
 
-	touch_notify_touch_motion(base, time, -1, seat_slot, &point);
+	if (!fallback_batch_touch(dispatch, device,
+				  LIBINPUT_EVENT_TOUCH_MOTION,
+				  -1, seat_slot, &point))
+		touch_notify_touch_motion(base, time, -1, seat_slot, &point);
 
 	return true;
 }
@@ -485,9 +551,12 @@ fallback_flush_st_up(struct fallback_dispatch *dispatch,
 	if (seat_slot == -1)
 		return false;
 
-	seat->slot_map &= ~bit(seat_slot);
+	libinput_seat_release_slot(seat, seat_slot);
 
-	touch_notify_touch_up(base, time, -1, seat_slot);
+	if (!fallback_batch_touch(dispatch, device,
+				  LIBINPUT_EVENT_TOUCH_UP,
+				  -1, seat_slot, NULL))
+		touch_notify_touch_up(base, time, -1, seat_slot);
 
 	return true;
 }
@@ -510,9 +579,12 @@ fallback_flush_st_cancel(struct fallback_dispatch *dispatch,
 	if (seat_slot == -1)
 		return false;
 
-	seat->slot_map &= ~bit(seat_slot);
+	libinput_seat_release_slot(seat, seat_slot);
 
-	touch_notify_touch_cancel(base, time, -1, seat_slot);
+	if (!fallback_batch_touch(dispatch, device,
+				  LIBINPUT_EVENT_TOUCH_CANCEL,
+				  -1, seat_slot, NULL))
+		touch_notify_touch_cancel(base, time, -1, seat_slot);
 
 	return true;
 }
@@ -562,6 +634,8 @@ fallback_process_key(struct fallback_dispatch *dispatch,
 			return;
 
 		dispatch->pending_event |= EVDEV_KEY;
+		if (type == KEY_TYPE_BUTTON)
+			dispatch->pending_event |= EVDEV_BUTTON;
 		break;
 	}
 
@@ -584,6 +658,41 @@ fallback_process_key(struct fallback_dispatch *dispatch,
 	}
 }
 
+/**
+ * fallback_process_key() for devices without any button codes, i.e.
+ * keyboards. There is no BTN_TOUCH, debouncing or middle button
+ * emulation to consider.
+ */
+static inline void
+fallback_process_keyboard_key(struct fallback_dispatch *dispatch,
+			      struct evdev_device *device,
+			      struct input_event *e, uint64_t time)
+{
+	bool pressed = e->value != 0;
+
+	/* ignore kernel key repeat */
+	if (e->value == 2)
+		return;
+
+	if (get_key_type(e->code) != KEY_TYPE_KEY) {
+		hw_set_key_down(dispatch, e->code, e->value);
+		return;
+	}
+
+	if (pressed == hw_is_key_down(dispatch, e->code))
+		return;
+
+	dispatch->pending_event |= EVDEV_KEY;
+	hw_set_key_down(dispatch, e->code, e->value);
+
+	fallback_keyboard_notify_key(dispatch,
+				     device,
+				     time,
+				     e->code,
+				     pressed ? LIBINPUT_KEY_STATE_PRESSED :
+					       LIBINPUT_KEY_STATE_RELEASED);
+}
+
 static void
 fallback_process_touch(struct fallback_dispatch *dispatch,
 		       struct evdev_device *device,
@@ -630,19 +739,19 @@ fallback_process_touch(struct fallback_dispatch *dispatch,
 			dispatch->pending_event |= EVDEV_ABSOLUTE_MT;
 			slot->state = SLOT_STATE_END;
 		}
-		slot->dirty = true;
+		long_set_bit(dispatch->mt.dirty_slots, dispatch->mt.slot);
 		break;
 	case ABS_MT_POSITION_X:
-		evdev_device_check_abs_axis_range(device, e->code, e->value);
+		evdev_device_check_abs_axis_range(device, e->code, e->value, time);
 		dispatch->mt.slots[dispatch->mt.slot].point.x = e->value;
 		dispatch->pending_event |= EVDEV_ABSOLUTE_MT;
-		slot->dirty = true;
+		long_set_bit(dispatch->mt.dirty_slots, dispatch->mt.slot);
 		break;
 	case ABS_MT_POSITION_Y:
-		evdev_device_check_abs_axis_range(device, e->code, e->value);
+		evdev_device_check_abs_axis_range(device, e->code, e->value, time);
 		dispatch->mt.slots[dispatch->mt.slot].point.y = e->value;
 		dispatch->pending_event |= EVDEV_ABSOLUTE_MT;
-		slot->dirty = true;
+		long_set_bit(dispatch->mt.dirty_slots, dispatch->mt.slot);
 		break;
 	case ABS_MT_TOOL_TYPE:
 		/* The transitions matter - we (may) need to send a touch
@@ -662,7 +771,7 @@ fallback_process_touch(struct fallback_dispatch *dispatch,
 			break;
 		}
 		dispatch->pending_event |= EVDEV_ABSOLUTE_MT;
-		slot->dirty = true;
+		long_set_bit(dispatch->mt.dirty_slots, dispatch->mt.slot);
 		break;
 	}
 }
@@ -670,16 +779,17 @@ fallback_process_touch(struct fallback_dispatch *dispatch,
 static inline void
 fallback_process_absolute_motion(struct fallback_dispatch *dispatch,
 				 struct evdev_device *device,
-				 struct input_event *e)
+				 struct input_event *e,
+				 uint64_t time)
 {
 	switch (e->code) {
 	case ABS_X:
-		evdev_device_check_abs_axis_range(device, e->code, e->value);
+		evdev_device_check_abs_axis_range(device, e->code, e->value, time);
 		dispatch->abs.point.x = e->value;
 		dispatch->pending_event |= EVDEV_ABSOLUTE_MOTION;
 		break;
 	case ABS_Y:
-		evdev_device_check_abs_axis_range(device, e->code, e->value);
+		evdev_device_check_abs_axis_range(device, e->code, e->value, time);
 		dispatch->abs.point.y = e->value;
 		dispatch->pending_event |= EVDEV_ABSOLUTE_MOTION;
 		break;
@@ -739,6 +849,7 @@ fallback_lid_toggle_keyboard_listener(struct fallback_dispatch *dispatch,
 		libinput_device_add_event_listener(
 					&kbd->device->base,
 					&kbd->listener,
+					EVENT_GROUP(LIBINPUT_EVENT_KEYBOARD_KEY),
 					fallback_lid_keyboard_event,
 					dispatch);
 	} else {
@@ -811,6 +922,7 @@ fallback_reject_relative(struct evdev_device *device,
 	    (device->seat_caps & EVDEV_DEVICE_POINTER) == 0) {
 		evdev_log_bug_libinput_ratelimit(device,
 						 &device->nonpointer_rel_limit,
+						 time,
 						 "REL_X/Y from a non-pointer device\n");
 		return true;
 	}
@@ -852,10 +964,12 @@ fallback_process_absolute(struct fallback_dispatch *dispatch,
 			  struct input_event *e,
 			  uint64_t time)
 {
-	if (device->is_mt) {
+	if (dispatch->mt.protocol_a.enabled) {
+		fallback_protocol_a_process(dispatch, device, e, time);
+	} else if (device->is_mt) {
 		fallback_process_touch(dispatch, device, e, time);
 	} else {
-		fallback_process_absolute_motion(dispatch, device, e);
+		fallback_process_absolute_motion(dispatch, device, e, time);
 	}
 }
 
@@ -882,141 +996,186 @@ fallback_arbitrate_touch(struct fallback_dispatch *dispatch,
 	if (dispatch->arbitration.state == ARBITRATION_IGNORE_RECT &&
 	    point_in_rect(&slot->point, &dispatch->arbitration.rect)) {
 		slot->palm_state = PALM_IS_PALM;
+		libinput_device_stat_inc(&dispatch->device->base,
+					 LIBINPUT_DEVICE_STAT_DISCARDED_ARBITRATION);
 		discard = true;
 	}
 
 	return discard;
 }
 
-static inline bool
-fallback_flush_mt_events(struct fallback_dispatch *dispatch,
-			 struct evdev_device *device,
-			 uint64_t time)
+static inline void
+fallback_flush_mt_slot(struct fallback_dispatch *dispatch,
+		       struct evdev_device *device,
+		       size_t i,
+		       uint64_t time,
+		       bool *sent)
 {
-	bool sent = false;
-
-	for (size_t i = 0; i < dispatch->mt.slots_len; i++) {
-		struct mt_slot *slot = &dispatch->mt.slots[i];
-
-		if (!slot->dirty)
-			continue;
-
-		slot->dirty = false;
+	struct mt_slot *slot = &dispatch->mt.slots[i];
 
-		/* Any palm state other than PALM_NEW means we've either
-		 * already cancelled the touch or the touch was never
-		 * a finger anyway and we didn't send the begin.
-		 */
-		if (slot->palm_state == PALM_NEW) {
-			if (slot->state != SLOT_STATE_BEGIN)
-				sent = fallback_flush_mt_cancel(dispatch,
-								device,
-								i,
-								time);
-			slot->palm_state = PALM_IS_PALM;
-		} else if (slot->palm_state == PALM_NONE) {
-			switch (slot->state) {
-			case SLOT_STATE_BEGIN:
-				if (!fallback_arbitrate_touch(dispatch,
-							     slot)) {
-					sent = fallback_flush_mt_down(dispatch,
-								      device,
-								      i,
-								      time);
-				}
-				break;
-			case SLOT_STATE_UPDATE:
-				sent = fallback_flush_mt_motion(dispatch,
-								device,
-								i,
-								time);
-				break;
-			case SLOT_STATE_END:
-				sent = fallback_flush_mt_up(dispatch,
-							    device,
-							    i,
-							    time);
-				break;
-			case SLOT_STATE_NONE:
-				break;
-			}
-		}
-
-		/* State machine continues independent of the palm state */
+	/* Any palm state other than PALM_NEW means we've either
+	 * already cancelled the touch or the touch was never
+	 * a finger anyway and we didn't send the begin.
+	 */
+	if (slot->palm_state == PALM_NEW) {
+		if (slot->state != SLOT_STATE_BEGIN)
+			*sent = fallback_flush_mt_cancel(dispatch,
+							 device,
+							 i,
+							 time);
+		slot->palm_state = PALM_IS_PALM;
+		libinput_device_stat_inc(&device->base,
+					 LIBINPUT_DEVICE_STAT_DISCARDED_PALM);
+	} else if (slot->palm_state == PALM_NONE) {
 		switch (slot->state) {
 		case SLOT_STATE_BEGIN:
-			slot->state = SLOT_STATE_UPDATE;
+			if (!fallback_arbitrate_touch(dispatch,
+						     slot)) {
+				*sent = fallback_flush_mt_down(dispatch,
+							       device,
+							       i,
+							       time);
+			}
 			break;
 		case SLOT_STATE_UPDATE:
+			*sent = fallback_flush_mt_motion(dispatch,
+							 device,
+							 i,
+							 time);
 			break;
 		case SLOT_STATE_END:
-			slot->state = SLOT_STATE_NONE;
+			*sent = fallback_flush_mt_up(dispatch,
+						     device,
+						     i,
+						     time);
 			break;
 		case SLOT_STATE_NONE:
-			/* touch arbitration may swallow the begin,
-			 * so we may get updates for a touch still
-			 * in NONE state */
 			break;
 		}
 	}
 
+	/* State machine continues independent of the palm state */
+	switch (slot->state) {
+	case SLOT_STATE_BEGIN:
+		slot->state = SLOT_STATE_UPDATE;
+		break;
+	case SLOT_STATE_UPDATE:
+		break;
+	case SLOT_STATE_END:
+		slot->state = SLOT_STATE_NONE;
+		break;
+	case SLOT_STATE_NONE:
+		/* touch arbitration may swallow the begin,
+		 * so we may get updates for a touch still
+		 * in NONE state */
+		break;
+	}
+}
+
+static inline bool
+fallback_flush_mt_events(struct fallback_dispatch *dispatch,
+			 struct evdev_device *device,
+			 uint64_t time)
+{
+	bool sent = false;
+
+	/* Only the slots that changed in this frame, most devices have
+	 * only a fraction of their slots in use */
+	for (size_t w = 0; w < NLONGS(dispatch->mt.slots_len); w++) {
+		unsigned long dirty = dispatch->mt.dirty_slots[w];
+
+		dispatch->mt.dirty_slots[w] = 0;
+		while (dirty) {
+			size_t i = w * LONG_BITS + __builtin_ctzl(dirty);
+
+			dirty &= dirty - 1;
+			fallback_flush_mt_slot(dispatch, device, i, time, &sent);
+		}
+	}
+
 	return sent;
 }
 
-static void
+/**
+ * fallback_handle_state() and fallback_process_event() are only ever
+ * called with a constant class mask. Each fallback_process_frame_*()
+ * below is a copy of the same code with the branches for anything
+ * outside its class folded away, see fallback_dispatch_classify().
+ */
+static inline void
 fallback_handle_state(struct fallback_dispatch *dispatch,
 		      struct evdev_device *device,
-		      uint64_t time)
+		      uint64_t time,
+		      const uint32_t class)
 {
+	const bool has_pointer = class & (FALLBACK_CLASS_REL|
+					  FALLBACK_CLASS_ABS|
+					  FALLBACK_CLASS_BUTTONS);
 	bool need_touch_frame = false;
 
+	if (has_pointer)
+		pointer_frame_begin(&device->base);
+
 	/* Relative motion */
-	if (dispatch->pending_event & EVDEV_RELATIVE_MOTION)
+	if ((class & FALLBACK_CLASS_REL) &&
+	    dispatch->pending_event & EVDEV_RELATIVE_MOTION)
 		fallback_flush_relative_motion(dispatch, device, time);
 
 	/* Single touch or absolute pointer devices */
-	if (dispatch->pending_event & EVDEV_ABSOLUTE_TOUCH_DOWN) {
-		if (fallback_flush_st_down(dispatch, device, time))
-			need_touch_frame = true;
-	} else if (dispatch->pending_event & EVDEV_ABSOLUTE_MOTION) {
-		if (device->seat_caps & EVDEV_DEVICE_TOUCH) {
-			if (fallback_flush_st_motion(dispatch,
-						     device,
-						     time))
+	if (class & FALLBACK_CLASS_ABS) {
+		if (dispatch->pending_event & EVDEV_ABSOLUTE_TOUCH_DOWN) {
+			if (fallback_flush_st_down(dispatch, device, time))
 				need_touch_frame = true;
-		} else if (device->seat_caps & EVDEV_DEVICE_POINTER) {
-			fallback_flush_absolute_motion(dispatch,
-						       device,
-						       time);
+		} else if (dispatch->pending_event & EVDEV_ABSOLUTE_MOTION) {
+			if (device->seat_caps & EVDEV_DEVICE_TOUCH) {
+				if (fallback_flush_st_motion(dispatch,
+							     device,
+							     time))
+					need_touch_frame = true;
+			} else if (device->seat_caps & EVDEV_DEVICE_POINTER) {
+				fallback_flush_absolute_motion(dispatch,
+							       device,
+							       time);
+			}
 		}
-	}
 
-	if (dispatch->pending_event & EVDEV_ABSOLUTE_TOUCH_UP) {
-		if (fallback_flush_st_up(dispatch, device, time))
-			need_touch_frame = true;
+		if (dispatch->pending_event & EVDEV_ABSOLUTE_TOUCH_UP) {
+			if (fallback_flush_st_up(dispatch, device, time))
+				need_touch_frame = true;
+		}
 	}
 
 	/* Multitouch devices */
-	if (dispatch->pending_event & EVDEV_ABSOLUTE_MT)
+	if ((class & FALLBACK_CLASS_MT) &&
+	    dispatch->pending_event & EVDEV_ABSOLUTE_MT)
 		need_touch_frame = fallback_flush_mt_events(dispatch,
 							    device,
 							    time);
 
-	if (need_touch_frame)
-		touch_notify_frame(&device->base, time);
+	if ((class & (FALLBACK_CLASS_ABS|FALLBACK_CLASS_MT)) &&
+	    (need_touch_frame || dispatch->touch_frame.npoints > 0))
+		fallback_notify_touch_frame(dispatch, device, time);
 
-	fallback_flush_wheels(dispatch, device, time);
+	if (class & FALLBACK_CLASS_REL)
+		fallback_flush_wheels(dispatch, device, time);
 
 	/* Buttons and keys */
-	if (dispatch->pending_event & EVDEV_KEY) {
+	if ((class & (FALLBACK_CLASS_KEYS|FALLBACK_CLASS_BUTTONS)) &&
+	    dispatch->pending_event & EVDEV_KEY) {
 		bool want_debounce = false;
-		for (unsigned int code = 0; code <= KEY_MAX; code++) {
-			if (!hw_key_has_changed(dispatch, code))
-				continue;
 
-			if (get_key_type(code) == KEY_TYPE_BUTTON) {
-				want_debounce = true;
-				break;
+		/* Only scan for changed buttons if a button event was seen,
+		 * keyboards never get here */
+		if ((class & FALLBACK_CLASS_BUTTONS) &&
+		    dispatch->pending_event & EVDEV_BUTTON) {
+			for (unsigned int code = BTN_MISC; code <= KEY_MAX; code++) {
+				if (!hw_key_has_changed(dispatch, code))
+					continue;
+
+				if (get_key_type(code) == KEY_TYPE_BUTTON) {
+					want_debounce = true;
+					break;
+				}
 			}
 		}
 
@@ -1026,46 +1185,155 @@ fallback_handle_state(struct fallback_dispatch *dispatch,
 		hw_key_update_last_state(dispatch);
 	}
 
+	if (has_pointer)
+		pointer_frame_end(&device->base);
+
 	dispatch->pending_event = EVDEV_NONE;
 }
 
-static void
-fallback_interface_process(struct evdev_dispatch *evdev_dispatch,
-			   struct evdev_device *device,
-			   struct input_event *event,
-			   uint64_t time)
+static inline void
+fallback_process_event(struct fallback_dispatch *dispatch,
+		       struct evdev_device *device,
+		       struct input_event *event,
+		       uint64_t time,
+		       const uint32_t class)
 {
-	struct fallback_dispatch *dispatch = fallback_dispatch(evdev_dispatch);
-
-	if (dispatch->arbitration.in_arbitration)
-		return;
-
 	switch (event->type) {
 	case EV_REL:
-		fallback_process_relative(dispatch, device, event, time);
+		if (class & FALLBACK_CLASS_REL)
+			fallback_process_relative(dispatch, device, event, time);
 		break;
 	case EV_ABS:
-		fallback_process_absolute(dispatch, device, event, time);
+		if (class & (FALLBACK_CLASS_ABS|FALLBACK_CLASS_MT))
+			fallback_process_absolute(dispatch, device, event, time);
 		break;
 	case EV_KEY:
-		fallback_process_key(dispatch, device, event, time);
+		/* Only the generic class needs to look at has_buttons */
+		if ((class & FALLBACK_CLASS_BUTTONS) &&
+		    ((class & FALLBACK_CLASS_KEYS) == 0 || dispatch->has_buttons))
+			fallback_process_key(dispatch, device, event, time);
+		else if (class & FALLBACK_CLASS_KEYS)
+			fallback_process_keyboard_key(dispatch, device, event, time);
 		break;
 	case EV_SW:
-		fallback_process_switch(dispatch, device, event, time);
+		if (class & FALLBACK_CLASS_SWITCH)
+			fallback_process_switch(dispatch, device, event, time);
 		break;
 	case EV_SYN:
-		fallback_handle_state(dispatch, device, time);
+		if ((class & FALLBACK_CLASS_MT) &&
+		    dispatch->mt.protocol_a.enabled) {
+			fallback_protocol_a_process(dispatch, device, event, time);
+			/* SYN_MT_REPORT only ends a contact, not the frame */
+			if (event->code != SYN_REPORT)
+				break;
+		}
+		fallback_handle_state(dispatch, device, time, class);
 		break;
 	}
 }
 
+static void
+fallback_interface_process(struct evdev_dispatch *evdev_dispatch,
+			   struct evdev_device *device,
+			   struct input_event *event,
+			   uint64_t time)
+{
+	struct fallback_dispatch *dispatch = fallback_dispatch(evdev_dispatch);
+
+	if (dispatch->arbitration.in_arbitration) {
+		if (event->type == EV_SYN && event->code == SYN_REPORT)
+			libinput_device_stat_inc(&device->base,
+						 LIBINPUT_DEVICE_STAT_DISCARDED_ARBITRATION);
+		return;
+	}
+
+	fallback_process_event(dispatch, device, event, time,
+			       FALLBACK_CLASS_ANY);
+}
+
+static inline void
+fallback_process_frame(struct evdev_dispatch *evdev_dispatch,
+		       struct evdev_device *device,
+		       struct input_event *events,
+		       size_t nevents,
+		       uint64_t time,
+		       const uint32_t class)
+{
+	struct fallback_dispatch *dispatch = fallback_dispatch(evdev_dispatch);
+
+	/* Only touch screens are paired with a tablet for arbitration */
+	if ((class & (FALLBACK_CLASS_ABS|FALLBACK_CLASS_MT)) &&
+	    dispatch->arbitration.in_arbitration) {
+		libinput_device_stat_inc(&device->base,
+					 LIBINPUT_DEVICE_STAT_DISCARDED_ARBITRATION);
+		return;
+	}
+
+	for (size_t i = 0; i < nevents; i++)
+		fallback_process_event(dispatch, device, &events[i], time, class);
+}
+
+static void
+fallback_interface_process_frame(struct evdev_dispatch *evdev_dispatch,
+				 struct evdev_device *device,
+				 struct input_event *events,
+				 size_t nevents,
+				 uint64_t time)
+{
+	fallback_process_frame(evdev_dispatch, device, events, nevents, time,
+			       FALLBACK_CLASS_ANY);
+}
+
+static void
+fallback_process_frame_keyboard(struct evdev_dispatch *evdev_dispatch,
+				struct evdev_device *device,
+				struct input_event *events,
+				size_t nevents,
+				uint64_t time)
+{
+	fallback_process_frame(evdev_dispatch, device, events, nevents, time,
+			       FALLBACK_CLASS_KEYBOARD);
+}
+
+static void
+fallback_process_frame_pointer(struct evdev_dispatch *evdev_dispatch,
+			       struct evdev_device *device,
+			       struct input_event *events,
+			       size_t nevents,
+			       uint64_t time)
+{
+	fallback_process_frame(evdev_dispatch, device, events, nevents, time,
+			       FALLBACK_CLASS_REL_POINTER);
+}
+
+static void
+fallback_process_frame_touchscreen(struct evdev_dispatch *evdev_dispatch,
+				   struct evdev_device *device,
+				   struct input_event *events,
+				   size_t nevents,
+				   uint64_t time)
+{
+	fallback_process_frame(evdev_dispatch, device, events, nevents, time,
+			       FALLBACK_CLASS_TOUCHSCREEN);
+}
+
+static void
+fallback_process_frame_switch(struct evdev_dispatch *evdev_dispatch,
+			      struct evdev_device *device,
+			      struct input_event *events,
+			      size_t nevents,
+			      uint64_t time)
+{
+	fallback_process_frame(evdev_dispatch, device, events, nevents, time,
+			       FALLBACK_CLASS_SWITCHES);
+}
+
 static void
 cancel_touches(struct fallback_dispatch *dispatch,
 	       struct evdev_device *device,
 	       const struct device_coord_rect *rect,
 	       uint64_t time)
 {
-	unsigned int idx;
 	bool need_frame = false;
 
 	if (!rect || point_in_rect(&dispatch->abs.point, rect))
@@ -1073,19 +1341,22 @@ cancel_touches(struct fallback_dispatch *dispatch,
 						      device,
 						      time);
 
-	for (idx = 0; idx < dispatch->mt.slots_len; idx++) {
-		struct mt_slot *slot = &dispatch->mt.slots[idx];
+	for (size_t w = 0; w < NLONGS(dispatch->mt.slots_len); w++) {
+		unsigned long active = dispatch->mt.active_slots[w];
 
-		if (slot->seat_slot == -1)
-			continue;
+		while (active) {
+			unsigned int idx = w * LONG_BITS + __builtin_ctzl(active);
+			struct mt_slot *slot = &dispatch->mt.slots[idx];
 
-		if ((!rect || point_in_rect(&slot->point, rect)) &&
-		    fallback_flush_mt_cancel(dispatch, device, idx, time))
-			need_frame = true;
+			active &= active - 1;
+			if ((!rect || point_in_rect(&slot->point, rect)) &&
+			    fallback_flush_mt_cancel(dispatch, device, idx, time))
+				need_frame = true;
+		}
 	}
 
-	if (need_frame)
-		touch_notify_frame(&device->base, time);
+	if (need_frame || dispatch->touch_frame.npoints > 0)
+		fallback_notify_touch_frame(dispatch, device, time);
 }
 
 static void
@@ -1259,6 +1530,7 @@ fallback_interface_toggle_touch(struct evdev_dispatch *evdev_dispatch,
 		 * get what looks like a tap. Fix this by delaying
 		 * arbitration by just a little bit so that any touch in
 		 * event is caught as palm touch. */
+		dispatch->arbitration.release_time = time;
 		libinput_timer_set(&dispatch->arbitration.arbitration_timer,
 				   time + ms2us(90));
 		break;
@@ -1287,8 +1559,33 @@ fallback_interface_destroy(struct evdev_dispatch *evdev_dispatch)
 	libinput_timer_destroy(&dispatch->debounce.timer);
 	libinput_timer_destroy(&dispatch->debounce.timer_short);
 
-	free(dispatch->mt.slots);
-	free(dispatch);
+	mem_free(dispatch);
+}
+
+static size_t
+fallback_interface_memory_usage(struct evdev_dispatch *evdev_dispatch)
+{
+	struct fallback_dispatch *dispatch = fallback_dispatch(evdev_dispatch);
+	struct evdev_paired_keyboard *kbd;
+	size_t size = sizeof(*dispatch);
+
+	size += dispatch->mt.slots_len * sizeof(*dispatch->mt.slots);
+	size += 2 * NLONGS(dispatch->mt.slots_len) * sizeof(long);
+	if (dispatch->mt.protocol_a.enabled) {
+		size_t nslots = dispatch->mt.slots_len;
+
+		size += nslots * sizeof(*dispatch->mt.protocol_a.contacts);
+		size += nslots * sizeof(*dispatch->mt.protocol_a.tracking_ids);
+		size += nslots * nslots *
+			sizeof(*dispatch->mt.protocol_a.matches);
+	}
+	size += dispatch->touch_frame.size *
+		sizeof(*dispatch->touch_frame.points);
+
+	list_for_each(kbd, &dispatch->lid.paired_keyboard_list, link)
+		size += sizeof(*kbd);
+
+	return size;
 }
 
 static void
@@ -1415,6 +1712,7 @@ fallback_pair_tablet_mode(struct evdev_device *keyboard,
 
 	libinput_device_add_event_listener(&tablet_mode_switch->base,
 				&dispatch->tablet_mode.other.listener,
+				EVENT_GROUP(LIBINPUT_EVENT_SWITCH_TOGGLE),
 				fallback_tablet_mode_switch_event,
 				dispatch);
 	dispatch->tablet_mode.other.sw_device = tablet_mode_switch;
@@ -1465,21 +1763,44 @@ fallback_interface_device_removed(struct evdev_device *device,
 	}
 }
 
-struct evdev_dispatch_interface fallback_interface = {
-	.process = fallback_interface_process,
-	.suspend = fallback_interface_suspend,
-	.remove = fallback_interface_remove,
-	.destroy = fallback_interface_destroy,
-	.device_added = fallback_interface_device_added,
-	.device_removed = fallback_interface_device_removed,
-	.device_suspended = fallback_interface_device_removed, /* treat as remove */
-	.device_resumed = fallback_interface_device_added,   /* treat as add */
-	.post_added = fallback_interface_sync_initial_state,
-	.touch_arbitration_toggle = fallback_interface_toggle_touch,
-	.touch_arbitration_update_rect = fallback_interface_update_rect,
-	.get_switch_state = fallback_interface_get_switch_state,
+#define FALLBACK_INTERFACE(process_frame_) { \
+	.process = fallback_interface_process, \
+	.process_frame = process_frame_, \
+	.suspend = fallback_interface_suspend, \
+	.remove = fallback_interface_remove, \
+	.destroy = fallback_interface_destroy, \
+	.device_added = fallback_interface_device_added, \
+	.pair_tags = EVDEV_TAG_KEYBOARD | EVDEV_TAG_TABLET_MODE_SWITCH, \
+	.device_removed = fallback_interface_device_removed, \
+	.device_suspended = fallback_interface_device_removed, /* treat as remove */ \
+	.device_resumed = fallback_interface_device_added,   /* treat as add */ \
+	.post_added = fallback_interface_sync_initial_state, \
+	.touch_arbitration_toggle = fallback_interface_toggle_touch, \
+	.touch_arbitration_update_rect = fallback_interface_update_rect, \
+	.get_switch_state = fallback_interface_get_switch_state, \
+	.memory_usage = fallback_interface_memory_usage, \
+}
+
+/* The first interface whose class covers everything the device can
+ * send is used, the generic one covers everything */
+static struct {
+	uint32_t class;
+	struct evdev_dispatch_interface interface;
+} fallback_interfaces[] = {
+	{ FALLBACK_CLASS_KEYBOARD,
+	  FALLBACK_INTERFACE(fallback_process_frame_keyboard) },
+	{ FALLBACK_CLASS_REL_POINTER,
+	  FALLBACK_INTERFACE(fallback_process_frame_pointer) },
+	{ FALLBACK_CLASS_TOUCHSCREEN,
+	  FALLBACK_INTERFACE(fallback_process_frame_touchscreen) },
+	{ FALLBACK_CLASS_SWITCHES,
+	  FALLBACK_INTERFACE(fallback_process_frame_switch) },
+	{ FALLBACK_CLASS_ANY,
+	  FALLBACK_INTERFACE(fallback_interface_process_frame) },
 };
 
+#undef FALLBACK_INTERFACE
+
 static void
 fallback_change_to_left_handed(struct evdev_device *device)
 {
@@ -1579,29 +1900,25 @@ fallback_dispatch_init_slots(struct fallback_dispatch *dispatch,
 	    !libevdev_has_event_code(evdev, EV_ABS, ABS_MT_POSITION_Y))
 		 return 0;
 
-	/* We only handle the slotted Protocol B in libinput.
-	   Devices with ABS_MT_POSITION_* but not ABS_MT_SLOT
-	   require mtdev for conversion. */
-	if (evdev_need_mtdev(device)) {
-		device->mtdev = mtdev_new_open(device->fd);
-		if (!device->mtdev)
-			return -1;
-
+	/* Devices with ABS_MT_POSITION_* but not ABS_MT_SLOT
+	   are Protocol A, their contacts are assigned to slots
+	   in evdev-protocol-a.c */
+	if (evdev_is_protocol_a_device(device)) {
 		/* pick 10 slots as default for type A
 		   devices. */
 		num_slots = 10;
-		active_slot = device->mtdev->caps.slot.value;
+		active_slot = 0;
 	} else {
 		num_slots = libevdev_get_num_slots(device->evdev);
 		active_slot = libevdev_get_current_slot(evdev);
 	}
 
-	slots = zalloc(num_slots * sizeof(struct mt_slot));
+	slots = arena_zalloc(&device->arena, num_slots * sizeof(struct mt_slot));
 
 	for (slot = 0; slot < num_slots; ++slot) {
 		slots[slot].seat_slot = -1;
 
-		if (evdev_need_mtdev(device))
+		if (evdev_is_protocol_a_device(device))
 			continue;
 
 		slots[slot].point.x = libevdev_get_slot_value(evdev,
@@ -1613,11 +1930,18 @@ fallback_dispatch_init_slots(struct fallback_dispatch *dispatch,
 	}
 	dispatch->mt.slots = slots;
 	dispatch->mt.slots_len = num_slots;
+	dispatch->mt.dirty_slots = arena_zalloc(&device->arena,
+						NLONGS(num_slots) * sizeof(long));
+	dispatch->mt.active_slots = arena_zalloc(&device->arena,
+						 NLONGS(num_slots) * sizeof(long));
 	dispatch->mt.slot = active_slot;
 	dispatch->mt.has_palm = libevdev_has_event_code(evdev,
 							EV_ABS,
 							ABS_MT_TOOL_TYPE);
 
+	if (evdev_is_protocol_a_device(device))
+		fallback_init_protocol_a(dispatch, device);
+
 	if (device->abs.absinfo_x->fuzz || device->abs.absinfo_y->fuzz) {
 		dispatch->mt.want_hysteresis = true;
 		dispatch->mt.hysteresis_margin.x = device->abs.absinfo_x->fuzz/2;
@@ -1627,6 +1951,26 @@ fallback_dispatch_init_slots(struct fallback_dispatch *dispatch,
 	return 0;
 }
 
+static inline void
+fallback_dispatch_init_keys(struct fallback_dispatch *dispatch,
+			    struct evdev_device *device)
+{
+	/* Single-touch BTN_TOUCH is handled by fallback_process_key() */
+	if (!device->is_mt &&
+	    libevdev_has_event_code(device->evdev, EV_KEY, BTN_TOUCH)) {
+		dispatch->has_buttons = true;
+		return;
+	}
+
+	for (unsigned int code = BTN_MISC; code <= KEY_MAX; code++) {
+		if (get_key_type(code) == KEY_TYPE_BUTTON &&
+		    libevdev_has_event_code(device->evdev, EV_KEY, code)) {
+			dispatch->has_buttons = true;
+			break;
+		}
+	}
+}
+
 static inline void
 fallback_dispatch_init_rel(struct fallback_dispatch *dispatch,
 			   struct evdev_device *device)
@@ -1672,13 +2016,56 @@ fallback_dispatch_init_switch(struct fallback_dispatch *dispatch,
 	libinput_device_init_event_listener(&dispatch->tablet_mode.other.listener);
 }
 
+static uint32_t
+fallback_dispatch_classify(struct fallback_dispatch *dispatch,
+			   struct evdev_device *device)
+{
+	struct libevdev *evdev = device->evdev;
+	uint32_t class = 0;
+
+	if (libevdev_has_event_type(evdev, EV_REL))
+		class |= FALLBACK_CLASS_REL;
+	if (libevdev_has_event_type(evdev, EV_ABS))
+		class |= (device->is_mt || dispatch->mt.protocol_a.enabled) ?
+			FALLBACK_CLASS_MT : FALLBACK_CLASS_ABS;
+	if (libevdev_has_event_type(evdev, EV_KEY))
+		class |= dispatch->has_buttons ?
+			FALLBACK_CLASS_BUTTONS : FALLBACK_CLASS_KEYS;
+	if (libevdev_has_event_type(evdev, EV_SW))
+		class |= FALLBACK_CLASS_SWITCH;
+
+	return class;
+}
+
+static struct evdev_dispatch_interface *
+fallback_dispatch_select_interface(struct fallback_dispatch *dispatch,
+				   struct evdev_device *device)
+{
+	uint32_t class = fallback_dispatch_classify(dispatch, device);
+	size_t i;
+
+	for (i = 0; i < ARRAY_LENGTH(fallback_interfaces); i++) {
+		if ((class & ~fallback_interfaces[i].class) == 0)
+			break;
+	}
+
+	assert(i < ARRAY_LENGTH(fallback_interfaces));
+
+	return &fallback_interfaces[i].interface;
+}
+
 static void
 fallback_arbitration_timeout(uint64_t now, void *data)
 {
 	struct fallback_dispatch *dispatch = data;
 
-	if (dispatch->arbitration.in_arbitration)
+	if (dispatch->arbitration.in_arbitration) {
 		dispatch->arbitration.in_arbitration = false;
+		libinput_device_record_delay(&dispatch->device->base,
+					     LIBINPUT_DELAY_SOURCE_ARBITRATION,
+					     dispatch->arbitration.release_time,
+					     now);
+	}
 }
 
 static void
@@ -1705,21 +2092,28 @@ fallback_dispatch_create(struct libinput_device *libinput_device)
 	struct evdev_device *device = evdev_device(libinput_device);
 	struct fallback_dispatch *dispatch;
 
-	dispatch = zalloc(sizeof *dispatch);
+	dispatch = mem_zalloc(sizeof *dispatch);
 	dispatch->device = evdev_device(libinput_device);
 	dispatch->base.dispatch_type = DISPATCH_FALLBACK;
-	dispatch->base.interface = &fallback_interface;
 	dispatch->pending_event = EVDEV_NONE;
 	list_init(&dispatch->lid.paired_keyboard_list);
 
+	fallback_dispatch_init_keys(dispatch, device);
 	fallback_dispatch_init_rel(dispatch, device);
 	fallback_dispatch_init_abs(dispatch, device);
 	if (fallback_dispatch_init_slots(dispatch, device) == -1) {
-		free(dispatch);
+		mem_free(dispatch);
 		return NULL;
 	}
 
+	dispatch->touch_frame.size = dispatch->mt.slots_len + 2;
+	dispatch->touch_frame.points = arena_zalloc(&device->arena,
+						    dispatch->touch_frame.size *
+						    sizeof(*dispatch->touch_frame.points));
+
 	fallback_dispatch_init_switch(dispatch, device);
+	dispatch->base.interface = fallback_dispatch_select_interface(dispatch,
+								      device);
 
 	if (device->left_handed.want_enabled)
 		evdev_init_left_handed(device,
@@ -1740,8 +2134,10 @@ fallback_dispatch_create(struct libinput_device *libinput_device)
 	 * we can only use the absence of BTN_MIDDLE to mean something, i.e.
 	 * we enable it by default on anything that only has L&R.
 	 * If we have L&R and no middle, we don't expose it as config
-	 * option */
-	if (libevdev_has_event_code(device->evdev, EV_KEY, BTN_LEFT) &&
+	 * option. Virtual devices get their buttons from a host that
+	 * already did whatever emulation the user wanted */
+	if ((device->model_flags & EVDEV_MODEL_VIRTUAL_DEVICE) == 0 &&
+	    libevdev_has_event_code(device->evdev, EV_KEY, BTN_LEFT) &&
 	    libevdev_has_event_code(device->evdev, EV_KEY, BTN_RIGHT)) {
 		bool has_middle = libevdev_has_event_code(device->evdev,
 							  EV_KEY,
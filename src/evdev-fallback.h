@@ -59,8 +59,21 @@ enum palm_state {
 	PALM_WAS_PALM, /* this touch sequence was a palm but isn't now */
 };
 
+/* A protocol A contact, i.e. the values between two SYN_MT_REPORT */
+struct mt_contact {
+	struct device_coords point;
+	int32_t tracking_id; /* -1 if the device doesn't send them */
+	int32_t tool_type;
+};
+
+/* A candidate assignment of a contact to a slot */
+struct mt_contact_match {
+	uint64_t dist2;
+	uint16_t contact;
+	uint16_t slot;
+};
+
 struct mt_slot {
-	bool dirty;
 	enum mt_slot_state state;
 	int32_t seat_slot;
 	struct device_coords point;
@@ -68,18 +81,36 @@ struct mt_slot {
 	enum palm_state palm_state;
 };
 
+/* What a fallback device can send, see fallback_dispatch_classify() */
+enum fallback_class {
+	FALLBACK_CLASS_REL		= bit(0),
+	FALLBACK_CLASS_ABS		= bit(1), /* single-touch or pointer */
+	FALLBACK_CLASS_MT		= bit(2), /* includes protocol A */
+	FALLBACK_CLASS_KEYS		= bit(3), /* keys but no buttons */
+	FALLBACK_CLASS_BUTTONS		= bit(4), /* buttons and maybe keys */
+	FALLBACK_CLASS_SWITCH		= bit(5),
+};
+
+#define FALLBACK_CLASS_ANY		(FALLBACK_CLASS_REL|FALLBACK_CLASS_ABS| \
+					 FALLBACK_CLASS_MT|FALLBACK_CLASS_KEYS| \
+					 FALLBACK_CLASS_BUTTONS|FALLBACK_CLASS_SWITCH)
+#define FALLBACK_CLASS_KEYBOARD		FALLBACK_CLASS_KEYS
+#define FALLBACK_CLASS_REL_POINTER	(FALLBACK_CLASS_REL|FALLBACK_CLASS_BUTTONS)
+#define FALLBACK_CLASS_TOUCHSCREEN	(FALLBACK_CLASS_MT|FALLBACK_CLASS_KEYS)
+#define FALLBACK_CLASS_SWITCHES		(FALLBACK_CLASS_SWITCH|FALLBACK_CLASS_KEYS)
+
 struct fallback_dispatch {
 	struct evdev_dispatch base;
 	struct evdev_device *device;
 
-	struct libinput_device_config_calibration calibration;
+	/* The per-frame state comes first, see struct evdev_device */
+	enum evdev_event_type pending_event;
 
-	struct {
-		bool is_enabled;
-		int angle;
-		struct matrix matrix;
-		struct libinput_device_config_rotation config;
-	} rotation;
+	/* false for keyboards, see fallback_process_keyboard_key() */
+	bool has_buttons;
+
+	struct device_coords rel;
+	struct device_coords wheel;
 
 	struct {
 		struct device_coords point;
@@ -90,33 +121,46 @@ struct fallback_dispatch {
 		int slot;
 		struct mt_slot *slots;
 		size_t slots_len;
+		/* Bitmasks of NLONGS(slots_len) longs: slots changed since
+		 * the last flush, slots with a touch down sent */
+		unsigned long *dirty_slots;
+		unsigned long *active_slots;
 		bool want_hysteresis;
 		struct device_coords hysteresis_margin;
 		bool has_palm;
-	} mt;
 
-	struct device_coords rel;
-	struct device_coords wheel;
+		/* Protocol A devices: the contacts of the current frame are
+		 * assigned to slots on SYN_REPORT, see evdev-protocol-a.c */
+		struct {
+			bool enabled;
+			struct mt_contact current;
+			bool current_valid;
+			struct mt_contact *contacts; /* slots_len */
+			size_t ncontacts;
+			int32_t *tracking_ids; /* per slot */
+			struct mt_contact_match *matches; /* slots_len² */
+		} protocol_a;
+	} mt;
 
+	/* Touch points of the current frame with touch frame batching
+	 * enabled, sized for every slot plus a single-touch down and up */
 	struct {
-		/* The struct for the tablet mode switch device itself */
-		struct {
-			int state;
-		} sw;
-		/* The struct for other devices listening to the tablet mode
-		   switch */
-		struct {
-			struct evdev_device *sw_device;
-			struct libinput_event_listener listener;
-		} other;
-	} tablet_mode;
+		struct touch_frame_point *points;
+		size_t npoints;
+		size_t size;
+	} touch_frame;
 
 	/* Bitmask of pressed keys used to ignore initial release events from
 	 * the kernel. */
 	unsigned long hw_key_mask[NLONGS(KEY_CNT)];
 	unsigned long last_hw_key_mask[NLONGS(KEY_CNT)];
 
-	enum evdev_event_type pending_event;
+	struct {
+		bool is_enabled;
+		int angle;
+		struct matrix matrix;
+		struct libinput_device_config_rotation config;
+	} rotation;
 
 	struct {
 		unsigned int button_code;
@@ -125,8 +169,36 @@ struct fallback_dispatch {
 		struct libinput_timer timer_short;
 		enum debounce_state state;
 		bool spurious_enabled;
+		/* timeouts expired without a bounce since the last bounce */
+		unsigned int clean_count;
+		/* don't arm the timers, see debounce_lazy_catch_up() */
+		bool lazy;
 	} debounce;
 
+	/* pen/touch arbitration has a delayed state,
+	 * in_arbitration is what decides when to filter.
+	 */
+	struct {
+		enum evdev_arbitration_state state;
+		bool in_arbitration;
+		struct device_coord_rect rect;
+		struct libinput_timer arbitration_timer;
+		uint64_t release_time; /* when the tool left proximity */
+	} arbitration;
+
+	struct {
+		/* The struct for the tablet mode switch device itself */
+		struct {
+			int state;
+		} sw;
+		/* The struct for other devices listening to the tablet mode
+		   switch */
+		struct {
+			struct evdev_device *sw_device;
+			struct libinput_event_listener listener;
+		} other;
+	} tablet_mode;
+
 	struct {
 		enum switch_reliability reliability;
 
@@ -141,15 +213,7 @@ struct fallback_dispatch {
 		struct list paired_keyboard_list;
 	} lid;
 
-	/* pen/touch arbitration has a delayed state,
-	 * in_arbitration is what decides when to filter.
-	 */
-	struct {
-		enum evdev_arbitration_state state;
-		bool in_arbitration;
-		struct device_coord_rect rect;
-		struct libinput_timer arbitration_timer;
-	} arbitration;
+	struct libinput_device_config_calibration calibration;
 };
 
 static inline struct fallback_dispatch*
@@ -235,11 +299,18 @@ hw_is_key_down(struct fallback_dispatch *dispatch, int code)
 static inline int
 get_key_down_count(struct evdev_device *device, int code)
 {
-	return device->key_count[code];
+	return key_count_get(&device->key_count, code);
 }
 
 void fallback_init_debounce(struct fallback_dispatch *dispatch);
 void fallback_debounce_handle_state(struct fallback_dispatch *dispatch,
 				    uint64_t time);
 
+void fallback_init_protocol_a(struct fallback_dispatch *dispatch,
+			      struct evdev_device *device);
+void fallback_protocol_a_process(struct fallback_dispatch *dispatch,
+				 struct evdev_device *device,
+				 struct input_event *e,
+				 uint64_t time);
+
 #endif
@@ -28,6 +28,8 @@
 #include "evdev.h"
 
 #define MIDDLEBUTTON_TIMEOUT ms2us(50)
+#define MIDDLEBUTTON_TIMEOUT_MIN ms2us(20)
+#define MIDDLEBUTTON_FRAME_SLACK ms2us(4) /* see libinput_set_frame_deadline() */
 
 /*****************************************
  * BEFORE YOU EDIT THIS FILE, look at the state diagram in
@@ -87,11 +89,56 @@ middlebutton_state_error(struct evdev_device *device,
 			       middlebutton_state_to_str(device->middlebutton.state));
 }
 
+/**
+ * The time we wait for the second button of a chord adapts to the user.
+ * chord_interval is the longest interval between the two presses of
+ * recent chords, including chords we missed because the timeout was too
+ * short. Every click that isn't a chord shrinks it a bit, so the less
+ * often a user presses chords, the less their clicks are delayed.
+ */
+static inline uint64_t
+middlebutton_timeout(struct evdev_device *device)
+{
+	uint64_t timeout = device->middlebutton.chord_interval * 3 / 2;
+
+	return min(max(timeout, MIDDLEBUTTON_TIMEOUT_MIN),
+		   MIDDLEBUTTON_TIMEOUT);
+}
+
+static inline void
+middlebutton_learn_chord(struct evdev_device *device, uint64_t time)
+{
+	uint64_t interval = time - device->middlebutton.first_event_time;
+
+	device->middlebutton.chord_interval =
+		max(device->middlebutton.chord_interval, interval);
+}
+
+static void
+evdev_middlebutton_handle_timeout(uint64_t now, void *data);
+
+/* The timer is initialized when first armed, middle button emulation is
+ * off by default on most devices */
 static void
 middlebutton_timer_set(struct evdev_device *device, uint64_t now)
 {
-	libinput_timer_set(&device->middlebutton.timer,
-			   now + MIDDLEBUTTON_TIMEOUT);
+	struct libinput_timer *timer = &device->middlebutton.timer;
+	char timer_name[64];
+
+	if (!libinput_timer_is_initialized(timer)) {
+		snprintf(timer_name,
+			 sizeof(timer_name),
+			 "%s middlebutton",
+			 evdev_device_get_sysname(device));
+		libinput_timer_init(timer,
+				    evdev_libinput_context(device),
+				    timer_name,
+				    evdev_middlebutton_handle_timeout,
+				    device);
+		libinput_timer_set_frame_slack(timer, MIDDLEBUTTON_FRAME_SLACK);
+	}
+
+	libinput_timer_set(timer, now + middlebutton_timeout(device));
 }
 
 static void
@@ -110,6 +157,7 @@ middlebutton_set_state(struct evdev_device *device,
 	case MIDDLEBUTTON_RIGHT_DOWN:
 		middlebutton_timer_set(device, now);
 		device->middlebutton.first_event_time = now;
+		device->middlebutton.timed_out = false;
 		break;
 	case MIDDLEBUTTON_IDLE:
 	case MIDDLEBUTTON_MIDDLE:
@@ -138,6 +186,29 @@ middlebutton_post_event(struct evdev_device *device,
 				    state);
 }
 
+/**
+ * Post the press of the button that was held back in LEFT_DOWN or
+ * RIGHT_DOWN, now that it's not part of a chord.
+ */
+static void
+middlebutton_post_delayed_press(struct evdev_device *device,
+				uint64_t now,
+				uint64_t press_time,
+				int button)
+{
+	libinput_device_record_delay(&device->base,
+				     LIBINPUT_DELAY_SOURCE_MIDDLEBUTTON,
+				     device->middlebutton.first_event_time,
+				     now);
+
+	device->middlebutton.chord_interval -=
+		device->middlebutton.chord_interval / 32;
+
+	middlebutton_post_event(device, press_time,
+				button,
+				LIBINPUT_BUTTON_STATE_PRESSED);
+}
+
 static int
 evdev_middlebutton_idle_handle_event(struct evdev_device *device,
 				     uint64_t time,
@@ -174,15 +245,14 @@ evdev_middlebutton_ldown_handle_event(struct evdev_device *device,
 		middlebutton_state_error(device, event);
 		break;
 	case MIDDLEBUTTON_EVENT_R_DOWN:
+		middlebutton_learn_chord(device, time);
 		middlebutton_post_event(device, time,
 					BTN_MIDDLE,
 					LIBINPUT_BUTTON_STATE_PRESSED);
 		middlebutton_set_state(device, MIDDLEBUTTON_MIDDLE, time);
 		break;
 	case MIDDLEBUTTON_EVENT_OTHER:
-		middlebutton_post_event(device, time,
-					BTN_LEFT,
-					LIBINPUT_BUTTON_STATE_PRESSED);
+		middlebutton_post_delayed_press(device, time, time, BTN_LEFT);
 		middlebutton_set_state(device,
 				       MIDDLEBUTTON_PASSTHROUGH,
 				       time);
@@ -191,23 +261,24 @@ evdev_middlebutton_ldown_handle_event(struct evdev_device *device,
 		middlebutton_state_error(device, event);
 		break;
 	case MIDDLEBUTTON_EVENT_L_UP:
-		middlebutton_post_event(device,
-					device->middlebutton.first_event_time,
-					BTN_LEFT,
-					LIBINPUT_BUTTON_STATE_PRESSED);
+		middlebutton_post_delayed_press(device,
+						time,
+						device->middlebutton.first_event_time,
+						BTN_LEFT);
 		middlebutton_post_event(device, time,
 					BTN_LEFT,
 					LIBINPUT_BUTTON_STATE_RELEASED);
 		middlebutton_set_state(device, MIDDLEBUTTON_IDLE, time);
 		break;
 	case MIDDLEBUTTON_EVENT_TIMEOUT:
-		middlebutton_post_event(device,
-					device->middlebutton.first_event_time,
-					BTN_LEFT,
-					LIBINPUT_BUTTON_STATE_PRESSED);
+		middlebutton_post_delayed_press(device,
+						time,
+						device->middlebutton.first_event_time,
+						BTN_LEFT);
 		middlebutton_set_state(device,
 				       MIDDLEBUTTON_PASSTHROUGH,
 				       time);
+		device->middlebutton.timed_out = true;
 		break;
 	case MIDDLEBUTTON_EVENT_ALL_UP:
 		middlebutton_state_error(device, event);
@@ -224,6 +295,7 @@ evdev_middlebutton_rdown_handle_event(struct evdev_device *device,
 {
 	switch (event) {
 	case MIDDLEBUTTON_EVENT_L_DOWN:
+		middlebutton_learn_chord(device, time);
 		middlebutton_post_event(device, time,
 					BTN_MIDDLE,
 					LIBINPUT_BUTTON_STATE_PRESSED);
@@ -233,19 +305,19 @@ evdev_middlebutton_rdown_handle_event(struct evdev_device *device,
 		middlebutton_state_error(device, event);
 		break;
 	case MIDDLEBUTTON_EVENT_OTHER:
-		middlebutton_post_event(device,
-					device->middlebutton.first_event_time,
-					BTN_RIGHT,
-					LIBINPUT_BUTTON_STATE_PRESSED);
+		middlebutton_post_delayed_press(device,
+						time,
+						device->middlebutton.first_event_time,
+						BTN_RIGHT);
 		middlebutton_set_state(device,
 				       MIDDLEBUTTON_PASSTHROUGH,
 				       time);
 		return 0;
 	case MIDDLEBUTTON_EVENT_R_UP:
-		middlebutton_post_event(device,
-					device->middlebutton.first_event_time,
-					BTN_RIGHT,
-					LIBINPUT_BUTTON_STATE_PRESSED);
+		middlebutton_post_delayed_press(device,
+						time,
+						device->middlebutton.first_event_time,
+						BTN_RIGHT);
 		middlebutton_post_event(device, time,
 					BTN_RIGHT,
 					LIBINPUT_BUTTON_STATE_RELEASED);
@@ -255,13 +327,14 @@ evdev_middlebutton_rdown_handle_event(struct evdev_device *device,
 		middlebutton_state_error(device, event);
 		break;
 	case MIDDLEBUTTON_EVENT_TIMEOUT:
-		middlebutton_post_event(device,
-					device->middlebutton.first_event_time,
-					BTN_RIGHT,
-					LIBINPUT_BUTTON_STATE_PRESSED);
+		middlebutton_post_delayed_press(device,
+						time,
+						device->middlebutton.first_event_time,
+						BTN_RIGHT);
 		middlebutton_set_state(device,
 				       MIDDLEBUTTON_PASSTHROUGH,
 				       time);
+		device->middlebutton.timed_out = true;
 		break;
 	case MIDDLEBUTTON_EVENT_ALL_UP:
 		middlebutton_state_error(device, event);
@@ -389,9 +462,23 @@ evdev_middlebutton_passthrough_handle_event(struct evdev_device *device,
 					    uint64_t time,
 					    enum evdev_middlebutton_event event)
 {
+	uint32_t other_button;
+
 	switch (event) {
 	case MIDDLEBUTTON_EVENT_L_DOWN:
 	case MIDDLEBUTTON_EVENT_R_DOWN:
+		/* If the other button is still down from a timeout, the
+		 * user was likely trying for a chord and we gave up too
+		 * early */
+		other_button = event == MIDDLEBUTTON_EVENT_L_DOWN ?
+				bit(BTN_RIGHT - BTN_LEFT) :
+				bit(BTN_LEFT - BTN_LEFT);
+		if (device->middlebutton.timed_out &&
+		    (device->middlebutton.button_mask & other_button) &&
+		    time - device->middlebutton.first_event_time < MIDDLEBUTTON_TIMEOUT)
+			middlebutton_learn_chord(device, time);
+		device->middlebutton.timed_out = false;
+		return 0;
 	case MIDDLEBUTTON_EVENT_OTHER:
 	case MIDDLEBUTTON_EVENT_R_UP:
 	case MIDDLEBUTTON_EVENT_L_UP:
@@ -700,20 +787,11 @@ evdev_init_middlebutton(struct evdev_device *device,
 			bool enable,
 			bool want_config)
 {
-	char timer_name[64];
-
-	snprintf(timer_name,
-		 sizeof(timer_name),
-		 "%s middlebutton",
-		 evdev_device_get_sysname(device));
-	libinput_timer_init(&device->middlebutton.timer,
-			    evdev_libinput_context(device),
-			    timer_name,
-			    evdev_middlebutton_handle_timeout,
-			    device);
 	device->middlebutton.enabled_default = enable;
 	device->middlebutton.want_enabled = enable;
 	device->middlebutton.enabled = enable;
+	/* Start with the full timeout until we know the user */
+	device->middlebutton.chord_interval = MIDDLEBUTTON_TIMEOUT * 2 / 3;
 
 	if (!want_config)
 		return;
@@ -77,82 +77,47 @@ button_event_to_str(enum button_event event)
 	return NULL;
 }
 
-static inline bool
-is_inside_bottom_button_area(const struct tp_dispatch *tp,
-			     const struct tp_touch *t)
-{
-	return t->point.y >= tp->buttons.bottom_area.top_edge;
-}
-
-static inline bool
-is_inside_bottom_right_area(const struct tp_dispatch *tp,
-			    const struct tp_touch *t)
-{
-	return is_inside_bottom_button_area(tp, t) &&
-	       t->point.x > tp->buttons.bottom_area.rightbutton_left_edge;
-}
-
-static inline bool
-is_inside_bottom_middle_area(const struct tp_dispatch *tp,
-			   const struct tp_touch *t)
-{
-	return is_inside_bottom_button_area(tp, t) &&
-	       !is_inside_bottom_right_area(tp, t) &&
-	       t->point.x > tp->buttons.bottom_area.middlebutton_left_edge;
-}
-
-static inline bool
-is_inside_bottom_left_area(const struct tp_dispatch *tp,
-			   const struct tp_touch *t)
-{
-	return is_inside_bottom_button_area(tp, t) &&
-	       !is_inside_bottom_middle_area(tp, t) &&
-	       !is_inside_bottom_right_area(tp, t);
-}
-
-static inline bool
-is_inside_top_button_area(const struct tp_dispatch *tp,
-			  const struct tp_touch *t)
-{
-	return t->point.y <= tp->buttons.top_area.bottom_edge;
-}
-
-static inline bool
-is_inside_top_right_area(const struct tp_dispatch *tp,
-			 const struct tp_touch *t)
-{
-	return is_inside_top_button_area(tp, t) &&
-	       t->point.x > tp->buttons.top_area.rightbutton_left_edge;
-}
-
-static inline bool
-is_inside_top_left_area(const struct tp_dispatch *tp,
-			const struct tp_touch *t)
-{
-	return is_inside_top_button_area(tp, t) &&
-	       t->point.x < tp->buttons.top_area.leftbutton_right_edge;
-}
+static void
+tp_button_handle_timeout(uint64_t now, void *data);
 
-static inline bool
-is_inside_top_middle_area(const struct tp_dispatch *tp,
-			  const struct tp_touch *t)
+/* Initialized on first use, only the software button areas need the
+ * timers */
+static struct libinput_timer *
+tp_button_timer(struct tp_dispatch *tp, struct tp_touch *t)
 {
-	return is_inside_top_button_area(tp, t) &&
-	       t->point.x >= tp->buttons.top_area.leftbutton_right_edge &&
-	       t->point.x <= tp->buttons.top_area.rightbutton_left_edge;
+	struct libinput_timer *timer = &tp_touch_cold(t)->button.timer;
+	char timer_name[64];
+
+	if (libinput_timer_is_initialized(timer))
+		return timer;
+
+	/* one name for all touches, the index is only for log messages */
+	snprintf(timer_name,
+		 sizeof(timer_name),
+		 "%s button",
+		 evdev_device_get_sysname(tp->device));
+	libinput_timer_init(timer,
+			    tp_libinput_context(tp),
+			    timer_name,
+			    tp_button_handle_timeout, t);
+	libinput_timer_set_index(timer, t->index);
+
+	return timer;
 }
 
 static void
 tp_button_set_enter_timer(struct tp_dispatch *tp, struct tp_touch *t)
 {
-	libinput_timer_set(&t->button.timer,
+	tp_touch_cold(t)->button.timer_start = t->time;
+	libinput_timer_set(tp_button_timer(tp, t),
 			   t->time + DEFAULT_BUTTON_ENTER_TIMEOUT);
 }
 
 static void
 tp_button_set_leave_timer(struct tp_dispatch *tp, struct tp_touch *t)
 {
-	libinput_timer_set(&t->button.timer,
+	tp_touch_cold(t)->button.timer_start = t->time;
+	libinput_timer_set(tp_button_timer(tp, t),
 			   t->time + DEFAULT_BUTTON_LEAVE_TIMEOUT);
 }
 
@@ -166,7 +131,7 @@ tp_button_set_state(struct tp_dispatch *tp,
 		    enum button_state new_state,
 		    enum button_event event)
 {
-	libinput_timer_cancel(&t->button.timer);
+	libinput_timer_cancel(&tp_touch_cold(t)->button.timer);
 
 	t->button.state = new_state;
 
@@ -260,16 +225,17 @@ tp_button_release_other_bottom_touches(struct tp_dispatch *tp,
 	struct tp_touch *t;
 
 	tp_for_each_touch(tp, t) {
-		uint64_t tdelta;
+		uint64_t initial_time, tdelta;
 
 		if (t->button.state != BUTTON_STATE_BOTTOM ||
 		    t->button.has_moved)
 			continue;
 
-		if (other_start_time > t->button.initial_time)
-			tdelta = other_start_time - t->button.initial_time;
+		initial_time = tp_touch_cold(t)->button.initial_time;
+		if (other_start_time > initial_time)
+			tdelta = other_start_time - initial_time;
 		else
-			tdelta = t->button.initial_time - other_start_time;
+			tdelta = initial_time - other_start_time;
 
 		if (tdelta > ms2us(80))
 			continue;
@@ -305,7 +271,7 @@ tp_button_bottom_handle_event(struct tp_dispatch *tp,
 		 * because they're part of a gesture.
 		 */
 		tp_button_release_other_bottom_touches(tp,
-						       t->button.initial_time);
+						       tp_touch_cold(t)->button.initial_time);
 		break;
 	case BUTTON_EVENT_UP:
 		tp_button_set_state(tp, t, BUTTON_STATE_NONE, event);
@@ -497,6 +463,7 @@ tp_button_check_for_movement(struct tp_dispatch *tp, struct tp_touch *t)
 {
 	struct device_coords delta;
 	struct phys_coords mm;
+	struct tp_touch_cold *cold = tp_touch_cold(t);
 	double vector_length;
 
 	if (t->button.has_moved)
@@ -515,8 +482,8 @@ tp_button_check_for_movement(struct tp_dispatch *tp, struct tp_touch *t)
 		break;
 	}
 
-	delta.x = t->point.x - t->button.initial.x;
-	delta.y = t->point.y - t->button.initial.y;
+	delta.x = t->point.x - cold->button.initial.x;
+	delta.y = t->point.y - cold->button.initial.y;
 	mm = evdev_device_unit_delta_to_mm(tp->device, &delta);
 	vector_length = hypot(mm.x, mm.y);
 
@@ -524,7 +491,7 @@ tp_button_check_for_movement(struct tp_dispatch *tp, struct tp_touch *t)
 		t->button.has_moved = true;
 
 		tp_button_release_other_bottom_touches(tp,
-						       t->button.initial_time);
+						       cold->button.initial_time);
 	}
 }
 
@@ -533,13 +500,15 @@ tp_button_handle_state(struct tp_dispatch *tp, uint64_t time)
 {
 	struct tp_touch *t;
 
-	tp_for_each_touch(tp, t) {
+	tp_for_each_active_touch(tp, t) {
 		if (t->state == TOUCH_NONE || t->state == TOUCH_HOVERING)
 			continue;
 
 		if (t->state == TOUCH_BEGIN) {
-			t->button.initial = t->point;
-			t->button.initial_time = time;
+			struct tp_touch_cold *cold = tp_touch_cold(t);
+
+			cold->button.initial = t->point;
+			cold->button.initial_time = time;
 			t->button.has_moved = false;
 		}
 
@@ -547,11 +516,12 @@ tp_button_handle_state(struct tp_dispatch *tp, uint64_t time)
 			tp_button_handle_event(tp, t, BUTTON_EVENT_UP, time);
 		} else if (t->dirty) {
 			enum button_event event;
+			uint32_t regions = tp_touch_get_regions(tp, t);
 
-			if (is_inside_bottom_button_area(tp, t)) {
-				if (is_inside_bottom_right_area(tp, t))
+			if (regions & TP_REGION_BOTTOM_AREA) {
+				if (regions & TP_REGION_BOTTOM_RIGHT)
 					event = BUTTON_EVENT_IN_BOTTOM_R;
-				else if (is_inside_bottom_middle_area(tp, t))
+				else if (regions & TP_REGION_BOTTOM_MIDDLE)
 					event = BUTTON_EVENT_IN_BOTTOM_M;
 				else
 					event = BUTTON_EVENT_IN_BOTTOM_L;
@@ -559,10 +529,10 @@ tp_button_handle_state(struct tp_dispatch *tp, uint64_t time)
 				/* In the bottom area we check for movement
 				 * within the area. Top area - meh */
 				tp_button_check_for_movement(tp, t);
-			} else if (is_inside_top_button_area(tp, t)) {
-				if (is_inside_top_right_area(tp, t))
+			} else if (regions & TP_REGION_TOP_AREA) {
+				if (regions & TP_REGION_TOP_RIGHT)
 					event = BUTTON_EVENT_IN_TOP_R;
-				else if (is_inside_top_middle_area(tp, t))
+				else if (regions & TP_REGION_TOP_MIDDLE)
 					event = BUTTON_EVENT_IN_TOP_M;
 				else
 					event = BUTTON_EVENT_IN_TOP_L;
@@ -584,6 +554,11 @@ tp_button_handle_timeout(uint64_t now, void *data)
 {
 	struct tp_touch *t = data;
 
+	libinput_device_record_delay(&t->tp->device->base,
+				     LIBINPUT_DELAY_SOURCE_SOFTWARE_BUTTONS,
+				     tp_touch_cold(t)->button.timer_start,
+				     now);
+
 	tp_button_handle_event(t->tp, t, BUTTON_EVENT_TIMEOUT, now);
 }
 
@@ -711,6 +686,8 @@ tp_init_top_softbuttons(struct tp_dispatch *tp,
 	} else {
 		tp->buttons.top_area.bottom_edge = INT_MIN;
 	}
+
+	tp_regions_update(tp);
 }
 
 static inline uint32_t
@@ -755,6 +732,8 @@ tp_switch_click_method(struct tp_dispatch *tp)
 		tp->buttons.bottom_area.top_edge = INT_MAX;
 		break;
 	}
+
+	tp_regions_update(tp);
 }
 
 static enum libinput_config_status
@@ -764,8 +743,11 @@ tp_button_config_click_set_method(struct libinput_device *device,
 	struct evdev_device *evdev = evdev_device(device);
 	struct tp_dispatch *tp = (struct tp_dispatch*)evdev->dispatch;
 
-	tp->buttons.click_method = method;
-	tp_switch_click_method(tp);
+	tp->buttons.want_click_method = method;
+	if (!evdev_config_deferred(evdev)) {
+		tp->buttons.click_method = method;
+		tp_switch_click_method(tp);
+	}
 
 	return LIBINPUT_CONFIG_STATUS_SUCCESS;
 }
@@ -776,7 +758,9 @@ tp_button_config_click_get_method(struct libinput_device *device)
 	struct evdev_device *evdev = evdev_device(device);
 	struct tp_dispatch *tp = (struct tp_dispatch*)evdev->dispatch;
 
-	return tp->buttons.click_method;
+	/* return the wanted configuration, even if it hasn't taken
+	 * effect yet! */
+	return tp->buttons.want_click_method;
 }
 
 static enum libinput_config_click_method
@@ -809,23 +793,56 @@ tp_button_config_click_get_default_method(struct libinput_device *device)
 	return tp_click_get_default_method(tp);
 }
 
-void
-tp_clickpad_middlebutton_apply_config(struct evdev_device *device)
+/* Returns true if the middle button emulation state changed, the soft
+ * buttons need to be rebuilt then */
+static bool
+tp_clickpad_middlebutton_update(struct tp_dispatch *tp)
 {
-	struct tp_dispatch *tp = (struct tp_dispatch*)device->dispatch;
+	struct evdev_device *device = tp->device;
 
 	if (!tp->buttons.is_clickpad ||
 	    tp->buttons.state != 0)
-		return;
+		return false;
 
 	if (device->middlebutton.want_enabled ==
 	    device->middlebutton.enabled)
-		return;
+		return false;
 
 	device->middlebutton.enabled = device->middlebutton.want_enabled;
+
+	return true;
+}
+
+void
+tp_clickpad_middlebutton_apply_config(struct evdev_device *device)
+{
+	struct tp_dispatch *tp = (struct tp_dispatch*)device->dispatch;
+
+	if (!tp_clickpad_middlebutton_update(tp))
+		return;
+
 	if (tp->buttons.click_method ==
-	    LIBINPUT_CONFIG_CLICK_METHOD_BUTTON_AREAS)
+	    LIBINPUT_CONFIG_CLICK_METHOD_BUTTON_AREAS) {
 		tp_init_softbuttons(tp, device);
+		tp_regions_update(tp);
+	}
+}
+
+void
+tp_button_config_commit(struct tp_dispatch *tp)
+{
+	bool middle_changed = tp_clickpad_middlebutton_update(tp);
+
+	/* Switching the click method rebuilds the soft buttons anyway */
+	if (tp->buttons.want_click_method != tp->buttons.click_method) {
+		tp->buttons.click_method = tp->buttons.want_click_method;
+		tp_switch_click_method(tp);
+	} else if (middle_changed &&
+		   tp->buttons.click_method ==
+		   LIBINPUT_CONFIG_CLICK_METHOD_BUTTON_AREAS) {
+		tp_init_softbuttons(tp, tp->device);
+		tp_regions_update(tp);
+	}
 }
 
 static int
@@ -851,7 +868,8 @@ tp_clickpad_middlebutton_set(struct libinput_device *device,
 		return LIBINPUT_CONFIG_STATUS_INVALID;
 	}
 
-	tp_clickpad_middlebutton_apply_config(evdev);
+	if (!evdev_config_deferred(evdev))
+		tp_clickpad_middlebutton_apply_config(evdev);
 
 	return LIBINPUT_CONFIG_STATUS_SUCCESS;
 }
@@ -921,9 +939,7 @@ void
 tp_init_buttons(struct tp_dispatch *tp,
 		struct evdev_device *device)
 {
-	struct tp_touch *t;
 	const struct input_absinfo *absinfo_x, *absinfo_y;
-	int i;
 
 	tp->buttons.is_clickpad = libevdev_has_property(device->evdev,
 							INPUT_PROP_BUTTONPAD);
@@ -956,28 +972,12 @@ tp_init_buttons(struct tp_dispatch *tp,
 	tp->device->base.config.click_method = &tp->buttons.config_method;
 
 	tp->buttons.click_method = tp_click_get_default_method(tp);
+	tp->buttons.want_click_method = tp->buttons.click_method;
 	tp_switch_click_method(tp);
 
 	tp_init_top_softbuttons(tp, device, 1.0);
 
 	tp_init_middlebutton_emulation(tp, device);
-
-	i = 0;
-	tp_for_each_touch(tp, t) {
-		char timer_name[64];
-		i++;
-
-		snprintf(timer_name,
-			 sizeof(timer_name),
-			 "%s (%d) button",
-			 evdev_device_get_sysname(device),
-			 i);
-		t->button.state = BUTTON_STATE_NONE;
-		libinput_timer_init(&t->button.timer,
-				    tp_libinput_context(tp),
-				    timer_name,
-				    tp_button_handle_timeout, t);
-	}
 }
 
 void
@@ -986,8 +986,10 @@ tp_remove_buttons(struct tp_dispatch *tp)
 	struct tp_touch *t;
 
 	tp_for_each_touch(tp, t) {
-		libinput_timer_cancel(&t->button.timer);
-		libinput_timer_destroy(&t->button.timer);
+		struct libinput_timer *timer = &tp_touch_cold(t)->button.timer;
+
+		libinput_timer_cancel(timer);
+		libinput_timer_destroy(timer);
 	}
 }
 
@@ -1090,7 +1092,7 @@ tp_clickfinger_set_button(struct tp_dispatch *tp)
 	struct tp_touch *first = NULL,
 			*second = NULL;
 
-	tp_for_each_touch(tp, t) {
+	tp_for_each_active_touch(tp, t) {
 		if (t->state != TOUCH_BEGIN && t->state != TOUCH_UPDATE)
 			continue;
 
@@ -1301,6 +1303,6 @@ bool
 tp_button_is_inside_softbutton_area(const struct tp_dispatch *tp,
 				    const struct tp_touch *t)
 {
-	return is_inside_top_button_area(tp, t) ||
-	       is_inside_bottom_button_area(tp, t);
+	return tp_touch_get_regions(tp, t) &
+		(TP_REGION_TOP_AREA|TP_REGION_BOTTOM_AREA);
 }
@@ -73,14 +73,16 @@ uint32_t
 tp_touch_get_edge(const struct tp_dispatch *tp, const struct tp_touch *t)
 {
 	uint32_t edge = EDGE_NONE;
+	uint32_t regions;
 
 	if (tp->scroll.method != LIBINPUT_CONFIG_SCROLL_EDGE)
 		return EDGE_NONE;
 
-	if (t->point.x > tp->scroll.right_edge)
+	regions = tp_touch_get_regions(tp, t);
+	if (regions & TP_REGION_EDGE_RIGHT)
 		edge |= EDGE_RIGHT;
 
-	if (t->point.y > tp->scroll.bottom_edge)
+	if (regions & TP_REGION_EDGE_BOTTOM)
 		edge |= EDGE_BOTTOM;
 
 	return edge;
@@ -99,8 +101,50 @@ tp_edge_scroll_set_timer(struct tp_dispatch *tp,
 	    LIBINPUT_CONFIG_CLICK_METHOD_BUTTON_AREAS)
 		return;
 
-	libinput_timer_set(&t->scroll.timer,
-			   t->time + DEFAULT_SCROLL_LOCK_TIMEOUT);
+	tp_touch_cold(t)->scroll.timeout = t->time + DEFAULT_SCROLL_LOCK_TIMEOUT;
+}
+
+static void
+tp_edge_scroll_handle_timeout(uint64_t now, void *data);
+
+/* All touches share one timer, armed for the earliest deadline. It only
+ * needs to be touched when that deadline changes. The timer is
+ * initialized when first armed, most touchpads use two-finger scrolling */
+static void
+tp_edge_scroll_update_timer(struct tp_dispatch *tp)
+{
+	struct libinput_timer *timer = &tp->scroll.edge_timer;
+	struct tp_touch *t;
+	uint64_t earliest = 0;
+	char timer_name[64];
+
+	tp_for_each_touch(tp, t) {
+		uint64_t timeout = tp_touch_cold(t)->scroll.timeout;
+
+		if (timeout && (earliest == 0 || timeout < earliest))
+			earliest = timeout;
+	}
+
+	if (earliest == timer->expire)
+		return;
+
+	if (!earliest) {
+		libinput_timer_cancel(timer);
+		return;
+	}
+
+	if (!libinput_timer_is_initialized(timer)) {
+		snprintf(timer_name,
+			 sizeof(timer_name),
+			 "%s edgescroll",
+			 evdev_device_get_sysname(tp->device));
+		libinput_timer_init(timer,
+				    tp_libinput_context(tp),
+				    timer_name,
+				    tp_edge_scroll_handle_timeout, tp);
+	}
+
+	libinput_timer_set(timer, earliest);
 }
 
 static void
@@ -108,7 +152,7 @@ tp_edge_scroll_set_state(struct tp_dispatch *tp,
 			 struct tp_touch *t,
 			 enum tp_edge_scroll_touch_state state)
 {
-	libinput_timer_cancel(&t->scroll.timer);
+	tp_touch_cold(t)->scroll.timeout = 0;
 
 	t->scroll.edge_state = state;
 
@@ -118,7 +162,7 @@ tp_edge_scroll_set_state(struct tp_dispatch *tp,
 		break;
 	case EDGE_SCROLL_TOUCH_STATE_EDGE_NEW:
 		t->scroll.edge = tp_touch_get_edge(tp, t);
-		t->scroll.initial = t->point;
+		tp_touch_cold(t)->scroll.initial = t->point;
 		tp_edge_scroll_set_timer(tp, t);
 		break;
 	case EDGE_SCROLL_TOUCH_STATE_EDGE:
@@ -269,20 +313,29 @@ tp_edge_scroll_handle_event(struct tp_dispatch *tp,
 static void
 tp_edge_scroll_handle_timeout(uint64_t now, void *data)
 {
-	struct tp_touch *t = data;
+	struct tp_dispatch *tp = data;
+	struct tp_touch *t;
 
-	tp_edge_scroll_handle_event(t->tp, t, SCROLL_EVENT_TIMEOUT);
+	tp_for_each_touch(tp, t) {
+		uint64_t timeout = tp_touch_cold(t)->scroll.timeout;
+
+		if (timeout == 0 || timeout > now)
+			continue;
+
+		tp_touch_cold(t)->scroll.timeout = 0;
+		tp_edge_scroll_handle_event(tp, t, SCROLL_EVENT_TIMEOUT);
+	}
+
+	tp_edge_scroll_update_timer(tp);
 }
 
 void
 tp_edge_scroll_init(struct tp_dispatch *tp, struct evdev_device *device)
 {
-	struct tp_touch *t;
 	double width, height;
 	bool want_horiz_scroll = true;
 	struct device_coords edges;
 	struct phys_coords mm = { 0.0, 0.0 };
-	int i;
 
 	evdev_device_get_size(device, &width, &height);
 	/* Touchpads smaller than 40mm are not tall enough to have a
@@ -304,33 +357,13 @@ tp_edge_scroll_init(struct tp_dispatch *tp, struct evdev_device *device)
 		tp->scroll.bottom_edge = edges.y;
 	else
 		tp->scroll.bottom_edge = INT_MAX;
-
-	i = 0;
-	tp_for_each_touch(tp, t) {
-		char timer_name[64];
-
-		snprintf(timer_name,
-			 sizeof(timer_name),
-			 "%s (%d) edgescroll",
-			 evdev_device_get_sysname(device),
-			 i);
-		t->scroll.direction = -1;
-		libinput_timer_init(&t->scroll.timer,
-				    tp_libinput_context(tp),
-				    timer_name,
-				    tp_edge_scroll_handle_timeout, t);
-	}
 }
 
 void
 tp_remove_edge_scroll(struct tp_dispatch *tp)
 {
-	struct tp_touch *t;
-
-	tp_for_each_touch(tp, t) {
-		libinput_timer_cancel(&t->scroll.timer);
-		libinput_timer_destroy(&t->scroll.timer);
-	}
+	libinput_timer_cancel(&tp->scroll.edge_timer);
+	libinput_timer_destroy(&tp->scroll.edge_timer);
 }
 
 void
@@ -350,7 +383,7 @@ tp_edge_scroll_handle_state(struct tp_dispatch *tp, uint64_t time)
 		return;
 	}
 
-	tp_for_each_touch(tp, t) {
+	tp_for_each_active_touch(tp, t) {
 		if (!t->dirty)
 			continue;
 
@@ -377,6 +410,8 @@ tp_edge_scroll_handle_state(struct tp_dispatch *tp, uint64_t time)
 			break;
 		}
 	}
+
+	tp_edge_scroll_update_timer(tp);
 }
 
 int
@@ -392,7 +427,7 @@ tp_edge_scroll_post_events(struct tp_dispatch *tp, uint64_t time)
 	const struct normalized_coords zero = { 0.0, 0.0 };
 	const struct discrete_coords zero_discrete = { 0.0, 0.0 };
 
-	tp_for_each_touch(tp, t) {
+	tp_for_each_active_touch(tp, t) {
 		if (!t->dirty)
 			continue;
 
@@ -445,7 +480,7 @@ tp_edge_scroll_post_events(struct tp_dispatch *tp, uint64_t time)
 			tmp = normalized;
 			normalized = tp_normalize_delta(tp,
 					device_delta(t->point,
-						     t->scroll.initial));
+						     tp_touch_cold(t)->scroll.initial));
 			if (fabs(*delta) < DEFAULT_SCROLL_THRESHOLD)
 				normalized = zero;
 			else
@@ -468,6 +503,8 @@ tp_edge_scroll_post_events(struct tp_dispatch *tp, uint64_t time)
 		tp_edge_scroll_handle_event(tp, t, SCROLL_EVENT_POSTED);
 	}
 
+	tp_edge_scroll_update_timer(tp);
+
 	return 0; /* Edge touches are suppressed by edge_scroll_touch_active */
 }
 
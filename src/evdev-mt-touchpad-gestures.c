@@ -49,11 +49,12 @@ static struct device_float_coords
 tp_get_touches_delta(struct tp_dispatch *tp, bool average)
 {
 	struct tp_touch *t;
-	unsigned int i, nactive = 0;
+	unsigned int nactive = 0;
 	struct device_float_coords delta = {0.0, 0.0};
 
-	for (i = 0; i < tp->num_slots; i++) {
-		t = &tp->touches[i];
+	tp_for_each_active_touch(tp, t) {
+		if (t->index >= tp->num_slots)
+			continue;
 
 		if (!tp_touch_active_for_gesture(tp, t))
 			continue;
@@ -160,6 +161,7 @@ tp_gesture_post_pointer_motion(struct tp_dispatch *tp, uint64_t time)
 				      time,
 				      &delta,
 				      &unaccel);
+		tp_low_latency_record_first_motion(tp, time);
 	}
 }
 
@@ -173,7 +175,7 @@ tp_gesture_get_active_touches(const struct tp_dispatch *tp,
 
 	memset(touches, 0, count * sizeof(struct tp_touch *));
 
-	tp_for_each_touch(tp, t) {
+	tp_for_each_active_touch(tp, t) {
 		if (tp_touch_active_for_gesture(tp, t)) {
 			touches[n++] = t;
 			if (n == count)
@@ -200,7 +202,7 @@ tp_gesture_get_direction(struct tp_dispatch *tp, struct tp_touch *touch)
 	struct phys_coords mm;
 	struct device_float_coords delta;
 
-	delta = device_delta(touch->point, touch->gesture.initial);
+	delta = device_delta(touch->point, tp_touch_cold(touch)->gesture.initial);
 	mm = tp_phys_delta(tp, delta);
 
 	return phys_get_direction(mm);
@@ -233,8 +235,8 @@ tp_gesture_set_scroll_buildup(struct tp_dispatch *tp)
 	struct tp_touch *first = tp->gesture.touches[0],
 			*second = tp->gesture.touches[1];
 
-	d0 = device_delta(first->point, first->gesture.initial);
-	d1 = device_delta(second->point, second->gesture.initial);
+	d0 = device_delta(first->point, tp_touch_cold(first)->gesture.initial);
+	d1 = device_delta(second->point, tp_touch_cold(second)->gesture.initial);
 
 	average = device_float_average(d0, d1);
 	tp->device->scroll.buildup = tp_normalize_delta(tp, average);
@@ -421,10 +423,11 @@ tp_gesture_handle_state_none(struct tp_dispatch *tp, uint64_t time)
 	}
 
 	tp->gesture.initial_time = time;
-	first->gesture.initial = first->point;
-	second->gesture.initial = second->point;
+	tp_touch_cold(first)->gesture.initial = first->point;
+	tp_touch_cold(second)->gesture.initial = second->point;
 	tp->gesture.touches[0] = first;
 	tp->gesture.touches[1] = second;
+	tp->gesture.unknown.valid = false;
 
 	return GESTURE_STATE_UNKNOWN;
 }
@@ -455,15 +458,45 @@ tp_gesture_init_pinch(struct tp_dispatch *tp)
 	tp->gesture.prev_scale = 1.0;
 }
 
-static struct phys_coords
-tp_gesture_mm_moved(struct tp_dispatch *tp, struct tp_touch *t)
+static double
+tp_gesture_mm2_moved(struct tp_dispatch *tp, struct tp_touch *t)
 {
 	struct device_coords delta;
+	struct device_coords initial = tp_touch_cold(t)->gesture.initial;
+	struct phys_coords mm;
+
+	delta.x = abs(t->point.x - initial.x);
+	delta.y = abs(t->point.y - initial.y);
 
-	delta.x = abs(t->point.x - t->gesture.initial.x);
-	delta.y = abs(t->point.y - t->gesture.initial.y);
+	mm = evdev_device_unit_delta_to_mm(tp->device, &delta);
 
-	return evdev_device_unit_delta_to_mm(tp->device, &delta);
+	return mm.x * mm.x + mm.y * mm.y;
+}
+
+/* Only the touches that changed in this frame need to be looked at
+ * again, the thresholds are compared against squared distances so
+ * there's no need for a sqrt either */
+static void
+tp_gesture_update_unknown(struct tp_dispatch *tp)
+{
+	struct tp_touch *first = tp->gesture.touches[0],
+			*second = tp->gesture.touches[1];
+	bool valid = tp->gesture.unknown.valid;
+	struct device_coords delta;
+
+	if (!valid || first->dirty)
+		tp->gesture.unknown.moved_mm2[0] = tp_gesture_mm2_moved(tp, first);
+	if (!valid || second->dirty)
+		tp->gesture.unknown.moved_mm2[1] = tp_gesture_mm2_moved(tp, second);
+
+	if (!valid || first->dirty || second->dirty) {
+		delta.x = abs(first->point.x - second->point.x);
+		delta.y = abs(first->point.y - second->point.y);
+		tp->gesture.unknown.distance_mm =
+			evdev_device_unit_delta_to_mm(tp->device, &delta);
+	}
+
+	tp->gesture.unknown.valid = true;
 }
 
 static enum tp_gesture_state
@@ -473,12 +506,13 @@ tp_gesture_handle_state_unknown(struct tp_dispatch *tp, uint64_t time)
 			*second = tp->gesture.touches[1],
 			*thumb;
 	uint32_t dir1, dir2;
-	struct device_coords delta;
-	struct phys_coords first_moved, second_moved, distance_mm;
-	double first_mm, second_mm; /* movement since gesture start in mm */
-	double thumb_mm, finger_mm;
+	struct phys_coords distance_mm;
+	/* movement since gesture start in mm² */
+	double first_mm2, second_mm2;
+	double thumb_mm2, finger_mm2;
 	double min_move = 1.5; /* min movement threshold in mm - count this touch */
 	double max_move = 4.0; /* max movement threshold in mm - ignore other touch */
+	double min_move2, max_move2;
 
 	/* If we have more fingers than slots, we don't know where the
 	 * fingers are. Default to swipe */
@@ -489,30 +523,27 @@ tp_gesture_handle_state_unknown(struct tp_dispatch *tp, uint64_t time)
 	/* Need more margin for error when there are more fingers */
 	max_move += 2.0 * (tp->gesture.finger_count - 2);
 	min_move += 0.5 * (tp->gesture.finger_count - 2);
+	max_move2 = max_move * max_move;
+	min_move2 = min_move * min_move;
 
-	first_moved = tp_gesture_mm_moved(tp, first);
-	first_mm = hypot(first_moved.x, first_moved.y);
-
-	second_moved = tp_gesture_mm_moved(tp, second);
-	second_mm = hypot(second_moved.x, second_moved.y);
-
-	delta.x = abs(first->point.x - second->point.x);
-	delta.y = abs(first->point.y - second->point.y);
-	distance_mm = evdev_device_unit_delta_to_mm(tp->device, &delta);
+	tp_gesture_update_unknown(tp);
+	first_mm2 = tp->gesture.unknown.moved_mm2[0];
+	second_mm2 = tp->gesture.unknown.moved_mm2[1];
+	distance_mm = tp->gesture.unknown.distance_mm;
 
 	/* If both touches moved less than a mm, we cannot decide yet */
-	if (first_mm < 1 && second_mm < 1)
+	if (first_mm2 < 1 && second_mm2 < 1)
 		return GESTURE_STATE_UNKNOWN;
 
 	/* Pick the thumb as the lowest point on the touchpad */
 	if (first->point.y > second->point.y) {
 		thumb = first;
-		thumb_mm = first_mm;
-		finger_mm = second_mm;
+		thumb_mm2 = first_mm2;
+		finger_mm2 = second_mm2;
 	} else {
 		thumb = second;
-		thumb_mm = second_mm;
-		finger_mm = first_mm;
+		thumb_mm2 = second_mm2;
+		finger_mm2 = first_mm2;
 	}
 
 	/* If both touches are within 7mm vertically and 40mm horizontally
@@ -533,13 +564,13 @@ tp_gesture_handle_state_unknown(struct tp_dispatch *tp, uint64_t time)
 	 * or the user is doing "one-finger-scroll," where one touch stays in
 	 * place while the other moves.
 	 */
-	if (first_mm >= max_move || second_mm >= max_move) {
+	if (first_mm2 >= max_move2 || second_mm2 >= max_move2) {
 		/* If thumb detection is enabled, and thumb is still while
 		 * finger moves, cancel gestures and mark lower as thumb.
 		 * This applies to all gestures (2, 3, 4+ fingers), but allows
 		 * more thumb motion on >2 finger gestures during detection.
 		 */
-		if (tp->thumb.detect_thumbs && thumb_mm < min_move) {
+		if (tp->thumb.detect_thumbs && thumb_mm2 < min_move2) {
 			tp_thumb_suppress(tp, thumb);
 			return GESTURE_STATE_NONE;
 		}
@@ -548,7 +579,7 @@ tp_gesture_handle_state_unknown(struct tp_dispatch *tp, uint64_t time)
 		 * while thumb moves, assume this is "one-finger scrolling."
 		 * This applies only to 2-finger gestures.
 		 */
-		if ((!tp->gesture.enabled || finger_mm < min_move) &&
+		if ((!tp->gesture.enabled || finger_mm2 < min_move2) &&
 		    tp->gesture.finger_count == 2) {
 			tp_gesture_set_scroll_buildup(tp);
 			return GESTURE_STATE_SCROLL;
@@ -557,7 +588,7 @@ tp_gesture_handle_state_unknown(struct tp_dispatch *tp, uint64_t time)
 		/* If more than 2 fingers are involved, and the thumb moves
 		 * while the fingers stay still, assume a pinch if eligible.
 		 */
-		if (finger_mm < min_move &&
+		if (finger_mm2 < min_move2 &&
 		    tp->gesture.finger_count > 2 &&
 		    tp->gesture.enabled &&
 		    tp->thumb.pinch_eligible) {
@@ -569,7 +600,7 @@ tp_gesture_handle_state_unknown(struct tp_dispatch *tp, uint64_t time)
 	/* If either touch is still below the min_move threshold, we can't
 	 * tell what kind of gesture this is.
 	 */
-	if ((first_mm < min_move) || (second_mm < min_move))
+	if ((first_mm2 < min_move2) || (second_mm2 < min_move2))
 		return GESTURE_STATE_UNKNOWN;
 
 	/* Both touches have exceeded the min_move threshold, so we have a
@@ -631,10 +662,9 @@ tp_gesture_handle_state_swipe(struct tp_dispatch *tp, uint64_t time)
 	struct normalized_coords delta, unaccel;
 
 	raw = tp_get_average_touches_delta(tp);
-	delta = tp_filter_motion(tp, &raw, time);
+	delta = tp_filter_motion_with_unaccel(tp, &raw, &unaccel, time);
 
 	if (!normalized_is_zero(delta) || !device_float_is_zero(raw)) {
-		unaccel = tp_normalize_delta(tp, raw);
 		tp_gesture_start(tp, time);
 		gesture_notify_swipe(&tp->device->base, time,
 				     LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
@@ -652,6 +682,12 @@ tp_gesture_handle_state_pinch(struct tp_dispatch *tp, uint64_t time)
 	struct device_float_coords center, fdelta;
 	struct normalized_coords delta, unaccel;
 
+	/* If neither touch moved, center, scale and angle are unchanged
+	 * and there is nothing to send. Skip the trig */
+	if (!tp->gesture.touches[0]->dirty &&
+	    !tp->gesture.touches[1]->dirty)
+		return GESTURE_STATE_PINCH;
+
 	tp_gesture_get_pinch_info(tp, &distance, &angle, &center);
 
 	scale = distance / tp->gesture.initial_distance;
@@ -666,13 +702,12 @@ tp_gesture_handle_state_pinch(struct tp_dispatch *tp, uint64_t time)
 	fdelta = device_float_delta(center, tp->gesture.center);
 	tp->gesture.center = center;
 
-	delta = tp_filter_motion(tp, &fdelta, time);
+	delta = tp_filter_motion_with_unaccel(tp, &fdelta, &unaccel, time);
 
 	if (normalized_is_zero(delta) && device_float_is_zero(fdelta) &&
 	    scale == tp->gesture.prev_scale && angle_delta == 0.0)
 		return GESTURE_STATE_PINCH;
 
-	unaccel = tp_normalize_delta(tp, fdelta);
 	tp_gesture_start(tp, time);
 	gesture_notify_pinch(&tp->device->base, time,
 			     LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
@@ -819,6 +854,11 @@ tp_gesture_finger_count_switch_timeout(uint64_t now, void *data)
 	if (!tp->gesture.finger_count_pending)
 		return;
 
+	libinput_device_record_delay(&tp->device->base,
+				     LIBINPUT_DELAY_SOURCE_GESTURE,
+				     tp->gesture.finger_count_pending_time,
+				     now);
+
 	tp_gesture_cancel(tp, now); /* End current gesture */
 	tp->gesture.finger_count = tp->gesture.finger_count_pending;
 	tp->gesture.finger_count_pending = 0;
@@ -830,7 +870,7 @@ tp_gesture_handle_state(struct tp_dispatch *tp, uint64_t time)
 	unsigned int active_touches = 0;
 	struct tp_touch *t;
 
-	tp_for_each_touch(tp, t) {
+	tp_for_each_active_touch(tp, t) {
 		if (tp_touch_active_for_gesture(tp, t))
 			active_touches++;
 	}
@@ -852,6 +892,7 @@ tp_gesture_handle_state(struct tp_dispatch *tp, uint64_t time)
 		/* Else debounce finger changes */
 		} else if (active_touches != tp->gesture.finger_count_pending) {
 			tp->gesture.finger_count_pending = active_touches;
+			tp->gesture.finger_count_pending_time = time;
 			libinput_timer_set(&tp->gesture.finger_count_switch_timer,
 				time + DEFAULT_GESTURE_SWITCH_TIMEOUT);
 		}
@@ -24,6 +24,7 @@
 #include "config.h"
 
 #include <assert.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 
@@ -31,6 +32,7 @@
 
 #define DEFAULT_TAP_TIMEOUT_PERIOD ms2us(180)
 #define DEFAULT_DRAG_TIMEOUT_PERIOD ms2us(300)
+#define DEFAULT_TAP_FRAME_SLACK ms2us(8) /* see libinput_set_frame_deadline() */
 #define DEFAULT_TAP_MOVE_THRESHOLD 1.3 /* mm */
 
 enum tap_event {
@@ -50,7 +52,8 @@ enum tap_event {
  * Look at the state diagram in doc/touchpad-tap-state-machine.svg
  * (generated with https://draw.io)
  *
- * Any changes in this file must be represented in the diagram.
+ * Any changes in this file must be represented in the diagram. The
+ * diagram's states and edges are the rows of tap_transitions.
  */
 
 static inline const char*
@@ -133,278 +136,317 @@ tp_tap_notify(struct tp_dispatch *tp,
 				    state);
 }
 
-static void
-tp_tap_set_timer(struct tp_dispatch *tp, uint64_t time)
+static inline bool
+tp_tap_button_is_down(const struct tp_dispatch *tp, int nfingers)
 {
-	libinput_timer_set(&tp->tap.timer, time + DEFAULT_TAP_TIMEOUT_PERIOD);
+	return !!(tp->tap.buttons_pressed & (1 << nfingers));
 }
 
 static void
-tp_tap_set_drag_timer(struct tp_dispatch *tp, uint64_t time)
+tp_tap_handle_timeout(uint64_t time, void *data);
+
+/* Initialized on first use, tapping is disabled by default on most
+ * touchpads */
+static struct libinput_timer *
+tp_tap_timer(struct tp_dispatch *tp)
 {
-	libinput_timer_set(&tp->tap.timer, time + DEFAULT_DRAG_TIMEOUT_PERIOD);
+	char timer_name[64];
+
+	if (libinput_timer_is_initialized(&tp->tap.timer))
+		return &tp->tap.timer;
+
+	snprintf(timer_name,
+		 sizeof(timer_name),
+		 "%s tap",
+		 evdev_device_get_sysname(tp->device));
+	libinput_timer_init(&tp->tap.timer,
+			    tp_libinput_context(tp),
+			    timer_name,
+			    tp_tap_handle_timeout, tp);
+	libinput_timer_set_frame_slack(&tp->tap.timer, DEFAULT_TAP_FRAME_SLACK);
+
+	return &tp->tap.timer;
 }
 
-static void
-tp_tap_clear_timer(struct tp_dispatch *tp)
+/* A tap can only become a drag while we wait in TAPPED for the next
+ * touch. Once the timeout, a button or the finger count has moved us out
+ * of it, the drag is no longer possible */
+static inline bool
+tp_tap_may_drag(const struct tp_dispatch *tp)
 {
-	libinput_timer_cancel(&tp->tap.timer);
+	return tp->tap.drag_enabled && tp->tap.state == TAP_STATE_TAPPED;
 }
 
 static void
-tp_tap_move_to_dead(struct tp_dispatch *tp, struct tp_touch *t)
+tp_tap_set_timer(struct tp_dispatch *tp, uint64_t time)
 {
-	tp->tap.state = TAP_STATE_DEAD;
-	t->tap.state = TAP_TOUCH_STATE_DEAD;
-	tp_tap_clear_timer(tp);
+	libinput_timer_set(tp_tap_timer(tp), time + DEFAULT_TAP_TIMEOUT_PERIOD);
 }
 
 static void
-tp_tap_idle_handle_event(struct tp_dispatch *tp,
-			 struct tp_touch *t,
-			 enum tap_event event, uint64_t time)
+tp_tap_set_drag_timer(struct tp_dispatch *tp, uint64_t time)
 {
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_TOUCH;
-		tp->tap.saved_press_time = time;
-		tp_tap_set_timer(tp, time);
-		break;
-	case TAP_EVENT_RELEASE:
-		break;
-	case TAP_EVENT_MOTION:
-		log_tap_bug(tp, t, event);
-		break;
-	case TAP_EVENT_TIMEOUT:
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		break;
-	case TAP_EVENT_THUMB:
-		log_tap_bug(tp, t, event);
-		break;
-	case TAP_EVENT_PALM:
-		tp->tap.state = TAP_STATE_IDLE;
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
+	libinput_timer_set(tp_tap_timer(tp), time + DEFAULT_DRAG_TIMEOUT_PERIOD);
 }
 
 static void
-tp_tap_touch_handle_event(struct tp_dispatch *tp,
-			  struct tp_touch *t,
-			  enum tap_event event, uint64_t time)
+tp_tap_clear_timer(struct tp_dispatch *tp)
 {
-
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_TOUCH_2;
-		tp->tap.saved_press_time = time;
-		tp_tap_set_timer(tp, time);
-		break;
-	case TAP_EVENT_RELEASE:
-		tp_tap_notify(tp,
-			      tp->tap.saved_press_time,
-			      1,
-			      LIBINPUT_BUTTON_STATE_PRESSED);
-		if (tp->tap.drag_enabled) {
-			tp->tap.state = TAP_STATE_TAPPED;
-			tp->tap.saved_release_time = time;
-			tp_tap_set_timer(tp, time);
-		} else {
-			tp_tap_notify(tp,
-				      time,
-				      1,
-				      LIBINPUT_BUTTON_STATE_RELEASED);
-			tp->tap.state = TAP_STATE_IDLE;
-		}
-		break;
-	case TAP_EVENT_MOTION:
-		tp_tap_move_to_dead(tp, t);
-		break;
-	case TAP_EVENT_TIMEOUT:
-		tp->tap.state = TAP_STATE_HOLD;
-		tp_tap_clear_timer(tp);
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		break;
-	case TAP_EVENT_THUMB:
-		tp->tap.state = TAP_STATE_IDLE;
-		t->tap.is_thumb = true;
-		tp->tap.nfingers_down--;
-		t->tap.state = TAP_TOUCH_STATE_DEAD;
-		tp_tap_clear_timer(tp);
-		break;
-	case TAP_EVENT_PALM:
-		tp->tap.state = TAP_STATE_IDLE;
-		tp_tap_clear_timer(tp);
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
+	libinput_timer_cancel(&tp->tap.timer);
 }
 
-static void
-tp_tap_hold_handle_event(struct tp_dispatch *tp,
-			 struct tp_touch *t,
-			 enum tap_event event, uint64_t time)
-{
+/* The actions of a transition in tap_transitions. They are applied in
+ * the order listed here, after the state changed to the transition's
+ * next state */
+enum tap_action {
+	TAP_ACTION_NONE			= 0,
+	TAP_ACTION_BUG			= bit(0), /* invalid event */
+	/* button 1 release with the saved release time, if it is still
+	 * down */
+	TAP_ACTION_RELEASE_1_SAVED	= bit(1),
+	/* button 1 press with the saved press time */
+	TAP_ACTION_PRESS_1		= bit(2),
+	/* two-finger tap with the saved press and release times */
+	TAP_ACTION_TAP_2		= bit(3),
+	/* three-finger tap if the touch is still a tap candidate */
+	TAP_ACTION_TAP_3		= bit(4),
+	/* button 1 release with the event time */
+	TAP_ACTION_RELEASE_1		= bit(5),
+	TAP_ACTION_SAVE_PRESS_TIME	= bit(6),
+	TAP_ACTION_SAVE_RELEASE_TIME	= bit(7),
+	TAP_ACTION_CLEAR_TIMER		= bit(8),
+	TAP_ACTION_SET_TIMER		= bit(9),
+	/* the touch can no longer tap */
+	TAP_ACTION_TOUCH_DEAD		= bit(10),
+	/* the touch is a thumb and ignored from now on */
+	TAP_ACTION_THUMB		= bit(11),
+	/* TAPPED if drag is enabled, otherwise release button 1 and IDLE */
+	TAP_ACTION_DRAG_OR_RELEASE	= bit(12),
+	/* with early commit, release button 1 now if the tap can no
+	 * longer become a drag. A tap that may still become a drag keeps
+	 * the button down, a release and new press for the drag would be
+	 * seen as a double-click */
+	TAP_ACTION_EARLY_RELEASE	= bit(13),
+	/* DRAGGING_WAIT if drag lock is enabled, otherwise release button
+	 * 1 and IDLE */
+	TAP_ACTION_DRAG_LOCK_OR_RELEASE	= bit(14),
+	/* IDLE once the last finger is up */
+	TAP_ACTION_IDLE_IF_NO_FINGERS	= bit(15),
+};
 
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_TOUCH_2;
-		tp->tap.saved_press_time = time;
-		tp_tap_set_timer(tp, time);
-		break;
-	case TAP_EVENT_RELEASE:
-		tp->tap.state = TAP_STATE_IDLE;
-		break;
-	case TAP_EVENT_MOTION:
-		tp_tap_move_to_dead(tp, t);
-		break;
-	case TAP_EVENT_TIMEOUT:
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		break;
-	case TAP_EVENT_THUMB:
-		tp->tap.state = TAP_STATE_IDLE;
-		t->tap.is_thumb = true;
-		tp->tap.nfingers_down--;
-		t->tap.state = TAP_TOUCH_STATE_DEAD;
-		break;
-	case TAP_EVENT_PALM:
-		tp->tap.state = TAP_STATE_IDLE;
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
+#define TAP_ACTION_MOVE_TO_DEAD \
+	(TAP_ACTION_TOUCH_DEAD | TAP_ACTION_CLEAR_TIMER)
+
+struct tap_transition {
+	uint8_t next;		/* enum tp_tap_state, 0 for unchanged */
+	uint16_t actions;	/* enum tap_action */
+};
+
+#define TAP_NSTATES (TAP_STATE_DEAD - TAP_STATE_IDLE + 1)
+#define TAP_NEVENTS (TAP_EVENT_PALM_UP - TAP_EVENT_TOUCH + 1)
+
+/* A missing entry is an event that is ignored in that state */
+#define T(state_, event_, next_, actions_) \
+	[TAP_STATE_##state_ - TAP_STATE_IDLE][TAP_EVENT_##event_ - TAP_EVENT_TOUCH] = \
+		{ next_, actions_ }
+#define S(state_) TAP_STATE_##state_
+#define A(action_) TAP_ACTION_##action_
+
+static const struct tap_transition tap_transitions[TAP_NSTATES][TAP_NEVENTS] = {
+	T(IDLE, TOUCH,		S(TOUCH),	A(SAVE_PRESS_TIME)|A(SET_TIMER)),
+	T(IDLE, MOTION,		0,		A(BUG)),
+	T(IDLE, BUTTON,		S(DEAD),	0),
+	T(IDLE, THUMB,		0,		A(BUG)),
+	T(IDLE, PALM,		S(IDLE),	0),
+
+	T(TOUCH, TOUCH,		S(TOUCH_2),	A(SAVE_PRESS_TIME)|A(SET_TIMER)),
+	T(TOUCH, RELEASE,	0,		A(PRESS_1)|A(DRAG_OR_RELEASE)|
+						A(EARLY_RELEASE)),
+	T(TOUCH, MOTION,	S(DEAD),	A(MOVE_TO_DEAD)),
+	T(TOUCH, TIMEOUT,	S(HOLD),	A(CLEAR_TIMER)),
+	T(TOUCH, BUTTON,	S(DEAD),	0),
+	T(TOUCH, THUMB,		S(IDLE),	A(THUMB)|A(CLEAR_TIMER)),
+	T(TOUCH, PALM,		S(IDLE),	A(CLEAR_TIMER)),
+
+	T(HOLD, TOUCH,		S(TOUCH_2),	A(SAVE_PRESS_TIME)|A(SET_TIMER)),
+	T(HOLD, RELEASE,	S(IDLE),	0),
+	T(HOLD, MOTION,		S(DEAD),	A(MOVE_TO_DEAD)),
+	T(HOLD, BUTTON,		S(DEAD),	0),
+	T(HOLD, THUMB,		S(IDLE),	A(THUMB)),
+	T(HOLD, PALM,		S(IDLE),	0),
+
+	T(TAPPED, MOTION,	0,		A(BUG)),
+	T(TAPPED, RELEASE,	0,		A(BUG)),
+	T(TAPPED, TOUCH,	S(DRAGGING_OR_DOUBLETAP),
+						A(SAVE_PRESS_TIME)|A(SET_TIMER)),
+	T(TAPPED, TIMEOUT,	S(IDLE),	A(RELEASE_1_SAVED)),
+	T(TAPPED, BUTTON,	S(DEAD),	A(RELEASE_1_SAVED)),
+	T(TAPPED, THUMB,	0,		A(BUG)),
+
+	T(TOUCH_2, TOUCH,	S(TOUCH_3),	A(SAVE_PRESS_TIME)|A(SET_TIMER)),
+	T(TOUCH_2, RELEASE,	S(TOUCH_2_RELEASE),
+						A(SAVE_RELEASE_TIME)|A(SET_TIMER)),
+	T(TOUCH_2, MOTION,	S(DEAD),	A(MOVE_TO_DEAD)),
+	T(TOUCH_2, TIMEOUT,	S(TOUCH_2_HOLD), 0),
+	T(TOUCH_2, BUTTON,	S(DEAD),	0),
+	T(TOUCH_2, PALM,	S(TOUCH),	A(SET_TIMER)),
+
+	T(TOUCH_2_HOLD, TOUCH,	S(TOUCH_3),	A(SAVE_PRESS_TIME)|A(SET_TIMER)),
+	T(TOUCH_2_HOLD, RELEASE, S(HOLD),	0),
+	T(TOUCH_2_HOLD, MOTION,	S(DEAD),	A(MOVE_TO_DEAD)),
+	T(TOUCH_2_HOLD, TIMEOUT, S(TOUCH_2_HOLD), 0),
+	T(TOUCH_2_HOLD, BUTTON,	S(DEAD),	0),
+	T(TOUCH_2_HOLD, PALM,	S(HOLD),	0),
+
+	T(TOUCH_2_RELEASE, TOUCH, S(TOUCH_2_HOLD),
+						A(TOUCH_DEAD)|A(CLEAR_TIMER)),
+	T(TOUCH_2_RELEASE, RELEASE, S(IDLE),	A(TAP_2)),
+	T(TOUCH_2_RELEASE, MOTION, S(DEAD),	A(MOVE_TO_DEAD)),
+	T(TOUCH_2_RELEASE, TIMEOUT, S(HOLD),	0),
+	T(TOUCH_2_RELEASE, BUTTON, S(DEAD),	0),
+	/* There's only one saved press time and it's overwritten by the
+	 * last touch down. So in the case of finger down, palm down,
+	 * finger up, palm detected, we use the palm touch's press time
+	 * here instead of the finger's press time. Let's wait and see if
+	 * that's an issue.
+	 */
+	T(TOUCH_2_RELEASE, PALM, 0,		A(PRESS_1)|A(DRAG_OR_RELEASE)|
+						A(EARLY_RELEASE)),
+
+	T(TOUCH_3, TOUCH,	S(DEAD),	A(CLEAR_TIMER)),
+	T(TOUCH_3, MOTION,	S(DEAD),	A(MOVE_TO_DEAD)),
+	T(TOUCH_3, TIMEOUT,	S(TOUCH_3_HOLD), A(CLEAR_TIMER)),
+	T(TOUCH_3, RELEASE,	S(TOUCH_2_HOLD), A(TAP_3)),
+	T(TOUCH_3, BUTTON,	S(DEAD),	0),
+	T(TOUCH_3, PALM,	S(TOUCH_2),	0),
+
+	T(TOUCH_3_HOLD, TOUCH,	S(DEAD),	A(SET_TIMER)),
+	T(TOUCH_3_HOLD, RELEASE, S(TOUCH_2_HOLD), 0),
+	T(TOUCH_3_HOLD, MOTION,	S(DEAD),	A(MOVE_TO_DEAD)),
+	T(TOUCH_3_HOLD, BUTTON,	S(DEAD),	0),
+	T(TOUCH_3_HOLD, PALM,	S(TOUCH_2_HOLD), 0),
+
+	T(DRAGGING_OR_DOUBLETAP, TOUCH, S(DRAGGING_2), 0),
+	T(DRAGGING_OR_DOUBLETAP, RELEASE, S(TAPPED),
+						A(RELEASE_1_SAVED)|A(PRESS_1)|
+						A(SAVE_RELEASE_TIME)|A(SET_TIMER)|
+						A(EARLY_RELEASE)),
+	T(DRAGGING_OR_DOUBLETAP, MOTION, S(DRAGGING), 0),
+	T(DRAGGING_OR_DOUBLETAP, TIMEOUT, S(DRAGGING), 0),
+	T(DRAGGING_OR_DOUBLETAP, BUTTON, S(DEAD), A(RELEASE_1_SAVED)),
+	T(DRAGGING_OR_DOUBLETAP, PALM, S(TAPPED), 0),
+
+	T(DRAGGING, TOUCH,	S(DRAGGING_2),	0),
+	T(DRAGGING, RELEASE,	0,		A(DRAG_LOCK_OR_RELEASE)),
+	T(DRAGGING, BUTTON,	S(DEAD),	A(RELEASE_1)),
+	T(DRAGGING, PALM,	S(IDLE),	A(RELEASE_1_SAVED)),
+
+	T(DRAGGING_WAIT, TOUCH,	S(DRAGGING_OR_TAP), A(SET_TIMER)),
+	T(DRAGGING_WAIT, TIMEOUT, S(IDLE),	A(RELEASE_1)),
+	T(DRAGGING_WAIT, BUTTON, S(DEAD),	A(RELEASE_1)),
+
+	T(DRAGGING_OR_TAP, TOUCH, S(DRAGGING_2), A(CLEAR_TIMER)),
+	T(DRAGGING_OR_TAP, RELEASE, S(IDLE),	A(RELEASE_1)),
+	T(DRAGGING_OR_TAP, MOTION, S(DRAGGING), 0),
+	T(DRAGGING_OR_TAP, TIMEOUT, S(DRAGGING), 0),
+	T(DRAGGING_OR_TAP, BUTTON, S(DEAD),	A(RELEASE_1)),
+	T(DRAGGING_OR_TAP, PALM, S(IDLE),	A(RELEASE_1_SAVED)),
+
+	T(DRAGGING_2, RELEASE,	S(DRAGGING),	0),
+	T(DRAGGING_2, TOUCH,	S(DEAD),	A(RELEASE_1)),
+	T(DRAGGING_2, BUTTON,	S(DEAD),	A(RELEASE_1)),
+	T(DRAGGING_2, PALM,	S(DRAGGING_OR_DOUBLETAP), 0),
+
+	T(DEAD, RELEASE,	0,		A(IDLE_IF_NO_FINGERS)),
+	T(DEAD, PALM,		0,		A(IDLE_IF_NO_FINGERS)),
+	T(DEAD, PALM_UP,	0,		A(IDLE_IF_NO_FINGERS)),
+};
+
+#undef T
+#undef S
+#undef A
 
 static void
-tp_tap_tapped_handle_event(struct tp_dispatch *tp,
-			   struct tp_touch *t,
-			   enum tap_event event, uint64_t time)
+tp_tap_trace(struct tp_dispatch *tp,
+	     struct tp_touch *t,
+	     enum tp_tap_state from,
+	     enum tap_event event,
+	     uint64_t time)
 {
-	switch (event) {
-	case TAP_EVENT_MOTION:
-	case TAP_EVENT_RELEASE:
-		log_tap_bug(tp, t, event);
-		break;
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_DRAGGING_OR_DOUBLETAP;
-		tp->tap.saved_press_time = time;
-		tp_tap_set_timer(tp, time);
-		break;
-	case TAP_EVENT_TIMEOUT:
-		tp->tap.state = TAP_STATE_IDLE;
-		tp_tap_notify(tp,
-			      tp->tap.saved_release_time,
-			      1,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		tp_tap_notify(tp,
-			      tp->tap.saved_release_time,
-			      1,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		break;
-	case TAP_EVENT_THUMB:
-		log_tap_bug(tp, t, event);
-		break;
-	case TAP_EVENT_PALM:
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
+	struct tp_tap_trace_entry *entry;
+
+	entry = &tp->tap.trace.entries[tp->tap.trace.index];
+	tp->tap.trace.index = (tp->tap.trace.index + 1) % TAP_TRACE_LENGTH;
+	if (tp->tap.trace.count < TAP_TRACE_LENGTH)
+		tp->tap.trace.count++;
+
+	entry->time = time;
+	entry->touch = t ? (int)t->index : -1;
+	entry->from = from;
+	entry->event = event;
+	entry->to = tp->tap.state;
 }
 
+/* Log the most recent tap transitions, oldest first */
 static void
-tp_tap_touch2_handle_event(struct tp_dispatch *tp,
-			   struct tp_touch *t,
-			   enum tap_event event, uint64_t time)
+tp_tap_dump_trace(struct tp_dispatch *tp)
 {
-
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_TOUCH_3;
-		tp->tap.saved_press_time = time;
-		tp_tap_set_timer(tp, time);
-		break;
-	case TAP_EVENT_RELEASE:
-		tp->tap.state = TAP_STATE_TOUCH_2_RELEASE;
-		tp->tap.saved_release_time = time;
-		tp_tap_set_timer(tp, time);
-		break;
-	case TAP_EVENT_MOTION:
-		tp_tap_move_to_dead(tp, t);
-		break;
-	case TAP_EVENT_TIMEOUT:
-		tp->tap.state = TAP_STATE_TOUCH_2_HOLD;
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		break;
-	case TAP_EVENT_THUMB:
-		break;
-	case TAP_EVENT_PALM:
-		tp->tap.state = TAP_STATE_TOUCH;
-		tp_tap_set_timer(tp, time); /* overwrite timer */
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
+	unsigned int i, idx;
+
+	for (i = 0; i < tp->tap.trace.count; i++) {
+		const struct tp_tap_trace_entry *entry;
+
+		idx = (tp->tap.trace.index + TAP_TRACE_LENGTH -
+		       tp->tap.trace.count + i) % TAP_TRACE_LENGTH;
+		entry = &tp->tap.trace.entries[idx];
+
+		evdev_log_error(tp->device,
+				"tap trace: %" PRIu64 "us touch %d %s → %s → %s\n",
+				entry->time,
+				entry->touch,
+				tap_state_to_str(entry->from),
+				tap_event_to_str(entry->event),
+				tap_state_to_str(entry->to));
 	}
 }
 
 static void
-tp_tap_touch2_hold_handle_event(struct tp_dispatch *tp,
-				struct tp_touch *t,
-				enum tap_event event, uint64_t time)
+tp_tap_handle_event(struct tp_dispatch *tp,
+		    struct tp_touch *t,
+		    enum tap_event event,
+		    uint64_t time)
 {
+	enum tp_tap_state current = tp->tap.state;
+	const struct tap_transition *transition;
+	uint32_t actions;
+	bool delayed_press = false;
 
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_TOUCH_3;
-		tp->tap.saved_press_time = time;
-		tp_tap_set_timer(tp, time);
-		break;
-	case TAP_EVENT_RELEASE:
-		tp->tap.state = TAP_STATE_HOLD;
-		break;
-	case TAP_EVENT_MOTION:
-		tp_tap_move_to_dead(tp, t);
-		break;
-	case TAP_EVENT_TIMEOUT:
-		tp->tap.state = TAP_STATE_TOUCH_2_HOLD;
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		break;
-	case TAP_EVENT_THUMB:
-		break;
-	case TAP_EVENT_PALM:
-		tp->tap.state = TAP_STATE_HOLD;
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
+	transition = &tap_transitions[current - TAP_STATE_IDLE]
+				     [event - TAP_EVENT_TOUCH];
+	actions = transition->actions;
+
+	if (actions & TAP_ACTION_BUG) {
+		log_tap_bug(tp, t, event);
+		tp_tap_dump_trace(tp);
 	}
-}
 
-static void
-tp_tap_touch2_release_handle_event(struct tp_dispatch *tp,
-				   struct tp_touch *t,
-				   enum tap_event event, uint64_t time)
-{
+	if (transition->next)
+		tp->tap.state = transition->next;
 
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_TOUCH_2_HOLD;
-		t->tap.state = TAP_TOUCH_STATE_DEAD;
-		tp_tap_clear_timer(tp);
-		break;
-	case TAP_EVENT_RELEASE:
+	if ((actions & TAP_ACTION_RELEASE_1_SAVED) &&
+	    tp_tap_button_is_down(tp, 1))
+		tp_tap_notify(tp,
+			      tp->tap.saved_release_time,
+			      1,
+			      LIBINPUT_BUTTON_STATE_RELEASED);
+	if (actions & TAP_ACTION_PRESS_1) {
+		tp_tap_notify(tp,
+			      tp->tap.saved_press_time,
+			      1,
+			      LIBINPUT_BUTTON_STATE_PRESSED);
+		delayed_press = true;
+	}
+	if (actions & TAP_ACTION_TAP_2) {
 		tp_tap_notify(tp,
 			      tp->tap.saved_press_time,
 			      2,
@@ -413,30 +455,46 @@ tp_tap_touch2_release_handle_event(struct tp_dispatch *tp,
 			      tp->tap.saved_release_time,
 			      2,
 			      LIBINPUT_BUTTON_STATE_RELEASED);
-		tp->tap.state = TAP_STATE_IDLE;
-		break;
-	case TAP_EVENT_MOTION:
-		tp_tap_move_to_dead(tp, t);
-		break;
-	case TAP_EVENT_TIMEOUT:
-		tp->tap.state = TAP_STATE_HOLD;
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		break;
-	case TAP_EVENT_THUMB:
-		break;
-	case TAP_EVENT_PALM:
-		/* There's only one saved press time and it's overwritten by
-		 * the last touch down. So in the case of finger down, palm
-		 * down, finger up, palm detected, we use the
-		 * palm touch's press time here instead of the finger's press
-		 * time. Let's wait and see if that's an issue.
-		 */
+		delayed_press = true;
+	}
+	if ((actions & TAP_ACTION_TAP_3) &&
+	    t->tap.state == TAP_TOUCH_STATE_TOUCH) {
 		tp_tap_notify(tp,
 			      tp->tap.saved_press_time,
-			      1,
+			      3,
 			      LIBINPUT_BUTTON_STATE_PRESSED);
+		tp_tap_notify(tp, time, 3, LIBINPUT_BUTTON_STATE_RELEASED);
+		delayed_press = true;
+	}
+	if (actions & TAP_ACTION_RELEASE_1)
+		tp_tap_notify(tp, time, 1, LIBINPUT_BUTTON_STATE_RELEASED);
+
+	/* The presses above carry the saved time, the difference is how
+	 * long the tap held them back */
+	if (delayed_press)
+		libinput_device_record_delay(&tp->device->base,
+					     LIBINPUT_DELAY_SOURCE_TAP,
+					     tp->tap.saved_press_time,
+					     time);
+
+	if (actions & TAP_ACTION_SAVE_PRESS_TIME)
+		tp->tap.saved_press_time = time;
+	if (actions & TAP_ACTION_SAVE_RELEASE_TIME)
+		tp->tap.saved_release_time = time;
+	if (actions & TAP_ACTION_CLEAR_TIMER)
+		tp_tap_clear_timer(tp);
+	if (actions & TAP_ACTION_SET_TIMER)
+		tp_tap_set_timer(tp, time);
+
+	if (actions & TAP_ACTION_TOUCH_DEAD)
+		t->tap.state = TAP_TOUCH_STATE_DEAD;
+	if (actions & TAP_ACTION_THUMB) {
+		t->tap.is_thumb = true;
+		tp->tap.nfingers_down--;
+		t->tap.state = TAP_TOUCH_STATE_DEAD;
+	}
+
+	if (actions & TAP_ACTION_DRAG_OR_RELEASE) {
 		if (tp->tap.drag_enabled) {
 			tp->tap.state = TAP_STATE_TAPPED;
 			tp->tap.saved_release_time = time;
@@ -448,139 +506,13 @@ tp_tap_touch2_release_handle_event(struct tp_dispatch *tp,
 				      LIBINPUT_BUTTON_STATE_RELEASED);
 			tp->tap.state = TAP_STATE_IDLE;
 		}
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
 	}
-}
-
-static void
-tp_tap_touch3_handle_event(struct tp_dispatch *tp,
-			   struct tp_touch *t,
-			   enum tap_event event, uint64_t time)
-{
-
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_DEAD;
-		tp_tap_clear_timer(tp);
-		break;
-	case TAP_EVENT_MOTION:
-		tp_tap_move_to_dead(tp, t);
-		break;
-	case TAP_EVENT_TIMEOUT:
-		tp->tap.state = TAP_STATE_TOUCH_3_HOLD;
-		tp_tap_clear_timer(tp);
-		break;
-	case TAP_EVENT_RELEASE:
-		tp->tap.state = TAP_STATE_TOUCH_2_HOLD;
-		if (t->tap.state == TAP_TOUCH_STATE_TOUCH) {
-			tp_tap_notify(tp,
-				      tp->tap.saved_press_time,
-				      3,
-				      LIBINPUT_BUTTON_STATE_PRESSED);
-			tp_tap_notify(tp, time, 3, LIBINPUT_BUTTON_STATE_RELEASED);
-		}
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		break;
-	case TAP_EVENT_THUMB:
-		break;
-	case TAP_EVENT_PALM:
-		tp->tap.state = TAP_STATE_TOUCH_2;
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
-
-static void
-tp_tap_touch3_hold_handle_event(struct tp_dispatch *tp,
-				struct tp_touch *t,
-				enum tap_event event, uint64_t time)
-{
-
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_DEAD;
-		tp_tap_set_timer(tp, time);
-		break;
-	case TAP_EVENT_RELEASE:
-		tp->tap.state = TAP_STATE_TOUCH_2_HOLD;
-		break;
-	case TAP_EVENT_MOTION:
-		tp_tap_move_to_dead(tp, t);
-		break;
-	case TAP_EVENT_TIMEOUT:
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		break;
-	case TAP_EVENT_THUMB:
-		break;
-	case TAP_EVENT_PALM:
-		tp->tap.state = TAP_STATE_TOUCH_2_HOLD;
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
-
-static void
-tp_tap_dragging_or_doubletap_handle_event(struct tp_dispatch *tp,
-					  struct tp_touch *t,
-					  enum tap_event event, uint64_t time)
-{
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_DRAGGING_2;
-		break;
-	case TAP_EVENT_RELEASE:
-		tp->tap.state = TAP_STATE_TAPPED;
-		tp_tap_notify(tp,
-			      tp->tap.saved_release_time,
-			      1,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		tp_tap_notify(tp,
-			      tp->tap.saved_press_time,
-			      1,
-			      LIBINPUT_BUTTON_STATE_PRESSED);
-		tp->tap.saved_release_time = time;
-		tp_tap_set_timer(tp, time);
-		break;
-	case TAP_EVENT_MOTION:
-	case TAP_EVENT_TIMEOUT:
-		tp->tap.state = TAP_STATE_DRAGGING;
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		tp_tap_notify(tp,
-			      tp->tap.saved_release_time,
-			      1,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		break;
-	case TAP_EVENT_THUMB:
-		break;
-	case TAP_EVENT_PALM:
-		tp->tap.state = TAP_STATE_TAPPED;
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
-
-static void
-tp_tap_dragging_handle_event(struct tp_dispatch *tp,
-			     struct tp_touch *t,
-			     enum tap_event event, uint64_t time)
-{
-
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_DRAGGING_2;
-		break;
-	case TAP_EVENT_RELEASE:
+	if ((actions & TAP_ACTION_EARLY_RELEASE) &&
+	    tp->tap.early_commit_enabled &&
+	    !tp_tap_may_drag(tp) &&
+	    tp_tap_button_is_down(tp, 1))
+		tp_tap_notify(tp, time, 1, LIBINPUT_BUTTON_STATE_RELEASED);
+	if (actions & TAP_ACTION_DRAG_LOCK_OR_RELEASE) {
 		if (tp->tap.drag_lock_enabled) {
 			tp->tap.state = TAP_STATE_DRAGGING_WAIT;
 			tp_tap_set_drag_timer(tp, time);
@@ -591,216 +523,16 @@ tp_tap_dragging_handle_event(struct tp_dispatch *tp,
 				      LIBINPUT_BUTTON_STATE_RELEASED);
 			tp->tap.state = TAP_STATE_IDLE;
 		}
-		break;
-	case TAP_EVENT_MOTION:
-	case TAP_EVENT_TIMEOUT:
-		/* noop */
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		tp_tap_notify(tp, time, 1, LIBINPUT_BUTTON_STATE_RELEASED);
-		break;
-	case TAP_EVENT_THUMB:
-		break;
-	case TAP_EVENT_PALM:
-		tp_tap_notify(tp,
-			      tp->tap.saved_release_time,
-			      1,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		tp->tap.state = TAP_STATE_IDLE;
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
 	}
-}
-
-static void
-tp_tap_dragging_wait_handle_event(struct tp_dispatch *tp,
-				  struct tp_touch *t,
-				  enum tap_event event, uint64_t time)
-{
-
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_DRAGGING_OR_TAP;
-		tp_tap_set_timer(tp, time);
-		break;
-	case TAP_EVENT_RELEASE:
-	case TAP_EVENT_MOTION:
-		break;
-	case TAP_EVENT_TIMEOUT:
+	if ((actions & TAP_ACTION_IDLE_IF_NO_FINGERS) &&
+	    tp->tap.nfingers_down == 0)
 		tp->tap.state = TAP_STATE_IDLE;
-		tp_tap_notify(tp, time, 1, LIBINPUT_BUTTON_STATE_RELEASED);
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		tp_tap_notify(tp, time, 1, LIBINPUT_BUTTON_STATE_RELEASED);
-		break;
-	case TAP_EVENT_THUMB:
-	case TAP_EVENT_PALM:
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
-
-static void
-tp_tap_dragging_tap_handle_event(struct tp_dispatch *tp,
-				  struct tp_touch *t,
-				  enum tap_event event, uint64_t time)
-{
-
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_DRAGGING_2;
-		tp_tap_clear_timer(tp);
-		break;
-	case TAP_EVENT_RELEASE:
-		tp->tap.state = TAP_STATE_IDLE;
-		tp_tap_notify(tp, time, 1, LIBINPUT_BUTTON_STATE_RELEASED);
-		break;
-	case TAP_EVENT_MOTION:
-	case TAP_EVENT_TIMEOUT:
-		tp->tap.state = TAP_STATE_DRAGGING;
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		tp_tap_notify(tp, time, 1, LIBINPUT_BUTTON_STATE_RELEASED);
-		break;
-	case TAP_EVENT_THUMB:
-		break;
-	case TAP_EVENT_PALM:
-		tp_tap_notify(tp,
-			      tp->tap.saved_release_time,
-			      1,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		tp->tap.state = TAP_STATE_IDLE;
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
-
-static void
-tp_tap_dragging2_handle_event(struct tp_dispatch *tp,
-			      struct tp_touch *t,
-			      enum tap_event event, uint64_t time)
-{
-
-	switch (event) {
-	case TAP_EVENT_RELEASE:
-		tp->tap.state = TAP_STATE_DRAGGING;
-		break;
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_DEAD;
-		tp_tap_notify(tp, time, 1, LIBINPUT_BUTTON_STATE_RELEASED);
-		break;
-	case TAP_EVENT_MOTION:
-	case TAP_EVENT_TIMEOUT:
-		/* noop */
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		tp_tap_notify(tp, time, 1, LIBINPUT_BUTTON_STATE_RELEASED);
-		break;
-	case TAP_EVENT_THUMB:
-		break;
-	case TAP_EVENT_PALM:
-		tp->tap.state = TAP_STATE_DRAGGING_OR_DOUBLETAP;
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
-
-static void
-tp_tap_dead_handle_event(struct tp_dispatch *tp,
-			 struct tp_touch *t,
-			 enum tap_event event,
-			 uint64_t time)
-{
-
-	switch (event) {
-	case TAP_EVENT_RELEASE:
-		if (tp->tap.nfingers_down == 0)
-			tp->tap.state = TAP_STATE_IDLE;
-		break;
-	case TAP_EVENT_TOUCH:
-	case TAP_EVENT_MOTION:
-	case TAP_EVENT_TIMEOUT:
-	case TAP_EVENT_BUTTON:
-		break;
-	case TAP_EVENT_THUMB:
-		break;
-	case TAP_EVENT_PALM:
-	case TAP_EVENT_PALM_UP:
-		if (tp->tap.nfingers_down == 0)
-			tp->tap.state = TAP_STATE_IDLE;
-		break;
-	}
-}
-
-static void
-tp_tap_handle_event(struct tp_dispatch *tp,
-		    struct tp_touch *t,
-		    enum tap_event event,
-		    uint64_t time)
-{
-	enum tp_tap_state current;
-
-	current = tp->tap.state;
-
-	switch(tp->tap.state) {
-	case TAP_STATE_IDLE:
-		tp_tap_idle_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_TOUCH:
-		tp_tap_touch_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_HOLD:
-		tp_tap_hold_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_TAPPED:
-		tp_tap_tapped_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_TOUCH_2:
-		tp_tap_touch2_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_TOUCH_2_HOLD:
-		tp_tap_touch2_hold_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_TOUCH_2_RELEASE:
-		tp_tap_touch2_release_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_TOUCH_3:
-		tp_tap_touch3_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_TOUCH_3_HOLD:
-		tp_tap_touch3_hold_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_DRAGGING_OR_DOUBLETAP:
-		tp_tap_dragging_or_doubletap_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_DRAGGING:
-		tp_tap_dragging_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_DRAGGING_WAIT:
-		tp_tap_dragging_wait_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_DRAGGING_OR_TAP:
-		tp_tap_dragging_tap_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_DRAGGING_2:
-		tp_tap_dragging2_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_DEAD:
-		tp_tap_dead_handle_event(tp, t, event, time);
-		break;
-	}
 
 	if (tp->tap.state == TAP_STATE_IDLE || tp->tap.state == TAP_STATE_DEAD)
 		tp_tap_clear_timer(tp);
 
+	tp_tap_trace(tp, t, current, event, time);
+
 	if (current != tp->tap.state)
 		evdev_log_debug(tp->device,
 			  "tap: touch %d state %s → %s → %s\n",
@@ -815,7 +547,7 @@ tp_tap_exceeds_motion_threshold(struct tp_dispatch *tp,
 				struct tp_touch *t)
 {
 	struct phys_coords mm =
-		tp_phys_delta(tp, device_delta(t->point, t->tap.initial));
+		tp_phys_delta(tp, device_delta(t->point, tp_touch_cold(t)->tap.initial));
 
 	/* if we have more fingers down than slots, we know that synaptics
 	 * touchpads are likely to give us pointer jumps.
@@ -862,7 +594,7 @@ tp_tap_handle_state(struct tp_dispatch *tp, uint64_t time)
 	if (tp->buttons.is_clickpad && tp->queued & TOUCHPAD_EVENT_BUTTON_PRESS)
 		tp_tap_handle_event(tp, NULL, TAP_EVENT_BUTTON, time);
 
-	tp_for_each_touch(tp, t) {
+	tp_for_each_active_touch(tp, t) {
 		if (!t->dirty || t->state == TOUCH_NONE)
 			continue;
 
@@ -910,7 +642,7 @@ tp_tap_handle_state(struct tp_dispatch *tp, uint64_t time)
 			}
 
 			t->tap.state = TAP_TOUCH_STATE_TOUCH;
-			t->tap.initial = t->point;
+			tp_touch_cold(t)->tap.initial = t->point;
 			tp->tap.nfingers_down++;
 			tp_tap_handle_event(tp, t, TAP_EVENT_TOUCH, time);
 
@@ -1053,9 +785,9 @@ tp_tap_config_set_enabled(struct libinput_device *device,
 	struct evdev_dispatch *dispatch = evdev_device(device)->dispatch;
 	struct tp_dispatch *tp = tp_dispatch(dispatch);
 
-	tp_tap_enabled_update(tp, tp->tap.suspended,
-			      (enabled == LIBINPUT_CONFIG_TAP_ENABLED),
-			      libinput_now(device->seat->libinput));
+	tp->tap.want_enabled = (enabled == LIBINPUT_CONFIG_TAP_ENABLED);
+	if (!evdev_config_deferred(tp->device))
+		tp_tap_config_commit(tp, libinput_now(device->seat->libinput));
 
 	return LIBINPUT_CONFIG_STATUS_SUCCESS;
 }
@@ -1066,8 +798,8 @@ tp_tap_config_is_enabled(struct libinput_device *device)
 	struct evdev_dispatch *dispatch = evdev_device(device)->dispatch;
 	struct tp_dispatch *tp = tp_dispatch(dispatch);
 
-	return tp->tap.enabled ? LIBINPUT_CONFIG_TAP_ENABLED :
-				 LIBINPUT_CONFIG_TAP_DISABLED;
+	return tp->tap.want_enabled ? LIBINPUT_CONFIG_TAP_ENABLED :
+				      LIBINPUT_CONFIG_TAP_DISABLED;
 }
 
 static enum libinput_config_tap_state
@@ -1199,11 +931,44 @@ tp_tap_config_get_default_draglock_enabled(struct libinput_device *device)
 	return tp_drag_lock_default(evdev);
 }
 
+static enum libinput_config_status
+tp_tap_config_set_early_commit_enabled(struct libinput_device *device,
+				       enum libinput_config_tap_early_commit_state enabled)
+{
+	struct evdev_dispatch *dispatch = evdev_device(device)->dispatch;
+	struct tp_dispatch *tp = tp_dispatch(dispatch);
+
+	tp->tap.early_commit_enabled = enabled;
+
+	return LIBINPUT_CONFIG_STATUS_SUCCESS;
+}
+
+static enum libinput_config_tap_early_commit_state
+tp_tap_config_get_early_commit_enabled(struct libinput_device *device)
+{
+	struct evdev_dispatch *dispatch = evdev_device(device)->dispatch;
+	struct tp_dispatch *tp = tp_dispatch(dispatch);
+
+	return tp->tap.early_commit_enabled;
+}
+
+static inline enum libinput_config_tap_early_commit_state
+tp_tap_early_commit_default(struct evdev_device *device)
+{
+	return LIBINPUT_CONFIG_TAP_EARLY_COMMIT_DISABLED;
+}
+
+static enum libinput_config_tap_early_commit_state
+tp_tap_config_get_default_early_commit_enabled(struct libinput_device *device)
+{
+	struct evdev_device *evdev = evdev_device(device);
+
+	return tp_tap_early_commit_default(evdev);
+}
+
 void
 tp_init_tap(struct tp_dispatch *tp)
 {
-	char timer_name[64];
-
 	tp->tap.config.count = tp_tap_config_count;
 	tp->tap.config.set_enabled = tp_tap_config_set_enabled;
 	tp->tap.config.get_enabled = tp_tap_config_is_enabled;
@@ -1217,23 +982,19 @@ tp_init_tap(struct tp_dispatch *tp)
 	tp->tap.config.set_draglock_enabled = tp_tap_config_set_draglock_enabled;
 	tp->tap.config.get_draglock_enabled = tp_tap_config_get_draglock_enabled;
 	tp->tap.config.get_default_draglock_enabled = tp_tap_config_get_default_draglock_enabled;
+	tp->tap.config.set_early_commit_enabled = tp_tap_config_set_early_commit_enabled;
+	tp->tap.config.get_early_commit_enabled = tp_tap_config_get_early_commit_enabled;
+	tp->tap.config.get_default_early_commit_enabled = tp_tap_config_get_default_early_commit_enabled;
 	tp->device->base.config.tap = &tp->tap.config;
 
 	tp->tap.state = TAP_STATE_IDLE;
 	tp->tap.enabled = tp_tap_default(tp->device);
+	tp->tap.want_enabled = tp->tap.enabled;
 	tp->tap.map = LIBINPUT_CONFIG_TAP_MAP_LRM;
 	tp->tap.want_map = tp->tap.map;
 	tp->tap.drag_enabled = tp_drag_default(tp->device);
 	tp->tap.drag_lock_enabled = tp_drag_lock_default(tp->device);
-
-	snprintf(timer_name,
-		 sizeof(timer_name),
-		 "%s tap",
-		 evdev_device_get_sysname(tp->device));
-	libinput_timer_init(&tp->tap.timer,
-			    tp_libinput_context(tp),
-			    timer_name,
-			    tp_tap_handle_timeout, tp);
+	tp->tap.early_commit_enabled = tp_tap_early_commit_default(tp->device);
 }
 
 void
@@ -1254,7 +1015,7 @@ tp_release_all_taps(struct tp_dispatch *tp, uint64_t now)
 	}
 
 	/* To neutralize all current touches, we make them all palms */
-	tp_for_each_touch(tp, t) {
+	tp_for_each_active_touch(tp, t) {
 		if (t->state == TOUCH_NONE)
 			continue;
 
@@ -1281,6 +1042,12 @@ tp_tap_resume(struct tp_dispatch *tp, uint64_t time)
 	tp_tap_enabled_update(tp, false, tp->tap.enabled, time);
 }
 
+void
+tp_tap_config_commit(struct tp_dispatch *tp, uint64_t time)
+{
+	tp_tap_enabled_update(tp, tp->tap.suspended, tp->tap.want_enabled, time);
+}
+
 bool
 tp_tap_dragging(const struct tp_dispatch *tp)
 {
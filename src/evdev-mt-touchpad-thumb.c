@@ -55,6 +55,12 @@ tp_thumb_set_state(struct tp_dispatch *tp,
 	if (tp->thumb.state == state && tp->thumb.index == index)
 		return;
 
+	if ((state == THUMB_STATE_SUPPRESSED || state == THUMB_STATE_DEAD) &&
+	    tp->thumb.state != THUMB_STATE_SUPPRESSED &&
+	    tp->thumb.state != THUMB_STATE_DEAD)
+		libinput_device_stat_inc(&tp->device->base,
+					 LIBINPUT_DEVICE_STAT_DISCARDED_THUMB);
+
 	evdev_log_debug(tp->device,
 			"thumb: touch %d, %s → %s\n",
 			(int)index,
@@ -103,7 +109,7 @@ tp_thumb_detect_pressure_size(const struct tp_dispatch *tp,
 
 	if (tp->thumb.use_size &&
 	    (t->major > tp->thumb.size_threshold) &&
-	    (t->minor < (tp->thumb.size_threshold * 0.6))) {
+	    (t->minor < tp->thumb.size_minor_threshold)) {
 		is_thumb = true;
 	}
 
@@ -279,7 +285,7 @@ tp_thumb_update_multifinger(struct tp_dispatch *tp)
 	/* Get the first and second bottom-most touches, the max speed exceeded
 	 * count overall, and the newest touch (or one of them, if more).
 	 */
-	tp_for_each_touch(tp, t) {
+	tp_for_each_active_touch(tp, t) {
 		if (t->state == TOUCH_NONE ||
 		    t->state == TOUCH_HOVERING)
 			continue;
@@ -403,6 +409,7 @@ tp_init_thumb(struct tp_dispatch *tp)
 				      &threshold)) {
 			tp->thumb.use_size = true;
 			tp->thumb.size_threshold = threshold;
+			tp->thumb.size_minor_threshold = (threshold * 6 + 9) / 10;
 		}
 	}
 
@@ -39,6 +39,9 @@
 #define DEFAULT_TRACKPOINT_EVENT_TIMEOUT ms2us(40)
 #define DEFAULT_KEYBOARD_ACTIVITY_TIMEOUT_1 ms2us(200)
 #define DEFAULT_KEYBOARD_ACTIVITY_TIMEOUT_2 ms2us(500)
+/* The trackpoint and dwt timeouts are not precise, let them fire a bit
+ * late to share wakeups with other timers */
+#define DEFAULT_ACTIVITY_TIMEOUT_SLACK ms2us(10)
 #define FAKE_FINGER_OVERFLOW (1 << 7)
 #define THUMB_IGNORE_SPEED_THRESHOLD 20 /* mm/s */
 
@@ -50,9 +53,9 @@ enum notify {
 static inline struct tp_history_point*
 tp_motion_history_offset(struct tp_touch *t, int offset)
 {
-	int offset_index =
-		(t->history.index - offset + TOUCHPAD_HISTORY_LENGTH) %
-		TOUCHPAD_HISTORY_LENGTH;
+	/* history_length is a power of two */
+	unsigned int offset_index =
+		(t->history.index - offset) & (t->tp->history_length - 1);
 
 	return &t->history.samples[offset_index];
 }
@@ -71,8 +74,7 @@ tp_filter_motion(struct tp_dispatch *tp,
 	/* Convert to device units with x/y in the same resolution */
 	raw = tp_scale_to_xaxis(tp, *unaccelerated);
 
-	return filter_dispatch(tp->device->pointer.filter,
-			       &raw, tp, time);
+	return evdev_filter_dispatch(tp->device, &raw, tp, time);
 }
 
 struct normalized_coords
@@ -89,8 +91,32 @@ tp_filter_motion_unaccelerated(struct tp_dispatch *tp,
 	/* Convert to device units with x/y in the same resolution */
 	raw = tp_scale_to_xaxis(tp, *unaccelerated);
 
-	return filter_dispatch_constant(tp->device->pointer.filter,
-					&raw, tp, time);
+	return evdev_filter_dispatch_constant(tp->device, &raw, tp, time);
+}
+
+/* For gestures, which need both the accelerated delta and the
+ * unaccelerated normalized delta: the delta is checked and scaled only
+ * once and the filter is called once */
+struct normalized_coords
+tp_filter_motion_with_unaccel(struct tp_dispatch *tp,
+			      const struct device_float_coords *unaccelerated,
+			      struct normalized_coords *unaccel_out,
+			      uint64_t time)
+{
+	struct device_float_coords raw;
+	const struct normalized_coords zero = { 0.0, 0.0 };
+
+	if (device_float_is_zero(*unaccelerated)) {
+		*unaccel_out = zero;
+		return zero;
+	}
+
+	*unaccel_out = tp_normalize_delta(tp, *unaccelerated);
+
+	/* Convert to device units with x/y in the same resolution */
+	raw = tp_scale_to_xaxis(tp, *unaccelerated);
+
+	return evdev_filter_dispatch(tp->device, &raw, tp, time);
 }
 
 static inline void
@@ -101,6 +127,7 @@ tp_calculate_motion_speed(struct tp_dispatch *tp, struct tp_touch *t)
 	struct phys_coords mm;
 	double distance;
 	double speed;
+	unsigned int offset;
 
 	/* Don't do this on single-touch or semi-mt devices */
 	if (!tp->has_mt || tp->semi_mt)
@@ -121,9 +148,15 @@ tp_calculate_motion_speed(struct tp_dispatch *tp, struct tp_touch *t)
 	if (t->history.count < 4)
 		return;
 
-	/* TODO: we probably need a speed history here so we can average
-	 * across a few events */
-	last = tp_motion_history_offset(t, 1);
+	/* Devices with a longer history are high-rate devices. Go back
+	 * proportionally further so the speed is calculated over roughly
+	 * the same time as with the default history, that averages out
+	 * the noise of the tiny per-event deltas */
+	offset = tp->history_length / TOUCHPAD_HISTORY_LENGTH;
+	if (t->history.count <= offset)
+		return;
+
+	last = tp_motion_history_offset(t, offset);
 	delta.x = abs(t->point.x - last->point.x);
 	delta.y = abs(t->point.y - last->point.y);
 	mm = evdev_device_unit_delta_to_mm(tp->device, &delta);
@@ -138,9 +171,10 @@ tp_calculate_motion_speed(struct tp_dispatch *tp, struct tp_touch *t)
 static inline void
 tp_motion_history_push(struct tp_touch *t)
 {
-	int motion_index = (t->history.index + 1) % TOUCHPAD_HISTORY_LENGTH;
+	unsigned int length = t->tp->history_length;
+	unsigned int motion_index = (t->history.index + 1) & (length - 1);
 
-	if (t->history.count < TOUCHPAD_HISTORY_LENGTH)
+	if (t->history.count < length)
 		t->history.count++;
 
 	t->history.samples[motion_index].point = t->point;
@@ -148,6 +182,18 @@ tp_motion_history_push(struct tp_touch *t)
 	t->history.index = motion_index;
 }
 
+/* In low-latency mode the device is assumed to be jitter-free until
+ * tp_detect_wobbling() proves otherwise, a fuzz alone doesn't enable
+ * the hysteresis */
+static inline bool
+tp_hysteresis_active(const struct tp_dispatch *tp)
+{
+	if (tp->low_latency.enabled)
+		return tp->hysteresis.jitter_detected;
+
+	return tp->hysteresis.enabled;
+}
+
 /* Idea: if we got a tuple of *very* quick moves like {Left, Right,
  * Left}, or {Right, Left, Right}, it means touchpad jitters since no
  * human can move like that within thresholds.
@@ -172,7 +218,7 @@ tp_detect_wobbling(struct tp_dispatch *tp,
 	    tp->nfingers_down != tp->old_nfingers_down)
 		return;
 
-	if (tp->hysteresis.enabled || t->history.count == 0)
+	if (tp_hysteresis_active(tp) || t->history.count == 0)
 		return;
 
 	if (!(tp->queued & TOUCHPAD_EVENT_MOTION)) {
@@ -199,6 +245,7 @@ tp_detect_wobbling(struct tp_dispatch *tp,
 		t->hysteresis.x_motion_history |= (1 << 2);
 		if (t->hysteresis.x_motion_history == r_l_r) {
 			tp->hysteresis.enabled = true;
+			tp->hysteresis.jitter_detected = true;
 			evdev_log_debug(tp->device,
 					"hysteresis enabled. "
 					"See %stouchpad-jitter.html for details\n",
@@ -211,7 +258,7 @@ static inline void
 tp_motion_hysteresis(struct tp_dispatch *tp,
 		     struct tp_touch *t)
 {
-	if (!tp->hysteresis.enabled)
+	if (!tp_hysteresis_active(tp))
 		return;
 
 	if (t->history.count > 0)
@@ -228,17 +275,33 @@ tp_motion_history_reset(struct tp_touch *t)
 	t->history.count = 0;
 }
 
+static void
+tp_alloc_touches(struct tp_dispatch *tp, unsigned int index);
+
 static inline struct tp_touch *
 tp_current_touch(struct tp_dispatch *tp)
 {
-	return &tp->touches[min(tp->slot, tp->ntouches - 1)];
+	unsigned int index = min(tp->slot, tp->ntouches - 1);
+
+	if (index >= tp->ntouches_allocated)
+		tp_alloc_touches(tp, index);
+
+	return tp->touches[index];
 }
 
 static inline struct tp_touch *
 tp_get_touch(struct tp_dispatch *tp, unsigned int slot)
 {
-	assert(slot < tp->ntouches);
-	return &tp->touches[slot];
+	assert(slot < tp->ntouches_allocated);
+	return tp->touches[slot];
+}
+
+/* The number of slots we have a touch for, the others are in
+ * TOUCH_NONE */
+static inline unsigned int
+tp_allocated_slots(struct tp_dispatch *tp)
+{
+	return min(tp->num_slots, tp->ntouches_allocated);
 }
 
 static inline unsigned int
@@ -331,7 +394,7 @@ tp_new_touch(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 	 * don't know if it's a touch down or not. And BTN_TOUCH may happen
 	 * after ABS_MT_TRACKING_ID */
 	tp_motion_history_reset(t);
-	t->dirty = true;
+	tp_touch_mark_dirty(t);
 	t->has_ended = false;
 	t->was_down = false;
 	t->palm.state = PALM_NONE;
@@ -347,7 +410,7 @@ tp_new_touch(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 static inline void
 tp_begin_touch(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 {
-	t->dirty = true;
+	tp_touch_mark_dirty(t);
 	t->state = TOUCH_BEGIN;
 	t->time = time;
 	t->was_down = true;
@@ -358,6 +421,11 @@ tp_begin_touch(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 	t->speed.exceeded_count = 0;
 	assert(tp->nfingers_down >= 1);
 	tp->hysteresis.last_motion_time = time;
+
+	if (tp->nfingers_down == 1) {
+		tp->low_latency.touch_time = time;
+		tp->low_latency.first_motion_pending = true;
+	}
 }
 
 /**
@@ -396,7 +464,7 @@ tp_maybe_end_touch(struct tp_dispatch *tp,
 		t->state = TOUCH_NONE;
 	}
 
-	t->dirty = true;
+	tp_touch_mark_dirty(t);
 }
 
 /**
@@ -407,7 +475,7 @@ static inline void
 tp_recover_ended_touch(struct tp_dispatch *tp,
 		       struct tp_touch *t)
 {
-	t->dirty = true;
+	tp_touch_mark_dirty(t);
 	t->state = TOUCH_UPDATE;
 	tp->nfingers_down++;
 }
@@ -427,7 +495,7 @@ tp_end_touch(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 		return;
 	}
 
-	t->dirty = true;
+	tp_touch_mark_dirty(t);
 	t->palm.state = PALM_NONE;
 	t->state = TOUCH_END;
 	t->pinned.is_pinned = false;
@@ -506,19 +574,21 @@ tp_process_absolute(struct tp_dispatch *tp,
 	case ABS_MT_POSITION_X:
 		evdev_device_check_abs_axis_range(tp->device,
 						  e->code,
-						  e->value);
+						  e->value,
+						  time);
 		t->point.x = rotated(tp, e->code, e->value);
 		t->time = time;
-		t->dirty = true;
+		tp_touch_mark_dirty(t);
 		tp->queued |= TOUCHPAD_EVENT_MOTION;
 		break;
 	case ABS_MT_POSITION_Y:
 		evdev_device_check_abs_axis_range(tp->device,
 						  e->code,
-						  e->value);
+						  e->value,
+						  time);
 		t->point.y = rotated(tp, e->code, e->value);
 		t->time = time;
-		t->dirty = true;
+		tp_touch_mark_dirty(t);
 		tp->queued |= TOUCHPAD_EVENT_MOTION;
 		break;
 	case ABS_MT_SLOT:
@@ -537,23 +607,23 @@ tp_process_absolute(struct tp_dispatch *tp,
 	case ABS_MT_PRESSURE:
 		t->pressure = e->value;
 		t->time = time;
-		t->dirty = true;
+		tp_touch_mark_contact_dirty(t);
 		tp->queued |= TOUCHPAD_EVENT_OTHERAXIS;
 		break;
 	case ABS_MT_TOOL_TYPE:
 		t->is_tool_palm = e->value == MT_TOOL_PALM;
 		t->time = time;
-		t->dirty = true;
+		tp_touch_mark_contact_dirty(t);
 		tp->queued |= TOUCHPAD_EVENT_OTHERAXIS;
 		break;
 	case ABS_MT_TOUCH_MAJOR:
 		t->major = e->value;
-		t->dirty = true;
+		tp_touch_mark_contact_dirty(t);
 		tp->queued |= TOUCHPAD_EVENT_OTHERAXIS;
 		break;
 	case ABS_MT_TOUCH_MINOR:
 		t->minor = e->value;
-		t->dirty = true;
+		tp_touch_mark_contact_dirty(t);
 		tp->queued |= TOUCHPAD_EVENT_OTHERAXIS;
 		break;
 	}
@@ -570,25 +640,27 @@ tp_process_absolute_st(struct tp_dispatch *tp,
 	case ABS_X:
 		evdev_device_check_abs_axis_range(tp->device,
 						  e->code,
-						  e->value);
+						  e->value,
+						  time);
 		t->point.x = rotated(tp, e->code, e->value);
 		t->time = time;
-		t->dirty = true;
+		tp_touch_mark_dirty(t);
 		tp->queued |= TOUCHPAD_EVENT_MOTION;
 		break;
 	case ABS_Y:
 		evdev_device_check_abs_axis_range(tp->device,
 						  e->code,
-						  e->value);
+						  e->value,
+						  time);
 		t->point.y = rotated(tp, e->code, e->value);
 		t->time = time;
-		t->dirty = true;
+		tp_touch_mark_dirty(t);
 		tp->queued |= TOUCHPAD_EVENT_MOTION;
 		break;
 	case ABS_PRESSURE:
 		t->pressure = e->value;
 		t->time = time;
-		t->dirty = true;
+		tp_touch_mark_contact_dirty(t);
 		tp->queued |= TOUCHPAD_EVENT_OTHERAXIS;
 		break;
 	}
@@ -618,7 +690,7 @@ tp_restore_synaptics_touches(struct tp_dispatch *tp,
 	 * Note: we only handle the transition from 2 to 3 touches, not the
 	 * other way round (see gitlab#434)
 	 */
-	for (i = 0; i < tp->num_slots; i++) {
+	for (i = 0; i < tp_allocated_slots(tp); i++) {
 		struct tp_touch *t = tp_get_touch(tp, i);
 
 		if (t->state != TOUCH_MAYBE_END)
@@ -687,7 +759,7 @@ tp_process_fake_touches(struct tp_dispatch *tp,
 
 
 	start = tp->has_mt ? tp->num_slots : 0;
-	for (i = start; i < tp->ntouches; i++) {
+	for (i = start; i < tp->ntouches_allocated; i++) {
 		t = tp_get_touch(tp, i);
 		if (i < nfake_touches)
 			tp_new_touch(tp, t, time);
@@ -785,13 +857,14 @@ static void
 tp_unpin_finger(const struct tp_dispatch *tp, struct tp_touch *t)
 {
 	struct phys_coords mm;
-	struct device_coords delta;
+	struct device_coords delta, center;
 
 	if (!t->pinned.is_pinned)
 		return;
 
-	delta.x = abs(t->point.x - t->pinned.center.x);
-	delta.y = abs(t->point.y - t->pinned.center.y);
+	center = tp_touch_cold(t)->pinned.center;
+	delta.x = abs(t->point.x - center.x);
+	delta.y = abs(t->point.y - center.y);
 
 	mm = evdev_device_unit_delta_to_mm(tp->device, &delta);
 
@@ -809,7 +882,7 @@ tp_pin_fingers(struct tp_dispatch *tp)
 
 	tp_for_each_touch(tp, t) {
 		t->pinned.is_pinned = true;
-		t->pinned.center = t->point;
+		tp_touch_cold(t)->pinned.center = t->point;
 	}
 }
 
@@ -835,36 +908,203 @@ tp_touch_active_for_gesture(const struct tp_dispatch *tp, const struct tp_touch
 		tp_edge_scroll_touch_active(tp, t);
 }
 
-static inline bool
-tp_palm_was_in_side_edge(const struct tp_dispatch *tp, const struct tp_touch *t)
+/* The per-axis comparisons the regions are built from. Every region is
+ * the intersection of an x and a y condition, so a grid cell has a
+ * single set of regions if neither axis changes within the cell. */
+enum tp_region_x_axis {
+	TP_REGION_X_BOTTOM_MIDDLE	= bit(0),
+	TP_REGION_X_BOTTOM_RIGHT	= bit(1),
+	TP_REGION_X_TOP_LEFT		= bit(2),
+	TP_REGION_X_TOP_RIGHT		= bit(3),
+	TP_REGION_X_EDGE		= bit(4),
+	TP_REGION_X_PALM		= bit(5),
+};
+
+enum tp_region_y_axis {
+	TP_REGION_Y_BOTTOM		= bit(0),
+	TP_REGION_Y_TOP			= bit(1),
+	TP_REGION_Y_EDGE		= bit(2),
+	TP_REGION_Y_PALM		= bit(3),
+};
+
+static uint32_t
+tp_regions_x_axis(const struct tp_dispatch *tp, int x)
 {
-	return t->palm.first.x < tp->palm.left_edge ||
-	       t->palm.first.x > tp->palm.right_edge;
+	uint32_t bits = 0;
+
+	if (x > tp->buttons.bottom_area.middlebutton_left_edge)
+		bits |= TP_REGION_X_BOTTOM_MIDDLE;
+	if (x > tp->buttons.bottom_area.rightbutton_left_edge)
+		bits |= TP_REGION_X_BOTTOM_RIGHT;
+	if (x < tp->buttons.top_area.leftbutton_right_edge)
+		bits |= TP_REGION_X_TOP_LEFT;
+	if (x > tp->buttons.top_area.rightbutton_left_edge)
+		bits |= TP_REGION_X_TOP_RIGHT;
+	if (x > tp->scroll.right_edge)
+		bits |= TP_REGION_X_EDGE;
+	if (x < tp->palm.left_edge || x > tp->palm.right_edge)
+		bits |= TP_REGION_X_PALM;
+
+	return bits;
 }
 
-static inline bool
-tp_palm_was_in_top_edge(const struct tp_dispatch *tp, const struct tp_touch *t)
+static uint32_t
+tp_regions_y_axis(const struct tp_dispatch *tp, int y)
+{
+	uint32_t bits = 0;
+
+	if (y >= tp->buttons.bottom_area.top_edge)
+		bits |= TP_REGION_Y_BOTTOM;
+	if (y <= tp->buttons.top_area.bottom_edge)
+		bits |= TP_REGION_Y_TOP;
+	if (y > tp->scroll.bottom_edge)
+		bits |= TP_REGION_Y_EDGE;
+	if (y < tp->palm.upper_edge)
+		bits |= TP_REGION_Y_PALM;
+
+	return bits;
+}
+
+static uint32_t
+tp_regions_combine(uint32_t xbits, uint32_t ybits)
+{
+	uint32_t regions = TP_REGION_NONE;
+
+	if (ybits & TP_REGION_Y_BOTTOM) {
+		if (xbits & TP_REGION_X_BOTTOM_RIGHT)
+			regions |= TP_REGION_BOTTOM_RIGHT;
+		else if (xbits & TP_REGION_X_BOTTOM_MIDDLE)
+			regions |= TP_REGION_BOTTOM_MIDDLE;
+		else
+			regions |= TP_REGION_BOTTOM_LEFT;
+	}
+
+	if (ybits & TP_REGION_Y_TOP) {
+		if (xbits & TP_REGION_X_TOP_RIGHT)
+			regions |= TP_REGION_TOP_RIGHT;
+		else if (xbits & TP_REGION_X_TOP_LEFT)
+			regions |= TP_REGION_TOP_LEFT;
+		else
+			regions |= TP_REGION_TOP_MIDDLE;
+	}
+
+	if (xbits & TP_REGION_X_EDGE)
+		regions |= TP_REGION_EDGE_RIGHT;
+	if (ybits & TP_REGION_Y_EDGE)
+		regions |= TP_REGION_EDGE_BOTTOM;
+
+	if (xbits & TP_REGION_X_PALM)
+		regions |= TP_REGION_PALM_SIDE;
+	if (ybits & TP_REGION_Y_PALM)
+		regions |= TP_REGION_PALM_TOP;
+
+	return regions;
+}
+
+uint32_t
+tp_regions_classify(const struct tp_dispatch *tp,
+		    const struct device_coords *point)
+{
+	return tp_regions_combine(tp_regions_x_axis(tp, point->x),
+				  tp_regions_y_axis(tp, point->y));
+}
+
+static unsigned int
+tp_regions_cell_shift(const struct input_absinfo *absinfo)
 {
-	return t->palm.first.y < tp->palm.upper_edge;
+	unsigned int range = absinfo->maximum - absinfo->minimum;
+	unsigned int shift = 0;
+
+	while ((range >> shift) >= TP_REGION_GRID_SIZE)
+		shift++;
+
+	return shift;
+}
+
+/* Fills in the axis bits for each cell along one axis, or marks the cell
+ * as split if the bits change anywhere within the cell */
+static void
+tp_regions_build_axis(const struct tp_dispatch *tp,
+		      uint32_t (*axis)(const struct tp_dispatch *tp, int v),
+		      int origin,
+		      unsigned int shift,
+		      uint32_t bits[TP_REGION_GRID_SIZE],
+		      bool split[TP_REGION_GRID_SIZE])
+{
+	for (unsigned int i = 0; i < TP_REGION_GRID_SIZE; i++) {
+		int start = origin + (int)(i << shift);
+		int end = start + (1 << shift);
+
+		bits[i] = axis(tp, start);
+		split[i] = false;
+		for (int v = start + 1; v < end; v++) {
+			if (axis(tp, v) != bits[i]) {
+				split[i] = true;
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * Rebuild the region map from the current button areas, scroll edges and
+ * palm edges. This must be called whenever any of those change.
+ *
+ * Touch coordinates are rotated before they are classified, so the map
+ * does not need to change with the left-handed rotation.
+ */
+void
+tp_regions_update(struct tp_dispatch *tp)
+{
+	const struct input_absinfo *ax = tp->device->abs.absinfo_x,
+				   *ay = tp->device->abs.absinfo_y;
+	uint32_t xbits[TP_REGION_GRID_SIZE], ybits[TP_REGION_GRID_SIZE];
+	bool xsplit[TP_REGION_GRID_SIZE], ysplit[TP_REGION_GRID_SIZE];
+
+	tp->regions.origin.x = ax->minimum;
+	tp->regions.origin.y = ay->minimum;
+	tp->regions.shift_x = tp_regions_cell_shift(ax);
+	tp->regions.shift_y = tp_regions_cell_shift(ay);
+
+	tp_regions_build_axis(tp, tp_regions_x_axis,
+			      tp->regions.origin.x, tp->regions.shift_x,
+			      xbits, xsplit);
+	tp_regions_build_axis(tp, tp_regions_y_axis,
+			      tp->regions.origin.y, tp->regions.shift_y,
+			      ybits, ysplit);
+
+	for (unsigned int row = 0; row < TP_REGION_GRID_SIZE; row++) {
+		for (unsigned int col = 0; col < TP_REGION_GRID_SIZE; col++) {
+			uint16_t *cell = &tp->regions.cells[row][col];
+
+			if (xsplit[col] || ysplit[row])
+				*cell = TP_REGION_SPLIT;
+			else
+				*cell = tp_regions_combine(xbits[col],
+							   ybits[row]);
+		}
+	}
 }
 
 static inline bool
-tp_palm_in_side_edge(const struct tp_dispatch *tp, const struct tp_touch *t)
+tp_palm_was_in_side_edge(const struct tp_dispatch *tp, const struct tp_touch *t)
 {
-	return t->point.x < tp->palm.left_edge ||
-	       t->point.x > tp->palm.right_edge;
+	int x = tp_touch_cold(t)->palm.first.x;
+
+	return x < tp->palm.left_edge || x > tp->palm.right_edge;
 }
 
 static inline bool
-tp_palm_in_top_edge(const struct tp_dispatch *tp, const struct tp_touch *t)
+tp_palm_was_in_top_edge(const struct tp_dispatch *tp, const struct tp_touch *t)
 {
-	return t->point.y < tp->palm.upper_edge;
+	return tp_touch_cold(t)->palm.first.y < tp->palm.upper_edge;
 }
 
 static inline bool
 tp_palm_in_edge(const struct tp_dispatch *tp, const struct tp_touch *t)
 {
-	return tp_palm_in_side_edge(tp, t) || tp_palm_in_top_edge(tp, t);
+	return tp_touch_get_regions(tp, t) &
+		(TP_REGION_PALM_SIDE|TP_REGION_PALM_TOP);
 }
 
 bool
@@ -891,7 +1131,7 @@ tp_palm_detect_dwt_triggered(struct tp_dispatch *tp,
 	    tp->dwt.keyboard_active &&
 	    t->state == TOUCH_BEGIN) {
 		t->palm.state = PALM_TYPING;
-		t->palm.first = t->point;
+		tp_touch_cold(t)->palm.first = t->point;
 		return true;
 	} else if (!tp->dwt.keyboard_active &&
 		   t->state == TOUCH_UPDATE &&
@@ -905,6 +1145,10 @@ tp_palm_detect_dwt_triggered(struct tp_dispatch *tp,
 		if (t->palm.time == 0 ||
 		    t->palm.time > tp->dwt.keyboard_last_press_time) {
 			t->palm.state = PALM_NONE;
+			libinput_device_record_delay(&tp->device->base,
+						     LIBINPUT_DELAY_SOURCE_DWT,
+						     tp->dwt.keyboard_last_press_time,
+						     time);
 			evdev_log_debug(tp->device,
 					"palm: touch %d released, timeout after typing\n",
 					t->index);
@@ -981,7 +1225,7 @@ tp_palm_detect_move_out_of_edge(struct tp_dispatch *tp,
 			directions = S|SE|SW;
 
 		if (directions) {
-			delta = device_delta(t->point, t->palm.first);
+			delta = device_delta(t->point, tp_touch_cold(t)->palm.first);
 			dirs = phys_get_direction(tp_phys_delta(tp, delta));
 			if ((dirs & directions) && !(dirs & ~directions))
 				return true;
@@ -1090,7 +1334,7 @@ tp_palm_detect_edge(struct tp_dispatch *tp,
 
 	t->palm.state = PALM_EDGE;
 	t->palm.time = time;
-	t->palm.first = t->point;
+	tp_touch_cold(t)->palm.first = t->point;
 
 	return true;
 }
@@ -1131,36 +1375,12 @@ tp_palm_detect(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 {
 	const char *palm_state;
 	enum touch_palm_state oldstate = t->palm.state;
+	unsigned int i;
 
-	if (tp_palm_detect_pressure_triggered(tp, t, time))
-		goto out;
-
-	if (tp_palm_detect_arbitration_triggered(tp, t, time))
-		goto out;
-
-	if (tp_palm_detect_dwt_triggered(tp, t, time))
-		goto out;
-
-	if (tp_palm_detect_trackpoint_triggered(tp, t, time))
-		goto out;
-
-	if (tp_palm_detect_tool_triggered(tp, t, time))
-		goto out;
-
-	if (tp_palm_detect_touch_size_triggered(tp, t, time))
-		goto out;
-
-	if (tp_palm_detect_edge(tp, t, time))
-		goto out;
-
-	/* Pressure is highest priority because it cannot be released and
-	 * overrides all other checks. So we check once before anything else
-	 * in case pressure triggers on a non-palm touch. And again after
-	 * everything in case one of the others released but we have a
-	 * pressure trigger now.
-	 */
-	if (tp_palm_detect_pressure_triggered(tp, t, time))
-		goto out;
+	for (i = 0; i < tp->palm.ndetectors; i++) {
+		if (tp->palm.detectors[i](tp, t, time))
+			goto out;
+	}
 
 	return;
 out:
@@ -1168,6 +1388,12 @@ out:
 	if (oldstate == t->palm.state)
 		return;
 
+	if (oldstate == PALM_NONE)
+		libinput_device_stat_inc(&tp->device->base,
+					 t->palm.state == PALM_ARBITRATION ?
+					 LIBINPUT_DEVICE_STAT_DISCARDED_ARBITRATION :
+					 LIBINPUT_DEVICE_STAT_DISCARDED_PALM);
+
 	switch (t->palm.state) {
 	case PALM_EDGE:
 		palm_state = "edge";
@@ -1213,7 +1439,7 @@ tp_unhover_pressure(struct tp_dispatch *tp, uint64_t time)
 	if (nfake_touches == FAKE_FINGER_OVERFLOW)
 		nfake_touches = 0;
 
-	for (i = 0; i < (int)tp->num_slots; i++) {
+	for (i = 0; i < (int)tp_allocated_slots(tp); i++) {
 		t = tp_get_touch(tp, i);
 
 		if (t->state == TOUCH_NONE)
@@ -1259,7 +1485,7 @@ tp_unhover_pressure(struct tp_dispatch *tp, uint64_t time)
 	 * ones don't. Anything else gets insane quickly.
 	 */
 	if (real_fingers_down > 0) {
-		tp_for_each_touch(tp, t) {
+		tp_for_each_active_touch(tp, t) {
 			if (t->state == TOUCH_HOVERING) {
 				/* avoid jumps when landing a finger */
 				tp_motion_history_reset(t);
@@ -1273,7 +1499,7 @@ tp_unhover_pressure(struct tp_dispatch *tp, uint64_t time)
 
 	if (tp->nfingers_down > nfake_touches ||
 	    real_fingers_down == 0) {
-		for (i = tp->ntouches - 1; i >= 0; i--) {
+		for (i = tp->ntouches_allocated - 1; i >= 0; i--) {
 			t = tp_get_touch(tp, i);
 
 			if (t->state == TOUCH_HOVERING ||
@@ -1301,7 +1527,7 @@ tp_unhover_size(struct tp_dispatch *tp, uint64_t time)
 	/* We require 5 slots for size handling, so we don't need to care
 	 * about fake touches here */
 
-	for (i = 0; i < (int)tp->num_slots; i++) {
+	for (i = 0; i < (int)tp_allocated_slots(tp); i++) {
 		t = tp_get_touch(tp, i);
 
 		if (t->state == TOUCH_NONE)
@@ -1356,7 +1582,7 @@ tp_unhover_fake_touches(struct tp_dispatch *tp, uint64_t time)
 	 */
 	if (tp_fake_finger_is_touching(tp) &&
 	    tp->nfingers_down < nfake_touches) {
-		tp_for_each_touch(tp, t) {
+		tp_for_each_active_touch(tp, t) {
 			if (t->state == TOUCH_HOVERING) {
 				tp_begin_touch(tp, t, time);
 
@@ -1372,7 +1598,7 @@ tp_unhover_fake_touches(struct tp_dispatch *tp, uint64_t time)
 	 */
 	if (tp->nfingers_down > nfake_touches ||
 	    !tp_fake_finger_is_touching(tp)) {
-		for (i = tp->ntouches - 1; i >= 0; i--) {
+		for (i = tp->ntouches_allocated - 1; i >= 0; i--) {
 			t = tp_get_touch(tp, i);
 
 			if (t->state == TOUCH_HOVERING ||
@@ -1415,7 +1641,7 @@ tp_position_fake_touches(struct tp_dispatch *tp)
 	 * touch and copy its coordinates over to to all fake touches.
 	 * This is more reliable than just taking the first touch.
 	 */
-	for (i = 0; i < tp->num_slots; i++) {
+	for (i = 0; i < tp_allocated_slots(tp); i++) {
 		t = tp_get_touch(tp, i);
 		if (t->state == TOUCH_END ||
 		    t->state == TOUCH_NONE)
@@ -1432,15 +1658,16 @@ tp_position_fake_touches(struct tp_dispatch *tp)
 	}
 
 	start = tp->has_mt ? tp->num_slots : 1;
-	for (i = start; i < tp->ntouches; i++) {
+	for (i = start; i < tp->ntouches_allocated; i++) {
 		t = tp_get_touch(tp, i);
 		if (t->state == TOUCH_NONE)
 			continue;
 
 		t->point = topmost->point;
 		t->pressure = topmost->pressure;
-		if (!t->dirty)
-			t->dirty = topmost->dirty;
+		if (!t->dirty && topmost->dirty)
+			tp_touch_mark_dirty(t);
+		t->contact_dirty |= topmost->contact_dirty;
 	}
 }
 
@@ -1669,7 +1896,7 @@ tp_pre_process_state(struct tp_dispatch *tp, uint64_t time)
 	tp_process_fake_touches(tp, time);
 	tp_unhover_touches(tp, time);
 
-	tp_for_each_touch(tp, t) {
+	tp_for_each_active_touch(tp, t) {
 		if (t->state == TOUCH_MAYBE_END)
 			tp_end_touch(tp, t, time);
 
@@ -1681,6 +1908,24 @@ tp_pre_process_state(struct tp_dispatch *tp, uint64_t time)
 
 }
 
+/* A resting finger on a jittery touchpad keeps sending positions inside
+ * the hysteresis margin. Such a touch can't be a jump, can't change its
+ * thumb state or unpin, and its speed is zero. Only palm detection has
+ * transitions based on time, e.g. a typing palm being released */
+static inline bool
+tp_touch_is_stationary(const struct tp_dispatch *tp, const struct tp_touch *t)
+{
+	return t->state == TOUCH_UPDATE &&
+	       !t->contact_dirty &&
+	       t->speed.exceeded_count == 0 &&
+	       t->history.count > 0 &&
+	       tp->nfingers_down == tp->old_nfingers_down &&
+	       tp_hysteresis_active(tp) &&
+	       evdev_hysteresis_contains(&t->point,
+					 &t->hysteresis.center,
+					 &tp->hysteresis.margin);
+}
+
 static void
 tp_process_state(struct tp_dispatch *tp, uint64_t time)
 {
@@ -1694,7 +1939,7 @@ tp_process_state(struct tp_dispatch *tp, uint64_t time)
 
 	want_motion_reset = tp_need_motion_history_reset(tp);
 
-	tp_for_each_touch(tp, t) {
+	tp_for_each_active_touch(tp, t) {
 		if (t->state == TOUCH_NONE)
 			continue;
 
@@ -1716,10 +1961,23 @@ tp_process_state(struct tp_dispatch *tp, uint64_t time)
 			continue;
 		}
 
+		if (tp_touch_is_stationary(tp, t)) {
+			tp_palm_detect(tp, t, time);
+			t->point = t->hysteresis.center;
+			t->speed.last_speed = 0;
+			tp_motion_history_push(t);
+			libinput_device_stat_inc(&tp->device->base,
+						 LIBINPUT_DEVICE_STAT_STATIONARY_TOUCHES);
+			continue;
+		}
+
 		if (tp_detect_jumps(tp, t, time)) {
+			libinput_device_stat_inc(&tp->device->base,
+						 LIBINPUT_DEVICE_STAT_DISCARDED_JUMP);
 			if (!tp->semi_mt)
 				evdev_log_bug_kernel_ratelimit(tp->device,
 						&tp->jump.warning,
+						time,
 					        "Touch jump detected and discarded.\n"
 					        "See %stouchpad-jumping-cursors.html for details\n",
 					        HTTP_DOC_LINK);
@@ -1793,7 +2051,7 @@ tp_post_process_state(struct tp_dispatch *tp, uint64_t time)
 {
 	struct tp_touch *t;
 
-	tp_for_each_touch(tp, t) {
+	tp_for_each_active_touch(tp, t) {
 
 		if (!t->dirty)
 			continue;
@@ -1808,6 +2066,9 @@ tp_post_process_state(struct tp_dispatch *tp, uint64_t time)
 		}
 
 		t->dirty = false;
+		t->contact_dirty = false;
+		if (t->state == TOUCH_NONE)
+			tp->active_touches &= ~((uint64_t)1 << t->index);
 	}
 
 	tp->old_nfingers_down = tp->nfingers_down;
@@ -1867,13 +2128,56 @@ tp_apply_rotation(struct evdev_device *device)
 			tp->left_handed.rotate ? "on" : "off");
 }
 
+/* A frame where all touches keep hovering, e.g. a finger resting just
+ * above a hover-capable touchpad. Tapping, the buttons, edge scrolling
+ * and gestures all ignore hovering touches and there's nothing to post,
+ * only palm detection may mark a hovering touch already, e.g. for
+ * MT_TOOL_PALM. Everything else about the touch is reset once it
+ * begins. */
+static inline bool
+tp_frame_is_hover_only(struct tp_dispatch *tp)
+{
+	struct tp_touch *t;
+
+	if (tp->nfingers_down != 0 || tp->old_nfingers_down != 0)
+		return false;
+
+	if (tp->queued & (TOUCHPAD_EVENT_BUTTON_PRESS|TOUCHPAD_EVENT_BUTTON_RELEASE))
+		return false;
+
+	tp_for_each_active_touch(tp, t) {
+		if (t->state != TOUCH_HOVERING)
+			return false;
+	}
+
+	return true;
+}
+
+static void
+tp_process_hover_state(struct tp_dispatch *tp, uint64_t time)
+{
+	struct tp_touch *t;
+
+	tp_for_each_active_touch(tp, t) {
+		if (t->dirty)
+			tp_palm_detect(tp, t, time);
+	}
+
+	libinput_device_stat_inc(&tp->device->base,
+				 LIBINPUT_DEVICE_STAT_HOVER_FRAMES);
+}
+
 static void
 tp_handle_state(struct tp_dispatch *tp,
 		uint64_t time)
 {
 	tp_pre_process_state(tp, time);
-	tp_process_state(tp, time);
-	tp_post_events(tp, time);
+	if (tp_frame_is_hover_only(tp)) {
+		tp_process_hover_state(tp, time);
+	} else {
+		tp_process_state(tp, time);
+		tp_post_events(tp, time);
+	}
 	tp_post_process_state(tp, time);
 
 	tp_clickpad_middlebutton_apply_config(tp->device);
@@ -1903,14 +2207,12 @@ tp_debug_touch_state(struct tp_dispatch *tp,
 		evdev_log_debug(device, "touch state: %s\n", buf);
 }
 
-static void
-tp_interface_process(struct evdev_dispatch *dispatch,
-		     struct evdev_device *device,
-		     struct input_event *e,
-		     uint64_t time)
+static inline void
+tp_process_event(struct tp_dispatch *tp,
+		 struct evdev_device *device,
+		 struct input_event *e,
+		 uint64_t time)
 {
-	struct tp_dispatch *tp = tp_dispatch(dispatch);
-
 	switch (e->type) {
 	case EV_ABS:
 		if (tp->has_mt)
@@ -1933,6 +2235,28 @@ tp_interface_process(struct evdev_dispatch *dispatch,
 	}
 }
 
+static void
+tp_interface_process(struct evdev_dispatch *dispatch,
+		     struct evdev_device *device,
+		     struct input_event *e,
+		     uint64_t time)
+{
+	tp_process_event(tp_dispatch(dispatch), device, e, time);
+}
+
+static void
+tp_interface_process_frame(struct evdev_dispatch *dispatch,
+			   struct evdev_device *device,
+			   struct input_event *events,
+			   size_t nevents,
+			   uint64_t time)
+{
+	struct tp_dispatch *tp = tp_dispatch(dispatch);
+
+	for (size_t i = 0; i < nevents; i++)
+		tp_process_event(tp, device, &events[i], time);
+}
+
 static void
 tp_remove_sendevents(struct tp_dispatch *tp)
 {
@@ -1983,8 +2307,27 @@ tp_interface_destroy(struct evdev_dispatch *dispatch)
 	libinput_timer_destroy(&tp->dwt.keyboard_timer);
 	libinput_timer_destroy(&tp->tap.timer);
 	libinput_timer_destroy(&tp->gesture.finger_count_switch_timer);
-	free(tp->touches);
-	free(tp);
+	mem_free(tp);
+}
+
+static size_t
+tp_interface_memory_usage(struct evdev_dispatch *dispatch)
+{
+	struct tp_dispatch *tp = tp_dispatch(dispatch);
+	struct evdev_paired_keyboard *kbd;
+	size_t size = sizeof(*tp);
+
+	size += tp->ntouches * sizeof(*tp->touches);
+	size += tp->ntouches * sizeof(*tp->touches_cold);
+	size += tp->ntouches_allocated *
+		(sizeof(**tp->touches) + sizeof(**tp->touches_cold));
+	size += tp->ntouches_allocated * tp->history_length *
+		sizeof(struct tp_history_point);
+
+	list_for_each(kbd, &tp->dwt.paired_keyboard_list, link)
+		size += sizeof(*kbd);
+
+	return size;
 }
 
 static void
@@ -2064,13 +2407,12 @@ tp_interface_suspend(struct evdev_dispatch *dispatch,
 }
 
 static inline void
-tp_sync_touch(struct tp_dispatch *tp,
-	      struct evdev_device *device,
-	      struct tp_touch *t,
-	      int slot)
+tp_sync_touch_values(struct tp_dispatch *tp,
+		     struct evdev_device *device,
+		     struct tp_touch *t,
+		     int slot)
 {
 	struct libevdev *evdev = device->evdev;
-	int tracking_id;
 
 	if (!libevdev_fetch_slot_value(evdev,
 				       slot,
@@ -2099,6 +2441,18 @@ tp_sync_touch(struct tp_dispatch *tp,
 				  slot,
 				  ABS_MT_TOUCH_MINOR,
 				  &t->minor);
+}
+
+static inline void
+tp_sync_touch(struct tp_dispatch *tp,
+	      struct evdev_device *device,
+	      struct tp_touch *t,
+	      int slot)
+{
+	struct libevdev *evdev = device->evdev;
+	int tracking_id;
+
+	tp_sync_touch_values(tp, device, t, slot);
 
 	if (libevdev_fetch_slot_value(evdev,
 				      slot,
@@ -2114,9 +2468,66 @@ tp_sync_slots(struct tp_dispatch *tp,
 {
 	/* Always sync the first touch so we get ABS_X/Y synced on
 	 * single-touch touchpads */
-	tp_sync_touch(tp, device, &tp->touches[0], 0);
-	for (unsigned int i = 1; i < tp->num_slots; i++)
-		tp_sync_touch(tp, device, &tp->touches[i], i);
+	tp_sync_touch(tp, device, tp->touches[0], 0);
+	for (unsigned int i = 1; i < tp->num_slots; i++) {
+		int tracking_id;
+
+		/* A slot without a touch gets its values synced when
+		 * its chunk is allocated */
+		if (i >= tp->ntouches_allocated &&
+		    (!libevdev_fetch_slot_value(device->evdev,
+						i,
+						ABS_MT_TRACKING_ID,
+						&tracking_id) ||
+		     tracking_id == -1))
+			continue;
+
+		tp_sync_touch(tp, device, tp_get_touch(tp, i), i);
+	}
+}
+
+static void
+tp_alloc_touches(struct tp_dispatch *tp, unsigned int index)
+{
+	struct evdev_device *device = tp->device;
+
+	assert(index < tp->ntouches);
+
+	while (tp->ntouches_allocated <= index) {
+		unsigned int first = tp->ntouches_allocated;
+		unsigned int n = min(tp->ntouches - first,
+				     (unsigned int)TOUCHPAD_TOUCH_CHUNK);
+		struct tp_touch *touches;
+		struct tp_touch_cold *cold;
+		struct tp_history_point *samples;
+
+		touches = arena_zalloc(&device->arena, n * sizeof(*touches));
+		cold = arena_zalloc(&device->arena, n * sizeof(*cold));
+		samples = arena_zalloc(&device->arena,
+				       n * tp->history_length *
+				       sizeof(*samples));
+
+		for (unsigned int i = 0; i < n; i++) {
+			struct tp_touch *t = &touches[i];
+
+			t->tp = tp;
+			t->has_ended = true;
+			t->index = first + i;
+			t->history.samples = &samples[i * tp->history_length];
+			t->button.state = BUTTON_STATE_NONE;
+			t->scroll.direction = -1;
+
+			/* The kernel only sends the values that changed
+			 * since the slot was last used */
+			if (t->index < tp->num_slots)
+				tp_sync_touch_values(tp, device, t, t->index);
+
+			tp->touches[t->index] = t;
+			tp->touches_cold[t->index] = &cold[i];
+		}
+
+		tp->ntouches_allocated += n;
+	}
 }
 
 static void
@@ -2141,11 +2552,30 @@ tp_resume(struct tp_dispatch *tp,
 	tp_sync_slots(tp, device);
 }
 
+static inline void
+tp_trackpoint_set_timeout(struct tp_dispatch *tp, uint64_t timeout)
+{
+	struct libinput_timer *timer = &tp->palm.trackpoint_timer;
+
+	tp->palm.trackpoint_timeout = timeout;
+
+	/* Trackpoint events only ever push the timeout back, see
+	 * tp_keyboard_set_timeout() */
+	if (timer->expire == 0 || timer->expire > timeout)
+		libinput_timer_set(timer, timeout);
+}
+
 static void
 tp_trackpoint_timeout(uint64_t now, void *data)
 {
 	struct tp_dispatch *tp = data;
 
+	if (now < tp->palm.trackpoint_timeout) {
+		libinput_timer_set(&tp->palm.trackpoint_timer,
+				   tp->palm.trackpoint_timeout);
+		return;
+	}
+
 	if (tp->palm.trackpoint_active) {
 		tp_tap_resume(tp, now);
 		tp->palm.trackpoint_active = false;
@@ -2166,11 +2596,10 @@ tp_trackpoint_event(uint64_t time, struct libinput_event *event, void *data)
 	tp->palm.trackpoint_last_event_time = time;
 	tp->palm.trackpoint_event_count++;
 
-
 	/* Require at least three events before enabling palm detection */
 	if (tp->palm.trackpoint_event_count < 3) {
-		libinput_timer_set(&tp->palm.trackpoint_timer,
-				   time + DEFAULT_TRACKPOINT_EVENT_TIMEOUT);
+		tp_trackpoint_set_timeout(tp,
+					  time + DEFAULT_TRACKPOINT_EVENT_TIMEOUT);
 		return;
 	}
 
@@ -2179,8 +2608,21 @@ tp_trackpoint_event(uint64_t time, struct libinput_event *event, void *data)
 		tp->palm.trackpoint_active = true;
 	}
 
-	libinput_timer_set(&tp->palm.trackpoint_timer,
-			   time + DEFAULT_TRACKPOINT_ACTIVITY_TIMEOUT);
+	tp_trackpoint_set_timeout(tp, time + DEFAULT_TRACKPOINT_ACTIVITY_TIMEOUT);
+}
+
+static inline void
+tp_keyboard_set_timeout(struct tp_dispatch *tp, uint64_t timeout)
+{
+	struct libinput_timer *timer = &tp->dwt.keyboard_timer;
+
+	tp->dwt.keyboard_timeout = timeout;
+
+	/* Key presses only ever push the timeout back. Rather than
+	 * re-arming the timer for every key press, leave it armed for the
+	 * earlier time and re-arm it for the real timeout when it fires */
+	if (timer->expire == 0 || timer->expire > timeout)
+		libinput_timer_set(timer, timeout);
 }
 
 static void
@@ -2188,11 +2630,17 @@ tp_keyboard_timeout(uint64_t now, void *data)
 {
 	struct tp_dispatch *tp = data;
 
+	if (now < tp->dwt.keyboard_timeout) {
+		libinput_timer_set(&tp->dwt.keyboard_timer,
+				   tp->dwt.keyboard_timeout);
+		return;
+	}
+
 	if (tp->dwt.dwt_enabled &&
 	    long_any_bit_set(tp->dwt.key_mask,
 			     ARRAY_LENGTH(tp->dwt.key_mask))) {
-		libinput_timer_set(&tp->dwt.keyboard_timer,
-				   now + DEFAULT_KEYBOARD_ACTIVITY_TIMEOUT_2);
+		tp_keyboard_set_timeout(tp,
+					now + DEFAULT_KEYBOARD_ACTIVITY_TIMEOUT_2);
 		tp->dwt.keyboard_last_press_time = now;
 		evdev_log_debug(tp->device, "palm: keyboard timeout refresh\n");
 		return;
@@ -2297,8 +2745,7 @@ tp_keyboard_event(uint64_t time, struct libinput_event *event, void *data)
 
 	tp->dwt.keyboard_last_press_time = time;
 	long_set_bit(tp->dwt.key_mask, key);
-	libinput_timer_set(&tp->dwt.keyboard_timer,
-			   time + timeout);
+	tp_keyboard_set_timeout(tp, time + timeout);
 }
 
 static bool
@@ -2349,6 +2796,7 @@ tp_dwt_pair_keyboard(struct evdev_device *touchpad,
 	kbd->device = keyboard;
 	libinput_device_add_event_listener(&keyboard->base,
 					   &kbd->listener,
+					   EVENT_GROUP(LIBINPUT_EVENT_KEYBOARD_KEY),
 					   tp_keyboard_event, tp);
 	list_insert(&tp->dwt.paired_keyboard_list, &kbd->link);
 	evdev_log_debug(touchpad,
@@ -2380,6 +2828,7 @@ tp_pair_trackpoint(struct evdev_device *touchpad,
 		if (tp->palm.monitor_trackpoint)
 			libinput_device_add_event_listener(&trackpoint->base,
 						&tp->palm.trackpoint_listener,
+						EVENT_GROUP(LIBINPUT_EVENT_POINTER_MOTION),
 						tp_trackpoint_event, tp);
 	}
 }
@@ -2457,6 +2906,7 @@ tp_pair_lid_switch(struct evdev_device *touchpad,
 
 		libinput_device_add_event_listener(&lid_switch->base,
 						   &tp->lid_switch.listener,
+						   EVENT_GROUP(LIBINPUT_EVENT_SWITCH_TOGGLE),
 						   tp_lid_switch_event, tp);
 		tp->lid_switch.lid_switch = lid_switch;
 	}
@@ -2488,6 +2938,7 @@ tp_pair_tablet_mode_switch(struct evdev_device *touchpad,
 
 	libinput_device_add_event_listener(&tablet_mode_switch->base,
 				&tp->tablet_mode_switch.listener,
+				EVENT_GROUP(LIBINPUT_EVENT_SWITCH_TOGGLE),
 				tp_tablet_mode_switch_event, tp);
 	tp->tablet_mode_switch.tablet_mode_switch = tablet_mode_switch;
 
@@ -2665,8 +3116,7 @@ evdev_tag_touchpad(struct evdev_device *device,
 	int bustype, vendor;
 	const char *prop;
 
-	prop = udev_device_get_property_value(udev_device,
-					      "ID_INPUT_TOUCHPAD_INTEGRATION");
+	prop = device->udev_props.touchpad_integration;
 	if (prop) {
 		if (streq(prop, "internal")) {
 			evdev_tag_touchpad_internal(device);
@@ -2727,8 +3177,13 @@ tp_arbitration_timeout(uint64_t now, void *data)
 {
 	struct tp_dispatch *tp = data;
 
-	if (tp->arbitration.state != ARBITRATION_NOT_ACTIVE)
+	if (tp->arbitration.state != ARBITRATION_NOT_ACTIVE) {
 		tp->arbitration.state = ARBITRATION_NOT_ACTIVE;
+		libinput_device_record_delay(&tp->device->base,
+					     LIBINPUT_DELAY_SOURCE_ARBITRATION,
+					     tp->arbitration.release_time,
+					     now);
+	}
 }
 
 static void
@@ -2758,6 +3213,7 @@ tp_interface_toggle_touch(struct evdev_dispatch *dispatch,
 		 * get what looks like a tap. Fix this by delaying
 		 * arbitration by just a little bit so that any touch in
 		 * event is caught as palm touch. */
+		tp->arbitration.release_time = time;
 		libinput_timer_set(&tp->arbitration.arbitration_timer,
 				   time + ms2us(90));
 		break;
@@ -2788,12 +3244,72 @@ touchpad_left_handed_toggled(struct evdev_dispatch *dispatch,
 	tp_change_rotation(device, DONT_NOTIFY);
 }
 
+enum tp_state_flags {
+	TP_STATE_JITTER_DETECTED = bit(0),
+};
+
+static size_t
+tp_interface_save_state(struct evdev_dispatch *dispatch,
+			void *buf,
+			size_t size)
+{
+	struct tp_dispatch *tp = tp_dispatch(dispatch);
+	uint32_t flags = 0;
+
+	if (tp->hysteresis.jitter_detected)
+		flags |= TP_STATE_JITTER_DETECTED;
+
+	if (size >= sizeof(flags))
+		memcpy(buf, &flags, sizeof(flags));
+
+	return sizeof(flags);
+}
+
+static bool
+tp_interface_restore_state(struct evdev_dispatch *dispatch,
+			   const void *buf,
+			   size_t size)
+{
+	struct tp_dispatch *tp = tp_dispatch(dispatch);
+	uint32_t flags;
+
+	if (size != sizeof(flags))
+		return false;
+
+	memcpy(&flags, buf, sizeof(flags));
+	if (flags & ~TP_STATE_JITTER_DETECTED)
+		return false;
+
+	/* Skip the wobble detection, it would just find the jitter again */
+	if (flags & TP_STATE_JITTER_DETECTED) {
+		tp->hysteresis.enabled = true;
+		tp->hysteresis.jitter_detected = true;
+	}
+
+	return true;
+}
+
+static void
+tp_interface_config_commit(struct evdev_dispatch *dispatch,
+			   struct evdev_device *device)
+{
+	struct tp_dispatch *tp = tp_dispatch(dispatch);
+
+	tp_tap_config_commit(tp, libinput_now(tp_libinput_context(tp)));
+	tp_button_config_commit(tp);
+}
+
 static struct evdev_dispatch_interface tp_interface = {
 	.process = tp_interface_process,
+	.process_frame = tp_interface_process_frame,
 	.suspend = tp_interface_suspend,
 	.remove = tp_interface_remove,
 	.destroy = tp_interface_destroy,
 	.device_added = tp_interface_device_added,
+	.pair_tags = EVDEV_TAG_TRACKPOINT | EVDEV_TAG_KEYBOARD |
+		     EVDEV_TAG_LID_SWITCH | EVDEV_TAG_TABLET_MODE_SWITCH |
+		     EVDEV_TAG_EXTERNAL_MOUSE,
+	.pair_seat_caps = EVDEV_DEVICE_TABLET,
 	.device_removed = tp_interface_device_removed,
 	.device_suspended = tp_interface_device_removed, /* treat as remove */
 	.device_resumed = tp_interface_device_added,   /* treat as add */
@@ -2802,16 +3318,39 @@ static struct evdev_dispatch_interface tp_interface = {
 	.touch_arbitration_update_rect = NULL,
 	.get_switch_state = NULL,
 	.left_handed_toggle = touchpad_left_handed_toggled,
+	.memory_usage = tp_interface_memory_usage,
+	.config_commit = tp_interface_config_commit,
+	.save_state = tp_interface_save_state,
+	.restore_state = tp_interface_restore_state,
 };
 
 static void
-tp_init_touch(struct tp_dispatch *tp,
-	      struct tp_touch *t,
-	      unsigned int index)
+tp_init_history_length(struct tp_dispatch *tp,
+		       struct evdev_device *device)
 {
-	t->tp = tp;
-	t->has_ended = true;
-	t->index = index;
+	struct quirks_context *quirks;
+	struct quirks *q;
+	uint32_t length;
+
+	tp->history_length = TOUCHPAD_HISTORY_LENGTH;
+
+	quirks = evdev_libinput_context(device)->quirks;
+	q = quirks_fetch_for_device(quirks, device->udev_device);
+	if (!q)
+		return;
+
+	if (quirks_get_uint32(q, QUIRK_ATTR_TOUCHPAD_HISTORY_LENGTH, &length)) {
+		if (length < TOUCHPAD_HISTORY_LENGTH ||
+		    length > TOUCHPAD_HISTORY_MAX_LENGTH ||
+		    (length & (length - 1)) != 0) {
+			evdev_log_bug_client(device,
+					     "ignoring invalid motion history length %u\n",
+					     length);
+		} else {
+			tp->history_length = length;
+		}
+	}
+	quirks_unref(q);
 }
 
 static inline void
@@ -2839,7 +3378,7 @@ tp_init_slots(struct tp_dispatch *tp,
 		{ BTN_TOOL_DOUBLETAP, 2 },
 	};
 	struct map *m;
-	unsigned int i, n_btn_tool_touches = 1;
+	unsigned int n_btn_tool_touches = 1;
 
 	absinfo = libevdev_get_abs_info(device->evdev, ABS_MT_SLOT);
 	if (absinfo) {
@@ -2892,11 +3431,22 @@ tp_init_slots(struct tp_dispatch *tp,
 		}
 	}
 
+	if (tp->num_slots > TOUCHPAD_MAX_TOUCHES) {
+		evdev_log_info(device,
+			       "device has %u slots, only using %d\n",
+			       tp->num_slots,
+			       TOUCHPAD_MAX_TOUCHES);
+		tp->num_slots = TOUCHPAD_MAX_TOUCHES;
+	}
+
 	tp->ntouches = max(tp->num_slots, n_btn_tool_touches);
-	tp->touches = zalloc(tp->ntouches * sizeof(struct tp_touch));
+	tp->touches = arena_zalloc(&device->arena,
+				   tp->ntouches * sizeof(*tp->touches));
+	tp->touches_cold = arena_zalloc(&device->arena,
+					tp->ntouches * sizeof(*tp->touches_cold));
 
-	for (i = 0; i < tp->ntouches; i++)
-		tp_init_touch(tp, &tp->touches[i], i);
+	tp_init_history_length(tp, device);
+	tp_alloc_touches(tp, 0);
 
 	tp_sync_slots(tp, device);
 
@@ -3336,6 +3886,63 @@ tp_init_palmdetect(struct tp_dispatch *tp,
 	tp_init_palmdetect_size(tp, device);
 }
 
+static inline void
+tp_palm_add_detector(struct tp_dispatch *tp,
+		     bool (*detector)(struct tp_dispatch *tp,
+				      struct tp_touch *t,
+				      uint64_t time))
+{
+	assert(tp->palm.ndetectors < ARRAY_LENGTH(tp->palm.detectors));
+
+	tp->palm.detectors[tp->palm.ndetectors++] = detector;
+}
+
+static void
+tp_init_palmdetect_pipeline(struct tp_dispatch *tp,
+			    struct evdev_device *device)
+{
+	bool use_edge;
+
+	use_edge = tp->palm.left_edge != INT_MIN ||
+		   tp->palm.right_edge != INT_MAX ||
+		   tp->palm.upper_edge != INT_MIN;
+
+	tp->palm.ndetectors = 0;
+
+	/* The order is the priority order of the palm states: the first
+	 * detector to trigger labels the touch. This happens to also
+	 * have the cheap checks first and the edge detection with its
+	 * loop over the other touches last.
+	 *
+	 * Pressure is highest priority because it cannot be released and
+	 * overrides all other checks. So we check once before anything else
+	 * in case pressure triggers on a non-palm touch. And again after
+	 * everything in case one of the others released but we have a
+	 * pressure trigger now.
+	 *
+	 * Arbitration and dwt depend on runtime state (a paired tablet,
+	 * the dwt configuration) and are always added.
+	 */
+	if (tp->palm.use_pressure)
+		tp_palm_add_detector(tp, tp_palm_detect_pressure_triggered);
+	tp_palm_add_detector(tp, tp_palm_detect_arbitration_triggered);
+	tp_palm_add_detector(tp, tp_palm_detect_dwt_triggered);
+	if (tp->palm.monitor_trackpoint)
+		tp_palm_add_detector(tp, tp_palm_detect_trackpoint_triggered);
+	if (tp->palm.use_mt_tool)
+		tp_palm_add_detector(tp, tp_palm_detect_tool_triggered);
+	if (tp->palm.use_size)
+		tp_palm_add_detector(tp, tp_palm_detect_touch_size_triggered);
+	if (use_edge)
+		tp_palm_add_detector(tp, tp_palm_detect_edge);
+	if (tp->palm.use_pressure)
+		tp_palm_add_detector(tp, tp_palm_detect_pressure_triggered);
+
+	evdev_log_debug(device,
+			"palm: %u detectors enabled\n",
+			tp->palm.ndetectors);
+}
+
 static void
 tp_init_sendevents(struct tp_dispatch *tp,
 		   struct evdev_device *device)
@@ -3350,6 +3957,8 @@ tp_init_sendevents(struct tp_dispatch *tp,
 			    tp_libinput_context(tp),
 			    timer_name,
 			    tp_trackpoint_timeout, tp);
+	libinput_timer_set_slack(&tp->palm.trackpoint_timer,
+				 DEFAULT_ACTIVITY_TIMEOUT_SLACK);
 
 	snprintf(timer_name,
 		 sizeof(timer_name),
@@ -3359,6 +3968,8 @@ tp_init_sendevents(struct tp_dispatch *tp,
 			    tp_libinput_context(tp),
 			    timer_name,
 			    tp_keyboard_timeout, tp);
+	libinput_timer_set_slack(&tp->dwt.keyboard_timer,
+				 DEFAULT_ACTIVITY_TIMEOUT_SLACK);
 }
 
 static bool
@@ -3445,6 +4056,61 @@ tp_init_hysteresis(struct tp_dispatch *tp)
 				HTTP_DOC_LINK);
 }
 
+static int
+tp_low_latency_config_is_available(struct libinput_device *device)
+{
+	return 1;
+}
+
+static enum libinput_config_status
+tp_low_latency_config_set(struct libinput_device *device,
+			  enum libinput_config_low_latency_state enable)
+{
+	struct evdev_device *evdev = evdev_device(device);
+	struct tp_dispatch *tp = (struct tp_dispatch*)evdev->dispatch;
+
+	switch(enable) {
+	case LIBINPUT_CONFIG_LOW_LATENCY_ENABLED:
+	case LIBINPUT_CONFIG_LOW_LATENCY_DISABLED:
+		break;
+	default:
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+	}
+
+	tp->low_latency.enabled = (enable == LIBINPUT_CONFIG_LOW_LATENCY_ENABLED);
+
+	return LIBINPUT_CONFIG_STATUS_SUCCESS;
+}
+
+static enum libinput_config_low_latency_state
+tp_low_latency_config_get(struct libinput_device *device)
+{
+	struct evdev_device *evdev = evdev_device(device);
+	struct tp_dispatch *tp = (struct tp_dispatch*)evdev->dispatch;
+
+	return tp->low_latency.enabled ?
+		LIBINPUT_CONFIG_LOW_LATENCY_ENABLED :
+		LIBINPUT_CONFIG_LOW_LATENCY_DISABLED;
+}
+
+static enum libinput_config_low_latency_state
+tp_low_latency_config_get_default(struct libinput_device *device)
+{
+	return LIBINPUT_CONFIG_LOW_LATENCY_DISABLED;
+}
+
+static void
+tp_init_low_latency(struct tp_dispatch *tp,
+		    struct evdev_device *device)
+{
+	tp->low_latency.config.is_available = tp_low_latency_config_is_available;
+	tp->low_latency.config.set_enabled = tp_low_latency_config_set;
+	tp->low_latency.config.get_enabled = tp_low_latency_config_get;
+	tp->low_latency.config.get_default_enabled = tp_low_latency_config_get_default;
+	tp->low_latency.enabled = false;
+	device->base.config.low_latency = &tp->low_latency.config;
+}
+
 static void
 tp_init_pressure(struct tp_dispatch *tp,
 		 struct evdev_device *device)
@@ -3590,6 +4256,7 @@ tp_init(struct tp_dispatch *tp,
 	device->dpi = device->abs.absinfo_x->resolution * 25.4;
 
 	tp_init_hysteresis(tp);
+	tp_init_low_latency(tp, device);
 
 	if (!tp_init_accel(tp))
 		return false;
@@ -3598,10 +4265,12 @@ tp_init(struct tp_dispatch *tp,
 	tp_init_buttons(tp, device);
 	tp_init_dwt(tp, device);
 	tp_init_palmdetect(tp, device);
+	tp_init_palmdetect_pipeline(tp, device);
 	tp_init_sendevents(tp, device);
 	tp_init_scroll(tp, device);
 	tp_init_gesture(tp);
 	tp_init_thumb(tp);
+	tp_regions_update(tp);
 
 	device->seat_caps |= EVDEV_DEVICE_POINTER;
 	if (tp->gesture.enabled)
@@ -3788,7 +4457,7 @@ evdev_mt_touchpad_create(struct evdev_device *device)
 
 	evdev_tag_touchpad(device, device->udev_device);
 
-	tp = zalloc(sizeof *tp);
+	tp = mem_zalloc(sizeof *tp);
 
 	if (!tp_init(tp, device)) {
 		tp_interface_destroy(&tp->base);
@@ -29,8 +29,19 @@
 #include "evdev.h"
 #include "timer.h"
 
-#define TOUCHPAD_HISTORY_LENGTH 4
+#define TOUCHPAD_HISTORY_LENGTH 4 /* default, see AttrTouchpadHistoryLength */
+#define TOUCHPAD_HISTORY_MAX_LENGTH 16
 #define TOUCHPAD_MIN_SAMPLES 4
+/* tp_dispatch.active_touches has one bit per touch */
+#define TOUCHPAD_MAX_TOUCHES 64
+/* touch storage is allocated this many touches at a time */
+#define TOUCHPAD_TOUCH_CHUNK 8
+
+/* pressure, arbitration, dwt, trackpoint, tool, size, edge, pressure */
+#define TP_PALM_MAX_DETECTORS 8
+#define TAP_TRACE_LENGTH 16
+/* Cells per axis in the precomputed region map */
+#define TP_REGION_GRID_SIZE 32
 
 /* Convert mm to a distance normalized to DEFAULT_MOUSE_DPI */
 #define TP_MM_TO_DPI_NORMALIZED(mm) (DEFAULT_MOUSE_DPI/25.4 * mm)
@@ -119,6 +130,30 @@ enum tp_edge {
 	EDGE_BOTTOM	= bit(1),
 };
 
+/* The regions a position falls into, see tp_regions_update() */
+enum tp_region {
+	TP_REGION_NONE		= 0,
+	TP_REGION_BOTTOM_LEFT	= bit(0),
+	TP_REGION_BOTTOM_MIDDLE	= bit(1),
+	TP_REGION_BOTTOM_RIGHT	= bit(2),
+	TP_REGION_TOP_LEFT	= bit(3),
+	TP_REGION_TOP_MIDDLE	= bit(4),
+	TP_REGION_TOP_RIGHT	= bit(5),
+	TP_REGION_EDGE_RIGHT	= bit(6),
+	TP_REGION_EDGE_BOTTOM	= bit(7),
+	TP_REGION_PALM_SIDE	= bit(8),
+	TP_REGION_PALM_TOP	= bit(9),
+
+	/* A region boundary runs through this grid cell, only used
+	 * inside the region map */
+	TP_REGION_SPLIT		= bit(15),
+};
+
+#define TP_REGION_BOTTOM_AREA \
+	(TP_REGION_BOTTOM_LEFT|TP_REGION_BOTTOM_MIDDLE|TP_REGION_BOTTOM_RIGHT)
+#define TP_REGION_TOP_AREA \
+	(TP_REGION_TOP_LEFT|TP_REGION_TOP_MIDDLE|TP_REGION_TOP_RIGHT)
+
 enum tp_edge_scroll_touch_state {
 	EDGE_SCROLL_TOUCH_STATE_NONE,
 	EDGE_SCROLL_TOUCH_STATE_EDGE_NEW,
@@ -156,6 +191,7 @@ struct tp_touch {
 	enum touch_state state;
 	bool has_ended;				/* TRACKING_ID == -1 */
 	bool dirty;
+	bool contact_dirty; /* pressure, size or tool type changed */
 	struct device_coords point;
 	uint64_t time;
 	int pressure;
@@ -178,7 +214,7 @@ struct tp_touch {
 		struct tp_history_point {
 			uint64_t time;
 			struct device_coords point;
-		} samples[TOUCHPAD_HISTORY_LENGTH];
+		} *samples;		/* len == tp->history_length */
 		unsigned int index;
 		unsigned int count;
 	} history;
@@ -194,27 +230,24 @@ struct tp_touch {
 
 	/* A pinned touchpoint is the one that pressed the physical button
 	 * on a clickpad. After the release, it won't move until the center
-	 * moves more than a threshold away from the original coordinates
+	 * moves more than a threshold away from the original coordinates,
+	 * see tp_touch_cold.pinned.
 	 */
 	struct {
 		bool is_pinned;
-		struct device_coords center;
 	} pinned;
 
-	/* Software-button state and timeout if applicable */
+	/* Software-button state, see tp_touch_cold.button for the
+	 * timeout */
 	struct {
 		enum button_state state;
 		/* We use button_event here so we can use == on events */
 		enum button_event current;
-		struct libinput_timer timer;
-		struct device_coords initial;
 		bool has_moved; /* has moved more than threshold */
-		uint64_t initial_time;
 	} button;
 
 	struct {
 		enum tp_tap_touch_state state;
-		struct device_coords initial;
 		bool is_thumb;
 		bool is_palm;
 	} tap;
@@ -223,26 +256,54 @@ struct tp_touch {
 		enum tp_edge_scroll_touch_state edge_state;
 		uint32_t edge;
 		int direction;
-		struct libinput_timer timer;
-		struct device_coords initial;
 	} scroll;
 
 	struct {
 		enum touch_palm_state state;
-		struct device_coords first; /* first coordinates if is_palm == true */
 		uint64_t time; /* first timestamp if is_palm == true */
 	} palm;
 
-	struct {
-		struct device_coords initial;
-	} gesture;
-
 	struct {
 		double last_speed; /* speed in mm/s at last sample */
 		unsigned int exceeded_count;
 	} speed;
 };
 
+/* The parts of a touch that are only needed on state transitions, kept
+ * out of struct tp_touch so the per-frame loops over the touches don't
+ * have to stride over them. Indexed like tp->touches, use
+ * tp_touch_cold() to get a touch's entry.
+ */
+struct tp_touch_cold {
+	struct {
+		struct device_coords center;
+	} pinned;
+
+	struct {
+		struct libinput_timer timer;
+		uint64_t timer_start; /* when the enter/leave timer was set */
+		struct device_coords initial;
+		uint64_t initial_time;
+	} button;
+
+	struct {
+		struct device_coords initial;
+	} tap;
+
+	struct {
+		uint64_t timeout; /* edge scroll lock deadline, 0 if none */
+		struct device_coords initial;
+	} scroll;
+
+	struct {
+		struct device_coords first; /* first coordinates if is_palm == true */
+	} palm;
+
+	struct {
+		struct device_coords initial;
+	} gesture;
+};
+
 enum suspend_trigger {
 	SUSPEND_NO_FLAG         = 0x0,
 	SUSPEND_EXTERNAL_MOUSE  = 0x1,
@@ -266,12 +327,23 @@ struct tp_dispatch {
 	struct {
 		enum evdev_arbitration_state state;
 		struct libinput_timer arbitration_timer;
+		uint64_t release_time; /* when the tool left proximity */
 	} arbitration;
 
 	unsigned int nactive_slots;		/* number of active slots */
 	unsigned int num_slots;			/* number of slots */
 	unsigned int ntouches;			/* no slots inc. fakes */
-	struct tp_touch *touches;		/* len == ntouches */
+	/* The touches are allocated TOUCHPAD_TOUCH_CHUNK at a time when a
+	 * slot in the chunk is first used, the first chunk always exists.
+	 * touches[n] and touches_cold[n] are NULL for
+	 * n >= ntouches_allocated, those touches are in TOUCH_NONE.
+	 */
+	unsigned int ntouches_allocated;
+	struct tp_touch **touches;		/* len == ntouches */
+	struct tp_touch_cold **touches_cold;	/* len == ntouches */
+	unsigned int history_length;		/* power of two */
+	/* bit n set if touches[n] is dirty or not in TOUCH_NONE */
+	uint64_t active_touches;
 	/* bit 0: BTN_TOUCH
 	 * bit 1: BTN_TOOL_FINGER
 	 * bit 2: BTN_TOOL_DOUBLETAP
@@ -303,12 +375,22 @@ struct tp_dispatch {
 	} touch_size;
 
 	struct {
-		bool enabled;
+		bool enabled;		/* fuzz set or jitter detected */
+		bool jitter_detected;
 		struct device_coords margin;
 		unsigned int other_event_count;
 		uint64_t last_motion_time;
 	} hysteresis;
 
+	struct {
+		struct libinput_device_config_low_latency config;
+		bool enabled;
+
+		/* for the first motion latency statistics */
+		uint64_t touch_time;
+		bool first_motion_pending;
+	} low_latency;
+
 	struct {
 		double x_scale_coeff;
 		double y_scale_coeff;
@@ -320,6 +402,7 @@ struct tp_dispatch {
 		bool started;
 		unsigned int finger_count;
 		unsigned int finger_count_pending;
+		uint64_t finger_count_pending_time;
 		struct libinput_timer finger_count_switch_timer;
 		enum tp_gesture_state state;
 		struct tp_touch *touches[2];
@@ -328,6 +411,15 @@ struct tp_dispatch {
 		double prev_scale;
 		double angle;
 		struct device_float_coords center;
+
+		/* Squared movement of touches[0] and [1] since the gesture
+		 * start in mm² and their distance in mm, updated only when
+		 * a touch changes while the gesture is undecided */
+		struct {
+			bool valid;
+			double moved_mm2[2];
+			struct phys_coords distance_mm;
+		} unknown;
 	} gesture;
 
 	struct {
@@ -363,6 +455,8 @@ struct tp_dispatch {
 		struct evdev_device *trackpoint;
 
 		enum libinput_config_click_method click_method;
+		/* differs from click_method during a config transaction */
+		enum libinput_config_click_method want_click_method;
 		struct libinput_device_config_click_method config_method;
 	} buttons;
 
@@ -371,6 +465,8 @@ struct tp_dispatch {
 		enum libinput_config_scroll_method method;
 		int32_t right_edge;		/* in device coordinates */
 		int32_t bottom_edge;		/* in device coordinates */
+		/* armed for the earliest touch scroll.timeout */
+		struct libinput_timer edge_timer;
 		struct {
 			bool h, v;
 		} active;
@@ -381,11 +477,23 @@ struct tp_dispatch {
 		} duration;
 	} scroll;
 
+	/* The button areas, scroll edges and palm edges compiled into a
+	 * coarse grid so a position is classified with a single lookup.
+	 * Cells crossed by a region boundary are marked TP_REGION_SPLIT
+	 * and classified exactly instead. */
+	struct {
+		struct device_coords origin;
+		unsigned int shift_x, shift_y; /* log2 of the cell size */
+		uint16_t cells[TP_REGION_GRID_SIZE][TP_REGION_GRID_SIZE];
+	} regions;
+
 	enum touchpad_event queued;
 
 	struct {
 		struct libinput_device_config_tap config;
 		bool enabled;
+		bool want_enabled; /* differs from enabled during a config
+				      transaction */
 		bool suspended;
 		struct libinput_timer timer;
 		enum tp_tap_state state;
@@ -398,8 +506,23 @@ struct tp_dispatch {
 
 		bool drag_enabled;
 		bool drag_lock_enabled;
+		bool early_commit_enabled;
 
 		unsigned int nfingers_down;	/* number of fingers down for tapping (excl. thumb/palm) */
+
+		/* The most recent tap events, logged when the state
+		 * machine sees an invalid event */
+		struct {
+			struct tp_tap_trace_entry {
+				uint64_t time;
+				int touch;	/* touch index or -1 */
+				uint8_t from;	/* enum tp_tap_state */
+				uint8_t event;	/* enum tap_event */
+				uint8_t to;	/* enum tp_tap_state */
+			} entries[TAP_TRACE_LENGTH];
+			unsigned int index;
+			unsigned int count;
+		} trace;
 	} tap;
 
 	struct {
@@ -411,6 +534,7 @@ struct tp_dispatch {
 		struct libinput_event_listener trackpoint_listener;
 		struct libinput_timer trackpoint_timer;
 		uint64_t trackpoint_last_event_time;
+		uint64_t trackpoint_timeout;
 		uint32_t trackpoint_event_count;
 		bool monitor_trackpoint;
 
@@ -421,6 +545,13 @@ struct tp_dispatch {
 
 		bool use_size;
 		int size_threshold;
+
+		/* The palm detectors this device uses, in the order they
+		 * run. A detector returning true ends the pipeline */
+		bool (*detectors[TP_PALM_MAX_DETECTORS])(struct tp_dispatch *tp,
+							 struct tp_touch *t,
+							 uint64_t time);
+		unsigned int ndetectors;
 	} palm;
 
 	struct {
@@ -444,6 +575,9 @@ struct tp_dispatch {
 		bool keyboard_active;
 		struct libinput_timer keyboard_timer;
 		uint64_t keyboard_last_press_time;
+		/* when typing is considered to have stopped. The timer may
+		 * be armed for an earlier time, see tp_keyboard_timeout() */
+		uint64_t keyboard_timeout;
 	} dwt;
 
 	struct {
@@ -456,6 +590,9 @@ struct tp_dispatch {
 
 		bool use_size;
 		int size_threshold;
+		/* a thumb's minor axis must be below this, precomputed
+		 * from size_threshold */
+		int size_minor_threshold;
 
 		enum tp_thumb_state state;
 		unsigned int index;
@@ -508,7 +645,85 @@ tp_dispatch(struct evdev_dispatch *dispatch)
 }
 
 #define tp_for_each_touch(_tp, _t) \
-	for (unsigned int _i = 0; _i < (_tp)->ntouches && (_t = &(_tp)->touches[_i]); _i++)
+	for (unsigned int _i = 0; _i < (_tp)->ntouches_allocated && (_t = (_tp)->touches[_i]); _i++)
+
+/* Iterates over the touches in active_touches only. The mask is read
+ * once, touches that become active during the loop are skipped */
+#define tp_for_each_active_touch(_tp, _t) \
+	for (uint64_t _m = (_tp)->active_touches; \
+	     _m && (_t = (_tp)->touches[__builtin_ctzll(_m)]); \
+	     _m &= _m - 1)
+
+uint32_t
+tp_regions_classify(const struct tp_dispatch *tp,
+		    const struct device_coords *point);
+
+void
+tp_regions_update(struct tp_dispatch *tp);
+
+static inline uint32_t
+tp_regions_for_point(const struct tp_dispatch *tp,
+		     const struct device_coords *point)
+{
+	int x = point->x - tp->regions.origin.x;
+	int y = point->y - tp->regions.origin.y;
+	unsigned int col, row;
+	uint16_t regions;
+
+	if (x < 0 || y < 0)
+		return tp_regions_classify(tp, point);
+
+	col = (unsigned int)x >> tp->regions.shift_x;
+	row = (unsigned int)y >> tp->regions.shift_y;
+	if (col >= TP_REGION_GRID_SIZE || row >= TP_REGION_GRID_SIZE)
+		return tp_regions_classify(tp, point);
+
+	regions = tp->regions.cells[row][col];
+	if (regions & TP_REGION_SPLIT)
+		return tp_regions_classify(tp, point);
+
+	return regions;
+}
+
+static inline uint32_t
+tp_touch_get_regions(const struct tp_dispatch *tp, const struct tp_touch *t)
+{
+	return tp_regions_for_point(tp, &t->point);
+}
+
+static inline void
+tp_low_latency_record_first_motion(struct tp_dispatch *tp, uint64_t time)
+{
+	struct libinput_device *device = &tp->device->base;
+
+	if (!tp->low_latency.first_motion_pending)
+		return;
+
+	tp->low_latency.first_motion_pending = false;
+	if (device->latency_tracking)
+		histogram_add(&device->first_motion_latency,
+			      time - tp->low_latency.touch_time);
+}
+
+static inline struct tp_touch_cold *
+tp_touch_cold(const struct tp_touch *t)
+{
+	return t->tp->touches_cold[t->index];
+}
+
+static inline void
+tp_touch_mark_dirty(struct tp_touch *t)
+{
+	t->dirty = true;
+	t->tp->active_touches |= (uint64_t)1 << t->index;
+}
+
+static inline void
+tp_touch_mark_contact_dirty(struct tp_touch *t)
+{
+	t->contact_dirty = true;
+	tp_touch_mark_dirty(t);
+}
 
 static inline struct libinput*
 tp_libinput_context(const struct tp_dispatch *tp)
@@ -569,6 +784,12 @@ tp_filter_motion_unaccelerated(struct tp_dispatch *tp,
 			       const struct device_float_coords *unaccelerated,
 			       uint64_t time);
 
+struct normalized_coords
+tp_filter_motion_with_unaccel(struct tp_dispatch *tp,
+			      const struct device_float_coords *unaccelerated,
+			      struct normalized_coords *unaccel_out,
+			      uint64_t time);
+
 bool
 tp_touch_active(const struct tp_dispatch *tp, const struct tp_touch *t);
 
@@ -588,9 +809,15 @@ tp_init_tap(struct tp_dispatch *tp);
 void
 tp_remove_tap(struct tp_dispatch *tp);
 
+void
+tp_tap_config_commit(struct tp_dispatch *tp, uint64_t time);
+
 void
 tp_init_buttons(struct tp_dispatch *tp, struct evdev_device *device);
 
+void
+tp_button_config_commit(struct tp_dispatch *tp);
+
 void
 tp_init_top_softbuttons(struct tp_dispatch *tp,
 			struct evdev_device *device,
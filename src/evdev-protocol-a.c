@@ -0,0 +1,352 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "config.h"
+
+#include "evdev-fallback.h"
+
+/* Protocol A devices don't have slots, every frame is a list of contacts
+ * separated by SYN_MT_REPORT:
+
+     ABS_MT_POSITION_X 100
+     ABS_MT_POSITION_Y 200
+     SYN_MT_REPORT
+     ABS_MT_POSITION_X 300
+     ABS_MT_POSITION_Y 400
+     SYN_MT_REPORT
+     SYN_REPORT
+
+   The contacts are collected until the SYN_REPORT and then assigned to
+   the slots that were active in the previous frame. Devices that send
+   ABS_MT_TRACKING_ID give us the assignment directly, otherwise each
+   contact goes to the nearest remaining slot. Slots left without a
+   contact end, contacts left without a slot begin a new one. The slots
+   then look exactly like the ones filled by a protocol B device and the
+   rest of the fallback dispatch doesn't know the difference.
+ */
+
+static inline void
+protocol_a_reset_contact(struct mt_contact *contact)
+{
+	contact->point.x = 0;
+	contact->point.y = 0;
+	contact->tracking_id = -1;
+	contact->tool_type = MT_TOOL_FINGER;
+}
+
+static inline void
+protocol_a_end_contact(struct fallback_dispatch *dispatch,
+		       struct evdev_device *device)
+{
+	if (!dispatch->mt.protocol_a.current_valid)
+		return;
+
+	if (dispatch->mt.protocol_a.ncontacts >= dispatch->mt.slots_len) {
+		evdev_log_bug_libinput(device,
+				       "exceeded contact count (max %zd)\n",
+				       dispatch->mt.slots_len);
+	} else {
+		size_t idx = dispatch->mt.protocol_a.ncontacts++;
+		dispatch->mt.protocol_a.contacts[idx] =
+			dispatch->mt.protocol_a.current;
+	}
+
+	protocol_a_reset_contact(&dispatch->mt.protocol_a.current);
+	dispatch->mt.protocol_a.current_valid = false;
+}
+
+static inline uint64_t
+protocol_a_dist2(const struct device_coords *a,
+		 const struct device_coords *b)
+{
+	int64_t dx = (int64_t)a->x - b->x,
+		dy = (int64_t)a->y - b->y;
+
+	return dx * dx + dy * dy;
+}
+
+static int
+protocol_a_match_cmp(const void *a, const void *b)
+{
+	const struct mt_contact_match *ma = a,
+				      *mb = b;
+
+	if (ma->dist2 < mb->dist2)
+		return -1;
+	if (ma->dist2 > mb->dist2)
+		return 1;
+	return 0;
+}
+
+static void
+protocol_a_update_slot(struct fallback_dispatch *dispatch,
+		       size_t slot_idx,
+		       const struct mt_contact *contact)
+{
+	struct mt_slot *slot = &dispatch->mt.slots[slot_idx];
+	bool dirty = false;
+
+	if (slot->point.x != contact->point.x ||
+	    slot->point.y != contact->point.y) {
+		slot->point = contact->point;
+		dirty = true;
+	}
+
+	/* Same palm transitions as for a protocol B ABS_MT_TOOL_TYPE */
+	switch (contact->tool_type) {
+	case MT_TOOL_PALM:
+		if (slot->palm_state == PALM_NONE) {
+			slot->palm_state = PALM_NEW;
+			dirty = true;
+		}
+		break;
+	default:
+		if (slot->palm_state == PALM_IS_PALM) {
+			slot->palm_state = PALM_WAS_PALM;
+			dirty = true;
+		}
+		break;
+	}
+
+	dispatch->mt.protocol_a.tracking_ids[slot_idx] = contact->tracking_id;
+
+	if (dirty) {
+		dispatch->pending_event |= EVDEV_ABSOLUTE_MT;
+		long_set_bit(dispatch->mt.dirty_slots, slot_idx);
+	}
+}
+
+static void
+protocol_a_begin_slot(struct fallback_dispatch *dispatch,
+		      size_t slot_idx,
+		      const struct mt_contact *contact)
+{
+	struct mt_slot *slot = &dispatch->mt.slots[slot_idx];
+
+	slot->state = SLOT_STATE_BEGIN;
+	slot->point = contact->point;
+	/* new touch, no cancel needed */
+	slot->palm_state = contact->tool_type == MT_TOOL_PALM ?
+				PALM_WAS_PALM : PALM_NONE;
+	dispatch->mt.protocol_a.tracking_ids[slot_idx] = contact->tracking_id;
+
+	dispatch->pending_event |= EVDEV_ABSOLUTE_MT;
+	long_set_bit(dispatch->mt.dirty_slots, slot_idx);
+}
+
+static void
+protocol_a_end_slot(struct fallback_dispatch *dispatch,
+		    size_t slot_idx)
+{
+	dispatch->mt.slots[slot_idx].state = SLOT_STATE_END;
+	dispatch->mt.protocol_a.tracking_ids[slot_idx] = -1;
+
+	dispatch->pending_event |= EVDEV_ABSOLUTE_MT;
+	long_set_bit(dispatch->mt.dirty_slots, slot_idx);
+}
+
+static void
+protocol_a_assign_slots(struct fallback_dispatch *dispatch)
+{
+	struct mt_contact *contacts = dispatch->mt.protocol_a.contacts;
+	struct mt_contact_match *matches = dispatch->mt.protocol_a.matches;
+	int32_t *tracking_ids = dispatch->mt.protocol_a.tracking_ids;
+	size_t ncontacts = dispatch->mt.protocol_a.ncontacts;
+	size_t nslots = dispatch->mt.slots_len;
+	size_t nmatches = 0;
+	/* slots_len is capped at 32 in fallback_init_protocol_a */
+	uint32_t slot_matched = 0,
+		 slot_active = 0,
+		 contact_matched = 0;
+
+	for (size_t s = 0; s < nslots; s++) {
+		if (dispatch->mt.slots[s].state == SLOT_STATE_UPDATE)
+			slot_active |= bit(s);
+	}
+
+	/* Tracking ids are authoritative where we have them */
+	for (size_t c = 0; c < ncontacts; c++) {
+		if (contacts[c].tracking_id < 0)
+			continue;
+
+		for (size_t s = 0; s < nslots; s++) {
+			if (!(slot_active & bit(s)) || (slot_matched & bit(s)))
+				continue;
+			if (tracking_ids[s] != contacts[c].tracking_id)
+				continue;
+
+			protocol_a_update_slot(dispatch, s, &contacts[c]);
+			slot_matched |= bit(s);
+			contact_matched |= bit(c);
+			break;
+		}
+	}
+
+	/* Everything else: shortest distance first. For the handful of
+	 * contacts a touchscreen has, this greedy match is the same as
+	 * the optimal one unless two fingers cross within one frame.
+	 * A contact with a tracking id that didn't match is a new touch
+	 * and a slot with a tracking id that didn't match has ended,
+	 * neither takes part in this pass */
+	for (size_t c = 0; c < ncontacts; c++) {
+		if ((contact_matched & bit(c)) || contacts[c].tracking_id >= 0)
+			continue;
+
+		for (size_t s = 0; s < nslots; s++) {
+			if (!(slot_active & bit(s)) || (slot_matched & bit(s)))
+				continue;
+			if (tracking_ids[s] >= 0)
+				continue;
+
+			matches[nmatches].dist2 =
+				protocol_a_dist2(&contacts[c].point,
+						 &dispatch->mt.slots[s].point);
+			matches[nmatches].contact = c;
+			matches[nmatches].slot = s;
+			nmatches++;
+		}
+	}
+
+	if (nmatches > 1)
+		qsort(matches, nmatches, sizeof(*matches), protocol_a_match_cmp);
+
+	for (size_t m = 0; m < nmatches; m++) {
+		size_t c = matches[m].contact,
+		       s = matches[m].slot;
+
+		if ((contact_matched & bit(c)) || (slot_matched & bit(s)))
+			continue;
+
+		protocol_a_update_slot(dispatch, s, &contacts[c]);
+		slot_matched |= bit(s);
+		contact_matched |= bit(c);
+	}
+
+	for (size_t s = 0; s < nslots; s++) {
+		if ((slot_active & bit(s)) && !(slot_matched & bit(s)))
+			protocol_a_end_slot(dispatch, s);
+	}
+
+	for (size_t c = 0; c < ncontacts; c++) {
+		size_t s;
+
+		if (contact_matched & bit(c))
+			continue;
+
+		for (s = 0; s < nslots; s++) {
+			if (dispatch->mt.slots[s].state == SLOT_STATE_NONE &&
+			    !(slot_matched & bit(s)))
+				break;
+		}
+
+		/* Can't happen, ncontacts is capped to the slot count */
+		if (s == nslots)
+			break;
+
+		protocol_a_begin_slot(dispatch, s, &contacts[c]);
+		slot_matched |= bit(s);
+	}
+
+	dispatch->mt.protocol_a.ncontacts = 0;
+}
+
+void
+fallback_protocol_a_process(struct fallback_dispatch *dispatch,
+			    struct evdev_device *device,
+			    struct input_event *e,
+			    uint64_t time)
+{
+	struct mt_contact *current = &dispatch->mt.protocol_a.current;
+
+	switch (e->type) {
+	case EV_ABS:
+		switch (e->code) {
+		case ABS_MT_POSITION_X:
+			evdev_device_check_abs_axis_range(device,
+							  e->code,
+							  e->value,
+							  time);
+			current->point.x = e->value;
+			break;
+		case ABS_MT_POSITION_Y:
+			evdev_device_check_abs_axis_range(device,
+							  e->code,
+							  e->value,
+							  time);
+			current->point.y = e->value;
+			break;
+		case ABS_MT_TRACKING_ID:
+			current->tracking_id = e->value;
+			break;
+		case ABS_MT_TOOL_TYPE:
+			current->tool_type = e->value;
+			break;
+		default:
+			return;
+		}
+		dispatch->mt.protocol_a.current_valid = true;
+		break;
+	case EV_SYN:
+		switch (e->code) {
+		case SYN_MT_REPORT:
+			protocol_a_end_contact(dispatch, device);
+			break;
+		case SYN_REPORT:
+			/* Some devices skip the SYN_MT_REPORT for the
+			 * last contact */
+			protocol_a_end_contact(dispatch, device);
+			protocol_a_assign_slots(dispatch);
+			break;
+		}
+		break;
+	}
+}
+
+void
+fallback_init_protocol_a(struct fallback_dispatch *dispatch,
+			 struct evdev_device *device)
+{
+	size_t nslots = dispatch->mt.slots_len;
+
+	assert(nslots <= 32);
+
+	dispatch->mt.protocol_a.enabled = true;
+	dispatch->mt.protocol_a.contacts =
+		arena_zalloc(&device->arena,
+			     nslots * sizeof(*dispatch->mt.protocol_a.contacts));
+	dispatch->mt.protocol_a.matches =
+		arena_zalloc(&device->arena,
+			     nslots * nslots *
+			     sizeof(*dispatch->mt.protocol_a.matches));
+	dispatch->mt.protocol_a.tracking_ids =
+		arena_zalloc(&device->arena,
+			     nslots * sizeof(*dispatch->mt.protocol_a.tracking_ids));
+
+	for (size_t s = 0; s < nslots; s++)
+		dispatch->mt.protocol_a.tracking_ids[s] = -1;
+
+	protocol_a_reset_contact(&dispatch->mt.protocol_a.current);
+	dispatch->mt.protocol_a.current_valid = false;
+	dispatch->mt.protocol_a.ncontacts = 0;
+}
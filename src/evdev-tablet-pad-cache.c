@@ -0,0 +1,103 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include "libinput-private.h"
+
+#if HAVE_LIBWACOM
+/**
+ * Look up the pad description for the pad whose input device is at
+ * syspath. The syspath only changes when the pad is unplugged, so a pad
+ * that is re-added, e.g. after a resume, finds its description again
+ * without a libwacom lookup and without walking sysfs for the LEDs.
+ * Returns NULL if the pad isn't cached.
+ */
+const struct libinput_libwacom_pad *
+libinput_libwacom_get_pad(struct libinput *li,
+			  const char *syspath,
+			  int vendor,
+			  int product)
+{
+	struct libinput_libwacom *libwacom = li->libwacom;
+	struct libinput_libwacom_pad *pad;
+
+	if (!libwacom->db)
+		return NULL;
+
+	ARRAY_FOR_EACH(libwacom->pads, pad) {
+		if (pad->syspath &&
+		    pad->vendor == vendor &&
+		    pad->product == product &&
+		    streq(pad->syspath, syspath))
+			return pad;
+	}
+
+	return NULL;
+}
+
+static void
+libinput_libwacom_pad_clear(struct libinput_libwacom_pad *pad)
+{
+	free(pad->syspath);
+	free(pad->led_base);
+	*pad = (struct libinput_libwacom_pad) { .syspath = NULL };
+}
+
+/**
+ * Return a zeroed pad description for the caller to fill in. Once the
+ * cache is full, the oldest entry is replaced, these usually belong to
+ * pads that were unplugged.
+ */
+struct libinput_libwacom_pad *
+libinput_libwacom_add_pad(struct libinput *li,
+			  const char *syspath,
+			  int vendor,
+			  int product)
+{
+	struct libinput_libwacom *libwacom = li->libwacom;
+	struct libinput_libwacom_pad *pad;
+
+	assert(libwacom->db);
+
+	pad = &libwacom->pads[libwacom->next_pad];
+	libwacom->next_pad = (libwacom->next_pad + 1) % LIBWACOM_PADS_MAX;
+
+	libinput_libwacom_pad_clear(pad);
+	pad->syspath = safe_strdup(syspath);
+	pad->vendor = vendor;
+	pad->product = product;
+
+	return pad;
+}
+
+void
+libinput_libwacom_release_pads(struct libinput_libwacom *libwacom)
+{
+	struct libinput_libwacom_pad *pad;
+
+	ARRAY_FOR_EACH(libwacom->pads, pad)
+		libinput_libwacom_pad_clear(pad);
+	libwacom->next_pad = 0;
+}
+#endif
@@ -71,28 +71,56 @@ pad_mode_toggle_button_destroy(struct pad_mode_toggle_button* button)
 }
 
 static inline int
-pad_led_group_get_mode(struct pad_led_group *group)
+pad_led_is_lit(struct pad_mode_led *led)
 {
 	char buf[4] = {0};
 	int rc;
 	unsigned int brightness;
+
+	/* One syscall per LED, sysfs can be slow */
+	rc = pread(led->brightness_fd, buf, sizeof(buf) - 1, 0);
+	if (rc == -1)
+		return -errno;
+
+	rc = sscanf(buf, "%u\n", &brightness);
+	if (rc != 1)
+		return -EINVAL;
+
+	return brightness != 0;
+}
+
+/**
+ * Returns the mode of the lit LED. The LED for expected_mode is read
+ * first, a toggle button usually cycles to the next mode so this is
+ * the only sysfs read in the common case. Pass -1 to scan all LEDs.
+ */
+static inline int
+pad_led_group_get_mode(struct pad_led_group *group, int expected_mode)
+{
+	int rc;
 	struct pad_mode_led *led;
 
-	list_for_each(led, &group->led_list, link) {
-		rc = lseek(led->brightness_fd, 0, SEEK_SET);
-		if (rc == -1)
-			return -errno;
+	if (expected_mode >= 0) {
+		list_for_each(led, &group->led_list, link) {
+			if (led->mode_idx != expected_mode)
+				continue;
 
-		rc = read(led->brightness_fd, buf, sizeof(buf) - 1);
-		if (rc == -1)
-			return -errno;
+			if (pad_led_is_lit(led) == 1)
+				return led->mode_idx;
+			break;
+		}
+	}
+
+	list_for_each(led, &group->led_list, link) {
+		if (led->mode_idx == expected_mode)
+			continue;
 
-		rc = sscanf(buf, "%u\n", &brightness);
-		if (rc != 1)
-			return -EINVAL;
+		rc = pad_led_is_lit(led);
+		if (rc < 0)
+			return rc;
 
 		/* Assumption: only one LED lit up at any time */
-		if (brightness != 0)
+		if (rc)
 			return led->mode_idx;
 	}
 
@@ -186,8 +214,7 @@ pad_group_new_basic(struct pad_dispatch *pad,
 static inline bool
 is_litest_device(struct evdev_device *device)
 {
-	return !!udev_device_get_property_value(device->udev_device,
-						"LIBINPUT_TEST_DEVICE");
+	return !!(device->udev_props.present & EVDEV_UDEV_PROP_TEST_DEVICE);
 }
 
 static inline struct pad_led_group *
@@ -214,7 +241,7 @@ pad_group_new(struct pad_dispatch *pad,
 		list_insert(&group->led_list, &led->link);
 	}
 
-	rc = pad_led_group_get_mode(group);
+	rc = pad_led_group_get_mode(group, -1);
 	if (rc < 0) {
 		errno = -rc;
 		goto error;
@@ -247,8 +274,7 @@ pad_led_get_sysfs_base_path(struct evdev_device *device,
 
 	/* For testing purposes only allow for a base path set through a
 	 * udev rule. We still expect the normal directory hierarchy inside */
-	test_path = udev_device_get_property_value(udev_device,
-						   "LIBINPUT_TEST_TABLET_PAD_SYSFS_PATH");
+	test_path = device->udev_props.tablet_pad_sysfs_path;
 	if (test_path) {
 		rc = snprintf(path_out, path_out_sz, "%s", test_path);
 		return rc != -1;
@@ -269,86 +295,74 @@ pad_led_get_sysfs_base_path(struct evdev_device *device,
 	return rc != -1;
 }
 
+static inline struct libinput_tablet_pad_mode_group *
+pad_get_mode_group(struct pad_dispatch *pad, unsigned int index)
+{
+	struct libinput_tablet_pad_mode_group *group;
+
+	list_for_each(group, &pad->modes.mode_group_list, link) {
+		if (group->index == index)
+			return group;
+	}
+
+	return NULL;
+}
+
 #if HAVE_LIBWACOM
-static int
-pad_init_led_groups(struct pad_dispatch *pad,
-		    struct evdev_device *device,
-		    WacomDevice *wacom)
+static bool
+pad_describe_led_groups(struct evdev_device *device,
+			WacomDevice *wacom,
+			struct libinput_libwacom_pad *desc)
 {
 	const WacomStatusLEDs *leds;
-	int nleds, nmodes;
+	int nleds;
 	int i;
-	struct pad_led_group *group;
-	char syspath[PATH_MAX];
 
 	leds = libwacom_get_status_leds(wacom, &nleds);
 	if (nleds == 0)
-		return 1;
+		return false;
 
-	/* syspath is /sys/class/leds/input1234/input12345::wacom-" and
-	   only needs the group + mode appended */
-	if (!pad_led_get_sysfs_base_path(device, syspath, sizeof(syspath)))
-		return 1;
+	if (nleds > LIBWACOM_PAD_MAX_GROUPS) {
+		evdev_log_bug_libinput(device,
+				       "Too many led groups %d\n",
+				       nleds);
+		return false;
+	}
 
 	for (i = 0; i < nleds; i++) {
+		struct libinput_libwacom_pad_group *group = &desc->groups[i];
+
 		switch(leds[i]) {
 		case WACOM_STATUS_LED_UNAVAILABLE:
 			evdev_log_bug_libinput(device,
 					       "Invalid led type %d\n",
 					       leds[i]);
-			return 1;
+			return false;
 		case WACOM_STATUS_LED_RING:
-			nmodes = libwacom_get_ring_num_modes(wacom);
-			group = pad_group_new(pad, i, nmodes, syspath);
-			if (!group)
-				return 1;
-			list_insert(&pad->modes.mode_group_list, &group->base.link);
+			group->num_modes = libwacom_get_ring_num_modes(wacom);
+			group->ring_mask |= 0x1;
 			break;
 		case WACOM_STATUS_LED_RING2:
-			nmodes = libwacom_get_ring2_num_modes(wacom);
-			group = pad_group_new(pad, i, nmodes, syspath);
-			if (!group)
-				return 1;
-			list_insert(&pad->modes.mode_group_list, &group->base.link);
+			group->num_modes = libwacom_get_ring2_num_modes(wacom);
+			group->ring_mask |= 0x2;
 			break;
 		case WACOM_STATUS_LED_TOUCHSTRIP:
-			nmodes = libwacom_get_strips_num_modes(wacom);
-			group = pad_group_new(pad, i, nmodes, syspath);
-			if (!group)
-				return 1;
-			list_insert(&pad->modes.mode_group_list, &group->base.link);
+			group->num_modes = libwacom_get_strips_num_modes(wacom);
+			group->strip_mask |= 0x1;
 			break;
 		case WACOM_STATUS_LED_TOUCHSTRIP2:
 			/* there is no get_strips2_... */
-			nmodes = libwacom_get_strips_num_modes(wacom);
-			group = pad_group_new(pad, i, nmodes, syspath);
-			if (!group)
-				return 1;
-			list_insert(&pad->modes.mode_group_list, &group->base.link);
+			group->num_modes = libwacom_get_strips_num_modes(wacom);
+			group->strip_mask |= 0x2;
 			break;
 		}
 	}
 
-	return 0;
-}
-
-#endif
-
-static inline struct libinput_tablet_pad_mode_group *
-pad_get_mode_group(struct pad_dispatch *pad, unsigned int index)
-{
-	struct libinput_tablet_pad_mode_group *group;
-
-	list_for_each(group, &pad->modes.mode_group_list, link) {
-		if (group->index == index)
-			return group;
-	}
+	desc->ngroups = nleds;
 
-	return NULL;
+	return true;
 }
 
-#if HAVE_LIBWACOM
-
 static inline int
 pad_find_button_group(WacomDevice *wacom,
 		      int button_index,
@@ -373,15 +387,22 @@ pad_find_button_group(WacomDevice *wacom,
 	return -1;
 }
 
-static int
-pad_init_mode_buttons(struct pad_dispatch *pad,
-		      WacomDevice *wacom)
+static bool
+pad_describe_mode_buttons(struct evdev_device *device,
+			  WacomDevice *wacom,
+			  struct libinput_libwacom_pad *desc)
 {
-	struct libinput_tablet_pad_mode_group *group;
-	unsigned int group_idx;
+	int group_idx;
 	int i;
 	WacomButtonFlags flags;
 
+	if (libwacom_get_num_buttons(wacom) > 32) {
+		evdev_log_bug_libinput(device,
+				       "Too many pad buttons for modes %d\n",
+				       libwacom_get_num_buttons(wacom));
+		return false;
+	}
+
 	/* libwacom numbers buttons as 'A', 'B', etc. We number them with 0,
 	 * 1, ...
 	 */
@@ -392,96 +413,140 @@ pad_init_mode_buttons(struct pad_dispatch *pad,
 		/* If this button is not a mode toggle button, find the mode
 		 * toggle button with the same position flags and take that
 		 * button's group idx */
-		if ((int)group_idx == -1) {
+		if (group_idx == -1) {
 			group_idx = pad_find_button_group(wacom, i, flags);
 		}
 
-		if ((int)group_idx == -1) {
-			evdev_log_bug_libinput(pad->device,
+		if (group_idx == -1) {
+			evdev_log_bug_libinput(device,
 					       "unhandled position for button %i\n",
 					       i);
-			return 1;
+			return false;
 		}
 
-		group = pad_get_mode_group(pad, group_idx);
-		if (!group) {
-			evdev_log_bug_libinput(pad->device,
+		if (group_idx < 0 || (size_t)group_idx >= desc->ngroups) {
+			evdev_log_bug_libinput(device,
 					       "Failed to find group %d for button %i\n",
 					       group_idx,
-					 i);
-			return 1;
+					       i);
+			return false;
 		}
 
-		group->button_mask |= 1 << i;
+		desc->groups[group_idx].button_mask |= 1U << i;
 
-		if (flags & WACOM_BUTTON_MODESWITCH) {
-			struct pad_mode_toggle_button *b;
-			struct pad_led_group *g;
-
-			b = pad_mode_toggle_button_new(pad, group, i);
-			if (!b)
-				return 1;
-			g = (struct pad_led_group*)group;
-			list_insert(&g->toggle_button_list, &b->link);
-			group->toggle_button_mask |= 1 << i;
-		}
+		if (flags & WACOM_BUTTON_MODESWITCH)
+			desc->groups[group_idx].toggle_button_mask |= 1U << i;
 	}
 
-	return 0;
+	return true;
 }
 
 static void
-pad_init_mode_rings(struct pad_dispatch *pad, WacomDevice *wacom)
+pad_describe(struct pad_dispatch *pad,
+	     struct evdev_device *device,
+	     struct libinput_libwacom_pad *desc)
 {
-	struct libinput_tablet_pad_mode_group *group;
-	const WacomStatusLEDs *leds;
-	int i, nleds;
+	struct libinput *li = pad_libinput_context(pad);
+	WacomDevice *wacom;
+	char syspath[PATH_MAX];
 
-	leds = libwacom_get_status_leds(wacom, &nleds);
-	if (nleds == 0)
+	wacom = libwacom_new_from_path(li->libwacom->db,
+				       udev_device_get_devnode(device->udev_device),
+				       WFALLBACK_NONE,
+				       NULL);
+	if (!wacom)
 		return;
 
-	for (i = 0; i < nleds; i++) {
-		switch(leds[i]) {
-		case WACOM_STATUS_LED_RING:
-			group = pad_get_mode_group(pad, i);
-			group->ring_mask |= 0x1;
-			break;
-		case WACOM_STATUS_LED_RING2:
-			group = pad_get_mode_group(pad, i);
-			group->ring_mask |= 0x2;
-			break;
-		default:
-			break;
-		}
-	}
+	if (!pad_describe_led_groups(device, wacom, desc) ||
+	    !pad_describe_mode_buttons(device, wacom, desc))
+		goto out;
+
+	/* syspath is /sys/class/leds/input1234/input12345::wacom-" and
+	   only needs the group + mode appended */
+	if (!pad_led_get_sysfs_base_path(device, syspath, sizeof(syspath)))
+		goto out;
+
+	desc->led_base = safe_strdup(syspath);
+	desc->known = true;
+
+out:
+	libwacom_destroy(wacom);
 }
 
-static void
-pad_init_mode_strips(struct pad_dispatch *pad, WacomDevice *wacom)
+/**
+ * The pad's mode groups only depend on the libwacom description and the
+ * LED directories in sysfs, both are looked up once per input device and
+ * cached with the libwacom database.
+ */
+static const struct libinput_libwacom_pad *
+pad_get_description(struct pad_dispatch *pad,
+		    struct evdev_device *device)
 {
-	struct libinput_tablet_pad_mode_group *group;
-	const WacomStatusLEDs *leds;
-	int i, nleds;
+	struct libinput *li = pad_libinput_context(pad);
+	const struct libinput_libwacom_pad *cached;
+	struct libinput_libwacom_pad *desc;
+	char input_syspath[PATH_MAX];
+	char *slash;
+	int rc;
+	int vendor = libevdev_get_id_vendor(device->evdev),
+	    product = libevdev_get_id_product(device->evdev);
+
+	/* The event node's parent is the input device */
+	rc = snprintf(input_syspath,
+		      sizeof(input_syspath),
+		      "%s",
+		      udev_device_get_syspath(device->udev_device));
+	if (rc < 0 || (size_t)rc >= sizeof(input_syspath))
+		return NULL;
+	slash = strrchr(input_syspath, '/');
+	if (slash)
+		*slash = '\0';
 
-	leds = libwacom_get_status_leds(wacom, &nleds);
-	if (nleds == 0)
-		return;
+	cached = libinput_libwacom_get_pad(li, input_syspath, vendor, product);
+	if (cached)
+		return cached;
 
-	for (i = 0; i < nleds; i++) {
-		switch(leds[i]) {
-		case WACOM_STATUS_LED_TOUCHSTRIP:
-			group = pad_get_mode_group(pad, i);
-			group->strip_mask |= 0x1;
-			break;
-		case WACOM_STATUS_LED_TOUCHSTRIP2:
-			group = pad_get_mode_group(pad, i);
-			group->strip_mask |= 0x2;
-			break;
-		default:
-			break;
+	desc = libinput_libwacom_add_pad(li, input_syspath, vendor, product);
+	pad_describe(pad, device, desc);
+
+	return desc;
+}
+
+static int
+pad_init_led_groups(struct pad_dispatch *pad,
+		    const struct libinput_libwacom_pad *desc)
+{
+	size_t i;
+
+	for (i = 0; i < desc->ngroups; i++) {
+		const struct libinput_libwacom_pad_group *d = &desc->groups[i];
+		struct pad_led_group *group;
+		unsigned int button;
+
+		group = pad_group_new(pad, i, d->num_modes, desc->led_base);
+		if (!group)
+			return 1;
+		list_insert(&pad->modes.mode_group_list, &group->base.link);
+
+		group->base.button_mask = d->button_mask;
+		group->base.toggle_button_mask = d->toggle_button_mask;
+		group->base.ring_mask = d->ring_mask;
+		group->base.strip_mask = d->strip_mask;
+
+		for (button = 0; button < 32; button++) {
+			struct pad_mode_toggle_button *b;
+
+			if ((d->toggle_button_mask & (1U << button)) == 0)
+				continue;
+
+			b = pad_mode_toggle_button_new(pad, &group->base, button);
+			if (!b)
+				return 1;
+			list_insert(&group->toggle_button_list, &b->link);
 		}
 	}
+
+	return 0;
 }
 
 static int
@@ -489,36 +554,17 @@ pad_init_leds_from_libwacom(struct pad_dispatch *pad,
 			    struct evdev_device *device)
 {
 	struct libinput *li = pad_libinput_context(pad);
-	WacomDeviceDatabase *db = NULL;
-	WacomDevice *wacom = NULL;
+	const struct libinput_libwacom_pad *desc;
 	int rc = 1;
 
-	db = libinput_libwacom_ref(li);
-	if (!db)
-		goto out;
-
-	wacom = libwacom_new_from_path(db,
-				       udev_device_get_devnode(device->udev_device),
-				       WFALLBACK_NONE,
-				       NULL);
-	if (!wacom)
-		goto out;
-
-	rc = pad_init_led_groups(pad, device, wacom);
-	if (rc != 0)
-		goto out;
-
-	if ((rc = pad_init_mode_buttons(pad, wacom)) != 0)
-		goto out;
+	if (!libinput_libwacom_ref(li))
+		return 1;
 
-	pad_init_mode_rings(pad, wacom);
-	pad_init_mode_strips(pad, wacom);
+	desc = pad_get_description(pad, device);
+	if (desc && desc->known)
+		rc = pad_init_led_groups(pad, desc);
 
-out:
-	if (wacom)
-		libwacom_destroy(wacom);
-	if (db)
-		libinput_libwacom_unref(li);
+	libinput_libwacom_unref(li);
 
 	if (rc != 0)
 		pad_destroy_leds(pad);
@@ -583,6 +629,27 @@ pad_destroy_leds(struct pad_dispatch *pad)
 		libinput_tablet_pad_mode_group_unref(group);
 }
 
+size_t
+pad_leds_memory_usage(struct pad_dispatch *pad)
+{
+	struct libinput_tablet_pad_mode_group *g;
+	size_t size = 0;
+
+	list_for_each(g, &pad->modes.mode_group_list, link) {
+		struct pad_led_group *group = (struct pad_led_group *)g;
+		struct pad_mode_toggle_button *button;
+		struct pad_mode_led *led;
+
+		size += sizeof(*group);
+		list_for_each(button, &group->toggle_button_list, link)
+			size += sizeof(*button);
+		list_for_each(led, &group->led_list, link)
+			size += sizeof(*led);
+	}
+
+	return size;
+}
+
 void
 pad_button_update_mode(struct libinput_tablet_pad_mode_group *g,
 		       unsigned int button_index,
@@ -597,7 +664,10 @@ pad_button_update_mode(struct libinput_tablet_pad_mode_group *g,
 	if (!libinput_tablet_pad_mode_group_button_is_toggle(g, button_index))
 		return;
 
-	rc = pad_led_group_get_mode(group);
+	rc = pad_led_group_get_mode(group,
+				    g->num_modes ?
+				    (int)((g->current_mode + 1) % g->num_modes) :
+				    -1);
 	if (rc >= 0)
 		group->base.current_mode = rc;
 }
@@ -360,48 +360,33 @@ pad_notify_button_mask(struct pad_dispatch *pad,
 {
 	struct libinput_device *base = &device->base;
 	struct libinput_tablet_pad_mode_group *group;
-	int32_t code;
-	unsigned int i;
+	int code;
+
+	bits_for_each_set(buttons->bits, sizeof(buttons->bits), code) {
+		key_or_button_map_t map = pad->button_map[code];
 
-	for (i = 0; i < sizeof(buttons->bits); i++) {
-		unsigned char buttons_slice = buttons->bits[i];
-
-		code = i * 8;
-		while (buttons_slice) {
-			int enabled;
-			key_or_button_map_t map;
-
-			code++;
-			enabled = (buttons_slice & 1);
-			buttons_slice >>= 1;
-
-			if (!enabled)
-				continue;
-
-			map = pad->button_map[code - 1];
-			if (map_is_unmapped(map))
-				continue;
-
-			if (map_is_button(map)) {
-				int32_t button = map_value(map);
-
-				group = pad_button_get_mode_group(pad, button);
-				pad_button_update_mode(group, button, state);
-				tablet_pad_notify_button(base,
-							 time,
-							 button,
-							 state,
-							 group);
-			} else if (map_is_key(map)) {
-				uint32_t key = map_value(map);
-
-				tablet_pad_notify_key(base,
-						      time,
-						      key,
-						      (enum libinput_key_state)state);
-			} else {
-				abort();
-			}
+		if (map_is_unmapped(map))
+			continue;
+
+		if (map_is_button(map)) {
+			int32_t button = map_value(map);
+
+			group = pad_button_get_mode_group(pad, button);
+			pad_button_update_mode(group, button, state);
+			tablet_pad_notify_button(base,
+						 time,
+						 button,
+						 state,
+						 group);
+		} else if (map_is_key(map)) {
+			uint32_t key = map_value(map);
+
+			tablet_pad_notify_key(base,
+					      time,
+					      key,
+					      (enum libinput_key_state)state);
+		} else {
+			abort();
 		}
 	}
 }
@@ -523,7 +508,15 @@ pad_destroy(struct evdev_dispatch *dispatch)
 	struct pad_dispatch *pad = pad_dispatch(dispatch);
 
 	pad_destroy_leds(pad);
-	free(pad);
+	mem_free(pad);
+}
+
+static size_t
+pad_memory_usage(struct evdev_dispatch *dispatch)
+{
+	struct pad_dispatch *pad = pad_dispatch(dispatch);
+
+	return sizeof(*pad) + pad_leds_memory_usage(pad);
 }
 
 static struct evdev_dispatch_interface pad_interface = {
@@ -539,6 +532,7 @@ static struct evdev_dispatch_interface pad_interface = {
 	.touch_arbitration_toggle = NULL,
 	.touch_arbitration_update_rect = NULL,
 	.get_switch_state = NULL,
+	.memory_usage = pad_memory_usage,
 };
 
 static bool
@@ -729,7 +723,7 @@ evdev_tablet_pad_create(struct evdev_device *device)
 {
 	struct pad_dispatch *pad;
 
-	pad = zalloc(sizeof *pad);
+	pad = mem_zalloc(sizeof *pad);
 
 	if (pad_init(pad, device) != 0) {
 		pad_destroy(&pad->base);
@@ -101,6 +101,8 @@ int
 pad_init_leds(struct pad_dispatch *pad, struct evdev_device *device);
 void
 pad_destroy_leds(struct pad_dispatch *pad);
+size_t
+pad_leds_memory_usage(struct pad_dispatch *pad);
 void
 pad_button_update_mode(struct libinput_tablet_pad_mode_group *g,
 		       unsigned int pressed_button,
@@ -41,6 +41,9 @@ enum notify {
    detect out-of-range.
    This value is higher during test suite runs */
 static int FORCED_PROXOUT_TIMEOUT = 50 * 1000; /* µs */
+static int FORCED_PROXOUT_TIMEOUT_SLACK = 10 * 1000; /* µs */
+/* The arbitration rect only follows the pen once it moved this far */
+static const double ARBITRATION_RECT_HYSTERESIS_MM = 5.0;
 
 #define tablet_set_status(tablet_,s_) (tablet_)->status |= (s_)
 #define tablet_unset_status(tablet_,s_) (tablet_)->status &= ~(s_)
@@ -86,12 +89,6 @@ tablet_force_button_presses(struct tablet_dispatch *tablet)
 	}
 }
 
-static inline size_t
-tablet_history_size(const struct tablet_dispatch *tablet)
-{
-	return ARRAY_LENGTH(tablet->history.samples);
-}
-
 static inline void
 tablet_history_reset(struct tablet_dispatch *tablet)
 {
@@ -99,35 +96,59 @@ tablet_history_reset(struct tablet_dispatch *tablet)
 }
 
 static inline void
-tablet_history_push(struct tablet_dispatch *tablet,
-		    const struct tablet_axes *axes)
+tablet_history_resum(struct tablet_dispatch *tablet)
 {
-	unsigned int index = (tablet->history.index + 1) %
-				tablet_history_size(tablet);
+	tablet->history.sum.x = 0;
+	tablet->history.sum.y = 0;
+	tablet->history.sum.tilt_x = 0;
+	tablet->history.sum.tilt_y = 0;
 
-	tablet->history.samples[index] = *axes;
-	tablet->history.index = index;
-	tablet->history.count = min(tablet->history.count + 1,
-				    tablet_history_size(tablet));
+	for (unsigned int i = 0; i < tablet->history.count; i++) {
+		const struct tablet_axes *a = &tablet->history.samples[i];
 
-	if (tablet->history.count < tablet_history_size(tablet))
-		tablet_history_push(tablet, axes);
+		tablet->history.sum.x += a->point.x;
+		tablet->history.sum.y += a->point.y;
+		tablet->history.sum.tilt_x += a->tilt.x;
+		tablet->history.sum.tilt_y += a->tilt.y;
+	}
 }
 
-/**
- * Return a previous axis state, where index of 0 means "most recent", 1 is
- * "one before most recent", etc.
- */
-static inline const struct tablet_axes*
-tablet_history_get(const struct tablet_dispatch *tablet, unsigned int index)
+static inline void
+tablet_history_push(struct tablet_dispatch *tablet,
+		    const struct tablet_axes *axes)
 {
-	size_t sz = tablet_history_size(tablet);
+	unsigned int length = tablet->history.length;
+	unsigned int index;
+	struct tablet_axes *oldest;
+
+	/* After a reset, the whole window is filled with the first sample */
+	if (tablet->history.count == 0) {
+		for (unsigned int i = 0; i < length; i++)
+			tablet->history.samples[i] = *axes;
+		tablet->history.index = 0;
+		tablet->history.count = length;
+		tablet_history_resum(tablet);
+		return;
+	}
+
+	index = tablet->history.index + 1;
+	if (index == length)
+		index = 0;
 
-	assert(index < sz);
-	assert(index < tablet->history.count);
+	/* The window is always full, the new sample replaces the oldest */
+	oldest = &tablet->history.samples[index];
+	tablet->history.sum.x += axes->point.x - oldest->point.x;
+	tablet->history.sum.y += axes->point.y - oldest->point.y;
+	tablet->history.sum.tilt_x += axes->tilt.x - oldest->tilt.x;
+	tablet->history.sum.tilt_y += axes->tilt.y - oldest->tilt.y;
+
+	*oldest = *axes;
+	tablet->history.index = index;
 
-	index = (tablet->history.index + sz - index) % sz;
-	return &tablet->history.samples[index];
+	/* Re-sum once per window so the floating point tilt sums can't
+	 * drift over a long proximity */
+	if (index == 0)
+		tablet_history_resum(tablet);
 }
 
 static inline void
@@ -271,6 +292,7 @@ tablet_apply_rotation(struct evdev_device *device)
 		return;
 
 	tablet->rotation.rotate = tablet->rotation.want_rotate;
+	evdev_device_set_rotated(device, tablet->rotation.rotate);
 
 	evdev_log_debug(device,
 			"tablet-rotation: rotation is %s\n",
@@ -409,44 +431,24 @@ adjust_tilt(const struct input_absinfo *absinfo)
 	return value;
 }
 
-static inline int32_t
-invert_axis(const struct input_absinfo *absinfo)
-{
-	return absinfo->maximum - (absinfo->value - absinfo->minimum);
-}
-
 static void
 convert_tilt_to_rotation(struct tablet_dispatch *tablet)
 {
-	const int offset = 5;
-	double x, y;
-	double angle = 0.0;
-
-	/* Wacom Intuos 4, 5, Pro mouse calculates rotation from the x/y tilt
-	   values. The device has a 175 degree CCW hardware offset but since we use
-	   atan2 the effective offset is just 5 degrees.
-	   */
-	x = tablet->axes.tilt.x;
-	y = tablet->axes.tilt.y;
+	/* The angle is calculated in tablet_axes_get_rotation() */
+	tablet->axes.rotation_raw.source = TABLET_ROTATION_TILT;
+	tablet->axes.rotation_raw.x = tablet->axes.tilt.x;
+	tablet->axes.rotation_raw.y = tablet->axes.tilt.y;
 
-	/* atan2 is CCW, we want CW -> negate x */
-	if (x || y)
-		angle = ((180.0 * atan2(-x, y)) / M_PI);
-
-	angle = fmod(360 + angle - offset, 360);
-
-	tablet->axes.rotation = angle;
 	set_bit(tablet->changed_axes, LIBINPUT_TABLET_TOOL_AXIS_ROTATION_Z);
 }
 
 static double
-convert_to_degrees(const struct input_absinfo *absinfo, double offset)
+normalize_rotation(const struct input_absinfo *absinfo)
 {
 	/* range is [0, 360[, i.e. range + 1 */
 	double range = absinfo->maximum - absinfo->minimum + 1;
-	double value = (absinfo->value - absinfo->minimum) / range;
 
-	return fmod(value * 360.0 + offset, 360.0);
+	return (absinfo->value - absinfo->minimum) / range;
 }
 
 static inline double
@@ -462,29 +464,16 @@ static inline void
 tablet_update_xy(struct tablet_dispatch *tablet,
 		 struct evdev_device *device)
 {
-	const struct input_absinfo *absinfo;
-	int value;
-
 	if (bit_is_set(tablet->changed_axes, LIBINPUT_TABLET_TOOL_AXIS_X) ||
 	    bit_is_set(tablet->changed_axes, LIBINPUT_TABLET_TOOL_AXIS_Y)) {
-		absinfo = libevdev_get_abs_info(device->evdev, ABS_X);
-
-		if (tablet->rotation.rotate)
-			value = invert_axis(absinfo);
-		else
-			value = absinfo->value;
-
-		tablet->axes.point.x = value;
-
-		absinfo = libevdev_get_abs_info(device->evdev, ABS_Y);
-
-		if (tablet->rotation.rotate)
-			value = invert_axis(absinfo);
-		else
-			value = absinfo->value;
-
-		tablet->axes.point.y = value;
-
+		tablet->axes.point.x = libevdev_get_event_value(device->evdev,
+								EV_ABS,
+								ABS_X);
+		tablet->axes.point.y = libevdev_get_event_value(device->evdev,
+								EV_ABS,
+								ABS_Y);
+
+		/* rotation and calibration in one step */
 		evdev_transform_absolute(device, &tablet->axes.point);
 	}
 }
@@ -525,10 +514,7 @@ tablet_tool_process_delta(struct tablet_dispatch *tablet,
 	if (device_float_is_zero(accel))
 		return zero;
 
-	return filter_dispatch(device->pointer.filter,
-			       &accel,
-			       tool,
-			       time);
+	return evdev_filter_dispatch(device, &accel, tool, time);
 }
 
 static inline void
@@ -607,8 +593,11 @@ tablet_update_artpen_rotation(struct tablet_dispatch *tablet,
 		       LIBINPUT_TABLET_TOOL_AXIS_ROTATION_Z)) {
 		absinfo = libevdev_get_abs_info(device->evdev,
 						ABS_Z);
-		/* artpen has 0 with buttons pointing east */
-		tablet->axes.rotation = convert_to_degrees(absinfo, 90);
+		/* The angle is calculated in tablet_axes_get_rotation() */
+		tablet->axes.rotation_raw.source = TABLET_ROTATION_ABS;
+		tablet->axes.rotation_raw.x = normalize_rotation(absinfo);
+		tablet->axes.rotation_raw.left_handed =
+			device->left_handed.enabled;
 	}
 }
 
@@ -641,13 +630,8 @@ tablet_update_rotation(struct tablet_dispatch *tablet,
 		/* tilt is already converted to left-handed, so mouse
 		 * rotation is converted to left-handed automatically */
 	} else {
-
+		/* left-handed is applied when the angle is calculated */
 		tablet_update_artpen_rotation(tablet, device);
-
-		if (device->left_handed.enabled) {
-			double r = tablet->axes.rotation;
-			tablet->axes.rotation = fmod(180 + r, 360);
-		}
 	}
 }
 
@@ -672,25 +656,13 @@ static void
 tablet_smoothen_axes(const struct tablet_dispatch *tablet,
 		     struct tablet_axes *axes)
 {
-	size_t i;
-	size_t count = tablet_history_size(tablet);
-	struct tablet_axes smooth = { 0 };
+	int64_t count = tablet->history.count;
 
-	for (i = 0; i < count; i++) {
-		const struct tablet_axes *a = tablet_history_get(tablet, i);
+	axes->point.x = tablet->history.sum.x/count;
+	axes->point.y = tablet->history.sum.y/count;
 
-		smooth.point.x += a->point.x;
-		smooth.point.y += a->point.y;
-
-		smooth.tilt.x += a->tilt.x;
-		smooth.tilt.y += a->tilt.y;
-	}
-
-	axes->point.x = smooth.point.x/count;
-	axes->point.y = smooth.point.y/count;
-
-	axes->tilt.x = smooth.tilt.x/count;
-	axes->tilt.y = smooth.tilt.y/count;
+	axes->tilt.x = tablet->history.sum.tilt_x/count;
+	axes->tilt.y = tablet->history.sum.tilt_y/count;
 }
 
 static bool
@@ -727,6 +699,7 @@ tablet_check_notify_axes(struct tablet_dispatch *tablet,
 	axes.wheel = tablet->axes.wheel;
 	axes.wheel_discrete = tablet->axes.wheel_discrete;
 	axes.rotation = tablet->axes.rotation;
+	axes.rotation_raw = tablet->axes.rotation_raw;
 
 	rc = true;
 
@@ -927,37 +900,33 @@ tool_set_bits_from_libwacom(const struct tablet_dispatch *tablet,
 	int rc = 1;
 
 #if HAVE_LIBWACOM
-	WacomDeviceDatabase *db;
-	const WacomStylus *s = NULL;
+	struct libinput_libwacom_stylus s;
 	int code;
 	WacomStylusType type;
 	WacomAxisTypeFlags axes;
 
-	db = tablet_libinput_context(tablet)->libwacom.db;
-	if (!db)
-		return rc;
-
-	s = libwacom_stylus_get_for_id(db, tool->tool_id);
-	if (!s)
+	if (!libinput_libwacom_get_stylus(tablet_libinput_context(tablet),
+					  tool->tool_id,
+					  &s))
 		return rc;
 
-	type = libwacom_stylus_get_type(s);
+	type = s.type;
 	if (type == WSTYLUS_PUCK) {
 		for (code = BTN_LEFT;
-		     code < BTN_LEFT + libwacom_stylus_get_num_buttons(s);
+		     code < BTN_LEFT + s.num_buttons;
 		     code++)
 			copy_button_cap(tablet, tool, code);
 	} else {
-		if (libwacom_stylus_get_num_buttons(s) >= 2)
+		if (s.num_buttons >= 2)
 			copy_button_cap(tablet, tool, BTN_STYLUS2);
-		if (libwacom_stylus_get_num_buttons(s) >= 1)
+		if (s.num_buttons >= 1)
 			copy_button_cap(tablet, tool, BTN_STYLUS);
 	}
 
-	if (libwacom_stylus_has_wheel(s))
+	if (s.has_wheel)
 		copy_axis_cap(tablet, tool, LIBINPUT_TABLET_TOOL_AXIS_REL_WHEEL);
 
-	axes = libwacom_stylus_get_axes(s);
+	axes = s.axes;
 
 	if (axes & WACOM_AXIS_TYPE_TILT) {
 		/* tilt on the puck is converted to rotation */
@@ -1070,65 +1039,127 @@ static inline void
 tool_set_pressure_thresholds(struct tablet_dispatch *tablet,
 			     struct libinput_tablet_tool *tool)
 {
-	struct evdev_device *device = tablet->device;
 	const struct input_absinfo *pressure;
-	struct quirks_context *quirks = NULL;
-	struct quirks *q = NULL;
-	struct quirk_range r;
-	int lo = 0, hi = 1;
 
-	tool->pressure_offset = 0;
+	pressure = libevdev_get_abs_info(tablet->device->evdev, ABS_PRESSURE);
+
+	tool->pressure_offset = pressure ? pressure->minimum : 0;
 	tool->has_pressure_offset = false;
+	tool->pressure_threshold = tablet->pressure_threshold;
+}
 
-	pressure = libevdev_get_abs_info(device->evdev, ABS_PRESSURE);
-	if (!pressure)
-		goto out;
+/* The per-tool part of libinput_device_save_state() */
+struct tablet_tool_state {
+	uint32_t type;
+	uint32_t serial;
+	uint32_t tool_id;
+	int32_t pressure_offset;
+};
 
-	quirks = evdev_libinput_context(device)->quirks;
-	q = quirks_fetch_for_device(quirks, device->udev_device);
+static inline bool
+tool_matches_state(const struct libinput_tablet_tool *tool,
+		   const struct tablet_tool_state *state)
+{
+	return tool->type == state->type &&
+	       tool->serial == state->serial &&
+	       tool->tool_id == state->tool_id;
+}
 
-	tool->pressure_offset = pressure->minimum;
+static inline bool
+tablet_has_seen_state(const struct tablet_dispatch *tablet,
+		      const struct tablet_tool_state *state)
+{
+	for (size_t i = 0; i < tablet->nseen_tools; i++) {
+		const struct tablet_tool_state *seen = &tablet->seen_tools[i];
 
-	/* 5 and 1% of the pressure range */
-	hi = axis_range_percentage(pressure, 5);
-	lo = axis_range_percentage(pressure, 1);
+		if (seen->type == state->type &&
+		    seen->serial == state->serial &&
+		    seen->tool_id == state->tool_id)
+			return true;
+	}
 
-	if (q && quirks_get_range(q, QUIRK_ATTR_PRESSURE_RANGE, &r)) {
-		if (r.lower >= r.upper) {
-			evdev_log_info(device,
-				       "Invalid pressure range, using defaults\n");
-		} else {
-			hi = r.upper;
-			lo = r.lower;
-		}
+	return false;
+}
+
+static inline bool
+tablet_has_seen_tool(const struct tablet_dispatch *tablet,
+		     const struct libinput_tablet_tool *tool)
+{
+	for (size_t i = 0; i < tablet->nseen_tools; i++) {
+		if (tool_matches_state(tool, &tablet->seen_tools[i]))
+			return true;
 	}
-out:
-	tool->pressure_threshold.upper = hi;
-	tool->pressure_threshold.lower = lo;
 
-	quirks_unref(q);
+	return false;
+}
+
+/* Tools with a serial are shared by all tablets, remember which ones
+ * were used on this one for tablet_save_state() */
+static void
+tablet_mark_tool_seen(struct tablet_dispatch *tablet,
+		      const struct libinput_tablet_tool *tool)
+{
+	size_t n = tablet->nseen_tools;
+
+	if (tablet_has_seen_tool(tablet, tool))
+		return;
+
+	tablet->seen_tools = realloc(tablet->seen_tools,
+				     (n + 1) * sizeof(*tablet->seen_tools));
+	if (!tablet->seen_tools)
+		abort();
+
+	tablet->seen_tools[n] = (struct tablet_tool_state) {
+		.type = tool->type,
+		.serial = tool->serial,
+		.tool_id = tool->tool_id,
+	};
+	tablet->nseen_tools = n + 1;
+}
+
+static void
+tool_restore_state(struct tablet_dispatch *tablet,
+		   struct libinput_tablet_tool *tool)
+{
+	const struct input_absinfo *pressure;
+	size_t i;
+
+	pressure = libevdev_get_abs_info(tablet->device->evdev, ABS_PRESSURE);
+	if (!pressure || tool->has_pressure_offset)
+		return;
+
+	for (i = 0; i < tablet->nsaved_tools; i++) {
+		const struct tablet_tool_state *state = &tablet->saved_tools[i];
+
+		if (!tool_matches_state(tool, state))
+			continue;
+
+		/* Same checks as detect_pressure_offset() */
+		if (state->pressure_offset <= pressure->minimum ||
+		    state->pressure_offset > axis_range_percentage(pressure, 20))
+			return;
+
+		tool->pressure_offset = state->pressure_offset;
+		tool->has_pressure_offset = true;
+		tool->pressure_threshold.lower = pressure->minimum;
+		return;
+	}
 }
 
 static struct libinput_tablet_tool *
 tablet_get_tool(struct tablet_dispatch *tablet,
 		enum libinput_tablet_tool_type type,
 		uint32_t tool_id,
-		uint32_t serial)
+		uint32_t serial,
+		uint64_t time)
 {
 	struct libinput *libinput = tablet_libinput_context(tablet);
 	struct libinput_tablet_tool *tool = NULL, *t;
-	struct list *tool_list;
+	bool global = serial != 0;
 
-	if (serial) {
-		tool_list = &libinput->tool_list;
-		/* Check if we already have the tool in our list of tools */
-		list_for_each(t, tool_list, link) {
-			if (type == t->type && serial == t->serial) {
-				tool = t;
-				break;
-			}
-		}
-	}
+	/* Check if we already have the tool in our list of tools */
+	if (serial)
+		tool = libinput_tool_hash_lookup(libinput, type, serial);
 
 	/* If we get a tool with a delayed serial number, we already created
 	 * a 0-serial number tool for it earlier. Re-use that, even though
@@ -1136,29 +1167,27 @@ tablet_get_tool(struct tablet_dispatch *tablet,
 	 * https://bugs.freedesktop.org/show_bug.cgi?id=97526
 	 */
 	if (!tool) {
-		tool_list = &tablet->tool_list;
 		/* We can't guarantee that tools without serial numbers are
 		 * unique, so we keep them local to the tablet that they come
 		 * into proximity of instead of storing them in the global tool
 		 * list
 		 * Same as above, but don't bother checking the serial number
 		 */
-		list_for_each(t, tool_list, link) {
+		ptr_array_for_each(t, &tablet->tools) {
 			if (type == t->type) {
 				tool = t;
+				global = false;
 				break;
 			}
 		}
-
-		/* Didn't find the tool but we have a serial. Switch
-		 * tool_list back so we create in the correct list */
-		if (!tool && serial)
-			tool_list = &libinput->tool_list;
 	}
 
 	/* If we didn't already have the new_tool in our list of tools,
 	 * add it */
 	if (!tool) {
+		if (global)
+			libinput_evict_idle_tools(libinput, time);
+
 		tool = zalloc(sizeof *tool);
 
 		*tool = (struct libinput_tablet_tool) {
@@ -1169,11 +1198,23 @@ tablet_get_tool(struct tablet_dispatch *tablet,
 		};
 
 		tool_set_pressure_thresholds(tablet, tool);
+		tool_restore_state(tablet, tool);
 		tool_set_bits(tablet, tool);
 
-		list_insert(tool_list, &tool->link);
+		if (global) {
+			list_insert(&libinput->tool_list, &tool->link);
+			libinput_tool_hash_insert(libinput, tool);
+		} else {
+			/* unlinked, so the final unref can still
+			 * list_remove() it */
+			list_init(&tool->link);
+			ptr_array_append(&tablet->tools, tool);
+		}
 	}
 
+	tablet_mark_tool_seen(tablet, tool);
+	tool->last_used = time;
+
 	return tool;
 }
 
@@ -1186,17 +1227,13 @@ tablet_notify_button_mask(struct tablet_dispatch *tablet,
 			  enum libinput_button_state state)
 {
 	struct libinput_device *base = &device->base;
-	size_t i;
-	size_t nbits = 8 * sizeof(buttons->bits);
+	int i;
 	enum libinput_tablet_tool_tip_state tip_state;
 
 	tip_state = tablet_has_status(tablet, TABLET_TOOL_IN_CONTACT) ?
 			LIBINPUT_TABLET_TOOL_TIP_DOWN : LIBINPUT_TABLET_TOOL_TIP_UP;
 
-	for (i = 0; i < nbits; i++) {
-		if (!bit_is_set(buttons->bits, i))
-			continue;
-
+	bits_for_each_set(buttons->bits, sizeof(buttons->bits), i) {
 		tablet_notify_button(base,
 				     time,
 				     tool,
@@ -1510,6 +1547,17 @@ tablet_calculate_arbitration_rect(struct tablet_dispatch *tablet)
 	return r;
 }
 
+static inline bool
+phys_rect_is_close(const struct phys_rect *a,
+		   const struct phys_rect *b,
+		   double margin)
+{
+	return fabs(a->x - b->x) < margin &&
+	       fabs(a->y - b->y) < margin &&
+	       fabs(a->w - b->w) < margin &&
+	       fabs(a->h - b->h) < margin;
+}
+
 static inline void
 tablet_update_touch_device_rect(struct tablet_dispatch *tablet,
 				const struct tablet_axes *axes,
@@ -1524,6 +1572,15 @@ tablet_update_touch_device_rect(struct tablet_dispatch *tablet,
 
 	rect = tablet_calculate_arbitration_rect(tablet);
 
+	/* The rect is much larger than the area below the hand, it
+	 * doesn't need to follow every bit of pen motion */
+	if (phys_rect_is_close(&rect,
+			       &tablet->arbitration_rect,
+			       ARBITRATION_RECT_HYSTERESIS_MM))
+		return;
+
+	tablet->arbitration_rect = rect;
+
 	dispatch = tablet->touch_device->dispatch;
 	if (dispatch->interface->touch_arbitration_update_rect)
 		dispatch->interface->touch_arbitration_update_rect(dispatch,
@@ -1751,11 +1808,38 @@ static inline void
 tablet_proximity_out_quirk_set_timer(struct tablet_dispatch *tablet,
 				     uint64_t time)
 {
+	tablet->quirks.prox_out_deferred = false;
+
 	if (tablet->quirks.need_to_force_prox_out)
 		libinput_timer_set(&tablet->quirks.prox_out_timer,
 				   time + FORCED_PROXOUT_TIMEOUT);
 }
 
+static inline void
+tablet_proximity_out_quirk_cancel_timer(struct tablet_dispatch *tablet)
+{
+	tablet->quirks.prox_out_deferred = false;
+	libinput_timer_cancel(&tablet->quirks.prox_out_timer);
+}
+
+/* Called once per frame. The timer is not re-armed per frame, the last
+ * event time is checked when the timer expires instead. During tip
+ * contact or a button press we can't force a proximity out anyway, so
+ * the timer stays off until the frame that ends those. */
+static inline void
+tablet_proximity_out_quirk_update(struct tablet_dispatch *tablet,
+				  uint64_t time)
+{
+	tablet->quirks.last_event_time = time;
+
+	if (!tablet->quirks.prox_out_deferred ||
+	    tablet_has_status(tablet, TABLET_TOOL_IN_CONTACT) ||
+	    tablet_has_status(tablet, TABLET_BUTTONS_DOWN))
+		return;
+
+	tablet_proximity_out_quirk_set_timer(tablet, time);
+}
+
 static bool
 tablet_update_tool_state(struct tablet_dispatch *tablet,
 			 struct evdev_device *device,
@@ -1832,7 +1916,7 @@ tablet_update_tool_state(struct tablet_dispatch *tablet,
 			 * send the correct event sequence occasionally but
 			 * are broken otherwise.
 			 */
-			libinput_timer_cancel(&tablet->quirks.prox_out_timer);
+			tablet_proximity_out_quirk_cancel_timer(tablet);
 		}
 	}
 
@@ -1846,7 +1930,7 @@ tablet_update_tool_state(struct tablet_dispatch *tablet,
 }
 
 static struct libinput_tablet_tool *
-tablet_get_current_tool(struct tablet_dispatch *tablet)
+tablet_get_current_tool(struct tablet_dispatch *tablet, uint64_t time)
 {
 	if (tablet->current_tool.type == LIBINPUT_TOOL_NONE)
 		return NULL;
@@ -1854,7 +1938,8 @@ tablet_get_current_tool(struct tablet_dispatch *tablet)
 	return tablet_get_tool(tablet,
 			       tablet->current_tool.type,
 			       tablet->current_tool.id,
-			       tablet->current_tool.serial);
+			       tablet->current_tool.serial,
+			       time);
 }
 
 static void
@@ -1868,7 +1953,7 @@ tablet_flush(struct tablet_dispatch *tablet,
 reprocess:
 	process_tool_twice = tablet_update_tool_state(tablet, device, time);
 
-	tool = tablet_get_current_tool(tablet);
+	tool = tablet_get_current_tool(tablet, time);
 	if (!tool)
 		return; /* OOM */
 
@@ -1917,6 +2002,8 @@ tablet_set_touch_device_enabled(struct tablet_dispatch *tablet,
 		return;
 
 	tablet->arbitration = which;
+	if (rect)
+		tablet->arbitration_rect = *rect;
 
 	dispatch = touch_device->dispatch;
 	if (dispatch->interface->touch_arbitration_toggle)
@@ -2000,7 +2087,7 @@ tablet_proximity_out_quirk_timer_func(uint64_t now, void *data)
 
 	if (tablet_has_status(tablet, TABLET_TOOL_IN_CONTACT) ||
 	    tablet_has_status(tablet, TABLET_BUTTONS_DOWN)) {
-		tablet_proximity_out_quirk_set_timer(tablet, now);
+		tablet->quirks.prox_out_deferred = true;
 		return;
 	}
 
@@ -2011,6 +2098,10 @@ tablet_proximity_out_quirk_timer_func(uint64_t now, void *data)
 	}
 
 	evdev_log_debug(tablet->device, "tablet: forcing proximity after timeout\n");
+	libinput_device_record_delay(&tablet->device->base,
+				     LIBINPUT_DELAY_SOURCE_TABLET_PROXIMITY,
+				     tablet->quirks.last_event_time,
+				     now);
 
 	ARRAY_FOR_EACH(events, e) {
 		tablet->base.interface->process(&tablet->base,
@@ -2022,14 +2113,12 @@ tablet_proximity_out_quirk_timer_func(uint64_t now, void *data)
 	tablet->quirks.proximity_out_forced = true;
 }
 
-static void
-tablet_process(struct evdev_dispatch *dispatch,
-	       struct evdev_device *device,
-	       struct input_event *e,
-	       uint64_t time)
+static inline void
+tablet_process_event(struct tablet_dispatch *tablet,
+		     struct evdev_device *device,
+		     struct input_event *e,
+		     uint64_t time)
 {
-	struct tablet_dispatch *tablet = tablet_dispatch(dispatch);
-
 	switch (e->type) {
 	case EV_ABS:
 		tablet_process_absolute(tablet, device, e, time);
@@ -2047,7 +2136,7 @@ tablet_process(struct evdev_dispatch *dispatch,
 		tablet_flush(tablet, device, time);
 		tablet_toggle_touch_device(tablet, device, time);
 		tablet_reset_state(tablet);
-		tablet->quirks.last_event_time = time;
+		tablet_proximity_out_quirk_update(tablet, time);
 		break;
 	default:
 		evdev_log_error(device,
@@ -2058,6 +2147,28 @@ tablet_process(struct evdev_dispatch *dispatch,
 	}
 }
 
+static void
+tablet_process(struct evdev_dispatch *dispatch,
+	       struct evdev_device *device,
+	       struct input_event *e,
+	       uint64_t time)
+{
+	tablet_process_event(tablet_dispatch(dispatch), device, e, time);
+}
+
+static void
+tablet_process_frame(struct evdev_dispatch *dispatch,
+		     struct evdev_device *device,
+		     struct input_event *events,
+		     size_t nevents,
+		     uint64_t time)
+{
+	struct tablet_dispatch *tablet = tablet_dispatch(dispatch);
+
+	for (size_t i = 0; i < nevents; i++)
+		tablet_process_event(tablet, device, &events[i], time);
+}
+
 static void
 tablet_suspend(struct evdev_dispatch *dispatch,
 	       struct evdev_device *device)
@@ -2081,19 +2192,21 @@ static void
 tablet_destroy(struct evdev_dispatch *dispatch)
 {
 	struct tablet_dispatch *tablet = tablet_dispatch(dispatch);
-	struct libinput_tablet_tool *tool, *tmp;
+	struct libinput_tablet_tool *tool;
 	struct libinput *li = tablet_libinput_context(tablet);
 
 	libinput_timer_cancel(&tablet->quirks.prox_out_timer);
 	libinput_timer_destroy(&tablet->quirks.prox_out_timer);
 
-	list_for_each_safe(tool, tmp, &tablet->tool_list, link) {
+	ptr_array_for_each(tool, &tablet->tools)
 		libinput_tablet_tool_unref(tool);
-	}
+	ptr_array_release(&tablet->tools);
+	free(tablet->saved_tools);
+	free(tablet->seen_tools);
 
 	libinput_libwacom_unref(li);
 
-	free(tablet);
+	mem_free(tablet);
 }
 
 static void
@@ -2219,12 +2332,128 @@ tablet_left_handed_toggled(struct evdev_dispatch *dispatch,
 	tablet_change_rotation(device, DONT_NOTIFY);
 }
 
+static size_t
+tablet_memory_usage(struct evdev_dispatch *dispatch)
+{
+	struct tablet_dispatch *tablet = tablet_dispatch(dispatch);
+	struct libinput_tablet_tool *tool;
+	size_t size = sizeof(*tablet);
+
+	/* tools without a serial belong to this tablet */
+	size += ptr_array_memory_usage(&tablet->tools);
+	ptr_array_for_each(tool, &tablet->tools)
+		size += sizeof(*tool);
+
+	size += tablet->nsaved_tools * sizeof(*tablet->saved_tools);
+	size += tablet->nseen_tools * sizeof(*tablet->seen_tools);
+
+	return size;
+}
+
+static inline void
+tablet_save_tool(const struct libinput_tablet_tool *tool,
+		 struct tablet_tool_state *states,
+		 size_t *n)
+{
+	if (!tool->has_pressure_offset)
+		return;
+
+	if (states)
+		states[*n] = (struct tablet_tool_state) {
+			.type = tool->type,
+			.serial = tool->serial,
+			.tool_id = tool->tool_id,
+			.pressure_offset = tool->pressure_offset,
+		};
+
+	(*n)++;
+}
+
+/* Returns the number of tools saved, states may be NULL to count them.
+ * Tools with a serial are shared across tablets, only those used on this
+ * one are saved. Restored states of tools that weren't used since are
+ * passed on as they are. */
+static size_t
+tablet_save_tools(struct tablet_dispatch *tablet,
+		  struct tablet_tool_state *states)
+{
+	struct libinput *li = tablet_libinput_context(tablet);
+	struct libinput_tablet_tool *tool;
+	size_t n = 0;
+
+	ptr_array_for_each(tool, &tablet->tools)
+		tablet_save_tool(tool, states, &n);
+	list_for_each(tool, &li->tool_list, link) {
+		if (tablet_has_seen_tool(tablet, tool))
+			tablet_save_tool(tool, states, &n);
+	}
+
+	for (size_t i = 0; i < tablet->nsaved_tools; i++) {
+		const struct tablet_tool_state *state = &tablet->saved_tools[i];
+
+		if (tablet_has_seen_state(tablet, state))
+			continue;
+
+		if (states)
+			states[n] = *state;
+		n++;
+	}
+
+	return n;
+}
+
+static size_t
+tablet_save_state(struct evdev_dispatch *dispatch,
+		  void *buf,
+		  size_t size)
+{
+	struct tablet_dispatch *tablet = tablet_dispatch(dispatch);
+	size_t n = tablet_save_tools(tablet, NULL);
+
+	if (n > 0 && size >= n * sizeof(struct tablet_tool_state))
+		tablet_save_tools(tablet, buf);
+
+	return n * sizeof(struct tablet_tool_state);
+}
+
+static bool
+tablet_restore_state(struct evdev_dispatch *dispatch,
+		     const void *buf,
+		     size_t size)
+{
+	struct tablet_dispatch *tablet = tablet_dispatch(dispatch);
+	struct libinput *li = tablet_libinput_context(tablet);
+	struct libinput_tablet_tool *tool;
+	struct tablet_tool_state *states;
+
+	if (size % sizeof(*states) != 0)
+		return false;
+
+	states = zalloc(size);
+	memcpy(states, buf, size);
+	free(tablet->saved_tools);
+	tablet->saved_tools = states;
+	tablet->nsaved_tools = size / sizeof(*states);
+
+	/* Tools that were already seen, e.g. in proximity when the
+	 * device was added */
+	ptr_array_for_each(tool, &tablet->tools)
+		tool_restore_state(tablet, tool);
+	list_for_each(tool, &li->tool_list, link)
+		tool_restore_state(tablet, tool);
+
+	return true;
+}
+
 static struct evdev_dispatch_interface tablet_interface = {
 	.process = tablet_process,
+	.process_frame = tablet_process_frame,
 	.suspend = tablet_suspend,
 	.remove = NULL,
 	.destroy = tablet_destroy,
 	.device_added = tablet_device_added,
+	.pair_tags = EVDEV_TAG_EXTERNAL_TOUCHPAD,
+	.pair_seat_caps = EVDEV_DEVICE_TOUCH,
 	.device_removed = tablet_device_removed,
 	.device_suspended = NULL,
 	.device_resumed = NULL,
@@ -2233,6 +2462,9 @@ static struct evdev_dispatch_interface tablet_interface = {
 	.touch_arbitration_update_rect = NULL,
 	.get_switch_state = NULL,
 	.left_handed_toggle = tablet_left_handed_toggled,
+	.memory_usage = tablet_memory_usage,
+	.save_state = tablet_save_state,
+	.restore_state = tablet_restore_state,
 };
 
 static void
@@ -2267,6 +2499,72 @@ tablet_init_proximity_threshold(struct tablet_dispatch *tablet,
 	tablet->cursor_proximity_threshold = 42;
 }
 
+/* The same for all tools, each tool gets a copy in
+ * tool_set_pressure_thresholds() */
+static void
+tablet_init_pressure_threshold(struct tablet_dispatch *tablet,
+			       struct evdev_device *device)
+{
+	const struct input_absinfo *pressure;
+	struct quirks_context *quirks = NULL;
+	struct quirks *q = NULL;
+	struct quirk_range r;
+	int lo = 0, hi = 1;
+
+	pressure = libevdev_get_abs_info(device->evdev, ABS_PRESSURE);
+	if (!pressure)
+		goto out;
+
+	quirks = evdev_libinput_context(device)->quirks;
+	q = quirks_fetch_for_device(quirks, device->udev_device);
+
+	/* 5 and 1% of the pressure range */
+	hi = axis_range_percentage(pressure, 5);
+	lo = axis_range_percentage(pressure, 1);
+
+	if (q && quirks_get_range(q, QUIRK_ATTR_PRESSURE_RANGE, &r)) {
+		if (r.lower >= r.upper) {
+			evdev_log_info(device,
+				       "Invalid pressure range, using defaults\n");
+		} else {
+			hi = r.upper;
+			lo = r.lower;
+		}
+	}
+out:
+	tablet->pressure_threshold.upper = hi;
+	tablet->pressure_threshold.lower = lo;
+
+	quirks_unref(q);
+}
+
+static void
+tablet_init_smoothing(struct tablet_dispatch *tablet,
+		      struct evdev_device *device)
+{
+	struct quirks_context *quirks;
+	struct quirks *q;
+	uint32_t length;
+
+	tablet->history.length = TABLET_HISTORY_LENGTH;
+
+	quirks = evdev_libinput_context(device)->quirks;
+	q = quirks_fetch_for_device(quirks, device->udev_device);
+	if (!q)
+		return;
+
+	if (quirks_get_uint32(q, QUIRK_ATTR_TABLET_SMOOTHING_WINDOW, &length)) {
+		if (length < 1 || length > TABLET_HISTORY_MAX_LENGTH) {
+			evdev_log_bug_client(device,
+					     "ignoring invalid smoothing window %u\n",
+					     length);
+		} else {
+			tablet->history.length = length;
+		}
+	}
+	quirks_unref(q);
+}
+
 static uint32_t
 tablet_accel_config_get_profiles(struct libinput_device *libinput_device)
 {
@@ -2365,7 +2663,7 @@ tablet_init(struct tablet_dispatch *tablet,
 	tablet->device = device;
 	tablet->status = TABLET_NONE;
 	tablet->current_tool.type = LIBINPUT_TOOL_NONE;
-	list_init(&tablet->tool_list);
+	ptr_array_init(&tablet->tools);
 
 	if (tablet_reject_device(device))
 		return -1;
@@ -2384,6 +2682,8 @@ tablet_init(struct tablet_dispatch *tablet,
 
 	tablet_init_calibration(tablet, device);
 	tablet_init_proximity_threshold(tablet, device);
+	tablet_init_pressure_threshold(tablet, device);
+	tablet_init_smoothing(tablet, device);
 	rc = tablet_init_accel(tablet, device);
 	if (rc != 0)
 		return rc;
@@ -2410,6 +2710,8 @@ tablet_init(struct tablet_dispatch *tablet,
 			    "proxout",
 			    tablet_proximity_out_quirk_timer_func,
 			    tablet);
+	libinput_timer_set_slack(&tablet->quirks.prox_out_timer,
+				 FORCED_PROXOUT_TIMEOUT_SLACK);
 
 	return 0;
 }
@@ -2426,7 +2728,7 @@ evdev_tablet_create(struct evdev_device *device)
 	if (getenv("LIBINPUT_RUNNING_TEST_SUITE"))
 		FORCED_PROXOUT_TIMEOUT = 150 * 1000; /* µs */
 
-	tablet = zalloc(sizeof *tablet);
+	tablet = mem_zalloc(sizeof *tablet);
 
 	if (tablet_init(tablet, device) != 0) {
 		tablet_destroy(&tablet->base);
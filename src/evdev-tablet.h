@@ -31,7 +31,8 @@
 #define LIBINPUT_TOOL_NONE 0
 #define LIBINPUT_TABLET_TOOL_TYPE_MAX LIBINPUT_TABLET_TOOL_TYPE_LENS
 
-#define TABLET_HISTORY_LENGTH 4
+#define TABLET_HISTORY_LENGTH 4 /* default, see AttrTabletSmoothingWindow */
+#define TABLET_HISTORY_MAX_LENGTH 32
 
 enum tablet_status {
 	TABLET_NONE			= 0,
@@ -53,6 +54,8 @@ struct button_state {
 	unsigned char bits[NCHARS(KEY_CNT)];
 };
 
+struct tablet_tool_state;
+
 struct tablet_dispatch {
 	struct evdev_dispatch base;
 	struct evdev_device *device;
@@ -63,7 +66,13 @@ struct tablet_dispatch {
 	struct {
 		unsigned int index;
 		unsigned int count;
-		struct tablet_axes samples[TABLET_HISTORY_LENGTH];
+		unsigned int length; /* the smoothing window */
+		/* Running sums of the samples in the window */
+		struct {
+			int64_t x, y;
+			double tilt_x, tilt_y;
+		} sum;
+		struct tablet_axes samples[TABLET_HISTORY_MAX_LENGTH];
 	} history;
 
 	unsigned char axis_caps[NCHARS(LIBINPUT_TABLET_TOOL_AXIS_MAX + 1)];
@@ -71,7 +80,16 @@ struct tablet_dispatch {
 	int prev_value[LIBINPUT_TABLET_TOOL_AXIS_MAX + 1];
 
 	/* Only used for tablets that don't report serial numbers */
-	struct list tool_list;
+	struct ptr_array tools; /* struct libinput_tablet_tool */
+
+	/* From libinput_device_restore_state(), applied to matching tools
+	 * when they are created */
+	struct tablet_tool_state *saved_tools;
+	size_t nsaved_tools;
+	/* The tools that were in proximity of this tablet, only the type,
+	 * serial and tool_id are set */
+	struct tablet_tool_state *seen_tools;
+	size_t nseen_tools;
 
 	struct button_state button_state;
 	struct button_state prev_button_state;
@@ -86,12 +104,16 @@ struct tablet_dispatch {
 	} current_tool;
 
 	uint32_t cursor_proximity_threshold;
+	/* copied into each tool, see tool_set_pressure_thresholds() */
+	struct threshold pressure_threshold;
 
 	struct libinput_device_config_calibration calibration;
 
 	/* The paired touch device on devices with both pen & touch */
 	struct evdev_device *touch_device;
 	enum evdev_arbitration_state arbitration;
+	/* the last rect sent to the touch device */
+	struct phys_rect arbitration_rect;
 
 	struct {
 		/* The device locked for rotation */
@@ -107,6 +129,9 @@ struct tablet_dispatch {
 		struct libinput_timer prox_out_timer;
 		bool proximity_out_forced;
 		uint64_t last_event_time;
+		/* The timer expired during tip contact or a button press
+		 * and is re-armed by the first frame without either */
+		bool prox_out_deferred;
 	} quirks;
 };
 
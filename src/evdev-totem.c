@@ -32,7 +32,6 @@ enum totem_slot_state {
 };
 
 struct totem_slot {
-	bool dirty;
 	unsigned int index;
 	enum totem_slot_state state;
 	struct libinput_tablet_tool *tool;
@@ -49,6 +48,8 @@ struct totem_dispatch {
 	int slot; /* current slot */
 	struct totem_slot *slots;
 	size_t nslots;
+	unsigned long *dirty_slots; /* slots with events in this frame */
+	unsigned long *active_slots; /* slots with state != SLOT_STATE_NONE */
 
 	struct evdev_device *touch_device;
 
@@ -215,10 +216,12 @@ totem_process_abs(struct totem_dispatch *totem,
 	case ABS_MT_TRACKING_ID:
 		/* If the totem is already down on init, we currently
 		   ignore it */
-		if (e->value >= 0)
+		if (e->value >= 0) {
 			slot->state = SLOT_STATE_BEGIN;
-		else if (slot->state != SLOT_STATE_NONE)
+			long_set_bit(totem->active_slots, totem->slot);
+		} else if (slot->state != SLOT_STATE_NONE) {
 			slot->state = SLOT_STATE_END;
+		}
 		break;
 	case ABS_MT_POSITION_X:
 		set_bit(slot->changed_axes, LIBINPUT_TABLET_TOOL_AXIS_X);
@@ -249,8 +252,10 @@ totem_process_abs(struct totem_dispatch *totem,
 		evdev_log_info(device,
 			       "Unhandled ABS event code %#x\n",
 			       e->code);
-		break;
+		return;
 	}
+
+	long_set_bit(totem->dirty_slots, totem->slot);
 }
 
 static bool
@@ -315,7 +320,7 @@ totem_slot_fetch_axes(struct totem_dispatch *totem,
 
 	delta.x = slot->axes.point.x - slot->last_point.x;
 	delta.y = slot->axes.point.y - slot->last_point.y;
-	axes.delta = filter_dispatch(device->pointer.filter, &delta, tool, time);
+	axes.delta = evdev_filter_dispatch(device, &delta, tool, time);
 
 	rc = true;
 out:
@@ -485,21 +490,60 @@ totem_handle_slot_state(struct totem_dispatch *totem,
 	return slot->state;
 }
 
+static inline bool
+totem_has_pending_state(struct totem_dispatch *totem)
+{
+	if (totem->button_state_now != totem->button_state_previous)
+		return true;
+
+	for (size_t w = 0; w < NLONGS(totem->nslots); w++) {
+		if (totem->dirty_slots[w])
+			return true;
+	}
+
+	return false;
+}
+
 static enum totem_slot_state
 totem_handle_state(struct totem_dispatch *totem,
 		   uint64_t time)
 {
 	enum totem_slot_state global_state = SLOT_STATE_NONE;
 
-	for (size_t i = 0; i < totem->nslots; i++) {
-		enum totem_slot_state s;
+	/* The button is sent with the first active slot, that one needs
+	 * to be handled even if it didn't change */
+	if (totem->button_state_now != totem->button_state_previous) {
+		for (size_t w = 0; w < NLONGS(totem->nslots); w++) {
+			unsigned long active = totem->active_slots[w];
 
-		s = totem_handle_slot_state(totem,
-					    &totem->slots[i],
-					    time);
+			if (active) {
+				totem->dirty_slots[w] |= active & -active;
+				break;
+			}
+		}
+	}
+
+	/* Only the slots that changed in this frame, in slot order */
+	for (size_t w = 0; w < NLONGS(totem->nslots); w++) {
+		unsigned long dirty = totem->dirty_slots[w];
+
+		totem->dirty_slots[w] = 0;
+		while (dirty) {
+			size_t i = w * LONG_BITS + __builtin_ctzl(dirty);
+			enum totem_slot_state s;
+
+			dirty &= dirty - 1;
+			s = totem_handle_slot_state(totem,
+						    &totem->slots[i],
+						    time);
+			if (s == SLOT_STATE_NONE)
+				long_clear_bit(totem->active_slots, i);
+		}
+	}
 
-		/* If one slot is active, the totem is active */
-		if (s != SLOT_STATE_NONE)
+	/* If one slot is active, the totem is active */
+	for (size_t w = 0; w < NLONGS(totem->nslots); w++) {
+		if (totem->active_slots[w])
 			global_state = SLOT_STATE_UPDATE;
 	}
 
@@ -527,6 +571,10 @@ totem_interface_process(struct evdev_dispatch *dispatch,
 		/* timestamp, ignore */
 		break;
 	case EV_SYN:
+		/* Nothing changed, the touch arbitration is still correct */
+		if (!totem_has_pending_state(totem))
+			break;
+
 		global_state = totem_handle_state(totem, time);
 		enable_touch = (global_state == SLOT_STATE_NONE);
 		totem_set_touch_device_enabled(totem,
@@ -602,8 +650,16 @@ totem_interface_destroy(struct evdev_dispatch *dispatch)
 {
 	struct totem_dispatch *totem = totem_dispatch(dispatch);
 
-	free(totem->slots);
-	free(totem);
+	mem_free(totem);
+}
+
+static size_t
+totem_interface_memory_usage(struct evdev_dispatch *dispatch)
+{
+	struct totem_dispatch *totem = totem_dispatch(dispatch);
+
+	return sizeof(*totem) + totem->nslots * sizeof(*totem->slots) +
+		2 * NLONGS(totem->nslots) * sizeof(long);
 }
 
 static void
@@ -688,6 +744,7 @@ totem_interface_initial_proximity(struct evdev_device *device,
 				  slot->changed_axes,
 				  &axes);
 		slot->state = SLOT_STATE_UPDATE;
+		long_set_bit(totem->active_slots, i);
 		enable_touch = false;
 	}
 
@@ -707,6 +764,7 @@ struct evdev_dispatch_interface totem_interface = {
 	.touch_arbitration_toggle = NULL,
 	.touch_arbitration_update_rect = NULL,
 	.get_switch_state = NULL,
+	.memory_usage = totem_interface_memory_usage,
 };
 
 static bool
@@ -800,7 +858,7 @@ evdev_totem_create(struct evdev_device *device)
 	if (totem_reject_device(device))
 		return NULL;
 
-	totem = zalloc(sizeof *totem);
+	totem = mem_zalloc(sizeof *totem);
 	totem->device = device;
 	totem->base.dispatch_type = DISPATCH_TOTEM;
 	totem->base.interface = &totem_interface;
@@ -810,7 +868,7 @@ evdev_totem_create(struct evdev_device *device)
 		goto error;
 
 	totem->slot = libevdev_get_current_slot(device->evdev);
-	slots = zalloc(num_slots * sizeof(*totem->slots));
+	slots = arena_zalloc(&device->arena, num_slots * sizeof(*totem->slots));
 
 	for (int slot = 0; slot < num_slots; ++slot) {
 		slots[slot].index = slot;
@@ -818,6 +876,10 @@ evdev_totem_create(struct evdev_device *device)
 
 	totem->slots = slots;
 	totem->nslots = num_slots;
+	totem->dirty_slots = arena_zalloc(&device->arena,
+					  NLONGS(num_slots) * sizeof(long));
+	totem->active_slots = arena_zalloc(&device->arena,
+					   NLONGS(num_slots) * sizeof(long));
 
 	evdev_init_sendevents(device, &totem->base);
 	totem_init_accel(totem, device);
@@ -30,19 +30,21 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include "linux/input.h"
 #include <unistd.h>
 #include <fcntl.h>
-#include <mtdev-plumbing.h>
 #include <assert.h>
 #include <math.h>
+#include <pthread.h>
 
 #include "libinput.h"
 #include "evdev.h"
 #include "filter.h"
 #include "libinput-private.h"
 #include "quirks.h"
+#include "util-device-group.h"
 #include "util-input-event.h"
 
 #if HAVE_LIBWACOM
@@ -88,17 +90,32 @@ static const struct evdev_udev_tag_match evdev_udev_tag_matches[] = {
 	{"ID_INPUT_SWITCH",		EVDEV_UDEV_TAG_SWITCH},
 };
 
+struct evdev_udev_prop_match {
+	const char *name;
+	enum evdev_udev_prop prop;
+};
+
+static const struct evdev_udev_prop_match evdev_udev_prop_matches[] = {
+	{"MOUSE_DPI",				EVDEV_UDEV_PROP_MOUSE_DPI},
+	{"MOUSE_WHEEL_CLICK_ANGLE",		EVDEV_UDEV_PROP_WHEEL_CLICK_ANGLE},
+	{"MOUSE_WHEEL_CLICK_COUNT",		EVDEV_UDEV_PROP_WHEEL_CLICK_COUNT},
+	{"MOUSE_WHEEL_CLICK_ANGLE_HORIZONTAL",	EVDEV_UDEV_PROP_HWHEEL_CLICK_ANGLE},
+	{"MOUSE_WHEEL_CLICK_COUNT_HORIZONTAL",	EVDEV_UDEV_PROP_HWHEEL_CLICK_COUNT},
+	{"MOUSE_WHEEL_TILT_VERTICAL",		EVDEV_UDEV_PROP_WHEEL_TILT_VERTICAL},
+	{"MOUSE_WHEEL_TILT_HORIZONTAL",		EVDEV_UDEV_PROP_WHEEL_TILT_HORIZONTAL},
+	{"LIBINPUT_CALIBRATION_MATRIX",		EVDEV_UDEV_PROP_CALIBRATION},
+	{"LIBINPUT_MODEL_LENOVO_X220_TOUCHPAD_FW81", EVDEV_UDEV_PROP_LENOVO_X220_FW81},
+	{"LIBINPUT_TEST_DEVICE",		EVDEV_UDEV_PROP_TEST_DEVICE},
+	{"ID_INPUT_TOUCHPAD_INTEGRATION",	EVDEV_UDEV_PROP_TOUCHPAD_INTEGRATION},
+	{"LIBINPUT_DEVICE_GROUP",		EVDEV_UDEV_PROP_DEVICE_GROUP},
+	{"LIBINPUT_TEST_TABLET_PAD_SYSFS_PATH",	EVDEV_UDEV_PROP_TABLET_PAD_SYSFS_PATH},
+};
+
 static inline bool
 parse_udev_flag(struct evdev_device *device,
-		struct udev_device *udev_device,
-		const char *property)
+		const char *property,
+		const char *val)
 {
-	const char *val;
-
-	val = udev_device_get_property_value(udev_device, property);
-	if (!val)
-		return false;
-
 	if (streq(val, "1"))
 		return true;
 	if (!streq(val, "0"))
@@ -109,6 +126,156 @@ parse_udev_flag(struct evdev_device *device,
 	return false;
 }
 
+static uint32_t
+evdev_parse_udev_tag(struct evdev_device *device,
+		     const char *name,
+		     const char *value)
+{
+	const struct evdev_udev_tag_match *match;
+	uint32_t tags = 0;
+
+	ARRAY_FOR_EACH(evdev_udev_tag_matches, match) {
+		if (streq(name, match->name) &&
+		    parse_udev_flag(device, name, value))
+			tags |= match->tag;
+	}
+
+	return tags;
+}
+
+static void
+evdev_parse_udev_fuzz(struct evdev_device *device,
+		      struct evdev_udev_props *props,
+		      const char *code_str,
+		      const char *value)
+{
+	unsigned int code;
+	int fuzz;
+
+	if (strlen(code_str) != 2 ||
+	    !safe_atou_base(code_str, &code, 16) ||
+	    code >= ABS_CNT)
+		return;
+
+	if (!safe_atoi(value, &fuzz) || fuzz < 0) {
+		evdev_log_bug_libinput(device,
+				       "invalid LIBINPUT_FUZZ property value: %s\n",
+				       value);
+		fuzz = -1;
+	}
+
+	props->fuzz_present |= 1ULL << code;
+	props->fuzz[code] = fuzz;
+}
+
+static void
+evdev_parse_udev_prop(struct evdev_device *device,
+		      struct evdev_udev_props *props,
+		      enum evdev_udev_prop prop,
+		      const char *name,
+		      const char *value)
+{
+	props->present |= prop;
+
+	switch (prop) {
+	case EVDEV_UDEV_PROP_MOUSE_DPI:
+		props->mouse_dpi = parse_mouse_dpi_property(value);
+		break;
+	case EVDEV_UDEV_PROP_WHEEL_CLICK_ANGLE:
+		props->wheel_click_angle =
+			parse_mouse_wheel_click_angle_property(value);
+		break;
+	case EVDEV_UDEV_PROP_WHEEL_CLICK_COUNT:
+		props->wheel_click_count =
+			parse_mouse_wheel_click_angle_property(value);
+		break;
+	case EVDEV_UDEV_PROP_HWHEEL_CLICK_ANGLE:
+		props->hwheel_click_angle =
+			parse_mouse_wheel_click_angle_property(value);
+		break;
+	case EVDEV_UDEV_PROP_HWHEEL_CLICK_COUNT:
+		props->hwheel_click_count =
+			parse_mouse_wheel_click_angle_property(value);
+		break;
+	case EVDEV_UDEV_PROP_CALIBRATION:
+		props->calibration_valid =
+			parse_calibration_property(value, props->calibration);
+		break;
+	case EVDEV_UDEV_PROP_TOUCHPAD_INTEGRATION:
+		props->touchpad_integration = value;
+		break;
+	case EVDEV_UDEV_PROP_DEVICE_GROUP:
+		props->device_group = value;
+		break;
+	case EVDEV_UDEV_PROP_TABLET_PAD_SYSFS_PATH:
+		props->tablet_pad_sysfs_path = value;
+		break;
+	case EVDEV_UDEV_PROP_WHEEL_TILT_VERTICAL:
+	case EVDEV_UDEV_PROP_WHEEL_TILT_HORIZONTAL:
+	case EVDEV_UDEV_PROP_LENOVO_X220_FW81:
+	case EVDEV_UDEV_PROP_TEST_DEVICE:
+		if (parse_udev_flag(device, name, value))
+			props->flags |= prop;
+		break;
+	}
+}
+
+/* Walks the udev properties once and stores the parsed values of the
+ * ones we care about, the readers below only look at the snapshot */
+static void
+evdev_read_udev_props(struct evdev_device *device)
+{
+	struct evdev_udev_props *props = &device->udev_props;
+	struct udev_device *parent;
+	struct udev_list_entry *entry;
+	const struct evdev_udev_prop_match *match;
+
+	memset(props, 0, sizeof(*props));
+
+	udev_list_entry_foreach(entry,
+				udev_device_get_properties_list_entry(device->udev_device)) {
+		const char *name = udev_list_entry_get_name(entry);
+		const char *value = udev_list_entry_get_value(entry);
+
+		if (!name || !value)
+			continue;
+
+		if (strneq(name, "ID_INPUT", 8))
+			props->tags |= evdev_parse_udev_tag(device, name, value);
+
+		if (strneq(name, "LIBINPUT_FUZZ_", 14)) {
+			evdev_parse_udev_fuzz(device, props, name + 14, value);
+			continue;
+		}
+
+		ARRAY_FOR_EACH(evdev_udev_prop_matches, match) {
+			if (streq(name, match->name)) {
+				evdev_parse_udev_prop(device,
+						      props,
+						      match->prop,
+						      name,
+						      value);
+				break;
+			}
+		}
+	}
+
+	parent = udev_device_get_parent(device->udev_device);
+	if (!parent)
+		return;
+
+	udev_list_entry_foreach(entry,
+				udev_device_get_properties_list_entry(parent)) {
+		const char *name = udev_list_entry_get_name(entry);
+		const char *value = udev_list_entry_get_value(entry);
+
+		if (name && value && strneq(name, "ID_INPUT", 8))
+			props->parent_tags |= evdev_parse_udev_tag(device,
+								   name,
+								   value);
+	}
+}
+
 int
 evdev_update_key_down_count(struct evdev_device *device,
 			    int code,
@@ -118,10 +285,10 @@ evdev_update_key_down_count(struct evdev_device *device,
 	assert(code >= 0 && code < KEY_CNT);
 
 	if (pressed) {
-		key_count = ++device->key_count[code];
+		key_count = key_count_inc(&device->key_count, code);
 	} else {
-		assert(device->key_count[code] > 0);
-		key_count = --device->key_count[code];
+		assert(key_count_get(&device->key_count, code) > 0);
+		key_count = key_count_dec(&device->key_count, code);
 	}
 
 	if (key_count > 32) {
@@ -311,10 +478,35 @@ evdev_device_led_update(struct evdev_device *device, enum libinput_led leds)
 	};
 	struct input_event ev[ARRAY_LENGTH(map) + 1];
 	unsigned int i;
+	bool changed = !device->leds.valid || device->leds.state != leds;
 
 	if (!(device->seat_caps & EVDEV_DEVICE_KEYBOARD))
 		return;
 
+	/* Skip the write if we already wrote this state and the kernel
+	 * agrees. Callers tend to update all keyboards on every lock key,
+	 * the write is a round-trip into the driver each time. */
+	for (i = 0; !changed && i < ARRAY_LENGTH(map); i++) {
+		int value;
+
+		if (!libevdev_has_event_code(device->evdev,
+					     EV_LED,
+					     map[i].evdev))
+			continue;
+
+		value = libevdev_get_event_value(device->evdev,
+						 EV_LED,
+						 map[i].evdev);
+		if (!!value != !!(leds & map[i].libinput))
+			changed = true;
+	}
+
+	if (!changed)
+		return;
+
+	device->leds.valid = true;
+	device->leds.state = leds;
+
 	memset(ev, 0, sizeof(ev));
 	for (i = 0; i < ARRAY_LENGTH(map); i++) {
 		ev[i].type = EV_LED;
@@ -332,10 +524,10 @@ void
 evdev_transform_absolute(struct evdev_device *device,
 			 struct device_coords *point)
 {
-	if (!device->abs.apply_calibration)
+	if (!device->abs.apply_transform)
 		return;
 
-	matrix_mult_vec(&device->abs.calibration, &point->x, &point->y);
+	matrix_mult_vec(&device->abs.transform, &point->x, &point->y);
 }
 
 void
@@ -374,6 +566,23 @@ evdev_device_transform_y(struct evdev_device *device,
 	return scale_axis(device->abs.absinfo_y, y, height);
 }
 
+int
+evdev_device_set_output_size(struct evdev_device *device,
+			     uint32_t width,
+			     uint32_t height)
+{
+	if (!device->abs.absinfo_x || !device->abs.absinfo_y)
+		return -1;
+
+	if (width == 0 || height == 0)
+		width = height = 0;
+
+	device->abs.output.width = width;
+	device->abs.output.height = height;
+
+	return 0;
+}
+
 void
 evdev_notify_axis(struct evdev_device *device,
 		  uint64_t time,
@@ -426,7 +635,7 @@ evdev_tag_trackpoint(struct evdev_device *device,
 
 	if (!libevdev_has_property(device->evdev,
 				  INPUT_PROP_POINTING_STICK) &&
-	    !parse_udev_flag(device, udev_device, "ID_INPUT_POINTINGSTICK"))
+	    !(device->udev_props.tags & EVDEV_UDEV_TAG_POINTINGSTICK))
 		return;
 
 	device->tags |= EVDEV_TAG_TRACKPOINT;
@@ -502,11 +711,13 @@ evdev_tag_keyboard(struct evdev_device *device,
 	device->tags |= EVDEV_TAG_KEYBOARD;
 }
 
+#if HAVE_TOUCHPAD
 static void
 evdev_tag_tablet_touchpad(struct evdev_device *device)
 {
 	device->tags |= EVDEV_TAG_TABLET_TOUCHPAD;
 }
+#endif
 
 static int
 evdev_calibration_has_matrix(struct libinput_device *libinput_device)
@@ -611,7 +822,8 @@ evdev_left_handed_set(struct libinput_device *device, int left_handed)
 
 	evdev->left_handed.want_enabled = left_handed ? true : false;
 
-	evdev->left_handed.change_to_enabled(evdev);
+	if (!evdev_config_deferred(evdev))
+		evdev->left_handed.change_to_enabled(evdev);
 
 	return LIBINPUT_CONFIG_STATUS_SUCCESS;
 }
@@ -659,7 +871,8 @@ evdev_scroll_set_method(struct libinput_device *device,
 	struct evdev_device *evdev = evdev_device(device);
 
 	evdev->scroll.want_method = method;
-	evdev->scroll.change_scroll_method(evdev);
+	if (!evdev_config_deferred(evdev))
+		evdev->scroll.change_scroll_method(evdev);
 
 	return LIBINPUT_CONFIG_STATUS_SUCCESS;
 }
@@ -699,7 +912,8 @@ evdev_scroll_set_button(struct libinput_device *device,
 	struct evdev_device *evdev = evdev_device(device);
 
 	evdev->scroll.want_button = button;
-	evdev->scroll.change_scroll_method(evdev);
+	if (!evdev_config_deferred(evdev))
+		evdev->scroll.change_scroll_method(evdev);
 
 	return LIBINPUT_CONFIG_STATUS_SUCCESS;
 }
@@ -751,7 +965,8 @@ evdev_scroll_set_button_lock(struct libinput_device *device,
 		return LIBINPUT_CONFIG_STATUS_INVALID;
 	}
 
-	evdev->scroll.change_scroll_method(evdev);
+	if (!evdev_config_deferred(evdev))
+		evdev->scroll.change_scroll_method(evdev);
 
 	return LIBINPUT_CONFIG_STATUS_SUCCESS;
 }
@@ -885,8 +1100,8 @@ evdev_init_natural_scroll(struct evdev_device *device)
 	device->base.config.natural_scroll = &device->scroll.config_natural;
 }
 
-int
-evdev_need_mtdev(struct evdev_device *device)
+bool
+evdev_is_protocol_a_device(struct evdev_device *device)
 {
 	struct libevdev *evdev = device->evdev;
 
@@ -978,34 +1193,162 @@ evdev_process_event(struct evdev_device *device, struct input_event *e)
 	evdev_print_event(device, e);
 #endif
 
-	libinput_timer_flush(evdev_libinput_context(device), time);
+	struct libinput *libinput = evdev_libinput_context(device);
+	enum libinput_profile_stage outer;
+
+	/* All events of a frame carry the same timestamp. Flushing the
+	 * timers before its first event handles anything that expired
+	 * before the frame, and no timer callback runs between the
+	 * events of a frame */
+	if (!device->in_frame) {
+		libinput_timer_flush(libinput, time);
+		device->in_frame = true;
+	}
+
+	tracepoint(process_start,
+		   evdev_device_get_sysname(device),
+		   dispatch->dispatch_type,
+		   e->type,
+		   e->code,
+		   time);
 
+	outer = libinput_profile_enter(libinput,
+				       evdev_dispatch_profile_stage(dispatch));
 	dispatch->interface->process(dispatch, device, e, time);
+	libinput_profile_leave(libinput, outer);
+
+	if (libevdev_event_is_code(e, EV_SYN, SYN_REPORT))
+		device->in_frame = false;
+
+	tracepoint(process_end,
+		   evdev_device_get_sysname(device),
+		   dispatch->dispatch_type);
 }
 
 static inline void
 evdev_device_dispatch_one(struct evdev_device *device,
 			  struct input_event *ev)
 {
-	if (!device->mtdev) {
-		evdev_process_event(device, ev);
-	} else {
-		mtdev_put_event(device->mtdev, ev);
-		if (libevdev_event_is_code(ev, EV_SYN, SYN_REPORT)) {
-			while (!mtdev_empty(device->mtdev)) {
-				struct input_event e;
-				mtdev_get_event(device->mtdev, &e);
-				evdev_process_event(device, &e);
-			}
-		}
+	evdev_process_event(device, ev);
+}
+
+/* Hand a complete frame to a dispatch that implements process_frame().
+ * The last event is the frame's SYN_REPORT */
+static inline void
+evdev_process_frame(struct evdev_device *device,
+		    struct input_event *events,
+		    size_t nevents)
+{
+	struct evdev_dispatch *dispatch = device->dispatch;
+	struct libinput *libinput = evdev_libinput_context(device);
+	uint64_t time = input_event_time(&events[nevents - 1]);
+	enum libinput_profile_stage outer;
+
+	/* The rest of a frame split across two reads, its start was
+	 * processed event by event and has already flushed the timers */
+	if (!device->in_frame)
+		libinput_timer_flush(libinput, time);
+
+	tracepoint(process_start,
+		   evdev_device_get_sysname(device),
+		   dispatch->dispatch_type,
+		   EV_SYN,
+		   SYN_REPORT,
+		   time);
+
+	outer = libinput_profile_enter(libinput,
+				       evdev_dispatch_profile_stage(dispatch));
+	dispatch->interface->process_frame(dispatch, device,
+					   events, nevents, time);
+	libinput_profile_leave(libinput, outer);
+
+	device->in_frame = false;
+
+	tracepoint(process_end,
+		   evdev_device_get_sysname(device),
+		   dispatch->dispatch_type);
+}
+
+/* Events a frame may contain and still be merged into the next one:
+ * absolute axes, where the later value wins, and relative motion,
+ * which the fallback dispatch sums up */
+static inline bool
+evdev_event_is_positional(const struct input_event *ev)
+{
+	switch (ev->type) {
+	case EV_ABS:
+		return ev->code != ABS_MT_TRACKING_ID;
+	case EV_REL:
+		return ev->code == REL_X || ev->code == REL_Y;
+	case EV_MSC:
+		return ev->code == MSC_TIMESTAMP;
+	default:
+		return false;
 	}
 }
 
+/* A frame that only moves things can be skipped when we're well behind
+ * and the next frame is already in the read buffer, it supersedes this
+ * one anyway. The state machines only run on the merged frame. */
+static inline bool
+evdev_frame_can_catch_up(struct evdev_device *device,
+			 const struct input_event *syn_report)
+{
+	struct libinput *libinput = evdev_libinput_context(device);
+	uint64_t now = libinput_now(libinput);
+	uint64_t time = input_event_time(syn_report);
+
+	if (time + EVDEV_CATCH_UP_LAG > now)
+		return false;
+
+	for (size_t i = device->readbuf.head; i < device->readbuf.count; i++) {
+		const struct input_event *ev = &device->readbuf.events[i];
+
+		if (ev->type != EV_SYN)
+			continue;
+
+		if (ev->code == SYN_REPORT)
+			return true;
+		if (ev->code == SYN_DROPPED)
+			return false;
+	}
+
+	return false;
+}
+
+/* Process the collected start of a frame event by event, the rest of
+ * the frame is still in the kernel */
+static inline void
+evdev_flush_partial_frame(struct evdev_device *device,
+			  size_t frame_head,
+			  size_t *frame_len)
+{
+	for (size_t i = 0; i < *frame_len; i++) {
+		/* suspended by one of the events */
+		if (!device->readbuf.events)
+			break;
+		evdev_device_dispatch_one(device,
+					  &device->readbuf.events[frame_head + i]);
+	}
+
+	*frame_len = 0;
+}
+
+/**
+ * Apply libevdev's sync events on top of whatever is left of the frame
+ * that was interrupted by the SYN_DROPPED. libevdev's state already
+ * includes that partial frame, so the sync events are exactly the
+ * difference to the device's real state, and its terminating
+ * SYN_REPORT commits both in one frame.
+ *
+ * @return the number of events processed, or a negative errno
+ */
 static int
 evdev_sync_device(struct evdev_device *device)
 {
 	struct input_event ev;
 	int rc;
+	int nevents = 0;
 
 	do {
 		rc = libevdev_next_event(device->evdev,
@@ -1013,48 +1356,451 @@ evdev_sync_device(struct evdev_device *device)
 		if (rc < 0)
 			break;
 		evdev_device_dispatch_one(device, &ev);
+		nevents++;
 	} while (rc == LIBEVDEV_READ_STATUS_SYNC);
 
-	return rc == -EAGAIN ? 0 : rc;
+	return rc == -EAGAIN ? nevents : rc;
+}
+
+/**
+ * libevdev_set_event_value() only updates libevdev's state, it doesn't
+ * sanitize the event like libevdev_next_event() does. Do the same here:
+ * clamp an ABS_MT_SLOT beyond the slot count and drop a tracking id
+ * change that doesn't change whether the slot is active.
+ *
+ * @return false if the event should be dropped
+ */
+static inline bool
+evdev_sanitize_mt_event(struct evdev_device *device,
+			struct input_event *e)
+{
+	int nslots = libevdev_get_num_slots(device->evdev);
+	int slot, tracking_id;
+
+	if (nslots <= 0)
+		return true;
+
+	switch (e->code) {
+	case ABS_MT_SLOT:
+		if (e->value < 0 || e->value >= nslots) {
+			evdev_log_bug_kernel(device,
+					     "invalid slot %d, max %d\n",
+					     e->value,
+					     nslots - 1);
+			e->value = nslots - 1;
+		}
+		break;
+	case ABS_MT_TRACKING_ID:
+		slot = libevdev_get_current_slot(device->evdev);
+		tracking_id = libevdev_get_slot_value(device->evdev,
+						      slot,
+						      ABS_MT_TRACKING_ID);
+		if ((e->value == -1) == (tracking_id == -1))
+			return false;
+		break;
+	}
+
+	return true;
+}
+
+/**
+ * We read from the fd directly rather than through libevdev_next_event()
+ * but libevdev's view of the device state must stay correct, we rely on
+ * it elsewhere and libevdev needs it to sync after a SYN_DROPPED.
+ *
+ * @return true if the event should be processed, false if libevdev would
+ * have filtered it
+ */
+static inline bool
+evdev_update_libevdev_state(struct evdev_device *device,
+			    struct input_event *e)
+{
+	switch (e->type) {
+	case EV_SYN:
+		return true;
+	case EV_ABS:
+		if (!libevdev_has_event_code(device->evdev, e->type, e->code))
+			return false;
+		if (!evdev_sanitize_mt_event(device, e))
+			return false;
+		return libevdev_set_event_value(device->evdev,
+						e->type,
+						e->code,
+						e->value) == 0;
+	case EV_KEY:
+	case EV_LED:
+	case EV_SW:
+		return libevdev_set_event_value(device->evdev,
+						e->type,
+						e->code,
+						e->value) == 0;
+	default:
+		return libevdev_has_event_code(device->evdev,
+					       e->type,
+					       e->code);
+	}
+}
+
+static inline void
+evdev_drop_read_buffer(struct evdev_device *device)
+{
+	device->readbuf.events = NULL;
+	device->readbuf.head = 0;
+	device->readbuf.count = 0;
+}
+
+static int
+evdev_fill_read_buffer(struct evdev_device *device)
+{
+	struct libinput *libinput = evdev_libinput_context(device);
+	void *buf;
+	ssize_t len;
+
+	/* suspended while processing the previous buffer */
+	if (!device->source)
+		return -ENODEV;
+
+	len = libinput_source_read(libinput, device->source, &buf);
+	if (len < 0)
+		return len;
+
+	/* evdev only ever gives us whole events */
+	if (len == 0 || len % sizeof(struct input_event) != 0)
+		return -EIO;
+
+	device->readbuf.events = buf;
+	device->readbuf.head = 0;
+	device->readbuf.count = len / sizeof(struct input_event);
+
+	if (libinput->evdev_tap.records)
+		libinput_evdev_tap_push(libinput,
+					&device->base,
+					device->readbuf.events,
+					device->readbuf.count);
+
+	return 0;
+}
+
+static int
+evdev_handle_syn_dropped(struct evdev_device *device,
+			 struct input_event *ev)
+{
+	struct input_event sync;
+	int rc;
+
+	tracepoint(syn_dropped, evdev_device_get_sysname(device));
+	libinput_device_stat_inc(&device->base, LIBINPUT_DEVICE_STAT_SYN_DROPPED);
+
+	evdev_log_info_ratelimit(device,
+				 &device->syn_drop_limit,
+				 input_event_time(ev),
+				 "SYN_DROPPED event - some input events have been lost.\n");
+
+	/* anything after the SYN_DROPPED is stale, libevdev
+	   drains the fd and gives us the current state instead */
+	evdev_drop_read_buffer(device);
+	libevdev_next_event(device->evdev,
+			    LIBEVDEV_READ_FLAG_FORCE_SYNC,
+			    &sync);
+
+	rc = evdev_sync_device(device);
+	if (rc < 0)
+		return rc;
+
+	/* Nothing changed while events were lost, libevdev doesn't send
+	 * a frame then. Terminate the interrupted frame ourselves. */
+	if (rc == 0) {
+		ev->code = SYN_REPORT;
+		evdev_device_dispatch_one(device, ev);
+	}
+
+	return 0;
+}
+
+static inline void
+evdev_count_event(struct evdev_device *device,
+		  const struct input_event *ev)
+{
+	libinput_device_stat_inc(&device->base,
+				 LIBINPUT_DEVICE_STAT_EVDEV_EVENTS);
+	if (ev->type == EV_SYN && ev->code == SYN_REPORT)
+		libinput_device_stat_inc(&device->base,
+					 LIBINPUT_DEVICE_STAT_EVDEV_FRAMES);
+}
+
+static inline void
+evdev_record_latency(struct evdev_device *device,
+		     const struct input_event *ev,
+		     uint64_t now)
+{
+	uint64_t time = input_event_time(ev);
+
+	histogram_add(&device->base.latency, now > time ? now - time : 0);
+}
+
+/* With merge set, only the next frame in the read buffer is processed
+ * and the fd is not read, see evdev_device_merge_peek() */
+static void
+evdev_device_dispatch_frames(struct evdev_device *device, bool merge)
+{
+	struct libinput *libinput = evdev_libinput_context(device);
+	unsigned int budget = libinput->dispatch_budget;
+	unsigned int frames = 0;
+	unsigned int nevents = 0;
+	struct input_event *ev;
+	enum libinput_profile_stage outer;
+	uint64_t now = 0;
+	bool process;
+	/* Dispatch interfaces with process_frame() get whole frames. The
+	 * events of the current frame that passed libevdev are moved
+	 * together in the read buffer, starting at frame_head. */
+	bool by_frame = device->dispatch->interface->process_frame != NULL;
+	size_t frame_head = device->readbuf.head;
+	size_t frame_len = 0;
+	bool frame_positional = true;
+	int rc = 0;
+
+	if (merge && device->base.latency_tracking)
+		now = libinput_now_fresh(libinput);
+
+	/* If the compositor is repainting, this function is called only once
+	 * per frame and we have to process all the events available on the
+	 * fd, otherwise there will be input lag. The exception is when the
+	 * caller set a dispatch budget or deadline, then we stop after that
+	 * many frames or once the time is up and get resumed first in the
+	 * next libinput_dispatch(). Events left in the read buffer are
+	 * picked up again on resume.
+	 */
+	while (true) {
+		if (device->readbuf.head == device->readbuf.count) {
+			/* the next read overwrites the buffer */
+			evdev_flush_partial_frame(device, frame_head, &frame_len);
+			frame_positional = true;
+
+			if (merge) {
+				rc = -EAGAIN;
+				break;
+			}
+
+			outer = libinput_profile_enter(libinput,
+						       LIBINPUT_PROFILE_STAGE_LIBEVDEV);
+			rc = evdev_fill_read_buffer(device);
+			libinput_profile_leave(libinput, outer);
+			if (rc != 0)
+				break;
+			frame_head = 0;
+
+			if (device->base.latency_tracking)
+				now = libinput_now_fresh(libinput);
+		}
+
+		ev = &device->readbuf.events[device->readbuf.head++];
+		nevents++;
+		evdev_count_event(device, ev);
+
+		if (ev->type == EV_SYN && ev->code == SYN_DROPPED) {
+			evdev_flush_partial_frame(device, frame_head, &frame_len);
+			frame_positional = true;
+			rc = evdev_handle_syn_dropped(device, ev);
+			if (rc != 0)
+				break;
+			frame_head = device->readbuf.head;
+			continue;
+		}
+
+		outer = libinput_profile_enter(libinput,
+					       LIBINPUT_PROFILE_STAGE_LIBEVDEV);
+		process = evdev_update_libevdev_state(device, ev);
+		libinput_profile_leave(libinput, outer);
+		if (!process)
+			continue;
+
+		if (!by_frame) {
+			evdev_device_dispatch_one(device, ev);
+		} else {
+			/* never ahead of ev, at most ev itself */
+			device->readbuf.events[frame_head + frame_len++] = *ev;
+			if (ev->type != EV_SYN || ev->code != SYN_REPORT) {
+				if (!evdev_event_is_positional(ev))
+					frame_positional = false;
+				continue;
+			}
+
+			/* Catching up on a backlog: drop the SYN_REPORT and
+			 * let the next frame's events land on top of this
+			 * one's */
+			if (frame_positional &&
+			    evdev_frame_can_catch_up(device, ev)) {
+				frame_len--;
+				continue;
+			}
+
+			evdev_process_frame(device,
+					    &device->readbuf.events[frame_head],
+					    frame_len);
+			frame_head = device->readbuf.head;
+			frame_len = 0;
+			frame_positional = true;
+		}
+
+		if (now && ev->type == EV_SYN && ev->code == SYN_REPORT)
+			evdev_record_latency(device, ev, now);
+
+		/* the caller keeps track of the budget and deadline */
+		if (merge && ev->type == EV_SYN && ev->code == SYN_REPORT) {
+			tracepoint(device_drain,
+				   evdev_device_get_sysname(device),
+				   nevents);
+			return;
+		}
+
+		if (device->source &&
+		    ev->type == EV_SYN && ev->code == SYN_REPORT &&
+		    ((budget && ++frames >= budget) ||
+		     libinput_dispatch_deadline_reached(libinput))) {
+			libinput_source_set_pending(libinput,
+						    device->source);
+			tracepoint(device_drain,
+				   evdev_device_get_sysname(device),
+				   nevents);
+			return;
+		}
+	}
+
+	tracepoint(device_drain, evdev_device_get_sysname(device), nevents);
+
+	if (device->source && rc != -EAGAIN && rc != -EINTR) {
+		libinput_remove_source(libinput, device->source);
+		device->source = NULL;
+	}
 }
 
 static void
 evdev_device_dispatch(void *data)
+{
+	evdev_device_dispatch_frames(data, false);
+}
+
+static void
+evdev_device_merge_dispatch(void *data)
+{
+	evdev_device_dispatch_frames(data, true);
+}
+
+/* For libinput_set_frame_merging(): read the fd if the read buffer is
+ * used up and return the time of the next complete frame in the read
+ * buffer. A frame split across two reads and read errors need
+ * evdev_device_dispatch(). */
+static int
+evdev_device_merge_peek(void *data, uint64_t *time)
 {
 	struct evdev_device *device = data;
 	struct libinput *libinput = evdev_libinput_context(device);
-	struct input_event ev;
+	enum libinput_profile_stage outer;
 	int rc;
 
-	/* If the compositor is repainting, this function is called only once
-	 * per frame and we have to process all the events available on the
-	 * fd, otherwise there will be input lag. */
-	do {
-		rc = libevdev_next_event(device->evdev,
-					 LIBEVDEV_READ_FLAG_NORMAL, &ev);
-		if (rc == LIBEVDEV_READ_STATUS_SYNC) {
-			evdev_log_info_ratelimit(device,
-						 &device->syn_drop_limit,
-						 "SYN_DROPPED event - some input events have been lost.\n");
-
-			/* send one more sync event so we handle all
-			   currently pending events before we sync up
-			   to the current state */
-			ev.code = SYN_REPORT;
-			evdev_device_dispatch_one(device, &ev);
-
-			rc = evdev_sync_device(device);
-			if (rc == 0)
-				rc = LIBEVDEV_READ_STATUS_SUCCESS;
-		} else if (rc == LIBEVDEV_READ_STATUS_SUCCESS) {
-			evdev_device_dispatch_one(device, &ev);
-		}
-	} while (rc == LIBEVDEV_READ_STATUS_SUCCESS);
+	if (device->readbuf.head == device->readbuf.count) {
+		outer = libinput_profile_enter(libinput,
+					       LIBINPUT_PROFILE_STAGE_LIBEVDEV);
+		rc = evdev_fill_read_buffer(device);
+		libinput_profile_leave(libinput, outer);
+		if (rc == -EAGAIN || rc == -EINTR)
+			return 0;
+		if (rc != 0)
+			return -1;
+	}
+
+	for (size_t i = device->readbuf.head; i < device->readbuf.count; i++) {
+		const struct input_event *ev = &device->readbuf.events[i];
+
+		if (ev->type == EV_SYN &&
+		    (ev->code == SYN_REPORT || ev->code == SYN_DROPPED)) {
+			*time = input_event_time(&device->readbuf.events[device->readbuf.head]);
+			return 1;
+		}
+	}
+
+	return -1;
+}
+
+static struct libinput_source *
+evdev_device_add_source(struct evdev_device *device, int fd)
+{
+	struct libinput *libinput = evdev_libinput_context(device);
+	struct libinput_source *source;
+
+	source = libinput_add_fd(libinput, fd, evdev_device_dispatch, device);
+	if (!source)
+		return NULL;
+
+	libinput_source_set_read_buffer(source,
+					EVDEV_READ_BUFFER_SIZE *
+					sizeof(struct input_event));
+	libinput_source_set_merge(source,
+				  evdev_device_merge_peek,
+				  evdev_device_merge_dispatch);
+	libinput_source_set_low_priority(source, device->low_priority);
+
+	return source;
+}
+
+void
+evdev_device_set_low_priority(struct evdev_device *device,
+			      bool low_priority)
+{
+	device->low_priority = low_priority;
+
+	/* A suspended device picks it up when it is resumed */
+	if (device->source)
+		libinput_source_set_low_priority(device->source,
+						 low_priority);
+}
+
+/**
+ * Stop reading from the device node, the caller pushes the events in
+ * with evdev_device_replay_event() instead. The fd stays open, libevdev
+ * and the dispatch interfaces still need it for ioctls.
+ */
+void
+evdev_device_set_replay(struct evdev_device *device)
+{
+	struct libinput *libinput = evdev_libinput_context(device);
+
+	device->replay = true;
+
+	if (device->source) {
+		libinput_remove_source(libinput, device->source);
+		device->source = NULL;
+	}
+}
+
+void
+evdev_device_replay_event(struct evdev_device *device,
+			  struct input_event *ev)
+{
+	struct libinput *libinput = evdev_libinput_context(device);
+	enum libinput_profile_stage outer;
+	bool process;
+
+	/* suspended */
+	if (device->fd == -1)
+		return;
+
+	evdev_count_event(device, ev);
 
-	if (rc != -EAGAIN && rc != -EINTR) {
-		libinput_remove_source(libinput, device->source);
-		device->source = NULL;
-	}
+	/* There is no kernel buffer we could sync from, the best we can do
+	 * is to terminate the current frame */
+	if (ev->type == EV_SYN && ev->code == SYN_DROPPED)
+		ev->code = SYN_REPORT;
+
+	outer = libinput_profile_enter(libinput,
+				       LIBINPUT_PROFILE_STAGE_LIBEVDEV);
+	process = evdev_update_libevdev_state(device, ev);
+	libinput_profile_leave(libinput, outer);
+	if (!process)
+		return;
+
+	evdev_device_dispatch_one(device, ev);
 }
 
 static inline bool
@@ -1065,6 +1811,12 @@ evdev_init_accel(struct evdev_device *device,
 
 	if (which == LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT)
 		filter = create_pointer_accelerator_filter_flat(device->dpi);
+	else if (which == LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM)
+		filter = create_pointer_accelerator_filter_custom(device->dpi,
+								  device->use_velocity_averaging,
+								  device->pointer.custom->step,
+								  device->pointer.custom->points,
+								  device->pointer.custom->npoints);
 	else if (device->tags & EVDEV_TAG_TRACKPOINT)
 		filter = create_pointer_accelerator_filter_trackpoint(device->trackpoint_multiplier,
 								      device->use_velocity_averaging);
@@ -1125,41 +1877,110 @@ evdev_accel_config_get_profiles(struct libinput_device *libinput_device)
 		return LIBINPUT_CONFIG_ACCEL_PROFILE_NONE;
 
 	return LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE |
-		LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT;
+		LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT |
+		LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM;
 }
 
-static enum libinput_config_status
-evdev_accel_config_set_profile(struct libinput_device *libinput_device,
-			       enum libinput_config_accel_profile profile)
+/* Replace the filter with a new one for the given profile, keeping the
+ * speed and the motion history */
+static bool
+evdev_accel_rebuild(struct evdev_device *device,
+		    enum libinput_config_accel_profile profile)
 {
-	struct evdev_device *device = evdev_device(libinput_device);
 	struct motion_filter *filter;
 	double speed;
 
 	filter = device->pointer.filter;
-	if (filter_get_type(filter) == profile)
-		return LIBINPUT_CONFIG_STATUS_SUCCESS;
-
 	speed = filter_get_speed(filter);
 	device->pointer.filter = NULL;
 
-	if (evdev_init_accel(device, profile)) {
-		evdev_accel_config_set_speed(libinput_device, speed);
-		filter_destroy(filter);
-	} else {
+	if (!evdev_init_accel(device, profile)) {
 		device->pointer.filter = filter;
+		device->pointer.want_profile = filter_get_type(filter);
+		return false;
+	}
+
+	evdev_accel_config_set_speed(&device->base, speed);
+	filter_copy_history(device->pointer.filter, filter);
+	filter_destroy(filter);
+
+	return true;
+}
+
+static enum libinput_config_status
+evdev_accel_config_set_profile(struct libinput_device *libinput_device,
+			       enum libinput_config_accel_profile profile)
+{
+	struct evdev_device *device = evdev_device(libinput_device);
+
+	device->pointer.want_profile = profile;
+	if (evdev_config_deferred(device))
+		return LIBINPUT_CONFIG_STATUS_SUCCESS;
+
+	if (filter_get_type(device->pointer.filter) == profile)
+		return LIBINPUT_CONFIG_STATUS_SUCCESS;
+
+	if (!evdev_accel_rebuild(device, profile))
 		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+
+	return LIBINPUT_CONFIG_STATUS_SUCCESS;
+}
+
+static enum libinput_config_status
+evdev_accel_config_set_custom_curve(struct libinput_device *libinput_device,
+				    double step,
+				    const double *points,
+				    size_t npoints)
+{
+	struct evdev_device *device = evdev_device(libinput_device);
+
+	device->pointer.custom->step = step;
+	device->pointer.custom->npoints = npoints;
+	memcpy(device->pointer.custom->points,
+	       points,
+	       npoints * sizeof(*points));
+
+	if (evdev_config_deferred(device)) {
+		device->pointer.custom_changed = true;
+		return LIBINPUT_CONFIG_STATUS_SUCCESS;
 	}
 
+	if (filter_get_type(device->pointer.filter) !=
+	    LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM)
+		return LIBINPUT_CONFIG_STATUS_SUCCESS;
+
+	/* Rebuild the filter so the new curve takes effect now */
+	if (!evdev_accel_rebuild(device, LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM))
+		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+
 	return LIBINPUT_CONFIG_STATUS_SUCCESS;
 }
 
+/* Build the filter for the profile and curve set during a configuration
+ * transaction, at most once */
+static void
+evdev_accel_commit(struct evdev_device *device)
+{
+	enum libinput_config_accel_profile profile = device->pointer.want_profile;
+	bool custom_changed = device->pointer.custom_changed;
+
+	device->pointer.custom_changed = false;
+
+	if (filter_get_type(device->pointer.filter) == profile &&
+	    (profile != LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM || !custom_changed))
+		return;
+
+	evdev_accel_rebuild(device, profile);
+}
+
 static enum libinput_config_accel_profile
 evdev_accel_config_get_profile(struct libinput_device *libinput_device)
 {
 	struct evdev_device *device = evdev_device(libinput_device);
 
-	return filter_get_type(device->pointer.filter);
+	/* return the wanted configuration, even if it hasn't taken
+	 * effect yet! */
+	return device->pointer.want_profile;
 }
 
 static enum libinput_config_accel_profile
@@ -1170,7 +1991,10 @@ evdev_accel_config_get_default_profile(struct libinput_device *libinput_device)
 	if (!device->pointer.filter)
 		return LIBINPUT_CONFIG_ACCEL_PROFILE_NONE;
 
-	/* No device has a flat profile as default */
+	/* The host already accelerated the motion of a virtual device */
+	if (device->model_flags & EVDEV_MODEL_VIRTUAL_DEVICE)
+		return LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT;
+
 	return LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE;
 }
 
@@ -1179,6 +2003,7 @@ evdev_device_init_pointer_acceleration(struct evdev_device *device,
 				       struct motion_filter *filter)
 {
 	device->pointer.filter = filter;
+	device->pointer.want_profile = filter_get_type(filter);
 
 	if (device->base.config.accel == NULL) {
 		double default_speed;
@@ -1191,8 +2016,17 @@ evdev_device_init_pointer_acceleration(struct evdev_device *device,
 		device->pointer.config.set_profile = evdev_accel_config_set_profile;
 		device->pointer.config.get_profile = evdev_accel_config_get_profile;
 		device->pointer.config.get_default_profile = evdev_accel_config_get_default_profile;
+		device->pointer.config.set_custom_curve = evdev_accel_config_set_custom_curve;
 		device->base.config.accel = &device->pointer.config;
 
+		/* The default custom curve is 1:1 movement */
+		device->pointer.custom = arena_zalloc(&device->arena,
+						      sizeof(*device->pointer.custom));
+		device->pointer.custom->step = 1.0;
+		device->pointer.custom->npoints = 2;
+		device->pointer.custom->points[0] = 0.0;
+		device->pointer.custom->points[1] = 1.0;
+
 		default_speed = evdev_accel_config_get_default_speed(&device->base);
 		evdev_accel_config_set_speed(&device->base, default_speed);
 	}
@@ -1200,17 +2034,14 @@ evdev_device_init_pointer_acceleration(struct evdev_device *device,
 
 static inline bool
 evdev_read_wheel_click_prop(struct evdev_device *device,
-			    const char *prop,
+			    enum evdev_udev_prop prop,
+			    int val,
 			    double *angle)
 {
-	int val;
-
 	*angle = DEFAULT_WHEEL_CLICK_ANGLE;
-	prop = udev_device_get_property_value(device->udev_device, prop);
-	if (!prop)
+	if (!(device->udev_props.present & prop))
 		return false;
 
-	val = parse_mouse_wheel_click_angle_property(prop);
 	if (val) {
 		*angle = val;
 		return true;
@@ -1226,16 +2057,13 @@ evdev_read_wheel_click_prop(struct evdev_device *device,
 
 static inline bool
 evdev_read_wheel_click_count_prop(struct evdev_device *device,
-				  const char *prop,
+				  enum evdev_udev_prop prop,
+				  int val,
 				  double *angle)
 {
-	int val;
-
-	prop = udev_device_get_property_value(device->udev_device, prop);
-	if (!prop)
+	if (!(device->udev_props.present & prop))
 		return false;
 
-	val = parse_mouse_wheel_click_angle_property(prop);
 	if (val) {
 		*angle = 360.0/val;
 		return true;
@@ -1254,19 +2082,28 @@ static inline struct wheel_angle
 evdev_read_wheel_click_props(struct evdev_device *device)
 {
 	struct wheel_angle angles;
-	const char *wheel_count = "MOUSE_WHEEL_CLICK_COUNT";
-	const char *wheel_angle = "MOUSE_WHEEL_CLICK_ANGLE";
-	const char *hwheel_count = "MOUSE_WHEEL_CLICK_COUNT_HORIZONTAL";
-	const char *hwheel_angle = "MOUSE_WHEEL_CLICK_ANGLE_HORIZONTAL";
+	const struct evdev_udev_props *props = &device->udev_props;
 
 	/* CLICK_COUNT overrides CLICK_ANGLE */
-	if (evdev_read_wheel_click_count_prop(device, wheel_count, &angles.y) ||
-	    evdev_read_wheel_click_prop(device, wheel_angle, &angles.y)) {
+	if (evdev_read_wheel_click_count_prop(device,
+					      EVDEV_UDEV_PROP_WHEEL_CLICK_COUNT,
+					      props->wheel_click_count,
+					      &angles.y) ||
+	    evdev_read_wheel_click_prop(device,
+					EVDEV_UDEV_PROP_WHEEL_CLICK_ANGLE,
+					props->wheel_click_angle,
+					&angles.y)) {
 		evdev_log_debug(device,
 				"wheel: vert click angle: %.2f\n", angles.y);
 	}
-	if (evdev_read_wheel_click_count_prop(device, hwheel_count, &angles.x) ||
-	    evdev_read_wheel_click_prop(device, hwheel_angle, &angles.x)) {
+	if (evdev_read_wheel_click_count_prop(device,
+					      EVDEV_UDEV_PROP_HWHEEL_CLICK_COUNT,
+					      props->hwheel_click_count,
+					      &angles.x) ||
+	    evdev_read_wheel_click_prop(device,
+					EVDEV_UDEV_PROP_HWHEEL_CLICK_ANGLE,
+					props->hwheel_click_angle,
+					&angles.x)) {
 		evdev_log_debug(device,
 				"wheel: horizontal click angle: %.2f\n", angles.y);
 	} else {
@@ -1281,13 +2118,10 @@ evdev_read_wheel_tilt_props(struct evdev_device *device)
 {
 	struct wheel_tilt_flags flags;
 
-	flags.vertical = parse_udev_flag(device,
-					 device->udev_device,
-					 "MOUSE_WHEEL_TILT_VERTICAL");
-
-	flags.horizontal = parse_udev_flag(device,
-					 device->udev_device,
-					 "MOUSE_WHEEL_TILT_HORIZONTAL");
+	flags.vertical = !!(device->udev_props.flags &
+			    EVDEV_UDEV_PROP_WHEEL_TILT_VERTICAL);
+	flags.horizontal = !!(device->udev_props.flags &
+			      EVDEV_UDEV_PROP_WHEEL_TILT_HORIZONTAL);
 	return flags;
 }
 
@@ -1346,19 +2180,40 @@ evdev_need_velocity_averaging(struct evdev_device *device)
 	return use_velocity_averaging;
 }
 
+/* Switches and tablet pads send few events and none of them need to
+ * be processed immediately, the quirk overrides that either way */
+static inline bool
+evdev_read_low_priority(struct evdev_device *device)
+{
+	struct quirks_context *quirks;
+	struct quirks *q;
+	char *prop;
+	bool low_priority;
+
+	low_priority = device->seat_caps == EVDEV_DEVICE_SWITCH ||
+		       (device->seat_caps & EVDEV_DEVICE_TABLET_PAD);
+
+	quirks = evdev_libinput_context(device)->quirks;
+	q = quirks_fetch_for_device(quirks, device->udev_device);
+	if (q) {
+		if (quirks_get_string(q, QUIRK_ATTR_DISPATCH_PRIORITY, &prop))
+			low_priority = streq(prop, "low");
+		quirks_unref(q);
+	}
+
+	return low_priority;
+}
+
 static inline int
 evdev_read_dpi_prop(struct evdev_device *device)
 {
-	const char *mouse_dpi;
 	int dpi = DEFAULT_MOUSE_DPI;
 
 	if (device->tags & EVDEV_TAG_TRACKPOINT)
 		return DEFAULT_MOUSE_DPI;
 
-	mouse_dpi = udev_device_get_property_value(device->udev_device,
-						   "MOUSE_DPI");
-	if (mouse_dpi) {
-		dpi = parse_mouse_dpi_property(mouse_dpi);
+	if (device->udev_props.present & EVDEV_UDEV_PROP_MOUSE_DPI) {
+		dpi = device->udev_props.mouse_dpi;
 		if (!dpi) {
 			evdev_log_error(device,
 					"mouse DPI property is present but invalid, "
@@ -1389,6 +2244,7 @@ evdev_read_model_flags(struct evdev_device *device)
 		MODEL(TRACKBALL),
 		MODEL(APPLE_TOUCHPAD_ONEBUTTON),
 		MODEL(LENOVO_SCROLLPOINT),
+		MODEL(VIRTUAL_DEVICE),
 #undef MODEL
 		{ 0, 0 },
 	};
@@ -1427,9 +2283,7 @@ evdev_read_model_flags(struct evdev_device *device)
 
 	quirks_unref(q);
 
-	if (parse_udev_flag(device,
-			    device->udev_device,
-			    "ID_INPUT_TRACKBALL")) {
+	if (device->udev_props.tags & EVDEV_UDEV_TAG_TRACKBALL) {
 		evdev_log_debug(device, "tagged as trackball\n");
 		model_flags |= EVDEV_MODEL_TRACKBALL;
 	}
@@ -1439,15 +2293,12 @@ evdev_read_model_flags(struct evdev_device *device)
 	 * one of the few udev properties that wasn't reserved for private
 	 * usage, so we need to keep this for backwards compat.
 	 */
-	if (parse_udev_flag(device,
-			    device->udev_device,
-			    "LIBINPUT_MODEL_LENOVO_X220_TOUCHPAD_FW81")) {
+	if (device->udev_props.flags & EVDEV_UDEV_PROP_LENOVO_X220_FW81) {
 		evdev_log_debug(device, "tagged as trackball\n");
 		model_flags |= EVDEV_MODEL_LENOVO_X220_TOUCHPAD_FW81;
 	}
 
-	if (parse_udev_flag(device, device->udev_device,
-			    "LIBINPUT_TEST_DEVICE")) {
+	if (device->udev_props.flags & EVDEV_UDEV_PROP_TEST_DEVICE) {
 		evdev_log_debug(device, "is a test device\n");
 		model_flags |= EVDEV_MODEL_TEST_DEVICE;
 	}
@@ -1553,26 +2404,10 @@ evdev_fix_abs_resolution(struct evdev_device *device,
 	return xres == EVDEV_FAKE_RESOLUTION;
 }
 
-static enum evdev_device_udev_tags
-evdev_device_get_udev_tags(struct evdev_device *device,
-			   struct udev_device *udev_device)
+static inline enum evdev_device_udev_tags
+evdev_device_get_udev_tags(struct evdev_device *device)
 {
-	enum evdev_device_udev_tags tags = 0;
-	int i;
-
-	for (i = 0; i < 2 && udev_device; i++) {
-		unsigned j;
-		for (j = 0; j < ARRAY_LENGTH(evdev_udev_tag_matches); j++) {
-			const struct evdev_udev_tag_match match = evdev_udev_tag_matches[j];
-			if (parse_udev_flag(device,
-					    udev_device,
-					    match.name))
-				tags |= match.tag;
-		}
-		udev_device = udev_device_get_parent(udev_device);
-	}
-
-	return tags;
+	return device->udev_props.tags | device->udev_props.parent_tags;
 }
 
 static inline void
@@ -1760,9 +2595,11 @@ evdev_configure_device(struct evdev_device *device)
 	struct libevdev *evdev = device->evdev;
 	enum evdev_device_udev_tags udev_tags;
 	unsigned int tablet_tags;
+#if HAVE_TOUCHPAD || HAVE_TABLET
 	struct evdev_dispatch *dispatch;
+#endif
 
-	udev_tags = evdev_device_get_udev_tags(device, device->udev_device);
+	udev_tags = evdev_device_get_udev_tags(device);
 
 	if ((udev_tags & EVDEV_UDEV_TAG_INPUT) == 0 ||
 	    (udev_tags & ~EVDEV_UDEV_TAG_INPUT) == 0) {
@@ -1820,10 +2657,16 @@ evdev_configure_device(struct evdev_device *device)
 
 	if (evdev_device_has_model_quirk(device,
 					 QUIRK_MODEL_DELL_CANVAS_TOTEM)) {
+#if HAVE_TABLET
 		dispatch = evdev_totem_create(device);
 		device->seat_caps |= EVDEV_DEVICE_TABLET;
 		evdev_log_info(device, "device is a totem\n");
 		return dispatch;
+#else
+		evdev_log_info(device,
+			       "device is a totem, tablet support is disabled\n");
+		return NULL;
+#endif
 	}
 
 	/* libwacom assigns touchpad (or touchscreen) _and_ tablet to the
@@ -1835,19 +2678,31 @@ evdev_configure_device(struct evdev_device *device)
 
 	/* libwacom assigns tablet _and_ tablet_pad to the pad devices */
 	if (udev_tags & EVDEV_UDEV_TAG_TABLET_PAD) {
+#if HAVE_TABLET
 		dispatch = evdev_tablet_pad_create(device);
 		device->seat_caps |= EVDEV_DEVICE_TABLET_PAD;
 		evdev_log_info(device, "device is a tablet pad\n");
 		return dispatch;
-
+#else
+		evdev_log_info(device,
+			       "device is a tablet pad, tablet support is disabled\n");
+		return NULL;
+#endif
 	} else if ((udev_tags & tablet_tags) == EVDEV_UDEV_TAG_TABLET) {
+#if HAVE_TABLET
 		dispatch = evdev_tablet_create(device);
 		device->seat_caps |= EVDEV_DEVICE_TABLET;
 		evdev_log_info(device, "device is a tablet\n");
 		return dispatch;
+#else
+		evdev_log_info(device,
+			       "device is a tablet, tablet support is disabled\n");
+		return NULL;
+#endif
 	}
 
 	if (udev_tags & EVDEV_UDEV_TAG_TOUCHPAD) {
+#if HAVE_TOUCHPAD
 		if (udev_tags & EVDEV_UDEV_TAG_TABLET)
 			evdev_tag_tablet_touchpad(device);
 		/* whether velocity should be averaged, false by default */
@@ -1855,6 +2710,11 @@ evdev_configure_device(struct evdev_device *device)
 		dispatch = evdev_mt_touchpad_create(device);
 		evdev_log_info(device, "device is a touchpad\n");
 		return dispatch;
+#else
+		evdev_log_info(device,
+			       "device is a touchpad, touchpad support is disabled\n");
+		return NULL;
+#endif
 	}
 
 	if (udev_tags & EVDEV_UDEV_TAG_MOUSE ||
@@ -1922,7 +2782,10 @@ evdev_configure_device(struct evdev_device *device)
 	if (device->seat_caps & EVDEV_DEVICE_POINTER &&
 	    libevdev_has_event_code(evdev, EV_REL, REL_X) &&
 	    libevdev_has_event_code(evdev, EV_REL, REL_Y) &&
-	    !evdev_init_accel(device, LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE)) {
+	    !evdev_init_accel(device,
+			      (device->model_flags & EVDEV_MODEL_VIRTUAL_DEVICE) ?
+			      LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT :
+			      LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE)) {
 		evdev_log_error(device,
 				"failed to initialize pointer acceleration\n");
 		return NULL;
@@ -1935,22 +2798,40 @@ evdev_configure_device(struct evdev_device *device)
 	return fallback_dispatch_create(&device->base);
 }
 
+static inline bool
+evdev_device_wants_pairing(struct evdev_device *device,
+			   struct evdev_device *other)
+{
+	struct evdev_dispatch_interface *interface = device->dispatch->interface;
+
+	if (!interface->device_added)
+		return false;
+
+	if (interface->pair_tags == 0 && interface->pair_seat_caps == 0)
+		return true;
+
+	return (other->tags & interface->pair_tags) ||
+	       (other->seat_caps & interface->pair_seat_caps);
+}
+
 static void
 evdev_notify_added_device(struct evdev_device *device)
 {
 	struct libinput_device *dev;
 
+	tracepoint(device_added, evdev_device_get_sysname(device));
+
 	list_for_each(dev, &device->base.seat->devices_list, link) {
 		struct evdev_device *d = evdev_device(dev);
 		if (dev == &device->base)
 			continue;
 
 		/* Notify existing device d about addition of device */
-		if (d->dispatch->interface->device_added)
+		if (evdev_device_wants_pairing(d, device))
 			d->dispatch->interface->device_added(d, device);
 
 		/* Notify new device about existing device d */
-		if (device->dispatch->interface->device_added)
+		if (evdev_device_wants_pairing(device, d))
 			device->dispatch->interface->device_added(device, d);
 
 		/* Notify new device if existing device d is suspended */
@@ -1996,16 +2877,40 @@ evdev_set_device_group(struct evdev_device *device,
 	struct libinput *libinput = evdev_libinput_context(device);
 	struct libinput_device_group *group = NULL;
 	const char *udev_group;
+	char key[1024], computed[1024];
+	bool have_key = false;
 
-	udev_group = udev_device_get_property_value(udev_device,
-						    "LIBINPUT_DEVICE_GROUP");
-	if (udev_group)
+	udev_group = device->udev_props.device_group;
+	if (udev_group) {
 		group = libinput_device_group_find_group(libinput, udev_group);
+	} else if (device_group_key(udev_device, key, sizeof(key))) {
+		/* Without the udev helper we compute the group ourselves,
+		 * once per physical device */
+		have_key = true;
+		group = libinput_device_group_find_key(libinput, key);
+		if (!group) {
+			bool is_wacom = evdev_device_get_id_vendor(device) ==
+					VENDOR_ID_WACOM;
+			void *db = is_wacom ? libinput_libwacom_ref(libinput) : NULL;
+
+			if (device_group_compute(udev_device, db,
+						 computed, sizeof(computed))) {
+				udev_group = computed;
+				group = libinput_device_group_find_group(libinput,
+									 udev_group);
+			}
+
+			if (is_wacom)
+				libinput_libwacom_unref(libinput);
+		}
+	}
 
 	if (!group) {
 		group = libinput_device_group_create(libinput, udev_group);
 		if (!group)
 			return false;
+		if (have_key)
+			group->key = safe_strdup(key);
 		libinput_device_set_device_group(&device->base, group);
 		libinput_device_group_unref(group);
 	} else {
@@ -2026,6 +2931,74 @@ evdev_drain_fd(int fd)
 	}
 }
 
+/* Tell the kernel which events we actually look at. Codes disabled
+ * during configuration (quirks, MSC_TIMESTAMP, the accelerometer axes,
+ * ...) and types we never process are then filtered before they are
+ * copied to our fd rather than read and discarded per event.
+ *
+ * EV_SYN cannot be masked and EV_LED is kept so libevdev's LED state
+ * stays in sync for evdev_device_led_update(). Kernels before 4.4
+ * don't have EVIOCSMASK, failure just means we get all events as
+ * before.
+ *
+ * With the evdev tap enabled the recorder wants the device's full
+ * stream, so everything is unmasked again. The codes we don't use are
+ * then dropped in evdev_update_libevdev_state() as before.
+ */
+void
+evdev_set_kernel_event_mask(struct evdev_device *device)
+{
+	bool unmasked = evdev_libinput_context(device)->evdev_tap.records != NULL;
+	const unsigned int types[] = {
+		EV_KEY, EV_REL, EV_ABS, EV_MSC, EV_SW, EV_LED,
+	};
+	const unsigned int *t;
+	unsigned long typemask[NLONGS(EV_CNT)] = {0};
+	unsigned long codes[NLONGS(KEY_CNT)];
+	struct input_mask mask;
+
+	ARRAY_FOR_EACH(types, t) {
+		int max = libevdev_event_type_get_max(*t);
+
+		if (!libevdev_has_event_type(device->evdev, *t))
+			continue;
+
+		long_set_bit(typemask, *t);
+
+		memset(codes, unmasked ? 0xff : 0, sizeof(codes));
+		for (int code = 0; !unmasked && code <= max; code++) {
+			if (libevdev_has_event_code(device->evdev, *t, code))
+				long_set_bit(codes, code);
+		}
+
+		/* None of the dispatch interfaces use the scancodes */
+		if (*t == EV_MSC && !unmasked)
+			long_clear_bit(codes, MSC_SCAN);
+
+		mask.type = *t;
+		mask.codes_size = NLONGS(max + 1) * sizeof(unsigned long);
+		mask.codes_ptr = (uint64_t)(uintptr_t)codes;
+		if (ioctl(device->fd, EVIOCSMASK, &mask) < 0)
+			goto error;
+	}
+
+	if (unmasked)
+		memset(typemask, 0xff, sizeof(typemask));
+
+	mask.type = EV_SYN;
+	mask.codes_size = sizeof(typemask);
+	mask.codes_ptr = (uint64_t)(uintptr_t)typemask;
+	if (ioctl(device->fd, EVIOCSMASK, &mask) < 0)
+		goto error;
+
+	return;
+
+error:
+	evdev_log_debug(device,
+			"failed to set the kernel event mask: %s\n",
+			strerror(errno));
+}
+
 static inline void
 evdev_pre_configure_model_quirks(struct evdev_device *device)
 {
@@ -2124,7 +3097,7 @@ libevdev_log_func(const struct libevdev *evdev,
 	log_msg_va(libinput, pri, fmt, args);
 }
 
-static bool
+bool
 udev_device_should_be_ignored(struct udev_device *udev_device)
 {
 	const char *value;
@@ -2135,17 +3108,160 @@ udev_device_should_be_ignored(struct udev_device *udev_device)
 	return value && !streq(value, "0");
 }
 
+#define EVDEV_PROBE_MIN_DEVICES 4
+#define EVDEV_PROBE_MAX_THREADS 8
+
+struct evdev_probe_work {
+	struct evdev_probe *probes;
+	size_t nprobes;
+	size_t next;
+};
+
+static void *
+evdev_probe_thread(void *data)
+{
+	struct evdev_probe_work *work = data;
+	size_t idx;
+
+	while ((idx = __atomic_fetch_add(&work->next, 1, __ATOMIC_RELAXED)) <
+	       work->nprobes) {
+		struct evdev_probe *probe = &work->probes[idx];
+		uint64_t start;
+
+		if (probe->fd < 0)
+			continue;
+
+		start = now_in_us();
+		evdev_drain_fd(probe->fd);
+		if (libevdev_new_from_fd(probe->fd, &probe->evdev) != 0)
+			probe->evdev = NULL;
+		probe->libevdev_time = now_in_us() - start;
+	}
+
+	return NULL;
+}
+
+/**
+ * Open the given devices and initialize libevdev for each. The libevdev
+ * initialization is a series of ioctls per device and runs on worker
+ * threads for larger sets of devices. Everything else, i.e.
+ * open_restricted() and the actual device creation in
+ * evdev_device_create(), stays on the caller's thread and in the
+ * caller's order.
+ *
+ * Probes not consumed by evdev_device_create() must be released with
+ * evdev_probe_release().
+ */
+void
+evdev_probe_devices(struct libinput *libinput,
+		    struct evdev_probe *probes,
+		    size_t nprobes)
+{
+	struct evdev_probe_work work = {
+		.probes = probes,
+		.nprobes = nprobes,
+		.next = 0,
+	};
+	pthread_t threads[EVDEV_PROBE_MAX_THREADS];
+	size_t nthreads = 0,
+	       nopened = 0;
+
+	for (size_t i = 0; i < nprobes; i++) {
+		struct evdev_probe *probe = &probes[i];
+		const char *devnode = udev_device_get_devnode(probe->udev_device);
+		uint64_t start;
+
+		probe->fd = -ENODEV;
+		probe->evdev = NULL;
+		probe->open_time = 0;
+		probe->libevdev_time = 0;
+
+		/* evdev_device_create() skips those anyway */
+		if (!devnode ||
+		    udev_device_should_be_ignored(probe->udev_device))
+			continue;
+
+		start = libinput_now_fresh(libinput);
+		probe->fd = open_restricted(libinput, devnode,
+					    O_RDWR | O_NONBLOCK | O_CLOEXEC);
+		probe->open_time = libinput_now_fresh(libinput) - start;
+		if (probe->fd >= 0)
+			nopened++;
+	}
+
+	/* Not worth the threads for a few devices, evdev_device_create()
+	 * initializes libevdev for those */
+	if (nopened < EVDEV_PROBE_MIN_DEVICES)
+		return;
+
+	/* The caller's thread does its share too */
+	while (nthreads < min(nopened / 2 - 1, ARRAY_LENGTH(threads))) {
+		if (pthread_create(&threads[nthreads],
+				   NULL,
+				   evdev_probe_thread,
+				   &work) != 0)
+			break;
+		nthreads++;
+	}
+
+	evdev_probe_thread(&work);
+
+	for (size_t i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+}
+
+void
+evdev_probe_release(struct libinput *libinput,
+		    struct evdev_probe *probe)
+{
+	if (probe->evdev) {
+		libevdev_free(probe->evdev);
+		probe->evdev = NULL;
+	}
+
+	if (probe->fd >= 0) {
+		close_restricted(libinput, probe->fd);
+		probe->fd = -ENODEV;
+	}
+}
+
+static void
+evdev_config_commit(struct libinput_device *libinput_device)
+{
+	struct evdev_device *device = evdev_device(libinput_device);
+	struct evdev_dispatch *dispatch = device->dispatch;
+
+	if (device->pointer.filter)
+		evdev_accel_commit(device);
+
+	if (dispatch->interface->config_commit)
+		dispatch->interface->config_commit(dispatch, device);
+
+	/* These check for buttons down themselves and otherwise take
+	 * effect on the next button release */
+	if (device->left_handed.change_to_enabled)
+		device->left_handed.change_to_enabled(device);
+
+	if (device->scroll.change_scroll_method)
+		device->scroll.change_scroll_method(device);
+}
+
 struct evdev_device *
 evdev_device_create(struct libinput_seat *seat,
-		    struct udev_device *udev_device)
+		    struct udev_device *udev_device,
+		    struct evdev_probe *probe)
 {
 	struct libinput *libinput = seat->libinput;
 	struct evdev_device *device = NULL;
+	struct libevdev *evdev = NULL;
 	int rc;
 	int fd;
 	int unhandled_device = 0;
 	const char *devnode = udev_device_get_devnode(udev_device);
 	const char *sysname = udev_device_get_sysname(udev_device);
+	uint64_t start,
+		 open_time = 0,
+		 libevdev_time = 0;
 
 	if (!devnode) {
 		log_info(libinput, "%s: no device node associated\n", sysname);
@@ -2157,11 +3273,23 @@ evdev_device_create(struct libinput_seat *seat,
 		return NULL;
 	}
 
-	/* Use non-blocking mode so that we can loop on read on
-	 * evdev_device_data() until all events on the fd are
-	 * read.  mtdev_get() also expects this. */
-	fd = open_restricted(libinput, devnode,
-			     O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (probe) {
+		/* We own the probed fd and libevdev from here on */
+		fd = probe->fd;
+		evdev = probe->evdev;
+		open_time = probe->open_time;
+		libevdev_time = probe->libevdev_time;
+		probe->fd = -ENODEV;
+		probe->evdev = NULL;
+	} else {
+		/* Use non-blocking mode so that we can loop on read on
+		 * evdev_device_data() until all events on the fd are
+		 * read. */
+		start = libinput_now_fresh(libinput);
+		fd = open_restricted(libinput, devnode,
+				     O_RDWR | O_NONBLOCK | O_CLOEXEC);
+		open_time = libinput_now_fresh(libinput) - start;
+	}
 	if (fd < 0) {
 		log_info(libinput,
 			 "%s: opening input device '%s' failed (%s).\n",
@@ -2171,19 +3299,38 @@ evdev_device_create(struct libinput_seat *seat,
 		return NULL;
 	}
 
-	if (!evdev_device_have_same_syspath(udev_device, fd))
+	if (!evdev_device_have_same_syspath(udev_device, fd)) {
+		libevdev_free(evdev);
 		goto err;
+	}
 
-	device = zalloc(sizeof *device);
+	device = mem_zalloc(sizeof *device);
 
 	libinput_device_init(&device->base, seat);
 	libinput_seat_ref(seat);
 
-	evdev_drain_fd(fd);
+	libinput_record_startup_time(libinput,
+				     &device->base,
+				     LIBINPUT_STARTUP_PHASE_OPEN,
+				     open_time);
 
-	rc = libevdev_new_from_fd(fd, &device->evdev);
-	if (rc != 0)
-		goto err;
+	if (evdev) {
+		device->evdev = evdev;
+	} else {
+		start = libinput_now_fresh(libinput);
+		evdev_drain_fd(fd);
+
+		rc = libevdev_new_from_fd(fd, &device->evdev);
+		libevdev_time = libinput_now_fresh(libinput) - start;
+		if (rc != 0)
+			goto err;
+	}
+	libinput_record_startup_time(libinput,
+				     &device->base,
+				     LIBINPUT_STARTUP_PHASE_LIBEVDEV,
+				     libevdev_time);
+
+	start = libinput_now_fresh(libinput);
 
 	libevdev_set_clock_id(device->evdev, CLOCK_MONOTONIC);
 	libevdev_set_device_log_function(device->evdev,
@@ -2192,8 +3339,8 @@ evdev_device_create(struct libinput_seat *seat,
 					 libinput);
 	device->seat_caps = 0;
 	device->is_mt = 0;
-	device->mtdev = NULL;
 	device->udev_device = udev_device_ref(udev_device);
+	evdev_read_udev_props(device);
 	device->dispatch = NULL;
 	device->fd = fd;
 	device->devname = libevdev_get_name(device->evdev);
@@ -2206,6 +3353,11 @@ evdev_device_create(struct libinput_seat *seat,
 	device->model_flags = evdev_read_model_flags(device);
 	device->dpi = DEFAULT_MOUSE_DPI;
 
+	/* Only the last position of a virtual absolute pointer matters */
+	if (device->model_flags & EVDEV_MODEL_VIRTUAL_DEVICE)
+		device->base.default_event_coalescing =
+			LIBINPUT_EVENT_COALESCING_POINTER_MOTION_ABSOLUTE;
+
 	/* at most 5 SYN_DROPPED log-messages per 30s */
 	ratelimit_init(&device->syn_drop_limit, s2us(30), 5);
 	/* at most 5 log-messages per 5s */
@@ -2214,27 +3366,42 @@ evdev_device_create(struct libinput_seat *seat,
 	matrix_init_identity(&device->abs.calibration);
 	matrix_init_identity(&device->abs.usermatrix);
 	matrix_init_identity(&device->abs.default_calibration);
+	matrix_init_identity(&device->abs.transform);
 
 	evdev_pre_configure_model_quirks(device);
 
 	device->dispatch = evdev_configure_device(device);
+	libinput_record_startup_time(libinput,
+				     &device->base,
+				     LIBINPUT_STARTUP_PHASE_CONFIGURE,
+				     libinput_now_fresh(libinput) - start);
 	if (device->dispatch == NULL) {
 		if (device->seat_caps == 0)
 			unhandled_device = 1;
 		goto err;
 	}
 
-	device->source =
-		libinput_add_fd(libinput, fd, evdev_device_dispatch, device);
+	device->transaction.commit = evdev_config_commit;
+	device->base.config.transaction = &device->transaction;
+
+	evdev_set_kernel_event_mask(device);
+
+	device->low_priority = evdev_read_low_priority(device);
+	device->source = evdev_device_add_source(device, fd);
 	if (!device->source)
 		goto err;
 
+	start = libinput_now_fresh(libinput);
 	if (!evdev_set_device_group(device, udev_device))
 		goto err;
 
 	list_insert(seat->devices_list.prev, &device->base.link);
 
 	evdev_notify_added_device(device);
+	libinput_record_startup_time(libinput,
+				     &device->base,
+				     LIBINPUT_STARTUP_PHASE_NOTIFY,
+				     libinput_now_fresh(libinput) - start);
 
 	return device;
 
@@ -2276,6 +3443,105 @@ evdev_device_get_id_vendor(struct evdev_device *device)
 	return libevdev_get_id_vendor(device->evdev);
 }
 
+/* The same for a device that is unplugged and plugged back in, unlike
+ * the syspath and the device node. Caller must free the string */
+char *
+evdev_device_get_identity(struct evdev_device *device)
+{
+	struct libevdev *evdev = device->evdev;
+	const char *phys = libevdev_get_phys(evdev);
+	char *identity;
+
+	xasprintf(&identity,
+		  "%04x:%04x:%04x:%04x:%s:%s",
+		  libevdev_get_id_bustype(evdev),
+		  libevdev_get_id_vendor(evdev),
+		  libevdev_get_id_product(evdev),
+		  libevdev_get_id_version(evdev),
+		  device->devname,
+		  phys ? phys : "");
+
+	return identity;
+}
+
+#define EVDEV_STATE_MAGIC 0x4c495354 /* LIST */
+#define EVDEV_STATE_VERSION 1
+
+/* Precedes the dispatch's own state in a libinput_device_save_state()
+ * blob. The blob is never read on a different machine, so everything
+ * is in host byte order */
+struct evdev_state_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t dispatch_type;
+	uint16_t vendor;
+	uint16_t product;
+	uint32_t size; /* of the dispatch state */
+};
+
+size_t
+evdev_device_save_state(struct evdev_device *device, void *buf, size_t size)
+{
+	struct evdev_dispatch *dispatch = device->dispatch;
+	struct evdev_state_header header;
+	const size_t hsize = sizeof(header);
+	char *p = buf;
+	size_t dsize;
+
+	if (!dispatch->interface->save_state)
+		return 0;
+
+	dsize = dispatch->interface->save_state(dispatch,
+						size > hsize ? p + hsize : NULL,
+						size > hsize ? size - hsize : 0);
+	if (dsize == 0)
+		return 0;
+
+	if (size >= hsize + dsize) {
+		header = (struct evdev_state_header) {
+			.magic = EVDEV_STATE_MAGIC,
+			.version = EVDEV_STATE_VERSION,
+			.dispatch_type = dispatch->dispatch_type,
+			.vendor = evdev_device_get_id_vendor(device),
+			.product = evdev_device_get_id_product(device),
+			.size = dsize,
+		};
+		memcpy(p, &header, hsize);
+	}
+
+	return hsize + dsize;
+}
+
+int
+evdev_device_restore_state(struct evdev_device *device,
+			   const void *buf,
+			   size_t size)
+{
+	struct evdev_dispatch *dispatch = device->dispatch;
+	struct evdev_state_header header;
+	const size_t hsize = sizeof(header);
+
+	if (size <= hsize)
+		return -EINVAL;
+
+	memcpy(&header, buf, hsize);
+	if (header.magic != EVDEV_STATE_MAGIC ||
+	    header.version != EVDEV_STATE_VERSION ||
+	    header.dispatch_type != dispatch->dispatch_type ||
+	    header.vendor != evdev_device_get_id_vendor(device) ||
+	    header.product != evdev_device_get_id_product(device) ||
+	    header.size != size - hsize)
+		return -EINVAL;
+
+	if (!dispatch->interface->restore_state ||
+	    !dispatch->interface->restore_state(dispatch,
+						(const char *)buf + hsize,
+						header.size))
+		return -EINVAL;
+
+	return 0;
+}
+
 struct udev_device *
 evdev_device_get_udev_device(struct evdev_device *device)
 {
@@ -2290,6 +3556,41 @@ evdev_device_set_default_calibration(struct evdev_device *device,
 	evdev_device_calibrate(device, calibration);
 }
 
+static void
+evdev_device_update_transform(struct evdev_device *device)
+{
+	const struct input_absinfo *x = device->abs.absinfo_x,
+				   *y = device->abs.absinfo_y;
+	struct matrix rotate;
+
+	device->abs.apply_transform = device->abs.apply_calibration ||
+				      device->abs.rotated;
+
+	if (!device->abs.rotated) {
+		device->abs.transform = device->abs.calibration;
+		return;
+	}
+
+	/* 180 degrees around the center of the axis range:
+	 * x' = max - (x - min), the rotation is applied before the
+	 * calibration */
+	matrix_init_scale(&rotate, -1, -1);
+	rotate.val[0][2] = x->maximum + x->minimum;
+	rotate.val[1][2] = y->maximum + y->minimum;
+
+	matrix_mult(&device->abs.transform, &device->abs.calibration, &rotate);
+}
+
+void
+evdev_device_set_rotated(struct evdev_device *device, bool rotated)
+{
+	if (device->abs.rotated == rotated)
+		return;
+
+	device->abs.rotated = rotated;
+	evdev_device_update_transform(device);
+}
+
 void
 evdev_device_calibrate(struct evdev_device *device,
 		       const float calibration[6])
@@ -2307,6 +3608,7 @@ evdev_device_calibrate(struct evdev_device *device,
 
 	if (!device->abs.apply_calibration) {
 		matrix_init_identity(&device->abs.calibration);
+		evdev_device_update_transform(device);
 		return;
 	}
 
@@ -2352,24 +3654,22 @@ evdev_device_calibrate(struct evdev_device *device,
 
 	/* store final matrix in device */
 	matrix_mult(&device->abs.calibration, &transform, &scale);
+	evdev_device_update_transform(device);
 }
 
 void
 evdev_read_calibration_prop(struct evdev_device *device)
 {
-	const char *prop;
-	float calibration[6];
-
-	prop = udev_device_get_property_value(device->udev_device,
-					      "LIBINPUT_CALIBRATION_MATRIX");
+	const struct evdev_udev_props *props = &device->udev_props;
+	const float *calibration = props->calibration;
 
-	if (prop == NULL)
+	if (!(props->present & EVDEV_UDEV_PROP_CALIBRATION))
 		return;
 
 	if (!device->abs.absinfo_x || !device->abs.absinfo_y)
 		return;
 
-	if (!parse_calibration_property(prop, calibration))
+	if (!props->calibration_valid)
 		return;
 
 	evdev_device_set_default_calibration(device, calibration);
@@ -2386,22 +3686,17 @@ evdev_read_calibration_prop(struct evdev_device *device)
 int
 evdev_read_fuzz_prop(struct evdev_device *device, unsigned int code)
 {
-	const char *prop;
-	char name[32];
-	int rc;
+	const struct evdev_udev_props *props = &device->udev_props;
+	bool have_prop;
 	int fuzz = 0;
 	const struct input_absinfo *abs;
 
-	rc = snprintf(name, sizeof(name), "LIBINPUT_FUZZ_%02x", code);
-	if (rc == -1)
-		return 0;
-
-	prop = udev_device_get_property_value(device->udev_device, name);
-	if (prop && (safe_atoi(prop, &fuzz) == false || fuzz < 0)) {
-		evdev_log_bug_libinput(device,
-				       "invalid LIBINPUT_FUZZ property value: %s\n",
-				       prop);
-		return 0;
+	have_prop = code < ABS_CNT && (props->fuzz_present & (1ULL << code));
+	if (have_prop) {
+		/* invalid values were logged when parsing */
+		if (props->fuzz[code] < 0)
+			return 0;
+		fuzz = props->fuzz[code];
 	}
 
 	/* The udev callout should have set the kernel fuzz to zero.
@@ -2415,7 +3710,7 @@ evdev_read_fuzz_prop(struct evdev_device *device, unsigned int code)
 	if (!abs || abs->fuzz == 0)
 		return fuzz;
 
-	if (prop) {
+	if (have_prop) {
 		evdev_log_bug_libinput(device,
 				       "kernel fuzz of %d even with LIBINPUT_FUZZ_%02x present\n",
 				       abs->fuzz,
@@ -2502,10 +3797,10 @@ evdev_device_get_touch_count(struct evdev_device *device)
 
 	ntouches = libevdev_get_num_slots(device->evdev);
 	if (ntouches == -1) {
-		/* mtdev devices have multitouch but we don't know
+		/* protocol A devices have multitouch but we don't know
 		 * how many. Otherwise, any touch device with num_slots of
 		 * -1 is a single-touch device */
-		if (device->mtdev)
+		if (evdev_is_protocol_a_device(device))
 			ntouches = 0;
 		else
 			ntouches = 1;
@@ -2710,15 +4005,13 @@ evdev_device_suspend(struct evdev_device *device)
 		device->source = NULL;
 	}
 
-	if (device->mtdev) {
-		mtdev_close_delete(device->mtdev);
-		device->mtdev = NULL;
-	}
-
 	if (device->fd != -1) {
 		close_restricted(libinput, device->fd);
 		device->fd = -1;
 	}
+
+	evdev_drop_read_buffer(device);
+	device->in_frame = false;
 }
 
 int
@@ -2755,12 +4048,6 @@ evdev_device_resume(struct evdev_device *device)
 
 	device->fd = fd;
 
-	if (evdev_need_mtdev(device)) {
-		device->mtdev = mtdev_new_open(device->fd);
-		if (!device->mtdev)
-			return -ENODEV;
-	}
-
 	libevdev_change_fd(device->evdev, fd);
 	libevdev_set_clock_id(device->evdev, CLOCK_MONOTONIC);
 
@@ -2775,13 +4062,16 @@ evdev_device_resume(struct evdev_device *device)
 					     &ev);
 	} while (status == LIBEVDEV_READ_STATUS_SYNC);
 
-	device->source =
-		libinput_add_fd(libinput, fd, evdev_device_dispatch, device);
-	if (!device->source) {
-		mtdev_close_delete(device->mtdev);
+	if (device->replay)
+		goto out;
+
+	evdev_set_kernel_event_mask(device);
+
+	device->source = evdev_device_add_source(device, fd);
+	if (!device->source)
 		return -ENOMEM;
-	}
 
+out:
 	evdev_notify_resumed_device(device);
 
 	return 0;
@@ -2793,6 +4083,7 @@ evdev_device_remove(struct evdev_device *device)
 	struct libinput_device *dev;
 
 	evdev_log_info(device, "device removed\n");
+	tracepoint(device_removed, evdev_device_get_sysname(device));
 
 	libinput_timer_cancel(&device->scroll.timer);
 	libinput_timer_cancel(&device->middlebutton.timer);
@@ -2829,6 +4120,7 @@ evdev_device_destroy(struct evdev_device *device)
 	dispatch = device->dispatch;
 	if (dispatch)
 		dispatch->interface->destroy(dispatch);
+	arena_release(&device->arena);
 
 	if (device->base.group)
 		libinput_device_group_unref(device->base.group);
@@ -2837,10 +4129,11 @@ evdev_device_destroy(struct evdev_device *device)
 	filter_destroy(device->pointer.filter);
 	libinput_timer_destroy(&device->scroll.timer);
 	libinput_timer_destroy(&device->middlebutton.timer);
+	key_count_destroy(&device->key_count);
 	libinput_seat_unref(device->base.seat);
 	libevdev_free(device->evdev);
 	udev_device_unref(device->udev_device);
-	free(device);
+	mem_free(device);
 }
 
 bool
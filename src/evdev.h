@@ -41,6 +41,13 @@
 /* The fake resolution value for abs devices without resolution */
 #define EVDEV_FAKE_RESOLUTION 1
 
+/* Number of input_events read from the fd in one go */
+#define EVDEV_READ_BUFFER_SIZE 64
+
+/* Frames older than this are merged into the next frame if they only
+ * update positions, see evdev_frame_can_catch_up() */
+#define EVDEV_CATCH_UP_LAG ms2us(100)
+
 enum evdev_event_type {
 	EVDEV_NONE,
 	EVDEV_ABSOLUTE_TOUCH_DOWN	= bit(0),
@@ -112,6 +119,7 @@ enum evdev_device_model {
 	EVDEV_MODEL_LENOVO_T450_TOUCHPAD	= bit(4),
 	EVDEV_MODEL_APPLE_TOUCHPAD_ONEBUTTON	= bit(5),
 	EVDEV_MODEL_LENOVO_SCROLLPOINT		= bit(6),
+	EVDEV_MODEL_VIRTUAL_DEVICE		= bit(7),
 
 	/* udev tags, not true quirks */
 	EVDEV_MODEL_TEST_DEVICE			= bit(20),
@@ -159,41 +167,125 @@ enum evdev_arbitration_state {
 	ARBITRATION_IGNORE_RECT,
 };
 
+enum evdev_udev_prop {
+	EVDEV_UDEV_PROP_MOUSE_DPI		= bit(0),
+	EVDEV_UDEV_PROP_WHEEL_CLICK_ANGLE	= bit(1),
+	EVDEV_UDEV_PROP_WHEEL_CLICK_COUNT	= bit(2),
+	EVDEV_UDEV_PROP_HWHEEL_CLICK_ANGLE	= bit(3),
+	EVDEV_UDEV_PROP_HWHEEL_CLICK_COUNT	= bit(4),
+	EVDEV_UDEV_PROP_WHEEL_TILT_VERTICAL	= bit(5),
+	EVDEV_UDEV_PROP_WHEEL_TILT_HORIZONTAL	= bit(6),
+	EVDEV_UDEV_PROP_CALIBRATION		= bit(7),
+	EVDEV_UDEV_PROP_LENOVO_X220_FW81	= bit(8),
+	EVDEV_UDEV_PROP_TEST_DEVICE		= bit(9),
+	EVDEV_UDEV_PROP_TOUCHPAD_INTEGRATION	= bit(10),
+	EVDEV_UDEV_PROP_DEVICE_GROUP		= bit(11),
+	EVDEV_UDEV_PROP_TABLET_PAD_SYSFS_PATH	= bit(12),
+};
+
+/* The udev properties we look at, parsed in one pass over the property
+ * list when the device is created. String values point into the udev
+ * device and are valid for as long as we hold device->udev_device.
+ */
+struct evdev_udev_props {
+	uint32_t present;	/* enum evdev_udev_prop */
+	uint32_t flags;		/* enum evdev_udev_prop, boolean set to 1 */
+	uint32_t tags;		/* enum evdev_device_udev_tags */
+	uint32_t parent_tags;	/* enum evdev_device_udev_tags */
+
+	/* 0 if the property is present but invalid */
+	int mouse_dpi;
+	int wheel_click_angle;
+	int wheel_click_count;
+	int hwheel_click_angle;
+	int hwheel_click_count;
+
+	bool calibration_valid;
+	float calibration[6];
+
+	const char *touchpad_integration;
+	const char *device_group;
+	const char *tablet_pad_sysfs_path;
+
+	/* LIBINPUT_FUZZ_xx, -1 if the property is invalid */
+	uint64_t fuzz_present;
+	int fuzz[ABS_CNT];
+};
+
+/* The custom acceleration curve set by the caller */
+struct evdev_accel_custom {
+	double step;
+	size_t npoints;
+	double points[CUSTOM_ACCEL_NPOINTS_MAX];
+};
+
 struct evdev_device {
 	struct libinput_device base;
 
-	struct libinput_source *source;
-
+	/* The fields used for every event come first, keep them together
+	 * so a frame touches as few cache lines as possible. Anything
+	 * only used for configuration or device setup goes to the end of
+	 * the struct. */
 	struct evdev_dispatch *dispatch;
 	struct libevdev *evdev;
-	struct udev_device *udev_device;
-	char *output_name;
-	const char *devname;
-	bool was_removed;
+	struct libinput_source *source;
 	int fd;
 	enum evdev_device_seat_capability seat_caps;
 	enum evdev_device_tags tags;
+	uint32_t model_flags;
 	bool is_mt;
+	/* an event was processed since the last SYN_REPORT */
+	bool in_frame;
 	bool is_suspended;
-	int dpi; /* HW resolution */
-	double trackpoint_multiplier; /* trackpoint constant multiplier */
-	bool use_velocity_averaging; /* whether averaging should be applied on velocity calculation */
-	struct ratelimit syn_drop_limit; /* ratelimit for SYN_DROPPED logging */
-	struct ratelimit nonpointer_rel_limit; /* ratelimit for REL_* events from non-pointer devices */
-	uint32_t model_flags;
-	struct mtdev *mtdev;
+	bool was_removed;
+	/* events are pushed in by the caller, the fd is never read */
+	bool replay;
+
+	/* events read from the fd but not yet processed, the buffer
+	 * belongs to the source */
+	struct {
+		struct input_event *events;
+		size_t head;
+		size_t count;
+	} readbuf;
+
+	struct {
+		struct motion_filter *filter;
+		struct libinput_device_config_accel config;
+		/* the profile set by the caller, differs from the filter's
+		 * during a configuration transaction */
+		enum libinput_config_accel_profile want_profile;
+		/* custom curve changed during a configuration transaction */
+		bool custom_changed;
+		/* allocated from the arena, only used to create the filter */
+		struct evdev_accel_custom *custom;
+	} pointer;
 
 	struct {
 		const struct input_absinfo *absinfo_x, *absinfo_y;
 		bool is_fake_resolution;
 
+		/* rotated by 180 degrees, e.g. left-handed tablets */
+		bool rotated;
+		/* rotation and calibration combined, applied by
+		 * evdev_transform_absolute() */
+		bool apply_transform;
+		struct matrix transform;
+
+		struct device_coords dimensions;
+
+		/* set by the caller, touch and tablet events precompute
+		 * their transformed coordinates for this size. 0 if unset */
+		struct {
+			uint32_t width, height;
+		} output;
+
+		/* only used to compute the transform */
 		int apply_calibration;
 		struct matrix calibration;
 		struct matrix default_calibration; /* from LIBINPUT_CALIBRATION_MATRIX */
 		struct matrix usermatrix; /* as supplied by the caller */
 
-		struct device_coords dimensions;
-
 		struct {
 			struct device_coords min, max;
 			struct ratelimit range_warn_limit;
@@ -239,15 +331,6 @@ struct evdev_device {
 		bool lock_enabled;
 	} scroll;
 
-	struct {
-		struct libinput_device_config_accel config;
-		struct motion_filter *filter;
-	} pointer;
-
-	/* Key counter used for multiplexing button events internally in
-	 * libinput. */
-	uint8_t key_count[KEY_CNT];
-
 	struct {
 		struct libinput_device_config_left_handed config;
 		/* left-handed currently enabled */
@@ -259,6 +342,10 @@ struct evdev_device {
 		void (*change_to_enabled)(struct evdev_device *device);
 	} left_handed;
 
+	/* Key counter used for multiplexing button events internally in
+	 * libinput. */
+	struct key_count key_count;
+
 	struct {
 		struct libinput_device_config_middle_emulation config;
 		/* middle-button emulation enabled */
@@ -269,7 +356,34 @@ struct evdev_device {
 		struct libinput_timer timer;
 		uint32_t button_mask;
 		uint64_t first_event_time;
+		/* longest recent interval between the two presses of a
+		 * chord, see middlebutton_timeout() */
+		uint64_t chord_interval;
+		/* set when we stopped waiting for a chord */
+		bool timed_out;
 	} middlebutton;
+
+	struct libinput_device_config_transaction transaction;
+	struct udev_device *udev_device;
+	struct evdev_udev_props udev_props;
+	char *output_name;
+	const char *devname;
+	int dpi; /* HW resolution */
+	double trackpoint_multiplier; /* trackpoint constant multiplier */
+	bool use_velocity_averaging; /* whether averaging should be applied on velocity calculation */
+	struct ratelimit syn_drop_limit; /* ratelimit for SYN_DROPPED logging */
+	struct ratelimit nonpointer_rel_limit; /* ratelimit for REL_* events from non-pointer devices */
+	bool low_priority; /* see libinput_device_set_priority() */
+
+	/* last state written by evdev_device_led_update() */
+	struct {
+		bool valid;
+		enum libinput_led state;
+	} leds;
+
+	/* allocations with the lifetime of the device, released after
+	 * the dispatch is destroyed */
+	struct arena arena;
 };
 
 static inline struct evdev_device *
@@ -278,6 +392,14 @@ evdev_device(struct libinput_device *device)
 	return container_of(device, struct evdev_device, base);
 }
 
+/* True during a configuration transaction. Config setters that need a
+ * state reset store the wanted value and leave the rest to the commit */
+static inline bool
+evdev_config_deferred(struct evdev_device *device)
+{
+	return device->base.config_transaction;
+}
+
 #define EVDEV_UNHANDLED_DEVICE ((struct evdev_device *) 1)
 
 struct evdev_dispatch;
@@ -289,6 +411,16 @@ struct evdev_dispatch_interface {
 			struct input_event *event,
 			uint64_t time);
 
+	/* Process a whole evdev frame, the last event is its SYN_REPORT.
+	 * Must have the same effect as calling process() for each event.
+	 * May be NULL, frames split across two reads always go through
+	 * process() */
+	void (*process_frame)(struct evdev_dispatch *dispatch,
+			      struct evdev_device *device,
+			      struct input_event *events,
+			      size_t nevents,
+			      uint64_t time);
+
 	/* Device is being suspended */
 	void (*suspend)(struct evdev_dispatch *dispatch,
 			struct evdev_device *device);
@@ -303,6 +435,14 @@ struct evdev_dispatch_interface {
 	void (*device_added)(struct evdev_device *device,
 			     struct evdev_device *added_device);
 
+	/* The enum evdev_device_tags and enum evdev_device_seat_capability
+	 * of the devices device_added cares about. Other devices are not
+	 * passed to device_added when they or this device are added. If
+	 * both are 0, device_added sees every device.
+	 */
+	uint32_t pair_tags;
+	uint32_t pair_seat_caps;
+
 	/* A device was removed */
 	void (*device_removed)(struct evdev_device *device,
 			       struct evdev_device *removed_device);
@@ -346,6 +486,29 @@ struct evdev_dispatch_interface {
 	void (*left_handed_toggle)(struct evdev_dispatch *dispatch,
 				   struct evdev_device *device,
 				   bool left_handed_enabled);
+
+	/* Return the number of bytes allocated for the dispatch, including
+	 * the dispatch struct itself (may be NULL) */
+	size_t (*memory_usage)(struct evdev_dispatch *dispatch);
+
+	/* Apply the dispatch-specific configuration changes deferred
+	 * during a configuration transaction (may be NULL) */
+	void (*config_commit)(struct evdev_dispatch *dispatch,
+			      struct evdev_device *device);
+
+	/* Write the runtime state learned for this device to buf and
+	 * return its size. buf is only written if size is large enough
+	 * (may be NULL) */
+	size_t (*save_state)(struct evdev_dispatch *dispatch,
+			     void *buf,
+			     size_t size);
+
+	/* Apply the state written by save_state, size is the exact size
+	 * save_state returned. Returns false if the state is invalid
+	 * (may be NULL) */
+	bool (*restore_state)(struct evdev_dispatch *dispatch,
+			      const void *buf,
+			      size_t size);
 };
 
 enum evdev_dispatch_type {
@@ -366,6 +529,25 @@ struct evdev_dispatch {
 	} sendevents;
 };
 
+static inline enum libinput_profile_stage
+evdev_dispatch_profile_stage(struct evdev_dispatch *dispatch)
+{
+	switch (dispatch->dispatch_type) {
+	case DISPATCH_FALLBACK:
+		return LIBINPUT_PROFILE_STAGE_FALLBACK;
+	case DISPATCH_TOUCHPAD:
+		return LIBINPUT_PROFILE_STAGE_TOUCHPAD;
+	case DISPATCH_TABLET:
+		return LIBINPUT_PROFILE_STAGE_TABLET;
+	case DISPATCH_TABLET_PAD:
+		return LIBINPUT_PROFILE_STAGE_TABLET_PAD;
+	case DISPATCH_TOTEM:
+		return LIBINPUT_PROFILE_STAGE_TOTEM;
+	}
+
+	abort();
+}
+
 static inline void
 evdev_verify_dispatch_type(struct evdev_dispatch *dispatch,
 			   enum evdev_dispatch_type type)
@@ -374,9 +556,34 @@ evdev_verify_dispatch_type(struct evdev_dispatch *dispatch,
 		abort();
 }
 
+/**
+ * A device node opened and with libevdev initialized ahead of
+ * evdev_device_create(), see evdev_probe_devices().
+ */
+struct evdev_probe {
+	struct udev_device *udev_device;
+	int fd;			/* negative errno if not opened */
+	struct libevdev *evdev;	/* NULL if not initialized */
+	uint64_t open_time;	/* us */
+	uint64_t libevdev_time;	/* us */
+};
+
+bool
+udev_device_should_be_ignored(struct udev_device *udev_device);
+
+void
+evdev_probe_devices(struct libinput *libinput,
+		    struct evdev_probe *probes,
+		    size_t nprobes);
+
+void
+evdev_probe_release(struct libinput *libinput,
+		    struct evdev_probe *probe);
+
 struct evdev_device *
 evdev_device_create(struct libinput_seat *seat,
-		    struct udev_device *device);
+		    struct udev_device *device,
+		    struct evdev_probe *probe);
 
 static inline struct libinput *
 evdev_libinput_context(const struct evdev_device *device)
@@ -384,6 +591,47 @@ evdev_libinput_context(const struct evdev_device *device)
 	return device->base.seat->libinput;
 }
 
+/* filter_dispatch() on the device's pointer filter, with profiling */
+static inline struct normalized_coords
+evdev_filter_dispatch(const struct evdev_device *device,
+		      const struct device_float_coords *unaccelerated,
+		      void *data,
+		      uint64_t time)
+{
+	struct libinput *libinput = evdev_libinput_context(device);
+	enum libinput_profile_stage outer;
+	struct normalized_coords accel;
+
+	outer = libinput_profile_enter(libinput, LIBINPUT_PROFILE_STAGE_FILTER);
+	accel = filter_dispatch(device->pointer.filter,
+				unaccelerated,
+				data,
+				time);
+	libinput_profile_leave(libinput, outer);
+
+	return accel;
+}
+
+static inline struct normalized_coords
+evdev_filter_dispatch_constant(const struct evdev_device *device,
+			       const struct device_float_coords *unaccelerated,
+			       void *data,
+			       uint64_t time)
+{
+	struct libinput *libinput = evdev_libinput_context(device);
+	enum libinput_profile_stage outer;
+	struct normalized_coords accel;
+
+	outer = libinput_profile_enter(libinput, LIBINPUT_PROFILE_STAGE_FILTER);
+	accel = filter_dispatch_constant(device->pointer.filter,
+					 unaccelerated,
+					 data,
+					 time);
+	libinput_profile_leave(libinput, outer);
+
+	return accel;
+}
+
 static inline bool
 evdev_device_has_model_quirk(struct evdev_device *device,
 			     enum quirk model_quirk)
@@ -455,8 +703,8 @@ evdev_totem_create(struct evdev_device *device);
 bool
 evdev_is_fake_mt_device(struct evdev_device *device);
 
-int
-evdev_need_mtdev(struct evdev_device *device);
+bool
+evdev_is_protocol_a_device(struct evdev_device *device);
 
 void
 evdev_device_led_update(struct evdev_device *device, enum libinput_led leds);
@@ -479,6 +727,17 @@ evdev_device_get_id_product(struct evdev_device *device);
 unsigned int
 evdev_device_get_id_vendor(struct evdev_device *device);
 
+char *
+evdev_device_get_identity(struct evdev_device *device);
+
+size_t
+evdev_device_save_state(struct evdev_device *device, void *buf, size_t size);
+
+int
+evdev_device_restore_state(struct evdev_device *device,
+			   const void *buf,
+			   size_t size);
+
 struct udev_device *
 evdev_device_get_udev_device(struct evdev_device *device);
 
@@ -489,6 +748,9 @@ void
 evdev_device_calibrate(struct evdev_device *device,
 		       const float calibration[6]);
 
+void
+evdev_device_set_rotated(struct evdev_device *device, bool rotated);
+
 bool
 evdev_device_has_capability(struct evdev_device *device,
 			    enum libinput_device_capability capability);
@@ -511,6 +773,7 @@ int
 evdev_device_has_switch(struct evdev_device *device,
 			enum libinput_switch sw);
 
+#if HAVE_TABLET
 int
 evdev_device_tablet_pad_has_key(struct evdev_device *device,
 				uint32_t code);
@@ -530,6 +793,46 @@ evdev_device_tablet_pad_get_num_mode_groups(struct evdev_device *device);
 struct libinput_tablet_pad_mode_group *
 evdev_device_tablet_pad_get_mode_group(struct evdev_device *device,
 				       unsigned int index);
+#else
+/* Built without tablet support, no device is ever a tablet pad */
+static inline int
+evdev_device_tablet_pad_has_key(struct evdev_device *device,
+				uint32_t code)
+{
+	return -1;
+}
+
+static inline int
+evdev_device_tablet_pad_get_num_buttons(struct evdev_device *device)
+{
+	return -1;
+}
+
+static inline int
+evdev_device_tablet_pad_get_num_rings(struct evdev_device *device)
+{
+	return -1;
+}
+
+static inline int
+evdev_device_tablet_pad_get_num_strips(struct evdev_device *device)
+{
+	return -1;
+}
+
+static inline int
+evdev_device_tablet_pad_get_num_mode_groups(struct evdev_device *device)
+{
+	return -1;
+}
+
+static inline struct libinput_tablet_pad_mode_group *
+evdev_device_tablet_pad_get_mode_group(struct evdev_device *device,
+				       unsigned int index)
+{
+	return NULL;
+}
+#endif
 
 enum libinput_switch_state
 evdev_device_switch_get_state(struct evdev_device *device,
@@ -544,12 +847,31 @@ double
 evdev_device_transform_y(struct evdev_device *device,
 			 double y,
 			 uint32_t height);
+
+int
+evdev_device_set_output_size(struct evdev_device *device,
+			     uint32_t width,
+			     uint32_t height);
+
+void
+evdev_set_kernel_event_mask(struct evdev_device *device);
+
+void
+evdev_device_set_low_priority(struct evdev_device *device,
+			      bool low_priority);
 void
 evdev_device_suspend(struct evdev_device *device);
 
 int
 evdev_device_resume(struct evdev_device *device);
 
+void
+evdev_device_set_replay(struct evdev_device *device);
+
+void
+evdev_device_replay_event(struct evdev_device *device,
+			  struct input_event *ev);
+
 void
 evdev_notify_suspended_device(struct evdev_device *device);
 
@@ -665,6 +987,24 @@ evdev_to_left_handed(struct evdev_device *device,
 	return button;
 }
 
+/**
+ * @return true if in is strictly inside the elliptical margin around
+ * center, i.e. evdev_hysteresis() would return the center
+ */
+static inline bool
+evdev_hysteresis_contains(const struct device_coords *in,
+			  const struct device_coords *center,
+			  const struct device_coords *margin)
+{
+	int64_t dx = in->x - center->x;
+	int64_t dy = in->y - center->y;
+	int64_t a = margin->x;
+	int64_t b = margin->y;
+
+	/* dx²/a² + dy²/b² < 1 is dx²b² + dy²a² < a²b² in integers */
+	return a && b && dx * dx * b * b + dy * dy * a * a < a * a * b * b;
+}
+
 /**
  * Apply a hysteresis filtering to the coordinate in, based on the current
  * hysteresis center and the margin. If 'in' is within 'margin' of center,
@@ -710,6 +1050,14 @@ evdev_hysteresis(const struct device_coords *in,
 	if (!a || !b)
 		return *in;
 
+	/*
+	 * Fast path for the common case of a finger resting inside the
+	 * margin, no sqrt or division needed. Anything not strictly inside
+	 * takes the floating point path below, so the result is the same.
+	 */
+	if (evdev_hysteresis_contains(in, center, margin))
+		return *center;
+
 	/*
 	 * Basic equation for an ellipse of radii a,b:
 	 *   x²/a² + y²/b² = 1
@@ -766,6 +1114,17 @@ evdev_log_msg(struct evdev_device *device,
 	if (!is_logged(evdev_libinput_context(device), priority))
 		return;
 
+	if (evdev_libinput_context(device)->log_ring.entries) {
+		va_start(args, format);
+		log_ring_push(evdev_libinput_context(device),
+			      evdev_device_get_sysname(device),
+			      priority,
+			      format,
+			      args);
+		va_end(args);
+		return;
+	}
+
 	/* Anything info and above is user-visible, use the device name */
 	snprintf(buf,
 		 sizeof(buf),
@@ -781,10 +1140,11 @@ evdev_log_msg(struct evdev_device *device,
 
 }
 
-LIBINPUT_ATTRIBUTE_PRINTF(4, 5)
+LIBINPUT_ATTRIBUTE_PRINTF(5, 6)
 static inline void
 evdev_log_msg_ratelimit(struct evdev_device *device,
 			struct ratelimit *ratelimit,
+			uint64_t time,
 			enum libinput_log_priority priority,
 			const char *format,
 			...)
@@ -797,21 +1157,28 @@ evdev_log_msg_ratelimit(struct evdev_device *device,
 	if (!is_logged(evdev_libinput_context(device), priority))
 		return;
 
-	state = ratelimit_test(ratelimit);
+	state = ratelimit_test_time(ratelimit, time);
 	if (state == RATELIMIT_EXCEEDED)
 		return;
 
-	/* Anything info and above is user-visible, use the device name */
-	snprintf(buf,
-		 sizeof(buf),
-		 "%-7s - %s%s%s",
-		 evdev_device_get_sysname(device),
-		 (priority > LIBINPUT_LOG_PRIORITY_DEBUG) ?  device->devname : "",
-		 (priority > LIBINPUT_LOG_PRIORITY_DEBUG) ?  ": " : "",
-		 format);
-
 	va_start(args, format);
-	log_msg_va(evdev_libinput_context(device), priority, buf, args);
+	if (evdev_libinput_context(device)->log_ring.entries) {
+		log_ring_push(evdev_libinput_context(device),
+			      evdev_device_get_sysname(device),
+			      priority,
+			      format,
+			      args);
+	} else {
+		/* Anything info and above is user-visible, use the device name */
+		snprintf(buf,
+			 sizeof(buf),
+			 "%-7s - %s%s%s",
+			 evdev_device_get_sysname(device),
+			 (priority > LIBINPUT_LOG_PRIORITY_DEBUG) ?  device->devname : "",
+			 (priority > LIBINPUT_LOG_PRIORITY_DEBUG) ?  ": " : "",
+			 format);
+		log_msg_va(evdev_libinput_context(device), priority, buf, args);
+	}
 	va_end(args);
 
 	if (state == RATELIMIT_THRESHOLD) {
@@ -834,18 +1201,18 @@ evdev_log_msg_ratelimit(struct evdev_device *device,
 #define evdev_log_bug_libinput(d_, ...) evdev_log_msg((d_), LIBINPUT_LOG_PRIORITY_ERROR, "libinput bug: " __VA_ARGS__)
 #define evdev_log_bug_client(d_, ...) evdev_log_msg((d_), LIBINPUT_LOG_PRIORITY_ERROR, "client bug: " __VA_ARGS__)
 
-#define evdev_log_debug_ratelimit(d_, r_, ...) \
-	evdev_log_msg_ratelimit((d_), (r_), LIBINPUT_LOG_PRIORITY_DEBUG, __VA_ARGS__)
-#define evdev_log_info_ratelimit(d_, r_, ...) \
-	evdev_log_msg_ratelimit((d_), (r_), LIBINPUT_LOG_PRIORITY_INFO, __VA_ARGS__)
-#define evdev_log_error_ratelimit(d_, r_, ...) \
-	evdev_log_msg_ratelimit((d_), (r_), LIBINPUT_LOG_PRIORITY_ERROR, __VA_ARGS__)
-#define evdev_log_bug_kernel_ratelimit(d_, r_, ...) \
-	evdev_log_msg_ratelimit((d_), (r_), LIBINPUT_LOG_PRIORITY_ERROR, "kernel bug: " __VA_ARGS__)
-#define evdev_log_bug_libinput_ratelimit(d_, r_, ...) \
-	evdev_log_msg_ratelimit((d_), (r_), LIBINPUT_LOG_PRIORITY_ERROR, "libinput bug: " __VA_ARGS__)
-#define evdev_log_bug_client_ratelimit(d_, r_, ...) \
-	evdev_log_msg_ratelimit((d_), (r_), LIBINPUT_LOG_PRIORITY_ERROR, "client bug: " __VA_ARGS__)
+#define evdev_log_debug_ratelimit(d_, r_, t_, ...) \
+	evdev_log_msg_ratelimit((d_), (r_), (t_), LIBINPUT_LOG_PRIORITY_DEBUG, __VA_ARGS__)
+#define evdev_log_info_ratelimit(d_, r_, t_, ...) \
+	evdev_log_msg_ratelimit((d_), (r_), (t_), LIBINPUT_LOG_PRIORITY_INFO, __VA_ARGS__)
+#define evdev_log_error_ratelimit(d_, r_, t_, ...) \
+	evdev_log_msg_ratelimit((d_), (r_), (t_), LIBINPUT_LOG_PRIORITY_ERROR, __VA_ARGS__)
+#define evdev_log_bug_kernel_ratelimit(d_, r_, t_, ...) \
+	evdev_log_msg_ratelimit((d_), (r_), (t_), LIBINPUT_LOG_PRIORITY_ERROR, "kernel bug: " __VA_ARGS__)
+#define evdev_log_bug_libinput_ratelimit(d_, r_, t_, ...) \
+	evdev_log_msg_ratelimit((d_), (r_), (t_), LIBINPUT_LOG_PRIORITY_ERROR, "libinput bug: " __VA_ARGS__)
+#define evdev_log_bug_client_ratelimit(d_, r_, t_, ...) \
+	evdev_log_msg_ratelimit((d_), (r_), (t_), LIBINPUT_LOG_PRIORITY_ERROR, "client bug: " __VA_ARGS__)
 
 /**
  * Convert the pair of delta coordinates in device space to mm.
@@ -981,7 +1348,8 @@ evdev_device_init_abs_range_warnings(struct evdev_device *device)
 static inline void
 evdev_device_check_abs_axis_range(struct evdev_device *device,
 				  unsigned int code,
-				  int value)
+				  int value,
+				  uint64_t time)
 {
 	int min, max;
 
@@ -1003,6 +1371,7 @@ evdev_device_check_abs_axis_range(struct evdev_device *device,
 	if (value < min || value > max) {
 		log_info_ratelimit(evdev_libinput_context(device),
 				   &device->abs.warning_range.range_warn_limit,
+				   time,
 				   "Axis %#x value %d is outside expected range [%d, %d]\n"
 				   "See %sabsolute_coordinate_ranges.html for details\n",
 				   code, value, min, max,
@@ -0,0 +1,198 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "filter.h"
+#include "libinput-util.h"
+#include "filter-private.h"
+
+/* A custom curve maps the input speed to an output speed, both in
+ * normalized units/ms. The curve is sampled in uniform steps starting at
+ * zero, so evaluating it is a multiplication to get the index and a
+ * linear interpolation between the two neighbouring points. Speeds beyond
+ * the last point are extrapolated from the last segment.
+ */
+struct pointer_accelerator_custom {
+	struct motion_filter base;
+
+	struct pointer_trackers trackers;
+
+	double step;		/* units/ms */
+	double inv_step;	/* 1/step, avoids a division per event */
+	size_t npoints;
+	double points[CUSTOM_ACCEL_NPOINTS_MAX]; /* units/ms */
+
+	int dpi;
+};
+
+static inline double
+custom_accel_speed(struct pointer_accelerator_custom *accel,
+		   double velocity)
+{
+	double pos = velocity * accel->inv_step;
+	size_t idx;
+
+	if (pos < accel->npoints - 1)
+		idx = (size_t)pos;
+	else
+		idx = accel->npoints - 2;
+
+	return accel->points[idx] +
+		(accel->points[idx + 1] - accel->points[idx]) * (pos - idx);
+}
+
+static struct normalized_coords
+accelerator_filter_custom(struct motion_filter *filter,
+			  const struct device_float_coords *unaccelerated,
+			  void *data, uint64_t time)
+{
+	struct pointer_accelerator_custom *accel =
+		(struct pointer_accelerator_custom *)filter;
+	struct normalized_coords normalized;
+	struct device_float_coords converted;
+	double velocity; /* units/ms */
+	double factor; /* unitless factor */
+
+	normalized = normalize_for_dpi(unaccelerated, accel->dpi);
+	converted.x = normalized.x;
+	converted.y = normalized.y;
+
+	trackers_feed(&accel->trackers, &converted, time);
+	velocity = v_us2ms(trackers_velocity(&accel->trackers, time));
+
+	/* At zero speed the factor is the slope of the first segment */
+	if (velocity > 0.0)
+		factor = custom_accel_speed(accel, velocity) / velocity;
+	else
+		factor = (accel->points[1] - accel->points[0]) *
+			 accel->inv_step;
+
+	normalized.x *= factor;
+	normalized.y *= factor;
+
+	return normalized;
+}
+
+static void
+accelerator_filter_batch_custom(struct motion_filter *filter,
+				const struct device_float_coords *unaccelerated,
+				const uint64_t *times,
+				struct normalized_coords *accelerated,
+				size_t n,
+				void *data)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		accelerated[i] = accelerator_filter_custom(filter,
+							   &unaccelerated[i],
+							   data,
+							   times[i]);
+}
+
+static struct normalized_coords
+accelerator_filter_noop_custom(struct motion_filter *filter,
+			       const struct device_float_coords *unaccelerated,
+			       void *data, uint64_t time)
+{
+	struct pointer_accelerator_custom *accel =
+		(struct pointer_accelerator_custom *) filter;
+
+	return normalize_for_dpi(unaccelerated, accel->dpi);
+}
+
+static void
+accelerator_restart_custom(struct motion_filter *filter,
+			   void *data,
+			   uint64_t time)
+{
+	struct pointer_accelerator_custom *accel =
+		(struct pointer_accelerator_custom *) filter;
+
+	trackers_reset(&accel->trackers, time);
+}
+
+static bool
+accelerator_set_speed_custom(struct motion_filter *filter,
+			     double speed_adjustment)
+{
+	assert(speed_adjustment >= -1.0 && speed_adjustment <= 1.0);
+
+	/* The curve defines the speed, the speed setting has no effect */
+	filter->speed_adjustment = speed_adjustment;
+
+	return true;
+}
+
+static void
+accelerator_destroy_custom(struct motion_filter *filter)
+{
+	struct pointer_accelerator_custom *accel =
+		(struct pointer_accelerator_custom *) filter;
+
+	free(accel);
+}
+
+struct motion_filter_interface accelerator_interface_custom = {
+	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM,
+	.filter = accelerator_filter_custom,
+	.filter_constant = accelerator_filter_noop_custom,
+	.filter_batch = accelerator_filter_batch_custom,
+	.restart = accelerator_restart_custom,
+	.destroy = accelerator_destroy_custom,
+	.set_speed = accelerator_set_speed_custom,
+};
+
+struct motion_filter *
+create_pointer_accelerator_filter_custom(int dpi,
+					 bool use_velocity_averaging,
+					 double step,
+					 const double *points,
+					 size_t npoints)
+{
+	struct pointer_accelerator_custom *filter;
+
+	if (step <= 0.0 ||
+	    npoints < 2 || npoints > CUSTOM_ACCEL_NPOINTS_MAX)
+		return NULL;
+
+	filter = zalloc(sizeof *filter);
+	filter->base.interface = &accelerator_interface_custom;
+	filter->dpi = dpi;
+	filter->step = step;
+	filter->inv_step = 1.0/step;
+	filter->npoints = npoints;
+	memcpy(filter->points, points, npoints * sizeof(*points));
+
+	trackers_init(&filter->trackers, use_velocity_averaging ? 16 : 2);
+	filter->base.trackers = &filter->trackers;
+	filter->base.history_scale = 1.0; /* normalized */
+
+	return &filter->base;
+}
@@ -60,6 +60,23 @@ accelerator_filter_flat(struct motion_filter *filter,
 	return accelerated;
 }
 
+static void
+accelerator_filter_batch_flat(struct motion_filter *filter,
+			      const struct device_float_coords *unaccelerated,
+			      const uint64_t *times,
+			      struct normalized_coords *accelerated,
+			      size_t n,
+			      void *data)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		accelerated[i] = accelerator_filter_flat(filter,
+							 &unaccelerated[i],
+							 data,
+							 times[i]);
+}
+
 static struct normalized_coords
 accelerator_filter_noop_flat(struct motion_filter *filter,
 			     const struct device_float_coords *unaccelerated,
@@ -104,6 +121,7 @@ struct motion_filter_interface accelerator_interface_flat = {
 	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT,
 	.filter = accelerator_filter_flat,
 	.filter_constant = accelerator_filter_noop_flat,
+	.filter_batch = accelerator_filter_batch_flat,
 	.restart = NULL,
 	.destroy = accelerator_destroy_flat,
 	.set_speed = accelerator_set_speed_flat,
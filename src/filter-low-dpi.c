@@ -164,6 +164,23 @@ accelerator_filter_unnormalized(struct motion_filter *filter,
 	return normalized;
 }
 
+static void
+accelerator_filter_batch_unnormalized(struct motion_filter *filter,
+				      const struct device_float_coords *unaccelerated,
+				      const uint64_t *times,
+				      struct normalized_coords *accelerated,
+				      size_t n,
+				      void *data)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		accelerated[i] = accelerator_filter_unnormalized(filter,
+								 &unaccelerated[i],
+								 data,
+								 times[i]);
+}
+
 static struct normalized_coords
 accelerator_filter_noop(struct motion_filter *filter,
 			const struct device_float_coords *unaccelerated,
@@ -192,7 +209,6 @@ accelerator_destroy(struct motion_filter *filter)
 	struct pointer_accelerator_low_dpi *accel =
 		(struct pointer_accelerator_low_dpi *) filter;
 
-	trackers_free(&accel->trackers);
 	free(accel);
 }
 
@@ -228,6 +244,7 @@ struct motion_filter_interface accelerator_interface_low_dpi = {
 	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE,
 	.filter = accelerator_filter_unnormalized,
 	.filter_constant = accelerator_filter_noop,
+	.filter_batch = accelerator_filter_batch_unnormalized,
 	.restart = accelerator_restart,
 	.destroy = accelerator_destroy,
 	.set_speed = accelerator_set_speed,
@@ -242,6 +259,9 @@ create_default_filter(int dpi, bool use_velocity_averaging)
 	filter->last_velocity = 0.0;
 
 	trackers_init(&filter->trackers, use_velocity_averaging ? 16 : 2);
+	filter->base.trackers = &filter->trackers;
+	/* device units */
+	filter->base.history_scale = dpi/(double)DEFAULT_MOUSE_DPI;
 
 	filter->threshold = DEFAULT_THRESHOLD;
 	filter->accel = DEFAULT_ACCELERATION;
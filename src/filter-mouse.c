@@ -150,6 +150,23 @@ accelerator_filter_pre_normalized(struct motion_filter *filter,
 	return normalized;
 }
 
+static void
+accelerator_filter_batch_pre_normalized(struct motion_filter *filter,
+					const struct device_float_coords *unaccelerated,
+					const uint64_t *times,
+					struct normalized_coords *accelerated,
+					size_t n,
+					void *data)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		accelerated[i] = accelerator_filter_pre_normalized(filter,
+								   &unaccelerated[i],
+								   data,
+								   times[i]);
+}
+
 /**
  * Generic filter that does nothing beyond converting from the device's
  * native dpi into normalized coordinates.
@@ -190,7 +207,6 @@ accelerator_destroy(struct motion_filter *filter)
 	struct pointer_accelerator *accel =
 		(struct pointer_accelerator *) filter;
 
-	trackers_free(&accel->trackers);
 	free(accel);
 }
 
@@ -302,6 +318,7 @@ struct motion_filter_interface accelerator_interface = {
 	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE,
 	.filter = accelerator_filter_pre_normalized,
 	.filter_constant = accelerator_filter_noop,
+	.filter_batch = accelerator_filter_batch_pre_normalized,
 	.restart = accelerator_restart,
 	.destroy = accelerator_destroy,
 	.set_speed = accelerator_set_speed,
@@ -316,6 +333,8 @@ create_default_filter(int dpi, bool use_velocity_averaging)
 	filter->last_velocity = 0.0;
 
 	trackers_init(&filter->trackers, use_velocity_averaging ? 16 : 2);
+	filter->base.trackers = &filter->trackers;
+	filter->base.history_scale = 1.0; /* normalized */
 
 	filter->threshold = DEFAULT_THRESHOLD;
 	filter->accel = DEFAULT_ACCELERATION;
@@ -38,6 +38,12 @@ struct motion_filter_interface {
 			   struct motion_filter *filter,
 			   const struct device_float_coords *unaccelerated,
 			   void *data, uint64_t time);
+	void (*filter_batch)(struct motion_filter *filter,
+			     const struct device_float_coords *unaccelerated,
+			     const uint64_t *times,
+			     struct normalized_coords *accelerated,
+			     size_t n,
+			     void *data);
 	void (*restart)(struct motion_filter *filter,
 			void *data,
 			uint64_t time);
@@ -49,45 +55,72 @@ struct motion_filter_interface {
 struct motion_filter {
 	double speed_adjustment; /* normalized [-1, 1] */
 	struct motion_filter_interface *interface;
+	struct pointer_trackers *trackers; /* NULL if the filter has none */
+	/* Tracker units per 1000dpi-normalized unit, 0 if the trackers'
+	 * units can't be converted. See filter_copy_history() */
+	double history_scale;
 };
 
 struct pointer_tracker {
-	struct device_float_coords delta; /* delta to most recent event */
+	struct device_float_coords sum; /* running sum when started */
 	uint64_t time;  /* us */
 	uint32_t dir;
 };
 
-/* For smoothing timestamps from devices with unreliable timing */
+/* For smoothing timestamps from devices with unreliable timing. A
+ * threshold of zero disables smoothing. */
 struct pointer_delta_smoothener {
 	uint64_t threshold;
 	uint64_t value;
 };
 
+/* Maximum number of trackers, must be a power of two */
+#define POINTER_TRACKERS_MAX 16
+
 struct pointer_trackers {
-	struct pointer_tracker *trackers;
-	size_t ntrackers;
+	/* Stored inline so the velocity calculation doesn't have to chase
+	 * a pointer away from the filter */
+	struct pointer_tracker trackers[POINTER_TRACKERS_MAX];
+	unsigned int ntrackers; /* power of two */
+	unsigned int mask; /* ntrackers - 1 */
 	unsigned int cur_tracker;
+	struct device_float_coords sum; /* running sum of all deltas */
 
-	struct pointer_delta_smoothener *smoothener;
+	struct pointer_delta_smoothener smoothener;
 };
 
-void trackers_init(struct pointer_trackers *trackers, int ntrackers);
-void trackers_free(struct pointer_trackers *trackers);
+void trackers_init(struct pointer_trackers *trackers, unsigned int ntrackers);
 
 void
 trackers_reset(struct pointer_trackers *trackers,
 	       uint64_t time);
 void
+trackers_copy_history(struct pointer_trackers *dest,
+		      struct pointer_trackers *src,
+		      double scale);
+void
 trackers_feed(struct pointer_trackers *trackers,
 	      const struct device_float_coords *delta,
 	      uint64_t time);
 
-struct pointer_tracker *
-trackers_by_offset(struct pointer_trackers *trackers, unsigned int offset);
+static inline struct pointer_tracker *
+trackers_by_offset(struct pointer_trackers *trackers, unsigned int offset)
+{
+	unsigned int index = (trackers->cur_tracker - offset) & trackers->mask;
+
+	return &trackers->trackers[index];
+}
+
+struct device_float_coords
+trackers_delta(struct pointer_trackers *trackers,
+	       struct pointer_tracker *tracker);
 
 double
 trackers_velocity(struct pointer_trackers *trackers, uint64_t time);
 
+struct device_float_coords
+trackers_velocity_vector(struct pointer_trackers *trackers, uint64_t time);
+
 double
 calculate_acceleration_simpsons(struct motion_filter *filter,
 				accel_profile_func_t profile,
@@ -96,6 +129,62 @@ calculate_acceleration_simpsons(struct motion_filter *filter,
 				double last_velocity,
 				uint64_t time);
 
+/**
+ * A lookup table of an acceleration profile, sampled in equal steps
+ * from 0 to max_velocity and linearly interpolated in between. Profiles
+ * that are expensive to evaluate build one whenever their parameters
+ * change, i.e. in set_speed, instead of evaluating the profile for
+ * every event. Velocities outside the table, or before the table is
+ * built, fall back to the profile.
+ */
+struct accel_lut {
+	accel_profile_func_t profile;
+	double max_velocity; /* units/us */
+	double scale; /* entries per units/us */
+	size_t nentries;
+	double *factors; /* nentries + 1 samples */
+};
+
+void
+accel_lut_init(struct accel_lut *lut, accel_profile_func_t profile);
+
+void
+accel_lut_build(struct accel_lut *lut,
+		struct motion_filter *filter,
+		double max_velocity,
+		size_t nentries);
+
+void
+accel_lut_free(struct accel_lut *lut);
+
+static inline double
+accel_lut_lookup(const struct accel_lut *lut,
+		 struct motion_filter *filter,
+		 void *data,
+		 double velocity,
+		 uint64_t time)
+{
+	double pos;
+	size_t idx;
+
+	if (!lut->factors || velocity >= lut->max_velocity)
+		return lut->profile(filter, data, velocity, time);
+
+	pos = velocity * lut->scale;
+	idx = (size_t)pos;
+
+	return lut->factors[idx] +
+		(lut->factors[idx + 1] - lut->factors[idx]) * (pos - idx);
+}
+
+double
+calculate_acceleration_simpsons_lut(struct motion_filter *filter,
+				    const struct accel_lut *lut,
+				    void *data,
+				    double velocity,
+				    double last_velocity,
+				    uint64_t time);
+
 /* Convert speed/velocity from units/us to units/ms */
 static inline double
 v_us2ms(double units_per_us)
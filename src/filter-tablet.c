@@ -120,6 +120,23 @@ tablet_accelerator_filter_flat(struct motion_filter *filter,
 	return accel;
 }
 
+static void
+tablet_accelerator_filter_batch_flat(struct motion_filter *filter,
+				     const struct device_float_coords *unaccelerated,
+				     const uint64_t *times,
+				     struct normalized_coords *accelerated,
+				     size_t n,
+				     void *data)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		accelerated[i] = tablet_accelerator_filter_flat(filter,
+								&unaccelerated[i],
+								data,
+								times[i]);
+}
+
 static bool
 tablet_accelerator_set_speed(struct motion_filter *filter,
 			     double speed_adjustment)
@@ -147,6 +164,7 @@ struct motion_filter_interface accelerator_interface_tablet = {
 	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT,
 	.filter = tablet_accelerator_filter_flat,
 	.filter_constant = NULL,
+	.filter_batch = tablet_accelerator_filter_batch_flat,
 	.restart = NULL,
 	.destroy = tablet_accelerator_destroy,
 	.set_speed = tablet_accelerator_set_speed,
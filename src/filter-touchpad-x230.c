@@ -165,6 +165,23 @@ accelerator_filter_x230(struct motion_filter *filter,
 	return accelerated;
 }
 
+static void
+accelerator_filter_batch_x230(struct motion_filter *filter,
+			      const struct device_float_coords *unaccelerated,
+			      const uint64_t *times,
+			      struct normalized_coords *accelerated,
+			      size_t n,
+			      void *data)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		accelerated[i] = accelerator_filter_x230(filter,
+							 &unaccelerated[i],
+							 data,
+							 times[i]);
+}
+
 static struct normalized_coords
 accelerator_filter_constant_x230(struct motion_filter *filter,
 				 const struct device_float_coords *unaccelerated,
@@ -190,20 +207,8 @@ accelerator_restart_x230(struct motion_filter *filter,
 {
 	struct pointer_accelerator_x230 *accel =
 		(struct pointer_accelerator_x230 *) filter;
-	unsigned int offset;
-	struct pointer_tracker *tracker;
-
-	for (offset = 1; offset < accel->trackers.ntrackers; offset++) {
-		tracker = trackers_by_offset(&accel->trackers, offset);
-		tracker->time = 0;
-		tracker->dir = 0;
-		tracker->delta.x = 0;
-		tracker->delta.y = 0;
-	}
-
-	tracker = trackers_by_offset(&accel->trackers, 0);
-	tracker->time = time;
-	tracker->dir = UNDEFINED_DIRECTION;
+
+	trackers_reset(&accel->trackers, time);
 }
 
 static void
@@ -212,7 +217,6 @@ accelerator_destroy_x230(struct motion_filter *filter)
 	struct pointer_accelerator_x230 *accel =
 		(struct pointer_accelerator_x230 *) filter;
 
-	free(accel->trackers.trackers);
 	free(accel);
 }
 
@@ -287,6 +291,7 @@ struct motion_filter_interface accelerator_interface_x230 = {
 	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE,
 	.filter = accelerator_filter_x230,
 	.filter_constant = accelerator_filter_constant_x230,
+	.filter_batch = accelerator_filter_batch_x230,
 	.restart = accelerator_restart_x230,
 	.destroy = accelerator_destroy_x230,
 	.set_speed = accelerator_set_speed_x230,
@@ -307,6 +312,8 @@ create_pointer_accelerator_filter_lenovo_x230(int dpi, bool use_velocity_averagi
 	filter->last_velocity = 0.0;
 
 	trackers_init(&filter->trackers, use_velocity_averaging ? 16 : 2);
+	filter->base.trackers = &filter->trackers;
+	filter->base.history_scale = 1.0; /* normalized */
 
 	filter->threshold = X230_THRESHOLD;
 	filter->accel = X230_ACCELERATION; /* unitless factor */
@@ -56,6 +56,8 @@ struct touchpad_accelerator {
 	int dpi;
 
 	double speed_factor;    /* factor based on speed setting */
+
+	struct accel_lut lut;
 };
 
 /**
@@ -79,12 +81,12 @@ calculate_acceleration_factor(struct touchpad_accelerator *accel,
 
 	trackers_feed(&accel->trackers, unaccelerated, time);
 	velocity = trackers_velocity(&accel->trackers, time);
-	accel_factor = calculate_acceleration_simpsons(&accel->base,
-						       accel->profile,
-						       data,
-						       velocity,
-						       accel->last_velocity,
-						       time);
+	accel_factor = calculate_acceleration_simpsons_lut(&accel->base,
+							   &accel->lut,
+							   data,
+							   velocity,
+							   accel->last_velocity,
+							   time);
 	accel->last_velocity = velocity;
 
 	return accel_factor;
@@ -140,6 +142,23 @@ accelerator_filter_post_normalized(struct motion_filter *filter,
 	return normalize_for_dpi(&accelerated, accel->dpi);
 }
 
+static void
+accelerator_filter_batch_post_normalized(struct motion_filter *filter,
+					 const struct device_float_coords *unaccelerated,
+					 const uint64_t *times,
+					 struct normalized_coords *accelerated,
+					 size_t n,
+					 void *data)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		accelerated[i] = accelerator_filter_post_normalized(filter,
+								    &unaccelerated[i],
+								    data,
+								    times[i]);
+}
+
 /* Maps the [-1, 1] speed setting into a constant acceleration
  * range. This isn't a linear scale, we keep 0 as the 'optimized'
  * mid-point and scale down to 0 for setting -1 and up to 5 for
@@ -176,6 +195,15 @@ touchpad_accelerator_set_speed(struct motion_filter *filter,
 	filter->speed_adjustment = speed_adjustment;
 	accel_filter->speed_factor = speed_factor(speed_adjustment);
 
+	/* The profile is flat above four times the threshold (in mm/s).
+	 * Steps of 0.5mm/s put the corners of the profile onto table
+	 * entries, so only the curve is interpolated. */
+	accel_lut_build(&accel_filter->lut,
+			filter,
+			4.0 * accel_filter->threshold * accel_filter->dpi / 25.4 /
+				1000000.0,
+			(size_t)(8 * accel_filter->threshold));
+
 	return true;
 }
 
@@ -221,7 +249,7 @@ touchpad_accelerator_destroy(struct motion_filter *filter)
 	struct touchpad_accelerator *accel =
 		(struct touchpad_accelerator *) filter;
 
-	trackers_free(&accel->trackers);
+	accel_lut_free(&accel->lut);
 	free(accel);
 }
 
@@ -317,6 +345,7 @@ struct motion_filter_interface accelerator_interface_touchpad = {
 	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE,
 	.filter = accelerator_filter_post_normalized,
 	.filter_constant = touchpad_constant_filter,
+	.filter_batch = accelerator_filter_batch_post_normalized,
 	.restart = touchpad_accelerator_restart,
 	.destroy = touchpad_accelerator_destroy,
 	.set_speed = touchpad_accelerator_set_speed,
@@ -329,23 +358,24 @@ create_pointer_accelerator_filter_touchpad(int dpi,
 	bool use_velocity_averaging)
 {
 	struct touchpad_accelerator *filter;
-	struct pointer_delta_smoothener *smoothener;
 
 	filter = zalloc(sizeof *filter);
 	filter->last_velocity = 0.0;
 
 	trackers_init(&filter->trackers, use_velocity_averaging ? 16 : 2);
+	filter->base.trackers = &filter->trackers;
+	/* device units */
+	filter->base.history_scale = dpi/(double)DEFAULT_MOUSE_DPI;
 
 	filter->threshold = 130;
 	filter->dpi = dpi;
 
 	filter->base.interface = &accelerator_interface_touchpad;
 	filter->profile = touchpad_accel_profile_linear;
+	accel_lut_init(&filter->lut, filter->profile);
 
-	smoothener = zalloc(sizeof(*smoothener));
-	smoothener->threshold = event_delta_smooth_threshold,
-	smoothener->value = event_delta_smooth_value,
-	filter->trackers.smoothener = smoothener;
+	filter->trackers.smoothener.threshold = event_delta_smooth_threshold;
+	filter->trackers.smoothener.value = event_delta_smooth_value;
 
 	return &filter->base;
 }
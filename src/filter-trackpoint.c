@@ -42,8 +42,15 @@ struct trackpoint_accelerator {
 	double speed_factor;
 
 	double multiplier;
+
+	struct accel_lut lut;
 };
 
+/* Velocities in units/ms beyond what the lookup table covers, the
+ * profile is evaluated directly for those */
+#define TRACKPOINT_LUT_MAX_VELOCITY 4.0
+#define TRACKPOINT_LUT_ENTRIES 1024
+
 double
 trackpoint_accel_profile(struct motion_filter *filter,
 			 void *data,
@@ -88,13 +95,30 @@ trackpoint_accelerator_filter(struct motion_filter *filter,
 	trackers_feed(&accel_filter->trackers, &multiplied, time);
 	velocity = trackers_velocity(&accel_filter->trackers, time);
 
-	f = trackpoint_accel_profile(filter, data, velocity, time);
+	f = accel_lut_lookup(&accel_filter->lut, filter, data, velocity, time);
 	coords.x = multiplied.x * f;
 	coords.y = multiplied.y * f;
 
 	return coords;
 }
 
+static void
+trackpoint_accelerator_filter_batch(struct motion_filter *filter,
+				    const struct device_float_coords *unaccelerated,
+				    const uint64_t *times,
+				    struct normalized_coords *accelerated,
+				    size_t n,
+				    void *data)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		accelerated[i] = trackpoint_accelerator_filter(filter,
+							       &unaccelerated[i],
+							       data,
+							       times[i]);
+}
+
 static struct normalized_coords
 trackpoint_accelerator_filter_noop(struct motion_filter *filter,
 				   const struct device_float_coords *unaccelerated,
@@ -146,6 +170,11 @@ trackpoint_accelerator_set_speed(struct motion_filter *filter,
 	filter->speed_adjustment = speed_adjustment;
 	accel_filter->speed_factor = speed_factor(speed_adjustment);
 
+	/* the profile calls pow(), avoid that for every event */
+	accel_lut_build(&accel_filter->lut,
+			filter,
+			v_ms2us(TRACKPOINT_LUT_MAX_VELOCITY),
+			TRACKPOINT_LUT_ENTRIES);
 
 	return true;
 }
@@ -167,7 +196,7 @@ trackpoint_accelerator_destroy(struct motion_filter *filter)
 	struct trackpoint_accelerator *accel_filter =
 		(struct trackpoint_accelerator *)filter;
 
-	trackers_free(&accel_filter->trackers);
+	accel_lut_free(&accel_filter->lut);
 	free(accel_filter);
 }
 
@@ -175,6 +204,7 @@ struct motion_filter_interface accelerator_interface_trackpoint = {
 	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE,
 	.filter = trackpoint_accelerator_filter,
 	.filter_constant = trackpoint_accelerator_filter_noop,
+	.filter_batch = trackpoint_accelerator_filter_batch,
 	.restart = trackpoint_accelerator_restart,
 	.destroy = trackpoint_accelerator_destroy,
 	.set_speed = trackpoint_accelerator_set_speed,
@@ -184,7 +214,6 @@ struct motion_filter *
 create_pointer_accelerator_filter_trackpoint(double multiplier, bool use_velocity_averaging)
 {
 	struct trackpoint_accelerator *filter;
-	struct pointer_delta_smoothener *smoothener;
 
 	assert(multiplier > 0.0);
 
@@ -207,13 +236,16 @@ create_pointer_accelerator_filter_trackpoint(double multiplier, bool use_velocit
 	filter->multiplier = multiplier;
 
 	trackers_init(&filter->trackers, use_velocity_averaging ? 16 : 2);
+	filter->base.trackers = &filter->trackers;
+	/* The trackers are in device units times the multiplier, without
+	 * a dpi those can't be converted so the history isn't copied */
+	filter->base.history_scale = 0.0;
 
 	filter->base.interface = &accelerator_interface_trackpoint;
+	accel_lut_init(&filter->lut, trackpoint_accel_profile);
 
-	smoothener = zalloc(sizeof(*smoothener));
-	smoothener->threshold = ms2us(10);
-	smoothener->value = ms2us(10);
-	filter->trackers.smoothener = smoothener;
+	filter->trackers.smoothener.threshold = ms2us(10);
+	filter->trackers.smoothener.value = ms2us(10);
 
 	return &filter->base;
 }
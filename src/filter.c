@@ -45,6 +45,33 @@ filter_dispatch(struct motion_filter *filter,
 	return filter->interface->filter(filter, unaccelerated, data, time);
 }
 
+void
+filter_dispatch_batch(struct motion_filter *filter,
+		      const struct device_float_coords *unaccelerated,
+		      const uint64_t *times,
+		      struct normalized_coords *accelerated,
+		      size_t n,
+		      void *data)
+{
+	size_t i;
+
+	if (filter->interface->filter_batch) {
+		filter->interface->filter_batch(filter,
+						unaccelerated,
+						times,
+						accelerated,
+						n,
+						data);
+		return;
+	}
+
+	for (i = 0; i < n; i++)
+		accelerated[i] = filter->interface->filter(filter,
+							   &unaccelerated[i],
+							   data,
+							   times[i]);
+}
+
 struct normalized_coords
 filter_dispatch_constant(struct motion_filter *filter,
 			 const struct device_float_coords *unaccelerated,
@@ -53,6 +80,24 @@ filter_dispatch_constant(struct motion_filter *filter,
 	return filter->interface->filter_constant(filter, unaccelerated, data, time);
 }
 
+void
+filter_copy_history(struct motion_filter *dest,
+		    struct motion_filter *src)
+{
+	if (!dest->trackers || !src->trackers)
+		return;
+
+	/* The filters feed their trackers in different units, e.g. device
+	 * units or normalized units. A delta in the wrong unit gives a
+	 * wrong velocity on the first motion after the switch */
+	if (dest->history_scale == 0.0 || src->history_scale == 0.0)
+		return;
+
+	trackers_copy_history(dest->trackers,
+			      src->trackers,
+			      dest->history_scale / src->history_scale);
+}
+
 void
 filter_restart(struct motion_filter *filter,
 	       void *data, uint64_t time)
@@ -90,20 +135,14 @@ filter_get_type(struct motion_filter *filter)
 }
 
 void
-trackers_init(struct pointer_trackers *trackers, int ntrackers)
+trackers_init(struct pointer_trackers *trackers, unsigned int ntrackers)
 {
-	trackers->trackers = zalloc(ntrackers *
-				    sizeof(*trackers->trackers));
-	trackers->ntrackers = ntrackers;
-	trackers->cur_tracker = 0;
-	trackers->smoothener = NULL;
-}
+	assert(ntrackers > 0 && ntrackers <= POINTER_TRACKERS_MAX);
+	assert((ntrackers & (ntrackers - 1)) == 0);
 
-void
-trackers_free(struct pointer_trackers *trackers)
-{
-	free(trackers->trackers);
-	free(trackers->smoothener);
+	memset(trackers, 0, sizeof(*trackers));
+	trackers->ntrackers = ntrackers;
+	trackers->mask = ntrackers - 1;
 }
 
 void
@@ -117,13 +156,59 @@ trackers_reset(struct pointer_trackers *trackers,
 		tracker = trackers_by_offset(trackers, offset);
 		tracker->time = 0;
 		tracker->dir = 0;
-		tracker->delta.x = 0;
-		tracker->delta.y = 0;
+		tracker->sum = trackers->sum;
 	}
 
 	tracker = trackers_by_offset(trackers, 0);
 	tracker->time = time;
 	tracker->dir = UNDEFINED_DIRECTION;
+	tracker->sum = trackers->sum;
+}
+
+void
+trackers_copy_history(struct pointer_trackers *dest,
+		      struct pointer_trackers *src,
+		      double scale)
+{
+	unsigned int offset;
+	unsigned int n = min(dest->ntrackers, src->ntrackers);
+
+	/* Copy the most recent trackers so the velocity carries over, the
+	 * smoothener belongs to the filter and stays as-is. The velocity
+	 * only depends on the differences between the sums, scaling the
+	 * sums converts it into the dest units */
+	dest->sum.x = src->sum.x * scale;
+	dest->sum.y = src->sum.y * scale;
+	trackers_reset(dest, 0);
+
+	for (offset = 0; offset < n; offset++) {
+		struct pointer_tracker *tracker = trackers_by_offset(dest, offset);
+
+		*tracker = *trackers_by_offset(src, offset);
+		tracker->sum.x *= scale;
+		tracker->sum.y *= scale;
+	}
+}
+
+/* Once the running sum gets this large we move the origin back to zero so
+ * the per-tracker differences don't lose precision. Deltas are in
+ * device units, it takes a long time of continuous motion in one
+ * direction to get here. */
+#define TRACKERS_SUM_REBASE 1e6
+
+static void
+trackers_rebase(struct pointer_trackers *trackers)
+{
+	struct device_float_coords origin = trackers->sum;
+	unsigned int i;
+
+	for (i = 0; i < trackers->ntrackers; i++) {
+		trackers->trackers[i].sum.x -= origin.x;
+		trackers->trackers[i].sum.y -= origin.y;
+	}
+
+	trackers->sum.x = 0.0;
+	trackers->sum.y = 0.0;
 }
 
 void
@@ -131,77 +216,83 @@ trackers_feed(struct pointer_trackers *trackers,
 	      const struct device_float_coords *delta,
 	      uint64_t time)
 {
-	unsigned int i, current;
+	unsigned int current;
 	struct pointer_tracker *ts = trackers->trackers;
 
 	assert(trackers->ntrackers);
 
-	for (i = 0; i < trackers->ntrackers; i++) {
-		ts[i].delta.x += delta->x;
-		ts[i].delta.y += delta->y;
-	}
+	/* Rather than adding the delta to every tracker, we keep a running
+	 * sum of all deltas and each tracker remembers the sum at the time
+	 * it was started. The tracker's delta is the difference. */
+	trackers->sum.x += delta->x;
+	trackers->sum.y += delta->y;
 
-	current = (trackers->cur_tracker + 1) % trackers->ntrackers;
+	if (fabs(trackers->sum.x) > TRACKERS_SUM_REBASE ||
+	    fabs(trackers->sum.y) > TRACKERS_SUM_REBASE)
+		trackers_rebase(trackers);
+
+	current = (trackers->cur_tracker + 1) & trackers->mask;
 	trackers->cur_tracker = current;
 
-	ts[current].delta.x = 0.0;
-	ts[current].delta.y = 0.0;
+	ts[current].sum = trackers->sum;
 	ts[current].time = time;
 	ts[current].dir = device_float_get_direction(*delta);
 }
 
-struct pointer_tracker *
-trackers_by_offset(struct pointer_trackers *trackers, unsigned int offset)
+struct device_float_coords
+trackers_delta(struct pointer_trackers *trackers,
+	       struct pointer_tracker *tracker)
 {
-	unsigned int index =
-		(trackers->cur_tracker + trackers->ntrackers - offset)
-		% trackers->ntrackers;
-	return &trackers->trackers[index];
+	struct device_float_coords delta;
+
+	delta.x = trackers->sum.x - tracker->sum.x;
+	delta.y = trackers->sum.y - tracker->sum.y;
+
+	return delta;
 }
 
-static double
-calculate_trackers_velocity(struct pointer_tracker *tracker,
-			   uint64_t time,
-			   struct pointer_delta_smoothener *smoothener)
+static inline uint64_t
+calculate_trackers_tdelta(struct pointer_trackers *trackers,
+			  struct pointer_tracker *tracker,
+			  uint64_t time)
 {
+	const struct pointer_delta_smoothener *smoothener =
+		&trackers->smoothener;
 	uint64_t tdelta = time - tracker->time + 1;
 
-	if (smoothener && tdelta < smoothener->threshold)
+	if (tdelta < smoothener->threshold)
 		tdelta = smoothener->value;
 
-	return hypot(tracker->delta.x, tracker->delta.y) /
-	       (double)tdelta; /* units/us */
+	return tdelta;
 }
 
 static double
-trackers_velocity_after_timeout(struct pointer_tracker *tracker,
-				 struct pointer_delta_smoothener *smoothener)
+calculate_trackers_velocity(struct pointer_trackers *trackers,
+			   struct pointer_tracker *tracker,
+			   uint64_t time)
 {
-	/* First movement after timeout needs special handling.
-	 *
-	 * When we trigger the timeout, the last event is too far in the
-	 * past to use it for velocity calculation across multiple tracker
-	 * values.
-	 *
-	 * Use the motion timeout itself to calculate the speed rather than
-	 * the last tracker time. This errs on the side of being too fast
-	 * for really slow movements but provides much more useful initial
-	 * movement in normal use-cases (pause, move, pause, move)
-	 */
-	return calculate_trackers_velocity(tracker,
-					  tracker->time + MOTION_TIMEOUT,
-					  smoothener);
+	struct device_float_coords delta = trackers_delta(trackers, tracker);
+	uint64_t tdelta = calculate_trackers_tdelta(trackers, tracker, time);
+
+	return hypot(delta.x, delta.y) / (double)tdelta; /* units/us */
 }
 
 /**
- * Calculate the velocity based on the tracker data. Velocity is averaged
+ * Find the velocity based on the tracker data. Velocity is averaged
  * across multiple historical values, provided those values aren't "too
  * different" to our current one. That includes either being too far in the
  * past, moving into a different direction or having too much of a velocity
  * change between events.
+ *
+ * The tracker the velocity is based on and the time to calculate it
+ * against are returned in picked and picked_time, picked is NULL if the
+ * velocity is zero.
  */
-double
-trackers_velocity(struct pointer_trackers *trackers, uint64_t time)
+static double
+trackers_find_velocity(struct pointer_trackers *trackers,
+		       uint64_t time,
+		       struct pointer_tracker **picked,
+		       uint64_t *picked_time)
 {
 	const double MAX_VELOCITY_DIFF = v_ms2us(1); /* units/us */
 	struct pointer_tracker *tracker;
@@ -213,6 +304,9 @@ trackers_velocity(struct pointer_trackers *trackers, uint64_t time)
 
 	unsigned int dir = trackers_by_offset(trackers, 0)->dir;
 
+	*picked = NULL;
+	*picked_time = time;
+
 	/* Find least recent vector within a timelimit, maximum velocity diff
 	 * and direction threshold. */
 	for (offset = 1; offset < trackers->ntrackers; offset++) {
@@ -224,24 +318,43 @@ trackers_velocity(struct pointer_trackers *trackers, uint64_t time)
 
 		/* Stop if too far away in time */
 		if (time - tracker->time > MOTION_TIMEOUT) {
-			if (offset == 1)
-				result = trackers_velocity_after_timeout(
-							  tracker,
-							  trackers->smoothener);
+			/* First movement after timeout needs special
+			 * handling.
+			 *
+			 * When we trigger the timeout, the last event is
+			 * too far in the past to use it for velocity
+			 * calculation across multiple tracker values.
+			 *
+			 * Use the motion timeout itself to calculate the
+			 * speed rather than the last tracker time. This
+			 * errs on the side of being too fast for really
+			 * slow movements but provides much more useful
+			 * initial movement in normal use-cases (pause,
+			 * move, pause, move)
+			 */
+			if (offset == 1) {
+				*picked = tracker;
+				*picked_time = tracker->time + MOTION_TIMEOUT;
+				result = calculate_trackers_velocity(trackers,
+								    tracker,
+								    *picked_time);
+			}
 			break;
 		}
 
-		velocity = calculate_trackers_velocity(tracker,
-						      time,
-						      trackers->smoothener);
+		velocity = calculate_trackers_velocity(trackers,
+						      tracker,
+						      time);
 
 		/* Stop if direction changed */
 		dir &= tracker->dir;
 		if (dir == 0) {
 			/* First movement after dirchange - velocity is that
 			 * of the last movement */
-			if (offset == 1)
+			if (offset == 1) {
+				*picked = tracker;
 				result = velocity;
+			}
 			break;
 		}
 
@@ -258,11 +371,139 @@ trackers_velocity(struct pointer_trackers *trackers, uint64_t time)
 
 			result = velocity;
 		}
+		*picked = tracker;
 	}
 
 	return result; /* units/us */
 }
 
+double
+trackers_velocity(struct pointer_trackers *trackers, uint64_t time)
+{
+	struct pointer_tracker *picked;
+	uint64_t picked_time;
+
+	return trackers_find_velocity(trackers, time, &picked, &picked_time);
+}
+
+struct device_float_coords
+trackers_velocity_vector(struct pointer_trackers *trackers, uint64_t time)
+{
+	struct pointer_tracker *picked;
+	uint64_t picked_time, tdelta;
+	struct device_float_coords v = { 0.0, 0.0 };
+
+	trackers_find_velocity(trackers, time, &picked, &picked_time);
+	if (!picked)
+		return v;
+
+	v = trackers_delta(trackers, picked);
+	tdelta = calculate_trackers_tdelta(trackers, picked, picked_time);
+	v.x /= tdelta;
+	v.y /= tdelta;
+
+	return v; /* units/us */
+}
+
+/* A prediction further into the future than this is considered a
+ * stopped pointer rather than a very long extrapolation */
+#define PREDICTION_MAX		ms2us(50)
+
+struct motion_predictor {
+	struct pointer_trackers trackers;
+	uint64_t last_time;
+	bool have_motion;
+	bool have_position;
+	struct device_float_coords position;
+};
+
+struct motion_predictor *
+motion_predictor_create(void)
+{
+	struct motion_predictor *predictor;
+
+	predictor = zalloc(sizeof *predictor);
+	trackers_init(&predictor->trackers, POINTER_TRACKERS_MAX);
+
+	return predictor;
+}
+
+void
+motion_predictor_destroy(struct motion_predictor *predictor)
+{
+	free(predictor);
+}
+
+void
+motion_predictor_reset(struct motion_predictor *predictor)
+{
+	trackers_init(&predictor->trackers, predictor->trackers.ntrackers);
+	predictor->last_time = 0;
+	predictor->have_motion = false;
+	predictor->have_position = false;
+}
+
+void
+motion_predictor_feed_delta(struct motion_predictor *predictor,
+			    const struct device_float_coords *delta,
+			    uint64_t time)
+{
+	trackers_feed(&predictor->trackers, delta, time);
+	predictor->last_time = time;
+	predictor->have_motion = true;
+}
+
+void
+motion_predictor_feed_position(struct motion_predictor *predictor,
+			       const struct device_float_coords *position,
+			       uint64_t time)
+{
+	struct device_float_coords delta;
+
+	/* The first position only provides the base for the deltas */
+	if (!predictor->have_position) {
+		predictor->position = *position;
+		predictor->have_position = true;
+		predictor->last_time = time;
+		return;
+	}
+
+	delta.x = position->x - predictor->position.x;
+	delta.y = position->y - predictor->position.y;
+	predictor->position = *position;
+
+	motion_predictor_feed_delta(predictor, &delta, time);
+}
+
+bool
+motion_predictor_predict(struct motion_predictor *predictor,
+			 uint64_t time,
+			 struct device_float_coords *delta)
+{
+	struct device_float_coords velocity;
+	uint64_t tdelta;
+
+	delta->x = 0.0;
+	delta->y = 0.0;
+
+	if (!predictor->have_motion && !predictor->have_position)
+		return false;
+
+	if (!predictor->have_motion || time <= predictor->last_time)
+		return true;
+
+	tdelta = time - predictor->last_time;
+	if (tdelta > PREDICTION_MAX)
+		return true;
+
+	velocity = trackers_velocity_vector(&predictor->trackers,
+					    predictor->last_time);
+	delta->x = velocity.x * tdelta;
+	delta->y = velocity.y * tdelta;
+
+	return true;
+}
+
 /**
  * Calculate the acceleration factor for our current velocity, averaging
  * between our current and the most recent velocity to smoothen out changes.
@@ -297,3 +538,80 @@ calculate_acceleration_simpsons(struct motion_filter *filter,
 
 	return factor; /* unitless factor */
 }
+
+void
+accel_lut_init(struct accel_lut *lut, accel_profile_func_t profile)
+{
+	lut->profile = profile;
+	lut->max_velocity = 0.0;
+	lut->scale = 0.0;
+	lut->nentries = 0;
+	lut->factors = NULL;
+}
+
+/**
+ * Sample the profile into the lookup table, any previous table contents
+ * are replaced. The profile is called with NULL data and a zero
+ * timestamp, it must only depend on the velocity and the filter.
+ *
+ * @param lut The lookup table to build
+ * @param filter The acceleration filter passed to the profile
+ * @param max_velocity The largest velocity in the table, in units/us
+ * @param nentries The number of steps between 0 and max_velocity
+ */
+void
+accel_lut_build(struct accel_lut *lut,
+		struct motion_filter *filter,
+		double max_velocity,
+		size_t nentries)
+{
+	size_t i;
+
+	assert(max_velocity > 0.0);
+	assert(nentries > 0);
+
+	if (lut->nentries != nentries) {
+		free(lut->factors);
+		lut->factors = zalloc((nentries + 1) * sizeof(*lut->factors));
+		lut->nentries = nentries;
+	}
+
+	lut->max_velocity = max_velocity;
+	lut->scale = nentries / max_velocity;
+
+	for (i = 0; i <= nentries; i++)
+		lut->factors[i] = lut->profile(filter, NULL, i / lut->scale, 0);
+}
+
+void
+accel_lut_free(struct accel_lut *lut)
+{
+	free(lut->factors);
+	lut->factors = NULL;
+	lut->nentries = 0;
+}
+
+/**
+ * Like calculate_acceleration_simpsons() but using the lookup table
+ * instead of evaluating the profile.
+ */
+double
+calculate_acceleration_simpsons_lut(struct motion_filter *filter,
+				    const struct accel_lut *lut,
+				    void *data,
+				    double velocity,
+				    double last_velocity,
+				    uint64_t time)
+{
+	double factor;
+
+	factor = accel_lut_lookup(lut, filter, data, velocity, time);
+	factor += accel_lut_lookup(lut, filter, data, last_velocity, time);
+	factor += 4.0 * accel_lut_lookup(lut, filter, data,
+					 (last_velocity + velocity) / 2,
+					 time);
+
+	factor = factor / 6.0;
+
+	return factor; /* unitless factor */
+}
@@ -61,6 +61,32 @@ filter_dispatch(struct motion_filter *filter,
 		const struct device_float_coords *unaccelerated,
 		void *data, uint64_t time);
 
+/**
+ * Accelerate a sequence of coordinates.
+ *
+ * This is equivalent to calling filter_dispatch() for each delta in
+ * order but avoids the per-event call overhead. It is intended for
+ * replaying recorded motion, e.g. in the ptraccel-debug tool.
+ *
+ * @param filter The device's motion filter
+ * @param unaccelerated Array of n unaccelerated deltas, see
+ * filter_dispatch()
+ * @param times Array of n timestamps, one per delta
+ * @param accelerated Array of n normalized coordinates, filled in by
+ * the filter
+ * @param n The number of deltas
+ * @param data Custom data, passed to the filter for each delta
+ *
+ * @see filter_dispatch
+ */
+void
+filter_dispatch_batch(struct motion_filter *filter,
+		      const struct device_float_coords *unaccelerated,
+		      const uint64_t *times,
+		      struct normalized_coords *accelerated,
+		      size_t n,
+		      void *data);
+
 /**
  * Apply constant motion filters, but no acceleration.
  *
@@ -86,6 +112,16 @@ void
 filter_restart(struct motion_filter *filter,
 	       void *data, uint64_t time);
 
+/**
+ * Copy the motion history from one filter to another, e.g. when
+ * replacing a device's filter. The velocity of the next event is then
+ * calculated as if the new filter had been in use all along.
+ * Does nothing if either filter does not track motion history.
+ */
+void
+filter_copy_history(struct motion_filter *dest,
+		    struct motion_filter *src);
+
 void
 filter_destroy(struct motion_filter *filter);
 
@@ -98,6 +134,43 @@ filter_get_speed(struct motion_filter *filter);
 enum libinput_config_accel_profile
 filter_get_type(struct motion_filter *filter);
 
+/**
+ * A motion predictor extrapolates the recent motion of a device to a
+ * future timestamp, based on the same velocity tracking as the
+ * acceleration filters. It is fed either deltas or absolute positions,
+ * the prediction is a delta relative to the last fed event in the same
+ * units.
+ */
+struct motion_predictor;
+
+struct motion_predictor *
+motion_predictor_create(void);
+
+void
+motion_predictor_destroy(struct motion_predictor *predictor);
+
+void
+motion_predictor_reset(struct motion_predictor *predictor);
+
+void
+motion_predictor_feed_delta(struct motion_predictor *predictor,
+			    const struct device_float_coords *delta,
+			    uint64_t time);
+
+void
+motion_predictor_feed_position(struct motion_predictor *predictor,
+			       const struct device_float_coords *position,
+			       uint64_t time);
+
+/**
+ * @return false if no motion was fed since the last reset, true
+ * otherwise
+ */
+bool
+motion_predictor_predict(struct motion_predictor *predictor,
+			 uint64_t time,
+			 struct device_float_coords *delta);
+
 typedef double (*accel_profile_func_t)(struct motion_filter *filter,
 				       void *data,
 				       double velocity,
@@ -107,6 +180,16 @@ typedef double (*accel_profile_func_t)(struct motion_filter *filter,
 struct motion_filter *
 create_pointer_accelerator_filter_flat(int dpi);
 
+/* Maximum number of points in a custom acceleration curve */
+#define CUSTOM_ACCEL_NPOINTS_MAX 64
+
+struct motion_filter *
+create_pointer_accelerator_filter_custom(int dpi,
+					 bool use_velocity_averaging,
+					 double step,
+					 const double *points,
+					 size_t npoints);
+
 struct motion_filter *
 create_pointer_accelerator_filter_linear(int dpi, bool use_velocity_averaging);
 
@@ -35,11 +35,17 @@
 #include <libwacom/libwacom.h>
 #endif
 
+#if HAVE_IO_URING
+#include <liburing.h>
+#endif
+
 #include "linux/input.h"
 
 #include "libinput.h"
 #include "libinput-util.h"
 #include "libinput-version.h"
+#include "libinput-tracepoints.h"
+#include "timer.h"
 
 struct libinput_source;
 
@@ -124,47 +130,350 @@ struct libinput_interface_backend {
 				  const char *seat_name);
 };
 
+/* The event struct types, each type has its own free-list in the event
+ * cache */
+/* Event types are grouped in blocks of 100 (LIBINPUT_EVENT_KEYBOARD_KEY
+ * is 300, ...), the event type masks keep one 32-bit mask per block */
+#define EVENT_TYPE_MASK_GROUPS (LIBINPUT_EVENT_SWITCH_TOGGLE / 100 + 1)
+
+/* Enough for all types within each block of event types */
+#define EVENT_TYPES_PER_GROUP 8
+
+#define STARTUP_PHASE_COUNT (LIBINPUT_STARTUP_PHASE_NOTIFY + 1)
+#define DEVICE_STAT_COUNT (LIBINPUT_DEVICE_STAT_HOVER_FRAMES + 1)
+#define DELAY_SOURCE_COUNT (LIBINPUT_DELAY_SOURCE_TABLET_PROXIMITY + 1)
+#define PROFILE_STAGE_COUNT (LIBINPUT_PROFILE_STAGE_EVENT_QUEUE + 1)
+
+enum libinput_event_slab {
+	EVENT_SLAB_DEVICE_NOTIFY,
+	EVENT_SLAB_KEYBOARD,
+	EVENT_SLAB_POINTER,
+	EVENT_SLAB_TOUCH,
+	EVENT_SLAB_GESTURE,
+	EVENT_SLAB_TABLET_TOOL,
+	EVENT_SLAB_TABLET_PAD,
+	EVENT_SLAB_SWITCH,
+
+	EVENT_SLAB_COUNT,
+};
+
+struct event_slab_entry;
+
+#define LOG_RING_MAX_ARGS 8
+#define LOG_RING_STRINGS_SIZE 128
+
+/* A message in the log ring, see libinput_log_set_ring(). The arguments
+ * are stored in the order of the format's conversions, string arguments
+ * are copied into strings and the argument is the offset. A message that
+ * can't be stored like this (too many or unsupported arguments) is
+ * formatted into strings instead and format is NULL. */
+struct log_ring_entry {
+	const char *format;
+	uint64_t time;
+	enum libinput_log_priority priority;
+	char sysname[16]; /* empty if not a device message */
+	union log_ring_arg {
+		long long i;
+		double d;
+		const void *p;
+	} args[LOG_RING_MAX_ARGS];
+	char strings[LOG_RING_STRINGS_SIZE];
+};
+
+#if HAVE_LIBWACOM
+/* What libwacom knows about a tool_id, see libinput_libwacom_get_stylus() */
+struct libinput_libwacom_stylus {
+	uint32_t tool_id;
+	bool known; /* false if libwacom has no stylus for the tool_id */
+	WacomStylusType type;
+	int num_buttons;
+	bool has_wheel;
+	WacomAxisTypeFlags axes;
+};
+
+/* A ring, strip or LED group of a pad, as described by libwacom */
+struct libinput_libwacom_pad_group {
+	int num_modes;
+	uint32_t button_mask;
+	uint32_t toggle_button_mask;
+	uint32_t ring_mask;
+	uint32_t strip_mask;
+};
+
+#define LIBWACOM_PAD_MAX_GROUPS 4
+
+/* What a pad's mode groups look like, see libinput_libwacom_get_pad() */
+struct libinput_libwacom_pad {
+	char *syspath; /* the pad's input device, NULL for an unused entry */
+	int vendor;
+	int product;
+	char *led_base; /* prefix of the LED sysfs directories or NULL */
+	bool known; /* false if libwacom has no usable description */
+	size_t ngroups;
+	struct libinput_libwacom_pad_group groups[LIBWACOM_PAD_MAX_GROUPS];
+};
+
+#define LIBWACOM_PADS_MAX 8
+
+struct libinput_libwacom {
+	WacomDeviceDatabase *db;
+	size_t refcount;
+
+	/* Stylus lookups, valid for as long as db */
+	struct libinput_libwacom_stylus *styli;
+	size_t nstyli;
+	size_t styli_size;
+
+	/* Pad lookups, valid for as long as db */
+	struct libinput_libwacom_pad pads[LIBWACOM_PADS_MAX];
+	size_t next_pad;
+};
+#endif
+
 struct libinput {
 	int epoll_fd;
+#if HAVE_IO_URING
+	/* if enabled, replaces epoll and libinput_get_fd() returns the
+	 * eventfd signalled on every completion */
+	struct {
+		bool enabled;
+		struct io_uring ring;
+		int eventfd;
+		bool need_submit;
+	} uring;
+#endif
+	/* see libinput_set_clock(), the timerfd stays disarmed if set */
+	struct {
+		libinput_clock_func func;
+		void *user_data;
+	} clock;
+
+	struct list source_list; /* the live sources */
 	struct list source_destroy_list;
+	/* see libinput_set_source_handler(), sources aren't in the epoll
+	 * fd while set */
+	struct {
+		libinput_source_handler handler;
+		void *user_data;
+	} source_handler;
+	/* Devices without references that are kept alive until no
+	 * queued or caller-held event can point to them anymore */
+	struct list device_destroy_list;
 
 	struct list seat_list;
 
 	struct {
-		struct list list;
+		struct libinput_timer **heap; /* armed timers, min-heap */
+		size_t heap_count;
+		size_t heap_size;
 		struct libinput_source *source;
 		int fd;
-		uint64_t next_expiry;
+		uint64_t next_expiry; /* what the timerfd is programmed to */
+		/* see libinput_set_client_timers(), the timerfd stays
+		 * disarmed if set */
+		bool client_managed;
+		bool in_handler;
+		uint64_t max_slack; /* largest slack of any timer */
+		uint64_t max_frame_slack; /* largest frame slack of any timer */
+		/* see libinput_set_frame_deadline(), 0 if unset */
+		uint64_t frame_deadline;
+		uint64_t settime_calls;
+		uint64_t wakeups;
+		struct list stats; /* struct timer_stats */
+		unsigned int nstats;
 	} timer;
 
+	/* evdev frames per device and dispatch, 0 for unlimited */
+	unsigned int dispatch_budget;
+	/* see libinput_set_frame_merging() */
+	bool frame_merging;
+	/* see libinput_set_low_priority_interval() */
+	struct {
+		uint64_t interval;
+		uint64_t next; /* earliest time of their next dispatch */
+		uint32_t serial; /* the dispatch that last processed them */
+		struct list muted; /* sources left in the kernel buffer */
+		struct libinput_timer timer;
+	} low_priority;
+	uint32_t dispatch_serial;
+	/* sources that ran out of budget, resumed first in the next
+	 * dispatch */
+	struct list dispatch_pending;
+	struct libinput_timer dispatch_pending_timer;
+	/* absolute time in us to stop dispatching, 0 for none */
+	uint64_t dispatch_deadline;
+	/* cached libinput_now() while dispatching, 0 otherwise */
+	uint64_t dispatch_now;
+	uint64_t sources_dispatched;
+
+	/* see libinput_set_event_handoff() */
+	struct {
+		bool enabled;
+		struct ring events; /* to the consumers, shared pop */
+		struct ring released; /* back from the consumers, shared push */
+		size_t outstanding; /* handed over and not yet reclaimed */
+		bool stalled; /* events left queued, shared with the consumer */
+		int fd; /* consumer wakeup */
+		int release_fd; /* dispatch wakeup when stalled */
+		struct libinput_source *release_source;
+	} handoff;
+	/* see libinput_enable_event_ring(), fd is -1 if not enabled */
+	struct {
+		int fd;
+		struct libinput_event_ring_header *header;
+		struct libinput_event_ring_record *records;
+		size_t map_size;
+		uint32_t mask; /* size - 1 */
+		uint64_t head; /* our copy of header->head */
+		uint64_t notified; /* head at the last notification */
+		int *notify_fds;
+		size_t nnotify_fds;
+	} event_ring;
+	uint32_t next_device_id;
+	/* see libinput_enable_evdev_tap(), records is NULL if not enabled */
+	struct {
+		struct libinput_evdev_tap_record *records;
+		size_t mask;
+		size_t head; /* next record to read, written by the recorder */
+		size_t tail; /* next record to write, written by us */
+		size_t notified; /* tail at the last notification */
+		uint64_t dropped;
+		int fd;
+	} evdev_tap;
+	/* see libinput_enable_seat_event_queues() */
+	bool seat_queues;
+	/* us without activity until dispatch returns, 0 for no busy poll */
+	uint64_t busy_poll_window;
+	uint64_t busy_poll_spins;
+	/* see libinput_udev_set_hotplug_damping() */
+	uint64_t hotplug_flaps;
+	uint64_t hotplug_deferred;
+	uint64_t hotplug_suppressed;
+	uint64_t dispatch_time_last; /* us, libinput_dispatch_until() only */
+	uint64_t dispatch_time_total;
+	/* us, device phases summed over all devices */
+	uint64_t startup_time[STARTUP_PHASE_COUNT];
+
+	/* see libinput_set_profiling(), 0 is no stage */
+	struct {
+		bool enabled;
+		enum libinput_profile_stage current;
+		uint64_t since; /* ns, when current was entered or resumed */
+		uint64_t time[PROFILE_STAGE_COUNT]; /* ns */
+		uint64_t count[PROFILE_STAGE_COUNT];
+	} profile;
+
 	struct libinput_event **events;
 	size_t events_count;
 	size_t events_len;
 	size_t events_in;
 	size_t events_out;
+	size_t events_priority; /* key, button, etc. events in the queue */
+	size_t events_high_water; /* max events_count since the last check */
+	size_t events_expected; /* per dispatch, sum over all devices */
+	size_t events_min_len; /* the queue never shrinks below this */
+	unsigned int events_idle_dispatches;
+	uint64_t events_dropped;
+
+	struct {
+		struct {
+			struct event_slab_entry *free_list;
+			size_t count;
+		} slabs[EVENT_SLAB_COUNT];
+		size_t count; /* total across all slabs */
+		size_t peak;
+		uint64_t hits;
+		uint64_t misses;
+	} event_cache;
+
+	uint32_t event_coalescing; /* enum libinput_event_coalescing mask */
+	/* false until the caller sets a mode, the devices use their
+	 * default_event_coalescing until then */
+	bool event_coalescing_set;
+	uint64_t events_coalesced;
+
+	/* see libinput_set_touch_frame_batching() */
+	bool touch_frame_batching;
+	/* see libinput_set_pointer_frame_batching() */
+	bool pointer_frame_batching;
+
+	/* events with a device that are queued or held by the caller */
+	size_t events_in_flight;
+	/* default for new devices, see libinput_set_event_type_enabled() */
+	uint32_t events_disabled[EVENT_TYPE_MASK_GROUPS];
+	uint64_t events_filtered;
+
+	size_t events_peak; /* max events_count over the context lifetime */
+	bool queue_latency_tracking;
+	struct histogram queue_latency; /* in us */
 
 	struct list tool_list;
+	/* Open-addressing index of the tools with a serial in tool_list,
+	 * keyed by (type, serial) */
+	struct {
+		struct libinput_tablet_tool **slots;
+		size_t size;		/* power of two, or 0 */
+		size_t count;		/* live entries */
+		size_t used;		/* live entries and tombstones */
+		uint64_t last_eviction;
+	} tool_hash;
 
 	const struct libinput_interface *interface;
 	const struct libinput_interface_backend *interface_backend;
 
 	libinput_log_handler log_handler;
 	enum libinput_log_priority log_priority;
+	struct {
+		libinput_quiescence_handler handler;
+		void *user_data;
+		bool quiescent; /* as last passed to the handler */
+	} quiescence;
+	struct {
+		struct log_ring_entry *entries; /* NULL if disabled */
+		size_t mask;
+		size_t head; /* oldest message */
+		size_t tail; /* next free slot */
+		size_t lost;
+	} log_ring;
 	void *user_data;
 	int refcount;
 
-	struct list device_group_list;
+	struct ptr_array device_groups; /* struct libinput_device_group */
+	/* Open-addressing index of the device groups with an identifier,
+	 * keyed by the identifier */
+	struct {
+		struct libinput_device_group **slots;
+		size_t size;		/* power of two, or 0 */
+		size_t count;		/* live entries */
+		size_t used;		/* live entries and tombstones */
+	} group_hash;
 
 	uint64_t last_event_time;
 
 	bool quirks_initialized;
 	struct quirks_context *quirks;
+	char *device_cache_path; /* see libinput_set_device_cache() */
+	struct {
+		struct libinput_source *source; /* NULL if not watching */
+		int fd;
+	} quirks_watch;
 
-#if HAVE_LIBWACOM
+	bool cache_sharing;
+
+	/* Recently removed devices, see libinput_set_replug_timeout() */
 	struct {
-		WacomDeviceDatabase *db;
-		size_t refcount;
-	} libwacom;
+		uint32_t timeout; /* ms, 0 if disabled */
+		struct list entries; /* struct replug_entry, newest first */
+		size_t count;
+	} replug;
+
+	libinput_open_async_func open_async;
+
+#if HAVE_LIBWACOM
+	/* Points to libwacom_local or, with cache sharing, to the
+	 * process-wide database */
+	struct libinput_libwacom *libwacom;
+	struct libinput_libwacom libwacom_local;
 #endif
 };
 
@@ -181,9 +490,24 @@ struct libinput_seat {
 	char *physical_name;
 	char *logical_name;
 
-	uint32_t slot_map;
+	/* Seat-wide touch slots in use. The first 64 are in slot_map so
+	 * the common case never allocates, the rest in slot_map_ext, see
+	 * libinput_seat_alloc_slot() */
+	uint64_t slot_map;
+	uint64_t *slot_map_ext;
+	size_t slot_map_ext_words;
 
-	uint32_t button_count[KEY_CNT];
+	struct key_count button_count;
+
+	/* see libinput_enable_seat_event_queues(), events is NULL unless
+	 * enabled */
+	struct {
+		struct libinput_event **events;
+		size_t len;
+		size_t count;
+		size_t out;
+		int fd; /* readable while count > 0 */
+	} queue;
 };
 
 struct libinput_device_config_tap {
@@ -207,6 +531,11 @@ struct libinput_device_config_tap {
 							    enum libinput_config_drag_lock_state);
 	enum libinput_config_drag_lock_state (*get_draglock_enabled)(struct libinput_device *device);
 	enum libinput_config_drag_lock_state (*get_default_draglock_enabled)(struct libinput_device *device);
+
+	enum libinput_config_status (*set_early_commit_enabled)(struct libinput_device *device,
+								enum libinput_config_tap_early_commit_state);
+	enum libinput_config_tap_early_commit_state (*get_early_commit_enabled)(struct libinput_device *device);
+	enum libinput_config_tap_early_commit_state (*get_default_early_commit_enabled)(struct libinput_device *device);
 };
 
 struct libinput_device_config_calibration {
@@ -239,6 +568,10 @@ struct libinput_device_config_accel {
 						   enum libinput_config_accel_profile);
 	enum libinput_config_accel_profile (*get_profile)(struct libinput_device *device);
 	enum libinput_config_accel_profile (*get_default_profile)(struct libinput_device *device);
+	enum libinput_config_status (*set_custom_curve)(struct libinput_device *device,
+							double step,
+							const double *points,
+							size_t npoints);
 };
 
 struct libinput_device_config_natural_scroll {
@@ -302,6 +635,17 @@ struct libinput_device_config_dwt {
 			 struct libinput_device *device);
 };
 
+struct libinput_device_config_low_latency {
+	int (*is_available)(struct libinput_device *device);
+	enum libinput_config_status (*set_enabled)(
+			 struct libinput_device *device,
+			 enum libinput_config_low_latency_state enable);
+	enum libinput_config_low_latency_state (*get_enabled)(
+			 struct libinput_device *device);
+	enum libinput_config_low_latency_state (*get_default_enabled)(
+			 struct libinput_device *device);
+};
+
 struct libinput_device_config_rotation {
 	int (*is_available)(struct libinput_device *device);
 	enum libinput_config_status (*set_angle)(
@@ -311,6 +655,11 @@ struct libinput_device_config_rotation {
 	unsigned int (*get_default_angle)(struct libinput_device *device);
 };
 
+struct libinput_device_config_transaction {
+	/* Apply the changes deferred since libinput_device_config_begin() */
+	void (*commit)(struct libinput_device *device);
+};
+
 struct libinput_device_config {
 	struct libinput_device_config_tap *tap;
 	struct libinput_device_config_calibration *calibration;
@@ -323,26 +672,71 @@ struct libinput_device_config {
 	struct libinput_device_config_middle_emulation *middle_emulation;
 	struct libinput_device_config_dwt *dwt;
 	struct libinput_device_config_rotation *rotation;
+	struct libinput_device_config_low_latency *low_latency;
+	struct libinput_device_config_transaction *transaction;
 };
 
 struct libinput_device_group {
 	int refcount;
 	void *user_data;
 	char *identifier; /* unique identifier or NULL for singletons */
+	/* device_group_key() of the device the identifier was computed
+	 * for, NULL if it came from udev */
+	char *key;
 
-	struct list link;
+	struct libinput *libinput;
 };
 
+struct motion_predictor;
+struct pointer_frame;
+
 struct libinput_device {
 	struct libinput_seat *seat;
 	struct libinput_device_group *group;
 	struct list link;
 	struct list event_listeners;
+	uint32_t listener_event_groups; /* union of all listeners' groups */
 	void *user_data;
 	int refcount;
+	uint32_t id; /* unique in the context, see the event ring */
 	struct libinput_device_config config;
+	bool config_transaction; /* between config_begin and config_commit */
+	uint32_t events_disabled[EVENT_TYPE_MASK_GROUPS];
+	/* enum libinput_event_coalescing mask, see event_coalescing_set */
+	uint32_t default_event_coalescing;
+	bool latency_tracking;
+	struct histogram latency; /* kernel to dispatch, in us */
+	struct histogram first_motion_latency; /* touch down to motion, in us */
+	/* events held back by a state machine, in us */
+	struct histogram delay[DELAY_SOURCE_COUNT];
+	struct motion_predictor *predictor; /* NULL unless enabled */
+	/* between pointer_frame_begin() and pointer_frame_end() */
+	bool pointer_frame_open;
+	struct pointer_frame *pointer_frame; /* the frame being filled */
+	uint64_t startup_time[STARTUP_PHASE_COUNT]; /* us */
+	uint64_t stats[DEVICE_STAT_COUNT];
+	uint64_t event_count[EVENT_TYPE_MASK_GROUPS][EVENT_TYPES_PER_GROUP];
 };
 
+static inline void
+libinput_device_stat_inc(struct libinput_device *device,
+			 enum libinput_device_stat stat)
+{
+	device->stats[stat]++;
+}
+
+static inline void
+libinput_device_record_delay(struct libinput_device *device,
+			     enum libinput_delay_source source,
+			     uint64_t since,
+			     uint64_t now)
+{
+	if (!device->latency_tracking)
+		return;
+
+	histogram_add(&device->delay[source], now > since ? now - since : 0);
+}
+
 enum libinput_tablet_tool_axis {
 	LIBINPUT_TABLET_TOOL_AXIS_X = 1,
 	LIBINPUT_TABLET_TOOL_AXIS_Y = 2,
@@ -359,6 +753,12 @@ enum libinput_tablet_tool_axis {
 
 #define LIBINPUT_TABLET_TOOL_AXIS_MAX LIBINPUT_TABLET_TOOL_AXIS_SIZE_MINOR
 
+enum tablet_rotation_source {
+	TABLET_ROTATION_VALUE,	/* rotation is the value in degrees */
+	TABLET_ROTATION_TILT,	/* mouse/lens, from the tilt in degrees */
+	TABLET_ROTATION_ABS,	/* artpen, x is ABS_Z normalized to [0, 1[ */
+};
+
 struct tablet_axes {
 	struct device_coords point;
 	struct normalized_coords delta;
@@ -366,12 +766,58 @@ struct tablet_axes {
 	double pressure;
 	struct tilt_degrees tilt;
 	double rotation;
+	/* Most callers never look at the rotation, it is only converted
+	 * to degrees on first use, see tablet_axes_get_rotation() */
+	struct {
+		enum tablet_rotation_source source;
+		double x, y;
+		bool left_handed;
+	} rotation_raw;
 	double slider;
 	double wheel;
 	int wheel_discrete;
 	struct phys_ellipsis size;
 };
 
+static inline double
+tablet_axes_get_rotation(struct tablet_axes *axes)
+{
+	double angle = 0.0;
+
+	switch (axes->rotation_raw.source) {
+	case TABLET_ROTATION_VALUE:
+		return axes->rotation;
+	case TABLET_ROTATION_TILT: {
+		/* Wacom Intuos 4, 5, Pro mouse calculates rotation from
+		   the x/y tilt values. The device has a 175 degree CCW
+		   hardware offset but since we use atan2 the effective
+		   offset is just 5 degrees.
+		   */
+		const int offset = 5;
+		double x = axes->rotation_raw.x,
+		       y = axes->rotation_raw.y;
+
+		/* atan2 is CCW, we want CW -> negate x */
+		if (x || y)
+			angle = ((180.0 * atan2(-x, y)) / M_PI);
+
+		angle = fmod(360 + angle - offset, 360);
+		break;
+	}
+	case TABLET_ROTATION_ABS:
+		/* artpen has 0 with buttons pointing east */
+		angle = fmod(axes->rotation_raw.x * 360.0 + 90, 360.0);
+		if (axes->rotation_raw.left_handed)
+			angle = fmod(180 + angle, 360);
+		break;
+	}
+
+	axes->rotation = angle;
+	axes->rotation_raw.source = TABLET_ROTATION_VALUE;
+
+	return angle;
+}
+
 struct libinput_tablet_tool {
 	struct list link;
 	uint32_t serial;
@@ -387,6 +833,9 @@ struct libinput_tablet_tool {
 	/* pressure_offset includes axis->minimum */
 	int pressure_offset;
 	bool has_pressure_offset;
+
+	uint64_t last_used;	/* last frame the tool was seen in */
+	bool in_proximity;
 };
 
 struct libinput_tablet_pad_mode_group {
@@ -411,10 +860,16 @@ struct libinput_tablet_pad_mode_group {
 struct libinput_event {
 	enum libinput_event_type type;
 	struct libinput_device *device;
+	uint64_t queued_time; /* 0 unless queue latency tracking is on */
 };
 
+/* The event group of an event type, for filtering event listeners */
+#define EVENT_GROUP(type_) bit((type_) / 100)
+
 struct libinput_event_listener {
 	struct list link;
+	struct libinput_device *device;
+	uint32_t event_groups; /* EVENT_GROUP() mask */
 	void (*notify_func)(uint64_t time, struct libinput_event *ev, void *notify_func_data);
 	void *notify_func_data;
 };
@@ -428,28 +883,42 @@ typedef void (*libinput_source_dispatch_t)(void *data);
 #define log_bug_libinput(li_, ...) log_msg((li_), LIBINPUT_LOG_PRIORITY_ERROR, "libinput bug: " __VA_ARGS__)
 #define log_bug_client(li_, ...) log_msg((li_), LIBINPUT_LOG_PRIORITY_ERROR, "client bug: " __VA_ARGS__)
 
-#define log_debug_ratelimit(li_, r_, ...) log_msg_ratelimit((li_), (r_), LIBINPUT_LOG_PRIORITY_DEBUG, __VA_ARGS__)
-#define log_info_ratelimit(li_, r_, ...) log_msg_ratelimit((li_), (r_), LIBINPUT_LOG_PRIORITY_INFO, __VA_ARGS__)
-#define log_error_ratelimit(li_, r_, ...) log_msg_ratelimit((li_), (r_), LIBINPUT_LOG_PRIORITY_ERROR, __VA_ARGS__)
-#define log_bug_kernel_ratelimit(li_, r_, ...) log_msg_ratelimit((li_), (r_), LIBINPUT_LOG_PRIORITY_ERROR, "kernel bug: " __VA_ARGS__)
-#define log_bug_libinput_ratelimit(li_, r_, ...) log_msg_ratelimit((li_), (r_), LIBINPUT_LOG_PRIORITY_ERROR, "libinput bug: " __VA_ARGS__)
-#define log_bug_client_ratelimit(li_, r_, ...) log_msg_ratelimit((li_), (r_), LIBINPUT_LOG_PRIORITY_ERROR, "client bug: " __VA_ARGS__)
+#define log_debug_ratelimit(li_, r_, t_, ...) log_msg_ratelimit((li_), (r_), (t_), LIBINPUT_LOG_PRIORITY_DEBUG, __VA_ARGS__)
+#define log_info_ratelimit(li_, r_, t_, ...) log_msg_ratelimit((li_), (r_), (t_), LIBINPUT_LOG_PRIORITY_INFO, __VA_ARGS__)
+#define log_error_ratelimit(li_, r_, t_, ...) log_msg_ratelimit((li_), (r_), (t_), LIBINPUT_LOG_PRIORITY_ERROR, __VA_ARGS__)
+#define log_bug_kernel_ratelimit(li_, r_, t_, ...) log_msg_ratelimit((li_), (r_), (t_), LIBINPUT_LOG_PRIORITY_ERROR, "kernel bug: " __VA_ARGS__)
+#define log_bug_libinput_ratelimit(li_, r_, t_, ...) log_msg_ratelimit((li_), (r_), (t_), LIBINPUT_LOG_PRIORITY_ERROR, "libinput bug: " __VA_ARGS__)
+#define log_bug_client_ratelimit(li_, r_, t_, ...) log_msg_ratelimit((li_), (r_), (t_), LIBINPUT_LOG_PRIORITY_ERROR, "client bug: " __VA_ARGS__)
 
 static inline bool
 is_logged(const struct libinput *libinput,
 	  enum libinput_log_priority priority)
 {
-       return libinput->log_handler &&
+       return (libinput->log_handler || libinput->log_ring.entries) &&
                libinput->log_priority <= priority;
 }
 
+/**
+ * Store the message in the log ring without formatting it, the format
+ * must be a string literal. sysname may be NULL. Only call this if the
+ * log ring is enabled and the priority is logged.
+ */
+void
+log_ring_push(struct libinput *libinput,
+	      const char *sysname,
+	      enum libinput_log_priority priority,
+	      const char *format,
+	      va_list args)
+	LIBINPUT_ATTRIBUTE_PRINTF(4, 0);
+
 
 void
 log_msg_ratelimit(struct libinput *libinput,
 		  struct ratelimit *ratelimit,
+		  uint64_t time,
 		  enum libinput_log_priority priority,
 		  const char *format, ...)
-	LIBINPUT_ATTRIBUTE_PRINTF(4, 5);
+	LIBINPUT_ATTRIBUTE_PRINTF(5, 6);
 
 void
 log_msg(struct libinput *libinput,
@@ -473,12 +942,50 @@ libinput_init(struct libinput *libinput,
 void
 libinput_init_quirks(struct libinput *libinput);
 
+/* Copy the events read from a device node into the evdev tap, only
+ * call this if the tap is enabled */
+void
+libinput_evdev_tap_push(struct libinput *libinput,
+			struct libinput_device *device,
+			const struct input_event *events,
+			size_t nevents);
+
 struct libinput_source *
 libinput_add_fd(struct libinput *libinput,
 		int fd,
 		libinput_source_dispatch_t dispatch,
 		void *data);
 
+void
+libinput_source_set_pending(struct libinput *libinput,
+			    struct libinput_source *source);
+
+void
+libinput_source_set_read_buffer(struct libinput_source *source,
+				size_t len);
+
+/* Returns 1 and the time of the source's next buffered frame, 0 if the
+ * source has no more data or -1 if it needs a regular dispatch */
+typedef int (*libinput_source_peek_t)(void *data, uint64_t *time);
+
+/* Lets libinput_set_frame_merging() order this source's frames with
+ * other sources', dispatch_frame processes one frame only */
+void
+libinput_source_set_merge(struct libinput_source *source,
+			  libinput_source_peek_t peek,
+			  libinput_source_dispatch_t dispatch_frame);
+
+/* Low priority sources are dispatched after all others, see
+ * libinput_device_set_priority() */
+void
+libinput_source_set_low_priority(struct libinput_source *source,
+				 bool low_priority);
+
+ssize_t
+libinput_source_read(struct libinput *libinput,
+		     struct libinput_source *source,
+		     void **buf);
+
 void
 libinput_remove_source(struct libinput *libinput,
 		       struct libinput_source *source);
@@ -493,6 +1000,35 @@ close_restricted(struct libinput *libinput, int fd);
 bool
 ignore_litest_test_suite_device(struct udev_device *device);
 
+typedef void (*libinput_open_request_func)(struct libinput_open_request *request,
+					   int fd);
+
+/**
+ * The backend embeds this as first member of its own, heap-allocated
+ * request struct. libinput frees it once the caller completes the
+ * request.
+ */
+struct libinput_open_request {
+	/* NULL once cancelled */
+	struct libinput *libinput;
+	libinput_open_request_func complete;
+
+	/* For closing the fd of a cancelled request, the context may be
+	 * gone by then */
+	const struct libinput_interface *interface;
+	void *user_data;
+};
+
+bool
+libinput_open_async(struct libinput *libinput,
+		    struct libinput_open_request *request,
+		    const char *path,
+		    int flags,
+		    libinput_open_request_func complete);
+
+void
+libinput_open_request_cancel(struct libinput_open_request *request);
+
 void
 libinput_seat_init(struct libinput_seat *seat,
 		   struct libinput *libinput,
@@ -504,6 +1040,42 @@ void
 libinput_device_init(struct libinput_device *device,
 		     struct libinput_seat *seat);
 
+/* Upper limit of concurrent touches per seat */
+#define SEAT_SLOTS_MAX 1024
+
+int
+libinput_seat_alloc_slot_ext(struct libinput_seat *seat);
+
+void
+libinput_seat_release_slot_ext(struct libinput_seat *seat, int slot);
+
+/**
+ * @return the lowest free seat slot, or -1 if SEAT_SLOTS_MAX touches
+ * are down already
+ */
+static inline int
+libinput_seat_alloc_slot(struct libinput_seat *seat)
+{
+	int slot;
+
+	if (seat->slot_map == UINT64_MAX)
+		return libinput_seat_alloc_slot_ext(seat);
+
+	slot = __builtin_ctzll(~seat->slot_map);
+	seat->slot_map |= 1ULL << slot;
+
+	return slot;
+}
+
+static inline void
+libinput_seat_release_slot(struct libinput_seat *seat, int slot)
+{
+	if (slot >= 64)
+		libinput_seat_release_slot_ext(seat, slot);
+	else
+		seat->slot_map &= ~(1ULL << slot);
+}
+
 struct libinput_device_group *
 libinput_device_group_create(struct libinput *libinput,
 			     const char *identifier);
@@ -512,6 +1084,10 @@ struct libinput_device_group *
 libinput_device_group_find_group(struct libinput *libinput,
 				 const char *identifier);
 
+struct libinput_device_group *
+libinput_device_group_find_key(struct libinput *libinput,
+			       const char *key);
+
 void
 libinput_device_set_device_group(struct libinput_device *device,
 				 struct libinput_device_group *group);
@@ -519,9 +1095,15 @@ libinput_device_set_device_group(struct libinput_device *device,
 void
 libinput_device_init_event_listener(struct libinput_event_listener *listener);
 
+/**
+ * Add a listener for this device's events. The listener is only called
+ * for events whose type is in one of the given groups, e.g.
+ * EVENT_GROUP(LIBINPUT_EVENT_KEYBOARD_KEY).
+ */
 void
 libinput_device_add_event_listener(struct libinput_device *device,
 				   struct libinput_event_listener *listener,
+				   uint32_t event_groups,
 				   void (*notify_func)(
 						uint64_t time,
 						struct libinput_event *event,
@@ -543,6 +1125,12 @@ keyboard_notify_key(struct libinput_device *device,
 		    uint32_t key,
 		    enum libinput_key_state state);
 
+void
+pointer_frame_begin(struct libinput_device *device);
+
+void
+pointer_frame_end(struct libinput_device *device);
+
 void
 pointer_notify_motion(struct libinput_device *device,
 		      uint64_t time,
@@ -598,6 +1186,21 @@ void
 touch_notify_frame(struct libinput_device *device,
 		   uint64_t time);
 
+/* One touch point of a batched touch frame, type is one of
+ * LIBINPUT_EVENT_TOUCH_DOWN, _MOTION, _UP or _CANCEL */
+struct touch_frame_point {
+	enum libinput_event_type type;
+	int32_t slot;
+	int32_t seat_slot;
+	struct device_coords point;
+};
+
+void
+touch_notify_touch_frame(struct libinput_device *device,
+			 uint64_t time,
+			 const struct touch_frame_point *points,
+			 size_t npoints);
+
 void
 gesture_notify_swipe(struct libinput_device *device,
 		     uint64_t time,
@@ -693,11 +1296,15 @@ switch_notify_toggle(struct libinput_device *device,
 		     enum libinput_switch sw,
 		     enum libinput_switch_state state);
 
+/* Reads the clock, use this where a cached value is not good enough */
 static inline uint64_t
-libinput_now(struct libinput *libinput)
+libinput_now_fresh(struct libinput *libinput)
 {
 	struct timespec ts = { 0, 0 };
 
+	if (libinput->clock.func)
+		return libinput->clock.func(libinput, libinput->clock.user_data);
+
 	if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
 		log_error(libinput, "clock_gettime failed: %s\n", strerror(errno));
 		return 0;
@@ -706,6 +1313,99 @@ libinput_now(struct libinput *libinput)
 	return s2us(ts.tv_sec) + ns2us(ts.tv_nsec);
 }
 
+static inline uint64_t
+libinput_now(struct libinput *libinput)
+{
+	/* During libinput_dispatch() the time is read once per source,
+	 * that's precise enough for anything that isn't a deadline */
+	if (libinput->dispatch_now)
+		return libinput->dispatch_now;
+
+	return libinput_now_fresh(libinput);
+}
+
+/**
+ * Add the duration of a setup phase to the context's totals and, if
+ * given, to the device, see libinput_get_startup_time(). Hotplugged
+ * devices are set up during dispatch, use libinput_now_fresh() for the
+ * timestamps.
+ */
+static inline void
+libinput_record_startup_time(struct libinput *libinput,
+			     struct libinput_device *device,
+			     enum libinput_startup_phase phase,
+			     uint64_t duration)
+{
+	libinput->startup_time[phase] += duration;
+	if (device)
+		device->startup_time[phase] += duration;
+
+	tracepoint(device_setup_phase, device, phase, duration);
+}
+
+static inline uint64_t
+libinput_profile_now(void)
+{
+	struct timespec ts = { 0, 0 };
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return s2us(ts.tv_sec) * 1000 + ts.tv_nsec;
+}
+
+/**
+ * Switch to the given profiling stage. Stages nest, e.g. the motion
+ * filter runs inside the dispatch process stage. The time is only ever
+ * charged to the innermost stage so the stage times add up to the total.
+ *
+ * @return the stage to pass to libinput_profile_leave()
+ */
+static inline enum libinput_profile_stage
+libinput_profile_enter(struct libinput *libinput,
+		       enum libinput_profile_stage stage)
+{
+	enum libinput_profile_stage outer = libinput->profile.current;
+	uint64_t now;
+
+	if (!libinput->profile.enabled)
+		return outer;
+
+	now = libinput_profile_now();
+	if (outer)
+		libinput->profile.time[outer] += now - libinput->profile.since;
+
+	libinput->profile.current = stage;
+	libinput->profile.since = now;
+	libinput->profile.count[stage]++;
+
+	return outer;
+}
+
+static inline void
+libinput_profile_leave(struct libinput *libinput,
+		       enum libinput_profile_stage outer)
+{
+	enum libinput_profile_stage current = libinput->profile.current;
+	uint64_t now;
+
+	if (!libinput->profile.enabled)
+		return;
+
+	now = libinput_profile_now();
+	if (current)
+		libinput->profile.time[current] += now - libinput->profile.since;
+
+	libinput->profile.current = outer;
+	libinput->profile.since = now;
+}
+
+static inline bool
+libinput_dispatch_deadline_reached(struct libinput *libinput)
+{
+	return libinput->dispatch_deadline != 0 &&
+	       libinput_now_fresh(libinput) >= libinput->dispatch_deadline;
+}
+
 static inline struct device_float_coords
 device_delta(const struct device_coords a, const struct device_coords b)
 {
@@ -861,11 +1561,44 @@ point_in_rect(const struct device_coords *point,
 		point->y < rect->y + rect->h);
 }
 
+struct libinput_tablet_tool *
+libinput_tool_hash_lookup(struct libinput *libinput,
+			  enum libinput_tablet_tool_type type,
+			  uint32_t serial);
+
+void
+libinput_tool_hash_insert(struct libinput *libinput,
+			  struct libinput_tablet_tool *tool);
+
+void
+libinput_evict_idle_tools(struct libinput *libinput, uint64_t now);
+
 #if HAVE_LIBWACOM
 WacomDeviceDatabase *
 libinput_libwacom_ref(struct libinput *li);
 void
 libinput_libwacom_unref(struct libinput *li);
+bool
+libinput_libwacom_get_stylus(struct libinput *li,
+			     uint32_t tool_id,
+			     struct libinput_libwacom_stylus *stylus);
+const struct libinput_libwacom_pad *
+libinput_libwacom_get_pad(struct libinput *li,
+			  const char *syspath,
+			  int vendor,
+			  int product);
+struct libinput_libwacom_pad *
+libinput_libwacom_add_pad(struct libinput *li,
+			  const char *syspath,
+			  int vendor,
+			  int product);
+#if HAVE_TABLET
+void
+libinput_libwacom_release_pads(struct libinput_libwacom *libwacom);
+#else
+static inline void
+libinput_libwacom_release_pads(struct libinput_libwacom *libwacom) {}
+#endif
 #else
 static inline void *libinput_libwacom_ref(struct libinput *li) { return NULL; }
 static inline void libinput_libwacom_unref(struct libinput *li) {}
@@ -0,0 +1,88 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef LIBINPUT_TRACEPOINTS_H
+#define LIBINPUT_TRACEPOINTS_H
+
+#include "config.h"
+
+/*
+ * Static tracepoints for perf, bpftrace and systemtap, built with
+ * -Dtracepoints=true. All tracepoints are in the "libinput" provider,
+ * e.g. with bpftrace:
+ *
+ *   bpftrace -e 'usdt:/usr/lib64/libinput.so.10:libinput:timer_fire
+ *                { printf("%s\n", str(arg0)); }'
+ *
+ * A tracepoint that isn't attached to is a nop instruction. Without
+ * -Dtracepoints the arguments are not evaluated at all.
+ *
+ * The tracepoints and their arguments:
+ *
+ * dispatch_enter()
+ * dispatch_exit(int rc)
+ *	libinput_dispatch() and libinput_dispatch_until()
+ * device_drain(const char *sysname, unsigned int nevents)
+ *	after reading from a device's fd, nevents is the number of
+ *	evdev events processed
+ * syn_dropped(const char *sysname)
+ *	the kernel's buffer for the device overflowed
+ * process_start(const char *sysname, int dispatch_type,
+ *		 uint16_t type, uint16_t code, uint64_t time)
+ * process_end(const char *sysname, int dispatch_type)
+ *	one evdev event handled by the device's dispatch interface,
+ *	dispatch_type is an enum evdev_dispatch_type. For dispatch
+ *	interfaces that take whole frames, one frame with the type and
+ *	code of its SYN_REPORT
+ * timer_fire(const char *name, uint64_t now, uint64_t lateness)
+ *	before calling a timer's function, all times in µs
+ * event_enqueue(int type, size_t queued)
+ * event_dequeue(int type, size_t queued)
+ *	a libinput event was added to or taken off the event queue,
+ *	type is an enum libinput_event_type
+ * device_setup_phase(struct libinput_device *device, int phase,
+ *		      uint64_t duration)
+ *	a device setup phase finished, phase is an enum
+ *	libinput_startup_phase, device may be NULL
+ * device_added(const char *sysname)
+ * device_removed(const char *sysname)
+ */
+
+#if HAVE_TRACEPOINTS
+#include <sys/sdt.h>
+
+#define tracepoint(name_, ...) \
+	STAP_PROBEV(libinput, name_, ##__VA_ARGS__)
+#else
+static inline void
+tracepoint_unused(int unused, ...)
+{
+}
+
+/* Keeps the compiler from warning about variables only used for the
+ * tracepoint, nothing is evaluated */
+#define tracepoint(name_, ...) \
+	do { if (0) tracepoint_unused(0, ##__VA_ARGS__); } while (0)
+#endif
+
+#endif /* LIBINPUT_TRACEPOINTS_H */
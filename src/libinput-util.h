@@ -34,12 +34,18 @@
 
 #include "libinput.h"
 
+#include "util-alloc.h"
+#include "util-arena.h"
+#include "util-array.h"
 #include "util-bits.h"
+#include "util-histogram.h"
+#include "util-key-count.h"
 #include "util-macros.h"
 #include "util-list.h"
 #include "util-matrix.h"
 #include "util-strings.h"
 #include "util-ratelimit.h"
+#include "util-ring.h"
 #include "util-prop-parsers.h"
 #include "util-time.h"
 
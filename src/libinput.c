@@ -31,18 +31,59 @@
 #include <stdarg.h>
 #include <string.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <libgen.h>
 #include <unistd.h>
+#if HAVE_IO_URING
+#include <poll.h>
+#endif
 #include <assert.h>
 
 #include "libinput.h"
 #include "libinput-private.h"
 #include "evdev.h"
+#include "filter.h"
 #include "timer.h"
+#include "replug.h"
 #include "quirks.h"
+#include "util-input-event.h"
+
+/* Event types are grouped in hundreds with only a few types per group,
+ * so each one maps to a bit in a uint64_t. The permitted types of a
+ * getter are folded into a constant mask at compile time. */
+#define EVENT_TYPE_BITS_PER_GROUP 6
+#define event_type_bit(t_) \
+	(1ULL << (((t_) / 100) * EVENT_TYPE_BITS_PER_GROUP + (t_) % 100))
+
+#define _event_type_mask1(a_) event_type_bit(a_)
+#define _event_type_mask2(a_, ...) (event_type_bit(a_) | _event_type_mask1(__VA_ARGS__))
+#define _event_type_mask3(a_, ...) (event_type_bit(a_) | _event_type_mask2(__VA_ARGS__))
+#define _event_type_mask4(a_, ...) (event_type_bit(a_) | _event_type_mask3(__VA_ARGS__))
+#define _event_type_mask5(a_, ...) (event_type_bit(a_) | _event_type_mask4(__VA_ARGS__))
+#define _event_type_mask6(a_, ...) (event_type_bit(a_) | _event_type_mask5(__VA_ARGS__))
+#define _event_type_mask7(a_, ...) (event_type_bit(a_) | _event_type_mask6(__VA_ARGS__))
+#define _event_type_mask8(a_, ...) (event_type_bit(a_) | _event_type_mask7(__VA_ARGS__))
+#define _event_type_mask_select(_1, _2, _3, _4, _5, _6, _7, _8, name_, ...) name_
+#define event_type_mask(...) \
+	_event_type_mask_select(__VA_ARGS__, \
+				_event_type_mask8, _event_type_mask7, \
+				_event_type_mask6, _event_type_mask5, \
+				_event_type_mask4, _event_type_mask3, \
+				_event_type_mask2, _event_type_mask1)(__VA_ARGS__)
+
+static_assert(LIBINPUT_EVENT_GESTURE_PINCH_END % 100 < EVENT_TYPE_BITS_PER_GROUP,
+	      "too many event types in a group");
+static_assert(LIBINPUT_EVENT_SWITCH_TOGGLE / 100 * EVENT_TYPE_BITS_PER_GROUP +
+	      EVENT_TYPE_BITS_PER_GROUP <= 64,
+	      "event type bits don't fit into the mask");
 
 #define require_event_type(li_, type_, retval_, ...)	\
 	if (type_ == LIBINPUT_EVENT_NONE) abort(); \
-	if (!check_event_type(li_, __func__, type_, __VA_ARGS__, -1)) \
+	if (!check_event_type(li_, __func__, type_, \
+			      event_type_mask(__VA_ARGS__))) \
 		return retval_; \
 
 #define ASSERT_INT_SIZE(type_) \
@@ -69,35 +110,29 @@ ASSERT_INT_SIZE(enum libinput_config_tap_state);
 ASSERT_INT_SIZE(enum libinput_config_tap_button_map);
 ASSERT_INT_SIZE(enum libinput_config_drag_state);
 ASSERT_INT_SIZE(enum libinput_config_drag_lock_state);
+ASSERT_INT_SIZE(enum libinput_config_tap_early_commit_state);
 ASSERT_INT_SIZE(enum libinput_config_send_events_mode);
 ASSERT_INT_SIZE(enum libinput_config_accel_profile);
 ASSERT_INT_SIZE(enum libinput_config_click_method);
 ASSERT_INT_SIZE(enum libinput_config_middle_emulation_state);
 ASSERT_INT_SIZE(enum libinput_config_scroll_method);
 ASSERT_INT_SIZE(enum libinput_config_dwt_state);
+ASSERT_INT_SIZE(enum libinput_config_low_latency_state);
+ASSERT_INT_SIZE(enum libinput_statistic);
+ASSERT_INT_SIZE(enum libinput_delay_source);
 
 static inline bool
 check_event_type(struct libinput *libinput,
 		 const char *function_name,
 		 unsigned int type_in,
-		 ...)
+		 uint64_t types_permitted)
 {
-	bool rc = false;
-	va_list args;
-	unsigned int type_permitted;
-
-	va_start(args, type_in);
-	type_permitted = va_arg(args, unsigned int);
-
-	while (type_permitted != (unsigned int)-1) {
-		if (type_permitted == type_in) {
-			rc = true;
-			break;
-		}
-		type_permitted = va_arg(args, unsigned int);
-	}
+	bool rc;
 
-	va_end(args);
+	/* anything outside the grouping would alias another type's bit */
+	rc = type_in % 100 < EVENT_TYPE_BITS_PER_GROUP &&
+	     type_in / 100 <= LIBINPUT_EVENT_SWITCH_TOGGLE / 100 &&
+	     (types_permitted & event_type_bit(type_in));
 
 	if (!rc)
 		log_bug_client(libinput,
@@ -118,6 +153,7 @@ event_type_to_str(enum libinput_event_type type)
 	CASE_RETURN_STRING(LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE);
 	CASE_RETURN_STRING(LIBINPUT_EVENT_POINTER_BUTTON);
 	CASE_RETURN_STRING(LIBINPUT_EVENT_POINTER_AXIS);
+	CASE_RETURN_STRING(LIBINPUT_EVENT_POINTER_FRAME);
 	CASE_RETURN_STRING(LIBINPUT_EVENT_TOUCH_DOWN);
 	CASE_RETURN_STRING(LIBINPUT_EVENT_TOUCH_UP);
 	CASE_RETURN_STRING(LIBINPUT_EVENT_TOUCH_MOTION);
@@ -145,11 +181,60 @@ event_type_to_str(enum libinput_event_type type)
 	return NULL;
 }
 
+static inline bool
+event_type_is_disabled(const uint32_t *mask, enum libinput_event_type type)
+{
+	return !!(mask[type / 100] & bit(type % 100));
+}
+
+#if HAVE_IO_URING
+/* Number of submission queue entries, we have at most a poll and a read
+ * request in flight per source plus the occasional cancel */
+#define URING_ENTRIES 256
+
+/* Set in the user data of the poll request that is linked to a source's
+ * read, see libinput_uring_arm_source() */
+#define URING_POLL_TAG 0x1
+
+enum source_op {
+	SOURCE_OP_NONE,
+	SOURCE_OP_POLL,
+	SOURCE_OP_READ,
+};
+#endif
+
 struct libinput_source {
 	libinput_source_dispatch_t dispatch;
 	void *user_data;
 	int fd;
-	struct list link;
+	struct list link; /* libinput.source_destroy_list */
+	struct list live_link; /* libinput.source_list */
+	struct list pending_link;
+	bool pending;
+	uint32_t dispatch_serial;
+
+	/* owned by the source, see libinput_source_read() */
+	void *buf;
+	size_t buf_len;
+	/* a read filled the buffer during the source's last dispatch, the
+	 * kernel buffer is likely close to overflowing */
+	bool backlogged;
+
+	/* see libinput_source_set_merge(), NULL if not mergeable */
+	libinput_source_peek_t peek;
+	libinput_source_dispatch_t dispatch_frame;
+
+	bool low_priority;
+	/* waiting for the low priority interval, EPOLLIN is disabled */
+	bool muted;
+	struct list muted_link; /* libinput.low_priority.muted */
+
+#if HAVE_IO_URING
+	enum source_op op; /* request in flight on the ring */
+	bool ready; /* a poll request completed */
+	bool read_done; /* a read request completed */
+	ssize_t read_result;
+#endif
 };
 
 struct libinput_event_device_notify {
@@ -164,6 +249,44 @@ struct libinput_event_keyboard {
 	enum libinput_key_state state;
 };
 
+/* Past this, a new frame event is started */
+#define POINTER_FRAME_MAX_BUTTONS 8
+
+struct pointer_frame_button {
+	uint32_t button;
+	uint32_t seat_button_count;
+	enum libinput_button_state state;
+};
+
+/* The motion is in the frame event's delta, delta_raw or absolute, the
+ * axes, source and discrete values too. Only the axis values need to be
+ * separate, the event's delta is used for both motion and axis events. */
+struct pointer_frame {
+	uint64_t time;
+	enum libinput_event_type motion_type; /* NONE if there is no motion */
+	struct normalized_coords delta;
+	struct device_float_coords delta_raw;
+	struct device_coords absolute;
+	uint32_t axes;
+	enum libinput_pointer_axis_source source;
+	struct normalized_coords axis_value;
+	struct discrete_coords discrete;
+	uint32_t nbuttons;
+	struct pointer_frame_button buttons[POINTER_FRAME_MAX_BUTTONS];
+};
+
+/* The most devices merged into one motion event, see
+ * LIBINPUT_EVENT_COALESCING_SEAT_POINTER_MOTION */
+#define POINTER_MOTION_MAX_SOURCES 8
+
+struct pointer_motion_sources {
+	size_t count;
+	struct {
+		struct libinput_device *device;
+		struct normalized_coords delta;
+	} sources[POINTER_MOTION_MAX_SOURCES];
+};
+
 struct libinput_event_pointer {
 	struct libinput_event base;
 	uint64_t time;
@@ -176,6 +299,21 @@ struct libinput_event_pointer {
 	enum libinput_button_state state;
 	enum libinput_pointer_axis_source source;
 	uint32_t axes;
+	struct pointer_frame *frame; /* NULL unless a frame event */
+	/* NULL unless the motion of several devices was merged */
+	struct pointer_motion_sources *sources;
+};
+
+/* Transformed coordinates precomputed at event creation for the
+ * device's output size, width and height are 0 if unset */
+struct output_coords {
+	uint32_t width, height;
+	struct device_float_coords point;
+};
+
+struct touch_frame {
+	uint32_t count;
+	struct touch_frame_point points[];
 };
 
 struct libinput_event_touch {
@@ -184,6 +322,8 @@ struct libinput_event_touch {
 	int32_t slot;
 	int32_t seat_slot;
 	struct device_coords point;
+	struct output_coords output;
+	struct touch_frame *frame; /* NULL unless the frame was batched */
 };
 
 struct libinput_event_gesture {
@@ -197,17 +337,41 @@ struct libinput_event_gesture {
 	double angle;
 };
 
+/* The state of an axis event merged into a later one, see
+ * LIBINPUT_EVENT_COALESCING_TABLET_TOOL_HISTORY */
+struct tablet_tool_sample {
+	uint64_t time;
+	struct device_coords point;
+	double pressure;
+	struct tilt_degrees tilt;
+};
+
+/* Past this, axis events are queued separately again */
+#define TABLET_TOOL_HISTORY_MAX 256
+
+struct tablet_tool_history {
+	uint32_t count;
+	uint32_t size;
+	struct tablet_tool_sample samples[]; /* oldest first */
+};
+
+/* Tablet tool events are the highest-volume event type, the members are
+ * ordered so the struct has no padding. The axes are always the full
+ * state, libinput_event_tablet_tool_get_*() return all axes of the
+ * device whether they changed or not. */
 struct libinput_event_tablet_tool {
 	struct libinput_event base;
-	uint32_t button;
-	enum libinput_button_state state;
-	uint32_t seat_button_count;
 	uint64_t time;
-	struct tablet_axes axes;
-	unsigned char changed_axes[NCHARS(LIBINPUT_TABLET_TOOL_AXIS_MAX + 1)];
 	struct libinput_tablet_tool *tool;
+	struct tablet_axes axes;
+	struct output_coords output;
+	struct tablet_tool_history *history; /* NULL unless samples were merged */
+	uint32_t button;
+	uint32_t seat_button_count;
+	enum libinput_button_state state;
 	enum libinput_tablet_tool_proximity_state proximity_state;
 	enum libinput_tablet_tool_tip_state tip_state;
+	unsigned char changed_axes[NCHARS(LIBINPUT_TABLET_TOOL_AXIS_MAX + 1)];
 };
 
 struct libinput_event_tablet_pad {
@@ -242,6 +406,167 @@ struct libinput_event_switch {
 	enum libinput_switch_state state;
 };
 
+/* The event queue starts at and never shrinks below this size. All queue
+ * sizes are a power of two */
+#define EVENT_QUEUE_MIN_LEN 4
+/* The queue is pre-sized for the devices present, up to this size. A
+ * larger queue is only allocated on demand */
+#define EVENT_QUEUE_PRESIZE_MAX 1024
+/* The number of frames expected per dispatch from a high-rate device,
+ * e.g. a 1000Hz mouse read by a caller that dispatches every 8ms */
+#define EVENT_QUEUE_FRAMES_PER_DISPATCH 8
+/* Number of consecutive dispatches with a mostly unused queue before the
+ * queue is shrunk */
+#define EVENT_QUEUE_SHRINK_DISPATCHES 64
+
+/* Upper limit of events kept around per slab, anything beyond that is
+ * released back to the system */
+#define EVENT_SLAB_MAX_ENTRIES 256
+
+struct event_slab_entry {
+	struct event_slab_entry *next;
+};
+
+static inline size_t
+libinput_queue_index(struct libinput *libinput, size_t idx)
+{
+	return idx & (libinput->events_len - 1);
+}
+
+static const size_t event_slab_sizes[EVENT_SLAB_COUNT] = {
+	[EVENT_SLAB_DEVICE_NOTIFY] = sizeof(struct libinput_event_device_notify),
+	[EVENT_SLAB_KEYBOARD] = sizeof(struct libinput_event_keyboard),
+	[EVENT_SLAB_POINTER] = sizeof(struct libinput_event_pointer),
+	[EVENT_SLAB_TOUCH] = sizeof(struct libinput_event_touch),
+	[EVENT_SLAB_GESTURE] = sizeof(struct libinput_event_gesture),
+	[EVENT_SLAB_TABLET_TOOL] = sizeof(struct libinput_event_tablet_tool),
+	[EVENT_SLAB_TABLET_PAD] = sizeof(struct libinput_event_tablet_pad),
+	[EVENT_SLAB_SWITCH] = sizeof(struct libinput_event_switch),
+};
+
+static inline enum libinput_event_slab
+event_type_to_slab(enum libinput_event_type type)
+{
+	switch(type) {
+	case LIBINPUT_EVENT_NONE:
+		abort();
+	case LIBINPUT_EVENT_DEVICE_ADDED:
+	case LIBINPUT_EVENT_DEVICE_REMOVED:
+		return EVENT_SLAB_DEVICE_NOTIFY;
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		return EVENT_SLAB_KEYBOARD;
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+	case LIBINPUT_EVENT_POINTER_AXIS:
+	case LIBINPUT_EVENT_POINTER_FRAME:
+		return EVENT_SLAB_POINTER;
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+	case LIBINPUT_EVENT_TOUCH_UP:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		return EVENT_SLAB_TOUCH;
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
+	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
+	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
+	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
+		return EVENT_SLAB_TABLET_TOOL;
+	case LIBINPUT_EVENT_TABLET_PAD_BUTTON:
+	case LIBINPUT_EVENT_TABLET_PAD_RING:
+	case LIBINPUT_EVENT_TABLET_PAD_STRIP:
+	case LIBINPUT_EVENT_TABLET_PAD_KEY:
+		return EVENT_SLAB_TABLET_PAD;
+	case LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_END:
+	case LIBINPUT_EVENT_GESTURE_PINCH_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_PINCH_END:
+		return EVENT_SLAB_GESTURE;
+	case LIBINPUT_EVENT_SWITCH_TOGGLE:
+		return EVENT_SLAB_SWITCH;
+	}
+
+	abort();
+}
+
+/**
+ * Allocate a zeroed event of the given struct type. Events are recycled
+ * through a per-context free-list so we don't hit malloc for every single
+ * event on high-frequency devices.
+ */
+static void *
+libinput_event_alloc(struct libinput_device *device,
+		     enum libinput_event_slab slab)
+{
+	struct libinput *libinput = device->seat->libinput;
+	struct event_slab_entry *entry;
+	size_t size = event_slab_sizes[slab];
+	enum libinput_profile_stage outer;
+
+	outer = libinput_profile_enter(libinput,
+				       LIBINPUT_PROFILE_STAGE_EVENT_QUEUE);
+
+	entry = libinput->event_cache.slabs[slab].free_list;
+	if (!entry) {
+		libinput->event_cache.misses++;
+		entry = mem_zalloc(size);
+		goto out;
+	}
+
+	libinput->event_cache.slabs[slab].free_list = entry->next;
+	libinput->event_cache.slabs[slab].count--;
+	libinput->event_cache.count--;
+	libinput->event_cache.hits++;
+
+	memset(entry, 0, size);
+
+out:
+	libinput_profile_leave(libinput, outer);
+
+	return entry;
+}
+
+static void
+libinput_event_release(struct libinput *libinput,
+		       struct libinput_event *event)
+{
+	enum libinput_event_slab slab = event_type_to_slab(event->type);
+	struct event_slab_entry *entry;
+
+	if (libinput->event_cache.slabs[slab].count >= EVENT_SLAB_MAX_ENTRIES) {
+		mem_free(event);
+		return;
+	}
+
+	entry = (struct event_slab_entry*)event;
+	entry->next = libinput->event_cache.slabs[slab].free_list;
+	libinput->event_cache.slabs[slab].free_list = entry;
+	libinput->event_cache.slabs[slab].count++;
+	libinput->event_cache.count++;
+	libinput->event_cache.peak = max(libinput->event_cache.peak,
+					 libinput->event_cache.count);
+}
+
+static void
+libinput_event_cache_destroy(struct libinput *libinput)
+{
+	for (size_t i = 0; i < EVENT_SLAB_COUNT; i++) {
+		struct event_slab_entry *entry, *next;
+
+		entry = libinput->event_cache.slabs[i].free_list;
+		while (entry) {
+			next = entry->next;
+			mem_free(entry);
+			entry = next;
+		}
+		libinput->event_cache.slabs[i].free_list = NULL;
+		libinput->event_cache.slabs[i].count = 0;
+	}
+	libinput->event_cache.count = 0;
+}
+
 LIBINPUT_ATTRIBUTE_PRINTF(3, 0)
 static void
 libinput_default_log_func(struct libinput *libinput,
@@ -267,10 +592,400 @@ log_msg_va(struct libinput *libinput,
 	   const char *format,
 	   va_list args)
 {
-	if (is_logged(libinput, priority))
+	if (!is_logged(libinput, priority))
+		return;
+
+	if (libinput->log_ring.entries)
+		log_ring_push(libinput, NULL, priority, format, args);
+	else
 		libinput->log_handler(libinput, priority, format, args);
 }
 
+/* One printf conversion, see log_ring_parse_conversion() */
+struct log_ring_conversion {
+	const char *start; /* the '%' */
+	const char *end; /* one past the conversion character */
+	bool star_width;
+	bool star_precision;
+	enum {
+		LOG_ARG_INT,
+		LOG_ARG_LONG,
+		LOG_ARG_LONG_LONG,
+		LOG_ARG_SIZE,
+		LOG_ARG_INTMAX,
+		LOG_ARG_PTRDIFF,
+		LOG_ARG_DOUBLE,
+		LOG_ARG_LONG_DOUBLE,
+		LOG_ARG_STRING,
+		LOG_ARG_POINTER,
+		LOG_ARG_PERCENT, /* %%, no argument */
+		LOG_ARG_INVALID,
+	} type;
+};
+
+/* Parse the conversion starting at the '%' in c->start */
+static void
+log_ring_parse_conversion(struct log_ring_conversion *c)
+{
+	const char *p = c->start + 1;
+	int length = 0; /* 'h', 'l', 'L' (ll), 'z', 'j', 't' or 'D' (L) */
+
+	c->star_width = false;
+	c->star_precision = false;
+
+	while (*p && strchr("-+ #0'", *p))
+		p++;
+	if (*p == '*') {
+		c->star_width = true;
+		p++;
+	}
+	while (*p >= '0' && *p <= '9')
+		p++;
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			c->star_precision = true;
+			p++;
+		}
+		while (*p >= '0' && *p <= '9')
+			p++;
+	}
+
+	switch (*p) {
+	case 'h':
+		length = 'h';
+		p++;
+		if (*p == 'h')
+			p++;
+		break;
+	case 'l':
+		length = 'l';
+		p++;
+		if (*p == 'l') {
+			length = 'L';
+			p++;
+		}
+		break;
+	case 'z':
+	case 'j':
+	case 't':
+		length = *p++;
+		break;
+	case 'L':
+		length = 'D';
+		p++;
+		break;
+	}
+
+	c->end = *p ? p + 1 : p;
+
+	switch (*p) {
+	case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+		switch (length) {
+		case 'l': c->type = LOG_ARG_LONG; break;
+		case 'L': c->type = LOG_ARG_LONG_LONG; break;
+		case 'z': c->type = LOG_ARG_SIZE; break;
+		case 'j': c->type = LOG_ARG_INTMAX; break;
+		case 't': c->type = LOG_ARG_PTRDIFF; break;
+		default: c->type = LOG_ARG_INT; break;
+		}
+		break;
+	case 'e': case 'E': case 'f': case 'F':
+	case 'g': case 'G': case 'a': case 'A':
+		c->type = length == 'D' ? LOG_ARG_LONG_DOUBLE : LOG_ARG_DOUBLE;
+		break;
+	case 's':
+		c->type = length == 0 ? LOG_ARG_STRING : LOG_ARG_INVALID;
+		break;
+	case 'p':
+		c->type = LOG_ARG_POINTER;
+		break;
+	case '%':
+		c->type = LOG_ARG_PERCENT;
+		break;
+	default:
+		c->type = LOG_ARG_INVALID;
+		break;
+	}
+}
+
+static bool
+log_ring_pack_args(struct log_ring_entry *entry,
+		   const char *format,
+		   va_list args)
+{
+	struct log_ring_conversion c;
+	size_t nargs = 0, strings_len = 0;
+	const char *p = format;
+
+	while ((p = strchr(p, '%'))) {
+		union log_ring_arg *arg;
+
+		c.start = p;
+		log_ring_parse_conversion(&c);
+		p = c.end;
+
+		if (c.type == LOG_ARG_PERCENT)
+			continue;
+		if (c.type == LOG_ARG_INVALID)
+			return false;
+
+		if (c.star_width) {
+			if (nargs == LOG_RING_MAX_ARGS)
+				return false;
+			entry->args[nargs++].i = va_arg(args, int);
+		}
+		if (c.star_precision) {
+			if (nargs == LOG_RING_MAX_ARGS)
+				return false;
+			entry->args[nargs++].i = va_arg(args, int);
+		}
+
+		if (nargs == LOG_RING_MAX_ARGS)
+			return false;
+		arg = &entry->args[nargs++];
+
+		switch (c.type) {
+		case LOG_ARG_INT: arg->i = va_arg(args, int); break;
+		case LOG_ARG_LONG: arg->i = va_arg(args, long); break;
+		case LOG_ARG_LONG_LONG: arg->i = va_arg(args, long long); break;
+		case LOG_ARG_SIZE: arg->i = va_arg(args, size_t); break;
+		case LOG_ARG_INTMAX: arg->i = va_arg(args, intmax_t); break;
+		case LOG_ARG_PTRDIFF: arg->i = va_arg(args, ptrdiff_t); break;
+		case LOG_ARG_DOUBLE: arg->d = va_arg(args, double); break;
+		case LOG_ARG_LONG_DOUBLE: arg->d = va_arg(args, long double); break;
+		case LOG_ARG_POINTER: arg->p = va_arg(args, void *); break;
+		case LOG_ARG_STRING: {
+			const char *s = va_arg(args, const char *);
+			size_t avail = sizeof(entry->strings) - strings_len;
+			size_t len;
+
+			if (!s)
+				s = "(null)";
+
+			/* truncate, but always leave room for the NUL */
+			len = strnlen(s, avail - 1);
+			memcpy(&entry->strings[strings_len], s, len);
+			entry->strings[strings_len + len] = '\0';
+			arg->i = strings_len;
+			strings_len = min(strings_len + len + 1,
+					  sizeof(entry->strings) - 1);
+			break;
+		}
+		default:
+			abort();
+		}
+	}
+
+	return true;
+}
+
+void
+log_ring_push(struct libinput *libinput,
+	      const char *sysname,
+	      enum libinput_log_priority priority,
+	      const char *format,
+	      va_list args)
+{
+	struct log_ring_entry *entry;
+	va_list copy;
+
+	/* Full, drop the oldest message */
+	if (libinput->log_ring.tail - libinput->log_ring.head > libinput->log_ring.mask) {
+		libinput->log_ring.head++;
+		libinput->log_ring.lost++;
+	}
+
+	entry = &libinput->log_ring.entries[libinput->log_ring.tail & libinput->log_ring.mask];
+	libinput->log_ring.tail++;
+
+	entry->time = libinput_now(libinput);
+	entry->priority = priority;
+	entry->sysname[0] = '\0';
+	if (sysname) {
+		size_t len = strnlen(sysname, sizeof(entry->sysname) - 1);
+
+		memcpy(entry->sysname, sysname, len);
+		entry->sysname[len] = '\0';
+	}
+
+	va_copy(copy, args);
+	if (log_ring_pack_args(entry, format, copy)) {
+		entry->format = format;
+	} else {
+		entry->format = NULL;
+		vsnprintf(entry->strings, sizeof(entry->strings), format, args);
+	}
+	va_end(copy);
+}
+
+LIBINPUT_ATTRIBUTE_PRINTF(3, 4)
+static int
+log_ring_append(char *buf, size_t size, const char *format, ...)
+{
+	va_list args;
+	int n;
+
+	va_start(args, format);
+	n = vsnprintf(buf, size, format, args);
+	va_end(args);
+
+	return n < 0 ? 0 : n;
+}
+
+/* Format the message into buf, returns the length or the length it
+ * would have had if buf were large enough */
+static size_t
+log_ring_format(const struct log_ring_entry *entry, char *buf, size_t size)
+{
+	struct log_ring_conversion c;
+	const union log_ring_arg *arg = entry->args;
+	const char *p = entry->format;
+	size_t len = 0;
+
+#define APPEND(...) \
+	len += log_ring_append(buf + min(len, size - 1), \
+			       size - min(len, size - 1), \
+			       __VA_ARGS__)
+
+	if (entry->sysname[0] != '\0')
+		APPEND("%-7s - ", entry->sysname);
+
+	if (!entry->format) {
+		APPEND("%s", entry->strings);
+		return len;
+	}
+
+	while (*p) {
+		const char *pct = strchr(p, '%');
+		char spec[32];
+		int width = 0, precision = 0;
+
+		if (!pct) {
+			APPEND("%s", p);
+			break;
+		}
+
+		APPEND("%.*s", (int)(pct - p), p);
+
+		c.start = pct;
+		log_ring_parse_conversion(&c);
+		p = c.end;
+
+		if (c.type == LOG_ARG_PERCENT) {
+			APPEND("%%");
+			continue;
+		}
+
+		/* log_ring_pack_args() made sure the format is valid */
+		snprintf(spec, sizeof(spec), "%.*s",
+			 (int)min((size_t)(c.end - c.start), sizeof(spec) - 1),
+			 c.start);
+		if (c.star_width)
+			width = (arg++)->i;
+		if (c.star_precision)
+			precision = (arg++)->i;
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#define APPEND_SPEC(v_) \
+		do { \
+			if (c.star_width && c.star_precision) \
+				APPEND(spec, width, precision, v_); \
+			else if (c.star_width) \
+				APPEND(spec, width, v_); \
+			else if (c.star_precision) \
+				APPEND(spec, precision, v_); \
+			else \
+				APPEND(spec, v_); \
+		} while (0)
+
+		switch (c.type) {
+		case LOG_ARG_INT: APPEND_SPEC((int)arg->i); break;
+		case LOG_ARG_LONG: APPEND_SPEC((long)arg->i); break;
+		case LOG_ARG_LONG_LONG: APPEND_SPEC((long long)arg->i); break;
+		case LOG_ARG_SIZE: APPEND_SPEC((size_t)arg->i); break;
+		case LOG_ARG_INTMAX: APPEND_SPEC((intmax_t)arg->i); break;
+		case LOG_ARG_PTRDIFF: APPEND_SPEC((ptrdiff_t)arg->i); break;
+		case LOG_ARG_DOUBLE: APPEND_SPEC(arg->d); break;
+		case LOG_ARG_LONG_DOUBLE: APPEND_SPEC((long double)arg->d); break;
+		case LOG_ARG_POINTER: APPEND_SPEC(arg->p); break;
+		case LOG_ARG_STRING: APPEND_SPEC(&entry->strings[arg->i]); break;
+		default:
+			abort();
+		}
+#undef APPEND_SPEC
+#pragma GCC diagnostic pop
+		arg++;
+	}
+#undef APPEND
+
+	return len;
+}
+
+LIBINPUT_EXPORT int
+libinput_log_set_ring(struct libinput *libinput, unsigned int size)
+{
+	struct log_ring_entry *entries = NULL;
+
+	if ((size & (size - 1)) != 0) {
+		log_bug_client(libinput, "Invalid log ring size %u\n", size);
+		return -1;
+	}
+
+	if (size > 0) {
+		entries = calloc(size, sizeof(*entries));
+		if (!entries)
+			return -1;
+	}
+
+	free(libinput->log_ring.entries);
+	libinput->log_ring.entries = entries;
+	libinput->log_ring.mask = size > 0 ? size - 1 : 0;
+	libinput->log_ring.head = 0;
+	libinput->log_ring.tail = 0;
+	libinput->log_ring.lost = 0;
+
+	return 0;
+}
+
+LIBINPUT_EXPORT unsigned int
+libinput_log_ring_drain(struct libinput *libinput,
+			libinput_log_ring_handler handler,
+			void *user_data)
+{
+	unsigned int count = 0;
+	char msg[1024];
+
+	if (!libinput->log_ring.entries)
+		return 0;
+
+	if (libinput->log_ring.lost > 0) {
+		snprintf(msg, sizeof(msg),
+			 "log ring full, %zd messages were lost\n",
+			 libinput->log_ring.lost);
+		libinput->log_ring.lost = 0;
+		handler(libinput,
+			LIBINPUT_LOG_PRIORITY_ERROR,
+			libinput_now(libinput),
+			msg,
+			user_data);
+		count++;
+	}
+
+	while (libinput->log_ring.head != libinput->log_ring.tail) {
+		const struct log_ring_entry *entry =
+			&libinput->log_ring.entries[libinput->log_ring.head & libinput->log_ring.mask];
+
+		log_ring_format(entry, msg, sizeof(msg));
+		handler(libinput, entry->priority, entry->time, msg, user_data);
+		libinput->log_ring.head++;
+		count++;
+	}
+
+	return count;
+}
+
 void
 log_msg(struct libinput *libinput,
 	enum libinput_log_priority priority,
@@ -286,13 +1001,17 @@ log_msg(struct libinput *libinput,
 void
 log_msg_ratelimit(struct libinput *libinput,
 		  struct ratelimit *ratelimit,
+		  uint64_t time,
 		  enum libinput_log_priority priority,
 		  const char *format, ...)
 {
 	va_list args;
 	enum ratelimit_state state;
 
-	state = ratelimit_test(ratelimit);
+	if (!is_logged(libinput, priority))
+		return;
+
+	state = ratelimit_test_time(ratelimit, time);
 	if (state == RATELIMIT_EXCEEDED)
 		return;
 
@@ -328,2704 +1047,8517 @@ libinput_log_set_handler(struct libinput *libinput,
 	libinput->log_handler = log_handler;
 }
 
-static void
-libinput_device_group_destroy(struct libinput_device_group *group);
+LIBINPUT_EXPORT uint64_t
+libinput_get_statistic(struct libinput *libinput,
+		       enum libinput_statistic statistic)
+{
+	switch (statistic) {
+	case LIBINPUT_STATISTIC_EVENT_CACHE_HITS:
+		return libinput->event_cache.hits;
+	case LIBINPUT_STATISTIC_EVENT_CACHE_MISSES:
+		return libinput->event_cache.misses;
+	case LIBINPUT_STATISTIC_EVENT_CACHE_PEAK:
+		return libinput->event_cache.peak;
+	case LIBINPUT_STATISTIC_EVENTS_COALESCED:
+		return libinput->events_coalesced;
+	case LIBINPUT_STATISTIC_EVENTS_DROPPED:
+		return libinput->events_dropped;
+	case LIBINPUT_STATISTIC_EVENT_QUEUE_SIZE:
+		return libinput->events_len;
+	case LIBINPUT_STATISTIC_EVENT_QUEUE_PEAK:
+		return libinput->events_peak;
+	case LIBINPUT_STATISTIC_QUEUE_LATENCY_SAMPLES:
+		return libinput->queue_latency.count;
+	case LIBINPUT_STATISTIC_QUEUE_LATENCY_P50:
+		return histogram_percentile(&libinput->queue_latency, 50);
+	case LIBINPUT_STATISTIC_QUEUE_LATENCY_P99:
+		return histogram_percentile(&libinput->queue_latency, 99);
+	case LIBINPUT_STATISTIC_QUEUE_LATENCY_MAX:
+		return libinput->queue_latency.max;
+	case LIBINPUT_STATISTIC_EVENTS_FILTERED:
+		return libinput->events_filtered;
+	case LIBINPUT_STATISTIC_DISPATCH_TIME_LAST:
+		return libinput->dispatch_time_last;
+	case LIBINPUT_STATISTIC_DISPATCH_TIME_TOTAL:
+		return libinput->dispatch_time_total;
+	case LIBINPUT_STATISTIC_TIMERFD_UPDATES:
+		return libinput->timer.settime_calls;
+	case LIBINPUT_STATISTIC_TIMER_WAKEUPS:
+		return libinput->timer.wakeups;
+	case LIBINPUT_STATISTIC_BUSY_POLL_SPINS:
+		return libinput->busy_poll_spins;
+	case LIBINPUT_STATISTIC_HOTPLUG_FLAPS:
+		return libinput->hotplug_flaps;
+	case LIBINPUT_STATISTIC_HOTPLUG_DEFERRED:
+		return libinput->hotplug_deferred;
+	case LIBINPUT_STATISTIC_HOTPLUG_SUPPRESSED:
+		return libinput->hotplug_suppressed;
+	case LIBINPUT_STATISTIC_EVDEV_TAP_DROPPED:
+		return libinput->evdev_tap.dropped;
+	}
 
-static void
-libinput_post_event(struct libinput *libinput,
-		    struct libinput_event *event);
+	log_bug_client(libinput,
+		       "Invalid statistic %d passed to %s()\n",
+		       statistic, __func__);
 
-LIBINPUT_EXPORT enum libinput_event_type
-libinput_event_get_type(struct libinput_event *event)
-{
-	return event->type;
+	return 0;
 }
 
-LIBINPUT_EXPORT struct libinput *
-libinput_event_get_context(struct libinput_event *event)
+LIBINPUT_EXPORT uint64_t
+libinput_get_startup_time(struct libinput *libinput,
+			  enum libinput_startup_phase phase)
 {
-	return event->device->seat->libinput;
-}
+	if (phase < LIBINPUT_STARTUP_PHASE_QUIRKS ||
+	    phase > LIBINPUT_STARTUP_PHASE_NOTIFY) {
+		log_bug_client(libinput,
+			       "Invalid startup phase %d passed to %s()\n",
+			       phase, __func__);
+		return 0;
+	}
 
-LIBINPUT_EXPORT struct libinput_device *
-libinput_event_get_device(struct libinput_event *event)
-{
-	return event->device;
+	return libinput->startup_time[phase];
 }
 
-LIBINPUT_EXPORT struct libinput_event_pointer *
-libinput_event_get_pointer_event(struct libinput_event *event)
+static size_t
+event_memory_usage(struct libinput_event *event)
 {
-	require_event_type(libinput_event_get_context(event),
-			   event->type,
-			   NULL,
-			   LIBINPUT_EVENT_POINTER_MOTION,
-			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
-			   LIBINPUT_EVENT_POINTER_BUTTON,
-			   LIBINPUT_EVENT_POINTER_AXIS);
+	size_t size = event_slab_sizes[event_type_to_slab(event->type)];
 
-	return (struct libinput_event_pointer *) event;
-}
+	if (event_type_to_slab(event->type) == EVENT_SLAB_TABLET_TOOL) {
+		struct libinput_event_tablet_tool *tev =
+			(struct libinput_event_tablet_tool *)event;
 
-LIBINPUT_EXPORT struct libinput_event_keyboard *
-libinput_event_get_keyboard_event(struct libinput_event *event)
-{
-	require_event_type(libinput_event_get_context(event),
-			   event->type,
-			   NULL,
-			   LIBINPUT_EVENT_KEYBOARD_KEY);
+		if (tev->history)
+			size += sizeof(*tev->history) +
+				tev->history->size * sizeof(*tev->history->samples);
+	} else if (event->type == LIBINPUT_EVENT_POINTER_FRAME) {
+		struct libinput_event_pointer *pev =
+			(struct libinput_event_pointer *)event;
 
-	return (struct libinput_event_keyboard *) event;
-}
+		size += sizeof(*pev->frame);
+	} else if (event->type == LIBINPUT_EVENT_POINTER_MOTION) {
+		struct libinput_event_pointer *pev =
+			(struct libinput_event_pointer *)event;
 
-LIBINPUT_EXPORT struct libinput_event_touch *
-libinput_event_get_touch_event(struct libinput_event *event)
-{
-	require_event_type(libinput_event_get_context(event),
-			   event->type,
-			   NULL,
-			   LIBINPUT_EVENT_TOUCH_DOWN,
-			   LIBINPUT_EVENT_TOUCH_UP,
-			   LIBINPUT_EVENT_TOUCH_MOTION,
-			   LIBINPUT_EVENT_TOUCH_CANCEL,
-			   LIBINPUT_EVENT_TOUCH_FRAME);
-	return (struct libinput_event_touch *) event;
+		if (pev->sources)
+			size += sizeof(*pev->sources);
+	}
+
+	return size;
 }
 
-LIBINPUT_EXPORT struct libinput_event_gesture *
-libinput_event_get_gesture_event(struct libinput_event *event)
+/* device may be NULL for all events */
+static size_t
+event_queue_memory_usage(struct libinput *libinput,
+			 struct libinput_device *device)
 {
-	require_event_type(libinput_event_get_context(event),
-			   event->type,
-			   NULL,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_END,
-			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
-			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_PINCH_END);
+	struct libinput_seat *seat;
+	size_t size = 0;
 
-	return (struct libinput_event_gesture *) event;
-}
+	for (size_t i = 0; i < libinput->events_count; i++) {
+		size_t idx = libinput_queue_index(libinput,
+						  libinput->events_out + i);
+		struct libinput_event *event = libinput->events[idx];
 
-LIBINPUT_EXPORT struct libinput_event_tablet_tool *
-libinput_event_get_tablet_tool_event(struct libinput_event *event)
-{
-	require_event_type(libinput_event_get_context(event),
-			   event->type,
-			   NULL,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON);
+		if (!device || event->device == device)
+			size += event_memory_usage(event);
+	}
 
-	return (struct libinput_event_tablet_tool *) event;
-}
+	list_for_each(seat, &libinput->seat_list, link) {
+		for (size_t i = 0; i < seat->queue.count; i++) {
+			size_t idx = (seat->queue.out + i) % seat->queue.len;
+			struct libinput_event *event = seat->queue.events[idx];
 
-LIBINPUT_EXPORT struct libinput_event_tablet_pad *
-libinput_event_get_tablet_pad_event(struct libinput_event *event)
-{
-	require_event_type(libinput_event_get_context(event),
-			   event->type,
-			   NULL,
-			   LIBINPUT_EVENT_TABLET_PAD_RING,
-			   LIBINPUT_EVENT_TABLET_PAD_STRIP,
-			   LIBINPUT_EVENT_TABLET_PAD_BUTTON,
-			   LIBINPUT_EVENT_TABLET_PAD_KEY);
+			if (!device || event->device == device)
+				size += event_memory_usage(event);
+		}
 
-	return (struct libinput_event_tablet_pad *) event;
+		if (!device)
+			size += seat->queue.len * sizeof(*seat->queue.events);
+	}
+
+	if (!device) {
+		size += libinput->events_len * sizeof(*libinput->events);
+		if (libinput->handoff.enabled)
+			size += (ring_size(&libinput->handoff.events) +
+				 ring_size(&libinput->handoff.released)) *
+				sizeof(void *);
+		if (libinput->event_ring.fd != -1)
+			size += libinput->event_ring.map_size;
+		if (libinput->evdev_tap.records)
+			size += (libinput->evdev_tap.mask + 1) *
+				sizeof(*libinput->evdev_tap.records);
+	}
+
+	return size;
 }
 
-LIBINPUT_EXPORT struct libinput_event_device_notify *
-libinput_event_get_device_notify_event(struct libinput_event *event)
+static size_t
+event_cache_memory_usage(struct libinput *libinput)
 {
-	require_event_type(libinput_event_get_context(event),
-			   event->type,
-			   NULL,
-			   LIBINPUT_EVENT_DEVICE_ADDED,
-			   LIBINPUT_EVENT_DEVICE_REMOVED);
+	size_t size = 0;
 
-	return (struct libinput_event_device_notify *) event;
+	for (size_t i = 0; i < EVENT_SLAB_COUNT; i++)
+		size += libinput->event_cache.slabs[i].count *
+			event_slab_sizes[i];
+
+	return size;
 }
 
-LIBINPUT_EXPORT struct libinput_event_switch *
-libinput_event_get_switch_event(struct libinput_event *event)
+static size_t
+device_memory_usage(struct libinput_device *device,
+		    enum libinput_memory_stat stat)
 {
-	require_event_type(libinput_event_get_context(event),
-			   event->type,
-			   NULL,
-			   LIBINPUT_EVENT_SWITCH_TOGGLE);
+	struct evdev_device *evdev = evdev_device(device);
+	size_t size = 0;
 
-	return (struct libinput_event_switch *) event;
+	switch (stat) {
+	case LIBINPUT_MEMORY_STAT_DEVICES:
+		size = sizeof(*evdev);
+		if (evdev->output_name)
+			size += strlen(evdev->output_name) + 1;
+		if (evdev->source)
+			size += sizeof(*evdev->source) + evdev->source->buf_len;
+		break;
+	case LIBINPUT_MEMORY_STAT_DISPATCH:
+		if (evdev->dispatch && evdev->dispatch->interface->memory_usage)
+			size = evdev->dispatch->interface->memory_usage(evdev->dispatch);
+		break;
+	default:
+		break;
+	}
+
+	return size;
 }
 
-LIBINPUT_EXPORT uint32_t
-libinput_event_keyboard_get_time(struct libinput_event_keyboard *event)
+static size_t
+context_memory_usage(struct libinput *libinput,
+		     enum libinput_memory_stat stat)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_KEYBOARD_KEY);
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+	struct libinput_device_group *group;
+	struct libinput_tablet_tool *tool;
+	size_t size = 0;
 
-	return us2ms(event->time);
+	switch (stat) {
+	case LIBINPUT_MEMORY_STAT_TOTAL:
+		break;
+	case LIBINPUT_MEMORY_STAT_CONTEXT:
+		size = sizeof(*libinput);
+		list_for_each(seat, &libinput->seat_list, link)
+			size += sizeof(*seat) +
+				strlen(seat->physical_name) + 1 +
+				strlen(seat->logical_name) + 1;
+		size += ptr_array_memory_usage(&libinput->device_groups);
+		size += libinput->group_hash.size *
+			sizeof(*libinput->group_hash.slots);
+		ptr_array_for_each(group, &libinput->device_groups) {
+			size += sizeof(*group);
+			if (group->identifier)
+				size += strlen(group->identifier) + 1;
+			if (group->key)
+				size += strlen(group->key) + 1;
+		}
+		break;
+	case LIBINPUT_MEMORY_STAT_EVENT_QUEUE:
+		size = event_queue_memory_usage(libinput, NULL);
+		break;
+	case LIBINPUT_MEMORY_STAT_EVENT_CACHE:
+		size = event_cache_memory_usage(libinput);
+		break;
+	case LIBINPUT_MEMORY_STAT_DEVICES:
+	case LIBINPUT_MEMORY_STAT_DISPATCH:
+		list_for_each(seat, &libinput->seat_list, link) {
+			list_for_each(device, &seat->devices_list, link)
+				size += device_memory_usage(device, stat);
+		}
+		break;
+	case LIBINPUT_MEMORY_STAT_TIMERS:
+		size = libinput_timer_subsys_memory_usage(libinput);
+		break;
+	case LIBINPUT_MEMORY_STAT_QUIRKS:
+		if (libinput->quirks)
+			size = quirks_context_get_memory_usage(libinput->quirks);
+		break;
+	case LIBINPUT_MEMORY_STAT_TABLET_TOOLS:
+		list_for_each(tool, &libinput->tool_list, link)
+			size += sizeof(*tool);
+		size += libinput->tool_hash.size *
+			sizeof(*libinput->tool_hash.slots);
+#if HAVE_LIBWACOM
+		size += libinput->libwacom->styli_size *
+			sizeof(*libinput->libwacom->styli);
+#endif
+		break;
+	case LIBINPUT_MEMORY_STAT_LOG_RING:
+		if (libinput->log_ring.entries)
+			size = (libinput->log_ring.mask + 1) *
+				sizeof(*libinput->log_ring.entries);
+		break;
+	}
+
+	return size;
 }
 
 LIBINPUT_EXPORT uint64_t
-libinput_event_keyboard_get_time_usec(struct libinput_event_keyboard *event)
+libinput_get_memory_stats(struct libinput *libinput,
+			  enum libinput_memory_stat stat)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_KEYBOARD_KEY);
+	uint64_t total = 0;
 
-	return event->time;
-}
+	if (stat < LIBINPUT_MEMORY_STAT_TOTAL ||
+	    stat > LIBINPUT_MEMORY_STAT_LOG_RING) {
+		log_bug_client(libinput,
+			       "Invalid memory stat %d passed to %s()\n",
+			       stat, __func__);
+		return 0;
+	}
 
-LIBINPUT_EXPORT uint32_t
-libinput_event_keyboard_get_key(struct libinput_event_keyboard *event)
-{
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_KEYBOARD_KEY);
+	if (stat != LIBINPUT_MEMORY_STAT_TOTAL)
+		return context_memory_usage(libinput, stat);
 
-	return event->key;
+	for (stat = LIBINPUT_MEMORY_STAT_CONTEXT;
+	     stat <= LIBINPUT_MEMORY_STAT_LOG_RING;
+	     stat++)
+		total += context_memory_usage(libinput, stat);
+
+	return total;
 }
 
-LIBINPUT_EXPORT enum libinput_key_state
-libinput_event_keyboard_get_key_state(struct libinput_event_keyboard *event)
+LIBINPUT_EXPORT void
+libinput_set_profiling(struct libinput *libinput, int enable)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_KEYBOARD_KEY);
+	if (enable && !libinput->profile.enabled) {
+		memset(libinput->profile.time, 0,
+		       sizeof(libinput->profile.time));
+		memset(libinput->profile.count, 0,
+		       sizeof(libinput->profile.count));
+	}
 
-	return event->state;
+	libinput->profile.current = 0;
+	libinput->profile.enabled = !!enable;
 }
 
-LIBINPUT_EXPORT uint32_t
-libinput_event_keyboard_get_seat_key_count(
-	struct libinput_event_keyboard *event)
+static inline bool
+check_profile_stage(struct libinput *libinput,
+		    enum libinput_profile_stage stage,
+		    const char *func)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_KEYBOARD_KEY);
+	if (stage < LIBINPUT_PROFILE_STAGE_LIBEVDEV ||
+	    stage > LIBINPUT_PROFILE_STAGE_EVENT_QUEUE) {
+		log_bug_client(libinput,
+			       "Invalid profile stage %d passed to %s()\n",
+			       stage, func);
+		return false;
+	}
 
-	return event->seat_key_count;
+	return true;
 }
 
-LIBINPUT_EXPORT uint32_t
-libinput_event_pointer_get_time(struct libinput_event_pointer *event)
+LIBINPUT_EXPORT uint64_t
+libinput_get_profile_time(struct libinput *libinput,
+			  enum libinput_profile_stage stage)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_POINTER_MOTION,
-			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
-			   LIBINPUT_EVENT_POINTER_BUTTON,
-			   LIBINPUT_EVENT_POINTER_AXIS);
+	if (!check_profile_stage(libinput, stage, __func__))
+		return 0;
 
-	return us2ms(event->time);
+	return libinput->profile.time[stage];
 }
 
 LIBINPUT_EXPORT uint64_t
-libinput_event_pointer_get_time_usec(struct libinput_event_pointer *event)
+libinput_get_profile_count(struct libinput *libinput,
+			   enum libinput_profile_stage stage)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_POINTER_MOTION,
-			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
-			   LIBINPUT_EVENT_POINTER_BUTTON,
-			   LIBINPUT_EVENT_POINTER_AXIS);
+	if (!check_profile_stage(libinput, stage, __func__))
+		return 0;
 
-	return event->time;
+	return libinput->profile.count[stage];
 }
 
-LIBINPUT_EXPORT double
-libinput_event_pointer_get_dx(struct libinput_event_pointer *event)
-{
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_POINTER_MOTION);
+static void
+libinput_device_group_destroy(struct libinput_device_group *group);
 
-	return event->delta.x;
-}
+static void
+libinput_post_event(struct libinput *libinput,
+		    struct libinput_event *event);
 
-LIBINPUT_EXPORT double
-libinput_event_pointer_get_dy(struct libinput_event_pointer *event)
+static void
+libinput_seat_post_event(struct libinput_seat *seat,
+			 struct libinput_event *event);
+
+static void
+libinput_queue_update_size(struct libinput *libinput);
+
+static void
+libinput_queue_update_expected(struct libinput *libinput,
+			       struct libinput_device *device,
+			       bool added);
+
+LIBINPUT_EXPORT enum libinput_event_type
+libinput_event_get_type(struct libinput_event *event)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_POINTER_MOTION);
+	return event->type;
+}
 
-	return event->delta.y;
+LIBINPUT_EXPORT struct libinput *
+libinput_event_get_context(struct libinput_event *event)
+{
+	return event->device->seat->libinput;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_pointer_get_dx_unaccelerated(
-	struct libinput_event_pointer *event)
+LIBINPUT_EXPORT struct libinput_device *
+libinput_event_get_device(struct libinput_event *event)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_POINTER_MOTION);
+	return event->device;
+}
 
-	return event->delta_raw.x;
+LIBINPUT_EXPORT uint64_t
+libinput_event_get_queue_time_usec(struct libinput_event *event)
+{
+	return event->queued_time;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_pointer_get_dy_unaccelerated(
-	struct libinput_event_pointer *event)
+static inline struct output_coords
+output_coords_from_point(struct libinput_device *libinput_device,
+			 const struct device_coords *point)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_POINTER_MOTION);
+	struct evdev_device *device = evdev_device(libinput_device);
+	uint32_t width = device->abs.output.width,
+		 height = device->abs.output.height;
+	struct output_coords output = {0};
 
-	return event->delta_raw.y;
+	if (width == 0)
+		return output;
+
+	output.width = width;
+	output.height = height;
+	output.point.x = evdev_device_transform_x(device, point->x, width);
+	output.point.y = evdev_device_transform_y(device, point->y, height);
+
+	return output;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_pointer_get_absolute_x(struct libinput_event_pointer *event)
+static inline double
+output_coords_get_x(struct evdev_device *device,
+		    const struct output_coords *output,
+		    int x,
+		    uint32_t width)
 {
-	struct evdev_device *device = evdev_device(event->base.device);
-
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE);
+	if (width != 0 && width == output->width)
+		return output->point.x;
 
-	return evdev_convert_to_mm(device->abs.absinfo_x, event->absolute.x);
+	return evdev_device_transform_x(device, x, width);
 }
 
-LIBINPUT_EXPORT double
-libinput_event_pointer_get_absolute_y(struct libinput_event_pointer *event)
+static inline double
+output_coords_get_y(struct evdev_device *device,
+		    const struct output_coords *output,
+		    int y,
+		    uint32_t height)
 {
-	struct evdev_device *device = evdev_device(event->base.device);
+	if (height != 0 && height == output->height)
+		return output->point.y;
 
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE);
+	return evdev_device_transform_y(device, y, height);
+}
 
-	return evdev_convert_to_mm(device->abs.absinfo_y, event->absolute.y);
+static void
+event_view_fill_pointer_axis(struct libinput_event_view *view,
+			     struct libinput_event_pointer *event,
+			     const struct normalized_coords *value)
+{
+	view->u.pointer.axes = event->axes;
+	view->u.pointer.axis_source = event->source;
+	if (event->axes & bit(LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL)) {
+		view->u.pointer.axis_value_horizontal = value->x;
+		view->u.pointer.axis_discrete_horizontal = event->discrete.x;
+	}
+	if (event->axes & bit(LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL)) {
+		view->u.pointer.axis_value_vertical = value->y;
+		view->u.pointer.axis_discrete_vertical = event->discrete.y;
+	}
 }
 
-LIBINPUT_EXPORT double
-libinput_event_pointer_get_absolute_x_transformed(
-	struct libinput_event_pointer *event,
-	uint32_t width)
+/* The view has room for one button, a frame's buttons are only available
+ * through libinput_event_pointer_get_frame_button() and friends */
+static void
+event_view_fill_pointer(struct libinput_event_view *view,
+			struct libinput_event_pointer *event,
+			uint32_t width,
+			uint32_t height)
 {
 	struct evdev_device *device = evdev_device(event->base.device);
+	enum libinput_event_type type = event->base.type;
 
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE);
+	view->time_usec = event->time;
 
-	return evdev_device_transform_x(device, event->absolute.x, width);
+	if (type == LIBINPUT_EVENT_POINTER_FRAME) {
+		event_view_fill_pointer_axis(view, event,
+					     &event->frame->axis_value);
+		type = event->frame->motion_type;
+	}
+
+	switch (type) {
+	case LIBINPUT_EVENT_POINTER_MOTION:
+		view->u.pointer.dx = event->delta.x;
+		view->u.pointer.dy = event->delta.y;
+		view->u.pointer.dx_unaccelerated = event->delta_raw.x;
+		view->u.pointer.dy_unaccelerated = event->delta_raw.y;
+		break;
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+		view->u.pointer.absolute_x =
+			evdev_convert_to_mm(device->abs.absinfo_x,
+					    event->absolute.x);
+		view->u.pointer.absolute_y =
+			evdev_convert_to_mm(device->abs.absinfo_y,
+					    event->absolute.y);
+		view->u.pointer.absolute_x_transformed =
+			evdev_device_transform_x(device,
+						 event->absolute.x,
+						 width);
+		view->u.pointer.absolute_y_transformed =
+			evdev_device_transform_y(device,
+						 event->absolute.y,
+						 height);
+		break;
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+		view->u.pointer.button = event->button;
+		view->u.pointer.button_state = event->state;
+		view->u.pointer.seat_button_count = event->seat_button_count;
+		break;
+	case LIBINPUT_EVENT_POINTER_AXIS:
+		event_view_fill_pointer_axis(view, event, &event->delta);
+		break;
+	default:
+		break;
+	}
 }
 
-LIBINPUT_EXPORT double
-libinput_event_pointer_get_absolute_y_transformed(
-	struct libinput_event_pointer *event,
-	uint32_t height)
+static void
+event_view_fill_touch(struct libinput_event_view *view,
+		      struct libinput_event_touch *event,
+		      uint32_t width,
+		      uint32_t height)
 {
 	struct evdev_device *device = evdev_device(event->base.device);
 
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE);
-
-	return evdev_device_transform_y(device, event->absolute.y, height);
+	view->time_usec = event->time;
+
+	switch (event->base.type) {
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+		view->u.touch.x = evdev_convert_to_mm(device->abs.absinfo_x,
+						      event->point.x);
+		view->u.touch.y = evdev_convert_to_mm(device->abs.absinfo_y,
+						      event->point.y);
+		view->u.touch.x_transformed =
+			output_coords_get_x(device,
+					    &event->output,
+					    event->point.x,
+					    width);
+		view->u.touch.y_transformed =
+			output_coords_get_y(device,
+					    &event->output,
+					    event->point.y,
+					    height);
+		/* fallthrough */
+	case LIBINPUT_EVENT_TOUCH_UP:
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+		view->u.touch.slot = event->slot;
+		view->u.touch.seat_slot = event->seat_slot;
+		break;
+	default:
+		break;
+	}
 }
 
-LIBINPUT_EXPORT uint32_t
-libinput_event_pointer_get_button(struct libinput_event_pointer *event)
+static void
+event_view_fill_tablet_tool(struct libinput_event_view *view,
+			    struct libinput_event_tablet_tool *event,
+			    uint32_t width,
+			    uint32_t height)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_POINTER_BUTTON);
+	struct evdev_device *device = evdev_device(event->base.device);
+	const struct tablet_axes *axes = &event->axes;
+
+	view->time_usec = event->time;
+	view->u.tablet_tool.tool = event->tool;
+	view->u.tablet_tool.proximity_state = event->proximity_state;
+	view->u.tablet_tool.tip_state = event->tip_state;
+	view->u.tablet_tool.x = evdev_convert_to_mm(device->abs.absinfo_x,
+						    axes->point.x);
+	view->u.tablet_tool.y = evdev_convert_to_mm(device->abs.absinfo_y,
+						    axes->point.y);
+	view->u.tablet_tool.x_transformed =
+		output_coords_get_x(device, &event->output, axes->point.x, width);
+	view->u.tablet_tool.y_transformed =
+		output_coords_get_y(device, &event->output, axes->point.y, height);
+	view->u.tablet_tool.dx = axes->delta.x;
+	view->u.tablet_tool.dy = axes->delta.y;
+	view->u.tablet_tool.pressure = axes->pressure;
+	view->u.tablet_tool.distance = axes->distance;
+	view->u.tablet_tool.tilt_x = axes->tilt.x;
+	view->u.tablet_tool.tilt_y = axes->tilt.y;
+	view->u.tablet_tool.rotation = tablet_axes_get_rotation(&event->axes);
+	view->u.tablet_tool.slider_position = axes->slider;
+	view->u.tablet_tool.wheel_delta = axes->wheel;
+
+	if (event->base.type == LIBINPUT_EVENT_TABLET_TOOL_BUTTON) {
+		view->u.tablet_tool.button = event->button;
+		view->u.tablet_tool.button_state = event->state;
+		view->u.tablet_tool.seat_button_count = event->seat_button_count;
+	}
+}
 
-	return event->button;
+LIBINPUT_EXPORT int
+libinput_event_get_view(struct libinput_event *event,
+			struct libinput_event_view *view_out,
+			size_t size,
+			uint32_t width,
+			uint32_t height)
+{
+	struct libinput_event_view view = {
+		.version = LIBINPUT_EVENT_VIEW_VERSION,
+		.type = event->type,
+		.device = event->device,
+	};
+
+	if (size < offsetof(struct libinput_event_view, u)) {
+		log_bug_client(libinput_event_get_context(event),
+			       "event view size %zd too small\n",
+			       size);
+		return -1;
+	}
+
+	switch (event->type) {
+	case LIBINPUT_EVENT_NONE:
+		abort();
+	case LIBINPUT_EVENT_DEVICE_ADDED:
+	case LIBINPUT_EVENT_DEVICE_REMOVED:
+		break;
+	case LIBINPUT_EVENT_KEYBOARD_KEY: {
+		struct libinput_event_keyboard *k =
+			(struct libinput_event_keyboard *)event;
+
+		view.time_usec = k->time;
+		view.u.keyboard.key = k->key;
+		view.u.keyboard.state = k->state;
+		view.u.keyboard.seat_key_count = k->seat_key_count;
+		break;
+	}
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+	case LIBINPUT_EVENT_POINTER_AXIS:
+	case LIBINPUT_EVENT_POINTER_FRAME:
+		event_view_fill_pointer(&view,
+					(struct libinput_event_pointer *)event,
+					width,
+					height);
+		break;
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+	case LIBINPUT_EVENT_TOUCH_UP:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		event_view_fill_touch(&view,
+				      (struct libinput_event_touch *)event,
+				      width,
+				      height);
+		break;
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
+	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
+	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
+	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
+		event_view_fill_tablet_tool(&view,
+					    (struct libinput_event_tablet_tool *)event,
+					    width,
+					    height);
+		break;
+	case LIBINPUT_EVENT_TABLET_PAD_BUTTON:
+	case LIBINPUT_EVENT_TABLET_PAD_RING:
+	case LIBINPUT_EVENT_TABLET_PAD_STRIP:
+	case LIBINPUT_EVENT_TABLET_PAD_KEY:
+		view.time_usec =
+			((struct libinput_event_tablet_pad *)event)->time;
+		break;
+	case LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_END:
+	case LIBINPUT_EVENT_GESTURE_PINCH_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_PINCH_END: {
+		struct libinput_event_gesture *g =
+			(struct libinput_event_gesture *)event;
+
+		view.time_usec = g->time;
+		view.u.gesture.finger_count = g->finger_count;
+		view.u.gesture.cancelled = g->cancelled;
+		view.u.gesture.dx = g->delta.x;
+		view.u.gesture.dy = g->delta.y;
+		view.u.gesture.dx_unaccelerated = g->delta_unaccel.x;
+		view.u.gesture.dy_unaccelerated = g->delta_unaccel.y;
+		if (event->type >= LIBINPUT_EVENT_GESTURE_PINCH_BEGIN) {
+			view.u.gesture.scale = g->scale;
+			view.u.gesture.angle_delta = g->angle;
+		}
+		break;
+	}
+	case LIBINPUT_EVENT_SWITCH_TOGGLE: {
+		struct libinput_event_switch *s =
+			(struct libinput_event_switch *)event;
+
+		view.time_usec = s->time;
+		view.u.sw.which = s->sw;
+		view.u.sw.state = s->state;
+		break;
+	}
+	}
+
+	memcpy(view_out, &view, min(size, sizeof(view)));
+
+	return 0;
 }
 
-LIBINPUT_EXPORT enum libinput_button_state
-libinput_event_pointer_get_button_state(struct libinput_event_pointer *event)
+static void
+event_ring_fill_record(struct libinput_event_ring_record *r,
+		       struct libinput_event *event)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_POINTER_BUTTON);
+	struct libinput_event_view view;
+	struct libinput_tablet_tool *tool;
 
-	return event->state;
+	libinput_event_get_view(event, &view, sizeof(view), 0, 0);
+
+	r->time_usec = view.time_usec;
+	r->type = event->type;
+	r->device_id = event->device->id;
+	memset(&r->u, 0, sizeof(r->u));
+
+	switch (event->type) {
+	case LIBINPUT_EVENT_NONE:
+		abort();
+	case LIBINPUT_EVENT_DEVICE_ADDED:
+		snprintf(r->u.device.sysname,
+			 sizeof(r->u.device.sysname),
+			 "%s",
+			 libinput_device_get_sysname(event->device));
+		snprintf(r->u.device.name,
+			 sizeof(r->u.device.name),
+			 "%s",
+			 libinput_device_get_name(event->device));
+		r->u.device.vendor = libinput_device_get_id_vendor(event->device);
+		r->u.device.product = libinput_device_get_id_product(event->device);
+		break;
+	case LIBINPUT_EVENT_DEVICE_REMOVED:
+		break;
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		r->u.keyboard.key = view.u.keyboard.key;
+		r->u.keyboard.state = view.u.keyboard.state;
+		r->u.keyboard.seat_key_count = view.u.keyboard.seat_key_count;
+		break;
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+	case LIBINPUT_EVENT_POINTER_AXIS:
+	case LIBINPUT_EVENT_POINTER_FRAME:
+		r->u.pointer.dx = view.u.pointer.dx;
+		r->u.pointer.dy = view.u.pointer.dy;
+		r->u.pointer.dx_unaccelerated = view.u.pointer.dx_unaccelerated;
+		r->u.pointer.dy_unaccelerated = view.u.pointer.dy_unaccelerated;
+		r->u.pointer.absolute_x = view.u.pointer.absolute_x;
+		r->u.pointer.absolute_y = view.u.pointer.absolute_y;
+		r->u.pointer.axis_value_horizontal =
+			view.u.pointer.axis_value_horizontal;
+		r->u.pointer.axis_value_vertical =
+			view.u.pointer.axis_value_vertical;
+		r->u.pointer.axis_discrete_horizontal =
+			view.u.pointer.axis_discrete_horizontal;
+		r->u.pointer.axis_discrete_vertical =
+			view.u.pointer.axis_discrete_vertical;
+		r->u.pointer.button = view.u.pointer.button;
+		r->u.pointer.button_state = view.u.pointer.button_state;
+		r->u.pointer.seat_button_count = view.u.pointer.seat_button_count;
+		r->u.pointer.axes = view.u.pointer.axes;
+		r->u.pointer.axis_source = view.u.pointer.axis_source;
+		break;
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+	case LIBINPUT_EVENT_TOUCH_UP:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		r->u.touch.slot = view.u.touch.slot;
+		r->u.touch.seat_slot = view.u.touch.seat_slot;
+		r->u.touch.x = view.u.touch.x;
+		r->u.touch.y = view.u.touch.y;
+		break;
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
+	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
+	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
+	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
+		tool = view.u.tablet_tool.tool;
+		r->u.tablet_tool.serial = tool->serial;
+		r->u.tablet_tool.tool_id = tool->tool_id;
+		r->u.tablet_tool.tool_type = tool->type;
+		r->u.tablet_tool.proximity_state =
+			view.u.tablet_tool.proximity_state;
+		r->u.tablet_tool.tip_state = view.u.tablet_tool.tip_state;
+		r->u.tablet_tool.button = view.u.tablet_tool.button;
+		r->u.tablet_tool.button_state = view.u.tablet_tool.button_state;
+		r->u.tablet_tool.seat_button_count =
+			view.u.tablet_tool.seat_button_count;
+		r->u.tablet_tool.x = view.u.tablet_tool.x;
+		r->u.tablet_tool.y = view.u.tablet_tool.y;
+		r->u.tablet_tool.dx = view.u.tablet_tool.dx;
+		r->u.tablet_tool.dy = view.u.tablet_tool.dy;
+		r->u.tablet_tool.pressure = view.u.tablet_tool.pressure;
+		r->u.tablet_tool.distance = view.u.tablet_tool.distance;
+		r->u.tablet_tool.tilt_x = view.u.tablet_tool.tilt_x;
+		r->u.tablet_tool.tilt_y = view.u.tablet_tool.tilt_y;
+		r->u.tablet_tool.rotation = view.u.tablet_tool.rotation;
+		r->u.tablet_tool.slider_position =
+			view.u.tablet_tool.slider_position;
+		r->u.tablet_tool.wheel_delta = view.u.tablet_tool.wheel_delta;
+		break;
+	case LIBINPUT_EVENT_TABLET_PAD_BUTTON:
+	case LIBINPUT_EVENT_TABLET_PAD_RING:
+	case LIBINPUT_EVENT_TABLET_PAD_STRIP:
+	case LIBINPUT_EVENT_TABLET_PAD_KEY: {
+		struct libinput_event_tablet_pad *p =
+			(struct libinput_event_tablet_pad *)event;
+
+		r->u.tablet_pad.mode = p->mode;
+		if (event->type == LIBINPUT_EVENT_TABLET_PAD_BUTTON) {
+			r->u.tablet_pad.number = p->button.number;
+			r->u.tablet_pad.state = p->button.state;
+		} else if (event->type == LIBINPUT_EVENT_TABLET_PAD_KEY) {
+			r->u.tablet_pad.number = p->key.code;
+			r->u.tablet_pad.state = p->key.state;
+		} else if (event->type == LIBINPUT_EVENT_TABLET_PAD_RING) {
+			r->u.tablet_pad.number = p->ring.number;
+			r->u.tablet_pad.source = p->ring.source;
+			r->u.tablet_pad.position = p->ring.position;
+		} else {
+			r->u.tablet_pad.number = p->strip.number;
+			r->u.tablet_pad.source = p->strip.source;
+			r->u.tablet_pad.position = p->strip.position;
+		}
+		break;
+	}
+	case LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_END:
+	case LIBINPUT_EVENT_GESTURE_PINCH_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_PINCH_END:
+		r->u.gesture.finger_count = view.u.gesture.finger_count;
+		r->u.gesture.cancelled = view.u.gesture.cancelled;
+		r->u.gesture.dx = view.u.gesture.dx;
+		r->u.gesture.dy = view.u.gesture.dy;
+		r->u.gesture.dx_unaccelerated = view.u.gesture.dx_unaccelerated;
+		r->u.gesture.dy_unaccelerated = view.u.gesture.dy_unaccelerated;
+		r->u.gesture.scale = view.u.gesture.scale;
+		r->u.gesture.angle_delta = view.u.gesture.angle_delta;
+		break;
+	case LIBINPUT_EVENT_SWITCH_TOGGLE:
+		r->u.sw.which = view.u.sw.which;
+		r->u.sw.state = view.u.sw.state;
+		break;
+	}
 }
 
-LIBINPUT_EXPORT uint32_t
-libinput_event_pointer_get_seat_button_count(
-	struct libinput_event_pointer *event)
+/* Single writer, any number of readers in other processes. Each record
+ * works like a seqlock: the sequence is cleared before and set after
+ * the payload is written, a reader that sees the same complete sequence
+ * before and after copying the record has a consistent copy */
+static void
+libinput_event_ring_publish(struct libinput *libinput,
+			    struct libinput_event *event)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_POINTER_BUTTON);
+	uint64_t pos = libinput->event_ring.head;
+	struct libinput_event_ring_record *r =
+		&libinput->event_ring.records[pos & libinput->event_ring.mask];
 
-	return event->seat_button_count;
+	__atomic_store_n(&r->sequence, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	event_ring_fill_record(r, event);
+
+	__atomic_store_n(&r->sequence, pos + 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&libinput->event_ring.header->head,
+			 pos + 1,
+			 __ATOMIC_RELEASE);
+	libinput->event_ring.head = pos + 1;
 }
 
-LIBINPUT_EXPORT int
-libinput_event_pointer_has_axis(struct libinput_event_pointer *event,
-				enum libinput_pointer_axis axis)
+static void
+libinput_event_ring_notify(struct libinput *libinput)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_POINTER_AXIS);
+	uint64_t one = 1;
 
-	switch (axis) {
-	case LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL:
-	case LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL:
-		return !!(event->axes & bit(axis));
+	for (size_t i = 0; i < libinput->event_ring.nnotify_fds; i++) {
+		int fd = libinput->event_ring.notify_fds[i];
+
+		/* EAGAIN means the counter is already non-zero */
+		if (write(fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+			log_error(libinput,
+				  "Failed to signal the event ring consumer: %s\n",
+				  strerror(errno));
 	}
 
-	return 0;
+	libinput->event_ring.notified = libinput->event_ring.head;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_pointer_get_axis_value(struct libinput_event_pointer *event,
-				      enum libinput_pointer_axis axis)
+static void
+libinput_event_ring_destroy(struct libinput *libinput)
 {
-	struct libinput *libinput = event->base.device->seat->libinput;
-	double value = 0;
+	if (libinput->event_ring.fd == -1)
+		return;
 
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0.0,
-			   LIBINPUT_EVENT_POINTER_AXIS);
+	munmap(libinput->event_ring.header, libinput->event_ring.map_size);
+	close(libinput->event_ring.fd);
+	free(libinput->event_ring.notify_fds);
+	libinput->event_ring.fd = -1;
+	libinput->event_ring.header = NULL;
+	libinput->event_ring.records = NULL;
+	libinput->event_ring.notify_fds = NULL;
+	libinput->event_ring.nnotify_fds = 0;
+}
 
-	if (!libinput_event_pointer_has_axis(event, axis)) {
-		log_bug_client(libinput, "value requested for unset axis\n");
-	} else {
-		switch (axis) {
-		case LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL:
-			value = event->delta.x;
-			break;
-		case LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL:
-			value = event->delta.y;
-			break;
+/* Keeps the records cache line aligned */
+#define EVENT_RING_HEADER_SIZE 64
+
+LIBINPUT_EXPORT int
+libinput_enable_event_ring(struct libinput *libinput,
+			   unsigned int size)
+{
+#ifdef HAVE_MEMFD_CREATE
+	struct libinput_event_ring_header *header;
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+	const size_t header_size = EVENT_RING_HEADER_SIZE;
+	size_t map_size;
+	int fd;
+
+	_Static_assert(sizeof(*header) <= EVENT_RING_HEADER_SIZE,
+		       "event ring header too large");
+	/* The record layout is ABI for the other processes */
+	_Static_assert(sizeof(struct libinput_event_ring_record) == 128,
+		       "event ring record size changed");
+
+	if (libinput->event_ring.fd != -1) {
+		log_bug_client(libinput, "Event ring is already enabled\n");
+		return -1;
+	}
+
+	if (size == 0 || (size & (size - 1)) != 0) {
+		log_bug_client(libinput, "Invalid event ring size %u\n", size);
+		return -1;
+	}
+
+	map_size = header_size + size * sizeof(struct libinput_event_ring_record);
+
+	fd = memfd_create("libinput-event-ring",
+			  MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd < 0)
+		goto err;
+
+	if (ftruncate(fd, map_size) < 0)
+		goto err_fd;
+
+	header = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (header == MAP_FAILED)
+		goto err_fd;
+
+	if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) < 0)
+		goto err_map;
+
+#ifdef F_SEAL_FUTURE_WRITE
+	/* Since 5.1, our writable mapping stays but nobody else can
+	 * create one. Not fatal, older kernels just can't enforce it */
+	fcntl(fd, F_ADD_SEALS, F_SEAL_FUTURE_WRITE);
+#endif
+	fcntl(fd, F_ADD_SEALS, F_SEAL_SEAL);
+
+	header->magic = LIBINPUT_EVENT_RING_MAGIC;
+	header->version = LIBINPUT_EVENT_RING_VERSION;
+	header->header_size = header_size;
+	header->record_size = sizeof(struct libinput_event_ring_record);
+	header->size = size;
+	header->head = 0;
+
+	libinput->event_ring.fd = fd;
+	libinput->event_ring.header = header;
+	libinput->event_ring.records =
+		(struct libinput_event_ring_record *)((char *)header + header_size);
+	libinput->event_ring.map_size = map_size;
+	libinput->event_ring.mask = size - 1;
+	libinput->event_ring.head = 0;
+
+	/* The devices added before the ring was enabled, without these a
+	 * consumer can't tell what the device_id of a record refers to */
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link) {
+			struct libinput_event added = {
+				.type = LIBINPUT_EVENT_DEVICE_ADDED,
+				.device = device,
+			};
+
+			libinput_event_ring_publish(libinput, &added);
 		}
 	}
 
-	return value;
+	/* Nobody to notify yet, see libinput_add_event_ring_notify_fd() */
+	libinput->event_ring.notified = libinput->event_ring.head;
+
+	return 0;
+
+err_map:
+	munmap(header, map_size);
+err_fd:
+	close(fd);
+err:
+	log_error(libinput,
+		  "Failed to create the event ring: %s\n",
+		  strerror(errno));
+	return -1;
+#else
+	log_bug_client(libinput, "Event ring is not supported on this system\n");
+	return -1;
+#endif
 }
 
-LIBINPUT_EXPORT double
-libinput_event_pointer_get_axis_value_discrete(struct libinput_event_pointer *event,
-					       enum libinput_pointer_axis axis)
+LIBINPUT_EXPORT int
+libinput_get_event_ring_fd(struct libinput *libinput)
 {
-	struct libinput *libinput = event->base.device->seat->libinput;
-	double value = 0;
+	return libinput->event_ring.fd;
+}
 
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0.0,
-			   LIBINPUT_EVENT_POINTER_AXIS);
+LIBINPUT_EXPORT int
+libinput_add_event_ring_notify_fd(struct libinput *libinput, int fd)
+{
+	size_t n = libinput->event_ring.nnotify_fds;
 
-	if (!libinput_event_pointer_has_axis(event, axis)) {
-		log_bug_client(libinput, "value requested for unset axis\n");
-	} else {
-		switch (axis) {
-		case LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL:
-			value = event->discrete.x;
-			break;
-		case LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL:
-			value = event->discrete.y;
-			break;
-		}
+	if (libinput->event_ring.fd == -1) {
+		log_bug_client(libinput, "Event ring is not enabled\n");
+		return -1;
 	}
-	return value;
+
+	if (fd < 0) {
+		log_bug_client(libinput, "Invalid notify fd %d\n", fd);
+		return -1;
+	}
+
+	libinput->event_ring.notify_fds =
+		realloc(libinput->event_ring.notify_fds,
+			(n + 1) * sizeof(*libinput->event_ring.notify_fds));
+	if (!libinput->event_ring.notify_fds)
+		abort();
+
+	libinput->event_ring.notify_fds[n] = fd;
+	libinput->event_ring.nnotify_fds = n + 1;
+
+	return 0;
 }
 
-LIBINPUT_EXPORT enum libinput_pointer_axis_source
-libinput_event_pointer_get_axis_source(struct libinput_event_pointer *event)
+LIBINPUT_EXPORT int
+libinput_remove_event_ring_notify_fd(struct libinput *libinput, int fd)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_POINTER_AXIS);
+	size_t n;
 
-	return event->source;
+	for (size_t i = 0; i < libinput->event_ring.nnotify_fds; i++) {
+		if (libinput->event_ring.notify_fds[i] != fd)
+			continue;
+
+		n = --libinput->event_ring.nnotify_fds;
+		libinput->event_ring.notify_fds[i] =
+			libinput->event_ring.notify_fds[n];
+		return 0;
+	}
+
+	return -1;
 }
 
-LIBINPUT_EXPORT uint32_t
-libinput_event_touch_get_time(struct libinput_event_touch *event)
+/* The evdev tap is a single-producer/single-consumer ring like struct
+ * ring but of records. We own tail, the recorder owns head. */
+void
+libinput_evdev_tap_push(struct libinput *libinput,
+			struct libinput_device *device,
+			const struct input_event *events,
+			size_t nevents)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TOUCH_DOWN,
-			   LIBINPUT_EVENT_TOUCH_UP,
-			   LIBINPUT_EVENT_TOUCH_MOTION,
-			   LIBINPUT_EVENT_TOUCH_CANCEL,
-			   LIBINPUT_EVENT_TOUCH_FRAME);
+	size_t tail = libinput->evdev_tap.tail;
+	size_t head = __atomic_load_n(&libinput->evdev_tap.head,
+				      __ATOMIC_ACQUIRE);
 
-	return us2ms(event->time);
+	if (nevents > libinput->evdev_tap.mask + 1 - (tail - head)) {
+		libinput->evdev_tap.dropped += nevents;
+		return;
+	}
+
+	for (size_t i = 0; i < nevents; i++) {
+		struct libinput_evdev_tap_record *r =
+			&libinput->evdev_tap.records[(tail + i) &
+						     libinput->evdev_tap.mask];
+
+		*r = (struct libinput_evdev_tap_record) {
+			.time_usec = input_event_time(&events[i]),
+			.device_id = device->id,
+			.type = events[i].type,
+			.code = events[i].code,
+			.value = events[i].value,
+		};
+	}
+
+	__atomic_store_n(&libinput->evdev_tap.tail,
+			 tail + nevents,
+			 __ATOMIC_RELEASE);
 }
 
-LIBINPUT_EXPORT uint64_t
-libinput_event_touch_get_time_usec(struct libinput_event_touch *event)
+static void
+libinput_evdev_tap_notify(struct libinput *libinput)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TOUCH_DOWN,
-			   LIBINPUT_EVENT_TOUCH_UP,
-			   LIBINPUT_EVENT_TOUCH_MOTION,
-			   LIBINPUT_EVENT_TOUCH_CANCEL,
-			   LIBINPUT_EVENT_TOUCH_FRAME);
+	uint64_t one = 1;
 
-	return event->time;
+	/* EAGAIN means the counter is already non-zero */
+	if (write(libinput->evdev_tap.fd, &one, sizeof(one)) < 0 &&
+	    errno != EAGAIN)
+		log_error(libinput,
+			  "Failed to signal the evdev tap: %s\n",
+			  strerror(errno));
+
+	libinput->evdev_tap.notified = libinput->evdev_tap.tail;
 }
 
-LIBINPUT_EXPORT int32_t
-libinput_event_touch_get_slot(struct libinput_event_touch *event)
+static void
+libinput_evdev_tap_destroy(struct libinput *libinput)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TOUCH_DOWN,
-			   LIBINPUT_EVENT_TOUCH_UP,
-			   LIBINPUT_EVENT_TOUCH_MOTION,
-			   LIBINPUT_EVENT_TOUCH_CANCEL);
+	if (!libinput->evdev_tap.records)
+		return;
 
-	return event->slot;
+	close(libinput->evdev_tap.fd);
+	free(libinput->evdev_tap.records);
+	libinput->evdev_tap.fd = -1;
+	libinput->evdev_tap.records = NULL;
 }
 
-LIBINPUT_EXPORT int32_t
-libinput_event_touch_get_seat_slot(struct libinput_event_touch *event)
+LIBINPUT_EXPORT int
+libinput_enable_evdev_tap(struct libinput *libinput,
+			  unsigned int size)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TOUCH_DOWN,
-			   LIBINPUT_EVENT_TOUCH_UP,
-			   LIBINPUT_EVENT_TOUCH_MOTION,
-			   LIBINPUT_EVENT_TOUCH_CANCEL);
+	struct libinput_evdev_tap_record *records;
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+	int fd;
 
-	return event->seat_slot;
-}
+	if (libinput->evdev_tap.records) {
+		log_bug_client(libinput, "The evdev tap is already enabled\n");
+		return -1;
+	}
 
-LIBINPUT_EXPORT double
-libinput_event_touch_get_x(struct libinput_event_touch *event)
-{
-	struct evdev_device *device = evdev_device(event->base.device);
+	if (size == 0 || (size & (size - 1)) != 0) {
+		log_bug_client(libinput, "Invalid evdev tap size %u\n", size);
+		return -1;
+	}
 
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TOUCH_DOWN,
-			   LIBINPUT_EVENT_TOUCH_MOTION);
+	records = calloc(size, sizeof(*records));
+	if (!records)
+		return -1;
 
-	return evdev_convert_to_mm(device->abs.absinfo_x, event->point.x);
-}
+	fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (fd < 0) {
+		free(records);
+		return -1;
+	}
 
-LIBINPUT_EXPORT double
-libinput_event_touch_get_x_transformed(struct libinput_event_touch *event,
-				       uint32_t width)
-{
-	struct evdev_device *device = evdev_device(event->base.device);
+	libinput->evdev_tap.records = records;
+	libinput->evdev_tap.mask = size - 1;
+	libinput->evdev_tap.head = 0;
+	libinput->evdev_tap.tail = 0;
+	libinput->evdev_tap.notified = 0;
+	libinput->evdev_tap.fd = fd;
+
+	/* The recorder wants what the kernel sends, not just the codes we
+	 * process */
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link) {
+			if (evdev_device(device)->fd != -1)
+				evdev_set_kernel_event_mask(evdev_device(device));
+		}
+	}
 
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TOUCH_DOWN,
-			   LIBINPUT_EVENT_TOUCH_MOTION);
+	return 0;
+}
 
-	return evdev_device_transform_x(device, event->point.x, width);
+LIBINPUT_EXPORT int
+libinput_get_evdev_tap_fd(struct libinput *libinput)
+{
+	return libinput->evdev_tap.fd;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_touch_get_y_transformed(struct libinput_event_touch *event,
-				       uint32_t height)
+static size_t
+evdev_tap_pop(struct libinput *libinput,
+	      struct libinput_evdev_tap_record *records,
+	      size_t max)
 {
-	struct evdev_device *device = evdev_device(event->base.device);
+	size_t head = libinput->evdev_tap.head;
+	size_t tail = __atomic_load_n(&libinput->evdev_tap.tail,
+				      __ATOMIC_ACQUIRE);
+	size_t n = min(tail - head, max);
 
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TOUCH_DOWN,
-			   LIBINPUT_EVENT_TOUCH_MOTION);
+	for (size_t i = 0; i < n; i++)
+		records[i] = libinput->evdev_tap.records[(head + i) &
+							 libinput->evdev_tap.mask];
 
-	return evdev_device_transform_y(device, event->point.y, height);
+	__atomic_store_n(&libinput->evdev_tap.head, head + n, __ATOMIC_RELEASE);
+
+	return n;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_touch_get_y(struct libinput_event_touch *event)
+LIBINPUT_EXPORT size_t
+libinput_evdev_tap_read(struct libinput *libinput,
+			struct libinput_evdev_tap_record *records,
+			size_t max)
 {
-	struct evdev_device *device = evdev_device(event->base.device);
+	uint64_t counter;
+	size_t n;
 
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TOUCH_DOWN,
-			   LIBINPUT_EVENT_TOUCH_MOTION);
+	if (!libinput->evdev_tap.records)
+		return 0;
 
-	return evdev_convert_to_mm(device->abs.absinfo_y, event->point.y);
-}
+	n = evdev_tap_pop(libinput, records, max);
+	if (n > 0)
+		return n;
 
-LIBINPUT_EXPORT uint32_t
-libinput_event_gesture_get_time(struct libinput_event_gesture *event)
-{
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
-			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_PINCH_END,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
+	/* Reset the fd, then look again in case events were added in
+	 * between. Anything added after this signals the fd again. */
+	if (read(libinput->evdev_tap.fd, &counter, sizeof(counter)) < 0 &&
+	    errno != EAGAIN)
+		return 0;
 
-	return us2ms(event->time);
+	return evdev_tap_pop(libinput, records, max);
 }
 
-LIBINPUT_EXPORT uint64_t
-libinput_event_gesture_get_time_usec(struct libinput_event_gesture *event)
-{
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
-			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_PINCH_END,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
+enum serialize_kind {
+	SERIALIZE_U32,
+	SERIALIZE_I32,
+	SERIALIZE_U64,
+	SERIALIZE_DOUBLE,
+	SERIALIZE_FLOAT,
+};
 
-	return event->time;
-}
+struct serialize_field {
+	size_t offset;
+	enum serialize_kind kind;
+};
 
-LIBINPUT_EXPORT int
-libinput_event_gesture_get_finger_count(struct libinput_event_gesture *event)
-{
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
-			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_PINCH_END,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
+#define SERIALIZE_FIELD(member_, kind_) \
+	{ offsetof(struct libinput_event_ring_record, u.member_), \
+	  SERIALIZE_##kind_ }
+
+static const struct serialize_field serialize_pointer[] = {
+	SERIALIZE_FIELD(pointer.dx, DOUBLE),
+	SERIALIZE_FIELD(pointer.dy, DOUBLE),
+	SERIALIZE_FIELD(pointer.dx_unaccelerated, DOUBLE),
+	SERIALIZE_FIELD(pointer.dy_unaccelerated, DOUBLE),
+	SERIALIZE_FIELD(pointer.absolute_x, DOUBLE),
+	SERIALIZE_FIELD(pointer.absolute_y, DOUBLE),
+	SERIALIZE_FIELD(pointer.axis_value_horizontal, DOUBLE),
+	SERIALIZE_FIELD(pointer.axis_value_vertical, DOUBLE),
+	SERIALIZE_FIELD(pointer.axis_discrete_horizontal, DOUBLE),
+	SERIALIZE_FIELD(pointer.axis_discrete_vertical, DOUBLE),
+	SERIALIZE_FIELD(pointer.button, U32),
+	SERIALIZE_FIELD(pointer.button_state, U32),
+	SERIALIZE_FIELD(pointer.seat_button_count, U32),
+	SERIALIZE_FIELD(pointer.axes, U32),
+	SERIALIZE_FIELD(pointer.axis_source, U32),
+};
 
-	return event->finger_count;
-}
+static const struct serialize_field serialize_keyboard[] = {
+	SERIALIZE_FIELD(keyboard.key, U32),
+	SERIALIZE_FIELD(keyboard.state, U32),
+	SERIALIZE_FIELD(keyboard.seat_key_count, U32),
+};
 
-LIBINPUT_EXPORT int
-libinput_event_gesture_get_cancelled(struct libinput_event_gesture *event)
-{
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_GESTURE_PINCH_END,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
+static const struct serialize_field serialize_touch[] = {
+	SERIALIZE_FIELD(touch.slot, I32),
+	SERIALIZE_FIELD(touch.seat_slot, I32),
+	SERIALIZE_FIELD(touch.x, DOUBLE),
+	SERIALIZE_FIELD(touch.y, DOUBLE),
+};
 
-	return event->cancelled;
-}
+static const struct serialize_field serialize_gesture[] = {
+	SERIALIZE_FIELD(gesture.finger_count, I32),
+	SERIALIZE_FIELD(gesture.cancelled, I32),
+	SERIALIZE_FIELD(gesture.dx, DOUBLE),
+	SERIALIZE_FIELD(gesture.dy, DOUBLE),
+	SERIALIZE_FIELD(gesture.dx_unaccelerated, DOUBLE),
+	SERIALIZE_FIELD(gesture.dy_unaccelerated, DOUBLE),
+	SERIALIZE_FIELD(gesture.scale, DOUBLE),
+	SERIALIZE_FIELD(gesture.angle_delta, DOUBLE),
+};
 
-LIBINPUT_EXPORT double
-libinput_event_gesture_get_dx(struct libinput_event_gesture *event)
-{
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0.0,
-			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
-			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_PINCH_END,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
+static const struct serialize_field serialize_tablet_tool[] = {
+	SERIALIZE_FIELD(tablet_tool.serial, U64),
+	SERIALIZE_FIELD(tablet_tool.tool_id, U64),
+	SERIALIZE_FIELD(tablet_tool.tool_type, U32),
+	SERIALIZE_FIELD(tablet_tool.proximity_state, U32),
+	SERIALIZE_FIELD(tablet_tool.tip_state, U32),
+	SERIALIZE_FIELD(tablet_tool.button, U32),
+	SERIALIZE_FIELD(tablet_tool.button_state, U32),
+	SERIALIZE_FIELD(tablet_tool.seat_button_count, U32),
+	SERIALIZE_FIELD(tablet_tool.x, DOUBLE),
+	SERIALIZE_FIELD(tablet_tool.y, DOUBLE),
+	SERIALIZE_FIELD(tablet_tool.dx, DOUBLE),
+	SERIALIZE_FIELD(tablet_tool.dy, DOUBLE),
+	SERIALIZE_FIELD(tablet_tool.pressure, FLOAT),
+	SERIALIZE_FIELD(tablet_tool.distance, FLOAT),
+	SERIALIZE_FIELD(tablet_tool.tilt_x, FLOAT),
+	SERIALIZE_FIELD(tablet_tool.tilt_y, FLOAT),
+	SERIALIZE_FIELD(tablet_tool.rotation, FLOAT),
+	SERIALIZE_FIELD(tablet_tool.slider_position, FLOAT),
+	SERIALIZE_FIELD(tablet_tool.wheel_delta, FLOAT),
+};
 
-	return event->delta.x;
+static const struct serialize_field serialize_tablet_pad[] = {
+	SERIALIZE_FIELD(tablet_pad.number, U32),
+	SERIALIZE_FIELD(tablet_pad.state, U32),
+	SERIALIZE_FIELD(tablet_pad.source, U32),
+	SERIALIZE_FIELD(tablet_pad.mode, U32),
+	SERIALIZE_FIELD(tablet_pad.position, DOUBLE),
+};
+
+static const struct serialize_field serialize_switch[] = {
+	SERIALIZE_FIELD(sw.which, U32),
+	SERIALIZE_FIELD(sw.state, U32),
+};
+
+static const struct serialize_field serialize_device[] = {
+	SERIALIZE_FIELD(device.vendor, U32),
+	SERIALIZE_FIELD(device.product, U32),
+};
+
+/* Returns false for types this version doesn't know about. Device
+ * removed events have no fields */
+static bool
+serialize_fields(uint32_t type,
+		 const struct serialize_field **fields,
+		 size_t *nfields)
+{
+#define FIELDS(a_) *fields = a_; *nfields = ARRAY_LENGTH(a_); break
+
+	switch (type) {
+	case LIBINPUT_EVENT_DEVICE_ADDED:
+		FIELDS(serialize_device);
+	case LIBINPUT_EVENT_DEVICE_REMOVED:
+		*fields = NULL;
+		*nfields = 0;
+		break;
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		FIELDS(serialize_keyboard);
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+	case LIBINPUT_EVENT_POINTER_AXIS:
+	case LIBINPUT_EVENT_POINTER_FRAME:
+		FIELDS(serialize_pointer);
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+	case LIBINPUT_EVENT_TOUCH_UP:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		FIELDS(serialize_touch);
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
+	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
+	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
+	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
+		FIELDS(serialize_tablet_tool);
+	case LIBINPUT_EVENT_TABLET_PAD_BUTTON:
+	case LIBINPUT_EVENT_TABLET_PAD_RING:
+	case LIBINPUT_EVENT_TABLET_PAD_STRIP:
+	case LIBINPUT_EVENT_TABLET_PAD_KEY:
+		FIELDS(serialize_tablet_pad);
+	case LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_END:
+	case LIBINPUT_EVENT_GESTURE_PINCH_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_PINCH_END:
+		FIELDS(serialize_gesture);
+	case LIBINPUT_EVENT_SWITCH_TOGGLE:
+		FIELDS(serialize_switch);
+	default:
+		return false;
+	}
+
+#undef FIELDS
+	return true;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_gesture_get_dy(struct libinput_event_gesture *event)
+/* Without a time, the previous event's time carries over */
+static inline bool
+serialize_type_has_time(uint32_t type)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0.0,
-			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
-			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_PINCH_END,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
-
-	return event->delta.y;
+	return type != LIBINPUT_EVENT_DEVICE_ADDED &&
+	       type != LIBINPUT_EVENT_DEVICE_REMOVED;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_gesture_get_dx_unaccelerated(
-	struct libinput_event_gesture *event)
+struct serialize_buffer {
+	uint8_t *data;
+	size_t len;
+	size_t pos;
+	bool overflow;
+};
+
+static inline void
+serialize_put_byte(struct serialize_buffer *b, uint8_t byte)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0.0,
-			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
-			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_PINCH_END,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
+	if (b->pos >= b->len) {
+		b->overflow = true;
+		return;
+	}
 
-	return event->delta_unaccel.x;
+	b->data[b->pos++] = byte;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_gesture_get_dy_unaccelerated(
-	struct libinput_event_gesture *event)
+static inline void
+serialize_put_varint(struct serialize_buffer *b, uint64_t value)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0.0,
-			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
-			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_PINCH_END,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
-
-	return event->delta_unaccel.y;
+	while (value >= 0x80) {
+		serialize_put_byte(b, (value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+	serialize_put_byte(b, value);
 }
 
-LIBINPUT_EXPORT double
-libinput_event_gesture_get_scale(struct libinput_event_gesture *event)
+static inline uint64_t
+zigzag_encode(int64_t value)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0.0,
-			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
-			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_PINCH_END);
+	return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
 
-	return event->scale;
+static inline int64_t
+zigzag_decode(uint64_t value)
+{
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 0x1);
 }
 
-LIBINPUT_EXPORT double
-libinput_event_gesture_get_angle_delta(struct libinput_event_gesture *event)
+static inline int64_t
+fixed_from_double(double value)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0.0,
-			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
-			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_PINCH_END);
+	/* 2^46 leaves 16 bits fraction and the sign in an int64 */
+	const double limit = 70368744177664.0;
 
-	return event->angle;
+	if (isnan(value))
+		return 0;
+
+	return llround(max(-limit, min(limit, value)) * 65536.0);
 }
 
-LIBINPUT_EXPORT int
-libinput_event_tablet_tool_x_has_changed(
-				struct libinput_event_tablet_tool *event)
+static inline uint64_t
+serialize_field_value(const struct libinput_event_ring_record *r,
+		      const struct serialize_field *f)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	const void *p = (const char *)r + f->offset;
 
-	return bit_is_set(event->changed_axes,
-			  LIBINPUT_TABLET_TOOL_AXIS_X);
+	switch (f->kind) {
+	case SERIALIZE_U32:
+		return *(const uint32_t *)p;
+	case SERIALIZE_I32:
+		return zigzag_encode(*(const int32_t *)p);
+	case SERIALIZE_U64:
+		return *(const uint64_t *)p;
+	case SERIALIZE_DOUBLE:
+		return zigzag_encode(fixed_from_double(*(const double *)p));
+	case SERIALIZE_FLOAT:
+		return zigzag_encode(fixed_from_double(*(const float *)p));
+	}
+
+	abort();
 }
 
-LIBINPUT_EXPORT int
-libinput_event_tablet_tool_y_has_changed(
-				struct libinput_event_tablet_tool *event)
+static inline void
+serialize_put_string(struct serialize_buffer *b, const char *str)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	size_t len = strlen(str);
 
-	return bit_is_set(event->changed_axes,
-			  LIBINPUT_TABLET_TOOL_AXIS_Y);
+	serialize_put_varint(b, len);
+	for (size_t i = 0; i < len; i++)
+		serialize_put_byte(b, str[i]);
 }
 
-LIBINPUT_EXPORT int
-libinput_event_tablet_tool_pressure_has_changed(
-				struct libinput_event_tablet_tool *event)
-{
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+static void
+serialize_event(struct serialize_buffer *b,
+		struct libinput_event *event,
+		uint64_t *last_time)
+{
+	struct libinput_event_ring_record r = {0};
+	const struct serialize_field *fields;
+	uint64_t values[32];
+	size_t nfields;
+	uint32_t mask = 0;
+
+	event_ring_fill_record(&r, event);
+	if (!serialize_fields(r.type, &fields, &nfields))
+		abort();
 
-	return bit_is_set(event->changed_axes,
-			  LIBINPUT_TABLET_TOOL_AXIS_PRESSURE);
-}
+	_Static_assert(ARRAY_LENGTH(serialize_tablet_tool) <= ARRAY_LENGTH(values),
+		       "too many fields to serialize");
 
-LIBINPUT_EXPORT int
-libinput_event_tablet_tool_distance_has_changed(
-				struct libinput_event_tablet_tool *event)
-{
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	serialize_put_varint(b, r.type);
+	serialize_put_varint(b, r.device_id);
+	if (serialize_type_has_time(r.type)) {
+		serialize_put_varint(b,
+				     zigzag_encode((int64_t)(r.time_usec - *last_time)));
+		*last_time = r.time_usec;
+	}
 
-	return bit_is_set(event->changed_axes,
-			  LIBINPUT_TABLET_TOOL_AXIS_DISTANCE);
-}
+	for (size_t i = 0; i < nfields; i++) {
+		values[i] = serialize_field_value(&r, &fields[i]);
+		if (values[i] != 0)
+			mask |= bit(i);
+	}
 
-LIBINPUT_EXPORT int
-libinput_event_tablet_tool_tilt_x_has_changed(
-				struct libinput_event_tablet_tool *event)
-{
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	serialize_put_varint(b, mask);
+	for (size_t i = 0; i < nfields; i++) {
+		if (mask & bit(i))
+			serialize_put_varint(b, values[i]);
+	}
 
-	return bit_is_set(event->changed_axes,
-			  LIBINPUT_TABLET_TOOL_AXIS_TILT_X);
+	if (r.type == LIBINPUT_EVENT_DEVICE_ADDED) {
+		serialize_put_string(b, r.u.device.sysname);
+		serialize_put_string(b, r.u.device.name);
+	}
 }
 
 LIBINPUT_EXPORT int
-libinput_event_tablet_tool_tilt_y_has_changed(
-				struct libinput_event_tablet_tool *event)
-{
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+libinput_events_serialize(struct libinput_event **events,
+			  size_t nevents,
+			  void *buf,
+			  size_t len,
+			  size_t *written)
+{
+	struct serialize_buffer b = {
+		.data = buf,
+		.len = len,
+	};
+	uint64_t last_time = 0;
+	uint32_t count = 0;
+	const size_t header_size = 5;
 
-	return bit_is_set(event->changed_axes,
-			  LIBINPUT_TABLET_TOOL_AXIS_TILT_Y);
-}
+	*written = 0;
 
-LIBINPUT_EXPORT int
-libinput_event_tablet_tool_rotation_has_changed(
-				struct libinput_event_tablet_tool *event)
-{
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	if (len < header_size)
+		return -1;
 
-	return bit_is_set(event->changed_axes,
-			  LIBINPUT_TABLET_TOOL_AXIS_ROTATION_Z);
-}
+	serialize_put_byte(&b, LIBINPUT_EVENT_SERIALIZE_VERSION);
+	b.pos = header_size; /* count is filled in below */
 
-LIBINPUT_EXPORT int
-libinput_event_tablet_tool_slider_has_changed(
-				struct libinput_event_tablet_tool *event)
-{
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	for (size_t i = 0; i < nevents && count < INT_MAX; i++) {
+		size_t pos = b.pos;
+		uint64_t time = last_time;
 
-	return bit_is_set(event->changed_axes,
-			  LIBINPUT_TABLET_TOOL_AXIS_SLIDER);
-}
+		serialize_event(&b, events[i], &time);
+		if (b.overflow) {
+			b.pos = pos;
+			break;
+		}
 
-LIBINPUT_EXPORT int
-libinput_event_tablet_tool_size_major_has_changed(
-				struct libinput_event_tablet_tool *event)
-{
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+		last_time = time;
+		count++;
+	}
 
-	return bit_is_set(event->changed_axes,
-			  LIBINPUT_TABLET_TOOL_AXIS_SIZE_MAJOR);
-}
+	for (size_t i = 0; i < 4; i++)
+		b.data[1 + i] = (count >> (8 * i)) & 0xff;
 
-LIBINPUT_EXPORT int
-libinput_event_tablet_tool_size_minor_has_changed(
-				struct libinput_event_tablet_tool *event)
-{
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	*written = b.pos;
 
-	return bit_is_set(event->changed_axes,
-			  LIBINPUT_TABLET_TOOL_AXIS_SIZE_MINOR);
+	return count;
 }
 
 LIBINPUT_EXPORT int
-libinput_event_tablet_tool_wheel_has_changed(
-				struct libinput_event_tablet_tool *event)
+libinput_event_serialize(struct libinput_event *event,
+			 void *buf,
+			 size_t len)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	size_t written;
 
-	return bit_is_set(event->changed_axes,
-			  LIBINPUT_TABLET_TOOL_AXIS_REL_WHEEL);
+	if (libinput_events_serialize(&event, 1, buf, len, &written) != 1)
+		return -1;
+
+	return written;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_tablet_tool_get_x(struct libinput_event_tablet_tool *event)
+struct deserialize_buffer {
+	const uint8_t *data;
+	size_t len;
+	size_t pos;
+	bool error;
+};
+
+static inline uint64_t
+deserialize_get_varint(struct deserialize_buffer *b)
 {
-	struct evdev_device *device = evdev_device(event->base.device);
+	uint64_t value = 0;
 
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	for (unsigned int shift = 0; shift < 64; shift += 7) {
+		uint8_t byte;
 
-	return evdev_convert_to_mm(device->abs.absinfo_x,
-				   event->axes.point.x);
+		if (b->pos >= b->len)
+			break;
+
+		byte = b->data[b->pos++];
+		value |= (uint64_t)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+			return value;
+	}
+
+	b->error = true;
+	return 0;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_tablet_tool_get_y(struct libinput_event_tablet_tool *event)
+static inline void
+deserialize_get_string(struct deserialize_buffer *b,
+		       char *str,
+		       size_t size)
 {
-	struct evdev_device *device = evdev_device(event->base.device);
+	uint64_t len = deserialize_get_varint(b);
 
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	if (b->error || len > b->len - b->pos) {
+		b->error = true;
+		return;
+	}
 
-	return evdev_convert_to_mm(device->abs.absinfo_y,
-				   event->axes.point.y);
+	/* A longer string is cut off at the field size */
+	snprintf(str, size, "%.*s", (int)min(len, size - 1),
+		 (const char *)&b->data[b->pos]);
+	b->pos += len;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_tablet_tool_get_dx(struct libinput_event_tablet_tool *event)
+static inline void
+deserialize_set_field(struct libinput_event_ring_record *r,
+		      const struct serialize_field *f,
+		      uint64_t value)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	void *p = (char *)r + f->offset;
 
-	return event->axes.delta.x;
+	switch (f->kind) {
+	case SERIALIZE_U32:
+		*(uint32_t *)p = value;
+		break;
+	case SERIALIZE_I32:
+		*(int32_t *)p = zigzag_decode(value);
+		break;
+	case SERIALIZE_U64:
+		*(uint64_t *)p = value;
+		break;
+	case SERIALIZE_DOUBLE:
+		*(double *)p = zigzag_decode(value) / 65536.0;
+		break;
+	case SERIALIZE_FLOAT:
+		*(float *)p = zigzag_decode(value) / 65536.0;
+		break;
+	}
 }
 
-LIBINPUT_EXPORT double
-libinput_event_tablet_tool_get_dy(struct libinput_event_tablet_tool *event)
+static bool
+deserialize_event(struct deserialize_buffer *b,
+		  struct libinput_event_ring_record *r,
+		  uint64_t *last_time)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	const struct serialize_field *fields;
+	size_t nfields;
+	uint64_t mask;
 
-	return event->axes.delta.y;
+	memset(r, 0, sizeof(*r));
+
+	r->type = deserialize_get_varint(b);
+	r->device_id = deserialize_get_varint(b);
+	if (b->error || !serialize_fields(r->type, &fields, &nfields))
+		return false;
+
+	if (serialize_type_has_time(r->type)) {
+		*last_time += zigzag_decode(deserialize_get_varint(b));
+		r->time_usec = *last_time;
+	}
+
+	mask = deserialize_get_varint(b);
+	if (b->error || mask >= bit(nfields))
+		return false;
+
+	for (size_t i = 0; i < nfields; i++) {
+		if (mask & bit(i))
+			deserialize_set_field(r,
+					      &fields[i],
+					      deserialize_get_varint(b));
+	}
+
+	if (r->type == LIBINPUT_EVENT_DEVICE_ADDED) {
+		deserialize_get_string(b,
+				       r->u.device.sysname,
+				       sizeof(r->u.device.sysname));
+		deserialize_get_string(b,
+				       r->u.device.name,
+				       sizeof(r->u.device.name));
+	}
+
+	return !b->error;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_tablet_tool_get_pressure(struct libinput_event_tablet_tool *event)
-{
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+LIBINPUT_EXPORT int
+libinput_events_deserialize(const void *buf,
+			    size_t len,
+			    struct libinput_event_ring_record *records,
+			    size_t nrecords)
+{
+	struct deserialize_buffer b = {
+		.data = buf,
+		.len = len,
+		.pos = 5,
+	};
+	struct libinput_event_ring_record scratch;
+	uint64_t last_time = 0;
+	uint32_t count = 0;
 
-	return event->axes.pressure;
+	if (len < 5 || b.data[0] != LIBINPUT_EVENT_SERIALIZE_VERSION)
+		return -1;
+
+	for (size_t i = 0; i < 4; i++)
+		count |= (uint32_t)b.data[1 + i] << (8 * i);
+
+	if (count > INT_MAX)
+		return -1;
+
+	/* All events are decoded to validate the buffer, even the ones
+	 * the caller has no room for */
+	for (uint32_t i = 0; i < count; i++) {
+		struct libinput_event_ring_record *r =
+			i < nrecords ? &records[i] : &scratch;
+
+		if (!deserialize_event(&b, r, &last_time))
+			return -1;
+	}
+
+	if (b.pos != len)
+		return -1;
+
+	return count;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_tablet_tool_get_distance(struct libinput_event_tablet_tool *event)
+LIBINPUT_EXPORT struct libinput_event_pointer *
+libinput_event_get_pointer_event(struct libinput_event *event)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	require_event_type(libinput_event_get_context(event),
+			   event->type,
+			   NULL,
+			   LIBINPUT_EVENT_POINTER_MOTION,
+			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
+			   LIBINPUT_EVENT_POINTER_BUTTON,
+			   LIBINPUT_EVENT_POINTER_AXIS,
+			   LIBINPUT_EVENT_POINTER_FRAME);
 
-	return event->axes.distance;
+	return (struct libinput_event_pointer *) event;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_tablet_tool_get_tilt_x(struct libinput_event_tablet_tool *event)
+LIBINPUT_EXPORT struct libinput_event_keyboard *
+libinput_event_get_keyboard_event(struct libinput_event *event)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	require_event_type(libinput_event_get_context(event),
+			   event->type,
+			   NULL,
+			   LIBINPUT_EVENT_KEYBOARD_KEY);
 
-	return event->axes.tilt.x;
+	return (struct libinput_event_keyboard *) event;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_tablet_tool_get_tilt_y(struct libinput_event_tablet_tool *event)
+LIBINPUT_EXPORT struct libinput_event_touch *
+libinput_event_get_touch_event(struct libinput_event *event)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	require_event_type(libinput_event_get_context(event),
+			   event->type,
+			   NULL,
+			   LIBINPUT_EVENT_TOUCH_DOWN,
+			   LIBINPUT_EVENT_TOUCH_UP,
+			   LIBINPUT_EVENT_TOUCH_MOTION,
+			   LIBINPUT_EVENT_TOUCH_CANCEL,
+			   LIBINPUT_EVENT_TOUCH_FRAME);
+	return (struct libinput_event_touch *) event;
+}
 
-	return event->axes.tilt.y;
+LIBINPUT_EXPORT struct libinput_event_gesture *
+libinput_event_get_gesture_event(struct libinput_event *event)
+{
+	require_event_type(libinput_event_get_context(event),
+			   event->type,
+			   NULL,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_END,
+			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
+			   LIBINPUT_EVENT_GESTURE_PINCH_END);
+
+	return (struct libinput_event_gesture *) event;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_tablet_tool_get_rotation(struct libinput_event_tablet_tool *event)
+LIBINPUT_EXPORT struct libinput_event_tablet_tool *
+libinput_event_get_tablet_tool_event(struct libinput_event *event)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
+	require_event_type(libinput_event_get_context(event),
+			   event->type,
+			   NULL,
 			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY,
 			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON);
 
-	return event->axes.rotation;
+	return (struct libinput_event_tablet_tool *) event;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_tablet_tool_get_slider_position(struct libinput_event_tablet_tool *event)
+LIBINPUT_EXPORT struct libinput_event_tablet_pad *
+libinput_event_get_tablet_pad_event(struct libinput_event *event)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	require_event_type(libinput_event_get_context(event),
+			   event->type,
+			   NULL,
+			   LIBINPUT_EVENT_TABLET_PAD_RING,
+			   LIBINPUT_EVENT_TABLET_PAD_STRIP,
+			   LIBINPUT_EVENT_TABLET_PAD_BUTTON,
+			   LIBINPUT_EVENT_TABLET_PAD_KEY);
 
-	return event->axes.slider;
+	return (struct libinput_event_tablet_pad *) event;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_tablet_tool_get_size_major(struct libinput_event_tablet_tool *event)
+LIBINPUT_EXPORT struct libinput_event_device_notify *
+libinput_event_get_device_notify_event(struct libinput_event *event)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	require_event_type(libinput_event_get_context(event),
+			   event->type,
+			   NULL,
+			   LIBINPUT_EVENT_DEVICE_ADDED,
+			   LIBINPUT_EVENT_DEVICE_REMOVED);
 
-	return event->axes.size.major;
+	return (struct libinput_event_device_notify *) event;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_tablet_tool_get_size_minor(struct libinput_event_tablet_tool *event)
+LIBINPUT_EXPORT struct libinput_event_switch *
+libinput_event_get_switch_event(struct libinput_event *event)
+{
+	require_event_type(libinput_event_get_context(event),
+			   event->type,
+			   NULL,
+			   LIBINPUT_EVENT_SWITCH_TOGGLE);
+
+	return (struct libinput_event_switch *) event;
+}
+
+LIBINPUT_EXPORT uint32_t
+libinput_event_keyboard_get_time(struct libinput_event_keyboard *event)
 {
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+			   LIBINPUT_EVENT_KEYBOARD_KEY);
 
-	return event->axes.size.minor;
+	return us2ms(event->time);
 }
 
-LIBINPUT_EXPORT double
-libinput_event_tablet_tool_get_wheel_delta(struct libinput_event_tablet_tool *event)
+LIBINPUT_EXPORT uint64_t
+libinput_event_keyboard_get_time_usec(struct libinput_event_keyboard *event)
 {
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+			   LIBINPUT_EVENT_KEYBOARD_KEY);
 
-	return event->axes.wheel;
+	return event->time;
 }
 
-LIBINPUT_EXPORT int
-libinput_event_tablet_tool_get_wheel_delta_discrete(
-				      struct libinput_event_tablet_tool *event)
+LIBINPUT_EXPORT uint32_t
+libinput_event_keyboard_get_key(struct libinput_event_keyboard *event)
 {
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+			   LIBINPUT_EVENT_KEYBOARD_KEY);
 
-	return event->axes.wheel_discrete;
+	return event->key;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_tablet_tool_get_x_transformed(struct libinput_event_tablet_tool *event,
-					uint32_t width)
+LIBINPUT_EXPORT enum libinput_key_state
+libinput_event_keyboard_get_key_state(struct libinput_event_keyboard *event)
 {
-	struct evdev_device *device = evdev_device(event->base.device);
-
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+			   LIBINPUT_EVENT_KEYBOARD_KEY);
 
-	return evdev_device_transform_x(device,
-					event->axes.point.x,
-					width);
+	return event->state;
 }
 
-LIBINPUT_EXPORT double
-libinput_event_tablet_tool_get_y_transformed(struct libinput_event_tablet_tool *event,
-					uint32_t height)
+LIBINPUT_EXPORT uint32_t
+libinput_event_keyboard_get_seat_key_count(
+	struct libinput_event_keyboard *event)
 {
-	struct evdev_device *device = evdev_device(event->base.device);
-
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+			   LIBINPUT_EVENT_KEYBOARD_KEY);
 
-	return evdev_device_transform_y(device,
-					event->axes.point.y,
-					height);
+	return event->seat_key_count;
 }
 
-LIBINPUT_EXPORT struct libinput_tablet_tool *
-libinput_event_tablet_tool_get_tool(struct libinput_event_tablet_tool *event)
+LIBINPUT_EXPORT uint32_t
+libinput_event_pointer_get_time(struct libinput_event_pointer *event)
 {
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+			   LIBINPUT_EVENT_POINTER_MOTION,
+			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
+			   LIBINPUT_EVENT_POINTER_BUTTON,
+			   LIBINPUT_EVENT_POINTER_AXIS,
+			   LIBINPUT_EVENT_POINTER_FRAME);
 
-	return event->tool;
+	return us2ms(event->time);
 }
 
-LIBINPUT_EXPORT enum libinput_tablet_tool_proximity_state
-libinput_event_tablet_tool_get_proximity_state(struct libinput_event_tablet_tool *event)
+LIBINPUT_EXPORT uint64_t
+libinput_event_pointer_get_time_usec(struct libinput_event_pointer *event)
 {
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+			   LIBINPUT_EVENT_POINTER_MOTION,
+			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
+			   LIBINPUT_EVENT_POINTER_BUTTON,
+			   LIBINPUT_EVENT_POINTER_AXIS,
+			   LIBINPUT_EVENT_POINTER_FRAME);
 
-	return event->proximity_state;
+	return event->time;
 }
 
-LIBINPUT_EXPORT enum libinput_tablet_tool_tip_state
-libinput_event_tablet_tool_get_tip_state(struct libinput_event_tablet_tool *event)
+LIBINPUT_EXPORT double
+libinput_event_pointer_get_dx(struct libinput_event_pointer *event)
 {
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+			   LIBINPUT_EVENT_POINTER_MOTION,
+			   LIBINPUT_EVENT_POINTER_FRAME);
 
-	return event->tip_state;
+	return event->delta.x;
 }
 
-LIBINPUT_EXPORT uint32_t
-libinput_event_tablet_tool_get_time(struct libinput_event_tablet_tool *event)
+LIBINPUT_EXPORT double
+libinput_event_pointer_get_dy(struct libinput_event_pointer *event)
 {
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+			   LIBINPUT_EVENT_POINTER_MOTION,
+			   LIBINPUT_EVENT_POINTER_FRAME);
 
-	return us2ms(event->time);
+	return event->delta.y;
 }
 
-LIBINPUT_EXPORT uint64_t
-libinput_event_tablet_tool_get_time_usec(struct libinput_event_tablet_tool *event)
+LIBINPUT_EXPORT double
+libinput_event_pointer_get_dx_unaccelerated(
+	struct libinput_event_pointer *event)
 {
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+			   LIBINPUT_EVENT_POINTER_MOTION,
+			   LIBINPUT_EVENT_POINTER_FRAME);
 
-	return event->time;
+	return event->delta_raw.x;
 }
 
-LIBINPUT_EXPORT uint32_t
-libinput_event_tablet_tool_get_button(struct libinput_event_tablet_tool *event)
+LIBINPUT_EXPORT double
+libinput_event_pointer_get_dy_unaccelerated(
+	struct libinput_event_pointer *event)
 {
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON);
+			   LIBINPUT_EVENT_POINTER_MOTION,
+			   LIBINPUT_EVENT_POINTER_FRAME);
 
-	return event->button;
+	return event->delta_raw.y;
 }
 
-LIBINPUT_EXPORT enum libinput_button_state
-libinput_event_tablet_tool_get_button_state(struct libinput_event_tablet_tool *event)
+LIBINPUT_EXPORT double
+libinput_event_pointer_get_absolute_x(struct libinput_event_pointer *event)
 {
+	struct evdev_device *device = evdev_device(event->base.device);
+
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON);
+			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
+			   LIBINPUT_EVENT_POINTER_FRAME);
 
-	return event->state;
+	return evdev_convert_to_mm(device->abs.absinfo_x, event->absolute.x);
 }
 
-LIBINPUT_EXPORT uint32_t
-libinput_event_tablet_tool_get_seat_button_count(struct libinput_event_tablet_tool *event)
+LIBINPUT_EXPORT double
+libinput_event_pointer_get_absolute_y(struct libinput_event_pointer *event)
 {
+	struct evdev_device *device = evdev_device(event->base.device);
+
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
-			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON);
+			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
+			   LIBINPUT_EVENT_POINTER_FRAME);
 
-	return event->seat_button_count;
+	return evdev_convert_to_mm(device->abs.absinfo_y, event->absolute.y);
 }
 
-LIBINPUT_EXPORT enum libinput_tablet_tool_type
-libinput_tablet_tool_get_type(struct libinput_tablet_tool *tool)
+LIBINPUT_EXPORT double
+libinput_event_pointer_get_absolute_x_transformed(
+	struct libinput_event_pointer *event,
+	uint32_t width)
 {
-	return tool->type;
-}
+	struct evdev_device *device = evdev_device(event->base.device);
 
-LIBINPUT_EXPORT uint64_t
-libinput_tablet_tool_get_tool_id(struct libinput_tablet_tool *tool)
-{
-	return tool->tool_id;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
+			   LIBINPUT_EVENT_POINTER_FRAME);
+
+	return evdev_device_transform_x(device, event->absolute.x, width);
 }
 
-LIBINPUT_EXPORT int
-libinput_tablet_tool_is_unique(struct libinput_tablet_tool *tool)
+LIBINPUT_EXPORT double
+libinput_event_pointer_get_absolute_y_transformed(
+	struct libinput_event_pointer *event,
+	uint32_t height)
 {
-	return tool->serial != 0;
+	struct evdev_device *device = evdev_device(event->base.device);
+
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
+			   LIBINPUT_EVENT_POINTER_FRAME);
+
+	return evdev_device_transform_y(device, event->absolute.y, height);
 }
 
-LIBINPUT_EXPORT uint64_t
-libinput_tablet_tool_get_serial(struct libinput_tablet_tool *tool)
+LIBINPUT_EXPORT uint32_t
+libinput_event_pointer_get_button(struct libinput_event_pointer *event)
 {
-	return tool->serial;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_POINTER_BUTTON);
+
+	return event->button;
 }
 
-LIBINPUT_EXPORT int
-libinput_tablet_tool_has_pressure(struct libinput_tablet_tool *tool)
+LIBINPUT_EXPORT enum libinput_button_state
+libinput_event_pointer_get_button_state(struct libinput_event_pointer *event)
 {
-	return bit_is_set(tool->axis_caps,
-			  LIBINPUT_TABLET_TOOL_AXIS_PRESSURE);
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_POINTER_BUTTON);
+
+	return event->state;
 }
 
-LIBINPUT_EXPORT int
-libinput_tablet_tool_has_distance(struct libinput_tablet_tool *tool)
+LIBINPUT_EXPORT uint32_t
+libinput_event_pointer_get_seat_button_count(
+	struct libinput_event_pointer *event)
 {
-	return bit_is_set(tool->axis_caps,
-			  LIBINPUT_TABLET_TOOL_AXIS_DISTANCE);
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_POINTER_BUTTON);
+
+	return event->seat_button_count;
 }
 
 LIBINPUT_EXPORT int
-libinput_tablet_tool_has_tilt(struct libinput_tablet_tool *tool)
+libinput_event_pointer_has_axis(struct libinput_event_pointer *event,
+				enum libinput_pointer_axis axis)
 {
-	return bit_is_set(tool->axis_caps,
-			  LIBINPUT_TABLET_TOOL_AXIS_TILT_X);
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_POINTER_AXIS,
+			   LIBINPUT_EVENT_POINTER_FRAME);
+
+	switch (axis) {
+	case LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL:
+	case LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL:
+		return !!(event->axes & bit(axis));
+	}
+
+	return 0;
 }
 
-LIBINPUT_EXPORT int
-libinput_tablet_tool_has_rotation(struct libinput_tablet_tool *tool)
+LIBINPUT_EXPORT double
+libinput_event_pointer_get_axis_value(struct libinput_event_pointer *event,
+				      enum libinput_pointer_axis axis)
 {
-	return bit_is_set(tool->axis_caps,
-			  LIBINPUT_TABLET_TOOL_AXIS_ROTATION_Z);
+	struct libinput *libinput = event->base.device->seat->libinput;
+	double value = 0;
+
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0.0,
+			   LIBINPUT_EVENT_POINTER_AXIS,
+			   LIBINPUT_EVENT_POINTER_FRAME);
+
+	if (!libinput_event_pointer_has_axis(event, axis)) {
+		log_bug_client(libinput, "value requested for unset axis\n");
+	} else {
+		const struct normalized_coords *delta = &event->delta;
+
+		if (event->frame)
+			delta = &event->frame->axis_value;
+
+		switch (axis) {
+		case LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL:
+			value = delta->x;
+			break;
+		case LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL:
+			value = delta->y;
+			break;
+		}
+	}
+
+	return value;
 }
 
-LIBINPUT_EXPORT int
-libinput_tablet_tool_has_slider(struct libinput_tablet_tool *tool)
+LIBINPUT_EXPORT double
+libinput_event_pointer_get_axis_value_discrete(struct libinput_event_pointer *event,
+					       enum libinput_pointer_axis axis)
 {
-	return bit_is_set(tool->axis_caps,
-			  LIBINPUT_TABLET_TOOL_AXIS_SLIDER);
+	struct libinput *libinput = event->base.device->seat->libinput;
+	double value = 0;
+
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0.0,
+			   LIBINPUT_EVENT_POINTER_AXIS,
+			   LIBINPUT_EVENT_POINTER_FRAME);
+
+	if (!libinput_event_pointer_has_axis(event, axis)) {
+		log_bug_client(libinput, "value requested for unset axis\n");
+	} else {
+		switch (axis) {
+		case LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL:
+			value = event->discrete.x;
+			break;
+		case LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL:
+			value = event->discrete.y;
+			break;
+		}
+	}
+	return value;
 }
 
-LIBINPUT_EXPORT int
-libinput_tablet_tool_has_wheel(struct libinput_tablet_tool *tool)
+LIBINPUT_EXPORT enum libinput_pointer_axis_source
+libinput_event_pointer_get_axis_source(struct libinput_event_pointer *event)
 {
-	return bit_is_set(tool->axis_caps,
-			  LIBINPUT_TABLET_TOOL_AXIS_REL_WHEEL);
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_POINTER_AXIS,
+			   LIBINPUT_EVENT_POINTER_FRAME);
+
+	return event->source;
 }
 
-LIBINPUT_EXPORT int
-libinput_tablet_tool_has_size(struct libinput_tablet_tool *tool)
+LIBINPUT_EXPORT enum libinput_event_type
+libinput_event_pointer_get_frame_motion_type(struct libinput_event_pointer *event)
 {
-	return bit_is_set(tool->axis_caps,
-			  LIBINPUT_TABLET_TOOL_AXIS_SIZE_MAJOR);
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   LIBINPUT_EVENT_NONE,
+			   LIBINPUT_EVENT_POINTER_FRAME);
+
+	return event->frame->motion_type;
 }
 
-LIBINPUT_EXPORT int
-libinput_tablet_tool_has_button(struct libinput_tablet_tool *tool,
-				uint32_t code)
+static const struct pointer_frame_button *
+pointer_get_frame_button(struct libinput_event_pointer *event,
+			 size_t index)
 {
-	if (NCHARS(code) > sizeof(tool->buttons))
-		return 0;
+	struct libinput *libinput = libinput_event_get_context(&event->base);
 
-	return bit_is_set(tool->buttons, code);
+	require_event_type(libinput,
+			   event->base.type,
+			   NULL,
+			   LIBINPUT_EVENT_POINTER_FRAME);
+
+	if (index >= event->frame->nbuttons) {
+		log_bug_client(libinput,
+			       "Invalid button index %zu, frame has %u buttons\n",
+			       index,
+			       event->frame->nbuttons);
+		return NULL;
+	}
+
+	return &event->frame->buttons[index];
 }
 
-LIBINPUT_EXPORT void
-libinput_tablet_tool_set_user_data(struct libinput_tablet_tool *tool,
-				   void *user_data)
+LIBINPUT_EXPORT size_t
+libinput_event_pointer_get_frame_button_count(struct libinput_event_pointer *event)
 {
-	tool->user_data = user_data;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_POINTER_FRAME);
+
+	return event->frame->nbuttons;
 }
 
-LIBINPUT_EXPORT void *
-libinput_tablet_tool_get_user_data(struct libinput_tablet_tool *tool)
+LIBINPUT_EXPORT uint32_t
+libinput_event_pointer_get_frame_button(struct libinput_event_pointer *event,
+					size_t index)
 {
-	return tool->user_data;
+	const struct pointer_frame_button *b;
+
+	b = pointer_get_frame_button(event, index);
+
+	return b ? b->button : 0;
 }
 
-LIBINPUT_EXPORT struct libinput_tablet_tool *
-libinput_tablet_tool_ref(struct libinput_tablet_tool *tool)
+LIBINPUT_EXPORT enum libinput_button_state
+libinput_event_pointer_get_frame_button_state(struct libinput_event_pointer *event,
+					      size_t index)
 {
-	tool->refcount++;
-	return tool;
+	const struct pointer_frame_button *b;
+
+	b = pointer_get_frame_button(event, index);
+
+	return b ? b->state : LIBINPUT_BUTTON_STATE_RELEASED;
 }
 
-LIBINPUT_EXPORT struct libinput_tablet_tool *
-libinput_tablet_tool_unref(struct libinput_tablet_tool *tool)
+LIBINPUT_EXPORT uint32_t
+libinput_event_pointer_get_frame_seat_button_count(struct libinput_event_pointer *event,
+						   size_t index)
 {
-	assert(tool->refcount > 0);
+	const struct pointer_frame_button *b;
 
-	tool->refcount--;
-	if (tool->refcount > 0)
-		return tool;
+	b = pointer_get_frame_button(event, index);
 
-	list_remove(&tool->link);
-	free(tool);
-	return NULL;
+	return b ? b->seat_button_count : 0;
 }
 
-LIBINPUT_EXPORT struct libinput_event *
-libinput_event_switch_get_base_event(struct libinput_event_switch *event)
+LIBINPUT_EXPORT size_t
+libinput_event_pointer_get_source_count(struct libinput_event_pointer *event)
 {
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
-			   NULL,
-			   LIBINPUT_EVENT_SWITCH_TOGGLE);
+			   0,
+			   LIBINPUT_EVENT_POINTER_MOTION);
 
-	return &event->base;
+	return event->sources ? event->sources->count : 1;
 }
 
-LIBINPUT_EXPORT enum libinput_switch
-libinput_event_switch_get_switch(struct libinput_event_switch *event)
+static bool
+pointer_check_source_index(struct libinput_event_pointer *event,
+			   size_t index)
 {
-	require_event_type(libinput_event_get_context(&event->base),
+	struct libinput *libinput = libinput_event_get_context(&event->base);
+	size_t count;
+
+	require_event_type(libinput,
 			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_SWITCH_TOGGLE);
+			   false,
+			   LIBINPUT_EVENT_POINTER_MOTION);
 
-	return event->sw;
+	count = event->sources ? event->sources->count : 1;
+	if (index >= count) {
+		log_bug_client(libinput,
+			       "Invalid source index %zu, event has %zu sources\n",
+			       index,
+			       count);
+		return false;
+	}
+
+	return true;
 }
 
-LIBINPUT_EXPORT enum libinput_switch_state
-libinput_event_switch_get_switch_state(struct libinput_event_switch *event)
+LIBINPUT_EXPORT struct libinput_device *
+libinput_event_pointer_get_source_device(struct libinput_event_pointer *event,
+					 size_t index)
 {
-	require_event_type(libinput_event_get_context(&event->base),
-			   event->base.type,
-			   0,
-			   LIBINPUT_EVENT_SWITCH_TOGGLE);
+	if (!pointer_check_source_index(event, index))
+		return NULL;
 
-	return event->state;
+	if (!event->sources)
+		return event->base.device;
+
+	return event->sources->sources[index].device;
+}
+
+LIBINPUT_EXPORT double
+libinput_event_pointer_get_source_dx(struct libinput_event_pointer *event,
+				     size_t index)
+{
+	if (!pointer_check_source_index(event, index))
+		return 0.0;
+
+	if (!event->sources)
+		return event->delta.x;
+
+	return event->sources->sources[index].delta.x;
+}
+
+LIBINPUT_EXPORT double
+libinput_event_pointer_get_source_dy(struct libinput_event_pointer *event,
+				     size_t index)
+{
+	if (!pointer_check_source_index(event, index))
+		return 0.0;
+
+	if (!event->sources)
+		return event->delta.y;
+
+	return event->sources->sources[index].delta.y;
 }
 
 LIBINPUT_EXPORT uint32_t
-libinput_event_switch_get_time(struct libinput_event_switch *event)
+libinput_event_touch_get_time(struct libinput_event_touch *event)
 {
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
-			   LIBINPUT_EVENT_SWITCH_TOGGLE);
+			   LIBINPUT_EVENT_TOUCH_DOWN,
+			   LIBINPUT_EVENT_TOUCH_UP,
+			   LIBINPUT_EVENT_TOUCH_MOTION,
+			   LIBINPUT_EVENT_TOUCH_CANCEL,
+			   LIBINPUT_EVENT_TOUCH_FRAME);
 
 	return us2ms(event->time);
 }
 
 LIBINPUT_EXPORT uint64_t
-libinput_event_switch_get_time_usec(struct libinput_event_switch *event)
+libinput_event_touch_get_time_usec(struct libinput_event_touch *event)
 {
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
-			   LIBINPUT_EVENT_SWITCH_TOGGLE);
+			   LIBINPUT_EVENT_TOUCH_DOWN,
+			   LIBINPUT_EVENT_TOUCH_UP,
+			   LIBINPUT_EVENT_TOUCH_MOTION,
+			   LIBINPUT_EVENT_TOUCH_CANCEL,
+			   LIBINPUT_EVENT_TOUCH_FRAME);
 
 	return event->time;
 }
 
-struct libinput_source *
-libinput_add_fd(struct libinput *libinput,
-		int fd,
-		libinput_source_dispatch_t dispatch,
-		void *user_data)
+LIBINPUT_EXPORT int32_t
+libinput_event_touch_get_slot(struct libinput_event_touch *event)
 {
-	struct libinput_source *source;
-	struct epoll_event ep;
-
-	source = zalloc(sizeof *source);
-	source->dispatch = dispatch;
-	source->user_data = user_data;
-	source->fd = fd;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TOUCH_DOWN,
+			   LIBINPUT_EVENT_TOUCH_UP,
+			   LIBINPUT_EVENT_TOUCH_MOTION,
+			   LIBINPUT_EVENT_TOUCH_CANCEL);
 
-	memset(&ep, 0, sizeof ep);
-	ep.events = EPOLLIN;
-	ep.data.ptr = source;
+	return event->slot;
+}
 
-	if (epoll_ctl(libinput->epoll_fd, EPOLL_CTL_ADD, fd, &ep) < 0) {
-		free(source);
-		return NULL;
-	}
+LIBINPUT_EXPORT int32_t
+libinput_event_touch_get_seat_slot(struct libinput_event_touch *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TOUCH_DOWN,
+			   LIBINPUT_EVENT_TOUCH_UP,
+			   LIBINPUT_EVENT_TOUCH_MOTION,
+			   LIBINPUT_EVENT_TOUCH_CANCEL);
 
-	return source;
+	return event->seat_slot;
 }
 
-void
-libinput_remove_source(struct libinput *libinput,
-		       struct libinput_source *source)
+LIBINPUT_EXPORT double
+libinput_event_touch_get_x(struct libinput_event_touch *event)
 {
-	epoll_ctl(libinput->epoll_fd, EPOLL_CTL_DEL, source->fd, NULL);
-	source->fd = -1;
-	list_insert(&libinput->source_destroy_list, &source->link);
+	struct evdev_device *device = evdev_device(event->base.device);
+
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TOUCH_DOWN,
+			   LIBINPUT_EVENT_TOUCH_MOTION);
+
+	return evdev_convert_to_mm(device->abs.absinfo_x, event->point.x);
 }
 
-int
-libinput_init(struct libinput *libinput,
-	      const struct libinput_interface *interface,
-	      const struct libinput_interface_backend *interface_backend,
-	      void *user_data)
+LIBINPUT_EXPORT double
+libinput_event_touch_get_x_transformed(struct libinput_event_touch *event,
+				       uint32_t width)
 {
-	assert(interface->open_restricted != NULL);
-	assert(interface->close_restricted != NULL);
+	struct evdev_device *device = evdev_device(event->base.device);
 
-	libinput->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
-	if (libinput->epoll_fd < 0)
-		return -1;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TOUCH_DOWN,
+			   LIBINPUT_EVENT_TOUCH_MOTION);
 
-	libinput->events_len = 4;
-	libinput->events = zalloc(libinput->events_len * sizeof(*libinput->events));
-	libinput->log_handler = libinput_default_log_func;
-	libinput->log_priority = LIBINPUT_LOG_PRIORITY_ERROR;
-	libinput->interface = interface;
-	libinput->interface_backend = interface_backend;
-	libinput->user_data = user_data;
-	libinput->refcount = 1;
-	list_init(&libinput->source_destroy_list);
-	list_init(&libinput->seat_list);
-	list_init(&libinput->device_group_list);
-	list_init(&libinput->tool_list);
+	return output_coords_get_x(device,
+				   &event->output,
+				   event->point.x,
+				   width);
+}
 
-	if (libinput_timer_subsys_init(libinput) != 0) {
-		free(libinput->events);
-		close(libinput->epoll_fd);
-		return -1;
-	}
+LIBINPUT_EXPORT double
+libinput_event_touch_get_y_transformed(struct libinput_event_touch *event,
+				       uint32_t height)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
 
-	return 0;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TOUCH_DOWN,
+			   LIBINPUT_EVENT_TOUCH_MOTION);
+
+	return output_coords_get_y(device,
+				   &event->output,
+				   event->point.y,
+				   height);
 }
 
-void
-libinput_init_quirks(struct libinput *libinput)
+LIBINPUT_EXPORT double
+libinput_event_touch_get_y(struct libinput_event_touch *event)
 {
-	const char *data_path,
-	           *override_file = NULL;
-	struct quirks_context *quirks;
+	struct evdev_device *device = evdev_device(event->base.device);
 
-	if (libinput->quirks_initialized)
-		return;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TOUCH_DOWN,
+			   LIBINPUT_EVENT_TOUCH_MOTION);
 
-	/* If we fail, we'll fail next time too */
-	libinput->quirks_initialized = true;
+	return evdev_convert_to_mm(device->abs.absinfo_y, event->point.y);
+}
 
-	data_path = getenv("LIBINPUT_QUIRKS_DIR");
-	if (!data_path) {
-		data_path = LIBINPUT_QUIRKS_DIR;
-		override_file = LIBINPUT_QUIRKS_OVERRIDE_FILE;
-	}
+static const struct touch_frame_point *
+touch_get_frame_point(struct libinput_event_touch *event,
+		      size_t index)
+{
+	struct libinput *libinput = libinput_event_get_context(&event->base);
 
-	quirks = quirks_init_subsystem(data_path,
-				       override_file,
-				       log_msg_va,
-				       libinput,
-				       QLOG_LIBINPUT_LOGGING);
-	if (!quirks) {
-		log_error(libinput,
-			  "Failed to load the device quirks from %s%s%s. "
-			  "This will negatively affect device behavior. "
-			  "See %sdevice-quirks.html for details.\n",
-			  data_path,
-			  override_file ? " and " : "",
-			  override_file ? override_file : "",
-			  HTTP_DOC_LINK
-			  );
-		return;
+	require_event_type(libinput,
+			   event->base.type,
+			   NULL,
+			   LIBINPUT_EVENT_TOUCH_FRAME);
+
+	if (!event->frame || index >= event->frame->count) {
+		log_bug_client(libinput,
+			       "Invalid touch index %zu, frame has %u touches\n",
+			       index,
+			       event->frame ? event->frame->count : 0);
+		return NULL;
 	}
 
-	libinput->quirks = quirks;
+	return &event->frame->points[index];
 }
 
-static void
-libinput_device_destroy(struct libinput_device *device);
+LIBINPUT_EXPORT size_t
+libinput_event_touch_get_frame_touch_count(struct libinput_event_touch *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TOUCH_FRAME);
 
-static void
-libinput_seat_destroy(struct libinput_seat *seat);
+	return event->frame ? event->frame->count : 0;
+}
 
-static void
-libinput_drop_destroyed_sources(struct libinput *libinput)
+LIBINPUT_EXPORT enum libinput_event_type
+libinput_event_touch_get_frame_touch_type(struct libinput_event_touch *event,
+					  size_t index)
 {
-	struct libinput_source *source, *next;
+	const struct touch_frame_point *p;
 
-	list_for_each_safe(source, next, &libinput->source_destroy_list, link)
-		free(source);
-	list_init(&libinput->source_destroy_list);
+	p = touch_get_frame_point(event, index);
+
+	return p ? p->type : LIBINPUT_EVENT_NONE;
 }
 
-LIBINPUT_EXPORT struct libinput *
-libinput_ref(struct libinput *libinput)
+LIBINPUT_EXPORT int32_t
+libinput_event_touch_get_frame_touch_slot(struct libinput_event_touch *event,
+					  size_t index)
 {
-	libinput->refcount++;
-	return libinput;
+	const struct touch_frame_point *p;
+
+	p = touch_get_frame_point(event, index);
+
+	return p ? p->slot : 0;
 }
 
-LIBINPUT_EXPORT struct libinput *
-libinput_unref(struct libinput *libinput)
+LIBINPUT_EXPORT int32_t
+libinput_event_touch_get_frame_touch_seat_slot(struct libinput_event_touch *event,
+					       size_t index)
 {
-	struct libinput_event *event;
-	struct libinput_device *device, *next_device;
-	struct libinput_seat *seat, *next_seat;
-	struct libinput_tablet_tool *tool, *next_tool;
-	struct libinput_device_group *group, *next_group;
-
-	if (libinput == NULL)
-		return NULL;
+	const struct touch_frame_point *p;
 
-	assert(libinput->refcount > 0);
-	libinput->refcount--;
-	if (libinput->refcount > 0)
-		return libinput;
+	p = touch_get_frame_point(event, index);
 
-	libinput_suspend(libinput);
+	return p ? p->seat_slot : 0;
+}
 
-	libinput->interface_backend->destroy(libinput);
+LIBINPUT_EXPORT double
+libinput_event_touch_get_frame_touch_x(struct libinput_event_touch *event,
+				       size_t index)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
+	const struct touch_frame_point *p;
 
-	while ((event = libinput_get_event(libinput)))
-	       libinput_event_destroy(event);
+	p = touch_get_frame_point(event, index);
+	if (!p)
+		return 0;
 
-	free(libinput->events);
+	return evdev_convert_to_mm(device->abs.absinfo_x, p->point.x);
+}
 
-	list_for_each_safe(seat, next_seat, &libinput->seat_list, link) {
-		list_for_each_safe(device, next_device,
-				   &seat->devices_list,
-				   link)
-			libinput_device_destroy(device);
+LIBINPUT_EXPORT double
+libinput_event_touch_get_frame_touch_y(struct libinput_event_touch *event,
+				       size_t index)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
+	const struct touch_frame_point *p;
 
-		libinput_seat_destroy(seat);
-	}
+	p = touch_get_frame_point(event, index);
+	if (!p)
+		return 0;
 
-	list_for_each_safe(group,
-			   next_group,
-			   &libinput->device_group_list,
-			   link) {
-		libinput_device_group_destroy(group);
-	}
+	return evdev_convert_to_mm(device->abs.absinfo_y, p->point.y);
+}
 
-	list_for_each_safe(tool, next_tool, &libinput->tool_list, link) {
-		libinput_tablet_tool_unref(tool);
-	}
+LIBINPUT_EXPORT double
+libinput_event_touch_get_frame_touch_x_transformed(struct libinput_event_touch *event,
+						   size_t index,
+						   uint32_t width)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
+	const struct touch_frame_point *p;
 
-	libinput_timer_subsys_destroy(libinput);
-	libinput_drop_destroyed_sources(libinput);
-	quirks_context_unref(libinput->quirks);
-	close(libinput->epoll_fd);
-	free(libinput);
+	p = touch_get_frame_point(event, index);
+	if (!p)
+		return 0;
 
-	return NULL;
+	return evdev_device_transform_x(device, p->point.x, width);
 }
 
-static void
-libinput_event_tablet_tool_destroy(struct libinput_event_tablet_tool *event)
+LIBINPUT_EXPORT double
+libinput_event_touch_get_frame_touch_y_transformed(struct libinput_event_touch *event,
+						   size_t index,
+						   uint32_t height)
 {
-	libinput_tablet_tool_unref(event->tool);
+	struct evdev_device *device = evdev_device(event->base.device);
+	const struct touch_frame_point *p;
+
+	p = touch_get_frame_point(event, index);
+	if (!p)
+		return 0;
+
+	return evdev_device_transform_y(device, p->point.y, height);
 }
 
-static void
-libinput_event_tablet_pad_destroy(struct libinput_event_tablet_pad *event)
+LIBINPUT_EXPORT uint32_t
+libinput_event_gesture_get_time(struct libinput_event_gesture *event)
 {
-	if (event->base.type != LIBINPUT_EVENT_TABLET_PAD_KEY)
-		libinput_tablet_pad_mode_group_unref(event->mode_group);
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
+			   LIBINPUT_EVENT_GESTURE_PINCH_END,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
+
+	return us2ms(event->time);
 }
 
-LIBINPUT_EXPORT void
-libinput_event_destroy(struct libinput_event *event)
+LIBINPUT_EXPORT uint64_t
+libinput_event_gesture_get_time_usec(struct libinput_event_gesture *event)
 {
-	if (event == NULL)
-		return;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
+			   LIBINPUT_EVENT_GESTURE_PINCH_END,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
 
-	switch(event->type) {
-	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
-	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
-	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
-	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
-		libinput_event_tablet_tool_destroy(
-		   libinput_event_get_tablet_tool_event(event));
-		break;
-	case LIBINPUT_EVENT_TABLET_PAD_RING:
-	case LIBINPUT_EVENT_TABLET_PAD_STRIP:
-	case LIBINPUT_EVENT_TABLET_PAD_BUTTON:
-	case LIBINPUT_EVENT_TABLET_PAD_KEY:
-		libinput_event_tablet_pad_destroy(
-		   libinput_event_get_tablet_pad_event(event));
-		break;
-	default:
-		break;
-	}
-
-	if (event->device)
-		libinput_device_unref(event->device);
-
-	free(event);
+	return event->time;
 }
 
-int
-open_restricted(struct libinput *libinput,
-		const char *path, int flags)
+LIBINPUT_EXPORT int
+libinput_event_gesture_get_finger_count(struct libinput_event_gesture *event)
 {
-	return libinput->interface->open_restricted(path,
-						    flags,
-						    libinput->user_data);
-}
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
+			   LIBINPUT_EVENT_GESTURE_PINCH_END,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
 
-void
-close_restricted(struct libinput *libinput, int fd)
-{
-	libinput->interface->close_restricted(fd, libinput->user_data);
+	return event->finger_count;
 }
 
-bool
-ignore_litest_test_suite_device(struct udev_device *device)
+LIBINPUT_EXPORT int
+libinput_event_gesture_get_cancelled(struct libinput_event_gesture *event)
 {
-	if (!getenv("LIBINPUT_RUNNING_TEST_SUITE") &&
-	    udev_device_get_property_value(device, "LIBINPUT_TEST_DEVICE"))
-		return true;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_GESTURE_PINCH_END,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
 
-	return false;
+	return event->cancelled;
 }
 
-void
-libinput_seat_init(struct libinput_seat *seat,
-		   struct libinput *libinput,
-		   const char *physical_name,
-		   const char *logical_name,
-		   libinput_seat_destroy_func destroy)
+LIBINPUT_EXPORT double
+libinput_event_gesture_get_dx(struct libinput_event_gesture *event)
 {
-	seat->refcount = 1;
-	seat->libinput = libinput;
-	seat->physical_name = safe_strdup(physical_name);
-	seat->logical_name = safe_strdup(logical_name);
-	seat->destroy = destroy;
-	list_init(&seat->devices_list);
-	list_insert(&libinput->seat_list, &seat->link);
-}
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0.0,
+			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
+			   LIBINPUT_EVENT_GESTURE_PINCH_END,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
 
-LIBINPUT_EXPORT struct libinput_seat *
-libinput_seat_ref(struct libinput_seat *seat)
-{
-	seat->refcount++;
-	return seat;
+	return event->delta.x;
 }
 
-static void
-libinput_seat_destroy(struct libinput_seat *seat)
+LIBINPUT_EXPORT double
+libinput_event_gesture_get_dy(struct libinput_event_gesture *event)
 {
-	list_remove(&seat->link);
-	free(seat->logical_name);
-	free(seat->physical_name);
-	seat->destroy(seat);
-}
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0.0,
+			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
+			   LIBINPUT_EVENT_GESTURE_PINCH_END,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
 
-LIBINPUT_EXPORT struct libinput_seat *
-libinput_seat_unref(struct libinput_seat *seat)
-{
-	assert(seat->refcount > 0);
-	seat->refcount--;
-	if (seat->refcount == 0) {
-		libinput_seat_destroy(seat);
-		return NULL;
-	} else {
-		return seat;
-	}
+	return event->delta.y;
 }
 
-LIBINPUT_EXPORT void
-libinput_seat_set_user_data(struct libinput_seat *seat, void *user_data)
+LIBINPUT_EXPORT double
+libinput_event_gesture_get_dx_unaccelerated(
+	struct libinput_event_gesture *event)
 {
-	seat->user_data = user_data;
-}
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0.0,
+			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
+			   LIBINPUT_EVENT_GESTURE_PINCH_END,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
 
-LIBINPUT_EXPORT void *
-libinput_seat_get_user_data(struct libinput_seat *seat)
-{
-	return seat->user_data;
+	return event->delta_unaccel.x;
 }
 
-LIBINPUT_EXPORT struct libinput *
-libinput_seat_get_context(struct libinput_seat *seat)
+LIBINPUT_EXPORT double
+libinput_event_gesture_get_dy_unaccelerated(
+	struct libinput_event_gesture *event)
 {
-	return seat->libinput;
-}
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0.0,
+			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
+			   LIBINPUT_EVENT_GESTURE_PINCH_END,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
+			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
 
-LIBINPUT_EXPORT const char *
-libinput_seat_get_physical_name(struct libinput_seat *seat)
-{
-	return seat->physical_name;
+	return event->delta_unaccel.y;
 }
 
-LIBINPUT_EXPORT const char *
-libinput_seat_get_logical_name(struct libinput_seat *seat)
+LIBINPUT_EXPORT double
+libinput_event_gesture_get_scale(struct libinput_event_gesture *event)
 {
-	return seat->logical_name;
-}
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0.0,
+			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
+			   LIBINPUT_EVENT_GESTURE_PINCH_END);
 
-void
-libinput_device_init(struct libinput_device *device,
-		     struct libinput_seat *seat)
-{
-	device->seat = seat;
-	device->refcount = 1;
-	list_init(&device->event_listeners);
+	return event->scale;
 }
 
-LIBINPUT_EXPORT struct libinput_device *
-libinput_device_ref(struct libinput_device *device)
+LIBINPUT_EXPORT double
+libinput_event_gesture_get_angle_delta(struct libinput_event_gesture *event)
 {
-	device->refcount++;
-	return device;
-}
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0.0,
+			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
+			   LIBINPUT_EVENT_GESTURE_PINCH_END);
 
-static void
-libinput_device_destroy(struct libinput_device *device)
-{
-	assert(list_empty(&device->event_listeners));
-	evdev_device_destroy(evdev_device(device));
+	return event->angle;
 }
 
-LIBINPUT_EXPORT struct libinput_device *
-libinput_device_unref(struct libinput_device *device)
+LIBINPUT_EXPORT int
+libinput_event_tablet_tool_x_has_changed(
+				struct libinput_event_tablet_tool *event)
 {
-	assert(device->refcount > 0);
-	device->refcount--;
-	if (device->refcount == 0) {
-		libinput_device_destroy(device);
-		return NULL;
-	} else {
-		return device;
-	}
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return bit_is_set(event->changed_axes,
+			  LIBINPUT_TABLET_TOOL_AXIS_X);
 }
 
 LIBINPUT_EXPORT int
-libinput_get_fd(struct libinput *libinput)
+libinput_event_tablet_tool_y_has_changed(
+				struct libinput_event_tablet_tool *event)
 {
-	return libinput->epoll_fd;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return bit_is_set(event->changed_axes,
+			  LIBINPUT_TABLET_TOOL_AXIS_Y);
 }
 
 LIBINPUT_EXPORT int
-libinput_dispatch(struct libinput *libinput)
+libinput_event_tablet_tool_pressure_has_changed(
+				struct libinput_event_tablet_tool *event)
 {
-	struct libinput_source *source;
-	struct epoll_event ep[32];
-	int i, count;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
 
-	count = epoll_wait(libinput->epoll_fd, ep, ARRAY_LENGTH(ep), 0);
-	if (count < 0)
-		return -errno;
+	return bit_is_set(event->changed_axes,
+			  LIBINPUT_TABLET_TOOL_AXIS_PRESSURE);
+}
+
+LIBINPUT_EXPORT int
+libinput_event_tablet_tool_distance_has_changed(
+				struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return bit_is_set(event->changed_axes,
+			  LIBINPUT_TABLET_TOOL_AXIS_DISTANCE);
+}
+
+LIBINPUT_EXPORT int
+libinput_event_tablet_tool_tilt_x_has_changed(
+				struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return bit_is_set(event->changed_axes,
+			  LIBINPUT_TABLET_TOOL_AXIS_TILT_X);
+}
+
+LIBINPUT_EXPORT int
+libinput_event_tablet_tool_tilt_y_has_changed(
+				struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return bit_is_set(event->changed_axes,
+			  LIBINPUT_TABLET_TOOL_AXIS_TILT_Y);
+}
+
+LIBINPUT_EXPORT int
+libinput_event_tablet_tool_rotation_has_changed(
+				struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return bit_is_set(event->changed_axes,
+			  LIBINPUT_TABLET_TOOL_AXIS_ROTATION_Z);
+}
+
+LIBINPUT_EXPORT int
+libinput_event_tablet_tool_slider_has_changed(
+				struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return bit_is_set(event->changed_axes,
+			  LIBINPUT_TABLET_TOOL_AXIS_SLIDER);
+}
+
+LIBINPUT_EXPORT int
+libinput_event_tablet_tool_size_major_has_changed(
+				struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return bit_is_set(event->changed_axes,
+			  LIBINPUT_TABLET_TOOL_AXIS_SIZE_MAJOR);
+}
+
+LIBINPUT_EXPORT int
+libinput_event_tablet_tool_size_minor_has_changed(
+				struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return bit_is_set(event->changed_axes,
+			  LIBINPUT_TABLET_TOOL_AXIS_SIZE_MINOR);
+}
+
+LIBINPUT_EXPORT int
+libinput_event_tablet_tool_wheel_has_changed(
+				struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return bit_is_set(event->changed_axes,
+			  LIBINPUT_TABLET_TOOL_AXIS_REL_WHEEL);
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_x(struct libinput_event_tablet_tool *event)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
+
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return evdev_convert_to_mm(device->abs.absinfo_x,
+				   event->axes.point.x);
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_y(struct libinput_event_tablet_tool *event)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
+
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return evdev_convert_to_mm(device->abs.absinfo_y,
+				   event->axes.point.y);
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_dx(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return event->axes.delta.x;
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_dy(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return event->axes.delta.y;
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_pressure(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return event->axes.pressure;
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_distance(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return event->axes.distance;
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_tilt_x(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return event->axes.tilt.x;
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_tilt_y(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return event->axes.tilt.y;
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_rotation(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return tablet_axes_get_rotation(&event->axes);
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_slider_position(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return event->axes.slider;
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_size_major(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return event->axes.size.major;
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_size_minor(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return event->axes.size.minor;
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_wheel_delta(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return event->axes.wheel;
+}
+
+LIBINPUT_EXPORT int
+libinput_event_tablet_tool_get_wheel_delta_discrete(
+				      struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return event->axes.wheel_discrete;
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_x_transformed(struct libinput_event_tablet_tool *event,
+					uint32_t width)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
+
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return output_coords_get_x(device,
+				   &event->output,
+				   event->axes.point.x,
+				   width);
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_y_transformed(struct libinput_event_tablet_tool *event,
+					uint32_t height)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
+
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return output_coords_get_y(device,
+				   &event->output,
+				   event->axes.point.y,
+				   height);
+}
+
+static const struct tablet_tool_sample *
+tablet_tool_get_historical_sample(struct libinput_event_tablet_tool *event,
+				  size_t index)
+{
+	struct libinput *libinput = libinput_event_get_context(&event->base);
+
+	require_event_type(libinput,
+			   event->base.type,
+			   NULL,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS);
+
+	if (!event->history || index >= event->history->count) {
+		log_bug_client(libinput,
+			       "Invalid history index %zu, event has %u samples\n",
+			       index,
+			       event->history ? event->history->count : 0);
+		return NULL;
+	}
+
+	return &event->history->samples[index];
+}
+
+LIBINPUT_EXPORT size_t
+libinput_event_tablet_tool_get_history_size(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return event->history ? event->history->count : 0;
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_event_tablet_tool_get_historical_time_usec(struct libinput_event_tablet_tool *event,
+						    size_t index)
+{
+	const struct tablet_tool_sample *sample;
+
+	sample = tablet_tool_get_historical_sample(event, index);
+
+	return sample ? sample->time : 0;
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_historical_x(struct libinput_event_tablet_tool *event,
+					    size_t index)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
+	const struct tablet_tool_sample *sample;
+
+	sample = tablet_tool_get_historical_sample(event, index);
+	if (!sample)
+		return 0;
+
+	return evdev_convert_to_mm(device->abs.absinfo_x, sample->point.x);
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_historical_y(struct libinput_event_tablet_tool *event,
+					    size_t index)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
+	const struct tablet_tool_sample *sample;
+
+	sample = tablet_tool_get_historical_sample(event, index);
+	if (!sample)
+		return 0;
+
+	return evdev_convert_to_mm(device->abs.absinfo_y, sample->point.y);
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_historical_x_transformed(struct libinput_event_tablet_tool *event,
+							size_t index,
+							uint32_t width)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
+	const struct tablet_tool_sample *sample;
+
+	sample = tablet_tool_get_historical_sample(event, index);
+	if (!sample)
+		return 0;
+
+	return evdev_device_transform_x(device, sample->point.x, width);
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_historical_y_transformed(struct libinput_event_tablet_tool *event,
+							size_t index,
+							uint32_t height)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
+	const struct tablet_tool_sample *sample;
+
+	sample = tablet_tool_get_historical_sample(event, index);
+	if (!sample)
+		return 0;
+
+	return evdev_device_transform_y(device, sample->point.y, height);
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_historical_pressure(struct libinput_event_tablet_tool *event,
+						   size_t index)
+{
+	const struct tablet_tool_sample *sample;
+
+	sample = tablet_tool_get_historical_sample(event, index);
+
+	return sample ? sample->pressure : 0;
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_historical_tilt_x(struct libinput_event_tablet_tool *event,
+						 size_t index)
+{
+	const struct tablet_tool_sample *sample;
+
+	sample = tablet_tool_get_historical_sample(event, index);
+
+	return sample ? sample->tilt.x : 0;
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_historical_tilt_y(struct libinput_event_tablet_tool *event,
+						 size_t index)
+{
+	const struct tablet_tool_sample *sample;
+
+	sample = tablet_tool_get_historical_sample(event, index);
+
+	return sample ? sample->tilt.y : 0;
+}
+
+LIBINPUT_EXPORT struct libinput_tablet_tool *
+libinput_event_tablet_tool_get_tool(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return event->tool;
+}
+
+LIBINPUT_EXPORT enum libinput_tablet_tool_proximity_state
+libinput_event_tablet_tool_get_proximity_state(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return event->proximity_state;
+}
+
+LIBINPUT_EXPORT enum libinput_tablet_tool_tip_state
+libinput_event_tablet_tool_get_tip_state(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return event->tip_state;
+}
+
+LIBINPUT_EXPORT uint32_t
+libinput_event_tablet_tool_get_time(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return us2ms(event->time);
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_event_tablet_tool_get_time_usec(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return event->time;
+}
+
+LIBINPUT_EXPORT uint32_t
+libinput_event_tablet_tool_get_button(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON);
+
+	return event->button;
+}
+
+LIBINPUT_EXPORT enum libinput_button_state
+libinput_event_tablet_tool_get_button_state(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON);
+
+	return event->state;
+}
+
+LIBINPUT_EXPORT uint32_t
+libinput_event_tablet_tool_get_seat_button_count(struct libinput_event_tablet_tool *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON);
+
+	return event->seat_button_count;
+}
+
+LIBINPUT_EXPORT enum libinput_tablet_tool_type
+libinput_tablet_tool_get_type(struct libinput_tablet_tool *tool)
+{
+	return tool->type;
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_tablet_tool_get_tool_id(struct libinput_tablet_tool *tool)
+{
+	return tool->tool_id;
+}
+
+LIBINPUT_EXPORT int
+libinput_tablet_tool_is_unique(struct libinput_tablet_tool *tool)
+{
+	return tool->serial != 0;
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_tablet_tool_get_serial(struct libinput_tablet_tool *tool)
+{
+	return tool->serial;
+}
+
+LIBINPUT_EXPORT int
+libinput_tablet_tool_has_pressure(struct libinput_tablet_tool *tool)
+{
+	return bit_is_set(tool->axis_caps,
+			  LIBINPUT_TABLET_TOOL_AXIS_PRESSURE);
+}
+
+LIBINPUT_EXPORT int
+libinput_tablet_tool_has_distance(struct libinput_tablet_tool *tool)
+{
+	return bit_is_set(tool->axis_caps,
+			  LIBINPUT_TABLET_TOOL_AXIS_DISTANCE);
+}
+
+LIBINPUT_EXPORT int
+libinput_tablet_tool_has_tilt(struct libinput_tablet_tool *tool)
+{
+	return bit_is_set(tool->axis_caps,
+			  LIBINPUT_TABLET_TOOL_AXIS_TILT_X);
+}
+
+LIBINPUT_EXPORT int
+libinput_tablet_tool_has_rotation(struct libinput_tablet_tool *tool)
+{
+	return bit_is_set(tool->axis_caps,
+			  LIBINPUT_TABLET_TOOL_AXIS_ROTATION_Z);
+}
+
+LIBINPUT_EXPORT int
+libinput_tablet_tool_has_slider(struct libinput_tablet_tool *tool)
+{
+	return bit_is_set(tool->axis_caps,
+			  LIBINPUT_TABLET_TOOL_AXIS_SLIDER);
+}
+
+LIBINPUT_EXPORT int
+libinput_tablet_tool_has_wheel(struct libinput_tablet_tool *tool)
+{
+	return bit_is_set(tool->axis_caps,
+			  LIBINPUT_TABLET_TOOL_AXIS_REL_WHEEL);
+}
+
+LIBINPUT_EXPORT int
+libinput_tablet_tool_has_size(struct libinput_tablet_tool *tool)
+{
+	return bit_is_set(tool->axis_caps,
+			  LIBINPUT_TABLET_TOOL_AXIS_SIZE_MAJOR);
+}
+
+LIBINPUT_EXPORT int
+libinput_tablet_tool_has_button(struct libinput_tablet_tool *tool,
+				uint32_t code)
+{
+	if (NCHARS(code) > sizeof(tool->buttons))
+		return 0;
+
+	return bit_is_set(tool->buttons, code);
+}
+
+LIBINPUT_EXPORT void
+libinput_tablet_tool_set_user_data(struct libinput_tablet_tool *tool,
+				   void *user_data)
+{
+	tool->user_data = user_data;
+}
+
+LIBINPUT_EXPORT void *
+libinput_tablet_tool_get_user_data(struct libinput_tablet_tool *tool)
+{
+	return tool->user_data;
+}
+
+LIBINPUT_EXPORT struct libinput_tablet_tool *
+libinput_tablet_tool_ref(struct libinput_tablet_tool *tool)
+{
+	tool->refcount++;
+	return tool;
+}
+
+LIBINPUT_EXPORT struct libinput_tablet_tool *
+libinput_tablet_tool_unref(struct libinput_tablet_tool *tool)
+{
+	assert(tool->refcount > 0);
+
+	tool->refcount--;
+	if (tool->refcount > 0)
+		return tool;
+
+	list_remove(&tool->link);
+	free(tool);
+	return NULL;
+}
+
+/* Tools with a serial are kept in the context for its lifetime so the
+ * caller sees the same tool across tablets and proximity events. Tools
+ * no-one else holds a reference to are dropped once they have been idle
+ * for this long, otherwise a long-running context collects every pen it
+ * has ever seen */
+#define TOOL_EVICTION_TIMEOUT s2us(24 * 60 * 60)
+#define TOOL_EVICTION_INTERVAL s2us(60 * 60)
+#define TOOL_HASH_MIN_SIZE 16
+
+static char tool_hash_tombstone;
+#define TOOL_HASH_TOMBSTONE ((struct libinput_tablet_tool *)&tool_hash_tombstone)
+
+static inline size_t
+tool_hash_index(const struct libinput *libinput,
+		enum libinput_tablet_tool_type type,
+		uint32_t serial)
+{
+	uint64_t key = ((uint64_t)type << 32) | serial;
+
+	/* 64-bit finalizer from MurmurHash3 */
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+
+	return key & (libinput->tool_hash.size - 1);
+}
+
+static void
+tool_hash_place(struct libinput *libinput,
+		struct libinput_tablet_tool *tool)
+{
+	size_t mask = libinput->tool_hash.size - 1;
+	size_t idx = tool_hash_index(libinput, tool->type, tool->serial);
+
+	while (libinput->tool_hash.slots[idx] &&
+	       libinput->tool_hash.slots[idx] != TOOL_HASH_TOMBSTONE)
+		idx = (idx + 1) & mask;
+
+	if (!libinput->tool_hash.slots[idx])
+		libinput->tool_hash.used++;
+	libinput->tool_hash.slots[idx] = tool;
+	libinput->tool_hash.count++;
+}
+
+static void
+tool_hash_resize(struct libinput *libinput, size_t size)
+{
+	struct libinput_tablet_tool **old = libinput->tool_hash.slots;
+	size_t old_size = libinput->tool_hash.size;
+
+	libinput->tool_hash.slots = zalloc(size * sizeof(*old));
+	libinput->tool_hash.size = size;
+	libinput->tool_hash.count = 0;
+	libinput->tool_hash.used = 0;
+
+	for (size_t i = 0; i < old_size; i++) {
+		if (old[i] && old[i] != TOOL_HASH_TOMBSTONE)
+			tool_hash_place(libinput, old[i]);
+	}
+
+	free(old);
+}
+
+struct libinput_tablet_tool *
+libinput_tool_hash_lookup(struct libinput *libinput,
+			  enum libinput_tablet_tool_type type,
+			  uint32_t serial)
+{
+	size_t mask, idx;
+	struct libinput_tablet_tool *t;
+
+	if (libinput->tool_hash.size == 0)
+		return NULL;
+
+	mask = libinput->tool_hash.size - 1;
+	idx = tool_hash_index(libinput, type, serial);
+
+	while ((t = libinput->tool_hash.slots[idx])) {
+		if (t != TOOL_HASH_TOMBSTONE &&
+		    t->type == type && t->serial == serial)
+			return t;
+		idx = (idx + 1) & mask;
+	}
+
+	return NULL;
+}
+
+void
+libinput_tool_hash_insert(struct libinput *libinput,
+			  struct libinput_tablet_tool *tool)
+{
+	size_t size = libinput->tool_hash.size;
+
+	/* Keep the load including tombstones below 3/4, grow only if the
+	 * live entries need it, otherwise rehashing just drops the
+	 * tombstones */
+	if ((libinput->tool_hash.used + 1) * 4 > size * 3) {
+		if ((libinput->tool_hash.count + 1) * 2 > size)
+			size = max(size * 2, (size_t)TOOL_HASH_MIN_SIZE);
+		tool_hash_resize(libinput, size);
+	}
+
+	tool_hash_place(libinput, tool);
+}
+
+static void
+tool_hash_remove(struct libinput *libinput,
+		 struct libinput_tablet_tool *tool)
+{
+	size_t mask, idx;
+	struct libinput_tablet_tool *t;
+
+	if (libinput->tool_hash.size == 0)
+		return;
+
+	mask = libinput->tool_hash.size - 1;
+	idx = tool_hash_index(libinput, tool->type, tool->serial);
+
+	while ((t = libinput->tool_hash.slots[idx])) {
+		if (t == tool) {
+			libinput->tool_hash.slots[idx] = TOOL_HASH_TOMBSTONE;
+			libinput->tool_hash.count--;
+			return;
+		}
+		idx = (idx + 1) & mask;
+	}
+}
+
+void
+libinput_evict_idle_tools(struct libinput *libinput, uint64_t now)
+{
+	struct libinput_tablet_tool *tool, *tmp;
+
+	if (now < libinput->tool_hash.last_eviction + TOOL_EVICTION_INTERVAL)
+		return;
+
+	libinput->tool_hash.last_eviction = now;
+
+	list_for_each_safe(tool, tmp, &libinput->tool_list, link) {
+		/* Only the context's own reference left */
+		if (tool->serial == 0 ||
+		    tool->refcount > 1 ||
+		    tool->in_proximity ||
+		    now < tool->last_used + TOOL_EVICTION_TIMEOUT)
+			continue;
+
+		tool_hash_remove(libinput, tool);
+		libinput_tablet_tool_unref(tool);
+	}
+}
+
+LIBINPUT_EXPORT struct libinput_event *
+libinput_event_switch_get_base_event(struct libinput_event_switch *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   NULL,
+			   LIBINPUT_EVENT_SWITCH_TOGGLE);
+
+	return &event->base;
+}
+
+LIBINPUT_EXPORT enum libinput_switch
+libinput_event_switch_get_switch(struct libinput_event_switch *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_SWITCH_TOGGLE);
+
+	return event->sw;
+}
+
+LIBINPUT_EXPORT enum libinput_switch_state
+libinput_event_switch_get_switch_state(struct libinput_event_switch *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_SWITCH_TOGGLE);
+
+	return event->state;
+}
+
+LIBINPUT_EXPORT uint32_t
+libinput_event_switch_get_time(struct libinput_event_switch *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_SWITCH_TOGGLE);
+
+	return us2ms(event->time);
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_event_switch_get_time_usec(struct libinput_event_switch *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_SWITCH_TOGGLE);
+
+	return event->time;
+}
+
+#if HAVE_IO_URING
+static struct io_uring_sqe *
+libinput_uring_get_sqe(struct libinput *libinput)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = io_uring_get_sqe(&libinput->uring.ring);
+	if (!sqe) {
+		/* submission queue is full, flush it and try again */
+		io_uring_submit(&libinput->uring.ring);
+		sqe = io_uring_get_sqe(&libinput->uring.ring);
+	}
+
+	if (!sqe)
+		log_bug_libinput(libinput, "io_uring submission queue full\n");
+
+	return sqe;
+}
+
+static inline void *
+libinput_uring_poll_tag(struct libinput_source *source)
+{
+	return (void *)((uintptr_t)source | URING_POLL_TAG);
+}
+
+/* Sources with a read buffer get a poll request with a read request
+ * linked to it, everything else a poll request and reads from the fd
+ * itself once it is readable.
+ *
+ * The fds are non-blocking, a read request on its own completes with
+ * -EAGAIN straight away on an idle fd. */
+static void
+libinput_uring_arm_source(struct libinput *libinput,
+			  struct libinput_source *source)
+{
+	struct io_uring_sqe *sqe;
+
+	if (source->op != SOURCE_OP_NONE || source->fd == -1)
+		return;
+
+	/* A link doesn't span submissions, both requests must go in
+	 * together */
+	if (source->buf &&
+	    io_uring_sq_space_left(&libinput->uring.ring) < 2)
+		io_uring_submit(&libinput->uring.ring);
+
+	sqe = libinput_uring_get_sqe(libinput);
+	if (!sqe)
+		return;
+
+	io_uring_prep_poll_add(sqe, source->fd, POLLIN);
+	if (source->buf) {
+		io_uring_sqe_set_data(sqe, libinput_uring_poll_tag(source));
+		sqe->flags |= IOSQE_IO_LINK;
+
+		sqe = libinput_uring_get_sqe(libinput);
+		if (!sqe)
+			return;
+
+		/* evdev ignores the offset */
+		io_uring_prep_read(sqe, source->fd,
+				   source->buf, source->buf_len, 0);
+		source->op = SOURCE_OP_READ;
+	} else {
+		source->op = SOURCE_OP_POLL;
+	}
+	io_uring_sqe_set_data(sqe, source);
+
+	libinput->uring.need_submit = true;
+}
+
+static void
+libinput_uring_submit(struct libinput *libinput)
+{
+	if (!libinput->uring.need_submit)
+		return;
+
+	io_uring_submit(&libinput->uring.ring);
+	libinput->uring.need_submit = false;
+}
+
+static void
+libinput_uring_cancel_source(struct libinput *libinput,
+			     struct libinput_source *source)
+{
+	struct io_uring_sqe *sqe;
+
+	if (source->op == SOURCE_OP_NONE)
+		return;
+
+	/* The source stays on the destroy list until the request
+	 * completes, the kernel may still write into the buffer.
+	 * Cancelling the poll of a poll+read pair cancels the read too,
+	 * unless the read is already running */
+	if (source->op == SOURCE_OP_READ) {
+		sqe = libinput_uring_get_sqe(libinput);
+		if (!sqe)
+			return;
+
+		io_uring_prep_cancel(sqe, libinput_uring_poll_tag(source), 0);
+		io_uring_sqe_set_data(sqe, NULL);
+	}
+
+	sqe = libinput_uring_get_sqe(libinput);
+	if (!sqe)
+		return;
+
+	io_uring_prep_cancel(sqe, source, 0);
+	io_uring_sqe_set_data(sqe, NULL);
+	libinput->uring.need_submit = true;
+	libinput_uring_submit(libinput);
+}
+
+/* Move every source with a completed request to the pending list, it
+ * gets dispatched from there */
+static int
+libinput_uring_reap(struct libinput *libinput)
+{
+	struct io_uring_cqe *cqe;
+	struct libinput_source *source;
+	enum source_op op;
+	uint64_t counter;
+	void *data;
+	int res;
+
+	/* Reset the eventfd before looking at completions, anything
+	 * completing after this signals it again */
+	if (read(libinput->uring.eventfd, &counter, sizeof(counter)) < 0 &&
+	    errno != EAGAIN)
+		return -errno;
+
+	while (io_uring_peek_cqe(&libinput->uring.ring, &cqe) == 0) {
+		data = io_uring_cqe_get_data(cqe);
+		res = cqe->res;
+		io_uring_cqe_seen(&libinput->uring.ring, cqe);
+
+		/* cancel requests */
+		if (!data)
+			continue;
+
+		/* the poll of a poll+read pair, the read completes after
+		 * it, with -ECANCELED if the poll failed */
+		if ((uintptr_t)data & URING_POLL_TAG)
+			continue;
+
+		source = data;
+
+		op = source->op;
+		source->op = SOURCE_OP_NONE;
 
-	for (i = 0; i < count; ++i) {
-		source = ep[i].data.ptr;
 		if (source->fd == -1)
 			continue;
 
-		source->dispatch(source->user_data);
-	}
+		if (op == SOURCE_OP_READ) {
+			/* Someone else drained the fd between the poll and
+			 * the read, wait for the next poll */
+			if (res == -EAGAIN) {
+				libinput_uring_arm_source(libinput, source);
+				continue;
+			}
+			source->read_done = true;
+			source->read_result = res;
+		} else {
+			source->ready = true;
+		}
+
+		libinput_source_set_pending(libinput, source);
+	}
+
+	return 0;
+}
+
+static void
+libinput_uring_init(struct libinput *libinput)
+{
+	int fd;
+
+	/* If the kernel doesn't support io_uring we silently stay on
+	 * epoll */
+	if (io_uring_queue_init(URING_ENTRIES, &libinput->uring.ring, 0) < 0)
+		return;
+
+	fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (fd < 0)
+		goto err;
+
+	if (io_uring_register_eventfd(&libinput->uring.ring, fd) < 0) {
+		close(fd);
+		goto err;
+	}
+
+	libinput->uring.eventfd = fd;
+	libinput->uring.enabled = true;
+
+	return;
+
+err:
+	io_uring_queue_exit(&libinput->uring.ring);
+}
+
+static void
+libinput_uring_destroy(struct libinput *libinput)
+{
+	struct libinput_source *source;
+
+	if (!libinput->uring.enabled)
+		return;
+
+	io_uring_queue_exit(&libinput->uring.ring);
+	close(libinput->uring.eventfd);
+	libinput->uring.enabled = false;
+
+	/* Nothing is in flight anymore */
+	list_for_each(source, &libinput->source_destroy_list, link)
+		source->op = SOURCE_OP_NONE;
+}
+#endif
+
+struct libinput_source *
+libinput_add_fd(struct libinput *libinput,
+		int fd,
+		libinput_source_dispatch_t dispatch,
+		void *user_data)
+{
+	struct libinput_source *source;
+	struct epoll_event ep;
+
+	source = zalloc(sizeof *source);
+	source->dispatch = dispatch;
+	source->user_data = user_data;
+	source->fd = fd;
+
+	if (libinput->source_handler.handler) {
+		list_append(&libinput->source_list, &source->live_link);
+		libinput->source_handler.handler(libinput, source, fd, 1,
+						 libinput->source_handler.user_data);
+		return source;
+	}
+
+#if HAVE_IO_URING
+	if (libinput->uring.enabled) {
+		list_append(&libinput->source_list, &source->live_link);
+		libinput_uring_arm_source(libinput, source);
+		libinput_uring_submit(libinput);
+		return source;
+	}
+#endif
+
+	memset(&ep, 0, sizeof ep);
+	ep.events = EPOLLIN;
+	ep.data.ptr = source;
+
+	if (epoll_ctl(libinput->epoll_fd, EPOLL_CTL_ADD, fd, &ep) < 0) {
+		free(source);
+		return NULL;
+	}
+
+	list_append(&libinput->source_list, &source->live_link);
+
+	return source;
+}
+
+void
+libinput_remove_source(struct libinput *libinput,
+		       struct libinput_source *source)
+{
+	list_remove(&source->live_link);
+
+	if (libinput->source_handler.handler)
+		libinput->source_handler.handler(libinput, source, source->fd, 0,
+						 libinput->source_handler.user_data);
+#if HAVE_IO_URING
+	else if (libinput->uring.enabled)
+		libinput_uring_cancel_source(libinput, source);
+#endif
+	else
+		epoll_ctl(libinput->epoll_fd, EPOLL_CTL_DEL, source->fd, NULL);
+	source->fd = -1;
+	list_insert(&libinput->source_destroy_list, &source->link);
+
+	if (source->pending) {
+		list_remove(&source->pending_link);
+		source->pending = false;
+	}
+
+	if (source->muted) {
+		list_remove(&source->muted_link);
+		source->muted = false;
+	}
+}
+
+void
+libinput_source_set_pending(struct libinput *libinput,
+			    struct libinput_source *source)
+{
+	if (source->pending)
+		return;
+
+	source->pending = true;
+	list_append(&libinput->dispatch_pending, &source->pending_link);
+}
+
+/**
+ * Give the source a read buffer of len bytes. The source's owner then
+ * calls libinput_source_read() instead of reading from the fd directly,
+ * which lets the io_uring backend submit the read itself.
+ */
+void
+libinput_source_set_read_buffer(struct libinput_source *source,
+				size_t len)
+{
+	free(source->buf);
+	source->buf = zalloc(len);
+	source->buf_len = len;
+}
+
+void
+libinput_source_set_merge(struct libinput_source *source,
+			  libinput_source_peek_t peek,
+			  libinput_source_dispatch_t dispatch_frame)
+{
+	source->peek = peek;
+	source->dispatch_frame = dispatch_frame;
+}
+
+void
+libinput_source_set_low_priority(struct libinput_source *source,
+				 bool low_priority)
+{
+	source->low_priority = low_priority;
+}
+
+/**
+ * Read into the source's read buffer, buf is set to that buffer. The
+ * buffer contents are only valid until the next call.
+ *
+ * @return the number of bytes read or a negative errno, -EAGAIN if
+ * no data is available
+ */
+ssize_t
+libinput_source_read(struct libinput *libinput,
+		     struct libinput_source *source,
+		     void **buf)
+{
+	ssize_t len;
+
+	*buf = source->buf;
+
+#if HAVE_IO_URING
+	if (libinput->uring.enabled) {
+		if (source->read_done) {
+			source->read_done = false;
+			return source->read_result;
+		}
+
+		/* The fd became readable before we had a read request on
+		 * the ring, read it directly this once */
+		if (source->ready) {
+			source->ready = false;
+			len = read(source->fd, source->buf, source->buf_len);
+			if (len >= 0)
+				return len;
+			if (errno != EAGAIN)
+				return -errno;
+		}
+
+		libinput_uring_arm_source(libinput, source);
+		return -EAGAIN;
+	}
+#endif
+
+	len = read(source->fd, source->buf, source->buf_len);
+	if (len < 0)
+		return -errno;
+
+	if ((size_t)len == source->buf_len)
+		source->backlogged = true;
+
+	return len;
+}
+
+static inline void
+libinput_source_dispatch(struct libinput *libinput,
+			 struct libinput_source *source)
+{
+	libinput->dispatch_now = libinput_now_fresh(libinput);
+
+	source->dispatch_serial = libinput->dispatch_serial;
+	source->backlogged = false;
+	source->dispatch(source->user_data);
+	libinput->sources_dispatched++;
+
+#if HAVE_IO_URING
+	/* Sources with a read buffer request the next read themselves
+	 * once they have consumed the buffer */
+	if (libinput->uring.enabled && !source->buf) {
+		source->ready = false;
+		libinput_uring_arm_source(libinput, source);
+	}
+#endif
+}
+
+static void
+libinput_low_priority_unmute(struct libinput *libinput)
+{
+	struct libinput_source *source;
+	struct epoll_event ep;
+
+	while (!list_empty(&libinput->low_priority.muted)) {
+		source = list_first_entry(&libinput->low_priority.muted,
+					  source,
+					  muted_link);
+		list_remove(&source->muted_link);
+		source->muted = false;
+
+		memset(&ep, 0, sizeof ep);
+		ep.events = EPOLLIN;
+		ep.data.ptr = source;
+		epoll_ctl(libinput->epoll_fd, EPOLL_CTL_MOD, source->fd, &ep);
+	}
+}
+
+static void
+libinput_low_priority_timer_func(uint64_t now, void *data)
+{
+	struct libinput *libinput = data;
+
+	/* The fds become readable again, that wakes up the caller */
+	libinput_low_priority_unmute(libinput);
+}
+
+/* Dispatch a low priority source, or leave its events in the kernel
+ * buffer if the low priority sources' interval hasn't passed yet, see
+ * libinput_set_low_priority_interval() */
+static void
+libinput_source_dispatch_low_priority(struct libinput *libinput,
+				      struct libinput_source *source)
+{
+	struct epoll_event ep;
+	uint64_t now;
+
+	/* A muted source only shows up for EPOLLHUP or EPOLLERR, these
+	 * need to be handled now */
+	if (libinput->low_priority.interval == 0 || source->muted) {
+		libinput_source_dispatch(libinput, source);
+		return;
+	}
+
+	/* All low priority sources readable in the same dispatch run
+	 * together */
+	if (libinput->low_priority.serial != libinput->dispatch_serial) {
+		now = libinput_now(libinput);
+		if (now >= libinput->low_priority.next) {
+			libinput->low_priority.serial = libinput->dispatch_serial;
+			libinput->low_priority.next =
+				now + libinput->low_priority.interval;
+		} else {
+			memset(&ep, 0, sizeof ep);
+			ep.data.ptr = source;
+			if (epoll_ctl(libinput->epoll_fd, EPOLL_CTL_MOD,
+				      source->fd, &ep) == 0) {
+				source->muted = true;
+				list_append(&libinput->low_priority.muted,
+					    &source->muted_link);
+				libinput_timer_set(&libinput->low_priority.timer,
+						   libinput->low_priority.next);
+				return;
+			}
+		}
+	}
+
+	libinput_source_dispatch(libinput, source);
+}
+
+static void
+libinput_dispatch_pending_func(uint64_t now, void *data)
+{
+	/* Nothing to do, this timer only wakes up the caller, pending
+	 * sources are resumed at the start of libinput_dispatch() */
+}
+
+static void
+libinput_source_list_move(struct list *dest, struct list *src)
+{
+	struct libinput_source *source;
+
+	while (!list_empty(src)) {
+		source = list_first_entry(src, source, pending_link);
+		list_remove(&source->pending_link);
+		list_append(dest, &source->pending_link);
+	}
+}
+
+/* Returns false if the dispatch deadline was reached before all pending
+ * sources were resumed */
+static bool
+libinput_dispatch_pending(struct libinput *libinput)
+{
+	struct libinput_source *source;
+	struct list pending;
+	bool dispatched = false;
+
+	if (list_empty(&libinput->dispatch_pending))
+		return true;
+
+	libinput_timer_cancel(&libinput->dispatch_pending_timer);
+
+	/* Sources that run out of budget again get re-appended to
+	 * dispatch_pending, so move the current set out of the way
+	 * first. */
+	list_init(&pending);
+	libinput_source_list_move(&pending, &libinput->dispatch_pending);
+
+	/* Pop one at a time, dispatching may remove other sources */
+	while (!list_empty(&pending)) {
+		if (dispatched && libinput_dispatch_deadline_reached(libinput)) {
+			/* Keep the order, what didn't run goes first */
+			libinput_source_list_move(&pending,
+						  &libinput->dispatch_pending);
+			libinput_source_list_move(&libinput->dispatch_pending,
+						  &pending);
+			return false;
+		}
+
+		source = list_first_entry(&pending, source, pending_link);
+		list_remove(&source->pending_link);
+		source->pending = false;
+		libinput_source_dispatch(libinput, source);
+		dispatched = true;
+	}
+
+	return true;
+}
+
+/* Number of contexts alive, the allocator can only change at zero.
+ * Contexts may be created and destroyed on different threads, so this
+ * is only accessed atomically */
+static size_t live_contexts;
+
+LIBINPUT_EXPORT int
+libinput_set_allocator(const struct libinput_allocator_interface *interface,
+		       void *user_data)
+{
+	if (__atomic_load_n(&live_contexts, __ATOMIC_ACQUIRE) > 0)
+		return -1;
+
+	if (interface == NULL) {
+		mem_set_allocator(NULL, NULL, NULL, NULL);
+		return 0;
+	}
+
+	assert(interface->alloc != NULL);
+	assert(interface->realloc != NULL);
+	assert(interface->free != NULL);
+
+	mem_set_allocator(interface->alloc,
+			  interface->realloc,
+			  interface->free,
+			  user_data);
+	return 0;
+}
+
+int
+libinput_init(struct libinput *libinput,
+	      const struct libinput_interface *interface,
+	      const struct libinput_interface_backend *interface_backend,
+	      void *user_data)
+{
+	assert(interface->open_restricted != NULL);
+	assert(interface->close_restricted != NULL);
+
+	libinput->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (libinput->epoll_fd < 0)
+		return -1;
+
+#if HAVE_IO_URING
+	libinput_uring_init(libinput);
+#endif
+
+	libinput->events_len = EVENT_QUEUE_MIN_LEN;
+	libinput->events_min_len = EVENT_QUEUE_MIN_LEN;
+	libinput->events = mem_zalloc(libinput->events_len *
+				      sizeof(*libinput->events));
+	libinput->log_handler = libinput_default_log_func;
+	libinput->log_priority = LIBINPUT_LOG_PRIORITY_ERROR;
+	libinput->interface = interface;
+	libinput->interface_backend = interface_backend;
+	libinput->user_data = user_data;
+	libinput->refcount = 1;
+	list_init(&libinput->source_list);
+	list_init(&libinput->source_destroy_list);
+	list_init(&libinput->device_destroy_list);
+	list_init(&libinput->seat_list);
+	ptr_array_init(&libinput->device_groups);
+	list_init(&libinput->tool_list);
+	list_init(&libinput->replug.entries);
+#if HAVE_LIBWACOM
+	libinput->libwacom = &libinput->libwacom_local;
+#endif
+
+	if (libinput_timer_subsys_init(libinput) != 0) {
+		mem_free(libinput->events);
+#if HAVE_IO_URING
+		libinput_uring_destroy(libinput);
+#endif
+		close(libinput->epoll_fd);
+		return -1;
+	}
+
+	libinput->handoff.fd = -1;
+	libinput->handoff.release_fd = -1;
+	libinput->event_ring.fd = -1;
+	libinput->evdev_tap.fd = -1;
+	libinput->quirks_watch.fd = -1;
+
+	list_init(&libinput->dispatch_pending);
+	libinput_timer_init(&libinput->dispatch_pending_timer,
+			    libinput,
+			    "dispatch-pending",
+			    libinput_dispatch_pending_func,
+			    libinput);
+	list_init(&libinput->low_priority.muted);
+	libinput_timer_init(&libinput->low_priority.timer,
+			    libinput,
+			    "low-priority",
+			    libinput_low_priority_timer_func,
+			    libinput);
+
+	__atomic_fetch_add(&live_contexts, 1, __ATOMIC_ACQ_REL);
+
+	return 0;
+}
+
+/* Caches shared between all contexts that enabled
+ * libinput_set_cache_sharing() */
+static struct {
+	size_t contexts;
+	struct list quirks; /* struct shared_quirks */
+#if HAVE_LIBWACOM
+	struct libinput_libwacom libwacom;
+#endif
+} shared_caches;
+
+struct shared_quirks {
+	struct list link;
+	char *data_path;
+	char *override_file;
+	struct quirks_context *quirks;
+	size_t users;
+};
+
+LIBINPUT_ATTRIBUTE_PRINTF(3, 0)
+static void
+shared_quirks_log_msg_va(struct libinput *libinput,
+			 enum libinput_log_priority priority,
+			 const char *format,
+			 va_list args)
+{
+	/* Once initialized, the shared quirks don't belong to any one
+	 * context so there's nowhere to log to */
+	if (libinput)
+		log_msg_va(libinput, priority, format, args);
+}
+
+static struct quirks_context *
+shared_quirks_get(struct libinput *libinput,
+		  const char *data_path,
+		  const char *override_file)
+{
+	struct shared_quirks *shared;
+	struct quirks_context *quirks;
+
+	list_for_each(shared, &shared_caches.quirks, link) {
+		if (!streq(shared->data_path, data_path))
+			continue;
+
+		if (shared->override_file && override_file ?
+		    !streq(shared->override_file, override_file) :
+		    shared->override_file != override_file)
+			continue;
+
+		shared->users++;
+		return shared->quirks;
+	}
+
+	quirks = quirks_init_subsystem(data_path,
+				       override_file,
+				       shared_quirks_log_msg_va,
+				       libinput,
+				       QLOG_LIBINPUT_LOGGING);
+	if (!quirks)
+		return NULL;
+
+	libinput_record_startup_time(libinput,
+				     NULL,
+				     LIBINPUT_STARTUP_PHASE_HOST_LOOKUP,
+				     quirks_context_get_host_lookup_time(quirks));
+	quirks_context_set_log_target(quirks, NULL);
+
+	shared = zalloc(sizeof(*shared));
+	shared->data_path = safe_strdup(data_path);
+	shared->override_file = override_file ? safe_strdup(override_file) : NULL;
+	shared->quirks = quirks;
+	shared->users = 1;
+	list_insert(&shared_caches.quirks, &shared->link);
+
+	return quirks;
+}
+
+static void
+shared_quirks_put(struct quirks_context *quirks)
+{
+	struct shared_quirks *shared;
+
+	list_for_each(shared, &shared_caches.quirks, link) {
+		if (shared->quirks != quirks)
+			continue;
+
+		assert(shared->users > 0);
+		if (--shared->users > 0)
+			return;
+
+		quirks_context_unref(shared->quirks);
+		list_remove(&shared->link);
+		free(shared->data_path);
+		free(shared->override_file);
+		free(shared);
+		return;
+	}
+}
+
+static inline void
+libinput_quirks_paths(const char **data_path, const char **override_file)
+{
+	*data_path = getenv("LIBINPUT_QUIRKS_DIR");
+	*override_file = NULL;
+	if (!*data_path) {
+		*data_path = LIBINPUT_QUIRKS_DIR;
+		*override_file = LIBINPUT_QUIRKS_OVERRIDE_FILE;
+	}
+}
+
+void
+libinput_init_quirks(struct libinput *libinput)
+{
+	const char *data_path,
+	           *override_file;
+	struct quirks_context *quirks;
+	uint64_t start;
+
+	if (libinput->quirks_initialized)
+		return;
+
+	/* If we fail, we'll fail next time too */
+	libinput->quirks_initialized = true;
+
+	libinput_quirks_paths(&data_path, &override_file);
+
+	start = libinput_now_fresh(libinput);
+	if (libinput->cache_sharing) {
+		quirks = shared_quirks_get(libinput, data_path, override_file);
+	} else {
+		quirks = quirks_init_subsystem_cached(data_path,
+						      override_file,
+						      libinput->device_cache_path,
+						      log_msg_va,
+						      libinput,
+						      QLOG_LIBINPUT_LOGGING);
+		libinput_record_startup_time(libinput,
+					     NULL,
+					     LIBINPUT_STARTUP_PHASE_HOST_LOOKUP,
+					     quirks_context_get_host_lookup_time(quirks));
+	}
+	libinput_record_startup_time(libinput,
+				     NULL,
+				     LIBINPUT_STARTUP_PHASE_QUIRKS,
+				     libinput_now_fresh(libinput) - start);
+
+	if (!quirks) {
+		log_error(libinput,
+			  "Failed to load the device quirks from %s%s%s. "
+			  "This will negatively affect device behavior. "
+			  "See %sdevice-quirks.html for details.\n",
+			  data_path,
+			  override_file ? " and " : "",
+			  override_file ? override_file : "",
+			  HTTP_DOC_LINK
+			  );
+		return;
+	}
+
+	libinput->quirks = quirks;
+}
+
+LIBINPUT_EXPORT int
+libinput_reload_quirks(struct libinput *libinput)
+{
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+	struct libinput_device **devices;
+	struct udev_device **udev_devices;
+	bool *changed;
+	size_t ndevices = 0;
+	int rc, nreadded = 0;
+
+	/* Other contexts' devices use the same quirks */
+	if (libinput->cache_sharing)
+		return -EBUSY;
+
+	/* Nothing loaded yet, the first device gets the current files */
+	if (!libinput->quirks_initialized)
+		return 0;
+
+	if (!libinput->quirks)
+		return -ENOENT;
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link)
+			ndevices++;
+	}
+
+	devices = zalloc(ndevices * sizeof(*devices));
+	udev_devices = zalloc(ndevices * sizeof(*udev_devices));
+	changed = zalloc(ndevices * sizeof(*changed));
+
+	ndevices = 0;
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link) {
+			devices[ndevices] = libinput_device_ref(device);
+			udev_devices[ndevices] = evdev_device(device)->udev_device;
+			ndevices++;
+		}
+	}
+
+	rc = quirks_context_reload(libinput->quirks,
+				   udev_devices,
+				   ndevices,
+				   changed);
+
+	/* Most quirks are only looked at during the device setup, so a
+	 * device with changed quirks is removed and added again, the
+	 * same as for a seat change */
+	for (size_t i = 0; rc > 0 && i < ndevices; i++) {
+		struct evdev_device *evdev = evdev_device(devices[i]);
+		char *seat_name;
+
+		if (!changed[i])
+			continue;
+
+		if (evdev->replay) {
+			evdev_log_info(evdev,
+				       "quirks changed, replay devices are not re-added\n");
+			continue;
+		}
+
+		evdev_log_info(evdev, "quirks changed, re-adding the device\n");
+		seat_name = safe_strdup(devices[i]->seat->logical_name);
+		if (libinput->interface_backend->device_change_seat(devices[i],
+								    seat_name) == 0)
+			nreadded++;
+		free(seat_name);
+	}
+
+	for (size_t i = 0; i < ndevices; i++)
+		libinput_device_unref(devices[i]);
+	free(devices);
+	free(udev_devices);
+	free(changed);
+
+	return rc < 0 ? rc : nreadded;
+}
+
+static void
+libinput_quirks_watch_dispatch(void *data)
+{
+	struct libinput *libinput = data;
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+	/* Which file changed doesn't matter, the reload compares all of
+	 * them with what it loaded before */
+	while (read(libinput->quirks_watch.fd, buf, sizeof(buf)) > 0)
+		;
+
+	libinput_reload_quirks(libinput);
+}
+
+LIBINPUT_EXPORT int
+libinput_set_quirks_watch(struct libinput *libinput, int enable)
+{
+	const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO |
+			      IN_MOVED_FROM | IN_DELETE;
+	const char *data_path,
+		   *override_file;
+	int fd, rc;
+
+	if (!!enable == (libinput->quirks_watch.source != NULL))
+		return 0;
+
+	if (!enable) {
+		libinput_remove_source(libinput, libinput->quirks_watch.source);
+		close(libinput->quirks_watch.fd);
+		libinput->quirks_watch.source = NULL;
+		libinput->quirks_watch.fd = -1;
+		return 0;
+	}
+
+	if (libinput->cache_sharing)
+		return -EBUSY;
+
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+
+	libinput_quirks_paths(&data_path, &override_file);
+	if (inotify_add_watch(fd, data_path, mask) < 0) {
+		rc = -errno;
+		close(fd);
+		return rc;
+	}
+
+	/* The override file's directory may not exist, nothing to watch
+	 * then */
+	if (override_file) {
+		char *dir = safe_strdup(override_file);
+
+		inotify_add_watch(fd, dirname(dir), mask);
+		free(dir);
+	}
+
+	libinput->quirks_watch.source =
+		libinput_add_fd(libinput,
+				fd,
+				libinput_quirks_watch_dispatch,
+				libinput);
+	if (!libinput->quirks_watch.source) {
+		close(fd);
+		return -ENOMEM;
+	}
+	libinput->quirks_watch.fd = fd;
+
+	return 0;
+}
+
+static void
+libinput_device_destroy(struct libinput_device *device);
+
+static void
+libinput_seat_destroy(struct libinput_seat *seat);
+
+static void
+libinput_handoff_reclaim(struct libinput *libinput)
+{
+	struct libinput_event *event;
+
+	while ((event = ring_pop(&libinput->handoff.released))) {
+		libinput_event_destroy(event);
+		libinput->handoff.outstanding--;
+	}
+}
+
+static void
+libinput_handoff_flush(struct libinput *libinput)
+{
+	struct libinput_event *event;
+	size_t size = ring_size(&libinput->handoff.events);
+	bool handed_over = false;
+	uint64_t one = 1;
+	size_t outstanding;
+
+	while (true) {
+		/* Never hand over more than the consumer can give back, so
+		 * the release ring cannot overflow */
+		while (libinput->handoff.outstanding < size &&
+		       (event = libinput_get_event(libinput))) {
+			ring_push(&libinput->handoff.events, event);
+			libinput->handoff.outstanding++;
+			handed_over = true;
+		}
+
+		if (libinput->events_count == 0)
+			break;
+
+		/* The consumer wakes us up once it releases an event.
+		 * If it released them all before it could see the flag,
+		 * nobody would wake us up, so look again once the flag is
+		 * set. The fence pairs with the exchange in
+		 * libinput_handoff_event_release() */
+		__atomic_store_n(&libinput->handoff.stalled, true,
+				 __ATOMIC_SEQ_CST);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+		outstanding = libinput->handoff.outstanding;
+		libinput_handoff_reclaim(libinput);
+		if (libinput->handoff.outstanding == outstanding)
+			break;
+	}
+
+	if (handed_over &&
+	    write(libinput->handoff.fd, &one, sizeof(one)) != sizeof(one))
+		log_error(libinput,
+			  "Failed to wake up the event consumer: %s\n",
+			  strerror(errno));
+}
+
+static void
+libinput_handoff_release_dispatch(void *data)
+{
+	struct libinput *libinput = data;
+	uint64_t counter;
+
+	/* libinput_dispatch() reclaims the events, this only resets the
+	 * fd */
+	if (read(libinput->handoff.release_fd,
+		 &counter,
+		 sizeof(counter)) < 0 && errno != EAGAIN)
+		log_error(libinput,
+			  "Failed to read the event release fd: %s\n",
+			  strerror(errno));
+}
+
+static void
+libinput_handoff_destroy(struct libinput *libinput)
+{
+	struct libinput_event *event;
+
+	if (!libinput->handoff.enabled)
+		return;
+
+	libinput_handoff_reclaim(libinput);
+	while ((event = ring_pop_shared(&libinput->handoff.events)))
+		libinput_event_destroy(event);
+
+	ring_destroy(&libinput->handoff.events);
+	ring_destroy(&libinput->handoff.released);
+	if (libinput->handoff.release_source)
+		libinput_remove_source(libinput,
+				       libinput->handoff.release_source);
+	close(libinput->handoff.release_fd);
+	close(libinput->handoff.fd);
+	libinput->handoff.enabled = false;
+}
+
+static void
+libinput_drop_destroyed_sources(struct libinput *libinput)
+{
+	struct libinput_source *source, *next;
+
+	list_for_each_safe(source, next, &libinput->source_destroy_list, link) {
+#if HAVE_IO_URING
+		/* dropped once the cancelled request completes */
+		if (source->op != SOURCE_OP_NONE)
+			continue;
+#endif
+		list_remove(&source->link);
+		free(source->buf);
+		free(source);
+	}
+}
+
+static void
+libinput_drop_destroyed_devices(struct libinput *libinput)
+{
+	struct libinput_device *device, *next;
+
+	list_for_each_safe(device, next, &libinput->device_destroy_list, link)
+		libinput_device_destroy(device);
+	list_init(&libinput->device_destroy_list);
+}
+
+LIBINPUT_EXPORT struct libinput *
+libinput_ref(struct libinput *libinput)
+{
+	libinput->refcount++;
+	return libinput;
+}
+
+LIBINPUT_EXPORT struct libinput *
+libinput_unref(struct libinput *libinput)
+{
+	struct libinput_event *event;
+	struct libinput_device *device, *next_device;
+	struct libinput_seat *seat, *next_seat;
+	struct libinput_tablet_tool *tool, *next_tool;
+	struct libinput_device_group *group;
+
+	if (libinput == NULL)
+		return NULL;
+
+	assert(libinput->refcount > 0);
+	libinput->refcount--;
+	if (libinput->refcount > 0)
+		return libinput;
+
+	libinput_suspend(libinput);
+
+	libinput->interface_backend->destroy(libinput);
+
+	while ((event = libinput_get_event(libinput)))
+	       libinput_event_destroy(event);
+
+	/* Destroying an event may destroy its device and with it the
+	 * seat, hold on to the seats until all of them are drained */
+	list_for_each(seat, &libinput->seat_list, link)
+		libinput_seat_ref(seat);
+	list_for_each(seat, &libinput->seat_list, link) {
+		while ((event = libinput_seat_get_event(seat)))
+			libinput_event_destroy(event);
+	}
+	list_for_each_safe(seat, next_seat, &libinput->seat_list, link)
+		libinput_seat_unref(seat);
+
+	libinput_handoff_destroy(libinput);
+	libinput_event_ring_destroy(libinput);
+	libinput_evdev_tap_destroy(libinput);
+	libinput_set_quirks_watch(libinput, 0);
+
+	/* Anything left here is referenced by events the caller never
+	 * destroyed */
+	libinput_drop_destroyed_devices(libinput);
+
+	mem_free(libinput->events);
+	libinput_event_cache_destroy(libinput);
+
+	list_for_each_safe(seat, next_seat, &libinput->seat_list, link) {
+		list_for_each_safe(device, next_device,
+				   &seat->devices_list,
+				   link)
+			libinput_device_destroy(device);
+
+		libinput_seat_destroy(seat);
+	}
+
+	/* destroying a group removes it from the array */
+	while (libinput->device_groups.count > 0) {
+		size_t last = libinput->device_groups.count - 1;
+
+		group = libinput->device_groups.data[last];
+		libinput_device_group_destroy(group);
+	}
+	ptr_array_release(&libinput->device_groups);
+	free(libinput->group_hash.slots);
+
+	list_for_each_safe(tool, next_tool, &libinput->tool_list, link) {
+		libinput_tablet_tool_unref(tool);
+	}
+	free(libinput->tool_hash.slots);
+
+	libinput_set_replug_timeout(libinput, 0);
+
+	/* Shared caches stay around until the last context sharing them
+	 * goes away */
+	if (!libinput->cache_sharing || --shared_caches.contexts == 0)
+		libinput_release_caches(libinput);
+
+	libinput_timer_cancel(&libinput->dispatch_pending_timer);
+	libinput_timer_destroy(&libinput->dispatch_pending_timer);
+	libinput_timer_cancel(&libinput->low_priority.timer);
+	libinput_timer_destroy(&libinput->low_priority.timer);
+	libinput_timer_subsys_destroy(libinput);
+#if HAVE_IO_URING
+	libinput_uring_destroy(libinput);
+#endif
+	libinput_drop_destroyed_sources(libinput);
+	if (libinput->cache_sharing)
+		shared_quirks_put(libinput->quirks);
+	else
+		quirks_context_unref(libinput->quirks);
+	free(libinput->device_cache_path);
+	close(libinput->epoll_fd);
+	free(libinput->log_ring.entries);
+	free(libinput);
+	__atomic_fetch_sub(&live_contexts, 1, __ATOMIC_ACQ_REL);
+
+	return NULL;
+}
+
+static void
+libinput_event_tablet_tool_destroy(struct libinput_event_tablet_tool *event)
+{
+	libinput_tablet_tool_unref(event->tool);
+	mem_free(event->history);
+}
+
+static void
+libinput_event_pointer_destroy(struct libinput_event_pointer *event)
+{
+	mem_free(event->frame);
+	mem_free(event->sources);
+}
+
+static void
+libinput_event_touch_destroy(struct libinput_event_touch *event)
+{
+	mem_free(event->frame);
+}
+
+static void
+libinput_event_tablet_pad_destroy(struct libinput_event_tablet_pad *event)
+{
+	if (event->base.type != LIBINPUT_EVENT_TABLET_PAD_KEY)
+		libinput_tablet_pad_mode_group_unref(event->mode_group);
+}
+
+/**
+ * Release the type-specific references held by the event. This does not
+ * release the device reference.
+ */
+static void
+libinput_event_release_resources(struct libinput_event *event)
+{
+	switch(event->type) {
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_FRAME:
+		libinput_event_pointer_destroy(
+		   libinput_event_get_pointer_event(event));
+		break;
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		libinput_event_touch_destroy(
+		   libinput_event_get_touch_event(event));
+		break;
+	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
+	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
+	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
+		libinput_event_tablet_tool_destroy(
+		   libinput_event_get_tablet_tool_event(event));
+		break;
+	case LIBINPUT_EVENT_TABLET_PAD_RING:
+	case LIBINPUT_EVENT_TABLET_PAD_STRIP:
+	case LIBINPUT_EVENT_TABLET_PAD_BUTTON:
+	case LIBINPUT_EVENT_TABLET_PAD_KEY:
+		libinput_event_tablet_pad_destroy(
+		   libinput_event_get_tablet_pad_event(event));
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Destroy an event that was never added to the queue and thus does not
+ * hold a device reference.
+ */
+static void
+libinput_event_discard(struct libinput *libinput,
+		       struct libinput_event *event)
+{
+	libinput_event_release_resources(event);
+	libinput_event_release(libinput, event);
+}
+
+LIBINPUT_EXPORT void
+libinput_event_destroy(struct libinput_event *event)
+{
+	if (event == NULL)
+		return;
+
+	libinput_event_release_resources(event);
+
+	if (event->device) {
+		struct libinput *libinput = event->device->seat->libinput;
+
+		libinput_event_release(libinput, event);
+
+		assert(libinput->events_in_flight > 0);
+		libinput->events_in_flight--;
+		if (libinput->events_in_flight == 0 &&
+		    !list_empty(&libinput->device_destroy_list))
+			libinput_drop_destroyed_devices(libinput);
+	} else {
+		mem_free(event);
+	}
+}
+
+LIBINPUT_EXPORT void
+libinput_events_destroy(struct libinput_event **events,
+			size_t nevents)
+{
+	for (size_t i = 0; i < nevents; i++)
+		libinput_event_destroy(events[i]);
+}
+
+int
+open_restricted(struct libinput *libinput,
+		const char *path, int flags)
+{
+	return libinput->interface->open_restricted(path,
+						    flags,
+						    libinput->user_data);
+}
+
+void
+close_restricted(struct libinput *libinput, int fd)
+{
+	libinput->interface->close_restricted(fd, libinput->user_data);
+}
+
+/**
+ * Hand the request to the caller's asynchronous open function. Returns
+ * false if there is none, the backend then opens the device with
+ * open_restricted(). Otherwise, complete is called once the caller
+ * completes the request, possibly before this function returns, unless
+ * the request is cancelled first.
+ */
+bool
+libinput_open_async(struct libinput *libinput,
+		    struct libinput_open_request *request,
+		    const char *path,
+		    int flags,
+		    libinput_open_request_func complete)
+{
+	if (!libinput->open_async)
+		return false;
+
+	request->libinput = libinput;
+	request->complete = complete;
+	request->interface = libinput->interface;
+	request->user_data = libinput->user_data;
+
+	libinput->open_async(request, path, flags, libinput->user_data);
+
+	return true;
+}
+
+void
+libinput_open_request_cancel(struct libinput_open_request *request)
+{
+	request->libinput = NULL;
+}
+
+LIBINPUT_EXPORT void
+libinput_set_open_async(struct libinput *libinput,
+			libinput_open_async_func open_async)
+{
+	libinput->open_async = open_async;
+}
+
+LIBINPUT_EXPORT void
+libinput_device_open_complete(struct libinput_open_request *request,
+			      int fd)
+{
+	if (request->libinput)
+		request->complete(request, fd);
+	else if (fd >= 0)
+		request->interface->close_restricted(fd, request->user_data);
+
+	free(request);
+}
+
+bool
+ignore_litest_test_suite_device(struct udev_device *device)
+{
+	if (!getenv("LIBINPUT_RUNNING_TEST_SUITE") &&
+	    udev_device_get_property_value(device, "LIBINPUT_TEST_DEVICE"))
+		return true;
+
+	return false;
+}
+
+static bool
+libinput_seat_queue_init(struct libinput_seat *seat)
+{
+	int fd;
+
+	fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (fd < 0) {
+		log_error(seat->libinput,
+			  "Failed to create the event queue for seat %s: %s\n",
+			  seat->logical_name,
+			  strerror(errno));
+		return false;
+	}
+
+	seat->queue.len = EVENT_QUEUE_MIN_LEN;
+	seat->queue.events = mem_zalloc(seat->queue.len *
+					sizeof(*seat->queue.events));
+	seat->queue.count = 0;
+	seat->queue.out = 0;
+	seat->queue.fd = fd;
+
+	return true;
+}
+
+void
+libinput_seat_init(struct libinput_seat *seat,
+		   struct libinput *libinput,
+		   const char *physical_name,
+		   const char *logical_name,
+		   libinput_seat_destroy_func destroy)
+{
+	seat->refcount = 1;
+	seat->libinput = libinput;
+	seat->physical_name = safe_strdup(physical_name);
+	seat->logical_name = safe_strdup(logical_name);
+	seat->destroy = destroy;
+	seat->queue.fd = -1;
+	list_init(&seat->devices_list);
+	list_insert(&libinput->seat_list, &seat->link);
+
+	if (libinput->seat_queues)
+		libinput_seat_queue_init(seat);
+}
+
+int
+libinput_seat_alloc_slot_ext(struct libinput_seat *seat)
+{
+	const size_t max_words = (SEAT_SLOTS_MAX - 64) / 64;
+	size_t w;
+	int slot;
+
+	for (w = 0; w < seat->slot_map_ext_words; w++) {
+		if (seat->slot_map_ext[w] != UINT64_MAX)
+			break;
+	}
+
+	if (w == seat->slot_map_ext_words) {
+		if (w == max_words)
+			return -1;
+
+		seat->slot_map_ext = realloc(seat->slot_map_ext,
+					     (w + 1) * sizeof(*seat->slot_map_ext));
+		if (!seat->slot_map_ext)
+			abort();
+		seat->slot_map_ext[w] = 0;
+		seat->slot_map_ext_words++;
+	}
+
+	slot = __builtin_ctzll(~seat->slot_map_ext[w]);
+	seat->slot_map_ext[w] |= 1ULL << slot;
+
+	return 64 + w * 64 + slot;
+}
+
+void
+libinput_seat_release_slot_ext(struct libinput_seat *seat, int slot)
+{
+	size_t w = (slot - 64) / 64;
+
+	assert(w < seat->slot_map_ext_words);
+	seat->slot_map_ext[w] &= ~(1ULL << (slot % 64));
+}
+
+static bool
+libinput_seat_has_touches(struct libinput_seat *seat)
+{
+	if (seat->slot_map != 0)
+		return true;
+
+	for (size_t w = 0; w < seat->slot_map_ext_words; w++) {
+		if (seat->slot_map_ext[w] != 0)
+			return true;
+	}
+
+	return false;
+}
+
+LIBINPUT_EXPORT struct libinput_seat *
+libinput_seat_ref(struct libinput_seat *seat)
+{
+	seat->refcount++;
+	return seat;
+}
+
+static void
+libinput_seat_destroy(struct libinput_seat *seat)
+{
+	/* Events hold their device and thus the seat, the queue is empty
+	 * by the time the seat goes away */
+	assert(seat->queue.count == 0);
+	mem_free(seat->queue.events);
+	if (seat->queue.fd != -1)
+		close(seat->queue.fd);
+
+	list_remove(&seat->link);
+	free(seat->logical_name);
+	free(seat->physical_name);
+	free(seat->slot_map_ext);
+	key_count_destroy(&seat->button_count);
+	seat->destroy(seat);
+}
+
+LIBINPUT_EXPORT struct libinput_seat *
+libinput_seat_unref(struct libinput_seat *seat)
+{
+	assert(seat->refcount > 0);
+	seat->refcount--;
+	if (seat->refcount == 0) {
+		libinput_seat_destroy(seat);
+		return NULL;
+	} else {
+		return seat;
+	}
+}
+
+LIBINPUT_EXPORT void
+libinput_seat_set_user_data(struct libinput_seat *seat, void *user_data)
+{
+	seat->user_data = user_data;
+}
+
+LIBINPUT_EXPORT void *
+libinput_seat_get_user_data(struct libinput_seat *seat)
+{
+	return seat->user_data;
+}
+
+LIBINPUT_EXPORT struct libinput *
+libinput_seat_get_context(struct libinput_seat *seat)
+{
+	return seat->libinput;
+}
+
+LIBINPUT_EXPORT const char *
+libinput_seat_get_physical_name(struct libinput_seat *seat)
+{
+	return seat->physical_name;
+}
+
+LIBINPUT_EXPORT const char *
+libinput_seat_get_logical_name(struct libinput_seat *seat)
+{
+	return seat->logical_name;
+}
+
+void
+libinput_device_init(struct libinput_device *device,
+		     struct libinput_seat *seat)
+{
+	device->seat = seat;
+	device->refcount = 1;
+	device->id = ++seat->libinput->next_device_id;
+	list_init(&device->event_listeners);
+	memcpy(device->events_disabled,
+	       seat->libinput->events_disabled,
+	       sizeof(device->events_disabled));
+}
+
+LIBINPUT_EXPORT struct libinput_device *
+libinput_device_ref(struct libinput_device *device)
+{
+	/* A device without references that is only kept alive by events,
+	 * e.g. the caller refs the device of a device removed event */
+	if (device->refcount == 0)
+		list_remove(&device->link);
+
+	device->refcount++;
+	return device;
+}
+
+static void
+libinput_device_destroy(struct libinput_device *device)
+{
+	assert(list_empty(&device->event_listeners));
+	motion_predictor_destroy(device->predictor);
+	mem_free(device->pointer_frame);
+	evdev_device_destroy(evdev_device(device));
+}
+
+LIBINPUT_EXPORT struct libinput_device *
+libinput_device_unref(struct libinput_device *device)
+{
+	struct libinput *libinput = device->seat->libinput;
+
+	assert(device->refcount > 0);
+	device->refcount--;
+	if (device->refcount == 0) {
+		/* Events don't hold a device reference, so if any events
+		 * are still around, the device must stay alive until the
+		 * last of them is destroyed. */
+		if (libinput->events_in_flight > 0)
+			list_insert(&libinput->device_destroy_list,
+				    &device->link);
+		else
+			libinput_device_destroy(device);
+		return NULL;
+	} else {
+		return device;
+	}
+}
+
+LIBINPUT_EXPORT int
+libinput_get_fd(struct libinput *libinput)
+{
+#if HAVE_IO_URING
+	if (libinput->uring.enabled)
+		return libinput->uring.eventfd;
+#endif
+	return libinput->epoll_fd;
+}
+
+/* Dispatch pending sources and every source that is readable right now.
+ * Returns 0 if all work was done, 1 if some remains because the deadline
+ * was reached, or a negative errno */
+/* readable sources handled per epoll_wait() */
+#define DISPATCH_MAX_SOURCES 32
+
+struct merge_source {
+	struct libinput_source *source;
+	uint64_t time; /* of the next frame */
+	unsigned int frames;
+	bool active; /* has a frame buffered */
+};
+
+static inline void
+merge_source_peek(struct libinput *libinput, struct merge_source *m)
+{
+	struct libinput_source *source = m->source;
+	int rc;
+
+	m->active = false;
+
+	/* removed or suspended by another device's frame */
+	if (source->fd == -1)
+		return;
+
+	rc = source->peek(source->user_data, &m->time);
+	if (rc == 1) {
+		m->active = true;
+	} else if (rc < 0) {
+		/* A frame split across reads, or an error to handle. This
+		 * source's remaining frames are not merged. */
+		libinput_source_dispatch(libinput, source);
+	}
+}
+
+/* Process the buffered frames of all readable sources that support it in
+ * the order of their timestamps, see libinput_set_frame_merging(). The
+ * sources that don't support merging, e.g. the timerfd, go last so the
+ * timers that expire between two frames fire in order too, followed by
+ * the low priority sources. Returns like libinput_dispatch_sources(). */
+static int
+libinput_dispatch_merged(struct libinput *libinput,
+			 struct epoll_event *ep,
+			 int count)
+{
+	struct merge_source merge[DISPATCH_MAX_SOURCES];
+	struct libinput_source *source;
+	size_t nmerge = 0;
+	unsigned int budget = libinput->dispatch_budget;
+	bool dispatched = false;
+	int i, pass;
+
+	for (i = 0; i < count; i++) {
+		source = ep[i].data.ptr;
+		if (source->fd == -1 || !source->peek ||
+		    source->low_priority || source->pending ||
+		    source->dispatch_serial == libinput->dispatch_serial)
+			continue;
+
+		source->dispatch_serial = libinput->dispatch_serial;
+		source->backlogged = false;
+		merge[nmerge] = (struct merge_source) { .source = source };
+		merge_source_peek(libinput, &merge[nmerge]);
+		nmerge++;
+	}
+
+	while (true) {
+		struct merge_source *next = NULL;
+
+		for (size_t m = 0; m < nmerge; m++) {
+			if (merge[m].active &&
+			    (!next || merge[m].time < next->time))
+				next = &merge[m];
+		}
+
+		if (!next)
+			break;
+
+		/* Out of time, the buffered frames are resumed without
+		 * merging */
+		if (dispatched &&
+		    libinput_dispatch_deadline_reached(libinput)) {
+			for (size_t m = 0; m < nmerge; m++) {
+				if (merge[m].active)
+					libinput_source_set_pending(libinput,
+								    merge[m].source);
+			}
+			return 1;
+		}
+
+		libinput->dispatch_now = libinput_now_fresh(libinput);
+		next->source->dispatch_frame(next->source->user_data);
+		libinput->sources_dispatched++;
+		dispatched = true;
+
+		if (budget && ++next->frames >= budget) {
+			next->active = false;
+			if (next->source->fd != -1)
+				libinput_source_set_pending(libinput,
+							    next->source);
+			continue;
+		}
+
+		merge_source_peek(libinput, next);
+	}
+
+	/* Everything merged had its dispatch_serial set above */
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < count; i++) {
+			source = ep[i].data.ptr;
+			if (source->fd == -1 ||
+			    source->low_priority != (pass == 1) ||
+			    source->pending ||
+			    source->dispatch_serial == libinput->dispatch_serial)
+				continue;
+
+			if (dispatched &&
+			    libinput_dispatch_deadline_reached(libinput))
+				return 1;
+
+			if (source->low_priority)
+				libinput_source_dispatch_low_priority(libinput,
+								      source);
+			else
+				libinput_source_dispatch(libinput, source);
+			dispatched = true;
+		}
+	}
+
+	return 0;
+}
+
+static int
+libinput_dispatch_sources(struct libinput *libinput)
+{
+	struct libinput_source *source;
+	struct epoll_event ep[DISPATCH_MAX_SOURCES];
+	int i, count, pass;
+	bool dispatched = false;
+
+	libinput->dispatch_serial++;
+
+#if HAVE_IO_URING
+	if (libinput->uring.enabled) {
+		int rc;
+
+		/* Completed sources join the pending list behind whatever
+		 * ran out of budget last time */
+		rc = libinput_uring_reap(libinput);
+		if (rc == 0 && !libinput_dispatch_pending(libinput))
+			rc = 1;
+		return rc;
+	}
+#endif
+
+	if (!libinput_dispatch_pending(libinput))
+		return 1;
+
+	/* The caller polls the sources and the epoll fd is empty */
+	if (libinput->source_handler.handler)
+		return 0;
+
+	count = epoll_wait(libinput->epoll_fd, ep, ARRAY_LENGTH(ep), 0);
+	if (count < 0)
+		return -errno;
+
+	if (libinput->frame_merging)
+		return libinput_dispatch_merged(libinput, ep, count);
+
+	/* Sources that filled their read buffer last time go first, a
+	 * device with a near-full kernel buffer shouldn't have to wait
+	 * for the others and overflow. Low priority sources go last,
+	 * after the events of all others are queued. */
+	for (pass = 0; pass < 3; pass++) {
+		for (i = 0; i < count; ++i) {
+			source = ep[i].data.ptr;
+			if (source->fd == -1)
+				continue;
+
+			if (pass == 0 && !source->backlogged)
+				continue;
+
+			if (source->low_priority != (pass == 2))
+				continue;
+
+			/* Already had its turn in this dispatch, the fd is
+			 * still readable next time */
+			if (source->pending ||
+			    source->dispatch_serial == libinput->dispatch_serial)
+				continue;
+
+			/* Out of time, the remaining fds stay readable */
+			if (dispatched &&
+			    libinput_dispatch_deadline_reached(libinput))
+				return 1;
+
+			if (source->low_priority)
+				libinput_source_dispatch_low_priority(libinput,
+								      source);
+			else
+				libinput_source_dispatch(libinput, source);
+			dispatched = true;
+		}
+	}
+
+	return 0;
+}
+
+/* Dispatch the pending sources, then the one source the caller's event
+ * loop found readable. Returns like libinput_dispatch_sources() */
+static int
+libinput_dispatch_one_source(struct libinput *libinput,
+			     struct libinput_source *source)
+{
+	libinput->dispatch_serial++;
+
+	if (!libinput_dispatch_pending(libinput))
+		return 1;
+
+	/* Already resumed from the pending list, or removed while
+	 * dispatching one of those */
+	if (source->fd == -1 ||
+	    source->dispatch_serial == libinput->dispatch_serial)
+		return 0;
+
+	libinput_source_dispatch(libinput, source);
+
+	return 0;
+}
+
+/* Keep polling the sources until a pass queued events or nothing
+ * happened for the busy-poll window, so the next frame is processed as
+ * soon as it arrives. A device that reports faster than the window must
+ * not keep us from returning the events.
+ * Returns like libinput_dispatch_sources() */
+static int
+libinput_dispatch_busy_poll(struct libinput *libinput)
+{
+	uint64_t last_activity, now;
+	uint64_t dispatched;
+	size_t events_count = libinput->events_count;
+	int rc;
+
+	last_activity = libinput_now_fresh(libinput);
+	dispatched = libinput->sources_dispatched;
+
+	while (true) {
+		now = libinput_now_fresh(libinput);
+		if (now - last_activity >= libinput->busy_poll_window)
+			return 0;
+
+		if (libinput_dispatch_deadline_reached(libinput))
+			return 1;
+
+		libinput->dispatch_now = now;
+		rc = libinput_dispatch_sources(libinput);
+		if (rc != 0)
+			return rc;
+
+		if (libinput->events_count > events_count)
+			return 0;
+
+		/* e.g. a partial frame, keep waiting for the rest */
+		if (libinput->sources_dispatched != dispatched) {
+			dispatched = libinput->sources_dispatched;
+			last_activity = libinput_now_fresh(libinput);
+		}
+
+		libinput->busy_poll_spins++;
+	}
+}
+
+static bool
+device_is_quiescent(struct libinput_device *libinput_device)
+{
+	struct evdev_device *device = evdev_device(libinput_device);
+
+	/* BTN_TOOL_PEN up to BTN_TOOL_QUADTAP covers the tablet tools,
+	 * BTN_TOUCH and all finger counts */
+	for (unsigned int code = BTN_TOOL_PEN; code <= BTN_TOOL_QUADTAP; code++) {
+		if (libevdev_get_event_value(device->evdev, EV_KEY, code))
+			return false;
+	}
+
+	return true;
+}
+
+static bool
+libinput_is_quiescent_internal(struct libinput *libinput)
+{
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+
+	if (libinput->timer.heap_count > 0)
+		return false;
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		if (libinput_seat_has_touches(seat) ||
+		    seat->button_count.nentries > 0)
+			return false;
+
+		list_for_each(device, &seat->devices_list, link) {
+			if (!device_is_quiescent(device))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static void
+libinput_update_quiescence(struct libinput *libinput)
+{
+	bool quiescent;
+
+	if (!libinput->quiescence.handler)
+		return;
+
+	quiescent = libinput_is_quiescent_internal(libinput);
+	if (quiescent == libinput->quiescence.quiescent)
+		return;
+
+	libinput->quiescence.quiescent = quiescent;
+	libinput->quiescence.handler(libinput,
+				     quiescent,
+				     libinput->quiescence.user_data);
+}
+
+LIBINPUT_EXPORT int
+libinput_is_quiescent(struct libinput *libinput)
+{
+	return libinput_is_quiescent_internal(libinput);
+}
+
+LIBINPUT_EXPORT void
+libinput_set_quiescence_handler(struct libinput *libinput,
+				libinput_quiescence_handler handler,
+				void *user_data)
+{
+	libinput->quiescence.handler = handler;
+	libinput->quiescence.user_data = user_data;
+	libinput->quiescence.quiescent = libinput_is_quiescent_internal(libinput);
+}
+
+/* Returns 0 if all work was done, 1 if some remains because the deadline
+ * was reached, or a negative errno */
+static int
+libinput_dispatch_internal(struct libinput *libinput,
+			   uint64_t deadline,
+			   struct libinput_source *source)
+{
+	uint64_t dispatched;
+	int rc;
+
+	tracepoint(dispatch_enter);
+
+	libinput_queue_update_size(libinput);
+
+	if (libinput->handoff.enabled)
+		libinput_handoff_reclaim(libinput);
+
+	libinput->dispatch_deadline = deadline;
+	libinput->dispatch_now = libinput_now_fresh(libinput);
+
+	/* Nothing wakes us up for the timers on the caller's clock or
+	 * if the caller manages the timers */
+	if (libinput->clock.func || libinput->timer.client_managed)
+		libinput_timer_flush(libinput, libinput->dispatch_now);
+
+	dispatched = libinput->sources_dispatched;
+	if (source)
+		rc = libinput_dispatch_one_source(libinput, source);
+	else
+		rc = libinput_dispatch_sources(libinput);
+
+	/* Only spin after activity, an idle dispatch returns right away.
+	 * A caller-provided clock doesn't move while we spin. */
+	if (rc == 0 && !source && !libinput->clock.func &&
+	    libinput->busy_poll_window &&
+	    libinput->sources_dispatched != dispatched)
+		rc = libinput_dispatch_busy_poll(libinput);
+
+	/* Events may be left in libevdev's buffer where epoll can't see
+	 * them, make sure the caller gets woken up again */
+	if (!list_empty(&libinput->dispatch_pending)) {
+		libinput_timer_set_flags(&libinput->dispatch_pending_timer,
+					 libinput_now(libinput),
+					 TIMER_FLAG_ALLOW_NEGATIVE);
+		if (rc == 0)
+			rc = 1;
+	}
+
+	if (libinput->handoff.enabled)
+		libinput_handoff_flush(libinput);
+
+	if (libinput->event_ring.head != libinput->event_ring.notified)
+		libinput_event_ring_notify(libinput);
+
+	if (libinput->evdev_tap.tail != libinput->evdev_tap.notified)
+		libinput_evdev_tap_notify(libinput);
+
+	libinput->dispatch_deadline = 0;
+	libinput->dispatch_now = 0;
+	libinput_drop_destroyed_sources(libinput);
+
+#if HAVE_IO_URING
+	if (libinput->uring.enabled)
+		libinput_uring_submit(libinput);
+#endif
+
+	libinput_update_quiescence(libinput);
+
+	tracepoint(dispatch_exit, rc);
+
+	return rc;
+}
+
+LIBINPUT_EXPORT int
+libinput_dispatch(struct libinput *libinput)
+{
+	int rc;
+
+	rc = libinput_dispatch_internal(libinput, 0, NULL);
+
+	return rc < 0 ? rc : 0;
+}
+
+LIBINPUT_EXPORT int
+libinput_dispatch_source(struct libinput *libinput,
+			 struct libinput_source *source)
+{
+	int rc;
+
+	if (!libinput->source_handler.handler) {
+		log_bug_client(libinput,
+			       "no source handler set, use libinput_dispatch()\n");
+		return -EINVAL;
+	}
+
+	rc = libinput_dispatch_internal(libinput, 0, source);
+
+	return rc < 0 ? rc : 0;
+}
+
+LIBINPUT_EXPORT int
+libinput_set_clock(struct libinput *libinput,
+		   libinput_clock_func clock,
+		   void *user_data)
+{
+	struct libinput_seat *seat;
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		if (!list_empty(&seat->devices_list))
+			return -EBUSY;
+	}
+
+	libinput->clock.func = clock;
+	libinput->clock.user_data = user_data;
+
+	libinput_timer_clock_changed(libinput);
+
+	return 0;
+}
+
+LIBINPUT_EXPORT int
+libinput_set_source_handler(struct libinput *libinput,
+			    libinput_source_handler handler,
+			    void *user_data)
+{
+	struct libinput_source *source;
+
+	if (!handler)
+		return -EINVAL;
+
+	if (libinput->source_handler.handler)
+		return -EBUSY;
+
+#if HAVE_IO_URING
+	if (libinput->uring.enabled)
+		return -ENOTSUP;
+#endif
+
+	libinput->source_handler.handler = handler;
+	libinput->source_handler.user_data = user_data;
+
+	list_for_each(source, &libinput->source_list, live_link) {
+		epoll_ctl(libinput->epoll_fd, EPOLL_CTL_DEL, source->fd, NULL);
+		handler(libinput, source, source->fd, 1, user_data);
+	}
+
+	return 0;
+}
+
+LIBINPUT_EXPORT int
+libinput_dispatch_until(struct libinput *libinput,
+			uint64_t deadline_usec)
+{
+	uint64_t start;
+	int rc;
+
+	start = libinput_now(libinput);
+
+	/* Always make some progress, even if the deadline has passed */
+	rc = libinput_dispatch_internal(libinput, max(deadline_usec, 1U), NULL);
+
+	libinput->dispatch_time_last = libinput_now(libinput) - start;
+	libinput->dispatch_time_total += libinput->dispatch_time_last;
+
+	return rc;
+}
+
+LIBINPUT_EXPORT void
+libinput_set_dispatch_budget(struct libinput *libinput,
+			     unsigned int max_frames)
+{
+	libinput->dispatch_budget = max_frames;
+}
+
+LIBINPUT_EXPORT unsigned int
+libinput_get_dispatch_budget(struct libinput *libinput)
+{
+	return libinput->dispatch_budget;
+}
+
+LIBINPUT_EXPORT void
+libinput_set_frame_merging(struct libinput *libinput, int enable)
+{
+	libinput->frame_merging = !!enable;
+}
+
+LIBINPUT_EXPORT int
+libinput_get_frame_merging(struct libinput *libinput)
+{
+	return libinput->frame_merging;
+}
+
+LIBINPUT_EXPORT void
+libinput_set_low_priority_interval(struct libinput *libinput,
+				   uint64_t interval_usec)
+{
+	libinput->low_priority.interval = interval_usec;
+	libinput->low_priority.next = 0;
+
+	libinput_timer_cancel(&libinput->low_priority.timer);
+	libinput_low_priority_unmute(libinput);
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_get_low_priority_interval(struct libinput *libinput)
+{
+	return libinput->low_priority.interval;
+}
+
+LIBINPUT_EXPORT void
+libinput_set_busy_poll(struct libinput *libinput,
+		       uint64_t window_usec)
+{
+	libinput->busy_poll_window = window_usec;
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_get_busy_poll(struct libinput *libinput)
+{
+	return libinput->busy_poll_window;
+}
+
+void
+libinput_device_init_event_listener(struct libinput_event_listener *listener)
+{
+	list_init(&listener->link);
+	listener->device = NULL;
+}
+
+void
+libinput_device_add_event_listener(struct libinput_device *device,
+				   struct libinput_event_listener *listener,
+				   uint32_t event_groups,
+				   void (*notify_func)(
+						uint64_t time,
+						struct libinput_event *event,
+						void *notify_func_data),
+				   void *notify_func_data)
+{
+	listener->device = device;
+	listener->event_groups = event_groups;
+	listener->notify_func = notify_func;
+	listener->notify_func_data = notify_func_data;
+	list_insert(&device->event_listeners, &listener->link);
+
+	device->listener_event_groups |= event_groups;
+}
+
+void
+libinput_device_remove_event_listener(struct libinput_event_listener *listener)
+{
+	struct libinput_device *device = listener->device;
+	struct libinput_event_listener *l;
+
+	list_remove(&listener->link);
+
+	if (!device)
+		return;
+
+	listener->device = NULL;
+
+	device->listener_event_groups = 0;
+	list_for_each(l, &device->event_listeners, link)
+		device->listener_event_groups |= l->event_groups;
+}
+
+static uint32_t
+update_seat_key_count(struct libinput_seat *seat,
+		      int32_t key,
+		      enum libinput_key_state state)
+{
+	assert(key >= 0 && key <= KEY_MAX);
+
+	switch (state) {
+	case LIBINPUT_KEY_STATE_PRESSED:
+		return key_count_inc(&seat->button_count, key);
+	case LIBINPUT_KEY_STATE_RELEASED:
+		/* We might not have received the first PRESSED event. */
+		return key_count_dec(&seat->button_count, key);
+	}
+
+	return 0;
+}
+
+static uint32_t
+update_seat_button_count(struct libinput_seat *seat,
+			 int32_t button,
+			 enum libinput_button_state state)
+{
+	assert(button >= 0 && button <= KEY_MAX);
+
+	switch (state) {
+	case LIBINPUT_BUTTON_STATE_PRESSED:
+		return key_count_inc(&seat->button_count, button);
+	case LIBINPUT_BUTTON_STATE_RELEASED:
+		/* We might not have received the first PRESSED event. */
+		return key_count_dec(&seat->button_count, button);
+	}
+
+	return 0;
+}
+
+static void
+init_event_base(struct libinput_event *event,
+		struct libinput_device *device,
+		enum libinput_event_type type)
+{
+	event->type = type;
+	event->device = device;
+}
+
+static inline bool
+event_is_priority(const struct libinput_event *event)
+{
+	switch (event->type) {
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
+	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
+	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
+	case LIBINPUT_EVENT_TABLET_PAD_BUTTON:
+	case LIBINPUT_EVENT_TABLET_PAD_KEY:
+	case LIBINPUT_EVENT_SWITCH_TOGGLE:
+		return true;
+	case LIBINPUT_EVENT_POINTER_FRAME:
+		return ((const struct libinput_event_pointer *)event)->frame->nbuttons > 0;
+	default:
+		return false;
+	}
+}
+
+/**
+ * Return the event offset positions from the end of the queue, i.e. 0 is
+ * the most recently queued event. Returns NULL if the queue has fewer
+ * events.
+ */
+static inline struct libinput_event *
+libinput_queue_peek_tail(struct libinput *libinput, size_t offset)
+{
+	size_t idx;
+
+	if (offset >= libinput->events_count)
+		return NULL;
+
+	idx = libinput_queue_index(libinput,
+				   libinput->events_in +
+				   libinput->events_len - 1 - offset);
+
+	return libinput->events[idx];
+}
+
+/**
+ * Remove and destroy the nevents most recently queued events.
+ */
+static void
+libinput_queue_drop_tail(struct libinput *libinput, size_t nevents)
+{
+	assert(nevents <= libinput->events_count);
+
+	for (size_t i = 0; i < nevents; i++) {
+		libinput->events_in = libinput_queue_index(libinput,
+							   libinput->events_in +
+							   libinput->events_len - 1);
+		libinput->events_count--;
+		if (event_is_priority(libinput->events[libinput->events_in]))
+			libinput->events_priority--;
+		libinput_event_destroy(libinput->events[libinput->events_in]);
+	}
+}
+
+/**
+ * The caller's mode once it set one, otherwise the device's default, see
+ * libinput_set_event_coalescing().
+ */
+static inline uint32_t
+event_coalescing_mode(struct libinput *libinput,
+		      struct libinput_device *device)
+{
+	if (libinput->event_coalescing_set)
+		return libinput->event_coalescing;
+
+	return device->default_event_coalescing;
+}
+
+/**
+ * Add the delta of motion to its device's entry in the sources of prev.
+ * Returns false if prev already has the maximum number of sources.
+ */
+static bool
+pointer_motion_add_source(struct libinput_event_pointer *prev,
+			  struct libinput_event_pointer *motion)
+{
+	struct pointer_motion_sources *s = prev->sources;
+	size_t i;
+
+	if (!s) {
+		s = mem_zalloc(sizeof(*s));
+		s->count = 1;
+		s->sources[0].device = prev->base.device;
+		s->sources[0].delta = prev->delta;
+		prev->sources = s;
+	}
+
+	for (i = 0; i < s->count; i++) {
+		if (s->sources[i].device == motion->base.device)
+			break;
+	}
+
+	if (i == s->count) {
+		if (s->count == POINTER_MOTION_MAX_SOURCES)
+			return false;
+		s->sources[s->count++].device = motion->base.device;
+	}
+
+	s->sources[i].delta.x += motion->delta.x;
+	s->sources[i].delta.y += motion->delta.y;
+
+	return true;
+}
+
+static bool
+coalesce_pointer_motion(struct libinput *libinput,
+			struct libinput_event *event,
+			bool seat)
+{
+	struct libinput_event *tail = libinput_queue_peek_tail(libinput, 0);
+	struct libinput_event_pointer *prev, *motion;
+
+	if (!tail || tail->type != LIBINPUT_EVENT_POINTER_MOTION)
+		return false;
+
+	prev = (struct libinput_event_pointer *)tail;
+	motion = (struct libinput_event_pointer *)event;
+
+	if (tail->device != event->device || prev->sources) {
+		if (!seat || tail->device->seat != event->device->seat ||
+		    !pointer_motion_add_source(prev, motion))
+			return false;
+	}
+
+	/* Devices on a seat don't have to be in sync, don't let a merge
+	 * go back in time */
+	prev->time = max(prev->time, motion->time);
+	prev->delta.x += motion->delta.x;
+	prev->delta.y += motion->delta.y;
+	prev->delta_raw.x += motion->delta_raw.x;
+	prev->delta_raw.y += motion->delta_raw.y;
+
+	return true;
+}
+
+static bool
+coalesce_pointer_motion_absolute(struct libinput *libinput,
+				 struct libinput_event *event)
+{
+	struct libinput_event *tail = libinput_queue_peek_tail(libinput, 0);
+	struct libinput_event_pointer *prev, *motion;
+
+	if (!tail ||
+	    tail->type != LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE ||
+	    tail->device != event->device)
+		return false;
+
+	prev = (struct libinput_event_pointer *)tail;
+	motion = (struct libinput_event_pointer *)event;
+
+	prev->time = motion->time;
+	prev->absolute = motion->absolute;
+
+	return true;
+}
+
+static inline bool
+same_direction(double a, double b)
+{
+	return (a >= 0 && b >= 0) || (a <= 0 && b <= 0);
+}
+
+/* An axis event with a zero value on one of its axes terminates a
+ * finger or continuous scroll sequence */
+static inline bool
+pointer_axis_is_stop(const struct libinput_event_pointer *event)
+{
+	return ((event->axes & bit(LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL)) &&
+		event->delta.y == 0.0) ||
+	       ((event->axes & bit(LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL)) &&
+		event->delta.x == 0.0);
+}
+
+static bool
+coalesce_pointer_axis(struct libinput *libinput,
+		      struct libinput_event *event)
+{
+	struct libinput_event *tail = libinput_queue_peek_tail(libinput, 0);
+	struct libinput_event_pointer *prev, *axis;
+
+	if (!tail ||
+	    tail->type != LIBINPUT_EVENT_POINTER_AXIS ||
+	    tail->device != event->device)
+		return false;
+
+	prev = (struct libinput_event_pointer *)tail;
+	axis = (struct libinput_event_pointer *)event;
+
+	if (prev->source != axis->source)
+		return false;
+
+	switch (axis->source) {
+	case LIBINPUT_POINTER_AXIS_SOURCE_WHEEL:
+	case LIBINPUT_POINTER_AXIS_SOURCE_WHEEL_TILT:
+		if (!(event_coalescing_mode(libinput, event->device) &
+		      LIBINPUT_EVENT_COALESCING_POINTER_AXIS))
+			return false;
+		break;
+	case LIBINPUT_POINTER_AXIS_SOURCE_FINGER:
+	case LIBINPUT_POINTER_AXIS_SOURCE_CONTINUOUS:
+		/* Scroll stops must stay where they are, in both
+		 * directions */
+		if (!(event_coalescing_mode(libinput, event->device) &
+		      LIBINPUT_EVENT_COALESCING_POINTER_SCROLL) ||
+		    pointer_axis_is_stop(prev) ||
+		    pointer_axis_is_stop(axis))
+			return false;
+		break;
+	default:
+		return false;
+	}
+
+	if (!same_direction(prev->delta.x, axis->delta.x) ||
+	    !same_direction(prev->delta.y, axis->delta.y))
+		return false;
+
+	prev->time = axis->time;
+	prev->axes |= axis->axes;
+	prev->delta.x += axis->delta.x;
+	prev->delta.y += axis->delta.y;
+	prev->discrete.x += axis->discrete.x;
+	prev->discrete.y += axis->discrete.y;
+
+	return true;
+}
+
+static bool
+coalesce_tablet_tool_axis(struct libinput *libinput,
+			  struct libinput_event *event)
+{
+	struct libinput_event *tail = libinput_queue_peek_tail(libinput, 0);
+	struct libinput_event_tablet_tool *prev, *axis;
+	struct tablet_axes axes;
+
+	if (!tail ||
+	    tail->type != LIBINPUT_EVENT_TABLET_TOOL_AXIS ||
+	    tail->device != event->device)
+		return false;
+
+	prev = (struct libinput_event_tablet_tool *)tail;
+	axis = (struct libinput_event_tablet_tool *)event;
+
+	if (prev->tool != axis->tool ||
+	    prev->tip_state != axis->tip_state)
+		return false;
+
+	if (event_coalescing_mode(libinput, event->device) &
+	    LIBINPUT_EVENT_COALESCING_TABLET_TOOL_HISTORY) {
+		struct tablet_tool_history *history = prev->history;
+		struct tablet_tool_sample *sample;
+
+		if (!history) {
+			history = mem_zalloc(sizeof(*history) +
+					     8 * sizeof(*history->samples));
+			history->size = 8;
+			prev->history = history;
+		} else if (history->count == history->size) {
+			if (history->size >= TABLET_TOOL_HISTORY_MAX)
+				return false;
+
+			history->size *= 2;
+			history = mem_realloc(history,
+					      sizeof(*history) +
+					      history->size * sizeof(*history->samples));
+			if (!history)
+				abort();
+			prev->history = history;
+		}
+
+		sample = &history->samples[history->count++];
+		*sample = (struct tablet_tool_sample) {
+			.time = prev->time,
+			.point = prev->axes.point,
+			.pressure = prev->axes.pressure,
+			.tilt = prev->axes.tilt,
+		};
+	}
+
+	/* Absolute axes take the most recent value, relative axes are
+	 * accumulated */
+	axes = axis->axes;
+	axes.delta.x += prev->axes.delta.x;
+	axes.delta.y += prev->axes.delta.y;
+	axes.wheel += prev->axes.wheel;
+	axes.wheel_discrete += prev->axes.wheel_discrete;
+
+	prev->time = axis->time;
+	prev->axes = axes;
+	prev->output = axis->output;
+	for (size_t i = 0; i < ARRAY_LENGTH(prev->changed_axes); i++)
+		prev->changed_axes[i] |= axis->changed_axes[i];
+
+	return true;
+}
+
+static inline bool
+is_touch_motion_event(struct libinput_event *event,
+		      struct libinput_device *device)
+{
+	return event &&
+	       event->type == LIBINPUT_EVENT_TOUCH_MOTION &&
+	       event->device == device;
+}
+
+static struct libinput_event_touch *
+find_touch_slot_event(struct libinput *libinput,
+		      size_t offset,
+		      size_t nevents,
+		      int32_t slot)
+{
+	for (size_t i = offset; i < offset + nevents; i++) {
+		struct libinput_event_touch *t;
+
+		t = (struct libinput_event_touch *)libinput_queue_peek_tail(libinput, i);
+		if (t->slot == slot)
+			return t;
+	}
+
+	return NULL;
+}
+
+/**
+ * Touch motion events are merged on the frame event. If the touch frame
+ * we're about to queue only contains motion events and the previous
+ * frame, still fully in the queue, has a motion event for each of those
+ * slots, the new positions are folded into the previous frame and the
+ * new frame is dropped.
+ */
+static bool
+coalesce_touch_frame(struct libinput *libinput,
+		     struct libinput_event *event)
+{
+	struct libinput_device *device = event->device;
+	struct libinput_event *e;
+	struct libinput_event_touch *prev_frame;
+	size_t nnew = 0, nprev = 0;
+
+	while (is_touch_motion_event(libinput_queue_peek_tail(libinput, nnew),
+				     device))
+		nnew++;
+
+	if (nnew == 0)
+		return false;
+
+	e = libinput_queue_peek_tail(libinput, nnew);
+	if (!e || e->type != LIBINPUT_EVENT_TOUCH_FRAME || e->device != device)
+		return false;
+
+	prev_frame = (struct libinput_event_touch *)e;
+
+	while (is_touch_motion_event(libinput_queue_peek_tail(libinput,
+							      nnew + 1 + nprev),
+				     device))
+		nprev++;
+
+	/* If we can't see the start of the previous frame, the caller
+	 * may have consumed some of its events already */
+	if (nprev == 0 ||
+	    !libinput_queue_peek_tail(libinput, nnew + 1 + nprev))
+		return false;
+
+	for (size_t i = 0; i < nnew; i++) {
+		struct libinput_event_touch *t;
+
+		t = (struct libinput_event_touch *)libinput_queue_peek_tail(libinput, i);
+		if (!find_touch_slot_event(libinput, nnew + 1, nprev, t->slot))
+			return false;
+	}
+
+	for (size_t i = 0; i < nnew; i++) {
+		struct libinput_event_touch *t, *p;
+
+		t = (struct libinput_event_touch *)libinput_queue_peek_tail(libinput, i);
+		p = find_touch_slot_event(libinput, nnew + 1, nprev, t->slot);
+		p->time = t->time;
+		p->point = t->point;
+		p->output = t->output;
+	}
+
+	prev_frame->time = ((struct libinput_event_touch *)event)->time;
+	libinput_queue_drop_tail(libinput, nnew);
+
+	return true;
+}
+
+/**
+ * Try to merge the event into the events at the end of the queue.
+ *
+ * @return true if the event was merged and must not be queued, false
+ * otherwise
+ */
+static bool
+libinput_event_coalesce(struct libinput *libinput,
+			struct libinput_event *event)
+{
+	uint32_t mode = event_coalescing_mode(libinput, event->device);
+	bool merged = false;
+
+	/* Coalescing merges into the tail of the context's queue, device
+	 * events don't get there with seat queues */
+	if (mode == LIBINPUT_EVENT_COALESCING_NONE || libinput->seat_queues)
+		return false;
+
+	switch (event->type) {
+	case LIBINPUT_EVENT_POINTER_MOTION:
+		if (mode & (LIBINPUT_EVENT_COALESCING_POINTER_MOTION|
+			    LIBINPUT_EVENT_COALESCING_SEAT_POINTER_MOTION))
+			merged = coalesce_pointer_motion(libinput,
+							 event,
+							 mode & LIBINPUT_EVENT_COALESCING_SEAT_POINTER_MOTION);
+		break;
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+		if (mode & LIBINPUT_EVENT_COALESCING_POINTER_MOTION_ABSOLUTE)
+			merged = coalesce_pointer_motion_absolute(libinput, event);
+		break;
+	case LIBINPUT_EVENT_POINTER_AXIS:
+		if (mode & (LIBINPUT_EVENT_COALESCING_POINTER_AXIS|
+			    LIBINPUT_EVENT_COALESCING_POINTER_SCROLL))
+			merged = coalesce_pointer_axis(libinput, event);
+		break;
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
+		if (mode & (LIBINPUT_EVENT_COALESCING_TABLET_TOOL_AXIS|
+			    LIBINPUT_EVENT_COALESCING_TABLET_TOOL_HISTORY))
+			merged = coalesce_tablet_tool_axis(libinput, event);
+		break;
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		if (mode & LIBINPUT_EVENT_COALESCING_TOUCH_MOTION)
+			merged = coalesce_touch_frame(libinput, event);
+		break;
+	default:
+		break;
+	}
+
+	if (merged)
+		libinput->events_coalesced++;
+
+	return merged;
+}
+
+static void
+post_base_event(struct libinput_device *device,
+		enum libinput_event_type type,
+		struct libinput_event *event)
+{
+	struct libinput *libinput = device->seat->libinput;
+	enum libinput_profile_stage outer;
+
+	init_event_base(event, device, type);
+
+	outer = libinput_profile_enter(libinput,
+				       LIBINPUT_PROFILE_STAGE_EVENT_QUEUE);
+	if (libinput->event_ring.fd != -1)
+		libinput_event_ring_publish(libinput, event);
+	libinput_post_event(libinput, event);
+	libinput_profile_leave(libinput, outer);
+}
+
+static void
+post_device_event(struct libinput_device *device,
+		  uint64_t time,
+		  enum libinput_event_type type,
+		  struct libinput_event *event)
+{
+	struct libinput_event_listener *listener, *tmp;
+	struct libinput *libinput = device->seat->libinput;
+	enum libinput_profile_stage outer;
+#if 0
+
+	if (libinput->last_event_time > time) {
+		log_bug_libinput(device->seat->libinput,
+				 "out-of-order timestamps for %s time %" PRIu64 "\n",
+				 event_type_to_str(type),
+				 time);
+	}
+	libinput->last_event_time = time;
+#endif
+
+	init_event_base(event, device, type);
+
+	device->stats[LIBINPUT_DEVICE_STAT_EVENTS]++;
+	device->event_count[type / 100][type % 100]++;
+
+	if (device->listener_event_groups & EVENT_GROUP(type)) {
+		list_for_each_safe(listener, tmp, &device->event_listeners, link) {
+			if (listener->event_groups & EVENT_GROUP(type))
+				listener->notify_func(time,
+						      event,
+						      listener->notify_func_data);
+		}
+	}
+
+	outer = libinput_profile_enter(libinput,
+				       LIBINPUT_PROFILE_STAGE_EVENT_QUEUE);
+
+	if (event_type_is_disabled(device->events_disabled, type)) {
+		libinput->events_filtered++;
+		libinput_event_discard(libinput, event);
+		goto out;
+	}
+
+	if (libinput->event_ring.fd != -1)
+		libinput_event_ring_publish(libinput, event);
+
+	if (libinput_event_coalesce(libinput, event)) {
+		libinput_event_discard(libinput, event);
+	} else if (device->seat->queue.events) {
+		libinput_seat_post_event(device->seat, event);
+	} else {
+		libinput_post_event(libinput, event);
+	}
+
+out:
+	libinput_profile_leave(libinput, outer);
+}
+
+/**
+ * Try to merge an event that only exists on the caller's stack into the
+ * queue, before it is allocated. This is only possible if nothing but the
+ * queue sees the event, i.e. there is no listener and no event ring.
+ *
+ * @return true if the event was merged and must not be posted, false if
+ * the caller has to allocate and post it
+ */
+static bool
+post_device_event_coalesced(struct libinput_device *device,
+			    enum libinput_event_type type,
+			    struct libinput_event *event)
+{
+	struct libinput *libinput = device->seat->libinput;
+	enum libinput_profile_stage outer;
+	bool merged;
+
+	if (event_coalescing_mode(libinput, device) == LIBINPUT_EVENT_COALESCING_NONE ||
+	    libinput->event_ring.fd != -1 ||
+	    (device->listener_event_groups & EVENT_GROUP(type)) ||
+	    event_type_is_disabled(device->events_disabled, type))
+		return false;
+
+	init_event_base(event, device, type);
+
+	outer = libinput_profile_enter(libinput,
+				       LIBINPUT_PROFILE_STAGE_EVENT_QUEUE);
+	merged = libinput_event_coalesce(libinput, event);
+	libinput_profile_leave(libinput, outer);
+
+	if (merged) {
+		device->stats[LIBINPUT_DEVICE_STAT_EVENTS]++;
+		device->event_count[type / 100][type % 100]++;
+	}
+
+	return merged;
+}
+
+void
+notify_added_device(struct libinput_device *device)
+{
+	struct libinput_event_device_notify *added_device_event;
+
+	libinput_queue_update_expected(device->seat->libinput, device, true);
+	replug_cache_restore(device);
+
+	added_device_event = libinput_event_alloc(device, EVENT_SLAB_DEVICE_NOTIFY);
+
+	post_base_event(device,
+			LIBINPUT_EVENT_DEVICE_ADDED,
+			&added_device_event->base);
+
+#ifdef __clang_analyzer__
+	/* clang doesn't realize we're not leaking the event here, so
+	 * pretend to free it  */
+	free(added_device_event);
+#endif
+}
+
+void
+notify_removed_device(struct libinput_device *device)
+{
+	struct libinput_event_device_notify *removed_device_event;
+
+	libinput_queue_update_expected(device->seat->libinput, device, false);
+	replug_cache_store(device);
+
+	removed_device_event = libinput_event_alloc(device, EVENT_SLAB_DEVICE_NOTIFY);
+
+	post_base_event(device,
+			LIBINPUT_EVENT_DEVICE_REMOVED,
+			&removed_device_event->base);
+
+#ifdef __clang_analyzer__
+	/* clang doesn't realize we're not leaking the event here, so
+	 * pretend to free it  */
+	free(removed_device_event);
+#endif
+}
+
+static inline bool
+device_has_cap(struct libinput_device *device,
+	       enum libinput_device_capability cap)
+{
+	const char *capability;
+
+	if (libinput_device_has_capability(device, cap))
+		return true;
+
+	switch (cap) {
+	case LIBINPUT_DEVICE_CAP_POINTER:
+		capability = "CAP_POINTER";
+		break;
+	case LIBINPUT_DEVICE_CAP_KEYBOARD:
+		capability = "CAP_KEYBOARD";
+		break;
+	case LIBINPUT_DEVICE_CAP_TOUCH:
+		capability = "CAP_TOUCH";
+		break;
+	case LIBINPUT_DEVICE_CAP_GESTURE:
+		capability = "CAP_GESTURE";
+		break;
+	case LIBINPUT_DEVICE_CAP_TABLET_TOOL:
+		capability = "CAP_TABLET_TOOL";
+		break;
+	case LIBINPUT_DEVICE_CAP_TABLET_PAD:
+		capability = "CAP_TABLET_PAD";
+		break;
+	case LIBINPUT_DEVICE_CAP_SWITCH:
+		capability = "CAP_SWITCH";
+		break;
+	}
+
+	log_bug_libinput(device->seat->libinput,
+			 "Event for missing capability %s on device \"%s\"\n",
+			 capability,
+			 libinput_device_get_name(device));
+
+	return false;
+}
+
+/* Returns false if the event can be dropped before it is even allocated,
+ * i.e. the caller doesn't want it and no internal listener needs it */
+static inline bool
+device_event_enabled(struct libinput_device *device,
+		     enum libinput_event_type type)
+{
+	return !event_type_is_disabled(device->events_disabled, type) ||
+	       (device->listener_event_groups & EVENT_GROUP(type));
+}
+
+/* Like device_event_enabled() but counts the event as filtered */
+static inline bool
+device_wants_event(struct libinput_device *device,
+		   enum libinput_event_type type)
+{
+	if (device_event_enabled(device, type))
+		return true;
+
+	device->seat->libinput->events_filtered++;
+
+	return false;
+}
+
+/**
+ * Start collecting the pointer events of one hardware frame into a
+ * LIBINPUT_EVENT_POINTER_FRAME event, if pointer frame batching is
+ * enabled. Until pointer_frame_end(), the pointer_notify_*() functions
+ * add to the frame instead of posting events.
+ */
+void
+pointer_frame_begin(struct libinput_device *device)
+{
+	if (!device->seat->libinput->pointer_frame_batching)
+		return;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
+		return;
+
+	/* Not device_wants_event(), a frame that isn't started is not a
+	 * filtered event */
+	if (!device_event_enabled(device, LIBINPUT_EVENT_POINTER_FRAME))
+		return;
+
+	device->pointer_frame_open = true;
+}
+
+/* Returns the frame to add to or NULL if no frame is open */
+static struct pointer_frame *
+pointer_frame_get(struct libinput_device *device, uint64_t time)
+{
+	if (!device->pointer_frame_open)
+		return NULL;
+
+	/* Only allocated once there's something in it, a frame without
+	 * pointer data sends no event */
+	if (!device->pointer_frame)
+		device->pointer_frame = mem_zalloc(sizeof(*device->pointer_frame));
+
+	device->pointer_frame->time = time;
+
+	return device->pointer_frame;
+}
+
+static void
+pointer_frame_post(struct libinput_device *device)
+{
+	struct pointer_frame *frame = device->pointer_frame;
+	struct libinput_event_pointer *frame_event;
+
+	if (!frame)
+		return;
+
+	device->pointer_frame = NULL;
+
+	frame_event = libinput_event_alloc(device, EVENT_SLAB_POINTER);
+
+	*frame_event = (struct libinput_event_pointer) {
+		.time = frame->time,
+		.delta = frame->delta,
+		.delta_raw = frame->delta_raw,
+		.absolute = frame->absolute,
+		.discrete = frame->discrete,
+		.source = frame->source,
+		.axes = frame->axes,
+		.frame = frame,
+	};
+
+	post_device_event(device, frame->time,
+			  LIBINPUT_EVENT_POINTER_FRAME,
+			  &frame_event->base);
+}
+
+void
+pointer_frame_end(struct libinput_device *device)
+{
+	pointer_frame_post(device);
+	device->pointer_frame_open = false;
+}
+
+void
+keyboard_notify_key(struct libinput_device *device,
+		    uint64_t time,
+		    uint32_t key,
+		    enum libinput_key_state state)
+{
+	struct libinput_event_keyboard *key_event;
+	uint32_t seat_key_count;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_KEYBOARD))
+		return;
+
+	seat_key_count = update_seat_key_count(device->seat, key, state);
+
+	if (!device_wants_event(device, LIBINPUT_EVENT_KEYBOARD_KEY))
+		return;
+
+	key_event = libinput_event_alloc(device, EVENT_SLAB_KEYBOARD);
+
+	*key_event = (struct libinput_event_keyboard) {
+		.time = time,
+		.key = key,
+		.state = state,
+		.seat_key_count = seat_key_count,
+	};
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_KEYBOARD_KEY,
+			  &key_event->base);
+}
+
+void
+pointer_notify_motion(struct libinput_device *device,
+		      uint64_t time,
+		      const struct normalized_coords *delta,
+		      const struct device_float_coords *raw)
+{
+	struct libinput_event_pointer event, *motion_event;
+	struct pointer_frame *frame;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
+		return;
+
+	if (device->predictor) {
+		struct device_float_coords d = { delta->x, delta->y };
+
+		motion_predictor_feed_delta(device->predictor, &d, time);
+	}
+
+	if (!device_wants_event(device, LIBINPUT_EVENT_POINTER_MOTION))
+		return;
+
+	frame = pointer_frame_get(device, time);
+	if (frame) {
+		/* The motion comes first in a frame */
+		if ((frame->motion_type != LIBINPUT_EVENT_NONE &&
+		     frame->motion_type != LIBINPUT_EVENT_POINTER_MOTION) ||
+		    frame->axes != 0 || frame->nbuttons > 0) {
+			pointer_frame_post(device);
+			frame = pointer_frame_get(device, time);
+		}
+
+		frame->motion_type = LIBINPUT_EVENT_POINTER_MOTION;
+		frame->delta.x += delta->x;
+		frame->delta.y += delta->y;
+		frame->delta_raw.x += raw->x;
+		frame->delta_raw.y += raw->y;
+		return;
+	}
+
+	event = (struct libinput_event_pointer) {
+		.time = time,
+		.delta = *delta,
+		.delta_raw = *raw,
+	};
+
+	if (post_device_event_coalesced(device,
+					LIBINPUT_EVENT_POINTER_MOTION,
+					&event.base))
+		return;
+
+	motion_event = libinput_event_alloc(device, EVENT_SLAB_POINTER);
+	*motion_event = event;
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_POINTER_MOTION,
+			  &motion_event->base);
+}
+
+void
+pointer_notify_motion_absolute(struct libinput_device *device,
+			       uint64_t time,
+			       const struct device_coords *point)
+{
+	struct libinput_event_pointer *motion_absolute_event, event;
+	struct pointer_frame *frame;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
+		return;
+
+	if (!device_wants_event(device, LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE))
+		return;
+
+	frame = pointer_frame_get(device, time);
+	if (frame) {
+		if (frame->motion_type != LIBINPUT_EVENT_NONE ||
+		    frame->axes != 0 || frame->nbuttons > 0) {
+			pointer_frame_post(device);
+			frame = pointer_frame_get(device, time);
+		}
+
+		frame->motion_type = LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE;
+		frame->absolute = *point;
+		return;
+	}
+
+	event = (struct libinput_event_pointer) {
+		.time = time,
+		.absolute = *point,
+	};
+
+	if (post_device_event_coalesced(device,
+					LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
+					&event.base))
+		return;
+
+	motion_absolute_event = libinput_event_alloc(device, EVENT_SLAB_POINTER);
+	*motion_absolute_event = event;
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
+			  &motion_absolute_event->base);
+}
+
+void
+pointer_notify_button(struct libinput_device *device,
+		      uint64_t time,
+		      int32_t button,
+		      enum libinput_button_state state)
+{
+	struct libinput_event_pointer *button_event;
+	struct pointer_frame *frame;
+	int32_t seat_button_count;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
+		return;
+
+	/* The seat count must stay correct for the other devices, even if
+	 * this device's button events are filtered */
+	seat_button_count = update_seat_button_count(device->seat,
+						     button,
+						     state);
+
+	if (!device_wants_event(device, LIBINPUT_EVENT_POINTER_BUTTON))
+		return;
+
+	frame = pointer_frame_get(device, time);
+	if (frame) {
+		if (frame->nbuttons == POINTER_FRAME_MAX_BUTTONS) {
+			pointer_frame_post(device);
+			frame = pointer_frame_get(device, time);
+		}
+
+		frame->buttons[frame->nbuttons++] = (struct pointer_frame_button) {
+			.button = button,
+			.state = state,
+			.seat_button_count = seat_button_count,
+		};
+		return;
+	}
+
+	button_event = libinput_event_alloc(device, EVENT_SLAB_POINTER);
+
+	*button_event = (struct libinput_event_pointer) {
+		.time = time,
+		.button = button,
+		.state = state,
+		.seat_button_count = seat_button_count,
+	};
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_POINTER_BUTTON,
+			  &button_event->base);
+}
+
+void
+pointer_notify_axis(struct libinput_device *device,
+		    uint64_t time,
+		    uint32_t axes,
+		    enum libinput_pointer_axis_source source,
+		    const struct normalized_coords *delta,
+		    const struct discrete_coords *discrete)
+{
+	struct libinput_event_pointer event, *axis_event;
+	struct pointer_frame *frame;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
+		return;
+
+	if (!device_wants_event(device, LIBINPUT_EVENT_POINTER_AXIS))
+		return;
+
+	frame = pointer_frame_get(device, time);
+	if (frame) {
+		/* One value per axis, buttons come after the scroll */
+		if ((frame->axes & axes) ||
+		    (frame->axes != 0 && frame->source != source) ||
+		    frame->nbuttons > 0) {
+			pointer_frame_post(device);
+			frame = pointer_frame_get(device, time);
+		}
+
+		frame->axes |= axes;
+		frame->source = source;
+		if (axes & bit(LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL)) {
+			frame->axis_value.x = delta->x;
+			frame->discrete.x = discrete->x;
+		}
+		if (axes & bit(LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL)) {
+			frame->axis_value.y = delta->y;
+			frame->discrete.y = discrete->y;
+		}
+		return;
+	}
+
+	event = (struct libinput_event_pointer) {
+		.time = time,
+		.delta = *delta,
+		.source = source,
+		.axes = axes,
+		.discrete = *discrete,
+	};
+
+	if (post_device_event_coalesced(device,
+					LIBINPUT_EVENT_POINTER_AXIS,
+					&event.base))
+		return;
+
+	axis_event = libinput_event_alloc(device, EVENT_SLAB_POINTER);
+	*axis_event = event;
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_POINTER_AXIS,
+			  &axis_event->base);
+}
+
+void
+touch_notify_touch_down(struct libinput_device *device,
+			uint64_t time,
+			int32_t slot,
+			int32_t seat_slot,
+			const struct device_coords *point)
+{
+	struct libinput_event_touch *touch_event;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
+		return;
+
+	if (!device_wants_event(device, LIBINPUT_EVENT_TOUCH_DOWN))
+		return;
+
+	touch_event = libinput_event_alloc(device, EVENT_SLAB_TOUCH);
+
+	*touch_event = (struct libinput_event_touch) {
+		.time = time,
+		.slot = slot,
+		.seat_slot = seat_slot,
+		.point = *point,
+		.output = output_coords_from_point(device, point),
+	};
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_TOUCH_DOWN,
+			  &touch_event->base);
+}
+
+void
+touch_notify_touch_motion(struct libinput_device *device,
+			  uint64_t time,
+			  int32_t slot,
+			  int32_t seat_slot,
+			  const struct device_coords *point)
+{
+	struct libinput_event_touch *touch_event;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
+		return;
+
+	if (!device_wants_event(device, LIBINPUT_EVENT_TOUCH_MOTION))
+		return;
+
+	touch_event = libinput_event_alloc(device, EVENT_SLAB_TOUCH);
+
+	*touch_event = (struct libinput_event_touch) {
+		.time = time,
+		.slot = slot,
+		.seat_slot = seat_slot,
+		.point = *point,
+		.output = output_coords_from_point(device, point),
+	};
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_TOUCH_MOTION,
+			  &touch_event->base);
+}
+
+void
+touch_notify_touch_up(struct libinput_device *device,
+		      uint64_t time,
+		      int32_t slot,
+		      int32_t seat_slot)
+{
+	struct libinput_event_touch *touch_event;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
+		return;
+
+	if (!device_wants_event(device, LIBINPUT_EVENT_TOUCH_UP))
+		return;
+
+	touch_event = libinput_event_alloc(device, EVENT_SLAB_TOUCH);
+
+	*touch_event = (struct libinput_event_touch) {
+		.time = time,
+		.slot = slot,
+		.seat_slot = seat_slot,
+	};
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_TOUCH_UP,
+			  &touch_event->base);
+}
+
+void
+touch_notify_touch_cancel(struct libinput_device *device,
+			  uint64_t time,
+			  int32_t slot,
+			  int32_t seat_slot)
+{
+	struct libinput_event_touch *touch_event;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
+		return;
+
+	if (!device_wants_event(device, LIBINPUT_EVENT_TOUCH_CANCEL))
+		return;
+
+	touch_event = libinput_event_alloc(device, EVENT_SLAB_TOUCH);
+
+	*touch_event = (struct libinput_event_touch) {
+		.time = time,
+		.slot = slot,
+		.seat_slot = seat_slot,
+	};
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_TOUCH_CANCEL,
+			  &touch_event->base);
+}
+
+void
+touch_notify_frame(struct libinput_device *device,
+		   uint64_t time)
+{
+	struct libinput_event_touch *touch_event;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
+		return;
+
+	if (!device_wants_event(device, LIBINPUT_EVENT_TOUCH_FRAME))
+		return;
+
+	touch_event = libinput_event_alloc(device, EVENT_SLAB_TOUCH);
+
+	*touch_event = (struct libinput_event_touch) {
+		.time = time,
+	};
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_TOUCH_FRAME,
+			  &touch_event->base);
+}
+
+/**
+ * Post a touch frame event that carries the touch points of the frame,
+ * instead of an event per touch point followed by the frame event.
+ */
+void
+touch_notify_touch_frame(struct libinput_device *device,
+			 uint64_t time,
+			 const struct touch_frame_point *points,
+			 size_t npoints)
+{
+	struct libinput_event_touch *touch_event;
+	struct touch_frame *frame;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
+		return;
+
+	if (!device_wants_event(device, LIBINPUT_EVENT_TOUCH_FRAME))
+		return;
+
+	frame = mem_zalloc(sizeof(*frame) + npoints * sizeof(*frame->points));
+	for (size_t i = 0; i < npoints; i++) {
+		if (!device_wants_event(device, points[i].type))
+			continue;
+
+		frame->points[frame->count++] = points[i];
+	}
+
+	touch_event = libinput_event_alloc(device, EVENT_SLAB_TOUCH);
+
+	*touch_event = (struct libinput_event_touch) {
+		.time = time,
+		.frame = frame,
+	};
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_TOUCH_FRAME,
+			  &touch_event->base);
+}
+
+void
+tablet_notify_axis(struct libinput_device *device,
+		   uint64_t time,
+		   struct libinput_tablet_tool *tool,
+		   enum libinput_tablet_tool_tip_state tip_state,
+		   unsigned char *changed_axes,
+		   const struct tablet_axes *axes)
+{
+	struct libinput_event_tablet_tool event, *axis_event;
+
+	if (device->predictor) {
+		struct phys_coords mm;
+		struct device_float_coords pos;
+
+		mm = evdev_convert_xy_to_mm(evdev_device(device),
+					    axes->point.x,
+					    axes->point.y);
+		pos.x = mm.x;
+		pos.y = mm.y;
+		motion_predictor_feed_position(device->predictor, &pos, time);
+	}
+
+	if (!device_wants_event(device, LIBINPUT_EVENT_TABLET_TOOL_AXIS))
+		return;
+
+	/* The tool is only referenced once the event is allocated */
+	event = (struct libinput_event_tablet_tool) {
+		.time = time,
+		.tool = tool,
+		.proximity_state = LIBINPUT_TABLET_TOOL_PROXIMITY_STATE_IN,
+		.tip_state = tip_state,
+		.axes = *axes,
+		.output = output_coords_from_point(device, &axes->point),
+	};
+
+	memcpy(event.changed_axes,
+	       changed_axes,
+	       sizeof(event.changed_axes));
+
+	if (post_device_event_coalesced(device,
+					LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+					&event.base))
+		return;
+
+	axis_event = libinput_event_alloc(device, EVENT_SLAB_TABLET_TOOL);
+	*axis_event = event;
+	libinput_tablet_tool_ref(tool);
+
+	post_device_event(device,
+			  time,
+			  LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			  &axis_event->base);
+}
+
+void
+tablet_notify_proximity(struct libinput_device *device,
+			uint64_t time,
+			struct libinput_tablet_tool *tool,
+			enum libinput_tablet_tool_proximity_state proximity_state,
+			unsigned char *changed_axes,
+			const struct tablet_axes *axes)
+{
+	struct libinput_event_tablet_tool *proximity_event;
+
+	tool->in_proximity =
+		proximity_state == LIBINPUT_TABLET_TOOL_PROXIMITY_STATE_IN;
+
+	/* Motion doesn't carry over from one proximity to the next */
+	if (device->predictor)
+		motion_predictor_reset(device->predictor);
+
+	if (!device_wants_event(device, LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY))
+		return;
+
+	proximity_event = libinput_event_alloc(device, EVENT_SLAB_TABLET_TOOL);
+
+	*proximity_event = (struct libinput_event_tablet_tool) {
+		.time = time,
+		.tool = libinput_tablet_tool_ref(tool),
+		.tip_state = LIBINPUT_TABLET_TOOL_TIP_UP,
+		.proximity_state = proximity_state,
+		.axes = *axes,
+		.output = output_coords_from_point(device, &axes->point),
+	};
+	memcpy(proximity_event->changed_axes,
+	       changed_axes,
+	       sizeof(proximity_event->changed_axes));
+
+	post_device_event(device,
+			  time,
+			  LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY,
+			  &proximity_event->base);
+}
+
+void
+tablet_notify_tip(struct libinput_device *device,
+		  uint64_t time,
+		  struct libinput_tablet_tool *tool,
+		  enum libinput_tablet_tool_tip_state tip_state,
+		  unsigned char *changed_axes,
+		  const struct tablet_axes *axes)
+{
+	struct libinput_event_tablet_tool *tip_event;
+
+	if (!device_wants_event(device, LIBINPUT_EVENT_TABLET_TOOL_TIP))
+		return;
+
+	tip_event = libinput_event_alloc(device, EVENT_SLAB_TABLET_TOOL);
+
+	*tip_event = (struct libinput_event_tablet_tool) {
+		.time = time,
+		.tool = libinput_tablet_tool_ref(tool),
+		.tip_state = tip_state,
+		.proximity_state = LIBINPUT_TABLET_TOOL_PROXIMITY_STATE_IN,
+		.axes = *axes,
+		.output = output_coords_from_point(device, &axes->point),
+	};
+	memcpy(tip_event->changed_axes,
+	       changed_axes,
+	       sizeof(tip_event->changed_axes));
+
+	post_device_event(device,
+			  time,
+			  LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			  &tip_event->base);
+}
+
+void
+tablet_notify_button(struct libinput_device *device,
+		     uint64_t time,
+		     struct libinput_tablet_tool *tool,
+		     enum libinput_tablet_tool_tip_state tip_state,
+		     const struct tablet_axes *axes,
+		     int32_t button,
+		     enum libinput_button_state state)
+{
+	struct libinput_event_tablet_tool *button_event;
+	int32_t seat_button_count;
+
+	seat_button_count = update_seat_button_count(device->seat,
+						     button,
+						     state);
 
-	libinput_drop_destroyed_sources(libinput);
+	if (!device_wants_event(device, LIBINPUT_EVENT_TABLET_TOOL_BUTTON))
+		return;
 
-	return 0;
+	button_event = libinput_event_alloc(device, EVENT_SLAB_TABLET_TOOL);
+
+	*button_event = (struct libinput_event_tablet_tool) {
+		.time = time,
+		.tool = libinput_tablet_tool_ref(tool),
+		.button = button,
+		.state = state,
+		.seat_button_count = seat_button_count,
+		.proximity_state = LIBINPUT_TABLET_TOOL_PROXIMITY_STATE_IN,
+		.tip_state = tip_state,
+		.axes = *axes,
+		.output = output_coords_from_point(device, &axes->point),
+	};
+
+	post_device_event(device,
+			  time,
+			  LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+			  &button_event->base);
 }
 
 void
-libinput_device_init_event_listener(struct libinput_event_listener *listener)
+tablet_pad_notify_button(struct libinput_device *device,
+			 uint64_t time,
+			 int32_t button,
+			 enum libinput_button_state state,
+			 struct libinput_tablet_pad_mode_group *group)
 {
-	list_init(&listener->link);
+	struct libinput_event_tablet_pad *button_event;
+	unsigned int mode;
+
+	if (!device_wants_event(device, LIBINPUT_EVENT_TABLET_PAD_BUTTON))
+		return;
+
+	button_event = libinput_event_alloc(device, EVENT_SLAB_TABLET_PAD);
+
+	mode = libinput_tablet_pad_mode_group_get_mode(group);
+
+	*button_event = (struct libinput_event_tablet_pad) {
+		.time = time,
+		.button.number = button,
+		.button.state = state,
+		.mode_group = libinput_tablet_pad_mode_group_ref(group),
+		.mode = mode,
+	};
+
+	post_device_event(device,
+			  time,
+			  LIBINPUT_EVENT_TABLET_PAD_BUTTON,
+			  &button_event->base);
 }
 
 void
-libinput_device_add_event_listener(struct libinput_device *device,
-				   struct libinput_event_listener *listener,
-				   void (*notify_func)(
-						uint64_t time,
-						struct libinput_event *event,
-						void *notify_func_data),
-				   void *notify_func_data)
+tablet_pad_notify_ring(struct libinput_device *device,
+		       uint64_t time,
+		       unsigned int number,
+		       double value,
+		       enum libinput_tablet_pad_ring_axis_source source,
+		       struct libinput_tablet_pad_mode_group *group)
 {
-	listener->notify_func = notify_func;
-	listener->notify_func_data = notify_func_data;
-	list_insert(&device->event_listeners, &listener->link);
+	struct libinput_event_tablet_pad *ring_event;
+	unsigned int mode;
+
+	if (!device_wants_event(device, LIBINPUT_EVENT_TABLET_PAD_RING))
+		return;
+
+	ring_event = libinput_event_alloc(device, EVENT_SLAB_TABLET_PAD);
+
+	mode = libinput_tablet_pad_mode_group_get_mode(group);
+
+	*ring_event = (struct libinput_event_tablet_pad) {
+		.time = time,
+		.ring.number = number,
+		.ring.position = value,
+		.ring.source = source,
+		.mode_group = libinput_tablet_pad_mode_group_ref(group),
+		.mode = mode,
+	};
+
+	post_device_event(device,
+			  time,
+			  LIBINPUT_EVENT_TABLET_PAD_RING,
+			  &ring_event->base);
 }
 
 void
-libinput_device_remove_event_listener(struct libinput_event_listener *listener)
+tablet_pad_notify_strip(struct libinput_device *device,
+			uint64_t time,
+			unsigned int number,
+			double value,
+			enum libinput_tablet_pad_strip_axis_source source,
+			struct libinput_tablet_pad_mode_group *group)
 {
-	list_remove(&listener->link);
+	struct libinput_event_tablet_pad *strip_event;
+	unsigned int mode;
+
+	if (!device_wants_event(device, LIBINPUT_EVENT_TABLET_PAD_STRIP))
+		return;
+
+	strip_event = libinput_event_alloc(device, EVENT_SLAB_TABLET_PAD);
+
+	mode = libinput_tablet_pad_mode_group_get_mode(group);
+
+	*strip_event = (struct libinput_event_tablet_pad) {
+		.time = time,
+		.strip.number = number,
+		.strip.position = value,
+		.strip.source = source,
+		.mode_group = libinput_tablet_pad_mode_group_ref(group),
+		.mode = mode,
+	};
+
+	post_device_event(device,
+			  time,
+			  LIBINPUT_EVENT_TABLET_PAD_STRIP,
+			  &strip_event->base);
 }
 
-static uint32_t
-update_seat_key_count(struct libinput_seat *seat,
+void
+tablet_pad_notify_key(struct libinput_device *device,
+		      uint64_t time,
 		      int32_t key,
 		      enum libinput_key_state state)
 {
-	assert(key >= 0 && key <= KEY_MAX);
+	struct libinput_event_tablet_pad *key_event;
 
-	switch (state) {
-	case LIBINPUT_KEY_STATE_PRESSED:
-		return ++seat->button_count[key];
-	case LIBINPUT_KEY_STATE_RELEASED:
-		/* We might not have received the first PRESSED event. */
-		if (seat->button_count[key] == 0)
-			return 0;
+	if (!device_wants_event(device, LIBINPUT_EVENT_TABLET_PAD_KEY))
+		return;
 
-		return --seat->button_count[key];
-	}
+	key_event = libinput_event_alloc(device, EVENT_SLAB_TABLET_PAD);
 
-	return 0;
+	*key_event = (struct libinput_event_tablet_pad) {
+		.time = time,
+		.key.code = key,
+		.key.state = state,
+	};
+
+	post_device_event(device,
+			  time,
+			  LIBINPUT_EVENT_TABLET_PAD_KEY,
+			  &key_event->base);
 }
 
-static uint32_t
-update_seat_button_count(struct libinput_seat *seat,
-			 int32_t button,
-			 enum libinput_button_state state)
+static void
+gesture_notify(struct libinput_device *device,
+	       uint64_t time,
+	       enum libinput_event_type type,
+	       int finger_count,
+	       int cancelled,
+	       const struct normalized_coords *delta,
+	       const struct normalized_coords *unaccel,
+	       double scale,
+	       double angle)
 {
-	assert(button >= 0 && button <= KEY_MAX);
+	struct libinput_event_gesture *gesture_event;
 
-	switch (state) {
-	case LIBINPUT_BUTTON_STATE_PRESSED:
-		return ++seat->button_count[button];
-	case LIBINPUT_BUTTON_STATE_RELEASED:
-		/* We might not have received the first PRESSED event. */
-		if (seat->button_count[button] == 0)
-			return 0;
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_GESTURE))
+		return;
 
-		return --seat->button_count[button];
-	}
+	if (!device_wants_event(device, type))
+		return;
 
-	return 0;
-}
+	gesture_event = libinput_event_alloc(device, EVENT_SLAB_GESTURE);
 
-static void
-init_event_base(struct libinput_event *event,
-		struct libinput_device *device,
-		enum libinput_event_type type)
-{
-	event->type = type;
-	event->device = device;
+	*gesture_event = (struct libinput_event_gesture) {
+		.time = time,
+		.finger_count = finger_count,
+		.cancelled = cancelled,
+		.delta = *delta,
+		.delta_unaccel = *unaccel,
+		.scale = scale,
+		.angle = angle,
+	};
+
+	post_device_event(device, time, type,
+			  &gesture_event->base);
 }
 
-static void
-post_base_event(struct libinput_device *device,
-		enum libinput_event_type type,
-		struct libinput_event *event)
+void
+gesture_notify_swipe(struct libinput_device *device,
+		     uint64_t time,
+		     enum libinput_event_type type,
+		     int finger_count,
+		     const struct normalized_coords *delta,
+		     const struct normalized_coords *unaccel)
 {
-	struct libinput *libinput = device->seat->libinput;
-	init_event_base(event, device, type);
-	libinput_post_event(libinput, event);
+	gesture_notify(device, time, type, finger_count, 0, delta, unaccel,
+		       0.0, 0.0);
 }
 
-static void
-post_device_event(struct libinput_device *device,
-		  uint64_t time,
-		  enum libinput_event_type type,
-		  struct libinput_event *event)
+void
+gesture_notify_swipe_end(struct libinput_device *device,
+			 uint64_t time,
+			 int finger_count,
+			 int cancelled)
 {
-	struct libinput_event_listener *listener, *tmp;
-#if 0
-	struct libinput *libinput = device->seat->libinput;
+	const struct normalized_coords zero = { 0.0, 0.0 };
 
-	if (libinput->last_event_time > time) {
-		log_bug_libinput(device->seat->libinput,
-				 "out-of-order timestamps for %s time %" PRIu64 "\n",
-				 event_type_to_str(type),
-				 time);
-	}
-	libinput->last_event_time = time;
-#endif
+	gesture_notify(device, time, LIBINPUT_EVENT_GESTURE_SWIPE_END,
+		       finger_count, cancelled, &zero, &zero, 0.0, 0.0);
+}
 
-	init_event_base(event, device, type);
+void
+gesture_notify_pinch(struct libinput_device *device,
+		     uint64_t time,
+		     enum libinput_event_type type,
+		     int finger_count,
+		     const struct normalized_coords *delta,
+		     const struct normalized_coords *unaccel,
+		     double scale,
+		     double angle)
+{
+	gesture_notify(device, time, type, finger_count, 0,
+		       delta, unaccel, scale, angle);
+}
 
-	list_for_each_safe(listener, tmp, &device->event_listeners, link)
-		listener->notify_func(time, event, listener->notify_func_data);
+void
+gesture_notify_pinch_end(struct libinput_device *device,
+			 uint64_t time,
+			 int finger_count,
+			 double scale,
+			 int cancelled)
+{
+	const struct normalized_coords zero = { 0.0, 0.0 };
 
-	libinput_post_event(device->seat->libinput, event);
+	gesture_notify(device, time, LIBINPUT_EVENT_GESTURE_PINCH_END,
+		       finger_count, cancelled, &zero, &zero, scale, 0.0);
 }
 
 void
-notify_added_device(struct libinput_device *device)
+switch_notify_toggle(struct libinput_device *device,
+		     uint64_t time,
+		     enum libinput_switch sw,
+		     enum libinput_switch_state state)
 {
-	struct libinput_event_device_notify *added_device_event;
+	struct libinput_event_switch *switch_event;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_SWITCH))
+		return;
 
-	added_device_event = zalloc(sizeof *added_device_event);
+	if (!device_wants_event(device, LIBINPUT_EVENT_SWITCH_TOGGLE))
+		return;
 
-	post_base_event(device,
-			LIBINPUT_EVENT_DEVICE_ADDED,
-			&added_device_event->base);
+	switch_event = libinput_event_alloc(device, EVENT_SLAB_SWITCH);
+
+	*switch_event = (struct libinput_event_switch) {
+		.time = time,
+		.sw = sw,
+		.state = state,
+	};
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_SWITCH_TOGGLE,
+			  &switch_event->base);
 
 #ifdef __clang_analyzer__
 	/* clang doesn't realize we're not leaking the event here, so
 	 * pretend to free it  */
-	free(added_device_event);
+	free(switch_event);
 #endif
 }
 
-void
-notify_removed_device(struct libinput_device *device)
+/**
+ * Copy the first count queued events into dest, in queue order. This does
+ * not remove the events from the queue.
+ */
+static void
+libinput_queue_copy(struct libinput *libinput,
+		    struct libinput_event **dest,
+		    size_t count)
 {
-	struct libinput_event_device_notify *removed_device_event;
+	size_t chunk;
 
-	removed_device_event = zalloc(sizeof *removed_device_event);
-
-	post_base_event(device,
-			LIBINPUT_EVENT_DEVICE_REMOVED,
-			&removed_device_event->base);
+	assert(count <= libinput->events_count);
 
-#ifdef __clang_analyzer__
-	/* clang doesn't realize we're not leaking the event here, so
-	 * pretend to free it  */
-	free(removed_device_event);
-#endif
+	/* The ring buffer may wrap, so copy in at most two chunks */
+	chunk = min(count, libinput->events_len - libinput->events_out);
+	memcpy(dest,
+	       libinput->events + libinput->events_out,
+	       chunk * sizeof *dest);
+	if (chunk < count)
+		memcpy(dest + chunk,
+		       libinput->events,
+		       (count - chunk) * sizeof *dest);
 }
 
-static inline bool
-device_has_cap(struct libinput_device *device,
-	       enum libinput_device_capability cap)
+/**
+ * Move the queued events into a new ring buffer of new_len entries. The
+ * events are copied in queue order, so the ring starts unwrapped.
+ */
+static bool
+libinput_queue_resize(struct libinput *libinput, size_t new_len)
 {
-	const char *capability;
+	struct libinput_event **events;
 
-	if (libinput_device_has_capability(device, cap))
-		return true;
+	assert(new_len >= libinput->events_count);
+	assert((new_len & (new_len - 1)) == 0);
 
-	switch (cap) {
-	case LIBINPUT_DEVICE_CAP_POINTER:
-		capability = "CAP_POINTER";
-		break;
-	case LIBINPUT_DEVICE_CAP_KEYBOARD:
-		capability = "CAP_KEYBOARD";
-		break;
-	case LIBINPUT_DEVICE_CAP_TOUCH:
-		capability = "CAP_TOUCH";
-		break;
-	case LIBINPUT_DEVICE_CAP_GESTURE:
-		capability = "CAP_GESTURE";
-		break;
-	case LIBINPUT_DEVICE_CAP_TABLET_TOOL:
-		capability = "CAP_TABLET_TOOL";
-		break;
-	case LIBINPUT_DEVICE_CAP_TABLET_PAD:
-		capability = "CAP_TABLET_PAD";
-		break;
-	case LIBINPUT_DEVICE_CAP_SWITCH:
-		capability = "CAP_SWITCH";
-		break;
+	events = mem_malloc(new_len * sizeof *events);
+	if (!events)
+		return false;
+
+	libinput_queue_copy(libinput, events, libinput->events_count);
+	mem_free(libinput->events);
+	libinput->events = events;
+	libinput->events_len = new_len;
+	libinput->events_out = 0;
+	libinput->events_in = libinput_queue_index(libinput,
+						   libinput->events_count);
+
+	return true;
+}
+
+/**
+ * Size the queue for the events expected per dispatch from each device,
+ * so the bursts of a newly added device don't have to grow the queue
+ * one doubling at a time while the caller is already handling input.
+ * A device contributes a number of frames of its typical frame size,
+ * see EVENT_QUEUE_FRAMES_PER_DISPATCH.
+ */
+static void
+libinput_queue_update_expected(struct libinput *libinput,
+			       struct libinput_device *device,
+			       bool added)
+{
+	size_t nevents = 1;
+	size_t min_len = EVENT_QUEUE_MIN_LEN;
+
+	if (libinput_device_has_capability(device,
+					   LIBINPUT_DEVICE_CAP_TOUCH)) {
+		int ntouches = libinput_device_touch_get_touch_count(device);
+
+		/* one event per touch plus the frame */
+		nevents = EVENT_QUEUE_FRAMES_PER_DISPATCH *
+			  (max(ntouches, 1) + 1);
+	} else if (libinput_device_has_capability(device,
+						  LIBINPUT_DEVICE_CAP_TABLET_TOOL)) {
+		/* axis plus tip or button */
+		nevents = EVENT_QUEUE_FRAMES_PER_DISPATCH * 2;
+	} else if (libinput_device_has_capability(device,
+						  LIBINPUT_DEVICE_CAP_POINTER)) {
+		nevents = EVENT_QUEUE_FRAMES_PER_DISPATCH;
 	}
 
-	log_bug_libinput(device->seat->libinput,
-			 "Event for missing capability %s on device \"%s\"\n",
-			 capability,
-			 libinput_device_get_name(device));
+	if (added)
+		libinput->events_expected += nevents;
+	else
+		libinput->events_expected -= min(nevents,
+						 libinput->events_expected);
 
-	return false;
+	while (min_len < libinput->events_expected &&
+	       min_len < EVENT_QUEUE_PRESIZE_MAX)
+		min_len *= 2;
+
+	/* A smaller minimum lets the queue shrink over the next dispatches,
+	 * see libinput_queue_update_size() */
+	libinput->events_min_len = min_len;
+	if (libinput->events_len < min_len)
+		libinput_queue_resize(libinput, min_len);
 }
 
-void
-keyboard_notify_key(struct libinput_device *device,
-		    uint64_t time,
-		    uint32_t key,
-		    enum libinput_key_state state)
+/**
+ * The ring buffer only grows on demand in libinput_post_event(). Once a
+ * burst is over we shrink it again, but only if it has been mostly unused
+ * for a number of consecutive dispatches. Otherwise a caller with regular
+ * bursts would reallocate the buffer on every burst.
+ *
+ * This is called once per libinput_dispatch().
+ */
+static void
+libinput_queue_update_size(struct libinput *libinput)
 {
-	struct libinput_event_keyboard *key_event;
-	uint32_t seat_key_count;
+	if (libinput->events_len <= libinput->events_min_len ||
+	    libinput->events_high_water > libinput->events_len / 4) {
+		libinput->events_idle_dispatches = 0;
+		goto out;
+	}
 
-	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_KEYBOARD))
+	if (++libinput->events_idle_dispatches < EVENT_QUEUE_SHRINK_DISPATCHES)
+		goto out;
+
+	if (libinput_queue_resize(libinput, libinput->events_len / 2))
+		libinput->events_idle_dispatches = 0;
+
+out:
+	libinput->events_high_water = libinput->events_count;
+}
+
+static void
+libinput_post_event(struct libinput *libinput,
+		    struct libinput_event *event)
+{
+	size_t events_count = libinput->events_count;
+
+#if 0
+	log_debug(libinput, "Queuing %s\n", event_type_to_str(event->type));
+#endif
+
+	events_count++;
+	if (events_count > libinput->events_len &&
+	    !libinput_queue_resize(libinput, libinput->events_len * 2)) {
+		log_error(libinput,
+			  "Failed to reallocate event ring buffer. "
+			  "Events may be discarded\n");
+		libinput->events_dropped++;
+		libinput_event_discard(libinput, event);
 		return;
+	}
 
-	key_event = zalloc(sizeof *key_event);
+	/* No device ref per event, see libinput_device_unref() */
+	if (event->device)
+		libinput->events_in_flight++;
 
-	seat_key_count = update_seat_key_count(device->seat, key, state);
+	/* The cached dispatch time is as old as the source's dispatch,
+	 * that would count the processing time as queue latency */
+	if (libinput->queue_latency_tracking)
+		event->queued_time = libinput_now_fresh(libinput);
 
-	*key_event = (struct libinput_event_keyboard) {
-		.time = time,
-		.key = key,
-		.state = state,
-		.seat_key_count = seat_key_count,
-	};
+	libinput->events_count = events_count;
+	if (event_is_priority(event))
+		libinput->events_priority++;
+	libinput->events_high_water = max(libinput->events_high_water,
+					  events_count);
+	libinput->events_peak = max(libinput->events_peak, events_count);
+	libinput->events[libinput->events_in] = event;
+	libinput->events_in = libinput_queue_index(libinput,
+						   libinput->events_in + 1);
 
-	post_device_event(device, time,
-			  LIBINPUT_EVENT_KEYBOARD_KEY,
-			  &key_event->base);
+	tracepoint(event_enqueue, event->type, events_count);
 }
 
-void
-pointer_notify_motion(struct libinput_device *device,
-		      uint64_t time,
-		      const struct normalized_coords *delta,
-		      const struct device_float_coords *raw)
+static void
+libinput_seat_post_event(struct libinput_seat *seat,
+			 struct libinput_event *event)
 {
-	struct libinput_event_pointer *motion_event;
+	struct libinput *libinput = seat->libinput;
+	uint64_t one = 1;
 
-	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
-		return;
+	if (seat->queue.count == seat->queue.len) {
+		size_t len = seat->queue.len * 2;
+		struct libinput_event **events;
+		size_t chunk;
 
-	motion_event = zalloc(sizeof *motion_event);
+		events = mem_malloc(len * sizeof(*events));
+		if (!events) {
+			log_error(libinput,
+				  "Failed to reallocate the event queue for seat %s. "
+				  "Events may be discarded\n",
+				  seat->logical_name);
+			libinput->events_dropped++;
+			libinput_event_discard(libinput, event);
+			return;
+		}
 
-	*motion_event = (struct libinput_event_pointer) {
-		.time = time,
-		.delta = *delta,
-		.delta_raw = *raw,
-	};
+		/* the queue is full, so it wraps at out */
+		chunk = seat->queue.len - seat->queue.out;
+		memcpy(events,
+		       seat->queue.events + seat->queue.out,
+		       chunk * sizeof(*events));
+		memcpy(events + chunk,
+		       seat->queue.events,
+		       seat->queue.out * sizeof(*events));
+		mem_free(seat->queue.events);
+		seat->queue.events = events;
+		seat->queue.len = len;
+		seat->queue.out = 0;
+	}
 
-	post_device_event(device, time,
-			  LIBINPUT_EVENT_POINTER_MOTION,
-			  &motion_event->base);
+	/* No device ref per event, see libinput_device_unref() */
+	libinput->events_in_flight++;
+
+	if (libinput->queue_latency_tracking)
+		event->queued_time = libinput_now_fresh(libinput);
+
+	seat->queue.events[(seat->queue.out + seat->queue.count) %
+			   seat->queue.len] = event;
+	seat->queue.count++;
+
+	tracepoint(event_enqueue, event->type, seat->queue.count);
+
+	if (seat->queue.count == 1 &&
+	    write(seat->queue.fd, &one, sizeof(one)) != sizeof(one))
+		log_error(libinput,
+			  "Failed to signal the event queue for seat %s: %s\n",
+			  seat->logical_name,
+			  strerror(errno));
 }
 
-void
-pointer_notify_motion_absolute(struct libinput_device *device,
-			       uint64_t time,
-			       const struct device_coords *point)
+static inline void
+libinput_queue_latency_update(struct libinput *libinput,
+			      struct libinput_event **events,
+			      size_t count)
 {
-	struct libinput_event_pointer *motion_absolute_event;
+	uint64_t now;
+	size_t i;
 
-	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
+	if (!libinput->queue_latency_tracking)
 		return;
 
-	motion_absolute_event = zalloc(sizeof *motion_absolute_event);
+	now = libinput_now_fresh(libinput);
+	for (i = 0; i < count; i++) {
+		uint64_t queued = events[i]->queued_time;
 
-	*motion_absolute_event = (struct libinput_event_pointer) {
-		.time = time,
-		.absolute = *point,
-	};
+		/* queued before tracking was enabled */
+		if (queued == 0)
+			continue;
 
-	post_device_event(device, time,
-			  LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
-			  &motion_absolute_event->base);
+		histogram_add(&libinput->queue_latency,
+			      now > queued ? now - queued : 0);
+	}
 }
 
-void
-pointer_notify_button(struct libinput_device *device,
-		      uint64_t time,
-		      int32_t button,
-		      enum libinput_button_state state)
+LIBINPUT_EXPORT struct libinput_event *
+libinput_get_event(struct libinput *libinput)
 {
-	struct libinput_event_pointer *button_event;
-	int32_t seat_button_count;
+	struct libinput_event *event;
 
-	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
-		return;
+	if (libinput->events_count == 0)
+		return NULL;
 
-	button_event = zalloc(sizeof *button_event);
+	event = libinput->events[libinput->events_out];
+	libinput->events_out = libinput_queue_index(libinput,
+						    libinput->events_out + 1);
+	libinput->events_count--;
+	if (event_is_priority(event))
+		libinput->events_priority--;
 
-	seat_button_count = update_seat_button_count(device->seat,
-						     button,
-						     state);
+	libinput_queue_latency_update(libinput, &event, 1);
 
-	*button_event = (struct libinput_event_pointer) {
-		.time = time,
-		.button = button,
-		.state = state,
-		.seat_button_count = seat_button_count,
-	};
+	tracepoint(event_dequeue, event->type, libinput->events_count);
 
-	post_device_event(device, time,
-			  LIBINPUT_EVENT_POINTER_BUTTON,
-			  &button_event->base);
+	return event;
 }
 
-void
-pointer_notify_axis(struct libinput_device *device,
-		    uint64_t time,
-		    uint32_t axes,
-		    enum libinput_pointer_axis_source source,
-		    const struct normalized_coords *delta,
-		    const struct discrete_coords *discrete)
+LIBINPUT_EXPORT struct libinput_event *
+libinput_seat_get_event(struct libinput_seat *seat)
 {
-	struct libinput_event_pointer *axis_event;
+	struct libinput_event *event;
+	uint64_t counter;
 
-	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
-		return;
+	if (seat->queue.count == 0)
+		return NULL;
 
-	axis_event = zalloc(sizeof *axis_event);
+	event = seat->queue.events[seat->queue.out];
+	seat->queue.out = (seat->queue.out + 1) % seat->queue.len;
+	seat->queue.count--;
 
-	*axis_event = (struct libinput_event_pointer) {
-		.time = time,
-		.delta = *delta,
-		.source = source,
-		.axes = axes,
-		.discrete = *discrete,
-	};
+	if (seat->queue.count == 0 &&
+	    read(seat->queue.fd, &counter, sizeof(counter)) < 0 &&
+	    errno != EAGAIN)
+		log_error(seat->libinput,
+			  "Failed to reset the event queue for seat %s: %s\n",
+			  seat->logical_name,
+			  strerror(errno));
 
-	post_device_event(device, time,
-			  LIBINPUT_EVENT_POINTER_AXIS,
-			  &axis_event->base);
+	libinput_queue_latency_update(seat->libinput, &event, 1);
+
+	tracepoint(event_dequeue, event->type, seat->queue.count);
+
+	return event;
 }
 
-void
-touch_notify_touch_down(struct libinput_device *device,
-			uint64_t time,
-			int32_t slot,
-			int32_t seat_slot,
-			const struct device_coords *point)
+LIBINPUT_EXPORT int
+libinput_seat_get_event_fd(struct libinput_seat *seat)
 {
-	struct libinput_event_touch *touch_event;
+	return seat->queue.events ? seat->queue.fd : -1;
+}
 
-	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
-		return;
+LIBINPUT_EXPORT int
+libinput_enable_seat_event_queues(struct libinput *libinput)
+{
+	struct libinput_seat *seat;
 
-	touch_event = zalloc(sizeof *touch_event);
+	if (libinput->seat_queues) {
+		log_bug_client(libinput, "Seat event queues are already enabled\n");
+		return -1;
+	}
 
-	*touch_event = (struct libinput_event_touch) {
-		.time = time,
-		.slot = slot,
-		.seat_slot = seat_slot,
-		.point = *point,
-	};
+	if (libinput->handoff.enabled) {
+		log_bug_client(libinput,
+			       "Seat event queues cannot be used with event handoff\n");
+		return -1;
+	}
 
-	post_device_event(device, time,
-			  LIBINPUT_EVENT_TOUCH_DOWN,
-			  &touch_event->base);
+	libinput->seat_queues = true;
+	list_for_each(seat, &libinput->seat_list, link)
+		libinput_seat_queue_init(seat);
+
+	return 0;
 }
 
-void
-touch_notify_touch_motion(struct libinput_device *device,
-			  uint64_t time,
-			  int32_t slot,
-			  int32_t seat_slot,
-			  const struct device_coords *point)
+LIBINPUT_EXPORT struct libinput_event *
+libinput_get_event_prioritized(struct libinput *libinput)
 {
-	struct libinput_event_touch *touch_event;
+	struct libinput_event **events = libinput->events;
+	struct libinput_event *event;
+	struct libinput_device *device = NULL;
+	size_t len = libinput->events_len,
+	       out = libinput->events_out;
+	size_t idx, prio;
+
+	if (libinput->events_priority == 0)
+		return libinput_get_event(libinput);
+
+	for (prio = 0; prio < libinput->events_count; prio++) {
+		event = events[(out + prio) % len];
+		if (event_is_priority(event)) {
+			device = event->device;
+			break;
+		}
+	}
+	assert(prio < libinput->events_count);
 
-	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
-		return;
+	/* Keep the device's own events in order, its oldest queued event
+	 * goes first */
+	for (idx = 0; idx < prio; idx++) {
+		if (events[(out + idx) % len]->device == device)
+			break;
+	}
 
-	touch_event = zalloc(sizeof *touch_event);
+	if (idx == 0)
+		return libinput_get_event(libinput);
 
-	*touch_event = (struct libinput_event_touch) {
-		.time = time,
-		.slot = slot,
-		.seat_slot = seat_slot,
-		.point = *point,
-	};
+	/* Close the gap by moving the events before it up by one */
+	event = events[(out + idx) % len];
+	for (size_t i = idx; i > 0; i--)
+		events[(out + i) % len] = events[(out + i - 1) % len];
 
-	post_device_event(device, time,
-			  LIBINPUT_EVENT_TOUCH_MOTION,
-			  &touch_event->base);
+	libinput->events_out = (out + 1) % len;
+	libinput->events_count--;
+	if (event_is_priority(event))
+		libinput->events_priority--;
+
+	libinput_queue_latency_update(libinput, &event, 1);
+
+	tracepoint(event_dequeue, event->type, libinput->events_count);
+
+	return event;
 }
 
-void
-touch_notify_touch_up(struct libinput_device *device,
-		      uint64_t time,
-		      int32_t slot,
-		      int32_t seat_slot)
+LIBINPUT_EXPORT size_t
+libinput_get_events(struct libinput *libinput,
+		    struct libinput_event **events,
+		    size_t max_events)
 {
-	struct libinput_event_touch *touch_event;
+	size_t count;
 
-	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
-		return;
+	count = min(max_events, libinput->events_count);
+	if (count == 0)
+		return 0;
 
-	touch_event = zalloc(sizeof *touch_event);
+	libinput_queue_copy(libinput, events, count);
 
-	*touch_event = (struct libinput_event_touch) {
-		.time = time,
-		.slot = slot,
-		.seat_slot = seat_slot,
-	};
+	libinput->events_out = libinput_queue_index(libinput,
+						    libinput->events_out + count);
+	libinput->events_count -= count;
+	for (size_t i = 0; i < count; i++) {
+		if (event_is_priority(events[i]))
+			libinput->events_priority--;
+	}
 
-	post_device_event(device, time,
-			  LIBINPUT_EVENT_TOUCH_UP,
-			  &touch_event->base);
+	libinput_queue_latency_update(libinput, events, count);
+
+	for (size_t i = 0; i < count; i++)
+		tracepoint(event_dequeue,
+			   events[i]->type,
+			   libinput->events_count + count - i - 1);
+
+	return count;
 }
 
-void
-touch_notify_touch_cancel(struct libinput_device *device,
-			  uint64_t time,
-			  int32_t slot,
-			  int32_t seat_slot)
+LIBINPUT_EXPORT int
+libinput_set_event_handoff(struct libinput *libinput,
+			   unsigned int size)
 {
-	struct libinput_event_touch *touch_event;
+	int fd, release_fd;
 
-	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
-		return;
+	if (libinput->handoff.enabled) {
+		log_bug_client(libinput, "Event handoff is already enabled\n");
+		return -1;
+	}
 
-	touch_event = zalloc(sizeof *touch_event);
+	if (libinput->seat_queues) {
+		log_bug_client(libinput,
+			       "Event handoff cannot be used with seat event queues\n");
+		return -1;
+	}
 
-	*touch_event = (struct libinput_event_touch) {
-		.time = time,
-		.slot = slot,
-		.seat_slot = seat_slot,
-	};
+	if (!ring_init(&libinput->handoff.events, size)) {
+		log_bug_client(libinput,
+			       "Invalid event handoff size %u\n",
+			       size);
+		return -1;
+	}
 
-	post_device_event(device, time,
-			  LIBINPUT_EVENT_TOUCH_CANCEL,
-			  &touch_event->base);
-}
+	if (!ring_init(&libinput->handoff.released, size))
+		goto err_released;
 
-void
-touch_notify_frame(struct libinput_device *device,
-		   uint64_t time)
-{
-	struct libinput_event_touch *touch_event;
+	fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (fd < 0)
+		goto err_fd;
 
-	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
-		return;
+	release_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (release_fd < 0)
+		goto err_release_fd;
 
-	touch_event = zalloc(sizeof *touch_event);
+	libinput->handoff.release_source =
+		libinput_add_fd(libinput,
+				release_fd,
+				libinput_handoff_release_dispatch,
+				libinput);
+	if (!libinput->handoff.release_source)
+		goto err_source;
 
-	*touch_event = (struct libinput_event_touch) {
-		.time = time,
-	};
+	libinput->handoff.fd = fd;
+	libinput->handoff.release_fd = release_fd;
+	libinput->handoff.outstanding = 0;
+	libinput->handoff.stalled = false;
+	libinput->handoff.enabled = true;
 
-	post_device_event(device, time,
-			  LIBINPUT_EVENT_TOUCH_FRAME,
-			  &touch_event->base);
+	return 0;
+
+err_source:
+	close(release_fd);
+err_release_fd:
+	close(fd);
+err_fd:
+	ring_destroy(&libinput->handoff.released);
+err_released:
+	ring_destroy(&libinput->handoff.events);
+	return -1;
 }
 
-void
-tablet_notify_axis(struct libinput_device *device,
-		   uint64_t time,
-		   struct libinput_tablet_tool *tool,
-		   enum libinput_tablet_tool_tip_state tip_state,
-		   unsigned char *changed_axes,
-		   const struct tablet_axes *axes)
+LIBINPUT_EXPORT int
+libinput_get_event_handoff_fd(struct libinput *libinput)
+{
+	return libinput->handoff.enabled ? libinput->handoff.fd : -1;
+}
+
+LIBINPUT_EXPORT struct libinput_event *
+libinput_get_handoff_event(struct libinput *libinput)
 {
-	struct libinput_event_tablet_tool *axis_event;
+	struct libinput_event *event;
+	uint64_t counter;
 
-	axis_event = zalloc(sizeof *axis_event);
+	if (!libinput->handoff.enabled)
+		return NULL;
 
-	*axis_event = (struct libinput_event_tablet_tool) {
-		.time = time,
-		.tool = libinput_tablet_tool_ref(tool),
-		.proximity_state = LIBINPUT_TABLET_TOOL_PROXIMITY_STATE_IN,
-		.tip_state = tip_state,
-		.axes = *axes,
-	};
+	event = ring_pop_shared(&libinput->handoff.events);
+	if (event)
+		return event;
 
-	memcpy(axis_event->changed_axes,
-	       changed_axes,
-	       sizeof(axis_event->changed_axes));
+	/* Reset the fd, then look again in case an event was handed over
+	 * in between. Anything handed over after this signals the fd
+	 * again. */
+	if (read(libinput->handoff.fd, &counter, sizeof(counter)) < 0 &&
+	    errno != EAGAIN)
+		return NULL;
 
-	post_device_event(device,
-			  time,
-			  LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			  &axis_event->base);
+	return ring_pop_shared(&libinput->handoff.events);
 }
 
-void
-tablet_notify_proximity(struct libinput_device *device,
-			uint64_t time,
-			struct libinput_tablet_tool *tool,
-			enum libinput_tablet_tool_proximity_state proximity_state,
-			unsigned char *changed_axes,
-			const struct tablet_axes *axes)
+LIBINPUT_EXPORT void
+libinput_handoff_event_release(struct libinput *libinput,
+			       struct libinput_event *event)
 {
-	struct libinput_event_tablet_tool *proximity_event;
+	uint64_t one = 1;
 
-	proximity_event = zalloc(sizeof *proximity_event);
-
-	*proximity_event = (struct libinput_event_tablet_tool) {
-		.time = time,
-		.tool = libinput_tablet_tool_ref(tool),
-		.tip_state = LIBINPUT_TABLET_TOOL_TIP_UP,
-		.proximity_state = proximity_state,
-		.axes = *axes,
-	};
-	memcpy(proximity_event->changed_axes,
-	       changed_axes,
-	       sizeof(proximity_event->changed_axes));
+	/* Can't fail, dispatch never hands over more events than fit */
+	if (!ring_push_shared(&libinput->handoff.released, event))
+		abort();
 
-	post_device_event(device,
-			  time,
-			  LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY,
-			  &proximity_event->base);
+	if (__atomic_exchange_n(&libinput->handoff.stalled, false,
+				__ATOMIC_SEQ_CST) &&
+	    write(libinput->handoff.release_fd, &one, sizeof(one)) < 0)
+		abort();
 }
 
-void
-tablet_notify_tip(struct libinput_device *device,
-		  uint64_t time,
-		  struct libinput_tablet_tool *tool,
-		  enum libinput_tablet_tool_tip_state tip_state,
-		  unsigned char *changed_axes,
-		  const struct tablet_axes *axes)
+LIBINPUT_EXPORT enum libinput_event_type
+libinput_next_event_type(struct libinput *libinput)
 {
-	struct libinput_event_tablet_tool *tip_event;
+	struct libinput_event *event;
 
-	tip_event = zalloc(sizeof *tip_event);
+	if (libinput->events_count == 0)
+		return LIBINPUT_EVENT_NONE;
 
-	*tip_event = (struct libinput_event_tablet_tool) {
-		.time = time,
-		.tool = libinput_tablet_tool_ref(tool),
-		.tip_state = tip_state,
-		.proximity_state = LIBINPUT_TABLET_TOOL_PROXIMITY_STATE_IN,
-		.axes = *axes,
-	};
-	memcpy(tip_event->changed_axes,
-	       changed_axes,
-	       sizeof(tip_event->changed_axes));
+	event = libinput->events[libinput->events_out];
+	return event->type;
+}
 
-	post_device_event(device,
-			  time,
-			  LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			  &tip_event->base);
+LIBINPUT_EXPORT int
+libinput_set_event_coalescing(struct libinput *libinput,
+			      uint32_t mode)
+{
+	uint32_t all = LIBINPUT_EVENT_COALESCING_POINTER_MOTION |
+		       LIBINPUT_EVENT_COALESCING_TOUCH_MOTION |
+		       LIBINPUT_EVENT_COALESCING_TABLET_TOOL_AXIS |
+		       LIBINPUT_EVENT_COALESCING_POINTER_AXIS |
+		       LIBINPUT_EVENT_COALESCING_TABLET_TOOL_HISTORY |
+		       LIBINPUT_EVENT_COALESCING_POINTER_SCROLL |
+		       LIBINPUT_EVENT_COALESCING_SEAT_POINTER_MOTION |
+		       LIBINPUT_EVENT_COALESCING_POINTER_MOTION_ABSOLUTE;
+
+	if (mode & ~all) {
+		log_bug_client(libinput,
+			       "Invalid event coalescing mode %#x\n",
+			       mode);
+		return -1;
+	}
+
+	libinput->event_coalescing = mode;
+	libinput->event_coalescing_set = true;
+
+	return 0;
 }
 
-void
-tablet_notify_button(struct libinput_device *device,
-		     uint64_t time,
-		     struct libinput_tablet_tool *tool,
-		     enum libinput_tablet_tool_tip_state tip_state,
-		     const struct tablet_axes *axes,
-		     int32_t button,
-		     enum libinput_button_state state)
+LIBINPUT_EXPORT uint32_t
+libinput_get_event_coalescing(struct libinput *libinput)
 {
-	struct libinput_event_tablet_tool *button_event;
-	int32_t seat_button_count;
+	return libinput->event_coalescing;
+}
 
-	button_event = zalloc(sizeof *button_event);
+LIBINPUT_EXPORT void
+libinput_set_touch_frame_batching(struct libinput *libinput,
+				  int enable)
+{
+	libinput->touch_frame_batching = !!enable;
+}
 
-	seat_button_count = update_seat_button_count(device->seat,
-						     button,
-						     state);
+LIBINPUT_EXPORT int
+libinput_get_touch_frame_batching(struct libinput *libinput)
+{
+	return libinput->touch_frame_batching;
+}
 
-	*button_event = (struct libinput_event_tablet_tool) {
-		.time = time,
-		.tool = libinput_tablet_tool_ref(tool),
-		.button = button,
-		.state = state,
-		.seat_button_count = seat_button_count,
-		.proximity_state = LIBINPUT_TABLET_TOOL_PROXIMITY_STATE_IN,
-		.tip_state = tip_state,
-		.axes = *axes,
-	};
+LIBINPUT_EXPORT void
+libinput_set_pointer_frame_batching(struct libinput *libinput,
+				    int enable)
+{
+	libinput->pointer_frame_batching = !!enable;
+}
 
-	post_device_event(device,
-			  time,
-			  LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			  &button_event->base);
+LIBINPUT_EXPORT int
+libinput_get_pointer_frame_batching(struct libinput *libinput)
+{
+	return libinput->pointer_frame_batching;
 }
 
-void
-tablet_pad_notify_button(struct libinput_device *device,
-			 uint64_t time,
-			 int32_t button,
-			 enum libinput_button_state state,
-			 struct libinput_tablet_pad_mode_group *group)
+LIBINPUT_EXPORT int
+libinput_set_cache_sharing(struct libinput *libinput,
+			   int enable)
 {
-	struct libinput_event_tablet_pad *button_event;
-	unsigned int mode;
+	/* Too late once the first device or seat was added */
+	if (libinput->quirks_initialized)
+		return -1;
 
-	button_event = zalloc(sizeof *button_event);
+	enable = !!enable;
+	if (enable == libinput->cache_sharing)
+		return 0;
 
-	mode = libinput_tablet_pad_mode_group_get_mode(group);
+	if (shared_caches.quirks.next == NULL)
+		list_init(&shared_caches.quirks);
 
-	*button_event = (struct libinput_event_tablet_pad) {
-		.time = time,
-		.button.number = button,
-		.button.state = state,
-		.mode_group = libinput_tablet_pad_mode_group_ref(group),
-		.mode = mode,
-	};
+	if (enable)
+		shared_caches.contexts++;
+	else
+		shared_caches.contexts--;
 
-	post_device_event(device,
-			  time,
-			  LIBINPUT_EVENT_TABLET_PAD_BUTTON,
-			  &button_event->base);
+#if HAVE_LIBWACOM
+	libinput->libwacom = enable ? &shared_caches.libwacom :
+				      &libinput->libwacom_local;
+#endif
+	libinput->cache_sharing = enable;
+
+	return 0;
 }
 
-void
-tablet_pad_notify_ring(struct libinput_device *device,
-		       uint64_t time,
-		       unsigned int number,
-		       double value,
-		       enum libinput_tablet_pad_ring_axis_source source,
-		       struct libinput_tablet_pad_mode_group *group)
+LIBINPUT_EXPORT int
+libinput_get_cache_sharing(struct libinput *libinput)
 {
-	struct libinput_event_tablet_pad *ring_event;
-	unsigned int mode;
+	return libinput->cache_sharing;
+}
+
+LIBINPUT_EXPORT int
+libinput_set_device_cache(struct libinput *libinput, const char *path)
+{
+	/* The cache is read when the quirks are loaded for the first
+	 * device */
+	if (libinput->quirks_initialized)
+		return -1;
 
-	ring_event = zalloc(sizeof *ring_event);
+	free(libinput->device_cache_path);
+	libinput->device_cache_path = path ? safe_strdup(path) : NULL;
 
-	mode = libinput_tablet_pad_mode_group_get_mode(group);
+	return 0;
+}
 
-	*ring_event = (struct libinput_event_tablet_pad) {
-		.time = time,
-		.ring.number = number,
-		.ring.position = value,
-		.ring.source = source,
-		.mode_group = libinput_tablet_pad_mode_group_ref(group),
-		.mode = mode,
-	};
+LIBINPUT_EXPORT int
+libinput_write_device_cache(struct libinput *libinput)
+{
+	if (!libinput->device_cache_path || libinput->cache_sharing)
+		return -EINVAL;
 
-	post_device_event(device,
-			  time,
-			  LIBINPUT_EVENT_TABLET_PAD_RING,
-			  &ring_event->base);
+	/* No device was added yet, there's nothing to write */
+	if (!libinput->quirks_initialized)
+		return 0;
+
+	if (!libinput->quirks)
+		return -ENOENT;
+
+	return quirks_context_write_device_cache(libinput->quirks);
 }
 
-void
-tablet_pad_notify_strip(struct libinput_device *device,
-			uint64_t time,
-			unsigned int number,
-			double value,
-			enum libinput_tablet_pad_strip_axis_source source,
-			struct libinput_tablet_pad_mode_group *group)
+LIBINPUT_EXPORT void
+libinput_set_queue_latency_tracking(struct libinput *libinput,
+				    int enable)
 {
-	struct libinput_event_tablet_pad *strip_event;
-	unsigned int mode;
+	if (enable && !libinput->queue_latency_tracking)
+		histogram_reset(&libinput->queue_latency);
 
-	strip_event = zalloc(sizeof *strip_event);
+	libinput->queue_latency_tracking = !!enable;
+}
 
-	mode = libinput_tablet_pad_mode_group_get_mode(group);
+LIBINPUT_EXPORT int
+libinput_get_queue_latency_tracking(struct libinput *libinput)
+{
+	return libinput->queue_latency_tracking;
+}
 
-	*strip_event = (struct libinput_event_tablet_pad) {
-		.time = time,
-		.strip.number = number,
-		.strip.position = value,
-		.strip.source = source,
-		.mode_group = libinput_tablet_pad_mode_group_ref(group),
-		.mode = mode,
-	};
+static inline bool
+event_type_is_maskable(enum libinput_event_type type)
+{
+	switch (type) {
+	case LIBINPUT_EVENT_NONE:
+	case LIBINPUT_EVENT_DEVICE_ADDED:
+	case LIBINPUT_EVENT_DEVICE_REMOVED:
+		return false;
+	default:
+		break;
+	}
 
-	post_device_event(device,
-			  time,
-			  LIBINPUT_EVENT_TABLET_PAD_STRIP,
-			  &strip_event->base);
+	return (unsigned int)type / 100 < EVENT_TYPE_MASK_GROUPS &&
+		event_type_to_str(type) != NULL;
 }
 
-void
-tablet_pad_notify_key(struct libinput_device *device,
-		      uint64_t time,
-		      int32_t key,
-		      enum libinput_key_state state)
+static inline void
+event_type_mask_set(uint32_t *mask,
+		    enum libinput_event_type type,
+		    bool enabled)
 {
-	struct libinput_event_tablet_pad *key_event;
+	if (enabled)
+		mask[type / 100] &= ~bit(type % 100);
+	else
+		mask[type / 100] |= bit(type % 100);
+}
 
-	key_event = zalloc(sizeof *key_event);
+LIBINPUT_EXPORT int
+libinput_set_event_type_enabled(struct libinput *libinput,
+				enum libinput_event_type type,
+				int enabled)
+{
+	struct libinput_seat *seat;
+	struct libinput_device *device;
 
-	*key_event = (struct libinput_event_tablet_pad) {
-		.time = time,
-		.key.code = key,
-		.key.state = state,
-	};
+	if (!event_type_is_maskable(type)) {
+		log_bug_client(libinput,
+			       "Invalid event type %d passed to %s()\n",
+			       type, __func__);
+		return -1;
+	}
 
-	post_device_event(device,
-			  time,
-			  LIBINPUT_EVENT_TABLET_PAD_KEY,
-			  &key_event->base);
+	event_type_mask_set(libinput->events_disabled, type, enabled);
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link)
+			event_type_mask_set(device->events_disabled,
+					    type,
+					    enabled);
+	}
+
+	return 0;
 }
 
-static void
-gesture_notify(struct libinput_device *device,
-	       uint64_t time,
-	       enum libinput_event_type type,
-	       int finger_count,
-	       int cancelled,
-	       const struct normalized_coords *delta,
-	       const struct normalized_coords *unaccel,
-	       double scale,
-	       double angle)
+LIBINPUT_EXPORT int
+libinput_get_event_type_enabled(struct libinput *libinput,
+				enum libinput_event_type type)
 {
-	struct libinput_event_gesture *gesture_event;
+	if (!event_type_is_maskable(type))
+		return type == LIBINPUT_EVENT_DEVICE_ADDED ||
+		       type == LIBINPUT_EVENT_DEVICE_REMOVED;
 
-	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_GESTURE))
-		return;
+	return !event_type_is_disabled(libinput->events_disabled, type);
+}
 
-	gesture_event = zalloc(sizeof *gesture_event);
+LIBINPUT_EXPORT void
+libinput_set_user_data(struct libinput *libinput,
+		       void *user_data)
+{
+	libinput->user_data = user_data;
+}
 
-	*gesture_event = (struct libinput_event_gesture) {
-		.time = time,
-		.finger_count = finger_count,
-		.cancelled = cancelled,
-		.delta = *delta,
-		.delta_unaccel = *unaccel,
-		.scale = scale,
-		.angle = angle,
-	};
+LIBINPUT_EXPORT void *
+libinput_get_user_data(struct libinput *libinput)
+{
+	return libinput->user_data;
+}
 
-	post_device_event(device, time, type,
-			  &gesture_event->base);
+LIBINPUT_EXPORT int
+libinput_resume(struct libinput *libinput)
+{
+	return libinput->interface_backend->resume(libinput);
 }
 
-void
-gesture_notify_swipe(struct libinput_device *device,
-		     uint64_t time,
-		     enum libinput_event_type type,
-		     int finger_count,
-		     const struct normalized_coords *delta,
-		     const struct normalized_coords *unaccel)
+LIBINPUT_EXPORT void
+libinput_suspend(struct libinput *libinput)
 {
-	gesture_notify(device, time, type, finger_count, 0, delta, unaccel,
-		       0.0, 0.0);
+	libinput->interface_backend->suspend(libinput);
 }
 
-void
-gesture_notify_swipe_end(struct libinput_device *device,
-			 uint64_t time,
-			 int finger_count,
-			 int cancelled)
+LIBINPUT_EXPORT void
+libinput_device_set_user_data(struct libinput_device *device, void *user_data)
 {
-	const struct normalized_coords zero = { 0.0, 0.0 };
+	device->user_data = user_data;
+}
 
-	gesture_notify(device, time, LIBINPUT_EVENT_GESTURE_SWIPE_END,
-		       finger_count, cancelled, &zero, &zero, 0.0, 0.0);
+LIBINPUT_EXPORT void *
+libinput_device_get_user_data(struct libinput_device *device)
+{
+	return device->user_data;
 }
 
-void
-gesture_notify_pinch(struct libinput_device *device,
-		     uint64_t time,
-		     enum libinput_event_type type,
-		     int finger_count,
-		     const struct normalized_coords *delta,
-		     const struct normalized_coords *unaccel,
-		     double scale,
-		     double angle)
+LIBINPUT_EXPORT int
+libinput_device_set_event_type_enabled(struct libinput_device *device,
+				       enum libinput_event_type type,
+				       int enabled)
 {
-	gesture_notify(device, time, type, finger_count, 0,
-		       delta, unaccel, scale, angle);
+	if (!event_type_is_maskable(type)) {
+		log_bug_client(device->seat->libinput,
+			       "Invalid event type %d passed to %s()\n",
+			       type, __func__);
+		return -1;
+	}
+
+	event_type_mask_set(device->events_disabled, type, enabled);
+
+	return 0;
 }
 
-void
-gesture_notify_pinch_end(struct libinput_device *device,
-			 uint64_t time,
-			 int finger_count,
-			 double scale,
-			 int cancelled)
+LIBINPUT_EXPORT int
+libinput_device_get_event_type_enabled(struct libinput_device *device,
+				       enum libinput_event_type type)
 {
-	const struct normalized_coords zero = { 0.0, 0.0 };
+	if (!event_type_is_maskable(type))
+		return type == LIBINPUT_EVENT_DEVICE_ADDED ||
+		       type == LIBINPUT_EVENT_DEVICE_REMOVED;
 
-	gesture_notify(device, time, LIBINPUT_EVENT_GESTURE_PINCH_END,
-		       finger_count, cancelled, &zero, &zero, scale, 0.0);
+	return !event_type_is_disabled(device->events_disabled, type);
 }
 
-void
-switch_notify_toggle(struct libinput_device *device,
-		     uint64_t time,
-		     enum libinput_switch sw,
-		     enum libinput_switch_state state)
+LIBINPUT_EXPORT void
+libinput_device_set_latency_tracking(struct libinput_device *device,
+				     int enable)
 {
-	struct libinput_event_switch *switch_event;
+	struct histogram *h;
 
-	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_SWITCH))
-		return;
+	if (enable && !device->latency_tracking) {
+		histogram_reset(&device->latency);
+		histogram_reset(&device->first_motion_latency);
+		ARRAY_FOR_EACH(device->delay, h)
+			histogram_reset(h);
+	}
 
-	switch_event = zalloc(sizeof *switch_event);
+	device->latency_tracking = !!enable;
+}
 
-	*switch_event = (struct libinput_event_switch) {
-		.time = time,
-		.sw = sw,
-		.state = state,
-	};
+LIBINPUT_EXPORT int
+libinput_device_get_latency_tracking(struct libinput_device *device)
+{
+	return device->latency_tracking;
+}
 
-	post_device_event(device, time,
-			  LIBINPUT_EVENT_SWITCH_TOGGLE,
-			  &switch_event->base);
+LIBINPUT_EXPORT uint64_t
+libinput_device_get_latency_stats(struct libinput_device *device,
+				  enum libinput_latency_stat stat)
+{
+	switch (stat) {
+	case LIBINPUT_LATENCY_STAT_SAMPLES:
+		return device->latency.count;
+	case LIBINPUT_LATENCY_STAT_P50:
+		return histogram_percentile(&device->latency, 50);
+	case LIBINPUT_LATENCY_STAT_P99:
+		return histogram_percentile(&device->latency, 99);
+	case LIBINPUT_LATENCY_STAT_MAX:
+		return device->latency.max;
+	case LIBINPUT_LATENCY_STAT_FIRST_MOTION_SAMPLES:
+		return device->first_motion_latency.count;
+	case LIBINPUT_LATENCY_STAT_FIRST_MOTION_P50:
+		return histogram_percentile(&device->first_motion_latency, 50);
+	case LIBINPUT_LATENCY_STAT_FIRST_MOTION_P99:
+		return histogram_percentile(&device->first_motion_latency, 99);
+	case LIBINPUT_LATENCY_STAT_FIRST_MOTION_MAX:
+		return device->first_motion_latency.max;
+	case LIBINPUT_LATENCY_STAT_MIDDLEBUTTON_SAMPLES:
+		return libinput_device_get_delay_stats(device,
+						       LIBINPUT_DELAY_SOURCE_MIDDLEBUTTON,
+						       LIBINPUT_LATENCY_STAT_SAMPLES);
+	case LIBINPUT_LATENCY_STAT_MIDDLEBUTTON_P50:
+		return libinput_device_get_delay_stats(device,
+						       LIBINPUT_DELAY_SOURCE_MIDDLEBUTTON,
+						       LIBINPUT_LATENCY_STAT_P50);
+	case LIBINPUT_LATENCY_STAT_MIDDLEBUTTON_P99:
+		return libinput_device_get_delay_stats(device,
+						       LIBINPUT_DELAY_SOURCE_MIDDLEBUTTON,
+						       LIBINPUT_LATENCY_STAT_P99);
+	case LIBINPUT_LATENCY_STAT_MIDDLEBUTTON_MAX:
+		return libinput_device_get_delay_stats(device,
+						       LIBINPUT_DELAY_SOURCE_MIDDLEBUTTON,
+						       LIBINPUT_LATENCY_STAT_MAX);
+	}
 
-#ifdef __clang_analyzer__
-	/* clang doesn't realize we're not leaking the event here, so
-	 * pretend to free it  */
-	free(switch_event);
-#endif
+	return 0;
 }
 
-static void
-libinput_post_event(struct libinput *libinput,
-		    struct libinput_event *event)
+LIBINPUT_EXPORT uint64_t
+libinput_device_get_delay_stats(struct libinput_device *device,
+				enum libinput_delay_source source,
+				enum libinput_latency_stat stat)
 {
-	struct libinput_event **events = libinput->events;
-	size_t events_len = libinput->events_len;
-	size_t events_count = libinput->events_count;
-	size_t move_len;
-	size_t new_out;
+	const struct histogram *h;
 
-#if 0
-	log_debug(libinput, "Queuing %s\n", event_type_to_str(event->type));
-#endif
+	if (source >= DELAY_SOURCE_COUNT)
+		return 0;
 
-	events_count++;
-	if (events_count > events_len) {
-		void *tmp;
+	h = &device->delay[source];
+
+	switch (stat) {
+	case LIBINPUT_LATENCY_STAT_SAMPLES:
+		return h->count;
+	case LIBINPUT_LATENCY_STAT_P50:
+		return histogram_percentile(h, 50);
+	case LIBINPUT_LATENCY_STAT_P99:
+		return histogram_percentile(h, 99);
+	case LIBINPUT_LATENCY_STAT_MAX:
+		return h->max;
+	default:
+		break;
+	}
 
-		events_len *= 2;
-		tmp = realloc(events, events_len * sizeof *events);
-		if (!tmp) {
-			log_error(libinput,
-				  "Failed to reallocate event ring buffer. "
-				  "Events may be discarded\n");
-			return;
-		}
+	return 0;
+}
 
-		events = tmp;
-
-		if (libinput->events_count > 0 && libinput->events_in == 0) {
-			libinput->events_in = libinput->events_len;
-		} else if (libinput->events_count > 0 &&
-			   libinput->events_out >= libinput->events_in) {
-			move_len = libinput->events_len - libinput->events_out;
-			new_out = events_len - move_len;
-			memmove(events + new_out,
-				events + libinput->events_out,
-				move_len * sizeof *events);
-			libinput->events_out = new_out;
-		}
+LIBINPUT_EXPORT uint64_t
+libinput_device_get_stats(struct libinput_device *device,
+			  enum libinput_device_stat stat)
+{
+	if ((unsigned int)stat >= DEVICE_STAT_COUNT)
+		return 0;
 
-		libinput->events = events;
-		libinput->events_len = events_len;
-	}
+	return device->stats[stat];
+}
 
-	if (event->device)
-		libinput_device_ref(event->device);
+LIBINPUT_EXPORT uint64_t
+libinput_device_get_event_count(struct libinput_device *device,
+				enum libinput_event_type type)
+{
+	if ((unsigned int)type / 100 >= EVENT_TYPE_MASK_GROUPS ||
+	    type % 100 >= EVENT_TYPES_PER_GROUP)
+		return 0;
 
-	libinput->events_count = events_count;
-	events[libinput->events_in] = event;
-	libinput->events_in = (libinput->events_in + 1) % libinput->events_len;
+	return device->event_count[type / 100][type % 100];
 }
 
-LIBINPUT_EXPORT struct libinput_event *
-libinput_get_event(struct libinput *libinput)
+LIBINPUT_EXPORT uint64_t
+libinput_device_get_startup_time(struct libinput_device *device,
+				 enum libinput_startup_phase phase)
 {
-	struct libinput_event *event;
+	if (phase < LIBINPUT_STARTUP_PHASE_QUIRKS ||
+	    phase > LIBINPUT_STARTUP_PHASE_NOTIFY)
+		return 0;
 
-	if (libinput->events_count == 0)
-		return NULL;
+	return device->startup_time[phase];
+}
 
-	event = libinput->events[libinput->events_out];
-	libinput->events_out =
-		(libinput->events_out + 1) % libinput->events_len;
-	libinput->events_count--;
+LIBINPUT_EXPORT uint64_t
+libinput_device_get_memory_stats(struct libinput_device *device,
+				 enum libinput_memory_stat stat)
+{
+	struct libinput *libinput = device->seat->libinput;
+
+	switch (stat) {
+	case LIBINPUT_MEMORY_STAT_TOTAL:
+		return device_memory_usage(device, LIBINPUT_MEMORY_STAT_DEVICES) +
+			device_memory_usage(device, LIBINPUT_MEMORY_STAT_DISPATCH) +
+			event_queue_memory_usage(libinput, device);
+	case LIBINPUT_MEMORY_STAT_EVENT_QUEUE:
+		return event_queue_memory_usage(libinput, device);
+	case LIBINPUT_MEMORY_STAT_DEVICES:
+	case LIBINPUT_MEMORY_STAT_DISPATCH:
+		return device_memory_usage(device, stat);
+	case LIBINPUT_MEMORY_STAT_CONTEXT:
+	case LIBINPUT_MEMORY_STAT_EVENT_CACHE:
+	case LIBINPUT_MEMORY_STAT_TIMERS:
+	case LIBINPUT_MEMORY_STAT_QUIRKS:
+	case LIBINPUT_MEMORY_STAT_TABLET_TOOLS:
+	case LIBINPUT_MEMORY_STAT_LOG_RING:
+		return 0;
+	}
 
-	return event;
+	return 0;
 }
 
-LIBINPUT_EXPORT enum libinput_event_type
-libinput_next_event_type(struct libinput *libinput)
+LIBINPUT_EXPORT int
+libinput_device_set_motion_prediction(struct libinput_device *device,
+				      int enable)
 {
-	struct libinput_event *event;
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER) &&
+	    !device_has_cap(device, LIBINPUT_DEVICE_CAP_TABLET_TOOL))
+		return -1;
 
-	if (libinput->events_count == 0)
-		return LIBINPUT_EVENT_NONE;
+	if (!enable) {
+		motion_predictor_destroy(device->predictor);
+		device->predictor = NULL;
+	} else if (!device->predictor) {
+		device->predictor = motion_predictor_create();
+	}
 
-	event = libinput->events[libinput->events_out];
-	return event->type;
+	return 0;
 }
 
-LIBINPUT_EXPORT void
-libinput_set_user_data(struct libinput *libinput,
-		       void *user_data)
+LIBINPUT_EXPORT int
+libinput_device_get_motion_prediction(struct libinput_device *device)
 {
-	libinput->user_data = user_data;
+	return device->predictor != NULL;
 }
 
-LIBINPUT_EXPORT void *
-libinput_get_user_data(struct libinput *libinput)
+LIBINPUT_EXPORT int
+libinput_device_set_priority(struct libinput_device *device,
+			     enum libinput_device_priority priority)
 {
-	return libinput->user_data;
+	switch (priority) {
+	case LIBINPUT_DEVICE_PRIORITY_NORMAL:
+	case LIBINPUT_DEVICE_PRIORITY_LOW:
+		break;
+	default:
+		return -1;
+	}
+
+	evdev_device_set_low_priority(evdev_device(device),
+				      priority == LIBINPUT_DEVICE_PRIORITY_LOW);
+
+	return 0;
 }
 
-LIBINPUT_EXPORT int
-libinput_resume(struct libinput *libinput)
+LIBINPUT_EXPORT enum libinput_device_priority
+libinput_device_get_priority(struct libinput_device *device)
 {
-	return libinput->interface_backend->resume(libinput);
+	return evdev_device(device)->low_priority ?
+		LIBINPUT_DEVICE_PRIORITY_LOW :
+		LIBINPUT_DEVICE_PRIORITY_NORMAL;
 }
 
-LIBINPUT_EXPORT void
-libinput_suspend(struct libinput *libinput)
+LIBINPUT_EXPORT int
+libinput_device_predict_motion(struct libinput_device *device,
+			       uint64_t time_usec,
+			       double *dx,
+			       double *dy)
 {
-	libinput->interface_backend->suspend(libinput);
+	struct device_float_coords delta;
+
+	if (!device->predictor ||
+	    !motion_predictor_predict(device->predictor, time_usec, &delta))
+		return -1;
+
+	*dx = delta.x;
+	*dy = delta.y;
+
+	return 0;
 }
 
-LIBINPUT_EXPORT void
-libinput_device_set_user_data(struct libinput_device *device, void *user_data)
+LIBINPUT_EXPORT size_t
+libinput_device_save_state(struct libinput_device *device,
+			   void *buf,
+			   size_t size)
 {
-	device->user_data = user_data;
+	return evdev_device_save_state((struct evdev_device *) device,
+				       buf, size);
 }
 
-LIBINPUT_EXPORT void *
-libinput_device_get_user_data(struct libinput_device *device)
+LIBINPUT_EXPORT int
+libinput_device_restore_state(struct libinput_device *device,
+			      const void *buf,
+			      size_t size)
 {
-	return device->user_data;
+	if (!buf)
+		return -EINVAL;
+
+	return evdev_device_restore_state((struct evdev_device *) device,
+					  buf, size);
 }
 
 LIBINPUT_EXPORT struct libinput *
@@ -3046,6 +9578,12 @@ libinput_device_get_sysname(struct libinput_device *device)
 	return evdev_device_get_sysname((struct evdev_device *) device);
 }
 
+LIBINPUT_EXPORT uint32_t
+libinput_device_get_id(struct libinput_device *device)
+{
+	return device->id;
+}
+
 LIBINPUT_EXPORT const char *
 libinput_device_get_name(struct libinput_device *device)
 {
@@ -3120,6 +9658,16 @@ libinput_device_get_size(struct libinput_device *device,
 				     height);
 }
 
+LIBINPUT_EXPORT int
+libinput_device_set_output_size(struct libinput_device *device,
+				uint32_t width,
+				uint32_t height)
+{
+	return evdev_device_set_output_size(evdev_device(device),
+					    width,
+					    height);
+}
+
 LIBINPUT_EXPORT int
 libinput_device_pointer_has_button(struct libinput_device *device, uint32_t code)
 {
@@ -3317,7 +9865,8 @@ libinput_event_pointer_get_base_event(struct libinput_event_pointer *event)
 			   LIBINPUT_EVENT_POINTER_MOTION,
 			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
 			   LIBINPUT_EVENT_POINTER_BUTTON,
-			   LIBINPUT_EVENT_POINTER_AXIS);
+			   LIBINPUT_EVENT_POINTER_AXIS,
+			   LIBINPUT_EVENT_POINTER_FRAME);
 
 	return &event->base;
 }
@@ -3552,6 +10101,102 @@ libinput_device_group_ref(struct libinput_device_group *group)
 	return group;
 }
 
+#define GROUP_HASH_MIN_SIZE 16
+
+static char group_hash_tombstone;
+#define GROUP_HASH_TOMBSTONE ((struct libinput_device_group *)&group_hash_tombstone)
+
+static inline size_t
+group_hash_index(const struct libinput *libinput, const char *identifier)
+{
+	/* FNV-1a */
+	uint32_t hash = 2166136261u;
+
+	for (const char *c = identifier; *c; c++) {
+		hash ^= (unsigned char)*c;
+		hash *= 16777619u;
+	}
+
+	return hash & (libinput->group_hash.size - 1);
+}
+
+static void
+group_hash_place(struct libinput *libinput,
+		 struct libinput_device_group *group)
+{
+	size_t mask = libinput->group_hash.size - 1;
+	size_t idx = group_hash_index(libinput, group->identifier);
+
+	while (libinput->group_hash.slots[idx] &&
+	       libinput->group_hash.slots[idx] != GROUP_HASH_TOMBSTONE)
+		idx = (idx + 1) & mask;
+
+	if (!libinput->group_hash.slots[idx])
+		libinput->group_hash.used++;
+	libinput->group_hash.slots[idx] = group;
+	libinput->group_hash.count++;
+}
+
+static void
+group_hash_resize(struct libinput *libinput, size_t size)
+{
+	struct libinput_device_group **old = libinput->group_hash.slots;
+	size_t old_size = libinput->group_hash.size;
+
+	libinput->group_hash.slots = zalloc(size * sizeof(*old));
+	libinput->group_hash.size = size;
+	libinput->group_hash.count = 0;
+	libinput->group_hash.used = 0;
+
+	for (size_t i = 0; i < old_size; i++) {
+		if (old[i] && old[i] != GROUP_HASH_TOMBSTONE)
+			group_hash_place(libinput, old[i]);
+	}
+
+	free(old);
+}
+
+static void
+group_hash_insert(struct libinput *libinput,
+		  struct libinput_device_group *group)
+{
+	size_t size = libinput->group_hash.size;
+
+	/* Keep the load including tombstones below 3/4, grow only if the
+	 * live entries need it, otherwise rehashing just drops the
+	 * tombstones */
+	if ((libinput->group_hash.used + 1) * 4 > size * 3) {
+		if ((libinput->group_hash.count + 1) * 2 > size)
+			size = max(size * 2, (size_t)GROUP_HASH_MIN_SIZE);
+		group_hash_resize(libinput, size);
+	}
+
+	group_hash_place(libinput, group);
+}
+
+static void
+group_hash_remove(struct libinput *libinput,
+		  struct libinput_device_group *group)
+{
+	size_t mask, idx;
+	struct libinput_device_group *g;
+
+	if (libinput->group_hash.size == 0)
+		return;
+
+	mask = libinput->group_hash.size - 1;
+	idx = group_hash_index(libinput, group->identifier);
+
+	while ((g = libinput->group_hash.slots[idx])) {
+		if (g == group) {
+			libinput->group_hash.slots[idx] = GROUP_HASH_TOMBSTONE;
+			libinput->group_hash.count--;
+			return;
+		}
+		idx = (idx + 1) & mask;
+	}
+}
+
 struct libinput_device_group *
 libinput_device_group_create(struct libinput *libinput,
 			     const char *identifier)
@@ -3561,9 +10206,11 @@ libinput_device_group_create(struct libinput *libinput,
 	group = zalloc(sizeof *group);
 	group->refcount = 1;
 	group->identifier = safe_strdup(identifier);
+	group->libinput = libinput;
 
-	list_init(&group->link);
-	list_insert(&libinput->device_group_list, &group->link);
+	ptr_array_append(&libinput->device_groups, group);
+	if (group->identifier)
+		group_hash_insert(libinput, group);
 
 	return group;
 }
@@ -3572,13 +10219,34 @@ struct libinput_device_group *
 libinput_device_group_find_group(struct libinput *libinput,
 				 const char *identifier)
 {
-	struct libinput_device_group *g = NULL;
+	size_t mask, idx;
+	struct libinput_device_group *g;
+
+	if (!identifier || libinput->group_hash.size == 0)
+		return NULL;
+
+	mask = libinput->group_hash.size - 1;
+	idx = group_hash_index(libinput, identifier);
+
+	while ((g = libinput->group_hash.slots[idx])) {
+		if (g != GROUP_HASH_TOMBSTONE &&
+		    streq(g->identifier, identifier))
+			return g;
+		idx = (idx + 1) & mask;
+	}
+
+	return NULL;
+}
+
+struct libinput_device_group *
+libinput_device_group_find_key(struct libinput *libinput,
+			       const char *key)
+{
+	struct libinput_device_group *g;
 
-	list_for_each(g, &libinput->device_group_list, link) {
-		if (identifier && g->identifier &&
-		    streq(g->identifier, identifier)) {
+	ptr_array_for_each(g, &libinput->device_groups) {
+		if (g->key && streq(g->key, key))
 			return g;
-		}
 	}
 
 	return NULL;
@@ -3595,8 +10263,11 @@ libinput_device_set_device_group(struct libinput_device *device,
 static void
 libinput_device_group_destroy(struct libinput_device_group *group)
 {
-	list_remove(&group->link);
+	ptr_array_remove(&group->libinput->device_groups, group);
+	if (group->identifier)
+		group_hash_remove(group->libinput, group);
 	free(group->identifier);
+	free(group->key);
 	free(group);
 }
 
@@ -3646,6 +10317,31 @@ libinput_config_status_to_str(enum libinput_config_status status)
 	return str;
 }
 
+LIBINPUT_EXPORT enum libinput_config_status
+libinput_device_config_begin(struct libinput_device *device)
+{
+	if (device->config_transaction)
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	device->config_transaction = true;
+
+	return LIBINPUT_CONFIG_STATUS_SUCCESS;
+}
+
+LIBINPUT_EXPORT enum libinput_config_status
+libinput_device_config_commit(struct libinput_device *device)
+{
+	if (!device->config_transaction)
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	device->config_transaction = false;
+
+	if (device->config.transaction)
+		device->config.transaction->commit(device);
+
+	return LIBINPUT_CONFIG_STATUS_SUCCESS;
+}
+
 LIBINPUT_EXPORT int
 libinput_device_config_tap_get_finger_count(struct libinput_device *device)
 {
@@ -3788,6 +10484,39 @@ libinput_device_config_tap_get_default_drag_lock_enabled(struct libinput_device
 	return device->config.tap->get_default_draglock_enabled(device);
 }
 
+LIBINPUT_EXPORT enum libinput_config_status
+libinput_device_config_tap_set_early_commit_enabled(struct libinput_device *device,
+						    enum libinput_config_tap_early_commit_state enable)
+{
+	if (enable != LIBINPUT_CONFIG_TAP_EARLY_COMMIT_ENABLED &&
+	    enable != LIBINPUT_CONFIG_TAP_EARLY_COMMIT_DISABLED)
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	if (libinput_device_config_tap_get_finger_count(device) == 0)
+		return enable ? LIBINPUT_CONFIG_STATUS_UNSUPPORTED :
+				LIBINPUT_CONFIG_STATUS_SUCCESS;
+
+	return device->config.tap->set_early_commit_enabled(device, enable);
+}
+
+LIBINPUT_EXPORT enum libinput_config_tap_early_commit_state
+libinput_device_config_tap_get_early_commit_enabled(struct libinput_device *device)
+{
+	if (libinput_device_config_tap_get_finger_count(device) == 0)
+		return LIBINPUT_CONFIG_TAP_EARLY_COMMIT_DISABLED;
+
+	return device->config.tap->get_early_commit_enabled(device);
+}
+
+LIBINPUT_EXPORT enum libinput_config_tap_early_commit_state
+libinput_device_config_tap_get_default_early_commit_enabled(struct libinput_device *device)
+{
+	if (libinput_device_config_tap_get_finger_count(device) == 0)
+		return LIBINPUT_CONFIG_TAP_EARLY_COMMIT_DISABLED;
+
+	return device->config.tap->get_default_early_commit_enabled(device);
+}
+
 LIBINPUT_EXPORT int
 libinput_device_config_calibration_has_matrix(struct libinput_device *device)
 {
@@ -3936,6 +10665,7 @@ libinput_device_config_accel_set_profile(struct libinput_device *device,
 	switch (profile) {
 	case LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT:
 	case LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE:
+	case LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM:
 		break;
 	default:
 		return LIBINPUT_CONFIG_STATUS_INVALID;
@@ -3948,6 +10678,35 @@ libinput_device_config_accel_set_profile(struct libinput_device *device,
 	return device->config.accel->set_profile(device, profile);
 }
 
+LIBINPUT_EXPORT enum libinput_config_status
+libinput_device_config_accel_set_custom_curve(struct libinput_device *device,
+					      double step,
+					      const double *points,
+					      size_t npoints)
+{
+	size_t i;
+
+	if (!isfinite(step) || step <= 0.0 ||
+	    !points || npoints < 2 || npoints > CUSTOM_ACCEL_NPOINTS_MAX)
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	for (i = 0; i < npoints; i++) {
+		if (!isfinite(points[i]) || points[i] < 0.0)
+			return LIBINPUT_CONFIG_STATUS_INVALID;
+	}
+
+	if (!libinput_device_config_accel_is_available(device) ||
+	    !device->config.accel->set_custom_curve ||
+	    (libinput_device_config_accel_get_profiles(device) &
+	     LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM) == 0)
+		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+
+	return device->config.accel->set_custom_curve(device,
+						      step,
+						      points,
+						      npoints);
+}
+
 LIBINPUT_EXPORT int
 libinput_device_config_scroll_has_natural_scroll(struct libinput_device *device)
 {
@@ -4292,6 +11051,48 @@ libinput_device_config_dwt_get_default_enabled(struct libinput_device *device)
 	return device->config.dwt->get_default_enabled(device);
 }
 
+LIBINPUT_EXPORT int
+libinput_device_config_low_latency_is_available(struct libinput_device *device)
+{
+	if (!device->config.low_latency)
+		return 0;
+
+	return device->config.low_latency->is_available(device);
+}
+
+LIBINPUT_EXPORT enum libinput_config_status
+libinput_device_config_low_latency_set_enabled(struct libinput_device *device,
+					       enum libinput_config_low_latency_state enable)
+{
+	if (enable != LIBINPUT_CONFIG_LOW_LATENCY_ENABLED &&
+	    enable != LIBINPUT_CONFIG_LOW_LATENCY_DISABLED)
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	if (!libinput_device_config_low_latency_is_available(device))
+		return enable ? LIBINPUT_CONFIG_STATUS_UNSUPPORTED :
+				LIBINPUT_CONFIG_STATUS_SUCCESS;
+
+	return device->config.low_latency->set_enabled(device, enable);
+}
+
+LIBINPUT_EXPORT enum libinput_config_low_latency_state
+libinput_device_config_low_latency_get_enabled(struct libinput_device *device)
+{
+	if (!libinput_device_config_low_latency_is_available(device))
+		return LIBINPUT_CONFIG_LOW_LATENCY_DISABLED;
+
+	return device->config.low_latency->get_enabled(device);
+}
+
+LIBINPUT_EXPORT enum libinput_config_low_latency_state
+libinput_device_config_low_latency_get_default_enabled(struct libinput_device *device)
+{
+	if (!libinput_device_config_low_latency_is_available(device))
+		return LIBINPUT_CONFIG_LOW_LATENCY_DISABLED;
+
+	return device->config.low_latency->get_default_enabled(device);
+}
+
 LIBINPUT_EXPORT int
 libinput_device_config_rotation_is_available(struct libinput_device *device)
 {
@@ -4333,39 +11134,310 @@ libinput_device_config_rotation_get_default_angle(struct libinput_device *device
 	return device->config.rotation->get_default_angle(device);
 }
 
+static void
+config_snapshot_fill_tap(struct libinput_device *device,
+			 struct libinput_config_snapshot *s)
+{
+	struct libinput_device_config_tap *tap = device->config.tap;
+
+	s->tap.finger_count = tap ? tap->count(device) : 0;
+	if (s->tap.finger_count == 0) {
+		s->tap.enabled = LIBINPUT_CONFIG_TAP_DISABLED;
+		s->tap.default_enabled = LIBINPUT_CONFIG_TAP_DISABLED;
+		s->tap.button_map = LIBINPUT_CONFIG_TAP_MAP_LRM;
+		s->tap.default_button_map = LIBINPUT_CONFIG_TAP_MAP_LRM;
+		s->tap.drag = LIBINPUT_CONFIG_DRAG_DISABLED;
+		s->tap.default_drag = LIBINPUT_CONFIG_DRAG_DISABLED;
+		s->tap.drag_lock = LIBINPUT_CONFIG_DRAG_LOCK_DISABLED;
+		s->tap.default_drag_lock = LIBINPUT_CONFIG_DRAG_LOCK_DISABLED;
+		s->tap.early_commit = LIBINPUT_CONFIG_TAP_EARLY_COMMIT_DISABLED;
+		s->tap.default_early_commit = LIBINPUT_CONFIG_TAP_EARLY_COMMIT_DISABLED;
+		return;
+	}
+
+	s->tap.enabled = tap->get_enabled(device);
+	s->tap.default_enabled = tap->get_default(device);
+	s->tap.button_map = tap->get_map(device);
+	s->tap.default_button_map = tap->get_default_map(device);
+	s->tap.drag = tap->get_drag_enabled(device);
+	s->tap.default_drag = tap->get_default_drag_enabled(device);
+	s->tap.drag_lock = tap->get_draglock_enabled(device);
+	s->tap.default_drag_lock = tap->get_default_draglock_enabled(device);
+	s->tap.early_commit = tap->get_early_commit_enabled(device);
+	s->tap.default_early_commit =
+		tap->get_default_early_commit_enabled(device);
+}
+
+static void
+config_snapshot_fill_pointer(struct libinput_device *device,
+			     struct libinput_config_snapshot *s)
+{
+	struct libinput_device_config *config = &device->config;
+
+	s->accel.available = config->accel ?
+		config->accel->available(device) : 0;
+	if (s->accel.available) {
+		s->accel.speed = config->accel->get_speed(device);
+		s->accel.default_speed = config->accel->get_default_speed(device);
+		s->accel.profiles = config->accel->get_profiles(device);
+		s->accel.profile = config->accel->get_profile(device);
+		s->accel.default_profile =
+			config->accel->get_default_profile(device);
+	} else {
+		s->accel.profile = LIBINPUT_CONFIG_ACCEL_PROFILE_NONE;
+		s->accel.default_profile = LIBINPUT_CONFIG_ACCEL_PROFILE_NONE;
+	}
+
+	if (config->natural_scroll) {
+		s->natural_scroll.available = config->natural_scroll->has(device);
+		s->natural_scroll.enabled =
+			config->natural_scroll->get_enabled(device);
+		s->natural_scroll.default_enabled =
+			config->natural_scroll->get_default_enabled(device);
+	}
+
+	s->left_handed.available = config->left_handed ?
+		config->left_handed->has(device) : 0;
+	if (s->left_handed.available) {
+		s->left_handed.enabled = config->left_handed->get(device);
+		s->left_handed.default_enabled =
+			config->left_handed->get_default(device);
+	}
+
+	if (config->click_method) {
+		s->click.methods = config->click_method->get_methods(device);
+		s->click.method = config->click_method->get_method(device);
+		s->click.default_method =
+			config->click_method->get_default_method(device);
+	} else {
+		s->click.method = LIBINPUT_CONFIG_CLICK_METHOD_NONE;
+		s->click.default_method = LIBINPUT_CONFIG_CLICK_METHOD_NONE;
+	}
+
+	s->middle_emulation.available = config->middle_emulation ?
+		config->middle_emulation->available(device) : 0;
+	if (s->middle_emulation.available) {
+		s->middle_emulation.enabled =
+			config->middle_emulation->get(device);
+		s->middle_emulation.default_enabled =
+			config->middle_emulation->get_default(device);
+	} else {
+		s->middle_emulation.enabled =
+			LIBINPUT_CONFIG_MIDDLE_EMULATION_DISABLED;
+		s->middle_emulation.default_enabled =
+			LIBINPUT_CONFIG_MIDDLE_EMULATION_DISABLED;
+	}
+
+	if (config->scroll_method) {
+		s->scroll.methods = config->scroll_method->get_methods(device);
+		s->scroll.method = config->scroll_method->get_method(device);
+		s->scroll.default_method =
+			config->scroll_method->get_default_method(device);
+	} else {
+		s->scroll.method = LIBINPUT_CONFIG_SCROLL_NO_SCROLL;
+		s->scroll.default_method = LIBINPUT_CONFIG_SCROLL_NO_SCROLL;
+	}
+
+	if (s->scroll.methods & LIBINPUT_CONFIG_SCROLL_ON_BUTTON_DOWN) {
+		s->scroll.button = config->scroll_method->get_button(device);
+		s->scroll.default_button =
+			config->scroll_method->get_default_button(device);
+		s->scroll.button_lock =
+			config->scroll_method->get_button_lock(device);
+		s->scroll.default_button_lock =
+			config->scroll_method->get_default_button_lock(device);
+	} else {
+		s->scroll.button_lock =
+			LIBINPUT_CONFIG_SCROLL_BUTTON_LOCK_DISABLED;
+		s->scroll.default_button_lock =
+			LIBINPUT_CONFIG_SCROLL_BUTTON_LOCK_DISABLED;
+	}
+}
+
+LIBINPUT_EXPORT int
+libinput_device_config_get_snapshot(struct libinput_device *device,
+				    struct libinput_config_snapshot *snapshot,
+				    size_t size)
+{
+	struct libinput_device_config *config = &device->config;
+	struct libinput_config_snapshot s = {
+		.version = LIBINPUT_CONFIG_SNAPSHOT_VERSION,
+	};
+
+	if (size < sizeof(s.version)) {
+		log_bug_client(libinput_device_get_context(device),
+			       "config snapshot size %zd too small\n",
+			       size);
+		return -1;
+	}
+
+	config_snapshot_fill_tap(device, &s);
+	config_snapshot_fill_pointer(device, &s);
+
+	s.calibration.has_matrix = config->calibration ?
+		config->calibration->has_matrix(device) : 0;
+	if (s.calibration.has_matrix) {
+		config->calibration->get_matrix(device, s.calibration.matrix);
+		config->calibration->get_default_matrix(device,
+							s.calibration.default_matrix);
+	}
+
+	s.send_events.modes = LIBINPUT_CONFIG_SEND_EVENTS_ENABLED;
+	s.send_events.mode = LIBINPUT_CONFIG_SEND_EVENTS_ENABLED;
+	s.send_events.default_mode = LIBINPUT_CONFIG_SEND_EVENTS_ENABLED;
+	if (config->sendevents) {
+		s.send_events.modes |= config->sendevents->get_modes(device);
+		s.send_events.mode = config->sendevents->get_mode(device);
+	}
+
+	s.dwt.available = config->dwt ? config->dwt->is_available(device) : 0;
+	if (s.dwt.available) {
+		s.dwt.enabled = config->dwt->get_enabled(device);
+		s.dwt.default_enabled = config->dwt->get_default_enabled(device);
+	} else {
+		s.dwt.enabled = LIBINPUT_CONFIG_DWT_DISABLED;
+		s.dwt.default_enabled = LIBINPUT_CONFIG_DWT_DISABLED;
+	}
+
+	s.low_latency.available = config->low_latency ?
+		config->low_latency->is_available(device) : 0;
+	if (s.low_latency.available) {
+		s.low_latency.enabled = config->low_latency->get_enabled(device);
+		s.low_latency.default_enabled =
+			config->low_latency->get_default_enabled(device);
+	} else {
+		s.low_latency.enabled = LIBINPUT_CONFIG_LOW_LATENCY_DISABLED;
+		s.low_latency.default_enabled =
+			LIBINPUT_CONFIG_LOW_LATENCY_DISABLED;
+	}
+
+	s.rotation.available = config->rotation ?
+		config->rotation->is_available(device) : 0;
+	if (s.rotation.available) {
+		s.rotation.angle = config->rotation->get_angle(device);
+		s.rotation.default_angle =
+			config->rotation->get_default_angle(device);
+	}
+
+	memcpy(snapshot, &s, min(size, sizeof(s)));
+
+	return 0;
+}
+
 #if HAVE_LIBWACOM
 WacomDeviceDatabase *
 libinput_libwacom_ref(struct libinput *li)
 {
 	WacomDeviceDatabase *db = NULL;
-	if (!li->libwacom.db) {
+	if (!li->libwacom->db) {
+		uint64_t start = libinput_now_fresh(li);
+
 		db = libwacom_database_new();
+		libinput_record_startup_time(li,
+					     NULL,
+					     LIBINPUT_STARTUP_PHASE_LIBWACOM,
+					     libinput_now_fresh(li) - start);
 		if (!db) {
 			log_error(li,
 				  "Failed to initialize libwacom context\n");
 			return NULL;
 		}
 
-		li->libwacom.db = db;
-		li->libwacom.refcount = 0;
+		li->libwacom->db = db;
+		li->libwacom->refcount = 0;
 	}
 
-	li->libwacom.refcount++;
-	db = li->libwacom.db;
+	li->libwacom->refcount++;
+	db = li->libwacom->db;
 	return db;
 }
 
 void
 libinput_libwacom_unref(struct libinput *li)
 {
-	if (!li->libwacom.db)
+	if (!li->libwacom->db)
 		return;
 
-	assert(li->libwacom.refcount >= 1);
+	assert(li->libwacom->refcount >= 1);
+
+	/* The database stays loaded once it drops to zero, re-parsing it
+	 * is expensive and every tablet probe would have to do it again.
+	 * See libinput_release_caches() */
+	li->libwacom->refcount--;
+}
+
+/* Past this, tool_ids are looked up in libwacom every time */
+#define LIBWACOM_STYLI_MAX 256
+
+/**
+ * Fill in the libwacom description of the stylus with the given tool_id.
+ * Returns false if the database isn't loaded or doesn't know the stylus.
+ * The lookup is cached with the database, so a stylus that comes into
+ * proximity of several tablets, or of a tablet that was unplugged and
+ * plugged in again, is only looked up once. With cache sharing, that
+ * applies across contexts too.
+ */
+bool
+libinput_libwacom_get_stylus(struct libinput *li,
+			     uint32_t tool_id,
+			     struct libinput_libwacom_stylus *stylus)
+{
+	struct libinput_libwacom *libwacom = li->libwacom;
+	const WacomStylus *s;
+
+	if (!libwacom->db)
+		return false;
+
+	for (size_t i = 0; i < libwacom->nstyli; i++) {
+		if (libwacom->styli[i].tool_id == tool_id) {
+			*stylus = libwacom->styli[i];
+			return stylus->known;
+		}
+	}
+
+	s = libwacom_stylus_get_for_id(libwacom->db, tool_id);
+	*stylus = (struct libinput_libwacom_stylus) {
+		.tool_id = tool_id,
+		.known = s != NULL,
+	};
+	if (s) {
+		stylus->type = libwacom_stylus_get_type(s);
+		stylus->num_buttons = libwacom_stylus_get_num_buttons(s);
+		stylus->has_wheel = libwacom_stylus_has_wheel(s);
+		stylus->axes = libwacom_stylus_get_axes(s);
+	}
+
+	if (libwacom->nstyli == LIBWACOM_STYLI_MAX)
+		return stylus->known;
 
-	if (--li->libwacom.refcount == 0) {
-		libwacom_database_destroy(li->libwacom.db);
-		li->libwacom.db = NULL;
+	if (libwacom->nstyli == libwacom->styli_size) {
+		size_t size = max(libwacom->styli_size * 2, 8U);
+
+		libwacom->styli = realloc(libwacom->styli,
+					  size * sizeof(*libwacom->styli));
+		if (!libwacom->styli)
+			abort();
+		libwacom->styli_size = size;
 	}
+
+	libwacom->styli[libwacom->nstyli++] = *stylus;
+
+	return stylus->known;
 }
 #endif
+
+LIBINPUT_EXPORT void
+libinput_release_caches(struct libinput *libinput)
+{
+#if HAVE_LIBWACOM
+	if (libinput->libwacom->db && libinput->libwacom->refcount == 0) {
+		libwacom_database_destroy(libinput->libwacom->db);
+		libinput->libwacom->db = NULL;
+		free(libinput->libwacom->styli);
+		libinput->libwacom->styli = NULL;
+		libinput->libwacom->nstyli = 0;
+		libinput->libwacom->styli_size = 0;
+		libinput_libwacom_release_pads(libinput->libwacom);
+	}
+#endif
+}
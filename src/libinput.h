@@ -75,6 +75,16 @@ struct libinput_device_group;
  */
 struct libinput_seat;
 
+/**
+ * @ingroup base
+ * @struct libinput_source
+ *
+ * One file descriptor libinput reads from, see
+ * libinput_set_source_handler(). This struct is owned by libinput and
+ * not refcounted.
+ */
+struct libinput_source;
+
 /**
  * @ingroup device
  * @struct libinput_tablet_tool
@@ -739,6 +749,17 @@ enum libinput_event_type {
 	LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
 	LIBINPUT_EVENT_POINTER_BUTTON,
 	LIBINPUT_EVENT_POINTER_AXIS,
+	/**
+	 * All pointer data one device produced for one hardware frame: at
+	 * most one relative or absolute motion, one scroll event and a
+	 * list of button transitions. This event is only sent when
+	 * pointer frame batching is enabled, it then replaces the
+	 * individual motion, button and axis events, see
+	 * libinput_set_pointer_frame_batching().
+	 *
+	 * @since 1.16
+	 */
+	LIBINPUT_EVENT_POINTER_FRAME,
 
 	LIBINPUT_EVENT_TOUCH_DOWN = 500,
 	LIBINPUT_EVENT_TOUCH_UP,
@@ -955,6 +976,148 @@ libinput_event_get_context(struct libinput_event *event);
 struct libinput_device *
 libinput_event_get_device(struct libinput_event *event);
 
+/**
+ * @ingroup event
+ *
+ * Return the time this event was added to the event queue, in
+ * microseconds, in the CLOCK_MONOTONIC clock domain. The queue time is only
+ * recorded while queue latency tracking is enabled, see
+ * libinput_set_queue_latency_tracking(). For all other events this
+ * function returns 0.
+ *
+ * This is not the same as the event's hardware timestamp, the difference
+ * between the two is the time libinput spent processing the event.
+ *
+ * @param event The libinput event
+ * @return The time the event was queued in microseconds or 0
+ *
+ * @since 1.16
+ */
+uint64_t
+libinput_event_get_queue_time_usec(struct libinput_event *event);
+
+/**
+ * @ingroup event
+ *
+ * The version of struct libinput_event_view described by this header.
+ *
+ * @since 1.16
+ */
+#define LIBINPUT_EVENT_VIEW_VERSION 1
+
+/**
+ * @ingroup event
+ *
+ * A plain copy of the commonly used fields of an event, filled in by
+ * libinput_event_get_view(). All values are precomputed, reading them
+ * does not involve any further calls into libinput. The values are the
+ * same as returned by the respective getter functions, e.g.
+ * pointer.absolute_x_transformed is the value of
+ * libinput_event_pointer_get_absolute_x_transformed().
+ *
+ * Only the member of the union matching the event type is filled in,
+ * everything else is zero. Values that don't apply to the specific event
+ * type, e.g. pointer.button for a motion event, are zero. Events without
+ * a type-specific member only have the common fields set.
+ *
+ * Future versions of libinput may append fields to this struct, see
+ * libinput_event_get_view().
+ *
+ * @since 1.16
+ */
+struct libinput_event_view {
+	uint32_t version;		/**< LIBINPUT_EVENT_VIEW_VERSION */
+	enum libinput_event_type type;
+	uint64_t time_usec;		/**< 0 for device notify events */
+	struct libinput_device *device;	/**< not refcounted */
+
+	union {
+		struct {
+			double dx, dy;
+			double dx_unaccelerated, dy_unaccelerated;
+			double absolute_x, absolute_y;	/* mm */
+			double absolute_x_transformed, absolute_y_transformed;
+			uint32_t button;
+			enum libinput_button_state button_state;
+			uint32_t seat_button_count;
+			/* bitmask of (1 << enum libinput_pointer_axis) */
+			uint32_t axes;
+			enum libinput_pointer_axis_source axis_source;
+			double axis_value_horizontal, axis_value_vertical;
+			double axis_discrete_horizontal, axis_discrete_vertical;
+		} pointer;
+		struct {
+			uint32_t key;
+			enum libinput_key_state state;
+			uint32_t seat_key_count;
+		} keyboard;
+		struct {
+			int32_t slot, seat_slot;
+			double x, y;			/* mm */
+			double x_transformed, y_transformed;
+		} touch;
+		struct {
+			int finger_count;
+			int cancelled;
+			double dx, dy;
+			double dx_unaccelerated, dy_unaccelerated;
+			double scale, angle_delta;
+		} gesture;
+		struct {
+			struct libinput_tablet_tool *tool; /* not refcounted */
+			enum libinput_tablet_tool_proximity_state proximity_state;
+			enum libinput_tablet_tool_tip_state tip_state;
+			double x, y;			/* mm */
+			double x_transformed, y_transformed;
+			double dx, dy;
+			double pressure, distance;
+			double tilt_x, tilt_y;
+			double rotation, slider_position;
+			double wheel_delta;
+			uint32_t button;
+			enum libinput_button_state button_state;
+			uint32_t seat_button_count;
+		} tablet_tool;
+		struct {
+			enum libinput_switch which;
+			enum libinput_switch_state state;
+		} sw;
+	} u;
+};
+
+/**
+ * @ingroup event
+ *
+ * Fill in a plain copy of the event's fields, see struct
+ * libinput_event_view. This is an alternative to the per-field getter
+ * functions for callers that read many fields of many events: the event
+ * type is checked once and the transformed coordinates are computed
+ * once for the given width and height.
+ *
+ * At most size bytes of view are written, pass sizeof(struct
+ * libinput_event_view). A caller compiled against an older version of
+ * this header gets the fields of that version only, view->version is
+ * set to the version libinput filled in.
+ *
+ * @param event The libinput event
+ * @param view The view to fill in
+ * @param size The size of the caller's struct libinput_event_view
+ * @param width The current output screen width, used for the
+ * transformed coordinates
+ * @param height The current output screen height, used for the
+ * transformed coordinates
+ * @return 0 on success or -1 if size is too small for the common
+ * fields
+ *
+ * @since 1.16
+ */
+int
+libinput_event_get_view(struct libinput_event *event,
+			struct libinput_event_view *view,
+			size_t size,
+			uint32_t width,
+			uint32_t height);
+
 /**
  * @ingroup event
  *
@@ -1190,8 +1353,13 @@ libinput_event_pointer_get_time_usec(struct libinput_event_pointer *event);
  * Relative motion deltas are to be interpreted as pixel movement of a
  * standardized mouse. See the libinput documentation for more details.
  *
+ * For @ref LIBINPUT_EVENT_POINTER_FRAME events, this function returns the
+ * frame's relative motion or 0 if the frame has none, see
+ * libinput_event_pointer_get_frame_motion_type().
+ *
  * @note It is an application bug to call this function for events other than
- * @ref LIBINPUT_EVENT_POINTER_MOTION.
+ * @ref LIBINPUT_EVENT_POINTER_MOTION or
+ * @ref LIBINPUT_EVENT_POINTER_FRAME.
  *
  * @return The relative x movement since the last event
  */
@@ -1211,8 +1379,13 @@ libinput_event_pointer_get_dx(struct libinput_event_pointer *event);
  * Relative motion deltas are to be interpreted as pixel movement of a
  * standardized mouse. See the libinput documentation for more details.
  *
+ * For @ref LIBINPUT_EVENT_POINTER_FRAME events, this function returns the
+ * frame's relative motion or 0 if the frame has none, see
+ * libinput_event_pointer_get_frame_motion_type().
+ *
  * @note It is an application bug to call this function for events other than
- * @ref LIBINPUT_EVENT_POINTER_MOTION.
+ * @ref LIBINPUT_EVENT_POINTER_MOTION or
+ * @ref LIBINPUT_EVENT_POINTER_FRAME.
  *
  * @return The relative y movement since the last event
  */
@@ -1235,8 +1408,13 @@ libinput_event_pointer_get_dy(struct libinput_event_pointer *event);
  * Any rotation applied to the device also applies to unaccelerated motion
  * (see libinput_device_config_rotation_set_angle()).
  *
+ * For @ref LIBINPUT_EVENT_POINTER_FRAME events, this function returns the
+ * frame's relative motion or 0 if the frame has none, see
+ * libinput_event_pointer_get_frame_motion_type().
+ *
  * @note It is an application bug to call this function for events other than
- * @ref LIBINPUT_EVENT_POINTER_MOTION.
+ * @ref LIBINPUT_EVENT_POINTER_MOTION or
+ * @ref LIBINPUT_EVENT_POINTER_FRAME.
  *
  * @return The unaccelerated relative x movement since the last event
  */
@@ -1260,8 +1438,13 @@ libinput_event_pointer_get_dx_unaccelerated(
  * Any rotation applied to the device also applies to unaccelerated motion
  * (see libinput_device_config_rotation_set_angle()).
  *
+ * For @ref LIBINPUT_EVENT_POINTER_FRAME events, this function returns the
+ * frame's relative motion or 0 if the frame has none, see
+ * libinput_event_pointer_get_frame_motion_type().
+ *
  * @note It is an application bug to call this function for events other than
- * @ref LIBINPUT_EVENT_POINTER_MOTION.
+ * @ref LIBINPUT_EVENT_POINTER_MOTION or
+ * @ref LIBINPUT_EVENT_POINTER_FRAME.
  *
  * @return The unaccelerated relative y movement since the last event
  */
@@ -1279,8 +1462,13 @@ libinput_event_pointer_get_dy_unaccelerated(
  * For pointer events that are not of type
  * @ref LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE, this function returns 0.
  *
+ * For @ref LIBINPUT_EVENT_POINTER_FRAME events, this function returns the
+ * frame's absolute position if libinput_event_pointer_get_frame_motion_type()
+ * is @ref LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE.
+ *
  * @note It is an application bug to call this function for events other than
- * @ref LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE.
+ * @ref LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE or
+ * @ref LIBINPUT_EVENT_POINTER_FRAME.
  *
  * @return The current absolute x coordinate
  */
@@ -1297,8 +1485,13 @@ libinput_event_pointer_get_absolute_x(struct libinput_event_pointer *event);
  * For pointer events that are not of type
  * @ref LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE, this function returns 0.
  *
+ * For @ref LIBINPUT_EVENT_POINTER_FRAME events, this function returns the
+ * frame's absolute position if libinput_event_pointer_get_frame_motion_type()
+ * is @ref LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE.
+ *
  * @note It is an application bug to call this function for events other than
- * @ref LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE.
+ * @ref LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE or
+ * @ref LIBINPUT_EVENT_POINTER_FRAME.
  *
  * @return The current absolute y coordinate
  */
@@ -1315,8 +1508,13 @@ libinput_event_pointer_get_absolute_y(struct libinput_event_pointer *event);
  * @ref LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE, the return value of this
  * function is undefined.
  *
+ * For @ref LIBINPUT_EVENT_POINTER_FRAME events, this function returns the
+ * frame's absolute position if libinput_event_pointer_get_frame_motion_type()
+ * is @ref LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE.
+ *
  * @note It is an application bug to call this function for events other than
- * @ref LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE.
+ * @ref LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE or
+ * @ref LIBINPUT_EVENT_POINTER_FRAME.
  *
  * @param event The libinput pointer event
  * @param width The current output screen width
@@ -1337,8 +1535,13 @@ libinput_event_pointer_get_absolute_x_transformed(
  * @ref LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE, the return value of this function is
  * undefined.
  *
+ * For @ref LIBINPUT_EVENT_POINTER_FRAME events, this function returns the
+ * frame's absolute position if libinput_event_pointer_get_frame_motion_type()
+ * is @ref LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE.
+ *
  * @note It is an application bug to call this function for events other than
- * @ref LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE.
+ * @ref LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE or
+ * @ref LIBINPUT_EVENT_POINTER_FRAME.
  *
  * @param event The libinput pointer event
  * @param height The current output screen height
@@ -1408,8 +1611,12 @@ libinput_event_pointer_get_seat_button_count(
  * For pointer events that are not of type @ref LIBINPUT_EVENT_POINTER_AXIS,
  * this function returns 0.
  *
+ * For @ref LIBINPUT_EVENT_POINTER_FRAME events, this function applies to
+ * the frame's axis data, if any.
+ *
  * @note It is an application bug to call this function for events other than
- * @ref LIBINPUT_EVENT_POINTER_AXIS.
+ * @ref LIBINPUT_EVENT_POINTER_AXIS or
+ * @ref LIBINPUT_EVENT_POINTER_FRAME.
  *
  * @return Non-zero if this event contains a value for this axis
  */
@@ -1434,8 +1641,12 @@ libinput_event_pointer_has_axis(struct libinput_event_pointer *event,
  * For pointer events that are not of type @ref LIBINPUT_EVENT_POINTER_AXIS,
  * this function returns 0.
  *
+ * For @ref LIBINPUT_EVENT_POINTER_FRAME events, this function applies to
+ * the frame's axis data, if any.
+ *
  * @note It is an application bug to call this function for events other than
- * @ref LIBINPUT_EVENT_POINTER_AXIS.
+ * @ref LIBINPUT_EVENT_POINTER_AXIS or
+ * @ref LIBINPUT_EVENT_POINTER_FRAME.
  *
  * @return The axis value of this event
  *
@@ -1484,8 +1695,12 @@ libinput_event_pointer_get_axis_value(struct libinput_event_pointer *event,
  * For pointer events that are not of type @ref LIBINPUT_EVENT_POINTER_AXIS,
  * this function returns 0.
  *
+ * For @ref LIBINPUT_EVENT_POINTER_FRAME events, this function applies to
+ * the frame's axis data, if any.
+ *
  * @note It is an application bug to call this function for events other than
- * @ref LIBINPUT_EVENT_POINTER_AXIS.
+ * @ref LIBINPUT_EVENT_POINTER_AXIS or
+ * @ref LIBINPUT_EVENT_POINTER_FRAME.
  *
  * @return The source for this axis event
  */
@@ -1504,6 +1719,9 @@ libinput_event_pointer_get_axis_source(struct libinput_event_pointer *event);
  * If the source is @ref LIBINPUT_POINTER_AXIS_SOURCE_CONTINUOUS or @ref
  * LIBINPUT_POINTER_AXIS_SOURCE_FINGER, the discrete value is always 0.
  *
+ * For @ref LIBINPUT_EVENT_POINTER_FRAME events, this function applies to
+ * the frame's axis data, if any.
+ *
  * @return The discrete value for the given event.
  *
  * @see libinput_event_pointer_get_axis_value
@@ -1520,6 +1738,174 @@ libinput_event_pointer_get_axis_value_discrete(struct libinput_event_pointer *ev
 struct libinput_event *
 libinput_event_pointer_get_base_event(struct libinput_event_pointer *event);
 
+/**
+ * @ingroup event_pointer
+ *
+ * Return the type of motion in this frame event, @ref
+ * LIBINPUT_EVENT_POINTER_MOTION if the frame has relative motion, @ref
+ * LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE if it has an absolute position
+ * or @ref LIBINPUT_EVENT_NONE if the frame has no motion. The motion
+ * itself is available through libinput_event_pointer_get_dx() and friends
+ * or libinput_event_pointer_get_absolute_x() and friends.
+ *
+ * @note It is an application bug to call this function for events other than
+ * @ref LIBINPUT_EVENT_POINTER_FRAME.
+ *
+ * @param event The libinput pointer event
+ * @return The motion type of the frame
+ *
+ * @since 1.16
+ */
+enum libinput_event_type
+libinput_event_pointer_get_frame_motion_type(struct libinput_event_pointer *event);
+
+/**
+ * @ingroup event_pointer
+ *
+ * Return the number of button transitions in this frame event. The
+ * buttons are in the order the individual button events would have been
+ * sent in.
+ *
+ * For events not of type @ref LIBINPUT_EVENT_POINTER_FRAME, this function
+ * returns 0.
+ *
+ * @note It is an application bug to call this function for events other than
+ * @ref LIBINPUT_EVENT_POINTER_FRAME.
+ *
+ * @param event The libinput pointer event
+ * @return The number of button transitions in this frame
+ *
+ * @see libinput_event_pointer_get_frame_button
+ * @since 1.16
+ */
+size_t
+libinput_event_pointer_get_frame_button_count(struct libinput_event_pointer *event);
+
+/**
+ * @ingroup event_pointer
+ *
+ * The batched equivalent of libinput_event_pointer_get_button().
+ *
+ * @param event The libinput pointer event
+ * @param index The button index, less than
+ * libinput_event_pointer_get_frame_button_count()
+ * @return The button code of the button transition
+ *
+ * @since 1.16
+ */
+uint32_t
+libinput_event_pointer_get_frame_button(struct libinput_event_pointer *event,
+					size_t index);
+
+/**
+ * @ingroup event_pointer
+ *
+ * The batched equivalent of libinput_event_pointer_get_button_state().
+ *
+ * @param event The libinput pointer event
+ * @param index The button index, less than
+ * libinput_event_pointer_get_frame_button_count()
+ * @return The state of the button transition
+ *
+ * @since 1.16
+ */
+enum libinput_button_state
+libinput_event_pointer_get_frame_button_state(struct libinput_event_pointer *event,
+					      size_t index);
+
+/**
+ * @ingroup event_pointer
+ *
+ * The batched equivalent of libinput_event_pointer_get_seat_button_count().
+ *
+ * @param event The libinput pointer event
+ * @param index The button index, less than
+ * libinput_event_pointer_get_frame_button_count()
+ * @return The seat wide pressed button count after the button transition
+ *
+ * @since 1.16
+ */
+uint32_t
+libinput_event_pointer_get_frame_seat_button_count(struct libinput_event_pointer *event,
+						   size_t index);
+
+/**
+ * @ingroup event_pointer
+ *
+ * Return the number of devices whose motion is in this event. This is
+ * only larger than one if @ref LIBINPUT_EVENT_COALESCING_SEAT_POINTER_MOTION
+ * merged the motion of several devices into this event, see
+ * libinput_set_event_coalescing().
+ *
+ * For pointer events that are not of type @ref
+ * LIBINPUT_EVENT_POINTER_MOTION, this function returns 0.
+ *
+ * @note It is an application bug to call this function for events other
+ * than @ref LIBINPUT_EVENT_POINTER_MOTION.
+ *
+ * @param event The libinput pointer event
+ * @return The number of source devices of this event
+ *
+ * @since 1.16
+ */
+size_t
+libinput_event_pointer_get_source_count(struct libinput_event_pointer *event);
+
+/**
+ * @ingroup event_pointer
+ *
+ * Return the device of the given source of this event, the first
+ * source is the device returned by libinput_event_get_device(). This
+ * function does not increase the device's refcount, the device is valid
+ * until the event is destroyed.
+ *
+ * @param event The libinput pointer event
+ * @param index The source index, less than
+ * libinput_event_pointer_get_source_count()
+ * @return The device of the source or NULL if the index is invalid
+ *
+ * @since 1.16
+ */
+struct libinput_device *
+libinput_event_pointer_get_source_device(struct libinput_event_pointer *event,
+					 size_t index);
+
+/**
+ * @ingroup event_pointer
+ *
+ * Return the accelerated delta on the x axis of the given source of this
+ * event, see libinput_event_pointer_get_dx(). The deltas of all sources
+ * add up to the event's delta.
+ *
+ * @param event The libinput pointer event
+ * @param index The source index, less than
+ * libinput_event_pointer_get_source_count()
+ * @return The relative x movement of this source
+ *
+ * @since 1.16
+ */
+double
+libinput_event_pointer_get_source_dx(struct libinput_event_pointer *event,
+				     size_t index);
+
+/**
+ * @ingroup event_pointer
+ *
+ * Return the accelerated delta on the y axis of the given source of this
+ * event, see libinput_event_pointer_get_dy(). The deltas of all sources
+ * add up to the event's delta.
+ *
+ * @param event The libinput pointer event
+ * @param index The source index, less than
+ * libinput_event_pointer_get_source_count()
+ * @return The relative y movement of this source
+ *
+ * @since 1.16
+ */
+double
+libinput_event_pointer_get_source_dy(struct libinput_event_pointer *event,
+				     size_t index);
+
 /**
  * @defgroup event_touch Touch events
  *
@@ -1674,6 +2060,155 @@ double
 libinput_event_touch_get_y_transformed(struct libinput_event_touch *event,
 				       uint32_t height);
 
+/**
+ * @ingroup event_touch
+ *
+ * Return the number of touch points in this frame event. Touch points are
+ * only added to events of type @ref LIBINPUT_EVENT_TOUCH_FRAME when touch
+ * frame batching is enabled, see libinput_set_touch_frame_batching(). The
+ * touch points are in the order the individual touch events would have
+ * been sent in.
+ *
+ * For events not of type @ref LIBINPUT_EVENT_TOUCH_FRAME, this function
+ * returns 0.
+ *
+ * @note It is an application bug to call this function for events of type
+ * other than @ref LIBINPUT_EVENT_TOUCH_FRAME.
+ *
+ * @param event The libinput touch event
+ * @return The number of touch points in this frame
+ *
+ * @see libinput_event_touch_get_frame_touch_type
+ * @since 1.16
+ */
+size_t
+libinput_event_touch_get_frame_touch_count(struct libinput_event_touch *event);
+
+/**
+ * @ingroup event_touch
+ *
+ * Return the type of the individual touch event this touch point
+ * replaces, one of @ref LIBINPUT_EVENT_TOUCH_DOWN, @ref
+ * LIBINPUT_EVENT_TOUCH_MOTION, @ref LIBINPUT_EVENT_TOUCH_UP or @ref
+ * LIBINPUT_EVENT_TOUCH_CANCEL.
+ *
+ * @param event The libinput touch event
+ * @param index The touch point index, less than
+ * libinput_event_touch_get_frame_touch_count()
+ * @return The event type of the touch point
+ *
+ * @since 1.16
+ */
+enum libinput_event_type
+libinput_event_touch_get_frame_touch_type(struct libinput_event_touch *event,
+					  size_t index);
+
+/**
+ * @ingroup event_touch
+ *
+ * The batched equivalent of libinput_event_touch_get_slot().
+ *
+ * @param event The libinput touch event
+ * @param index The touch point index, less than
+ * libinput_event_touch_get_frame_touch_count()
+ * @return The slot of the touch point
+ *
+ * @since 1.16
+ */
+int32_t
+libinput_event_touch_get_frame_touch_slot(struct libinput_event_touch *event,
+					  size_t index);
+
+/**
+ * @ingroup event_touch
+ *
+ * The batched equivalent of libinput_event_touch_get_seat_slot().
+ *
+ * @param event The libinput touch event
+ * @param index The touch point index, less than
+ * libinput_event_touch_get_frame_touch_count()
+ * @return The seat slot of the touch point
+ *
+ * @since 1.16
+ */
+int32_t
+libinput_event_touch_get_frame_touch_seat_slot(struct libinput_event_touch *event,
+					       size_t index);
+
+/**
+ * @ingroup event_touch
+ *
+ * The batched equivalent of libinput_event_touch_get_x(). For touch
+ * points of type @ref LIBINPUT_EVENT_TOUCH_UP or @ref
+ * LIBINPUT_EVENT_TOUCH_CANCEL, the coordinate is meaningless.
+ *
+ * @param event The libinput touch event
+ * @param index The touch point index, less than
+ * libinput_event_touch_get_frame_touch_count()
+ * @return The absolute x coordinate of the touch point in mm
+ *
+ * @since 1.16
+ */
+double
+libinput_event_touch_get_frame_touch_x(struct libinput_event_touch *event,
+				       size_t index);
+
+/**
+ * @ingroup event_touch
+ *
+ * The batched equivalent of libinput_event_touch_get_y(). For touch
+ * points of type @ref LIBINPUT_EVENT_TOUCH_UP or @ref
+ * LIBINPUT_EVENT_TOUCH_CANCEL, the coordinate is meaningless.
+ *
+ * @param event The libinput touch event
+ * @param index The touch point index, less than
+ * libinput_event_touch_get_frame_touch_count()
+ * @return The absolute y coordinate of the touch point in mm
+ *
+ * @since 1.16
+ */
+double
+libinput_event_touch_get_frame_touch_y(struct libinput_event_touch *event,
+				       size_t index);
+
+/**
+ * @ingroup event_touch
+ *
+ * The batched equivalent of libinput_event_touch_get_x_transformed().
+ *
+ * @param event The libinput touch event
+ * @param index The touch point index, less than
+ * libinput_event_touch_get_frame_touch_count()
+ * @param width The current output screen width
+ * @return The absolute x coordinate of the touch point transformed to a
+ * screen coordinate
+ *
+ * @since 1.16
+ */
+double
+libinput_event_touch_get_frame_touch_x_transformed(struct libinput_event_touch *event,
+						   size_t index,
+						   uint32_t width);
+
+/**
+ * @ingroup event_touch
+ *
+ * The batched equivalent of libinput_event_touch_get_y_transformed().
+ *
+ * @param event The libinput touch event
+ * @param index The touch point index, less than
+ * libinput_event_touch_get_frame_touch_count()
+ * @param height The current output screen height
+ * @return The absolute y coordinate of the touch point transformed to a
+ * screen coordinate
+ *
+ * @since 1.16
+ */
+double
+libinput_event_touch_get_frame_touch_y_transformed(struct libinput_event_touch *event,
+						   size_t index,
+						   uint32_t height);
+
 /**
  * @ingroup event_touch
  *
@@ -2473,48 +3008,201 @@ libinput_event_tablet_tool_get_y_transformed(struct libinput_event_tablet_tool *
 /**
  * @ingroup event_tablet
  *
- * Returns the tool that was in use during this event.
+ * Return the number of historical samples in this event. Samples are only
+ * recorded for events of type @ref LIBINPUT_EVENT_TABLET_TOOL_AXIS when
+ * @ref LIBINPUT_EVENT_COALESCING_TABLET_TOOL_HISTORY is enabled, see
+ * libinput_set_event_coalescing(). Each sample is the state of an axis
+ * event that was merged into this event, the oldest sample has the index
+ * 0. The event's own axis values are more recent than all samples.
  *
- * The returned tablet tool is not refcounted and may become invalid after
- * the next call to libinput. Use libinput_tablet_tool_ref() and
- * libinput_tablet_tool_unref() to continue using the handle outside of the
- * immediate scope.
+ * @param event The libinput tablet tool event
+ * @return The number of historical samples in this event
  *
- * If the caller holds at least one reference, this struct is used
- * whenever the tools enters proximity again.
-  *
- * @note Physical tool tracking requires hardware support. If unavailable,
- * libinput creates one tool per type per tablet. See
- * libinput_tablet_tool_get_serial() for more details.
+ * @see libinput_event_tablet_tool_get_historical_time_usec
+ * @since 1.16
+ */
+size_t
+libinput_event_tablet_tool_get_history_size(struct libinput_event_tablet_tool *event);
+
+/**
+ * @ingroup event_tablet
  *
  * @param event The libinput tablet tool event
- * @return The new tool triggering this event
+ * @param index The sample index, less than
+ * libinput_event_tablet_tool_get_history_size()
+ * @return The timestamp of the historical sample in microseconds
  *
- * @since 1.2
+ * @since 1.16
  */
-struct libinput_tablet_tool *
-libinput_event_tablet_tool_get_tool(struct libinput_event_tablet_tool *event);
+uint64_t
+libinput_event_tablet_tool_get_historical_time_usec(struct libinput_event_tablet_tool *event,
+						    size_t index);
 
 /**
  * @ingroup event_tablet
  *
- * Returns the new proximity state of a tool from a proximity event.
- * Used to check whether or not a tool came in or out of proximity during an
- * event of type @ref LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY.
+ * The historical equivalent of libinput_event_tablet_tool_get_x().
  *
- * The proximity state represents the logical proximity state which does not
- * necessarily match when a tool comes into sensor range or leaves the
- * sensor range. On some tools this range does not represent the physical
- * range but a reduced tool-specific logical range. If the range is reduced,
- * this is done transparent to the caller.
+ * @param event The libinput tablet tool event
+ * @param index The sample index, less than
+ * libinput_event_tablet_tool_get_history_size()
+ * @return The x coordinate of the historical sample in mm
  *
- * For example, the Wacom mouse and lens cursor tools are usually
- * used in relative mode, lying flat on the tablet. Movement typically follows
- * the interaction normal mouse movements have, i.e. slightly lift the tool and
- * place it in a separate location. The proximity detection on Wacom
- * tablets however extends further than the user may lift the mouse, i.e. the
- * tool may not be lifted out of physical proximity. For such tools, libinput
- * provides software-emulated proximity.
+ * @since 1.16
+ */
+double
+libinput_event_tablet_tool_get_historical_x(struct libinput_event_tablet_tool *event,
+					    size_t index);
+
+/**
+ * @ingroup event_tablet
+ *
+ * The historical equivalent of libinput_event_tablet_tool_get_y().
+ *
+ * @param event The libinput tablet tool event
+ * @param index The sample index, less than
+ * libinput_event_tablet_tool_get_history_size()
+ * @return The y coordinate of the historical sample in mm
+ *
+ * @since 1.16
+ */
+double
+libinput_event_tablet_tool_get_historical_y(struct libinput_event_tablet_tool *event,
+					    size_t index);
+
+/**
+ * @ingroup event_tablet
+ *
+ * The historical equivalent of
+ * libinput_event_tablet_tool_get_x_transformed().
+ *
+ * @param event The libinput tablet tool event
+ * @param index The sample index, less than
+ * libinput_event_tablet_tool_get_history_size()
+ * @param width The current output screen width
+ * @return The x coordinate of the historical sample transformed to a
+ * screen coordinate
+ *
+ * @since 1.16
+ */
+double
+libinput_event_tablet_tool_get_historical_x_transformed(struct libinput_event_tablet_tool *event,
+							size_t index,
+							uint32_t width);
+
+/**
+ * @ingroup event_tablet
+ *
+ * The historical equivalent of
+ * libinput_event_tablet_tool_get_y_transformed().
+ *
+ * @param event The libinput tablet tool event
+ * @param index The sample index, less than
+ * libinput_event_tablet_tool_get_history_size()
+ * @param height The current output screen height
+ * @return The y coordinate of the historical sample transformed to a
+ * screen coordinate
+ *
+ * @since 1.16
+ */
+double
+libinput_event_tablet_tool_get_historical_y_transformed(struct libinput_event_tablet_tool *event,
+							size_t index,
+							uint32_t height);
+
+/**
+ * @ingroup event_tablet
+ *
+ * The historical equivalent of libinput_event_tablet_tool_get_pressure().
+ *
+ * @param event The libinput tablet tool event
+ * @param index The sample index, less than
+ * libinput_event_tablet_tool_get_history_size()
+ * @return The normalized pressure of the historical sample
+ *
+ * @since 1.16
+ */
+double
+libinput_event_tablet_tool_get_historical_pressure(struct libinput_event_tablet_tool *event,
+						   size_t index);
+
+/**
+ * @ingroup event_tablet
+ *
+ * The historical equivalent of libinput_event_tablet_tool_get_tilt_x().
+ *
+ * @param event The libinput tablet tool event
+ * @param index The sample index, less than
+ * libinput_event_tablet_tool_get_history_size()
+ * @return The x tilt of the historical sample in degrees
+ *
+ * @since 1.16
+ */
+double
+libinput_event_tablet_tool_get_historical_tilt_x(struct libinput_event_tablet_tool *event,
+						 size_t index);
+
+/**
+ * @ingroup event_tablet
+ *
+ * The historical equivalent of libinput_event_tablet_tool_get_tilt_y().
+ *
+ * @param event The libinput tablet tool event
+ * @param index The sample index, less than
+ * libinput_event_tablet_tool_get_history_size()
+ * @return The y tilt of the historical sample in degrees
+ *
+ * @since 1.16
+ */
+double
+libinput_event_tablet_tool_get_historical_tilt_y(struct libinput_event_tablet_tool *event,
+						 size_t index);
+
+/**
+ * @ingroup event_tablet
+ *
+ * Returns the tool that was in use during this event.
+ *
+ * The returned tablet tool is not refcounted and may become invalid after
+ * the next call to libinput. Use libinput_tablet_tool_ref() and
+ * libinput_tablet_tool_unref() to continue using the handle outside of the
+ * immediate scope.
+ *
+ * If the caller holds at least one reference, this struct is used
+ * whenever the tools enters proximity again.
+  *
+ * @note Physical tool tracking requires hardware support. If unavailable,
+ * libinput creates one tool per type per tablet. See
+ * libinput_tablet_tool_get_serial() for more details.
+ *
+ * @param event The libinput tablet tool event
+ * @return The new tool triggering this event
+ *
+ * @since 1.2
+ */
+struct libinput_tablet_tool *
+libinput_event_tablet_tool_get_tool(struct libinput_event_tablet_tool *event);
+
+/**
+ * @ingroup event_tablet
+ *
+ * Returns the new proximity state of a tool from a proximity event.
+ * Used to check whether or not a tool came in or out of proximity during an
+ * event of type @ref LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY.
+ *
+ * The proximity state represents the logical proximity state which does not
+ * necessarily match when a tool comes into sensor range or leaves the
+ * sensor range. On some tools this range does not represent the physical
+ * range but a reduced tool-specific logical range. If the range is reduced,
+ * this is done transparent to the caller.
+ *
+ * For example, the Wacom mouse and lens cursor tools are usually
+ * used in relative mode, lying flat on the tablet. Movement typically follows
+ * the interaction normal mouse movements have, i.e. slightly lift the tool and
+ * place it in a separate location. The proximity detection on Wacom
+ * tablets however extends further than the user may lift the mouse, i.e. the
+ * tool may not be lifted out of physical proximity. For such tools, libinput
+ * provides software-emulated proximity.
  *
  * @param event The libinput tablet tool event
  * @return The new proximity state of the tool from the event.
@@ -3326,6 +4014,74 @@ struct libinput_interface {
 	void (*close_restricted)(int fd, void *user_data);
 };
 
+/**
+ * @ingroup base
+ * @struct libinput_allocator_interface
+ *
+ * Memory allocation hooks, see libinput_set_allocator(). All three
+ * functions must be provided.
+ *
+ * @since 1.16
+ */
+struct libinput_allocator_interface {
+	/**
+	 * Allocate size bytes and return a pointer to the memory, or NULL
+	 * on failure. The memory does not need to be initialized.
+	 *
+	 * @param size The number of bytes to allocate, never 0
+	 * @param user_data The user_data provided in
+	 * libinput_set_allocator()
+	 */
+	void *(*alloc)(size_t size, void *user_data);
+	/**
+	 * Resize the memory at ptr to size bytes with the semantics of
+	 * realloc(3). ptr may be NULL.
+	 *
+	 * @param ptr Memory previously returned by alloc or realloc, or NULL
+	 * @param size The new size in bytes
+	 * @param user_data The user_data provided in
+	 * libinput_set_allocator()
+	 */
+	void *(*realloc)(void *ptr, size_t size, void *user_data);
+	/**
+	 * Release memory previously returned by alloc or realloc. ptr is
+	 * never NULL.
+	 *
+	 * @param ptr The memory to release
+	 * @param user_data The user_data provided in
+	 * libinput_set_allocator()
+	 */
+	void (*free)(void *ptr, void *user_data);
+};
+
+/**
+ * @ingroup base
+ *
+ * Set the allocator libinput uses for its per-event and per-device
+ * memory: events and their frame and history data, the event queues,
+ * devices and their dispatch state, quirks and the timer heap. Memory
+ * owned by other libraries, e.g. libudev or libevdev, is not affected.
+ *
+ * The allocator is process-wide and can only be changed while no libinput
+ * context exists, i.e. before the first context is created or after the
+ * last one was destroyed.
+ *
+ * The hooks are only called from threads that call into libinput. While
+ * a custom allocator is set, libinput does not use worker threads for
+ * jobs that would allocate memory with it, e.g. parsing the quirks.
+ *
+ * @param interface The allocator hooks, or NULL to restore the system
+ * allocator
+ * @param user_data Caller-specific data passed to the hooks
+ *
+ * @return 0 on success, or -1 if a libinput context exists
+ *
+ * @since 1.16
+ */
+int
+libinput_set_allocator(const struct libinput_allocator_interface *interface,
+		       void *user_data);
+
 /**
  * @ingroup base
  *
@@ -3369,6 +4125,42 @@ int
 libinput_udev_assign_seat(struct libinput *libinput,
 			  const char *seat_id);
 
+/**
+ * @ingroup base
+ *
+ * Hold back devices that are unplugged and plugged back in repeatedly,
+ * e.g. because of a faulty cable or a power-saving hub, until they stay
+ * plugged in for the given window.
+ *
+ * A device is flapping if it is removed less than window_ms after it was
+ * added. When a flapping device comes back within window_ms of its
+ * removal, libinput waits until it has been present for window_ms before
+ * adding it. If it goes away again in the meantime, the caller never sees
+ * a @ref LIBINPUT_EVENT_DEVICE_ADDED or @ref LIBINPUT_EVENT_DEVICE_REMOVED
+ * event for it. Devices are identified by their bus type, vendor and
+ * product ID, version, name and physical path.
+ *
+ * Devices that were not flapping before, and devices present when the
+ * seat is assigned or the context is resumed, are added immediately.
+ *
+ * Hotplug damping is disabled by default. Disabling it adds any held
+ * back devices immediately. See @ref LIBINPUT_STATISTIC_HOTPLUG_FLAPS,
+ * @ref LIBINPUT_STATISTIC_HOTPLUG_DEFERRED and @ref
+ * LIBINPUT_STATISTIC_HOTPLUG_SUPPRESSED for the counters.
+ *
+ * @param libinput A libinput context initialized with
+ * libinput_udev_create_context()
+ * @param window_ms The damping window in ms, or 0 to disable damping
+ *
+ * @return 0 on success or -1 if the context was not created with
+ * libinput_udev_create_context()
+ *
+ * @since 1.16
+ */
+int
+libinput_udev_set_hotplug_damping(struct libinput *libinput,
+				  uint32_t window_ms);
+
 /**
  * @ingroup base
  *
@@ -3416,6 +4208,43 @@ struct libinput_device *
 libinput_path_add_device(struct libinput *libinput,
 			 const char *path);
 
+/**
+ * @ingroup base
+ *
+ * Add a set of devices to a libinput context initialized with
+ * libinput_path_create_context(). This is equivalent to calling
+ * libinput_path_add_device() for each path but the udev lookups are
+ * done for all paths first and the devices are opened and probed in
+ * parallel where possible. The devices are created in the order of
+ * paths, their @ref LIBINPUT_EVENT_DEVICE_ADDED events are queued
+ * together.
+ *
+ * A path that fails to resolve or initialize does not affect the other
+ * paths.
+ *
+ * If devices is not NULL, it must have space for npaths elements. On
+ * return each element is the device created for the path at the same
+ * index or NULL if that path failed. The lifetime of the device
+ * pointers is the same as for libinput_path_add_device().
+ *
+ * @param libinput A previously initialized libinput context
+ * @param paths An array of paths to input devices
+ * @param npaths The number of elements in paths
+ * @param devices Returns the devices created, may be NULL
+ * @return The number of devices added, or -1 if the arguments are
+ * invalid
+ *
+ * @note It is an application bug to call this function on a libinput
+ * context initialized with libinput_udev_create_context().
+ *
+ * @since 1.16
+ */
+int
+libinput_path_add_devices(struct libinput *libinput,
+			  const char **paths,
+			  size_t npaths,
+			  struct libinput_device **devices);
+
 /**
  * @ingroup base
  *
@@ -3440,399 +4269,3464 @@ libinput_path_remove_device(struct libinput_device *device);
 /**
  * @ingroup base
  *
- * libinput keeps a single file descriptor for all events. Call into
- * libinput_dispatch() if any events become available on this fd.
+ * Create a new libinput context that processes events pushed in by the
+ * caller with libinput_replay_device_push_event() instead of reading them
+ * from the kernel. This is intended for replaying recorded event
+ * sequences in benchmarks and tests.
  *
- * @return The file descriptor used to notify of pending events.
+ * Devices are added and removed with libinput_path_add_device() and
+ * libinput_path_remove_device() like on a path context. The device node
+ * is only used to set up the device, e.g. a uinput device with the
+ * recorded capabilities, any events the kernel sends on it are ignored.
+ *
+ * Timers in a replay context run on the clock of the pushed events, a
+ * timer fires once an event at or after its expiry time is pushed or the
+ * time is advanced with libinput_replay_advance_time(). The caller does
+ * not need to call libinput_dispatch() to process the events, they are
+ * available via libinput_get_event() immediately.
+ *
+ * The reference count of the context is initialized to 1. See @ref
+ * libinput_unref.
+ *
+ * @param interface The callback interface
+ * @param user_data Caller-specific data passed to the various callback
+ * interfaces.
+ *
+ * @return An initialized, empty libinput context.
+ *
+ * @since 1.16
  */
-int
-libinput_get_fd(struct libinput *libinput);
+struct libinput *
+libinput_replay_create_context(const struct libinput_interface *interface,
+			       void *user_data);
 
 /**
  * @ingroup base
  *
- * Main event dispatchment function. Reads events of the file descriptors
- * and processes them internally. Use libinput_get_event() to retrieve the
- * events.
+ * Process one evdev event on a device of a context initialized with
+ * libinput_replay_create_context(), as if it had been read from the
+ * device node. Events must be pushed in the order they were recorded,
+ * the timestamps must not go backwards.
  *
- * Dispatching does not necessarily queue libinput events. This function
- * should be called immediately once data is available on the file
- * descriptor returned by libinput_get_fd(). libinput has a number of
- * timing-sensitive features (e.g. tap-to-click), any delay in calling
- * libinput_dispatch() may prevent these features from working correctly.
+ * A SYN_DROPPED event cannot be resynced from the kernel and is
+ * processed like a SYN_REPORT.
  *
- * @param libinput A previously initialized libinput context
+ * @param device A libinput device
+ * @param time The event time in microseconds, in CLOCK_MONOTONIC
+ * @param type The evdev event type, e.g. EV_REL
+ * @param code The evdev event code, e.g. REL_X
+ * @param value The event value
  *
- * @return 0 on success, or a negative errno on failure
+ * @return 0 on success, -ENODEV if the device is suspended or -EINVAL
+ * if the device does not belong to a replay context.
+ *
+ * @since 1.16
  */
 int
-libinput_dispatch(struct libinput *libinput);
+libinput_replay_device_push_event(struct libinput_device *device,
+				  uint64_t time,
+				  uint16_t type,
+				  uint16_t code,
+				  int32_t value);
 
 /**
  * @ingroup base
  *
- * Retrieve the next event from libinput's internal event queue.
+ * Advance the clock of a context initialized with
+ * libinput_replay_create_context() to the given time and fire all timers
+ * that expire by then. Use this to flush timeouts after the last event
+ * of a recording, e.g. tapping or the button debouncing.
  *
- * After handling the retrieved event, the caller must destroy it using
- * libinput_event_destroy().
+ * @param libinput A libinput context initialized with
+ * libinput_replay_create_context()
+ * @param time The time in microseconds, in CLOCK_MONOTONIC
  *
- * @param libinput A previously initialized libinput context
- * @return The next available event, or NULL if no event is available.
+ * @since 1.16
  */
-struct libinput_event *
-libinput_get_event(struct libinput *libinput);
+void
+libinput_replay_advance_time(struct libinput *libinput, uint64_t time);
 
 /**
  * @ingroup base
  *
- * Return the type of the next event in the internal queue. This function
- * does not pop the event off the queue and the next call to
- * libinput_get_event() returns that event.
+ * A clock provided by the caller, see libinput_set_clock().
  *
- * @param libinput A previously initialized libinput context
- * @return The event type of the next available event or @ref
- * LIBINPUT_EVENT_NONE if no event is available.
+ * @param libinput The libinput context
+ * @param user_data The user_data passed to libinput_set_clock()
+ *
+ * @return The current time in microseconds
+ *
+ * @since 1.16
  */
-enum libinput_event_type
-libinput_next_event_type(struct libinput *libinput);
+typedef uint64_t (*libinput_clock_func)(struct libinput *libinput,
+					void *user_data);
 
 /**
  * @ingroup base
  *
- * Set caller-specific data associated with this context. libinput does
- * not manage, look at, or modify this data. The caller must ensure the
- * data is valid.
+ * Replace CLOCK_MONOTONIC as the source of libinput's current time. All
+ * timers, e.g. tapping, button debouncing or disable-while-typing, then
+ * expire relative to this clock. This is intended for replaying
+ * recordings and benchmarks that run faster than real time.
+ *
+ * With a clock set, libinput no longer arms a kernel timer. Timers that
+ * expired according to the clock fire in the next libinput_dispatch(),
+ * the caller must call libinput_dispatch() after advancing the clock.
+ * The timestamps of events read from the kernel are unaffected and
+ * should be on the same timeline as the clock.
+ *
+ * A context initialized with libinput_replay_create_context() already
+ * uses the time of the last pushed event as its clock.
+ *
+ * This function must be called before any device is added to the
+ * context.
  *
  * @param libinput A previously initialized libinput context
- * @param user_data Caller-specific data passed to the various callback
- * interfaces.
+ * @param clock The clock, or NULL to go back to CLOCK_MONOTONIC
+ * @param user_data Passed to the clock
+ *
+ * @return 0 on success or -EBUSY if the context already has devices
+ *
+ * @since 1.16
  */
-void
-libinput_set_user_data(struct libinput *libinput,
-		       void *user_data);
+int
+libinput_set_clock(struct libinput *libinput,
+		   libinput_clock_func clock,
+		   void *user_data);
 
 /**
  * @ingroup base
  *
- * Get the caller-specific data associated with this context, if any.
+ * Return the time libinput's earliest internal timer expires, e.g. for
+ * tapping, button debouncing or disable-while-typing. A timer may fire
+ * anywhere between its expiry and this time, libinput_dispatch() must be
+ * called by then for the timer to fire in time.
+ *
+ * The return value is only valid until the next call to
+ * libinput_dispatch() or any other call that may arm a timer, e.g. a
+ * configuration change. Call this function after processing the
+ * events of a libinput_dispatch().
  *
  * @param libinput A previously initialized libinput context
- * @return The caller-specific data previously assigned in
- * libinput_set_user_data(), libinput_path_create_context() or
- * libinput_udev_create_context().
+ *
+ * @return The time of the next timeout in microseconds, in
+ * CLOCK_MONOTONIC or the clock set with libinput_set_clock(), or 0 if no
+ * timer is pending
+ *
+ * @see libinput_set_client_timers
+ *
+ * @since 1.16
  */
-void *
-libinput_get_user_data(struct libinput *libinput);
+uint64_t
+libinput_get_next_timeout(struct libinput *libinput);
 
 /**
  * @ingroup base
  *
- * Resume a suspended libinput context. This re-enables device
- * monitoring and adds existing devices.
+ * Stop libinput from arming a kernel timer for its internal timers. The
+ * fd returned by libinput_get_fd() then only becomes readable for
+ * events from the devices, the caller is responsible for calling
+ * libinput_dispatch() by the time returned by
+ * libinput_get_next_timeout(). Timers that expired fire in the next
+ * libinput_dispatch().
+ *
+ * This is for callers that run their own timers anyway, it saves a
+ * system call for every change to libinput's timers and a wakeup per
+ * timeout. A caller that fails to dispatch in time delays e.g. a tap or
+ * a button release until its next dispatch.
  *
  * @param libinput A previously initialized libinput context
- * @see libinput_suspend
+ * @param enable Non-zero to manage the timers in the caller, zero to go
+ * back to libinput's own timer
  *
- * @return 0 on success or -1 on failure
+ * @see libinput_get_next_timeout
+ *
+ * @since 1.16
  */
-int
-libinput_resume(struct libinput *libinput);
+void
+libinput_set_client_timers(struct libinput *libinput, int enable);
 
 /**
  * @ingroup base
  *
- * Suspend monitoring for new devices and close existing devices.
- * This all but terminates libinput but does keep the context
- * valid to be resumed with libinput_resume().
+ * Tell libinput the latest time events are picked up for the caller's
+ * next frame, e.g. the compositor's next repaint minus the time it
+ * needs to render. libinput then fires some of its internal timers up
+ * to a few milliseconds early if they would otherwise expire just
+ * after this deadline. The events they send, e.g. the button release
+ * of a tap or an emulated middle button press, make the next frame
+ * instead of waiting a whole refresh period.
+ *
+ * Only timers where firing slightly early is not noticeable to the
+ * user are affected, the deadline never delays a timer. The deadline
+ * applies until it is reached, the caller should set it for every
+ * frame.
  *
  * @param libinput A previously initialized libinput context
+ * @param deadline The deadline in microseconds, in CLOCK_MONOTONIC or
+ * the clock set with libinput_set_clock(), or 0 to unset it
+ *
+ * @see libinput_get_next_timeout
+ *
+ * @since 1.16
  */
 void
-libinput_suspend(struct libinput *libinput);
+libinput_set_frame_deadline(struct libinput *libinput, uint64_t deadline);
 
 /**
  * @ingroup base
  *
- * Add a reference to the context. A context is destroyed whenever the
- * reference count reaches 0. See @ref libinput_unref.
+ * libinput keeps a single file descriptor for all events. Call into
+ * libinput_dispatch() if any events become available on this fd.
  *
- * @param libinput A previously initialized valid libinput context
- * @return The passed libinput context
+ * @return The file descriptor used to notify of pending events.
  */
-struct libinput *
-libinput_ref(struct libinput *libinput);
+int
+libinput_get_fd(struct libinput *libinput);
 
 /**
  * @ingroup base
  *
- * Dereference the libinput context. After this, the context may have been
- * destroyed, if the last reference was dereferenced. If so, the context is
- * invalid and may not be interacted with.
+ * The handler called when libinput starts or stops reading from a file
+ * descriptor, see libinput_set_source_handler().
  *
- * @bug When the refcount reaches zero, libinput_unref() releases resources
- * even if a caller still holds refcounted references to related resources
- * (e.g. a libinput_device). When libinput_unref() returns
- * NULL, the caller must consider any resources related to that context
- * invalid. See https://bugs.freedesktop.org/show_bug.cgi?id=91872.
+ * @param libinput The libinput context
+ * @param source The source, pass it to libinput_dispatch_source()
+ * @param fd The file descriptor to poll for readability
+ * @param added 1 if the source was added, 0 if it was removed. A removed
+ * source must not be used after the handler returns.
+ * @param user_data The user_data passed to libinput_set_source_handler()
  *
- * Example code:
- * @code
- * li = libinput_path_create_context(&interface, NULL);
- * device = libinput_path_add_device(li, "/dev/input/event0");
- * // get extra reference to device
- * libinput_device_ref(device);
+ * @since 1.16
+ */
+typedef void (*libinput_source_handler)(struct libinput *libinput,
+					struct libinput_source *source,
+					int fd,
+					int added,
+					void *user_data);
+
+/**
+ * @ingroup base
  *
- * // refcount reaches 0, so *all* resources are cleaned up,
- * // including device
- * libinput_unref(li);
+ * Hand each of libinput's file descriptors (devices, timers, the udev
+ * monitor) to the caller's own event loop instead of collecting them
+ * in the fd returned by libinput_get_fd(). The handler is called once
+ * for every existing source before this function returns, and again
+ * whenever a source is added or removed, including from within
+ * libinput_dispatch_source() and libinput_unref().
  *
- * // INCORRECT: device has been cleaned up and must not be used
- * // li = libinput_device_get_context(device);
- * @endcode
+ * When a source's fd is readable, call libinput_dispatch_source() for
+ * that source. libinput_get_fd() never becomes readable while a source
+ * handler is set. libinput_dispatch() may still be called, it only
+ * processes sources that could not finish in a previous dispatch.
+ *
+ * The handler cannot be changed or removed once set. This is not
+ * available if libinput was built with io_uring support and uses it.
  *
  * @param libinput A previously initialized libinput context
- * @return NULL if context was destroyed otherwise the passed context
+ * @param handler The handler, must not be NULL
+ * @param user_data Passed to the handler
+ *
+ * @return 0 on success, -EINVAL if handler is NULL, -EBUSY if a handler
+ * is already set or -ENOTSUP if libinput uses io_uring
+ *
+ * @see libinput_dispatch_source
+ * @since 1.16
  */
-struct libinput *
-libinput_unref(struct libinput *libinput);
+int
+libinput_set_source_handler(struct libinput *libinput,
+			    libinput_source_handler handler,
+			    void *user_data);
 
 /**
  * @ingroup base
  *
- * Set the log priority for the libinput context. Messages with priorities
- * equal to or higher than the argument will be printed to the context's
- * log handler.
+ * Process the data available on one source previously passed to the
+ * handler set with libinput_set_source_handler(). This is the
+ * equivalent of libinput_dispatch() for a single readable file
+ * descriptor. Use libinput_get_event() to retrieve the events.
  *
- * The default log priority is @ref LIBINPUT_LOG_PRIORITY_ERROR.
+ * @param libinput A previously initialized libinput context
+ * @param source The source whose fd is readable
+ *
+ * @return 0 on success, -EINVAL if no source handler is set, or a
+ * negative errno on failure
+ *
+ * @since 1.16
+ */
+int
+libinput_dispatch_source(struct libinput *libinput,
+			 struct libinput_source *source);
+
+/**
+ * @ingroup base
+ *
+ * Main event dispatchment function. Reads events of the file descriptors
+ * and processes them internally. Use libinput_get_event() to retrieve the
+ * events.
+ *
+ * Dispatching does not necessarily queue libinput events. This function
+ * should be called immediately once data is available on the file
+ * descriptor returned by libinput_get_fd(). libinput has a number of
+ * timing-sensitive features (e.g. tap-to-click), any delay in calling
+ * libinput_dispatch() may prevent these features from working correctly.
  *
  * @param libinput A previously initialized libinput context
- * @param priority The minimum priority of log messages to print.
  *
- * @see libinput_log_set_handler
- * @see libinput_log_get_priority
+ * @return 0 on success, or a negative errno on failure
+ */
+int
+libinput_dispatch(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Like libinput_dispatch(), but stop processing once the given deadline
+ * is reached. This is intended for callers that dispatch once per frame
+ * and need to protect their frame budget when devices flood the event
+ * stream.
+ *
+ * The deadline is checked between hardware frames, so libinput may
+ * overrun it by the time it takes to process one frame. At least one
+ * frame is processed even if the deadline has already passed, so
+ * repeated calls always make progress.
+ *
+ * No events are lost when the deadline is reached. The remaining work is
+ * resumed first in the next call to libinput_dispatch() or
+ * libinput_dispatch_until(), and the file descriptor returned by
+ * libinput_get_fd() stays readable until then.
+ *
+ * The time spent in this function is available as @ref
+ * LIBINPUT_STATISTIC_DISPATCH_TIME_LAST and @ref
+ * LIBINPUT_STATISTIC_DISPATCH_TIME_TOTAL.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param deadline_usec The absolute time in microseconds, in the
+ * CLOCK_MONOTONIC clock domain, at which to stop processing
+ *
+ * @return 0 if all available events were processed, 1 if work remains,
+ * or a negative errno on failure
+ *
+ * @see libinput_dispatch
+ * @since 1.16
+ */
+int
+libinput_dispatch_until(struct libinput *libinput,
+			uint64_t deadline_usec);
+
+/**
+ * @ingroup base
+ *
+ * Limit the number of hardware frames libinput processes per device in
+ * one call to libinput_dispatch(). By default, libinput processes all
+ * available events of a device before moving on to the next one, so a
+ * device that floods the event stream can delay events from other
+ * devices.
+ *
+ * With a budget set, a device that still has events pending after
+ * max_frames frames is suspended and resumed first in the next call to
+ * libinput_dispatch(), before any other device. No events are lost and
+ * the file descriptor returned by libinput_get_fd() becomes readable
+ * again immediately if work remains.
+ *
+ * A hardware frame is one set of events terminated by the kernel's
+ * SYN_REPORT, it may result in zero or more libinput events.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param max_frames The maximum number of frames per device and
+ * dispatch, or 0 for no limit
+ *
+ * @see libinput_get_dispatch_budget
+ * @since 1.16
  */
 void
-libinput_log_set_priority(struct libinput *libinput,
-			  enum libinput_log_priority priority);
+libinput_set_dispatch_budget(struct libinput *libinput,
+			     unsigned int max_frames);
 
 /**
  * @ingroup base
  *
- * Get the context's log priority. Messages with priorities equal to or
- * higher than the argument will be printed to the current log handler.
+ * @param libinput A previously initialized libinput context
+ * @return The maximum number of frames processed per device and dispatch,
+ * or 0 if unlimited
  *
- * The default log priority is @ref LIBINPUT_LOG_PRIORITY_ERROR.
+ * @see libinput_set_dispatch_budget
+ * @since 1.16
+ */
+unsigned int
+libinput_get_dispatch_budget(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Enable merging of the devices' hardware frames in
+ * libinput_dispatch(). By default, each device with events available
+ * is processed in turn, so the events of two devices are handled
+ * grouped by device and not in the order they happened. With merging
+ * enabled, libinput reads from all devices with events available and
+ * processes their frames in the order of their kernel timestamps. The
+ * interactions between devices, e.g. disable-while-typing, then see
+ * the events in order, even with a dispatch budget.
+ *
+ * Frames are only merged across the devices that were readable when
+ * libinput_dispatch() was called. A frame that is split across two
+ * reads of a device node, and the frames of a device resumed after its
+ * dispatch budget, are processed without merging.
+ *
+ * Merging has no effect with a source handler set, see
+ * libinput_set_source_handler(), or with io_uring. It is disabled by
+ * default.
  *
  * @param libinput A previously initialized libinput context
- * @return The minimum priority of log messages to print.
+ * @param enable Non-zero to enable merging, zero to disable it
  *
- * @see libinput_log_set_handler
- * @see libinput_log_set_priority
+ * @see libinput_get_frame_merging
+ * @since 1.16
  */
-enum libinput_log_priority
-libinput_log_get_priority(const struct libinput *libinput);
+void
+libinput_set_frame_merging(struct libinput *libinput, int enable);
 
 /**
  * @ingroup base
  *
- * Log handler type for custom logging.
+ * @param libinput A previously initialized libinput context
+ * @return Non-zero if frame merging is enabled, zero otherwise
  *
- * @param libinput The libinput context
- * @param priority The priority of the current message
- * @param format Message format in printf-style
- * @param args Message arguments
+ * @see libinput_set_frame_merging
+ * @since 1.16
+ */
+int
+libinput_get_frame_merging(struct libinput *libinput);
+
+/**
+ * @ingroup base
  *
- * @see libinput_log_set_priority
- * @see libinput_log_get_priority
- * @see libinput_log_set_handler
+ * Limit how often the devices with a low priority are processed, see
+ * libinput_device_set_priority(). By default, these devices are
+ * processed in every call to libinput_dispatch() that finds events on
+ * them, after all other devices. With an interval set, their events are
+ * processed at most once per interval and are otherwise left in the
+ * kernel buffer until the interval has passed. The file descriptor
+ * returned by libinput_get_fd() becomes readable once they are due.
+ *
+ * This is intended for callers that want fewer wakeups, e.g. while the
+ * system is on battery. An event of a device with a low priority, e.g.
+ * a lid switch, may then be delayed by up to the interval.
+ *
+ * The interval has no effect with a source handler set, see
+ * libinput_set_source_handler(), or with io_uring. It is 0 by default.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param interval_usec The minimum time in microseconds between two
+ * dispatches of the devices with a low priority, or 0 to process them
+ * whenever they have events
+ *
+ * @see libinput_get_low_priority_interval
+ * @since 1.16
  */
-typedef void (*libinput_log_handler)(struct libinput *libinput,
-				     enum libinput_log_priority priority,
-				     const char *format, va_list args)
-	   LIBINPUT_ATTRIBUTE_PRINTF(3, 0);
+void
+libinput_set_low_priority_interval(struct libinput *libinput,
+				   uint64_t interval_usec);
 
 /**
  * @ingroup base
  *
- * Set the context's log handler. Messages with priorities equal to or
- * higher than the context's log priority will be passed to the given
- * log handler.
+ * @param libinput A previously initialized libinput context
+ * @return The minimum time in microseconds between two dispatches of
+ * the devices with a low priority, or 0 if not limited
  *
- * The default log handler prints to stderr.
+ * @see libinput_set_low_priority_interval
+ * @since 1.16
+ */
+uint64_t
+libinput_get_low_priority_interval(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Enable busy polling in libinput_dispatch(). By default,
+ * libinput_dispatch() processes the events that are available and
+ * returns. With busy polling enabled, once any events were processed
+ * libinput_dispatch() keeps polling the devices until the next events
+ * are queued, or until no new input was seen for window_usec
+ * microseconds. The next hardware frame is then processed as soon as
+ * the kernel makes it available, instead of after the caller's next
+ * wakeup. A device that sends events continuously does not keep
+ * libinput_dispatch() from returning.
+ *
+ * Busy polling trades CPU time and power for latency, it is intended for
+ * callers that dedicate a thread to input processing. libinput is not
+ * thread-safe, all calls on the context must still come from that
+ * thread. A call to libinput_dispatch() that finds no events returns
+ * immediately. libinput_dispatch_until() stops busy polling once its
+ * deadline is reached.
  *
  * @param libinput A previously initialized libinput context
- * @param log_handler The log handler for library messages.
+ * @param window_usec The idle time in microseconds after which
+ * libinput_dispatch() returns, or 0 to disable busy polling
  *
- * @see libinput_log_set_priority
- * @see libinput_log_get_priority
+ * @see libinput_get_busy_poll
+ * @since 1.16
  */
 void
-libinput_log_set_handler(struct libinput *libinput,
-			 libinput_log_handler log_handler);
+libinput_set_busy_poll(struct libinput *libinput,
+		       uint64_t window_usec);
 
 /**
- * @defgroup seat Initialization and manipulation of seats
+ * @ingroup base
  *
- * A seat has two identifiers, the physical name and the logical name. A
- * device is always assigned to exactly one seat. It may change to a
- * different logical seat but it cannot change physical seats.
+ * @param libinput A previously initialized libinput context
+ * @return The busy-poll window in microseconds, or 0 if busy polling is
+ * disabled
  *
- * See the libinput documentation for more information on seats.
+ * @see libinput_set_busy_poll
+ * @since 1.16
  */
+uint64_t
+libinput_get_busy_poll(struct libinput *libinput);
 
 /**
- * @ingroup seat
+ * @ingroup base
  *
- * Increase the refcount of the seat. A seat will be freed whenever the
- * refcount reaches 0. This may happen during libinput_dispatch() if the
- * seat was removed from the system. A caller must ensure to reference
- * the seat correctly to avoid dangling pointers.
+ * Retrieve the next event from libinput's internal event queue.
  *
- * @param seat A previously obtained seat
- * @return The passed seat
+ * After handling the retrieved event, the caller must destroy it using
+ * libinput_event_destroy().
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The next available event, or NULL if no event is available.
  */
-struct libinput_seat *
-libinput_seat_ref(struct libinput_seat *seat);
+struct libinput_event *
+libinput_get_event(struct libinput *libinput);
 
 /**
- * @ingroup seat
+ * @ingroup base
  *
- * Decrease the refcount of the seat. A seat will be freed whenever the
- * refcount reaches 0. This may happen during libinput_dispatch() if the
- * seat was removed from the system. A caller must ensure to reference
- * the seat correctly to avoid dangling pointers.
+ * Return the type of the next event in the internal queue. This function
+ * does not pop the event off the queue and the next call to
+ * libinput_get_event() returns that event.
  *
- * @param seat A previously obtained seat
- * @return NULL if seat was destroyed, otherwise the passed seat
+ * @param libinput A previously initialized libinput context
+ * @return The event type of the next available event or @ref
+ * LIBINPUT_EVENT_NONE if no event is available.
  */
-struct libinput_seat *
-libinput_seat_unref(struct libinput_seat *seat);
+enum libinput_event_type
+libinput_next_event_type(struct libinput *libinput);
 
 /**
- * @ingroup seat
+ * @ingroup base
  *
- * Set caller-specific data associated with this seat. libinput does
- * not manage, look at, or modify this data. The caller must ensure the
- * data is valid.
+ * Retrieve up to max_events events from libinput's internal event queue
+ * and store them in the caller-provided array, in the same order
+ * consecutive calls to libinput_get_event() would return them.
  *
- * @param seat A previously obtained seat
- * @param user_data Caller-specific data pointer
- * @see libinput_seat_get_user_data
+ * After handling the retrieved events, the caller must destroy each
+ * event using libinput_event_destroy() or destroy all of them with
+ * libinput_events_destroy().
+ *
+ * @param libinput A previously initialized libinput context
+ * @param events An array with space for at least max_events events
+ * @param max_events The maximum number of events to retrieve
+ * @return The number of events stored in events, 0 if no event is
+ * available
+ *
+ * @see libinput_events_destroy
+ * @since 1.16
+ */
+size_t
+libinput_get_events(struct libinput *libinput,
+		    struct libinput_event **events,
+		    size_t max_events);
+
+/**
+ * @ingroup base
+ *
+ * Retrieve the next event from libinput's internal event queue, giving
+ * priority to events that represent a discrete user action. These are
+ * @ref LIBINPUT_EVENT_KEYBOARD_KEY, @ref LIBINPUT_EVENT_POINTER_BUTTON,
+ * @ref LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY,
+ * @ref LIBINPUT_EVENT_TABLET_TOOL_TIP,
+ * @ref LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+ * @ref LIBINPUT_EVENT_TABLET_PAD_BUTTON,
+ * @ref LIBINPUT_EVENT_TABLET_PAD_KEY and
+ * @ref LIBINPUT_EVENT_SWITCH_TOGGLE.
+ *
+ * If such an event is queued, this function returns it ahead of
+ * the events of other devices queued before it, e.g. a key press is
+ * returned before a backlog of pointer motion events from a mouse. The
+ * events of any single device are always returned in order: if the
+ * device has other events queued before its priority event, those are
+ * returned first.
+ *
+ * Otherwise, this function behaves like libinput_get_event(). A caller
+ * may mix calls to this function and libinput_get_event(), note that
+ * libinput_next_event_type() refers to the event libinput_get_event()
+ * would return.
+ *
+ * Since events of different devices may be reordered, the seat-wide
+ * button and key counts of events from different devices may not be
+ * monotonic in the order the caller sees them.
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The next available event, or NULL if no event is available.
+ *
+ * @see libinput_get_event
+ * @since 1.16
+ */
+struct libinput_event *
+libinput_get_event_prioritized(struct libinput *libinput);
+
+/**
+ * @ingroup event
+ *
+ * Destroy nevents events as retrieved with libinput_get_events(). This is
+ * equivalent to calling libinput_event_destroy() on each event in order.
+ *
+ * @param events An array of events
+ * @param nevents The number of events in the array
+ *
+ * @see libinput_get_events
+ * @since 1.16
  */
 void
-libinput_seat_set_user_data(struct libinput_seat *seat, void *user_data);
+libinput_events_destroy(struct libinput_event **events,
+			size_t nevents);
 
 /**
- * @ingroup seat
+ * @ingroup base
  *
- * Get the caller-specific data associated with this seat, if any.
+ * Hand events over to a second thread. By default, events are retrieved
+ * with libinput_get_event() on the thread that calls libinput_dispatch().
+ * With event handoff enabled, libinput_dispatch() moves all queued events
+ * into a lock-free ring of the given size instead. Any number of other
+ * threads, the consumers, retrieve them with libinput_get_handoff_event()
+ * and return them with libinput_handoff_event_release(). Neither side
+ * takes a lock or allocates memory.
+ *
+ * Each event goes to exactly one consumer, in the order the events were
+ * queued. With more than one consumer, events of the same device may be
+ * processed concurrently by different consumers, a caller that needs
+ * them in order must serialize them itself.
+ *
+ * At most size events are handed over at a time. If the consumers hold
+ * that many unreleased events, the remaining events stay queued until
+ * a consumer releases some, the file descriptor returned by
+ * libinput_get_fd() then becomes readable.
+ *
+ * Event handoff must be enabled before the consumer threads start and
+ * cannot be disabled again. All other libinput functions, including
+ * libinput_event_destroy(), must still be called from the dispatching
+ * thread only. The consumers may use the event accessors, e.g.
+ * libinput_event_pointer_get_dx(), on the events they hold, but must not
+ * change the reference count of the event's device or seat. A released
+ * event is destroyed by libinput_dispatch(), so the last reference to a
+ * removed device is always dropped on the dispatching thread.
  *
- * @param seat A previously obtained seat
- * @return Caller-specific data pointer or NULL if none was set
- * @see libinput_seat_set_user_data
+ * @param libinput A previously initialized libinput context
+ * @param size The number of events that can be handed over at a time,
+ * must be a power of two
+ * @return 0 on success or -1 if the size is invalid, handoff is already
+ * enabled or the ring could not be allocated
+ *
+ * @see libinput_get_event_handoff_fd
+ * @since 1.16
  */
-void *
-libinput_seat_get_user_data(struct libinput_seat *seat);
+int
+libinput_set_event_handoff(struct libinput *libinput,
+			   unsigned int size);
 
 /**
- * @ingroup seat
+ * @ingroup base
+ *
+ * Return a file descriptor for the consumer threads to poll. It becomes
+ * readable when libinput_dispatch() hands over new events, see
+ * libinput_set_event_handoff(). The file descriptor is reset by
+ * libinput_get_handoff_event() when no more events are available.
+ *
+ * With more than one consumer, each wakeup is only guaranteed to wake
+ * one of them. That consumer should retrieve events until
+ * libinput_get_handoff_event() returns NULL.
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The file descriptor or -1 if event handoff is not enabled
+ *
+ * @see libinput_get_handoff_event
+ * @since 1.16
+ */
+int
+libinput_get_event_handoff_fd(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Give each seat its own event queue. By default, all events are queued
+ * in the context and retrieved with libinput_get_event(). With seat event
+ * queues enabled, the events of a device are queued in its seat instead
+ * and retrieved with libinput_seat_get_event(). A caller serving several
+ * seats can then drain each seat separately, without retrieving and
+ * sorting all events first.
+ *
+ * @ref LIBINPUT_EVENT_DEVICE_ADDED and @ref LIBINPUT_EVENT_DEVICE_REMOVED
+ * are still queued in the context, that is where the caller learns about
+ * new devices and seats. All other events of a device go to its seat's
+ * queue, in order. Events queued before this call stay in the context's
+ * queue.
+ *
+ * Seat event queues cannot be disabled again. They cannot be used
+ * together with libinput_set_event_handoff() and
+ * libinput_get_event_prioritized() only sees the context's queue. Events
+ * in a seat's queue are not coalesced, see
+ * libinput_set_event_coalescing().
+ *
+ * @param libinput A previously initialized libinput context
+ * @return 0 on success or -1 if seat event queues are already enabled
+ * or event handoff is enabled
+ *
+ * @see libinput_seat_get_event
+ * @see libinput_seat_get_event_fd
+ * @since 1.16
+ */
+int
+libinput_enable_seat_event_queues(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Retrieve the next handed-over event, see libinput_set_event_handoff().
+ * This function may be called from any number of consumer threads at the
+ * same time, and while libinput_dispatch() runs on the dispatching
+ * thread.
+ *
+ * The caller must pass the event to libinput_handoff_event_release()
+ * instead of libinput_event_destroy() when done with it.
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The next event or NULL if no event is available
+ *
+ * @see libinput_handoff_event_release
+ * @since 1.16
+ */
+struct libinput_event *
+libinput_get_handoff_event(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Return an event retrieved with libinput_get_handoff_event(). The event
+ * is destroyed during the next libinput_dispatch() and must not be
+ * accessed after this call. This function may be called from any number
+ * of consumer threads at the same time.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param event An event retrieved with libinput_get_handoff_event()
+ *
+ * @see libinput_get_handoff_event
+ * @since 1.16
+ */
+void
+libinput_handoff_event_release(struct libinput *libinput,
+			       struct libinput_event *event);
+
+/**
+ * @ingroup base
+ *
+ * The magic number at the start of an event ring, see struct
+ * libinput_event_ring_header.
+ *
+ * @since 1.16
+ */
+#define LIBINPUT_EVENT_RING_MAGIC 0x4c495247 /* "LIRG" */
+
+/**
+ * @ingroup base
+ *
+ * The version of the event ring layout described by this header. A
+ * consumer must not read a ring with a different version.
+ *
+ * @since 1.16
+ */
+#define LIBINPUT_EVENT_RING_VERSION 1
+
+/**
+ * @ingroup base
+ *
+ * The header at offset 0 of the shared memory returned by
+ * libinput_get_event_ring_fd(). The records start at header_size bytes
+ * into the memory, record n of the stream is at index n % size.
+ *
+ * head is the number of records published so far. It is only ever
+ * incremented and must be read with acquire semantics, e.g.
+ * __atomic_load_n(&header->head, __ATOMIC_ACQUIRE).
+ *
+ * @since 1.16
+ */
+struct libinput_event_ring_header {
+	uint32_t magic;		/**< LIBINPUT_EVENT_RING_MAGIC */
+	uint32_t version;	/**< LIBINPUT_EVENT_RING_VERSION */
+	uint32_t header_size;	/**< offset of the first record in bytes */
+	uint32_t record_size;	/**< sizeof(struct libinput_event_ring_record) */
+	uint32_t size;		/**< number of records, a power of two */
+	uint32_t reserved;
+	uint64_t head;		/**< number of records published */
+};
+
+/**
+ * @ingroup base
+ *
+ * One event in the ring, see libinput_enable_event_ring().
+ *
+ * sequence is the position of the record in the stream plus one once
+ * the record is complete, and 0 while libinput writes it. device_id
+ * identifies the device within the context, a device's id is not reused
+ * for another device. A consumer learns about the id from the
+ * @ref LIBINPUT_EVENT_DEVICE_ADDED record, the only record with the
+ * device member filled in.
+ *
+ * Only the member of the union matching the type is filled in, the
+ * values are the same as returned by the respective getter functions.
+ * Transformed coordinates depend on the caller's output size and are
+ * not part of the record, coordinates are in mm.
+ *
+ * @since 1.16
+ */
+struct libinput_event_ring_record {
+	uint64_t sequence;
+	uint64_t time_usec;	/**< 0 for device notify events */
+	uint32_t type;		/**< enum libinput_event_type */
+	uint32_t device_id;
+
+	union {
+		struct {
+			char sysname[32];
+			char name[64];
+			uint32_t vendor, product;
+		} device;
+		struct {
+			double dx, dy;
+			double dx_unaccelerated, dy_unaccelerated;
+			double absolute_x, absolute_y;
+			double axis_value_horizontal, axis_value_vertical;
+			double axis_discrete_horizontal, axis_discrete_vertical;
+			uint32_t button;
+			uint32_t button_state;
+			uint32_t seat_button_count;
+			/* bitmask of (1 << enum libinput_pointer_axis) */
+			uint32_t axes;
+			uint32_t axis_source;
+		} pointer;
+		struct {
+			uint32_t key;
+			uint32_t state;
+			uint32_t seat_key_count;
+		} keyboard;
+		struct {
+			int32_t slot, seat_slot;
+			double x, y;
+		} touch;
+		struct {
+			int32_t finger_count;
+			int32_t cancelled;
+			double dx, dy;
+			double dx_unaccelerated, dy_unaccelerated;
+			double scale, angle_delta;
+		} gesture;
+		struct {
+			uint64_t serial;
+			uint64_t tool_id;
+			uint32_t tool_type;
+			uint32_t proximity_state;
+			uint32_t tip_state;
+			uint32_t button;
+			uint32_t button_state;
+			uint32_t seat_button_count;
+			double x, y;
+			double dx, dy;
+			float pressure, distance;
+			float tilt_x, tilt_y;
+			float rotation, slider_position;
+			float wheel_delta;
+		} tablet_tool;
+		struct {
+			/* button, ring or strip number or the key code */
+			uint32_t number;
+			/* button or key state */
+			uint32_t state;
+			/* ring or strip axis source */
+			uint32_t source;
+			uint32_t mode;
+			double position;
+		} tablet_pad;
+		struct {
+			uint32_t which;
+			uint32_t state;
+		} sw;
+	} u;
+};
+
+/**
+ * @ingroup base
+ *
+ * Publish a copy of every event in a shared memory ring that other
+ * processes can map and read without any further involvement of this
+ * process. Each event is written as one fixed-size struct
+ * libinput_event_ring_record when it is queued, before it is merged with
+ * other events, see libinput_set_event_coalescing(). Events of types
+ * disabled for the device are not published. The events are still
+ * queued as usual and must still be retrieved with libinput_get_event().
+ *
+ * The ring starts with one @ref LIBINPUT_EVENT_DEVICE_ADDED record for
+ * each device that was added to the context before this call. These
+ * records are not queued as events, the caller already had those.
+ *
+ * The ring holds the last size records. libinput never waits for a
+ * consumer: a consumer that falls more than size records behind loses
+ * the oldest ones. To read the ring, a consumer keeps its own position
+ * tail, starting at the header's head (or 0 for the whole history):
+ *
+ * @code
+ * head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+ * if (head - tail > header->size)
+ *	tail = head - header->size; // records were lost
+ * while (tail < head) {
+ *	r = &records[tail % header->size];
+ *	seq = __atomic_load_n(&r->sequence, __ATOMIC_ACQUIRE);
+ *	copy = *r;
+ *	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+ *	if (seq != tail + 1 ||
+ *	    __atomic_load_n(&r->sequence, __ATOMIC_RELAXED) != seq)
+ *		break; // overwritten while reading, re-read the head
+ *	handle(&copy);
+ *	tail++;
+ * }
+ * @endcode
+ *
+ * The ring is backed by a sealed memfd that cannot change its size, see
+ * libinput_get_event_ring_fd(). Where the kernel supports it, the memfd
+ * cannot be mapped writable by anyone but libinput. Consumers are woken
+ * up through the file descriptors added with
+ * libinput_add_event_ring_notify_fd().
+ *
+ * The event ring cannot be disabled again.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param size The number of records in the ring, must be a power of two
+ * @return 0 on success or -1 if the size is invalid, the ring is already
+ * enabled or the shared memory could not be created
+ *
+ * @see libinput_get_event_ring_fd
+ * @since 1.16
+ */
+int
+libinput_enable_event_ring(struct libinput *libinput,
+			   unsigned int size);
+
+/**
+ * @ingroup base
+ *
+ * Return the memfd backing the event ring, see
+ * libinput_enable_event_ring(). The caller may pass this file descriptor
+ * to other processes, e.g. through a Unix socket with SCM_RIGHTS, which
+ * map it with
+ *
+ * @code
+ * mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+ * @endcode
+ *
+ * where size is the size of the file. The file descriptor is owned by
+ * libinput and closed in libinput_unref(), the caller must not close it.
+ * Mappings in other processes stay valid after that.
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The file descriptor or -1 if the event ring is not enabled
+ *
+ * @since 1.16
+ */
+int
+libinput_get_event_ring_fd(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Add a file descriptor, usually an eventfd, that libinput writes the
+ * 8-byte value 1 to at the end of each libinput_dispatch() that
+ * published new records in the event ring. Use one file descriptor per
+ * consumer, every consumer resets its own. A write that would block is
+ * skipped, the consumer is already due to wake up.
+ *
+ * libinput does not take ownership of the file descriptor, the caller
+ * must remove it with libinput_remove_event_ring_notify_fd() before
+ * closing it.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param fd The file descriptor to signal
+ * @return 0 on success or -1 if the event ring is not enabled or the
+ * file descriptor is invalid
+ *
+ * @see libinput_remove_event_ring_notify_fd
+ * @since 1.16
+ */
+int
+libinput_add_event_ring_notify_fd(struct libinput *libinput, int fd);
+
+/**
+ * @ingroup base
+ *
+ * Remove a file descriptor added with libinput_add_event_ring_notify_fd().
+ *
+ * @param libinput A previously initialized libinput context
+ * @param fd The file descriptor to remove
+ * @return 0 on success or -1 if the file descriptor was not added
+ *
+ * @see libinput_add_event_ring_notify_fd
+ * @since 1.16
+ */
+int
+libinput_remove_event_ring_notify_fd(struct libinput *libinput, int fd);
+
+/**
+ * @ingroup base
+ *
+ * One kernel event in the evdev tap, see libinput_enable_evdev_tap().
+ * The fields are those of the kernel's struct input_event.
+ *
+ * @since 1.16
+ */
+struct libinput_evdev_tap_record {
+	uint64_t time_usec;
+	uint32_t device_id;	/**< see libinput_device_get_id() */
+	uint16_t type;
+	uint16_t code;
+	int32_t value;
+	uint32_t reserved;
+};
+
+/**
+ * @ingroup base
+ *
+ * Copy every event libinput reads from a device node into a lock-free
+ * ring that one other thread, the recorder, drains with
+ * libinput_evdev_tap_read(). This allows a caller to record the raw
+ * evdev data of a running context, e.g. in the format of libinput
+ * record, without opening the devices a second time.
+ *
+ * The events are copied in the batches they were read from the kernel,
+ * before libinput processes them. A batch that does not fit into the
+ * ring is dropped as a whole and counted in @ref
+ * LIBINPUT_STATISTIC_EVDEV_TAP_DROPPED, libinput never waits for the
+ * recorder. Events passed to a device replayed by the caller and the
+ * events libevdev synthesizes after a SYN_DROPPED are not in the tap.
+ *
+ * Without the tap, libinput asks the kernel to filter the event codes it
+ * does not process, e.g. MSC_SCAN. With the tap enabled, that filter is
+ * removed so the tap has the full stream of the device.
+ *
+ * The evdev tap cannot be disabled again.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param size The number of events in the ring, must be a power of two
+ * @return 0 on success or -1 if the size is invalid, the tap is already
+ * enabled or the ring could not be allocated
+ *
+ * @see libinput_get_evdev_tap_fd
+ * @since 1.16
+ */
+int
+libinput_enable_evdev_tap(struct libinput *libinput,
+			  unsigned int size);
+
+/**
+ * @ingroup base
+ *
+ * Return a file descriptor for the recorder thread to poll. It becomes
+ * readable at the end of a libinput_dispatch() that added events to the
+ * evdev tap and is reset by libinput_evdev_tap_read() when the tap is
+ * empty. The file descriptor is owned by libinput.
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The file descriptor or -1 if the evdev tap is not enabled
+ *
+ * @see libinput_enable_evdev_tap
+ * @since 1.16
+ */
+int
+libinput_get_evdev_tap_fd(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Move up to max events out of the evdev tap, oldest first, see
+ * libinput_enable_evdev_tap(). This function may be called from one
+ * thread other than the dispatching thread, while libinput_dispatch()
+ * runs. It must not be called from more than one thread at a time.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param records The buffer to fill
+ * @param max The number of records that fit into records
+ * @return The number of records filled in, 0 if the tap is empty or not
+ * enabled
+ *
+ * @since 1.16
+ */
+size_t
+libinput_evdev_tap_read(struct libinput *libinput,
+			struct libinput_evdev_tap_record *records,
+			size_t max);
+
+/**
+ * @ingroup event
+ *
+ * The version of the encoding written by libinput_events_serialize().
+ *
+ * @since 1.16
+ */
+#define LIBINPUT_EVENT_SERIALIZE_VERSION 1
+
+/**
+ * @ingroup event
+ *
+ * Encode events into a compact, self-contained binary buffer, e.g. to
+ * forward them over the network. The buffer can be decoded with
+ * libinput_events_deserialize() by a process that does not have the
+ * devices, or libinput at all, in the same libinput version or a later
+ * one.
+ *
+ * The buffer starts with the version byte and the number of events as
+ * 32-bit little-endian value, followed by one entry per event. Each
+ * entry is the event type, the device id (see struct
+ * libinput_event_ring_record), the time as difference to the previous
+ * event in the buffer and a bitmask of the non-zero fields of the event,
+ * followed by those fields only. All integers are variable-length
+ * (LEB128) encoded, signed values are zigzag-encoded and floating point
+ * values are encoded as 16.16 fixed point. A pointer motion event
+ * following another event typically takes less than 20 bytes.
+ *
+ * A @ref LIBINPUT_EVENT_DEVICE_ADDED entry carries the device's sysname,
+ * name and ids, a receiver learns about the device id from it.
+ * Transformed coordinates depend on the receiver's output size and are
+ * not encoded.
+ *
+ * If not all events fit into the buffer, as many whole events as fit are
+ * encoded and the caller may encode the remaining ones into a new buffer.
+ *
+ * @param events An array of events
+ * @param nevents The number of events in the array
+ * @param buf The buffer to write to
+ * @param len The size of the buffer in bytes
+ * @param written Set to the number of bytes written
+ * @return The number of events encoded or -1 if not even the buffer
+ * header fits
+ *
+ * @see libinput_event_serialize
+ * @see libinput_events_deserialize
+ * @since 1.16
+ */
+int
+libinput_events_serialize(struct libinput_event **events,
+			  size_t nevents,
+			  void *buf,
+			  size_t len,
+			  size_t *written);
+
+/**
+ * @ingroup event
+ *
+ * Encode a single event, see libinput_events_serialize().
+ *
+ * @param event The libinput event
+ * @param buf The buffer to write to
+ * @param len The size of the buffer in bytes
+ * @return The number of bytes written or -1 if the event does not fit
+ *
+ * @see libinput_events_serialize
+ * @since 1.16
+ */
+int
+libinput_event_serialize(struct libinput_event *event,
+			 void *buf,
+			 size_t len);
+
+/**
+ * @ingroup event
+ *
+ * Decode a buffer written by libinput_events_serialize(). The events are
+ * returned with the same layout as the records of the event ring, see
+ * struct libinput_event_ring_record. The sequence field is 0 and fields
+ * that were not encoded are 0. Floating point values have a precision of
+ * 1/65536.
+ *
+ * This function does not use a libinput context and may be called from
+ * any thread.
+ *
+ * @param buf The encoded buffer
+ * @param len The size of the encoded buffer in bytes
+ * @param records The records to fill in
+ * @param nrecords The number of records to fill in at most
+ * @return The number of events in the buffer, of which the first
+ * nrecords were filled in, or -1 if the buffer is malformed or of an
+ * unsupported version
+ *
+ * @see libinput_events_serialize
+ * @since 1.16
+ */
+int
+libinput_events_deserialize(const void *buf,
+			    size_t len,
+			    struct libinput_event_ring_record *records,
+			    size_t nrecords);
+
+/**
+ * @ingroup base
+ *
+ * Event types that may be merged into a previously queued event, see
+ * libinput_set_event_coalescing().
+ *
+ * @since 1.16
+ */
+enum libinput_event_coalescing {
+	/**
+	 * Do not merge events, every event is queued.
+	 */
+	LIBINPUT_EVENT_COALESCING_NONE = 0,
+	/**
+	 * Merge consecutive @ref LIBINPUT_EVENT_POINTER_MOTION events from
+	 * the same device. The accelerated and unaccelerated deltas are
+	 * summed up, the timestamp is that of the most recent event.
+	 */
+	LIBINPUT_EVENT_COALESCING_POINTER_MOTION = (1 << 0),
+	/**
+	 * Merge a touch frame consisting only of @ref
+	 * LIBINPUT_EVENT_TOUCH_MOTION events into the previous frame of the
+	 * same device if that frame has motion events for the same slots.
+	 * The coordinates and timestamps are those of the most recent
+	 * event.
+	 */
+	LIBINPUT_EVENT_COALESCING_TOUCH_MOTION = (1 << 1),
+	/**
+	 * Merge consecutive @ref LIBINPUT_EVENT_TABLET_TOOL_AXIS events
+	 * from the same device and tool. Absolute axes are those of the
+	 * most recent event, relative axes (motion delta and wheel) are
+	 * summed up. An axis has changed if it changed in any of the
+	 * merged events.
+	 */
+	LIBINPUT_EVENT_COALESCING_TABLET_TOOL_AXIS = (1 << 2),
+	/**
+	 * Merge consecutive @ref LIBINPUT_EVENT_POINTER_AXIS events with a
+	 * source of @ref LIBINPUT_POINTER_AXIS_SOURCE_WHEEL or @ref
+	 * LIBINPUT_POINTER_AXIS_SOURCE_WHEEL_TILT from the same device.
+	 * The axis values and discrete values are summed up, the
+	 * timestamp is that of the most recent event. Events are not
+	 * merged when the scroll direction on an axis changes.
+	 *
+	 * This reduces the number of events for free-spinning wheels,
+	 * the merged event carries the total of all clicks since the
+	 * caller last retrieved an event.
+	 */
+	LIBINPUT_EVENT_COALESCING_POINTER_AXIS = (1 << 3),
+	/**
+	 * Like @ref LIBINPUT_EVENT_COALESCING_TABLET_TOOL_AXIS, but the
+	 * position, pressure and tilt of each merged event are kept in the
+	 * merged event as a historical sample, see
+	 * libinput_event_tablet_tool_get_history_size(). The caller
+	 * receives every sample without an event per sample.
+	 *
+	 * An event holds a limited number of samples, once that is
+	 * reached the next axis event is queued separately.
+	 */
+	LIBINPUT_EVENT_COALESCING_TABLET_TOOL_HISTORY = (1 << 4),
+	/**
+	 * Merge consecutive @ref LIBINPUT_EVENT_POINTER_AXIS events with a
+	 * source of @ref LIBINPUT_POINTER_AXIS_SOURCE_FINGER or @ref
+	 * LIBINPUT_POINTER_AXIS_SOURCE_CONTINUOUS from the same device,
+	 * i.e. touchpad two-finger and edge scrolling, button scrolling
+	 * and trackpoint scrolling. The axis values are summed up, the
+	 * timestamp is that of the most recent event. Events are not
+	 * merged when the scroll direction on an axis changes.
+	 *
+	 * A scroll stop event, i.e. an axis with a value of 0, is never
+	 * merged and the events after it start a new event. A caller thus
+	 * sees exactly the same scroll sequences, with fewer events in
+	 * between.
+	 */
+	LIBINPUT_EVENT_COALESCING_POINTER_SCROLL = (1 << 5),
+	/**
+	 * Like @ref LIBINPUT_EVENT_COALESCING_POINTER_MOTION, but
+	 * consecutive @ref LIBINPUT_EVENT_POINTER_MOTION events from all
+	 * devices on the same seat are merged, e.g. a mouse, a touchpad
+	 * and a KVM's virtual mouse that all move the same cursor. The
+	 * merged event is from the device of its first motion and its
+	 * timestamp is the most recent of all merged events, so the
+	 * stream stays ordered in time. Any other event, e.g. a button
+	 * press, ends the merge.
+	 *
+	 * The accelerated deltas of each device are available through
+	 * libinput_event_pointer_get_source_count(). The unaccelerated
+	 * deltas are summed up in the units of each device and are only
+	 * meaningful for an event with a single source.
+	 *
+	 * An event holds a limited number of source devices, once that is
+	 * reached the motion of the next device is queued separately.
+	 */
+	LIBINPUT_EVENT_COALESCING_SEAT_POINTER_MOTION = (1 << 6),
+	/**
+	 * Merge consecutive @ref LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE
+	 * events from the same device. The position and timestamp are
+	 * those of the most recent event.
+	 */
+	LIBINPUT_EVENT_COALESCING_POINTER_MOTION_ABSOLUTE = (1 << 7),
+};
+
+/**
+ * @ingroup base
+ *
+ * Enable merging of events that are still in the internal event queue.
+ * If the caller does not retrieve events with libinput_get_event() in
+ * time, the queue keeps growing with events that are of little use
+ * individually. With event coalescing enabled, an event is merged into
+ * the most recently queued event where possible. Only events still in
+ * the queue are affected, an event that has been retrieved by the caller
+ * is never modified.
+ *
+ * Until this function is called, each device uses its own default mode.
+ * That is @ref LIBINPUT_EVENT_COALESCING_NONE except for devices
+ * emulated by a virtual machine host, which default to @ref
+ * LIBINPUT_EVENT_COALESCING_POINTER_MOTION_ABSOLUTE. Once set, the mode
+ * applies to all devices, including a mode of @ref
+ * LIBINPUT_EVENT_COALESCING_NONE.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param mode A bitmask of @ref libinput_event_coalescing
+ * @return 0 on success or -1 if the mode contains invalid bits
+ *
+ * @see libinput_get_event_coalescing
+ * @since 1.16
+ */
+int
+libinput_set_event_coalescing(struct libinput *libinput,
+			      uint32_t mode);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return A bitmask of @ref libinput_event_coalescing, @ref
+ * LIBINPUT_EVENT_COALESCING_NONE if no mode was set and the devices use
+ * their default
+ *
+ * @see libinput_set_event_coalescing
+ * @since 1.16
+ */
+uint32_t
+libinput_get_event_coalescing(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Enable batching of touch frames. By default, each touch frame is a
+ * sequence of @ref LIBINPUT_EVENT_TOUCH_DOWN, @ref
+ * LIBINPUT_EVENT_TOUCH_MOTION, @ref LIBINPUT_EVENT_TOUCH_UP and @ref
+ * LIBINPUT_EVENT_TOUCH_CANCEL events, one per touch point, followed by a
+ * @ref LIBINPUT_EVENT_TOUCH_FRAME event. With batching enabled, the
+ * individual touch events are not sent, the @ref
+ * LIBINPUT_EVENT_TOUCH_FRAME event carries all touch points of the frame
+ * instead, see libinput_event_touch_get_frame_touch_count().
+ *
+ * This reduces the number of events on devices with many simultaneous
+ * touches. Touch frame batching is disabled by default.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param enable Non-zero to enable touch frame batching, zero to disable
+ * it
+ *
+ * @see libinput_get_touch_frame_batching
+ * @since 1.16
+ */
+void
+libinput_set_touch_frame_batching(struct libinput *libinput,
+				  int enable);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return Non-zero if touch frame batching is enabled, zero otherwise
+ *
+ * @see libinput_set_touch_frame_batching
+ * @since 1.16
+ */
+int
+libinput_get_touch_frame_batching(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Enable or disable pointer frame batching. With batching enabled, the
+ * motion, scroll and button events a pointer device produces for one
+ * hardware frame are sent as a single @ref LIBINPUT_EVENT_POINTER_FRAME
+ * event instead, so a caller needs to dequeue and process one event per
+ * frame instead of several.
+ *
+ * A frame holds at most one motion, one scroll event per axis and a
+ * limited number of button transitions. If the device sends more than
+ * that, or relative and absolute motion in the same frame, the frame is
+ * split into several frame events in the original order. Within a frame,
+ * the motion happens before the scroll and the scroll before the button
+ * transitions.
+ *
+ * Batching only applies to events that are the direct result of a
+ * hardware frame. Events libinput generates later, e.g. delayed button
+ * events from middle button emulation or debouncing, and events from
+ * touchpads are still sent individually. Pointer frame batching is
+ * disabled by default and only takes effect for pointer frames started
+ * after this call.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param enable Non-zero to enable pointer frame batching, zero to disable
+ * it
+ *
+ * @see libinput_get_pointer_frame_batching
+ * @since 1.16
+ */
+void
+libinput_set_pointer_frame_batching(struct libinput *libinput,
+				    int enable);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return Non-zero if pointer frame batching is enabled, zero otherwise
+ *
+ * @see libinput_set_pointer_frame_batching
+ * @since 1.16
+ */
+int
+libinput_get_pointer_frame_batching(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Share the device quirks and the libwacom tablet database with all other
+ * libinput contexts in this process that enable cache sharing. Without
+ * sharing, each context loads its own copy of this data when the first
+ * device is added, which is wasteful if a process creates several
+ * contexts.
+ *
+ * The quirks are shared between contexts that use the same quirks
+ * directory. Shared data is released with the last context using it.
+ *
+ * Cache sharing must be enabled before the first device or seat is added
+ * to the context, i.e. before libinput_path_add_device() or
+ * libinput_udev_assign_seat(). libinput is not thread-safe and this
+ * applies across contexts that share caches: all of them must be used
+ * from the same thread.
+ *
+ * Cache sharing is disabled by default.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param enable Non-zero to enable cache sharing, zero to disable it
+ *
+ * @return 0 on success or -1 if a device or seat was already added
+ *
+ * @see libinput_get_cache_sharing
+ * @since 1.16
+ */
+int
+libinput_set_cache_sharing(struct libinput *libinput,
+			   int enable);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return Non-zero if cache sharing is enabled, zero otherwise
+ *
+ * @see libinput_set_cache_sharing
+ * @since 1.16
+ */
+int
+libinput_get_cache_sharing(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Use a cache file for the device setup across restarts of the caller,
+ * e.g. at /var/cache/libinput/devices.bin. libinput_write_device_cache()
+ * writes the device quirks of every device seen into this file. On the
+ * next start, the devices found in a valid cache get their quirks from
+ * the cache and the device quirks files are not loaded at all unless a
+ * device isn't in the cache.
+ *
+ * A device is identified by its bus type, vendor and product ID,
+ * version, name and physical path. The cache is only valid for the same
+ * device quirks files, DMI modalias or device tree and libinput version,
+ * otherwise it is ignored and the quirks files are loaded as usual. A
+ * missing or invalid cache file is not an error.
+ *
+ * The cache must be set before the first device or seat is added to the
+ * context, i.e. before libinput_path_add_device() or
+ * libinput_udev_assign_seat(). The directory must exist. The cache is
+ * not used with cache sharing, see libinput_set_cache_sharing().
+ *
+ * @param libinput A previously initialized libinput context
+ * @param path The path to the cache file, or NULL to not use a cache
+ *
+ * @return 0 on success or -1 if a device or seat was already added
+ *
+ * @see libinput_write_device_cache
+ * @since 1.16
+ */
+int
+libinput_set_device_cache(struct libinput *libinput, const char *path);
+
+/**
+ * @ingroup base
+ *
+ * Write the device quirks of all devices seen so far, and those of the
+ * devices from the cache file that weren't seen, to the cache file set
+ * with libinput_set_device_cache(). The file is replaced atomically.
+ * Nothing is written if the cache is up-to-date.
+ *
+ * The caller should call this function once the devices are set up,
+ * e.g. after libinput_udev_assign_seat(), and may call it again after
+ * devices were added.
+ *
+ * @param libinput A previously initialized libinput context
+ *
+ * @return 0 on success, -EINVAL if no cache is set or cache sharing is
+ * enabled, or another negative errno if the file could not be written
+ *
+ * @see libinput_set_device_cache
+ * @since 1.16
+ */
+int
+libinput_write_device_cache(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Remember removed devices for the given time so that a device that is
+ * unplugged and plugged back in, e.g. by a KVM switch, is set up faster
+ * and keeps its configuration.
+ *
+ * A device added within timeout_ms of the removal of a device with the
+ * same bus type, vendor and product ID, version, name and physical path
+ * is treated as the same device. Its device quirks are taken over
+ * without matching them again, and the configuration options that
+ * differed from the defaults when it was removed are applied before the
+ * @ref LIBINPUT_EVENT_DEVICE_ADDED event is queued. The calibration
+ * matrix and a custom acceleration curve are not restored.
+ *
+ * Only the most recently removed devices are remembered. A change to the
+ * device quirks files discards the remembered quirks, see
+ * libinput_reload_quirks().
+ *
+ * The cache is disabled by default.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param timeout_ms The time in ms to remember a removed device, or 0 to
+ * disable the cache and forget all removed devices
+ *
+ * @see libinput_get_replug_timeout
+ * @since 1.16
+ */
+void
+libinput_set_replug_timeout(struct libinput *libinput,
+			    uint32_t timeout_ms);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The time in ms removed devices are remembered, or 0 if the
+ * cache is disabled
+ *
+ * @see libinput_set_replug_timeout
+ * @since 1.16
+ */
+uint32_t
+libinput_get_replug_timeout(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Re-read the device quirks files that were changed, added or removed
+ * since they were loaded, see the libinput documentation on device quirks
+ * for the file locations. Only the changed files are parsed again and
+ * only the devices that match a changed section are looked at.
+ *
+ * Most quirks only take effect when a device is set up, so each device
+ * whose quirks changed is removed and added again. The caller sees a
+ * @ref LIBINPUT_EVENT_DEVICE_REMOVED and a @ref LIBINPUT_EVENT_DEVICE_ADDED
+ * event for it and must re-apply its configuration as for any new device.
+ * All other devices are left alone.
+ *
+ * If a changed file fails to parse, an error is logged and the previously
+ * loaded quirks stay in place.
+ *
+ * This function must not be called from within one of libinput's
+ * callbacks. It is not available when cache sharing is enabled, see
+ * libinput_set_cache_sharing().
+ *
+ * @param libinput A previously initialized libinput context
+ *
+ * @return The number of devices that were added again, or a negative
+ * errno on failure
+ *
+ * @see libinput_set_quirks_watch
+ * @since 1.16
+ */
+int
+libinput_reload_quirks(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Watch the device quirks files with inotify and call
+ * libinput_reload_quirks() from within libinput_dispatch() whenever one
+ * of them changes.
+ *
+ * Watching is disabled by default. It is not available when cache sharing
+ * is enabled, see libinput_set_cache_sharing().
+ *
+ * @param libinput A previously initialized libinput context
+ * @param enable Non-zero to watch the files, zero to stop watching
+ *
+ * @return 0 on success or a negative errno on failure
+ *
+ * @see libinput_reload_quirks
+ * @since 1.16
+ */
+int
+libinput_set_quirks_watch(struct libinput *libinput, int enable);
+
+/**
+ * @ingroup base
+ * @struct libinput_open_request
+ *
+ * A pending request to open a device, see libinput_set_open_async().
+ */
+struct libinput_open_request;
+
+/**
+ * @ingroup base
+ *
+ * Open the device at the given path with the flags provided without
+ * blocking. Once the file descriptor is available, or opening failed,
+ * the caller must call libinput_device_open_complete() with the request.
+ *
+ * @param request The request handle to pass to
+ * libinput_device_open_complete()
+ * @param path The device path to open
+ * @param flags Flags as defined by open(2)
+ * @param user_data The user_data provided in
+ * libinput_udev_create_context()
+ *
+ * @see libinput_set_open_async
+ * @since 1.16
+ */
+typedef void (*libinput_open_async_func)(struct libinput_open_request *request,
+					 const char *path,
+					 int flags,
+					 void *user_data);
+
+/**
+ * @ingroup base
+ *
+ * Use an asynchronous function to open devices. By default, libinput
+ * calls the interface's open_restricted() and blocks until it returns.
+ * Where opening a device is slow, e.g. a D-Bus call to the session
+ * manager, this stalls the caller for each device added.
+ *
+ * With an asynchronous open function, a device found by the udev backend
+ * is added once the file descriptor is available and
+ * libinput_device_open_complete() is called, the @ref
+ * LIBINPUT_EVENT_DEVICE_ADDED event is sent after that. Devices added
+ * with libinput_path_add_device() and devices re-opened when their send
+ * events mode changes still use open_restricted(). File descriptors
+ * opened asynchronously are still closed with close_restricted().
+ *
+ * If the device is removed or the context is suspended or destroyed
+ * while a request is pending, libinput closes the file descriptor once
+ * the request is completed.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param open_async The function to open devices or NULL to use
+ * open_restricted()
+ *
+ * @see libinput_device_open_complete
+ * @since 1.16
+ */
+void
+libinput_set_open_async(struct libinput *libinput,
+			libinput_open_async_func open_async);
+
+/**
+ * @ingroup base
+ *
+ * Complete a request from the asynchronous open function, see
+ * libinput_set_open_async(). This function must be called exactly once
+ * for each request, the request handle is invalid afterwards. It may be
+ * called from within the open function itself.
+ *
+ * If the request was cancelled, this function closes the file descriptor
+ * with close_restricted(), even if the context was destroyed in the
+ * meantime. Otherwise, the device is added to the context.
+ *
+ * @param request The request handle passed to the open function
+ * @param fd The file descriptor, or a negative errno on failure
+ *
+ * @see libinput_set_open_async
+ * @since 1.16
+ */
+void
+libinput_device_open_complete(struct libinput_open_request *request,
+			      int fd);
+
+/**
+ * @ingroup base
+ *
+ * Enable or disable tracking of the time events spend in the event queue.
+ * While enabled, libinput records the time each event is queued and
+ * measures how long it takes until the caller retrieves it with
+ * libinput_get_event() or libinput_get_events(). The results are available
+ * through libinput_get_statistic() as @ref
+ * LIBINPUT_STATISTIC_QUEUE_LATENCY_P50, @ref
+ * LIBINPUT_STATISTIC_QUEUE_LATENCY_P99 and @ref
+ * LIBINPUT_STATISTIC_QUEUE_LATENCY_MAX.
+ *
+ * Tracking costs one clock read per queued event and one per call to
+ * retrieve events. It is disabled by default. Enabling tracking resets the
+ * previously collected samples, events queued before tracking was enabled
+ * are not counted.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param enable Non-zero to enable tracking, zero to disable it
+ *
+ * @see libinput_get_queue_latency_tracking
+ * @since 1.16
+ */
+void
+libinput_set_queue_latency_tracking(struct libinput *libinput,
+				    int enable);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return Non-zero if queue latency tracking is enabled, zero otherwise
+ *
+ * @see libinput_set_queue_latency_tracking
+ * @since 1.16
+ */
+int
+libinput_get_queue_latency_tracking(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Enable or disable delivery of the given event type for all devices in
+ * this context. This changes the setting on all current devices and is
+ * used as the default for devices added later, see
+ * libinput_device_set_event_type_enabled() for details.
+ *
+ * All event types are enabled by default. @ref
+ * LIBINPUT_EVENT_DEVICE_ADDED and @ref LIBINPUT_EVENT_DEVICE_REMOVED
+ * cannot be disabled.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param type The event type to enable or disable
+ * @param enabled Non-zero to enable the event type, zero to disable it
+ * @return 0 on success or -1 if the event type is invalid or cannot be
+ * disabled
+ *
+ * @see libinput_get_event_type_enabled
+ * @since 1.16
+ */
+int
+libinput_set_event_type_enabled(struct libinput *libinput,
+				enum libinput_event_type type,
+				int enabled);
+
+/**
+ * @ingroup base
+ *
+ * Check whether the given event type is enabled by default for devices
+ * in this context.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param type The event type to check
+ * @return Non-zero if the event type is enabled, zero otherwise
+ *
+ * @see libinput_set_event_type_enabled
+ * @since 1.16
+ */
+int
+libinput_get_event_type_enabled(struct libinput *libinput,
+				enum libinput_event_type type);
+
+/**
+ * @ingroup base
+ *
+ * Set caller-specific data associated with this context. libinput does
+ * not manage, look at, or modify this data. The caller must ensure the
+ * data is valid.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param user_data Caller-specific data passed to the various callback
+ * interfaces.
+ */
+void
+libinput_set_user_data(struct libinput *libinput,
+		       void *user_data);
+
+/**
+ * @ingroup base
+ *
+ * Get the caller-specific data associated with this context, if any.
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The caller-specific data previously assigned in
+ * libinput_set_user_data(), libinput_path_create_context() or
+ * libinput_udev_create_context().
+ */
+void *
+libinput_get_user_data(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Resume a suspended libinput context. This re-enables device
+ * monitoring and adds existing devices.
+ *
+ * @param libinput A previously initialized libinput context
+ * @see libinput_suspend
+ *
+ * @return 0 on success or -1 on failure
+ */
+int
+libinput_resume(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Suspend monitoring for new devices and close existing devices.
+ * This all but terminates libinput but does keep the context
+ * valid to be resumed with libinput_resume().
+ *
+ * @param libinput A previously initialized libinput context
+ */
+void
+libinput_suspend(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Release data libinput keeps loaded for the lifetime of the context to
+ * speed up device probes. At the moment this is the libwacom tablet
+ * database, which is otherwise parsed once and then re-used for every
+ * tablet, pad and touchpad added to the context, and the pad mode group
+ * descriptions looked up in it.
+ *
+ * Data still in use by a device is not released. Anything released is
+ * loaded again on demand the next time a device needs it, so this
+ * function may be called at any time, e.g. in response to memory
+ * pressure. With libinput_set_cache_sharing(), this releases the data
+ * shared with the other contexts.
+ *
+ * @param libinput A previously initialized libinput context
+ *
+ * @since 1.16
+ */
+void
+libinput_release_caches(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Add a reference to the context. A context is destroyed whenever the
+ * reference count reaches 0. See @ref libinput_unref.
+ *
+ * @param libinput A previously initialized valid libinput context
+ * @return The passed libinput context
+ */
+struct libinput *
+libinput_ref(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Dereference the libinput context. After this, the context may have been
+ * destroyed, if the last reference was dereferenced. If so, the context is
+ * invalid and may not be interacted with.
+ *
+ * @bug When the refcount reaches zero, libinput_unref() releases resources
+ * even if a caller still holds refcounted references to related resources
+ * (e.g. a libinput_device). When libinput_unref() returns
+ * NULL, the caller must consider any resources related to that context
+ * invalid. See https://bugs.freedesktop.org/show_bug.cgi?id=91872.
+ *
+ * Example code:
+ * @code
+ * li = libinput_path_create_context(&interface, NULL);
+ * device = libinput_path_add_device(li, "/dev/input/event0");
+ * // get extra reference to device
+ * libinput_device_ref(device);
+ *
+ * // refcount reaches 0, so *all* resources are cleaned up,
+ * // including device
+ * libinput_unref(li);
+ *
+ * // INCORRECT: device has been cleaned up and must not be used
+ * // li = libinput_device_get_context(device);
+ * @endcode
+ *
+ * @param libinput A previously initialized libinput context
+ * @return NULL if context was destroyed otherwise the passed context
+ */
+struct libinput *
+libinput_unref(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Set the log priority for the libinput context. Messages with priorities
+ * equal to or higher than the argument will be printed to the context's
+ * log handler.
+ *
+ * The default log priority is @ref LIBINPUT_LOG_PRIORITY_ERROR.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param priority The minimum priority of log messages to print.
+ *
+ * @see libinput_log_set_handler
+ * @see libinput_log_get_priority
+ */
+void
+libinput_log_set_priority(struct libinput *libinput,
+			  enum libinput_log_priority priority);
+
+/**
+ * @ingroup base
+ *
+ * Get the context's log priority. Messages with priorities equal to or
+ * higher than the argument will be printed to the current log handler.
+ *
+ * The default log priority is @ref LIBINPUT_LOG_PRIORITY_ERROR.
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The minimum priority of log messages to print.
+ *
+ * @see libinput_log_set_handler
+ * @see libinput_log_set_priority
+ */
+enum libinput_log_priority
+libinput_log_get_priority(const struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Log handler type for custom logging.
+ *
+ * @param libinput The libinput context
+ * @param priority The priority of the current message
+ * @param format Message format in printf-style
+ * @param args Message arguments
+ *
+ * @see libinput_log_set_priority
+ * @see libinput_log_get_priority
+ * @see libinput_log_set_handler
+ */
+typedef void (*libinput_log_handler)(struct libinput *libinput,
+				     enum libinput_log_priority priority,
+				     const char *format, va_list args)
+	   LIBINPUT_ATTRIBUTE_PRINTF(3, 0);
+
+/**
+ * @ingroup base
+ *
+ * Set the context's log handler. Messages with priorities equal to or
+ * higher than the context's log priority will be passed to the given
+ * log handler.
+ *
+ * The default log handler prints to stderr.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param log_handler The log handler for library messages.
+ *
+ * @see libinput_log_set_priority
+ * @see libinput_log_get_priority
+ */
+void
+libinput_log_set_handler(struct libinput *libinput,
+			 libinput_log_handler log_handler);
+
+/**
+ * @ingroup base
+ *
+ * Log messages into a ring buffer instead of passing them to the log
+ * handler. The messages are stored unformatted: the format string, the
+ * arguments, the device and a timestamp. Formatting is deferred until
+ * the caller calls libinput_log_ring_drain(), so debug logging can stay
+ * enabled without slowing down the event processing.
+ *
+ * While the ring is enabled, all messages that pass the log priority go
+ * into the ring, the log handler is not called. If the ring is full, the
+ * oldest message is discarded and libinput_log_ring_drain() reports the
+ * number of lost messages.
+ *
+ * String arguments are copied into the message and may be truncated.
+ * Messages logged for a device carry the device's sysname but not its
+ * name.
+ *
+ * Setting the ring size to zero disables the ring and discards all
+ * messages not yet drained. Changing the size discards all messages not
+ * yet drained.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param size The number of messages the ring holds, must be zero or a
+ * power of two
+ *
+ * @return 0 on success or -1 if the size is invalid
+ *
+ * @see libinput_log_ring_drain
+ *
+ * @since 1.16
+ */
+int
+libinput_log_set_ring(struct libinput *libinput, unsigned int size);
+
+/**
+ * @ingroup base
+ *
+ * Handler for the messages drained from the log ring, see
+ * libinput_log_ring_drain().
+ *
+ * @param libinput The libinput context
+ * @param priority The priority of the message
+ * @param time_usec The time the message was logged, in the same clock as
+ * the event timestamps
+ * @param message The formatted message, only valid during the call
+ * @param user_data The user_data passed to libinput_log_ring_drain()
+ *
+ * @since 1.16
+ */
+typedef void (*libinput_log_ring_handler)(struct libinput *libinput,
+					  enum libinput_log_priority priority,
+					  uint64_t time_usec,
+					  const char *message,
+					  void *user_data);
+
+/**
+ * @ingroup base
+ *
+ * Format the messages in the log ring and pass them to the handler in
+ * the order they were logged, see libinput_log_set_ring(). If messages
+ * were lost because the ring was full, the handler is first called with
+ * a message saying how many.
+ *
+ * This function must not be called from within a log handler or a
+ * libinput interface callback.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param handler The handler for each message
+ * @param user_data Passed to the handler
+ *
+ * @return The number of messages passed to the handler
+ *
+ * @since 1.16
+ */
+unsigned int
+libinput_log_ring_drain(struct libinput *libinput,
+			libinput_log_ring_handler handler,
+			void *user_data);
+
+/**
+ * @ingroup base
+ *
+ * Check whether the context is quiescent: no timers are armed, no key
+ * or button of any device is logically down, no touch is down and no
+ * tablet tool is in proximity. A quiescent context produces no event
+ * until new data arrives from one of its file descriptors, a caller
+ * may use this to reduce how often it wakes up, e.g. in a compositor
+ * for a kiosk nobody is using.
+ *
+ * Events already in the queue are not taken into account.
+ *
+ * @param libinput A previously initialized libinput context
+ * @return 1 if the context is quiescent, 0 otherwise
+ *
+ * @see libinput_set_quiescence_handler
+ * @since 1.16
+ */
+int
+libinput_is_quiescent(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * The handler called when the context changes into or out of the
+ * quiescent state, see libinput_set_quiescence_handler().
+ *
+ * @param libinput The libinput context
+ * @param quiescent 1 if the context is now quiescent, 0 otherwise
+ * @param user_data The user_data passed to
+ * libinput_set_quiescence_handler()
+ *
+ * @since 1.16
+ */
+typedef void (*libinput_quiescence_handler)(struct libinput *libinput,
+					    int quiescent,
+					    void *user_data);
+
+/**
+ * @ingroup base
+ *
+ * Set a handler to be called whenever the context changes into or
+ * out of the quiescent state as returned by libinput_is_quiescent().
+ * The state is checked at the end of libinput_dispatch() and
+ * libinput_dispatch_until(). The handler is called from within those
+ * functions, and must not call them.
+ *
+ * The state at the time of this call is the baseline, the handler is
+ * not called for it.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param handler The handler, or NULL to remove a previous handler
+ * @param user_data Passed to the handler
+ *
+ * @see libinput_is_quiescent
+ * @since 1.16
+ */
+void
+libinput_set_quiescence_handler(struct libinput *libinput,
+				libinput_quiescence_handler handler,
+				void *user_data);
+
+/**
+ * @ingroup base
+ *
+ * Statistics kept by the libinput context, see libinput_get_statistic().
+ *
+ * @since 1.16
+ */
+enum libinput_statistic {
+	/**
+	 * The number of events whose memory was recycled from a previously
+	 * destroyed event of the same type.
+	 */
+	LIBINPUT_STATISTIC_EVENT_CACHE_HITS = 1,
+	/**
+	 * The number of events that required a new allocation because no
+	 * previously destroyed event of the same type was available.
+	 */
+	LIBINPUT_STATISTIC_EVENT_CACHE_MISSES,
+	/**
+	 * The highest number of destroyed events held for recycling at any
+	 * point in time.
+	 */
+	LIBINPUT_STATISTIC_EVENT_CACHE_PEAK,
+	/**
+	 * The number of events merged into an already queued event, see
+	 * libinput_set_event_coalescing().
+	 */
+	LIBINPUT_STATISTIC_EVENTS_COALESCED,
+	/**
+	 * The number of events discarded because the event queue could
+	 * not be enlarged.
+	 */
+	LIBINPUT_STATISTIC_EVENTS_DROPPED,
+	/**
+	 * The number of events the event queue can currently hold without
+	 * reallocation. This is not a counter, the queue grows on demand and
+	 * shrinks again after a period of low use.
+	 */
+	LIBINPUT_STATISTIC_EVENT_QUEUE_SIZE,
+	/**
+	 * The largest number of events that were waiting in the event
+	 * queue at any one time.
+	 */
+	LIBINPUT_STATISTIC_EVENT_QUEUE_PEAK,
+	/**
+	 * The number of events whose queue latency was measured, see
+	 * libinput_set_queue_latency_tracking().
+	 */
+	LIBINPUT_STATISTIC_QUEUE_LATENCY_SAMPLES,
+	/**
+	 * The median time in microseconds an event spent in the event
+	 * queue before the caller retrieved it. This value is an upper
+	 * bound with a granularity of a power of two. Only available while
+	 * libinput_set_queue_latency_tracking() is enabled.
+	 */
+	LIBINPUT_STATISTIC_QUEUE_LATENCY_P50,
+	/**
+	 * The 99th percentile of the time in microseconds an event spent
+	 * in the event queue, see @ref LIBINPUT_STATISTIC_QUEUE_LATENCY_P50.
+	 */
+	LIBINPUT_STATISTIC_QUEUE_LATENCY_P99,
+	/**
+	 * The longest time in microseconds an event spent in the event
+	 * queue, see @ref LIBINPUT_STATISTIC_QUEUE_LATENCY_P50.
+	 */
+	LIBINPUT_STATISTIC_QUEUE_LATENCY_MAX,
+	/**
+	 * The number of events dropped because the caller disabled their
+	 * event type, see libinput_device_set_event_type_enabled().
+	 */
+	LIBINPUT_STATISTIC_EVENTS_FILTERED,
+	/**
+	 * The time in microseconds spent in the most recent call to
+	 * libinput_dispatch_until().
+	 */
+	LIBINPUT_STATISTIC_DISPATCH_TIME_LAST,
+	/**
+	 * The total time in microseconds spent in
+	 * libinput_dispatch_until().
+	 */
+	LIBINPUT_STATISTIC_DISPATCH_TIME_TOTAL,
+	/**
+	 * The number of times libinput reprogrammed its internal timer file
+	 * descriptor.
+	 */
+	LIBINPUT_STATISTIC_TIMERFD_UPDATES,
+	/**
+	 * The number of times libinput's internal timer file descriptor
+	 * expired.
+	 */
+	LIBINPUT_STATISTIC_TIMER_WAKEUPS,
+	/**
+	 * The number of times libinput polled its file descriptors without
+	 * waiting while busy polling, see libinput_set_busy_poll().
+	 */
+	LIBINPUT_STATISTIC_BUSY_POLL_SPINS,
+	/**
+	 * The number of times a device was removed within the hotplug
+	 * damping window after it was added, see
+	 * libinput_udev_set_hotplug_damping().
+	 */
+	LIBINPUT_STATISTIC_HOTPLUG_FLAPS,
+	/**
+	 * The number of times adding a flapping device was deferred, see
+	 * libinput_udev_set_hotplug_damping().
+	 */
+	LIBINPUT_STATISTIC_HOTPLUG_DEFERRED,
+	/**
+	 * The number of devices that were removed again before they were
+	 * added, i.e. the number of @ref LIBINPUT_EVENT_DEVICE_ADDED and
+	 * @ref LIBINPUT_EVENT_DEVICE_REMOVED pairs that were never sent.
+	 */
+	LIBINPUT_STATISTIC_HOTPLUG_SUPPRESSED,
+	/**
+	 * The number of evdev events that did not fit into the evdev tap,
+	 * see libinput_enable_evdev_tap().
+	 */
+	LIBINPUT_STATISTIC_EVDEV_TAP_DROPPED,
+};
+
+/**
+ * @ingroup base
+ *
+ * Return the current value of the given statistic. Statistics are
+ * accumulated over the lifetime of the context and are intended for
+ * debugging and performance analysis only.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param statistic The statistic to query
+ * @return The current value of the statistic or 0 if the statistic is
+ * invalid
+ *
+ * @since 1.16
+ */
+uint64_t
+libinput_get_statistic(struct libinput *libinput,
+		       enum libinput_statistic statistic);
+
+/**
+ * @ingroup base
+ * @struct libinput_timer_stats
+ *
+ * A snapshot of libinput's internal timer statistics, see
+ * libinput_get_timer_stats().
+ */
+struct libinput_timer_stats;
+
+/**
+ * @ingroup base
+ *
+ * The values available for each timer in a @ref libinput_timer_stats
+ * snapshot.
+ *
+ * @since 1.16
+ */
+enum libinput_timer_stat {
+	/**
+	 * The number of times the timer was set, including setting an
+	 * already running timer to a new expiry.
+	 */
+	LIBINPUT_TIMER_STAT_ARMED,
+	/**
+	 * The number of times the timer expired.
+	 */
+	LIBINPUT_TIMER_STAT_FIRED,
+	/**
+	 * The number of times the timer was cancelled before it expired.
+	 */
+	LIBINPUT_TIMER_STAT_CANCELLED,
+	/**
+	 * The median time in microseconds between the scheduled expiry and
+	 * the time the timer was handled. This value is an upper bound with
+	 * a granularity of a power of two.
+	 */
+	LIBINPUT_TIMER_STAT_LATENESS_P50,
+	/**
+	 * The 99th percentile of the timer lateness in microseconds, see
+	 * @ref LIBINPUT_TIMER_STAT_LATENESS_P50.
+	 */
+	LIBINPUT_TIMER_STAT_LATENESS_P99,
+	/**
+	 * The largest timer lateness in microseconds.
+	 */
+	LIBINPUT_TIMER_STAT_LATENESS_MAX,
+};
+
+/**
+ * @ingroup base
+ *
+ * Take a snapshot of the usage statistics of libinput's internal timers.
+ * libinput uses timers for e.g. tapping, button debouncing and
+ * disable-while-typing. Statistics are accumulated per timer name over
+ * the lifetime of the context, timers on different devices have
+ * different names.
+ *
+ * This function is intended for debugging and performance analysis, the
+ * set of timers and their names are not stable API.
+ *
+ * The caller must destroy the snapshot with
+ * libinput_timer_stats_destroy().
+ *
+ * @param libinput A previously initialized libinput context
+ * @return A new snapshot of the timer statistics
+ *
+ * @since 1.16
+ */
+struct libinput_timer_stats *
+libinput_get_timer_stats(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * @param stats A timer statistics snapshot
+ * @return The number of timers in this snapshot
+ *
+ * @since 1.16
+ */
+unsigned int
+libinput_timer_stats_get_count(struct libinput_timer_stats *stats);
+
+/**
+ * @ingroup base
+ *
+ * @param stats A timer statistics snapshot
+ * @param index The timer index, between 0 and
+ * libinput_timer_stats_get_count() - 1
+ * @return The name of the timer or NULL if the index is invalid. The
+ * string is owned by the snapshot.
+ *
+ * @since 1.16
+ */
+const char *
+libinput_timer_stats_get_name(struct libinput_timer_stats *stats,
+			      unsigned int index);
+
+/**
+ * @ingroup base
+ *
+ * @param stats A timer statistics snapshot
+ * @param index The timer index, between 0 and
+ * libinput_timer_stats_get_count() - 1
+ * @param stat The value to return
+ * @return The value or 0 if the index or stat is invalid
+ *
+ * @since 1.16
+ */
+uint64_t
+libinput_timer_stats_get_value(struct libinput_timer_stats *stats,
+			       unsigned int index,
+			       enum libinput_timer_stat stat);
+
+/**
+ * @ingroup base
+ *
+ * Destroy a timer statistics snapshot.
+ *
+ * @param stats A timer statistics snapshot, may be NULL
+ *
+ * @since 1.16
+ */
+void
+libinput_timer_stats_destroy(struct libinput_timer_stats *stats);
+
+/**
+ * @ingroup base
+ *
+ * The phases of the context and device setup whose duration libinput
+ * records, see libinput_get_startup_time() and
+ * libinput_device_get_startup_time().
+ *
+ * @since 1.16
+ */
+enum libinput_startup_phase {
+	/**
+	 * Loading the device quirks, once per context. This includes @ref
+	 * LIBINPUT_STARTUP_PHASE_HOST_LOOKUP.
+	 */
+	LIBINPUT_STARTUP_PHASE_QUIRKS = 1,
+	/**
+	 * Reading the DMI modalias or device tree compatible string of
+	 * the host to match the quirks against, once per context.
+	 */
+	LIBINPUT_STARTUP_PHASE_HOST_LOOKUP,
+	/**
+	 * Enumerating the udev devices on seat assignment and resume,
+	 * excluding the setup of the devices found.
+	 */
+	LIBINPUT_STARTUP_PHASE_ENUMERATE,
+	/**
+	 * Loading the libwacom database, once per context and only if a
+	 * tablet is present. A device's @ref
+	 * LIBINPUT_STARTUP_PHASE_CONFIGURE includes this time for the first
+	 * tablet device.
+	 */
+	LIBINPUT_STARTUP_PHASE_LIBWACOM,
+	/**
+	 * Opening the device with the open_restricted() function of the
+	 * @ref libinput_interface. Devices opened with an asynchronous open
+	 * function, see libinput_set_open_async(), have no open time.
+	 */
+	LIBINPUT_STARTUP_PHASE_OPEN,
+	/**
+	 * Reading the device's capabilities and state through libevdev.
+	 */
+	LIBINPUT_STARTUP_PHASE_LIBEVDEV,
+	/**
+	 * Configuring the device, i.e. matching the quirks, applying the
+	 * axis fixups and setting up the device-specific event processing.
+	 */
+	LIBINPUT_STARTUP_PHASE_CONFIGURE,
+	/**
+	 * Adding the device to its device group and seat and queuing the
+	 * @ref LIBINPUT_EVENT_DEVICE_ADDED event.
+	 */
+	LIBINPUT_STARTUP_PHASE_NOTIFY,
+};
+
+/**
+ * @ingroup base
+ *
+ * Return the total time in microseconds this context spent in the given
+ * setup phase. For the phases that apply to a single device, this is the
+ * sum over all devices set up so far, including devices that failed to
+ * initialize or have since been removed. See
+ * libinput_device_get_startup_time() for the time of a single device.
+ *
+ * This function is intended for debugging and performance analysis.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param phase The setup phase
+ * @return The time in microseconds or 0 if the phase is invalid
+ *
+ * @since 1.16
+ */
+uint64_t
+libinput_get_startup_time(struct libinput *libinput,
+			  enum libinput_startup_phase phase);
+
+/**
+ * @ingroup base
+ *
+ * The memory categories available through libinput_get_memory_stats()
+ * and libinput_device_get_memory_stats(). All values are in bytes.
+ *
+ * The values are what libinput allocated for each category, the
+ * allocator's overhead is not included. Memory allocated by libevdev,
+ * libudev and libwacom is not included either, libinput cannot measure
+ * it.
+ *
+ * @since 1.16
+ */
+enum libinput_memory_stat {
+	/**
+	 * The sum of all other categories.
+	 */
+	LIBINPUT_MEMORY_STAT_TOTAL,
+	/**
+	 * The context struct, seats and device groups.
+	 * Always 0 for a device.
+	 */
+	LIBINPUT_MEMORY_STAT_CONTEXT,
+	/**
+	 * The event queue and the events that are queued but not yet
+	 * retrieved by the caller. For a device, the events of that device
+	 * in the queue.
+	 */
+	LIBINPUT_MEMORY_STAT_EVENT_QUEUE,
+	/**
+	 * Destroyed events kept for reuse. Always 0 for a device.
+	 */
+	LIBINPUT_MEMORY_STAT_EVENT_CACHE,
+	/**
+	 * The device structs and their read buffers.
+	 */
+	LIBINPUT_MEMORY_STAT_DEVICES,
+	/**
+	 * The device-type specific state, e.g. the touchpad's touches or a
+	 * tablet's tools without a serial number.
+	 */
+	LIBINPUT_MEMORY_STAT_DISPATCH,
+	/**
+	 * The timer heap and the timer statistics. Always 0 for a device.
+	 */
+	LIBINPUT_MEMORY_STAT_TIMERS,
+	/**
+	 * The device quirks database and the cached quirks of each device.
+	 * With libinput_set_cache_sharing() the database is shared with
+	 * other contexts and counted in each. Always 0 for a device.
+	 */
+	LIBINPUT_MEMORY_STAT_QUIRKS,
+	/**
+	 * The tablet tools with a serial number, which are shared by all
+	 * tablets of the context. Always 0 for a device.
+	 */
+	LIBINPUT_MEMORY_STAT_TABLET_TOOLS,
+	/**
+	 * The log ring, see libinput_log_set_ring(). Always 0 for a device.
+	 */
+	LIBINPUT_MEMORY_STAT_LOG_RING,
+};
+
+/**
+ * @ingroup base
+ *
+ * Return the number of bytes this context currently has allocated for
+ * the given category, see @ref libinput_memory_stat. The devices and
+ * the dispatch state are summed over all devices of the context.
+ *
+ * This function is intended for debugging and performance analysis, the
+ * values are computed on every call.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param stat The memory category
+ * @return The number of bytes or 0 if the category is invalid
+ *
+ * @see libinput_device_get_memory_stats
+ * @since 1.16
+ */
+uint64_t
+libinput_get_memory_stats(struct libinput *libinput,
+			  enum libinput_memory_stat stat);
+
+/**
+ * @ingroup base
+ *
+ * The stages of event processing whose cost libinput measures while
+ * profiling is enabled, see libinput_set_profiling().
+ *
+ * Stages nest, e.g. the motion filter runs while the touchpad processes
+ * an event. The time of a stage excludes the time spent in any stage
+ * nested inside it, so the stage times add up to the total time spent
+ * in libinput's event processing.
+ *
+ * @since 1.16
+ */
+enum libinput_profile_stage {
+	/**
+	 * Reading events from the device and updating libevdev's view of
+	 * the device state.
+	 */
+	LIBINPUT_PROFILE_STAGE_LIBEVDEV = 1,
+	/**
+	 * Processing an evdev event in the fallback event handling, used
+	 * for mice, keyboards, touchscreens and others.
+	 */
+	LIBINPUT_PROFILE_STAGE_FALLBACK,
+	/**
+	 * Processing an evdev event in the touchpad event handling.
+	 */
+	LIBINPUT_PROFILE_STAGE_TOUCHPAD,
+	/**
+	 * Processing an evdev event in the tablet tool event handling.
+	 */
+	LIBINPUT_PROFILE_STAGE_TABLET,
+	/**
+	 * Processing an evdev event in the tablet pad event handling.
+	 */
+	LIBINPUT_PROFILE_STAGE_TABLET_PAD,
+	/**
+	 * Processing an evdev event in the totem event handling.
+	 */
+	LIBINPUT_PROFILE_STAGE_TOTEM,
+	/**
+	 * Pointer acceleration and other motion filtering.
+	 */
+	LIBINPUT_PROFILE_STAGE_FILTER,
+	/**
+	 * Firing expired timers, including the work done by the timer
+	 * callbacks, e.g. the tap state machine.
+	 */
+	LIBINPUT_PROFILE_STAGE_TIMERS,
+	/**
+	 * Allocating events, coalescing them and adding them to the event
+	 * queue.
+	 */
+	LIBINPUT_PROFILE_STAGE_EVENT_QUEUE,
+};
+
+/**
+ * @ingroup base
+ *
+ * Enable or disable profiling of the event processing stages. While
+ * enabled, libinput measures the time spent in each @ref
+ * libinput_profile_stage, see libinput_get_profile_time() and
+ * libinput_get_profile_count().
+ *
+ * Profiling costs two clock reads every time libinput moves between
+ * stages, i.e. several per evdev event. It is disabled by default and
+ * intended for benchmarking only. Enabling profiling resets the
+ * previously collected values.
+ *
+ * @note Profiling must not be enabled or disabled from within a callback,
+ * e.g. the log handler.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param enable Non-zero to enable profiling, zero to disable it
+ *
+ * @since 1.16
+ */
+void
+libinput_set_profiling(struct libinput *libinput, int enable);
+
+/**
+ * @ingroup base
+ *
+ * Return the time in nanoseconds spent in the given stage since profiling
+ * was enabled, see libinput_set_profiling().
+ *
+ * @param libinput A previously initialized libinput context
+ * @param stage The processing stage
+ * @return The time in nanoseconds or 0 if the stage is invalid
+ *
+ * @since 1.16
+ */
+uint64_t
+libinput_get_profile_time(struct libinput *libinput,
+			  enum libinput_profile_stage stage);
+
+/**
+ * @ingroup base
+ *
+ * Return the number of times libinput entered the given stage since
+ * profiling was enabled, see libinput_set_profiling(). For the dispatch
+ * stages this is the number of evdev events processed.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param stage The processing stage
+ * @return The number of times the stage was entered or 0 if the stage
+ * is invalid
+ *
+ * @since 1.16
+ */
+uint64_t
+libinput_get_profile_count(struct libinput *libinput,
+			   enum libinput_profile_stage stage);
+
+/**
+ * @defgroup seat Initialization and manipulation of seats
+ *
+ * A seat has two identifiers, the physical name and the logical name. A
+ * device is always assigned to exactly one seat. It may change to a
+ * different logical seat but it cannot change physical seats.
+ *
+ * See the libinput documentation for more information on seats.
+ */
+
+/**
+ * @ingroup seat
+ *
+ * Increase the refcount of the seat. A seat will be freed whenever the
+ * refcount reaches 0. This may happen during libinput_dispatch() if the
+ * seat was removed from the system. A caller must ensure to reference
+ * the seat correctly to avoid dangling pointers.
+ *
+ * @param seat A previously obtained seat
+ * @return The passed seat
+ */
+struct libinput_seat *
+libinput_seat_ref(struct libinput_seat *seat);
+
+/**
+ * @ingroup seat
+ *
+ * Decrease the refcount of the seat. A seat will be freed whenever the
+ * refcount reaches 0. This may happen during libinput_dispatch() if the
+ * seat was removed from the system. A caller must ensure to reference
+ * the seat correctly to avoid dangling pointers.
+ *
+ * @param seat A previously obtained seat
+ * @return NULL if seat was destroyed, otherwise the passed seat
+ */
+struct libinput_seat *
+libinput_seat_unref(struct libinput_seat *seat);
+
+/**
+ * @ingroup seat
+ *
+ * Set caller-specific data associated with this seat. libinput does
+ * not manage, look at, or modify this data. The caller must ensure the
+ * data is valid.
+ *
+ * @param seat A previously obtained seat
+ * @param user_data Caller-specific data pointer
+ * @see libinput_seat_get_user_data
+ */
+void
+libinput_seat_set_user_data(struct libinput_seat *seat, void *user_data);
+
+/**
+ * @ingroup seat
+ *
+ * Get the caller-specific data associated with this seat, if any.
+ *
+ * @param seat A previously obtained seat
+ * @return Caller-specific data pointer or NULL if none was set
+ * @see libinput_seat_set_user_data
+ */
+void *
+libinput_seat_get_user_data(struct libinput_seat *seat);
+
+/**
+ * @ingroup seat
+ *
+ * Get the libinput context from the seat.
+ *
+ * @param seat A previously obtained seat
+ * @return The libinput context for this seat.
+ */
+struct libinput *
+libinput_seat_get_context(struct libinput_seat *seat);
+
+/**
+ * @ingroup seat
+ *
+ * Return the physical name of the seat. For libinput contexts created from
+ * udev, this is always the same value as passed into
+ * libinput_udev_assign_seat() and all seats from that context will have
+ * the same physical name.
+ *
+ * The physical name of the seat is one that is usually set by the system or
+ * lower levels of the stack. In most cases, this is the base filter for
+ * devices - devices assigned to seats outside the current seat will not
+ * be available to the caller.
+ *
+ * @param seat A previously obtained seat
+ * @return The physical name of this seat
+ */
+const char *
+libinput_seat_get_physical_name(struct libinput_seat *seat);
+
+/**
+ * @ingroup seat
+ *
+ * Return the logical name of the seat. This is an identifier to group sets
+ * of devices within the compositor.
+ *
+ * @param seat A previously obtained seat
+ * @return The logical name of this seat
+ */
+const char *
+libinput_seat_get_logical_name(struct libinput_seat *seat);
+
+/**
+ * @ingroup seat
+ *
+ * Retrieve the next event from the seat's own event queue, see
+ * libinput_enable_seat_event_queues(). The caller must destroy the event
+ * with libinput_event_destroy().
+ *
+ * Destroying the last event of a removed device may release the seat,
+ * a caller that keeps using the seat must hold a reference to it, see
+ * libinput_seat_ref().
+ *
+ * @param seat A previously obtained seat
+ * @return The next event of this seat or NULL if no event is available
+ * or seat event queues are not enabled
+ *
+ * @see libinput_seat_get_event_fd
+ * @since 1.16
+ */
+struct libinput_event *
+libinput_seat_get_event(struct libinput_seat *seat);
+
+/**
+ * @ingroup seat
+ *
+ * Return a file descriptor that is readable while the seat's event queue
+ * holds events, see libinput_enable_seat_event_queues(). Reading the
+ * events with libinput_seat_get_event() resets it. The caller must not
+ * read from or close the file descriptor.
+ *
+ * New events only arrive during libinput_dispatch(), the caller must
+ * still monitor the file descriptor returned by libinput_get_fd().
+ *
+ * @param seat A previously obtained seat
+ * @return The file descriptor or -1 if the seat has no event queue
+ *
+ * @since 1.16
+ */
+int
+libinput_seat_get_event_fd(struct libinput_seat *seat);
+
+/**
+ * @defgroup device Initialization and manipulation of input devices
+ */
+
+/**
+ * @ingroup device
+ *
+ * Increase the refcount of the input device. An input device will be freed
+ * whenever the refcount reaches 0. This may happen during
+ * libinput_dispatch() if the device was removed from the system. A caller
+ * must ensure to reference the device correctly to avoid dangling pointers.
+ *
+ * @param device A previously obtained device
+ * @return The passed device
+ */
+struct libinput_device *
+libinput_device_ref(struct libinput_device *device);
+
+/**
+ * @ingroup device
+ *
+ * Decrease the refcount of the input device. An input device will be freed
+ * whenever the refcount reaches 0. This may happen during libinput_dispatch
+ * if the device was removed from the system. A caller must ensure to
+ * reference the device correctly to avoid dangling pointers.
+ *
+ * @param device A previously obtained device
+ * @return NULL if the device was destroyed, otherwise the passed device
+ */
+struct libinput_device *
+libinput_device_unref(struct libinput_device *device);
+
+/**
+ * @ingroup device
+ *
+ * Set caller-specific data associated with this input device. libinput does
+ * not manage, look at, or modify this data. The caller must ensure the
+ * data is valid.
+ *
+ * @param device A previously obtained device
+ * @param user_data Caller-specific data pointer
+ * @see libinput_device_get_user_data
+ */
+void
+libinput_device_set_user_data(struct libinput_device *device, void *user_data);
+
+/**
+ * @ingroup device
+ *
+ * Get the caller-specific data associated with this input device, if any.
+ *
+ * @param device A previously obtained device
+ * @return Caller-specific data pointer or NULL if none was set
+ * @see libinput_device_set_user_data
+ */
+void *
+libinput_device_get_user_data(struct libinput_device *device);
+
+/**
+ * @ingroup device
+ *
+ * Enable or disable delivery of the given event type for this device.
+ * Events of a disabled type are dropped by libinput as early as possible,
+ * usually before they are allocated, and never reach the event queue.
+ * Internal processing is not affected, e.g. a disabled @ref
+ * LIBINPUT_EVENT_SWITCH_TOGGLE still disables a touchpad when the lid
+ * closes.
+ *
+ * All event types are enabled by default, or whatever was set with
+ * libinput_set_event_type_enabled() when the device was added. @ref
+ * LIBINPUT_EVENT_DEVICE_ADDED and @ref LIBINPUT_EVENT_DEVICE_REMOVED
+ * cannot be disabled.
+ *
+ * @param device A previously obtained device
+ * @param type The event type to enable or disable
+ * @param enabled Non-zero to enable the event type, zero to disable it
+ * @return 0 on success or -1 if the event type is invalid or cannot be
+ * disabled
+ *
+ * @see libinput_device_get_event_type_enabled
+ * @since 1.16
+ */
+int
+libinput_device_set_event_type_enabled(struct libinput_device *device,
+				       enum libinput_event_type type,
+				       int enabled);
+
+/**
+ * @ingroup device
+ *
+ * Check whether the given event type is delivered for this device.
+ *
+ * @param device A previously obtained device
+ * @param type The event type to check
+ * @return Non-zero if the event type is enabled, zero otherwise
+ *
+ * @see libinput_device_set_event_type_enabled
+ * @since 1.16
+ */
+int
+libinput_device_get_event_type_enabled(struct libinput_device *device,
+				       enum libinput_event_type type);
+
+/**
+ * @ingroup device
+ *
+ * Enable or disable tracking of the time between the kernel timestamp of
+ * an event frame and the time libinput reads and processes it. A high
+ * value means the caller was late calling libinput_dispatch(), as
+ * opposed to libinput being slow to process the events. The results are
+ * available through libinput_device_get_latency_stats().
+ *
+ * One sample is recorded for each frame of events, tracking costs one
+ * clock read each time libinput reads from the device. It is disabled by
+ * default. Enabling tracking resets the previously collected samples.
+ *
+ * @param device A previously obtained device
+ * @param enable Non-zero to enable tracking, zero to disable it
+ *
+ * @see libinput_device_get_latency_tracking
+ * @since 1.16
+ */
+void
+libinput_device_set_latency_tracking(struct libinput_device *device,
+				     int enable);
+
+/**
+ * @ingroup device
+ *
+ * @param device A previously obtained device
+ * @return Non-zero if latency tracking is enabled, zero otherwise
+ *
+ * @see libinput_device_set_latency_tracking
+ * @since 1.16
+ */
+int
+libinput_device_get_latency_tracking(struct libinput_device *device);
+
+/**
+ * @ingroup device
+ *
+ * The values available from libinput_device_get_latency_stats().
+ *
+ * @since 1.16
+ */
+enum libinput_latency_stat {
+	/**
+	 * The number of event frames whose latency was measured.
+	 */
+	LIBINPUT_LATENCY_STAT_SAMPLES,
+	/**
+	 * The median time in microseconds between the kernel timestamp of
+	 * an event frame and its processing. This value is an upper bound
+	 * with a granularity of a power of two.
+	 */
+	LIBINPUT_LATENCY_STAT_P50,
+	/**
+	 * The 99th percentile of the latency in microseconds, see @ref
+	 * LIBINPUT_LATENCY_STAT_P50.
+	 */
+	LIBINPUT_LATENCY_STAT_P99,
+	/**
+	 * The largest latency in microseconds.
+	 */
+	LIBINPUT_LATENCY_STAT_MAX,
+	/**
+	 * The number of touch sequences whose first motion latency was
+	 * measured. The first motion latency is the time between the first
+	 * finger going down and the first pointer motion event from that
+	 * finger. It includes the time the finger is held still and is
+	 * only recorded by touchpads, see
+	 * libinput_device_config_low_latency_set_enabled().
+	 */
+	LIBINPUT_LATENCY_STAT_FIRST_MOTION_SAMPLES,
+	/**
+	 * The median first motion latency in microseconds, see @ref
+	 * LIBINPUT_LATENCY_STAT_FIRST_MOTION_SAMPLES. This value is an upper
+	 * bound with a granularity of a power of two.
+	 */
+	LIBINPUT_LATENCY_STAT_FIRST_MOTION_P50,
+	/**
+	 * The 99th percentile of the first motion latency in microseconds.
+	 */
+	LIBINPUT_LATENCY_STAT_FIRST_MOTION_P99,
+	/**
+	 * The largest first motion latency in microseconds.
+	 */
+	LIBINPUT_LATENCY_STAT_FIRST_MOTION_MAX,
+	/**
+	 * The number of left or right button presses that were held back
+	 * by middle button emulation, see
+	 * libinput_device_config_middle_emulation_set_enabled(). With
+	 * middle button emulation enabled, a button press is only sent once
+	 * libinput has given up waiting for the other button.
+	 */
+	LIBINPUT_LATENCY_STAT_MIDDLEBUTTON_SAMPLES,
+	/**
+	 * The median time in microseconds a button press was held back by
+	 * middle button emulation, see @ref
+	 * LIBINPUT_LATENCY_STAT_MIDDLEBUTTON_SAMPLES. This value is an
+	 * upper bound with a granularity of a power of two.
+	 */
+	LIBINPUT_LATENCY_STAT_MIDDLEBUTTON_P50,
+	/**
+	 * The 99th percentile of the middle button emulation delay in
+	 * microseconds.
+	 */
+	LIBINPUT_LATENCY_STAT_MIDDLEBUTTON_P99,
+	/**
+	 * The largest middle button emulation delay in microseconds.
+	 */
+	LIBINPUT_LATENCY_STAT_MIDDLEBUTTON_MAX,
+};
+
+/**
+ * @ingroup device
+ *
+ * Return the given latency statistic for this device, see
+ * libinput_device_set_latency_tracking(). The values accumulate until
+ * tracking is enabled again.
+ *
+ * @param device A previously obtained device
+ * @param stat The statistic to query
+ * @return The current value of the statistic or 0 if the statistic is
+ * invalid
+ *
+ * @since 1.16
+ */
+uint64_t
+libinput_device_get_latency_stats(struct libinput_device *device,
+				  enum libinput_latency_stat stat);
+
+/**
+ * @ingroup device
+ *
+ * The parts of libinput that hold back an event until they can decide
+ * what to do with it, see libinput_device_get_delay_stats().
+ *
+ * @since 1.16
+ */
+enum libinput_delay_source {
+	/**
+	 * A tap button press, held back until the finger is known not to
+	 * move or start a drag, see
+	 * libinput_device_config_tap_set_enabled(). The delay is measured
+	 * from the finger up or down that is the tap's timestamp.
+	 */
+	LIBINPUT_DELAY_SOURCE_TAP,
+	/**
+	 * A left or right button press, held back by middle button
+	 * emulation while waiting for the other button. This is the same
+	 * data as @ref LIBINPUT_LATENCY_STAT_MIDDLEBUTTON_SAMPLES.
+	 */
+	LIBINPUT_DELAY_SOURCE_MIDDLEBUTTON,
+	/**
+	 * A button press or release, held back by button debouncing until
+	 * it is known not to be a bounce.
+	 */
+	LIBINPUT_DELAY_SOURCE_DEBOUNCE,
+	/**
+	 * A touch in a software button area, waiting for the enter or
+	 * leave timeout of the area, see
+	 * libinput_device_config_click_set_method().
+	 */
+	LIBINPUT_DELAY_SOURCE_SOFTWARE_BUTTONS,
+	/**
+	 * A touch ignored by disable-while-typing, measured from the last
+	 * key press until the touch is released to move the pointer, see
+	 * libinput_device_config_dwt_set_enabled().
+	 */
+	LIBINPUT_DELAY_SOURCE_DWT,
+	/**
+	 * Touches ignored after a tablet tool left proximity, measured
+	 * from the proximity out to the end of the pen/touch arbitration.
+	 */
+	LIBINPUT_DELAY_SOURCE_ARBITRATION,
+	/**
+	 * A change in the number of fingers on a touchpad during a
+	 * gesture, measured from the change to the switch to the new
+	 * gesture.
+	 */
+	LIBINPUT_DELAY_SOURCE_GESTURE,
+	/**
+	 * A tablet tool proximity out that libinput forced because the
+	 * device never sent one, measured from the last event of the tool.
+	 */
+	LIBINPUT_DELAY_SOURCE_TABLET_PROXIMITY,
+};
+
+/**
+ * @ingroup device
+ *
+ * Return the given statistic for the delays from one source, in
+ * microseconds. Only @ref LIBINPUT_LATENCY_STAT_SAMPLES, @ref
+ * LIBINPUT_LATENCY_STAT_P50, @ref LIBINPUT_LATENCY_STAT_P99 and @ref
+ * LIBINPUT_LATENCY_STAT_MAX are valid for stat, the percentiles are
+ * upper bounds with a granularity of a power of two.
+ *
+ * Delays are only recorded while latency tracking is enabled, see
+ * libinput_device_set_latency_tracking(). A source that does not
+ * apply to the device never records a sample.
+ *
+ * @param device A previously obtained device
+ * @param source The source of the delays
+ * @param stat The statistic to query
+ * @return The current value of the statistic or 0 if the source or
+ * statistic is invalid
+ *
+ * @since 1.16
+ */
+uint64_t
+libinput_device_get_delay_stats(struct libinput_device *device,
+				enum libinput_delay_source source,
+				enum libinput_latency_stat stat);
+
+/**
+ * @ingroup device
+ *
+ * The counters available from libinput_device_get_stats().
+ *
+ * @since 1.16
+ */
+enum libinput_device_stat {
+	/**
+	 * The number of evdev events read from the device, including
+	 * the EV_SYN events.
+	 */
+	LIBINPUT_DEVICE_STAT_EVDEV_EVENTS,
+	/**
+	 * The number of evdev frames, i.e. EV_SYN/SYN_REPORT events, read
+	 * from the device.
+	 */
+	LIBINPUT_DEVICE_STAT_EVDEV_FRAMES,
+	/**
+	 * The number of times the kernel's event buffer for this device
+	 * overflowed and events were lost.
+	 */
+	LIBINPUT_DEVICE_STAT_SYN_DROPPED,
+	/**
+	 * The number of libinput events generated by this device,
+	 * including events that were later merged into a queued event or
+	 * filtered out. See libinput_device_get_event_count() for the
+	 * number per event type.
+	 */
+	LIBINPUT_DEVICE_STAT_EVENTS,
+	/**
+	 * The number of touches discarded by palm detection.
+	 */
+	LIBINPUT_DEVICE_STAT_DISCARDED_PALM,
+	/**
+	 * The number of touches discarded by thumb detection.
+	 */
+	LIBINPUT_DEVICE_STAT_DISCARDED_THUMB,
+	/**
+	 * The number of button bounces filtered by button debouncing. Each
+	 * bounce is a press and release pair that never reached the
+	 * caller.
+	 */
+	LIBINPUT_DEVICE_STAT_DISCARDED_BOUNCE,
+	/**
+	 * The number of touch positions discarded as pointer jumps.
+	 */
+	LIBINPUT_DEVICE_STAT_DISCARDED_JUMP,
+	/**
+	 * The number of touches, or of evdev frames, discarded because
+	 * a paired device was in use, e.g. a touchscreen ignoring input
+	 * while a pen is in proximity.
+	 */
+	LIBINPUT_DEVICE_STAT_DISCARDED_ARBITRATION,
+	/**
+	 * The number of touch updates that stayed within the touchpad's
+	 * hysteresis margin. These skip most of the per-touch processing.
+	 */
+	LIBINPUT_DEVICE_STAT_STATIONARY_TOUCHES,
+	/**
+	 * The number of touchpad frames where all touches were hovering
+	 * above the touchpad. These skip the touchpad's state machines.
+	 */
+	LIBINPUT_DEVICE_STAT_HOVER_FRAMES,
+};
+
+/**
+ * @ingroup device
+ *
+ * Return the given counter for this device. Counters accumulate over
+ * the lifetime of the device and are intended to find devices that
+ * cause excessive work, e.g. a device that floods libinput with events
+ * or constantly triggers palm detection.
+ *
+ * @param device A previously obtained device
+ * @param stat The counter to query
+ * @return The current value of the counter or 0 if the counter is
+ * invalid
+ *
+ * @see libinput_device_get_event_count
+ * @since 1.16
+ */
+uint64_t
+libinput_device_get_stats(struct libinput_device *device,
+			  enum libinput_device_stat stat);
+
+/**
+ * @ingroup device
+ *
+ * Return the number of libinput events of the given type generated by
+ * this device, including events that were later merged into a queued
+ * event or filtered out, see @ref LIBINPUT_DEVICE_STAT_EVENTS.
+ *
+ * @param device A previously obtained device
+ * @param type The event type
+ * @return The number of events or 0 if the type is invalid
+ *
+ * @see libinput_device_get_stats
+ * @since 1.16
+ */
+uint64_t
+libinput_device_get_event_count(struct libinput_device *device,
+				enum libinput_event_type type);
+
+/**
+ * @ingroup device
+ *
+ * Return the time in microseconds libinput spent in the given phase
+ * while setting up this device, see @ref libinput_startup_phase. Phases
+ * that apply to the context only, e.g. @ref
+ * LIBINPUT_STARTUP_PHASE_QUIRKS, return 0, see
+ * libinput_get_startup_time() for those.
+ *
+ * This function is intended for debugging and performance analysis.
+ *
+ * @param device A previously obtained device
+ * @param phase The setup phase
+ * @return The time in microseconds or 0 if the phase is invalid
+ *
+ * @since 1.16
+ */
+uint64_t
+libinput_device_get_startup_time(struct libinput_device *device,
+				 enum libinput_startup_phase phase);
+
+/**
+ * @ingroup device
+ *
+ * Return the number of bytes libinput currently has allocated for this
+ * device in the given category, see @ref libinput_memory_stat.
+ * Categories that apply to the context only return 0.
+ *
+ * This function is intended for debugging and performance analysis, the
+ * values are computed on every call.
+ *
+ * @param device A previously obtained device
+ * @param stat The memory category
+ * @return The number of bytes or 0 if the category is invalid
+ *
+ * @see libinput_get_memory_stats
+ * @since 1.16
+ */
+uint64_t
+libinput_device_get_memory_stats(struct libinput_device *device,
+				 enum libinput_memory_stat stat);
+
+/**
+ * @ingroup device
+ *
+ * Enable or disable motion prediction on this device. A compositor
+ * usually draws the cursor or a stroke some time after the last event
+ * was processed, prediction allows it to draw the position the device
+ * is expected to be at when the frame is displayed, see
+ * libinput_device_predict_motion().
  *
- * Get the libinput context from the seat.
+ * Prediction is available on devices with the @ref
+ * LIBINPUT_DEVICE_CAP_POINTER or @ref LIBINPUT_DEVICE_CAP_TABLET_TOOL
+ * capability. It is disabled by default, enabling it costs a few
+ * arithmetic operations per pointer motion or tablet axis event.
+ * Disabling it discards the collected motion history.
  *
- * @param seat A previously obtained seat
- * @return The libinput context for this seat.
+ * @param device A previously obtained device
+ * @param enable Non-zero to enable prediction, zero to disable it
+ * @return 0 on success or -1 if the device does not support prediction
+ *
+ * @see libinput_device_get_motion_prediction
+ * @since 1.16
  */
-struct libinput *
-libinput_seat_get_context(struct libinput_seat *seat);
+int
+libinput_device_set_motion_prediction(struct libinput_device *device,
+				      int enable);
 
 /**
- * @ingroup seat
- *
- * Return the physical name of the seat. For libinput contexts created from
- * udev, this is always the same value as passed into
- * libinput_udev_assign_seat() and all seats from that context will have
- * the same physical name.
+ * @ingroup device
  *
- * The physical name of the seat is one that is usually set by the system or
- * lower levels of the stack. In most cases, this is the base filter for
- * devices - devices assigned to seats outside the current seat will not
- * be available to the caller.
+ * @param device A previously obtained device
+ * @return Non-zero if motion prediction is enabled, zero otherwise
  *
- * @param seat A previously obtained seat
- * @return The physical name of this seat
+ * @see libinput_device_set_motion_prediction
+ * @since 1.16
  */
-const char *
-libinput_seat_get_physical_name(struct libinput_seat *seat);
+int
+libinput_device_get_motion_prediction(struct libinput_device *device);
 
 /**
- * @ingroup seat
+ * @ingroup device
  *
- * Return the logical name of the seat. This is an identifier to group sets
- * of devices within the compositor.
+ * The dispatch priority of a device, see libinput_device_set_priority().
  *
- * @param seat A previously obtained seat
- * @return The logical name of this seat
+ * @since 1.16
  */
-const char *
-libinput_seat_get_logical_name(struct libinput_seat *seat);
+enum libinput_device_priority {
+	LIBINPUT_DEVICE_PRIORITY_NORMAL = 0,
+	/**
+	 * The device's events are not latency-sensitive, it is processed
+	 * after the devices with a normal priority.
+	 */
+	LIBINPUT_DEVICE_PRIORITY_LOW,
+};
 
 /**
- * @defgroup device Initialization and manipulation of input devices
+ * @ingroup device
+ *
+ * Set the dispatch priority of the device. In libinput_dispatch(), the
+ * devices with a low priority are processed after all devices with a
+ * normal priority, so their events never delay e.g. pointer motion or
+ * key events that were available at the same time. Their processing can
+ * be further limited with libinput_set_low_priority_interval().
+ *
+ * Switches, tablet pads and devices marked with a quirk, e.g. some
+ * hotkey keyboards, have a low priority by default. All other devices
+ * have a normal priority.
+ *
+ * The priority has no effect with a source handler set, see
+ * libinput_set_source_handler(), or with io_uring.
+ *
+ * @param device A previously obtained device
+ * @param priority The device's dispatch priority
+ * @return 0 on success or -1 if the priority is invalid
+ *
+ * @see libinput_device_get_priority
+ * @since 1.16
  */
+int
+libinput_device_set_priority(struct libinput_device *device,
+			     enum libinput_device_priority priority);
 
 /**
  * @ingroup device
  *
- * Increase the refcount of the input device. An input device will be freed
- * whenever the refcount reaches 0. This may happen during
- * libinput_dispatch() if the device was removed from the system. A caller
- * must ensure to reference the device correctly to avoid dangling pointers.
- *
  * @param device A previously obtained device
- * @return The passed device
+ * @return The device's dispatch priority
+ *
+ * @see libinput_device_set_priority
+ * @since 1.16
  */
-struct libinput_device *
-libinput_device_ref(struct libinput_device *device);
+enum libinput_device_priority
+libinput_device_get_priority(struct libinput_device *device);
 
 /**
  * @ingroup device
  *
- * Decrease the refcount of the input device. An input device will be freed
- * whenever the refcount reaches 0. This may happen during libinput_dispatch
- * if the device was removed from the system. A caller must ensure to
- * reference the device correctly to avoid dangling pointers.
+ * Predict the motion of the device between the last event processed by
+ * libinput and the given time. The prediction extrapolates the recent
+ * velocity of the device, it is not a substitute for the actual events
+ * and must not be accumulated.
+ *
+ * For pointer devices the result is a delta in the same units as
+ * libinput_event_pointer_get_dx() and libinput_event_pointer_get_dy(),
+ * relative to the position after the last @ref
+ * LIBINPUT_EVENT_POINTER_MOTION event.
+ *
+ * For tablet tools the result is a delta in mm relative to the position
+ * of the last @ref LIBINPUT_EVENT_TABLET_TOOL_AXIS event, in the same
+ * coordinate system as libinput_event_tablet_tool_get_x() and
+ * libinput_event_tablet_tool_get_y().
+ *
+ * If the time is not after the last event, or so far after it that
+ * the device is considered stationary, the predicted delta is 0.
  *
  * @param device A previously obtained device
- * @return NULL if the device was destroyed, otherwise the passed device
+ * @param time_usec The time to predict the motion for, in microseconds
+ * in the same clock as libinput_event_pointer_get_time_usec()
+ * @param dx Set to the predicted delta on the x axis
+ * @param dy Set to the predicted delta on the y axis
+ * @return 0 on success, -1 if prediction is disabled or there was no
+ * motion yet. On failure, dx and dy are left untouched.
+ *
+ * @see libinput_device_set_motion_prediction
+ * @since 1.16
  */
-struct libinput_device *
-libinput_device_unref(struct libinput_device *device);
+int
+libinput_device_predict_motion(struct libinput_device *device,
+			       uint64_t time_usec,
+			       double *dx,
+			       double *dy);
 
 /**
  * @ingroup device
  *
- * Set caller-specific data associated with this input device. libinput does
- * not manage, look at, or modify this data. The caller must ensure the
- * data is valid.
+ * Save the runtime state libinput learned about this device into a
+ * blob that can be passed to libinput_device_restore_state() on the
+ * same device in a later libinput context, e.g. after a compositor
+ * restart. The state includes the pressure offsets detected on tablet
+ * tools and whether a touchpad was detected to jitter. It does not
+ * include the device configuration, the caller is expected to restore
+ * that itself.
+ *
+ * The blob is only valid for the same device on the same machine and
+ * the same version of libinput, its format is not stable.
+ *
+ * If size is smaller than the size of the blob, nothing is written. Use
+ * a size of 0 to query the size.
  *
  * @param device A previously obtained device
- * @param user_data Caller-specific data pointer
- * @see libinput_device_get_user_data
+ * @param buf The buffer to write the blob to, may be NULL if size is 0
+ * @param size The size of buf in bytes
+ * @return The size of the blob in bytes, or 0 if libinput has no
+ * runtime state for this device
+ *
+ * @see libinput_device_restore_state
+ * @since 1.16
  */
-void
-libinput_device_set_user_data(struct libinput_device *device, void *user_data);
+size_t
+libinput_device_save_state(struct libinput_device *device,
+			   void *buf,
+			   size_t size);
 
 /**
  * @ingroup device
  *
- * Get the caller-specific data associated with this input device, if any.
+ * Restore runtime state saved with libinput_device_save_state(). This
+ * should be called immediately after the device was added, state
+ * learned by the device since then may be overwritten.
  *
  * @param device A previously obtained device
- * @return Caller-specific data pointer or NULL if none was set
- * @see libinput_device_set_user_data
+ * @param buf The blob previously returned by libinput_device_save_state()
+ * @param size The size of the blob in bytes
+ * @return 0 on success, or -EINVAL if the blob is invalid or was saved
+ * for a different device or version of libinput
+ *
+ * @see libinput_device_save_state
+ * @since 1.16
  */
-void *
-libinput_device_get_user_data(struct libinput_device *device);
+int
+libinput_device_restore_state(struct libinput_device *device,
+			      const void *buf,
+			      size_t size);
 
 /**
  * @ingroup device
@@ -3922,6 +7816,23 @@ libinput_device_get_device_group(struct libinput_device *device);
 const char *
 libinput_device_get_sysname(struct libinput_device *device);
 
+/**
+ * @ingroup device
+ *
+ * Get the id of the device within its context, the device_id in the
+ * records of the event ring and the evdev tap. The id of a removed
+ * device is not reused for another device.
+ *
+ * @param device A previously obtained device
+ * @return The id of the device, never 0
+ *
+ * @see libinput_enable_event_ring
+ * @see libinput_enable_evdev_tap
+ * @since 1.16
+ */
+uint32_t
+libinput_device_get_id(struct libinput_device *device);
+
 /**
  * @ingroup device
  *
@@ -4100,6 +8011,41 @@ libinput_device_get_size(struct libinput_device *device,
 			 double *width,
 			 double *height);
 
+/**
+ * @ingroup device
+ *
+ * Set the size of the output this device maps to, in the caller's
+ * coordinate space. Touch and tablet tool events of this device then
+ * compute their transformed coordinates for this size once, when the
+ * event is created. A subsequent call to
+ * libinput_event_touch_get_x_transformed(),
+ * libinput_event_tablet_tool_get_x_transformed() or their y equivalents
+ * with the same width or height returns the precomputed value. Calling
+ * those functions with a different size is still supported but computes
+ * the coordinate on every call.
+ *
+ * The output size only affects events created after this call, events
+ * already in the queue are unaffected. It does not change the value
+ * returned by any transformed getter, only the cost of calling it.
+ *
+ * A width or height of 0 unsets the output size.
+ *
+ * @param device The device
+ * @param width The width of the output in the caller's coordinates
+ * @param height The height of the output in the caller's coordinates
+ * @return 0 on success, or -1 if the device does not have absolute x/y
+ * axes
+ *
+ * @see libinput_event_touch_get_x_transformed
+ * @see libinput_event_tablet_tool_get_x_transformed
+ *
+ * @since 1.16
+ */
+int
+libinput_device_set_output_size(struct libinput_device *device,
+				uint32_t width,
+				uint32_t height);
+
 /**
  * @ingroup device
  *
@@ -4321,6 +8267,7 @@ libinput_device_group_get_user_data(struct libinput_device_group *group);
  *    - libinput_device_config_click_set_method()
  *    - libinput_device_config_scroll_set_method()
  *    - libinput_device_config_dwt_set_enabled()
+ *    - libinput_device_config_low_latency_set_enabled()
  * - Touchscreens:
  *    - libinput_device_config_calibration_set_matrix()
  * - Pointer devices (mice, trackballs, touchpads):
@@ -4358,6 +8305,52 @@ enum libinput_config_status {
 const char *
 libinput_config_status_to_str(enum libinput_config_status status);
 
+/**
+ * @ingroup config
+ *
+ * Start a configuration transaction on this device. Until
+ * libinput_device_config_commit() is called, configuration changes are
+ * validated and stored, and the getters return the new values, but
+ * changes that need a state reset on the device are not applied. This
+ * includes enabling or disabling tapping, the click method, middle
+ * button emulation, left-handed mode, the scroll method and the pointer
+ * acceleration profile.
+ *
+ * Use this when applying a set of configuration options at once, the
+ * device then goes through one state reset instead of one per option.
+ *
+ * @param device The device to configure
+ * @return @ref LIBINPUT_CONFIG_STATUS_INVALID if a transaction is
+ * already in progress on this device, @ref LIBINPUT_CONFIG_STATUS_SUCCESS
+ * otherwise.
+ *
+ * @see libinput_device_config_commit
+ *
+ * @since 1.16
+ */
+enum libinput_config_status
+libinput_device_config_begin(struct libinput_device *device);
+
+/**
+ * @ingroup config
+ *
+ * Apply all configuration changes made since
+ * libinput_device_config_begin(). Changes that must wait until the
+ * device is in a neutral state, e.g. left-handed mode while a button is
+ * held down, take effect as they would outside a transaction.
+ *
+ * @param device The device to configure
+ * @return @ref LIBINPUT_CONFIG_STATUS_INVALID if no transaction is in
+ * progress on this device, @ref LIBINPUT_CONFIG_STATUS_SUCCESS
+ * otherwise.
+ *
+ * @see libinput_device_config_begin
+ *
+ * @since 1.16
+ */
+enum libinput_config_status
+libinput_device_config_commit(struct libinput_device *device);
+
 /**
  * @ingroup config
  */
@@ -4697,6 +8690,97 @@ libinput_device_config_tap_get_drag_lock_enabled(struct libinput_device *device)
 enum libinput_config_drag_lock_state
 libinput_device_config_tap_get_default_drag_lock_enabled(struct libinput_device *device);
 
+/**
+ * @ingroup config
+ * @since 1.16
+ */
+enum libinput_config_tap_early_commit_state {
+	/** Early commit is to be disabled, or is currently disabled */
+	LIBINPUT_CONFIG_TAP_EARLY_COMMIT_DISABLED,
+	/** Early commit is to be enabled, or is currently enabled */
+	LIBINPUT_CONFIG_TAP_EARLY_COMMIT_ENABLED,
+};
+
+/**
+ * @ingroup config
+ *
+ * Enable or disable early commit of a single-finger tap on this device.
+ *
+ * With tap-and-drag enabled, the button release of a single-finger tap
+ * is normally delayed until the tap timeout expires, so that a
+ * subsequent touch can turn the tap into a drag. When early commit is
+ * enabled, the button release is sent as soon as the tap can no longer
+ * become a drag. The release is never sent while a drag is still
+ * possible, a release followed by a new button press for the drag would
+ * be seen by the caller as a double-click followed by a drag.
+ *
+ * Early commit has no effect when tap-and-drag is disabled, in that case
+ * the tap is always sent immediately.
+ *
+ * Enabling early commit on a device that has tapping disabled is
+ * permitted, but has no effect until tapping is enabled.
+ *
+ * @param device The device to configure
+ * @param enable @ref LIBINPUT_CONFIG_TAP_EARLY_COMMIT_ENABLED to enable
+ * early commit or @ref LIBINPUT_CONFIG_TAP_EARLY_COMMIT_DISABLED to disable
+ * it
+ *
+ * @return A config status code. Disabling early commit on a device that
+ * does not support tapping always succeeds.
+ *
+ * @see libinput_device_config_tap_get_early_commit_enabled
+ * @see libinput_device_config_tap_get_default_early_commit_enabled
+ *
+ * @since 1.16
+ */
+enum libinput_config_status
+libinput_device_config_tap_set_early_commit_enabled(struct libinput_device *device,
+						    enum libinput_config_tap_early_commit_state enable);
+
+/**
+ * @ingroup config
+ *
+ * Check if early commit of taps is enabled on this device. If the device
+ * does not support tapping, this function always returns
+ * @ref LIBINPUT_CONFIG_TAP_EARLY_COMMIT_DISABLED.
+ *
+ * @param device The device to configure
+ *
+ * @retval LIBINPUT_CONFIG_TAP_EARLY_COMMIT_ENABLED If early commit is
+ * currently enabled
+ * @retval LIBINPUT_CONFIG_TAP_EARLY_COMMIT_DISABLED If early commit is
+ * currently disabled
+ *
+ * @see libinput_device_config_tap_set_early_commit_enabled
+ * @see libinput_device_config_tap_get_default_early_commit_enabled
+ *
+ * @since 1.16
+ */
+enum libinput_config_tap_early_commit_state
+libinput_device_config_tap_get_early_commit_enabled(struct libinput_device *device);
+
+/**
+ * @ingroup config
+ *
+ * Check if early commit of taps is enabled by default on this device. If
+ * the device does not support tapping, this function always returns
+ * @ref LIBINPUT_CONFIG_TAP_EARLY_COMMIT_DISABLED.
+ *
+ * @param device The device to configure
+ *
+ * @retval LIBINPUT_CONFIG_TAP_EARLY_COMMIT_ENABLED If early commit is
+ * enabled by default
+ * @retval LIBINPUT_CONFIG_TAP_EARLY_COMMIT_DISABLED If early commit is
+ * disabled by default
+ *
+ * @see libinput_device_config_tap_set_early_commit_enabled
+ * @see libinput_device_config_tap_get_early_commit_enabled
+ *
+ * @since 1.16
+ */
+enum libinput_config_tap_early_commit_state
+libinput_device_config_tap_get_default_early_commit_enabled(struct libinput_device *device);
+
 /**
  * @ingroup config
  *
@@ -5031,6 +9115,16 @@ enum libinput_config_accel_profile {
 	 * on the input speed. This is the default profile for most devices.
 	 */
 	LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE = (1 << 1),
+
+	/**
+	 * A custom acceleration profile. Pointer acceleration follows a
+	 * caller-provided curve, see
+	 * libinput_device_config_accel_set_custom_curve(). The speed
+	 * setting has no effect on this profile.
+	 *
+	 * @since 1.16
+	 */
+	LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM = (1 << 2),
 };
 
 /**
@@ -5093,6 +9187,46 @@ libinput_device_config_accel_get_profile(struct libinput_device *device);
 enum libinput_config_accel_profile
 libinput_device_config_accel_get_default_profile(struct libinput_device *device);
 
+/**
+ * @ingroup config
+ *
+ * Set the curve used by the @ref LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM
+ * acceleration profile.
+ *
+ * The curve maps the speed of the device to the speed of the pointer,
+ * both in units/ms normalized to 1000dpi. The curve is uniformly
+ * sampled, points[i] is the output speed for an input speed of
+ * i * step. Between points the output speed is linearly interpolated,
+ * beyond the last point it is extrapolated from the last two points.
+ *
+ * The default curve is the identity with a step of 1 and the points
+ * 0 and 1, i.e. the pointer moves 1:1 with the device.
+ *
+ * The curve is copied and may be set at any time, it takes effect
+ * immediately if the custom profile is the current profile and is
+ * otherwise used once the custom profile is selected with
+ * libinput_device_config_accel_set_profile().
+ *
+ * @param device The device to configure
+ * @param step The input speed difference between two points in
+ * units/ms, must be greater than zero
+ * @param points The output speeds in units/ms, all values must be
+ * zero or greater
+ * @param npoints The number of points, between 2 and 64
+ *
+ * @return A config status code. If the device does not support the
+ * custom profile, @ref LIBINPUT_CONFIG_STATUS_UNSUPPORTED is returned.
+ *
+ * @see libinput_device_config_accel_set_profile
+ *
+ * @since 1.16
+ */
+enum libinput_config_status
+libinput_device_config_accel_set_custom_curve(struct libinput_device *device,
+					      double step,
+					      const double *points,
+					      size_t npoints);
+
 /**
  * @ingroup config
  *
@@ -5839,6 +9973,108 @@ libinput_device_config_dwt_get_enabled(struct libinput_device *device);
 enum libinput_config_dwt_state
 libinput_device_config_dwt_get_default_enabled(struct libinput_device *device);
 
+/**
+ * @ingroup config
+ *
+ * Possible states for the low-latency mode.
+ *
+ * @since 1.16
+ */
+enum libinput_config_low_latency_state {
+	LIBINPUT_CONFIG_LOW_LATENCY_DISABLED,
+	LIBINPUT_CONFIG_LOW_LATENCY_ENABLED,
+};
+
+/**
+ * @ingroup config
+ *
+ * Check if this device supports a low-latency mode. This is currently
+ * only available on touchpads.
+ *
+ * @param device The device to configure
+ * @return 0 if this device does not support a low-latency mode, or 1
+ * otherwise.
+ *
+ * @see libinput_device_config_low_latency_set_enabled
+ * @see libinput_device_config_low_latency_get_enabled
+ * @see libinput_device_config_low_latency_get_default_enabled
+ *
+ * @since 1.16
+ */
+int
+libinput_device_config_low_latency_is_available(struct libinput_device *device);
+
+/**
+ * @ingroup config
+ *
+ * Enable or disable the low-latency mode. libinput usually applies a
+ * hysteresis to touchpads that have a fuzz value set, this filters
+ * jitter at the cost of swallowing the start of each movement. When
+ * the low-latency mode is enabled, the device is assumed to be
+ * jitter-free and the hysteresis is skipped. If libinput detects jitter
+ * on the device, the hysteresis is applied regardless.
+ *
+ * The effect on the first movement of each touch can be measured with
+ * @ref LIBINPUT_LATENCY_STAT_FIRST_MOTION_P50 and related statistics,
+ * see libinput_device_get_latency_stats().
+ *
+ * @param device The device to configure
+ * @param enable @ref LIBINPUT_CONFIG_LOW_LATENCY_DISABLED to disable
+ * the low-latency mode, @ref LIBINPUT_CONFIG_LOW_LATENCY_ENABLED to enable
+ *
+ * @return A config status code. Disabling the low-latency mode on a
+ * device that does not support the feature always succeeds.
+ *
+ * @see libinput_device_config_low_latency_is_available
+ * @see libinput_device_config_low_latency_get_enabled
+ * @see libinput_device_config_low_latency_get_default_enabled
+ *
+ * @since 1.16
+ */
+enum libinput_config_status
+libinput_device_config_low_latency_set_enabled(struct libinput_device *device,
+					       enum libinput_config_low_latency_state enable);
+
+/**
+ * @ingroup config
+ *
+ * Check if the low-latency mode is currently enabled on this device. If
+ * the device does not support a low-latency mode, this function returns
+ * @ref LIBINPUT_CONFIG_LOW_LATENCY_DISABLED.
+ *
+ * @param device The device to configure
+ * @return @ref LIBINPUT_CONFIG_LOW_LATENCY_DISABLED if disabled, @ref
+ * LIBINPUT_CONFIG_LOW_LATENCY_ENABLED if enabled.
+ *
+ * @see libinput_device_config_low_latency_is_available
+ * @see libinput_device_config_low_latency_set_enabled
+ * @see libinput_device_config_low_latency_get_default_enabled
+ *
+ * @since 1.16
+ */
+enum libinput_config_low_latency_state
+libinput_device_config_low_latency_get_enabled(struct libinput_device *device);
+
+/**
+ * @ingroup config
+ *
+ * Check if the low-latency mode is enabled on this device by default. If
+ * the device does not support a low-latency mode, this function returns
+ * @ref LIBINPUT_CONFIG_LOW_LATENCY_DISABLED.
+ *
+ * @param device The device to configure
+ * @return @ref LIBINPUT_CONFIG_LOW_LATENCY_DISABLED if disabled, @ref
+ * LIBINPUT_CONFIG_LOW_LATENCY_ENABLED if enabled.
+ *
+ * @see libinput_device_config_low_latency_is_available
+ * @see libinput_device_config_low_latency_set_enabled
+ * @see libinput_device_config_low_latency_get_enabled
+ *
+ * @since 1.16
+ */
+enum libinput_config_low_latency_state
+libinput_device_config_low_latency_get_default_enabled(struct libinput_device *device);
+
 /**
  * @ingroup config
  *
@@ -5930,6 +10166,141 @@ libinput_device_config_rotation_get_angle(struct libinput_device *device);
 unsigned int
 libinput_device_config_rotation_get_default_angle(struct libinput_device *device);
 
+/**
+ * @ingroup config
+ *
+ * The version of struct libinput_config_snapshot described by this
+ * header.
+ *
+ * @since 1.16
+ */
+#define LIBINPUT_CONFIG_SNAPSHOT_VERSION 1
+
+/**
+ * @ingroup config
+ *
+ * A copy of all configuration options of a device, filled in by
+ * libinput_device_config_get_snapshot(). Each value is the same as
+ * returned by the respective getter function, e.g. tap.drag_lock is the
+ * value of libinput_device_config_tap_get_drag_lock_enabled() and
+ * tap.default_drag_lock the value of
+ * libinput_device_config_tap_get_default_drag_lock_enabled(). Options
+ * that are not available on the device have the value their getter
+ * returns in that case.
+ *
+ * Future versions of libinput may append fields to this struct, see
+ * libinput_device_config_get_snapshot().
+ *
+ * @since 1.16
+ */
+struct libinput_config_snapshot {
+	uint32_t version;	/**< LIBINPUT_CONFIG_SNAPSHOT_VERSION */
+
+	struct {
+		int finger_count; /**< 0 if tapping is not available */
+		enum libinput_config_tap_state enabled, default_enabled;
+		enum libinput_config_tap_button_map button_map,
+						    default_button_map;
+		enum libinput_config_drag_state drag, default_drag;
+		enum libinput_config_drag_lock_state drag_lock,
+						     default_drag_lock;
+		enum libinput_config_tap_early_commit_state early_commit,
+							    default_early_commit;
+	} tap;
+
+	struct {
+		int has_matrix;
+		float matrix[6], default_matrix[6];
+	} calibration;
+
+	struct {
+		uint32_t modes;
+		uint32_t mode, default_mode;
+	} send_events;
+
+	struct {
+		int available;
+		double speed, default_speed;
+		uint32_t profiles;
+		enum libinput_config_accel_profile profile, default_profile;
+	} accel;
+
+	struct {
+		int available;
+		int enabled, default_enabled;
+	} natural_scroll;
+
+	struct {
+		int available;
+		int enabled, default_enabled;
+	} left_handed;
+
+	struct {
+		uint32_t methods;
+		enum libinput_config_click_method method, default_method;
+	} click;
+
+	struct {
+		int available;
+		enum libinput_config_middle_emulation_state enabled,
+							    default_enabled;
+	} middle_emulation;
+
+	struct {
+		uint32_t methods;
+		enum libinput_config_scroll_method method, default_method;
+		uint32_t button, default_button;
+		enum libinput_config_scroll_button_lock_state button_lock,
+							      default_button_lock;
+	} scroll;
+
+	struct {
+		int available;
+		enum libinput_config_dwt_state enabled, default_enabled;
+	} dwt;
+
+	struct {
+		int available;
+		enum libinput_config_low_latency_state enabled,
+						       default_enabled;
+	} low_latency;
+
+	struct {
+		int available;
+		unsigned int angle, default_angle;
+	} rotation;
+};
+
+/**
+ * @ingroup config
+ *
+ * Fill in the current value, the default value and the availability of
+ * every configuration option of the device, see struct
+ * libinput_config_snapshot. This is an alternative to the per-option
+ * getter functions for callers that display the whole configuration of
+ * a device, e.g. a settings panel.
+ *
+ * At most size bytes of snapshot are written, pass sizeof(struct
+ * libinput_config_snapshot). A caller compiled against an older version
+ * of this header gets the fields of that version only,
+ * snapshot->version is set to the version libinput filled in.
+ *
+ * Inside a configuration transaction, see
+ * libinput_device_config_begin(), the snapshot has the same values as
+ * the getter functions.
+ *
+ * @param device The device to query
+ * @param snapshot The snapshot to fill in
+ * @param size The size of the caller's struct libinput_config_snapshot
+ * @return 0 on success or -1 if size is too small for the version field
+ *
+ * @since 1.16
+ */
+int
+libinput_device_config_get_snapshot(struct libinput_device *device,
+				    struct libinput_config_snapshot *snapshot,
+				    size_t size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -28,11 +28,14 @@
 #include <libudev.h>
 
 #include "evdev.h"
+#include "util-input-event.h"
 
 struct path_input {
 	struct libinput base;
 	struct udev *udev;
 	struct list path_list;
+	bool replay;
+	uint64_t replay_time; /* of the last pushed event */
 };
 
 struct path_device {
@@ -174,7 +177,8 @@ out:
 static struct libinput_device *
 path_device_enable(struct path_input *input,
 		   struct udev_device *udev_device,
-		   const char *seat_logical_name_override)
+		   const char *seat_logical_name_override,
+		   struct evdev_probe *probe)
 {
 	struct path_seat *seat;
 	struct evdev_device *device = NULL;
@@ -188,7 +192,7 @@ path_device_enable(struct path_input *input,
 	if (!seat)
 		goto out;
 
-	device = evdev_device_create(&seat->base, udev_device);
+	device = evdev_device_create(&seat->base, udev_device, probe);
 	libinput_seat_unref(&seat->base);
 
 	if (device == EVDEV_UNHANDLED_DEVICE) {
@@ -206,6 +210,9 @@ path_device_enable(struct path_input *input,
 		goto out;
 	}
 
+	if (input->replay)
+		evdev_device_set_replay(device);
+
 	evdev_read_calibration_prop(device);
 	output_name = udev_device_get_property_value(udev_device, "WL_OUTPUT");
 	device->output_name = safe_strdup(output_name);
@@ -219,13 +226,42 @@ path_input_enable(struct libinput *libinput)
 {
 	struct path_input *input = (struct path_input*)libinput;
 	struct path_device *dev;
+	struct evdev_probe *probes;
+	size_t nprobes = 0;
+	int rc = 0;
 
-	list_for_each(dev, &input->path_list, link) {
-		if (path_device_enable(input, dev->udev_device, NULL) == NULL) {
-			path_input_disable(libinput);
-			return -1;
-		}
+	list_for_each(dev, &input->path_list, link)
+		nprobes++;
+
+	if (nprobes == 0)
+		goto out;
+
+	/* Re-open all devices in one go, see evdev_probe_devices() */
+	probes = zalloc(nprobes * sizeof(*probes));
+	nprobes = 0;
+	list_for_each(dev, &input->path_list, link)
+		probes[nprobes++].udev_device = dev->udev_device;
+
+	evdev_probe_devices(libinput, probes, nprobes);
+
+	for (size_t i = 0; i < nprobes; i++) {
+		if (rc == 0 &&
+		    path_device_enable(input,
+				       probes[i].udev_device,
+				       NULL,
+				       &probes[i]) == NULL)
+			rc = -1;
+		evdev_probe_release(libinput, &probes[i]);
 	}
+	free(probes);
+
+	if (rc != 0) {
+		path_input_disable(libinput);
+		return rc;
+	}
+
+out:
+	quirks_cache_expire(libinput->quirks);
 
 	return 0;
 }
@@ -254,7 +290,8 @@ path_input_destroy(struct libinput *input)
 static struct libinput_device *
 path_create_device(struct libinput *libinput,
 		   struct udev_device *udev_device,
-		   const char *seat_name)
+		   const char *seat_name,
+		   struct evdev_probe *probe)
 {
 	struct path_input *input = (struct path_input*)libinput;
 	struct path_device *dev;
@@ -265,7 +302,7 @@ path_create_device(struct libinput *libinput,
 
 	list_insert(&input->path_list, &dev->link);
 
-	device = path_device_enable(input, udev_device, seat_name);
+	device = path_device_enable(input, udev_device, seat_name, probe);
 
 	if (!device)
 		path_device_destroy(dev);
@@ -286,7 +323,7 @@ path_device_change_seat(struct libinput_device *device,
 	udev_device_ref(udev_device);
 	libinput_path_remove_device(device);
 
-	if (path_create_device(libinput, udev_device, seat_name) != NULL)
+	if (path_create_device(libinput, udev_device, seat_name, NULL) != NULL)
 		rc = 0;
 	udev_device_unref(udev_device);
 	return rc;
@@ -299,9 +336,9 @@ static const struct libinput_interface_backend interface_backend = {
 	.device_change_seat = path_device_change_seat,
 };
 
-LIBINPUT_EXPORT struct libinput *
-libinput_path_create_context(const struct libinput_interface *interface,
-			     void *user_data)
+static struct path_input *
+path_input_create(const struct libinput_interface *interface,
+		  void *user_data)
 {
 	struct path_input *input;
 	struct udev *udev;
@@ -324,6 +361,43 @@ libinput_path_create_context(const struct libinput_interface *interface,
 	input->udev = udev;
 	list_init(&input->path_list);
 
+	return input;
+}
+
+LIBINPUT_EXPORT struct libinput *
+libinput_path_create_context(const struct libinput_interface *interface,
+			     void *user_data)
+{
+	struct path_input *input;
+
+	input = path_input_create(interface, user_data);
+
+	return input ? &input->base : NULL;
+}
+
+static uint64_t
+replay_clock(struct libinput *libinput, void *user_data)
+{
+	struct path_input *input = user_data;
+
+	return input->replay_time;
+}
+
+LIBINPUT_EXPORT struct libinput *
+libinput_replay_create_context(const struct libinput_interface *interface,
+			       void *user_data)
+{
+	struct path_input *input;
+
+	input = path_input_create(interface, user_data);
+	if (!input)
+		return NULL;
+
+	input->replay = true;
+	/* Until the first event is pushed, time is whatever it was before */
+	input->replay_time = now_in_us();
+	libinput_set_clock(&input->base, replay_clock, input);
+
 	return &input->base;
 }
 
@@ -396,11 +470,168 @@ libinput_path_add_device(struct libinput *libinput,
 	 */
 	libinput_init_quirks(libinput);
 
-	device = path_create_device(libinput, udev_device, NULL);
+	device = path_create_device(libinput, udev_device, NULL, NULL);
 	udev_device_unref(udev_device);
 	return device;
 }
 
+/* Resolves all devnodes first and then waits for the uninitialized
+ * ones together, so a set of devices still being processed by udev
+ * costs one wait instead of one per device. Entries that can't be
+ * resolved are left as NULL.
+ */
+static void
+udev_devices_from_devnodes(struct libinput *libinput,
+			   struct udev *udev,
+			   const char **devnodes,
+			   dev_t *devnums,
+			   struct udev_device **devices,
+			   size_t ndevices)
+{
+	size_t pending = 0;
+	size_t count = 0;
+
+	for (size_t i = 0; i < ndevices; i++) {
+		struct stat st;
+
+		devices[i] = NULL;
+		devnums[i] = 0;
+
+		if (stat(devnodes[i], &st) < 0)
+			continue;
+
+		devnums[i] = st.st_rdev;
+		devices[i] = udev_device_new_from_devnum(udev, 'c', devnums[i]);
+		if (devices[i] && !udev_device_get_is_initialized(devices[i]))
+			pending++;
+	}
+
+	while (pending > 0) {
+		if (++count > 200) {
+			for (size_t i = 0; i < ndevices; i++) {
+				if (!devices[i] ||
+				    udev_device_get_is_initialized(devices[i]))
+					continue;
+
+				log_bug_libinput(libinput,
+						 "udev device never initialized (%s)\n",
+						 devnodes[i]);
+				devices[i] = udev_device_unref(devices[i]);
+			}
+			break;
+		}
+
+		msleep(10);
+
+		pending = 0;
+		for (size_t i = 0; i < ndevices; i++) {
+			if (!devices[i] ||
+			    udev_device_get_is_initialized(devices[i]))
+				continue;
+
+			udev_device_unref(devices[i]);
+			devices[i] = udev_device_new_from_devnum(udev,
+								 'c',
+								 devnums[i]);
+			if (devices[i] &&
+			    !udev_device_get_is_initialized(devices[i]))
+				pending++;
+		}
+	}
+}
+
+LIBINPUT_EXPORT int
+libinput_path_add_devices(struct libinput *libinput,
+			  const char **paths,
+			  size_t npaths,
+			  struct libinput_device **devices)
+{
+	struct path_input *input = (struct path_input *)libinput;
+	struct udev_device **udev_devices;
+	struct evdev_probe *probes;
+	dev_t *devnums;
+	size_t nprobes = 0;
+	int nadded = 0;
+
+	if (libinput->interface_backend != &interface_backend) {
+		log_bug_client(libinput, "Mismatching backends.\n");
+		return -1;
+	}
+
+	for (size_t i = 0; i < npaths; i++) {
+		if (devices)
+			devices[i] = NULL;
+
+		if (strlen(paths[i]) > PATH_MAX) {
+			log_bug_client(libinput,
+				       "Unexpected path, limited to %d characters.\n",
+				       PATH_MAX);
+			return -1;
+		}
+	}
+
+	if (npaths == 0)
+		return 0;
+
+	udev_devices = zalloc(npaths * sizeof(*udev_devices));
+	devnums = zalloc(npaths * sizeof(*devnums));
+	probes = zalloc(npaths * sizeof(*probes));
+
+	udev_devices_from_devnodes(libinput,
+				   input->udev,
+				   paths,
+				   devnums,
+				   udev_devices,
+				   npaths);
+	free(devnums);
+
+	for (size_t i = 0; i < npaths; i++) {
+		if (!udev_devices[i]) {
+			log_bug_client(libinput, "Invalid path %s\n", paths[i]);
+			continue;
+		}
+
+		if (ignore_litest_test_suite_device(udev_devices[i])) {
+			udev_devices[i] = udev_device_unref(udev_devices[i]);
+			continue;
+		}
+
+		probes[nprobes++].udev_device = udev_devices[i];
+	}
+
+	/* See libinput_path_add_device() */
+	libinput_init_quirks(libinput);
+
+	evdev_probe_devices(libinput, probes, nprobes);
+
+	/* Devices are created in the caller's order, their
+	 * DEVICE_ADDED events are queued back-to-back */
+	for (size_t i = 0, p = 0; i < npaths; i++) {
+		struct libinput_device *device;
+
+		if (!udev_devices[i])
+			continue;
+
+		device = path_create_device(libinput,
+					    udev_devices[i],
+					    NULL,
+					    &probes[p]);
+		evdev_probe_release(libinput, &probes[p]);
+		p++;
+
+		if (device)
+			nadded++;
+		if (devices)
+			devices[i] = device;
+		udev_device_unref(udev_devices[i]);
+	}
+
+	free(probes);
+	free(udev_devices);
+
+	return nadded;
+}
+
 LIBINPUT_EXPORT void
 libinput_path_remove_device(struct libinput_device *device)
 {
@@ -415,6 +646,11 @@ libinput_path_remove_device(struct libinput_device *device)
 		return;
 	}
 
+	if (libinput->replug.timeout)
+		quirks_cache_retire(libinput->quirks, evdev->udev_device);
+	else
+		quirks_cache_forget(libinput->quirks, evdev->udev_device);
+
 	list_for_each(dev, &input->path_list, link) {
 		if (dev->udev_device == evdev->udev_device) {
 			path_device_destroy(dev);
@@ -427,3 +663,64 @@ libinput_path_remove_device(struct libinput_device *device)
 	path_disable_device(libinput, evdev);
 	libinput_seat_unref(seat);
 }
+
+/* Events and timers on a replay context run on the recording's clock,
+ * libinput_now() returns the time of the event being processed so the
+ * timers are armed relative to that rather than to the wall clock */
+static inline void
+replay_set_time(struct libinput *libinput, uint64_t time)
+{
+	struct path_input *input = (struct path_input*)libinput;
+
+	input->replay_time = time;
+	libinput->dispatch_now = time;
+	libinput_timer_flush(libinput, time);
+}
+
+LIBINPUT_EXPORT int
+libinput_replay_device_push_event(struct libinput_device *device,
+				  uint64_t time,
+				  uint16_t type,
+				  uint16_t code,
+				  int32_t value)
+{
+	struct libinput *libinput = device->seat->libinput;
+	struct path_input *input = (struct path_input*)libinput;
+	struct evdev_device *evdev = evdev_device(device);
+	struct input_event ev;
+
+	if (libinput->interface_backend != &interface_backend ||
+	    !input->replay) {
+		log_bug_client(libinput, "Mismatching backends.\n");
+		return -EINVAL;
+	}
+
+	if (evdev->fd == -1)
+		return -ENODEV;
+
+	ev = input_event_init(time, type, code, value);
+
+	/* The timers are flushed at the start of each frame by the
+	 * device itself */
+	input->replay_time = time;
+	libinput->dispatch_now = time;
+	evdev_device_replay_event(evdev, &ev);
+	libinput->dispatch_now = 0;
+
+	return 0;
+}
+
+LIBINPUT_EXPORT void
+libinput_replay_advance_time(struct libinput *libinput, uint64_t time)
+{
+	struct path_input *input = (struct path_input*)libinput;
+
+	if (libinput->interface_backend != &interface_backend ||
+	    !input->replay) {
+		log_bug_client(libinput, "Mismatching backends.\n");
+		return;
+	}
+
+	replay_set_time(libinput, time);
+	libinput->dispatch_now = 0;
+}
@@ -35,7 +35,13 @@
 #include <dirent.h>
 #include <fnmatch.h>
 #include <libgen.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
+#include "libinput-version.h"
 #include "libinput-versionsort.h"
 #include "libinput-util.h"
 
@@ -137,11 +143,24 @@ struct match {
 	char *dt;	/* device tree compatible (first) string */
 };
 
+/**
+ * One data file or the override file as last loaded, see
+ * quirks_context_reload().
+ */
+struct quirks_file {
+	struct list link; /* struct quirks_context.files */
+	char *path;
+	uint64_t stamp; /* stamp_file() of just this file */
+	size_t index; /* position in the load order */
+	bool changed; /* only during quirks_context_reload() */
+};
+
 /**
  * Represents one section in the .quirks file.
  */
 struct section {
 	struct list link;
+	const struct quirks_file *file; /* NULL if loaded from the image */
 
 	bool has_match;		/* to check for empty sections */
 	bool has_property;	/* to check for empty sections */
@@ -149,12 +168,30 @@ struct section {
 	char *name;		/* the [Section Name] */
 	struct match match;
 	struct list properties;
+
+	size_t order;		/* position in quirks_context.sections */
+};
+
+/**
+ * The sections that match on one vendor ID and, unless any_product is
+ * set, one product ID, in the order they were loaded.
+ */
+struct section_bucket {
+	uint32_t vendor;
+	uint32_t product;
+	bool any_product;
+
+	struct section **sections;
+	size_t nsections;
 };
 
 /**
  * The struct returned to the caller. It contains the
  * properties for a given device.
  */
+#define QUIRK_NMODELS (_QUIRK_LAST_MODEL_QUIRK_ - QUIRK_MODEL_ALPS_SERIAL_TOUCHPAD)
+#define QUIRK_NATTRS (_QUIRK_LAST_ATTR_QUIRK_ - QUIRK_ATTR_SIZE_HINT)
+
 struct quirks {
 	size_t refcount;
 	struct list link; /* struct quirks_context.quirks */
@@ -162,8 +199,68 @@ struct quirks {
 	/* These are not ref'd, just a collection of pointers */
 	struct property **properties;
 	size_t nproperties;
+
+	/* The last property assigned for each quirk, see quirk_index().
+	 * Points into properties */
+	struct property *by_quirk[QUIRK_NMODELS + QUIRK_NATTRS];
+};
+
+/* Maps the model and attr quirks into a single contiguous range, or
+ * returns -1 for anything else */
+static inline int
+quirk_index(enum quirk which)
+{
+	if (which >= QUIRK_MODEL_ALPS_SERIAL_TOUCHPAD &&
+	    which < _QUIRK_LAST_MODEL_QUIRK_)
+		return which - QUIRK_MODEL_ALPS_SERIAL_TOUCHPAD;
+
+	if (which >= QUIRK_ATTR_SIZE_HINT &&
+	    which < _QUIRK_LAST_ATTR_QUIRK_)
+		return QUIRK_NMODELS + which - QUIRK_ATTR_SIZE_HINT;
+
+	return -1;
+}
+
+struct quirks_log_message {
+	struct list link; /* struct quirks_context.deferred_log.messages */
+	enum quirks_log_priorities priority;
+	char *message;
+};
+
+/**
+ * The result of quirks_fetch_for_device() for one device. The kernel
+ * never reuses a syspath and devnum combination for another device, so
+ * the result stays valid for as long as the device exists, including
+ * across suspend and resume.
+ *
+ * A retired entry belongs to a device that was removed, the next device
+ * with the same identity takes it over, see quirks_cache_retire().
+ */
+struct quirks_cache_entry {
+	struct list link; /* struct quirks_context.cache.entries */
+	char *syspath;
+	dev_t devnum;
+	char *identity; /* everything the sections can match on */
+	struct quirks *quirks; /* NULL if no quirks apply */
+	uint32_t generation;
+	uint32_t retired; /* order of retirement, 0 if not retired */
+	bool checked; /* only during quirks_context_reload() */
+};
+
+/**
+ * The quirks of one device in the device cache, see
+ * quirks_init_subsystem_cached(). Unlike the entries above these are
+ * keyed by identity only, the syspath is different after a reboot.
+ */
+struct quirks_device_cache_entry {
+	struct list link; /* struct quirks_context.device_cache.entries */
+	char *identity;
+	struct quirks *quirks; /* NULL if no quirks apply */
 };
 
+/* Retired entries kept before the oldest one is dropped */
+#define QUIRKS_CACHE_RETIRED_MAX 8
+
 /**
  * Quirk matching context, initialized once with quirks_init_subsystem()
  */
@@ -174,13 +271,58 @@ struct quirks_context {
 	enum quirks_log_type log_type;
 	struct libinput *libinput; /* for logging */
 
+	/* Set for the contexts parse_file_list() parses into on worker
+	 * threads, messages are kept until they can be logged in order */
+	struct {
+		bool enabled;
+		struct list messages; /* struct quirks_log_message */
+	} deferred_log;
+
 	char *dmi;
 	char *dt;
 
+	char *data_path;
+	char *override_file;
+	struct list files; /* struct quirks_file, in load order */
+	bool from_image; /* the sections came from the binary image */
+
+	/* false until the first device isn't in the device cache */
+	bool sections_loaded;
 	struct list sections;
 
+	/* Built once all sections are loaded, see quirks_index_sections().
+	 * Sections with a MatchVendor are hashed by vendor and product ID,
+	 * only the ones without are checked against every device */
+	struct {
+		struct section_bucket *buckets; /* open addressing */
+		size_t size; /* power of two, or 0 */
+		struct section **generic;
+		size_t ngeneric;
+	} index;
+
 	/* list of quirks handed to libinput, just for bookkeeping */
 	struct list quirks;
+
+	uint64_t host_lookup_time; /* us, init_dmi() and init_dt() */
+
+	/* Entries not used in the current generation are dropped by
+	 * quirks_cache_expire() */
+	struct {
+		struct list entries; /* struct quirks_cache_entry */
+		uint32_t generation;
+		uint32_t retired; /* last retirement */
+	} cache;
+
+	/* see quirks_init_subsystem_cached(), path is NULL if unused */
+	struct {
+		char *path;
+		uint64_t stamp; /* what the entries are valid for */
+		struct list entries; /* struct quirks_device_cache_entry */
+		/* The properties of the loaded entries, like a section's
+		 * properties these are only freed with the context */
+		struct list properties;
+		bool dirty; /* entries changed since the file was read */
+	} device_cache;
 };
 
 LIBINPUT_ATTRIBUTE_PRINTF(3, 0)
@@ -204,6 +346,18 @@ quirk_log_msg_va(struct quirks_context *ctx,
 		break;
 	}
 
+	if (ctx->deferred_log.enabled) {
+		struct quirks_log_message *m = zalloc(sizeof(*m));
+
+		m->priority = priority;
+		if (vasprintf(&m->message, format, args) == -1) {
+			free(m);
+			return;
+		}
+		list_append(&ctx->deferred_log.messages, &m->link);
+		return;
+	}
+
 	ctx->log_handler(ctx->libinput,
 			 (enum libinput_log_priority)priority,
 			 format,
@@ -256,6 +410,7 @@ quirk_get_name(enum quirk q)
 	case QUIRK_MODEL_WACOM_TOUCHPAD:		return "ModelWacomTouchpad";
 	case QUIRK_MODEL_WACOM_ISDV4_PEN:		return "ModelWacomISDV4Pen";
 	case QUIRK_MODEL_DELL_CANVAS_TOTEM:		return "ModelDellCanvasTotem";
+	case QUIRK_MODEL_VIRTUAL_DEVICE:		return "ModelVirtualDevice";
 
 	case QUIRK_ATTR_SIZE_HINT:			return "AttrSizeHint";
 	case QUIRK_ATTR_TOUCH_SIZE_RANGE:		return "AttrTouchSizeRange";
@@ -273,6 +428,9 @@ quirk_get_name(enum quirk q)
 	case QUIRK_ATTR_THUMB_SIZE_THRESHOLD:		return "AttrThumbSizeThreshold";
 	case QUIRK_ATTR_MSC_TIMESTAMP:			return "AttrMscTimestamp";
 	case QUIRK_ATTR_EVENT_CODE_DISABLE:		return "AttrEventCodeDisable";
+	case QUIRK_ATTR_TOUCHPAD_HISTORY_LENGTH:	return "AttrTouchpadHistoryLength";
+	case QUIRK_ATTR_TABLET_SMOOTHING_WINDOW:	return "AttrTabletSmoothingWindow";
+	case QUIRK_ATTR_DISPATCH_PRIORITY:		return "AttrDispatchPriority";
 	default:
 		abort();
 	}
@@ -300,7 +458,7 @@ property_new(void)
 {
 	struct property *p;
 
-	p = zalloc(sizeof *p);
+	p = mem_zalloc(sizeof *p);
 	p->refcount = 1;
 	list_init(&p->link);
 
@@ -339,7 +497,7 @@ property_cleanup(struct property *p)
 	list_remove(&p->link);
 	if (p->type == PT_STRING)
 		free(p->value.s);
-	free(p);
+	mem_free(p);
 }
 
 /**
@@ -648,6 +806,20 @@ parse_attr(struct quirks_context *ctx,
 		p->type = PT_UINT;
 		p->value.u = v;
 		rc = true;
+	} else if (streq(key, quirk_get_name(QUIRK_ATTR_TOUCHPAD_HISTORY_LENGTH))) {
+		p->id = QUIRK_ATTR_TOUCHPAD_HISTORY_LENGTH;
+		if (!safe_atou(value, &v))
+			goto out;
+		p->type = PT_UINT;
+		p->value.u = v;
+		rc = true;
+	} else if (streq(key, quirk_get_name(QUIRK_ATTR_TABLET_SMOOTHING_WINDOW))) {
+		p->id = QUIRK_ATTR_TABLET_SMOOTHING_WINDOW;
+		if (!safe_atou(value, &v))
+			goto out;
+		p->type = PT_UINT;
+		p->value.u = v;
+		rc = true;
 	} else if (streq(key, quirk_get_name(QUIRK_ATTR_LID_SWITCH_RELIABILITY))) {
 		p->id = QUIRK_ATTR_LID_SWITCH_RELIABILITY;
 		if (!streq(value, "reliable") &&
@@ -737,6 +909,14 @@ parse_attr(struct quirks_context *ctx,
 		p->type = PT_STRING;
 		p->value.s = safe_strdup(value);
 		rc = true;
+	} else if (streq(key, quirk_get_name(QUIRK_ATTR_DISPATCH_PRIORITY))) {
+		p->id = QUIRK_ATTR_DISPATCH_PRIORITY;
+		if (!streq(value, "low") &&
+		    !streq(value, "normal"))
+			goto out;
+		p->type = PT_STRING;
+		p->value.s = safe_strdup(value);
+		rc = true;
 	} else if (streq(key, quirk_get_name(QUIRK_ATTR_EVENT_CODE_DISABLE))) {
 		struct input_event events[32];
 		size_t nevents = ARRAY_LENGTH(events);
@@ -990,22 +1170,79 @@ is_data_file(const struct dirent *dir) {
 	return strneq(&dir->d_name[offset], suffix, slen);
 }
 
+/**
+ * The binary image is a header followed by the serialized sections, in
+ * the order they were parsed. All values are in host byte order, the image
+ * is not meant to be shared between machines. Strings are stored as a
+ * uint32_t length including the terminating null byte, a zero length is a
+ * NULL string.
+ *
+ * The stamp is a hash of the names, sizes and mtimes of the files the
+ * image was compiled from. If any of those change, the image is stale
+ * and we parse the text files instead.
+ */
+#define QUIRKS_IMAGE_NAME "quirks.bin"
+#define QUIRKS_IMAGE_MAGIC 0x4249514c /* LQIB */
+#define QUIRKS_IMAGE_VERSION 1
+
+struct quirks_image_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t last_model_quirk;
+	uint32_t last_attr_quirk;
+	uint64_t stamp;
+	uint64_t checksum; /* of the payload */
+	uint64_t size; /* of the payload */
+	uint32_t nsections;
+	uint32_t padding;
+};
+
+#define FNV1A_INIT 0xcbf29ce484222325ULL
+
+static inline uint64_t
+fnv1a(uint64_t hash, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= p[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+static inline uint64_t
+stamp_file(uint64_t stamp, const char *path)
+{
+	struct stat st;
+	uint64_t values[3] = {0};
+
+	/* A missing file (i.e. the override file) is hashed as empty */
+	if (stat(path, &st) == 0) {
+		values[0] = st.st_size;
+		values[1] = st.st_mtim.tv_sec;
+		values[2] = st.st_mtim.tv_nsec;
+	}
+
+	stamp = fnv1a(stamp, path, strlen(path) + 1);
+	return fnv1a(stamp, values, sizeof(values));
+}
+
 static inline bool
-parse_files(struct quirks_context *ctx, const char *data_path)
+quirks_source_stamp(const char *data_path,
+		    const char *override_file,
+		    uint64_t *stamp_out)
 {
 	struct dirent **namelist;
-	int ndev = -1;
-	int idx = 0;
+	uint64_t stamp = FNV1A_INIT;
+	int ndev;
 
 	ndev = scandir(data_path, &namelist, is_data_file, versionsort);
-	if (ndev <= 0) {
-		qlog_error(ctx,
-			   "%s: failed to find data files\n",
-			   data_path);
+	if (ndev <= 0)
 		return false;
-	}
 
-	for (idx = 0; idx < ndev; idx++) {
+	for (int idx = 0; idx < ndev; idx++) {
 		char path[PATH_MAX];
 
 		snprintf(path,
@@ -1013,427 +1250,2305 @@ parse_files(struct quirks_context *ctx, const char *data_path)
 			 "%s/%s",
 			 data_path,
 			 namelist[idx]->d_name);
-
-		if (!parse_file(ctx, path))
-			break;
+		stamp = stamp_file(stamp, path);
+		free(namelist[idx]);
 	}
-
-	for (int i = 0; i < ndev; i++)
-		free(namelist[i]);
 	free(namelist);
 
-	return idx == ndev;
-}
+	if (override_file)
+		stamp = stamp_file(stamp, override_file);
 
-struct quirks_context *
-quirks_init_subsystem(const char *data_path,
-		      const char *override_file,
-		      libinput_log_handler log_handler,
-		      struct libinput *libinput,
-		      enum quirks_log_type log_type)
-{
-	struct quirks_context *ctx = zalloc(sizeof *ctx);
+	*stamp_out = stamp;
 
-	assert(data_path);
+	return true;
+}
 
-	ctx->refcount = 1;
-	ctx->log_handler = log_handler;
-	ctx->log_type = log_type;
-	ctx->libinput = libinput;
-	list_init(&ctx->quirks);
-	list_init(&ctx->sections);
+static void
+quirks_files_free(struct list *files)
+{
+	struct quirks_file *f, *tmp;
 
-	qlog_debug(ctx, "%s is data root\n", data_path);
+	list_for_each_safe(f, tmp, files, link) {
+		list_remove(&f->link);
+		free(f->path);
+		free(f);
+	}
+}
 
-	ctx->dmi = init_dmi();
-	ctx->dt = init_dt();
-	if (!ctx->dmi && !ctx->dt)
-		goto error;
+static inline void
+quirks_files_append(struct list *files, const char *path, size_t index)
+{
+	struct quirks_file *f = zalloc(sizeof(*f));
 
-	if (!parse_files(ctx, data_path))
-		goto error;
+	f->path = safe_strdup(path);
+	f->stamp = stamp_file(FNV1A_INIT, path);
+	f->index = index;
+	list_append(files, &f->link);
+}
 
-	if (override_file && !parse_file(ctx, override_file))
-		goto error;
+static inline struct quirks_file *
+quirks_files_find(struct list *files, const char *path)
+{
+	struct quirks_file *f;
 
-	return ctx;
+	list_for_each(f, files, link) {
+		if (streq(f->path, path))
+			return f;
+	}
 
-error:
-	quirks_context_unref(ctx);
 	return NULL;
 }
 
-struct quirks_context *
-quirks_context_ref(struct quirks_context *ctx)
+/**
+ * Fill files with the data files in data_path followed by the override
+ * file, in the order they are parsed.
+ */
+static bool
+quirks_scan_files(const char *data_path,
+		  const char *override_file,
+		  struct list *files)
 {
-	assert(ctx->refcount > 0);
-	ctx->refcount++;
+	struct dirent **namelist;
+	int ndev;
 
-	return ctx;
-}
+	ndev = scandir(data_path, &namelist, is_data_file, versionsort);
+	if (ndev <= 0)
+		return false;
 
-struct quirks_context *
-quirks_context_unref(struct quirks_context *ctx)
-{
-	struct section *s, *tmp;
+	for (int idx = 0; idx < ndev; idx++) {
+		char path[PATH_MAX];
 
-	if (!ctx)
-		return NULL;
+		snprintf(path,
+			 sizeof(path),
+			 "%s/%s",
+			 data_path,
+			 namelist[idx]->d_name);
+		quirks_files_append(files, path, idx);
+		free(namelist[idx]);
+	}
+	free(namelist);
 
-	assert(ctx->refcount >= 1);
-	ctx->refcount--;
+	if (override_file)
+		quirks_files_append(files, override_file, ndev);
 
-	if (ctx->refcount > 0)
-		return NULL;
+	return true;
+}
 
-	/* Caller needs to clean up before calling this */
-	assert(list_empty(&ctx->quirks));
+static struct quirks_context *
+quirks_context_new(libinput_log_handler log_handler,
+		   struct libinput *libinput,
+		   enum quirks_log_type log_type);
 
-	list_for_each_safe(s, tmp, &ctx->sections, link) {
-		section_destroy(s);
-	}
+#define QUIRKS_PARSE_MIN_FILES 8
+#define QUIRKS_PARSE_MAX_THREADS 8
 
-	free(ctx->dmi);
-	free(ctx->dt);
-	free(ctx);
+struct quirks_parse_job {
+	struct quirks_file *file;
+	struct quirks_context *parsed; /* for just this file */
+	bool rc;
+};
 
-	return NULL;
+struct quirks_parse_work {
+	struct quirks_parse_job *jobs;
+	size_t njobs;
+	size_t next;
+};
+
+/* Log the messages deferred in from through to, or just discard them if
+ * to is NULL */
+static void
+quirks_deferred_log_replay(struct quirks_context *from,
+			   struct quirks_context *to)
+{
+	struct quirks_log_message *m, *tmp;
+
+	list_for_each_safe(m, tmp, &from->deferred_log.messages, link) {
+		if (to)
+			quirk_log_msg(to, m->priority, "%s", m->message);
+		list_remove(&m->link);
+		free(m->message);
+		free(m);
+	}
 }
 
-static struct quirks *
-quirks_new(void)
+static void *
+quirks_parse_thread(void *data)
 {
-	struct quirks *q;
+	struct quirks_parse_work *work = data;
+	size_t idx;
 
-	q = zalloc(sizeof *q);
-	q->refcount = 1;
-	q->nproperties = 0;
-	list_init(&q->link);
+	while ((idx = __atomic_fetch_add(&work->next, 1, __ATOMIC_RELAXED)) <
+	       work->njobs) {
+		struct quirks_parse_job *job = &work->jobs[idx];
 
-	return q;
+		job->rc = parse_file(job->parsed, job->file->path);
+	}
+
+	return NULL;
 }
 
-struct quirks *
-quirks_unref(struct quirks *q)
+/**
+ * Parse each file into a context of its own on worker threads, then move
+ * the sections over in the file order. The result is the same as with
+ * parsing one file after the other, including the log messages: those
+ * are deferred and logged from the caller's thread, up to the first file
+ * that failed.
+ */
+static bool
+parse_file_list_threaded(struct quirks_context *ctx,
+			 struct list *files,
+			 bool changed_only,
+			 size_t njobs,
+			 size_t ncpus)
 {
-	if (!q)
-		return NULL;
+	struct quirks_parse_work work = {0};
+	pthread_t threads[QUIRKS_PARSE_MAX_THREADS];
+	size_t nthreads = 0;
+	struct quirks_file *f;
+	struct section *s, *tmp;
+	bool rc = true;
 
-	/* We don't really refcount, but might
-	 * as well have the API in place */
-	assert(q->refcount == 1);
+	work.jobs = zalloc(njobs * sizeof(*work.jobs));
+	list_for_each(f, files, link) {
+		struct quirks_parse_job *job;
 
-	for (size_t i = 0; i < q->nproperties; i++) {
-		property_unref(q->properties[i]);
+		if (changed_only && !f->changed)
+			continue;
+
+		job = &work.jobs[work.njobs++];
+		job->file = f;
+		job->parsed = quirks_context_new(ctx->log_handler,
+						 ctx->libinput,
+						 ctx->log_type);
+		job->parsed->deferred_log.enabled = true;
 	}
 
-	list_remove(&q->link);
-	free(q->properties);
-	free(q);
+	/* The caller's thread does its share too */
+	while (nthreads < min(min(njobs / 4, ncpus) - 1,
+			      ARRAY_LENGTH(threads))) {
+		if (pthread_create(&threads[nthreads],
+				   NULL,
+				   quirks_parse_thread,
+				   &work) != 0)
+			break;
+		nthreads++;
+	}
 
-	return NULL;
+	quirks_parse_thread(&work);
+
+	for (size_t i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+
+	for (size_t i = 0; i < work.njobs; i++) {
+		struct quirks_parse_job *job = &work.jobs[i];
+
+		/* Like parse_file() we leave the sections of a broken file
+		 * in place, the caller cleans up */
+		if (rc) {
+			quirks_deferred_log_replay(job->parsed, ctx);
+			list_for_each_safe(s, tmp, &job->parsed->sections, link) {
+				list_remove(&s->link);
+				s->file = job->file;
+				list_append(&ctx->sections, &s->link);
+			}
+			rc = job->rc;
+		}
+
+		quirks_deferred_log_replay(job->parsed, NULL);
+		quirks_context_unref(job->parsed);
+	}
+	free(work.jobs);
+
+	return rc;
 }
 
 /**
- * Searches for the udev property on this device and its parent devices.
- *
- * @return the value of the property or NULL
+ * Parse the files in the list, or only those marked as changed, and tag
+ * the new sections with their file. Larger sets of files are parsed on
+ * worker threads, see parse_file_list_threaded(). The parser allocates
+ * its properties with mem_zalloc(), so a custom allocator from
+ * libinput_set_allocator() forces the serial path, that allocator must
+ * not be called from our own threads.
  */
-static const char *
-udev_prop(struct udev_device *device, const char *prop)
+static bool
+parse_file_list(struct quirks_context *ctx,
+		struct list *files,
+		bool changed_only)
 {
-	struct udev_device *d = device;
-	const char *value = NULL;
+	struct quirks_file *f;
+	struct section *s;
+	size_t njobs = 0;
+	long ncpus;
 
-	do {
-		value = udev_device_get_property_value(d, prop);
-		d = udev_device_get_parent(d);
-	} while (value == NULL && d != NULL);
+	list_for_each(f, files, link) {
+		if (!changed_only || f->changed)
+			njobs++;
+	}
 
-	return value;
+	ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (njobs >= QUIRKS_PARSE_MIN_FILES && ncpus > 1 &&
+	    !mem_has_custom_allocator())
+		return parse_file_list_threaded(ctx,
+						files,
+						changed_only,
+						njobs,
+						ncpus);
+
+	list_for_each(f, files, link) {
+		if (changed_only && !f->changed)
+			continue;
+
+		if (!parse_file(ctx, f->path))
+			return false;
+
+		list_for_each(s, &ctx->sections, link) {
+			if (!s->file)
+				s->file = f;
+		}
+	}
+
+	return true;
 }
 
+struct image_buffer {
+	uint8_t *data;
+	size_t len;
+	size_t size;
+};
+
 static inline void
-match_fill_name(struct match *m,
-		struct udev_device *device)
+image_put(struct image_buffer *b, const void *data, size_t len)
 {
-	const char *str = udev_prop(device, "NAME");
-	size_t slen;
-
-	if (!str)
-		return;
-
-	/* udev NAME is in quotes, strip them */
-	if (str[0] == '"')
-		str++;
+	if (b->len + len > b->size) {
+		b->size = max(b->size * 2, b->len + len);
+		b->data = realloc(b->data, b->size);
+		if (!b->data)
+			abort();
+	}
 
-	m->name = safe_strdup(str);
-	slen = strlen(m->name);
-	if (slen > 1 &&
-	    m->name[slen - 1] == '"')
-		m->name[slen - 1] = '\0';
+	memcpy(&b->data[b->len], data, len);
+	b->len += len;
+}
 
-	m->bits |= M_NAME;
+static inline void
+image_put_u32(struct image_buffer *b, uint32_t value)
+{
+	image_put(b, &value, sizeof(value));
 }
 
 static inline void
-match_fill_bus_vid_pid(struct match *m,
-		       struct udev_device *device)
+image_put_string(struct image_buffer *b, const char *str)
 {
-	const char *str;
-	unsigned int product, vendor, bus, version;
+	uint32_t len = str ? strlen(str) + 1 : 0;
 
-	str = udev_prop(device, "PRODUCT");
-	if (!str)
-		return;
+	image_put_u32(b, len);
+	image_put(b, str, len);
+}
 
-	/* ID_VENDOR_ID/ID_PRODUCT_ID/ID_BUS aren't filled in for virtual
-	 * devices so we have to resort to PRODUCT  */
-	if (sscanf(str, "%x/%x/%x/%x", &bus, &vendor, &product, &version) != 4)
-		return;
+static void
+image_put_property(struct image_buffer *b, struct property *p)
+{
+	image_put_u32(b, p->id);
+	image_put_u32(b, p->type);
 
-	m->product = product;
-	m->vendor = vendor;
-	m->version = version;
-	m->bits |= M_PID|M_VID|M_VERSION;
-	switch (bus) {
-	case BUS_USB:
-		m->bus = BT_USB;
-		m->bits |= M_BUS;
+	switch (p->type) {
+	case PT_UINT:
+		image_put_u32(b, p->value.u);
 		break;
-	case BUS_BLUETOOTH:
-		m->bus = BT_BLUETOOTH;
-		m->bits |= M_BUS;
+	case PT_INT:
+		image_put_u32(b, (uint32_t)p->value.i);
 		break;
-	case BUS_I8042:
-		m->bus = BT_PS2;
-		m->bits |= M_BUS;
+	case PT_STRING:
+		image_put_string(b, p->value.s);
 		break;
-	case BUS_RMI:
-		m->bus = BT_RMI;
-		m->bits |= M_BUS;
+	case PT_BOOL:
+		image_put_u32(b, p->value.b);
 		break;
-	case BUS_I2C:
-		m->bus = BT_I2C;
-		m->bits |= M_BUS;
+	case PT_DIMENSION: {
+		uint64_t dim[2] = { p->value.dim.x, p->value.dim.y };
+		image_put(b, dim, sizeof(dim));
 		break;
-	default:
+	}
+	case PT_RANGE:
+		image_put_u32(b, (uint32_t)p->value.range.lower);
+		image_put_u32(b, (uint32_t)p->value.range.upper);
+		break;
+	case PT_DOUBLE:
+		image_put(b, &p->value.d, sizeof(p->value.d));
+		break;
+	case PT_TUPLES:
+		image_put_u32(b, p->value.tuples.ntuples);
+		for (size_t i = 0; i < p->value.tuples.ntuples; i++) {
+			image_put_u32(b, (uint32_t)p->value.tuples.tuples[i].first);
+			image_put_u32(b, (uint32_t)p->value.tuples.tuples[i].second);
+		}
 		break;
 	}
 }
 
-static inline void
-match_fill_udev_type(struct match *m,
-		     struct udev_device *device)
+static void
+image_put_section(struct image_buffer *b, struct section *s)
 {
-	struct ut_map {
-		const char *prop;
-		enum udev_type flag;
-	} mappings[] = {
-		{ "ID_INPUT_MOUSE", UDEV_MOUSE },
-		{ "ID_INPUT_POINTINGSTICK", UDEV_POINTINGSTICK },
-		{ "ID_INPUT_TOUCHPAD", UDEV_TOUCHPAD },
-		{ "ID_INPUT_TABLET", UDEV_TABLET },
-		{ "ID_INPUT_TABLET_PAD", UDEV_TABLET_PAD },
-		{ "ID_INPUT_JOYSTICK", UDEV_JOYSTICK },
-		{ "ID_INPUT_KEYBOARD", UDEV_KEYBOARD },
-		{ "ID_INPUT_KEY", UDEV_KEYBOARD },
-	};
-	struct ut_map *map;
-
-	ARRAY_FOR_EACH(mappings, map) {
-		if (udev_prop(device, map->prop))
-			m->udev_type |= map->flag;
-	}
-	m->bits |= M_UDEV_TYPE;
+	struct property *p;
+	uint32_t nproperties = 0;
+
+	image_put_string(b, s->name);
+	image_put_u32(b, s->match.bits);
+	image_put_string(b, s->match.name);
+	image_put_u32(b, s->match.bus);
+	image_put_u32(b, s->match.vendor);
+	image_put_u32(b, s->match.product);
+	image_put_u32(b, s->match.version);
+	image_put_string(b, s->match.dmi);
+	image_put_u32(b, s->match.udev_type);
+	image_put_string(b, s->match.dt);
+
+	list_for_each(p, &s->properties, link)
+		nproperties++;
+	image_put_u32(b, nproperties);
+	list_for_each(p, &s->properties, link)
+		image_put_property(b, p);
 }
 
+struct image_reader {
+	const uint8_t *data;
+	size_t len;
+	size_t offset;
+	bool error;
+};
+
 static inline void
-match_fill_dmi_dt(struct match *m, char *dmi, char *dt)
+image_get(struct image_reader *r, void *data, size_t len)
 {
-	if (dmi) {
-		m->dmi = dmi;
-		m->bits |= M_DMI;
+	if (r->error || len > r->len - r->offset) {
+		r->error = true;
+		memset(data, 0, len);
+		return;
 	}
 
-	if (dt) {
-		m->dt = dt;
-		m->bits |= M_DT;
-	}
+	memcpy(data, &r->data[r->offset], len);
+	r->offset += len;
 }
 
-static struct match *
-match_new(struct udev_device *device,
-	  char *dmi, char *dt)
+static inline uint32_t
+image_get_u32(struct image_reader *r)
 {
-	struct match *m = zalloc(sizeof *m);
+	uint32_t value;
 
-	match_fill_name(m, device);
-	match_fill_bus_vid_pid(m, device);
-	match_fill_dmi_dt(m, dmi, dt);
-	match_fill_udev_type(m, device);
-	return m;
-}
+	image_get(r, &value, sizeof(value));
 
-static void
-match_free(struct match *m)
-{
-	/* dmi and dt are global */
-	free(m->name);
-	free(m);
+	return value;
 }
 
-static void
-quirk_apply_section(struct quirks_context *ctx,
-		    struct quirks *q,
-		    const struct section *s)
+static inline char *
+image_get_string(struct image_reader *r)
 {
-	struct property *p;
-	size_t nprops = 0;
-	void *tmp;
+	uint32_t len = image_get_u32(r);
+	char *str;
 
-	list_for_each(p, &s->properties, link) {
-		nprops++;
+	if (r->error || len == 0)
+		return NULL;
+
+	if (len > r->len - r->offset ||
+	    r->data[r->offset + len - 1] != '\0') {
+		r->error = true;
+		return NULL;
 	}
 
-	nprops += q->nproperties;
-	tmp = realloc(q->properties, nprops * sizeof(p));
-	if (!tmp)
-		return;
+	str = safe_strdup((const char *)&r->data[r->offset]);
+	r->offset += len;
 
-	q->properties = tmp;
-	list_for_each(p, &s->properties, link) {
-		qlog_debug(ctx, "property added: %s from %s\n",
-			   quirk_get_name(p->id), s->name);
+	return str;
+}
 
-		q->properties[q->nproperties++] = property_ref(p);
-	}
+static inline bool
+image_quirk_is_valid(uint32_t id, uint32_t type)
+{
+	if (id >= QUIRK_MODEL_ALPS_SERIAL_TOUCHPAD &&
+	    id < _QUIRK_LAST_MODEL_QUIRK_)
+		return type == PT_BOOL;
+
+	return id >= QUIRK_ATTR_SIZE_HINT &&
+	       id < _QUIRK_LAST_ATTR_QUIRK_ &&
+	       type <= PT_TUPLES;
 }
 
-static bool
-quirk_match_section(struct quirks_context *ctx,
-		    struct quirks *q,
-		    struct section *s,
-		    struct match *m,
-		    struct udev_device *device)
+static struct property *
+image_get_property(struct image_reader *r)
 {
-	uint32_t matched_flags = 0x0;
+	struct property *p;
+	uint32_t id, type;
 
-	for (uint32_t flag = 0x1; flag <= M_LAST; flag <<= 1) {
-		uint32_t prev_matched_flags = matched_flags;
-		/* section doesn't have this bit set, continue */
-		if ((s->match.bits & flag) == 0)
-			continue;
+	id = image_get_u32(r);
+	type = image_get_u32(r);
+	if (r->error || !image_quirk_is_valid(id, type)) {
+		r->error = true;
+		return NULL;
+	}
 
-		/* Couldn't fill in this bit for the match, so we
-		 * do not match on it */
-		if ((m->bits & flag) == 0) {
-			qlog_debug(ctx,
-				   "%s wants %s but we don't have that\n",
-				   s->name, matchflagname(flag));
-			continue;
-		}
+	p = property_new();
+	p->id = id;
+	p->type = type;
 
-		/* now check the actual matching bit */
-		switch (flag) {
-		case M_NAME:
-			if (fnmatch(s->match.name, m->name, 0) == 0)
-				matched_flags |= flag;
-			break;
-		case M_BUS:
-			if (m->bus == s->match.bus)
-				matched_flags |= flag;
-			break;
-		case M_VID:
-			if (m->vendor == s->match.vendor)
-				matched_flags |= flag;
-			break;
-		case M_PID:
-			if (m->product == s->match.product)
-				matched_flags |= flag;
-			break;
-		case M_VERSION:
-			if (m->version == s->match.version)
-				matched_flags |= flag;
-			break;
-		case M_DMI:
-			if (fnmatch(s->match.dmi, m->dmi, 0) == 0)
-				matched_flags |= flag;
-			break;
-		case M_DT:
-			if (fnmatch(s->match.dt, m->dt, 0) == 0)
-				matched_flags |= flag;
-			break;
-		case M_UDEV_TYPE:
-			if (s->match.udev_type & m->udev_type)
-				matched_flags |= flag;
+	switch (p->type) {
+	case PT_UINT:
+		p->value.u = image_get_u32(r);
+		break;
+	case PT_INT:
+		p->value.i = (int32_t)image_get_u32(r);
+		break;
+	case PT_STRING:
+		p->value.s = image_get_string(r);
+		if (!p->value.s)
+			r->error = true;
+		break;
+	case PT_BOOL:
+		p->value.b = !!image_get_u32(r);
+		break;
+	case PT_DIMENSION: {
+		uint64_t dim[2];
+		image_get(r, dim, sizeof(dim));
+		p->value.dim.x = dim[0];
+		p->value.dim.y = dim[1];
+		break;
+	}
+	case PT_RANGE:
+		p->value.range.lower = (int32_t)image_get_u32(r);
+		p->value.range.upper = (int32_t)image_get_u32(r);
+		break;
+	case PT_DOUBLE:
+		image_get(r, &p->value.d, sizeof(p->value.d));
+		break;
+	case PT_TUPLES:
+		p->value.tuples.ntuples = image_get_u32(r);
+		if (p->value.tuples.ntuples > ARRAY_LENGTH(p->value.tuples.tuples)) {
+			p->value.tuples.ntuples = 0;
+			r->error = true;
 			break;
-		default:
-			abort();
 		}
-
-		if (prev_matched_flags != matched_flags) {
-			qlog_debug(ctx,
-				   "%s matches for %s\n",
-				   s->name,
-				   matchflagname(flag));
+		for (size_t i = 0; i < p->value.tuples.ntuples; i++) {
+			p->value.tuples.tuples[i].first = (int32_t)image_get_u32(r);
+			p->value.tuples.tuples[i].second = (int32_t)image_get_u32(r);
 		}
+		break;
 	}
 
-	if (s->match.bits == matched_flags) {
-		qlog_debug(ctx, "%s is full match\n", s->name);
-		quirk_apply_section(ctx, q, s);
+	return p;
+}
+
+static struct section *
+image_get_section(struct image_reader *r)
+{
+	struct section *s = zalloc(sizeof(*s));
+	uint32_t nproperties;
+
+	list_init(&s->link);
+	list_init(&s->properties);
+
+	s->name = image_get_string(r);
+	s->match.bits = image_get_u32(r);
+	s->match.name = image_get_string(r);
+	s->match.bus = image_get_u32(r);
+	s->match.vendor = image_get_u32(r);
+	s->match.product = image_get_u32(r);
+	s->match.version = image_get_u32(r);
+	s->match.dmi = image_get_string(r);
+	s->match.udev_type = image_get_u32(r);
+	s->match.dt = image_get_string(r);
+
+	nproperties = image_get_u32(r);
+	for (uint32_t i = 0; !r->error && i < nproperties; i++) {
+		struct property *p = image_get_property(r);
+		if (p)
+			list_append(&s->properties, &p->link);
 	}
 
-	return true;
+	s->has_match = s->match.bits != 0;
+	s->has_property = !list_empty(&s->properties);
+
+	/* The string matches go straight to fnmatch() */
+	if (((s->match.bits & M_NAME) && !s->match.name) ||
+	    ((s->match.bits & M_DMI) && !s->match.dmi) ||
+	    ((s->match.bits & M_DT) && !s->match.dt))
+		r->error = true;
+
+	if (r->error || !s->name || !s->has_match || !s->has_property) {
+		r->error = true;
+		section_destroy(s);
+		return NULL;
+	}
+
+	return s;
 }
 
-struct quirks *
-quirks_fetch_for_device(struct quirks_context *ctx,
-			struct udev_device *udev_device)
+/**
+ * Load the sections from the binary image at path. Where the image
+ * doesn't exist, is stale or otherwise unusable, this function returns
+ * false and leaves the context untouched.
+ */
+static bool
+load_image(struct quirks_context *ctx, const char *path, uint64_t stamp)
 {
-	struct quirks *q = NULL;
-	struct section *s;
-	struct match *m;
+	struct quirks_image_header header;
+	struct image_reader reader = {0};
+	struct section *s, *tmp;
+	struct list sections;
+	struct stat st;
+	void *map;
+	int fd;
+	bool rc = false;
 
-	if (!ctx)
-		return NULL;
+	fd = open(path, O_RDONLY|O_CLOEXEC);
+	if (fd < 0) {
+		if (errno != ENOENT)
+			qlog_debug(ctx, "%s: failed to open image\n", path);
+		return false;
+	}
 
-	qlog_debug(ctx, "%s: fetching quirks\n",
-		   udev_device_get_devnode(udev_device));
+	if (fstat(fd, &st) < 0 ||
+	    (size_t)st.st_size < sizeof(header)) {
+		close(fd);
+		return false;
+	}
 
-	q = quirks_new();
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
 
-	m = match_new(udev_device, ctx->dmi, ctx->dt);
+	memcpy(&header, map, sizeof(header));
+	if (header.magic != QUIRKS_IMAGE_MAGIC ||
+	    header.version != QUIRKS_IMAGE_VERSION ||
+	    header.last_model_quirk != _QUIRK_LAST_MODEL_QUIRK_ ||
+	    header.last_attr_quirk != _QUIRK_LAST_ATTR_QUIRK_ ||
+	    header.size != st.st_size - sizeof(header)) {
+		qlog_debug(ctx, "%s: incompatible image, ignoring\n", path);
+		goto out;
+	}
 
-	list_for_each(s, &ctx->sections, link) {
-		quirk_match_section(ctx, q, s, m, udev_device);
+	if (header.stamp != stamp) {
+		qlog_debug(ctx, "%s: image is stale, ignoring\n", path);
+		goto out;
 	}
 
-	match_free(m);
+	reader.data = (const uint8_t *)map + sizeof(header);
+	reader.len = header.size;
 
-	if (q->nproperties == 0) {
-		quirks_unref(q);
-		return NULL;
+	if (fnv1a(FNV1A_INIT, reader.data, reader.len) != header.checksum) {
+		qlog_error(ctx, "%s: checksum mismatch, ignoring\n", path);
+		goto out;
 	}
 
-	list_insert(&ctx->quirks, &q->link);
+	list_init(&sections);
+	for (uint32_t i = 0; i < header.nsections; i++) {
+		s = image_get_section(&reader);
+		if (!s)
+			break;
+		list_append(&sections, &s->link);
+	}
 
-	return q;
-}
+	if (reader.error || reader.offset != reader.len) {
+		qlog_error(ctx, "%s: invalid image, ignoring\n", path);
+		list_for_each_safe(s, tmp, &sections, link)
+			section_destroy(s);
+		goto out;
+	}
+
+	list_for_each_safe(s, tmp, &sections, link) {
+		list_remove(&s->link);
+		list_append(&ctx->sections, &s->link);
+	}
 
+	qlog_debug(ctx, "%s: loaded %u sections\n", path, header.nsections);
+	rc = true;
 
-static inline struct property *
-quirk_find_prop(struct quirks *q, enum quirk which)
+out:
+	munmap(map, st.st_size);
+	return rc;
+}
+
+/* Write to a temporary file and rename it so that concurrent readers
+ * never see a partial file. Returns 0 or a negative errno */
+static int
+image_buffer_write(struct quirks_context *ctx,
+		   const struct image_buffer *b,
+		   const char *path)
 {
-	/* Run backwards to only handle the last one assigned */
-	for (ssize_t i = q->nproperties - 1; i >= 0; i--) {
-		struct property *p = q->properties[i];
-		if (p->id == which)
-			return p;
+	char *tmppath;
+	FILE *fp;
+	int fd;
+	int rc;
+
+	xasprintf(&tmppath, "%s.XXXXXX", path);
+	fd = mkstemp(tmppath);
+	if (fd < 0) {
+		rc = -errno;
+		qlog_error(ctx, "%s: failed to create file (%s)\n",
+			   tmppath, strerror(-rc));
+		free(tmppath);
+		return rc;
 	}
 
-	return NULL;
+	fp = fdopen(fd, "w");
+	if (!fp) {
+		rc = -errno;
+		close(fd);
+		goto out;
+	}
+
+	if (fchmod(fd, 0644) < 0 ||
+	    fwrite(b->data, 1, b->len, fp) != b->len) {
+		rc = errno ? -errno : -EIO;
+		fclose(fp);
+		qlog_error(ctx, "%s: failed to write file\n", tmppath);
+		goto out;
+	}
+
+	if (fclose(fp) != 0) {
+		rc = -errno;
+		qlog_error(ctx, "%s: failed to write file\n", tmppath);
+		goto out;
+	}
+
+	if (rename(tmppath, path) < 0) {
+		rc = -errno;
+		qlog_error(ctx, "%s: failed to write file (%s)\n",
+			   path, strerror(-rc));
+		goto out;
+	}
+
+	rc = 0;
+
+out:
+	if (rc != 0)
+		unlink(tmppath);
+	free(tmppath);
+
+	return rc;
+}
+
+static bool
+write_image(struct quirks_context *ctx, const char *path, uint64_t stamp)
+{
+	struct quirks_image_header header = {
+		.magic = QUIRKS_IMAGE_MAGIC,
+		.version = QUIRKS_IMAGE_VERSION,
+		.last_model_quirk = _QUIRK_LAST_MODEL_QUIRK_,
+		.last_attr_quirk = _QUIRK_LAST_ATTR_QUIRK_,
+		.stamp = stamp,
+	};
+	struct image_buffer b = {0};
+	struct section *s;
+	bool rc = false;
+
+	/* Reserve the header, we fill it in once we have the payload */
+	image_put(&b, &header, sizeof(header));
+
+	list_for_each(s, &ctx->sections, link) {
+		image_put_section(&b, s);
+		header.nsections++;
+	}
+
+	header.size = b.len - sizeof(header);
+	header.checksum = fnv1a(FNV1A_INIT,
+				&b.data[sizeof(header)],
+				header.size);
+	memcpy(b.data, &header, sizeof(header));
+
+	if (image_buffer_write(ctx, &b, path) == 0) {
+		qlog_debug(ctx, "%s: wrote %u sections\n", path, header.nsections);
+		rc = true;
+	}
+
+	free(b.data);
+
+	return rc;
+}
+
+static inline size_t
+section_bucket_hash(uint32_t vendor, uint32_t product, bool any_product)
+{
+	uint64_t key = ((uint64_t)vendor << 32) | product;
+
+	key ^= any_product;
+	key *= 0x9e3779b97f4a7c15ULL;
+
+	return (size_t)(key >> 32);
+}
+
+static struct section_bucket *
+section_bucket_find(struct quirks_context *ctx,
+		    uint32_t vendor,
+		    uint32_t product,
+		    bool any_product,
+		    bool create)
+{
+	size_t mask, idx;
+	struct section_bucket *b;
+
+	if (ctx->index.size == 0)
+		return NULL;
+
+	mask = ctx->index.size - 1;
+	idx = section_bucket_hash(vendor, product, any_product) & mask;
+
+	while ((b = &ctx->index.buckets[idx])->sections) {
+		if (b->vendor == vendor &&
+		    b->product == product &&
+		    b->any_product == any_product)
+			return b;
+		idx = (idx + 1) & mask;
+	}
+
+	if (!create)
+		return NULL;
+
+	b->vendor = vendor;
+	b->product = product;
+	b->any_product = any_product;
+
+	return b;
+}
+
+static inline void
+section_array_append(struct section ***sections,
+		     size_t *nsections,
+		     struct section *s)
+{
+	*sections = realloc(*sections, (*nsections + 1) * sizeof(**sections));
+	if (!*sections)
+		abort();
+
+	(*sections)[(*nsections)++] = s;
+}
+
+static inline bool
+section_matches_host(struct quirks_context *ctx, struct section *s)
+{
+	if ((s->match.bits & M_DMI) &&
+	    (!ctx->dmi || fnmatch(s->match.dmi, ctx->dmi, 0) != 0))
+		return false;
+
+	if ((s->match.bits & M_DT) &&
+	    (!ctx->dt || fnmatch(s->match.dt, ctx->dt, 0) != 0))
+		return false;
+
+	return true;
+}
+
+/**
+ * A section with a MatchVendor can only ever match a device with that
+ * vendor ID (and product ID, if it has a MatchProduct), so we only need to
+ * look at those sections for a device. Everything else, i.e. sections
+ * that match on names, DMI or udev types only, is checked for every
+ * device.
+ *
+ * The DMI and DT globs only depend on the host, so they are evaluated
+ * here once and sections for other hosts are dropped.
+ */
+static void
+quirks_index_sections(struct quirks_context *ctx)
+{
+	struct section *s, *tmp;
+	size_t order = 0,
+	       nvendor = 0;
+
+	list_for_each_safe(s, tmp, &ctx->sections, link) {
+		if (!section_matches_host(ctx, s)) {
+			qlog_debug(ctx, "%s does not match this host\n",
+				   s->name);
+			section_destroy(s);
+			continue;
+		}
+
+		if (s->match.bits & M_VID)
+			nvendor++;
+	}
+
+	if (nvendor > 0) {
+		/* One bucket per section worst case, at half load */
+		ctx->index.size = 16;
+		while (ctx->index.size < nvendor * 2)
+			ctx->index.size *= 2;
+		ctx->index.buckets = zalloc(ctx->index.size *
+					    sizeof(*ctx->index.buckets));
+	}
+
+	list_for_each(s, &ctx->sections, link) {
+		s->order = order++;
+
+		if (s->match.bits & M_VID) {
+			bool any_product = !(s->match.bits & M_PID);
+			struct section_bucket *b;
+
+			b = section_bucket_find(ctx,
+						s->match.vendor,
+						any_product ? 0 : s->match.product,
+						any_product,
+						true);
+			section_array_append(&b->sections, &b->nsections, s);
+		} else {
+			section_array_append(&ctx->index.generic,
+					     &ctx->index.ngeneric,
+					     s);
+		}
+	}
+
+	qlog_debug(ctx, "%zd sections indexed, %zd generic\n",
+		   order, ctx->index.ngeneric);
+}
+
+static void
+quirks_index_reset(struct quirks_context *ctx)
+{
+	for (size_t i = 0; i < ctx->index.size; i++)
+		free(ctx->index.buckets[i].sections);
+	free(ctx->index.buckets);
+	free(ctx->index.generic);
+
+	ctx->index.buckets = NULL;
+	ctx->index.size = 0;
+	ctx->index.generic = NULL;
+	ctx->index.ngeneric = 0;
+}
+
+static struct quirks_context *
+quirks_context_new(libinput_log_handler log_handler,
+		   struct libinput *libinput,
+		   enum quirks_log_type log_type)
+{
+	struct quirks_context *ctx = zalloc(sizeof *ctx);
+
+	ctx->refcount = 1;
+	ctx->log_handler = log_handler;
+	ctx->log_type = log_type;
+	ctx->libinput = libinput;
+	list_init(&ctx->quirks);
+	list_init(&ctx->files);
+	list_init(&ctx->sections);
+	list_init(&ctx->cache.entries);
+	list_init(&ctx->device_cache.entries);
+	list_init(&ctx->device_cache.properties);
+	list_init(&ctx->deferred_log.messages);
+
+	return ctx;
+}
+
+static inline bool
+parse_all_files(struct quirks_context *ctx,
+		const char *data_path,
+		const char *override_file)
+{
+	if (!quirks_scan_files(data_path, override_file, &ctx->files)) {
+		qlog_error(ctx,
+			   "%s: failed to find data files\n",
+			   data_path);
+		return false;
+	}
+
+	return parse_file_list(ctx, &ctx->files, false);
+}
+
+/* Load the sections from the image or the data files. With a valid
+ * device cache this only happens once a device isn't in the cache, see
+ * quirks_match_device() */
+static bool
+quirks_context_load_sections(struct quirks_context *ctx)
+{
+	struct section *s, *tmp;
+	char *image;
+	uint64_t stamp;
+	bool loaded = false;
+
+	ctx->sections_loaded = true;
+
+	xasprintf(&image, "%s/%s", ctx->data_path, QUIRKS_IMAGE_NAME);
+	if (quirks_source_stamp(ctx->data_path, ctx->override_file, &stamp))
+		loaded = load_image(ctx, image, stamp);
+	free(image);
+
+	ctx->from_image = loaded;
+	if (!loaded && !parse_file_list(ctx, &ctx->files, false)) {
+		list_for_each_safe(s, tmp, &ctx->sections, link)
+			section_destroy(s);
+		return false;
+	}
+
+	quirks_index_sections(ctx);
+
+	return true;
+}
+
+static bool
+quirks_device_cache_load(struct quirks_context *ctx);
+
+static void
+quirks_device_cache_flush(struct quirks_context *ctx);
+
+/* The device cache is only valid for the same data files, host and
+ * libinput version, any of these can change what a device matches */
+static inline uint64_t
+quirks_device_cache_stamp(struct quirks_context *ctx, uint64_t source_stamp)
+{
+	const char *dmi = ctx->dmi ? ctx->dmi : "",
+		   *dt = ctx->dt ? ctx->dt : "";
+	uint64_t stamp = source_stamp;
+
+	stamp = fnv1a(stamp, LIBINPUT_VERSION, sizeof(LIBINPUT_VERSION));
+	stamp = fnv1a(stamp, dmi, strlen(dmi) + 1);
+	stamp = fnv1a(stamp, dt, strlen(dt) + 1);
+
+	return stamp;
+}
+
+struct quirks_context *
+quirks_init_subsystem_cached(const char *data_path,
+			     const char *override_file,
+			     const char *cache_path,
+			     libinput_log_handler log_handler,
+			     struct libinput *libinput,
+			     enum quirks_log_type log_type)
+{
+	struct quirks_context *ctx;
+	uint64_t stamp, start;
+
+	assert(data_path);
+
+	ctx = quirks_context_new(log_handler, libinput, log_type);
+
+	qlog_debug(ctx, "%s is data root\n", data_path);
+
+	start = now_in_us();
+	ctx->dmi = init_dmi();
+	ctx->dt = init_dt();
+	ctx->host_lookup_time = now_in_us() - start;
+	if (!ctx->dmi && !ctx->dt)
+		goto error;
+
+	/* Remembered for quirks_context_reload() */
+	ctx->data_path = safe_strdup(data_path);
+	ctx->override_file = override_file ? safe_strdup(override_file) : NULL;
+	if (!quirks_scan_files(data_path, override_file, &ctx->files)) {
+		qlog_error(ctx,
+			   "%s: failed to find data files\n",
+			   data_path);
+		goto error;
+	}
+
+	if (cache_path) {
+		ctx->device_cache.path = safe_strdup(cache_path);
+		if (quirks_source_stamp(data_path, override_file, &stamp)) {
+			ctx->device_cache.stamp =
+				quirks_device_cache_stamp(ctx, stamp);
+			if (quirks_device_cache_load(ctx))
+				return ctx;
+		}
+	}
+
+	if (!quirks_context_load_sections(ctx))
+		goto error;
+
+	return ctx;
+
+error:
+	quirks_context_unref(ctx);
+	return NULL;
+}
+
+struct quirks_context *
+quirks_init_subsystem(const char *data_path,
+		      const char *override_file,
+		      libinput_log_handler log_handler,
+		      struct libinput *libinput,
+		      enum quirks_log_type log_type)
+{
+	return quirks_init_subsystem_cached(data_path,
+					    override_file,
+					    NULL,
+					    log_handler,
+					    libinput,
+					    log_type);
+}
+
+bool
+quirks_compile_image(const char *data_path,
+		     const char *override_file,
+		     libinput_log_handler log_handler,
+		     enum quirks_log_type log_type)
+{
+	struct quirks_context *ctx;
+	char *image;
+	uint64_t stamp;
+	bool rc = false;
+
+	assert(data_path);
+
+	ctx = quirks_context_new(log_handler, NULL, log_type);
+
+	/* Stamp first, so a file changing while we parse makes the
+	 * image stale rather than silently out of date */
+	if (!quirks_source_stamp(data_path, override_file, &stamp)) {
+		qlog_error(ctx,
+			   "%s: failed to find data files\n",
+			   data_path);
+		goto out;
+	}
+
+	if (!parse_all_files(ctx, data_path, override_file))
+		goto out;
+
+	xasprintf(&image, "%s/%s", data_path, QUIRKS_IMAGE_NAME);
+	rc = write_image(ctx, image, stamp);
+	free(image);
+
+out:
+	quirks_context_unref(ctx);
+	return rc;
+}
+
+struct quirks_context *
+quirks_context_ref(struct quirks_context *ctx)
+{
+	assert(ctx->refcount > 0);
+	ctx->refcount++;
+
+	return ctx;
+}
+
+static inline size_t
+strsize(const char *str)
+{
+	return str ? strlen(str) + 1 : 0;
+}
+
+size_t
+quirks_context_get_memory_usage(struct quirks_context *ctx)
+{
+	struct section *s;
+	struct property *p;
+	struct quirks *q;
+	struct quirks_cache_entry *entry;
+	struct quirks_device_cache_entry *dc;
+	struct quirks_file *f;
+	size_t size;
+
+	size = sizeof(*ctx) + strsize(ctx->dmi) + strsize(ctx->dt);
+	size += strsize(ctx->data_path) + strsize(ctx->override_file);
+	size += strsize(ctx->device_cache.path);
+
+	list_for_each(f, &ctx->files, link)
+		size += sizeof(*f) + strsize(f->path);
+
+	list_for_each(s, &ctx->sections, link) {
+		size += sizeof(*s) + strsize(s->name);
+		size += strsize(s->match.name) +
+			strsize(s->match.dmi) +
+			strsize(s->match.dt);
+
+		list_for_each(p, &s->properties, link) {
+			size += sizeof(*p);
+			if (p->type == PT_STRING)
+				size += strsize(p->value.s);
+		}
+	}
+
+	size += ctx->index.size * sizeof(*ctx->index.buckets);
+	for (size_t i = 0; i < ctx->index.size; i++)
+		size += ctx->index.buckets[i].nsections * sizeof(struct section *);
+	size += ctx->index.ngeneric * sizeof(*ctx->index.generic);
+
+	/* cached quirks are on the quirks list too */
+	list_for_each(q, &ctx->quirks, link)
+		size += sizeof(*q) + q->nproperties * sizeof(*q->properties);
+
+	list_for_each(entry, &ctx->cache.entries, link)
+		size += sizeof(*entry) + strsize(entry->syspath) +
+			strsize(entry->identity);
+
+	list_for_each(dc, &ctx->device_cache.entries, link)
+		size += sizeof(*dc) + strsize(dc->identity);
+
+	list_for_each(p, &ctx->device_cache.properties, link) {
+		size += sizeof(*p);
+		if (p->type == PT_STRING)
+			size += strsize(p->value.s);
+	}
+
+	return size;
+}
+
+uint64_t
+quirks_context_get_host_lookup_time(struct quirks_context *ctx)
+{
+	return ctx ? ctx->host_lookup_time : 0;
+}
+
+void
+quirks_context_set_log_target(struct quirks_context *ctx,
+			      struct libinput *libinput)
+{
+	ctx->libinput = libinput;
+}
+
+static void
+quirks_cache_flush(struct quirks_context *ctx);
+
+struct quirks_context *
+quirks_context_unref(struct quirks_context *ctx)
+{
+	struct section *s, *tmp;
+	struct property *p, *ptmp;
+
+	if (!ctx)
+		return NULL;
+
+	assert(ctx->refcount >= 1);
+	ctx->refcount--;
+
+	if (ctx->refcount > 0)
+		return NULL;
+
+	quirks_cache_flush(ctx);
+	quirks_device_cache_flush(ctx);
+
+	/* Caller needs to clean up before calling this */
+	assert(list_empty(&ctx->quirks));
+
+	list_for_each_safe(s, tmp, &ctx->sections, link) {
+		section_destroy(s);
+	}
+
+	list_for_each_safe(p, ptmp, &ctx->device_cache.properties, link)
+		property_cleanup(p);
+
+	quirks_index_reset(ctx);
+
+	quirks_files_free(&ctx->files);
+	free(ctx->data_path);
+	free(ctx->override_file);
+	free(ctx->device_cache.path);
+	free(ctx->dmi);
+	free(ctx->dt);
+	free(ctx);
+
+	return NULL;
+}
+
+static struct quirks *
+quirks_new(void)
+{
+	struct quirks *q;
+
+	q = mem_zalloc(sizeof *q);
+	q->refcount = 1;
+	q->nproperties = 0;
+	list_init(&q->link);
+
+	return q;
+}
+
+struct quirks *
+quirks_unref(struct quirks *q)
+{
+	if (!q)
+		return NULL;
+
+	assert(q->refcount >= 1);
+	q->refcount--;
+
+	if (q->refcount > 0)
+		return NULL;
+
+	for (size_t i = 0; i < q->nproperties; i++) {
+		property_unref(q->properties[i]);
+	}
+
+	list_remove(&q->link);
+	mem_free(q->properties);
+	mem_free(q);
+
+	return NULL;
+}
+
+/**
+ * Searches for the udev property on this device and its parent devices.
+ *
+ * @return the value of the property or NULL
+ */
+static const char *
+udev_prop(struct udev_device *device, const char *prop)
+{
+	struct udev_device *d = device;
+	const char *value = NULL;
+
+	do {
+		value = udev_device_get_property_value(d, prop);
+		d = udev_device_get_parent(d);
+	} while (value == NULL && d != NULL);
+
+	return value;
+}
+
+static inline void
+match_fill_name(struct match *m,
+		struct udev_device *device)
+{
+	const char *str = udev_prop(device, "NAME");
+	size_t slen;
+
+	if (!str)
+		return;
+
+	/* udev NAME is in quotes, strip them */
+	if (str[0] == '"')
+		str++;
+
+	m->name = safe_strdup(str);
+	slen = strlen(m->name);
+	if (slen > 1 &&
+	    m->name[slen - 1] == '"')
+		m->name[slen - 1] = '\0';
+
+	m->bits |= M_NAME;
+}
+
+static inline void
+match_fill_bus_vid_pid(struct match *m,
+		       struct udev_device *device)
+{
+	const char *str;
+	unsigned int product, vendor, bus, version;
+
+	str = udev_prop(device, "PRODUCT");
+	if (!str)
+		return;
+
+	/* ID_VENDOR_ID/ID_PRODUCT_ID/ID_BUS aren't filled in for virtual
+	 * devices so we have to resort to PRODUCT  */
+	if (sscanf(str, "%x/%x/%x/%x", &bus, &vendor, &product, &version) != 4)
+		return;
+
+	m->product = product;
+	m->vendor = vendor;
+	m->version = version;
+	m->bits |= M_PID|M_VID|M_VERSION;
+	switch (bus) {
+	case BUS_USB:
+		m->bus = BT_USB;
+		m->bits |= M_BUS;
+		break;
+	case BUS_BLUETOOTH:
+		m->bus = BT_BLUETOOTH;
+		m->bits |= M_BUS;
+		break;
+	case BUS_I8042:
+		m->bus = BT_PS2;
+		m->bits |= M_BUS;
+		break;
+	case BUS_RMI:
+		m->bus = BT_RMI;
+		m->bits |= M_BUS;
+		break;
+	case BUS_I2C:
+		m->bus = BT_I2C;
+		m->bits |= M_BUS;
+		break;
+	default:
+		break;
+	}
+}
+
+static inline void
+match_fill_udev_type(struct match *m,
+		     struct udev_device *device)
+{
+	struct ut_map {
+		const char *prop;
+		enum udev_type flag;
+	} mappings[] = {
+		{ "ID_INPUT_MOUSE", UDEV_MOUSE },
+		{ "ID_INPUT_POINTINGSTICK", UDEV_POINTINGSTICK },
+		{ "ID_INPUT_TOUCHPAD", UDEV_TOUCHPAD },
+		{ "ID_INPUT_TABLET", UDEV_TABLET },
+		{ "ID_INPUT_TABLET_PAD", UDEV_TABLET_PAD },
+		{ "ID_INPUT_JOYSTICK", UDEV_JOYSTICK },
+		{ "ID_INPUT_KEYBOARD", UDEV_KEYBOARD },
+		{ "ID_INPUT_KEY", UDEV_KEYBOARD },
+	};
+	struct ut_map *map;
+
+	ARRAY_FOR_EACH(mappings, map) {
+		if (udev_prop(device, map->prop))
+			m->udev_type |= map->flag;
+	}
+	m->bits |= M_UDEV_TYPE;
+}
+
+static inline void
+match_fill_dmi_dt(struct match *m, char *dmi, char *dt)
+{
+	if (dmi) {
+		m->dmi = dmi;
+		m->bits |= M_DMI;
+	}
+
+	if (dt) {
+		m->dt = dt;
+		m->bits |= M_DT;
+	}
+}
+
+static struct match *
+match_new(struct udev_device *device,
+	  char *dmi, char *dt)
+{
+	struct match *m = zalloc(sizeof *m);
+
+	match_fill_name(m, device);
+	match_fill_bus_vid_pid(m, device);
+	match_fill_dmi_dt(m, dmi, dt);
+	match_fill_udev_type(m, device);
+	return m;
+}
+
+static void
+match_free(struct match *m)
+{
+	/* dmi and dt are global */
+	free(m->name);
+	free(m);
+}
+
+static void
+quirk_apply_section(struct quirks_context *ctx,
+		    struct quirks *q,
+		    const struct section *s)
+{
+	struct property *p;
+	size_t nprops = 0;
+	void *tmp;
+
+	list_for_each(p, &s->properties, link) {
+		nprops++;
+	}
+
+	nprops += q->nproperties;
+	tmp = mem_realloc(q->properties, nprops * sizeof(p));
+	if (!tmp)
+		return;
+
+	q->properties = tmp;
+	list_for_each(p, &s->properties, link) {
+		int idx = quirk_index(p->id);
+
+		qlog_debug(ctx, "property added: %s from %s\n",
+			   quirk_get_name(p->id), s->name);
+
+		q->properties[q->nproperties++] = property_ref(p);
+		if (idx >= 0)
+			q->by_quirk[idx] = p;
+	}
+}
+
+static bool
+section_matches(struct quirks_context *ctx,
+		struct section *s,
+		struct match *m)
+{
+	uint32_t matched_flags = 0x0;
+
+	for (uint32_t flag = 0x1; flag <= M_LAST; flag <<= 1) {
+		uint32_t prev_matched_flags = matched_flags;
+		/* section doesn't have this bit set, continue */
+		if ((s->match.bits & flag) == 0)
+			continue;
+
+		/* Couldn't fill in this bit for the match, so we
+		 * do not match on it */
+		if ((m->bits & flag) == 0) {
+			qlog_debug(ctx,
+				   "%s wants %s but we don't have that\n",
+				   s->name, matchflagname(flag));
+			continue;
+		}
+
+		/* now check the actual matching bit */
+		switch (flag) {
+		case M_NAME:
+			if (fnmatch(s->match.name, m->name, 0) == 0)
+				matched_flags |= flag;
+			break;
+		case M_BUS:
+			if (m->bus == s->match.bus)
+				matched_flags |= flag;
+			break;
+		case M_VID:
+			if (m->vendor == s->match.vendor)
+				matched_flags |= flag;
+			break;
+		case M_PID:
+			if (m->product == s->match.product)
+				matched_flags |= flag;
+			break;
+		case M_VERSION:
+			if (m->version == s->match.version)
+				matched_flags |= flag;
+			break;
+		case M_DMI:
+		case M_DT:
+			/* The host's DMI and DT are the same for every
+			 * device, quirks_index_sections() dropped all
+			 * sections that don't match them */
+			matched_flags |= flag;
+			break;
+		case M_UDEV_TYPE:
+			if (s->match.udev_type & m->udev_type)
+				matched_flags |= flag;
+			break;
+		default:
+			abort();
+		}
+
+		if (prev_matched_flags != matched_flags) {
+			qlog_debug(ctx,
+				   "%s matches for %s\n",
+				   s->name,
+				   matchflagname(flag));
+		}
+	}
+
+	return s->match.bits == matched_flags;
+}
+
+static bool
+quirk_match_section(struct quirks_context *ctx,
+		    struct quirks *q,
+		    struct section *s,
+		    struct match *m,
+		    struct udev_device *device)
+{
+	if (section_matches(ctx, s, m)) {
+		qlog_debug(ctx, "%s is full match\n", s->name);
+		quirk_apply_section(ctx, q, s);
+	}
+
+	return true;
+}
+
+static struct quirks *
+quirks_ref(struct quirks *q)
+{
+	if (q)
+		q->refcount++;
+
+	return q;
+}
+
+static void
+quirks_cache_entry_destroy(struct quirks_cache_entry *entry)
+{
+	list_remove(&entry->link);
+	quirks_unref(entry->quirks);
+	free(entry->syspath);
+	free(entry->identity);
+	free(entry);
+}
+
+static struct quirks_cache_entry *
+quirks_cache_find(struct quirks_context *ctx,
+		  struct udev_device *udev_device)
+{
+	struct quirks_cache_entry *entry;
+	const char *syspath = udev_device_get_syspath(udev_device);
+	dev_t devnum = udev_device_get_devnum(udev_device);
+
+	if (!syspath)
+		return NULL;
+
+	list_for_each(entry, &ctx->cache.entries, link) {
+		if (entry->retired)
+			continue;
+
+		if (entry->devnum == devnum && streq(entry->syspath, syspath))
+			return entry;
+	}
+
+	return NULL;
+}
+
+static void
+quirks_cache_flush(struct quirks_context *ctx)
+{
+	struct quirks_cache_entry *entry, *tmp;
+
+	list_for_each_safe(entry, tmp, &ctx->cache.entries, link)
+		quirks_cache_entry_destroy(entry);
+}
+
+void
+quirks_cache_keep(struct quirks_context *ctx,
+		  struct udev_device *udev_device)
+{
+	struct quirks_cache_entry *entry;
+
+	if (!ctx)
+		return;
+
+	entry = quirks_cache_find(ctx, udev_device);
+	if (entry)
+		entry->generation = ctx->cache.generation;
+}
+
+void
+quirks_cache_forget(struct quirks_context *ctx,
+		    struct udev_device *udev_device)
+{
+	struct quirks_cache_entry *entry;
+
+	if (!ctx)
+		return;
+
+	entry = quirks_cache_find(ctx, udev_device);
+	if (entry)
+		quirks_cache_entry_destroy(entry);
+}
+
+void
+quirks_cache_retire(struct quirks_context *ctx,
+		    struct udev_device *udev_device)
+{
+	struct quirks_cache_entry *entry, *oldest = NULL;
+	size_t nretired = 0;
+
+	if (!ctx)
+		return;
+
+	entry = quirks_cache_find(ctx, udev_device);
+	if (!entry)
+		return;
+
+	entry->retired = ++ctx->cache.retired;
+
+	list_for_each(entry, &ctx->cache.entries, link) {
+		if (!entry->retired)
+			continue;
+
+		nretired++;
+		if (!oldest || entry->retired < oldest->retired)
+			oldest = entry;
+	}
+
+	if (nretired > QUIRKS_CACHE_RETIRED_MAX)
+		quirks_cache_entry_destroy(oldest);
+}
+
+void
+quirks_cache_expire(struct quirks_context *ctx)
+{
+	struct quirks_cache_entry *entry, *tmp;
+
+	if (!ctx)
+		return;
+
+	/* Retired entries are bound by QUIRKS_CACHE_RETIRED_MAX instead */
+	list_for_each_safe(entry, tmp, &ctx->cache.entries, link) {
+		if (!entry->retired &&
+		    entry->generation != ctx->cache.generation)
+			quirks_cache_entry_destroy(entry);
+	}
+
+	ctx->cache.generation++;
+}
+
+/**
+ * The device cache file is a header followed by the devices, each with
+ * its identity and properties in the image format. Like the image, it
+ * is ignored if it was written for different data files, a different
+ * host or libinput version.
+ */
+#define QUIRKS_DEVICE_CACHE_MAGIC 0x4344514c /* LQDC */
+#define QUIRKS_DEVICE_CACHE_VERSION 1
+/* Devices written to the cache, the most recently matched win */
+#define QUIRKS_DEVICE_CACHE_MAX 128
+
+struct quirks_device_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t last_model_quirk;
+	uint32_t last_attr_quirk;
+	uint64_t stamp;
+	uint64_t checksum; /* of the payload */
+	uint64_t size; /* of the payload */
+	uint32_t nentries;
+	uint32_t padding;
+};
+
+static void
+quirks_device_cache_entry_destroy(struct quirks_device_cache_entry *entry)
+{
+	list_remove(&entry->link);
+	quirks_unref(entry->quirks);
+	free(entry->identity);
+	free(entry);
+}
+
+static void
+quirks_device_cache_flush(struct quirks_context *ctx)
+{
+	struct quirks_device_cache_entry *entry, *tmp;
+
+	list_for_each_safe(entry, tmp, &ctx->device_cache.entries, link)
+		quirks_device_cache_entry_destroy(entry);
+}
+
+static struct quirks_device_cache_entry *
+quirks_device_cache_find(struct quirks_context *ctx, const char *identity)
+{
+	struct quirks_device_cache_entry *entry;
+
+	list_for_each(entry, &ctx->device_cache.entries, link) {
+		if (streq(entry->identity, identity))
+			return entry;
+	}
+
+	return NULL;
+}
+
+static void
+quirks_device_cache_add(struct quirks_context *ctx,
+			const char *identity,
+			struct quirks *q)
+{
+	struct quirks_device_cache_entry *entry;
+
+	entry = zalloc(sizeof(*entry));
+	entry->identity = safe_strdup(identity);
+	entry->quirks = quirks_ref(q);
+	list_insert(&ctx->device_cache.entries, &entry->link);
+	ctx->device_cache.dirty = true;
+}
+
+static struct quirks *
+image_get_quirks(struct quirks_context *ctx, struct image_reader *r)
+{
+	struct quirks *q;
+	uint32_t nproperties;
+
+	nproperties = image_get_u32(r);
+	if (r->error || nproperties == 0)
+		return NULL;
+
+	/* Every property takes at least 8 bytes */
+	if (nproperties > (r->len - r->offset) / 8) {
+		r->error = true;
+		return NULL;
+	}
+
+	q = quirks_new();
+	q->properties = mem_zalloc(nproperties * sizeof(*q->properties));
+	for (uint32_t i = 0; !r->error && i < nproperties; i++) {
+		struct property *p = image_get_property(r);
+		int idx;
+
+		if (!p)
+			break;
+
+		list_append(&ctx->device_cache.properties, &p->link);
+
+		idx = quirk_index(p->id);
+		q->properties[q->nproperties++] = property_ref(p);
+		if (idx >= 0)
+			q->by_quirk[idx] = p;
+	}
+	list_insert(&ctx->quirks, &q->link);
+
+	return q;
+}
+
+/**
+ * Load the devices from the device cache file. Where the file doesn't
+ * exist, is stale or otherwise unusable, this function returns false
+ * and leaves the context untouched.
+ */
+static bool
+quirks_device_cache_load(struct quirks_context *ctx)
+{
+	const char *path = ctx->device_cache.path;
+	struct quirks_device_cache_header header;
+	struct image_reader reader = {0};
+	struct quirks_device_cache_entry *entry;
+	struct stat st;
+	void *map;
+	int fd;
+	bool rc = false;
+
+	fd = open(path, O_RDONLY|O_CLOEXEC);
+	if (fd < 0) {
+		if (errno != ENOENT)
+			qlog_debug(ctx, "%s: failed to open device cache\n", path);
+		return false;
+	}
+
+	if (fstat(fd, &st) < 0 ||
+	    (size_t)st.st_size < sizeof(header)) {
+		close(fd);
+		return false;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+
+	memcpy(&header, map, sizeof(header));
+	if (header.magic != QUIRKS_DEVICE_CACHE_MAGIC ||
+	    header.version != QUIRKS_DEVICE_CACHE_VERSION ||
+	    header.last_model_quirk != _QUIRK_LAST_MODEL_QUIRK_ ||
+	    header.last_attr_quirk != _QUIRK_LAST_ATTR_QUIRK_ ||
+	    header.size != st.st_size - sizeof(header)) {
+		qlog_debug(ctx, "%s: incompatible device cache, ignoring\n", path);
+		goto out;
+	}
+
+	if (header.stamp != ctx->device_cache.stamp) {
+		qlog_debug(ctx, "%s: device cache is stale, ignoring\n", path);
+		goto out;
+	}
+
+	reader.data = (const uint8_t *)map + sizeof(header);
+	reader.len = header.size;
+
+	if (fnv1a(FNV1A_INIT, reader.data, reader.len) != header.checksum) {
+		qlog_error(ctx, "%s: checksum mismatch, ignoring\n", path);
+		goto out;
+	}
+
+	for (uint32_t i = 0; !reader.error && i < header.nentries; i++) {
+		entry = zalloc(sizeof(*entry));
+		list_append(&ctx->device_cache.entries, &entry->link);
+		entry->identity = image_get_string(&reader);
+		entry->quirks = image_get_quirks(ctx, &reader);
+		if (!entry->identity)
+			reader.error = true;
+	}
+
+	if (reader.error || reader.offset != reader.len) {
+		qlog_error(ctx, "%s: invalid device cache, ignoring\n", path);
+		quirks_device_cache_flush(ctx);
+		goto out;
+	}
+
+	qlog_debug(ctx, "%s: loaded %u devices\n", path, header.nentries);
+	rc = true;
+
+out:
+	munmap(map, st.st_size);
+	return rc;
+}
+
+int
+quirks_context_write_device_cache(struct quirks_context *ctx)
+{
+	struct quirks_device_cache_header header = {
+		.magic = QUIRKS_DEVICE_CACHE_MAGIC,
+		.version = QUIRKS_DEVICE_CACHE_VERSION,
+		.last_model_quirk = _QUIRK_LAST_MODEL_QUIRK_,
+		.last_attr_quirk = _QUIRK_LAST_ATTR_QUIRK_,
+	};
+	struct quirks_device_cache_entry *entry;
+	struct image_buffer b = {0};
+	int rc;
+
+	if (!ctx || !ctx->device_cache.path)
+		return -EINVAL;
+
+	if (!ctx->device_cache.dirty)
+		return 0;
+
+	header.stamp = ctx->device_cache.stamp;
+
+	/* Reserve the header, we fill it in once we have the payload */
+	image_put(&b, &header, sizeof(header));
+
+	/* New entries are at the front of the list */
+	list_for_each(entry, &ctx->device_cache.entries, link) {
+		struct quirks *q = entry->quirks;
+
+		if (header.nentries == QUIRKS_DEVICE_CACHE_MAX)
+			break;
+
+		image_put_string(&b, entry->identity);
+		image_put_u32(&b, q ? q->nproperties : 0);
+		for (size_t i = 0; q && i < q->nproperties; i++)
+			image_put_property(&b, q->properties[i]);
+		header.nentries++;
+	}
+
+	header.size = b.len - sizeof(header);
+	header.checksum = fnv1a(FNV1A_INIT,
+				&b.data[sizeof(header)],
+				header.size);
+	memcpy(b.data, &header, sizeof(header));
+
+	rc = image_buffer_write(ctx, &b, ctx->device_cache.path);
+	if (rc == 0) {
+		qlog_debug(ctx, "%s: wrote %u devices\n",
+			   ctx->device_cache.path,
+			   header.nentries);
+		ctx->device_cache.dirty = false;
+	}
+
+	free(b.data);
+
+	return rc;
+}
+
+/* Two devices with the same identity always match the same sections,
+ * the host's DMI and device tree strings are the same for all devices */
+static char *
+quirks_device_identity(struct udev_device *udev_device)
+{
+	struct match *m;
+	const char *phys;
+	char *identity;
+
+	m = match_new(udev_device, NULL, NULL);
+	phys = udev_prop(udev_device, "PHYS");
+	xasprintf(&identity,
+		  "%x:%x:%x:%x:%x:%x:%s:%s",
+		  m->bits,
+		  m->bus,
+		  m->vendor,
+		  m->product,
+		  m->version,
+		  m->udev_type,
+		  m->name ? m->name : "",
+		  phys ? phys : "");
+	match_free(m);
+
+	return identity;
+}
+
+static struct quirks *
+quirks_match_device(struct quirks_context *ctx,
+		    struct udev_device *udev_device)
+{
+	struct quirks *q = NULL;
+	struct match *m;
+	struct section_bucket *vid_pid = NULL,
+			      *vid = NULL;
+	struct {
+		struct section **sections;
+		size_t nsections;
+		size_t pos;
+	} candidates[3] = {0};
+
+	if (!ctx->sections_loaded && !quirks_context_load_sections(ctx))
+		qlog_error(ctx, "%s: failed to load the data files\n",
+			   ctx->data_path);
+
+	qlog_debug(ctx, "%s: fetching quirks\n",
+		   udev_device_get_devnode(udev_device));
+
+	q = quirks_new();
+
+	m = match_new(udev_device, ctx->dmi, ctx->dt);
+
+	candidates[0].sections = ctx->index.generic;
+	candidates[0].nsections = ctx->index.ngeneric;
+	if (m->bits & M_VID) {
+		vid_pid = section_bucket_find(ctx, m->vendor, m->product,
+					      false, false);
+		vid = section_bucket_find(ctx, m->vendor, 0, true, false);
+	}
+	if (vid_pid) {
+		candidates[1].sections = vid_pid->sections;
+		candidates[1].nsections = vid_pid->nsections;
+	}
+	if (vid) {
+		candidates[2].sections = vid->sections;
+		candidates[2].nsections = vid->nsections;
+	}
+
+	/* Later sections override earlier ones, so walk the candidates
+	 * in the order the sections were loaded */
+	while (true) {
+		struct section *s = NULL;
+		size_t next = 0;
+
+		for (size_t i = 0; i < ARRAY_LENGTH(candidates); i++) {
+			struct section *c;
+
+			if (candidates[i].pos == candidates[i].nsections)
+				continue;
+
+			c = candidates[i].sections[candidates[i].pos];
+			if (!s || c->order < s->order) {
+				s = c;
+				next = i;
+			}
+		}
+
+		if (!s)
+			break;
+
+		candidates[next].pos++;
+		quirk_match_section(ctx, q, s, m, udev_device);
+	}
+
+	match_free(m);
+
+	if (q->nproperties == 0) {
+		quirks_unref(q);
+		return NULL;
+	}
+
+	list_insert(&ctx->quirks, &q->link);
+
+	return q;
+}
+
+struct quirks *
+quirks_fetch_for_device(struct quirks_context *ctx,
+			struct udev_device *udev_device)
+{
+	struct quirks_cache_entry *entry;
+	struct quirks_device_cache_entry *cached;
+	struct quirks *q;
+	const char *syspath;
+	char *identity;
+
+	if (!ctx)
+		return NULL;
+
+	/* The device setup fetches the quirks a dozen times, and again on
+	 * every resume */
+	entry = quirks_cache_find(ctx, udev_device);
+	if (entry) {
+		entry->generation = ctx->cache.generation;
+		return quirks_ref(entry->quirks);
+	}
+
+	syspath = udev_device_get_syspath(udev_device);
+	if (!syspath)
+		return quirks_match_device(ctx, udev_device);
+
+	/* A device that was unplugged and plugged back in gets a new
+	 * syspath but matches the same sections as before */
+	identity = quirks_device_identity(udev_device);
+	list_for_each(entry, &ctx->cache.entries, link) {
+		if (!entry->retired || !streq(entry->identity, identity))
+			continue;
+
+		free(identity);
+		free(entry->syspath);
+		entry->syspath = safe_strdup(syspath);
+		entry->devnum = udev_device_get_devnum(udev_device);
+		entry->generation = ctx->cache.generation;
+		entry->retired = 0;
+		qlog_debug(ctx, "%s: reusing quirks of a removed device\n",
+			   udev_device_get_devnode(udev_device));
+		return quirks_ref(entry->quirks);
+	}
+
+	/* Seen in a previous run, e.g. before a reboot */
+	cached = quirks_device_cache_find(ctx, identity);
+	if (cached) {
+		q = quirks_ref(cached->quirks);
+	} else {
+		q = quirks_match_device(ctx, udev_device);
+		if (ctx->device_cache.path)
+			quirks_device_cache_add(ctx, identity, q);
+	}
+
+	entry = zalloc(sizeof(*entry));
+	entry->syspath = safe_strdup(syspath);
+	entry->devnum = udev_device_get_devnum(udev_device);
+	entry->identity = identity;
+	entry->quirks = quirks_ref(q);
+	entry->generation = ctx->cache.generation;
+	list_insert(&ctx->cache.entries, &entry->link);
+
+	return q;
+}
+
+static bool
+property_equal(const struct property *a, const struct property *b)
+{
+	if (a->id != b->id || a->type != b->type)
+		return false;
+
+	switch (a->type) {
+	case PT_UINT:
+		return a->value.u == b->value.u;
+	case PT_INT:
+		return a->value.i == b->value.i;
+	case PT_BOOL:
+		return a->value.b == b->value.b;
+	case PT_STRING:
+		return streq(a->value.s, b->value.s);
+	case PT_DIMENSION:
+		return a->value.dim.x == b->value.dim.x &&
+		       a->value.dim.y == b->value.dim.y;
+	case PT_RANGE:
+		return a->value.range.lower == b->value.range.lower &&
+		       a->value.range.upper == b->value.range.upper;
+	case PT_DOUBLE:
+		return a->value.d == b->value.d;
+	case PT_TUPLES:
+		return a->value.tuples.ntuples == b->value.tuples.ntuples &&
+		       memcmp(a->value.tuples.tuples,
+			      b->value.tuples.tuples,
+			      a->value.tuples.ntuples *
+			      sizeof(a->value.tuples.tuples[0])) == 0;
+	}
+
+	return false;
+}
+
+static bool
+quirks_equal(const struct quirks *a, const struct quirks *b)
+{
+	if (!a || !b)
+		return a == b;
+
+	/* Only the property that wins for each quirk matters, a changed
+	 * value that is overridden by a later section is not a change */
+	for (size_t i = 0; i < ARRAY_LENGTH(a->by_quirk); i++) {
+		const struct property *pa = a->by_quirk[i],
+				      *pb = b->by_quirk[i];
+
+		if (!pa || !pb) {
+			if (pa != pb)
+				return false;
+		} else if (!property_equal(pa, pb)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static int
+section_compare_load_order(const void *a, const void *b)
+{
+	const struct section *sa = *(const struct section * const *)a;
+	const struct section *sb = *(const struct section * const *)b;
+
+	if (sa->file->index != sb->file->index)
+		return sa->file->index < sb->file->index ? -1 : 1;
+
+	/* same file, keep the parse order */
+	if (sa->order != sb->order)
+		return sa->order < sb->order ? -1 : 1;
+
+	return 0;
+}
+
+static bool
+quirks_device_affected(struct quirks_context *ctx,
+		       struct list *dead,
+		       struct udev_device *udev_device)
+{
+	struct match *m;
+	struct section *s;
+	bool affected = false;
+
+	m = match_new(udev_device, ctx->dmi, ctx->dt);
+
+	list_for_each(s, dead, link) {
+		if (section_matches(ctx, s, m)) {
+			affected = true;
+			goto out;
+		}
+	}
+
+	list_for_each(s, &ctx->sections, link) {
+		if (s->file->changed && section_matches(ctx, s, m)) {
+			affected = true;
+			goto out;
+		}
+	}
+
+out:
+	match_free(m);
+	return affected;
+}
+
+int
+quirks_context_reload(struct quirks_context *ctx,
+		      struct udev_device **devices,
+		      size_t ndevices,
+		      bool *changed)
+{
+	struct quirks_context *parsed;
+	struct quirks_file *f, *old, *ftmp;
+	struct quirks_cache_entry *entry, *etmp;
+	struct section *s, *tmp, **sections;
+	struct list files, dead;
+	size_t nchanged = 0,
+	       nsections = 0;
+	uint64_t stamp = 0;
+
+	for (size_t i = 0; i < ndevices; i++)
+		changed[i] = false;
+
+	/* Everything came from the device cache so far */
+	if (!ctx->sections_loaded)
+		quirks_context_load_sections(ctx);
+
+	list_init(&files);
+	if (!quirks_scan_files(ctx->data_path, ctx->override_file, &files)) {
+		qlog_error(ctx,
+			   "%s: failed to find data files\n",
+			   ctx->data_path);
+		return -ENOENT;
+	}
+
+	/* The sections from the image don't know which file they came
+	 * from, the first reload after loading it re-parses everything */
+	list_for_each(f, &files, link) {
+		old = quirks_files_find(&ctx->files, f->path);
+		f->changed = ctx->from_image || !old || old->stamp != f->stamp;
+		if (f->changed)
+			nchanged++;
+	}
+	list_for_each(old, &ctx->files, link) {
+		f = quirks_files_find(&files, old->path);
+		old->changed = !f || f->changed;
+		if (!f)
+			nchanged++;
+	}
+
+	if (nchanged == 0) {
+		quirks_files_free(&files);
+		return 0;
+	}
+
+	/* Stamp first, so a file changing while we parse makes the
+	 * device cache stale rather than silently out of date */
+	if (ctx->device_cache.path)
+		quirks_source_stamp(ctx->data_path, ctx->override_file, &stamp);
+
+	/* Parse into a separate context first so a broken file leaves
+	 * us with the previous state */
+	parsed = quirks_context_new(ctx->log_handler,
+				    ctx->libinput,
+				    ctx->log_type);
+	if (!parse_file_list(parsed, &files, true)) {
+		qlog_error(ctx, "Failed to reload the quirks, keeping the previous ones\n");
+		quirks_context_unref(parsed);
+		quirks_files_free(&files);
+		return -EINVAL;
+	}
+
+	/* The old sections of changed files can't be destroyed yet, the
+	 * cached quirks still reference their properties */
+	list_for_each(s, &ctx->sections, link)
+		nsections++;
+	list_for_each(s, &parsed->sections, link)
+		nsections++;
+	sections = zalloc(nsections * sizeof(*sections));
+	nsections = 0;
+
+	list_init(&dead);
+	list_for_each_safe(s, tmp, &ctx->sections, link) {
+		list_remove(&s->link);
+		if (!s->file || s->file->changed) {
+			list_append(&dead, &s->link);
+			continue;
+		}
+
+		s->file = quirks_files_find(&files, s->file->path);
+		s->order = nsections;
+		sections[nsections++] = s;
+	}
+	list_for_each_safe(s, tmp, &parsed->sections, link) {
+		list_remove(&s->link);
+		s->order = nsections;
+		sections[nsections++] = s;
+	}
+	quirks_context_unref(parsed);
+
+	qsort(sections, nsections, sizeof(*sections), section_compare_load_order);
+	for (size_t i = 0; i < nsections; i++)
+		list_append(&ctx->sections, &sections[i]->link);
+	free(sections);
+
+	quirks_index_reset(ctx);
+	quirks_index_sections(ctx);
+
+	/* Only a device that matches one of the old or new sections of
+	 * a changed file can have a different result */
+	list_for_each(entry, &ctx->cache.entries, link)
+		entry->checked = false;
+
+	for (size_t i = 0; i < ndevices; i++) {
+		entry = quirks_cache_find(ctx, devices[i]);
+
+		if (quirks_device_affected(ctx, &dead, devices[i])) {
+			struct quirks *q = quirks_match_device(ctx, devices[i]);
+
+			changed[i] = !entry || !quirks_equal(entry->quirks, q);
+			if (entry) {
+				quirks_unref(entry->quirks);
+				entry->quirks = q;
+			} else {
+				quirks_unref(q);
+			}
+		}
+
+		if (entry)
+			entry->checked = true;
+	}
+
+	/* Entries for other devices may reference the old sections,
+	 * they get re-fetched if the device comes back */
+	list_for_each_safe(entry, etmp, &ctx->cache.entries, link) {
+		if (!entry->checked)
+			quirks_cache_entry_destroy(entry);
+	}
+
+	list_for_each_safe(s, tmp, &dead, link)
+		section_destroy(s);
+
+	quirks_files_free(&ctx->files);
+	list_for_each_safe(f, ftmp, &files, link) {
+		list_remove(&f->link);
+		f->changed = false;
+		list_append(&ctx->files, &f->link);
+	}
+	ctx->from_image = false;
+
+	/* What's left in the memory cache is up-to-date, the other
+	 * devices in the device cache may match differently now */
+	if (ctx->device_cache.path) {
+		quirks_device_cache_flush(ctx);
+		list_for_each(entry, &ctx->cache.entries, link) {
+			if (!quirks_device_cache_find(ctx, entry->identity))
+				quirks_device_cache_add(ctx,
+							entry->identity,
+							entry->quirks);
+		}
+		ctx->device_cache.stamp = quirks_device_cache_stamp(ctx, stamp);
+		ctx->device_cache.dirty = true;
+	}
+
+	qlog_info(ctx, "%zd quirks files changed, reloaded\n", nchanged);
+
+	return nchanged;
+}
+
+
+static inline struct property *
+quirk_find_prop(struct quirks *q, enum quirk which)
+{
+	int idx = quirk_index(which);
+
+	if (idx < 0)
+		return NULL;
+
+	return q->by_quirk[idx];
 }
 
 bool
@@ -89,6 +89,7 @@ enum quirk {
 	QUIRK_MODEL_WACOM_TOUCHPAD,
 	QUIRK_MODEL_WACOM_ISDV4_PEN,
 	QUIRK_MODEL_DELL_CANVAS_TOTEM,
+	QUIRK_MODEL_VIRTUAL_DEVICE,
 
 	_QUIRK_LAST_MODEL_QUIRK_, /* Guard: do not modify */
 
@@ -109,6 +110,9 @@ enum quirk {
 	QUIRK_ATTR_THUMB_SIZE_THRESHOLD,
 	QUIRK_ATTR_MSC_TIMESTAMP,
 	QUIRK_ATTR_EVENT_CODE_DISABLE,
+	QUIRK_ATTR_TOUCHPAD_HISTORY_LENGTH,
+	QUIRK_ATTR_TABLET_SMOOTHING_WINDOW,
+	QUIRK_ATTR_DISPATCH_PRIORITY,
 
 	_QUIRK_LAST_ATTR_QUIRK_, /* Guard: do not modify */
 };
@@ -166,6 +170,55 @@ quirks_init_subsystem(const char *data_path,
 		      struct libinput *libinput,
 		      enum quirks_log_type log_type);
 
+/**
+ * Like quirks_init_subsystem() but with the device cache at cache_path,
+ * a file with the quirks of each device previously fetched. If the cache
+ * was written for the same data files, override file, host and libinput
+ * version, the quirks of the devices in it are taken from the cache and
+ * the data files are only loaded once a device isn't found there.
+ *
+ * A missing or stale cache is not an error, it is replaced by the next
+ * quirks_context_write_device_cache().
+ *
+ * @param cache_path The device cache file, or NULL for none
+ */
+struct quirks_context *
+quirks_init_subsystem_cached(const char *data_path,
+			     const char *override_file,
+			     const char *cache_path,
+			     libinput_log_handler log_handler,
+			     struct libinput *libinput,
+			     enum quirks_log_type log_type);
+
+/**
+ * Write the quirks of the devices in the device cache and of all devices
+ * fetched since to the device cache file. Does nothing if nothing
+ * changed since the cache was loaded or last written.
+ *
+ * @return 0 on success, -EINVAL if the context has no device cache or
+ * another negative errno
+ */
+int
+quirks_context_write_device_cache(struct quirks_context *ctx);
+
+/**
+ * Parse the quirks files in data_path and the override file and write the
+ * result as a binary image into data_path. quirks_init_subsystem() loads
+ * this image instead of parsing the files for as long as the files and the
+ * override file remain unchanged.
+ *
+ * @param data_path The directory containing the various data files
+ * @param override_file A file path containing custom overrides
+ * @param log_handler The libinput log handler called for debugging output
+ *
+ * @return true on success or false on failure
+ */
+bool
+quirks_compile_image(const char *data_path,
+		     const char *override_file,
+		     libinput_log_handler log_handler,
+		     enum quirks_log_type log_type);
+
 /**
  * Clean up after ourselves. This function must be called
  * as the last call to the quirks subsystem.
@@ -181,16 +234,99 @@ quirks_context_unref(struct quirks_context *ctx);
 struct quirks_context *
 quirks_context_ref(struct quirks_context *ctx);
 
+/**
+ * @return The time in microseconds spent reading the host's DMI modalias
+ * and device tree compatible string during quirks_init_subsystem()
+ */
+uint64_t
+quirks_context_get_host_lookup_time(struct quirks_context *ctx);
+
+/**
+ * @return The number of bytes allocated for the context, its sections,
+ * the section index and the cached per-device results. This is an
+ * estimate, it does not include the allocator's overhead.
+ */
+size_t
+quirks_context_get_memory_usage(struct quirks_context *ctx);
+
+/**
+ * Change the libinput struct passed to the log handler, e.g. when the
+ * context is shared and the libinput context that initialized it may go
+ * away first.
+ */
+void
+quirks_context_set_log_target(struct quirks_context *ctx,
+			      struct libinput *libinput);
+
+/**
+ * Re-parse the data files and the override file that changed, were
+ * added or were removed since they were last loaded, and re-match the
+ * given devices where the result could differ.
+ *
+ * changed must have room for ndevices values and is set to true for
+ * each device whose quirks are now different. Cached results for devices
+ * not in the list are dropped. No quirks other than the cached ones may
+ * be held by the caller.
+ *
+ * If a file fails to parse, the context stays as it was.
+ *
+ * @return the number of changed files, or a negative errno
+ */
+int
+quirks_context_reload(struct quirks_context *ctx,
+		      struct udev_device **devices,
+		      size_t ndevices,
+		      bool *changed);
+
 /**
  * Fetch the quirks for a given device. If no quirks are defined, this
  * function returns NULL.
  *
+ * The result is cached by the device's syspath and devnum, fetching the
+ * quirks again for the same device, e.g. after a resume, does not
+ * re-match the sections.
+ *
  * @return A new quirks struct, use quirks_unref() to release
  */
 struct quirks *
 quirks_fetch_for_device(struct quirks_context *ctx,
 			struct udev_device *device);
 
+/**
+ * Keep the cached quirks for this device in the current generation as if
+ * they had been fetched, see quirks_cache_expire().
+ */
+void
+quirks_cache_keep(struct quirks_context *ctx,
+		  struct udev_device *device);
+
+/**
+ * Drop the cached quirks for this device, e.g. because the device was
+ * removed.
+ */
+void
+quirks_cache_forget(struct quirks_context *ctx,
+		    struct udev_device *device);
+
+/**
+ * Keep the cached quirks for a device that was removed. The next device
+ * with the same name, bus, vendor and product ID, version, udev type and
+ * physical path takes them over without re-matching, even though its
+ * syspath differs. Only the most recently retired few are kept.
+ */
+void
+quirks_cache_retire(struct quirks_context *ctx,
+		    struct udev_device *device);
+
+/**
+ * Drop the cached quirks of all devices not fetched or kept since the
+ * last call to this function and start a new generation. Call this after
+ * re-enumerating the devices to drop the devices that went away in the
+ * meantime.
+ */
+void
+quirks_cache_expire(struct quirks_context *ctx);
+
 /**
  * Reduce the refcount by one. When the refcount reaches zero, the
  * associated struct is released.
@@ -0,0 +1,293 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include "libinput-private.h"
+#include "evdev.h"
+#include "replug.h"
+
+/* Most recently removed devices remembered, see
+ * libinput_set_replug_timeout() */
+#define REPLUG_CACHE_MAX 16
+
+enum replug_option {
+	REPLUG_TAP = bit(0),
+	REPLUG_TAP_MAP = bit(1),
+	REPLUG_DRAG = bit(2),
+	REPLUG_DRAG_LOCK = bit(3),
+	REPLUG_SEND_EVENTS = bit(4),
+	REPLUG_SPEED = bit(5),
+	REPLUG_PROFILE = bit(6),
+	REPLUG_NATURAL_SCROLL = bit(7),
+	REPLUG_LEFT_HANDED = bit(8),
+	REPLUG_CLICK_METHOD = bit(9),
+	REPLUG_MIDDLE_EMULATION = bit(10),
+	REPLUG_SCROLL_METHOD = bit(11),
+	REPLUG_SCROLL_BUTTON = bit(12),
+	REPLUG_SCROLL_BUTTON_LOCK = bit(13),
+	REPLUG_DWT = bit(14),
+	REPLUG_ROTATION = bit(15),
+};
+
+/* The configuration of a removed device, only the options that differ
+ * from the defaults are restored */
+struct replug_entry {
+	struct list link; /* struct libinput.replug.entries */
+	char *identity; /* see evdev_device_get_identity() */
+	uint64_t removed;
+	uint32_t options; /* enum replug_option */
+
+	enum libinput_config_tap_state tap;
+	enum libinput_config_tap_button_map tap_map;
+	enum libinput_config_drag_state drag;
+	enum libinput_config_drag_lock_state drag_lock;
+	uint32_t send_events;
+	double speed;
+	enum libinput_config_accel_profile profile;
+	int natural_scroll;
+	int left_handed;
+	enum libinput_config_click_method click_method;
+	enum libinput_config_middle_emulation_state middle_emulation;
+	enum libinput_config_scroll_method scroll_method;
+	uint32_t scroll_button;
+	enum libinput_config_scroll_button_lock_state scroll_button_lock;
+	enum libinput_config_dwt_state dwt;
+	unsigned int rotation;
+};
+
+static void
+replug_entry_destroy(struct libinput *libinput, struct replug_entry *entry)
+{
+	list_remove(&entry->link);
+	libinput->replug.count--;
+	free(entry->identity);
+	free(entry);
+}
+
+/* Drops the entries older than the timeout, the list is newest first */
+static void
+replug_cache_expire(struct libinput *libinput, uint64_t now)
+{
+	struct replug_entry *entry, *tmp;
+	uint64_t timeout = ms2us(libinput->replug.timeout);
+
+	list_for_each_safe(entry, tmp, &libinput->replug.entries, link) {
+		if (now - entry->removed > timeout)
+			replug_entry_destroy(libinput, entry);
+	}
+}
+
+#define replug_save(entry_, option_, field_, get_, get_default_) \
+	do { \
+		(entry_)->field_ = get_(device); \
+		if ((entry_)->field_ != get_default_(device)) \
+			(entry_)->options |= (option_); \
+	} while (0)
+
+void
+replug_cache_store(struct libinput_device *device)
+{
+	struct libinput *libinput = device->seat->libinput;
+	struct replug_entry *entry, *tmp;
+	struct replug_entry config = {0};
+	uint64_t now = libinput_now(libinput);
+	char *identity;
+
+	if (libinput->replug.timeout == 0)
+		return;
+
+	replug_cache_expire(libinput, now);
+
+	replug_save(&config, REPLUG_TAP, tap,
+		    libinput_device_config_tap_get_enabled,
+		    libinput_device_config_tap_get_default_enabled);
+	replug_save(&config, REPLUG_TAP_MAP, tap_map,
+		    libinput_device_config_tap_get_button_map,
+		    libinput_device_config_tap_get_default_button_map);
+	replug_save(&config, REPLUG_DRAG, drag,
+		    libinput_device_config_tap_get_drag_enabled,
+		    libinput_device_config_tap_get_default_drag_enabled);
+	replug_save(&config, REPLUG_DRAG_LOCK, drag_lock,
+		    libinput_device_config_tap_get_drag_lock_enabled,
+		    libinput_device_config_tap_get_default_drag_lock_enabled);
+	replug_save(&config, REPLUG_SEND_EVENTS, send_events,
+		    libinput_device_config_send_events_get_mode,
+		    libinput_device_config_send_events_get_default_mode);
+	replug_save(&config, REPLUG_SPEED, speed,
+		    libinput_device_config_accel_get_speed,
+		    libinput_device_config_accel_get_default_speed);
+	replug_save(&config, REPLUG_PROFILE, profile,
+		    libinput_device_config_accel_get_profile,
+		    libinput_device_config_accel_get_default_profile);
+	replug_save(&config, REPLUG_NATURAL_SCROLL, natural_scroll,
+		    libinput_device_config_scroll_get_natural_scroll_enabled,
+		    libinput_device_config_scroll_get_default_natural_scroll_enabled);
+	replug_save(&config, REPLUG_LEFT_HANDED, left_handed,
+		    libinput_device_config_left_handed_get,
+		    libinput_device_config_left_handed_get_default);
+	replug_save(&config, REPLUG_CLICK_METHOD, click_method,
+		    libinput_device_config_click_get_method,
+		    libinput_device_config_click_get_default_method);
+	replug_save(&config, REPLUG_MIDDLE_EMULATION, middle_emulation,
+		    libinput_device_config_middle_emulation_get_enabled,
+		    libinput_device_config_middle_emulation_get_default_enabled);
+	replug_save(&config, REPLUG_SCROLL_METHOD, scroll_method,
+		    libinput_device_config_scroll_get_method,
+		    libinput_device_config_scroll_get_default_method);
+	replug_save(&config, REPLUG_SCROLL_BUTTON, scroll_button,
+		    libinput_device_config_scroll_get_button,
+		    libinput_device_config_scroll_get_default_button);
+	replug_save(&config, REPLUG_SCROLL_BUTTON_LOCK, scroll_button_lock,
+		    libinput_device_config_scroll_get_button_lock,
+		    libinput_device_config_scroll_get_default_button_lock);
+	replug_save(&config, REPLUG_DWT, dwt,
+		    libinput_device_config_dwt_get_enabled,
+		    libinput_device_config_dwt_get_default_enabled);
+	replug_save(&config, REPLUG_ROTATION, rotation,
+		    libinput_device_config_rotation_get_angle,
+		    libinput_device_config_rotation_get_default_angle);
+
+	identity = evdev_device_get_identity(evdev_device(device));
+	list_for_each_safe(entry, tmp, &libinput->replug.entries, link) {
+		if (streq(entry->identity, identity))
+			replug_entry_destroy(libinput, entry);
+	}
+
+	/* Nothing to restore, the quirks are remembered separately */
+	if (config.options == 0) {
+		free(identity);
+		return;
+	}
+
+	if (libinput->replug.count == REPLUG_CACHE_MAX) {
+		entry = container_of(libinput->replug.entries.prev,
+				     struct replug_entry,
+				     link);
+		replug_entry_destroy(libinput, entry);
+	}
+
+	entry = zalloc(sizeof(*entry));
+	*entry = config;
+	entry->identity = identity;
+	entry->removed = now;
+	list_insert(&libinput->replug.entries, &entry->link);
+	libinput->replug.count++;
+}
+
+#define replug_restore(entry_, option_, field_, set_) \
+	do { \
+		if ((entry_)->options & (option_)) \
+			set_(device, (entry_)->field_); \
+	} while (0)
+
+void
+replug_cache_restore(struct libinput_device *device)
+{
+	struct libinput *libinput = device->seat->libinput;
+	struct replug_entry *entry;
+	char *identity;
+	bool found = false;
+
+	if (libinput->replug.timeout == 0 ||
+	    list_empty(&libinput->replug.entries))
+		return;
+
+	replug_cache_expire(libinput, libinput_now(libinput));
+
+	identity = evdev_device_get_identity(evdev_device(device));
+	list_for_each(entry, &libinput->replug.entries, link) {
+		if (streq(entry->identity, identity)) {
+			found = true;
+			break;
+		}
+	}
+	free(identity);
+
+	if (!found)
+		return;
+
+	log_debug(libinput,
+		  "%s: restoring the configuration of a removed device\n",
+		  libinput_device_get_sysname(device));
+
+	/* One state reset for all options */
+	libinput_device_config_begin(device);
+	replug_restore(entry, REPLUG_TAP, tap,
+		       libinput_device_config_tap_set_enabled);
+	replug_restore(entry, REPLUG_TAP_MAP, tap_map,
+		       libinput_device_config_tap_set_button_map);
+	replug_restore(entry, REPLUG_DRAG, drag,
+		       libinput_device_config_tap_set_drag_enabled);
+	replug_restore(entry, REPLUG_DRAG_LOCK, drag_lock,
+		       libinput_device_config_tap_set_drag_lock_enabled);
+	replug_restore(entry, REPLUG_SPEED, speed,
+		       libinput_device_config_accel_set_speed);
+	replug_restore(entry, REPLUG_PROFILE, profile,
+		       libinput_device_config_accel_set_profile);
+	replug_restore(entry, REPLUG_NATURAL_SCROLL, natural_scroll,
+		       libinput_device_config_scroll_set_natural_scroll_enabled);
+	replug_restore(entry, REPLUG_LEFT_HANDED, left_handed,
+		       libinput_device_config_left_handed_set);
+	replug_restore(entry, REPLUG_CLICK_METHOD, click_method,
+		       libinput_device_config_click_set_method);
+	replug_restore(entry, REPLUG_MIDDLE_EMULATION, middle_emulation,
+		       libinput_device_config_middle_emulation_set_enabled);
+	replug_restore(entry, REPLUG_SCROLL_METHOD, scroll_method,
+		       libinput_device_config_scroll_set_method);
+	replug_restore(entry, REPLUG_SCROLL_BUTTON, scroll_button,
+		       libinput_device_config_scroll_set_button);
+	replug_restore(entry, REPLUG_SCROLL_BUTTON_LOCK, scroll_button_lock,
+		       libinput_device_config_scroll_set_button_lock);
+	replug_restore(entry, REPLUG_DWT, dwt,
+		       libinput_device_config_dwt_set_enabled);
+	replug_restore(entry, REPLUG_ROTATION, rotation,
+		       libinput_device_config_rotation_set_angle);
+	libinput_device_config_commit(device);
+
+	/* Suspends the device, so outside of the transaction */
+	replug_restore(entry, REPLUG_SEND_EVENTS, send_events,
+		       libinput_device_config_send_events_set_mode);
+
+	replug_entry_destroy(libinput, entry);
+}
+
+LIBINPUT_EXPORT void
+libinput_set_replug_timeout(struct libinput *libinput,
+			    uint32_t timeout_ms)
+{
+	struct replug_entry *entry, *tmp;
+
+	libinput->replug.timeout = timeout_ms;
+
+	if (timeout_ms == 0) {
+		list_for_each_safe(entry, tmp, &libinput->replug.entries, link)
+			replug_entry_destroy(libinput, entry);
+	}
+}
+
+LIBINPUT_EXPORT uint32_t
+libinput_get_replug_timeout(struct libinput *libinput)
+{
+	return libinput->replug.timeout;
+}
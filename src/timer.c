@@ -32,6 +32,26 @@
 #include "libinput-private.h"
 #include "timer.h"
 
+/* Statistics are kept per timer name for the lifetime of the context,
+ * so they survive the timer's device being removed and added again */
+static struct timer_stats *
+timer_stats_lookup(struct libinput *libinput, const char *timer_name)
+{
+	struct timer_stats *stats;
+
+	list_for_each(stats, &libinput->timer.stats, link) {
+		if (streq(stats->name, timer_name))
+			return stats;
+	}
+
+	stats = zalloc(sizeof(*stats));
+	stats->name = safe_strdup(timer_name);
+	list_append(&libinput->timer.stats, &stats->link);
+	libinput->timer.nstats++;
+
+	return stats;
+}
+
 void
 libinput_timer_init(struct libinput_timer *timer,
 		    struct libinput *libinput,
@@ -40,42 +60,254 @@ libinput_timer_init(struct libinput_timer *timer,
 		    void *timer_func_data)
 {
 	timer->libinput = libinput;
-	timer->timer_name = safe_strdup(timer_name);
+	timer->stats = timer_stats_lookup(libinput, timer_name);
+	timer->index = -1;
 	timer->timer_func = timer_func;
 	timer->timer_func_data = timer_func_data;
 }
 
+void
+libinput_timer_set_index(struct libinput_timer *timer, int index)
+{
+	timer->index = index;
+}
+
+/* The name for log messages, only composed when needed */
+static const char *
+timer_log_name(struct libinput_timer *timer, char *buf, size_t sz)
+{
+	if (timer->index < 0)
+		return timer->stats->name;
+
+	snprintf(buf, sz, "%s (%d)", timer->stats->name, timer->index);
+
+	return buf;
+}
+
 void
 libinput_timer_destroy(struct libinput_timer *timer)
 {
-	if (timer->link.prev != NULL && timer->link.prev != NULL &&
-	    !list_empty(&timer->link)) {
+	char name[64];
+
+	if (timer->expire) {
 		log_bug_libinput(timer->libinput,
 				 "timer: %s has not been cancelled\n",
-				 timer->timer_name);
+				 timer_log_name(timer, name, sizeof(name)));
 		assert(!"timer not cancelled");
 	}
-	free(timer->timer_name);
+}
+
+void
+libinput_timer_set_slack(struct libinput_timer *timer, uint64_t slack)
+{
+	assert(!timer->expire);
+
+	timer->slack = slack;
+	timer->libinput->timer.max_slack = max(timer->libinput->timer.max_slack,
+					       slack);
+}
+
+void
+libinput_timer_set_frame_slack(struct libinput_timer *timer,
+			       uint64_t frame_slack)
+{
+	timer->frame_slack = frame_slack;
+	timer->libinput->timer.max_frame_slack =
+		max(timer->libinput->timer.max_frame_slack, frame_slack);
+}
+
+/* A timer that expires shortly after the frame deadline fires at the
+ * deadline instead */
+static inline bool
+timer_is_frame_due(struct libinput_timer *timer, uint64_t frame_deadline)
+{
+	return frame_deadline != 0 &&
+	       timer->expire > frame_deadline &&
+	       timer->expire <= frame_deadline + timer->frame_slack;
+}
+
+/*
+ * Armed timers are kept in a binary min-heap ordered by deadline, i.e.
+ * expiry plus slack, so arming and cancelling a timer is O(log n) and
+ * the timer that must fire first is always heap[0]. Each timer stores
+ * its own heap index for removal.
+ *
+ * The timerfd is programmed for the earliest deadline, and once it fires
+ * every timer that has expired by then fires too. Timers with slack
+ * thus get batched with other timers expiring shortly after them.
+ */
+
+static inline bool
+timer_heap_less(struct libinput *libinput, size_t a, size_t b)
+{
+	return libinput->timer.heap[a]->deadline <
+		libinput->timer.heap[b]->deadline;
+}
+
+static inline void
+timer_heap_swap(struct libinput *libinput, size_t a, size_t b)
+{
+	struct libinput_timer **heap = libinput->timer.heap;
+	struct libinput_timer *tmp = heap[a];
+
+	heap[a] = heap[b];
+	heap[b] = tmp;
+	heap[a]->heap_index = a;
+	heap[b]->heap_index = b;
+}
+
+static void
+timer_heap_sift_up(struct libinput *libinput, size_t idx)
+{
+	while (idx > 0) {
+		size_t parent = (idx - 1) / 2;
+
+		if (!timer_heap_less(libinput, idx, parent))
+			break;
+
+		timer_heap_swap(libinput, idx, parent);
+		idx = parent;
+	}
+}
+
+static void
+timer_heap_sift_down(struct libinput *libinput, size_t idx)
+{
+	size_t count = libinput->timer.heap_count;
+
+	while (true) {
+		size_t left = 2 * idx + 1,
+		       right = left + 1,
+		       smallest = idx;
+
+		if (left < count && timer_heap_less(libinput, left, smallest))
+			smallest = left;
+		if (right < count && timer_heap_less(libinput, right, smallest))
+			smallest = right;
+		if (smallest == idx)
+			break;
+
+		timer_heap_swap(libinput, idx, smallest);
+		idx = smallest;
+	}
+}
+
+static void
+timer_heap_insert(struct libinput *libinput, struct libinput_timer *timer)
+{
+	if (libinput->timer.heap_count == libinput->timer.heap_size) {
+		size_t size = max(libinput->timer.heap_size * 2, 16U);
+		struct libinput_timer **heap;
+
+		heap = mem_realloc(libinput->timer.heap, size * sizeof(*heap));
+		if (!heap)
+			abort();
+
+		libinput->timer.heap = heap;
+		libinput->timer.heap_size = size;
+	}
+
+	timer->heap_index = libinput->timer.heap_count++;
+	libinput->timer.heap[timer->heap_index] = timer;
+	timer_heap_sift_up(libinput, timer->heap_index);
+}
+
+static void
+timer_heap_remove(struct libinput *libinput, struct libinput_timer *timer)
+{
+	size_t idx = timer->heap_index;
+	size_t last = --libinput->timer.heap_count;
+
+	assert(libinput->timer.heap[idx] == timer);
+
+	if (idx != last) {
+		timer_heap_swap(libinput, idx, last);
+		timer_heap_sift_down(libinput, idx);
+		timer_heap_sift_up(libinput, idx);
+	}
+}
+
+/* A frame-due timer's deadline is at most frame_deadline plus the
+ * largest slacks, any subtree with a later root can be skipped */
+static bool
+timer_heap_has_frame_due(struct libinput *libinput,
+			 size_t idx,
+			 uint64_t frame_deadline,
+			 uint64_t horizon)
+{
+	struct libinput_timer *timer;
+
+	if (idx >= libinput->timer.heap_count)
+		return false;
+
+	timer = libinput->timer.heap[idx];
+	if (timer->deadline > horizon)
+		return false;
+
+	return timer_is_frame_due(timer, frame_deadline) ||
+	       timer_heap_has_frame_due(libinput, 2 * idx + 1,
+					frame_deadline, horizon) ||
+	       timer_heap_has_frame_due(libinput, 2 * idx + 2,
+					frame_deadline, horizon);
+}
+
+/* The time the first timer must fire, UINT64_MAX if none is armed */
+static uint64_t
+timer_next_fire_time(struct libinput *libinput)
+{
+	uint64_t frame_deadline = libinput->timer.frame_deadline;
+	uint64_t earliest;
+
+	if (libinput->timer.heap_count == 0)
+		return UINT64_MAX;
+
+	earliest = libinput->timer.heap[0]->deadline;
+	if (frame_deadline != 0 && frame_deadline < earliest &&
+	    libinput->timer.max_frame_slack > 0 &&
+	    timer_heap_has_frame_due(libinput, 0, frame_deadline,
+				     frame_deadline +
+				     libinput->timer.max_frame_slack +
+				     libinput->timer.max_slack))
+		earliest = frame_deadline;
+
+	return earliest;
 }
 
 static void
 libinput_timer_arm_timer_fd(struct libinput *libinput)
 {
 	int r;
-	struct libinput_timer *timer;
 	struct itimerspec its = { { 0, 0 }, { 0, 0 } };
-	uint64_t earliest_expire = UINT64_MAX;
+	uint64_t earliest_expire;
+
+	/* The handler re-arms once it's done */
+	if (libinput->timer.in_handler)
+		return;
+
+	earliest_expire = timer_next_fire_time(libinput);
 
-	list_for_each(timer, &libinput->timer.list, link) {
-		if (timer->expire < earliest_expire)
-			earliest_expire = timer->expire;
+	/* On the caller's clock or with the caller managing the timers
+	 * there is no timerfd to program, the timers are flushed by
+	 * libinput_dispatch() */
+	if (libinput->clock.func || libinput->timer.client_managed) {
+		libinput->timer.next_expiry = earliest_expire;
+		return;
 	}
 
+	/* If the earliest expiry moved later (or all timers are gone),
+	 * leave the timerfd alone. It wakes us up a bit early, the
+	 * handler finds nothing expired and we reprogram then. This
+	 * avoids a syscall for every re-armed timer, e.g. the DWT timer on
+	 * every key press. */
+	if (earliest_expire >= libinput->timer.next_expiry)
+		return;
+
 	if (earliest_expire != UINT64_MAX) {
 		its.it_value.tv_sec = earliest_expire / ms2us(1000);
 		its.it_value.tv_nsec = (earliest_expire % ms2us(1000)) * 1000;
 	}
 
+	libinput->timer.settime_calls++;
 	r = timerfd_settime(libinput->timer.fd, TFD_TIMER_ABSTIME, &its, NULL);
 	if (r)
 		log_error(libinput, "timer: timerfd_settime error: %s\n", strerror(errno));
@@ -88,29 +320,45 @@ libinput_timer_set_flags(struct libinput_timer *timer,
 			 uint64_t expire,
 			 uint32_t flags)
 {
+	struct libinput *libinput = timer->libinput;
 #ifndef NDEBUG
 	uint64_t now = libinput_now(timer->libinput);
+	char name[64];
+
 	if (expire < now) {
 		if ((flags & TIMER_FLAG_ALLOW_NEGATIVE) == 0)
 			log_bug_client(timer->libinput,
 				       "timer %s: scheduled expiry is in the past (-%dms), your system is too slow\n",
-				       timer->timer_name,
+				       timer_log_name(timer, name, sizeof(name)),
 				       us2ms(now - expire));
 	} else if ((expire - now) > ms2us(5000)) {
 		log_bug_libinput(timer->libinput,
 			 "timer %s: offset more than 5s, now %d expire %d\n",
-			 timer->timer_name,
+			 timer_log_name(timer, name, sizeof(name)),
 			 us2ms(now), us2ms(expire));
 	}
 #endif
 
 	assert(expire);
 
-	if (!timer->expire)
-		list_insert(&timer->libinput->timer.list, &timer->link);
+	timer->stats->armed++;
+
+	if (!timer->expire) {
+		timer->expire = expire;
+		timer->deadline = expire + timer->slack;
+		timer_heap_insert(libinput, timer);
+	} else {
+		bool earlier = expire < timer->expire;
+
+		timer->expire = expire;
+		timer->deadline = expire + timer->slack;
+		if (earlier)
+			timer_heap_sift_up(libinput, timer->heap_index);
+		else
+			timer_heap_sift_down(libinput, timer->heap_index);
+	}
 
-	timer->expire = expire;
-	libinput_timer_arm_timer_fd(timer->libinput);
+	libinput_timer_arm_timer_fd(libinput);
 }
 
 void
@@ -119,44 +367,158 @@ libinput_timer_set(struct libinput_timer *timer, uint64_t expire)
 	libinput_timer_set_flags(timer, expire, TIMER_FLAG_NONE);
 }
 
+static void
+libinput_timer_disarm(struct libinput_timer *timer)
+{
+	timer_heap_remove(timer->libinput, timer);
+	timer->expire = 0;
+	libinput_timer_arm_timer_fd(timer->libinput);
+}
+
 void
 libinput_timer_cancel(struct libinput_timer *timer)
 {
 	if (!timer->expire)
 		return;
 
-	timer->expire = 0;
-	list_remove(&timer->link);
-	libinput_timer_arm_timer_fd(timer->libinput);
+	timer->stats->cancelled++;
+	libinput_timer_disarm(timer);
 }
 
 static void
-libinput_timer_handler(struct libinput *libinput , uint64_t now)
+libinput_timer_fire(struct libinput_timer *timer, uint64_t now)
+{
+	struct timer_stats *stats = timer->stats;
+
+	stats->fired++;
+	/* frame-due timers fire early, that counts as on time */
+	histogram_add(&stats->lateness,
+		      now > timer->expire ? now - timer->expire : 0);
+
+	tracepoint(timer_fire, stats->name, now,
+		   now > timer->expire ? now - timer->expire : 0);
+
+	/* Clear the timer before calling timer_func,
+	   as timer_func may re-arm it */
+	libinput_timer_disarm(timer);
+	timer->timer_func(now, timer->timer_func_data);
+}
+
+#define TIMER_BATCH_SIZE 32
+
+/* Collect the expired and frame-due timers into the batch. A subtree
+ * can be skipped when its root's deadline is beyond the horizon, none of
+ * its timers can have expired then. */
+static void
+timer_heap_collect_expired(struct libinput *libinput,
+			   size_t idx,
+			   uint64_t now,
+			   uint64_t frame_deadline,
+			   uint64_t horizon,
+			   struct libinput_timer **batch,
+			   size_t *nbatch)
 {
 	struct libinput_timer *timer;
 
-restart:
-	list_for_each(timer, &libinput->timer.list, link) {
-		if (timer->expire == 0)
-			continue;
-
-		if (timer->expire <= now) {
-			/* Clear the timer before calling timer_func,
-			   as timer_func may re-arm it */
-			libinput_timer_cancel(timer);
-			timer->timer_func(now, timer->timer_func_data);
-
-			/*
-			 * Restart the loop. We can't use
-			 * list_for_each_safe() here because that only
-			 * allows removing one (our) timer per timer_func.
-			 * But the timer func may trigger another unrelated
-			 * timer to be cancelled and removed, causing a
-			 * segfault.
-			 */
-			goto restart;
+	if (idx >= libinput->timer.heap_count || *nbatch >= TIMER_BATCH_SIZE)
+		return;
+
+	timer = libinput->timer.heap[idx];
+	if (timer->deadline > horizon)
+		return;
+
+	if (timer->expire <= now || timer_is_frame_due(timer, frame_deadline))
+		batch[(*nbatch)++] = timer;
+
+	timer_heap_collect_expired(libinput, 2 * idx + 1, now, frame_deadline,
+				   horizon, batch, nbatch);
+	timer_heap_collect_expired(libinput, 2 * idx + 2, now, frame_deadline,
+				   horizon, batch, nbatch);
+}
+
+static void
+libinput_timer_handler_batched(struct libinput *libinput,
+			       uint64_t now,
+			       uint64_t frame_deadline)
+{
+	struct libinput_timer *batch[TIMER_BATCH_SIZE];
+	size_t nbatch, i, j;
+	uint64_t horizon;
+
+	horizon = now + libinput->timer.max_slack;
+	if (frame_deadline)
+		horizon += libinput->timer.max_frame_slack;
+	if (horizon < now)
+		horizon = UINT64_MAX;
+
+	do {
+		nbatch = 0;
+		timer_heap_collect_expired(libinput, 0, now, frame_deadline,
+					   horizon, batch, &nbatch);
+
+		/* fire in order of expiry */
+		for (i = 1; i < nbatch; i++) {
+			struct libinput_timer *t = batch[i];
+
+			for (j = i; j > 0 && batch[j - 1]->expire > t->expire; j--)
+				batch[j] = batch[j - 1];
+			batch[j] = t;
+		}
+
+		for (i = 0; i < nbatch; i++) {
+			struct libinput_timer *timer = batch[i];
+
+			/* an earlier timer_func may have cancelled or
+			 * re-armed this one */
+			if (timer->expire == 0 ||
+			    (timer->expire > now &&
+			     !timer_is_frame_due(timer, frame_deadline)))
+				continue;
+
+			libinput_timer_fire(timer, now);
+		}
+
+		/* A timer re-armed by its timer_func may be frame-due
+		 * again, only fire it once early */
+		frame_deadline = 0;
+	} while (nbatch > 0);
+}
+
+static void
+libinput_timer_handler(struct libinput *libinput , uint64_t now)
+{
+	struct libinput_timer *timer;
+	enum libinput_profile_stage outer;
+	uint64_t frame_deadline = libinput->timer.frame_deadline;
+
+	outer = libinput_profile_enter(libinput, LIBINPUT_PROFILE_STAGE_TIMERS);
+	libinput->timer.in_handler = true;
+
+	/* Once the frame deadline is reached its frame-due timers fire,
+	 * the deadline is used up then */
+	if (frame_deadline != 0 && now >= frame_deadline)
+		libinput->timer.frame_deadline = 0;
+	else
+		frame_deadline = 0;
+
+	if (libinput->timer.max_slack > 0 || frame_deadline != 0) {
+		libinput_timer_handler_batched(libinput, now, frame_deadline);
+	} else {
+		/* timer_func may set or cancel any timer, including the
+		 * one that just expired, so always look at the current
+		 * heap top */
+		while (libinput->timer.heap_count > 0) {
+			timer = libinput->timer.heap[0];
+			if (timer->expire > now)
+				break;
+
+			libinput_timer_fire(timer, now);
 		}
 	}
+
+	libinput->timer.in_handler = false;
+	libinput_timer_arm_timer_fd(libinput);
+	libinput_profile_leave(libinput, outer);
 }
 
 static void
@@ -174,6 +536,10 @@ libinput_timer_dispatch(void *data)
 				 errno,
 				 strerror(errno));
 
+	/* The timerfd is one-shot, it's disarmed now */
+	libinput->timer.next_expiry = UINT64_MAX;
+	libinput->timer.wakeups++;
+
 	now = libinput_now(libinput);
 	if (now == 0)
 		return;
@@ -181,6 +547,18 @@ libinput_timer_dispatch(void *data)
 	libinput_timer_handler(libinput, now);
 }
 
+/* The context switched clocks, whatever the timerfd is programmed to is
+ * on the wrong one */
+void
+libinput_timer_clock_changed(struct libinput *libinput)
+{
+	struct itimerspec its = { { 0, 0 }, { 0, 0 } };
+
+	timerfd_settime(libinput->timer.fd, TFD_TIMER_ABSTIME, &its, NULL);
+	libinput->timer.next_expiry = UINT64_MAX;
+	libinput_timer_arm_timer_fd(libinput);
+}
+
 int
 libinput_timer_subsys_init(struct libinput *libinput)
 {
@@ -189,7 +567,12 @@ libinput_timer_subsys_init(struct libinput *libinput)
 	if (libinput->timer.fd < 0)
 		return -1;
 
-	list_init(&libinput->timer.list);
+	libinput->timer.heap = NULL;
+	libinput->timer.heap_count = 0;
+	libinput->timer.heap_size = 0;
+	libinput->timer.next_expiry = UINT64_MAX;
+	list_init(&libinput->timer.stats);
+	libinput->timer.nstats = 0;
 
 	libinput->timer.source = libinput_add_fd(libinput,
 						 libinput->timer.fd,
@@ -203,23 +586,45 @@ libinput_timer_subsys_init(struct libinput *libinput)
 	return 0;
 }
 
+size_t
+libinput_timer_subsys_memory_usage(struct libinput *libinput)
+{
+	struct timer_stats *stats;
+	size_t size;
+
+	size = libinput->timer.heap_size * sizeof(*libinput->timer.heap);
+
+	list_for_each(stats, &libinput->timer.stats, link)
+		size += sizeof(*stats) + strlen(stats->name) + 1;
+
+	return size;
+}
+
 void
 libinput_timer_subsys_destroy(struct libinput *libinput)
 {
+	struct timer_stats *stats, *tmp;
+
 #ifndef NDEBUG
-	if (!list_empty(&libinput->timer.list)) {
-		struct libinput_timer *t;
+	for (size_t i = 0; i < libinput->timer.heap_count; i++) {
+		char name[64];
 
-		list_for_each(t, &libinput->timer.list, link) {
-			log_bug_libinput(libinput,
-					 "timer: %s still present on shutdown\n",
-					 t->timer_name);
-		}
+		log_bug_libinput(libinput,
+				 "timer: %s still present on shutdown\n",
+				 timer_log_name(libinput->timer.heap[i],
+						name, sizeof(name)));
 	}
 #endif
 
 	/* All timer users should have destroyed their timers now */
-	assert(list_empty(&libinput->timer.list));
+	assert(libinput->timer.heap_count == 0);
+	mem_free(libinput->timer.heap);
+
+	list_for_each_safe(stats, tmp, &libinput->timer.stats, link) {
+		list_remove(&stats->link);
+		free(stats->name);
+		free(stats);
+	}
 
 	libinput_remove_source(libinput, libinput->timer.source);
 	close(libinput->timer.fd);
@@ -243,3 +648,120 @@ libinput_timer_flush(struct libinput *libinput, uint64_t now)
 
 	libinput_timer_handler(libinput, now);
 }
+
+LIBINPUT_EXPORT uint64_t
+libinput_get_next_timeout(struct libinput *libinput)
+{
+	uint64_t next = timer_next_fire_time(libinput);
+
+	return next == UINT64_MAX ? 0 : next;
+}
+
+LIBINPUT_EXPORT void
+libinput_set_frame_deadline(struct libinput *libinput, uint64_t deadline)
+{
+	libinput->timer.frame_deadline = deadline;
+
+	/* A later deadline only takes effect once the timerfd fired,
+	 * see libinput_timer_arm_timer_fd() */
+	libinput_timer_arm_timer_fd(libinput);
+}
+
+LIBINPUT_EXPORT void
+libinput_set_client_timers(struct libinput *libinput, int enable)
+{
+	if (libinput->timer.client_managed == !!enable)
+		return;
+
+	libinput->timer.client_managed = !!enable;
+
+	/* Disarms the timerfd, or programs it for the pending timers */
+	libinput_timer_clock_changed(libinput);
+}
+
+struct libinput_timer_stats {
+	unsigned int count;
+	struct {
+		char *name;
+		uint64_t values[LIBINPUT_TIMER_STAT_LATENESS_MAX + 1];
+	} *timers;
+};
+
+LIBINPUT_EXPORT struct libinput_timer_stats *
+libinput_get_timer_stats(struct libinput *libinput)
+{
+	struct libinput_timer_stats *snapshot;
+	struct timer_stats *stats;
+	unsigned int idx = 0;
+
+	snapshot = zalloc(sizeof(*snapshot));
+	snapshot->count = libinput->timer.nstats;
+	snapshot->timers = zalloc(max(snapshot->count, 1U) *
+				  sizeof(*snapshot->timers));
+
+	list_for_each(stats, &libinput->timer.stats, link) {
+		uint64_t *values = snapshot->timers[idx].values;
+
+		snapshot->timers[idx].name = safe_strdup(stats->name);
+		values[LIBINPUT_TIMER_STAT_ARMED] = stats->armed;
+		values[LIBINPUT_TIMER_STAT_FIRED] = stats->fired;
+		values[LIBINPUT_TIMER_STAT_CANCELLED] = stats->cancelled;
+		values[LIBINPUT_TIMER_STAT_LATENESS_P50] =
+			histogram_percentile(&stats->lateness, 50);
+		values[LIBINPUT_TIMER_STAT_LATENESS_P99] =
+			histogram_percentile(&stats->lateness, 99);
+		values[LIBINPUT_TIMER_STAT_LATENESS_MAX] = stats->lateness.max;
+		idx++;
+	}
+
+	return snapshot;
+}
+
+LIBINPUT_EXPORT unsigned int
+libinput_timer_stats_get_count(struct libinput_timer_stats *stats)
+{
+	return stats->count;
+}
+
+LIBINPUT_EXPORT const char *
+libinput_timer_stats_get_name(struct libinput_timer_stats *stats,
+			      unsigned int index)
+{
+	if (index >= stats->count)
+		return NULL;
+
+	return stats->timers[index].name;
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_timer_stats_get_value(struct libinput_timer_stats *stats,
+			       unsigned int index,
+			       enum libinput_timer_stat stat)
+{
+	if (index >= stats->count)
+		return 0;
+
+	switch (stat) {
+	case LIBINPUT_TIMER_STAT_ARMED:
+	case LIBINPUT_TIMER_STAT_FIRED:
+	case LIBINPUT_TIMER_STAT_CANCELLED:
+	case LIBINPUT_TIMER_STAT_LATENESS_P50:
+	case LIBINPUT_TIMER_STAT_LATENESS_P99:
+	case LIBINPUT_TIMER_STAT_LATENESS_MAX:
+		return stats->timers[index].values[stat];
+	}
+
+	return 0;
+}
+
+LIBINPUT_EXPORT void
+libinput_timer_stats_destroy(struct libinput_timer_stats *stats)
+{
+	if (!stats)
+		return;
+
+	for (unsigned int i = 0; i < stats->count; i++)
+		free(stats->timers[i].name);
+	free(stats->timers);
+	free(stats);
+}
@@ -30,13 +30,27 @@
 
 struct libinput;
 
+/* Usage statistics, shared by all timers with the same name */
+struct timer_stats {
+	struct list link;
+	char *name;
+	uint64_t armed;
+	uint64_t fired;
+	uint64_t cancelled; /* cancelled before they fired */
+	struct histogram lateness; /* fire time - expiry in us */
+};
+
 struct libinput_timer {
 	struct libinput *libinput;
-	char *timer_name;
-	struct list link;
+	uint32_t heap_index; /* only valid while armed */
+	int32_t index; /* e.g. the touch for per-touch timers, or -1 */
 	uint64_t expire; /* in absolute us CLOCK_MONOTONIC */
+	uint64_t slack; /* in us, how late the timer may fire */
+	uint64_t deadline; /* expire + slack */
+	uint64_t frame_slack; /* in us, how early it may fire for a frame */
 	void (*timer_func)(uint64_t now, void *timer_func_data);
 	void *timer_func_data;
+	struct timer_stats *stats; /* has the timer's name */
 };
 
 void
@@ -48,6 +62,37 @@ libinput_timer_init(struct libinput_timer *timer, struct libinput *libinput,
 void
 libinput_timer_destroy(struct libinput_timer *timer);
 
+/* A timer in zeroed memory is uninitialized but may be cancelled and
+ * destroyed, so timers that are rarely used can be initialized the
+ * first time they are armed */
+static inline bool
+libinput_timer_is_initialized(struct libinput_timer *timer)
+{
+	return timer->libinput != NULL;
+}
+
+/**
+ * Set the index of a timer that exists once per touch or similar. The
+ * index is only used in log messages, all timers with the same name
+ * share their statistics.
+ */
+void
+libinput_timer_set_index(struct libinput_timer *timer, int index);
+
+/* Allow the timer to fire up to slack us late so its expiry can be
+ * batched with other timers into a single wakeup. Must not be called
+ * while the timer is armed. */
+void
+libinput_timer_set_slack(struct libinput_timer *timer, uint64_t slack);
+
+/* Allow the timer to fire up to frame_slack us early so the events it
+ * sends make the caller's next frame, see libinput_set_frame_deadline().
+ * Only for timers where firing a few ms early is indistinguishable for
+ * the user, e.g. the end of a tap. */
+void
+libinput_timer_set_frame_slack(struct libinput_timer *timer,
+			       uint64_t frame_slack);
+
 /* Set timer expire time, in absolute us CLOCK_MONOTONIC */
 void
 libinput_timer_set(struct libinput_timer *timer, uint64_t expire);
@@ -68,9 +113,16 @@ libinput_timer_cancel(struct libinput_timer *timer);
 int
 libinput_timer_subsys_init(struct libinput *libinput);
 
+void
+libinput_timer_clock_changed(struct libinput *libinput);
+
 void
 libinput_timer_subsys_destroy(struct libinput *libinput);
 
+/* Bytes allocated for the timer heap and the timer statistics */
+size_t
+libinput_timer_subsys_memory_usage(struct libinput *libinput);
+
 void
 libinput_timer_flush(struct libinput *libinput, uint64_t now);
 
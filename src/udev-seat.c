@@ -24,6 +24,7 @@
 
 #include "config.h"
 
+#include <fcntl.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -42,57 +43,567 @@ static struct udev_seat *
 udev_seat_get_named(struct udev_input *input, const char *seat_name);
 
 
+#define SEAT_INDEX_MIN_SIZE 16
+
+static char seat_index_tombstone;
+#define SEAT_INDEX_TOMBSTONE ((struct evdev_device *)&seat_index_tombstone)
+
+static inline size_t
+seat_index_slot(const struct udev_seat *seat, const char *syspath)
+{
+	/* FNV-1a */
+	uint32_t hash = 2166136261u;
+
+	for (const char *c = syspath; *c; c++) {
+		hash ^= (unsigned char)*c;
+		hash *= 16777619u;
+	}
+
+	return hash & (seat->index.size - 1);
+}
+
+static inline const char *
+evdev_device_syspath(struct evdev_device *device)
+{
+	return udev_device_get_syspath(device->udev_device);
+}
+
+static void
+seat_index_place(struct udev_seat *seat, struct evdev_device *device)
+{
+	size_t mask = seat->index.size - 1;
+	size_t idx = seat_index_slot(seat, evdev_device_syspath(device));
+
+	while (seat->index.slots[idx] &&
+	       seat->index.slots[idx] != SEAT_INDEX_TOMBSTONE)
+		idx = (idx + 1) & mask;
+
+	if (!seat->index.slots[idx])
+		seat->index.used++;
+	seat->index.slots[idx] = device;
+	seat->index.count++;
+}
+
+static void
+seat_index_resize(struct udev_seat *seat, size_t size)
+{
+	struct evdev_device **old = seat->index.slots;
+	size_t old_size = seat->index.size;
+
+	seat->index.slots = zalloc(size * sizeof(*old));
+	seat->index.size = size;
+	seat->index.count = 0;
+	seat->index.used = 0;
+
+	for (size_t i = 0; i < old_size; i++) {
+		if (old[i] && old[i] != SEAT_INDEX_TOMBSTONE)
+			seat_index_place(seat, old[i]);
+	}
+
+	free(old);
+}
+
+static struct evdev_device *
+seat_index_lookup(struct udev_seat *seat, const char *syspath)
+{
+	size_t mask, idx;
+	struct evdev_device *d;
+
+	if (seat->index.size == 0 || !syspath)
+		return NULL;
+
+	mask = seat->index.size - 1;
+	idx = seat_index_slot(seat, syspath);
+
+	while ((d = seat->index.slots[idx])) {
+		if (d != SEAT_INDEX_TOMBSTONE &&
+		    streq(evdev_device_syspath(d), syspath))
+			return d;
+		idx = (idx + 1) & mask;
+	}
+
+	return NULL;
+}
+
+static void
+seat_index_insert(struct udev_seat *seat, struct evdev_device *device)
+{
+	size_t size = seat->index.size;
+
+	if (!evdev_device_syspath(device))
+		return;
+
+	/* Keep the load including tombstones below 3/4, grow only if the
+	 * live entries need it, otherwise rehashing just drops the
+	 * tombstones */
+	if ((seat->index.used + 1) * 4 > size * 3) {
+		if ((seat->index.count + 1) * 2 > size)
+			size = max(size * 2, (size_t)SEAT_INDEX_MIN_SIZE);
+		seat_index_resize(seat, size);
+	}
+
+	seat_index_place(seat, device);
+}
+
+static void
+seat_index_remove(struct udev_seat *seat, struct evdev_device *device)
+{
+	size_t mask, idx;
+	struct evdev_device *d;
+
+	if (seat->index.size == 0 || !evdev_device_syspath(device))
+		return;
+
+	mask = seat->index.size - 1;
+	idx = seat_index_slot(seat, evdev_device_syspath(device));
+
+	while ((d = seat->index.slots[idx])) {
+		if (d == device) {
+			seat->index.slots[idx] = SEAT_INDEX_TOMBSTONE;
+			seat->index.count--;
+			return;
+		}
+		idx = (idx + 1) & mask;
+	}
+}
+
+static void
+udev_seat_remove_device(struct udev_seat *seat, struct evdev_device *device)
+{
+	seat_index_remove(seat, device);
+	evdev_device_remove(device);
+}
+
 static inline bool
 filter_duplicates(struct udev_seat *udev_seat,
 		  struct udev_device *udev_device)
 {
-	struct libinput_device *device;
-	const char *new_syspath = udev_device_get_syspath(udev_device);
-	bool ignore_device = false;
-
 	if (!udev_seat)
 		return false;
 
-	list_for_each(device, &udev_seat->base.devices_list, link) {
-		const char *syspath;
-		struct udev_device *ud;
+	return seat_index_lookup(udev_seat,
+				 udev_device_get_syspath(udev_device)) != NULL;
+}
+
+static inline bool
+device_is_for_seat(struct udev_device *udev_device,
+		   struct udev_input *input)
+{
+	const char *device_seat;
+
+	device_seat = udev_device_get_property_value(udev_device, "ID_SEAT");
+	if (!device_seat)
+		device_seat = default_seat;
 
-		ud = libinput_device_get_udev_device(device);
-		if (!ud)
+	if (!streq(device_seat, input->seat_id))
+		return false;
+
+	return !ignore_litest_test_suite_device(udev_device);
+}
+
+struct udev_open_request {
+	struct libinput_open_request base;
+	struct list link; /* udev_input.open_requests */
+	struct udev_input *input;
+	struct udev_device *udev_device;
+	char *seat_name;
+};
+
+static int
+device_added(struct udev_device *udev_device,
+	     struct udev_input *input,
+	     const char *seat_name,
+	     struct evdev_probe *probe);
+
+static void
+udev_open_request_release(struct udev_open_request *request)
+{
+	list_remove(&request->link);
+	udev_device_unref(request->udev_device);
+	free(request->seat_name);
+}
+
+static void
+udev_open_request_complete(struct libinput_open_request *base, int fd)
+{
+	struct udev_open_request *request = (struct udev_open_request*)base;
+	struct udev_input *input = request->input;
+	struct evdev_probe probe = {
+		.udev_device = request->udev_device,
+		.fd = fd,
+		.evdev = NULL,
+	};
+
+	device_added(request->udev_device, input, request->seat_name, &probe);
+	evdev_probe_release(&input->base, &probe);
+
+	udev_open_request_release(request);
+}
+
+static void
+udev_open_request_cancel(struct udev_open_request *request)
+{
+	udev_open_request_release(request);
+	libinput_open_request_cancel(&request->base);
+}
+
+static void
+udev_input_cancel_open_requests(struct udev_input *input,
+				const char *syspath)
+{
+	struct udev_open_request *request, *tmp;
+
+	list_for_each_safe(request, tmp, &input->open_requests, link) {
+		if (syspath &&
+		    !streq(syspath, udev_device_get_syspath(request->udev_device)))
 			continue;
 
-		syspath = udev_device_get_syspath(ud);
-		if (syspath && new_syspath && streq(syspath, new_syspath))
-			ignore_device = true;
-		udev_device_unref(ud);
+		udev_open_request_cancel(request);
+	}
+}
+
+static bool
+udev_input_has_open_request(struct udev_input *input,
+			    struct udev_device *udev_device)
+{
+	struct udev_open_request *request;
+	const char *syspath = udev_device_get_syspath(udev_device);
+
+	list_for_each(request, &input->open_requests, link) {
+		if (streq(syspath, udev_device_get_syspath(request->udev_device)))
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Open the device with the caller's asynchronous open function, if any.
+ * device_added() is called again once the fd is available.
+ *
+ * @return true if the request was handed to the caller
+ */
+static bool
+udev_device_open_async(struct udev_input *input,
+		       struct udev_device *udev_device,
+		       const char *seat_name)
+{
+	struct udev_open_request *request;
+	const char *devnode = udev_device_get_devnode(udev_device);
+
+	/* evdev_device_create() logs and skips those */
+	if (!input->base.open_async ||
+	    !devnode ||
+	    udev_device_should_be_ignored(udev_device))
+		return false;
+
+	/* Same race as in filter_duplicates(), the device is already
+	 * on its way */
+	if (udev_input_has_open_request(input, udev_device))
+		return true;
+
+	request = zalloc(sizeof(*request));
+	request->input = input;
+	request->udev_device = udev_device_ref(udev_device);
+	request->seat_name = seat_name ? safe_strdup(seat_name) : NULL;
+	/* The caller may complete the request before
+	 * libinput_open_async() returns */
+	list_insert(&input->open_requests, &request->link);
+
+	if (!libinput_open_async(&input->base,
+				 &request->base,
+				 devnode,
+				 O_RDWR | O_NONBLOCK | O_CLOEXEC,
+				 udev_open_request_complete)) {
+		udev_open_request_release(request);
+		free(request);
+		return false;
+	}
+
+	return true;
+}
+
+/* One physical device as seen by the hotplug damping. It outlives the
+ * evdev device by one damping window so a flapping device is recognized
+ * when it comes back */
+struct udev_hotplug_device {
+	struct list link; /* udev_input.damping.devices */
+	char *identity;
+	char *syspath; /* of the current or most recent udev device */
+	uint64_t added;
+	uint64_t removed; /* 0 while the device is present */
+	bool flapping;
+	struct udev_device *pending; /* held back add, or NULL */
+	uint64_t deadline; /* for the pending add */
+};
+
+static const char *
+udev_device_find_property(struct udev_device *udev_device, const char *prop)
+{
+	const char *value;
+
+	/* NAME, PHYS and PRODUCT are on the parent input device */
+	do {
+		value = udev_device_get_property_value(udev_device, prop);
+		udev_device = udev_device_get_parent(udev_device);
+	} while (!value && udev_device);
+
+	return value;
+}
+
+/* The syspath changes on every plug, this doesn't */
+static char *
+udev_hotplug_identity(struct udev_device *udev_device)
+{
+	const char *product, *name, *phys;
+	char *identity;
+
+	product = udev_device_find_property(udev_device, "PRODUCT");
+	name = udev_device_find_property(udev_device, "NAME");
+	phys = udev_device_find_property(udev_device, "PHYS");
+
+	xasprintf(&identity,
+		  "%s:%s:%s",
+		  product ? product : "",
+		  name ? name : "",
+		  phys ? phys : "");
+
+	return identity;
+}
+
+static void
+udev_hotplug_device_destroy(struct udev_hotplug_device *dev)
+{
+	list_remove(&dev->link);
+	if (dev->pending)
+		udev_device_unref(dev->pending);
+	free(dev->identity);
+	free(dev->syspath);
+	free(dev);
+}
+
+static struct udev_hotplug_device *
+udev_hotplug_find_syspath(struct udev_input *input, const char *syspath)
+{
+	struct udev_hotplug_device *dev;
+
+	if (!syspath)
+		return NULL;
+
+	list_for_each(dev, &input->damping.devices, link) {
+		if (dev->syspath && streq(dev->syspath, syspath))
+			return dev;
+	}
+
+	return NULL;
+}
+
+static struct udev_hotplug_device *
+udev_hotplug_find_identity(struct udev_input *input, const char *identity)
+{
+	struct udev_hotplug_device *dev;
 
-		if (ignore_device)
-			break;
+	list_for_each(dev, &input->damping.devices, link) {
+		if (streq(dev->identity, identity))
+			return dev;
 	}
 
-	return ignore_device;
+	return NULL;
+}
+
+/* Devices gone for longer than the window are treated as new when they
+ * come back */
+static void
+udev_hotplug_expire(struct udev_input *input, uint64_t now)
+{
+	struct udev_hotplug_device *dev, *tmp;
+
+	list_for_each_safe(dev, tmp, &input->damping.devices, link) {
+		if (!dev->pending && dev->removed &&
+		    now - dev->removed > input->damping.window)
+			udev_hotplug_device_destroy(dev);
+	}
+}
+
+static void
+udev_hotplug_arm(struct udev_input *input)
+{
+	struct udev_hotplug_device *dev;
+	uint64_t deadline = 0;
+
+	list_for_each(dev, &input->damping.devices, link) {
+		if (dev->pending && (!deadline || dev->deadline < deadline))
+			deadline = dev->deadline;
+	}
+
+	if (deadline)
+		libinput_timer_set(&input->damping.timer, deadline);
+	else
+		libinput_timer_cancel(&input->damping.timer);
+}
+
+/**
+ * Hold back the add of a device that was flapping, taking over the
+ * udev_device reference.
+ *
+ * @return true if the add was held back
+ */
+static bool
+udev_hotplug_defer(struct udev_input *input, struct udev_device *udev_device)
+{
+	struct libinput *libinput = &input->base;
+	struct udev_hotplug_device *dev;
+	uint64_t now;
+	char *identity;
+
+	if (input->damping.window == 0)
+		return false;
+
+	now = libinput_now(libinput);
+	udev_hotplug_expire(input, now);
+
+	identity = udev_hotplug_identity(udev_device);
+	dev = udev_hotplug_find_identity(input, identity);
+	free(identity);
+
+	if (!dev || !dev->flapping || dev->removed == 0)
+		return false;
+
+	log_debug(libinput,
+		  "%-7s - holding back flapping input device '%s'\n",
+		  udev_device_get_sysname(udev_device),
+		  udev_device_get_devnode(udev_device));
+
+	if (dev->pending)
+		udev_device_unref(dev->pending);
+	dev->pending = udev_device;
+	dev->deadline = now + input->damping.window;
+	free(dev->syspath);
+	dev->syspath = safe_strdup(udev_device_get_syspath(udev_device));
+	libinput->hotplug_deferred++;
+	udev_hotplug_arm(input);
+
+	return true;
+}
+
+static void
+udev_hotplug_added(struct udev_input *input, struct udev_device *udev_device)
+{
+	struct udev_hotplug_device *dev;
+	char *identity;
+
+	if (input->damping.window == 0)
+		return;
+
+	identity = udev_hotplug_identity(udev_device);
+	dev = udev_hotplug_find_identity(input, identity);
+	if (dev) {
+		free(identity);
+	} else {
+		dev = zalloc(sizeof(*dev));
+		dev->identity = identity;
+		list_insert(&input->damping.devices, &dev->link);
+	}
+
+	free(dev->syspath);
+	dev->syspath = safe_strdup(udev_device_get_syspath(udev_device));
+	dev->added = libinput_now(&input->base);
+	dev->removed = 0;
+}
+
+static void
+udev_hotplug_removed(struct udev_input *input, struct udev_device *udev_device)
+{
+	struct libinput *libinput = &input->base;
+	struct udev_hotplug_device *dev;
+	uint64_t now;
+
+	if (input->damping.window == 0)
+		return;
+
+	dev = udev_hotplug_find_syspath(input,
+					udev_device_get_syspath(udev_device));
+	if (!dev)
+		return;
+
+	now = libinput_now(libinput);
+
+	if (dev->pending) {
+		udev_device_unref(dev->pending);
+		dev->pending = NULL;
+		dev->flapping = true;
+		dev->removed = now;
+		libinput->hotplug_suppressed++;
+		udev_hotplug_arm(input);
+		return;
+	}
+
+	if (dev->removed)
+		return;
+
+	dev->removed = now;
+	dev->flapping = now - dev->added < input->damping.window;
+	if (dev->flapping)
+		libinput->hotplug_flaps++;
+}
+
+static void
+udev_hotplug_flush(struct udev_input *input, uint64_t now, bool all)
+{
+	struct udev_hotplug_device *dev, *tmp;
+
+	list_for_each_safe(dev, tmp, &input->damping.devices, link) {
+		struct udev_device *udev_device = dev->pending;
+
+		if (!udev_device || (!all && dev->deadline > now))
+			continue;
+
+		dev->pending = NULL;
+		device_added(udev_device, input, NULL, NULL);
+		udev_device_unref(udev_device);
+	}
+
+	udev_hotplug_arm(input);
+}
+
+static void
+udev_hotplug_timeout(uint64_t now, void *data)
+{
+	struct udev_input *input = data;
+
+	udev_hotplug_flush(input, now, false);
+}
+
+/* Pending adds are dropped, a resume enumerates the devices again */
+static void
+udev_hotplug_reset(struct udev_input *input)
+{
+	struct udev_hotplug_device *dev, *tmp;
+
+	list_for_each_safe(dev, tmp, &input->damping.devices, link)
+		udev_hotplug_device_destroy(dev);
+
+	libinput_timer_cancel(&input->damping.timer);
 }
 
 static int
 device_added(struct udev_device *udev_device,
 	     struct udev_input *input,
-	     const char *seat_name)
+	     const char *seat_name,
+	     struct evdev_probe *probe)
 {
 	struct evdev_device *device;
 	const char *devnode, *sysname;
 	const char *device_seat, *output_name;
 	struct udev_seat *seat;
 
+	if (!device_is_for_seat(udev_device, input))
+		return 0;
+
 	device_seat = udev_device_get_property_value(udev_device, "ID_SEAT");
 	if (!device_seat)
 		device_seat = default_seat;
 
-	if (!streq(device_seat, input->seat_id))
-		return 0;
-
-	if (ignore_litest_test_suite_device(udev_device))
-		return 0;
-
 	devnode = udev_device_get_devnode(udev_device);
 	sysname = udev_device_get_sysname(udev_device);
 
@@ -111,6 +622,9 @@ device_added(struct udev_device *udev_device,
 	if (filter_duplicates(seat, udev_device))
 		return 0;
 
+	if (!probe && udev_device_open_async(input, udev_device, seat_name))
+		return 0;
+
 	if (seat)
 		libinput_seat_ref(&seat->base);
 	else {
@@ -119,7 +633,7 @@ device_added(struct udev_device *udev_device,
 			return -1;
 	}
 
-	device = evdev_device_create(&seat->base, udev_device);
+	device = evdev_device_create(&seat->base, udev_device, probe);
 	libinput_seat_unref(&seat->base);
 
 	if (device == EVDEV_UNHANDLED_DEVICE) {
@@ -136,6 +650,9 @@ device_added(struct udev_device *udev_device,
 		return 0;
 	}
 
+	seat_index_insert(seat, device);
+	udev_hotplug_added(input, udev_device);
+
 	evdev_read_calibration_prop(device);
 
 	output_name = udev_device_get_property_value(udev_device, "WL_OUTPUT");
@@ -147,23 +664,64 @@ device_added(struct udev_device *udev_device,
 static void
 device_removed(struct udev_device *udev_device, struct udev_input *input)
 {
-	struct evdev_device *device, *next;
-	struct udev_seat *seat;
+	struct evdev_device *device;
+	struct udev_seat *seat, *tmp;
 	const char *syspath;
 
 	syspath = udev_device_get_syspath(udev_device);
-	list_for_each(seat, &input->base.seat_list, base.link) {
-		list_for_each_safe(device, next,
-				   &seat->base.devices_list, base.link) {
-			if (streq(syspath,
-				  udev_device_get_syspath(device->udev_device))) {
-				evdev_device_remove(device);
-				break;
-			}
-		}
+	udev_input_cancel_open_requests(input, syspath);
+	udev_hotplug_removed(input, udev_device);
+	if (input->base.replug.timeout)
+		quirks_cache_retire(input->base.quirks, udev_device);
+	else
+		quirks_cache_forget(input->base.quirks, udev_device);
+
+	list_for_each_safe(seat, tmp, &input->base.seat_list, base.link) {
+		device = seat_index_lookup(seat, syspath);
+		if (device)
+			udev_seat_remove_device(seat, device);
 	}
 }
 
+/**
+ * Add the devices in the order given, taking over the udev_device
+ * references in the probes.
+ *
+ * @return 0 on success or -1 if any device could not be added
+ */
+static int
+udev_input_add_probed_devices(struct udev_input *input,
+			      struct evdev_probe *probes,
+			      size_t nprobes)
+{
+	int rc = 0;
+
+	/* Open all devices first so the slow parts of the device setup can
+	 * happen in parallel, then add them in order. With an
+	 * asynchronous open function, device_added() hands each device to
+	 * the caller instead.
+	 */
+	if (!input->base.open_async)
+		evdev_probe_devices(&input->base, probes, nprobes);
+
+	for (size_t i = 0; i < nprobes; i++) {
+		struct evdev_probe *probe = input->base.open_async ?
+					    NULL : &probes[i];
+
+		if (device_added(probes[i].udev_device,
+				 input,
+				 NULL,
+				 probe) < 0)
+			rc = -1;
+
+		if (probe)
+			evdev_probe_release(&input->base, probe);
+		udev_device_unref(probes[i].udev_device);
+	}
+
+	return rc;
+}
+
 static int
 udev_input_add_devices(struct udev_input *input, struct udev *udev)
 {
@@ -171,6 +729,10 @@ udev_input_add_devices(struct udev_input *input, struct udev *udev)
 	struct udev_list_entry *entry;
 	struct udev_device *device;
 	const char *path, *sysname;
+	struct evdev_probe *probes = NULL;
+	size_t nprobes = 0;
+	int rc = 0;
+	uint64_t start = libinput_now_fresh(&input->base);
 
 	e = udev_enumerate_new(udev);
 	udev_enumerate_add_match_subsystem(e, "input");
@@ -198,17 +760,74 @@ udev_input_add_devices(struct udev_input *input, struct udev *udev)
 			continue;
 		}
 
-		if (device_added(device, input, NULL) < 0) {
+		if (!device_is_for_seat(device, input)) {
 			udev_device_unref(device);
-			udev_enumerate_unref(e);
-			return -1;
+			continue;
 		}
 
-		udev_device_unref(device);
+		/* Devices still around after a resume reuse their quirks
+		 * even if opened asynchronously */
+		quirks_cache_keep(input->base.quirks, device);
+
+		probes = realloc(probes, (nprobes + 1) * sizeof(*probes));
+		if (!probes)
+			abort();
+		probes[nprobes++].udev_device = device;
 	}
 	udev_enumerate_unref(e);
 
-	return 0;
+	/* Anything not enumerated went away while we were suspended */
+	quirks_cache_expire(input->base.quirks);
+
+	libinput_record_startup_time(&input->base,
+				     NULL,
+				     LIBINPUT_STARTUP_PHASE_ENUMERATE,
+				     libinput_now_fresh(&input->base) - start);
+
+	rc = udev_input_add_probed_devices(input, probes, nprobes);
+	free(probes);
+
+	return rc;
+}
+
+/* Upper limit of monitor events handled per wakeup, anything beyond
+ * that is handled on the next one */
+#define UDEV_HOTPLUG_MAX_EVENTS 128
+
+struct udev_hotplug_event {
+	struct udev_device *udev_device;
+	bool added;
+};
+
+/**
+ * Drop the pending add event for a device that is removed again within
+ * the same batch, the device never shows up at all.
+ *
+ * @return true if the remove event cancelled an add event
+ */
+static bool
+udev_hotplug_cancel_add(struct udev_hotplug_event *events,
+			size_t nevents,
+			struct udev_device *udev_device)
+{
+	const char *syspath = udev_device_get_syspath(udev_device);
+
+	for (size_t i = nevents; i > 0; i--) {
+		struct udev_hotplug_event *ev = &events[i - 1];
+
+		if (!ev->udev_device ||
+		    !streq(syspath, udev_device_get_syspath(ev->udev_device)))
+			continue;
+
+		if (!ev->added)
+			return false;
+
+		udev_device_unref(ev->udev_device);
+		ev->udev_device = NULL;
+		return true;
+	}
+
+	return false;
 }
 
 static void
@@ -216,26 +835,72 @@ evdev_udev_handler(void *data)
 {
 	struct udev_input *input = data;
 	struct udev_device *udev_device;
+	struct udev_hotplug_event events[UDEV_HOTPLUG_MAX_EVENTS];
+	struct evdev_probe probes[UDEV_HOTPLUG_MAX_EVENTS];
+	size_t nevents = 0,
+	       nprobes = 0;
 	const char *action;
 
-	udev_device = udev_monitor_receive_device(input->udev_monitor);
-	if (!udev_device)
-		return;
+	/* Hub re-enumeration and docks send dozens of events at once,
+	 * drain them all and collapse the devices that come and go within
+	 * the batch */
+	while (nevents < ARRAY_LENGTH(events) &&
+	       (udev_device = udev_monitor_receive_device(input->udev_monitor))) {
+		action = udev_device_get_action(udev_device);
+		if (!action ||
+		    strncmp("event", udev_device_get_sysname(udev_device), 5) != 0) {
+			udev_device_unref(udev_device);
+			continue;
+		}
 
-	action = udev_device_get_action(udev_device);
-	if (!action)
-		goto out;
+		if (streq(action, "add")) {
+			events[nevents].udev_device = udev_device;
+			events[nevents].added = true;
+			nevents++;
+		} else if (streq(action, "remove")) {
+			if (udev_hotplug_cancel_add(events, nevents, udev_device)) {
+				input->base.hotplug_suppressed++;
+				udev_device_unref(udev_device);
+				continue;
+			}
+			events[nevents].udev_device = udev_device;
+			events[nevents].added = false;
+			nevents++;
+		} else {
+			udev_device_unref(udev_device);
+		}
+	}
 
-	if (strncmp("event", udev_device_get_sysname(udev_device), 5) != 0)
-		goto out;
+	/* Whatever remains for the same syspath is a remove followed by an
+	 * add, so removing first preserves the order per device */
+	for (size_t i = 0; i < nevents; i++) {
+		struct udev_hotplug_event *ev = &events[i];
 
-	if (streq(action, "add"))
-		device_added(udev_device, input, NULL);
-	else if (streq(action, "remove"))
-		device_removed(udev_device, input);
+		if (!ev->udev_device || ev->added)
+			continue;
 
-out:
-	udev_device_unref(udev_device);
+		device_removed(ev->udev_device, input);
+		udev_device_unref(ev->udev_device);
+	}
+
+	for (size_t i = 0; i < nevents; i++) {
+		struct udev_hotplug_event *ev = &events[i];
+
+		if (!ev->udev_device || !ev->added)
+			continue;
+
+		if (!device_is_for_seat(ev->udev_device, input)) {
+			udev_device_unref(ev->udev_device);
+			continue;
+		}
+
+		if (udev_hotplug_defer(input, ev->udev_device))
+			continue;
+
+		probes[nprobes++].udev_device = ev->udev_device;
+	}
+
+	udev_input_add_probed_devices(input, probes, nprobes);
 }
 
 static void
@@ -248,7 +913,7 @@ udev_input_remove_devices(struct udev_input *input)
 		libinput_seat_ref(&seat->base);
 		list_for_each_safe(device, next,
 				   &seat->base.devices_list, base.link) {
-			evdev_device_remove(device);
+			udev_seat_remove_device(seat, device);
 		}
 		libinput_seat_unref(&seat->base);
 	}
@@ -259,6 +924,9 @@ udev_input_disable(struct libinput *libinput)
 {
 	struct udev_input *input = (struct udev_input*)libinput;
 
+	udev_input_cancel_open_requests(input, NULL);
+	udev_hotplug_reset(input);
+
 	if (!input->udev_monitor)
 		return;
 
@@ -324,6 +992,9 @@ udev_input_destroy(struct libinput *input)
 	if (input == NULL)
 		return;
 
+	udev_input_cancel_open_requests(udev_input, NULL);
+	udev_hotplug_reset(udev_input);
+	libinput_timer_destroy(&udev_input->damping.timer);
 	udev_unref(udev_input->udev);
 	free(udev_input->seat_id);
 }
@@ -332,6 +1003,7 @@ static void
 udev_seat_destroy(struct libinput_seat *seat)
 {
 	struct udev_seat *useat = (struct udev_seat*)seat;
+	free(useat->index.slots);
 	free(useat);
 }
 
@@ -376,7 +1048,7 @@ udev_device_change_seat(struct libinput_device *device,
 
 	udev_device_ref(udev_device);
 	device_removed(udev_device, input);
-	rc = device_added(udev_device, input, seat_name);
+	rc = device_added(udev_device, input, seat_name, NULL);
 	udev_device_unref(udev_device);
 
 	return rc;
@@ -400,6 +1072,8 @@ libinput_udev_create_context(const struct libinput_interface *interface,
 		return NULL;
 
 	input = zalloc(sizeof *input);
+	list_init(&input->open_requests);
+	list_init(&input->damping.devices);
 
 	if (libinput_init(&input->base, interface,
 			  &interface_backend, user_data) != 0) {
@@ -409,6 +1083,11 @@ libinput_udev_create_context(const struct libinput_interface *interface,
 	}
 
 	input->udev = udev_ref(udev);
+	libinput_timer_init(&input->damping.timer,
+			    &input->base,
+			    "hotplug-damping",
+			    udev_hotplug_timeout,
+			    input);
 
 	return &input->base;
 }
@@ -450,3 +1129,23 @@ libinput_udev_assign_seat(struct libinput *libinput,
 
 	return 0;
 }
+
+LIBINPUT_EXPORT int
+libinput_udev_set_hotplug_damping(struct libinput *libinput,
+				  uint32_t window_ms)
+{
+	struct udev_input *input = (struct udev_input*)libinput;
+
+	if (libinput->interface_backend != &interface_backend) {
+		log_bug_client(libinput, "Mismatching backends.\n");
+		return -1;
+	}
+
+	input->damping.window = ms2us(window_ms);
+	if (window_ms == 0) {
+		udev_hotplug_flush(input, 0, true);
+		udev_hotplug_reset(input);
+	}
+
+	return 0;
+}
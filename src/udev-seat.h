@@ -28,9 +28,21 @@
 
 #include <libudev.h>
 #include "libinput-private.h"
+#include "timer.h"
+
+struct evdev_device;
 
 struct udev_seat {
 	struct libinput_seat base;
+
+	/* Open-addressing index of the devices in base.devices_list,
+	 * keyed by syspath */
+	struct {
+		struct evdev_device **slots;
+		size_t size;		/* power of two, or 0 */
+		size_t count;		/* live entries */
+		size_t used;		/* live entries and tombstones */
+	} index;
 };
 
 struct udev_input {
@@ -39,6 +51,15 @@ struct udev_input {
 	struct udev_monitor *udev_monitor;
 	struct libinput_source *udev_monitor_source;
 	char *seat_id;
+
+	struct list open_requests; /* struct udev_open_request */
+
+	/* see libinput_udev_set_hotplug_damping() */
+	struct {
+		uint64_t window; /* us, 0 if disabled */
+		struct list devices; /* struct udev_hotplug_device */
+		struct libinput_timer timer;
+	} damping;
 };
 
 #endif
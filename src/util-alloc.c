@@ -0,0 +1,104 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "util-alloc.h"
+
+static struct {
+	mem_alloc_func_t alloc;
+	mem_realloc_func_t realloc;
+	mem_free_func_t free;
+	void *user_data;
+} allocator;
+
+void
+mem_set_allocator(mem_alloc_func_t alloc_func,
+		  mem_realloc_func_t realloc_func,
+		  mem_free_func_t free_func,
+		  void *user_data)
+{
+	allocator.alloc = alloc_func;
+	allocator.realloc = realloc_func;
+	allocator.free = free_func;
+	allocator.user_data = user_data;
+}
+
+bool
+mem_has_custom_allocator(void)
+{
+	return allocator.alloc != NULL;
+}
+
+void *
+mem_malloc(size_t size)
+{
+	if (allocator.alloc)
+		return allocator.alloc(size, allocator.user_data);
+
+	return malloc(size);
+}
+
+void *
+mem_zalloc(size_t size)
+{
+	void *p;
+
+	if (!allocator.alloc) {
+		p = calloc(1, size);
+	} else {
+		p = allocator.alloc(size, allocator.user_data);
+		if (p)
+			memset(p, 0, size);
+	}
+
+	if (!p)
+		abort();
+
+	return p;
+}
+
+void *
+mem_realloc(void *ptr, size_t size)
+{
+	if (allocator.realloc)
+		return allocator.realloc(ptr, size, allocator.user_data);
+
+	return realloc(ptr, size);
+}
+
+void
+mem_free(void *ptr)
+{
+	if (!ptr)
+		return;
+
+	if (allocator.free)
+		allocator.free(ptr, allocator.user_data);
+	else
+		free(ptr);
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * The allocator for libinput's own long-lived and high-rate allocations,
+ * e.g. events, devices and their dispatch, see libinput_set_allocator().
+ * Memory allocated with these functions must be freed with mem_free().
+ * Everything else, e.g. strings, uses the system allocator directly.
+ */
+
+typedef void *(*mem_alloc_func_t)(size_t size, void *user_data);
+typedef void *(*mem_realloc_func_t)(void *ptr, size_t size, void *user_data);
+typedef void (*mem_free_func_t)(void *ptr, void *user_data);
+
+/**
+ * Replace the allocator, NULL functions restore the system allocator.
+ * This must not be called while any memory from the previous allocator
+ * is still allocated.
+ */
+void
+mem_set_allocator(mem_alloc_func_t alloc_func,
+		  mem_realloc_func_t realloc_func,
+		  mem_free_func_t free_func,
+		  void *user_data);
+
+/**
+ * True if a caller-provided allocator is in use. That allocator is only
+ * guaranteed to be called from the threads that call into libinput.
+ */
+bool
+mem_has_custom_allocator(void);
+
+/**
+ * Allocate size zeroed bytes. This function never fails, it aborts if
+ * the allocator is out of memory.
+ */
+void *
+mem_zalloc(size_t size);
+
+/**
+ * Allocate size bytes without zeroing them, or NULL on failure.
+ */
+void *
+mem_malloc(size_t size);
+
+/**
+ * Resize an allocation from mem_zalloc(), mem_malloc() or mem_realloc().
+ * Returns NULL on failure, ptr is untouched in that case.
+ */
+void *
+mem_realloc(void *ptr, size_t size);
+
+void
+mem_free(void *ptr);
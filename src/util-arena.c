@@ -0,0 +1,90 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "config.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util-alloc.h"
+#include "util-arena.h"
+#include "util-macros.h"
+
+/* Large enough for the usual device setup to need one chunk */
+#define ARENA_CHUNK_SIZE 4096
+/* Enough for any type we allocate, like malloc on 64-bit */
+#define ARENA_ALIGN 16
+
+struct arena_chunk {
+	struct arena_chunk *next;
+	size_t size; /* of data */
+	size_t used;
+	unsigned char data[] __attribute__((aligned(ARENA_ALIGN)));
+};
+
+void *
+arena_zalloc(struct arena *arena, size_t size)
+{
+	struct arena_chunk *chunk = arena->chunks;
+	void *ptr;
+
+	size = (size + ARENA_ALIGN - 1) & ~((size_t)ARENA_ALIGN - 1);
+
+	if (!chunk || chunk->size - chunk->used < size) {
+		size_t chunk_size = max(size, (size_t)ARENA_CHUNK_SIZE);
+
+		chunk = mem_malloc(sizeof(*chunk) + chunk_size);
+		if (!chunk)
+			abort();
+
+		chunk->size = chunk_size;
+		chunk->used = 0;
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+		arena->size += sizeof(*chunk) + chunk_size;
+	}
+
+	ptr = &chunk->data[chunk->used];
+	chunk->used += size;
+	memset(ptr, 0, size);
+
+	return ptr;
+}
+
+void
+arena_release(struct arena *arena)
+{
+	struct arena_chunk *chunk = arena->chunks;
+
+	while (chunk) {
+		struct arena_chunk *next = chunk->next;
+
+		mem_free(chunk);
+		chunk = next;
+	}
+
+	arena->chunks = NULL;
+	arena->size = 0;
+}
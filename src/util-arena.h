@@ -0,0 +1,55 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "config.h"
+
+#include <stddef.h>
+
+/**
+ * A simple bump allocator for memory with the lifetime of an object,
+ * e.g. a device's per-touch arrays. Allocations can't be freed
+ * individually, arena_release() frees them all at once.
+ *
+ * A zeroed struct arena is a valid, empty arena.
+ */
+struct arena {
+	struct arena_chunk *chunks; /* most recent first */
+	size_t size; /* bytes allocated from the system */
+};
+
+/**
+ * Allocate size zeroed bytes from the arena, aligned for any type. This
+ * function never fails, it aborts if the system is out of memory.
+ */
+void *
+arena_zalloc(struct arena *arena, size_t size);
+
+/**
+ * Free all memory allocated from the arena. The arena may be used again
+ * afterwards.
+ */
+void
+arena_release(struct arena *arena);
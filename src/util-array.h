@@ -0,0 +1,110 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * A growable array of pointers for collections that are walked more
+ * often than they change. Iterating is a linear walk over one
+ * allocation instead of chasing list nodes across the heap.
+ *
+ * The array only stores pointers, the objects themselves never move, so
+ * a pointer to an object stays a valid handle while the array grows or
+ * other elements are removed.
+ *
+ * A zeroed struct ptr_array is a valid, empty array.
+ */
+struct ptr_array {
+	void **data;
+	size_t count;
+	size_t size;
+};
+
+#define ptr_array_for_each(elem_, arr_) \
+	for (size_t _pa_i = 0; \
+	     _pa_i < (arr_)->count && ((elem_) = (arr_)->data[_pa_i], 1); \
+	     _pa_i++)
+
+static inline void
+ptr_array_init(struct ptr_array *arr)
+{
+	arr->data = NULL;
+	arr->count = 0;
+	arr->size = 0;
+}
+
+static inline void
+ptr_array_release(struct ptr_array *arr)
+{
+	free(arr->data);
+	ptr_array_init(arr);
+}
+
+/* Aborts if the system is out of memory */
+static inline void
+ptr_array_append(struct ptr_array *arr, void *ptr)
+{
+	if (arr->count == arr->size) {
+		size_t size = arr->size ? arr->size * 2 : 8;
+		void **data = realloc(arr->data, size * sizeof(*data));
+
+		if (!data)
+			abort();
+
+		arr->data = data;
+		arr->size = size;
+	}
+
+	arr->data[arr->count++] = ptr;
+}
+
+/* Removes the first occurrence of ptr, keeping the order of the other
+ * elements. Returns false if ptr is not in the array */
+static inline bool
+ptr_array_remove(struct ptr_array *arr, void *ptr)
+{
+	for (size_t i = 0; i < arr->count; i++) {
+		if (arr->data[i] != ptr)
+			continue;
+
+		memmove(&arr->data[i],
+			&arr->data[i + 1],
+			(arr->count - i - 1) * sizeof(*arr->data));
+		arr->count--;
+		return true;
+	}
+
+	return false;
+}
+
+static inline size_t
+ptr_array_memory_usage(const struct ptr_array *arr)
+{
+	return arr->size * sizeof(*arr->data);
+}
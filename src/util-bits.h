@@ -30,6 +30,7 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #define bit(x_) (1UL << (x_))
 #define NBITS(b) (b * 8)
@@ -60,6 +61,50 @@ clear_bit(unsigned char *array, int bit)
 	array[bit / 8] &= ~(1 << (bit % 8));
 }
 
+/* Bits 64 * word to 64 * word + 63 of the array, bytes past nbytes
+ * read as zero */
+static inline uint64_t
+bits_get_word(const unsigned char *array, size_t nbytes, size_t word)
+{
+	uint64_t w = 0;
+
+	for (size_t i = 0; i < 8 && word * 8 + i < nbytes; i++)
+		w |= (uint64_t)array[word * 8 + i] << (8 * i);
+
+	return w;
+}
+
+/**
+ * @return the first bit set at or after start, or -1 if there is none
+ */
+static inline int
+bits_next_set(const unsigned char *array, size_t nbytes, int start)
+{
+	size_t nwords = (nbytes + 7) / 8;
+	size_t word;
+	uint64_t w;
+
+	if (start < 0 || (size_t)start >= nbytes * 8)
+		return -1;
+
+	word = start / 64;
+	w = bits_get_word(array, nbytes, word) & (~0ULL << (start % 64));
+	while (w == 0) {
+		if (++word >= nwords)
+			return -1;
+		w = bits_get_word(array, nbytes, word);
+	}
+
+	return word * 64 + __builtin_ctzll(w);
+}
+
+/* Loops over all bits set in a byte array, skipping 64 unset bits at a
+ * time */
+#define bits_for_each_set(array_, nbytes_, bit_)			\
+	for (bit_ = bits_next_set(array_, nbytes_, 0);			\
+	     bit_ >= 0;							\
+	     bit_ = bits_next_set(array_, nbytes_, bit_ + 1))
+
 static inline bool
 long_bit_is_set(const unsigned long *array, int bit)
 {
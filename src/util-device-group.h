@@ -0,0 +1,58 @@
+/*
+ * Copyright © 2015 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <libudev.h>
+
+/* Computes what the udev helper writes into LIBINPUT_DEVICE_GROUP, so
+ * libinput can do without the helper. */
+
+/**
+ * Write the bus, vendor/product id and phys of the input device into
+ * key, in the same format as device_group_compute() but without the
+ * lookup of linked Wacom devices. The key is the same for all event
+ * nodes of one physical device and identifies it cheaply, e.g. to cache
+ * the result of device_group_compute().
+ *
+ * @return false if no parent of the device has a phys attribute
+ */
+bool
+device_group_key(struct udev_device *device, char *key, size_t size);
+
+/**
+ * Compute the device group for the device.
+ *
+ * @param wacom_db A WacomDeviceDatabase to look up paired Wacom
+ * devices in. If NULL, one is created as needed.
+ * @return false if no parent of the device has a phys attribute
+ */
+bool
+device_group_compute(struct udev_device *device,
+		     void *wacom_db,
+		     char *group,
+		     size_t size);
@@ -0,0 +1,106 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "util-macros.h"
+
+/**
+ * A fixed-size histogram with power-of-two buckets. Bucket 0 holds the
+ * value 0, bucket n holds values in [2^(n-1), 2^n). Adding a sample is a
+ * handful of instructions and never allocates, so this is cheap enough to
+ * keep enabled on hot paths.
+ */
+#define HISTOGRAM_BUCKETS 32
+
+struct histogram {
+	uint64_t buckets[HISTOGRAM_BUCKETS];
+	uint64_t count;
+	uint64_t max;
+};
+
+static inline void
+histogram_reset(struct histogram *h)
+{
+	memset(h, 0, sizeof(*h));
+}
+
+static inline unsigned int
+histogram_bucket(uint64_t value)
+{
+	unsigned int bucket = 0;
+
+	while (value && bucket < HISTOGRAM_BUCKETS - 1) {
+		value >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+static inline void
+histogram_add(struct histogram *h, uint64_t value)
+{
+	h->buckets[histogram_bucket(value)]++;
+	h->count++;
+	h->max = max(h->max, value);
+}
+
+/**
+ * Return an upper bound for the given percentile (0-100) of all samples
+ * added so far. The result is the upper limit of the bucket the
+ * percentile falls into, clamped to the largest value seen. Returns 0
+ * if the histogram is empty.
+ */
+static inline uint64_t
+histogram_percentile(const struct histogram *h, unsigned int percentile)
+{
+	uint64_t rank, seen = 0;
+	unsigned int i;
+
+	if (h->count == 0)
+		return 0;
+
+	percentile = min(percentile, 100U);
+	/* rank of the sample we're looking for, rounded up, 1-based */
+	rank = (h->count * percentile + 99) / 100;
+	rank = max(rank, 1U);
+
+	for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		seen += h->buckets[i];
+		if (seen >= rank)
+			break;
+	}
+
+	if (i == 0)
+		return 0;
+	if (i >= HISTOGRAM_BUCKETS - 1)
+		return h->max;
+
+	return min((1ULL << i) - 1, h->max);
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "config.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <linux/input.h>
+
+/* Keys down before the counter needs a heap allocation, chosen so that
+ * struct key_count is one 64-byte cache line */
+#define KEY_COUNT_INLINE 6
+
+/**
+ * A press counter for key and button codes. Only a few keys are down at
+ * any time, so instead of a counter for each of the KEY_CNT codes, a
+ * short unsorted array holds the counts of the codes that are down. The
+ * first KEY_COUNT_INLINE entries are stored in the struct itself, only
+ * more keys down at the same time move the array to the heap. A lookup
+ * is a scan of the keys currently down.
+ *
+ * A zeroed struct key_count is a valid, empty counter.
+ */
+struct key_count {
+	struct key_count_entry {
+		uint32_t code;
+		uint32_t count;
+	} *heap; /* NULL while the inline storage is used */
+	uint32_t nentries;
+	uint32_t size; /* of heap */
+	struct key_count_entry inline_entries[KEY_COUNT_INLINE];
+};
+
+static inline struct key_count_entry *
+key_count_entries(const struct key_count *kc)
+{
+	return kc->heap ? kc->heap :
+		(struct key_count_entry *)kc->inline_entries;
+}
+
+static inline struct key_count_entry *
+key_count_find(const struct key_count *kc, unsigned int code)
+{
+	struct key_count_entry *entries = key_count_entries(kc);
+
+	assert(code < KEY_CNT);
+
+	for (uint32_t i = 0; i < kc->nentries; i++) {
+		if (entries[i].code == code)
+			return &entries[i];
+	}
+
+	return NULL;
+}
+
+static inline uint32_t
+key_count_get(const struct key_count *kc, unsigned int code)
+{
+	struct key_count_entry *e = key_count_find(kc, code);
+
+	return e ? e->count : 0;
+}
+
+/**
+ * @return the count after the increment
+ */
+static inline uint32_t
+key_count_inc(struct key_count *kc, unsigned int code)
+{
+	struct key_count_entry *e = key_count_find(kc, code);
+
+	if (e)
+		return ++e->count;
+
+	if (!kc->heap && kc->nentries == KEY_COUNT_INLINE) {
+		kc->size = KEY_COUNT_INLINE * 2;
+		kc->heap = malloc(kc->size * sizeof(*kc->heap));
+		if (!kc->heap)
+			abort();
+		memcpy(kc->heap, kc->inline_entries, sizeof(kc->inline_entries));
+	} else if (kc->heap && kc->nentries == kc->size) {
+		kc->size *= 2;
+		kc->heap = realloc(kc->heap, kc->size * sizeof(*kc->heap));
+		if (!kc->heap)
+			abort();
+	}
+
+	key_count_entries(kc)[kc->nentries++] = (struct key_count_entry) {
+		.code = code,
+		.count = 1,
+	};
+
+	return 1;
+}
+
+/**
+ * Decrementing a code that is not down is a noop.
+ *
+ * @return the count after the decrement
+ */
+static inline uint32_t
+key_count_dec(struct key_count *kc, unsigned int code)
+{
+	struct key_count_entry *e = key_count_find(kc, code);
+
+	if (!e)
+		return 0;
+
+	if (--e->count > 0)
+		return e->count;
+
+	*e = key_count_entries(kc)[--kc->nentries];
+
+	return 0;
+}
+
+static inline void
+key_count_destroy(struct key_count *kc)
+{
+	free(kc->heap);
+	kc->heap = NULL;
+	kc->nentries = 0;
+	kc->size = 0;
+}
@@ -176,30 +176,17 @@ parse_dimension_property(const char *prop, size_t *w, size_t *h)
 bool
 parse_calibration_property(const char *prop, float calibration_out[6])
 {
-	int idx;
-	char **strv;
-	float calibration[6];
+	double values[6];
 
 	if (!prop)
 		return false;
 
-	strv = strv_from_string(prop, " ");
-	if (!strv)
+	if (safe_atod_list(prop, " ", values, ARRAY_LENGTH(values)) !=
+	    (int)ARRAY_LENGTH(values))
 		return false;
 
-	for (idx = 0; idx < 6; idx++) {
-		double v;
-		if (strv[idx] == NULL || !safe_atod(strv[idx], &v)) {
-			strv_free(strv);
-			return false;
-		}
-
-		calibration[idx] = v;
-	}
-
-	strv_free(strv);
-
-	memcpy(calibration_out, calibration, sizeof(calibration));
+	for (size_t idx = 0; idx < ARRAY_LENGTH(values); idx++)
+		calibration_out[idx] = values[idx];
 
 	return true;
 }
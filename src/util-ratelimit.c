@@ -56,13 +56,25 @@ enum ratelimit_state
 ratelimit_test(struct ratelimit *r)
 {
 	struct timespec ts;
-	uint64_t utime;
 
 	if (r->interval <= 0 || r->burst <= 0)
 		return RATELIMIT_PASS;
 
 	clock_gettime(CLOCK_MONOTONIC, &ts);
-	utime = s2us(ts.tv_sec) + ns2us(ts.tv_nsec);
+
+	return ratelimit_test_time(r, s2us(ts.tv_sec) + ns2us(ts.tv_nsec));
+}
+
+/*
+ * Same as ratelimit_test() but with a caller-supplied timestamp in µs,
+ * CLOCK_MONOTONIC like the event times. Use this where the current time
+ * is already known to avoid the clock_gettime().
+ */
+enum ratelimit_state
+ratelimit_test_time(struct ratelimit *r, uint64_t utime)
+{
+	if (r->interval <= 0 || r->burst <= 0)
+		return RATELIMIT_PASS;
 
 	if (r->begin <= 0 || r->begin + r->interval < utime) {
 		/* reset counter */
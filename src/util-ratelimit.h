@@ -43,3 +43,4 @@ struct ratelimit {
 
 void ratelimit_init(struct ratelimit *r, uint64_t ival_ms, unsigned int burst);
 enum ratelimit_state ratelimit_test(struct ratelimit *r);
+enum ratelimit_state ratelimit_test_time(struct ratelimit *r, uint64_t now);
@@ -0,0 +1,173 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "config.h"
+
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * A wait-free single-producer/single-consumer ring of pointers. One
+ * thread may push while another thread pops, without any locking. Each
+ * side must only be used by one thread at a time.
+ *
+ * The producer owns tail, the consumer owns head, each side only reads
+ * the other's index. The size must be a power of two, both indices run
+ * freely and are masked on access.
+ *
+ * Either side may be shared between threads by using ring_push_shared()
+ * or ring_pop_shared() for that side instead. A ring must use either the
+ * plain or the shared function for each side, never both.
+ */
+struct ring {
+	void **slots;
+	size_t mask;
+	size_t head; /* next slot to pop, written by the consumer */
+	size_t tail; /* next slot to push, written by the producer */
+	size_t reserved; /* next slot to claim, ring_push_shared() only */
+};
+
+static inline bool
+ring_init(struct ring *r, size_t size)
+{
+	if (size == 0 || (size & (size - 1)) != 0)
+		return false;
+
+	r->slots = calloc(size, sizeof(*r->slots));
+	if (!r->slots)
+		return false;
+
+	r->mask = size - 1;
+	r->head = 0;
+	r->tail = 0;
+	r->reserved = 0;
+
+	return true;
+}
+
+static inline void
+ring_destroy(struct ring *r)
+{
+	free(r->slots);
+	r->slots = NULL;
+}
+
+static inline size_t
+ring_size(const struct ring *r)
+{
+	return r->mask + 1;
+}
+
+/* Producer side, returns false if the ring is full */
+static inline bool
+ring_push(struct ring *r, void *data)
+{
+	size_t tail = r->tail;
+	size_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+
+	if (tail - head > r->mask)
+		return false;
+
+	r->slots[tail & r->mask] = data;
+	__atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/* Consumer side, returns NULL if the ring is empty */
+static inline void *
+ring_pop(struct ring *r)
+{
+	size_t head = r->head;
+	size_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+	void *data;
+
+	if (head == tail)
+		return NULL;
+
+	data = r->slots[head & r->mask];
+	__atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+
+	return data;
+}
+
+/* Producer side for any number of producer threads, returns false if
+ * the ring is full. A producer claims a slot, fills it and then waits
+ * for the producers before it to publish theirs, so the consumer sees
+ * the slots in order. That wait is only ever for another producer
+ * between its claim and its publish, a handful of instructions unless
+ * that producer was preempted, so we yield the CPU to it. */
+static inline bool
+ring_push_shared(struct ring *r, void *data)
+{
+	size_t slot = __atomic_load_n(&r->reserved, __ATOMIC_RELAXED);
+
+	do {
+		size_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+
+		if (slot - head > r->mask)
+			return false;
+	} while (!__atomic_compare_exchange_n(&r->reserved, &slot, slot + 1,
+					      true,
+					      __ATOMIC_ACQ_REL,
+					      __ATOMIC_RELAXED));
+
+	__atomic_store_n(&r->slots[slot & r->mask], data, __ATOMIC_RELAXED);
+
+	while (__atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) != slot)
+		sched_yield();
+	__atomic_store_n(&r->tail, slot + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/* Consumer side for any number of consumer threads, returns NULL if
+ * the ring is empty. The slot is read before it is claimed, if another
+ * consumer claims it first we retry with the next one. The producer
+ * cannot overwrite the slot before it is claimed. */
+static inline void *
+ring_pop_shared(struct ring *r)
+{
+	size_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+	void *data;
+
+	do {
+		size_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+
+		if (head == tail)
+			return NULL;
+
+		data = __atomic_load_n(&r->slots[head & r->mask],
+				       __ATOMIC_RELAXED);
+	} while (!__atomic_compare_exchange_n(&r->head, &head, head + 1,
+					      true,
+					      __ATOMIC_ACQ_REL,
+					      __ATOMIC_ACQUIRE));
+
+	return data;
+}
@@ -58,6 +58,75 @@ next_word(const char **state, size_t *len, const char *separators)
 	return next;
 }
 
+#ifdef HAVE_LOCALE_H
+/**
+ * Return a "C" numeric locale shared by the whole process. It is created
+ * on first use and never freed.
+ *
+ * @return The locale or (locale_t)0 if it cannot be created
+ */
+locale_t
+c_locale_get(void)
+{
+	static locale_t c_locale = (locale_t)0;
+	locale_t l, expected = (locale_t)0;
+
+	l = __atomic_load_n(&c_locale, __ATOMIC_ACQUIRE);
+	if (l != (locale_t)0)
+		return l;
+
+	l = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+	if (l == (locale_t)0)
+		return l;
+
+	/* Another thread got there first, use theirs */
+	if (!__atomic_compare_exchange_n(&c_locale, &expected, l, false,
+					 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		freelocale(l);
+		l = expected;
+	}
+
+	return l;
+}
+#endif
+
+/**
+ * Parse the first nvalues doubles in a string of doubles separated by
+ * any of the separators, with the same rules as safe_atod(). Unlike
+ * strv_from_string() with safe_atod() this does not allocate.
+ *
+ * @param str Input string
+ * @param separators List of separator characters
+ * @param values Returns the values parsed
+ * @param nvalues The maximum number of values to parse
+ *
+ * @return The number of values parsed, or -1 if a word before the
+ * nvalues'th is not a valid double
+ */
+int
+safe_atod_list(const char *str, const char *separators,
+	       double *values, size_t nvalues)
+{
+	const char *s = str, *word;
+	size_t l;
+	size_t n = 0;
+
+	while (n < nvalues && (word = next_word(&s, &l, separators))) {
+		char buf[64];
+
+		if (l >= sizeof(buf))
+			return -1;
+
+		memcpy(buf, word, l);
+		buf[l] = '\0';
+		if (!safe_atod(buf, &values[n]))
+			return -1;
+		n++;
+	}
+
+	return n;
+}
+
 /**
  * Return a null-terminated string array with the tokens in the input
  * string, e.g. "one two\tthree" with a separator list of " \t" will return
@@ -171,6 +171,10 @@ safe_atou(const char *str, unsigned int *val)
 	return safe_atou_base(str, val, 10);
 }
 
+#ifdef HAVE_LOCALE_H
+locale_t c_locale_get(void);
+#endif
+
 static inline bool
 safe_atod(const char *str, double *val)
 {
@@ -199,14 +203,13 @@ safe_atod(const char *str, double *val)
 	}
 
 #ifdef HAVE_LOCALE_H
-	/* Create a "C" locale to force strtod to use '.' as separator */
-	c_locale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+	/* Use the "C" locale to force strtod to use '.' as separator */
+	c_locale = c_locale_get();
 	if (c_locale == (locale_t)0)
 		return false;
 
 	errno = 0;
 	v = strtod_l(str, &endptr, c_locale);
-	freelocale(c_locale);
 #else
 	/* No locale support in provided libc, assume it already uses '.' */
 	errno = 0;
@@ -226,6 +229,8 @@ safe_atod(const char *str, double *val)
 }
 
 char **strv_from_string(const char *string, const char *separator);
+int safe_atod_list(const char *str, const char *separators,
+		   double *values, size_t nvalues);
 char *strv_join(char **strv, const char *separator);
 
 static inline void
@@ -28,6 +28,7 @@
 #include <assert.h>
 #include <time.h>
 #include <stdint.h>
+#include <time.h>
 #include <unistd.h>
 #include <linux/input.h>
 
@@ -63,6 +64,18 @@ s2us(uint64_t s)
 	return ms2us(s * 1000);
 }
 
+/* Reads CLOCK_MONOTONIC, returns 0 on error */
+static inline uint64_t
+now_in_us(void)
+{
+	struct timespec ts = { 0, 0 };
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+		return 0;
+
+	return s2us(ts.tv_sec) + ns2us(ts.tv_nsec);
+}
+
 static inline uint32_t
 us2ms(uint64_t us)
 {
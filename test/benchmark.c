@@ -0,0 +1,874 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Microbenchmarks for libinput's internals. This is linked against the
+ * library's objects, not the shared library, so it can call the internal
+ * functions directly.
+ *
+ * Each benchmark is calibrated to run for at least BENCH_ROUND_MS per
+ * round, the calibration doubles as warmup. The result is the mean time
+ * per operation over BENCH_ROUNDS rounds and its relative standard
+ * deviation: a large deviation means the result is not to be trusted.
+ *
+ * The benchmarks that need a device create a uinput device, they are
+ * skipped when not run as root.
+ */
+
+#include "config.h"
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <libevdev/libevdev.h>
+#include <libevdev/libevdev-uinput.h>
+#include <libudev.h>
+
+#include "libinput-private.h"
+#include "filter.h"
+#include "filter-private.h"
+#include "quirks.h"
+#include "timer.h"
+
+#define BENCH_ROUNDS 15
+#define BENCH_ROUND_MS 20
+#define BENCH_MAX_OPS (1U << 30)
+
+/* event times advance by this much per frame, roughly a 144Hz device */
+#define FRAME_INTERVAL_US 7000
+
+struct benchmark {
+	const char *name;
+	unsigned int param;
+	/* @return the state passed to run, or NULL to skip the benchmark */
+	void *(*setup)(unsigned int param);
+	/* @return the number of operations done, at least nops */
+	unsigned int (*run)(void *state, unsigned int nops);
+	void (*teardown)(void *state);
+};
+
+/* results are accumulated here so the compiler can't drop the work */
+static volatile double sink;
+
+static inline uint64_t
+now_in_ns(void)
+{
+	struct timespec ts = { 0, 0 };
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return s2us(ts.tv_sec) * 1000 + ts.tv_nsec;
+}
+
+static int
+bench_open(const char *path, int flags, void *user_data)
+{
+	int fd = open(path, flags);
+
+	return fd < 0 ? -errno : fd;
+}
+
+static void
+bench_close(int fd, void *user_data)
+{
+	close(fd);
+}
+
+static const struct libinput_interface interface = {
+	.open_restricted = bench_open,
+	.close_restricted = bench_close,
+};
+
+static void
+drain_events(struct libinput *li)
+{
+	struct libinput_event *event;
+
+	while ((event = libinput_get_event(li)))
+		libinput_event_destroy(event);
+}
+
+/* Device benchmarks: a replay context with a single uinput device */
+struct device_state {
+	struct libevdev_uinput *uinput;
+	struct libinput *li;
+	struct libinput_device *device;
+	uint64_t time;
+	unsigned int frame;
+	unsigned int param;
+};
+
+static struct device_state *
+device_state_new(struct libevdev *evdev)
+{
+	struct device_state *s;
+	struct libinput_device *device;
+	int rc;
+
+	if (getuid() != 0)
+		return NULL;
+
+	s = zalloc(sizeof(*s));
+	rc = libevdev_uinput_create_from_device(evdev,
+						LIBEVDEV_UINPUT_OPEN_MANAGED,
+						&s->uinput);
+	libevdev_free(evdev);
+	if (rc != 0) {
+		free(s);
+		return NULL;
+	}
+
+	s->li = libinput_replay_create_context(&interface, NULL);
+	device = libinput_path_add_device(s->li,
+					  libevdev_uinput_get_devnode(s->uinput));
+	if (!device) {
+		libinput_unref(s->li);
+		libevdev_uinput_destroy(s->uinput);
+		free(s);
+		return NULL;
+	}
+
+	s->device = libinput_device_ref(device);
+	s->time = now_in_us();
+	drain_events(s->li);
+
+	return s;
+}
+
+static void
+device_state_destroy(void *data)
+{
+	struct device_state *s = data;
+
+	libinput_replay_advance_time(s->li, s->time + s2us(5));
+	drain_events(s->li);
+	libinput_device_unref(s->device);
+	libinput_unref(s->li);
+	libevdev_uinput_destroy(s->uinput);
+	free(s);
+}
+
+static inline void
+push(struct device_state *s, unsigned int type, unsigned int code, int value)
+{
+	libinput_replay_device_push_event(s->device, s->time, type, code, value);
+}
+
+static inline void
+push_frame(struct device_state *s)
+{
+	push(s, EV_SYN, SYN_REPORT, 0);
+	s->time += FRAME_INTERVAL_US;
+	s->frame++;
+}
+
+/* A triangle wave so the pointer goes back and forth without jumps */
+static inline int
+wave(unsigned int frame, int step)
+{
+	unsigned int phase = frame % 500;
+
+	return (phase < 250 ? phase : 500 - phase) * step;
+}
+
+static struct libevdev *
+mouse_description(void)
+{
+	struct libevdev *evdev = libevdev_new();
+
+	libevdev_set_name(evdev, "benchmark mouse");
+	libevdev_set_id_bustype(evdev, BUS_USB);
+	libevdev_set_id_vendor(evdev, 0x1234);
+	libevdev_set_id_product(evdev, 0x5678);
+	libevdev_enable_event_code(evdev, EV_REL, REL_X, NULL);
+	libevdev_enable_event_code(evdev, EV_REL, REL_Y, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_LEFT, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_RIGHT, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_MIDDLE, NULL);
+
+	return evdev;
+}
+
+static void *
+event_queue_setup(unsigned int param)
+{
+	return device_state_new(mouse_description());
+}
+
+/* One op is queuing a pointer motion event and retrieving it again, in
+ * batches of param events */
+static unsigned int
+event_queue_run(void *data, unsigned int nops)
+{
+	struct device_state *s = data;
+	const struct normalized_coords delta = { 1.0, 1.0 };
+	const struct device_float_coords raw = { 1.0, 1.0 };
+	unsigned int done = 0;
+
+	while (done < nops) {
+		struct libinput_event *event;
+
+		for (unsigned int i = 0; i < s->param; i++) {
+			pointer_notify_motion(s->device, s->time, &delta, &raw);
+			s->time++;
+		}
+
+		while ((event = libinput_get_event(s->li)))
+			libinput_event_destroy(event);
+
+		done += s->param;
+	}
+
+	return done;
+}
+
+static void *
+event_queue_batch_setup(unsigned int param)
+{
+	struct device_state *s = event_queue_setup(param);
+
+	if (s)
+		s->param = param;
+
+	return s;
+}
+
+/* Timers, on a context without devices */
+struct timer_state {
+	struct libinput *li;
+	struct libinput_timer *timers;
+	unsigned int ntimers;
+};
+
+static void
+timer_func(uint64_t now, void *data)
+{
+	sink += 1;
+}
+
+static void *
+timer_setup(unsigned int ntimers)
+{
+	struct timer_state *s = zalloc(sizeof(*s));
+	char name[32];
+
+	s->li = libinput_path_create_context(&interface, NULL);
+	s->ntimers = ntimers;
+	s->timers = zalloc(ntimers * sizeof(*s->timers));
+	for (unsigned int i = 0; i < ntimers; i++) {
+		snprintf(name, sizeof(name), "bench%u", i);
+		libinput_timer_init(&s->timers[i], s->li, name, timer_func, s);
+	}
+
+	return s;
+}
+
+static void
+timer_teardown(void *data)
+{
+	struct timer_state *s = data;
+
+	for (unsigned int i = 0; i < s->ntimers; i++) {
+		libinput_timer_cancel(&s->timers[i]);
+		libinput_timer_destroy(&s->timers[i]);
+	}
+	free(s->timers);
+	libinput_unref(s->li);
+	free(s);
+}
+
+/* One op is arming and cancelling a timer while ntimers are armed. The
+ * timers are cancelled in the order they were armed, i.e. each cancel
+ * removes the earliest timer */
+static unsigned int
+timer_arm_cancel_run(void *data, unsigned int nops)
+{
+	struct timer_state *s = data;
+	unsigned int done = 0;
+
+	while (done < nops) {
+		uint64_t base = now_in_us() + ms2us(100);
+
+		for (unsigned int i = 0; i < s->ntimers; i++)
+			libinput_timer_set(&s->timers[i], base + i * 10);
+		for (unsigned int i = 0; i < s->ntimers; i++)
+			libinput_timer_cancel(&s->timers[i]);
+
+		done += s->ntimers;
+	}
+
+	return done;
+}
+
+/* One op is arming a timer and firing it, ntimers at a time */
+static unsigned int
+timer_fire_run(void *data, unsigned int nops)
+{
+	struct timer_state *s = data;
+	unsigned int done = 0;
+
+	while (done < nops) {
+		uint64_t base = now_in_us() + ms2us(100);
+
+		for (unsigned int i = 0; i < s->ntimers; i++)
+			libinput_timer_set(&s->timers[i], base + i * 10);
+		libinput_timer_flush(s->li, base + s->ntimers * 10);
+
+		done += s->ntimers;
+	}
+
+	return done;
+}
+
+/* Quirks, matched against the shipped quirks files */
+struct quirks_state {
+	struct quirks_context *ctx;
+	struct libevdev_uinput *uinput;
+	struct udev *udev;
+	struct udev_device *udev_device;
+	bool cached;
+};
+
+static void
+quirks_log_handler(struct libinput *libinput,
+		   enum libinput_log_priority priority,
+		   const char *format,
+		   va_list args)
+{
+}
+
+static void *
+quirks_setup(unsigned int cached)
+{
+	struct quirks_state *s;
+	struct stat st;
+
+	if (getuid() != 0)
+		return NULL;
+
+	s = zalloc(sizeof(*s));
+	s->cached = cached;
+	s->ctx = quirks_init_subsystem(LIBINPUT_QUIRKS_SRCDIR,
+				       NULL,
+				       quirks_log_handler,
+				       NULL,
+				       QLOG_LIBINPUT_LOGGING);
+	if (!s->ctx)
+		goto err;
+
+	if (libevdev_uinput_create_from_device(mouse_description(),
+					       LIBEVDEV_UINPUT_OPEN_MANAGED,
+					       &s->uinput) != 0)
+		goto err;
+
+	s->udev = udev_new();
+	if (stat(libevdev_uinput_get_devnode(s->uinput), &st) < 0)
+		goto err;
+
+	/* udev may need a moment to process the new device */
+	for (int i = 0; i < 200 && !s->udev_device; i++) {
+		s->udev_device = udev_device_new_from_devnum(s->udev,
+							     'c',
+							     st.st_rdev);
+		if (s->udev_device &&
+		    !udev_device_get_is_initialized(s->udev_device)) {
+			s->udev_device = udev_device_unref(s->udev_device);
+			msleep(10);
+		}
+	}
+	if (!s->udev_device)
+		goto err;
+
+	return s;
+
+err:
+	if (s->udev)
+		udev_unref(s->udev);
+	if (s->uinput)
+		libevdev_uinput_destroy(s->uinput);
+	if (s->ctx)
+		quirks_context_unref(s->ctx);
+	free(s);
+	return NULL;
+}
+
+static void
+quirks_teardown(void *data)
+{
+	struct quirks_state *s = data;
+
+	udev_device_unref(s->udev_device);
+	udev_unref(s->udev);
+	libevdev_uinput_destroy(s->uinput);
+	quirks_context_unref(s->ctx);
+	free(s);
+}
+
+static unsigned int
+quirks_fetch_run(void *data, unsigned int nops)
+{
+	struct quirks_state *s = data;
+
+	for (unsigned int i = 0; i < nops; i++) {
+		struct quirks *q;
+
+		if (!s->cached)
+			quirks_cache_forget(s->ctx, s->udev_device);
+		q = quirks_fetch_for_device(s->ctx, s->udev_device);
+		quirks_unref(q);
+	}
+
+	return nops;
+}
+
+/* Velocity trackers and the pointer acceleration filters */
+struct filter_state {
+	struct pointer_trackers trackers;
+	struct motion_filter *filter;
+	struct libinput_tablet_tool tool;
+	uint64_t time;
+};
+
+static void *
+trackers_setup(unsigned int ntrackers)
+{
+	struct filter_state *s = zalloc(sizeof(*s));
+
+	trackers_init(&s->trackers, ntrackers);
+	s->time = s2us(1);
+	trackers_reset(&s->trackers, s->time);
+
+	return s;
+}
+
+static void
+filter_state_destroy(void *data)
+{
+	struct filter_state *s = data;
+
+	filter_destroy(s->filter);
+	free(s);
+}
+
+/* One op is feeding a delta and calculating the velocity */
+static unsigned int
+trackers_velocity_run(void *data, unsigned int nops)
+{
+	struct filter_state *s = data;
+	double velocity = 0.0;
+
+	for (unsigned int i = 0; i < nops; i++) {
+		struct device_float_coords delta = {
+			.x = 1.0 + (i % 8),
+			.y = 1.0,
+		};
+
+		s->time += 1000;
+		trackers_feed(&s->trackers, &delta, s->time);
+		velocity += trackers_velocity(&s->trackers, s->time);
+	}
+
+	sink += velocity;
+
+	return nops;
+}
+
+enum accel_filter {
+	FILTER_FLAT,
+	FILTER_LINEAR,
+	FILTER_LOW_DPI,
+	FILTER_TOUCHPAD,
+	FILTER_X230,
+	FILTER_TRACKPOINT,
+	FILTER_CUSTOM,
+	FILTER_TABLET,
+};
+
+static void *
+filter_setup(unsigned int which)
+{
+	struct filter_state *s = zalloc(sizeof(*s));
+	const double points[] = { 0.0, 1.0, 2.5, 6.0, 10.0 };
+
+	switch (which) {
+	case FILTER_FLAT:
+		s->filter = create_pointer_accelerator_filter_flat(1000);
+		break;
+	case FILTER_LINEAR:
+		s->filter = create_pointer_accelerator_filter_linear(1000, true);
+		break;
+	case FILTER_LOW_DPI:
+		s->filter = create_pointer_accelerator_filter_linear_low_dpi(400, true);
+		break;
+	case FILTER_TOUCHPAD:
+		s->filter = create_pointer_accelerator_filter_touchpad(1000,
+								       ms2us(50),
+								       ms2us(10),
+								       true);
+		break;
+	case FILTER_X230:
+		s->filter = create_pointer_accelerator_filter_lenovo_x230(1000, true);
+		break;
+	case FILTER_TRACKPOINT:
+		s->filter = create_pointer_accelerator_filter_trackpoint(1.0, true);
+		break;
+	case FILTER_CUSTOM:
+		s->filter = create_pointer_accelerator_filter_custom(1000,
+								     true,
+								     1.0,
+								     points,
+								     ARRAY_LENGTH(points));
+		break;
+	case FILTER_TABLET:
+		s->filter = create_pointer_accelerator_filter_tablet(200, 200);
+		break;
+	}
+
+	s->tool.type = LIBINPUT_TABLET_TOOL_TYPE_PEN;
+	s->time = s2us(1);
+
+	return s;
+}
+
+/* One op is filtering a single delta, at 1000Hz */
+static unsigned int
+filter_run(void *data, unsigned int nops)
+{
+	struct filter_state *s = data;
+	double sum = 0.0;
+
+	for (unsigned int i = 0; i < nops; i++) {
+		struct device_float_coords delta = {
+			.x = 1.0 + (i % 16),
+			.y = 0.5 * (i % 4),
+		};
+		struct normalized_coords accel;
+
+		s->time += 1000;
+		accel = filter_dispatch(s->filter, &delta, &s->tool, s->time);
+		sum += accel.x + accel.y;
+	}
+
+	sink += sum;
+
+	return nops;
+}
+
+/* Touchpad frames with param touches moving at the same time */
+static void *
+touchpad_setup(unsigned int ntouches)
+{
+	const struct input_absinfo x = { .minimum = 0, .maximum = 4000, .resolution = 40 },
+				   y = { .minimum = 0, .maximum = 2500, .resolution = 40 },
+				   slot = { .minimum = 0, .maximum = 4 },
+				   tracking_id = { .minimum = 0, .maximum = 65535 };
+	const unsigned int tools[] = {
+		BTN_TOOL_FINGER, BTN_TOOL_DOUBLETAP, BTN_TOOL_TRIPLETAP,
+		BTN_TOOL_QUADTAP, BTN_TOOL_QUINTTAP,
+	};
+	struct libevdev *evdev = libevdev_new();
+	struct device_state *s;
+
+	libevdev_set_name(evdev, "benchmark touchpad");
+	libevdev_set_id_bustype(evdev, BUS_I8042);
+	libevdev_set_id_vendor(evdev, 0x2);
+	libevdev_set_id_product(evdev, 0x7);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_X, &x);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_Y, &y);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_MT_SLOT, &slot);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_MT_POSITION_X, &x);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_MT_POSITION_Y, &y);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_MT_TRACKING_ID, &tracking_id);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_LEFT, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_TOUCH, NULL);
+	for (size_t i = 0; i < ARRAY_LENGTH(tools); i++)
+		libevdev_enable_event_code(evdev, EV_KEY, tools[i], NULL);
+	libevdev_enable_property(evdev, INPUT_PROP_POINTER);
+	libevdev_enable_property(evdev, INPUT_PROP_BUTTONPAD);
+
+	s = device_state_new(evdev);
+	if (!s)
+		return NULL;
+
+	s->param = ntouches;
+	for (unsigned int i = 0; i < ntouches; i++) {
+		push(s, EV_ABS, ABS_MT_SLOT, i);
+		push(s, EV_ABS, ABS_MT_TRACKING_ID, i);
+		push(s, EV_ABS, ABS_MT_POSITION_X, 1000 + i * 500);
+		push(s, EV_ABS, ABS_MT_POSITION_Y, 1000);
+	}
+	push(s, EV_KEY, BTN_TOUCH, 1);
+	push(s, EV_KEY, tools[ntouches - 1], 1);
+	push(s, EV_ABS, ABS_X, 1000);
+	push(s, EV_ABS, ABS_Y, 1000);
+	push_frame(s);
+	drain_events(s->li);
+
+	return s;
+}
+
+/* One op is a frame with all touches moving */
+static unsigned int
+touchpad_run(void *data, unsigned int nops)
+{
+	struct device_state *s = data;
+
+	for (unsigned int i = 0; i < nops; i++) {
+		int offset = wave(s->frame, 4);
+
+		for (unsigned int t = 0; t < s->param; t++) {
+			push(s, EV_ABS, ABS_MT_SLOT, t);
+			push(s, EV_ABS, ABS_MT_POSITION_X, 1000 + t * 500 + offset);
+			push(s, EV_ABS, ABS_MT_POSITION_Y, 1000 + offset / 2);
+		}
+		push(s, EV_ABS, ABS_X, 1000 + offset);
+		push(s, EV_ABS, ABS_Y, 1000 + offset / 2);
+		push_frame(s);
+		drain_events(s->li);
+	}
+
+	return nops;
+}
+
+/* Tablet pen frames with position, pressure and tilt changing */
+static void *
+tablet_setup(unsigned int param)
+{
+	const struct input_absinfo x = { .minimum = 0, .maximum = 40000, .resolution = 200 },
+				   y = { .minimum = 0, .maximum = 25000, .resolution = 200 },
+				   pressure = { .minimum = 0, .maximum = 8191 },
+				   tilt = { .minimum = -64, .maximum = 63, .resolution = 57 };
+	struct libevdev *evdev = libevdev_new();
+	struct device_state *s;
+
+	libevdev_set_name(evdev, "benchmark tablet");
+	libevdev_set_id_bustype(evdev, BUS_USB);
+	libevdev_set_id_vendor(evdev, 0x1234);
+	libevdev_set_id_product(evdev, 0x5679);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_X, &x);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_Y, &y);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_PRESSURE, &pressure);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_TILT_X, &tilt);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_TILT_Y, &tilt);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_TOOL_PEN, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_TOUCH, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_STYLUS, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_STYLUS2, NULL);
+	libevdev_enable_property(evdev, INPUT_PROP_POINTER);
+
+	s = device_state_new(evdev);
+	if (!s)
+		return NULL;
+
+	push(s, EV_KEY, BTN_TOOL_PEN, 1);
+	push(s, EV_ABS, ABS_X, 10000);
+	push(s, EV_ABS, ABS_Y, 10000);
+	push_frame(s);
+	push(s, EV_KEY, BTN_TOUCH, 1);
+	push(s, EV_ABS, ABS_PRESSURE, 2000);
+	push_frame(s);
+	drain_events(s->li);
+
+	return s;
+}
+
+/* One op is a frame with all axes changing */
+static unsigned int
+tablet_run(void *data, unsigned int nops)
+{
+	struct device_state *s = data;
+
+	for (unsigned int i = 0; i < nops; i++) {
+		int offset = wave(s->frame, 10);
+
+		push(s, EV_ABS, ABS_X, 10000 + offset);
+		push(s, EV_ABS, ABS_Y, 10000 + offset / 2);
+		push(s, EV_ABS, ABS_PRESSURE, 2000 + offset);
+		push(s, EV_ABS, ABS_TILT_X, offset / 100 - 12);
+		push(s, EV_ABS, ABS_TILT_Y, 12 - offset / 100);
+		push_frame(s);
+		drain_events(s->li);
+	}
+
+	return nops;
+}
+
+static const struct benchmark benchmarks[] = {
+	{ "event-queue/batch-1", 1, event_queue_batch_setup, event_queue_run, device_state_destroy },
+	{ "event-queue/batch-64", 64, event_queue_batch_setup, event_queue_run, device_state_destroy },
+	{ "event-queue/batch-1024", 1024, event_queue_batch_setup, event_queue_run, device_state_destroy },
+	{ "timer/arm-cancel-1", 1, timer_setup, timer_arm_cancel_run, timer_teardown },
+	{ "timer/arm-cancel-16", 16, timer_setup, timer_arm_cancel_run, timer_teardown },
+	{ "timer/arm-cancel-256", 256, timer_setup, timer_arm_cancel_run, timer_teardown },
+	{ "timer/arm-fire-1", 1, timer_setup, timer_fire_run, timer_teardown },
+	{ "timer/arm-fire-16", 16, timer_setup, timer_fire_run, timer_teardown },
+	{ "timer/arm-fire-256", 256, timer_setup, timer_fire_run, timer_teardown },
+	{ "quirks/fetch-uncached", 0, quirks_setup, quirks_fetch_run, quirks_teardown },
+	{ "quirks/fetch-cached", 1, quirks_setup, quirks_fetch_run, quirks_teardown },
+	{ "trackers/velocity-4", 4, trackers_setup, trackers_velocity_run, filter_state_destroy },
+	{ "trackers/velocity-16", 16, trackers_setup, trackers_velocity_run, filter_state_destroy },
+	{ "filter/flat", FILTER_FLAT, filter_setup, filter_run, filter_state_destroy },
+	{ "filter/linear", FILTER_LINEAR, filter_setup, filter_run, filter_state_destroy },
+	{ "filter/low-dpi", FILTER_LOW_DPI, filter_setup, filter_run, filter_state_destroy },
+	{ "filter/touchpad", FILTER_TOUCHPAD, filter_setup, filter_run, filter_state_destroy },
+	{ "filter/x230", FILTER_X230, filter_setup, filter_run, filter_state_destroy },
+	{ "filter/trackpoint", FILTER_TRACKPOINT, filter_setup, filter_run, filter_state_destroy },
+	{ "filter/custom", FILTER_CUSTOM, filter_setup, filter_run, filter_state_destroy },
+	{ "filter/tablet", FILTER_TABLET, filter_setup, filter_run, filter_state_destroy },
+	{ "touchpad/frame-1", 1, touchpad_setup, touchpad_run, device_state_destroy },
+	{ "touchpad/frame-2", 2, touchpad_setup, touchpad_run, device_state_destroy },
+	{ "touchpad/frame-3", 3, touchpad_setup, touchpad_run, device_state_destroy },
+	{ "touchpad/frame-5", 5, touchpad_setup, touchpad_run, device_state_destroy },
+	{ "tablet/frame", 0, tablet_setup, tablet_run, device_state_destroy },
+};
+
+static void
+run_benchmark(const struct benchmark *b)
+{
+	double results[BENCH_ROUNDS];
+	double mean = 0.0, variance = 0.0, min = INFINITY;
+	unsigned int nops = 1;
+	void *state;
+
+	state = b->setup(b->param);
+	if (!state) {
+		printf("%-28s skipped\n", b->name);
+		return;
+	}
+
+	/* Find the number of ops that takes at least one round, this
+	 * doubles as warmup */
+	while (nops < BENCH_MAX_OPS) {
+		uint64_t start = now_in_ns();
+
+		nops = b->run(state, nops);
+		if (now_in_ns() - start >= ms2us(BENCH_ROUND_MS) * 1000)
+			break;
+		nops *= 2;
+	}
+
+	for (int i = 0; i < BENCH_ROUNDS; i++) {
+		uint64_t start = now_in_ns();
+		unsigned int done;
+
+		done = b->run(state, nops);
+		results[i] = (double)(now_in_ns() - start) / done;
+		mean += results[i];
+		min = min(min, results[i]);
+	}
+	mean /= BENCH_ROUNDS;
+
+	for (int i = 0; i < BENCH_ROUNDS; i++)
+		variance += (results[i] - mean) * (results[i] - mean);
+	variance /= BENCH_ROUNDS - 1;
+
+	printf("%-28s %12.1f ns/op  ±%5.1f%%  min %12.1f  (%u ops x %d rounds)\n",
+	       b->name,
+	       mean,
+	       mean > 0.0 ? 100.0 * sqrt(variance) / mean : 0.0,
+	       min,
+	       nops,
+	       BENCH_ROUNDS);
+	fflush(stdout);
+
+	b->teardown(state);
+}
+
+static void
+usage(void)
+{
+	printf("Usage: %s [--help] [--list] [filter ...]\n"
+	       "\n"
+	       "Run the benchmarks whose name contains one of the filters, or all\n"
+	       "benchmarks if no filter is given.\n",
+	       program_invocation_short_name);
+}
+
+static bool
+matches(const char *name, char **filters, int nfilters)
+{
+	if (nfilters == 0)
+		return true;
+
+	for (int i = 0; i < nfilters; i++) {
+		if (strstr(name, filters[i]))
+			return true;
+	}
+
+	return false;
+}
+
+int
+main(int argc, char **argv)
+{
+	enum {
+		OPT_HELP,
+		OPT_LIST,
+	};
+	struct option opts[] = {
+		{ "help", no_argument, 0, OPT_HELP },
+		{ "list", no_argument, 0, OPT_LIST },
+		{ 0, 0, 0, 0 },
+	};
+	bool list = false;
+
+	while (1) {
+		int c = getopt_long(argc, argv, "h", opts, NULL);
+
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+		case OPT_HELP:
+			usage();
+			return EXIT_SUCCESS;
+		case OPT_LIST:
+			list = true;
+			break;
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	setenv("LIBINPUT_QUIRKS_DIR", LIBINPUT_QUIRKS_SRCDIR, 0);
+
+	for (size_t i = 0; i < ARRAY_LENGTH(benchmarks); i++) {
+		const struct benchmark *b = &benchmarks[i];
+
+		if (!matches(b->name, &argv[optind], argc - optind))
+			continue;
+
+		if (list)
+			printf("%s\n", b->name);
+		else
+			run_benchmark(b);
+	}
+
+	return EXIT_SUCCESS;
+}
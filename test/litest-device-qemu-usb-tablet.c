@@ -88,7 +88,7 @@ static int events[] = {
 
 TEST_DEVICE("qemu-tablet",
 	.type = LITEST_QEMU_TABLET,
-	.features = LITEST_WHEEL | LITEST_BUTTON | LITEST_ABSOLUTE,
+	.features = LITEST_WHEEL | LITEST_BUTTON | LITEST_ABSOLUTE | LITEST_NO_DEBOUNCE | LITEST_VIRTUAL,
 	.interface = &interface,
 
 	.name = "QEMU 0.12.1 QEMU USB Tablet",
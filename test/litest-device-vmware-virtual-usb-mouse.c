@@ -102,7 +102,7 @@ static int events[] = {
 
 TEST_DEVICE("vmware-virtmouse",
 	.type = LITEST_VMWARE_VIRTMOUSE,
-	.features = LITEST_WHEEL | LITEST_BUTTON | LITEST_ABSOLUTE | LITEST_NO_DEBOUNCE,
+	.features = LITEST_WHEEL | LITEST_BUTTON | LITEST_ABSOLUTE | LITEST_NO_DEBOUNCE | LITEST_VIRTUAL,
 	.interface = &interface,
 
 	.name = "VMware VMware Virtual USB Mouse",
@@ -1347,11 +1347,13 @@ litest_install_model_quirks(struct list *created_files_list)
 	if (use_system_rules_quirks)
 		return;
 
+#ifdef LIBINPUT_DEVICE_GROUPS_RULES_FILE
 	file = litest_copy_file(UDEV_DEVICE_GROUPS_FILE,
 				LIBINPUT_DEVICE_GROUPS_RULES_FILE,
 				warning,
 				true);
 	list_insert(created_files_list, &file->link);
+#endif
 
 	file = litest_copy_file(UDEV_FUZZ_OVERRIDE_RULE_FILE,
 				LIBINPUT_FUZZ_OVERRIDE_UDEV_RULES_FILE,
@@ -2937,6 +2939,9 @@ litest_event_type_str(enum libinput_event_type type)
 	case LIBINPUT_EVENT_POINTER_AXIS:
 		str = "AXIS";
 		break;
+	case LIBINPUT_EVENT_POINTER_FRAME:
+		str = "POINTER FRAME";
+		break;
 	case LIBINPUT_EVENT_TOUCH_DOWN:
 		str = "TOUCH DOWN";
 		break;
@@ -3990,6 +3995,12 @@ litest_timeout_hysteresis(void)
 	msleep(90);
 }
 
+void
+litest_timeout_catch_up(void)
+{
+	msleep(150);
+}
+
 void
 litest_push_event_frame(struct litest_device *dev)
 {
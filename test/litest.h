@@ -341,6 +341,7 @@ enum litest_device_type {
 #define LITEST_DIRECT		bit(30)
 #define LITEST_TOTEM		bit(31)
 #define LITEST_FORCED_PROXOUT	bit(32)
+#define LITEST_VIRTUAL		bit(33)
 
 /* this is a semi-mt device, so we keep track of the touches that the tests
  * send and modify them so that the first touch is always slot 0 and sends
@@ -871,6 +872,9 @@ litest_timeout_touch_arbitration(void);
 void
 litest_timeout_hysteresis(void);
 
+void
+litest_timeout_catch_up(void);
+
 void
 litest_push_event_frame(struct litest_device *dev);
 
@@ -0,0 +1,420 @@
+#!/usr/bin/env python3
+# vim: set expandtab shiftwidth=4:
+# -*- Mode: python; coding: utf-8; indent-tabs-mode: nil -*- */
+#
+# Copyright © 2020 Red Hat, Inc.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# DEALINGS IN THE SOFTWARE.
+#
+# The training workload for a profile-guided optimization build, see the
+# "pgo-train" target in meson.build.
+#
+# This writes one libinput record file per device type into the output
+# directory and replays each through libinput benchmark. The recordings are
+# generated so they are small and cover the common interactions: pointer
+# motion at different speeds, buttons, scrolling, tapping, two-finger
+# gestures, multitouch, tablet proximity and pressure, typing. Extra
+# recordings, e.g. made with libinput record on the target hardware, can
+# be appended with --recording.
+
+
+import argparse
+import math
+import os
+import subprocess
+import sys
+
+EV_SYN = 0
+EV_KEY = 1
+EV_REL = 2
+EV_ABS = 3
+EV_MSC = 4
+
+SYN_REPORT = 0
+
+BTN_LEFT = 0x110
+BTN_RIGHT = 0x111
+BTN_MIDDLE = 0x112
+BTN_TOOL_PEN = 0x140
+BTN_TOOL_RUBBER = 0x141
+BTN_TOOL_FINGER = 0x145
+BTN_TOOL_QUINTTAP = 0x148
+BTN_TOUCH = 0x14a
+BTN_STYLUS = 0x14b
+BTN_STYLUS2 = 0x14c
+BTN_TOOL_DOUBLETAP = 0x14d
+BTN_TOOL_TRIPLETAP = 0x14e
+BTN_TOOL_QUADTAP = 0x14f
+
+REL_X = 0x00
+REL_Y = 0x01
+REL_WHEEL = 0x08
+REL_WHEEL_HI_RES = 0x0b
+
+ABS_X = 0x00
+ABS_Y = 0x01
+ABS_PRESSURE = 0x18
+ABS_DISTANCE = 0x19
+ABS_TILT_X = 0x1a
+ABS_TILT_Y = 0x1b
+ABS_MT_SLOT = 0x2f
+ABS_MT_POSITION_X = 0x35
+ABS_MT_POSITION_Y = 0x36
+ABS_MT_TRACKING_ID = 0x39
+ABS_MT_PRESSURE = 0x3a
+
+MSC_SERIAL = 0x00
+MSC_SCAN = 0x04
+
+INPUT_PROP_POINTER = 0x00
+INPUT_PROP_DIRECT = 0x01
+INPUT_PROP_BUTTONPAD = 0x02
+
+
+class Device(object):
+    def __init__(self, name, id, codes, absinfo={}, props=[]):
+        self.name = name
+        self.id = id
+        self.codes = codes
+        self.absinfo = absinfo
+        self.props = props
+        self.frames = []
+        self.time = 1000000  # µs
+
+    def frame(self, events, dt):
+        '''Append one frame of (type, code, value) events, dt µs after
+        the previous one'''
+        self.time += dt
+        self.frames.append((self.time, events))
+
+    def write(self, path):
+        with open(path, 'w') as f:
+            f.write('version: 1\n')
+            f.write('ndevices: 1\n')
+            f.write('devices:\n')
+            f.write('  - node: /dev/input/event0\n')
+            f.write('    evdev:\n')
+            f.write('      name: "{}"\n'.format(self.name))
+            f.write('      id: [{}]\n'.format(', '.join(str(i) for i in self.id)))
+            f.write('      codes:\n')
+            f.write('        0: [0]\n')
+            for t, codes in sorted(self.codes.items()):
+                f.write('        {}: [{}]\n'.format(t, ', '.join(str(c) for c in codes)))
+            if self.absinfo:
+                f.write('      absinfo:\n')
+                for c, a in sorted(self.absinfo.items()):
+                    f.write('        {}: [{}]\n'.format(c, ', '.join(str(v) for v in a)))
+            f.write('      properties: [{}]\n'.format(', '.join(str(p) for p in self.props)))
+            f.write('    events:\n')
+            for time, events in self.frames:
+                sec, usec = divmod(time, 1000000)
+                f.write('      - evdev:\n')
+                for t, c, v in events + [(EV_SYN, SYN_REPORT, 0)]:
+                    f.write('        - [{}, {}, {}, {}, {}]\n'.format(sec, usec, t, c, v))
+
+
+def mouse():
+    d = Device('PGO Training Mouse', [3, 0x46d, 0xc077, 0x111],
+               codes={EV_KEY: [BTN_LEFT, BTN_RIGHT, BTN_MIDDLE],
+                      EV_REL: [REL_X, REL_Y, REL_WHEEL, REL_WHEEL_HI_RES],
+                      EV_MSC: [MSC_SCAN]})
+    # circles at increasing speed so the acceleration curve is covered
+    for speed in (1, 3, 8, 20):
+        for i in range(250):
+            a = i * 2 * math.pi / 125
+            dx = round(speed * math.cos(a))
+            dy = round(speed * math.sin(a))
+            if dx or dy:
+                d.frame([(EV_REL, REL_X, dx), (EV_REL, REL_Y, dy)], 8000)
+    for button in (BTN_LEFT, BTN_RIGHT, BTN_MIDDLE, BTN_LEFT):
+        d.frame([(EV_MSC, MSC_SCAN, 0x90001), (EV_KEY, button, 1)], 100000)
+        for i in range(20):
+            d.frame([(EV_REL, REL_X, 2)], 8000)
+        d.frame([(EV_MSC, MSC_SCAN, 0x90001), (EV_KEY, button, 0)], 80000)
+    for direction in (1, -1):
+        for i in range(30):
+            d.frame([(EV_REL, REL_WHEEL, direction),
+                     (EV_REL, REL_WHEEL_HI_RES, 120 * direction)], 16000)
+    return d
+
+
+def keyboard():
+    keys = list(range(1, 89))
+    d = Device('PGO Training Keyboard', [0x11, 0x1, 0x1, 0xab41],
+               codes={EV_KEY: keys, EV_MSC: [MSC_SCAN]})
+    text = [16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 57, 30, 31, 32, 33,
+            34, 35, 36, 37, 38, 57, 44, 45, 46, 47, 48, 49, 50, 28]
+    for repeat in range(10):
+        for key in text:
+            d.frame([(EV_MSC, MSC_SCAN, key), (EV_KEY, key, 1)], 90000)
+            d.frame([(EV_MSC, MSC_SCAN, key), (EV_KEY, key, 0)], 60000)
+    # shift + key and a held key with autorepeat
+    d.frame([(EV_KEY, 42, 1)], 200000)
+    d.frame([(EV_KEY, 30, 1)], 80000)
+    d.frame([(EV_KEY, 30, 0)], 60000)
+    d.frame([(EV_KEY, 42, 0)], 60000)
+    d.frame([(EV_KEY, 14, 1)], 200000)
+    for i in range(30):
+        d.frame([(EV_KEY, 14, 2)], 33000 if i else 500000)
+    d.frame([(EV_KEY, 14, 0)], 20000)
+    return d
+
+
+def touchpad():
+    d = Device('PGO Training Touchpad', [0x18, 0x6cb, 0xcd7d, 0x100],
+               codes={EV_KEY: [BTN_LEFT, BTN_TOOL_FINGER, BTN_TOOL_QUINTTAP,
+                               BTN_TOUCH, BTN_TOOL_DOUBLETAP,
+                               BTN_TOOL_TRIPLETAP, BTN_TOOL_QUADTAP],
+                      EV_ABS: [ABS_X, ABS_Y, ABS_PRESSURE, ABS_MT_SLOT,
+                               ABS_MT_POSITION_X, ABS_MT_POSITION_Y,
+                               ABS_MT_TRACKING_ID, ABS_MT_PRESSURE]},
+               absinfo={ABS_X: [0, 3200, 0, 0, 32],
+                        ABS_Y: [0, 2100, 0, 0, 32],
+                        ABS_PRESSURE: [0, 255, 0, 0, 0],
+                        ABS_MT_SLOT: [0, 4, 0, 0, 0],
+                        ABS_MT_POSITION_X: [0, 3200, 0, 0, 32],
+                        ABS_MT_POSITION_Y: [0, 2100, 0, 0, 32],
+                        ABS_MT_TRACKING_ID: [0, 65535, 0, 0, 0],
+                        ABS_MT_PRESSURE: [0, 255, 0, 0, 0]},
+               props=[INPUT_PROP_POINTER, INPUT_PROP_BUTTONPAD])
+    tracking_id = [0]
+    tools = {1: BTN_TOOL_FINGER, 2: BTN_TOOL_DOUBLETAP,
+             3: BTN_TOOL_TRIPLETAP}
+
+    def touch(paths, dt=7000, click=False):
+        '''paths is a list of per-finger lists of (x, y), all fingers
+        go down in the first frame and up after the last'''
+        n = len(paths)
+        for i in range(len(paths[0])):
+            events = []
+            for slot, path in enumerate(paths):
+                x, y = path[i]
+                events.append((EV_ABS, ABS_MT_SLOT, slot))
+                if i == 0:
+                    tracking_id[0] += 1
+                    events.append((EV_ABS, ABS_MT_TRACKING_ID, tracking_id[0]))
+                events += [(EV_ABS, ABS_MT_POSITION_X, x),
+                           (EV_ABS, ABS_MT_POSITION_Y, y),
+                           (EV_ABS, ABS_MT_PRESSURE, 60)]
+            if i == 0:
+                events += [(EV_KEY, BTN_TOUCH, 1), (EV_KEY, tools[n], 1)]
+            if click and i == len(paths[0]) // 2:
+                events.append((EV_KEY, BTN_LEFT, 1))
+            if click and i == len(paths[0]) // 2 + 5:
+                events.append((EV_KEY, BTN_LEFT, 0))
+            x, y = paths[0][i]
+            events += [(EV_ABS, ABS_X, x), (EV_ABS, ABS_Y, y),
+                       (EV_ABS, ABS_PRESSURE, 60)]
+            d.frame(events, dt)
+        events = []
+        for slot in range(n):
+            events += [(EV_ABS, ABS_MT_SLOT, slot),
+                       (EV_ABS, ABS_MT_TRACKING_ID, -1)]
+        events += [(EV_KEY, BTN_TOUCH, 0), (EV_KEY, tools[n], 0),
+                   (EV_ABS, ABS_PRESSURE, 0)]
+        d.frame(events, dt)
+
+    def line(x0, y0, x1, y1, steps):
+        return [(x0 + (x1 - x0) * i // steps, y0 + (y1 - y0) * i // steps)
+                for i in range(steps + 1)]
+
+    # pointer motion, slow and fast
+    for steps in (200, 60, 20):
+        touch([line(800, 600, 2400, 1500, steps)])
+        d.time += 300000
+    # tap, double-tap, two-finger tap
+    for i in range(5):
+        touch([line(1600, 1000, 1602, 1001, 8)])
+        d.time += 300000
+    touch([line(1600, 1000, 1600, 1000, 6)])
+    d.time += 80000
+    touch([line(1600, 1000, 1600, 1000, 6)])
+    d.time += 500000
+    touch([line(1400, 1000, 1400, 1000, 8), line(1900, 1000, 1900, 1000, 8)])
+    d.time += 500000
+    # tap-and-drag
+    touch([line(1600, 1000, 1600, 1000, 6)])
+    d.time += 60000
+    touch([line(1600, 1000, 2200, 1300, 80)])
+    d.time += 500000
+    # two-finger scroll, both directions
+    for y0, y1 in ((600, 1600), (1600, 600)):
+        touch([line(1300, y0, 1300, y1, 100), line(1800, y0, 1800, y1, 100)])
+        d.time += 500000
+    # pinch and three-finger swipe
+    touch([line(1400, 1000, 800, 800, 80), line(1800, 1100, 2400, 1400, 80)])
+    d.time += 500000
+    touch([line(1000, 1000, 2000, 1000, 60), line(1400, 1100, 2400, 1100, 60),
+           line(1800, 1000, 2800, 1000, 60)])
+    d.time += 500000
+    # physical clicks in the software button areas
+    touch([line(800, 1900, 805, 1900, 20)], click=True)
+    d.time += 400000
+    touch([line(2600, 1900, 2605, 1900, 20)], click=True)
+    d.time += 400000
+    # edge of the touchpad and a resting thumb at the bottom
+    touch([line(3150, 200, 3150, 1800, 80)])
+    d.time += 400000
+    touch([line(1000, 2050, 1005, 2050, 60), line(1600, 600, 2400, 1200, 60)])
+    return d
+
+
+def touchscreen():
+    d = Device('PGO Training Touchscreen', [0x18, 0x4f3, 0x2a1c, 0x100],
+               codes={EV_KEY: [BTN_TOUCH],
+                      EV_ABS: [ABS_X, ABS_Y, ABS_MT_SLOT, ABS_MT_POSITION_X,
+                               ABS_MT_POSITION_Y, ABS_MT_TRACKING_ID]},
+               absinfo={ABS_X: [0, 4000, 0, 0, 15],
+                        ABS_Y: [0, 2400, 0, 0, 15],
+                        ABS_MT_SLOT: [0, 9, 0, 0, 0],
+                        ABS_MT_POSITION_X: [0, 4000, 0, 0, 15],
+                        ABS_MT_POSITION_Y: [0, 2400, 0, 0, 15],
+                        ABS_MT_TRACKING_ID: [0, 65535, 0, 0, 0]},
+               props=[INPUT_PROP_DIRECT])
+    tracking_id = 0
+    for nfingers in (1, 2, 3, 5, 1, 2):
+        for i in range(60):
+            events = []
+            for slot in range(nfingers):
+                events.append((EV_ABS, ABS_MT_SLOT, slot))
+                if i == 0:
+                    tracking_id += 1
+                    events.append((EV_ABS, ABS_MT_TRACKING_ID, tracking_id))
+                x = 500 + slot * 600 + i * 20
+                y = 400 + slot * 200 + i * 12
+                events += [(EV_ABS, ABS_MT_POSITION_X, x),
+                           (EV_ABS, ABS_MT_POSITION_Y, y)]
+                if slot == 0:
+                    events += [(EV_ABS, ABS_X, x), (EV_ABS, ABS_Y, y)]
+            if i == 0:
+                events.append((EV_KEY, BTN_TOUCH, 1))
+            d.frame(events, 10000)
+        events = []
+        for slot in range(nfingers):
+            events += [(EV_ABS, ABS_MT_SLOT, slot),
+                       (EV_ABS, ABS_MT_TRACKING_ID, -1)]
+        events.append((EV_KEY, BTN_TOUCH, 0))
+        d.frame(events, 10000)
+        d.time += 300000
+    return d
+
+
+def tablet():
+    d = Device('PGO Training Pen Tablet', [3, 0x56a, 0x374, 0x110],
+               codes={EV_KEY: [BTN_TOOL_PEN, BTN_TOOL_RUBBER, BTN_TOUCH,
+                               BTN_STYLUS, BTN_STYLUS2],
+                      EV_ABS: [ABS_X, ABS_Y, ABS_PRESSURE, ABS_DISTANCE,
+                               ABS_TILT_X, ABS_TILT_Y],
+                      EV_MSC: [MSC_SERIAL]},
+               absinfo={ABS_X: [0, 15200, 4, 0, 100],
+                        ABS_Y: [0, 9500, 4, 0, 100],
+                        ABS_PRESSURE: [0, 4095, 0, 0, 0],
+                        ABS_DISTANCE: [0, 63, 0, 0, 0],
+                        ABS_TILT_X: [-64, 63, 0, 0, 57],
+                        ABS_TILT_Y: [-64, 63, 0, 0, 57]},
+               props=[INPUT_PROP_POINTER])
+    for tool in (BTN_TOOL_PEN, BTN_TOOL_RUBBER, BTN_TOOL_PEN):
+        for i in range(300):
+            x = 3000 + i * 30
+            y = 2000 + round(1500 * math.sin(i / 20))
+            events = [(EV_ABS, ABS_X, x), (EV_ABS, ABS_Y, y),
+                      (EV_ABS, ABS_TILT_X, (i % 40) - 20),
+                      (EV_ABS, ABS_TILT_Y, 10 - (i % 20))]
+            if i == 0:
+                events += [(EV_KEY, tool, 1), (EV_ABS, ABS_DISTANCE, 40)]
+            if 50 <= i < 250:
+                # a stroke with a pressure curve
+                pressure = round(3000 * math.sin((i - 50) * math.pi / 200)) + 50
+                events.append((EV_ABS, ABS_PRESSURE, pressure))
+                if i == 50:
+                    events += [(EV_KEY, BTN_TOUCH, 1),
+                               (EV_ABS, ABS_DISTANCE, 0)]
+            elif i == 250:
+                events += [(EV_KEY, BTN_TOUCH, 0),
+                           (EV_ABS, ABS_PRESSURE, 0),
+                           (EV_ABS, ABS_DISTANCE, 20)]
+            if i in (270, 280):
+                events.append((EV_KEY, BTN_STYLUS, 1 if i == 270 else 0))
+            events.append((EV_MSC, MSC_SERIAL, 0x12345678))
+            d.frame(events, 5000)
+        d.frame([(EV_KEY, tool, 0), (EV_ABS, ABS_X, 0), (EV_ABS, ABS_Y, 0),
+                 (EV_ABS, ABS_TILT_X, 0), (EV_ABS, ABS_TILT_Y, 0),
+                 (EV_ABS, ABS_DISTANCE, 0),
+                 (EV_MSC, MSC_SERIAL, 0x12345678)], 5000)
+        d.time += 500000
+    return d
+
+
+WORKLOADS = {
+    'mouse': mouse,
+    'keyboard': keyboard,
+    'touchpad': touchpad,
+    'touchscreen': touchscreen,
+    'tablet': tablet,
+}
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Run the profile-guided optimization training workload')
+    parser.add_argument('--benchmark', required=True,
+                        help='path to the libinput-benchmark tool')
+    parser.add_argument('--outdir', required=True,
+                        help='directory for the generated recordings')
+    parser.add_argument('--iterations', type=int, default=20,
+                        help='replays per recording (default: 20)')
+    parser.add_argument('--recording', action='append', default=[],
+                        help='an additional recording to replay')
+    parser.add_argument('--generate-only', action='store_true',
+                        help='only write the recordings')
+    args = parser.parse_args()
+
+    if args.iterations < 1:
+        parser.error('--iterations must be at least 1')
+
+    os.makedirs(args.outdir, exist_ok=True)
+    recordings = []
+    for name, workload in sorted(WORKLOADS.items()):
+        path = os.path.join(args.outdir, '{}.yml'.format(name))
+        workload().write(path)
+        recordings.append(path)
+    recordings += args.recording
+
+    if args.generate_only:
+        return
+
+    if os.geteuid() != 0:
+        print('Error: the training replays through uinput devices and must run as root',
+              file=sys.stderr)
+        sys.exit(1)
+
+    for path in recordings:
+        print('Training with {}'.format(path))
+        subprocess.run([args.benchmark, '--no-stages',
+                        '--iterations={}'.format(args.iterations), path],
+                       stdout=subprocess.DEVNULL, check=True)
+
+
+if __name__ == '__main__':
+    try:
+        main()
+    except subprocess.CalledProcessError as e:
+        print('Error: {}'.format(e), file=sys.stderr)
+        sys.exit(1)
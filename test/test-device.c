@@ -452,6 +452,378 @@ START_TEST(device_reenable_device_removed)
 }
 END_TEST
 
+START_TEST(device_replug_config)
+{
+	struct libinput *li;
+	struct litest_device *dev;
+	struct libinput_device *device;
+	enum libinput_config_status status;
+
+	li = litest_create_context();
+	libinput_set_replug_timeout(li, 60000);
+	ck_assert_int_eq(libinput_get_replug_timeout(li), 60000);
+
+	dev = litest_add_device(li, LITEST_MOUSE);
+	device = dev->libinput_device;
+	status = libinput_device_config_left_handed_set(device, 1);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	status = libinput_device_config_accel_set_speed(device, 0.5);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	litest_drain_events(li);
+
+	litest_delete_device(dev);
+	litest_drain_events(li);
+
+	/* Same identity, the configuration comes back */
+	dev = litest_add_device(li, LITEST_MOUSE);
+	device = dev->libinput_device;
+	ck_assert_int_eq(libinput_device_config_left_handed_get(device), 1);
+	ck_assert_double_eq(libinput_device_config_accel_get_speed(device),
+			    0.5);
+	litest_drain_events(li);
+
+	/* Disabling the cache forgets the removed device */
+	litest_delete_device(dev);
+	litest_drain_events(li);
+	libinput_set_replug_timeout(li, 0);
+
+	dev = litest_add_device(li, LITEST_MOUSE);
+	device = dev->libinput_device;
+	ck_assert_int_eq(libinput_device_config_left_handed_get(device), 0);
+	ck_assert_double_eq(libinput_device_config_accel_get_speed(device),
+			    0.0);
+
+	litest_delete_device(dev);
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(device_removed_events_keep_device)
+{
+	struct libinput *li;
+	struct litest_device *dev;
+	struct libinput_device *device = NULL;
+	struct libinput_event *events[16];
+	size_t nevents, i;
+
+	li = litest_create_context();
+	dev = litest_add_device(li, LITEST_MOUSE);
+	litest_drain_events(li);
+
+	for (i = 0; i < 3; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	litest_delete_device(dev);
+	libinput_dispatch(li);
+
+	/* Events don't hold a device ref, but the device must stay valid
+	 * for as long as any of its events exist */
+	nevents = libinput_get_events(li, events, ARRAY_LENGTH(events));
+	ck_assert_int_ge(nevents, 2);
+	ck_assert_int_eq(libinput_event_get_type(events[nevents - 1]),
+			 LIBINPUT_EVENT_DEVICE_REMOVED);
+
+	for (i = 0; i < nevents; i++) {
+		struct libinput_device *d = libinput_event_get_device(events[i]);
+
+		ck_assert_notnull(libinput_device_get_sysname(d));
+		if (libinput_event_get_type(events[i]) ==
+		    LIBINPUT_EVENT_DEVICE_REMOVED)
+			device = libinput_device_ref(d);
+	}
+
+	libinput_events_destroy(events, nevents);
+
+	ck_assert_notnull(device);
+	ck_assert_notnull(libinput_device_get_sysname(device));
+	ck_assert(libinput_device_unref(device) == NULL);
+
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(device_latency_tracking)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput *li = dev->libinput;
+	uint64_t p50, p99, max;
+	int i;
+
+	ck_assert_int_eq(libinput_device_get_latency_tracking(device), 0);
+	libinput_device_set_latency_tracking(device, 1);
+	ck_assert_int_eq(libinput_device_get_latency_tracking(device), 1);
+	litest_drain_events(li);
+
+	/* the frames sit in the kernel for at least 10ms */
+	for (i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	msleep(10);
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_device_get_latency_stats(device,
+							   LIBINPUT_LATENCY_STAT_SAMPLES),
+			 5);
+	p50 = libinput_device_get_latency_stats(device, LIBINPUT_LATENCY_STAT_P50);
+	p99 = libinput_device_get_latency_stats(device, LIBINPUT_LATENCY_STAT_P99);
+	max = libinput_device_get_latency_stats(device, LIBINPUT_LATENCY_STAT_MAX);
+	ck_assert_int_ge(p50, 10000);
+	ck_assert_int_le(p50, p99);
+	ck_assert_int_le(p99, max);
+
+	/* no more samples while disabled */
+	libinput_device_set_latency_tracking(device, 0);
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_device_get_latency_stats(device,
+							   LIBINPUT_LATENCY_STAT_SAMPLES),
+			 5);
+
+	/* enabling again starts from scratch */
+	libinput_device_set_latency_tracking(device, 1);
+	ck_assert_int_eq(libinput_device_get_latency_stats(device,
+							   LIBINPUT_LATENCY_STAT_SAMPLES),
+			 0);
+	ck_assert_int_eq(libinput_device_get_latency_stats(device,
+							   LIBINPUT_LATENCY_STAT_MAX),
+			 0);
+}
+END_TEST
+
+START_TEST(device_stats)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput *li = dev->libinput;
+	uint64_t events, frames, motion, total;
+	int i;
+
+	litest_drain_events(li);
+
+	events = libinput_device_get_stats(device,
+					   LIBINPUT_DEVICE_STAT_EVDEV_EVENTS);
+	frames = libinput_device_get_stats(device,
+					   LIBINPUT_DEVICE_STAT_EVDEV_FRAMES);
+	total = libinput_device_get_stats(device, LIBINPUT_DEVICE_STAT_EVENTS);
+	motion = libinput_device_get_event_count(device,
+						 LIBINPUT_EVENT_POINTER_MOTION);
+
+	for (i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_device_get_stats(device,
+						   LIBINPUT_DEVICE_STAT_EVDEV_EVENTS),
+			 events + 10);
+	ck_assert_int_eq(libinput_device_get_stats(device,
+						   LIBINPUT_DEVICE_STAT_EVDEV_FRAMES),
+			 frames + 5);
+	ck_assert_int_eq(libinput_device_get_stats(device,
+						   LIBINPUT_DEVICE_STAT_EVENTS),
+			 total + 5);
+	ck_assert_int_eq(libinput_device_get_event_count(device,
+							 LIBINPUT_EVENT_POINTER_MOTION),
+			 motion + 5);
+	ck_assert_int_eq(libinput_device_get_stats(device,
+						   LIBINPUT_DEVICE_STAT_SYN_DROPPED),
+			 0);
+
+	/* invalid values */
+	ck_assert_int_eq(libinput_device_get_stats(device, 1000), 0);
+	ck_assert_int_eq(libinput_device_get_event_count(device,
+							 LIBINPUT_EVENT_NONE + 99),
+			 0);
+	ck_assert_int_eq(libinput_device_get_event_count(device, 10000), 0);
+}
+END_TEST
+
+START_TEST(device_syn_dropped_backlog_order)
+{
+	struct libinput *li;
+	struct litest_device *keyboard, *mouse;
+	struct libinput_event *event;
+	bool c_pressed = false, mouse_released = false;
+	int b_down = 0;
+
+	li = litest_create_context();
+	keyboard = litest_add_device(li, LITEST_KEYBOARD);
+	mouse = litest_add_device(li, LITEST_MOUSE);
+	litest_drain_events(li);
+
+	/* 80 events, more than one read buffer but less than the
+	 * kernel buffer: the mouse is backlogged but nothing is lost */
+	for (int i = 0; i < 40; i++) {
+		litest_event(mouse, EV_REL, REL_X, 1);
+		litest_event(mouse, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	/* The keyboard's fd becomes readable first but the mouse's
+	 * events must be processed first */
+	litest_keyboard_key(keyboard, KEY_A, true);
+	litest_event(mouse, EV_KEY, BTN_LEFT, 1);
+	litest_event(mouse, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_assert_key_event(li, KEY_A, LIBINPUT_KEY_STATE_PRESSED);
+	litest_assert_empty_queue(li);
+
+	/* Force a SYN_DROPPED, KEY_C only comes from the resync */
+	for (int i = 0; i < 500; i++) {
+		litest_keyboard_key(keyboard, KEY_B, true);
+		litest_keyboard_key(keyboard, KEY_B, false);
+	}
+	litest_keyboard_key(keyboard, KEY_C, true);
+	litest_event(mouse, EV_KEY, BTN_LEFT, 0);
+	litest_event(mouse, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	ck_assert_int_gt(libinput_device_get_stats(keyboard->libinput_device,
+						   LIBINPUT_DEVICE_STAT_SYN_DROPPED),
+			 0);
+
+	/* Every KEY_B press is paired with its release and the resync
+	 * comes after everything read before the SYN_DROPPED */
+	while ((event = libinput_get_event(li))) {
+		struct libinput_event_keyboard *kev;
+		struct libinput_event_pointer *pev;
+		enum libinput_key_state state;
+
+		switch (libinput_event_get_type(event)) {
+		case LIBINPUT_EVENT_KEYBOARD_KEY:
+			kev = libinput_event_get_keyboard_event(event);
+			state = libinput_event_keyboard_get_key_state(kev);
+			ck_assert(!c_pressed);
+			switch (libinput_event_keyboard_get_key(kev)) {
+			case KEY_B:
+				if (state == LIBINPUT_KEY_STATE_PRESSED)
+					b_down++;
+				else
+					b_down--;
+				ck_assert_int_ge(b_down, 0);
+				ck_assert_int_le(b_down, 1);
+				break;
+			case KEY_C:
+				ck_assert_int_eq(state,
+						 LIBINPUT_KEY_STATE_PRESSED);
+				c_pressed = true;
+				break;
+			default:
+				litest_abort_msg("Unexpected key %d\n",
+						 libinput_event_keyboard_get_key(kev));
+			}
+			break;
+		case LIBINPUT_EVENT_POINTER_BUTTON:
+			pev = libinput_event_get_pointer_event(event);
+			ck_assert(!mouse_released);
+			ck_assert_int_eq(libinput_event_pointer_get_button(pev),
+					 BTN_LEFT);
+			ck_assert_int_eq(libinput_event_pointer_get_button_state(pev),
+					 LIBINPUT_BUTTON_STATE_RELEASED);
+			mouse_released = true;
+			break;
+		default:
+			litest_abort_msg("Unexpected event type %d\n",
+					 libinput_event_get_type(event));
+		}
+		libinput_event_destroy(event);
+	}
+
+	ck_assert(c_pressed);
+	ck_assert(mouse_released);
+	ck_assert_int_eq(b_down, 0);
+
+	litest_keyboard_key(keyboard, KEY_A, false);
+	litest_keyboard_key(keyboard, KEY_C, false);
+	litest_drain_events(li);
+
+	litest_delete_device(keyboard);
+	litest_delete_device(mouse);
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(device_motion_prediction)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	uint64_t time = 0;
+	double dx = 0, dy = 0;
+	int i;
+
+	ck_assert_int_eq(libinput_device_get_motion_prediction(device), 0);
+	ck_assert_int_eq(libinput_device_predict_motion(device, 0, &dx, &dy),
+			 -1);
+
+	ck_assert_int_eq(libinput_device_set_motion_prediction(device, 1), 0);
+	ck_assert_int_eq(libinput_device_get_motion_prediction(device), 1);
+	litest_drain_events(li);
+
+	/* no motion yet */
+	ck_assert_int_eq(libinput_device_predict_motion(device, 0, &dx, &dy),
+			 -1);
+
+	for (i = 0; i < 10; i++) {
+		litest_event(dev, EV_REL, REL_X, 5);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		msleep(2);
+		libinput_dispatch(li);
+	}
+
+	while ((event = libinput_get_event(li))) {
+		ptrev = litest_is_motion_event(event);
+		time = libinput_event_pointer_get_time_usec(ptrev);
+		libinput_event_destroy(event);
+	}
+
+	ck_assert_int_eq(libinput_device_predict_motion(device, time + 10000,
+							&dx, &dy),
+			 0);
+	ck_assert_double_gt(dx, 0.0);
+	litest_assert_double_eq(dy, 0.0);
+
+	/* no prediction into the past or too far into the future */
+	ck_assert_int_eq(libinput_device_predict_motion(device, time,
+							&dx, &dy),
+			 0);
+	litest_assert_double_eq(dx, 0.0);
+	ck_assert_int_eq(libinput_device_predict_motion(device, time + s2us(1),
+							&dx, &dy),
+			 0);
+	litest_assert_double_eq(dx, 0.0);
+
+	ck_assert_int_eq(libinput_device_set_motion_prediction(device, 0), 0);
+	ck_assert_int_eq(libinput_device_get_motion_prediction(device), 0);
+	ck_assert_int_eq(libinput_device_predict_motion(device, time + 10000,
+							&dx, &dy),
+			 -1);
+}
+END_TEST
+
+START_TEST(device_motion_prediction_unsupported)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+
+	ck_assert_int_eq(libinput_device_set_motion_prediction(device, 1), -1);
+	ck_assert_int_eq(libinput_device_get_motion_prediction(device), 0);
+}
+END_TEST
+
 START_TEST(device_disable_release_buttons)
 {
 	struct litest_device *dev = litest_current_device();
@@ -853,6 +1225,251 @@ START_TEST(device_group_leak)
 }
 END_TEST
 
+static struct libevdev_uinput *
+create_mouse_with_phys(const char *name, const char *phys)
+{
+	struct libevdev_uinput *uinput;
+	struct libevdev *evdev;
+	int rc;
+
+	evdev = libevdev_new();
+	litest_assert_ptr_notnull(evdev);
+	libevdev_set_name(evdev, name);
+	libevdev_set_id_bustype(evdev, BUS_USB);
+	libevdev_set_id_vendor(evdev, 0x1234);
+	libevdev_set_id_product(evdev, 0x5678);
+	if (phys)
+		libevdev_set_phys(evdev, phys);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_LEFT, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_RIGHT, NULL);
+	libevdev_enable_event_code(evdev, EV_REL, REL_X, NULL);
+	libevdev_enable_event_code(evdev, EV_REL, REL_Y, NULL);
+
+	rc = libevdev_uinput_create_from_device(evdev,
+						LIBEVDEV_UINPUT_OPEN_MANAGED,
+						&uinput);
+	litest_assert_msg(rc == 0, "Failed to create uinput device: %s\n",
+			  strerror(-rc));
+	libevdev_free(evdev);
+
+	return uinput;
+}
+
+START_TEST(device_group_same_phys)
+{
+	struct libinput *li;
+	struct libinput_device *d1, *d2;
+	struct libevdev_uinput *u1, *u2;
+
+	/* Two event nodes of one physical device, e.g. a keyboard's
+	 * multimedia keys */
+	u1 = create_mouse_with_phys("litest group mouse", "usb-0000:00:14.0-1/input0");
+	u2 = create_mouse_with_phys("litest group mouse", "usb-0000:00:14.0-1/input1");
+
+	li = libinput_path_create_context(&simple_interface, NULL);
+	d1 = libinput_path_add_device(li, libevdev_uinput_get_devnode(u1));
+	d2 = libinput_path_add_device(li, libevdev_uinput_get_devnode(u2));
+	ck_assert_notnull(d1);
+	ck_assert_notnull(d2);
+
+	ck_assert_ptr_eq(libinput_device_get_device_group(d1),
+			 libinput_device_get_device_group(d2));
+
+	libinput_unref(li);
+	libevdev_uinput_destroy(u1);
+	libevdev_uinput_destroy(u2);
+}
+END_TEST
+
+START_TEST(device_group_unrelated)
+{
+	struct libinput *li;
+	struct libinput_device *d1, *d2, *d3, *d4;
+	struct libevdev_uinput *u1, *u2, *u3, *u4;
+	struct libinput_device_group *g1, *g2, *g3, *g4;
+
+	u1 = create_mouse_with_phys("litest group mouse", "usb-0000:00:14.0-1/input0");
+	u2 = create_mouse_with_phys("litest group mouse", "usb-0000:00:14.0-2/input0");
+	/* same ids, no phys: nothing says these are one device */
+	u3 = create_mouse_with_phys("litest group mouse", NULL);
+	u4 = create_mouse_with_phys("litest group mouse", NULL);
+
+	li = libinput_path_create_context(&simple_interface, NULL);
+	d1 = libinput_path_add_device(li, libevdev_uinput_get_devnode(u1));
+	d2 = libinput_path_add_device(li, libevdev_uinput_get_devnode(u2));
+	d3 = libinput_path_add_device(li, libevdev_uinput_get_devnode(u3));
+	d4 = libinput_path_add_device(li, libevdev_uinput_get_devnode(u4));
+	ck_assert_notnull(d1);
+	ck_assert_notnull(d2);
+	ck_assert_notnull(d3);
+	ck_assert_notnull(d4);
+
+	g1 = libinput_device_get_device_group(d1);
+	g2 = libinput_device_get_device_group(d2);
+	g3 = libinput_device_get_device_group(d3);
+	g4 = libinput_device_get_device_group(d4);
+	ck_assert_ptr_ne(g1, g2);
+	ck_assert_ptr_ne(g1, g3);
+	ck_assert_ptr_ne(g2, g3);
+	ck_assert_ptr_ne(g3, g4);
+
+	/* Each group only has its own device: once the device is
+	 * removed, our reference is the last one */
+	libinput_device_group_ref(g1);
+	libinput_path_remove_device(d1);
+	ck_assert(libinput_device_group_unref(g1) == NULL);
+
+	libinput_unref(li);
+	libevdev_uinput_destroy(u1);
+	libevdev_uinput_destroy(u2);
+	libevdev_uinput_destroy(u3);
+	libevdev_uinput_destroy(u4);
+}
+END_TEST
+
+static void
+uinput_write_frame(struct libevdev_uinput *uinput,
+		   unsigned int type,
+		   unsigned int code,
+		   int value)
+{
+	libevdev_uinput_write_event(uinput, type, code, value);
+	libevdev_uinput_write_event(uinput, EV_SYN, SYN_REPORT, 0);
+}
+
+START_TEST(device_fallback_keyboard_only)
+{
+	struct libinput *li;
+	struct libinput_device *device;
+	struct libevdev_uinput *uinput;
+
+	uinput = litest_create_uinput_device("test keyboard", NULL,
+					     EV_KEY, KEY_A,
+					     EV_KEY, KEY_B,
+					     EV_KEY, KEY_LEFTSHIFT,
+					     -1);
+
+	li = libinput_path_create_context(&simple_interface, NULL);
+	device = libinput_path_add_device(li,
+					  libevdev_uinput_get_devnode(uinput));
+	ck_assert_notnull(device);
+	ck_assert(libinput_device_has_capability(device,
+						 LIBINPUT_DEVICE_CAP_KEYBOARD));
+	ck_assert(!libinput_device_has_capability(device,
+						  LIBINPUT_DEVICE_CAP_POINTER));
+	litest_drain_events(li);
+
+	uinput_write_frame(uinput, EV_KEY, KEY_A, 1);
+	uinput_write_frame(uinput, EV_KEY, KEY_A, 0);
+	libinput_dispatch(li);
+	litest_assert_key_event(li, KEY_A, LIBINPUT_KEY_STATE_PRESSED);
+	litest_assert_key_event(li, KEY_A, LIBINPUT_KEY_STATE_RELEASED);
+	litest_assert_empty_queue(li);
+
+	libinput_unref(li);
+	libevdev_uinput_destroy(uinput);
+}
+END_TEST
+
+START_TEST(device_fallback_pointer_only)
+{
+	struct libinput *li;
+	struct libinput_device *device;
+	struct libevdev_uinput *uinput;
+
+	uinput = litest_create_uinput_device("test mouse", NULL,
+					     EV_KEY, BTN_LEFT,
+					     EV_KEY, BTN_RIGHT,
+					     EV_REL, REL_X,
+					     EV_REL, REL_Y,
+					     -1);
+
+	li = libinput_path_create_context(&simple_interface, NULL);
+	device = libinput_path_add_device(li,
+					  libevdev_uinput_get_devnode(uinput));
+	ck_assert_notnull(device);
+	ck_assert(libinput_device_has_capability(device,
+						 LIBINPUT_DEVICE_CAP_POINTER));
+	ck_assert(!libinput_device_has_capability(device,
+						  LIBINPUT_DEVICE_CAP_KEYBOARD));
+	litest_drain_events(li);
+
+	for (int i = 0; i < 5; i++)
+		uinput_write_frame(uinput, EV_REL, REL_X, 5);
+	libinput_dispatch(li);
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+
+	uinput_write_frame(uinput, EV_KEY, BTN_LEFT, 1);
+	uinput_write_frame(uinput, EV_KEY, BTN_LEFT, 0);
+	libinput_dispatch(li);
+	litest_timeout_debounce();
+	libinput_dispatch(li);
+	litest_assert_button_event(li, BTN_LEFT, LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_assert_button_event(li, BTN_LEFT, LIBINPUT_BUTTON_STATE_RELEASED);
+	litest_assert_empty_queue(li);
+
+	libinput_unref(li);
+	libevdev_uinput_destroy(uinput);
+}
+END_TEST
+
+START_TEST(device_fallback_keyboard_and_pointer)
+{
+	struct libinput *li;
+	struct libinput_device *device;
+	struct libevdev_uinput *uinput;
+
+	/* e.g. a wireless keyboard with a built-in trackball on one node */
+	uinput = litest_create_uinput_device("test combined", NULL,
+					     EV_KEY, KEY_A,
+					     EV_KEY, KEY_B,
+					     EV_KEY, BTN_LEFT,
+					     EV_KEY, BTN_RIGHT,
+					     EV_REL, REL_X,
+					     EV_REL, REL_Y,
+					     EV_REL, REL_WHEEL,
+					     -1);
+
+	li = libinput_path_create_context(&simple_interface, NULL);
+	device = libinput_path_add_device(li,
+					  libevdev_uinput_get_devnode(uinput));
+	ck_assert_notnull(device);
+	ck_assert(libinput_device_has_capability(device,
+						 LIBINPUT_DEVICE_CAP_POINTER));
+	ck_assert(libinput_device_has_capability(device,
+						 LIBINPUT_DEVICE_CAP_KEYBOARD));
+	litest_drain_events(li);
+
+	uinput_write_frame(uinput, EV_KEY, KEY_A, 1);
+	uinput_write_frame(uinput, EV_KEY, KEY_A, 0);
+	libinput_dispatch(li);
+	litest_assert_key_event(li, KEY_A, LIBINPUT_KEY_STATE_PRESSED);
+	litest_assert_key_event(li, KEY_A, LIBINPUT_KEY_STATE_RELEASED);
+	litest_assert_empty_queue(li);
+
+	for (int i = 0; i < 5; i++)
+		uinput_write_frame(uinput, EV_REL, REL_X, 5);
+	libinput_dispatch(li);
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+
+	uinput_write_frame(uinput, EV_REL, REL_WHEEL, 1);
+	libinput_dispatch(li);
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_AXIS);
+
+	uinput_write_frame(uinput, EV_KEY, BTN_LEFT, 1);
+	uinput_write_frame(uinput, EV_KEY, BTN_LEFT, 0);
+	libinput_dispatch(li);
+	litest_timeout_debounce();
+	libinput_dispatch(li);
+	litest_assert_button_event(li, BTN_LEFT, LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_assert_button_event(li, BTN_LEFT, LIBINPUT_BUTTON_STATE_RELEASED);
+	litest_assert_empty_queue(li);
+
+	libinput_unref(li);
+	libevdev_uinput_destroy(uinput);
+}
+END_TEST
+
 START_TEST(abs_device_no_absx)
 {
 	struct libevdev_uinput *uinput;
@@ -1395,6 +2012,77 @@ START_TEST(device_quirks_logitech_marble_mouse)
 }
 END_TEST
 
+START_TEST(device_disabled_code_not_dispatched)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_evdev_tap_record records[16];
+	bool have_middle = false;
+	size_t n;
+
+	litest_drain_events(li);
+
+	/* BTN_MIDDLE is disabled by a quirk and thus masked in the
+	 * kernel */
+	litest_button_click_debounced(dev, li, BTN_MIDDLE, true);
+	litest_button_click_debounced(dev, li, BTN_MIDDLE, false);
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+
+	litest_button_click_debounced(dev, li, BTN_LEFT, true);
+	litest_button_click_debounced(dev, li, BTN_LEFT, false);
+	litest_assert_button_event(li, BTN_LEFT, LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_assert_button_event(li, BTN_LEFT, LIBINPUT_BUTTON_STATE_RELEASED);
+
+	/* The evdev tap lifts the kernel mask, the dispatch still must
+	 * not see the disabled code */
+	ck_assert_int_eq(libinput_enable_evdev_tap(li, 64), 0);
+	litest_button_click_debounced(dev, li, BTN_MIDDLE, true);
+	litest_button_click_debounced(dev, li, BTN_MIDDLE, false);
+	litest_assert_empty_queue(li);
+
+	n = libinput_evdev_tap_read(li, records, ARRAY_LENGTH(records));
+	for (size_t i = 0; i < n; i++) {
+		if (records[i].type == EV_KEY && records[i].code == BTN_MIDDLE)
+			have_middle = true;
+	}
+	ck_assert(have_middle);
+}
+END_TEST
+
+START_TEST(device_evdev_tap_scancodes)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_evdev_tap_record records[16];
+	bool have_scan = false;
+	size_t n;
+
+	litest_drain_events(li);
+
+	/* MSC_SCAN is masked in the kernel, but a recording needs it */
+	ck_assert_int_eq(libinput_enable_evdev_tap(li, 64), 0);
+	litest_event(dev, EV_MSC, MSC_SCAN, 0x70004);
+	litest_event(dev, EV_KEY, KEY_A, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_event(dev, EV_MSC, MSC_SCAN, 0x70004);
+	litest_event(dev, EV_KEY, KEY_A, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	litest_assert_key_event(li, KEY_A, LIBINPUT_KEY_STATE_PRESSED);
+	litest_assert_key_event(li, KEY_A, LIBINPUT_KEY_STATE_RELEASED);
+	litest_assert_empty_queue(li);
+
+	n = libinput_evdev_tap_read(li, records, ARRAY_LENGTH(records));
+	for (size_t i = 0; i < n; i++) {
+		if (records[i].type == EV_MSC && records[i].code == MSC_SCAN)
+			have_scan = true;
+	}
+	ck_assert(have_scan);
+}
+END_TEST
+
 START_TEST(device_capability_at_least_one)
 {
 	struct litest_device *dev = litest_current_device();
@@ -1562,6 +2250,187 @@ START_TEST(device_button_down_remove)
 }
 END_TEST
 
+START_TEST(device_priority_low)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+
+	/* Switches, pads and hotkey devices via quirks */
+	ck_assert_int_eq(libinput_device_get_priority(device),
+			 LIBINPUT_DEVICE_PRIORITY_LOW);
+
+	ck_assert_int_eq(libinput_device_set_priority(device,
+						      LIBINPUT_DEVICE_PRIORITY_NORMAL),
+			 0);
+	ck_assert_int_eq(libinput_device_get_priority(device),
+			 LIBINPUT_DEVICE_PRIORITY_NORMAL);
+	ck_assert_int_eq(libinput_device_set_priority(device,
+						      LIBINPUT_DEVICE_PRIORITY_LOW),
+			 0);
+	ck_assert_int_eq(libinput_device_get_priority(device),
+			 LIBINPUT_DEVICE_PRIORITY_LOW);
+
+	ck_assert_int_eq(libinput_device_set_priority(device, 2), -1);
+	ck_assert_int_eq(libinput_device_get_priority(device),
+			 LIBINPUT_DEVICE_PRIORITY_LOW);
+}
+END_TEST
+
+START_TEST(device_priority_normal)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+
+	ck_assert_int_eq(libinput_device_get_priority(device),
+			 LIBINPUT_DEVICE_PRIORITY_NORMAL);
+}
+END_TEST
+
+START_TEST(device_save_restore_state)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	char buf[4096] = {0};
+	size_t size;
+
+	size = libinput_device_save_state(device, NULL, 0);
+	if (size == 0) {
+		ck_assert_int_eq(libinput_device_restore_state(device,
+							       buf,
+							       sizeof(buf)),
+				 -EINVAL);
+		return;
+	}
+
+	ck_assert_int_le(size, sizeof(buf));
+
+	/* too small, nothing written */
+	ck_assert_int_eq(libinput_device_save_state(device, buf, size - 1),
+			 size);
+	ck_assert_int_eq(buf[0], 0);
+
+	ck_assert_int_eq(libinput_device_save_state(device, buf, sizeof(buf)),
+			 size);
+	ck_assert_int_eq(libinput_device_restore_state(device, buf, size), 0);
+
+	ck_assert_int_eq(libinput_device_restore_state(device, buf, size - 1),
+			 -EINVAL);
+	ck_assert_int_eq(libinput_device_restore_state(device, buf, size + 1),
+			 -EINVAL);
+	buf[0] = ~buf[0];
+	ck_assert_int_eq(libinput_device_restore_state(device, buf, size),
+			 -EINVAL);
+}
+END_TEST
+
+START_TEST(device_config_snapshot)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *d = dev->libinput_device;
+	struct libinput_config_snapshot s;
+	float matrix[6];
+
+	/* The default is toggled if possible, so the snapshot doesn't just
+	 * contain the defaults */
+	if (libinput_device_config_left_handed_is_available(d))
+		libinput_device_config_left_handed_set(d, 1);
+	if (libinput_device_config_accel_is_available(d))
+		libinput_device_config_accel_set_speed(d, 0.5);
+
+	ck_assert_int_eq(libinput_device_config_get_snapshot(d, &s, sizeof(s)), 0);
+	ck_assert_int_eq(s.version, LIBINPUT_CONFIG_SNAPSHOT_VERSION);
+
+	ck_assert_int_eq(s.tap.finger_count,
+			 libinput_device_config_tap_get_finger_count(d));
+	ck_assert_int_eq(s.tap.enabled,
+			 libinput_device_config_tap_get_enabled(d));
+	ck_assert_int_eq(s.tap.default_enabled,
+			 libinput_device_config_tap_get_default_enabled(d));
+	ck_assert_int_eq(s.tap.button_map,
+			 libinput_device_config_tap_get_button_map(d));
+	ck_assert_int_eq(s.tap.drag,
+			 libinput_device_config_tap_get_drag_enabled(d));
+	ck_assert_int_eq(s.tap.drag_lock,
+			 libinput_device_config_tap_get_drag_lock_enabled(d));
+	ck_assert_int_eq(s.tap.early_commit,
+			 libinput_device_config_tap_get_early_commit_enabled(d));
+
+	ck_assert_int_eq(s.calibration.has_matrix,
+			 libinput_device_config_calibration_has_matrix(d));
+	if (s.calibration.has_matrix) {
+		libinput_device_config_calibration_get_matrix(d, matrix);
+		ck_assert(memcmp(matrix, s.calibration.matrix,
+				 sizeof(matrix)) == 0);
+	}
+
+	ck_assert_int_eq(s.send_events.modes,
+			 libinput_device_config_send_events_get_modes(d));
+	ck_assert_int_eq(s.send_events.mode,
+			 libinput_device_config_send_events_get_mode(d));
+
+	ck_assert_int_eq(s.accel.available,
+			 libinput_device_config_accel_is_available(d));
+	ck_assert_double_eq(s.accel.speed,
+			    libinput_device_config_accel_get_speed(d));
+	ck_assert_double_eq(s.accel.default_speed,
+			    libinput_device_config_accel_get_default_speed(d));
+	ck_assert_int_eq(s.accel.profiles,
+			 libinput_device_config_accel_get_profiles(d));
+	ck_assert_int_eq(s.accel.profile,
+			 libinput_device_config_accel_get_profile(d));
+
+	ck_assert_int_eq(s.natural_scroll.available,
+			 libinput_device_config_scroll_has_natural_scroll(d));
+	ck_assert_int_eq(s.natural_scroll.enabled,
+			 libinput_device_config_scroll_get_natural_scroll_enabled(d));
+	ck_assert_int_eq(s.left_handed.available,
+			 libinput_device_config_left_handed_is_available(d));
+	ck_assert_int_eq(s.left_handed.enabled,
+			 libinput_device_config_left_handed_get(d));
+	ck_assert_int_eq(s.left_handed.default_enabled,
+			 libinput_device_config_left_handed_get_default(d));
+
+	ck_assert_int_eq(s.click.methods,
+			 libinput_device_config_click_get_methods(d));
+	ck_assert_int_eq(s.click.method,
+			 libinput_device_config_click_get_method(d));
+	ck_assert_int_eq(s.middle_emulation.available,
+			 libinput_device_config_middle_emulation_is_available(d));
+	ck_assert_int_eq(s.middle_emulation.enabled,
+			 libinput_device_config_middle_emulation_get_enabled(d));
+
+	ck_assert_int_eq(s.scroll.methods,
+			 libinput_device_config_scroll_get_methods(d));
+	ck_assert_int_eq(s.scroll.method,
+			 libinput_device_config_scroll_get_method(d));
+	ck_assert_int_eq(s.scroll.button,
+			 libinput_device_config_scroll_get_button(d));
+	ck_assert_int_eq(s.scroll.button_lock,
+			 libinput_device_config_scroll_get_button_lock(d));
+
+	ck_assert_int_eq(s.dwt.available,
+			 libinput_device_config_dwt_is_available(d));
+	ck_assert_int_eq(s.dwt.enabled,
+			 libinput_device_config_dwt_get_enabled(d));
+	ck_assert_int_eq(s.low_latency.available,
+			 libinput_device_config_low_latency_is_available(d));
+	ck_assert_int_eq(s.low_latency.enabled,
+			 libinput_device_config_low_latency_get_enabled(d));
+	ck_assert_int_eq(s.rotation.available,
+			 libinput_device_config_rotation_is_available(d));
+	ck_assert_int_eq(s.rotation.angle,
+			 libinput_device_config_rotation_get_angle(d));
+
+	/* A caller with an older, shorter struct only gets its part */
+	memset(&s, 0xab, sizeof(s));
+	ck_assert_int_eq(libinput_device_config_get_snapshot(d, &s,
+							     sizeof(s.version)),
+			 0);
+	ck_assert_int_eq(s.version, LIBINPUT_CONFIG_SNAPSHOT_VERSION);
+	ck_assert_int_eq(s.tap.finger_count, (int)0xabababab);
+}
+END_TEST
+
 TEST_COLLECTION(device)
 {
 	struct range abs_range = { 0, ABS_MISC };
@@ -1583,6 +2452,12 @@ TEST_COLLECTION(device)
 	litest_add("device:sendevents", device_double_enable, LITEST_ANY, LITEST_TABLET);
 	litest_add_no_device("device:sendevents", device_reenable_syspath_changed);
 	litest_add_no_device("device:sendevents", device_reenable_device_removed);
+	litest_add_no_device("device:removed", device_removed_events_keep_device);
+	litest_add_no_device("device:removed", device_replug_config);
+	litest_add_for_device("device:latency", device_latency_tracking, LITEST_MOUSE);
+	litest_add_for_device("device:stats", device_stats, LITEST_MOUSE);
+	litest_add_for_device("device:prediction", device_motion_prediction, LITEST_MOUSE);
+	litest_add_for_device("device:prediction", device_motion_prediction_unsupported, LITEST_KEYBOARD);
 	litest_add_for_device("device:sendevents", device_disable_release_buttons, LITEST_MOUSE);
 	litest_add_for_device("device:sendevents", device_disable_release_keys, LITEST_KEYBOARD);
 	litest_add("device:sendevents", device_disable_release_tap, LITEST_TOUCHPAD, LITEST_ANY);
@@ -1598,6 +2473,14 @@ TEST_COLLECTION(device)
 	litest_add("device:group", device_group_get, LITEST_ANY, LITEST_ANY);
 	litest_add_no_device("device:group", device_group_ref);
 	litest_add_no_device("device:group", device_group_leak);
+	litest_add_no_device("device:group", device_group_same_phys);
+	litest_add_no_device("device:group", device_group_unrelated);
+
+	litest_add_no_device("device:dispatch", device_syn_dropped_backlog_order);
+
+	litest_add_no_device("device:fallback", device_fallback_keyboard_only);
+	litest_add_no_device("device:fallback", device_fallback_pointer_only);
+	litest_add_no_device("device:fallback", device_fallback_keyboard_and_pointer);
 
 	litest_add_no_device("device:invalid devices", abs_device_no_absx);
 	litest_add_no_device("device:invalid devices", abs_device_no_absy);
@@ -1623,6 +2506,8 @@ TEST_COLLECTION(device)
 	litest_add_for_device("device:quirks", device_quirks_cyborg_rat_mode_button, LITEST_CYBORG_RAT);
 	litest_add_for_device("device:quirks", device_quirks_apple_magicmouse, LITEST_MAGICMOUSE);
 	litest_add_for_device("device:quirks", device_quirks_logitech_marble_mouse, LITEST_LOGITECH_TRACKBALL);
+	litest_add_for_device("device:quirks", device_disabled_code_not_dispatched, LITEST_LOGITECH_TRACKBALL);
+	litest_add_for_device("device:evdev tap", device_evdev_tap_scancodes, LITEST_KEYBOARD_BLACKWIDOW);
 
 	litest_add("device:capability", device_capability_at_least_one, LITEST_ANY, LITEST_ANY);
 	litest_add("device:capability", device_capability_check_invalid, LITEST_ANY, LITEST_ANY);
@@ -1639,4 +2524,13 @@ TEST_COLLECTION(device)
 	litest_add("device:seat", device_seat_phys_name, LITEST_ANY, LITEST_ANY);
 
 	litest_add("device:button", device_button_down_remove, LITEST_BUTTON, LITEST_ANY);
+
+	litest_add("device:priority", device_priority_low, LITEST_SWITCH, LITEST_ANY);
+	litest_add("device:priority", device_priority_low, LITEST_TABLET_PAD, LITEST_ANY);
+	litest_add("device:priority", device_priority_normal, LITEST_ANY,
+		   LITEST_SWITCH|LITEST_TABLET_PAD);
+
+	litest_add("device:state", device_save_restore_state, LITEST_ANY, LITEST_ANY);
+
+	litest_add("device:config", device_config_snapshot, LITEST_ANY, LITEST_ANY);
 }
@@ -420,6 +420,58 @@ START_TEST(keyboard_frame_order)
 }
 END_TEST
 
+START_TEST(keyboard_keys_held_across_syn_dropped)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_keyboard *kev;
+
+	litest_drain_events(li);
+
+	litest_keyboard_key(dev, KEY_A, true);
+	libinput_dispatch(li);
+	litest_assert_key_event(li, KEY_A, LIBINPUT_KEY_STATE_PRESSED);
+
+	/* Force a SYN_DROPPED */
+	for (int i = 0; i < 500; i++) {
+		litest_keyboard_key(dev, KEY_B, true);
+		litest_keyboard_key(dev, KEY_B, false);
+	}
+
+	/* still within SYN_DROPPED, only the sync can give us this one */
+	litest_keyboard_key(dev, KEY_C, true);
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	ck_assert_int_gt(libinput_device_get_stats(dev->libinput_device,
+						   LIBINPUT_DEVICE_STAT_SYN_DROPPED),
+			 0);
+
+	/* A must still be down and C must be down as well, otherwise
+	 * their releases are discarded as unpaired */
+	litest_keyboard_key(dev, KEY_A, false);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	kev = litest_is_keyboard_event(event,
+				       KEY_A,
+				       LIBINPUT_KEY_STATE_RELEASED);
+	ck_assert_int_eq(libinput_event_keyboard_get_seat_key_count(kev), 1);
+	libinput_event_destroy(event);
+
+	litest_keyboard_key(dev, KEY_C, false);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	kev = litest_is_keyboard_event(event,
+				       KEY_C,
+				       LIBINPUT_KEY_STATE_RELEASED);
+	ck_assert_int_eq(libinput_event_keyboard_get_seat_key_count(kev), 0);
+	libinput_event_destroy(event);
+
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
 START_TEST(keyboard_leds)
 {
 	struct litest_device *dev = litest_current_device();
@@ -487,6 +539,7 @@ TEST_COLLECTION(keyboard)
 
 	litest_add("keyboard:events", keyboard_no_buttons, LITEST_KEYS, LITEST_ANY);
 	litest_add("keyboard:events", keyboard_frame_order, LITEST_KEYS, LITEST_ANY);
+	litest_add_for_device("keyboard:events", keyboard_keys_held_across_syn_dropped, LITEST_KEYBOARD);
 
 	litest_add("keyboard:leds", keyboard_leds, LITEST_ANY, LITEST_ANY);
 
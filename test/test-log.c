@@ -150,6 +150,111 @@ START_TEST(log_priority)
 }
 END_TEST
 
+static int ring_handler_called;
+
+static void
+ring_handler(struct libinput *libinput,
+	     enum libinput_log_priority priority,
+	     uint64_t time_usec,
+	     const char *message,
+	     void *user_data)
+{
+	ring_handler_called++;
+	litest_assert_ptr_eq(user_data, libinput);
+	litest_assert_notnull(message);
+	litest_assert(strlen(message) > 0);
+	litest_assert_int_ge((int)priority, LIBINPUT_LOG_PRIORITY_DEBUG);
+}
+
+START_TEST(log_ring)
+{
+	struct libinput *li;
+	unsigned int count;
+
+	log_handler_context = NULL;
+	log_handler_called = 0;
+	ring_handler_called = 0;
+
+	li = libinput_path_create_context(&simple_interface, NULL);
+	libinput_log_set_priority(li, LIBINPUT_LOG_PRIORITY_DEBUG);
+	libinput_log_set_handler(li, simple_log_handler);
+	log_handler_context = li;
+
+	ck_assert_int_eq(libinput_log_set_ring(li, 64), 0);
+
+	/* nothing to drain yet */
+	ck_assert_int_eq(libinput_log_ring_drain(li, ring_handler, li), 0);
+
+	libinput_path_add_device(li, "/tmp");
+	ck_assert_int_eq(log_handler_called, 0);
+
+	count = libinput_log_ring_drain(li, ring_handler, li);
+	ck_assert_int_gt(count, 0);
+	ck_assert_int_eq(ring_handler_called, count);
+	ck_assert_int_eq(libinput_log_ring_drain(li, ring_handler, li), 0);
+
+	/* disabled, back to the log handler */
+	ck_assert_int_eq(libinput_log_set_ring(li, 0), 0);
+	libinput_path_add_device(li, "/tmp");
+	ck_assert_int_gt(log_handler_called, 0);
+	ck_assert_int_eq(libinput_log_ring_drain(li, ring_handler, li), 0);
+
+	libinput_unref(li);
+
+	log_handler_context = NULL;
+	log_handler_called = 0;
+}
+END_TEST
+
+static int ring_lost_handler_called;
+
+static void
+ring_lost_handler(struct libinput *libinput,
+		  enum libinput_log_priority priority,
+		  uint64_t time_usec,
+		  const char *message,
+		  void *user_data)
+{
+	/* the first message tells us about the lost ones */
+	if (ring_lost_handler_called++ == 0)
+		litest_assert_notnull(strstr(message, "were lost"));
+}
+
+START_TEST(log_ring_overflow)
+{
+	struct libinput *li;
+
+	ring_lost_handler_called = 0;
+
+	li = libinput_path_create_context(&simple_interface, NULL);
+	libinput_log_set_priority(li, LIBINPUT_LOG_PRIORITY_DEBUG);
+	ck_assert_int_eq(libinput_log_set_ring(li, 1), 0);
+
+	libinput_path_add_device(li, "/tmp");
+	libinput_path_add_device(li, "/tmp");
+
+	ck_assert_int_eq(libinput_log_ring_drain(li, ring_lost_handler, NULL), 2);
+	ck_assert_int_eq(ring_lost_handler_called, 2);
+
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(log_ring_invalid_size)
+{
+	struct libinput *li;
+
+	li = libinput_path_create_context(&simple_interface, NULL);
+	litest_set_log_handler_bug(li);
+
+	ck_assert_int_eq(libinput_log_set_ring(li, 3), -1);
+	ck_assert_int_eq(libinput_log_set_ring(li, 1000), -1);
+
+	litest_restore_log_handler(li);
+	libinput_unref(li);
+}
+END_TEST
+
 static int axisrange_log_handler_called = 0;
 
 static void
@@ -208,8 +313,10 @@ TEST_COLLECTION(log)
 	litest_add_deviceless("log:logging", log_handler_invoked);
 	litest_add_deviceless("log:logging", log_handler_NULL);
 	litest_add_no_device("log:logging", log_priority);
+	litest_add_deviceless("log:ring", log_ring);
+	litest_add_deviceless("log:ring", log_ring_overflow);
+	litest_add_deviceless("log:ring", log_ring_invalid_size);
 
-	/* mtdev clips to axis ranges */
-	litest_add_ranged("log:warnings", log_axisrange_warning, LITEST_TOUCH, LITEST_PROTOCOL_A, &axes);
+	litest_add_ranged("log:warnings", log_axisrange_warning, LITEST_TOUCH, LITEST_ANY, &axes);
 	litest_add_ranged("log:warnings", log_axisrange_warning, LITEST_TOUCHPAD, LITEST_ANY, &axes);
 }
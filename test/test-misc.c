@@ -26,6 +26,12 @@
 #include <check.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include <libinput.h>
 #include <libinput-util.h>
 #include <unistd.h>
@@ -581,6 +587,1994 @@ START_TEST(config_status_string)
 }
 END_TEST
 
+START_TEST(event_cache_recycling)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	uint64_t hits, misses;
+
+	litest_drain_events(li);
+
+	litest_button_click_debounced(dev, li, BTN_LEFT, true);
+	litest_button_click_debounced(dev, li, BTN_LEFT, false);
+	litest_drain_events(li);
+
+	hits = libinput_get_statistic(li, LIBINPUT_STATISTIC_EVENT_CACHE_HITS);
+	misses = libinput_get_statistic(li, LIBINPUT_STATISTIC_EVENT_CACHE_MISSES);
+	ck_assert_int_gt(misses, 0);
+	ck_assert_int_gt(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_EVENT_CACHE_PEAK),
+			 0);
+
+	/* The previous button events are in the cache now, so these must
+	 * be recycled */
+	litest_button_click_debounced(dev, li, BTN_LEFT, true);
+	litest_button_click_debounced(dev, li, BTN_LEFT, false);
+	litest_drain_events(li);
+
+	ck_assert_int_gt(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_EVENT_CACHE_HITS),
+			 hits);
+	ck_assert_int_eq(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_EVENT_CACHE_MISSES),
+			 misses);
+}
+END_TEST
+
+START_TEST(event_batch_drain)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *events[16];
+	struct libinput_event *event;
+	size_t nevents;
+	int i;
+
+	litest_drain_events(li);
+
+	for (i = 0; i < 5; i++) {
+		litest_button_click_debounced(dev, li, BTN_LEFT, true);
+		litest_button_click_debounced(dev, li, BTN_LEFT, false);
+	}
+	libinput_dispatch(li);
+
+	nevents = libinput_get_events(li, events, 0);
+	ck_assert_int_eq(nevents, 0);
+
+	/* Partial drain first, then the remainder */
+	nevents = libinput_get_events(li, events, 3);
+	ck_assert_int_eq(nevents, 3);
+	for (i = 0; i < 3; i++) {
+		struct libinput_event_pointer *p;
+
+		p = litest_is_button_event(events[i],
+					   BTN_LEFT,
+					   i % 2 ?
+					   LIBINPUT_BUTTON_STATE_RELEASED :
+					   LIBINPUT_BUTTON_STATE_PRESSED);
+		ck_assert_notnull(p);
+	}
+	libinput_events_destroy(events, nevents);
+
+	nevents = libinput_get_events(li, events, ARRAY_LENGTH(events));
+	ck_assert_int_eq(nevents, 7);
+	for (i = 0; i < 7; i++) {
+		struct libinput_event_pointer *p;
+
+		p = litest_is_button_event(events[i],
+					   BTN_LEFT,
+					   i % 2 ?
+					   LIBINPUT_BUTTON_STATE_PRESSED :
+					   LIBINPUT_BUTTON_STATE_RELEASED);
+		ck_assert_notnull(p);
+	}
+	libinput_events_destroy(events, nevents);
+
+	nevents = libinput_get_events(li, events, ARRAY_LENGTH(events));
+	ck_assert_int_eq(nevents, 0);
+	event = libinput_get_event(li);
+	ck_assert(event == NULL);
+}
+END_TEST
+
+START_TEST(event_prioritized)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct litest_device *keyboard;
+	struct libinput_event *event;
+	int motion = 0;
+	int i;
+
+	keyboard = litest_add_device(li, LITEST_KEYBOARD);
+	litest_drain_events(li);
+
+	for (i = 0; i < 10; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+	litest_keyboard_key(keyboard, KEY_A, true);
+	libinput_dispatch(li);
+	litest_button_click_debounced(dev, li, BTN_LEFT, true);
+	libinput_dispatch(li);
+
+	/* the key jumps the mouse's queue */
+	event = libinput_get_event_prioritized(li);
+	litest_is_keyboard_event(event, KEY_A, LIBINPUT_KEY_STATE_PRESSED);
+	libinput_event_destroy(event);
+
+	/* the button does not jump its own device's motion */
+	while ((event = libinput_get_event_prioritized(li)) &&
+	       libinput_event_get_type(event) == LIBINPUT_EVENT_POINTER_MOTION) {
+		motion++;
+		libinput_event_destroy(event);
+	}
+	ck_assert_int_gt(motion, 0);
+	litest_is_button_event(event, BTN_LEFT, LIBINPUT_BUTTON_STATE_PRESSED);
+	libinput_event_destroy(event);
+
+	ck_assert(libinput_get_event_prioritized(li) == NULL);
+
+	litest_delete_device(keyboard);
+}
+END_TEST
+
+struct quiescence_data {
+	int calls;
+	int quiescent;
+};
+
+static void
+quiescence_handler(struct libinput *libinput, int quiescent, void *user_data)
+{
+	struct quiescence_data *data = user_data;
+
+	data->calls++;
+	data->quiescent = quiescent;
+}
+
+START_TEST(context_quiescence)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct quiescence_data data = { 0, -1 };
+
+	litest_drain_events(li);
+	litest_timeout_debounce();
+	libinput_dispatch(li);
+	ck_assert_int_eq(libinput_is_quiescent(li), 1);
+
+	libinput_set_quiescence_handler(li, quiescence_handler, &data);
+	libinput_dispatch(li);
+	ck_assert_int_eq(data.calls, 0);
+
+	litest_button_click_debounced(dev, li, BTN_LEFT, true);
+	ck_assert_int_eq(libinput_is_quiescent(li), 0);
+	ck_assert_int_eq(data.calls, 1);
+	ck_assert_int_eq(data.quiescent, 0);
+
+	litest_button_click_debounced(dev, li, BTN_LEFT, false);
+	ck_assert_int_eq(libinput_is_quiescent(li), 1);
+	ck_assert_int_eq(data.calls, 2);
+	ck_assert_int_eq(data.quiescent, 1);
+
+	libinput_set_quiescence_handler(li, NULL, NULL);
+	litest_button_click_debounced(dev, li, BTN_LEFT, true);
+	litest_button_click_debounced(dev, li, BTN_LEFT, false);
+	ck_assert_int_eq(data.calls, 2);
+
+	litest_drain_events(li);
+}
+END_TEST
+
+START_TEST(event_queue_presize)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	uint64_t size;
+	int ntouches;
+
+	ntouches = libinput_device_touch_get_touch_count(dev->libinput_device);
+	ck_assert_int_gt(ntouches, 1);
+
+	/* sized for a few frames of all touches before the first event */
+	size = libinput_get_statistic(li, LIBINPUT_STATISTIC_EVENT_QUEUE_SIZE);
+	ck_assert_int_ge(size, 8 * (ntouches + 1));
+	ck_assert_int_eq(size & (size - 1), 0);
+
+	litest_drain_events(li);
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+	ck_assert_int_eq(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_EVENT_QUEUE_SIZE),
+			 size);
+	litest_drain_events(li);
+}
+END_TEST
+
+START_TEST(event_queue_shrink)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	uint64_t size, initial_size;
+	int i;
+
+	litest_drain_events(li);
+	initial_size = libinput_get_statistic(li,
+					      LIBINPUT_STATISTIC_EVENT_QUEUE_SIZE);
+
+	for (i = 0; i < 100; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	size = libinput_get_statistic(li, LIBINPUT_STATISTIC_EVENT_QUEUE_SIZE);
+	ck_assert_int_ge(size, 64);
+
+	litest_drain_events(li);
+
+	/* The queue shrinks gradually once it's been idle for a while */
+	for (i = 0; i < 1000; i++) {
+		libinput_dispatch(li);
+		size = libinput_get_statistic(li,
+					      LIBINPUT_STATISTIC_EVENT_QUEUE_SIZE);
+		if (size == initial_size)
+			break;
+	}
+	ck_assert_int_eq(size, initial_size);
+	ck_assert_int_gt(i, 64);
+
+	ck_assert_int_eq(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_EVENTS_DROPPED),
+			 0);
+}
+END_TEST
+
+static uint64_t ticking_clock_now;
+
+static uint64_t
+ticking_clock(struct libinput *libinput, void *user_data)
+{
+	ticking_clock_now += 1000;
+	return ticking_clock_now;
+}
+
+START_TEST(event_queue_time_fresh)
+{
+	struct libinput *li;
+	struct litest_device *dev;
+	struct libinput_event *event;
+	uint64_t last = 0;
+	int i;
+
+	ticking_clock_now = s2us(1000);
+
+	li = litest_create_context();
+	ck_assert_int_eq(libinput_set_clock(li, ticking_clock, NULL), 0);
+	dev = litest_add_device(li, LITEST_MOUSE);
+	litest_drain_events(li);
+
+	libinput_set_queue_latency_tracking(li, 1);
+
+	/* All from the same source dispatch, each event gets its own
+	 * queue time and not the time the dispatch started */
+	for (i = 0; i < 3; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	for (i = 0; i < 3; i++) {
+		uint64_t queued;
+
+		event = libinput_get_event(li);
+		litest_is_motion_event(event);
+		queued = libinput_event_get_queue_time_usec(event);
+		ck_assert_int_gt(queued, last);
+		last = queued;
+		libinput_event_destroy(event);
+	}
+
+	litest_delete_device(dev);
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(event_queue_latency)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	uint64_t p50, p99, max;
+	int i;
+
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_get_queue_latency_tracking(li), 0);
+
+	/* not tracked by default */
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	ck_assert_notnull(event);
+	ck_assert_int_eq(libinput_event_get_queue_time_usec(event), 0);
+	libinput_event_destroy(event);
+	ck_assert_int_eq(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_QUEUE_LATENCY_SAMPLES),
+			 0);
+
+	libinput_set_queue_latency_tracking(li, 1);
+	ck_assert_int_ne(libinput_get_queue_latency_tracking(li), 0);
+
+	for (i = 0; i < 10; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+	msleep(5);
+
+	while ((event = libinput_get_event(li))) {
+		ck_assert_int_ne(libinput_event_get_queue_time_usec(event), 0);
+		libinput_event_destroy(event);
+	}
+
+	ck_assert_int_eq(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_QUEUE_LATENCY_SAMPLES),
+			 10);
+	ck_assert_int_ge(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_EVENT_QUEUE_PEAK),
+			 10);
+
+	p50 = libinput_get_statistic(li, LIBINPUT_STATISTIC_QUEUE_LATENCY_P50);
+	p99 = libinput_get_statistic(li, LIBINPUT_STATISTIC_QUEUE_LATENCY_P99);
+	max = libinput_get_statistic(li, LIBINPUT_STATISTIC_QUEUE_LATENCY_MAX);
+	ck_assert_int_ge(max, ms2us(5));
+	ck_assert_int_le(p50, p99);
+	ck_assert_int_le(p99, max);
+
+	libinput_set_queue_latency_tracking(li, 0);
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_QUEUE_LATENCY_SAMPLES),
+			 10);
+}
+END_TEST
+
+START_TEST(event_type_disabled)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	int rc;
+
+	litest_drain_events(li);
+
+	ck_assert_int_ne(libinput_device_get_event_type_enabled(device,
+								LIBINPUT_EVENT_POINTER_MOTION),
+			 0);
+	rc = libinput_device_set_event_type_enabled(device,
+						    LIBINPUT_EVENT_POINTER_MOTION,
+						    0);
+	ck_assert_int_eq(rc, 0);
+	ck_assert_int_eq(libinput_device_get_event_type_enabled(device,
+								LIBINPUT_EVENT_POINTER_MOTION),
+			 0);
+
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+
+	litest_button_click_debounced(dev, li, BTN_LEFT, true);
+	litest_button_click_debounced(dev, li, BTN_LEFT, false);
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_BUTTON);
+
+	ck_assert_int_eq(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_EVENTS_FILTERED),
+			 1);
+
+	/* the context setting overrides all devices */
+	rc = libinput_set_event_type_enabled(li,
+					     LIBINPUT_EVENT_POINTER_MOTION,
+					     1);
+	ck_assert_int_eq(rc, 0);
+	ck_assert_int_ne(libinput_device_get_event_type_enabled(device,
+								LIBINPUT_EVENT_POINTER_MOTION),
+			 0);
+
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+
+	litest_disable_log_handler(li);
+	rc = libinput_device_set_event_type_enabled(device,
+						    LIBINPUT_EVENT_DEVICE_REMOVED,
+						    0);
+	ck_assert_int_eq(rc, -1);
+	rc = libinput_set_event_type_enabled(li, 1234, 0);
+	ck_assert_int_eq(rc, -1);
+	litest_restore_log_handler(li);
+	ck_assert_int_ne(libinput_device_get_event_type_enabled(device,
+								LIBINPUT_EVENT_DEVICE_REMOVED),
+			 0);
+}
+END_TEST
+
+START_TEST(event_type_disabled_seat_button_count)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct litest_device *other;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	int rc;
+
+	other = litest_add_device(li, LITEST_MOUSE);
+	litest_drain_events(li);
+
+	rc = libinput_device_set_event_type_enabled(dev->libinput_device,
+						    LIBINPUT_EVENT_POINTER_BUTTON,
+						    0);
+	ck_assert_int_eq(rc, 0);
+
+	/* The filtered button still counts for the seat */
+	litest_button_click_debounced(dev, li, BTN_LEFT, true);
+	litest_assert_empty_queue(li);
+
+	litest_button_click_debounced(other, li, BTN_LEFT, true);
+	event = libinput_get_event(li);
+	ptrev = litest_is_button_event(event,
+				       BTN_LEFT,
+				       LIBINPUT_BUTTON_STATE_PRESSED);
+	ck_assert_int_eq(libinput_event_pointer_get_seat_button_count(ptrev), 2);
+	libinput_event_destroy(event);
+
+	litest_button_click_debounced(dev, li, BTN_LEFT, false);
+	litest_assert_empty_queue(li);
+
+	litest_button_click_debounced(other, li, BTN_LEFT, false);
+	event = libinput_get_event(li);
+	ptrev = litest_is_button_event(event,
+				       BTN_LEFT,
+				       LIBINPUT_BUTTON_STATE_RELEASED);
+	ck_assert_int_eq(libinput_event_pointer_get_seat_button_count(ptrev), 0);
+	libinput_event_destroy(event);
+
+	libinput_device_set_event_type_enabled(dev->libinput_device,
+					       LIBINPUT_EVENT_POINTER_BUTTON,
+					       1);
+	litest_delete_device(other);
+}
+END_TEST
+
+START_TEST(dispatch_budget)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct litest_device *keyboard;
+	struct libinput_event *event;
+	int motion = 0, key = 0;
+	int i;
+
+	keyboard = litest_add_device(li, LITEST_KEYBOARD);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_get_dispatch_budget(li), 0);
+	libinput_set_dispatch_budget(li, 2);
+	ck_assert_int_eq(libinput_get_dispatch_budget(li), 2);
+
+	for (i = 0; i < 10; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	litest_keyboard_key(keyboard, KEY_A, true);
+
+	/* The mouse gets cut off after two frames, the keyboard event
+	 * goes through in the same dispatch */
+	libinput_dispatch(li);
+	while ((event = libinput_get_event(li))) {
+		switch (libinput_event_get_type(event)) {
+		case LIBINPUT_EVENT_POINTER_MOTION:
+			motion++;
+			break;
+		case LIBINPUT_EVENT_KEYBOARD_KEY:
+			key++;
+			break;
+		default:
+			litest_abort_msg("Unexpected event type");
+			break;
+		}
+		libinput_event_destroy(event);
+	}
+	ck_assert_int_eq(motion, 2);
+	ck_assert_int_eq(key, 1);
+
+	/* The rest arrives over the next dispatches without new data on
+	 * the fd */
+	for (i = 0; i < 10 && motion < 10; i++) {
+		libinput_dispatch(li);
+		while ((event = libinput_get_event(li))) {
+			litest_is_motion_event(event);
+			motion++;
+			libinput_event_destroy(event);
+		}
+	}
+	ck_assert_int_eq(motion, 10);
+	ck_assert_int_eq(i, 4);
+
+	libinput_set_dispatch_budget(li, 0);
+	litest_keyboard_key(keyboard, KEY_A, false);
+	litest_drain_events(li);
+	litest_delete_device(keyboard);
+}
+END_TEST
+
+START_TEST(dispatch_frame_merging)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct litest_device *keyboard;
+	struct libinput_event *event;
+	enum libinput_event_type expected[] = {
+		LIBINPUT_EVENT_POINTER_MOTION,
+		LIBINPUT_EVENT_KEYBOARD_KEY,
+		LIBINPUT_EVENT_POINTER_MOTION,
+		LIBINPUT_EVENT_KEYBOARD_KEY,
+		LIBINPUT_EVENT_POINTER_MOTION,
+	};
+	size_t i;
+
+	keyboard = litest_add_device(li, LITEST_KEYBOARD);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_get_frame_merging(li), 0);
+	libinput_set_frame_merging(li, 1);
+	ck_assert_int_ne(libinput_get_frame_merging(li), 0);
+
+	/* one ms apart so the kernel timestamps differ */
+	for (i = 0; i < ARRAY_LENGTH(expected); i++) {
+		if (expected[i] == LIBINPUT_EVENT_POINTER_MOTION) {
+			litest_event(dev, EV_REL, REL_X, 1);
+			litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		} else {
+			litest_keyboard_key(keyboard, KEY_A, i == 1);
+		}
+		msleep(1);
+	}
+
+	libinput_dispatch(li);
+	for (i = 0; i < ARRAY_LENGTH(expected); i++) {
+		event = libinput_get_event(li);
+		litest_assert_notnull(event);
+		litest_assert_event_type(event, expected[i]);
+		libinput_event_destroy(event);
+	}
+	litest_assert_empty_queue(li);
+
+	libinput_set_frame_merging(li, 0);
+	litest_delete_device(keyboard);
+}
+END_TEST
+
+START_TEST(dispatch_low_priority)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct litest_device *sw;
+	struct libinput_event *event;
+	int merging;
+
+	sw = litest_add_device(li, LITEST_LID_SWITCH);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_device_get_priority(sw->libinput_device),
+			 LIBINPUT_DEVICE_PRIORITY_LOW);
+
+	for (merging = 0; merging <= 1; merging++) {
+		libinput_set_frame_merging(li, merging);
+
+		/* The switch is processed last even though its event
+		 * happened first */
+		litest_switch_action(sw,
+				     LIBINPUT_SWITCH_LID,
+				     merging ? LIBINPUT_SWITCH_STATE_OFF :
+					       LIBINPUT_SWITCH_STATE_ON);
+		msleep(1);
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+
+		libinput_dispatch(li);
+		event = libinput_get_event(li);
+		litest_assert_event_type(event, LIBINPUT_EVENT_POINTER_MOTION);
+		libinput_event_destroy(event);
+		event = libinput_get_event(li);
+		litest_assert_event_type(event, LIBINPUT_EVENT_SWITCH_TOGGLE);
+		libinput_event_destroy(event);
+		litest_assert_empty_queue(li);
+	}
+
+	libinput_set_frame_merging(li, 0);
+	litest_delete_device(sw);
+}
+END_TEST
+
+START_TEST(dispatch_low_priority_interval)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct litest_device *sw;
+	struct libinput_event *event;
+
+	sw = litest_add_device(li, LITEST_LID_SWITCH);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_get_low_priority_interval(li), 0);
+	libinput_set_low_priority_interval(li, 200000);
+	ck_assert_int_eq(libinput_get_low_priority_interval(li), 200000);
+
+	litest_switch_action(sw,
+			     LIBINPUT_SWITCH_LID,
+			     LIBINPUT_SWITCH_STATE_ON);
+	libinput_dispatch(li);
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_SWITCH_TOGGLE);
+
+	/* Within the interval the switch stays in the kernel buffer,
+	 * other devices are unaffected */
+	litest_switch_action(sw,
+			     LIBINPUT_SWITCH_LID,
+			     LIBINPUT_SWITCH_STATE_OFF);
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+
+	msleep(250);
+	libinput_dispatch(li);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	litest_is_switch_event(event,
+			       LIBINPUT_SWITCH_LID,
+			       LIBINPUT_SWITCH_STATE_OFF);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	libinput_set_low_priority_interval(li, 0);
+	litest_delete_device(sw);
+}
+END_TEST
+
+START_TEST(dispatch_idle_fd_quiet)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct pollfd fds = {
+		.fd = libinput_get_fd(li),
+		.events = POLLIN,
+	};
+
+	litest_drain_events(li);
+
+	/* A context without input must not wake up the caller, e.g.
+	 * through read requests on the ring completing with -EAGAIN */
+	for (int i = 0; i < 5; i++) {
+		ck_assert_int_eq(poll(&fds, 1, 20), 0);
+		libinput_dispatch(li);
+		litest_assert_empty_queue(li);
+	}
+
+	/* Input still wakes it up */
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	ck_assert_int_eq(poll(&fds, 1, 1000), 1);
+	libinput_dispatch(li);
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+}
+END_TEST
+
+START_TEST(startup_time)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	enum libinput_startup_phase phase;
+
+	/* Parsing the quirks files and setting up a device can't be
+	 * done within a microsecond */
+	ck_assert_int_gt(libinput_get_startup_time(li,
+						   LIBINPUT_STARTUP_PHASE_QUIRKS),
+			 0);
+	ck_assert_int_gt(libinput_device_get_startup_time(device,
+							  LIBINPUT_STARTUP_PHASE_CONFIGURE),
+			 0);
+
+	/* The context sums up the time of all devices */
+	for (phase = LIBINPUT_STARTUP_PHASE_OPEN;
+	     phase <= LIBINPUT_STARTUP_PHASE_NOTIFY;
+	     phase++) {
+		ck_assert_int_ge(libinput_get_startup_time(li, phase),
+				 libinput_device_get_startup_time(device, phase));
+	}
+
+	/* context-only phases */
+	ck_assert_int_eq(libinput_device_get_startup_time(device,
+							  LIBINPUT_STARTUP_PHASE_QUIRKS),
+			 0);
+	ck_assert_int_eq(libinput_device_get_startup_time(device,
+							  LIBINPUT_STARTUP_PHASE_ENUMERATE),
+			 0);
+
+	ck_assert_int_eq(libinput_device_get_startup_time(device, 0), 0);
+	litest_set_log_handler_bug(li);
+	ck_assert_int_eq(libinput_get_startup_time(li, 0), 0);
+	ck_assert_int_eq(libinput_get_startup_time(li,
+						   LIBINPUT_STARTUP_PHASE_NOTIFY + 1),
+			 0);
+	litest_restore_log_handler(li);
+}
+END_TEST
+
+START_TEST(memory_stats)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	enum libinput_memory_stat stat;
+	uint64_t sum = 0;
+	uint64_t queued;
+
+	litest_drain_events(li);
+
+	ck_assert_int_gt(libinput_device_get_memory_stats(device,
+							  LIBINPUT_MEMORY_STAT_DEVICES),
+			 0);
+	ck_assert_int_gt(libinput_device_get_memory_stats(device,
+							  LIBINPUT_MEMORY_STAT_DISPATCH),
+			 0);
+	ck_assert_int_eq(libinput_device_get_memory_stats(device,
+							  LIBINPUT_MEMORY_STAT_EVENT_QUEUE),
+			 0);
+	ck_assert_int_eq(libinput_device_get_memory_stats(device,
+							  LIBINPUT_MEMORY_STAT_QUIRKS),
+			 0);
+
+	for (stat = LIBINPUT_MEMORY_STAT_CONTEXT;
+	     stat <= LIBINPUT_MEMORY_STAT_LOG_RING;
+	     stat++) {
+		ck_assert_int_ge(libinput_get_memory_stats(li, stat),
+				 libinput_device_get_memory_stats(device, stat));
+		sum += libinput_get_memory_stats(li, stat);
+	}
+	ck_assert_int_eq(libinput_get_memory_stats(li, LIBINPUT_MEMORY_STAT_TOTAL),
+			 sum);
+	ck_assert_int_gt(libinput_get_memory_stats(li, LIBINPUT_MEMORY_STAT_QUIRKS),
+			 0);
+
+	/* queued events are accounted to their device */
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_move_to(dev, 0, 50, 50, 70, 70, 10);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+
+	queued = libinput_device_get_memory_stats(device,
+						  LIBINPUT_MEMORY_STAT_EVENT_QUEUE);
+	ck_assert_int_gt(queued, 0);
+	ck_assert_int_gt(libinput_get_memory_stats(li,
+						   LIBINPUT_MEMORY_STAT_EVENT_QUEUE),
+			 queued);
+
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_device_get_memory_stats(device,
+							  LIBINPUT_MEMORY_STAT_EVENT_QUEUE),
+			 0);
+	ck_assert_int_gt(libinput_get_memory_stats(li,
+						   LIBINPUT_MEMORY_STAT_EVENT_CACHE),
+			 0);
+
+	litest_set_log_handler_bug(li);
+	ck_assert_int_eq(libinput_get_memory_stats(li,
+						   LIBINPUT_MEMORY_STAT_LOG_RING + 1),
+			 0);
+	litest_restore_log_handler(li);
+}
+END_TEST
+
+START_TEST(profile_stages)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	enum libinput_profile_stage stage;
+	int i;
+
+	litest_drain_events(li);
+
+	/* disabled by default */
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_drain_events(li);
+	for (stage = LIBINPUT_PROFILE_STAGE_LIBEVDEV;
+	     stage <= LIBINPUT_PROFILE_STAGE_EVENT_QUEUE;
+	     stage++)
+		ck_assert_int_eq(libinput_get_profile_count(li, stage), 0);
+
+	libinput_set_profiling(li, 1);
+	for (i = 0; i < 10; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	litest_drain_events(li);
+	libinput_set_profiling(li, 0);
+
+	ck_assert_int_eq(libinput_get_profile_count(li,
+						    LIBINPUT_PROFILE_STAGE_FALLBACK),
+			 20);
+	ck_assert_int_ge(libinput_get_profile_count(li,
+						    LIBINPUT_PROFILE_STAGE_LIBEVDEV),
+			 20);
+	ck_assert_int_eq(libinput_get_profile_count(li,
+						    LIBINPUT_PROFILE_STAGE_FILTER),
+			 10);
+	ck_assert_int_ge(libinput_get_profile_count(li,
+						    LIBINPUT_PROFILE_STAGE_EVENT_QUEUE),
+			 20);
+	ck_assert_int_eq(libinput_get_profile_count(li,
+						    LIBINPUT_PROFILE_STAGE_TOUCHPAD),
+			 0);
+	ck_assert_int_gt(libinput_get_profile_time(li,
+						   LIBINPUT_PROFILE_STAGE_FALLBACK),
+			 0);
+
+	/* the values stay until profiling is enabled again */
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_get_profile_count(li,
+						    LIBINPUT_PROFILE_STAGE_FALLBACK),
+			 20);
+	libinput_set_profiling(li, 1);
+	ck_assert_int_eq(libinput_get_profile_count(li,
+						    LIBINPUT_PROFILE_STAGE_FALLBACK),
+			 0);
+	libinput_set_profiling(li, 0);
+
+	litest_set_log_handler_bug(li);
+	ck_assert_int_eq(libinput_get_profile_time(li, 0), 0);
+	ck_assert_int_eq(libinput_get_profile_count(li,
+						    LIBINPUT_PROFILE_STAGE_EVENT_QUEUE + 1),
+			 0);
+	litest_restore_log_handler(li);
+}
+END_TEST
+
+START_TEST(release_caches)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct litest_device *pad;
+	int nbuttons;
+
+	nbuttons = libinput_device_tablet_pad_get_num_buttons(dev->libinput_device);
+
+	/* The device still holds its data, releasing must not affect it */
+	libinput_release_caches(li);
+	ck_assert_int_eq(libinput_device_tablet_pad_get_num_buttons(dev->libinput_device),
+			 nbuttons);
+
+	/* A new device after the release loads everything again */
+	pad = litest_add_device(li, LITEST_WACOM_INTUOS5_PAD);
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_device_tablet_pad_get_num_buttons(pad->libinput_device),
+			 nbuttons);
+	litest_delete_device(pad);
+	litest_drain_events(li);
+
+	libinput_release_caches(li);
+	libinput_release_caches(li);
+}
+END_TEST
+
+START_TEST(cache_sharing)
+{
+	struct litest_device *dev = litest_current_device();
+	const char *devnode = libevdev_uinput_get_devnode(dev->uinput);
+	struct libinput *li1, *li2;
+	struct libinput_device *d1, *d2;
+	int nbuttons;
+
+	nbuttons = libinput_device_tablet_pad_get_num_buttons(dev->libinput_device);
+
+	li1 = libinput_path_create_context(&simple_interface, NULL);
+	li2 = libinput_path_create_context(&simple_interface, NULL);
+	ck_assert_int_eq(libinput_get_cache_sharing(li1), 0);
+	ck_assert_int_eq(libinput_set_cache_sharing(li1, 1), 0);
+	ck_assert_int_eq(libinput_set_cache_sharing(li2, 1), 0);
+	ck_assert_int_eq(libinput_get_cache_sharing(li1), 1);
+
+	d1 = libinput_path_add_device(li1, devnode);
+	d2 = libinput_path_add_device(li2, devnode);
+	ck_assert_notnull(d1);
+	ck_assert_notnull(d2);
+
+	/* Too late now */
+	ck_assert_int_eq(libinput_set_cache_sharing(li1, 0), -1);
+	ck_assert_int_eq(libinput_get_cache_sharing(li1), 1);
+
+	ck_assert_int_eq(libinput_device_tablet_pad_get_num_buttons(d1),
+			 nbuttons);
+	ck_assert_int_eq(libinput_device_tablet_pad_get_num_buttons(d2),
+			 nbuttons);
+
+	/* The second context keeps the shared data alive */
+	libinput_unref(li1);
+	libinput_path_remove_device(d2);
+	d2 = libinput_path_add_device(li2, devnode);
+	ck_assert_notnull(d2);
+	ck_assert_int_eq(libinput_device_tablet_pad_get_num_buttons(d2),
+			 nbuttons);
+	libinput_unref(li2);
+}
+END_TEST
+
+START_TEST(dispatch_until_deadline)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	int motion = 0;
+	int i, rc;
+
+	litest_drain_events(li);
+
+	for (i = 0; i < 10; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+
+	/* Deadline already expired, we still process one frame */
+	rc = libinput_dispatch_until(li, 1);
+	ck_assert_int_eq(rc, 1);
+	while ((event = libinput_get_event(li))) {
+		litest_is_motion_event(event);
+		motion++;
+		libinput_event_destroy(event);
+	}
+	ck_assert_int_eq(motion, 1);
+
+	rc = libinput_dispatch_until(li, UINT64_MAX);
+	ck_assert_int_eq(rc, 0);
+	while ((event = libinput_get_event(li))) {
+		litest_is_motion_event(event);
+		motion++;
+		libinput_event_destroy(event);
+	}
+	ck_assert_int_eq(motion, 10);
+
+	ck_assert_int_ge(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_DISPATCH_TIME_TOTAL),
+			 libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_DISPATCH_TIME_LAST));
+
+	rc = libinput_dispatch_until(li, UINT64_MAX);
+	ck_assert_int_eq(rc, 0);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(dispatch_busy_poll)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	uint64_t spins;
+	int motion = 0;
+	int i;
+
+	ck_assert_int_eq(libinput_get_busy_poll(li), 0);
+	libinput_set_busy_poll(li, ms2us(20));
+	ck_assert_int_eq(libinput_get_busy_poll(li), ms2us(20));
+
+	litest_drain_events(li);
+
+	/* Nothing to do, no spinning */
+	spins = libinput_get_statistic(li, LIBINPUT_STATISTIC_BUSY_POLL_SPINS);
+	libinput_dispatch(li);
+	ck_assert_int_eq(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_BUSY_POLL_SPINS),
+			 spins);
+
+	for (i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+
+	/* spins until nothing happened for 20ms */
+	libinput_dispatch(li);
+	ck_assert_int_gt(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_BUSY_POLL_SPINS),
+			 spins);
+
+	while ((event = libinput_get_event(li))) {
+		litest_is_motion_event(event);
+		motion++;
+		libinput_event_destroy(event);
+	}
+	ck_assert_int_eq(motion, 5);
+
+	libinput_set_busy_poll(li, 0);
+}
+END_TEST
+
+START_TEST(dispatch_busy_poll_continuous)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	uint64_t start;
+	pid_t pid;
+	int status;
+
+	libinput_set_busy_poll(li, ms2us(20));
+	litest_drain_events(li);
+
+	/* A device reporting faster than the window, for longer than
+	 * the window */
+	pid = fork();
+	ck_assert_int_ge(pid, 0);
+	if (pid == 0) {
+		for (int i = 0; i < 200; i++) {
+			litest_event(dev, EV_REL, REL_X, 1);
+			litest_event(dev, EV_SYN, SYN_REPORT, 0);
+			msleep(2);
+		}
+		_exit(0);
+	}
+
+	msleep(5);
+
+	/* Returns once the next frame arrived, not once the device
+	 * stops */
+	start = now_in_us();
+	libinput_dispatch(li);
+	ck_assert_int_lt(now_in_us() - start, ms2us(100));
+	ck_assert_int_ne(libinput_next_event_type(li), LIBINPUT_EVENT_NONE);
+
+	ck_assert_int_eq(waitpid(pid, &status, 0), pid);
+	ck_assert(WIFEXITED(status));
+
+	libinput_set_busy_poll(li, 0);
+	litest_drain_events(li);
+}
+END_TEST
+
+START_TEST(event_handoff)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *events[2];
+	struct libinput_event *event;
+	int fd;
+	int i;
+
+	ck_assert_int_eq(libinput_get_event_handoff_fd(li), -1);
+	ck_assert(libinput_get_handoff_event(li) == NULL);
+
+	litest_disable_log_handler(li);
+	ck_assert_int_eq(libinput_set_event_handoff(li, 3), -1);
+	litest_restore_log_handler(li);
+
+	ck_assert_int_eq(libinput_set_event_handoff(li, 2), 0);
+	fd = libinput_get_event_handoff_fd(li);
+	ck_assert_int_ge(fd, 0);
+
+	litest_disable_log_handler(li);
+	ck_assert_int_eq(libinput_set_event_handoff(li, 2), -1);
+	litest_restore_log_handler(li);
+
+	litest_drain_events(li);
+
+	for (i = 0; i < 3; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	/* Nothing for the dispatching thread, two events for the
+	 * consumer and the third waits for a free slot */
+	ck_assert(libinput_get_event(li) == NULL);
+	ck_assert_int_eq(libinput_next_event_type(li), LIBINPUT_EVENT_NONE);
+
+	for (i = 0; i < 2; i++) {
+		events[i] = libinput_get_handoff_event(li);
+		ck_assert_notnull(events[i]);
+		litest_is_motion_event(events[i]);
+	}
+	ck_assert(libinput_get_handoff_event(li) == NULL);
+
+	for (i = 0; i < 2; i++)
+		libinput_handoff_event_release(li, events[i]);
+
+	libinput_dispatch(li);
+	event = libinput_get_handoff_event(li);
+	ck_assert_notnull(event);
+	litest_is_motion_event(event);
+	libinput_handoff_event_release(li, event);
+
+	ck_assert(libinput_get_handoff_event(li) == NULL);
+	libinput_dispatch(li);
+	ck_assert(libinput_get_handoff_event(li) == NULL);
+}
+END_TEST
+
+static struct libinput_event *handoff_held[2];
+
+/* The clock is read in libinput_dispatch() after libinput reclaimed the
+ * released events. Releasing from here is the same as a
+ * consumer thread releasing them at that moment. */
+static uint64_t
+handoff_release_clock(struct libinput *libinput, void *user_data)
+{
+	for (size_t i = 0; i < ARRAY_LENGTH(handoff_held); i++) {
+		if (handoff_held[i])
+			libinput_handoff_event_release(libinput,
+						       handoff_held[i]);
+		handoff_held[i] = NULL;
+	}
+
+	return now_in_us();
+}
+
+START_TEST(event_handoff_release_during_dispatch)
+{
+	struct libinput *li;
+	struct litest_device *dev;
+	struct libinput_event *event;
+	int i;
+
+	li = litest_create_context();
+	ck_assert_int_eq(libinput_set_clock(li, handoff_release_clock, NULL),
+			 0);
+	dev = litest_add_device(li, LITEST_MOUSE);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_set_event_handoff(li, 2), 0);
+
+	for (i = 0; i < 2; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+	for (i = 0; i < 2; i++) {
+		handoff_held[i] = libinput_get_handoff_event(li);
+		ck_assert_notnull(handoff_held[i]);
+	}
+
+	/* The handoff is full when this event is queued, but the
+	 * consumer releases both slots before the producer marks itself
+	 * stalled. Nothing would wake us up for this event, it has to
+	 * be handed over in this dispatch. */
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	ck_assert(handoff_held[0] == NULL);
+
+	event = libinput_get_handoff_event(li);
+	ck_assert_notnull(event);
+	litest_is_motion_event(event);
+	libinput_handoff_event_release(li, event);
+	ck_assert(libinput_get_handoff_event(li) == NULL);
+
+	litest_delete_device(dev);
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(event_ring)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	const struct libinput_event_ring_header *header;
+	const struct libinput_event_ring_record *records, *r;
+	struct libinput_event *event;
+	struct stat st;
+	uint64_t counter;
+	uint32_t device_id;
+	int fd, efd;
+	void *map;
+	int i;
+
+	ck_assert_int_eq(libinput_get_event_ring_fd(li), -1);
+
+	litest_disable_log_handler(li);
+	ck_assert_int_eq(libinput_enable_event_ring(li, 3), -1);
+	ck_assert_int_eq(libinput_add_event_ring_notify_fd(li, 0), -1);
+	litest_restore_log_handler(li);
+
+	ck_assert_int_eq(libinput_enable_event_ring(li, 4), 0);
+	fd = libinput_get_event_ring_fd(li);
+	ck_assert_int_ge(fd, 0);
+
+	litest_disable_log_handler(li);
+	ck_assert_int_eq(libinput_enable_event_ring(li, 4), -1);
+	litest_restore_log_handler(li);
+
+	efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	ck_assert_int_ge(efd, 0);
+	ck_assert_int_eq(libinput_add_event_ring_notify_fd(li, efd), 0);
+
+	ck_assert_int_eq(fstat(fd, &st), 0);
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	ck_assert(map != MAP_FAILED);
+	header = map;
+	ck_assert_int_eq(header->magic, LIBINPUT_EVENT_RING_MAGIC);
+	ck_assert_int_eq(header->version, LIBINPUT_EVENT_RING_VERSION);
+	ck_assert_int_eq(header->record_size, sizeof(*r));
+	ck_assert_int_eq(header->size, 4);
+	records = (const void *)((const char *)map + header->header_size);
+
+	/* The device was added before the ring existed */
+	ck_assert_int_eq(header->head, 1);
+	r = &records[0];
+	ck_assert_int_eq(r->sequence, 1);
+	ck_assert_int_eq(r->type, LIBINPUT_EVENT_DEVICE_ADDED);
+	ck_assert_str_eq(r->u.device.sysname,
+			 libinput_device_get_sysname(dev->libinput_device));
+	device_id = r->device_id;
+
+	/* The sealed memfd can't grow */
+	ck_assert_int_lt(ftruncate(fd, st.st_size * 2), 0);
+
+	litest_drain_events(li);
+	ck_assert_int_eq(read(efd, &counter, sizeof(counter)), -1);
+
+	for (i = 0; i < 6; i++) {
+		litest_event(dev, EV_REL, REL_X, i + 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	ck_assert_int_eq(read(efd, &counter, sizeof(counter)),
+			 sizeof(counter));
+	ck_assert_int_eq(counter, 1);
+
+	/* Only the last four fit, the events are still queued as usual */
+	ck_assert_int_eq(header->head, 7);
+	for (i = 3; i < 7; i++) {
+		r = &records[i % header->size];
+		ck_assert_int_eq(r->sequence, i + 1);
+		ck_assert_int_eq(r->type, LIBINPUT_EVENT_POINTER_MOTION);
+		ck_assert_int_eq(r->device_id, device_id);
+		ck_assert_int_ne(r->time_usec, 0);
+		ck_assert_double_gt(r->u.pointer.dx_unaccelerated, 0.0);
+	}
+
+	for (i = 0; i < 6; i++) {
+		event = libinput_get_event(li);
+		litest_is_motion_event(event);
+		libinput_event_destroy(event);
+	}
+
+	/* Nothing new, no notification */
+	libinput_dispatch(li);
+	ck_assert_int_eq(read(efd, &counter, sizeof(counter)), -1);
+
+	ck_assert_int_eq(libinput_remove_event_ring_notify_fd(li, efd), 0);
+	ck_assert_int_eq(libinput_remove_event_ring_notify_fd(li, efd), -1);
+
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	ck_assert_int_eq(header->head, 8);
+	ck_assert_int_eq(read(efd, &counter, sizeof(counter)), -1);
+	litest_drain_events(li);
+
+	munmap(map, st.st_size);
+	close(efd);
+}
+END_TEST
+
+START_TEST(evdev_tap)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_evdev_tap_record records[16];
+	struct pollfd pfd;
+	size_t n;
+	int i;
+
+	ck_assert_int_eq(libinput_get_evdev_tap_fd(li), -1);
+	ck_assert_int_eq(libinput_evdev_tap_read(li, records, 16), 0);
+
+	litest_disable_log_handler(li);
+	ck_assert_int_eq(libinput_enable_evdev_tap(li, 6), -1);
+	litest_restore_log_handler(li);
+
+	ck_assert_int_eq(libinput_enable_evdev_tap(li, 8), 0);
+	pfd.fd = libinput_get_evdev_tap_fd(li);
+	pfd.events = POLLIN;
+	ck_assert_int_ge(pfd.fd, 0);
+
+	litest_disable_log_handler(li);
+	ck_assert_int_eq(libinput_enable_evdev_tap(li, 8), -1);
+	litest_restore_log_handler(li);
+
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_evdev_tap_read(li, records, 16), 0);
+	ck_assert_int_eq(poll(&pfd, 1, 0), 0);
+
+	for (i = 0; i < 4; i++) {
+		litest_event(dev, EV_REL, REL_X, i + 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+	ck_assert_int_eq(poll(&pfd, 1, 0), 1);
+
+	/* The raw events, whatever libinput made of them */
+	n = libinput_evdev_tap_read(li, records, 16);
+	ck_assert_int_eq(n, 8);
+	for (i = 0; i < 4; i++) {
+		struct libinput_evdev_tap_record *rel = &records[i * 2],
+						 *syn = &records[i * 2 + 1];
+
+		ck_assert_int_eq(rel->device_id,
+				 libinput_device_get_id(dev->libinput_device));
+		ck_assert_int_eq(rel->type, EV_REL);
+		ck_assert_int_eq(rel->code, REL_X);
+		ck_assert_int_eq(rel->value, i + 1);
+		ck_assert_int_ne(rel->time_usec, 0);
+		ck_assert_int_eq(syn->type, EV_SYN);
+		ck_assert_int_eq(syn->code, SYN_REPORT);
+	}
+
+	/* Still readable until a read finds the tap empty */
+	ck_assert_int_eq(poll(&pfd, 1, 0), 1);
+	ck_assert_int_eq(libinput_evdev_tap_read(li, records, 16), 0);
+	ck_assert_int_eq(poll(&pfd, 1, 0), 0);
+	litest_drain_events(li);
+
+	/* Fill the tap, the next batch doesn't fit */
+	for (i = 0; i < 4; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	ck_assert_int_eq(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_EVDEV_TAP_DROPPED),
+			 2);
+	ck_assert_int_eq(libinput_evdev_tap_read(li, records, 3), 3);
+	ck_assert_int_eq(libinput_evdev_tap_read(li, records, 16), 5);
+	litest_drain_events(li);
+}
+END_TEST
+
+START_TEST(event_serialize)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *events[3];
+	struct libinput_event_ring_record records[3];
+	struct libinput_event_pointer *p;
+	uint8_t buf[256];
+	size_t written;
+	int i;
+
+	litest_drain_events(li);
+
+	litest_event(dev, EV_REL, REL_X, 5);
+	litest_event(dev, EV_REL, REL_Y, -3);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_button_click_debounced(dev, li, BTN_LEFT, true);
+	litest_button_click_debounced(dev, li, BTN_LEFT, false);
+	libinput_dispatch(li);
+
+	for (i = 0; i < 3; i++) {
+		events[i] = libinput_get_event(li);
+		ck_assert_notnull(events[i]);
+	}
+
+	ck_assert_int_eq(libinput_events_serialize(events, 3, buf, 4, &written),
+			 -1);
+	ck_assert_int_eq(written, 0);
+
+	/* Only whole events are written */
+	ck_assert_int_eq(libinput_events_serialize(events, 3, buf, 12, &written),
+			 0);
+	ck_assert_int_eq(written, 5);
+	ck_assert_int_eq(libinput_events_deserialize(buf, written, records, 3),
+			 0);
+
+	ck_assert_int_eq(libinput_events_serialize(events, 3, buf, sizeof(buf), &written),
+			 3);
+	ck_assert_int_lt(written, 64);
+
+	/* Everything is decoded, even without room for it */
+	ck_assert_int_eq(libinput_events_deserialize(buf, written, records, 1),
+			 3);
+	ck_assert_int_eq(libinput_events_deserialize(buf, written, records, 3),
+			 3);
+	ck_assert_int_eq(libinput_events_deserialize(buf, written - 1, records, 3),
+			 -1);
+
+	p = litest_is_motion_event(events[0]);
+	ck_assert_int_eq(records[0].type, LIBINPUT_EVENT_POINTER_MOTION);
+	ck_assert_int_eq(records[0].time_usec,
+			 libinput_event_pointer_get_time_usec(p));
+	ck_assert_double_eq_tol(records[0].u.pointer.dx,
+				libinput_event_pointer_get_dx(p),
+				1.0/65536);
+	ck_assert_double_eq_tol(records[0].u.pointer.dy_unaccelerated,
+				-3.0,
+				1.0/65536);
+
+	for (i = 1; i < 3; i++) {
+		p = libinput_event_get_pointer_event(events[i]);
+		ck_assert_int_eq(records[i].type, LIBINPUT_EVENT_POINTER_BUTTON);
+		ck_assert_int_eq(records[i].device_id, records[0].device_id);
+		ck_assert_int_eq(records[i].time_usec,
+				 libinput_event_pointer_get_time_usec(p));
+		ck_assert_int_eq(records[i].u.pointer.button, BTN_LEFT);
+		ck_assert_int_eq(records[i].u.pointer.button_state,
+				 libinput_event_pointer_get_button_state(p));
+		ck_assert_double_eq(records[i].u.pointer.dx, 0.0);
+	}
+
+	ck_assert_int_eq(libinput_event_serialize(events[0], buf, 8), -1);
+	ck_assert_int_gt(libinput_event_serialize(events[0], buf, sizeof(buf)),
+			 5);
+
+	/* Unknown version */
+	buf[0] = 0xff;
+	ck_assert_int_eq(libinput_events_deserialize(buf, written, records, 3),
+			 -1);
+
+	for (i = 0; i < 3; i++)
+		libinput_event_destroy(events[i]);
+}
+END_TEST
+
+START_TEST(seat_event_queues)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_seat *seat = libinput_device_get_seat(dev->libinput_device);
+	struct libinput_event *event;
+	struct pollfd pfd;
+	int i;
+
+	ck_assert_int_eq(libinput_seat_get_event_fd(seat), -1);
+	ck_assert(libinput_seat_get_event(seat) == NULL);
+
+	ck_assert_int_eq(libinput_enable_seat_event_queues(li), 0);
+	litest_disable_log_handler(li);
+	ck_assert_int_eq(libinput_enable_seat_event_queues(li), -1);
+	ck_assert_int_eq(libinput_set_event_handoff(li, 2), -1);
+	litest_restore_log_handler(li);
+
+	pfd.fd = libinput_seat_get_event_fd(seat);
+	pfd.events = POLLIN;
+	ck_assert_int_ge(pfd.fd, 0);
+
+	litest_drain_events(li);
+	ck_assert_int_eq(poll(&pfd, 1, 0), 0);
+
+	for (i = 0; i < 3; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	/* Nothing in the context, everything in the seat */
+	ck_assert(libinput_get_event(li) == NULL);
+	ck_assert_int_eq(poll(&pfd, 1, 0), 1);
+
+	for (i = 0; i < 3; i++) {
+		event = libinput_seat_get_event(seat);
+		litest_is_motion_event(event);
+		libinput_event_destroy(event);
+	}
+	ck_assert(libinput_seat_get_event(seat) == NULL);
+	ck_assert_int_eq(poll(&pfd, 1, 0), 0);
+
+	/* Events left in the seat are cleaned up with the context */
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+}
+END_TEST
+
+static struct {
+	struct libinput_source *sources[32];
+	int fds[32];
+	size_t nsources;
+} external_sources;
+
+static void
+external_source_handler(struct libinput *libinput,
+			struct libinput_source *source,
+			int fd,
+			int added,
+			void *user_data)
+{
+	size_t i;
+
+	if (added) {
+		litest_assert_int_lt(external_sources.nsources,
+				     ARRAY_LENGTH(external_sources.sources));
+		i = external_sources.nsources++;
+		external_sources.sources[i] = source;
+		external_sources.fds[i] = fd;
+		return;
+	}
+
+	for (i = 0; i < external_sources.nsources; i++) {
+		if (external_sources.sources[i] != source)
+			continue;
+
+		external_sources.nsources--;
+		external_sources.sources[i] =
+			external_sources.sources[external_sources.nsources];
+		external_sources.fds[i] =
+			external_sources.fds[external_sources.nsources];
+		return;
+	}
+
+	litest_abort_msg("removed source was never added");
+}
+
+static void
+external_sources_dispatch(struct libinput *li)
+{
+	struct pollfd pfd[ARRAY_LENGTH(external_sources.fds)];
+	struct libinput_source *ready[ARRAY_LENGTH(external_sources.sources)];
+	size_t i, n = external_sources.nsources;
+
+	for (i = 0; i < n; i++) {
+		pfd[i].fd = external_sources.fds[i];
+		pfd[i].events = POLLIN;
+		ready[i] = external_sources.sources[i];
+	}
+
+	ck_assert_int_gt(poll(pfd, n, 0), 0);
+
+	for (i = 0; i < n; i++) {
+		if (pfd[i].revents & POLLIN)
+			ck_assert_int_eq(libinput_dispatch_source(li, ready[i]), 0);
+	}
+}
+
+START_TEST(source_handler)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct pollfd pfd;
+	int i;
+
+	litest_drain_events(li);
+
+	litest_disable_log_handler(li);
+	ck_assert_int_eq(libinput_dispatch_source(li, NULL), -EINVAL);
+	litest_restore_log_handler(li);
+
+	memset(&external_sources, 0, sizeof(external_sources));
+	ck_assert_int_eq(libinput_set_source_handler(li, NULL, NULL), -EINVAL);
+	ck_assert_int_eq(libinput_set_source_handler(li,
+						     external_source_handler,
+						     NULL),
+			 0);
+	ck_assert_int_eq(libinput_set_source_handler(li,
+						     external_source_handler,
+						     NULL),
+			 -EBUSY);
+
+	/* at least the device and the timer */
+	ck_assert_int_ge(external_sources.nsources, 2);
+
+	for (i = 0; i < 3; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+
+	/* Everything goes through the sources now */
+	pfd.fd = libinput_get_fd(li);
+	pfd.events = POLLIN;
+	ck_assert_int_eq(poll(&pfd, 1, 0), 0);
+	libinput_dispatch(li);
+	ck_assert(libinput_get_event(li) == NULL);
+
+	external_sources_dispatch(li);
+
+	for (i = 0; i < 3; i++) {
+		event = libinput_get_event(li);
+		litest_is_motion_event(event);
+		libinput_event_destroy(event);
+	}
+	ck_assert(libinput_get_event(li) == NULL);
+}
+END_TEST
+
+START_TEST(timer_stats)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_timer_stats *stats;
+	unsigned int i, count;
+	uint64_t armed = 0, fired = 0;
+
+	litest_drain_events(li);
+
+	/* debouncing arms timers on every button event */
+	litest_button_click_debounced(dev, li, BTN_LEFT, true);
+	litest_button_click_debounced(dev, li, BTN_LEFT, false);
+	litest_timeout_debounce();
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	stats = libinput_get_timer_stats(li);
+	count = libinput_timer_stats_get_count(stats);
+	ck_assert_int_gt(count, 0);
+
+	for (i = 0; i < count; i++) {
+		uint64_t p50, p99, max;
+
+		ck_assert_notnull(libinput_timer_stats_get_name(stats, i));
+
+		armed += libinput_timer_stats_get_value(stats, i,
+							LIBINPUT_TIMER_STAT_ARMED);
+		fired += libinput_timer_stats_get_value(stats, i,
+							LIBINPUT_TIMER_STAT_FIRED);
+
+		p50 = libinput_timer_stats_get_value(stats, i,
+						     LIBINPUT_TIMER_STAT_LATENESS_P50);
+		p99 = libinput_timer_stats_get_value(stats, i,
+						     LIBINPUT_TIMER_STAT_LATENESS_P99);
+		max = libinput_timer_stats_get_value(stats, i,
+						     LIBINPUT_TIMER_STAT_LATENESS_MAX);
+		ck_assert_int_le(p50, p99);
+		ck_assert_int_le(p99, max);
+	}
+
+	ck_assert_int_gt(armed, 0);
+	ck_assert_int_gt(fired, 0);
+	ck_assert_int_ge(armed, fired);
+
+	ck_assert(libinput_timer_stats_get_name(stats, count) == NULL);
+	ck_assert_int_eq(libinput_timer_stats_get_value(stats, count,
+							LIBINPUT_TIMER_STAT_ARMED),
+			 0);
+
+	libinput_timer_stats_destroy(stats);
+}
+END_TEST
+
+static bool
+has_timer(struct libinput *li, const char *suffix)
+{
+	struct libinput_timer_stats *stats;
+	unsigned int i, count;
+	bool found = false;
+
+	stats = libinput_get_timer_stats(li);
+	count = libinput_timer_stats_get_count(stats);
+	for (i = 0; i < count; i++) {
+		const char *name = libinput_timer_stats_get_name(stats, i);
+		size_t len = strlen(name);
+
+		if (len >= strlen(suffix) &&
+		    streq(name + len - strlen(suffix), suffix))
+			found = true;
+	}
+	libinput_timer_stats_destroy(stats);
+
+	return found;
+}
+
+START_TEST(timer_stats_lazy)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+
+	litest_disable_tap(dev->libinput_device);
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	/* The tap timer is only set up once it is needed */
+	ck_assert(!has_timer(li, " tap"));
+
+	litest_enable_tap(dev->libinput_device);
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+	litest_timeout_tap();
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	ck_assert(has_timer(li, " tap"));
+}
+END_TEST
+
+static uint64_t fake_clock_now;
+
+static uint64_t
+fake_clock(struct libinput *libinput, void *user_data)
+{
+	return fake_clock_now;
+}
+
+static uint64_t
+timers_fired(struct libinput *li)
+{
+	struct libinput_timer_stats *stats;
+	unsigned int i, count;
+	uint64_t fired = 0;
+
+	stats = libinput_get_timer_stats(li);
+	count = libinput_timer_stats_get_count(stats);
+	for (i = 0; i < count; i++)
+		fired += libinput_timer_stats_get_value(stats, i,
+							LIBINPUT_TIMER_STAT_FIRED);
+	libinput_timer_stats_destroy(stats);
+
+	return fired;
+}
+
+START_TEST(timer_clock)
+{
+	struct libinput *li;
+	struct litest_device *dev;
+	uint64_t fired;
+
+	fake_clock_now = s2us(1000);
+
+	li = litest_create_context();
+	ck_assert_int_eq(libinput_set_clock(li, fake_clock, NULL), 0);
+
+	dev = litest_add_device(li, LITEST_MOUSE);
+	ck_assert_int_eq(libinput_set_clock(li, NULL, NULL), -EBUSY);
+	litest_drain_events(li);
+
+	/* debouncing arms a timer, it must not fire while the clock
+	 * stands still */
+	fired = timers_fired(li);
+	litest_button_click(dev, BTN_LEFT, true);
+	libinput_dispatch(li);
+	litest_timeout_debounce();
+	libinput_dispatch(li);
+	ck_assert_int_eq(timers_fired(li), fired);
+
+	fake_clock_now += s2us(1);
+	libinput_dispatch(li);
+	ck_assert_int_gt(timers_fired(li), fired);
+
+	litest_button_click(dev, BTN_LEFT, false);
+	fake_clock_now += s2us(1);
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	litest_delete_device(dev);
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(timer_client_managed)
+{
+	struct libinput *li;
+	struct litest_device *dev;
+	struct pollfd fds;
+	uint64_t fired, updates, timeout;
+
+	li = litest_create_context();
+	dev = litest_add_device(li, LITEST_MOUSE);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_get_next_timeout(li), 0);
+	libinput_set_client_timers(li, 1);
+
+	/* debouncing arms a timer, the timerfd is left alone */
+	fired = timers_fired(li);
+	updates = libinput_get_statistic(li, LIBINPUT_STATISTIC_TIMERFD_UPDATES);
+	litest_button_click(dev, BTN_LEFT, true);
+	libinput_dispatch(li);
+	timeout = libinput_get_next_timeout(li);
+	ck_assert_int_gt(timeout, 0);
+	ck_assert_int_eq(libinput_get_statistic(li, LIBINPUT_STATISTIC_TIMERFD_UPDATES),
+			 updates);
+
+	/* nothing wakes us up for the expired timer */
+	litest_timeout_debounce();
+	fds.fd = libinput_get_fd(li);
+	fds.events = POLLIN;
+	fds.revents = 0;
+	ck_assert_int_eq(poll(&fds, 1, 0), 0);
+
+	libinput_dispatch(li);
+	ck_assert_int_gt(timers_fired(li), fired);
+	litest_assert_button_event(li,
+				   BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+
+	litest_button_click(dev, BTN_LEFT, false);
+	libinput_dispatch(li);
+	litest_timeout_debounce();
+	libinput_set_client_timers(li, 0);
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_get_next_timeout(li), 0);
+
+	litest_delete_device(dev);
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(timer_frame_deadline)
+{
+	struct libinput *li;
+	struct litest_device *dev;
+	struct libinput_device *device;
+	uint64_t timeout;
+
+	li = litest_create_context();
+	dev = litest_add_device(li, LITEST_MOUSE);
+	device = dev->libinput_device;
+	libinput_device_config_middle_emulation_set_enabled(device,
+				LIBINPUT_CONFIG_MIDDLE_EMULATION_ENABLED);
+	litest_drain_events(li);
+
+	libinput_set_client_timers(li, 1);
+
+	/* a single press waits for the middle button chord */
+	litest_event(dev, EV_KEY, BTN_LEFT, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+	timeout = libinput_get_next_timeout(li);
+	ck_assert_int_gt(timeout, 0);
+
+	/* too far away from the timeout */
+	libinput_set_frame_deadline(li, timeout - ms2us(20));
+	ck_assert_int_eq(libinput_get_next_timeout(li), timeout);
+
+	/* the timer fires at the frame deadline */
+	libinput_set_frame_deadline(li, timeout - ms2us(2));
+	ck_assert_int_eq(libinput_get_next_timeout(li), timeout - ms2us(2));
+
+	while (now_in_us() < timeout - ms2us(2))
+		msleep(1);
+	libinput_dispatch(li);
+	litest_assert_button_event(li,
+				   BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+
+	litest_timeout_debounce();
+	litest_event(dev, EV_KEY, BTN_LEFT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	litest_timeout_debounce();
+	libinput_dispatch(li);
+	litest_assert_button_event(li,
+				   BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_RELEASED);
+
+	litest_delete_device(dev);
+	libinput_unref(li);
+}
+END_TEST
+
+struct counting_allocator {
+	size_t allocs;
+	size_t live;
+};
+
+static void *
+counting_alloc(size_t size, void *data)
+{
+	struct counting_allocator *a = data;
+
+	a->allocs++;
+	a->live++;
+	return malloc(size);
+}
+
+static void *
+counting_realloc(void *ptr, size_t size, void *data)
+{
+	struct counting_allocator *a = data;
+
+	if (!ptr) {
+		a->allocs++;
+		a->live++;
+	}
+	return realloc(ptr, size);
+}
+
+static void
+counting_free(void *ptr, void *data)
+{
+	struct counting_allocator *a = data;
+
+	litest_assert_int_gt(a->live, 0U);
+	a->live--;
+	free(ptr);
+}
+
+START_TEST(allocator_hooks)
+{
+	struct libinput *li;
+	struct litest_device *dev;
+	struct counting_allocator a = {0};
+	const struct libinput_allocator_interface allocator = {
+		.alloc = counting_alloc,
+		.realloc = counting_realloc,
+		.free = counting_free,
+	};
+
+	ck_assert_int_eq(libinput_set_allocator(&allocator, &a), 0);
+
+	li = litest_create_context();
+	ck_assert_int_gt(a.allocs, 0U);
+	ck_assert_int_eq(libinput_set_allocator(NULL, NULL), -1);
+
+	dev = litest_add_device(li, LITEST_MOUSE);
+	litest_drain_events(li);
+
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_button_click_debounced(dev, li, BTN_LEFT, true);
+	litest_button_click_debounced(dev, li, BTN_LEFT, false);
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	litest_delete_device(dev);
+	libinput_unref(li);
+
+	ck_assert_int_eq(a.live, 0U);
+	ck_assert_int_eq(libinput_set_allocator(NULL, NULL), 0);
+}
+END_TEST
+
+static void *
+context_churn_thread(void *data)
+{
+	for (int i = 0; i < 500; i++) {
+		struct libinput *li;
+
+		li = libinput_path_create_context(&simple_interface, NULL);
+		litest_assert_notnull(li);
+		libinput_unref(li);
+	}
+
+	return NULL;
+}
+
+START_TEST(allocator_contexts_on_threads)
+{
+	pthread_t threads[4];
+
+	/* Contexts created and destroyed on several threads at once, the
+	 * allocator must be settable again once they're all gone */
+	for (size_t i = 0; i < ARRAY_LENGTH(threads); i++)
+		ck_assert_int_eq(pthread_create(&threads[i],
+						NULL,
+						context_churn_thread,
+						NULL),
+				 0);
+	for (size_t i = 0; i < ARRAY_LENGTH(threads); i++)
+		pthread_join(threads[i], NULL);
+
+	ck_assert_int_eq(libinput_set_allocator(NULL, NULL), 0);
+}
+END_TEST
+
 static int open_restricted_leak(const char *path, int flags, void *data)
 {
 	return *(int*)data;
@@ -853,9 +2847,47 @@ TEST_COLLECTION(misc)
 
 	litest_add_deviceless("context:refcount", context_ref_counting);
 	litest_add_deviceless("config:status string", config_status_string);
+	litest_add_for_device("context:event-cache", event_cache_recycling, LITEST_MOUSE);
+	litest_add_for_device("context:event-batch", event_batch_drain, LITEST_MOUSE);
+	litest_add_for_device("context:event-prioritized", event_prioritized, LITEST_MOUSE);
+	litest_add_for_device("context:quiescence", context_quiescence, LITEST_MOUSE);
+	litest_add_for_device("context:event-queue", event_queue_presize, LITEST_GENERIC_MULTITOUCH_SCREEN);
+	litest_add_for_device("context:event-queue", event_queue_shrink, LITEST_MOUSE);
+	litest_add_for_device("context:event-queue", event_queue_latency, LITEST_MOUSE);
+	litest_add_no_device("context:event-queue", event_queue_time_fresh);
+	litest_add_for_device("context:event-filter", event_type_disabled, LITEST_MOUSE);
+	litest_add_for_device("context:event-filter", event_type_disabled_seat_button_count, LITEST_MOUSE);
+	litest_add_for_device("context:dispatch", dispatch_budget, LITEST_MOUSE);
+	litest_add_for_device("context:dispatch", dispatch_frame_merging, LITEST_MOUSE);
+	litest_add_for_device("context:dispatch", dispatch_low_priority, LITEST_MOUSE);
+	litest_add_for_device("context:dispatch", dispatch_low_priority_interval, LITEST_MOUSE);
+	litest_add_for_device("context:dispatch", dispatch_idle_fd_quiet, LITEST_MOUSE);
+	litest_add_for_device("context:dispatch", dispatch_until_deadline, LITEST_MOUSE);
+	litest_add_for_device("context:dispatch", dispatch_busy_poll, LITEST_MOUSE);
+	litest_add_for_device("context:dispatch", dispatch_busy_poll_continuous, LITEST_MOUSE);
+	litest_add_for_device("context:startup", startup_time, LITEST_MOUSE);
+	litest_add_for_device("context:memory", memory_stats, LITEST_SYNAPTICS_TOUCHPAD);
+	litest_add_for_device("context:profile", profile_stages, LITEST_MOUSE);
+	litest_add_for_device("context:caches", release_caches, LITEST_WACOM_INTUOS5_PAD);
+	litest_add_for_device("context:caches", cache_sharing, LITEST_WACOM_INTUOS5_PAD);
+	litest_add_for_device("events:handoff", event_handoff, LITEST_MOUSE);
+	litest_add_no_device("events:handoff", event_handoff_release_during_dispatch);
+	litest_add_for_device("events:ring", event_ring, LITEST_MOUSE);
+	litest_add_for_device("events:ring", evdev_tap, LITEST_MOUSE);
+	litest_add_for_device("events:serialize", event_serialize, LITEST_MOUSE);
+	litest_add_for_device("events:seat-queues", seat_event_queues, LITEST_MOUSE);
+	litest_add_for_device("events:source-handler", source_handler, LITEST_MOUSE);
 
 	litest_add_for_device("timer:offset-warning", timer_offset_bug_warning, LITEST_SYNAPTICS_TOUCHPAD);
 	litest_add_no_device("timer:flush", timer_flush);
+	litest_add_for_device("timer:stats", timer_stats, LITEST_MOUSE);
+	litest_add_for_device("timer:stats", timer_stats_lazy, LITEST_SYNAPTICS_TOUCHPAD);
+	litest_add_no_device("timer:clock", timer_clock);
+	litest_add_no_device("timer:client", timer_client_managed);
+	litest_add_no_device("timer:client", timer_frame_deadline);
+
+	litest_add_no_device("context:allocator", allocator_hooks);
+	litest_add_no_device("context:allocator", allocator_contexts_on_threads);
 
 	litest_add_no_device("misc:fd", fd_no_event_leak);
 
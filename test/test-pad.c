@@ -835,6 +835,64 @@ START_TEST(pad_mode_group_has)
 }
 END_TEST
 
+START_TEST(pad_mode_groups_resume)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput_tablet_pad_mode_group *group;
+	struct libinput_event *event;
+	int ngroups, nbuttons;
+	int modes[8] = {0};
+	uint32_t buttons[8] = {0};
+	int i, b;
+
+	ngroups = libinput_device_tablet_pad_get_num_mode_groups(device);
+	ck_assert_int_le(ngroups, (int)ARRAY_LENGTH(modes));
+	nbuttons = min(32, libinput_device_tablet_pad_get_num_buttons(device));
+
+	for (i = 0; i < ngroups; i++) {
+		group = libinput_device_tablet_pad_get_mode_group(device, i);
+		modes[i] = libinput_tablet_pad_mode_group_get_num_modes(group);
+		for (b = 0; b < nbuttons; b++) {
+			if (libinput_tablet_pad_mode_group_has_button(group, b))
+				buttons[i] |= 1U << b;
+		}
+	}
+
+	litest_drain_events(li);
+	libinput_suspend(li);
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_resume(li), 0);
+	libinput_dispatch(li);
+
+	/* The re-added pad re-uses the cached description, it must
+	 * look the same */
+	event = libinput_get_event(li);
+	ck_assert_notnull(event);
+	ck_assert_int_eq(libinput_event_get_type(event),
+			 LIBINPUT_EVENT_DEVICE_ADDED);
+	device = libinput_event_get_device(event);
+
+	ck_assert_int_eq(libinput_device_tablet_pad_get_num_mode_groups(device),
+			 ngroups);
+	for (i = 0; i < ngroups; i++) {
+		uint32_t mask = 0;
+
+		group = libinput_device_tablet_pad_get_mode_group(device, i);
+		ck_assert_int_eq(libinput_tablet_pad_mode_group_get_num_modes(group),
+				 modes[i]);
+		for (b = 0; b < nbuttons; b++) {
+			if (libinput_tablet_pad_mode_group_has_button(group, b))
+				mask |= 1U << b;
+		}
+		ck_assert_int_eq(mask, buttons[i]);
+	}
+	libinput_event_destroy(event);
+	litest_drain_events(li);
+}
+END_TEST
+
 START_TEST(pad_mode_group_has_invalid)
 {
 	struct litest_device *dev = litest_current_device();
@@ -1014,6 +1072,7 @@ TEST_COLLECTION(tablet_pad)
 	litest_add("pad:modes", pad_mode_groups_ref, LITEST_TABLET_PAD, LITEST_ANY);
 	litest_add("pad:modes", pad_mode_group_mode, LITEST_TABLET_PAD, LITEST_ANY);
 	litest_add("pad:modes", pad_mode_group_has, LITEST_TABLET_PAD, LITEST_ANY);
+	litest_add("pad:modes", pad_mode_groups_resume, LITEST_TABLET_PAD, LITEST_ANY);
 	litest_add("pad:modes", pad_mode_group_has_invalid, LITEST_TABLET_PAD, LITEST_ANY);
 	litest_add("pad:modes", pad_mode_group_has_no_toggle, LITEST_TABLET_PAD, LITEST_ANY);
 
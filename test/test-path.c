@@ -473,6 +473,88 @@ START_TEST(path_add_invalid_path)
 }
 END_TEST
 
+START_TEST(path_add_devices)
+{
+	struct libinput *li;
+	struct libevdev_uinput *uinputs[5];
+	const char *paths[ARRAY_LENGTH(uinputs) + 1];
+	struct libinput_device *devices[ARRAY_LENGTH(paths)];
+	struct libinput_event *event;
+	size_t invalid = 2;
+	int nadded;
+
+	for (size_t i = 0, u = 0; i < ARRAY_LENGTH(paths); i++) {
+		if (i == invalid) {
+			paths[i] = "/tmp/";
+			continue;
+		}
+
+		uinputs[u] = litest_create_uinput_device("test device", NULL,
+							 EV_KEY, BTN_LEFT,
+							 EV_KEY, BTN_RIGHT,
+							 EV_REL, REL_X,
+							 EV_REL, REL_Y,
+							 -1);
+		paths[i] = libevdev_uinput_get_devnode(uinputs[u]);
+		u++;
+	}
+
+	li = litest_create_context();
+
+	litest_disable_log_handler(li);
+	nadded = libinput_path_add_devices(li,
+					   paths,
+					   ARRAY_LENGTH(paths),
+					   devices);
+	litest_restore_log_handler(li);
+	ck_assert_int_eq(nadded, ARRAY_LENGTH(uinputs));
+
+	for (size_t i = 0; i < ARRAY_LENGTH(paths); i++) {
+		if (i == invalid)
+			ck_assert(devices[i] == NULL);
+		else
+			ck_assert_notnull(devices[i]);
+	}
+
+	libinput_dispatch(li);
+
+	/* the events are in the order of the paths */
+	for (size_t i = 0; i < ARRAY_LENGTH(paths); i++) {
+		if (i == invalid)
+			continue;
+
+		event = libinput_get_event(li);
+		ck_assert_notnull(event);
+		ck_assert_int_eq(libinput_event_get_type(event),
+				 LIBINPUT_EVENT_DEVICE_ADDED);
+		ck_assert(libinput_event_get_device(event) == devices[i]);
+		libinput_event_destroy(event);
+	}
+
+	litest_assert_empty_queue(li);
+
+	/* suspend/resume re-opens them in one go */
+	libinput_suspend(li);
+	libinput_dispatch(li);
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_resume(li), 0);
+	libinput_dispatch(li);
+
+	for (size_t i = 0; i < ARRAY_LENGTH(uinputs); i++) {
+		event = libinput_get_event(li);
+		ck_assert_notnull(event);
+		ck_assert_int_eq(libinput_event_get_type(event),
+				 LIBINPUT_EVENT_DEVICE_ADDED);
+		libinput_event_destroy(event);
+	}
+	litest_assert_empty_queue(li);
+
+	libinput_unref(li);
+	for (size_t i = 0; i < ARRAY_LENGTH(uinputs); i++)
+		libevdev_uinput_destroy(uinputs[i]);
+}
+END_TEST
+
 START_TEST(path_device_sysname)
 {
 	struct litest_device *dev = litest_current_device();
@@ -1012,6 +1094,71 @@ START_TEST(path_ignore_device)
 }
 END_TEST
 
+START_TEST(path_replay_push_event)
+{
+	struct libinput *li;
+	struct libinput_device *device;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	struct libevdev_uinput *uinput;
+	uint64_t time = s2us(1);
+	int rc;
+
+	uinput = litest_create_uinput_device("test device", NULL,
+					     EV_KEY, BTN_LEFT,
+					     EV_KEY, BTN_RIGHT,
+					     EV_REL, REL_X,
+					     EV_REL, REL_Y,
+					     -1);
+
+	li = libinput_replay_create_context(&simple_interface, NULL);
+	ck_assert_notnull(li);
+
+	device = libinput_path_add_device(li,
+					  libevdev_uinput_get_devnode(uinput));
+	ck_assert_notnull(device);
+	litest_drain_events(li);
+
+	rc = libinput_replay_device_push_event(device, time, EV_REL, REL_X, 1);
+	ck_assert_int_eq(rc, 0);
+	rc = libinput_replay_device_push_event(device, time, EV_SYN, SYN_REPORT, 0);
+	ck_assert_int_eq(rc, 0);
+
+	/* no libinput_dispatch() needed */
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	ck_assert_int_eq(libinput_event_pointer_get_time_usec(ptrev), time);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	/* events from the kernel are ignored */
+	libevdev_uinput_write_event(uinput, EV_REL, REL_X, 1);
+	libevdev_uinput_write_event(uinput, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+
+	libinput_unref(li);
+	libevdev_uinput_destroy(uinput);
+}
+END_TEST
+
+START_TEST(path_replay_push_event_path_context)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	int rc;
+
+	litest_set_log_handler_bug(li);
+	rc = libinput_replay_device_push_event(dev->libinput_device,
+					       s2us(1),
+					       EV_SYN,
+					       SYN_REPORT,
+					       0);
+	ck_assert_int_eq(rc, -EINVAL);
+	litest_restore_log_handler(li);
+}
+END_TEST
+
 TEST_COLLECTION(path)
 {
 	litest_add_no_device("path:create", path_create_NULL);
@@ -1034,10 +1181,14 @@ TEST_COLLECTION(path)
 	litest_add("path:device events", path_device_sysname, LITEST_ANY, LITEST_ANY);
 	litest_add_for_device("path:device events", path_add_device, LITEST_SYNAPTICS_CLICKPAD_X220);
 	litest_add_no_device("path:device events", path_add_invalid_path);
+	litest_add_no_device("path:device events", path_add_devices);
 	litest_add_for_device("path:device events", path_remove_device, LITEST_SYNAPTICS_CLICKPAD_X220);
 	litest_add_for_device("path:device events", path_double_remove_device, LITEST_SYNAPTICS_CLICKPAD_X220);
 	litest_add_no_device("path:seat", path_seat_recycle);
 	litest_add_for_device("path:udev", path_udev_assign_seat, LITEST_SYNAPTICS_CLICKPAD_X220);
 
 	litest_add_no_device("path:ignore", path_ignore_device);
+
+	litest_add_no_device("path:replay", path_replay_push_event);
+	litest_add_for_device("path:replay", path_replay_push_event_path_context, LITEST_MOUSE);
 }
@@ -262,6 +262,67 @@ START_TEST(pointer_motion_absolute)
 }
 END_TEST
 
+START_TEST(pointer_motion_absolute_virtual)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	uint64_t coalesced;
+	double ex, ey;
+
+	litest_drain_events(li);
+	coalesced = libinput_get_statistic(li,
+					   LIBINPUT_STATISTIC_EVENTS_COALESCED);
+
+	/* Without a dispatch in between, only the last position is left */
+	litest_touch_down(dev, 0, 20, 30);
+	litest_touch_move(dev, 0, 40, 50);
+	litest_touch_move(dev, 0, 60, 70);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	litest_assert_event_type(event, LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE);
+	ptrev = libinput_event_get_pointer_event(event);
+	ex = libinput_event_pointer_get_absolute_x_transformed(ptrev, 100);
+	ey = libinput_event_pointer_get_absolute_y_transformed(ptrev, 100);
+	litest_assert_int_eq((int)(ex + 0.5), 60);
+	litest_assert_int_eq((int)(ey + 0.5), 70);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	ck_assert_int_eq(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_EVENTS_COALESCED),
+			 coalesced + 2);
+
+	/* Once read, the next position is a new event */
+	litest_touch_move(dev, 0, 10, 10);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	litest_assert_event_type(event, LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	/* The caller's mode overrides the device default */
+	ck_assert_int_eq(libinput_set_event_coalescing(li,
+						       LIBINPUT_EVENT_COALESCING_NONE),
+			 0);
+	litest_touch_move(dev, 0, 20, 20);
+	litest_touch_move(dev, 0, 30, 30);
+	libinput_dispatch(li);
+	for (int i = 0; i < 2; i++) {
+		event = libinput_get_event(li);
+		litest_assert_event_type(event,
+					 LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE);
+		libinput_event_destroy(event);
+	}
+	litest_assert_empty_queue(li);
+	ck_assert_int_eq(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_EVENTS_COALESCED),
+			 coalesced + 2);
+}
+END_TEST
+
 START_TEST(pointer_absolute_initial_state)
 {
 	struct litest_device *dev = litest_current_device();
@@ -362,6 +423,296 @@ START_TEST(pointer_motion_unaccel)
 }
 END_TEST
 
+START_TEST(pointer_motion_catch_up)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	int i;
+
+	litest_drain_events(li);
+
+	/* Not behind, every frame gets its event */
+	for (i = 0; i < 4; i++) {
+		litest_event(dev, EV_REL, REL_X, 10);
+		litest_event(dev, EV_REL, REL_Y, -5);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	for (i = 0; i < 4; i++) {
+		event = libinput_get_event(li);
+		litest_is_motion_event(event);
+		libinput_event_destroy(event);
+	}
+	litest_assert_empty_queue(li);
+
+	/* Well behind, the frames collapse into the last one */
+	for (i = 0; i < 4; i++) {
+		litest_event(dev, EV_REL, REL_X, 10);
+		litest_event(dev, EV_REL, REL_Y, -5);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	litest_timeout_catch_up();
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	litest_assert_double_eq(libinput_event_pointer_get_dx_unaccelerated(ptrev),
+				40.0);
+	litest_assert_double_eq(libinput_event_pointer_get_dy_unaccelerated(ptrev),
+				-20.0);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(pointer_motion_coalescing)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	uint64_t nallocs;
+	int rc;
+
+	rc = libinput_set_event_coalescing(li,
+					   LIBINPUT_EVENT_COALESCING_POINTER_MOTION);
+	ck_assert_int_eq(rc, 0);
+	ck_assert_int_eq(libinput_get_event_coalescing(li),
+			 LIBINPUT_EVENT_COALESCING_POINTER_MOTION);
+
+	litest_drain_events(li);
+
+	nallocs = libinput_get_statistic(li, LIBINPUT_STATISTIC_EVENT_CACHE_HITS) +
+		  libinput_get_statistic(li, LIBINPUT_STATISTIC_EVENT_CACHE_MISSES);
+
+	for (int i = 0; i < 4; i++) {
+		litest_event(dev, EV_REL, REL_X, 10);
+		litest_event(dev, EV_REL, REL_Y, -5);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	/* The merged events are never allocated */
+	ck_assert_int_eq(libinput_get_statistic(li, LIBINPUT_STATISTIC_EVENT_CACHE_HITS) +
+			 libinput_get_statistic(li, LIBINPUT_STATISTIC_EVENT_CACHE_MISSES),
+			 nallocs + 1);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	litest_assert_double_eq(libinput_event_pointer_get_dx_unaccelerated(ptrev),
+				40.0);
+	litest_assert_double_eq(libinput_event_pointer_get_dy_unaccelerated(ptrev),
+				-20.0);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	ck_assert_int_eq(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_EVENTS_COALESCED),
+			 3);
+
+	/* A button event in between stops the merge */
+	litest_event(dev, EV_REL, REL_X, 10);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_button_click_debounced(dev, li, BTN_LEFT, true);
+	litest_event(dev, EV_REL, REL_X, 10);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_button_event(event, BTN_LEFT, LIBINPUT_BUTTON_STATE_PRESSED);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	litest_disable_log_handler(li);
+	rc = libinput_set_event_coalescing(li, 0x100);
+	litest_restore_log_handler(li);
+	ck_assert_int_eq(rc, -1);
+	ck_assert_int_eq(libinput_get_event_coalescing(li),
+			 LIBINPUT_EVENT_COALESCING_POINTER_MOTION);
+}
+END_TEST
+
+START_TEST(pointer_motion_seat_coalescing)
+{
+	struct libinput *li;
+	struct litest_device *dev1, *dev2;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	double dx = 0.0, dy = 0.0;
+	int rc;
+
+	li = litest_create_context();
+	dev1 = litest_add_device(li, LITEST_MOUSE);
+	dev2 = litest_add_device(li, LITEST_MOUSE);
+
+	rc = libinput_set_event_coalescing(li,
+					   LIBINPUT_EVENT_COALESCING_SEAT_POINTER_MOTION);
+	ck_assert_int_eq(rc, 0);
+	litest_drain_events(li);
+
+	for (int i = 0; i < 4; i++) {
+		litest_event(dev1, EV_REL, REL_X, 10);
+		litest_event(dev1, EV_SYN, SYN_REPORT, 0);
+		litest_event(dev2, EV_REL, REL_Y, -5);
+		litest_event(dev2, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	ck_assert_int_eq(libinput_event_pointer_get_source_count(ptrev), 2);
+	for (size_t i = 0; i < 2; i++) {
+		struct libinput_device *d;
+
+		d = libinput_event_pointer_get_source_device(ptrev, i);
+		ck_assert(d == dev1->libinput_device ||
+			  d == dev2->libinput_device);
+		if (d == dev1->libinput_device) {
+			ck_assert_double_gt(libinput_event_pointer_get_source_dx(ptrev, i), 0.0);
+			litest_assert_double_eq(libinput_event_pointer_get_source_dy(ptrev, i), 0.0);
+		} else {
+			litest_assert_double_eq(libinput_event_pointer_get_source_dx(ptrev, i), 0.0);
+			ck_assert_double_lt(libinput_event_pointer_get_source_dy(ptrev, i), 0.0);
+		}
+		dx += libinput_event_pointer_get_source_dx(ptrev, i);
+		dy += libinput_event_pointer_get_source_dy(ptrev, i);
+	}
+	litest_assert_double_eq(dx, libinput_event_pointer_get_dx(ptrev));
+	litest_assert_double_eq(dy, libinput_event_pointer_get_dy(ptrev));
+
+	litest_disable_log_handler(li);
+	ck_assert(libinput_event_pointer_get_source_device(ptrev, 2) == NULL);
+	litest_restore_log_handler(li);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	/* A button event in between stops the merge */
+	litest_event(dev1, EV_REL, REL_X, 10);
+	litest_event(dev1, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	litest_button_click_debounced(dev1, li, BTN_LEFT, true);
+	litest_event(dev2, EV_REL, REL_X, 10);
+	litest_event(dev2, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	ck_assert_int_eq(libinput_event_pointer_get_source_count(ptrev), 1);
+	ck_assert(libinput_event_pointer_get_source_device(ptrev, 0) ==
+		  dev1->libinput_device);
+	litest_assert_double_eq(libinput_event_pointer_get_source_dx(ptrev, 0),
+				libinput_event_pointer_get_dx(ptrev));
+	libinput_event_destroy(event);
+	litest_assert_button_event(li, BTN_LEFT, LIBINPUT_BUTTON_STATE_PRESSED);
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	ck_assert(libinput_event_get_device(event) == dev2->libinput_device);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	litest_delete_device(dev1);
+	litest_delete_device(dev2);
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(pointer_frame_batching)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+
+	ck_assert_int_eq(libinput_get_pointer_frame_batching(li), 0);
+	libinput_set_pointer_frame_batching(li, 1);
+	ck_assert_int_ne(libinput_get_pointer_frame_batching(li), 0);
+	litest_drain_events(li);
+
+	litest_event(dev, EV_REL, REL_X, 10);
+	litest_event(dev, EV_REL, REL_Y, -5);
+	litest_event(dev, EV_KEY, BTN_LEFT, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	litest_assert_event_type(event, LIBINPUT_EVENT_POINTER_FRAME);
+	ptrev = libinput_event_get_pointer_event(event);
+	ck_assert_int_eq(libinput_event_pointer_get_frame_motion_type(ptrev),
+			 LIBINPUT_EVENT_POINTER_MOTION);
+	litest_assert_double_eq(libinput_event_pointer_get_dx_unaccelerated(ptrev),
+				10.0);
+	litest_assert_double_eq(libinput_event_pointer_get_dy_unaccelerated(ptrev),
+				-5.0);
+	ck_assert(!libinput_event_pointer_has_axis(ptrev,
+				LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL));
+	ck_assert_int_eq(libinput_event_pointer_get_frame_button_count(ptrev), 1);
+	ck_assert_int_eq(libinput_event_pointer_get_frame_button(ptrev, 0),
+			 BTN_LEFT);
+	ck_assert_int_eq(libinput_event_pointer_get_frame_button_state(ptrev, 0),
+			 LIBINPUT_BUTTON_STATE_PRESSED);
+	ck_assert_int_eq(libinput_event_pointer_get_frame_seat_button_count(ptrev, 0),
+			 1);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	litest_timeout_debounce();
+	libinput_dispatch(li);
+	litest_button_click_debounced(dev, li, BTN_LEFT, false);
+	litest_drain_events(li);
+
+	/* Motion and scroll end up in the same frame */
+	litest_event(dev, EV_REL, REL_X, 10);
+	litest_event(dev, EV_REL, REL_WHEEL, -1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	litest_assert_event_type(event, LIBINPUT_EVENT_POINTER_FRAME);
+	ptrev = libinput_event_get_pointer_event(event);
+	ck_assert_int_eq(libinput_event_pointer_get_frame_motion_type(ptrev),
+			 LIBINPUT_EVENT_POINTER_MOTION);
+	litest_assert_double_eq(libinput_event_pointer_get_dx_unaccelerated(ptrev),
+				10.0);
+	ck_assert_int_eq(libinput_event_pointer_get_frame_button_count(ptrev), 0);
+	ck_assert_int_eq(libinput_event_pointer_get_axis_source(ptrev),
+			 LIBINPUT_POINTER_AXIS_SOURCE_WHEEL);
+	ck_assert(libinput_event_pointer_has_axis(ptrev,
+				LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL));
+	ck_assert(!libinput_event_pointer_has_axis(ptrev,
+				LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL));
+	litest_assert_double_eq(
+		libinput_event_pointer_get_axis_value_discrete(ptrev,
+				LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL),
+		1.0);
+	ck_assert_double_gt(
+		libinput_event_pointer_get_axis_value(ptrev,
+				LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL),
+		0.0);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	/* Individual events again once batching is disabled */
+	libinput_set_pointer_frame_batching(li, 0);
+	litest_event(dev, EV_REL, REL_X, 10);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
 static void
 test_button_event(struct litest_device *dev, unsigned int button, int state)
 {
@@ -702,6 +1053,72 @@ START_TEST(pointer_scroll_wheel)
 }
 END_TEST
 
+START_TEST(pointer_scroll_wheel_coalescing)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	double step = wheel_click_angle(dev, REL_WHEEL);
+	int rc;
+
+	rc = libinput_set_event_coalescing(li,
+					   LIBINPUT_EVENT_COALESCING_POINTER_AXIS);
+	ck_assert_int_eq(rc, 0);
+
+	litest_drain_events(li);
+
+	/* mouse scroll wheels are 'upside down' */
+	for (int i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_WHEEL, -1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_axis_event(event,
+				     LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL,
+				     LIBINPUT_POINTER_AXIS_SOURCE_WHEEL);
+	litest_assert_double_eq(
+		libinput_event_pointer_get_axis_value(ptrev,
+						      LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL),
+		5 * step);
+	litest_assert_double_eq(
+		libinput_event_pointer_get_axis_value_discrete(ptrev,
+							       LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL),
+		5);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	/* A direction change starts a new event */
+	litest_event(dev, EV_REL, REL_WHEEL, -1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_event(dev, EV_REL, REL_WHEEL, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_axis_event(event,
+				     LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL,
+				     LIBINPUT_POINTER_AXIS_SOURCE_WHEEL);
+	litest_assert_double_eq(
+		libinput_event_pointer_get_axis_value_discrete(ptrev,
+							       LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL),
+		1);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	ptrev = litest_is_axis_event(event,
+				     LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL,
+				     LIBINPUT_POINTER_AXIS_SOURCE_WHEEL);
+	litest_assert_double_eq(
+		libinput_event_pointer_get_axis_value_discrete(ptrev,
+							       LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL),
+		-1);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
 START_TEST(pointer_scroll_natural_defaults)
 {
 	struct litest_device *dev = litest_current_device();
@@ -1926,6 +2343,7 @@ START_TEST(pointer_accel_profile_defaults)
 	profiles = libinput_device_config_accel_get_profiles(device);
 	ck_assert(profiles & LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE);
 	ck_assert(profiles & LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT);
+	ck_assert(profiles & LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM);
 
 	status = libinput_device_config_accel_set_profile(device,
 							  LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT);
@@ -1936,6 +2354,12 @@ START_TEST(pointer_accel_profile_defaults)
 	profile = libinput_device_config_accel_get_default_profile(device);
 	ck_assert_int_eq(profile, LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE);
 
+	status = libinput_device_config_accel_set_profile(device,
+							  LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	profile = libinput_device_config_accel_get_profile(device);
+	ck_assert_int_eq(profile, LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM);
+
 	status = libinput_device_config_accel_set_profile(device,
 							  LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE);
 	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
@@ -2049,6 +2473,154 @@ START_TEST(pointer_accel_profile_flat_motion_relative)
 }
 END_TEST
 
+static double
+accel_sum_dx(struct litest_device *dev, int nevents)
+{
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *pev;
+	double dx = 0.0;
+	int i;
+
+	litest_drain_events(li);
+
+	for (i = 0; i < nevents; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		libinput_dispatch(li);
+	}
+
+	while ((event = libinput_get_event(li))) {
+		pev = litest_is_motion_event(event);
+		dx += libinput_event_pointer_get_dx(pev);
+		libinput_event_destroy(event);
+	}
+
+	return dx;
+}
+
+START_TEST(pointer_accel_profile_custom)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	enum libinput_config_status status;
+	double double_speed[] = { 0.0, 2.0 };
+	double dx_flat, dx_custom;
+
+	status = libinput_device_config_accel_set_profile(device,
+							  LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	dx_flat = accel_sum_dx(dev, 10);
+
+	/* Can set the curve before selecting the profile */
+	status = libinput_device_config_accel_set_custom_curve(device,
+							       1.0,
+							       double_speed,
+							       ARRAY_LENGTH(double_speed));
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	status = libinput_device_config_accel_set_profile(device,
+							  LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+
+	dx_custom = accel_sum_dx(dev, 10);
+	ck_assert_double_eq(dx_custom, 2 * dx_flat);
+
+	/* Back to 1:1 while the custom profile is active */
+	double_speed[1] = 1.0;
+	status = libinput_device_config_accel_set_custom_curve(device,
+							       1.0,
+							       double_speed,
+							       ARRAY_LENGTH(double_speed));
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	dx_custom = accel_sum_dx(dev, 10);
+	ck_assert_double_eq(dx_custom, dx_flat);
+}
+END_TEST
+
+START_TEST(pointer_accel_profile_custom_invalid)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	enum libinput_config_status status;
+	double points[65] = {0};
+
+	status = libinput_device_config_accel_set_custom_curve(device,
+							       0.0,
+							       points,
+							       2);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_INVALID);
+	status = libinput_device_config_accel_set_custom_curve(device,
+							       1.0,
+							       points,
+							       1);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_INVALID);
+	status = libinput_device_config_accel_set_custom_curve(device,
+							       1.0,
+							       points,
+							       ARRAY_LENGTH(points));
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_INVALID);
+	status = libinput_device_config_accel_set_custom_curve(device,
+							       1.0,
+							       NULL,
+							       2);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_INVALID);
+
+	points[1] = -1.0;
+	status = libinput_device_config_accel_set_custom_curve(device,
+							       1.0,
+							       points,
+							       2);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_INVALID);
+
+	points[1] = 1.0;
+	status = libinput_device_config_accel_set_custom_curve(device,
+							       1.0,
+							       points,
+							       64);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+}
+END_TEST
+
+START_TEST(pointer_accel_profile_custom_max_points)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	enum libinput_config_status status;
+	double points[64] = {0};
+	double step = 0.0001;
+
+	/* Flat zero except for the last segment, any movement is faster
+	 * than the last point. We only get motion if the curve keeps
+	 * all of its points. */
+	points[63] = 2 * 63 * step;
+	status = libinput_device_config_accel_set_custom_curve(device,
+							       step,
+							       points,
+							       ARRAY_LENGTH(points));
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	status = libinput_device_config_accel_set_profile(device,
+							  LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+
+	ck_assert_double_gt(accel_sum_dx(dev, 10), 0.0);
+}
+END_TEST
+
+START_TEST(pointer_accel_profile_custom_unsupported)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	enum libinput_config_status status;
+	double points[] = { 0.0, 1.0 };
+
+	status = libinput_device_config_accel_set_custom_curve(device,
+							       1.0,
+							       points,
+							       ARRAY_LENGTH(points));
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_UNSUPPORTED);
+}
+END_TEST
+
 START_TEST(middlebutton)
 {
 	struct litest_device *device = litest_current_device();
@@ -2181,6 +2753,58 @@ START_TEST(middlebutton_timeout)
 }
 END_TEST
 
+START_TEST(middlebutton_latency_stats)
+{
+	struct litest_device *device = litest_current_device();
+	struct libinput_device *d = device->libinput_device;
+	struct libinput *li = device->libinput;
+	enum libinput_config_status status;
+	unsigned int button;
+	uint64_t max;
+
+	disable_button_scrolling(device);
+
+	status = libinput_device_config_middle_emulation_set_enabled(
+					    d,
+					    LIBINPUT_CONFIG_MIDDLE_EMULATION_ENABLED);
+	if (status == LIBINPUT_CONFIG_STATUS_UNSUPPORTED)
+		return;
+
+	libinput_device_set_latency_tracking(d, 1);
+	litest_drain_events(li);
+
+	/* a chord doesn't delay anything */
+	litest_button_click_debounced(device, li, BTN_LEFT, true);
+	litest_button_click_debounced(device, li, BTN_RIGHT, true);
+	litest_button_click_debounced(device, li, BTN_RIGHT, false);
+	litest_button_click_debounced(device, li, BTN_LEFT, false);
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_device_get_latency_stats(d,
+							   LIBINPUT_LATENCY_STAT_MIDDLEBUTTON_SAMPLES),
+			 0);
+
+	for (button = BTN_LEFT; button <= BTN_RIGHT; button++) {
+		litest_button_click_debounced(device, li, button, true);
+		litest_timeout_middlebutton();
+		libinput_dispatch(li);
+		litest_button_click_debounced(device, li, button, false);
+		litest_drain_events(li);
+	}
+
+	ck_assert_int_eq(libinput_device_get_latency_stats(d,
+							   LIBINPUT_LATENCY_STAT_MIDDLEBUTTON_SAMPLES),
+			 2);
+	max = libinput_device_get_latency_stats(d,
+						LIBINPUT_LATENCY_STAT_MIDDLEBUTTON_MAX);
+	ck_assert_int_gt(max, 0);
+	ck_assert_int_le(libinput_device_get_latency_stats(d,
+							   LIBINPUT_LATENCY_STAT_MIDDLEBUTTON_P50),
+			 2 * max);
+
+	libinput_device_set_latency_tracking(d, 0);
+}
+END_TEST
+
 START_TEST(middlebutton_doubleclick)
 {
 	struct litest_device *device = litest_current_device();
@@ -2755,6 +3379,63 @@ START_TEST(debounce_bounce)
 }
 END_TEST
 
+START_TEST(debounce_bounce_after_clean_clicks)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+
+	litest_disable_middleemu(dev);
+	disable_button_scrolling(dev);
+	litest_drain_events(li);
+
+	/* Enough clicks without a bounce for the debouncer to stop arming
+	 * its timers */
+	for (int i = 0; i < 20; i++) {
+		litest_button_click_debounced(dev, li, BTN_LEFT, true);
+		litest_assert_button_event(li,
+					   BTN_LEFT,
+					   LIBINPUT_BUTTON_STATE_PRESSED);
+
+		litest_button_click_debounced(dev, li, BTN_LEFT, false);
+		litest_assert_button_event(li,
+					   BTN_LEFT,
+					   LIBINPUT_BUTTON_STATE_RELEASED);
+	}
+	litest_assert_empty_queue(li);
+
+	/* A bounce must still be filtered */
+	litest_event(dev, EV_KEY, BTN_LEFT, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_event(dev, EV_KEY, BTN_LEFT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_event(dev, EV_KEY, BTN_LEFT, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	litest_timeout_debounce();
+	libinput_dispatch(li);
+
+	litest_assert_button_event(li,
+				   BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_assert_empty_queue(li);
+
+	litest_event(dev, EV_KEY, BTN_LEFT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_event(dev, EV_KEY, BTN_LEFT, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_event(dev, EV_KEY, BTN_LEFT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	litest_timeout_debounce();
+	libinput_dispatch(li);
+
+	litest_assert_button_event(li,
+				   BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_RELEASED);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
 START_TEST(debounce_bounce_check_immediate)
 {
 	struct litest_device *dev = litest_current_device();
@@ -3192,8 +3873,14 @@ TEST_COLLECTION(pointer)
 
 	litest_add("pointer:motion", pointer_motion_relative, LITEST_RELATIVE, LITEST_POINTINGSTICK);
 	litest_add_for_device("pointer:motion", pointer_motion_relative_zero, LITEST_MOUSE);
+	litest_add_for_device("pointer:motion", pointer_motion_coalescing, LITEST_MOUSE);
+	litest_add_no_device("pointer:motion", pointer_motion_seat_coalescing);
+	litest_add_for_device("pointer:frame", pointer_frame_batching, LITEST_MOUSE);
+	litest_add_for_device("pointer:motion", pointer_motion_catch_up, LITEST_MOUSE);
+	litest_add_for_device("pointer:scroll", pointer_scroll_wheel_coalescing, LITEST_MOUSE);
 	litest_add_ranged("pointer:motion", pointer_motion_relative_min_decel, LITEST_RELATIVE, LITEST_POINTINGSTICK, &compass);
 	litest_add("pointer:motion", pointer_motion_absolute, LITEST_ABSOLUTE, LITEST_ANY);
+	litest_add("pointer:motion", pointer_motion_absolute_virtual, LITEST_ABSOLUTE|LITEST_VIRTUAL, LITEST_ANY);
 	litest_add("pointer:motion", pointer_motion_unaccel, LITEST_RELATIVE, LITEST_ANY);
 	litest_add("pointer:button", pointer_button, LITEST_BUTTON, LITEST_CLICKPAD);
 	litest_add_no_device("pointer:button", pointer_button_auto_release);
@@ -3244,17 +3931,23 @@ TEST_COLLECTION(pointer)
 	litest_add("pointer:accel", pointer_accel_profile_invalid, LITEST_RELATIVE, LITEST_ANY);
 	litest_add("pointer:accel", pointer_accel_profile_noaccel, LITEST_ANY, LITEST_TOUCHPAD|LITEST_RELATIVE|LITEST_TABLET);
 	litest_add("pointer:accel", pointer_accel_profile_flat_motion_relative, LITEST_RELATIVE, LITEST_TOUCHPAD);
+	litest_add("pointer:accel", pointer_accel_profile_custom, LITEST_RELATIVE, LITEST_TOUCHPAD);
+	litest_add("pointer:accel", pointer_accel_profile_custom_invalid, LITEST_RELATIVE, LITEST_TOUCHPAD);
+	litest_add("pointer:accel", pointer_accel_profile_custom_max_points, LITEST_RELATIVE, LITEST_TOUCHPAD);
+	litest_add("pointer:accel", pointer_accel_profile_custom_unsupported, LITEST_TOUCHPAD, LITEST_ANY);
 
 	litest_add("pointer:middlebutton", middlebutton, LITEST_BUTTON, LITEST_CLICKPAD);
 	litest_add("pointer:middlebutton", middlebutton_nostart_while_down, LITEST_BUTTON, LITEST_CLICKPAD);
 	litest_add("pointer:middlebutton", middlebutton_timeout, LITEST_BUTTON, LITEST_CLICKPAD);
+	litest_add("pointer:middlebutton", middlebutton_latency_stats, LITEST_BUTTON, LITEST_CLICKPAD);
 	litest_add("pointer:middlebutton", middlebutton_doubleclick, LITEST_BUTTON, LITEST_CLICKPAD);
 	litest_add("pointer:middlebutton", middlebutton_middleclick, LITEST_BUTTON, LITEST_CLICKPAD);
 	litest_add("pointer:middlebutton", middlebutton_middleclick_during, LITEST_BUTTON, LITEST_CLICKPAD);
-	litest_add("pointer:middlebutton", middlebutton_default_enabled, LITEST_BUTTON, LITEST_TOUCHPAD|LITEST_POINTINGSTICK);
+	litest_add("pointer:middlebutton", middlebutton_default_enabled, LITEST_BUTTON, LITEST_TOUCHPAD|LITEST_POINTINGSTICK|LITEST_VIRTUAL);
 	litest_add("pointer:middlebutton", middlebutton_default_clickpad, LITEST_CLICKPAD, LITEST_ANY);
 	litest_add("pointer:middlebutton", middlebutton_default_touchpad, LITEST_TOUCHPAD, LITEST_CLICKPAD);
 	litest_add("pointer:middlebutton", middlebutton_default_disabled, LITEST_ANY, LITEST_BUTTON);
+	litest_add("pointer:middlebutton", middlebutton_default_disabled, LITEST_VIRTUAL, LITEST_ANY);
 	litest_add_for_device("pointer:middlebutton", middlebutton_default_alps, LITEST_ALPS_SEMI_MT);
 	litest_add("pointer:middlebutton", middlebutton_button_scrolling, LITEST_RELATIVE|LITEST_BUTTON, LITEST_CLICKPAD);
 	litest_add("pointer:middlebutton", middlebutton_button_scrolling_middle, LITEST_RELATIVE|LITEST_BUTTON, LITEST_CLICKPAD);
@@ -3267,6 +3960,7 @@ TEST_COLLECTION(pointer)
 
 	litest_add_ranged("pointer:debounce", debounce_bounce, LITEST_BUTTON, LITEST_TOUCHPAD|LITEST_NO_DEBOUNCE, &buttons);
 	litest_add("pointer:debounce", debounce_bounce_check_immediate, LITEST_BUTTON, LITEST_TOUCHPAD|LITEST_NO_DEBOUNCE);
+	litest_add("pointer:debounce", debounce_bounce_after_clean_clicks, LITEST_BUTTON, LITEST_TOUCHPAD|LITEST_NO_DEBOUNCE);
 	litest_add_ranged("pointer:debounce", debounce_spurious, LITEST_BUTTON, LITEST_TOUCHPAD|LITEST_NO_DEBOUNCE, &buttons);
 	litest_add("pointer:debounce", debounce_spurious_multibounce, LITEST_BUTTON, LITEST_TOUCHPAD|LITEST_NO_DEBOUNCE);
 	litest_add("pointer:debounce_otherbutton", debounce_spurious_dont_enable_on_otherbutton, LITEST_BUTTON, LITEST_TOUCHPAD|LITEST_NO_DEBOUNCE);
@@ -24,6 +24,10 @@
 #include <config.h>
 
 #include <check.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <libinput.h>
 
 #include "libinput-util.h"
@@ -1065,6 +1069,8 @@ START_TEST(quirks_parse_uint_attr)
 		QUIRK_ATTR_PALM_SIZE_THRESHOLD,
 		QUIRK_ATTR_PALM_PRESSURE_THRESHOLD,
 		QUIRK_ATTR_THUMB_PRESSURE_THRESHOLD,
+		QUIRK_ATTR_TOUCHPAD_HISTORY_LENGTH,
+		QUIRK_ATTR_TABLET_SMOOTHING_WINDOW,
 	};
 	enum quirk *a;
 	struct qtest_uint test_values[] = {
@@ -1166,6 +1172,7 @@ START_TEST(quirks_parse_string_attr)
 		QUIRK_ATTR_TPKBCOMBO_LAYOUT,
 		QUIRK_ATTR_LID_SWITCH_RELIABILITY,
 		QUIRK_ATTR_KEYBOARD_INTEGRATION,
+		QUIRK_ATTR_DISPATCH_PRIORITY,
 	};
 	enum quirk *a;
 	struct qtest_str test_values[] = {
@@ -1174,6 +1181,8 @@ START_TEST(quirks_parse_string_attr)
 		{ "write_open", QUIRK_ATTR_LID_SWITCH_RELIABILITY },
 		{ "internal", QUIRK_ATTR_KEYBOARD_INTEGRATION },
 		{ "external", QUIRK_ATTR_KEYBOARD_INTEGRATION },
+		{ "low", QUIRK_ATTR_DISPATCH_PRIORITY },
+		{ "normal", QUIRK_ATTR_DISPATCH_PRIORITY },
 
 		{ "10", 0 },
 		{ "-10", 0 },
@@ -1272,6 +1281,716 @@ START_TEST(quirks_model_one)
 }
 END_TEST
 
+START_TEST(quirks_section_order)
+{
+	struct litest_device *dev = litest_current_device();
+	struct udev_device *ud = libinput_device_get_udev_device(dev->libinput_device);
+	struct quirks_context *ctx;
+	/* Sections are indexed by vendor/product, but the last matching
+	 * section must still win regardless of which index it's in */
+	const char quirks_file[] =
+	"[generic first]\n"
+	"MatchUdevType=mouse\n"
+	"AttrPalmSizeThreshold=1\n"
+	"AttrThumbSizeThreshold=1\n"
+	"\n"
+	"[vendor]\n"
+	"MatchVendor=0x17EF\n"
+	"AttrPalmSizeThreshold=2\n"
+	"AttrThumbSizeThreshold=2\n"
+	"\n"
+	"[other vendor]\n"
+	"MatchVendor=0x17EE\n"
+	"AttrPalmSizeThreshold=10\n"
+	"AttrThumbSizeThreshold=10\n"
+	"\n"
+	"[vendor and product]\n"
+	"MatchVendor=0x17EF\n"
+	"MatchProduct=0x6019\n"
+	"AttrPalmSizeThreshold=3\n"
+	"\n"
+	"[generic last]\n"
+	"MatchUdevType=mouse\n"
+	"AttrThumbSizeThreshold=4\n";
+	struct data_dir dd = make_data_dir(quirks_file);
+	struct quirks *q;
+	uint32_t v;
+
+	ctx = quirks_init_subsystem(dd.dirname,
+				    NULL,
+				    log_handler,
+				    NULL,
+				    QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+
+	q = quirks_fetch_for_device(ctx, ud);
+	ck_assert_notnull(q);
+
+	ck_assert(quirks_get_uint32(q, QUIRK_ATTR_PALM_SIZE_THRESHOLD, &v));
+	ck_assert_int_eq(v, 3);
+	ck_assert(quirks_get_uint32(q, QUIRK_ATTR_THUMB_SIZE_THRESHOLD, &v));
+	ck_assert_int_eq(v, 4);
+
+	quirks_unref(q);
+	quirks_context_unref(ctx);
+	cleanup_data_dir(dd);
+	udev_device_unref(ud);
+}
+END_TEST
+
+START_TEST(quirks_match_dmi)
+{
+	struct litest_device *dev = litest_current_device();
+	struct udev_device *ud = libinput_device_get_udev_device(dev->libinput_device);
+	struct quirks_context *ctx;
+	/* The test suite's DMI modalias is "dmi:" */
+	const char quirks_file[] =
+	"[host]\n"
+	"MatchUdevType=mouse\n"
+	"MatchDMIModalias=dmi:*\n"
+	"AttrPalmSizeThreshold=1\n"
+	"\n"
+	"[other host]\n"
+	"MatchUdevType=mouse\n"
+	"MatchDMIModalias=dmi:*svnFoo*\n"
+	"AttrPalmSizeThreshold=2\n"
+	"AttrThumbSizeThreshold=2\n";
+	struct data_dir dd = make_data_dir(quirks_file);
+	struct quirks *q;
+	uint32_t v;
+
+	ctx = quirks_init_subsystem(dd.dirname,
+				    NULL,
+				    log_handler,
+				    NULL,
+				    QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+
+	q = quirks_fetch_for_device(ctx, ud);
+	ck_assert_notnull(q);
+
+	ck_assert(quirks_get_uint32(q, QUIRK_ATTR_PALM_SIZE_THRESHOLD, &v));
+	ck_assert_int_eq(v, 1);
+	ck_assert(!quirks_has_quirk(q, QUIRK_ATTR_THUMB_SIZE_THRESHOLD));
+
+	quirks_unref(q);
+	quirks_context_unref(ctx);
+	cleanup_data_dir(dd);
+	udev_device_unref(ud);
+}
+END_TEST
+
+static int fetch_count;
+
+static void
+count_fetch_log_handler(struct libinput *this_is_null,
+			enum libinput_log_priority priority,
+			const char *format,
+			va_list args)
+{
+	if (strstr(format, "fetching quirks"))
+		fetch_count++;
+}
+
+START_TEST(quirks_cache)
+{
+	struct litest_device *dev = litest_current_device();
+	struct udev_device *ud = libinput_device_get_udev_device(dev->libinput_device);
+	struct quirks_context *ctx;
+	const char quirks_file[] =
+	"[mouse]\n"
+	"MatchUdevType=mouse\n"
+	"AttrPalmSizeThreshold=1\n";
+	struct data_dir dd = make_data_dir(quirks_file);
+	struct quirks *q1, *q2;
+	uint32_t v;
+
+	fetch_count = 0;
+	ctx = quirks_init_subsystem(dd.dirname,
+				    NULL,
+				    count_fetch_log_handler,
+				    NULL,
+				    QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+
+	q1 = quirks_fetch_for_device(ctx, ud);
+	q2 = quirks_fetch_for_device(ctx, ud);
+	ck_assert_notnull(q1);
+	ck_assert_ptr_eq(q1, q2);
+	ck_assert_int_eq(fetch_count, 1);
+	ck_assert(quirks_get_uint32(q2, QUIRK_ATTR_PALM_SIZE_THRESHOLD, &v));
+	ck_assert_int_eq(v, 1);
+	quirks_unref(q1);
+	quirks_unref(q2);
+
+	/* Fetched in this generation, survives the expiry */
+	quirks_cache_expire(ctx);
+	q1 = quirks_fetch_for_device(ctx, ud);
+	quirks_unref(q1);
+	ck_assert_int_eq(fetch_count, 1);
+
+	/* Kept without fetching, still survives */
+	quirks_cache_expire(ctx);
+	quirks_cache_keep(ctx, ud);
+	quirks_cache_expire(ctx);
+	q1 = quirks_fetch_for_device(ctx, ud);
+	quirks_unref(q1);
+	ck_assert_int_eq(fetch_count, 1);
+
+	/* Neither fetched nor kept */
+	quirks_cache_expire(ctx);
+	quirks_cache_expire(ctx);
+	q1 = quirks_fetch_for_device(ctx, ud);
+	ck_assert_notnull(q1);
+	quirks_unref(q1);
+	ck_assert_int_eq(fetch_count, 2);
+
+	quirks_cache_forget(ctx, ud);
+	q1 = quirks_fetch_for_device(ctx, ud);
+	ck_assert_notnull(q1);
+	ck_assert_int_eq(fetch_count, 3);
+
+	/* Still referenced by the cache until the context goes */
+	quirks_unref(q1);
+	quirks_context_unref(ctx);
+	cleanup_data_dir(dd);
+	udev_device_unref(ud);
+}
+END_TEST
+
+static void
+rewrite_data_file(struct data_dir dd, const char *file_content)
+{
+	FILE *fp;
+
+	fp = fopen(dd.filename, "w");
+	litest_assert_notnull(fp);
+	litest_assert_int_ge(fputs(file_content, fp), 0);
+	fclose(fp);
+}
+
+static uint32_t
+image_test_palm_size(struct data_dir dd, struct udev_device *ud)
+{
+	struct quirks_context *ctx;
+	struct quirks *q;
+	struct quirk_dimensions dim;
+	bool isset;
+	uint32_t v;
+
+	ctx = quirks_init_subsystem(dd.dirname,
+				    NULL,
+				    log_handler,
+				    NULL,
+				    QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+	q = quirks_fetch_for_device(ctx, ud);
+	ck_assert_notnull(q);
+
+	ck_assert(quirks_get_bool(q, QUIRK_MODEL_APPLE_TOUCHPAD, &isset));
+	ck_assert(isset == true);
+	ck_assert(quirks_get_dimensions(q, QUIRK_ATTR_SIZE_HINT, &dim));
+	ck_assert_int_eq(dim.x, 10);
+	ck_assert_int_eq(dim.y, 20);
+	ck_assert(quirks_get_uint32(q, QUIRK_ATTR_PALM_SIZE_THRESHOLD, &v));
+
+	quirks_unref(q);
+	quirks_context_unref(ctx);
+
+	return v;
+}
+
+START_TEST(quirks_image)
+{
+	struct litest_device *dev = litest_current_device();
+	struct udev_device *ud = libinput_device_get_udev_device(dev->libinput_device);
+	const char quirks_file[] =
+	"[Section name]\n"
+	"MatchUdevType=mouse\n"
+	"ModelAppleTouchpad=1\n"
+	"AttrSizeHint=10x20\n"
+	"AttrPalmSizeThreshold=5\n";
+	const char quirks_file_changed[] =
+	"[Section name]\n"
+	"MatchUdevType=mouse\n"
+	"ModelAppleTouchpad=1\n"
+	"AttrSizeHint=10x20\n"
+	"AttrPalmSizeThreshold=7\n";
+	struct data_dir dd = make_data_dir(quirks_file);
+	struct timespec times[2];
+	struct stat st;
+	char *image;
+
+	ck_assert(quirks_compile_image(dd.dirname,
+				       NULL,
+				       log_handler,
+				       QLOG_CUSTOM_LOG_PRIORITIES));
+	xasprintf(&image, "%s/quirks.bin", dd.dirname);
+	ck_assert_int_eq(access(image, R_OK), 0);
+
+	ck_assert_int_eq(image_test_palm_size(dd, ud), 5);
+
+	/* Same size and mtime: the image is used and we get the old value */
+	ck_assert_int_eq(stat(dd.filename, &st), 0);
+	times[0] = st.st_atim;
+	times[1] = st.st_mtim;
+	rewrite_data_file(dd, quirks_file_changed);
+	ck_assert_int_eq(utimensat(AT_FDCWD, dd.filename, times, 0), 0);
+	ck_assert_int_eq(image_test_palm_size(dd, ud), 5);
+
+	/* A modified file makes the image stale */
+	times[1].tv_sec += 1;
+	ck_assert_int_eq(utimensat(AT_FDCWD, dd.filename, times, 0), 0);
+	ck_assert_int_eq(image_test_palm_size(dd, ud), 7);
+
+	unlink(image);
+	free(image);
+	cleanup_data_dir(dd);
+	udev_device_unref(ud);
+}
+END_TEST
+
+/* Must match the layout in quirks.c */
+struct test_image_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t last_model_quirk;
+	uint32_t last_attr_quirk;
+	uint64_t stamp;
+	uint64_t checksum;
+	uint64_t size;
+	uint32_t nsections;
+	uint32_t padding;
+};
+
+static uint64_t
+test_image_checksum(const uint8_t *data, size_t len)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= data[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+START_TEST(quirks_image_missing_match_string)
+{
+	struct litest_device *dev = litest_current_device();
+	struct udev_device *ud = libinput_device_get_udev_device(dev->libinput_device);
+	const char quirks_file[] =
+	"[Section name]\n"
+	"MatchName=*Mouse*\n"
+	"ModelAppleTouchpad=1\n"
+	"AttrSizeHint=10x20\n"
+	"AttrPalmSizeThreshold=5\n";
+	const char quirks_file_changed[] =
+	"[Section name]\n"
+	"MatchName=*Mouse*\n"
+	"ModelAppleTouchpad=1\n"
+	"AttrSizeHint=10x20\n"
+	"AttrPalmSizeThreshold=7\n";
+	const char match[] = "\x08\0\0\0*Mouse*";
+	struct data_dir dd = make_data_dir(quirks_file);
+	struct test_image_header header;
+	struct timespec times[2];
+	struct stat st;
+	uint8_t *data, *str;
+	uint32_t zero = 0;
+	size_t len, offset;
+	char *image;
+	FILE *fp;
+
+	ck_assert(quirks_compile_image(dd.dirname,
+				       NULL,
+				       log_handler,
+				       QLOG_CUSTOM_LOG_PRIORITIES));
+	xasprintf(&image, "%s/quirks.bin", dd.dirname);
+
+	ck_assert_int_eq(stat(image, &st), 0);
+	len = st.st_size;
+	data = zalloc(len);
+	fp = fopen(image, "r");
+	litest_assert_notnull(fp);
+	ck_assert_int_eq(fread(data, 1, len, fp), len);
+	fclose(fp);
+
+	/* Replace the MatchName string with an empty one but leave the
+	 * match bit set. The checksum is valid, only the section isn't. */
+	str = memmem(data, len, match, sizeof(match));
+	litest_assert_notnull(str);
+	offset = str - data;
+	memcpy(&data[offset], &zero, sizeof(zero));
+	memmove(&data[offset + sizeof(zero)],
+		&data[offset + sizeof(match)],
+		len - offset - sizeof(match));
+	len -= sizeof(match) - sizeof(zero);
+
+	memcpy(&header, data, sizeof(header));
+	header.size = len - sizeof(header);
+	header.checksum = test_image_checksum(&data[sizeof(header)],
+					      header.size);
+	memcpy(data, &header, sizeof(header));
+
+	fp = fopen(image, "w");
+	litest_assert_notnull(fp);
+	ck_assert_int_eq(fwrite(data, 1, len, fp), len);
+	fclose(fp);
+	free(data);
+
+	/* Change the data file without changing the stamp: we only see
+	 * the new value if the image is rejected */
+	ck_assert_int_eq(stat(dd.filename, &st), 0);
+	times[0] = st.st_atim;
+	times[1] = st.st_mtim;
+	rewrite_data_file(dd, quirks_file_changed);
+	ck_assert_int_eq(utimensat(AT_FDCWD, dd.filename, times, 0), 0);
+	ck_assert_int_eq(image_test_palm_size(dd, ud), 7);
+
+	unlink(image);
+	free(image);
+	cleanup_data_dir(dd);
+	udev_device_unref(ud);
+}
+END_TEST
+
+static uint32_t
+device_cache_test_palm_size(struct data_dir dd,
+			    const char *cache,
+			    struct udev_device *ud)
+{
+	struct quirks_context *ctx;
+	struct quirks *q;
+	struct quirk_dimensions dim;
+	bool isset;
+	uint32_t v;
+
+	ctx = quirks_init_subsystem_cached(dd.dirname,
+					   NULL,
+					   cache,
+					   log_handler,
+					   NULL,
+					   QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+	q = quirks_fetch_for_device(ctx, ud);
+	ck_assert_notnull(q);
+
+	ck_assert(quirks_get_bool(q, QUIRK_MODEL_APPLE_TOUCHPAD, &isset));
+	ck_assert(isset == true);
+	ck_assert(quirks_get_dimensions(q, QUIRK_ATTR_SIZE_HINT, &dim));
+	ck_assert_int_eq(dim.x, 10);
+	ck_assert_int_eq(dim.y, 20);
+	ck_assert(quirks_get_uint32(q, QUIRK_ATTR_PALM_SIZE_THRESHOLD, &v));
+	quirks_unref(q);
+
+	ck_assert_int_eq(quirks_context_write_device_cache(ctx), 0);
+	quirks_context_unref(ctx);
+
+	return v;
+}
+
+START_TEST(quirks_device_cache)
+{
+	struct litest_device *dev = litest_current_device();
+	struct udev_device *ud = libinput_device_get_udev_device(dev->libinput_device);
+	struct quirks_context *ctx;
+	const char quirks_file[] =
+	"[Section name]\n"
+	"MatchUdevType=mouse\n"
+	"ModelAppleTouchpad=1\n"
+	"AttrSizeHint=10x20\n"
+	"AttrPalmSizeThreshold=5\n";
+	const char quirks_file_changed[] =
+	"[Section name]\n"
+	"MatchUdevType=mouse\n"
+	"ModelAppleTouchpad=1\n"
+	"AttrSizeHint=10x20\n"
+	"AttrPalmSizeThreshold=7\n";
+	struct data_dir dd = make_data_dir(quirks_file);
+	struct timespec times[2];
+	struct stat st;
+	char *cache;
+
+	/* No cache to write to */
+	ctx = quirks_init_subsystem(dd.dirname,
+				    NULL,
+				    log_handler,
+				    NULL,
+				    QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+	ck_assert_int_eq(quirks_context_write_device_cache(ctx), -EINVAL);
+	quirks_context_unref(ctx);
+
+	xasprintf(&cache, "%s/devices.bin", dd.dirname);
+	ck_assert_int_eq(device_cache_test_palm_size(dd, cache, ud), 5);
+	ck_assert_int_eq(access(cache, R_OK), 0);
+
+	/* Same size and mtime: the device comes from the cache and the
+	 * data file isn't even parsed */
+	ck_assert_int_eq(stat(dd.filename, &st), 0);
+	times[0] = st.st_atim;
+	times[1] = st.st_mtim;
+	rewrite_data_file(dd, quirks_file_changed);
+	ck_assert_int_eq(utimensat(AT_FDCWD, dd.filename, times, 0), 0);
+	ck_assert_int_eq(device_cache_test_palm_size(dd, cache, ud), 5);
+
+	/* A modified file makes the cache stale */
+	times[1].tv_sec += 1;
+	ck_assert_int_eq(utimensat(AT_FDCWD, dd.filename, times, 0), 0);
+	ck_assert_int_eq(device_cache_test_palm_size(dd, cache, ud), 7);
+
+	/* The stale cache was replaced */
+	rewrite_data_file(dd, quirks_file);
+	ck_assert_int_eq(utimensat(AT_FDCWD, dd.filename, times, 0), 0);
+	ck_assert_int_eq(device_cache_test_palm_size(dd, cache, ud), 7);
+
+	unlink(cache);
+	free(cache);
+	cleanup_data_dir(dd);
+	udev_device_unref(ud);
+}
+END_TEST
+
+static uint32_t
+reload_test_palm_size(struct quirks_context *ctx, struct udev_device *ud)
+{
+	struct quirks *q;
+	uint32_t v = 0;
+
+	q = quirks_fetch_for_device(ctx, ud);
+	ck_assert_notnull(q);
+	ck_assert(quirks_get_uint32(q, QUIRK_ATTR_PALM_SIZE_THRESHOLD, &v));
+	quirks_unref(q);
+
+	return v;
+}
+
+START_TEST(quirks_reload)
+{
+	struct litest_device *dev = litest_current_device();
+	struct udev_device *ud = libinput_device_get_udev_device(dev->libinput_device);
+	struct quirks_context *ctx;
+	const char quirks_file[] =
+	"[mouse]\n"
+	"MatchUdevType=mouse\n"
+	"AttrPalmSizeThreshold=1\n";
+	const char quirks_file_changed[] =
+	"[mouse]\n"
+	"MatchUdevType=mouse\n"
+	"AttrPalmSizeThreshold=12\n";
+	const char quirks_file_other[] =
+	"[keyboard]\n"
+	"MatchUdevType=keyboard\n"
+	"AttrKeyboardIntegration=internal\n";
+	const char quirks_file_broken[] =
+	"[mouse]\n"
+	"MatchUdevType=mouse\n";
+	struct data_dir dd = make_data_dir(quirks_file);
+	char *other;
+	FILE *fp;
+	bool changed;
+	int rc;
+
+	ctx = quirks_init_subsystem(dd.dirname,
+				    NULL,
+				    log_handler,
+				    NULL,
+				    QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+	ck_assert_int_eq(reload_test_palm_size(ctx, ud), 1);
+
+	/* Nothing changed */
+	rc = quirks_context_reload(ctx, &ud, 1, &changed);
+	ck_assert_int_eq(rc, 0);
+	ck_assert(!changed);
+
+	rewrite_data_file(dd, quirks_file_changed);
+	rc = quirks_context_reload(ctx, &ud, 1, &changed);
+	ck_assert_int_eq(rc, 1);
+	ck_assert(changed);
+	ck_assert_int_eq(reload_test_palm_size(ctx, ud), 12);
+
+	/* A new file that doesn't apply to the device */
+	xasprintf(&other, "%s/other.quirks", dd.dirname);
+	fp = fopen(other, "w");
+	ck_assert_notnull(fp);
+	fputs(quirks_file_other, fp);
+	fclose(fp);
+	rc = quirks_context_reload(ctx, &ud, 1, &changed);
+	ck_assert_int_eq(rc, 1);
+	ck_assert(!changed);
+	ck_assert_int_eq(reload_test_palm_size(ctx, ud), 12);
+
+	/* A broken file keeps the previous state */
+	rewrite_data_file(dd, quirks_file_broken);
+	rc = quirks_context_reload(ctx, &ud, 1, &changed);
+	ck_assert_int_lt(rc, 0);
+	ck_assert(!changed);
+	ck_assert_int_eq(reload_test_palm_size(ctx, ud), 12);
+
+	unlink(other);
+	free(other);
+	quirks_context_unref(ctx);
+	cleanup_data_dir(dd);
+	udev_device_unref(ud);
+}
+END_TEST
+
+static void
+write_numbered_data_file(struct data_dir dd, int n, const char *content)
+{
+	char *path;
+	FILE *fp;
+
+	xasprintf(&path, "%s/%d-test.quirks", dd.dirname, n);
+	fp = fopen(path, "w");
+	ck_assert_notnull(fp);
+	fputs(content, fp);
+	fclose(fp);
+	free(path);
+}
+
+START_TEST(quirks_parse_many_files)
+{
+	struct litest_device *dev = litest_current_device();
+	struct udev_device *ud = libinput_device_get_udev_device(dev->libinput_device);
+	struct quirks_context *ctx;
+	struct data_dir dd = make_data_dir(NULL);
+	const int nfiles = 32;
+	char *path;
+
+	/* Enough files to be parsed on worker threads, the last one in
+	 * versionsort order must win */
+	for (int i = 1; i <= nfiles; i++) {
+		char *content;
+
+		xasprintf(&content,
+			  "[mouse %d]\n"
+			  "MatchUdevType=mouse\n"
+			  "AttrPalmSizeThreshold=%d\n",
+			  i, i);
+		write_numbered_data_file(dd, i, content);
+		free(content);
+	}
+
+	ctx = quirks_init_subsystem(dd.dirname,
+				    NULL,
+				    log_handler,
+				    NULL,
+				    QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+	ck_assert_int_eq(reload_test_palm_size(ctx, ud), nfiles);
+	quirks_context_unref(ctx);
+
+	/* One broken file fails the lot */
+	write_numbered_data_file(dd, 12, "[mouse]\nMatchUdevType=mouse\n");
+	ctx = quirks_init_subsystem(dd.dirname,
+				    NULL,
+				    log_handler,
+				    NULL,
+				    QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert(ctx == NULL);
+
+	for (int i = 1; i <= nfiles; i++) {
+		xasprintf(&path, "%s/%d-test.quirks", dd.dirname, i);
+		unlink(path);
+		free(path);
+	}
+	cleanup_data_dir(dd);
+	udev_device_unref(ud);
+}
+END_TEST
+
+struct thread_allocator {
+	pthread_t thread;
+	size_t allocs;
+	size_t foreign; /* calls from other threads */
+};
+
+static void
+thread_allocator_count(struct thread_allocator *a)
+{
+	if (pthread_equal(pthread_self(), a->thread))
+		a->allocs++;
+	else
+		__atomic_fetch_add(&a->foreign, 1, __ATOMIC_RELAXED);
+}
+
+static void *
+thread_alloc(size_t size, void *data)
+{
+	thread_allocator_count(data);
+	return malloc(size);
+}
+
+static void *
+thread_realloc(void *ptr, size_t size, void *data)
+{
+	thread_allocator_count(data);
+	return realloc(ptr, size);
+}
+
+static void
+thread_free(void *ptr, void *data)
+{
+	thread_allocator_count(data);
+	free(ptr);
+}
+
+START_TEST(quirks_parse_custom_allocator)
+{
+	struct litest_device *dev = litest_current_device();
+	struct udev_device *ud = libinput_device_get_udev_device(dev->libinput_device);
+	struct quirks_context *ctx;
+	struct data_dir dd = make_data_dir(NULL);
+	struct thread_allocator a = {
+		.thread = pthread_self(),
+	};
+	const int nfiles = 32;
+	char *path;
+
+	/* Enough files for the worker threads, but they must not call
+	 * into the caller's allocator */
+	for (int i = 1; i <= nfiles; i++) {
+		char *content;
+
+		xasprintf(&content,
+			  "[mouse %d]\n"
+			  "MatchUdevType=mouse\n"
+			  "AttrPalmSizeThreshold=%d\n",
+			  i, i);
+		write_numbered_data_file(dd, i, content);
+		free(content);
+	}
+
+	mem_set_allocator(thread_alloc, thread_realloc, thread_free, &a);
+
+	ctx = quirks_init_subsystem(dd.dirname,
+				    NULL,
+				    log_handler,
+				    NULL,
+				    QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+	ck_assert_int_eq(reload_test_palm_size(ctx, ud), nfiles);
+	quirks_context_unref(ctx);
+
+	mem_set_allocator(NULL, NULL, NULL, NULL);
+
+	ck_assert_int_gt(a.allocs, 0U);
+	ck_assert_int_eq(a.foreign, 0U);
+
+	for (int i = 1; i <= nfiles; i++) {
+		xasprintf(&path, "%s/%d-test.quirks", dd.dirname, i);
+		unlink(path);
+		free(path);
+	}
+	cleanup_data_dir(dd);
+	udev_device_unref(ud);
+}
+END_TEST
+
 START_TEST(quirks_model_zero)
 {
 	struct litest_device *dev = litest_current_device();
@@ -1472,6 +2191,16 @@ TEST_COLLECTION(quirks)
 	litest_add_for_device("quirks:model", quirks_model_one, LITEST_MOUSE);
 	litest_add_for_device("quirks:model", quirks_model_zero, LITEST_MOUSE);
 
+	litest_add_for_device("quirks:match", quirks_section_order, LITEST_MOUSE);
+	litest_add_for_device("quirks:match", quirks_match_dmi, LITEST_MOUSE);
+	litest_add_for_device("quirks:match", quirks_cache, LITEST_MOUSE);
+	litest_add_for_device("quirks:image", quirks_image, LITEST_MOUSE);
+	litest_add_for_device("quirks:image", quirks_image_missing_match_string, LITEST_MOUSE);
+	litest_add_for_device("quirks:device-cache", quirks_device_cache, LITEST_MOUSE);
+	litest_add_for_device("quirks:reload", quirks_reload, LITEST_MOUSE);
+	litest_add_for_device("quirks:parse", quirks_parse_many_files, LITEST_MOUSE);
+	litest_add_for_device("quirks:parse", quirks_parse_custom_allocator, LITEST_MOUSE);
+
 	litest_add("quirks:devices", quirks_model_alps, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("quirks:devices", quirks_model_wacom, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("quirks:devices", quirks_model_apple, LITEST_TOUCHPAD, LITEST_ANY);
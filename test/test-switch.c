@@ -277,6 +277,51 @@ START_TEST(switch_disable_touchpad)
 }
 END_TEST
 
+START_TEST(switch_disable_touchpad_event_type_disabled)
+{
+	struct litest_device *sw = litest_current_device();
+	struct litest_device *touchpad;
+	struct libinput *li = sw->libinput;
+	enum libinput_switch which = _i; /* ranged test */
+	int rc;
+
+	if (!libinput_device_switch_has_switch(sw->libinput_device, which))
+		return;
+
+	rc = libinput_device_set_event_type_enabled(sw->libinput_device,
+						    LIBINPUT_EVENT_SWITCH_TOGGLE,
+						    0);
+	ck_assert_int_eq(rc, 0);
+
+	touchpad = switch_init_paired_touchpad(li);
+	litest_disable_tap(touchpad->libinput_device);
+	litest_drain_events(li);
+
+	/* switch events are not delivered but still disable the touchpad */
+	litest_switch_action(sw, which, LIBINPUT_SWITCH_STATE_ON);
+	litest_assert_empty_queue(li);
+
+	litest_touch_down(touchpad, 0, 50, 50);
+	litest_touch_move_to(touchpad, 0, 50, 50, 70, 50, 10);
+	litest_touch_up(touchpad, 0);
+	litest_assert_empty_queue(li);
+
+	litest_switch_action(sw, which, LIBINPUT_SWITCH_STATE_OFF);
+	litest_assert_empty_queue(li);
+
+	litest_touch_down(touchpad, 0, 50, 50);
+	litest_touch_move_to(touchpad, 0, 50, 50, 70, 50, 10);
+	litest_touch_up(touchpad, 0);
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+
+	ck_assert_int_ge(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_EVENTS_FILTERED),
+			 2);
+
+	litest_delete_device(touchpad);
+}
+END_TEST
+
 START_TEST(switch_disable_touchpad_during_touch)
 {
 	struct litest_device *sw = litest_current_device();
@@ -1278,6 +1323,7 @@ TEST_COLLECTION(switch)
 	litest_add_ranged("switch:toggle", switch_down_on_init, LITEST_SWITCH, LITEST_ANY, &switches);
 	litest_add("switch:toggle", switch_not_down_on_init, LITEST_SWITCH, LITEST_ANY);
 	litest_add_ranged("switch:touchpad", switch_disable_touchpad, LITEST_SWITCH, LITEST_ANY, &switches);
+	litest_add_ranged("switch:touchpad", switch_disable_touchpad_event_type_disabled, LITEST_SWITCH, LITEST_ANY, &switches);
 	litest_add_ranged("switch:touchpad", switch_disable_touchpad_during_touch, LITEST_SWITCH, LITEST_ANY, &switches);
 	litest_add_ranged("switch:touchpad", switch_disable_touchpad_edge_scroll, LITEST_SWITCH, LITEST_ANY, &switches);
 	litest_add_ranged("switch:touchpad", switch_disable_touchpad_edge_scroll_interrupt, LITEST_SWITCH, LITEST_ANY, &switches);
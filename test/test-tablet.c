@@ -1611,6 +1611,77 @@ START_TEST(proximity_out_not_during_buttonpress)
 }
 END_TEST
 
+static uint64_t
+proxout_timer_stat(struct libinput *li, enum libinput_timer_stat stat)
+{
+	struct libinput_timer_stats *stats;
+	uint64_t value = 0;
+
+	stats = libinput_get_timer_stats(li);
+	for (unsigned int i = 0; i < libinput_timer_stats_get_count(stats); i++) {
+		if (streq(libinput_timer_stats_get_name(stats, i), "proxout"))
+			value = libinput_timer_stats_get_value(stats, i, stat);
+	}
+	libinput_timer_stats_destroy(stats);
+
+	return value;
+}
+
+START_TEST(proximity_out_timer_not_rearmed)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct axis_replacement axes[] = {
+		{ ABS_DISTANCE, 0 },
+		{ ABS_PRESSURE, 10 },
+		{ -1, -1 }
+	};
+	uint64_t armed;
+
+	litest_tablet_proximity_in(dev, 10, 10, axes);
+	litest_drain_events(li);
+
+	armed = proxout_timer_stat(li, LIBINPUT_TIMER_STAT_ARMED);
+
+	/* Motion doesn't touch the timer */
+	for (int i = 0; i < 10; i++)
+		litest_tablet_motion(dev, 12 + i, 12, axes);
+	litest_drain_events(li);
+	ck_assert_int_eq(proxout_timer_stat(li, LIBINPUT_TIMER_STAT_ARMED),
+			 armed);
+
+	/* Expiry during contact does not re-arm it until the tip is up */
+	litest_timeout_tablet_proxout();
+	libinput_dispatch(li);
+	litest_timeout_tablet_proxout();
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+	ck_assert_int_eq(proxout_timer_stat(li, LIBINPUT_TIMER_STAT_ARMED),
+			 armed);
+
+	litest_tablet_motion(dev, 30, 12, axes);
+	litest_drain_events(li);
+	ck_assert_int_eq(proxout_timer_stat(li, LIBINPUT_TIMER_STAT_ARMED),
+			 armed);
+
+	litest_axis_set_value(axes, ABS_PRESSURE, 0);
+	litest_tablet_motion(dev, 32, 12, axes);
+	litest_drain_events(li);
+	ck_assert_int_eq(proxout_timer_stat(li, LIBINPUT_TIMER_STAT_ARMED),
+			 armed + 1);
+
+	litest_timeout_tablet_proxout();
+	libinput_dispatch(li);
+
+	/* The forced prox out */
+	litest_assert_tablet_proximity_event(li,
+					     LIBINPUT_TABLET_TOOL_PROXIMITY_STATE_OUT);
+
+	litest_tablet_proximity_out(dev);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
 START_TEST(proximity_out_no_timeout)
 {
 	struct litest_device *dev = litest_current_device();
@@ -2056,10 +2127,96 @@ START_TEST(left_handed_artpen_rotation)
 		litest_assert_empty_queue(li);
 
 	}
+
+	/* Other axes changing must not change the rotation */
+	litest_event(dev, EV_ABS, ABS_X, 4000);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	tev = litest_is_tablet_event(event,
+				     LIBINPUT_EVENT_TABLET_TOOL_AXIS);
+	ck_assert(!libinput_event_tablet_tool_rotation_has_changed(tev));
+	ck_assert_double_eq(libinput_event_tablet_tool_get_rotation(tev),
+			    val);
+	libinput_event_destroy(event);
 #endif
 }
 END_TEST
 
+START_TEST(motion_coalescing_history)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event_tablet_tool *tev;
+	struct libinput_event *event;
+	struct axis_replacement axes[] = {
+		{ ABS_DISTANCE, 10 },
+		{ ABS_PRESSURE, 0 },
+		{ -1, -1 }
+	};
+	double x, y;
+	uint64_t time;
+	int rc;
+
+	litest_tablet_proximity_in(dev, 10, 10, axes);
+	litest_drain_events(li);
+
+	/* Without history, merged events don't carry samples */
+	rc = libinput_set_event_coalescing(li,
+					   LIBINPUT_EVENT_COALESCING_TABLET_TOOL_AXIS);
+	ck_assert_int_eq(rc, 0);
+	for (int i = 0; i < 4; i++)
+		litest_tablet_motion(dev, 15 + i * 5, 15 + i * 5, axes);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	tev = litest_is_tablet_event(event, LIBINPUT_EVENT_TABLET_TOOL_AXIS);
+	ck_assert_int_eq(libinput_event_tablet_tool_get_history_size(tev), 0);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	rc = libinput_set_event_coalescing(li,
+					   LIBINPUT_EVENT_COALESCING_TABLET_TOOL_HISTORY);
+	ck_assert_int_eq(rc, 0);
+
+	for (int i = 0; i < 4; i++)
+		litest_tablet_motion(dev, 40 + i * 5, 40 + i * 5, axes);
+	libinput_dispatch(li);
+
+	/* One event, the first three motion events are its history */
+	event = libinput_get_event(li);
+	tev = litest_is_tablet_event(event, LIBINPUT_EVENT_TABLET_TOOL_AXIS);
+	ck_assert_int_eq(libinput_event_tablet_tool_get_history_size(tev), 3);
+
+	x = libinput_event_tablet_tool_get_historical_x(tev, 0);
+	y = libinput_event_tablet_tool_get_historical_y(tev, 0);
+	time = libinput_event_tablet_tool_get_historical_time_usec(tev, 0);
+	for (int i = 1; i < 3; i++) {
+		litest_assert_double_gt(libinput_event_tablet_tool_get_historical_x(tev, i),
+					x);
+		litest_assert_double_gt(libinput_event_tablet_tool_get_historical_y(tev, i),
+					y);
+		ck_assert_int_ge(libinput_event_tablet_tool_get_historical_time_usec(tev, i),
+				 time);
+		x = libinput_event_tablet_tool_get_historical_x(tev, i);
+		y = libinput_event_tablet_tool_get_historical_y(tev, i);
+		time = libinput_event_tablet_tool_get_historical_time_usec(tev, i);
+	}
+	litest_assert_double_gt(libinput_event_tablet_tool_get_x(tev), x);
+	litest_assert_double_gt(libinput_event_tablet_tool_get_y(tev), y);
+	ck_assert_int_ge(libinput_event_tablet_tool_get_time_usec(tev), time);
+
+	litest_disable_log_handler(li);
+	litest_assert_double_eq(libinput_event_tablet_tool_get_historical_x(tev, 3),
+				0.0);
+	litest_restore_log_handler(li);
+
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	libinput_set_event_coalescing(li, LIBINPUT_EVENT_COALESCING_NONE);
+}
+END_TEST
+
 START_TEST(motion_event_state)
 {
 	struct litest_device *dev = litest_current_device();
@@ -2352,6 +2509,61 @@ START_TEST(serial_changes_tool)
 }
 END_TEST
 
+static struct libinput_tablet_tool *
+tool_proximity_in_out(struct litest_device *dev, int serial)
+{
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_tablet_tool *tablet_event;
+	struct libinput_tablet_tool *tool;
+
+	litest_event(dev, EV_KEY, BTN_TOOL_PEN, 1);
+	litest_event(dev, EV_MSC, MSC_SERIAL, serial);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	tablet_event = litest_is_tablet_event(event,
+				LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	tool = libinput_event_tablet_tool_get_tool(tablet_event);
+	libinput_tablet_tool_ref(tool);
+	libinput_event_destroy(event);
+
+	litest_event(dev, EV_KEY, BTN_TOOL_PEN, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_drain_events(li);
+
+	return tool;
+}
+
+START_TEST(serial_tools_reused)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_tablet_tool *tools[100];
+	struct libinput_tablet_tool *tool;
+	int i;
+
+	litest_drain_events(li);
+
+	/* Enough tools to grow the context's tool index a few times */
+	for (i = 0; i < (int)ARRAY_LENGTH(tools); i++) {
+		tools[i] = tool_proximity_in_out(dev, 1000 + i);
+		ck_assert_uint_eq(libinput_tablet_tool_get_serial(tools[i]),
+				  1000 + i);
+		if (i > 0)
+			ck_assert_ptr_ne(tools[i], tools[i - 1]);
+	}
+
+	for (i = 0; i < (int)ARRAY_LENGTH(tools); i++) {
+		tool = tool_proximity_in_out(dev, 1000 + i);
+		ck_assert_ptr_eq(tool, tools[i]);
+		libinput_tablet_tool_unref(tool);
+		libinput_tablet_tool_unref(tools[i]);
+	}
+}
+END_TEST
+
 START_TEST(invalid_serials)
 {
 	struct litest_device *dev = litest_current_device();
@@ -3797,6 +4009,115 @@ START_TEST(tablet_pressure_offset)
 }
 END_TEST
 
+START_TEST(tablet_pressure_offset_restore_state)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct litest_device *dev2;
+	struct libinput *li2;
+	struct libinput_event *event;
+	struct libinput_event_tablet_tool *tev;
+	struct axis_replacement axes[] = {
+		{ ABS_DISTANCE, 70 },
+		{ ABS_PRESSURE, 20 },
+		{ -1, -1 },
+	};
+	char buf[1024];
+	size_t size;
+	double pressure;
+
+	/* detect the offset on the first context */
+	litest_tablet_proximity_in(dev, 5, 100, axes);
+	litest_tablet_proximity_out(dev);
+	litest_timeout_tablet_proxout();
+	litest_drain_events(li);
+
+	size = libinput_device_save_state(dev->libinput_device,
+					  buf, sizeof(buf));
+	ck_assert_int_gt(size, 0);
+	ck_assert_int_le(size, sizeof(buf));
+
+	li2 = litest_create_context();
+	dev2 = litest_add_device(li2, dev->which);
+	litest_drain_events(li2);
+	ck_assert_int_eq(libinput_device_restore_state(dev2->libinput_device,
+						       buf, size),
+			 0);
+
+	/* Too close for the offset to be detected, it has to come from
+	 * the restored state */
+	litest_axis_set_value(axes, ABS_DISTANCE, 10);
+	litest_tablet_proximity_in(dev2, 5, 100, axes);
+	litest_drain_events(li2);
+
+	litest_axis_set_value(axes, ABS_DISTANCE, 0);
+	litest_axis_set_value(axes, ABS_PRESSURE, 25);
+	litest_push_event_frame(dev2);
+	litest_tablet_motion(dev2, 70, 70, axes);
+	litest_event(dev2, EV_KEY, BTN_TOUCH, 1);
+	litest_pop_event_frame(dev2);
+	libinput_dispatch(li2);
+	litest_drain_events(li2);
+
+	litest_axis_set_value(axes, ABS_PRESSURE, 20.1);
+	litest_tablet_motion(dev2, 70, 70, axes);
+	libinput_dispatch(li2);
+
+	event = libinput_get_event(li2);
+	tev = litest_is_tablet_event(event,
+				     LIBINPUT_EVENT_TABLET_TOOL_AXIS);
+	pressure = libinput_event_tablet_tool_get_pressure(tev);
+	ck_assert_double_lt(pressure, 0.01);
+	libinput_event_destroy(event);
+
+	litest_delete_device(dev2);
+	libinput_unref(li2);
+}
+END_TEST
+
+START_TEST(tablet_save_state_own_tools)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct litest_device *dev2;
+	struct axis_replacement axes[] = {
+		{ ABS_DISTANCE, 70 },
+		{ ABS_PRESSURE, 20 },
+		{ -1, -1 },
+	};
+	char buf[1024];
+	size_t size;
+
+	dev2 = litest_add_device(li, dev->which);
+	litest_drain_events(li);
+
+	/* The tool has a serial, so it is shared with the second tablet
+	 * but it was never used there */
+	litest_tablet_proximity_in(dev, 5, 100, axes);
+	litest_tablet_proximity_out(dev);
+	litest_timeout_tablet_proxout();
+	litest_drain_events(li);
+
+	size = libinput_device_save_state(dev->libinput_device,
+					  buf, sizeof(buf));
+	ck_assert_int_gt(size, 0);
+	ck_assert_int_le(size, sizeof(buf));
+	ck_assert_int_eq(libinput_device_save_state(dev2->libinput_device,
+						    NULL, 0),
+			 0);
+
+	/* A restored state is kept until the tool is used again */
+	ck_assert_int_eq(libinput_device_restore_state(dev2->libinput_device,
+						       buf, size),
+			 0);
+	ck_assert_int_eq(libinput_device_save_state(dev2->libinput_device,
+						    NULL, 0),
+			 size);
+
+	litest_delete_device(dev2);
+}
+END_TEST
+
 START_TEST(tablet_pressure_offset_decrease)
 {
 	struct litest_device *dev = litest_current_device();
@@ -5896,6 +6217,7 @@ TEST_COLLECTION(tablet)
 	litest_add("tablet:tool_serial", tool_serial, LITEST_TABLET | LITEST_TOOL_SERIAL, LITEST_ANY);
 	litest_add("tablet:tool_serial", tool_id, LITEST_TABLET | LITEST_TOOL_SERIAL, LITEST_ANY);
 	litest_add("tablet:tool_serial", serial_changes_tool, LITEST_TABLET | LITEST_TOOL_SERIAL, LITEST_ANY);
+	litest_add("tablet:tool_serial", serial_tools_reused, LITEST_TABLET | LITEST_TOOL_SERIAL, LITEST_ANY);
 	litest_add("tablet:tool_serial", invalid_serials, LITEST_TABLET | LITEST_TOOL_SERIAL, LITEST_ANY);
 	litest_add_no_device("tablet:tool_serial", tools_with_serials);
 	litest_add_no_device("tablet:tool_serial", tools_without_serials);
@@ -5914,6 +6236,7 @@ TEST_COLLECTION(tablet)
 	litest_add("tablet:proximity", proximity_out_slow_event, LITEST_TABLET | LITEST_DISTANCE, LITEST_ANY);
 	litest_add("tablet:proximity", proximity_out_not_during_contact, LITEST_TABLET | LITEST_DISTANCE, LITEST_ANY);
 	litest_add("tablet:proximity", proximity_out_not_during_buttonpress, LITEST_TABLET | LITEST_DISTANCE, LITEST_ANY);
+	litest_add("tablet:proximity", proximity_out_timer_not_rearmed, LITEST_TABLET | LITEST_DISTANCE, LITEST_ANY);
 	litest_add_for_device("tablet:proximity", proximity_out_no_timeout, LITEST_WACOM_ISDV4_4200_PEN);
 
 	litest_add_no_device("tablet:proximity", proximity_out_on_delete);
@@ -5933,6 +6256,7 @@ TEST_COLLECTION(tablet)
 	litest_add("tablet:tip", tip_state_button, LITEST_TABLET|LITEST_HOVER, LITEST_ANY);
 	litest_add_no_device("tablet:tip", tip_up_on_delete);
 	litest_add("tablet:motion", motion, LITEST_TABLET, LITEST_ANY);
+	litest_add("tablet:motion", motion_coalescing_history, LITEST_TABLET, LITEST_ANY);
 	litest_add("tablet:motion", motion_event_state, LITEST_TABLET, LITEST_ANY);
 	litest_add_for_device("tablet:motion", motion_outside_bounds, LITEST_WACOM_CINTIQ_24HD);
 	litest_add("tablet:tilt", tilt_available, LITEST_TABLET|LITEST_TILT, LITEST_ANY);
@@ -5965,6 +6289,8 @@ TEST_COLLECTION(tablet)
 	litest_add("tablet:pressure", tablet_pressure_min_max, LITEST_TABLET, LITEST_ANY);
 	litest_add_for_device("tablet:pressure", tablet_pressure_range, LITEST_WACOM_INTUOS);
 	litest_add_for_device("tablet:pressure", tablet_pressure_offset, LITEST_WACOM_INTUOS);
+	litest_add_for_device("tablet:pressure", tablet_pressure_offset_restore_state, LITEST_WACOM_INTUOS);
+	litest_add_for_device("tablet:pressure", tablet_save_state_own_tools, LITEST_WACOM_INTUOS);
 	litest_add_for_device("tablet:pressure", tablet_pressure_offset_decrease, LITEST_WACOM_INTUOS);
 	litest_add_for_device("tablet:pressure", tablet_pressure_offset_increase, LITEST_WACOM_INTUOS);
 	litest_add_for_device("tablet:pressure", tablet_pressure_offset_exceed_threshold, LITEST_WACOM_INTUOS);
@@ -64,6 +64,151 @@ START_TEST(touch_frame_events)
 }
 END_TEST
 
+START_TEST(touch_motion_coalescing)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_touch *tev;
+
+	libinput_set_event_coalescing(li,
+				      LIBINPUT_EVENT_COALESCING_TOUCH_MOTION);
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 10, 10);
+	litest_touch_down(dev, 1, 80, 80);
+	for (int i = 1; i <= 5; i++) {
+		litest_push_event_frame(dev);
+		litest_touch_move(dev, 0, 10 + i * 5, 10);
+		litest_touch_move(dev, 1, 80 - i * 5, 80);
+		litest_pop_event_frame(dev);
+	}
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_DOWN);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_FRAME);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_DOWN);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_FRAME);
+	libinput_event_destroy(event);
+
+	/* All motion frames collapse into one, with the most recent
+	 * coordinates */
+	for (int i = 0; i < 2; i++) {
+		double x;
+
+		event = libinput_get_event(li);
+		tev = litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_MOTION);
+		x = libinput_event_touch_get_x_transformed(tev, 100);
+		if (libinput_event_touch_get_slot(tev) == 0)
+			ck_assert_double_eq_tol(x, 35.0, 1.0);
+		else
+			ck_assert_double_eq_tol(x, 55.0, 1.0);
+		libinput_event_destroy(event);
+	}
+	event = libinput_get_event(li);
+	litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_FRAME);
+	libinput_event_destroy(event);
+
+	litest_assert_empty_queue(li);
+
+	litest_touch_up(dev, 0);
+	litest_touch_up(dev, 1);
+	litest_drain_events(li);
+}
+END_TEST
+
+START_TEST(touch_frame_batching)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_touch *tev;
+
+	ck_assert_int_eq(libinput_get_touch_frame_batching(li), 0);
+	libinput_set_touch_frame_batching(li, 1);
+	ck_assert_int_ne(libinput_get_touch_frame_batching(li), 0);
+	litest_drain_events(li);
+
+	litest_push_event_frame(dev);
+	litest_touch_down(dev, 0, 10, 10);
+	litest_touch_down(dev, 1, 80, 80);
+	litest_pop_event_frame(dev);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	tev = litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_FRAME);
+	ck_assert_int_eq(libinput_event_touch_get_frame_touch_count(tev), 2);
+	for (size_t i = 0; i < 2; i++) {
+		double x = libinput_event_touch_get_frame_touch_x_transformed(tev, i, 100);
+
+		ck_assert_int_eq(libinput_event_touch_get_frame_touch_type(tev, i),
+				 LIBINPUT_EVENT_TOUCH_DOWN);
+		ck_assert_int_eq(libinput_event_touch_get_frame_touch_slot(tev, i),
+				 i);
+		ck_assert_double_eq_tol(x, i == 0 ? 10.0 : 80.0, 1.0);
+	}
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	litest_push_event_frame(dev);
+	litest_touch_move(dev, 0, 20, 10);
+	litest_touch_move(dev, 1, 70, 80);
+	litest_pop_event_frame(dev);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	tev = litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_FRAME);
+	ck_assert_int_eq(libinput_event_touch_get_frame_touch_count(tev), 2);
+	for (size_t i = 0; i < 2; i++) {
+		double x = libinput_event_touch_get_frame_touch_x_transformed(tev, i, 100);
+
+		ck_assert_int_eq(libinput_event_touch_get_frame_touch_type(tev, i),
+				 LIBINPUT_EVENT_TOUCH_MOTION);
+		ck_assert_double_eq_tol(x, i == 0 ? 20.0 : 70.0, 1.0);
+	}
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	litest_push_event_frame(dev);
+	litest_touch_up(dev, 0);
+	litest_touch_up(dev, 1);
+	litest_pop_event_frame(dev);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	tev = litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_FRAME);
+	ck_assert_int_eq(libinput_event_touch_get_frame_touch_count(tev), 2);
+	for (size_t i = 0; i < 2; i++)
+		ck_assert_int_eq(libinput_event_touch_get_frame_touch_type(tev, i),
+				 LIBINPUT_EVENT_TOUCH_UP);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	/* Per-touch events again once batching is disabled */
+	libinput_set_touch_frame_batching(li, 0);
+	litest_touch_down(dev, 0, 10, 10);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_DOWN);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	tev = litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_FRAME);
+	ck_assert_int_eq(libinput_event_touch_get_frame_touch_count(tev), 0);
+	libinput_event_destroy(event);
+
+	litest_touch_up(dev, 0);
+	litest_drain_events(li);
+}
+END_TEST
+
 START_TEST(touch_downup_no_motion)
 {
 	struct litest_device *dev = litest_current_device();
@@ -83,6 +228,27 @@ START_TEST(touch_downup_no_motion)
 }
 END_TEST
 
+START_TEST(touch_st_no_buttons_downup)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+
+	litest_drain_events(li);
+
+	/* BTN_TOUCH is the device's only key, it must not be taken for a
+	 * keyboard key */
+	for (int i = 0; i < 2; i++) {
+		litest_touch_down(dev, 0, 10, 10);
+		libinput_dispatch(li);
+		litest_assert_touch_down_frame(li);
+
+		litest_touch_up(dev, 0);
+		libinput_dispatch(li);
+		litest_assert_touch_up_frame(li);
+	}
+}
+END_TEST
+
 START_TEST(touch_abs_transform)
 {
 	struct litest_device *dev;
@@ -202,6 +368,51 @@ START_TEST(touch_seat_slot)
 }
 END_TEST
 
+START_TEST(touch_seat_slot_many_devices)
+{
+	struct libinput *li = litest_create_context();
+	struct litest_device *devs[3];
+	const int nslots = 40;
+	struct input_absinfo abs[] = {
+		{ ABS_MT_SLOT, 0, nslots - 1, 0, 0, 0 },
+		{ .value = -1 },
+	};
+	int seat_slot = 0;
+
+	for (size_t i = 0; i < ARRAY_LENGTH(devs); i++)
+		devs[i] = litest_add_device_with_overrides(li,
+							   LITEST_WACOM_TOUCH,
+							   "litest Multi-touch device",
+							   NULL, abs, NULL);
+	litest_drain_events(li);
+
+	/* More touches than fit into a single word of seat slots */
+	for (int slot = 0; slot < nslots; slot++) {
+		for (size_t i = 0; i < ARRAY_LENGTH(devs); i++) {
+			litest_touch_down(devs[i], slot, 10 + slot, 50);
+			touch_assert_seat_slot(li, LIBINPUT_EVENT_TOUCH_DOWN,
+					       slot, seat_slot++);
+		}
+	}
+
+	/* lowest free seat slot is reused */
+	litest_touch_up(devs[1], 30);
+	touch_assert_seat_slot(li, LIBINPUT_EVENT_TOUCH_UP, 30, 91);
+	litest_touch_down(devs[1], 30, 50, 50);
+	touch_assert_seat_slot(li, LIBINPUT_EVENT_TOUCH_DOWN, 30, 91);
+
+	for (int slot = 0; slot < nslots; slot++) {
+		for (size_t i = 0; i < ARRAY_LENGTH(devs); i++)
+			litest_touch_up(devs[i], slot);
+	}
+	litest_drain_events(li);
+
+	for (size_t i = 0; i < ARRAY_LENGTH(devs); i++)
+		litest_delete_device(devs[i]);
+	libinput_unref(li);
+}
+END_TEST
+
 START_TEST(touch_many_slots)
 {
 	struct libinput *libinput;
@@ -350,6 +561,113 @@ START_TEST(touch_calibration_scale)
 }
 END_TEST
 
+START_TEST(touch_event_view)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *ev;
+	struct libinput_event_touch *tev;
+	struct libinput_event_view view;
+	const int width = 640, height = 480;
+
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 30, 70);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+
+	ev = libinput_get_event(li);
+	tev = litest_is_touch_event(ev, LIBINPUT_EVENT_TOUCH_DOWN);
+
+	ck_assert_int_eq(libinput_event_get_view(ev,
+						 &view,
+						 sizeof(view),
+						 width,
+						 height),
+			 0);
+	ck_assert_int_eq(view.version, LIBINPUT_EVENT_VIEW_VERSION);
+	ck_assert_int_eq(view.type, LIBINPUT_EVENT_TOUCH_DOWN);
+	ck_assert(view.device == dev->libinput_device);
+	ck_assert_int_eq(view.time_usec, libinput_event_touch_get_time_usec(tev));
+	ck_assert_int_eq(view.u.touch.slot, libinput_event_touch_get_slot(tev));
+	ck_assert_int_eq(view.u.touch.seat_slot,
+			 libinput_event_touch_get_seat_slot(tev));
+	ck_assert_double_eq(view.u.touch.x, libinput_event_touch_get_x(tev));
+	ck_assert_double_eq(view.u.touch.y, libinput_event_touch_get_y(tev));
+	ck_assert_double_eq(view.u.touch.x_transformed,
+			    libinput_event_touch_get_x_transformed(tev, width));
+	ck_assert_double_eq(view.u.touch.y_transformed,
+			    libinput_event_touch_get_y_transformed(tev, height));
+
+	/* an older, smaller view only gets the common fields */
+	memset(&view, 0xab, sizeof(view));
+	ck_assert_int_eq(libinput_event_get_view(ev,
+						 &view,
+						 offsetof(struct libinput_event_view, u),
+						 width,
+						 height),
+			 0);
+	ck_assert_int_eq(view.type, LIBINPUT_EVENT_TOUCH_DOWN);
+	ck_assert_int_eq(view.u.touch.slot, (int32_t)0xabababab);
+
+	litest_disable_log_handler(li);
+	ck_assert_int_eq(libinput_event_get_view(ev, &view, 4, width, height),
+			 -1);
+	litest_restore_log_handler(li);
+
+	libinput_event_destroy(ev);
+}
+END_TEST
+
+START_TEST(touch_output_size)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput *li = dev->libinput;
+	struct libinput_event *ev;
+	struct libinput_event_touch *tev;
+	const int width = 1920, height = 1080;
+	double x, y;
+
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 30, 70);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+
+	ev = libinput_get_event(li);
+	tev = litest_is_touch_event(ev, LIBINPUT_EVENT_TOUCH_DOWN);
+	x = libinput_event_touch_get_x_transformed(tev, width);
+	y = libinput_event_touch_get_y_transformed(tev, height);
+	libinput_event_destroy(ev);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_device_set_output_size(device,
+							 width,
+							 height),
+			 0);
+
+	litest_touch_down(dev, 0, 30, 70);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+
+	ev = libinput_get_event(li);
+	tev = litest_is_touch_event(ev, LIBINPUT_EVENT_TOUCH_DOWN);
+	ck_assert(libinput_event_touch_get_x_transformed(tev, width) == x);
+	ck_assert(libinput_event_touch_get_y_transformed(tev, height) == y);
+	/* a different size still works */
+	ck_assert_double_eq(libinput_event_touch_get_x_transformed(tev,
+								   width/2),
+			    x/2);
+	ck_assert_double_eq(libinput_event_touch_get_y_transformed(tev,
+								   height/2),
+			    y/2);
+	libinput_event_destroy(ev);
+
+	ck_assert_int_eq(libinput_device_set_output_size(device, 0, 0), 0);
+}
+END_TEST
+
 START_TEST(touch_calibration_rotation)
 {
 	struct libinput *li;
@@ -811,6 +1129,101 @@ START_TEST(touch_protocol_a_2fg_touch)
 }
 END_TEST
 
+START_TEST(touch_protocol_a_2fg_release_first)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *ev;
+	struct libinput_event_touch *tev;
+
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 20, 20);
+	litest_touch_down(dev, 1, 80, 80);
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	/* The remaining contact must stay in its slot, not be moved
+	 * into the one that was freed up */
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+	ev = libinput_get_event(li);
+	tev = litest_is_touch_event(ev, LIBINPUT_EVENT_TOUCH_UP);
+	ck_assert_int_eq(libinput_event_touch_get_slot(tev), 0);
+	libinput_event_destroy(ev);
+	ev = libinput_get_event(li);
+	litest_is_touch_event(ev, LIBINPUT_EVENT_TOUCH_FRAME);
+	libinput_event_destroy(ev);
+	litest_assert_empty_queue(li);
+
+	litest_touch_move(dev, 1, 70, 70);
+	libinput_dispatch(li);
+	ev = libinput_get_event(li);
+	tev = litest_is_touch_event(ev, LIBINPUT_EVENT_TOUCH_MOTION);
+	ck_assert_int_eq(libinput_event_touch_get_slot(tev), 1);
+	libinput_event_destroy(ev);
+	ev = libinput_get_event(li);
+	litest_is_touch_event(ev, LIBINPUT_EVENT_TOUCH_FRAME);
+	libinput_event_destroy(ev);
+
+	litest_touch_up(dev, 1);
+	libinput_dispatch(li);
+	litest_assert_touch_up_frame(li);
+}
+END_TEST
+
+START_TEST(touch_protocol_a_new_tracking_id)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *ev;
+	int x = (libevdev_get_abs_minimum(dev->evdev, ABS_X) +
+		 libevdev_get_abs_maximum(dev->evdev, ABS_X)) / 2,
+	    y = (libevdev_get_abs_minimum(dev->evdev, ABS_Y) +
+		 libevdev_get_abs_maximum(dev->evdev, ABS_Y)) / 2;
+	int ndown = 0, nup = 0;
+
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 50, 50);
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	/* A different tracking id in the same position is a new touch,
+	 * it must not be matched to the old slot by distance */
+	litest_event(dev, EV_ABS, ABS_MT_TRACKING_ID, 1000);
+	litest_event(dev, EV_ABS, ABS_MT_POSITION_X, x);
+	litest_event(dev, EV_ABS, ABS_MT_POSITION_Y, y);
+	litest_event(dev, EV_SYN, SYN_MT_REPORT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	while ((ev = libinput_get_event(li))) {
+		switch (libinput_event_get_type(ev)) {
+		case LIBINPUT_EVENT_TOUCH_DOWN:
+			ndown++;
+			break;
+		case LIBINPUT_EVENT_TOUCH_UP:
+			nup++;
+			break;
+		case LIBINPUT_EVENT_TOUCH_FRAME:
+			break;
+		default:
+			litest_abort_msg("Unexpected event type %d\n",
+					 libinput_event_get_type(ev));
+			break;
+		}
+		libinput_event_destroy(ev);
+	}
+	ck_assert_int_eq(ndown, 1);
+	ck_assert_int_eq(nup, 1);
+
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+	litest_assert_touch_up_frame(li);
+}
+END_TEST
+
 START_TEST(touch_initial_state)
 {
 	struct litest_device *dev;
@@ -1343,11 +1756,17 @@ TEST_COLLECTION(touch)
 	struct range axes = { ABS_X, ABS_Y + 1};
 
 	litest_add("touch:frame", touch_frame_events, LITEST_TOUCH, LITEST_ANY);
+	litest_add("touch:view", touch_event_view, LITEST_TOUCH, LITEST_ANY);
+	litest_add("touch:output-size", touch_output_size, LITEST_TOUCH, LITEST_ANY);
+	litest_add("touch:frame", touch_motion_coalescing, LITEST_TOUCH, LITEST_PROTOCOL_A);
+	litest_add("touch:frame", touch_frame_batching, LITEST_TOUCH, LITEST_PROTOCOL_A);
 	litest_add("touch:down", touch_downup_no_motion, LITEST_TOUCH, LITEST_ANY);
 	litest_add("touch:down", touch_downup_no_motion, LITEST_SINGLE_TOUCH, LITEST_TOUCHPAD);
+	litest_add_for_device("touch:down", touch_st_no_buttons_downup, LITEST_GENERIC_SINGLETOUCH);
 	litest_add_no_device("touch:abs-transform", touch_abs_transform);
 	litest_add("touch:slots", touch_seat_slot, LITEST_TOUCH, LITEST_TOUCHPAD);
 	litest_add_no_device("touch:slots", touch_many_slots);
+	litest_add_no_device("touch:slots", touch_seat_slot_many_devices);
 	litest_add("touch:double-touch-down-up", touch_double_touch_down_up, LITEST_TOUCH, LITEST_PROTOCOL_A);
 	litest_add("touch:calibration", touch_calibration_scale, LITEST_TOUCH, LITEST_TOUCHPAD);
 	litest_add("touch:calibration", touch_calibration_scale, LITEST_SINGLE_TOUCH, LITEST_TOUCHPAD);
@@ -1367,6 +1786,8 @@ TEST_COLLECTION(touch)
 	litest_add("touch:protocol a", touch_protocol_a_init, LITEST_PROTOCOL_A, LITEST_ANY);
 	litest_add("touch:protocol a", touch_protocol_a_touch, LITEST_PROTOCOL_A, LITEST_ANY);
 	litest_add("touch:protocol a", touch_protocol_a_2fg_touch, LITEST_PROTOCOL_A, LITEST_ANY);
+	litest_add("touch:protocol a", touch_protocol_a_2fg_release_first, LITEST_PROTOCOL_A, LITEST_ANY);
+	litest_add("touch:protocol a", touch_protocol_a_new_tracking_id, LITEST_PROTOCOL_A, LITEST_ANY);
 
 	litest_add_ranged("touch:state", touch_initial_state, LITEST_TOUCH, LITEST_PROTOCOL_A, &axes);
 
@@ -56,6 +56,60 @@ START_TEST(touchpad_1fg_tap)
 }
 END_TEST
 
+START_TEST(touchpad_1fg_tap_delay_stats)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput *li = dev->libinput;
+	uint64_t samples;
+
+	litest_enable_tap(device);
+	litest_drain_events(li);
+
+	/* not tracking, nothing is recorded */
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_up(dev, 0);
+	litest_timeout_tap();
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	libinput_device_set_latency_tracking(device, 1);
+	samples = libinput_device_get_delay_stats(device,
+						  LIBINPUT_DELAY_SOURCE_TAP,
+						  LIBINPUT_LATENCY_STAT_SAMPLES);
+	ck_assert_int_eq(samples, 0);
+
+	litest_touch_down(dev, 0, 50, 50);
+	msleep(10);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+	litest_timeout_tap();
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	samples = libinput_device_get_delay_stats(device,
+						  LIBINPUT_DELAY_SOURCE_TAP,
+						  LIBINPUT_LATENCY_STAT_SAMPLES);
+	ck_assert_int_eq(samples, 1);
+	ck_assert_int_ge(libinput_device_get_delay_stats(device,
+							 LIBINPUT_DELAY_SOURCE_TAP,
+							 LIBINPUT_LATENCY_STAT_MAX),
+			 ms2us(10));
+
+	/* the tap is the only thing that delayed an event */
+	samples = libinput_device_get_delay_stats(device,
+						  LIBINPUT_DELAY_SOURCE_SOFTWARE_BUTTONS,
+						  LIBINPUT_LATENCY_STAT_SAMPLES);
+	ck_assert_int_eq(samples, 0);
+	ck_assert_int_eq(libinput_device_get_delay_stats(device,
+							 LIBINPUT_DELAY_SOURCE_TAP,
+							 LIBINPUT_LATENCY_STAT_FIRST_MOTION_SAMPLES),
+			 0);
+
+	libinput_device_set_latency_tracking(device, 0);
+}
+END_TEST
+
 START_TEST(touchpad_1fg_doubletap)
 {
 	struct litest_device *dev = litest_current_device();
@@ -740,6 +794,90 @@ START_TEST(touchpad_1fg_tap_n_drag)
 }
 END_TEST
 
+START_TEST(touchpad_1fg_tap_early_commit)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	enum libinput_config_status status;
+
+	litest_enable_tap(dev->libinput_device);
+	litest_enable_tap_drag(dev->libinput_device);
+	status = libinput_device_config_tap_set_early_commit_enabled(dev->libinput_device,
+								     LIBINPUT_CONFIG_TAP_EARLY_COMMIT_ENABLED);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+
+	/* the tap may still become a drag, so the release waits for the
+	 * tap timeout */
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_assert_empty_queue(li);
+
+	litest_timeout_tap();
+	libinput_dispatch(li);
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_RELEASED);
+	litest_assert_empty_queue(li);
+
+	/* without drag, press and release are sent immediately */
+	litest_disable_tap_drag(dev->libinput_device);
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_RELEASED);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(touchpad_1fg_tap_n_drag_early_commit)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	enum libinput_config_status status;
+
+	litest_enable_tap(dev->libinput_device);
+	litest_enable_tap_drag(dev->libinput_device);
+	litest_disable_drag_lock(dev->libinput_device);
+	status = libinput_device_config_tap_set_early_commit_enabled(dev->libinput_device,
+								     LIBINPUT_CONFIG_TAP_EARLY_COMMIT_ENABLED);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_assert_empty_queue(li);
+
+	/* the button stays down for the drag, no release and second
+	 * press that would look like a double-click */
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_move_to(dev, 0, 50, 50, 80, 80, 20);
+	libinput_dispatch(li);
+
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_RELEASED);
+
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
 START_TEST(touchpad_1fg_tap_n_drag_draglock)
 {
 	struct litest_device *dev = litest_current_device();
@@ -2399,6 +2537,53 @@ START_TEST(touchpad_tap_map_unsupported)
 }
 END_TEST
 
+START_TEST(touchpad_tap_config_transaction)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput *li = dev->libinput;
+	enum libinput_config_status status;
+
+	litest_disable_tap(device);
+	litest_drain_events(li);
+
+	status = libinput_device_config_commit(device);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_INVALID);
+
+	status = libinput_device_config_begin(device);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	status = libinput_device_config_begin(device);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_INVALID);
+
+	litest_enable_tap(device);
+	ck_assert_int_eq(libinput_device_config_tap_get_enabled(device),
+			 LIBINPUT_CONFIG_TAP_ENABLED);
+
+	/* not committed yet, tapping is still off */
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+	litest_timeout_tap();
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+
+	status = libinput_device_config_commit(device);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	status = libinput_device_config_commit(device);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_INVALID);
+
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_timeout_tap();
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_RELEASED);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
 START_TEST(touchpad_tap_set_map)
 {
 	struct litest_device *dev = litest_current_device();
@@ -2735,6 +2920,58 @@ START_TEST(touchpad_drag_lock_default_disabled)
 }
 END_TEST
 
+START_TEST(touchpad_tap_early_commit_default_disabled)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	enum libinput_config_status status;
+
+	ck_assert_int_eq(libinput_device_config_tap_get_early_commit_enabled(device),
+			 LIBINPUT_CONFIG_TAP_EARLY_COMMIT_DISABLED);
+	ck_assert_int_eq(libinput_device_config_tap_get_default_early_commit_enabled(device),
+			 LIBINPUT_CONFIG_TAP_EARLY_COMMIT_DISABLED);
+
+	status = libinput_device_config_tap_set_early_commit_enabled(device,
+								     LIBINPUT_CONFIG_TAP_EARLY_COMMIT_ENABLED);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	ck_assert_int_eq(libinput_device_config_tap_get_early_commit_enabled(device),
+			 LIBINPUT_CONFIG_TAP_EARLY_COMMIT_ENABLED);
+
+	status = libinput_device_config_tap_set_early_commit_enabled(device,
+								     LIBINPUT_CONFIG_TAP_EARLY_COMMIT_DISABLED);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+
+	status = libinput_device_config_tap_set_early_commit_enabled(device,
+								     3);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_INVALID);
+}
+END_TEST
+
+START_TEST(touchpad_tap_early_commit_default_unavailable)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	enum libinput_config_status status;
+
+	ck_assert_int_eq(libinput_device_config_tap_get_early_commit_enabled(device),
+			 LIBINPUT_CONFIG_TAP_EARLY_COMMIT_DISABLED);
+	ck_assert_int_eq(libinput_device_config_tap_get_default_early_commit_enabled(device),
+			 LIBINPUT_CONFIG_TAP_EARLY_COMMIT_DISABLED);
+
+	status = libinput_device_config_tap_set_early_commit_enabled(device,
+								     LIBINPUT_CONFIG_TAP_EARLY_COMMIT_ENABLED);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_UNSUPPORTED);
+
+	status = libinput_device_config_tap_set_early_commit_enabled(device,
+								     LIBINPUT_CONFIG_TAP_EARLY_COMMIT_DISABLED);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+
+	status = libinput_device_config_tap_set_early_commit_enabled(device,
+								     3);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_INVALID);
+}
+END_TEST
+
 START_TEST(touchpad_drag_lock_default_unavailable)
 {
 	struct litest_device *dev = litest_current_device();
@@ -3666,6 +3903,7 @@ TEST_COLLECTION(touchpad_tap)
 	struct range range_multifinger = {2, 5};
 
 	litest_add("tap:1fg", touchpad_1fg_tap, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add("tap:1fg", touchpad_1fg_tap_delay_stats, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("tap:1fg", touchpad_1fg_doubletap, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add_ranged("tap:1fg", touchpad_1fg_tap_drag_high_delay, LITEST_TOUCHPAD, LITEST_ANY, &any_tap_range);
 	litest_add_ranged("tap:1fg", touchpad_1fg_multitap, LITEST_TOUCHPAD, LITEST_ANY, &multitap_range);
@@ -3677,6 +3915,8 @@ TEST_COLLECTION(touchpad_tap)
 	litest_add_ranged("tap:1fg", touchpad_1fg_multitap_n_drag_click, LITEST_CLICKPAD, LITEST_ANY, &multitap_range);
 	litest_add("tap:1fg", touchpad_1fg_tap_n_drag, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("tap:1fg", touchpad_1fg_tap_n_drag_draglock, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add("tap:1fg", touchpad_1fg_tap_early_commit, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add("tap:1fg", touchpad_1fg_tap_n_drag_early_commit, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("tap:1fg", touchpad_1fg_tap_n_drag_draglock_tap, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("tap:1fg", touchpad_1fg_tap_n_drag_draglock_timeout, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("tap:2fg", touchpad_2fg_tap_n_drag, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH);
@@ -3729,6 +3969,7 @@ TEST_COLLECTION(touchpad_tap)
 	litest_add("tap:config", touchpad_tap_default_map, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("tap:config", touchpad_tap_map_unsupported, LITEST_ANY, LITEST_TOUCHPAD);
 	litest_add("tap:config", touchpad_tap_set_map, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add("tap:config", touchpad_tap_config_transaction, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("tap:config", touchpad_tap_set_map_no_tapping, LITEST_ANY, LITEST_TOUCHPAD);
 	litest_add("tap:config", touchpad_tap_get_map_no_tapping, LITEST_ANY, LITEST_TOUCHPAD);
 	litest_add("tap:config", touchpad_tap_map_delayed, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH|LITEST_SEMI_MT);
@@ -3739,6 +3980,9 @@ TEST_COLLECTION(touchpad_tap)
 	litest_add("tap:draglock", touchpad_drag_lock_default_disabled, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("tap:draglock", touchpad_drag_lock_default_unavailable, LITEST_ANY, LITEST_TOUCHPAD);
 
+	litest_add("tap:earlycommit", touchpad_tap_early_commit_default_disabled, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add("tap:earlycommit", touchpad_tap_early_commit_default_unavailable, LITEST_ANY, LITEST_TOUCHPAD);
+
 	litest_add("tap:drag", touchpad_drag_default_disabled, LITEST_ANY, LITEST_TOUCHPAD);
 	litest_add("tap:drag", touchpad_drag_default_enabled, LITEST_TOUCHPAD, LITEST_BUTTON);
 	litest_add("tap:drag", touchpad_drag_config_invalid, LITEST_TOUCHPAD, LITEST_ANY);
@@ -53,6 +53,55 @@ dwt_init_paired_keyboard(struct libinput *li,
 	return litest_add_device(li, which);
 }
 
+START_TEST(touchpad_high_slot_touch)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	uint64_t before, after;
+
+	litest_disable_tap(device);
+	litest_drain_events(li);
+
+	before = libinput_device_get_memory_stats(device,
+						  LIBINPUT_MEMORY_STAT_DISPATCH);
+
+	/* A slot beyond the initial chunk of touches */
+	litest_touch_down(dev, 12, 50, 50);
+	litest_touch_move_to(dev, 12, 50, 50, 80, 50, 20);
+	litest_touch_up(dev, 12);
+	libinput_dispatch(li);
+
+	after = libinput_device_get_memory_stats(device,
+						 LIBINPUT_MEMORY_STAT_DISPATCH);
+	ck_assert_int_gt(after, before);
+
+	event = libinput_get_event(li);
+	ck_assert_notnull(event);
+
+	while (event) {
+		ck_assert_int_eq(libinput_event_get_type(event),
+				 LIBINPUT_EVENT_POINTER_MOTION);
+
+		ptrev = libinput_event_get_pointer_event(event);
+		ck_assert_int_ge(libinput_event_pointer_get_dx(ptrev), 0);
+		ck_assert_int_eq(libinput_event_pointer_get_dy(ptrev), 0);
+		libinput_event_destroy(event);
+		event = libinput_get_event(li);
+	}
+
+	/* A second touch in the same chunk doesn't allocate again */
+	litest_touch_down(dev, 13, 50, 50);
+	litest_touch_up(dev, 13);
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_device_get_memory_stats(device,
+							  LIBINPUT_MEMORY_STAT_DISPATCH),
+			 after);
+}
+END_TEST
+
 START_TEST(touchpad_1fg_motion)
 {
 	struct litest_device *dev = litest_current_device();
@@ -164,6 +213,49 @@ START_TEST(touchpad_2fg_scroll)
 }
 END_TEST
 
+START_TEST(touchpad_2fg_scroll_coalescing)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	enum libinput_pointer_axis axis = LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL;
+
+	if (!litest_has_2fg_scroll(dev))
+		return;
+
+	litest_enable_2fg_scroll(dev);
+	ck_assert_int_eq(libinput_set_event_coalescing(li,
+				LIBINPUT_EVENT_COALESCING_POINTER_SCROLL), 0);
+	litest_drain_events(li);
+
+	/* Everything up to the scroll stop is merged into one event, the
+	 * scroll stop stays separate */
+	test_2fg_scroll(dev, 0.1, 40, false);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_axis_event(event,
+				     axis,
+				     LIBINPUT_POINTER_AXIS_SOURCE_FINGER);
+	ck_assert_double_gt(libinput_event_pointer_get_axis_value(ptrev, axis),
+			    0.0);
+	libinput_event_destroy(event);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_axis_event(event,
+				     axis,
+				     LIBINPUT_POINTER_AXIS_SOURCE_FINGER);
+	ck_assert_double_eq(libinput_event_pointer_get_axis_value(ptrev, axis),
+			    0.0);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	/* The next sequence doesn't merge into the scroll stop */
+	test_2fg_scroll(dev, 0.1, -40, false);
+	litest_assert_scroll(li, axis, -9);
+}
+END_TEST
+
 START_TEST(touchpad_2fg_scroll_initially_diagonal)
 {
 	struct litest_device *dev = litest_current_device();
@@ -3069,6 +3161,38 @@ START_TEST(touchpad_hover_noevent)
 }
 END_TEST
 
+START_TEST(touchpad_hover_frames_skipped)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	uint64_t hover;
+
+	litest_drain_events(li);
+
+	hover = libinput_device_get_stats(device,
+					  LIBINPUT_DEVICE_STAT_HOVER_FRAMES);
+
+	litest_hover_start(dev, 0, 50, 50);
+	litest_hover_move_to(dev, 0, 50, 50, 70, 70, 10);
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+
+	ck_assert_int_ge(libinput_device_get_stats(device,
+						   LIBINPUT_DEVICE_STAT_HOVER_FRAMES),
+			 hover + 10);
+
+	/* the touch still works normally once it's down */
+	litest_touch_move_to(dev, 0, 70, 70, 50, 50, 10);
+	libinput_dispatch(li);
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+
+	litest_hover_move_to(dev, 0, 50, 50, 70, 70, 10);
+	litest_hover_end(dev, 0);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
 START_TEST(touchpad_hover_down)
 {
 	struct litest_device *dev = litest_current_device();
@@ -3688,6 +3812,44 @@ START_TEST(touchpad_state_after_syn_dropped_2fg_change)
 }
 END_TEST
 
+START_TEST(touchpad_dwt_timerfd_updates)
+{
+	struct litest_device *touchpad = litest_current_device();
+	struct litest_device *keyboard;
+	struct libinput *li = touchpad->libinput;
+	uint64_t before, after;
+	int i;
+
+	if (!has_disable_while_typing(touchpad))
+		return;
+
+	keyboard = dwt_init_paired_keyboard(li, touchpad);
+	litest_drain_events(li);
+
+	before = libinput_get_statistic(li, LIBINPUT_STATISTIC_TIMERFD_UPDATES);
+
+	/* Every key press re-arms the dwt timer to a later expiry, that
+	 * must not reprogram the timerfd every time */
+	for (i = 0; i < 20; i++) {
+		litest_keyboard_key(keyboard, KEY_A, true);
+		litest_keyboard_key(keyboard, KEY_A, false);
+		libinput_dispatch(li);
+	}
+
+	after = libinput_get_statistic(li, LIBINPUT_STATISTIC_TIMERFD_UPDATES);
+	ck_assert_int_lt(after - before, 5);
+
+	litest_drain_events(li);
+	litest_timeout_dwt_long();
+	libinput_dispatch(li);
+	ck_assert_int_gt(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_TIMER_WAKEUPS),
+			 0);
+
+	litest_delete_device(keyboard);
+}
+END_TEST
+
 START_TEST(touchpad_dwt)
 {
 	struct litest_device *touchpad = litest_current_device();
@@ -6976,6 +7138,37 @@ START_TEST(touchpad_end_start_touch)
 }
 END_TEST
 
+START_TEST(touchpad_stationary_touch)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	uint64_t stationary;
+
+	litest_drain_events(li);
+
+	stationary = libinput_device_get_stats(device,
+					       LIBINPUT_DEVICE_STAT_STATIONARY_TOUCHES);
+
+	/* Jitter within the hysteresis margin skips the motion
+	 * processing and doesn't move the pointer */
+	litest_touch_down(dev, 0, 50, 50);
+	for (int i = 0; i < 10; i++)
+		litest_touch_move(dev, 0, 50 + (i % 2) * 0.02, 50);
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+
+	ck_assert_int_ge(libinput_device_get_stats(device,
+						   LIBINPUT_DEVICE_STAT_STATIONARY_TOUCHES),
+			 stationary + 8);
+
+	/* Moving on from there is normal motion again */
+	litest_touch_move_to(dev, 0, 50, 50, 70, 50, 10);
+	litest_touch_up(dev, 0);
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+}
+END_TEST
+
 START_TEST(touchpad_fuzz)
 {
 	struct litest_device *dev = litest_current_device();
@@ -6992,6 +7185,86 @@ START_TEST(touchpad_fuzz)
 }
 END_TEST
 
+START_TEST(touchpad_low_latency_config)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	enum libinput_config_status status;
+	enum libinput_config_low_latency_state state;
+
+	ck_assert(libinput_device_config_low_latency_is_available(device));
+	state = libinput_device_config_low_latency_get_enabled(device);
+	ck_assert_int_eq(state, LIBINPUT_CONFIG_LOW_LATENCY_DISABLED);
+	state = libinput_device_config_low_latency_get_default_enabled(device);
+	ck_assert_int_eq(state, LIBINPUT_CONFIG_LOW_LATENCY_DISABLED);
+
+	status = libinput_device_config_low_latency_set_enabled(device,
+					LIBINPUT_CONFIG_LOW_LATENCY_ENABLED);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	state = libinput_device_config_low_latency_get_enabled(device);
+	ck_assert_int_eq(state, LIBINPUT_CONFIG_LOW_LATENCY_ENABLED);
+
+	status = libinput_device_config_low_latency_set_enabled(device,
+					LIBINPUT_CONFIG_LOW_LATENCY_DISABLED);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+
+	status = libinput_device_config_low_latency_set_enabled(device, 3);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_INVALID);
+}
+END_TEST
+
+START_TEST(touchpad_low_latency_config_unavailable)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	enum libinput_config_status status;
+	enum libinput_config_low_latency_state state;
+
+	ck_assert(!libinput_device_config_low_latency_is_available(device));
+	state = libinput_device_config_low_latency_get_enabled(device);
+	ck_assert_int_eq(state, LIBINPUT_CONFIG_LOW_LATENCY_DISABLED);
+	state = libinput_device_config_low_latency_get_default_enabled(device);
+	ck_assert_int_eq(state, LIBINPUT_CONFIG_LOW_LATENCY_DISABLED);
+
+	status = libinput_device_config_low_latency_set_enabled(device,
+					LIBINPUT_CONFIG_LOW_LATENCY_ENABLED);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_UNSUPPORTED);
+	status = libinput_device_config_low_latency_set_enabled(device,
+					LIBINPUT_CONFIG_LOW_LATENCY_DISABLED);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+}
+END_TEST
+
+START_TEST(touchpad_low_latency_first_motion_stats)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput *li = dev->libinput;
+
+	libinput_device_config_low_latency_set_enabled(device,
+					LIBINPUT_CONFIG_LOW_LATENCY_ENABLED);
+	libinput_device_set_latency_tracking(device, 1);
+	litest_disable_tap(device);
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_move_to(dev, 0, 50, 50, 70, 50, 10);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+
+	/* one touch sequence, one sample */
+	ck_assert_int_eq(libinput_device_get_latency_stats(device,
+							   LIBINPUT_LATENCY_STAT_FIRST_MOTION_SAMPLES),
+			 1);
+	ck_assert_int_ge(libinput_device_get_latency_stats(device,
+							   LIBINPUT_LATENCY_STAT_FIRST_MOTION_MAX),
+			 libinput_device_get_latency_stats(device,
+							   LIBINPUT_LATENCY_STAT_FIRST_MOTION_P50));
+}
+END_TEST
+
 TEST_COLLECTION(touchpad)
 {
 	struct range suspends = { SUSPEND_EXT_MOUSE, SUSPEND_COUNT };
@@ -7003,6 +7276,7 @@ TEST_COLLECTION(touchpad)
 	litest_add("touchpad:motion", touchpad_2fg_no_motion, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH);
 
 	litest_add("touchpad:scroll", touchpad_2fg_scroll, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH|LITEST_SEMI_MT);
+	litest_add("touchpad:scroll", touchpad_2fg_scroll_coalescing, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH|LITEST_SEMI_MT);
 	litest_add("touchpad:scroll", touchpad_2fg_scroll_initially_diagonal, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH|LITEST_SEMI_MT);
 	litest_add("touchpad:scroll", touchpad_2fg_scroll_axis_lock, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH|LITEST_SEMI_MT);
 	litest_add("touchpad:scroll", touchpad_2fg_scroll_axis_lock_switch, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH|LITEST_SEMI_MT);
@@ -7096,6 +7370,7 @@ TEST_COLLECTION(touchpad)
 
 	litest_add("touchpad:hover", touchpad_hover_noevent, LITEST_TOUCHPAD|LITEST_HOVER, LITEST_ANY);
 	litest_add("touchpad:hover", touchpad_hover_down, LITEST_TOUCHPAD|LITEST_HOVER, LITEST_ANY);
+	litest_add("touchpad:hover", touchpad_hover_frames_skipped, LITEST_TOUCHPAD|LITEST_HOVER, LITEST_SEMI_MT);
 	litest_add("touchpad:hover", touchpad_hover_down_up, LITEST_TOUCHPAD|LITEST_HOVER, LITEST_ANY);
 	litest_add("touchpad:hover", touchpad_hover_down_hover_down, LITEST_TOUCHPAD|LITEST_HOVER, LITEST_ANY);
 	litest_add("touchpad:hover", touchpad_hover_2fg_noevent, LITEST_TOUCHPAD|LITEST_HOVER, LITEST_ANY);
@@ -7114,6 +7389,7 @@ TEST_COLLECTION(touchpad)
 	litest_add("touchpad:state", touchpad_state_after_syn_dropped_2fg_change, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH);
 
 	litest_add("touchpad:dwt", touchpad_dwt, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add("touchpad:dwt", touchpad_dwt_timerfd_updates, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add_for_device("touchpad:dwt", touchpad_dwt_ext_and_int_keyboard, LITEST_SYNAPTICS_I2C);
 	litest_add("touchpad:dwt", touchpad_dwt_enable_touch, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("touchpad:dwt", touchpad_dwt_touch_hold, LITEST_TOUCHPAD, LITEST_ANY);
@@ -7135,6 +7411,11 @@ TEST_COLLECTION(touchpad)
 	litest_add("touchpad:dwt", touchpad_dwt_edge_scroll_interrupt, LITEST_TOUCHPAD, LITEST_CLICKPAD);
 	litest_add("touchpad:dwt", touchpad_dwt_config_default_on, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("touchpad:dwt", touchpad_dwt_config_default_off, LITEST_ANY, LITEST_TOUCHPAD);
+
+	litest_add("touchpad:low-latency", touchpad_low_latency_config, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add("touchpad:low-latency", touchpad_low_latency_config_unavailable, LITEST_ANY, LITEST_TOUCHPAD);
+	litest_add("touchpad:low-latency", touchpad_low_latency_first_motion_stats, LITEST_TOUCHPAD, LITEST_ANY);
+
 	litest_add("touchpad:dwt", touchpad_dwt_disabled, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("touchpad:dwt", touchpad_dwt_disable_during_touch, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("touchpad:dwt", touchpad_dwt_disable_before_touch, LITEST_TOUCHPAD, LITEST_ANY);
@@ -7198,4 +7479,7 @@ TEST_COLLECTION(touchpad)
 	litest_add_for_device("touchpad:bugs", touchpad_end_start_touch, LITEST_WACOM_FINGER);
 
 	litest_add("touchpad:fuzz", touchpad_fuzz, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add_for_device("touchpad:fuzz", touchpad_stationary_touch, LITEST_MAGIC_TRACKPAD);
+
+	litest_add_for_device("touchpad:slots", touchpad_high_slot_touch, LITEST_MAGIC_TRACKPAD);
 }
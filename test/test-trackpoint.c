@@ -408,6 +408,50 @@ START_TEST(trackpoint_palmdetect_require_min_events_timeout)
 }
 END_TEST
 
+START_TEST(trackpoint_palmdetect_timerfd_updates)
+{
+	struct litest_device *trackpoint = litest_current_device();
+	struct litest_device *touchpad;
+	struct libinput *li = trackpoint->libinput;
+	uint64_t before, after;
+
+	touchpad = litest_add_device(li, LITEST_SYNAPTICS_I2C);
+	litest_drain_events(li);
+
+	before = libinput_get_statistic(li, LIBINPUT_STATISTIC_TIMERFD_UPDATES);
+
+	/* Every motion event pushes the palm timeout back, that must not
+	 * reprogram the timerfd every time */
+	for (int i = 0; i < 20; i++) {
+		litest_event(trackpoint, EV_REL, REL_X, 1);
+		litest_event(trackpoint, EV_REL, REL_Y, 1);
+		litest_event(trackpoint, EV_SYN, SYN_REPORT, 0);
+		libinput_dispatch(li);
+	}
+
+	after = libinput_get_statistic(li, LIBINPUT_STATISTIC_TIMERFD_UPDATES);
+	ck_assert_int_lt(after - before, 5);
+	litest_drain_events(li);
+
+	litest_touch_down(touchpad, 0, 30, 30);
+	litest_touch_move_to(touchpad, 0, 30, 30, 80, 80, 10);
+	litest_touch_up(touchpad, 0);
+	litest_assert_empty_queue(li);
+
+	/* The timer armed for the earlier timeout re-arms itself for the
+	 * last event's */
+	litest_timeout_trackpoint();
+	libinput_dispatch(li);
+
+	litest_touch_down(touchpad, 0, 30, 30);
+	litest_touch_move_to(touchpad, 0, 30, 30, 80, 80, 10);
+	litest_touch_up(touchpad, 0);
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+
+	litest_delete_device(touchpad);
+}
+END_TEST
+
 TEST_COLLECTION(trackpoint)
 {
 	litest_add("trackpoint:middlebutton", trackpoint_middlebutton, LITEST_POINTINGSTICK, LITEST_ANY);
@@ -422,4 +466,5 @@ TEST_COLLECTION(trackpoint)
 	litest_add("trackpoint:palmdetect", trackpoint_palmdetect_resume_touch, LITEST_POINTINGSTICK, LITEST_ANY);
 	litest_add("trackpoint:palmdetect", trackpoint_palmdetect_require_min_events, LITEST_POINTINGSTICK, LITEST_ANY);
 	litest_add("trackpoint:palmdetect", trackpoint_palmdetect_require_min_events_timeout, LITEST_POINTINGSTICK, LITEST_ANY);
+	litest_add("trackpoint:palmdetect", trackpoint_palmdetect_timerfd_updates, LITEST_POINTINGSTICK, LITEST_ANY);
 }
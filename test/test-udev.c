@@ -672,6 +672,371 @@ START_TEST(udev_ignore_device)
 }
 END_TEST
 
+START_TEST(udev_many_devices)
+{
+	struct udev *udev;
+	struct libinput *li;
+	struct libinput_event *event;
+	struct litest_device *devs[8];
+	int seen[ARRAY_LENGTH(devs)] = {0};
+
+	/* Enough devices for the probing to go parallel */
+	for (size_t i = 0; i < ARRAY_LENGTH(devs); i++)
+		devs[i] = litest_create(LITEST_MOUSE, NULL, NULL, NULL, NULL);
+
+	udev = udev_new();
+	ck_assert_notnull(udev);
+
+	li = libinput_udev_create_context(&simple_interface, NULL, udev);
+	ck_assert_notnull(li);
+	litest_restore_log_handler(li);
+
+	ck_assert_int_eq(libinput_udev_assign_seat(li, "seat0"), 0);
+	libinput_dispatch(li);
+
+	while ((event = libinput_get_event(li))) {
+		if (libinput_event_get_type(event) ==
+		    LIBINPUT_EVENT_DEVICE_ADDED) {
+			struct libinput_device *device;
+			const char *sysname;
+
+			device = libinput_event_get_device(event);
+			sysname = libinput_device_get_sysname(device);
+
+			for (size_t i = 0; i < ARRAY_LENGTH(devs); i++) {
+				const char *devnode;
+
+				devnode = libevdev_uinput_get_devnode(devs[i]->uinput);
+				if (streq(strrchr(devnode, '/') + 1, sysname))
+					seen[i]++;
+			}
+		}
+		libinput_event_destroy(event);
+		libinput_dispatch(li);
+	}
+
+	for (size_t i = 0; i < ARRAY_LENGTH(devs); i++)
+		ck_assert_int_eq(seen[i], 1);
+
+	libinput_unref(li);
+	udev_unref(udev);
+
+	for (size_t i = 0; i < ARRAY_LENGTH(devs); i++)
+		litest_delete_device(devs[i]);
+}
+END_TEST
+
+static int
+count_device_events(struct libinput *li,
+		    enum libinput_event_type type,
+		    struct litest_device **devs,
+		    size_t ndevs,
+		    int *seen)
+{
+	struct libinput_event *event;
+	int count = 0;
+
+	litest_wait_for_event_of_type(li, type, -1);
+
+	while ((event = libinput_get_event(li))) {
+		if (libinput_event_get_type(event) == type) {
+			struct libinput_device *device;
+			const char *sysname;
+
+			device = libinput_event_get_device(event);
+			sysname = libinput_device_get_sysname(device);
+
+			for (size_t i = 0; i < ndevs; i++) {
+				const char *devnode;
+
+				devnode = libevdev_uinput_get_devnode(devs[i]->uinput);
+				if (streq(strrchr(devnode, '/') + 1, sysname)) {
+					seen[i]++;
+					count++;
+				}
+			}
+		}
+		libinput_event_destroy(event);
+		libinput_dispatch(li);
+	}
+
+	return count;
+}
+
+START_TEST(udev_hotplug_many_devices)
+{
+	struct udev *udev;
+	struct libinput *li;
+	struct litest_device *devs[6];
+	int added[ARRAY_LENGTH(devs)] = {0};
+	int count;
+
+	udev = udev_new();
+	ck_assert_notnull(udev);
+
+	li = libinput_udev_create_context(&simple_interface, NULL, udev);
+	ck_assert_notnull(li);
+	litest_restore_log_handler(li);
+
+	ck_assert_int_eq(libinput_udev_assign_seat(li, "seat0"), 0);
+	litest_drain_events(li);
+
+	/* The monitor events arrive in bursts, every device must be added
+	 * exactly once no matter how they are batched */
+	for (size_t i = 0; i < ARRAY_LENGTH(devs); i++)
+		devs[i] = litest_create(LITEST_MOUSE, NULL, NULL, NULL, NULL);
+
+	count = 0;
+	while (count < (int)ARRAY_LENGTH(devs))
+		count += count_device_events(li,
+					     LIBINPUT_EVENT_DEVICE_ADDED,
+					     devs,
+					     ARRAY_LENGTH(devs),
+					     added);
+
+	for (size_t i = 0; i < ARRAY_LENGTH(devs); i++)
+		ck_assert_int_eq(added[i], 1);
+
+	libinput_unref(li);
+	udev_unref(udev);
+
+	for (size_t i = 0; i < ARRAY_LENGTH(devs); i++)
+		litest_delete_device(devs[i]);
+}
+END_TEST
+
+/* Dispatches until the statistic reaches the value, the udev events
+ * arrive asynchronously */
+static void
+wait_for_statistic(struct libinput *li,
+		   enum libinput_statistic statistic,
+		   uint64_t value)
+{
+	for (int i = 0; i < 200; i++) {
+		libinput_dispatch(li);
+		if (libinput_get_statistic(li, statistic) >= value)
+			break;
+		msleep(5);
+	}
+
+	ck_assert_int_eq(libinput_get_statistic(li, statistic), value);
+}
+
+START_TEST(udev_hotplug_damping)
+{
+	struct udev *udev;
+	struct libinput *li;
+	struct litest_device *dev;
+
+	udev = udev_new();
+	ck_assert_notnull(udev);
+
+	li = libinput_udev_create_context(&simple_interface, NULL, udev);
+	ck_assert_notnull(li);
+	litest_restore_log_handler(li);
+	ck_assert_int_eq(libinput_udev_set_hotplug_damping(li, 1000), 0);
+
+	ck_assert_int_eq(libinput_udev_assign_seat(li, "seat0"), 0);
+	litest_drain_events(li);
+
+	/* A device that is gone again right away is flapping */
+	dev = litest_create(LITEST_MOUSE, NULL, NULL, NULL, NULL);
+	litest_wait_for_event_of_type(li, LIBINPUT_EVENT_DEVICE_ADDED, -1);
+	litest_drain_events(li);
+	litest_delete_device(dev);
+	litest_wait_for_event_of_type(li, LIBINPUT_EVENT_DEVICE_REMOVED, -1);
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_HOTPLUG_FLAPS),
+			 1);
+
+	/* When it comes back it's held back, and the caller never sees
+	 * it if it goes away again in the meantime */
+	dev = litest_create(LITEST_MOUSE, NULL, NULL, NULL, NULL);
+	wait_for_statistic(li, LIBINPUT_STATISTIC_HOTPLUG_DEFERRED, 1);
+	litest_assert_empty_queue(li);
+	litest_delete_device(dev);
+	wait_for_statistic(li, LIBINPUT_STATISTIC_HOTPLUG_SUPPRESSED, 1);
+	litest_assert_empty_queue(li);
+
+	/* Once it stays for the window, it's added */
+	dev = litest_create(LITEST_MOUSE, NULL, NULL, NULL, NULL);
+	wait_for_statistic(li, LIBINPUT_STATISTIC_HOTPLUG_DEFERRED, 2);
+	litest_assert_empty_queue(li);
+	litest_wait_for_event_of_type(li, LIBINPUT_EVENT_DEVICE_ADDED, -1);
+	litest_drain_events(li);
+
+	libinput_unref(li);
+	udev_unref(udev);
+	litest_delete_device(dev);
+}
+END_TEST
+
+struct open_async_data {
+	struct libinput_open_request *requests[32];
+	char *paths[32];
+	int flags[32];
+	size_t nrequests;
+	int nopened;
+	int nclosed;
+};
+
+static int
+open_async_open_restricted(const char *path, int flags, void *data)
+{
+	/* asynchronous open must not fall back to this */
+	litest_abort_msg("open_restricted called for %s\n", path);
+	return -ENODEV;
+}
+
+static void
+open_async_close_restricted(int fd, void *data)
+{
+	struct open_async_data *d = data;
+
+	d->nclosed++;
+	close(fd);
+}
+
+static const struct libinput_interface open_async_interface = {
+	.open_restricted = open_async_open_restricted,
+	.close_restricted = open_async_close_restricted,
+};
+
+static void
+open_async(struct libinput_open_request *request,
+	   const char *path,
+	   int flags,
+	   void *data)
+{
+	struct open_async_data *d = data;
+
+	litest_assert_int_lt(d->nrequests, ARRAY_LENGTH(d->requests));
+	d->requests[d->nrequests] = request;
+	d->paths[d->nrequests] = safe_strdup(path);
+	d->flags[d->nrequests] = flags;
+	d->nrequests++;
+}
+
+static void
+open_async_complete_all(struct open_async_data *d)
+{
+	for (size_t i = 0; i < d->nrequests; i++) {
+		int fd = open(d->paths[i], d->flags[i]);
+
+		if (fd >= 0)
+			d->nopened++;
+
+		libinput_device_open_complete(d->requests[i],
+					      fd < 0 ? -errno : fd);
+		free(d->paths[i]);
+	}
+	d->nrequests = 0;
+}
+
+static int
+count_added_devices(struct libinput *li, struct litest_device *dev)
+{
+	struct libinput_event *event;
+	const char *devnode = libevdev_uinput_get_devnode(dev->uinput);
+	int count = 0;
+
+	libinput_dispatch(li);
+	while ((event = libinput_get_event(li))) {
+		if (libinput_event_get_type(event) ==
+		    LIBINPUT_EVENT_DEVICE_ADDED) {
+			struct libinput_device *device;
+			const char *sysname;
+
+			device = libinput_event_get_device(event);
+			sysname = libinput_device_get_sysname(device);
+			if (streq(strrchr(devnode, '/') + 1, sysname))
+				count++;
+		}
+		libinput_event_destroy(event);
+		libinput_dispatch(li);
+	}
+
+	return count;
+}
+
+START_TEST(udev_open_async)
+{
+	struct litest_device *dev;
+	struct udev *udev;
+	struct libinput *li;
+	struct open_async_data data = {0};
+
+	dev = litest_create(LITEST_MOUSE, NULL, NULL, NULL, NULL);
+
+	udev = udev_new();
+	ck_assert_notnull(udev);
+
+	li = libinput_udev_create_context(&open_async_interface, &data, udev);
+	ck_assert_notnull(li);
+	litest_restore_log_handler(li);
+	libinput_set_open_async(li, open_async);
+
+	ck_assert_int_eq(libinput_udev_assign_seat(li, "seat0"), 0);
+
+	/* Nothing is added until the fds arrive */
+	ck_assert_int_ge(data.nrequests, 1);
+	ck_assert_int_eq(count_added_devices(li, dev), 0);
+
+	open_async_complete_all(&data);
+	ck_assert_int_ge(data.nopened, 1);
+	ck_assert_int_eq(count_added_devices(li, dev), 1);
+
+	/* Re-enumeration on resume requests the devices again */
+	data.nopened = 0;
+	libinput_suspend(li);
+	ck_assert_int_eq(libinput_resume(li), 0);
+	ck_assert_int_ge(data.nrequests, 1);
+	open_async_complete_all(&data);
+	ck_assert_int_eq(count_added_devices(li, dev), 1);
+
+	libinput_unref(li);
+	ck_assert_int_eq(data.nclosed, data.nopened);
+	udev_unref(udev);
+
+	litest_delete_device(dev);
+}
+END_TEST
+
+START_TEST(udev_open_async_cancelled)
+{
+	struct litest_device *dev;
+	struct udev *udev;
+	struct libinput *li;
+	struct open_async_data data = {0};
+
+	dev = litest_create(LITEST_MOUSE, NULL, NULL, NULL, NULL);
+
+	udev = udev_new();
+	ck_assert_notnull(udev);
+
+	li = libinput_udev_create_context(&open_async_interface, &data, udev);
+	ck_assert_notnull(li);
+	litest_restore_log_handler(li);
+	libinput_set_open_async(li, open_async);
+
+	ck_assert_int_eq(libinput_udev_assign_seat(li, "seat0"), 0);
+	ck_assert_int_ge(data.nrequests, 1);
+
+	/* Pending requests are cancelled and their fds closed once they
+	 * arrive, even after the context is gone */
+	libinput_unref(li);
+	ck_assert_int_eq(data.nclosed, 0);
+
+	open_async_complete_all(&data);
+	ck_assert_int_ge(data.nopened, 1);
+	ck_assert_int_eq(data.nclosed, data.nopened);
+
+	udev_unref(udev);
+	litest_delete_device(dev);
+}
+END_TEST
+
 TEST_COLLECTION(udev)
 {
 	litest_add_no_device("udev:create", udev_create_NULL);
@@ -690,6 +1055,11 @@ TEST_COLLECTION(udev)
 	litest_add_for_device("udev:suspend", udev_suspend_resume_before_seat, LITEST_SYNAPTICS_CLICKPAD_X220);
 	litest_add_for_device("udev:device events", udev_device_sysname, LITEST_SYNAPTICS_CLICKPAD_X220);
 	litest_add_for_device("udev:seat", udev_seat_recycle, LITEST_SYNAPTICS_CLICKPAD_X220);
+	litest_add_no_device("udev:seat", udev_many_devices);
+	litest_add_no_device("udev:seat", udev_hotplug_many_devices);
+	litest_add_no_device("udev:seat", udev_hotplug_damping);
+	litest_add_no_device("udev:seat", udev_open_async);
+	litest_add_no_device("udev:seat", udev_open_async_cancelled);
 
 	litest_add_no_device("udev:path", udev_path_add_device);
 	litest_add_for_device("udev:path", udev_path_remove_device, LITEST_SYNAPTICS_CLICKPAD_X220);
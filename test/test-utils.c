@@ -24,6 +24,8 @@
 #include <config.h>
 
 #include <check.h>
+#include <pthread.h>
+#include <sched.h>
 
 #include <valgrind/valgrind.h>
 
@@ -35,6 +37,9 @@
 #include "util-bits.h"
 #include "util-ratelimit.h"
 #include "util-matrix.h"
+#include "util-histogram.h"
+#include "util-ring.h"
+#include "filter-private.h"
 
 #define  TEST_VERSIONSORT
 #include "libinput-versionsort.h"
@@ -78,6 +83,32 @@ START_TEST(bitfield_helpers)
 }
 END_TEST
 
+START_TEST(bitfield_for_each_set)
+{
+	/* bits on byte and word boundaries and in a short last word */
+	const int expected[] = { 0, 7, 8, 63, 64, 65, 127, 128, 200 };
+	unsigned char bits[NCHARS(201)] = {0};
+	size_t n = 0;
+	int b;
+
+	bits_for_each_set(bits, sizeof(bits), b)
+		ck_abort();
+
+	for (size_t i = 0; i < ARRAY_LENGTH(expected); i++)
+		set_bit(bits, expected[i]);
+
+	bits_for_each_set(bits, sizeof(bits), b) {
+		ck_assert_int_lt(n, ARRAY_LENGTH(expected));
+		ck_assert_int_eq(b, expected[n]);
+		n++;
+	}
+	ck_assert_int_eq(n, ARRAY_LENGTH(expected));
+
+	ck_assert_int_eq(bits_next_set(bits, sizeof(bits), 201), -1);
+	ck_assert_int_eq(bits_next_set(bits, sizeof(bits), 129), 200);
+}
+END_TEST
+
 START_TEST(matrix_helpers)
 {
 	struct matrix m1, m2, m3;
@@ -195,6 +226,38 @@ START_TEST(ratelimit_helpers)
 }
 END_TEST
 
+START_TEST(ratelimit_helpers_time)
+{
+	struct ratelimit rl;
+	unsigned int i, j;
+	uint64_t time = ms2us(5000);
+
+	/* 10 attempts every 1000ms */
+	ratelimit_init(&rl, ms2us(1000), 10);
+
+	for (j = 0; j < 3; ++j) {
+		for (i = 0; i < 9; ++i) {
+			ck_assert_int_eq(ratelimit_test_time(&rl, time),
+					 RATELIMIT_PASS);
+			time += ms2us(1);
+		}
+
+		ck_assert_int_eq(ratelimit_test_time(&rl, time),
+				 RATELIMIT_THRESHOLD);
+		ck_assert_int_eq(ratelimit_test_time(&rl, time),
+				 RATELIMIT_EXCEEDED);
+
+		/* still within the interval */
+		time += ms2us(900);
+		ck_assert_int_eq(ratelimit_test_time(&rl, time),
+				 RATELIMIT_EXCEEDED);
+
+		/* the timestamp, not the wall clock, resets the counter */
+		time += ms2us(200);
+	}
+}
+END_TEST
+
 struct parser_test {
 	char *tag;
 	int expected_value;
@@ -664,6 +727,523 @@ START_TEST(human_time)
 }
 END_TEST
 
+START_TEST(histogram_test)
+{
+	struct histogram h;
+
+	histogram_reset(&h);
+	ck_assert_int_eq(h.count, 0);
+	ck_assert_int_eq(histogram_percentile(&h, 50), 0);
+
+	histogram_add(&h, 0);
+	ck_assert_int_eq(histogram_percentile(&h, 50), 0);
+	ck_assert_int_eq(histogram_percentile(&h, 100), 0);
+
+	histogram_reset(&h);
+	for (int i = 0; i < 99; i++)
+		histogram_add(&h, 10);
+	histogram_add(&h, 5000);
+
+	ck_assert_int_eq(h.count, 100);
+	ck_assert_int_eq(h.max, 5000);
+	/* 10 lands in the [8, 16) bucket */
+	ck_assert_int_eq(histogram_percentile(&h, 50), 15);
+	ck_assert_int_eq(histogram_percentile(&h, 99), 15);
+	ck_assert_int_eq(histogram_percentile(&h, 100), 5000);
+
+	histogram_add(&h, 6000);
+	ck_assert_int_eq(histogram_percentile(&h, 100), 6000);
+	/* [4096, 8192) bucket, clamped to the max */
+	ck_assert_int_eq(histogram_percentile(&h, 99), 6000);
+
+	histogram_reset(&h);
+	histogram_add(&h, UINT64_MAX);
+	ck_assert(histogram_percentile(&h, 50) == UINT64_MAX);
+}
+END_TEST
+
+START_TEST(key_count_test)
+{
+	struct key_count kc = {0};
+
+	ck_assert_int_le(sizeof(kc), 64);
+
+	ck_assert_int_eq(key_count_get(&kc, KEY_A), 0);
+	ck_assert_int_eq(key_count_dec(&kc, KEY_A), 0);
+
+	ck_assert_int_eq(key_count_inc(&kc, KEY_A), 1);
+	ck_assert_int_eq(key_count_inc(&kc, KEY_A), 2);
+	ck_assert_int_eq(key_count_inc(&kc, BTN_LEFT), 1);
+	ck_assert_int_eq(key_count_get(&kc, KEY_A), 2);
+	ck_assert_int_eq(key_count_get(&kc, BTN_LEFT), 1);
+	ck_assert_int_eq(key_count_get(&kc, KEY_B), 0);
+
+	ck_assert_int_eq(key_count_dec(&kc, KEY_A), 1);
+	ck_assert_int_eq(key_count_dec(&kc, KEY_A), 0);
+	ck_assert_int_eq(key_count_get(&kc, KEY_A), 0);
+	ck_assert_int_eq(key_count_get(&kc, BTN_LEFT), 1);
+
+	/* more keys down than the inline storage */
+	for (unsigned int code = KEY_ESC; code <= KEY_MICMUTE; code++)
+		ck_assert_int_eq(key_count_inc(&kc, code), 1);
+	for (unsigned int code = KEY_MICMUTE; code >= KEY_ESC; code--) {
+		ck_assert_int_eq(key_count_get(&kc, code), 1);
+		ck_assert_int_eq(key_count_dec(&kc, code), 0);
+	}
+	ck_assert_int_eq(key_count_get(&kc, BTN_LEFT), 1);
+	ck_assert_int_eq(key_count_dec(&kc, BTN_LEFT), 0);
+
+	key_count_destroy(&kc);
+}
+END_TEST
+
+START_TEST(arena_test)
+{
+	struct arena arena = {0};
+	unsigned char *small, *big;
+	uint64_t *aligned;
+
+	small = arena_zalloc(&arena, 3);
+	aligned = arena_zalloc(&arena, sizeof(*aligned));
+	ck_assert_ptr_ne(small, NULL);
+	ck_assert_int_eq((uintptr_t)aligned % 16, 0);
+	ck_assert_int_eq(*aligned, 0);
+	memset(small, 0xff, 3);
+	*aligned = UINT64_MAX;
+
+	/* larger than a chunk */
+	big = arena_zalloc(&arena, 10000);
+	for (size_t i = 0; i < 10000; i++)
+		ck_assert_int_eq(big[i], 0);
+	memset(big, 0xff, 10000);
+	ck_assert_int_ge(arena.size, 10000);
+
+	/* the previous allocations are untouched */
+	ck_assert_int_eq(*aligned, UINT64_MAX);
+	ck_assert_int_eq(small[2], 0xff);
+
+	arena_release(&arena);
+	ck_assert_int_eq(arena.size, 0);
+
+	/* usable again after release */
+	ck_assert_ptr_ne(arena_zalloc(&arena, 8), NULL);
+	arena_release(&arena);
+}
+END_TEST
+
+START_TEST(ptr_array_test)
+{
+	struct ptr_array arr = {0};
+	int values[20];
+	int *v;
+	int expected;
+
+	for (size_t i = 0; i < ARRAY_LENGTH(values); i++) {
+		values[i] = i;
+		ptr_array_append(&arr, &values[i]);
+	}
+	ck_assert_int_eq(arr.count, ARRAY_LENGTH(values));
+	ck_assert_int_ge(arr.size, arr.count);
+
+	ck_assert(ptr_array_remove(&arr, &values[0]));
+	ck_assert(ptr_array_remove(&arr, &values[10]));
+	ck_assert(!ptr_array_remove(&arr, &values[10]));
+	ck_assert_int_eq(arr.count, ARRAY_LENGTH(values) - 2);
+
+	/* order is kept */
+	expected = 1;
+	ptr_array_for_each(v, &arr) {
+		if (expected == 10)
+			expected++;
+		ck_assert_ptr_eq(v, &values[expected]);
+		expected++;
+	}
+	ck_assert_int_eq(expected, ARRAY_LENGTH(values));
+
+	ptr_array_release(&arr);
+	ck_assert_int_eq(arr.count, 0);
+	ck_assert_ptr_eq(arr.data, NULL);
+}
+END_TEST
+
+START_TEST(ring_test)
+{
+	struct ring r;
+	int values[8];
+	int i;
+
+	ck_assert(!ring_init(&r, 0));
+	ck_assert(!ring_init(&r, 6));
+	ck_assert(ring_init(&r, 4));
+	ck_assert_int_eq(ring_size(&r), 4);
+
+	ck_assert(ring_pop(&r) == NULL);
+
+	for (i = 0; i < 4; i++)
+		ck_assert(ring_push(&r, &values[i]));
+	ck_assert(!ring_push(&r, &values[4]));
+
+	ck_assert(ring_pop(&r) == &values[0]);
+	ck_assert(ring_push(&r, &values[4]));
+
+	/* wraps around */
+	for (i = 1; i < 5; i++)
+		ck_assert(ring_pop(&r) == &values[i]);
+	ck_assert(ring_pop(&r) == NULL);
+
+	for (i = 0; i < 8; i++) {
+		ck_assert(ring_push(&r, &values[i]));
+		ck_assert(ring_pop(&r) == &values[i]);
+	}
+	ck_assert(ring_pop(&r) == NULL);
+
+	ring_destroy(&r);
+}
+END_TEST
+
+#define RING_THREADS 4
+#define RING_VALUES 10000
+
+struct ring_thread {
+	struct ring *r;
+	uintptr_t id;
+	unsigned int count;
+};
+
+static void *
+ring_producer(void *data)
+{
+	struct ring_thread *t = data;
+
+	/* values are 1-based, NULL means empty */
+	for (uintptr_t v = 1; v <= RING_VALUES; v++) {
+		while (!ring_push_shared(t->r, (void*)(t->id << 16 | v)))
+			sched_yield();
+	}
+
+	return NULL;
+}
+
+static void *
+ring_consumer(void *data)
+{
+	struct ring_thread *t = data;
+	uintptr_t v;
+
+	while ((v = (uintptr_t)ring_pop_shared(t->r)) != UINTPTR_MAX) {
+		if (v)
+			t->count++;
+		else
+			sched_yield();
+	}
+
+	return NULL;
+}
+
+START_TEST(ring_shared_test)
+{
+	struct ring r;
+	pthread_t threads[RING_THREADS];
+	struct ring_thread t[RING_THREADS];
+	uintptr_t last[RING_THREADS] = {0};
+	unsigned int total = 0;
+	int i;
+
+	ck_assert(ring_init(&r, 64));
+
+	/* many producers, one consumer: everything arrives once and each
+	 * producer's values arrive in order */
+	for (i = 0; i < RING_THREADS; i++) {
+		t[i] = (struct ring_thread){ .r = &r, .id = i };
+		ck_assert_int_eq(pthread_create(&threads[i], NULL,
+						ring_producer, &t[i]), 0);
+	}
+
+	while (total < RING_THREADS * RING_VALUES) {
+		uintptr_t v = (uintptr_t)ring_pop(&r);
+		uintptr_t id = v >> 16;
+
+		if (!v) {
+			sched_yield();
+			continue;
+		}
+
+		ck_assert_int_lt(id, RING_THREADS);
+		ck_assert_int_eq(v & 0xffff, last[id] + 1);
+		last[id] = v & 0xffff;
+		total++;
+	}
+	ck_assert(ring_pop(&r) == NULL);
+
+	for (i = 0; i < RING_THREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	/* one producer, many consumers: everything arrives exactly once,
+	 * UINTPTR_MAX tells the consumers to stop */
+	for (i = 0; i < RING_THREADS; i++) {
+		t[i] = (struct ring_thread){ .r = &r, .id = i };
+		ck_assert_int_eq(pthread_create(&threads[i], NULL,
+						ring_consumer, &t[i]), 0);
+	}
+
+	for (uintptr_t v = 1; v <= RING_VALUES; v++) {
+		while (!ring_push(&r, (void*)v))
+			sched_yield();
+	}
+	for (i = 0; i < RING_THREADS; i++) {
+		while (!ring_push(&r, (void*)UINTPTR_MAX))
+			sched_yield();
+	}
+
+	total = 0;
+	for (i = 0; i < RING_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+		total += t[i].count;
+	}
+	ck_assert_int_eq(total, RING_VALUES);
+	ck_assert(ring_pop(&r) == NULL);
+
+	ring_destroy(&r);
+}
+END_TEST
+
+
+/* The trackers used to add each delta to every tracker, this is a copy of
+ * that implementation to compare the running sums against */
+struct ref_tracker {
+	struct device_float_coords delta;
+	uint64_t time;
+	uint32_t dir;
+};
+
+struct ref_trackers {
+	struct ref_tracker trackers[16];
+	unsigned int cur;
+	struct pointer_delta_smoothener *smoothener;
+};
+
+static void
+ref_trackers_feed(struct ref_trackers *t,
+		  const struct device_float_coords *delta,
+		  uint64_t time)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_LENGTH(t->trackers); i++) {
+		t->trackers[i].delta.x += delta->x;
+		t->trackers[i].delta.y += delta->y;
+	}
+
+	t->cur = (t->cur + 1) % ARRAY_LENGTH(t->trackers);
+	t->trackers[t->cur].delta.x = 0.0;
+	t->trackers[t->cur].delta.y = 0.0;
+	t->trackers[t->cur].time = time;
+	t->trackers[t->cur].dir = device_float_get_direction(*delta);
+}
+
+static double
+ref_velocity(struct ref_trackers *t, struct ref_tracker *tracker,
+	     uint64_t time)
+{
+	uint64_t tdelta = time - tracker->time + 1;
+
+	if (t->smoothener && tdelta < t->smoothener->threshold)
+		tdelta = t->smoothener->value;
+
+	return hypot(tracker->delta.x, tracker->delta.y) / (double)tdelta;
+}
+
+static double
+ref_trackers_velocity(struct ref_trackers *t, uint64_t time)
+{
+	const unsigned int n = ARRAY_LENGTH(t->trackers);
+	struct ref_tracker *tracker;
+	double velocity, result = 0.0, initial_velocity = 0.0;
+	unsigned int offset;
+	uint32_t dir = t->trackers[t->cur].dir;
+
+	for (offset = 1; offset < n; offset++) {
+		tracker = &t->trackers[(t->cur + n - offset) % n];
+
+		if (tracker->time > time)
+			break;
+
+		if (time - tracker->time > ms2us(1000)) {
+			if (offset == 1)
+				result = ref_velocity(t, tracker,
+						      tracker->time + ms2us(1000));
+			break;
+		}
+
+		velocity = ref_velocity(t, tracker, time);
+
+		dir &= tracker->dir;
+		if (dir == 0) {
+			if (offset == 1)
+				result = velocity;
+			break;
+		}
+
+		if (initial_velocity == 0.0 || offset <= 2) {
+			result = initial_velocity = velocity;
+		} else {
+			if (fabs(initial_velocity - velocity) > v_ms2us(1))
+				break;
+			result = velocity;
+		}
+	}
+
+	return result;
+}
+
+START_TEST(trackers_velocity_test)
+{
+	struct pointer_delta_smoothener smoothener = {
+		.threshold = ms2us(10),
+		.value = ms2us(10),
+	};
+	bool fractional = _i & 0x1;
+	bool smooth = _i & 0x2;
+	struct pointer_trackers trackers;
+	struct ref_trackers ref = {0};
+	uint64_t time = ms2us(5000);
+	uint32_t seed = 1;
+	int i;
+
+	trackers_init(&trackers, ARRAY_LENGTH(ref.trackers));
+	if (smooth) {
+		trackers.smoothener = smoothener;
+		ref.smoothener = &smoothener;
+	}
+
+	for (i = 0; i < 20000; i++) {
+		struct device_float_coords delta;
+		double v, expected;
+
+		seed = seed * 1103515245 + 12345;
+		delta.x = (int)((seed >> 16) % 21) - 10;
+		seed = seed * 1103515245 + 12345;
+		delta.y = (int)((seed >> 16) % 21) - 10;
+		if (fractional) {
+			delta.x *= 1.37;
+			delta.y *= 0.61;
+		}
+
+		/* long stretches like a real pointer moving one way,
+		 * these run the sums up far enough to get rebased */
+		if (i % 1000 < 500)
+			delta.x += 4000;
+
+		seed = seed * 1103515245 + 12345;
+		if ((seed >> 16) % 500 == 0)
+			time += ms2us(1500);
+		else
+			time += (seed >> 16) % 15000;
+
+		trackers_feed(&trackers, &delta, time);
+		ref_trackers_feed(&ref, &delta, time);
+
+		v = trackers_velocity(&trackers, time);
+		expected = ref_trackers_velocity(&ref, time);
+		if (fractional)
+			ck_assert_double_eq_tol(v, expected,
+						1e-12 + 1e-9 * expected);
+		else
+			ck_assert(v == expected);
+	}
+
+}
+END_TEST
+
+START_TEST(filter_copy_history_test)
+{
+	struct motion_filter *old, *new;
+	struct device_float_coords delta = { 3, 1 };
+	uint64_t time = ms2us(5000);
+	double points[] = { 0.0, 1.0 };
+	int i;
+
+	old = create_pointer_accelerator_filter_linear(1000, true);
+	for (i = 0; i < 20; i++) {
+		time += ms2us(8);
+		filter_dispatch(old, &delta, NULL, time);
+	}
+
+	new = create_pointer_accelerator_filter_custom(1000, true,
+						       1.0, points, 2);
+	ck_assert_double_eq(trackers_velocity(new->trackers, time), 0.0);
+
+	filter_copy_history(new, old);
+	ck_assert(trackers_velocity(new->trackers, time) ==
+		  trackers_velocity(old->trackers, time));
+
+	/* and history keeps going in the new filter */
+	time += ms2us(8);
+	filter_dispatch(old, &delta, NULL, time);
+	filter_dispatch(new, &delta, NULL, time);
+	ck_assert(trackers_velocity(new->trackers, time) ==
+		  trackers_velocity(old->trackers, time));
+
+	/* flat has no history, nothing to copy */
+	filter_destroy(new);
+	new = create_pointer_accelerator_filter_flat(1000);
+	filter_copy_history(new, old);
+	filter_copy_history(old, new);
+
+	filter_destroy(new);
+	filter_destroy(old);
+}
+END_TEST
+
+START_TEST(filter_copy_history_units)
+{
+	struct motion_filter *low_dpi, *adaptive, *trackpoint;
+	struct device_float_coords delta = { 3, 1 };
+	uint64_t time = ms2us(5000);
+	double v_low, v_adaptive;
+	int i;
+
+	/* low-dpi works in device units, the mouse filter in normalized
+	 * units: the same motion is 1000/400 times faster in the latter */
+	low_dpi = create_pointer_accelerator_filter_linear_low_dpi(400, true);
+	adaptive = create_pointer_accelerator_filter_linear(400, true);
+	for (i = 0; i < 20; i++) {
+		time += ms2us(8);
+		filter_dispatch(low_dpi, &delta, NULL, time);
+	}
+
+	filter_copy_history(adaptive, low_dpi);
+	v_low = trackers_velocity(low_dpi->trackers, time);
+	v_adaptive = trackers_velocity(adaptive->trackers, time);
+	ck_assert_double_gt(v_low, 0.0);
+	ck_assert_double_eq_tol(v_adaptive, v_low * 1000/400.0, 1e-9);
+
+	/* mid-motion, the next event doesn't see a spike */
+	time += ms2us(8);
+	filter_dispatch(low_dpi, &delta, NULL, time);
+	filter_dispatch(adaptive, &delta, NULL, time);
+	v_low = trackers_velocity(low_dpi->trackers, time);
+	v_adaptive = trackers_velocity(adaptive->trackers, time);
+	ck_assert_double_eq_tol(v_adaptive, v_low * 1000/400.0, 1e-9);
+
+	/* and back */
+	filter_destroy(low_dpi);
+	low_dpi = create_pointer_accelerator_filter_linear_low_dpi(400, true);
+	filter_copy_history(low_dpi, adaptive);
+	ck_assert_double_eq_tol(trackers_velocity(low_dpi->trackers, time),
+				v_low, 1e-9);
+
+	/* trackpoint units can't be converted, nothing is copied */
+	trackpoint = create_pointer_accelerator_filter_trackpoint(1.0, true);
+	filter_copy_history(trackpoint, adaptive);
+	ck_assert_double_eq(trackers_velocity(trackpoint->trackers, time), 0.0);
+
+	filter_destroy(trackpoint);
+	filter_destroy(adaptive);
+	filter_destroy(low_dpi);
+}
+END_TEST
+
 struct atoi_test {
 	char *str;
 	bool success;
@@ -934,6 +1514,24 @@ START_TEST(safe_atod_test)
 }
 END_TEST
 
+START_TEST(safe_atod_list_test)
+{
+	double values[4];
+
+	ck_assert_int_eq(safe_atod_list("1 2.5  -3", " ", values, 4), 3);
+	ck_assert(values[0] == 1.0);
+	ck_assert(values[1] == 2.5);
+	ck_assert(values[2] == -3.0);
+
+	ck_assert_int_eq(safe_atod_list("1;2;3;4;5", ";", values, 4), 4);
+	ck_assert(values[3] == 4.0);
+
+	ck_assert_int_eq(safe_atod_list("", " ", values, 4), 0);
+	ck_assert_int_eq(safe_atod_list("1 x 3", " ", values, 4), -1);
+	ck_assert_int_eq(safe_atod_list("1 NAN", " ", values, 4), -1);
+}
+END_TEST
+
 START_TEST(strsplit_test)
 {
 	struct strsplit_test {
@@ -1186,8 +1784,10 @@ litest_utils_suite(void)
 	tc = tcase_create("utils");
 
 	tcase_add_test(tc, bitfield_helpers);
+	tcase_add_test(tc, bitfield_for_each_set);
 	tcase_add_test(tc, matrix_helpers);
 	tcase_add_test(tc, ratelimit_helpers);
+	tcase_add_test(tc, ratelimit_helpers_time);
 	tcase_add_test(tc, dpi_parser);
 	tcase_add_test(tc, wheel_click_parser);
 	tcase_add_test(tc, wheel_click_count_parser);
@@ -1204,12 +1804,22 @@ litest_utils_suite(void)
 	tcase_add_test(tc, safe_atou_base_16_test);
 	tcase_add_test(tc, safe_atou_base_8_test);
 	tcase_add_test(tc, safe_atod_test);
+	tcase_add_test(tc, safe_atod_list_test);
 	tcase_add_test(tc, strsplit_test);
 	tcase_add_test(tc, kvsplit_double_test);
 	tcase_add_test(tc, strjoin_test);
 	tcase_add_test(tc, strstrip_test);
 	tcase_add_test(tc, time_conversion);
 	tcase_add_test(tc, human_time);
+	tcase_add_test(tc, histogram_test);
+	tcase_add_test(tc, arena_test);
+	tcase_add_test(tc, ptr_array_test);
+	tcase_add_test(tc, ring_test);
+	tcase_add_test(tc, ring_shared_test);
+	tcase_add_test(tc, key_count_test);
+	tcase_add_loop_test(tc, trackers_velocity_test, 0, 4);
+	tcase_add_test(tc, filter_copy_history_test);
+	tcase_add_test(tc, filter_copy_history_units);
 
 	tcase_add_test(tc, list_test_insert);
 	tcase_add_test(tc, list_test_append);
@@ -0,0 +1,578 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Measures the relative motion between touch events (based on slots) */
+
+#include "config.h"
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "shared.h"
+#include "recording.h"
+#include "util-macros.h"
+#include "util-strings.h"
+
+#define SLOT_WIDTH 16
+
+enum slot_state {
+	SLOT_STATE_NONE,
+	SLOT_STATE_BEGIN,
+	SLOT_STATE_UPDATE,
+	SLOT_STATE_END,
+};
+
+struct slot {
+	enum slot_state state;
+	int x, y;
+	int dx, dy;
+	bool used;
+	bool dirty;
+};
+
+/* In order of precedence for the tool column */
+static const struct {
+	unsigned int code;
+	const char *name;
+} tools[] = {
+	{ BTN_TOOL_QUINTTAP, "QIN" },
+	{ BTN_TOOL_QUADTAP, "QAD" },
+	{ BTN_TOOL_TRIPLETAP, "TRI" },
+	{ BTN_TOOL_DOUBLETAP, "DBL" },
+	{ BTN_TOUCH, "TOU" },
+};
+
+/* One output line, reused for every frame */
+struct line {
+	char *buf;
+	size_t len;
+	size_t sz;
+	bool have_data;
+	bool filtered;
+};
+
+struct context {
+	bool use_mm;
+	bool use_st;
+	bool use_absolute;
+	bool have_threshold;
+	double threshold;
+	bool have_ignore_below;
+	double ignore_below;
+	const char *color_red;
+	const char *color_reset;
+
+	bool initialized;
+	bool failed;
+	struct slot *slots;
+	int nslots;
+	int slot; /* -1 after an out-of-range ABS_MT_SLOT */
+	double xres, yres;
+	int tool_bits[ARRAY_LENGTH(tools)];
+
+	bool have_last_time;
+	uint64_t last_time;
+	unsigned int nskipped_lines;
+
+	struct line line;
+};
+
+static void
+line_printf(struct line *l, const char *format, ...)
+{
+	va_list args;
+	int n;
+
+	while (true) {
+		va_start(args, format);
+		n = vsnprintf(l->buf + l->len, l->sz - l->len, format, args);
+		va_end(args);
+
+		if (n < 0)
+			abort();
+		if ((size_t)n < l->sz - l->len)
+			break;
+
+		l->sz = max(l->sz * 2, l->len + n + 1);
+		l->buf = realloc(l->buf, l->sz);
+		if (!l->buf)
+			abort();
+	}
+	l->len += n;
+}
+
+static bool
+device_has_code(struct recording_device *d,
+		unsigned int type,
+		unsigned int code)
+{
+	for (size_t i = 0; i < d->ncodes; i++) {
+		if (d->codes[i].type == type && d->codes[i].code == code)
+			return true;
+	}
+
+	return false;
+}
+
+static const char *
+direction(double dx, double dy)
+{
+	static const char *directions[] = {
+		"↖↑", "↖←", "↙←", "↙↓", "↓↘", "→↘", "→↗", "↑↗",
+	};
+
+	if (dx != 0 && dy != 0) {
+		double t = atan2(dx, dy) + M_PI; /* in [0, 2pi] range now */
+		int idx;
+
+		t = t * 180.0 / M_PI;
+		idx = min((int)(t / 45), (int)ARRAY_LENGTH(directions) - 1);
+		return directions[idx];
+	}
+
+	if (dy == 0)
+		return dx < 0 ? "←←" : "→→";
+
+	return dy < 0 ? "↑↑" : "↓↓";
+}
+
+static void
+format_slot(struct context *ctx, struct slot *slot)
+{
+	struct line *l = &ctx->line;
+	const char *color = "",
+		   *reset = "";
+	const char *dir;
+	double dx, dy;
+	char values[64];
+	int pad;
+
+	if (slot->state == SLOT_STATE_BEGIN) {
+		line_printf(l, "    +++++++     ");
+		l->have_data = true;
+		return;
+	}
+
+	if (slot->state == SLOT_STATE_END) {
+		line_printf(l, "    -------     ");
+		l->have_data = true;
+		return;
+	}
+
+	if (slot->state == SLOT_STATE_NONE) {
+		line_printf(l, " ************** ");
+		return;
+	}
+
+	if (!slot->dirty) {
+		line_printf(l, "%*s", SLOT_WIDTH, "");
+		return;
+	}
+
+	dx = slot->dx;
+	dy = slot->dy;
+	if (ctx->use_mm) {
+		dx /= ctx->xres;
+		dy /= ctx->yres;
+	}
+	dir = direction(dx, dy);
+
+	if (!ctx->use_absolute) {
+		if (ctx->have_ignore_below || ctx->have_threshold) {
+			double dist = hypot(dx, dy);
+
+			if (ctx->have_ignore_below &&
+			    dist < ctx->ignore_below) {
+				line_printf(l, "%*s", SLOT_WIDTH, "");
+				l->filtered = true;
+				return;
+			}
+			if (ctx->have_threshold && dist >= ctx->threshold) {
+				color = ctx->color_red;
+				reset = ctx->color_reset;
+			}
+		}
+
+		if (ctx->use_mm)
+			snprintf(values, sizeof(values), "%+3.2f/%+03.2f", dx, dy);
+		else
+			snprintf(values, sizeof(values), "%+4d/%+4d", slot->dx, slot->dy);
+	} else {
+		snprintf(values, sizeof(values), "%4d/%4d", slot->x, slot->y);
+	}
+
+	/* The direction is two characters wide but not two bytes */
+	pad = max(SLOT_WIDTH - 3 - (int)strlen(values), 0);
+	line_printf(l, "%s %s%s%s%*s", dir, color, values, reset, pad, "");
+	l->have_data = true;
+}
+
+static void
+print_frame(struct context *ctx, uint64_t time)
+{
+	struct line *l = &ctx->line;
+	const char *tool_state = "   ";
+	int64_t tdelta = 0;
+	bool first = true;
+
+	if (ctx->have_last_time)
+		tdelta = (int64_t)(time - ctx->last_time) / 1000; /* ms */
+	ctx->have_last_time = true;
+	ctx->last_time = time;
+
+	for (size_t i = 0; i < ARRAY_LENGTH(tools); i++) {
+		if (ctx->tool_bits[i]) {
+			tool_state = tools[i].name;
+			break;
+		}
+	}
+
+	l->len = 0;
+	l->have_data = false;
+	l->filtered = false;
+	line_printf(l, "%s", "");
+
+	for (int i = 0; i < ctx->nslots; i++) {
+		struct slot *s = &ctx->slots[i];
+
+		if (!s->used)
+			continue;
+
+		if (!first)
+			line_printf(l, " | ");
+		first = false;
+
+		format_slot(ctx, s);
+
+		s->dirty = false;
+		s->dx = 0;
+		s->dy = 0;
+		if (s->state == SLOT_STATE_BEGIN)
+			s->state = SLOT_STATE_UPDATE;
+		else if (s->state == SLOT_STATE_END)
+			s->state = SLOT_STATE_NONE;
+	}
+
+	if (l->have_data) {
+		if (ctx->nskipped_lines > 0) {
+			printf("\n");
+			ctx->nskipped_lines = 0;
+		}
+		printf("%2" PRIu64 ".%06" PRIu64 " %+5" PRId64 "ms %s: %s\n",
+		       time / 1000000,
+		       time % 1000000,
+		       tdelta,
+		       tool_state,
+		       l->buf);
+	} else if (l->filtered) {
+		ctx->nskipped_lines++;
+		printf("\r%23s... %u below threshold", "", ctx->nskipped_lines);
+		fflush(stdout);
+	}
+}
+
+static inline void
+slot_set_begin(struct slot *s, int value)
+{
+	s->dirty = true;
+	s->state = value ? SLOT_STATE_BEGIN : SLOT_STATE_END;
+}
+
+static inline void
+slot_set_x(struct slot *s, int value)
+{
+	if (s->state == SLOT_STATE_UPDATE)
+		s->dx = value - s->x;
+	s->x = value;
+	s->dirty = true;
+}
+
+static inline void
+slot_set_y(struct slot *s, int value)
+{
+	if (s->state == SLOT_STATE_UPDATE)
+		s->dy = value - s->y;
+	s->y = value;
+	s->dirty = true;
+}
+
+static void
+process_event_st(struct context *ctx, const struct recording_event *e)
+{
+	struct slot *s;
+
+	/* Note: this relies on the EV_KEY events to come in before the
+	 * x/y events, otherwise the last/first event in each slot will
+	 * be wrong. */
+	if (e->type == EV_KEY &&
+	    (e->code == BTN_TOOL_FINGER || e->code == BTN_TOOL_PEN)) {
+		ctx->slot = 0;
+		slot_set_begin(&ctx->slots[ctx->slot], e->value);
+		return;
+	}
+
+	if (e->type == EV_KEY && e->code == BTN_TOOL_DOUBLETAP) {
+		if (ctx->nslots > 1)
+			ctx->slot = 1;
+		slot_set_begin(&ctx->slots[ctx->slot], e->value);
+		return;
+	}
+
+	if (e->type != EV_ABS)
+		return;
+
+	s = &ctx->slots[ctx->slot];
+	if (e->code == ABS_X)
+		slot_set_x(s, e->value);
+	else if (e->code == ABS_Y)
+		slot_set_y(s, e->value);
+}
+
+static void
+process_event_mt(struct context *ctx, const struct recording_event *e)
+{
+	struct slot *s;
+
+	if (e->type != EV_ABS)
+		return;
+
+	if (e->code == ABS_MT_SLOT) {
+		if (e->value < 0 || e->value >= ctx->nslots) {
+			ctx->slot = -1;
+			return;
+		}
+
+		ctx->slot = e->value;
+		ctx->slots[ctx->slot].dirty = true;
+		/* bcm5974 cycles through slot numbers, so let's say all
+		 * below our current slot number was used */
+		for (int i = 0; i <= ctx->slot; i++)
+			ctx->slots[i].used = true;
+		return;
+	}
+
+	if (ctx->slot < 0)
+		return;
+
+	s = &ctx->slots[ctx->slot];
+	switch (e->code) {
+	case ABS_MT_TRACKING_ID:
+		if (e->value == -1) {
+			s->state = SLOT_STATE_END;
+		} else {
+			s->state = SLOT_STATE_BEGIN;
+			s->dx = 0;
+			s->dy = 0;
+		}
+		s->dirty = true;
+		break;
+	case ABS_MT_POSITION_X:
+		slot_set_x(s, e->value);
+		break;
+	case ABS_MT_POSITION_Y:
+		slot_set_y(s, e->value);
+		break;
+	}
+}
+
+static bool
+setup(struct context *ctx, struct recording_device *d)
+{
+	ctx->initialized = true;
+
+	if (!device_has_code(d, EV_ABS, ABS_MT_SLOT))
+		ctx->use_st = true;
+
+	ctx->nslots = ctx->use_st ? 1 : max(d->absinfo[ABS_MT_SLOT].maximum + 1, 1);
+	ctx->slots = zalloc(ctx->nslots * sizeof(*ctx->slots));
+	ctx->slots[0].used = true;
+
+	if (ctx->use_mm) {
+		ctx->xres = d->absinfo[ABS_X].resolution;
+		ctx->yres = d->absinfo[ABS_Y].resolution;
+		if (ctx->xres == 0 || ctx->yres == 0) {
+			printf("Error: device doesn't have a resolution, cannot use mm\n");
+			ctx->failed = true;
+			return false;
+		}
+	}
+
+	if (ctx->use_st)
+		printf("Warning: slot coordinates on FINGER/DOUBLETAP change may be incorrect\n");
+
+	return true;
+}
+
+static bool
+handle_frame(struct recording *recording,
+	     const struct recording_frame *frame,
+	     const struct recording_event *events,
+	     void *userdata)
+{
+	struct context *ctx = userdata;
+
+	/* Only the first device is analyzed */
+	if (frame->device != 0)
+		return true;
+
+	if (!ctx->initialized && !setup(ctx, &recording->devices[0]))
+		return false;
+
+	for (size_t i = 0; i < frame->nevents; i++) {
+		const struct recording_event *e = &events[i];
+
+		if (e->type == EV_KEY) {
+			for (size_t t = 0; t < ARRAY_LENGTH(tools); t++) {
+				if (tools[t].code == e->code)
+					ctx->tool_bits[t] = e->value;
+			}
+		}
+
+		if (ctx->use_st)
+			process_event_st(ctx, e);
+		else
+			process_event_mt(ctx, e);
+
+		if (e->type == EV_SYN && e->code == SYN_REPORT)
+			print_frame(ctx, frame->time);
+	}
+
+	return true;
+}
+
+static void
+usage(void)
+{
+	printf("Usage: libinput analyze per-slot-delta [--help] [options] recording\n"
+	       "\n"
+	       "Measure delta between event frames for each slot of a recording made\n"
+	       "by libinput record.\n"
+	       "\n"
+	       "Options:\n"
+	       "  --use-mm ............. use mm instead of device deltas\n"
+	       "  --use-st ............. use ABS_X/ABS_Y instead of ABS_MT_POSITION_X/Y\n"
+	       "  --use-absolute ....... use absolute coordinates, not deltas\n"
+	       "  --threshold=<t> ...... mark any delta above this threshold\n"
+	       "  --ignore-below=<t> ... ignore any delta below this threshold\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	struct context ctx = {
+		.color_red = "\x1b[6;31m",
+		.color_reset = "\x1b[0m",
+		.slot = 0,
+	};
+	struct recording *recording;
+	int rc = EXIT_FAILURE;
+
+	while (1) {
+		int c;
+		int option_index = 0;
+		enum {
+			OPT_USE_MM = 1,
+			OPT_USE_ST,
+			OPT_USE_ABSOLUTE,
+			OPT_THRESHOLD,
+			OPT_IGNORE_BELOW,
+		};
+		static struct option opts[] = {
+			{ "help",         no_argument,       0, 'h' },
+			{ "use-mm",       no_argument,       0, OPT_USE_MM },
+			{ "use-st",       no_argument,       0, OPT_USE_ST },
+			{ "use-absolute", no_argument,       0, OPT_USE_ABSOLUTE },
+			{ "threshold",    required_argument, 0, OPT_THRESHOLD },
+			{ "ignore-below", required_argument, 0, OPT_IGNORE_BELOW },
+			{ 0, 0, 0, 0 },
+		};
+
+		c = getopt_long(argc, argv, "h", opts, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			usage();
+			return EXIT_SUCCESS;
+		case OPT_USE_MM:
+			ctx.use_mm = true;
+			break;
+		case OPT_USE_ST:
+			ctx.use_st = true;
+			break;
+		case OPT_USE_ABSOLUTE:
+			ctx.use_absolute = true;
+			break;
+		case OPT_THRESHOLD:
+			if (!safe_atod(optarg, &ctx.threshold)) {
+				usage();
+				return EXIT_INVALID_USAGE;
+			}
+			ctx.have_threshold = true;
+			break;
+		case OPT_IGNORE_BELOW:
+			if (!safe_atod(optarg, &ctx.ignore_below)) {
+				usage();
+				return EXIT_INVALID_USAGE;
+			}
+			ctx.have_ignore_below = true;
+			break;
+		default:
+			usage();
+			return EXIT_INVALID_USAGE;
+		}
+	}
+
+	if (optind != argc - 1) {
+		usage();
+		return EXIT_INVALID_USAGE;
+	}
+
+	if (!isatty(STDOUT_FILENO)) {
+		ctx.color_red = "";
+		ctx.color_reset = "";
+	}
+
+	recording = recording_stream(argv[optind], handle_frame, &ctx);
+	if (!recording)
+		goto out;
+
+	if (!ctx.initialized)
+		setup(&ctx, &recording->devices[0]);
+
+	if (!ctx.failed)
+		rc = EXIT_SUCCESS;
+
+	recording_free(recording);
+out:
+	free(ctx.slots);
+	free(ctx.line.buf);
+
+	return rc;
+}
@@ -0,0 +1,479 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <libevdev/libevdev.h>
+#include <libevdev/libevdev-uinput.h>
+#include <libinput.h>
+
+#include "shared.h"
+#include "recording.h"
+#include "util-macros.h"
+#include "util-strings.h"
+#include "util-time.h"
+
+/* The window for the peak event count, roughly one frame of a 100Hz
+ * compositor */
+#define PEAK_WINDOW_US ms2us(10)
+
+/* libinput event types are grouped by the hundreds */
+static const char *libinput_event_groups[] = {
+	[LIBINPUT_EVENT_KEYBOARD_KEY / 100] = "keyboard",
+	[LIBINPUT_EVENT_POINTER_MOTION / 100] = "pointer",
+	[LIBINPUT_EVENT_TOUCH_DOWN / 100] = "touch",
+	[LIBINPUT_EVENT_TABLET_TOOL_AXIS / 100] = "tablet-tool",
+	[LIBINPUT_EVENT_TABLET_PAD_BUTTON / 100] = "tablet-pad",
+	[LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN / 100] = "gesture",
+	[LIBINPUT_EVENT_SWITCH_TOGGLE / 100] = "switch",
+};
+
+struct device_stats {
+	uint64_t duration; /* µs */
+	size_t nframes;
+	size_t nevents; /* excluding SYN_REPORT */
+	size_t nsyn_reports;
+	size_t nsyn_dropped;
+	size_t types[EV_CNT];
+
+	uint64_t *intervals; /* within a burst, µs */
+	size_t nintervals;
+	size_t *events_per_report;
+	size_t nreports;
+
+	size_t nbursts;
+	size_t *burst_frames;
+	uint64_t burst_max_duration;
+	size_t peak_events;
+
+	bool replayed;
+	size_t libinput_events;
+	size_t libinput_groups[ARRAY_LENGTH(libinput_event_groups)];
+};
+
+static int
+cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a,
+		 y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int
+cmp_size(const void *a, const void *b)
+{
+	size_t x = *(const size_t *)a,
+	       y = *(const size_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static inline double
+ratio(double a, double b)
+{
+	return b != 0.0 ? a / b : 0.0;
+}
+
+static void
+analyze_device(struct recording_device *d,
+	       struct device_stats *s,
+	       uint64_t idle_threshold)
+{
+	size_t events_in_report = 0;
+	size_t burst_start = 0;
+	size_t window_start = 0, window_events = 0;
+
+	s->nframes = d->nframes;
+	if (d->nframes == 0)
+		return;
+
+	s->duration = d->frames[d->nframes - 1].time - d->frames[0].time;
+	s->intervals = zalloc(d->nframes * sizeof(*s->intervals));
+	s->burst_frames = zalloc(d->nframes * sizeof(*s->burst_frames));
+	/* every event may be a SYN_REPORT, plus a trailing partial one */
+	s->events_per_report = zalloc((d->nevents + 1) * sizeof(*s->events_per_report));
+
+	for (size_t f = 0; f < d->nframes; f++) {
+		struct recording_frame *frame = &d->frames[f];
+		size_t frame_events = 0;
+
+		for (size_t e = 0; e < frame->nevents; e++) {
+			struct recording_event *ev = &d->events[frame->first_event + e];
+
+			if (ev->type == EV_SYN && ev->code == SYN_REPORT) {
+				s->events_per_report[s->nreports++] = events_in_report;
+				s->nsyn_reports++;
+				events_in_report = 0;
+				continue;
+			}
+
+			if (ev->type == EV_SYN && ev->code == SYN_DROPPED)
+				s->nsyn_dropped++;
+
+			if (ev->type < EV_CNT)
+				s->types[ev->type]++;
+			s->nevents++;
+			events_in_report++;
+			frame_events++;
+		}
+
+		/* Bursts are frames with less than the idle threshold
+		 * between them, the intervals between bursts are idle time
+		 * and not part of the jitter */
+		if (f > 0) {
+			uint64_t dt = frame->time - d->frames[f - 1].time;
+
+			if (dt > idle_threshold) {
+				s->burst_frames[s->nbursts++] = f - burst_start;
+				s->burst_max_duration = max(s->burst_max_duration,
+							    d->frames[f - 1].time - d->frames[burst_start].time);
+				burst_start = f;
+			} else {
+				s->intervals[s->nintervals++] = dt;
+			}
+		}
+
+		/* Sliding window for the peak number of events */
+		window_events += frame_events;
+		while (frame->time - d->frames[window_start].time >= PEAK_WINDOW_US) {
+			struct recording_frame *old = &d->frames[window_start++];
+
+			for (size_t e = 0; e < old->nevents; e++) {
+				struct recording_event *ev = &d->events[old->first_event + e];
+
+				if (ev->type != EV_SYN || ev->code != SYN_REPORT)
+					window_events--;
+			}
+		}
+		s->peak_events = max(s->peak_events, window_events);
+	}
+
+	s->burst_frames[s->nbursts++] = d->nframes - burst_start;
+	s->burst_max_duration = max(s->burst_max_duration,
+				    d->frames[d->nframes - 1].time - d->frames[burst_start].time);
+
+	if (events_in_report > 0)
+		s->events_per_report[s->nreports++] = events_in_report;
+
+	qsort(s->intervals, s->nintervals, sizeof(*s->intervals), cmp_u64);
+	qsort(s->burst_frames, s->nbursts, sizeof(*s->burst_frames), cmp_size);
+	qsort(s->events_per_report, s->nreports, sizeof(*s->events_per_report), cmp_size);
+}
+
+static size_t
+drain_events(struct libinput *li,
+	     struct libinput_device **devices,
+	     struct device_stats *stats,
+	     size_t ndevices)
+{
+	struct libinput_event *event;
+	size_t count = 0;
+
+	while ((event = libinput_get_event(li))) {
+		struct libinput_device *device = libinput_event_get_device(event);
+		unsigned int group = libinput_event_get_type(event) / 100;
+
+		for (size_t i = 0; i < ndevices; i++) {
+			if (devices[i] != device)
+				continue;
+
+			stats[i].libinput_events++;
+			if (group < ARRAY_LENGTH(libinput_event_groups))
+				stats[i].libinput_groups[group]++;
+		}
+
+		libinput_event_destroy(event);
+		count++;
+	}
+
+	return count;
+}
+
+/* Push the recording through a libinput replay context and count the
+ * libinput events per device */
+static bool
+replay_recording(struct recording *r, struct device_stats *stats)
+{
+	struct libevdev_uinput **uinputs;
+	struct libinput_device **devices = NULL;
+	struct libinput *li = NULL;
+	struct recording_frame **timeline;
+	size_t nframes;
+	uint64_t base, t0, time = 0;
+	bool rc = false;
+
+	timeline = recording_build_timeline(r, &nframes);
+	uinputs = zalloc(r->ndevices * sizeof(*uinputs));
+	if (nframes == 0)
+		goto out;
+
+	for (size_t i = 0; i < r->ndevices; i++) {
+		uinputs[i] = recording_device_create_uinput(&r->devices[i]);
+		if (!uinputs[i])
+			goto out;
+	}
+
+	li = recording_create_replay_context(r, uinputs, false, &devices);
+	if (!li)
+		goto out;
+
+	t0 = timeline[0]->time;
+	base = now_in_us();
+	for (size_t i = 0; i < nframes; i++) {
+		struct recording_frame *frame = timeline[i];
+		struct recording_device *d = &r->devices[frame->device];
+		struct libinput_device *device = devices[frame->device];
+
+		if (!device)
+			continue;
+
+		time = base + frame->time - t0;
+		for (size_t e = 0; e < frame->nevents; e++) {
+			struct recording_event *ev = &d->events[frame->first_event + e];
+
+			libinput_replay_device_push_event(device,
+							  time,
+							  ev->type,
+							  ev->code,
+							  ev->value);
+		}
+		drain_events(li, devices, stats, r->ndevices);
+	}
+
+	/* Let the timeouts expire, e.g. a tap or a pending button release */
+	libinput_replay_advance_time(li, time + s2us(5));
+	drain_events(li, devices, stats, r->ndevices);
+
+	for (size_t i = 0; i < r->ndevices; i++)
+		stats[i].replayed = devices[i] != NULL;
+
+	rc = true;
+out:
+	if (devices) {
+		for (size_t i = 0; i < r->ndevices; i++) {
+			if (devices[i])
+				libinput_device_unref(devices[i]);
+		}
+		free(devices);
+	}
+	if (li)
+		libinput_unref(li);
+	for (size_t i = 0; i < r->ndevices; i++) {
+		if (uinputs[i])
+			libevdev_uinput_destroy(uinputs[i]);
+	}
+	free(uinputs);
+	free(timeline);
+
+	return rc;
+}
+
+#define percentile(a_, n_, p_) ((a_)[((n_) - 1) * (p_) / 100])
+
+static void
+print_device(struct recording_device *d, struct device_stats *s)
+{
+	double seconds = s->duration / 1e6;
+	double mean = 0.0, variance = 0.0;
+
+	printf("%s: %s\n", d->node ? d->node : "unknown", d->name ? d->name : "unknown");
+
+	if (s->nframes == 0) {
+		printf("  no events\n\n");
+		return;
+	}
+
+	printf("  duration:           %.3fs\n", seconds);
+	printf("  frames:             %zd (%.1f/s)\n",
+	       s->nframes, ratio(s->nframes, seconds));
+	printf("  events:             %zd (%.1f/s)\n",
+	       s->nevents, ratio(s->nevents, seconds));
+
+	printf("  event types:\n");
+	for (unsigned int t = 0; t < EV_CNT; t++) {
+		if (t == EV_SYN || s->types[t] == 0)
+			continue;
+
+		printf("    %-17s %zd (%.1f/s)\n",
+		       libevdev_event_type_get_name(t),
+		       s->types[t],
+		       ratio(s->types[t], seconds));
+	}
+
+	printf("  SYN_REPORT:         %zd\n", s->nsyn_reports);
+	if (s->nreports > 0) {
+		printf("  events/SYN_REPORT:  mean %.2f, p50 %zd, p99 %zd, max %zd\n",
+		       ratio(s->nevents, s->nreports),
+		       percentile(s->events_per_report, s->nreports, 50),
+		       percentile(s->events_per_report, s->nreports, 99),
+		       s->events_per_report[s->nreports - 1]);
+	}
+	if (s->nsyn_dropped > 0)
+		printf("  SYN_DROPPED:        %zd\n", s->nsyn_dropped);
+
+	if (s->nintervals > 0) {
+		for (size_t i = 0; i < s->nintervals; i++)
+			mean += s->intervals[i];
+		mean /= s->nintervals;
+		for (size_t i = 0; i < s->nintervals; i++)
+			variance += (s->intervals[i] - mean) * (s->intervals[i] - mean);
+		variance /= s->nintervals;
+
+		printf("  frame interval:     mean %.2fms, p50 %.2fms, p99 %.2fms, max %.2fms\n",
+		       mean / 1000.0,
+		       percentile(s->intervals, s->nintervals, 50) / 1000.0,
+		       percentile(s->intervals, s->nintervals, 99) / 1000.0,
+		       s->intervals[s->nintervals - 1] / 1000.0);
+		printf("  jitter:             %.2fms stddev (%.1f%%)\n",
+		       sqrt(variance) / 1000.0,
+		       100.0 * ratio(sqrt(variance), mean));
+	}
+
+	printf("  bursts:             %zd, frames/burst p50 %zd, p99 %zd, max %zd, longest %.3fs\n",
+	       s->nbursts,
+	       percentile(s->burst_frames, s->nbursts, 50),
+	       percentile(s->burst_frames, s->nbursts, 99),
+	       s->burst_frames[s->nbursts - 1],
+	       s->burst_max_duration / 1e6);
+	printf("  peak events/%dms:   %zd\n",
+	       (int)us2ms(PEAK_WINDOW_US), s->peak_events);
+
+	if (s->replayed) {
+		printf("  libinput events:    %zd, %.2f per evdev event, %.2f per SYN_REPORT\n",
+		       s->libinput_events,
+		       ratio(s->libinput_events, s->nevents),
+		       ratio(s->libinput_events, s->nsyn_reports));
+		for (size_t g = 0; g < ARRAY_LENGTH(libinput_event_groups); g++) {
+			if (!libinput_event_groups[g] || s->libinput_groups[g] == 0)
+				continue;
+
+			printf("    %-17s %zd\n",
+			       libinput_event_groups[g],
+			       s->libinput_groups[g]);
+		}
+	}
+
+	printf("\n");
+}
+
+static void
+usage(void)
+{
+	printf("Usage: libinput analyze rates [--help] [--idle-threshold=<ms>] [--replay] recording\n"
+	       "\n"
+	       "Print event rates, burst sizes and frame timing of a recording made by\n"
+	       "libinput record.\n"
+	       "\n"
+	       "Options:\n"
+	       "  --idle-threshold=<ms> .. a longer gap between frames ends a burst (default: 50)\n"
+	       "  --replay ............... replay the recording through libinput to count the\n"
+	       "                           libinput events, this needs to run as root\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	struct recording *recording;
+	struct device_stats *stats;
+	unsigned int idle_threshold = 50;
+	bool replay = false;
+	int rc = EXIT_FAILURE;
+
+	while (1) {
+		int c;
+		int option_index = 0;
+		enum {
+			OPT_IDLE_THRESHOLD = 1,
+			OPT_REPLAY,
+		};
+		static struct option opts[] = {
+			{ "help",           no_argument,       0, 'h' },
+			{ "idle-threshold", required_argument, 0, OPT_IDLE_THRESHOLD },
+			{ "replay",         no_argument,       0, OPT_REPLAY },
+			{ 0, 0, 0, 0 },
+		};
+
+		c = getopt_long(argc, argv, "h", opts, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			usage();
+			return EXIT_SUCCESS;
+		case OPT_IDLE_THRESHOLD:
+			if (!safe_atou(optarg, &idle_threshold) ||
+			    idle_threshold == 0) {
+				usage();
+				return EXIT_INVALID_USAGE;
+			}
+			break;
+		case OPT_REPLAY:
+			replay = true;
+			break;
+		default:
+			usage();
+			return EXIT_INVALID_USAGE;
+		}
+	}
+
+	if (optind != argc - 1) {
+		usage();
+		return EXIT_INVALID_USAGE;
+	}
+
+	recording = recording_load(argv[optind]);
+	if (!recording)
+		return EXIT_FAILURE;
+
+	stats = zalloc(max(recording->ndevices, (size_t)1) * sizeof(*stats));
+	for (size_t i = 0; i < recording->ndevices; i++)
+		analyze_device(&recording->devices[i],
+			       &stats[i],
+			       ms2us(idle_threshold));
+
+	if (replay && !replay_recording(recording, stats)) {
+		fprintf(stderr, "Failed to replay the recording through libinput\n");
+		goto out;
+	}
+
+	for (size_t i = 0; i < recording->ndevices; i++)
+		print_device(&recording->devices[i], &stats[i]);
+
+	rc = EXIT_SUCCESS;
+out:
+	for (size_t i = 0; i < recording->ndevices; i++) {
+		free(stats[i].intervals);
+		free(stats[i].burst_frames);
+		free(stats[i].events_per_report);
+	}
+	free(stats);
+	recording_free(recording);
+
+	return rc;
+}
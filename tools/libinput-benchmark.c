@@ -0,0 +1,450 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <libevdev/libevdev-uinput.h>
+#include <libinput.h>
+
+#include "libinput-version.h"
+#include "libinput-git-version.h"
+#include "shared.h"
+#include "recording.h"
+#include "util-macros.h"
+#include "util-strings.h"
+#include "util-time.h"
+
+/* Counted in user space only, i.e. libinput and the tool but not the
+ * kernel. The cache misses show the effect of the struct layout, see
+ * struct evdev_device */
+static const struct {
+	uint32_t type;
+	uint64_t config;
+	const char *name;
+} counters[] = {
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES, "cache_references" },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "cache_misses" },
+	{ PERF_TYPE_HW_CACHE,
+	  PERF_COUNT_HW_CACHE_L1D |
+	  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+	  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+	  "l1d_read_misses" },
+};
+
+struct benchmark {
+	struct recording *recording;
+	struct libevdev_uinput **uinputs;
+	struct libinput *libinput;
+	struct libinput_device **devices;
+
+	struct recording_frame **timeline;
+	size_t nframes;
+
+	uint64_t clock; /* last replayed time in µs */
+	bool stages; /* profile the processing stages */
+
+	/* totals over all timed iterations */
+	uint64_t time; /* ns */
+	uint64_t frames;
+	uint64_t evdev_events;
+	uint64_t libinput_events;
+
+	/* hardware counters, -1 if not available */
+	int counter_fds[ARRAY_LENGTH(counters)];
+};
+
+
+static const struct {
+	enum libinput_profile_stage stage;
+	const char *name;
+} stages[] = {
+	{ LIBINPUT_PROFILE_STAGE_LIBEVDEV, "libevdev" },
+	{ LIBINPUT_PROFILE_STAGE_FALLBACK, "fallback" },
+	{ LIBINPUT_PROFILE_STAGE_TOUCHPAD, "touchpad" },
+	{ LIBINPUT_PROFILE_STAGE_TABLET, "tablet" },
+	{ LIBINPUT_PROFILE_STAGE_TABLET_PAD, "tablet-pad" },
+	{ LIBINPUT_PROFILE_STAGE_TOTEM, "totem" },
+	{ LIBINPUT_PROFILE_STAGE_FILTER, "filter" },
+	{ LIBINPUT_PROFILE_STAGE_TIMERS, "timers" },
+	{ LIBINPUT_PROFILE_STAGE_EVENT_QUEUE, "event-queue" },
+};
+
+static inline uint64_t
+now_in_ns(void)
+{
+	struct timespec ts = { 0, 0 };
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return s2us(ts.tv_sec) * 1000 + ts.tv_nsec;
+}
+
+static void
+counters_open(struct benchmark *b)
+{
+	for (size_t i = 0; i < ARRAY_LENGTH(counters); i++) {
+		struct perf_event_attr attr = {
+			.size = sizeof(attr),
+			.type = counters[i].type,
+			.config = counters[i].config,
+			.disabled = 1,
+			.exclude_kernel = 1,
+			.exclude_hv = 1,
+		};
+
+		b->counter_fds[i] = syscall(__NR_perf_event_open,
+					    &attr, 0, -1, -1, 0);
+	}
+}
+
+static void
+counters_enable(struct benchmark *b, bool enable)
+{
+	for (size_t i = 0; i < ARRAY_LENGTH(counters); i++) {
+		if (b->counter_fds[i] == -1)
+			continue;
+
+		ioctl(b->counter_fds[i],
+		      enable ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE,
+		      0);
+	}
+}
+
+static void
+counters_close(struct benchmark *b)
+{
+	for (size_t i = 0; i < ARRAY_LENGTH(counters); i++) {
+		if (b->counter_fds[i] != -1)
+			close(b->counter_fds[i]);
+		b->counter_fds[i] = -1;
+	}
+}
+
+static bool
+counters_available(struct benchmark *b)
+{
+	for (size_t i = 0; i < ARRAY_LENGTH(counters); i++) {
+		if (b->counter_fds[i] != -1)
+			return true;
+	}
+
+	return false;
+}
+
+static size_t
+drain_events(struct libinput *li)
+{
+	struct libinput_event *event;
+	size_t count = 0;
+
+	while ((event = libinput_get_event(li))) {
+		libinput_event_destroy(event);
+		count++;
+	}
+
+	return count;
+}
+
+/* Replay the whole recording as fast as possible. The replayed
+ * timestamps keep the recorded intervals so libinput's timers behave as
+ * they would in real time */
+static void
+run_once(struct benchmark *b)
+{
+	uint64_t begin, base, t0, time = 0;
+
+	t0 = b->timeline[0]->time;
+	base = max(now_in_us(), b->clock);
+
+	begin = now_in_ns();
+	for (size_t i = 0; i < b->nframes; i++) {
+		struct recording_frame *frame = b->timeline[i];
+		struct recording_device *d = &b->recording->devices[frame->device];
+		struct libinput_device *device = b->devices[frame->device];
+
+		if (!device)
+			continue;
+
+		time = base + frame->time - t0;
+		for (size_t e = 0; e < frame->nevents; e++) {
+			struct recording_event *ev = &d->events[frame->first_event + e];
+
+			libinput_replay_device_push_event(device,
+							  time,
+							  ev->type,
+							  ev->code,
+							  ev->value);
+		}
+
+		b->frames++;
+		b->evdev_events += frame->nevents;
+		b->libinput_events += drain_events(b->libinput);
+	}
+
+	/* Let the timeouts expire, e.g. a tap or a pending button release */
+	b->clock = time + s2us(5);
+	libinput_replay_advance_time(b->libinput, b->clock);
+	b->libinput_events += drain_events(b->libinput);
+
+	b->time += now_in_ns() - begin;
+}
+
+static inline double
+ratio(uint64_t a, uint64_t b)
+{
+	return b ? (double)a / b : 0.0;
+}
+
+static void
+print_json_string(const char *s)
+{
+	putchar('"');
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\')
+			printf("\\%c", *s);
+		else if ((unsigned char)*s < 0x20)
+			printf("\\u%04x", *s);
+		else
+			putchar(*s);
+	}
+	putchar('"');
+}
+
+static void
+print_json(struct benchmark *b, const char *path, unsigned int iterations)
+{
+	printf("{\n");
+	printf("  \"libinput\": \"%s\",\n", LIBINPUT_VERSION);
+	printf("  \"git\": \"%s\",\n", LIBINPUT_GIT_VERSION);
+	printf("  \"recording\": ");
+	print_json_string(path);
+	printf(",\n");
+	printf("  \"iterations\": %u,\n", iterations);
+	printf("  \"frames\": %" PRIu64 ",\n", b->frames);
+	printf("  \"evdev_events\": %" PRIu64 ",\n", b->evdev_events);
+	printf("  \"libinput_events\": %" PRIu64 ",\n", b->libinput_events);
+	printf("  \"time_ns\": %" PRIu64 ",\n", b->time);
+	printf("  \"evdev_events_per_sec\": %.0f,\n",
+	       ratio(b->evdev_events, b->time) * 1e9);
+	printf("  \"libinput_events_per_sec\": %.0f,\n",
+	       ratio(b->libinput_events, b->time) * 1e9);
+	printf("  \"ns_per_frame\": %.1f,\n", ratio(b->time, b->frames));
+	printf("  \"ns_per_libinput_event\": %.1f%s\n",
+	       ratio(b->time, b->libinput_events),
+	       b->stages || counters_available(b) ? "," : "");
+
+	if (counters_available(b)) {
+		bool first = true;
+
+		printf("  \"counters\": {\n");
+		for (size_t i = 0; i < ARRAY_LENGTH(counters); i++) {
+			uint64_t value;
+
+			if (b->counter_fds[i] == -1 ||
+			    read(b->counter_fds[i], &value, sizeof(value)) != sizeof(value))
+				continue;
+
+			printf("%s    \"%s\": { \"count\": %" PRIu64 ", \"per_frame\": %.2f }",
+			       first ? "" : ",\n",
+			       counters[i].name,
+			       value,
+			       ratio(value, b->frames));
+			first = false;
+		}
+		printf("\n  }%s\n", b->stages ? "," : "");
+	}
+
+	if (!b->stages)
+		goto out;
+
+	printf("  \"stages\": {\n");
+	for (size_t i = 0; i < ARRAY_LENGTH(stages); i++) {
+		uint64_t time = libinput_get_profile_time(b->libinput,
+							  stages[i].stage);
+		uint64_t count = libinput_get_profile_count(b->libinput,
+							    stages[i].stage);
+
+		printf("    \"%s\": { \"time_ns\": %" PRIu64 ", \"count\": %" PRIu64 ", \"share\": %.4f }%s\n",
+		       stages[i].name,
+		       time,
+		       count,
+		       ratio(time, b->time),
+		       i < ARRAY_LENGTH(stages) - 1 ? "," : "");
+	}
+	printf("  }\n");
+out:
+	printf("}\n");
+}
+
+static inline void
+usage(void)
+{
+	printf("Usage: libinput benchmark [--help] [--verbose] [--iterations=<count>] [--no-stages] recording\n"
+	       "\n"
+	       "Replay a recording made by libinput record through libinput as fast as\n"
+	       "possible and print the cost of each processing stage as JSON.\n"
+	       "\n"
+	       "Options:\n"
+	       "  --verbose ............. enable libinput's debug log\n"
+	       "  --iterations=<count> .. replay the recording count times (default: 10)\n"
+	       "  --no-stages ........... don't profile the processing stages\n");
+}
+
+enum options {
+	OPT_HELP,
+	OPT_VERBOSE,
+	OPT_ITERATIONS,
+	OPT_NO_STAGES,
+};
+
+int
+main(int argc, char **argv)
+{
+	struct benchmark b = {0};
+	struct option opts[] = {
+		{ "help", no_argument, 0, OPT_HELP },
+		{ "verbose", no_argument, 0, OPT_VERBOSE },
+		{ "iterations", required_argument, 0, OPT_ITERATIONS },
+		{ "no-stages", no_argument, 0, OPT_NO_STAGES },
+		{ 0, 0, 0, 0 },
+	};
+	unsigned int iterations = 10;
+	bool verbose = false;
+	int rc = EXIT_FAILURE;
+
+	b.stages = true;
+	for (size_t i = 0; i < ARRAY_LENGTH(b.counter_fds); i++)
+		b.counter_fds[i] = -1;
+
+	while (1) {
+		int c;
+		int option_index = 0;
+
+		c = getopt_long(argc, argv, "h", opts, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+		case OPT_HELP:
+			usage();
+			return EXIT_SUCCESS;
+		case OPT_VERBOSE:
+			verbose = true;
+			break;
+		case OPT_ITERATIONS:
+			if (!safe_atou(optarg, &iterations) || iterations == 0) {
+				usage();
+				return EXIT_INVALID_USAGE;
+			}
+			break;
+		case OPT_NO_STAGES:
+			b.stages = false;
+			break;
+		default:
+			usage();
+			return EXIT_INVALID_USAGE;
+		}
+	}
+
+	if (optind != argc - 1) {
+		usage();
+		return EXIT_INVALID_USAGE;
+	}
+
+	b.recording = recording_load(argv[optind]);
+	if (!b.recording)
+		return EXIT_FAILURE;
+
+	b.timeline = recording_build_timeline(b.recording, &b.nframes);
+	if (b.nframes == 0) {
+		fprintf(stderr, "Recording has no events\n");
+		goto out;
+	}
+
+	b.uinputs = zalloc(b.recording->ndevices * sizeof(*b.uinputs));
+	for (size_t i = 0; i < b.recording->ndevices; i++) {
+		b.uinputs[i] = recording_device_create_uinput(&b.recording->devices[i]);
+		if (!b.uinputs[i])
+			goto out;
+	}
+
+	b.libinput = recording_create_replay_context(b.recording,
+						     b.uinputs,
+						     verbose,
+						     &b.devices);
+	if (!b.libinput)
+		goto out;
+
+	/* One untimed run to warm up the caches and the event free-lists */
+	run_once(&b);
+	b.time = 0;
+	b.frames = 0;
+	b.evdev_events = 0;
+	b.libinput_events = 0;
+
+	counters_open(&b);
+
+	if (b.stages)
+		libinput_set_profiling(b.libinput, 1);
+	counters_enable(&b, true);
+	for (unsigned int i = 0; i < iterations; i++)
+		run_once(&b);
+	counters_enable(&b, false);
+	libinput_set_profiling(b.libinput, 0);
+
+	print_json(&b, argv[optind], iterations);
+
+	rc = EXIT_SUCCESS;
+out:
+	if (b.devices) {
+		for (size_t i = 0; i < b.recording->ndevices; i++) {
+			if (b.devices[i])
+				libinput_device_unref(b.devices[i]);
+		}
+		free(b.devices);
+	}
+	if (b.libinput)
+		libinput_unref(b.libinput);
+	if (b.uinputs) {
+		for (size_t i = 0; i < b.recording->ndevices; i++) {
+			if (b.uinputs[i])
+				libevdev_uinput_destroy(b.uinputs[i]);
+		}
+		free(b.uinputs);
+	}
+	counters_close(&b);
+	free(b.timeline);
+	recording_free(b.recording);
+
+	return rc;
+}
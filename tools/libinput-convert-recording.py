@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+# vim: set expandtab shiftwidth=4:
+# -*- Mode: python; coding: utf-8; indent-tabs-mode: nil -*- */
+#
+# Copyright © 2020 Red Hat, Inc.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# DEALINGS IN THE SOFTWARE.
+#
+#
+# Converts a libinput record file between the YAML and the binary format
+
+import argparse
+import sys
+
+try:
+    import yaml
+    import libinput_recording
+except ModuleNotFoundError as e:
+    print('Error: {}'.format(str(e)), file=sys.stderr)
+    print('One or more python modules are missing. Please install those '
+          'modules and re-run this tool.')
+    sys.exit(1)
+
+
+def main(args):
+    parser = argparse.ArgumentParser(description='Convert a libinput recording between the YAML and binary format')
+    parser.add_argument('input', metavar='recording',
+                        help='Path to a libinput record file')
+    parser.add_argument('output', metavar='output-file',
+                        help='Path to the converted file')
+    parser.add_argument('--format', choices=['yaml', 'binary'], default=None,
+                        help='Output format (default: the other format)')
+    args = parser.parse_args(args)
+
+    try:
+        binary = libinput_recording.is_binary(args.input)
+        recording = libinput_recording.load(args.input)
+    except (OSError, yaml.YAMLError, libinput_recording.RecordingException) as e:
+        print('Error: failed to load recording: {}'.format(e), file=sys.stderr)
+        sys.exit(1)
+
+    fmt = args.format or ('yaml' if binary else 'binary')
+    if fmt == 'binary':
+        dropped = any('libinput' in e
+                      for d in recording['devices']
+                      for e in d.get('events') or [])
+        if dropped:
+            print('Warning: libinput events are not supported in the binary format, skipping those',
+                  file=sys.stderr)
+
+        with open(args.output, 'wb') as f:
+            libinput_recording.write_binary(recording, f)
+    else:
+        with open(args.output, 'w') as f:
+            libinput_recording.write_yaml(recording, f)
+
+
+if __name__ == '__main__':
+    try:
+        main(sys.argv[1:])
+    except KeyboardInterrupt:
+        pass
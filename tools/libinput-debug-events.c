@@ -48,106 +48,95 @@ static const uint32_t screen_width = 100;
 static const uint32_t screen_height = 100;
 static struct tools_options options;
 static bool show_keycodes;
+static bool show_timer_stats;
+static bool show_startup_timing;
+static bool show_stats;
+static bool show_latency_audit;
+static bool flush_per_dispatch;
+static unsigned int log_ring_size;
 static volatile sig_atomic_t stop = 0;
 static bool be_quiet = false;
 
 #define printq(...) ({ if (!be_quiet)  printf(__VA_ARGS__); })
 
-static void
-print_event_header(struct libinput_event *ev)
+static const char *
+event_type_name(enum libinput_event_type type)
 {
-	/* use for pointer value only, do not dereference */
-	static void *last_device = NULL;
-	struct libinput_device *dev = libinput_event_get_device(ev);
-	const char *type = NULL;
-	char prefix;
-
-	switch(libinput_event_get_type(ev)) {
+	switch (type) {
 	case LIBINPUT_EVENT_NONE:
-		abort();
-	case LIBINPUT_EVENT_DEVICE_ADDED:
-		type = "DEVICE_ADDED";
 		break;
+	case LIBINPUT_EVENT_DEVICE_ADDED:
+		return "DEVICE_ADDED";
 	case LIBINPUT_EVENT_DEVICE_REMOVED:
-		type = "DEVICE_REMOVED";
-		break;
+		return "DEVICE_REMOVED";
 	case LIBINPUT_EVENT_KEYBOARD_KEY:
-		type = "KEYBOARD_KEY";
-		break;
+		return "KEYBOARD_KEY";
 	case LIBINPUT_EVENT_POINTER_MOTION:
-		type = "POINTER_MOTION";
-		break;
+		return "POINTER_MOTION";
 	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
-		type = "POINTER_MOTION_ABSOLUTE";
-		break;
+		return "POINTER_MOTION_ABSOLUTE";
 	case LIBINPUT_EVENT_POINTER_BUTTON:
-		type = "POINTER_BUTTON";
-		break;
+		return "POINTER_BUTTON";
 	case LIBINPUT_EVENT_POINTER_AXIS:
-		type = "POINTER_AXIS";
-		break;
+		return "POINTER_AXIS";
+	case LIBINPUT_EVENT_POINTER_FRAME:
+		return "POINTER_FRAME";
 	case LIBINPUT_EVENT_TOUCH_DOWN:
-		type = "TOUCH_DOWN";
-		break;
+		return "TOUCH_DOWN";
 	case LIBINPUT_EVENT_TOUCH_MOTION:
-		type = "TOUCH_MOTION";
-		break;
+		return "TOUCH_MOTION";
 	case LIBINPUT_EVENT_TOUCH_UP:
-		type = "TOUCH_UP";
-		break;
+		return "TOUCH_UP";
 	case LIBINPUT_EVENT_TOUCH_CANCEL:
-		type = "TOUCH_CANCEL";
-		break;
+		return "TOUCH_CANCEL";
 	case LIBINPUT_EVENT_TOUCH_FRAME:
-		type = "TOUCH_FRAME";
-		break;
+		return "TOUCH_FRAME";
 	case LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN:
-		type = "GESTURE_SWIPE_BEGIN";
-		break;
+		return "GESTURE_SWIPE_BEGIN";
 	case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE:
-		type = "GESTURE_SWIPE_UPDATE";
-		break;
+		return "GESTURE_SWIPE_UPDATE";
 	case LIBINPUT_EVENT_GESTURE_SWIPE_END:
-		type = "GESTURE_SWIPE_END";
-		break;
+		return "GESTURE_SWIPE_END";
 	case LIBINPUT_EVENT_GESTURE_PINCH_BEGIN:
-		type = "GESTURE_PINCH_BEGIN";
-		break;
+		return "GESTURE_PINCH_BEGIN";
 	case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:
-		type = "GESTURE_PINCH_UPDATE";
-		break;
+		return "GESTURE_PINCH_UPDATE";
 	case LIBINPUT_EVENT_GESTURE_PINCH_END:
-		type = "GESTURE_PINCH_END";
-		break;
+		return "GESTURE_PINCH_END";
 	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
-		type = "TABLET_TOOL_AXIS";
-		break;
+		return "TABLET_TOOL_AXIS";
 	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
-		type = "TABLET_TOOL_PROXIMITY";
-		break;
+		return "TABLET_TOOL_PROXIMITY";
 	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
-		type = "TABLET_TOOL_TIP";
-		break;
+		return "TABLET_TOOL_TIP";
 	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
-		type = "TABLET_TOOL_BUTTON";
-		break;
+		return "TABLET_TOOL_BUTTON";
 	case LIBINPUT_EVENT_TABLET_PAD_BUTTON:
-		type = "TABLET_PAD_BUTTON";
-		break;
+		return "TABLET_PAD_BUTTON";
 	case LIBINPUT_EVENT_TABLET_PAD_RING:
-		type = "TABLET_PAD_RING";
-		break;
+		return "TABLET_PAD_RING";
 	case LIBINPUT_EVENT_TABLET_PAD_STRIP:
-		type = "TABLET_PAD_STRIP";
-		break;
+		return "TABLET_PAD_STRIP";
 	case LIBINPUT_EVENT_TABLET_PAD_KEY:
-		type = "TABLET_PAD_KEY";
-		break;
+		return "TABLET_PAD_KEY";
 	case LIBINPUT_EVENT_SWITCH_TOGGLE:
-		type = "SWITCH_TOGGLE";
-		break;
+		return "SWITCH_TOGGLE";
 	}
 
+	abort();
+}
+
+static void
+print_event_header(struct libinput_event *ev)
+{
+	/* use for pointer value only, do not dereference */
+	static void *last_device = NULL;
+	struct libinput_device *dev = libinput_event_get_device(ev);
+	const char *type;
+	char prefix;
+
+	type = event_type_name(libinput_event_get_type(ev));
+
 	prefix = (last_device != dev) ? '-' : ' ';
 
 	printq("%c%-7s  %-16s ",
@@ -167,23 +156,26 @@ print_event_time(uint32_t time)
 static inline void
 print_device_options(struct libinput_device *dev)
 {
+	struct libinput_config_snapshot config;
 	uint32_t scroll_methods, click_methods;
 
-	if (libinput_device_config_tap_get_finger_count(dev)) {
+	libinput_device_config_get_snapshot(dev, &config, sizeof(config));
+
+	if (config.tap.finger_count) {
 	    printq(" tap");
-	    if (libinput_device_config_tap_get_drag_lock_enabled(dev))
+	    if (config.tap.drag_lock)
 		    printq("(dl on)");
 	    else
 		    printq("(dl off)");
 	}
-	if (libinput_device_config_left_handed_is_available(dev))
+	if (config.left_handed.available)
 	    printq(" left");
-	if (libinput_device_config_scroll_has_natural_scroll(dev))
+	if (config.natural_scroll.available)
 	    printq(" scroll-nat");
-	if (libinput_device_config_calibration_has_matrix(dev))
+	if (config.calibration.has_matrix)
 	    printq(" calib");
 
-	scroll_methods = libinput_device_config_scroll_get_methods(dev);
+	scroll_methods = config.scroll.methods;
 	if (scroll_methods != LIBINPUT_CONFIG_SCROLL_NO_SCROLL) {
 		printq(" scroll");
 		if (scroll_methods & LIBINPUT_CONFIG_SCROLL_2FG)
@@ -194,7 +186,7 @@ print_device_options(struct libinput_device *dev)
 			printq("-button");
 	}
 
-	click_methods = libinput_device_config_click_get_methods(dev);
+	click_methods = config.click.methods;
 	if (click_methods != LIBINPUT_CONFIG_CLICK_METHOD_NONE) {
 		printq(" click");
 		if (click_methods & LIBINPUT_CONFIG_CLICK_METHOD_BUTTON_AREAS)
@@ -203,9 +195,8 @@ print_device_options(struct libinput_device *dev)
 			printq("-clickfinger");
 	}
 
-	if (libinput_device_config_dwt_is_available(dev)) {
-		if (libinput_device_config_dwt_get_enabled(dev) ==
-		    LIBINPUT_CONFIG_DWT_ENABLED)
+	if (config.dwt.available) {
+		if (config.dwt.enabled == LIBINPUT_CONFIG_DWT_ENABLED)
 			printq(" dwt-on");
 		else
 			printq(" dwt-off)");
@@ -510,6 +501,63 @@ print_pointer_axis_event(struct libinput_event *ev)
 	       v, dv, have_vert, h, dh, have_horiz, source);
 }
 
+static void
+print_pointer_frame_event(struct libinput_event *ev)
+{
+	struct libinput_event_pointer *p = libinput_event_get_pointer_event(ev);
+	const enum libinput_pointer_axis axes[] = {
+		LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL,
+		LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL,
+	};
+
+	print_event_time(libinput_event_pointer_get_time(p));
+
+	switch (libinput_event_pointer_get_frame_motion_type(p)) {
+	case LIBINPUT_EVENT_POINTER_MOTION:
+		printq("%6.2f/%6.2f (%+6.2f/%+6.2f)",
+		       libinput_event_pointer_get_dx(p),
+		       libinput_event_pointer_get_dy(p),
+		       libinput_event_pointer_get_dx_unaccelerated(p),
+		       libinput_event_pointer_get_dy_unaccelerated(p));
+		break;
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+		printq("%6.2f/%6.2f",
+		       libinput_event_pointer_get_absolute_x_transformed(p,
+								 screen_width),
+		       libinput_event_pointer_get_absolute_y_transformed(p,
+								 screen_height));
+		break;
+	default:
+		printq("no motion");
+		break;
+	}
+
+	for (size_t i = 0; i < ARRAY_LENGTH(axes); i++) {
+		if (!libinput_event_pointer_has_axis(p, axes[i]))
+			continue;
+
+		printq(" %s %.2f/%d",
+		       axes[i] == LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL ?
+			       "vert" : "horiz",
+		       libinput_event_pointer_get_axis_value(p, axes[i]),
+		       (int)libinput_event_pointer_get_axis_value_discrete(p,
+								   axes[i]));
+	}
+
+	for (size_t i = 0; i < libinput_event_pointer_get_frame_button_count(p); i++) {
+		uint32_t button = libinput_event_pointer_get_frame_button(p, i);
+		const char *buttonname = libevdev_event_code_get_name(EV_KEY,
+								      button);
+
+		printq(" %s %s",
+		       buttonname ? buttonname : "???",
+		       libinput_event_pointer_get_frame_button_state(p, i) ==
+			       LIBINPUT_BUTTON_STATE_PRESSED ? "pressed" : "released");
+	}
+
+	printq("\n");
+}
+
 static void
 print_tablet_axis_event(struct libinput_event *ev)
 {
@@ -818,6 +866,271 @@ print_switch_event(struct libinput_event *ev)
 	printq("switch %s state %d\n", which, state);
 }
 
+static void
+print_startup_timing(struct libinput *li, struct libinput_device *device)
+{
+	char *str = tools_startup_time_str(li, device);
+
+	if (device)
+		printq("%-7s  startup: %s\n",
+		       libinput_device_get_sysname(device),
+		       str);
+	else
+		printq("context startup: %s\n", str);
+
+	free(str);
+}
+
+static void
+print_log_ring_message(struct libinput *li,
+		       enum libinput_log_priority priority,
+		       uint64_t time_usec,
+		       const char *message,
+		       void *user_data)
+{
+	uint32_t time = time_usec / 1000;
+
+	printf("%+6.3fs	%s",
+	       start_time ? ((int64_t)time - start_time) / 1000.0 : 0,
+	       message);
+}
+
+/* The devices whose delays are printed on exit. They keep a reference so
+ * removed devices are printed too */
+static struct {
+	struct libinput_device **devices;
+	size_t ndevices;
+} latency_audit;
+
+static void
+latency_audit_add_device(struct libinput_device *device)
+{
+	latency_audit.devices = realloc(latency_audit.devices,
+					(latency_audit.ndevices + 1) *
+					sizeof(*latency_audit.devices));
+	if (!latency_audit.devices)
+		abort();
+
+	latency_audit.devices[latency_audit.ndevices++] =
+		libinput_device_ref(device);
+	libinput_device_set_latency_tracking(device, 1);
+}
+
+/* Index into the per-type counters, the event types are grouped in
+ * hundreds with fewer than 8 per group */
+#define STATS_TYPE_INDEX(t_) ((t_) / 100 * 8 + (t_) % 100)
+#define STATS_NTYPES STATS_TYPE_INDEX(LIBINPUT_EVENT_SWITCH_TOGGLE + 100)
+#define STATS_INTERVAL_US 1000000
+
+struct device_stats {
+	struct libinput_device *device;
+	bool removed;
+	uint64_t nevents;
+	uint64_t counts[STATS_NTYPES];
+	uint64_t last_time; /* us, of the last event */
+	uint64_t nframes;
+	uint64_t frame_interval_sum; /* us */
+	uint64_t frame_interval_max; /* us */
+};
+
+static struct {
+	struct device_stats *devices;
+	size_t ndevices;
+	uint64_t since; /* us, start of the current interval */
+	uint64_t dispatch_calls;
+	uint64_t dispatch_time; /* us */
+	uint64_t dispatch_time_max; /* us */
+	size_t queue_depth_max;
+} stats;
+
+static inline uint64_t
+now_in_us(void)
+{
+	struct timespec tp;
+
+	clock_gettime(CLOCK_MONOTONIC, &tp);
+	return tp.tv_sec * 1000000ULL + tp.tv_nsec / 1000;
+}
+
+static struct device_stats *
+stats_get_device(struct libinput_device *device)
+{
+	struct device_stats *d;
+
+	for (size_t i = 0; i < stats.ndevices; i++) {
+		if (stats.devices[i].device == device)
+			return &stats.devices[i];
+	}
+
+	stats.devices = realloc(stats.devices,
+				(stats.ndevices + 1) * sizeof(*stats.devices));
+	if (!stats.devices)
+		abort();
+
+	d = &stats.devices[stats.ndevices++];
+	memset(d, 0, sizeof(*d));
+	d->device = libinput_device_ref(device);
+
+	return d;
+}
+
+static void
+stats_record_event(struct libinput_event *ev)
+{
+	enum libinput_event_type type = libinput_event_get_type(ev);
+	struct device_stats *d;
+	struct libinput_event_view view;
+
+	d = stats_get_device(libinput_event_get_device(ev));
+
+	if (type == LIBINPUT_EVENT_DEVICE_ADDED)
+		return;
+
+	if (type == LIBINPUT_EVENT_DEVICE_REMOVED) {
+		d->removed = true;
+		return;
+	}
+
+	d->nevents++;
+	d->counts[STATS_TYPE_INDEX(type)]++;
+
+	/* All events of one evdev frame share the timestamp */
+	libinput_event_get_view(ev, &view, sizeof(view), 0, 0);
+	if (view.time_usec != d->last_time) {
+		if (d->last_time != 0 && view.time_usec > d->last_time) {
+			uint64_t interval = view.time_usec - d->last_time;
+
+			d->nframes++;
+			d->frame_interval_sum += interval;
+			d->frame_interval_max = max(d->frame_interval_max,
+						    interval);
+		}
+		d->last_time = view.time_usec;
+	}
+}
+
+static void
+stats_record_dispatch(uint64_t start, uint64_t end)
+{
+	stats.dispatch_calls++;
+	stats.dispatch_time += end - start;
+	stats.dispatch_time_max = max(stats.dispatch_time_max, end - start);
+}
+
+static void
+print_stats(uint64_t now)
+{
+	double elapsed = (now - stats.since) / 1000000.0;
+	uint32_t time = now / 1000;
+	size_t i = 0;
+
+	if (elapsed <= 0.0)
+		return;
+
+	printf("%+6.3fs	dispatch: %6.1f calls/s, avg %6.1fus, max %6" PRIu64 "us, queue depth max %zu\n",
+	       start_time ? ((int64_t)time - start_time) / 1000.0 : 0,
+	       stats.dispatch_calls / elapsed,
+	       stats.dispatch_calls ?
+		       (double)stats.dispatch_time / stats.dispatch_calls : 0,
+	       stats.dispatch_time_max,
+	       stats.queue_depth_max);
+
+	while (i < stats.ndevices) {
+		struct device_stats *d = &stats.devices[i];
+
+		if (d->nevents) {
+			printf("\t%-7s  %8.1f events/s",
+			       libinput_device_get_sysname(d->device),
+			       d->nevents / elapsed);
+			if (d->nframes)
+				printf(", frame interval avg %6.2fms max %6.2fms",
+				       d->frame_interval_sum / 1000.0 / d->nframes,
+				       d->frame_interval_max / 1000.0);
+			printf("\n");
+
+			for (size_t t = 0; t < STATS_NTYPES; t++) {
+				if (d->counts[t] == 0)
+					continue;
+
+				printf("\t\t%-24s %8.1f/s\n",
+				       event_type_name(t / 8 * 100 + t % 8),
+				       d->counts[t] / elapsed);
+			}
+		}
+
+		if (d->removed) {
+			libinput_device_unref(d->device);
+			*d = stats.devices[--stats.ndevices];
+			continue;
+		}
+
+		d->nevents = 0;
+		d->nframes = 0;
+		d->frame_interval_sum = 0;
+		d->frame_interval_max = 0;
+		memset(d->counts, 0, sizeof(d->counts));
+		i++;
+	}
+
+	stats.since = now;
+	stats.dispatch_calls = 0;
+	stats.dispatch_time = 0;
+	stats.dispatch_time_max = 0;
+	stats.queue_depth_max = 0;
+}
+
+static void
+stats_destroy(void)
+{
+	for (size_t i = 0; i < stats.ndevices; i++)
+		libinput_device_unref(stats.devices[i].device);
+	free(stats.devices);
+	stats.devices = NULL;
+	stats.ndevices = 0;
+}
+
+static void
+handle_stats_events(struct libinput *li)
+{
+	struct libinput_event *ev;
+	uint64_t start, end;
+	size_t depth = 0;
+
+	start = now_in_us();
+	libinput_dispatch(li);
+	end = now_in_us();
+	stats_record_dispatch(start, end);
+
+	while ((ev = libinput_get_event(li))) {
+		enum libinput_event_type type = libinput_event_get_type(ev);
+
+		depth++;
+
+		if (type == LIBINPUT_EVENT_DEVICE_ADDED ||
+		    type == LIBINPUT_EVENT_DEVICE_REMOVED) {
+			print_event_header(ev);
+			print_device_notify(ev);
+		}
+		if (type == LIBINPUT_EVENT_DEVICE_ADDED) {
+			tools_device_apply_config(libinput_event_get_device(ev),
+						  &options);
+			if (show_latency_audit)
+				latency_audit_add_device(libinput_event_get_device(ev));
+		}
+
+		stats_record_event(ev);
+		libinput_event_destroy(ev);
+	}
+
+	stats.queue_depth_max = max(stats.queue_depth_max, depth);
+
+	if (end - stats.since >= STATS_INTERVAL_US)
+		print_stats(end);
+
+	if (log_ring_size)
+		libinput_log_ring_drain(li, print_log_ring_message, NULL);
+}
+
 static int
 handle_and_print_events(struct libinput *li)
 {
@@ -833,8 +1146,13 @@ handle_and_print_events(struct libinput *li)
 			abort();
 		case LIBINPUT_EVENT_DEVICE_ADDED:
 			print_device_notify(ev);
+			if (show_startup_timing)
+				print_startup_timing(li,
+						     libinput_event_get_device(ev));
 			tools_device_apply_config(libinput_event_get_device(ev),
 						  &options);
+			if (show_latency_audit)
+				latency_audit_add_device(libinput_event_get_device(ev));
 			break;
 		case LIBINPUT_EVENT_DEVICE_REMOVED:
 			print_device_notify(ev);
@@ -854,6 +1172,9 @@ handle_and_print_events(struct libinput *li)
 		case LIBINPUT_EVENT_POINTER_AXIS:
 			print_pointer_axis_event(ev);
 			break;
+		case LIBINPUT_EVENT_POINTER_FRAME:
+			print_pointer_frame_event(ev);
+			break;
 		case LIBINPUT_EVENT_TOUCH_DOWN:
 			print_touch_event_with_coords(ev);
 			break;
@@ -920,6 +1241,10 @@ handle_and_print_events(struct libinput *li)
 		libinput_dispatch(li);
 		rc = 0;
 	}
+
+	if (log_ring_size)
+		libinput_log_ring_drain(li, print_log_ring_message, NULL);
+
 	return rc;
 }
 
@@ -942,21 +1267,135 @@ mainloop(struct libinput *li)
 	if (handle_and_print_events(li))
 		fprintf(stderr, "Expected device added events on startup but got none. "
 				"Maybe you don't have the right permissions?\n");
+	if (flush_per_dispatch)
+		fflush(stdout);
 
 	/* time offset starts with our first received event */
 	if (poll(&fds, 1, -1) > -1) {
 		struct timespec tp;
+		/* wake up for the stats even without events */
+		int timeout = show_stats ? STATS_INTERVAL_US / 1000 : -1;
 
 		clock_gettime(CLOCK_MONOTONIC, &tp);
 		start_time = tp.tv_sec * 1000 + tp.tv_nsec / 1000000;
+		stats.since = now_in_us();
 		do {
-			handle_and_print_events(li);
-		} while (!stop && poll(&fds, 1, -1) > -1);
+			if (show_stats)
+				handle_stats_events(li);
+			else
+				handle_and_print_events(li);
+			if (flush_per_dispatch)
+				fflush(stdout);
+		} while (!stop && poll(&fds, 1, timeout) > -1);
+	}
+
+	if (show_stats) {
+		print_stats(now_in_us());
+		stats_destroy();
 	}
 
 	printf("\n");
 }
 
+static void
+print_latency_audit(void)
+{
+	static const struct {
+		enum libinput_delay_source source;
+		const char *name;
+	} sources[] = {
+		{ LIBINPUT_DELAY_SOURCE_TAP, "tap" },
+		{ LIBINPUT_DELAY_SOURCE_MIDDLEBUTTON, "middle button emulation" },
+		{ LIBINPUT_DELAY_SOURCE_DEBOUNCE, "debounce" },
+		{ LIBINPUT_DELAY_SOURCE_SOFTWARE_BUTTONS, "software buttons" },
+		{ LIBINPUT_DELAY_SOURCE_DWT, "disable-while-typing" },
+		{ LIBINPUT_DELAY_SOURCE_ARBITRATION, "pen/touch arbitration" },
+		{ LIBINPUT_DELAY_SOURCE_GESTURE, "gesture finger count" },
+		{ LIBINPUT_DELAY_SOURCE_TABLET_PROXIMITY, "forced proximity out" },
+	};
+
+	for (size_t i = 0; i < latency_audit.ndevices; i++) {
+		struct libinput_device *device = latency_audit.devices[i];
+		bool have_delays = false;
+
+		printf("%-7s  %s\n",
+		       libinput_device_get_sysname(device),
+		       libinput_device_get_name(device));
+
+		for (size_t j = 0; j < ARRAY_LENGTH(sources); j++) {
+			enum libinput_delay_source source = sources[j].source;
+			uint64_t samples;
+
+			samples = libinput_device_get_delay_stats(device,
+								  source,
+								  LIBINPUT_LATENCY_STAT_SAMPLES);
+			if (samples == 0)
+				continue;
+
+			if (!have_delays)
+				printf("    %-26s %10s %10s %10s %10s\n",
+				       "source", "delayed", "p50", "p99", "max");
+			have_delays = true;
+
+			printf("    %-26s %10" PRIu64 " %8" PRIu64 "us %8" PRIu64
+			       "us %8" PRIu64 "us\n",
+			       sources[j].name,
+			       samples,
+			       libinput_device_get_delay_stats(device,
+							       source,
+							       LIBINPUT_LATENCY_STAT_P50),
+			       libinput_device_get_delay_stats(device,
+							       source,
+							       LIBINPUT_LATENCY_STAT_P99),
+			       libinput_device_get_delay_stats(device,
+							       source,
+							       LIBINPUT_LATENCY_STAT_MAX));
+		}
+
+		if (!have_delays)
+			printf("    no delayed events\n");
+
+		libinput_device_unref(device);
+	}
+
+	free(latency_audit.devices);
+	latency_audit.devices = NULL;
+	latency_audit.ndevices = 0;
+}
+
+static void
+print_timer_stats(struct libinput *li)
+{
+	struct libinput_timer_stats *stats;
+	unsigned int i, count;
+
+	stats = libinput_get_timer_stats(li);
+	count = libinput_timer_stats_get_count(stats);
+
+	printf("%-40s %10s %10s %10s %10s %10s %10s\n",
+	       "timer", "armed", "fired", "cancelled",
+	       "late p50", "late p99", "late max");
+	for (i = 0; i < count; i++) {
+		printf("%-40s %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+		       " %8" PRIu64 "us %8" PRIu64 "us %8" PRIu64 "us\n",
+		       libinput_timer_stats_get_name(stats, i),
+		       libinput_timer_stats_get_value(stats, i,
+						      LIBINPUT_TIMER_STAT_ARMED),
+		       libinput_timer_stats_get_value(stats, i,
+						      LIBINPUT_TIMER_STAT_FIRED),
+		       libinput_timer_stats_get_value(stats, i,
+						      LIBINPUT_TIMER_STAT_CANCELLED),
+		       libinput_timer_stats_get_value(stats, i,
+						      LIBINPUT_TIMER_STAT_LATENESS_P50),
+		       libinput_timer_stats_get_value(stats, i,
+						      LIBINPUT_TIMER_STAT_LATENESS_P99),
+		       libinput_timer_stats_get_value(stats, i,
+						      LIBINPUT_TIMER_STAT_LATENESS_MAX));
+	}
+
+	libinput_timer_stats_destroy(stats);
+}
+
 static void
 usage(void) {
 	printf("Usage: libinput debug-events [options] [--udev <seat>|--device /dev/input/event0 ...]\n");
@@ -985,6 +1424,11 @@ main(int argc, char **argv)
 			OPT_VERBOSE,
 			OPT_SHOW_KEYCODES,
 			OPT_QUIET,
+			OPT_TIMER_STATS,
+			OPT_STARTUP_TIMING,
+			OPT_LOG_RING,
+			OPT_STATS,
+			OPT_LATENCY_AUDIT,
 		};
 		static struct option opts[] = {
 			CONFIGURATION_OPTIONS,
@@ -995,6 +1439,11 @@ main(int argc, char **argv)
 			{ "grab",                      no_argument,       0, OPT_GRAB },
 			{ "verbose",                   no_argument,       0, OPT_VERBOSE },
 			{ "quiet",                     no_argument,       0, OPT_QUIET },
+			{ "timer-stats",               no_argument,       0, OPT_TIMER_STATS },
+			{ "startup-timing",            no_argument,       0, OPT_STARTUP_TIMING },
+			{ "log-ring",                  required_argument, 0, OPT_LOG_RING },
+			{ "stats",                     no_argument,       0, OPT_STATS },
+			{ "latency-audit",             no_argument,       0, OPT_LATENCY_AUDIT },
 			{ 0, 0, 0, 0}
 		};
 
@@ -1016,6 +1465,26 @@ main(int argc, char **argv)
 		case OPT_QUIET:
 			be_quiet = true;
 			break;
+		case OPT_TIMER_STATS:
+			show_timer_stats = true;
+			break;
+		case OPT_STARTUP_TIMING:
+			show_startup_timing = true;
+			break;
+		case OPT_STATS:
+			show_stats = true;
+			break;
+		case OPT_LATENCY_AUDIT:
+			show_latency_audit = true;
+			break;
+		case OPT_LOG_RING:
+			if (!safe_atou(optarg, &log_ring_size) ||
+			    log_ring_size == 0 ||
+			    (log_ring_size & (log_ring_size - 1)) != 0) {
+				usage();
+				return EXIT_INVALID_USAGE;
+			}
+			break;
 		case OPT_DEVICE:
 			if (backend == BACKEND_UDEV ||
 			    ndevices >= ARRAY_LENGTH(seat_or_devices)) {
@@ -1081,6 +1550,16 @@ main(int argc, char **argv)
 		return EXIT_FAILURE;
 	}
 
+	/* A line-buffered terminal costs one write per event line, flush
+	 * once per dispatch instead. Anything else, e.g. a pipe, gets a
+	 * large buffer that is only written when full or on exit */
+	if (isatty(STDOUT_FILENO)) {
+		setvbuf(stdout, NULL, _IOFBF, BUFSIZ);
+		flush_per_dispatch = true;
+	} else {
+		setvbuf(stdout, NULL, _IOFBF, 64 * 1024);
+	}
+
 	if (verbose)
 		printf("libinput version: %s\n", LIBINPUT_VERSION);
 
@@ -1088,8 +1567,26 @@ main(int argc, char **argv)
 	if (!li)
 		return EXIT_FAILURE;
 
+	if (show_startup_timing)
+		print_startup_timing(li, NULL);
+
+	if (log_ring_size) {
+		if (libinput_log_set_ring(li, log_ring_size) != 0) {
+			fprintf(stderr, "Failed to set up the log ring\n");
+			libinput_unref(li);
+			return EXIT_FAILURE;
+		}
+		libinput_log_set_priority(li, LIBINPUT_LOG_PRIORITY_DEBUG);
+	}
+
 	mainloop(li);
 
+	if (show_timer_stats)
+		print_timer_stats(li);
+
+	if (show_latency_audit)
+		print_latency_audit();
+
 	libinput_unref(li);
 
 	return EXIT_SUCCESS;
@@ -45,6 +45,7 @@
 #include "util-strings.h"
 #include "util-macros.h"
 #include "util-list.h"
+#include "util-time.h"
 
 #include "shared.h"
 
@@ -65,6 +66,18 @@ struct point {
 	double x, y;
 };
 
+/* A line that is drawn incrementally into its own surface. Only the
+ * segments added since the last frame are stroked, the rest of the
+ * trace is a single paint of the surface regardless of its length */
+struct trace {
+	cairo_surface_t *surface;
+	bool clear;
+	struct point drawn; /* end of the stroked part */
+	struct point last; /* end of the trace */
+	struct point pending[256];
+	size_t npending;
+};
+
 struct device_user_data {
 	struct point scroll_accumulated;
 };
@@ -86,13 +99,15 @@ struct window {
 	GtkWidget *area;
 	int width, height; /* of window */
 
+	/* one redraw per frame, see window_queue_redraw() */
+	guint redraw_tick;
+
 	/* sprite position */
 	double x, y;
 
-	/* these are for the delta coordinates, but they're not
-	 * deltas, they are converted into abs positions */
-	size_t ndeltas;
-	struct point deltas[64];
+	/* the unaccelerated deltas, converted into abs positions */
+	struct trace trace;
+	uint64_t last_motion_time; /* us */
 
 	/* abs position */
 	int absx, absy;
@@ -141,10 +156,8 @@ struct window {
 		double size_major, size_minor;
 		bool is_down;
 
-		/* these are for the delta coordinates, but they're not
-		 * deltas, they are converted into abs positions */
-		size_t ndeltas;
-		struct point deltas[64];
+		/* the deltas, converted into abs positions */
+		struct trace trace;
 	} tool;
 
 	struct {
@@ -185,6 +198,80 @@ msg(const char *fmt, ...)
 	va_end(args);
 }
 
+static void
+trace_reset(struct trace *t, double x, double y)
+{
+	t->clear = true;
+	t->drawn.x = x;
+	t->drawn.y = y;
+	t->last = t->drawn;
+	t->npending = 0;
+}
+
+static void
+trace_add_delta(struct trace *t, double dx, double dy)
+{
+	t->last.x += dx;
+	t->last.y += dy;
+
+	/* More events than this within one frame only lose detail, not
+	 * the position */
+	if (t->npending == ARRAY_LENGTH(t->pending))
+		t->npending--;
+	t->pending[t->npending++] = t->last;
+}
+
+static void
+trace_draw(struct trace *t, cairo_t *cr, int width, int height)
+{
+	cairo_t *tcr;
+
+	/* Nothing to show yet, or the trace was reset and is empty */
+	if (t->npending == 0 && (!t->surface || t->clear))
+		return;
+
+	if (!t->surface ||
+	    cairo_image_surface_get_width(t->surface) != width ||
+	    cairo_image_surface_get_height(t->surface) != height) {
+		if (t->surface)
+			cairo_surface_destroy(t->surface);
+		t->surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+							width,
+							height);
+		t->clear = false; /* new surfaces are transparent */
+	}
+
+	tcr = cairo_create(t->surface);
+	if (t->clear) {
+		cairo_set_operator(tcr, CAIRO_OPERATOR_CLEAR);
+		cairo_paint(tcr);
+		cairo_set_operator(tcr, CAIRO_OPERATOR_OVER);
+		t->clear = false;
+	}
+
+	if (t->npending) {
+		cairo_set_source(tcr, cairo_get_source(cr));
+		cairo_move_to(tcr, t->drawn.x, t->drawn.y);
+		for (size_t i = 0; i < t->npending; i++)
+			cairo_line_to(tcr, t->pending[i].x, t->pending[i].y);
+		cairo_stroke(tcr);
+		t->drawn = t->pending[t->npending - 1];
+		t->npending = 0;
+	}
+	cairo_destroy(tcr);
+
+	cairo_set_source_surface(cr, t->surface, 0, 0);
+	cairo_paint(cr);
+}
+
+static void
+trace_destroy(struct trace *t)
+{
+	if (t->surface)
+		cairo_surface_destroy(t->surface);
+	t->surface = NULL;
+}
+
 static inline void
 draw_evdev_rel(struct window *w, cairo_t *cr)
 {
@@ -533,9 +620,6 @@ draw_pad(struct window *w, cairo_t *cr)
 static inline void
 draw_tablet(struct window *w, cairo_t *cr)
 {
-	double x, y;
-	int first, last;
-	size_t mask;
 	int rx, ry;
 
 	/* pressure/distance bars */
@@ -614,34 +698,15 @@ draw_tablet(struct window *w, cairo_t *cr)
 	}
 
 	/* tablet deltas */
-	mask = ARRAY_LENGTH(w->tool.deltas);
-	first = max(w->tool.ndeltas + 1, mask) - mask;
-	last = w->tool.ndeltas;
-
 	cairo_save(cr);
 	cairo_set_source_rgb(cr, .8, .8, .2);
-
-	x = w->tool.deltas[first % mask].x;
-	y = w->tool.deltas[first % mask].y;
-	cairo_move_to(cr, x, y);
-
-	for (int i = first + 1; i < last; i++) {
-		x = w->tool.deltas[i % mask].x;
-		y = w->tool.deltas[i % mask].y;
-		cairo_line_to(cr, x, y);
-	}
-
-	cairo_stroke(cr);
+	trace_draw(&w->tool.trace, cr, w->width, w->height);
 	cairo_restore(cr);
 }
 
 static inline void
 draw_pointer(struct window *w, cairo_t *cr)
 {
-	double x, y;
-	int first, last;
-	size_t mask;
-
 	/* draw pointer sprite */
 	cairo_set_source_rgb(cr, 0, 0, 0);
 	cairo_save(cr);
@@ -652,23 +717,8 @@ draw_pointer(struct window *w, cairo_t *cr)
 	cairo_fill(cr);
 
 	/* pointer deltas */
-	mask = ARRAY_LENGTH(w->deltas);
-	first = max(w->ndeltas + 1, mask) - mask;
-	last = w->ndeltas;
-
 	cairo_set_source_rgb(cr, .8, .5, .2);
-
-	x = w->deltas[first % mask].x;
-	y = w->deltas[first % mask].y;
-	cairo_move_to(cr, x, y);
-
-	for (int i = first + 1; i < last; i++) {
-		x = w->deltas[i % mask].x;
-		y = w->deltas[i % mask].y;
-		cairo_line_to(cr, x, y);
-	}
-
-	cairo_stroke(cr);
+	trace_draw(&w->trace, cr, w->width, w->height);
 	cairo_restore(cr);
 }
 
@@ -753,6 +803,32 @@ draw(GtkWidget *widget, cairo_t *cr, gpointer data)
 	return TRUE;
 }
 
+static gboolean
+redraw_tick_cb(GtkWidget *widget, GdkFrameClock *clock, gpointer data)
+{
+	struct window *w = data;
+
+	w->redraw_tick = 0;
+	gtk_widget_queue_draw(w->area);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Input may arrive far more often than the display refreshes, the
+ * handlers only update the state and the scene is drawn in the next
+ * frame of the frame clock */
+static void
+window_queue_redraw(struct window *w)
+{
+	if (w->redraw_tick)
+		return;
+
+	w->redraw_tick = gtk_widget_add_tick_callback(w->area,
+						      redraw_tick_cb,
+						      w,
+						      NULL);
+}
+
 static void
 map_event_cb(GtkWidget *widget, GdkEvent *event, gpointer data)
 {
@@ -782,6 +858,8 @@ map_event_cb(GtkWidget *widget, GdkEvent *event, gpointer data)
 	w->pinch.x = w->width/2;
 	w->pinch.y = w->height/2;
 
+	trace_reset(&w->trace, w->width/2, w->height/2);
+
 	g_signal_connect(G_OBJECT(w->area), "draw", G_CALLBACK(draw), w);
 
 	window = gdk_event_get_window(event);
@@ -835,6 +913,9 @@ window_cleanup(struct window *w)
 		if (*dev)
 			libinput_device_unref(*dev);
 	}
+
+	trace_destroy(&w->trace);
+	trace_destroy(&w->tool.trace);
 }
 
 static void
@@ -944,7 +1025,7 @@ handle_event_evdev(GIOChannel *source, GIOCondition condition, gpointer data)
 		}
 	} while (rc == LIBEVDEV_READ_STATUS_SUCCESS);
 
-	gtk_widget_queue_draw(w->area);
+	window_queue_redraw(w);
 out:
 	return TRUE;
 }
@@ -1067,22 +1148,21 @@ handle_event_motion(struct libinput_event *ev, struct window *w)
 	struct libinput_event_pointer *p = libinput_event_get_pointer_event(ev);
 	double dx = libinput_event_pointer_get_dx(p),
 	       dy = libinput_event_pointer_get_dy(p);
-	struct point point;
-	const int mask = ARRAY_LENGTH(w->deltas);
-	size_t idx;
+	uint64_t time = libinput_event_pointer_get_time_usec(p);
 
 	w->x += dx;
 	w->y += dy;
 	w->x = clip(w->x, 0.0, w->width);
 	w->y = clip(w->y, 0.0, w->height);
 
-	idx = w->ndeltas % mask;
-	point = w->deltas[idx];
-	idx = (w->ndeltas + 1) % mask;
-	point.x += libinput_event_pointer_get_dx_unaccelerated(p);
-	point.y += libinput_event_pointer_get_dy_unaccelerated(p);
-	w->deltas[idx] = point;
-	w->ndeltas++;
+	/* A new movement after a pause starts a new trace */
+	if (time - w->last_motion_time > ms2us(1000))
+		trace_reset(&w->trace, w->width/2, w->height/2);
+	w->last_motion_time = time;
+
+	trace_add_delta(&w->trace,
+			libinput_event_pointer_get_dx_unaccelerated(p),
+			libinput_event_pointer_get_dy_unaccelerated(p));
 }
 
 static void
@@ -1298,9 +1378,6 @@ handle_event_tablet(struct libinput_event *ev, struct window *w)
 {
 	struct libinput_event_tablet_tool *t = libinput_event_get_tablet_tool_event(ev);
 	double x, y;
-	struct point point;
-	int idx;
-	const int mask = ARRAY_LENGTH(w->tool.deltas);
 	bool is_press;
 	unsigned int button;
 
@@ -1320,9 +1397,7 @@ handle_event_tablet(struct libinput_event *ev, struct window *w)
 		} else {
 			w->tool.x_in = x;
 			w->tool.y_in = y;
-			w->tool.ndeltas = 0;
-			w->tool.deltas[0].x = w->width/2;
-			w->tool.deltas[0].y = w->height/2;
+			trace_reset(&w->tool.trace, w->width/2, w->height/2);
 		}
 		break;
 	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
@@ -1352,16 +1427,9 @@ handle_event_tablet(struct libinput_event *ev, struct window *w)
 		w->tool.size_major = libinput_event_tablet_tool_get_size_major(t);
 		w->tool.size_minor = libinput_event_tablet_tool_get_size_minor(t);
 
-		/* Add the delta to the last position and store them as abs
-		 * coordinates */
-		idx = w->tool.ndeltas % mask;
-		point = w->tool.deltas[idx];
-
-		idx = (w->tool.ndeltas + 1) % mask;
-		point.x += libinput_event_tablet_tool_get_dx(t);
-		point.y += libinput_event_tablet_tool_get_dy(t);
-		w->tool.deltas[idx] = point;
-		w->tool.ndeltas++;
+		trace_add_delta(&w->tool.trace,
+				libinput_event_tablet_tool_get_dx(t),
+				libinput_event_tablet_tool_get_dy(t));
 		break;
 	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
 		is_press = libinput_event_tablet_tool_get_button_state(t) == LIBINPUT_BUTTON_STATE_PRESSED;
@@ -1487,7 +1555,7 @@ handle_event_libinput(GIOChannel *source, GIOCondition condition, gpointer data)
 		libinput_event_destroy(ev);
 		libinput_dispatch(li);
 	}
-	gtk_widget_queue_draw(w->area);
+	window_queue_redraw(w);
 
 	return TRUE;
 }
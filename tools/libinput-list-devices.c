@@ -24,6 +24,7 @@
 #include "config.h"
 
 #include <errno.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
@@ -32,10 +33,14 @@
 
 #include <libinput.h>
 #include <libinput-version.h>
+#include "util-macros.h"
 #include "util-strings.h"
 
 #include "shared.h"
 
+static bool show_timing;
+static bool show_memory;
+
 static const char *
 tap_default(struct libinput_device *device)
 {
@@ -72,6 +77,18 @@ draglock_default(struct libinput_device *device)
 		return "disabled";
 }
 
+static const char *
+tap_early_commit_default(struct libinput_device *device)
+{
+	if (!libinput_device_config_tap_get_finger_count(device))
+		return "n/a";
+
+	if (libinput_device_config_tap_get_default_early_commit_enabled(device))
+		return "enabled";
+	else
+		return "disabled";
+}
+
 static const char*
 left_handed_default(struct libinput_device *device)
 {
@@ -205,11 +222,13 @@ accel_profiles(struct libinput_device *device)
 
 	profile = libinput_device_config_accel_get_default_profile(device);
 	xasprintf(&str,
-		  "%s%s %s%s",
+		  "%s%s %s%s %s%s",
 		  (profile == LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT) ? "*" : "",
 		  (profiles & LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT) ? "flat" : "",
 		  (profile == LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE) ? "*" : "",
-		  (profiles & LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE) ? "adaptive" : "");
+		  (profiles & LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE) ? "adaptive" : "",
+		  (profile == LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM) ? "*" : "",
+		  (profiles & LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM) ? "custom" : "");
 
 	return str;
 }
@@ -226,6 +245,18 @@ dwt_default(struct libinput_device *device)
 		return "disabled";
 }
 
+static const char *
+low_latency_default(struct libinput_device *device)
+{
+	if (!libinput_device_config_low_latency_is_available(device))
+		return "n/a";
+
+	if (libinput_device_config_low_latency_get_default_enabled(device))
+		return "enabled";
+	else
+		return "disabled";
+}
+
 static char *
 rotation_default(struct libinput_device *device)
 {
@@ -264,6 +295,66 @@ print_pad_info(struct libinput_device *device)
 
 }
 
+static void
+print_size(const char *label, uint64_t bytes)
+{
+	if (bytes < 1024)
+		printf("%s%" PRIu64 "B", label, bytes);
+	else
+		printf("%s%.1fKiB", label, bytes / 1024.0);
+}
+
+static void
+print_device_memory(struct libinput_device *dev)
+{
+	uint64_t total, device, dispatch, queued;
+
+	total = libinput_device_get_memory_stats(dev,
+						 LIBINPUT_MEMORY_STAT_TOTAL);
+	device = libinput_device_get_memory_stats(dev,
+						  LIBINPUT_MEMORY_STAT_DEVICES);
+	dispatch = libinput_device_get_memory_stats(dev,
+						    LIBINPUT_MEMORY_STAT_DISPATCH);
+	queued = libinput_device_get_memory_stats(dev,
+						  LIBINPUT_MEMORY_STAT_EVENT_QUEUE);
+
+	print_size("Memory:           ", total);
+	print_size(" (device ", device);
+	print_size(", dispatch ", dispatch);
+	print_size(", queued events ", queued);
+	printf(")\n");
+}
+
+static void
+print_context_memory(struct libinput *li)
+{
+	struct memory_stat {
+		enum libinput_memory_stat stat;
+		const char *name;
+	} *s, stats[] = {
+		{ LIBINPUT_MEMORY_STAT_CONTEXT, "context" },
+		{ LIBINPUT_MEMORY_STAT_EVENT_QUEUE, "event queue" },
+		{ LIBINPUT_MEMORY_STAT_EVENT_CACHE, "event cache" },
+		{ LIBINPUT_MEMORY_STAT_DEVICES, "devices" },
+		{ LIBINPUT_MEMORY_STAT_DISPATCH, "dispatch" },
+		{ LIBINPUT_MEMORY_STAT_TIMERS, "timers" },
+		{ LIBINPUT_MEMORY_STAT_QUIRKS, "quirks" },
+		{ LIBINPUT_MEMORY_STAT_TABLET_TOOLS, "tablet tools" },
+		{ LIBINPUT_MEMORY_STAT_LOG_RING, "log ring" },
+	};
+
+	print_size("Context memory:   ",
+		   libinput_get_memory_stats(li, LIBINPUT_MEMORY_STAT_TOTAL));
+	printf("\n");
+	ARRAY_FOR_EACH(stats, s) {
+		char label[32];
+
+		snprintf(label, sizeof(label), "    %-14s", s->name);
+		print_size(label, libinput_get_memory_stats(li, s->stat));
+		printf("\n");
+	}
+}
+
 static void
 print_device_notify(struct libinput_event *ev)
 {
@@ -328,6 +419,7 @@ print_device_notify(struct libinput_event *ev)
 	printf("Tap-to-click:     %s\n", tap_default(dev));
 	printf("Tap-and-drag:     %s\n",  drag_default(dev));
 	printf("Tap drag lock:    %s\n", draglock_default(dev));
+	printf("Tap early commit: %s\n", tap_early_commit_default(dev));
 	printf("Left-handed:      %s\n", left_handed_default(dev));
 	printf("Nat.scrolling:    %s\n", nat_scroll_default(dev));
 	printf("Middle emulation: %s\n", middle_emulation_default(dev));
@@ -344,6 +436,7 @@ print_device_notify(struct libinput_event *ev)
 	free(str);
 
 	printf("Disable-w-typing: %s\n", dwt_default(dev));
+	printf("Low latency:      %s\n", low_latency_default(dev));
 
 	str = accel_profiles(dev);
 	printf("Accel profiles:   %s\n", str);
@@ -353,6 +446,15 @@ print_device_notify(struct libinput_event *ev)
 	printf("Rotation:         %s\n", str);
 	free(str);
 
+	if (show_timing) {
+		str = tools_startup_time_str(NULL, dev);
+		printf("Startup time:     %s\n", str);
+		free(str);
+	}
+
+	if (show_memory)
+		print_device_memory(dev);
+
 	if (libinput_device_has_capability(dev,
 					   LIBINPUT_DEVICE_CAP_TABLET_PAD))
 		print_pad_info(dev);
@@ -363,10 +465,12 @@ print_device_notify(struct libinput_event *ev)
 static inline void
 usage(void)
 {
-	printf("Usage: libinput list-devices [--help|--version]\n");
+	printf("Usage: libinput list-devices [--help|--version|--timing|--memory]\n");
 	printf("\n"
 	       "--help ...... show this help and exit\n"
 	       "--version ... show version information and exit\n"
+	       "--timing .... show the time spent setting up each device\n"
+	       "--memory .... show the memory libinput allocated for each device\n"
 	       "\n");
 }
 
@@ -380,13 +484,17 @@ main(int argc, char **argv)
 
 	/* This is kept for backwards-compatibility with the old
 	   libinput-list-devices */
-	if (argc > 1) {
-		if (streq(argv[1], "--help")) {
+	for (int i = 1; i < argc; i++) {
+		if (streq(argv[i], "--help")) {
 			usage();
 			return 0;
-		} else if (streq(argv[1], "--version")) {
+		} else if (streq(argv[i], "--version")) {
 			printf("%s\n", LIBINPUT_VERSION);
 			return 0;
+		} else if (streq(argv[i], "--timing")) {
+			show_timing = true;
+		} else if (streq(argv[i], "--memory")) {
+			show_memory = true;
 		} else {
 			usage();
 			return EXIT_INVALID_USAGE;
@@ -407,6 +515,16 @@ main(int argc, char **argv)
 		libinput_dispatch(li);
 	}
 
+	if (show_timing) {
+		char *str = tools_startup_time_str(li, NULL);
+
+		printf("Context startup time: %s\n", str);
+		free(str);
+	}
+
+	if (show_memory)
+		print_context_memory(li);
+
 	libinput_unref(li);
 
 	return EXIT_SUCCESS;
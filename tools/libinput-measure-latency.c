@@ -0,0 +1,608 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <libinput.h>
+
+#include "shared.h"
+#include "util-list.h"
+#include "util-macros.h"
+#include "util-strings.h"
+#include "util-time.h"
+
+/* Events that were released by one of the device's timers are filed
+ * under that timer's name, everything else under this one */
+#define CAUSE_DIRECT "direct"
+
+struct cause {
+	struct list link;
+	char *name;
+	uint64_t *latencies; /* µs */
+	size_t count;
+	size_t size;
+};
+
+struct device {
+	struct list link;
+	struct libinput_device *device;
+	char *sysname;
+	char *name;
+	struct list causes;
+	size_t syn_dropped;
+	size_t clock_errors;
+};
+
+struct timer {
+	char *name;
+	uint64_t fired;
+	bool fired_now;
+};
+
+struct measurement {
+	struct libinput *libinput;
+	struct list devices;
+	struct list removed;
+
+	struct timer *timers;
+	size_t ntimers;
+
+	bool verbose;
+	uint64_t start;
+};
+
+static volatile sig_atomic_t stop = 0;
+static struct measurement *current;
+
+static struct device *
+find_device(struct measurement *m, const char *sysname)
+{
+	struct device *d;
+
+	list_for_each(d, &m->devices, link) {
+		if (streq(d->sysname, sysname))
+			return d;
+	}
+
+	return NULL;
+}
+
+static struct cause *
+device_get_cause(struct device *d, const char *name)
+{
+	struct cause *c;
+
+	list_for_each(c, &d->causes, link) {
+		if (streq(c->name, name))
+			return c;
+	}
+
+	c = zalloc(sizeof(*c));
+	c->name = safe_strdup(name);
+	list_append(&d->causes, &c->link);
+
+	return c;
+}
+
+static void
+cause_add_latency(struct cause *c, uint64_t latency)
+{
+	if (c->count == c->size) {
+		c->size = max(c->size * 2, 64U);
+		c->latencies = realloc(c->latencies,
+				       c->size * sizeof(*c->latencies));
+		if (!c->latencies)
+			abort();
+	}
+
+	c->latencies[c->count++] = latency;
+}
+
+static void
+device_destroy(struct device *d)
+{
+	struct cause *c, *tmp;
+
+	list_for_each_safe(c, tmp, &d->causes, link) {
+		list_remove(&c->link);
+		free(c->latencies);
+		free(c->name);
+		free(c);
+	}
+	list_remove(&d->link);
+	free(d->sysname);
+	free(d->name);
+	free(d);
+}
+
+/* Update the fired counts of all timers, the ones that fired since the
+ * last call get fired_now set */
+static void
+update_timers(struct measurement *m)
+{
+	struct libinput_timer_stats *stats;
+	unsigned int count;
+
+	for (size_t i = 0; i < m->ntimers; i++)
+		m->timers[i].fired_now = false;
+
+	stats = libinput_get_timer_stats(m->libinput);
+	if (!stats)
+		return;
+
+	count = libinput_timer_stats_get_count(stats);
+	for (unsigned int i = 0; i < count; i++) {
+		const char *name = libinput_timer_stats_get_name(stats, i);
+		uint64_t fired = libinput_timer_stats_get_value(stats, i,
+								LIBINPUT_TIMER_STAT_FIRED);
+		struct timer *t = NULL;
+
+		for (size_t j = 0; j < m->ntimers; j++) {
+			if (streq(m->timers[j].name, name)) {
+				t = &m->timers[j];
+				break;
+			}
+		}
+
+		if (!t) {
+			m->timers = realloc(m->timers,
+					    (m->ntimers + 1) * sizeof(*m->timers));
+			if (!m->timers)
+				abort();
+			t = &m->timers[m->ntimers++];
+			t->name = safe_strdup(name);
+			t->fired = 0;
+		}
+
+		t->fired_now = fired > t->fired;
+		t->fired = fired;
+	}
+
+	libinput_timer_stats_destroy(stats);
+}
+
+/* The device's timers are named "<sysname> <purpose>", return the
+ * purpose of the first of them that fired in this dispatch */
+static const char *
+timer_cause(struct measurement *m, const char *sysname)
+{
+	size_t len = strlen(sysname);
+
+	for (size_t i = 0; i < m->ntimers; i++) {
+		struct timer *t = &m->timers[i];
+
+		if (t->fired_now &&
+		    strneq(t->name, sysname, len) &&
+		    t->name[len] == ' ')
+			return &t->name[len + 1];
+	}
+
+	return NULL;
+}
+
+static bool
+event_get_time(struct libinput_event *ev, uint64_t *time)
+{
+	switch (libinput_event_get_type(ev)) {
+	case LIBINPUT_EVENT_NONE:
+	case LIBINPUT_EVENT_DEVICE_ADDED:
+	case LIBINPUT_EVENT_DEVICE_REMOVED:
+		return false;
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		*time = libinput_event_keyboard_get_time_usec(
+				libinput_event_get_keyboard_event(ev));
+		break;
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+	case LIBINPUT_EVENT_POINTER_AXIS:
+		*time = libinput_event_pointer_get_time_usec(
+				libinput_event_get_pointer_event(ev));
+		break;
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+	case LIBINPUT_EVENT_TOUCH_UP:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		*time = libinput_event_touch_get_time_usec(
+				libinput_event_get_touch_event(ev));
+		break;
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
+	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
+	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
+	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
+		*time = libinput_event_tablet_tool_get_time_usec(
+				libinput_event_get_tablet_tool_event(ev));
+		break;
+	case LIBINPUT_EVENT_TABLET_PAD_BUTTON:
+	case LIBINPUT_EVENT_TABLET_PAD_RING:
+	case LIBINPUT_EVENT_TABLET_PAD_STRIP:
+	case LIBINPUT_EVENT_TABLET_PAD_KEY:
+		*time = libinput_event_tablet_pad_get_time_usec(
+				libinput_event_get_tablet_pad_event(ev));
+		break;
+	case LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_END:
+	case LIBINPUT_EVENT_GESTURE_PINCH_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_PINCH_END:
+		*time = libinput_event_gesture_get_time_usec(
+				libinput_event_get_gesture_event(ev));
+		break;
+	case LIBINPUT_EVENT_SWITCH_TOGGLE:
+		*time = libinput_event_switch_get_time_usec(
+				libinput_event_get_switch_event(ev));
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+static void
+handle_device_added(struct measurement *m, struct libinput_event *ev)
+{
+	struct libinput_device *device = libinput_event_get_device(ev);
+	struct device *d;
+
+	d = zalloc(sizeof(*d));
+	d->device = libinput_device_ref(device);
+	d->sysname = safe_strdup(libinput_device_get_sysname(device));
+	d->name = safe_strdup(libinput_device_get_name(device));
+	list_init(&d->causes);
+	list_append(&m->devices, &d->link);
+
+	printf("%-7s - %s: added\n", d->sysname, d->name);
+}
+
+static void
+handle_device_removed(struct measurement *m, struct libinput_event *ev)
+{
+	struct libinput_device *device = libinput_event_get_device(ev);
+	struct device *d;
+
+	list_for_each(d, &m->devices, link) {
+		if (d->device != device)
+			continue;
+
+		/* keep the numbers for the summary */
+		list_remove(&d->link);
+		list_append(&m->removed, &d->link);
+		libinput_device_unref(d->device);
+		d->device = NULL;
+		break;
+	}
+}
+
+static void
+handle_event(struct measurement *m, struct libinput_event *ev, uint64_t now)
+{
+	struct libinput_device *device = libinput_event_get_device(ev);
+	struct device *d;
+	const char *cause;
+	uint64_t time;
+
+	if (!event_get_time(ev, &time))
+		return;
+
+	d = find_device(m, libinput_device_get_sysname(device));
+	if (!d)
+		return;
+
+	/* libinput's clock is CLOCK_MONOTONIC, a time in the future means
+	 * the kernel timestamps are in a different clock */
+	if (time > now) {
+		d->clock_errors++;
+		return;
+	}
+
+	cause = timer_cause(m, d->sysname);
+	cause_add_latency(device_get_cause(d, cause ? cause : CAUSE_DIRECT),
+			  now - time);
+}
+
+static void
+handle_events(struct measurement *m)
+{
+	struct libinput_event *ev;
+
+	libinput_dispatch(m->libinput);
+	update_timers(m);
+
+	while ((ev = libinput_get_event(m->libinput))) {
+		/* the time the caller would see the event */
+		uint64_t now = now_in_us();
+
+		switch (libinput_event_get_type(ev)) {
+		case LIBINPUT_EVENT_DEVICE_ADDED:
+			handle_device_added(m, ev);
+			break;
+		case LIBINPUT_EVENT_DEVICE_REMOVED:
+			handle_device_removed(m, ev);
+			break;
+		default:
+			handle_event(m, ev, now);
+			break;
+		}
+
+		libinput_event_destroy(ev);
+	}
+}
+
+LIBINPUT_ATTRIBUTE_PRINTF(3, 0)
+static void
+log_handler(struct libinput *li,
+	    enum libinput_log_priority priority,
+	    const char *format,
+	    va_list args)
+{
+	struct measurement *m = current;
+	char msg[1024];
+	char sysname[64];
+	struct device *d;
+
+	vsnprintf(msg, sizeof(msg), format, args);
+
+	if (m->verbose)
+		printf("%s", msg);
+
+	if (!strstr(msg, "SYN_DROPPED") ||
+	    sscanf(msg, "%63s", sysname) != 1)
+		return;
+
+	d = find_device(m, sysname);
+	if (!d)
+		return;
+
+	d->syn_dropped++;
+	printf("%-7s - SYN_DROPPED after %.3fs, events were lost\n",
+	       d->sysname,
+	       (now_in_us() - m->start) / 1e6);
+}
+
+static int
+cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a,
+		 y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static inline double
+percentile(const uint64_t *sorted, size_t count, unsigned int p)
+{
+	size_t idx = (count - 1) * p / 100;
+
+	return sorted[idx] / 1000.0;
+}
+
+static void
+print_device(struct device *d)
+{
+	struct cause *c;
+
+	printf("%-7s - %s\n", d->sysname, d->name);
+
+	if (list_empty(&d->causes)) {
+		printf("    no events\n");
+	} else {
+		printf("    %-20s %8s %9s %9s %9s %9s\n",
+		       "cause", "events", "p50", "p90", "p99", "max");
+	}
+
+	list_for_each(c, &d->causes, link) {
+		qsort(c->latencies, c->count, sizeof(*c->latencies), cmp_u64);
+		printf("    %-20s %8zd %7.2fms %7.2fms %7.2fms %7.2fms\n",
+		       c->name,
+		       c->count,
+		       percentile(c->latencies, c->count, 50),
+		       percentile(c->latencies, c->count, 90),
+		       percentile(c->latencies, c->count, 99),
+		       c->latencies[c->count - 1] / 1000.0);
+	}
+
+	if (d->syn_dropped)
+		printf("    SYN_DROPPED: %zd (rate-limited, may be more)\n",
+		       d->syn_dropped);
+	if (d->clock_errors)
+		printf("    %zd events with a timestamp in the future, "
+		       "kernel timestamps are not CLOCK_MONOTONIC\n",
+		       d->clock_errors);
+}
+
+static void
+print_summary(struct measurement *m)
+{
+	struct device *d;
+
+	printf("\nLatency between the kernel timestamp and libinput_get_event():\n");
+	list_for_each(d, &m->devices, link)
+		print_device(d);
+	list_for_each(d, &m->removed, link)
+		print_device(d);
+}
+
+static void
+sighandler(int signal, siginfo_t *siginfo, void *userdata)
+{
+	stop = 1;
+}
+
+static void
+mainloop(struct measurement *m)
+{
+	struct pollfd fds;
+
+	fds.fd = libinput_get_fd(m->libinput);
+	fds.events = POLLIN;
+	fds.revents = 0;
+
+	handle_events(m);
+	if (list_empty(&m->devices)) {
+		fprintf(stderr, "No devices found. "
+				"Maybe you don't have the right permissions?\n");
+		return;
+	}
+
+	printf("Measuring, hit Ctrl+C to stop and print the results\n");
+
+	while (!stop && poll(&fds, 1, -1) > -1)
+		handle_events(m);
+}
+
+static void
+usage(void)
+{
+	printf("Usage: libinput measure latency [--help] [--verbose] [--grab] [--udev <seat>|/dev/input/event0 ...]\n"
+	       "\n"
+	       "Measure the time between the kernel's event timestamp and the time\n"
+	       "the resulting libinput event is returned by libinput_get_event().\n"
+	       "\n"
+	       "Options:\n"
+	       "  --udev <seat> ..... use the devices on the given seat (default: seat0)\n"
+	       "  --grab ............ exclusively grab all opened devices\n"
+	       "  --verbose ......... print libinput's debug log\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	struct measurement m = {0};
+	enum tools_backend backend = BACKEND_NONE;
+	const char *seat_or_devices[60] = {NULL};
+	size_t ndevices = 0;
+	bool grab = false;
+	struct sigaction act;
+	struct device *d, *tmp;
+
+	while (1) {
+		int c;
+		int option_index = 0;
+		enum {
+			OPT_UDEV = 1,
+			OPT_GRAB,
+			OPT_VERBOSE,
+		};
+		static struct option opts[] = {
+			{ "help",                      no_argument,       0, 'h' },
+			{ "udev",                      required_argument, 0, OPT_UDEV },
+			{ "grab",                      no_argument,       0, OPT_GRAB },
+			{ "verbose",                   no_argument,       0, OPT_VERBOSE },
+			{ 0, 0, 0, 0}
+		};
+
+		c = getopt_long(argc, argv, "h", opts, &option_index);
+		if (c == -1)
+			break;
+
+		switch(c) {
+		case 'h':
+			usage();
+			return EXIT_SUCCESS;
+		case OPT_UDEV:
+			backend = BACKEND_UDEV;
+			seat_or_devices[0] = optarg;
+			ndevices = 1;
+			break;
+		case OPT_GRAB:
+			grab = true;
+			break;
+		case OPT_VERBOSE:
+			m.verbose = true;
+			break;
+		default:
+			usage();
+			return EXIT_INVALID_USAGE;
+		}
+	}
+
+	if (optind < argc) {
+		if (backend == BACKEND_UDEV) {
+			usage();
+			return EXIT_INVALID_USAGE;
+		}
+		backend = BACKEND_DEVICE;
+		do {
+			if (ndevices >= ARRAY_LENGTH(seat_or_devices) - 1) {
+				usage();
+				return EXIT_INVALID_USAGE;
+			}
+			seat_or_devices[ndevices++] = argv[optind];
+		} while(++optind < argc);
+	} else if (backend == BACKEND_NONE) {
+		backend = BACKEND_UDEV;
+		seat_or_devices[0] = "seat0";
+	}
+
+	memset(&act, 0, sizeof(act));
+	act.sa_sigaction = sighandler;
+	act.sa_flags = SA_SIGINFO;
+
+	if (sigaction(SIGINT, &act, NULL) == -1) {
+		fprintf(stderr, "Failed to set up signal handling (%s)\n",
+				strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	list_init(&m.devices);
+	list_init(&m.removed);
+	current = &m;
+
+	m.libinput = tools_open_backend(backend, seat_or_devices, false, &grab);
+	if (!m.libinput)
+		return EXIT_FAILURE;
+
+	/* SYN_DROPPED is logged at info priority */
+	libinput_log_set_handler(m.libinput, log_handler);
+	libinput_log_set_priority(m.libinput,
+				  m.verbose ? LIBINPUT_LOG_PRIORITY_DEBUG :
+					      LIBINPUT_LOG_PRIORITY_INFO);
+	m.start = now_in_us();
+
+	mainloop(&m);
+
+	print_summary(&m);
+
+	list_for_each_safe(d, tmp, &m.devices, link) {
+		libinput_device_unref(d->device);
+		device_destroy(d);
+	}
+	list_for_each_safe(d, tmp, &m.removed, link)
+		device_destroy(d);
+	for (size_t i = 0; i < m.ntimers; i++)
+		free(m.timers[i].name);
+	free(m.timers);
+	libinput_unref(m.libinput);
+
+	return EXIT_SUCCESS;
+}
@@ -78,7 +78,10 @@ usage(void)
 	       "	Print the quirks for the given device\n"
 	       "\n"
 	       "  libinput quirks validate [--data-dir /path/to/quirks/dir]\n"
-	       "	Validate the database\n");
+	       "	Validate the database\n"
+	       "\n"
+	       "  libinput quirks compile [--data-dir /path/to/quirks/dir]\n"
+	       "	Compile the database into a binary image\n");
 }
 
 static void
@@ -98,6 +101,7 @@ main(int argc, char **argv)
 	int rc = 1;
 	struct quirks_context *quirks;
 	bool validate = false;
+	bool compile = false;
 
 	while (1) {
 		int c;
@@ -155,6 +159,13 @@ main(int argc, char **argv)
 			return 1;
 		}
 		validate = true;
+	} else if (streq(argv[optind], "compile")) {
+		optind++;
+		if (optind < argc) {
+			usage();
+			return 1;
+		}
+		compile = true;
 	} else {
 		fprintf(stderr, "Unnkown action '%s'\n", argv[optind]);
 		return 1;
@@ -172,6 +183,20 @@ main(int argc, char **argv)
 		}
 	}
 
+	if (compile) {
+		if (!quirks_compile_image(data_path,
+					  override_file,
+					  log_handler,
+					  QLOG_CUSTOM_LOG_PRIORITIES)) {
+			fprintf(stderr,
+				"Failed to compile the device quirks. "
+				"Please see the above errors "
+				"and/or re-run with --verbose for more details\n");
+			return 1;
+		}
+		return 0;
+	}
+
 	quirks = quirks_init_subsystem(data_path,
 				      override_file,
 				      log_handler,
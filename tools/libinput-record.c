@@ -23,6 +23,7 @@
 
 #include "config.h"
 
+#include <endian.h>
 #include <errno.h>
 #include <inttypes.h>
 #include <linux/input.h>
@@ -45,13 +46,17 @@
 #include "libinput-version.h"
 #include "libinput-git-version.h"
 #include "shared.h"
+#include "recording.h"
 #include "builddir.h"
 #include "util-list.h"
 #include "util-time.h"
 #include "util-input-event.h"
 #include "util-macros.h"
 
-static const int FILE_VERSION_NUMBER = 1;
+enum output_format {
+	FORMAT_YAML,
+	FORMAT_BINARY,
+};
 
 /* libinput is not designed to keep events past immediate use so we need to
  * cache our events. Simplest way to do this is to just cache the printf
@@ -77,6 +82,22 @@ struct event {
 	} u;
 };
 
+/* A preallocated buffer for --ring, once full the oldest element is
+ * overwritten. */
+struct ring {
+	char *data;
+	size_t elem_size;
+	size_t size;	/* in elements */
+	size_t head;	/* next element to write */
+	size_t count;
+};
+
+/* Upper bound for the ring sizes, a device sending more than this loses
+ * the oldest events before they are --ring seconds old. */
+#define RING_EVDEV_EVENTS_PER_SEC 1000
+#define RING_LIBINPUT_EVENTS_PER_SEC 250
+#define RING_MAX_TRIGGER_KEYS 8
+
 struct record_device {
 	struct list link;
 	char *devnode;		/* device node of the source device */
@@ -85,6 +106,14 @@ struct record_device {
 					deltas */
 	struct libinput_device *device;
 
+	unsigned int index;	/* position in the recording */
+	uint64_t last_frame_time; /* binary format only */
+
+	struct {
+		struct ring evdev;	/* struct input_event */
+		struct ring libinput;	/* struct event */
+	} ring;
+
 	struct event *events;
 	size_t nevents;
 	size_t events_sz;
@@ -99,6 +128,14 @@ struct record_device {
 struct record_context {
 	int timeout;
 	bool show_keycodes;
+	enum output_format format;
+
+	struct {
+		uint64_t duration; /* us, 0 unless --ring is given */
+		bool dump_pending;
+		unsigned int trigger_keys[RING_MAX_TRIGGER_KEYS];
+		size_t ntrigger_keys;
+	} ring;
 
 	uint64_t offset;
 
@@ -111,9 +148,83 @@ struct record_context {
 	int out_fd;
 	unsigned int indent;
 
+	/* All output goes through this buffer, see output_flush() */
+	struct {
+		char *data;
+		size_t len;
+		size_t size;
+		bool interactive; /* flush after every batch of events */
+		uint64_t last_flush; /* ms */
+	} outbuf;
+
 	struct libinput *libinput;
 };
 
+/* One write() per line can't keep up with a high-frequency device and
+ * makes the recorder itself slow enough to cause SYN_DROPPED. Output is
+ * written once the buffer fills up or after the interval. */
+#define OUTPUT_FLUSH_SIZE (64 * 1024)
+#define OUTPUT_FLUSH_INTERVAL_MS 1000
+
+static inline uint64_t
+now_in_ms(void)
+{
+	return us2ms(now_in_us());
+}
+
+static void
+ring_init(struct ring *r, size_t elem_size, size_t size)
+{
+	r->data = zalloc(elem_size * size);
+	r->elem_size = elem_size;
+	r->size = size;
+	r->head = 0;
+	r->count = 0;
+}
+
+static inline void
+ring_destroy(struct ring *r)
+{
+	free(r->data);
+	r->data = NULL;
+}
+
+/**
+ * @return the element to write, overwriting the oldest one if the ring is
+ * full
+ */
+static inline void *
+ring_next(struct ring *r)
+{
+	void *elem = r->data + r->head * r->elem_size;
+
+	r->head = (r->head + 1) % r->size;
+	if (r->count < r->size)
+		r->count++;
+
+	return elem;
+}
+
+/**
+ * @return the element at idx, where 0 is the oldest element
+ */
+static inline void *
+ring_get(struct ring *r, size_t idx)
+{
+	size_t first = (r->head + r->size - r->count) % r->size;
+
+	assert(idx < r->count);
+
+	return r->data + ((first + idx) % r->size) * r->elem_size;
+}
+
+static inline void
+ring_clear(struct ring *r)
+{
+	r->head = 0;
+	r->count = 0;
+}
+
 static inline bool
 obfuscate_keycode(struct input_event *ev)
 {
@@ -148,11 +259,111 @@ indent_pop(struct record_context *ctx)
 	ctx->indent -= 2;
 }
 
+static void
+output_flush(struct record_context *ctx)
+{
+	size_t written = 0;
+
+	while (written < ctx->outbuf.len) {
+		ssize_t rc = write(ctx->out_fd,
+				   ctx->outbuf.data + written,
+				   ctx->outbuf.len - written);
+		if (rc == -1) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "Failed to write to '%s': %m\n",
+				ctx->output_file);
+			break;
+		}
+		written += rc;
+	}
+
+	ctx->outbuf.len = 0;
+	ctx->outbuf.last_flush = now_in_ms();
+}
+
 /**
- * Indented dprintf, indentation is given as second parameter.
+ * Flush the output if it's been sitting in the buffer for long enough,
+ * call this after each batch of events.
  */
 static inline void
-iprintf(const struct record_context *ctx, const char *format, ...)
+output_flush_if_due(struct record_context *ctx)
+{
+	if (ctx->outbuf.len == 0)
+		return;
+
+	if (ctx->outbuf.interactive ||
+	    now_in_ms() - ctx->outbuf.last_flush >= OUTPUT_FLUSH_INTERVAL_MS)
+		output_flush(ctx);
+}
+
+/**
+ * Make sure the output buffer has space for len bytes plus a trailing
+ * NUL byte.
+ */
+static void
+output_reserve(struct record_context *ctx, size_t len)
+{
+	size_t size;
+
+	if (ctx->outbuf.size - ctx->outbuf.len > len)
+		return;
+
+	size = max(ctx->outbuf.size * 2, (size_t)OUTPUT_FLUSH_SIZE * 2);
+	while (size - ctx->outbuf.len <= len)
+		size *= 2;
+
+	ctx->outbuf.data = realloc(ctx->outbuf.data, size);
+	if (!ctx->outbuf.data)
+		abort();
+	ctx->outbuf.size = size;
+}
+
+static void
+output_write(struct record_context *ctx, const void *data, size_t len)
+{
+	output_reserve(ctx, len);
+	memcpy(ctx->outbuf.data + ctx->outbuf.len, data, len);
+	ctx->outbuf.len += len;
+
+	if (ctx->outbuf.len >= OUTPUT_FLUSH_SIZE)
+		output_flush(ctx);
+}
+
+LIBINPUT_ATTRIBUTE_PRINTF(2, 0)
+static int
+output_vprintf(struct record_context *ctx, const char *format, va_list args)
+{
+	size_t space = ctx->outbuf.size - ctx->outbuf.len;
+	va_list copy;
+	int len;
+
+	va_copy(copy, args);
+	len = vsnprintf(ctx->outbuf.data + ctx->outbuf.len, space, format, copy);
+	va_end(copy);
+	if (len < 0)
+		return len;
+
+	if ((size_t)len >= space) {
+		output_reserve(ctx, len);
+		vsnprintf(ctx->outbuf.data + ctx->outbuf.len,
+			  ctx->outbuf.size - ctx->outbuf.len,
+			  format,
+			  args);
+	}
+
+	ctx->outbuf.len += len;
+	if (ctx->outbuf.len >= OUTPUT_FLUSH_SIZE)
+		output_flush(ctx);
+
+	return len;
+}
+
+/**
+ * Indented printf, indentation is given as second parameter.
+ */
+static inline void
+iprintf(struct record_context *ctx, const char *format, ...)
 {
 	va_list args;
 	char fmt[1024];
@@ -175,7 +386,7 @@ iprintf(const struct record_context *ctx, const char *format, ...)
 
 	snprintf(fmt, sizeof(fmt), "%s%s", &space[len - indent - 1], format);
 	va_start(args, format);
-	rc = vdprintf(ctx->out_fd, fmt, args);
+	rc = output_vprintf(ctx, fmt, args);
 	va_end(args);
 
 	assert(rc != -1 && (unsigned int)rc > indent);
@@ -185,13 +396,13 @@ iprintf(const struct record_context *ctx, const char *format, ...)
  * Normal printf, just wrapped for the context
  */
 static inline void
-noiprintf(const struct record_context *ctx, const char *format, ...)
+noiprintf(struct record_context *ctx, const char *format, ...)
 {
 	va_list args;
 	int rc;
 
 	va_start(args, format);
-	rc = vdprintf(ctx->out_fd, format, args);
+	rc = output_vprintf(ctx, format, args);
 	va_end(args);
 	assert(rc != -1 && (unsigned int)rc > 0);
 }
@@ -341,6 +552,77 @@ print_evdev_event(struct record_context *ctx,
 		desc);
 }
 
+static inline void
+write_binary_time_gap(struct record_context *ctx,
+		      struct record_device *dev,
+		      uint64_t *dt)
+{
+	struct binary_frame frame = {
+		.dt = htole32(UINT32_MAX),
+		.device = htole16(dev->index),
+		.nevents = 0,
+	};
+
+	while (*dt > UINT32_MAX) {
+		output_write(ctx, &frame, sizeof(frame));
+		*dt -= UINT32_MAX;
+	}
+}
+
+static void
+write_binary_frame(struct record_context *ctx,
+		   struct record_device *dev,
+		   size_t offset,
+		   size_t len)
+{
+	struct binary_frame frame;
+	struct binary_event bev;
+	uint64_t time = 0, dt;
+	size_t nevents = 0;
+
+	assert(offset + len <= dev->nevents);
+
+	for (size_t i = offset; i < offset + len; i++) {
+		if (dev->events[i].type != EVDEV)
+			continue;
+
+		if (nevents++ == 0)
+			time = input_event_time(&dev->events[i].u.evdev) -
+				ctx->offset;
+	}
+
+	if (nevents == 0)
+		return;
+
+	assert(nevents <= UINT16_MAX);
+	assert(time >= dev->last_frame_time);
+
+	dt = time - dev->last_frame_time;
+	dev->last_frame_time = time;
+	write_binary_time_gap(ctx, dev, &dt);
+
+	frame.dt = htole32(dt);
+	frame.device = htole16(dev->index);
+	frame.nevents = htole16(nevents);
+	output_write(ctx, &frame, sizeof(frame));
+
+	for (size_t i = offset; i < offset + len; i++) {
+		struct input_event ev;
+
+		if (dev->events[i].type != EVDEV)
+			continue;
+
+		ev = dev->events[i].u.evdev;
+		if (!ctx->show_keycodes)
+			obfuscate_keycode(&ev);
+
+		bev.type = htole16(ev.type);
+		bev.code = htole16(ev.code);
+		bev.value = htole32(ev.value);
+		output_write(ctx, &bev, sizeof(bev));
+	}
+}
+
 #define resize(array_, sz_) \
 { \
 	size_t new_size = (sz_) + 1000; \
@@ -1375,10 +1657,14 @@ handle_libinput_events(struct record_context *ctx,
 			assert(found);
 		}
 
-		if (current->nevents == current->events_sz)
-			resize(current->events, current->events_sz);
+		if (ctx->ring.duration > 0) {
+			event = ring_next(&current->ring.libinput);
+		} else {
+			if (current->nevents == current->events_sz)
+				resize(current->events, current->events_sz);
 
-		event = &current->events[current->nevents++];
+			event = &current->events[current->nevents++];
+		}
 		event->type = LIBINPUT;
 		buffer_libinput_event(ctx, e, event);
 
@@ -1405,6 +1691,14 @@ handle_events(struct record_context *ctx, struct record_device *d, bool print)
 		if (evcount == 0 && licount == 0)
 			break;
 
+		/* Binary frames are written as they come in, for all
+		 * devices, nothing needs to stay cached */
+		if (ctx->format == FORMAT_BINARY) {
+			write_binary_frame(ctx, d, first_idx, evcount);
+			d->nevents = first_idx;
+			continue;
+		}
+
 		if (!print)
 			continue;
 
@@ -1943,6 +2237,30 @@ print_device_description(struct record_context *ctx, struct record_device *dev)
 	print_libinput_description(ctx, dev);
 }
 
+static inline void
+print_binary_header(struct record_context *ctx)
+{
+	struct record_device *d;
+	uint32_t version = htole32(BINARY_VERSION_NUMBER);
+	unsigned int index = 0;
+
+	output_write(ctx, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+	output_write(ctx, &version, sizeof(version));
+
+	print_header(ctx);
+	iprintf(ctx, "devices:\n");
+	indent_push(ctx);
+	list_for_each(d, &ctx->devices, link) {
+		d->index = index++;
+		d->last_frame_time = 0;
+		print_device_description(ctx, d);
+	}
+	indent_pop(ctx);
+
+	/* terminates the YAML header */
+	output_write(ctx, "", 1);
+}
+
 static int is_event_node(const struct dirent *dir) {
 	return strneq(dir->d_name, "event", 5);
 }
@@ -2090,6 +2408,8 @@ open_output_file(struct record_context *ctx, bool is_prefix)
 	}
 
 	ctx->out_fd = out_fd;
+	ctx->outbuf.interactive = isatty(out_fd);
+	ctx->outbuf.last_flush = now_in_ms();
 
 	return true;
 }
@@ -2107,6 +2427,384 @@ print_progress_bar(void)
 	fprintf(stderr, "\rReceiving events: [%*s%*s]", foo, "*", 21 - foo, " ");
 }
 
+/**
+ * Poll and handle the events until we get a signal, an error or the
+ * autorestart timeout. Only the first device's events are printed as
+ * they come in, the other devices' events are cached.
+ *
+ * @return true if any events were recorded
+ */
+static bool
+record_events(struct record_context *ctx,
+	      struct pollfd *fds,
+	      unsigned int nfds,
+	      struct record_device *first_device,
+	      bool *autorestart)
+{
+	struct record_device *d;
+	bool had_events = false;
+	uint64_t last_activity = now_in_ms();
+	int rc;
+
+	while (true) {
+		int timeout = ctx->timeout;
+
+		/* Wake up to write out what's still buffered */
+		if (ctx->outbuf.len > 0 &&
+		    (timeout < 0 || timeout > OUTPUT_FLUSH_INTERVAL_MS))
+			timeout = OUTPUT_FLUSH_INTERVAL_MS;
+
+		rc = poll(fds, nfds, timeout);
+		if (rc == -1) { /* error */
+			fprintf(stderr, "Error: %m\n");
+			*autorestart = false;
+			break;
+		} else if (rc == 0) {
+			output_flush(ctx);
+
+			if (ctx->timeout < 0 ||
+			    now_in_ms() - last_activity < (uint64_t)ctx->timeout)
+				continue;
+
+			fprintf(stderr,
+				" ... timeout%s\n",
+				had_events ? "" : " (file is empty)");
+			break;
+		} else if (fds[0].revents != 0) { /* signal */
+			*autorestart = false;
+			break;
+		}
+
+		last_activity = now_in_ms();
+
+		/* Pull off the evdev events first since they cause
+		 * libinput events.
+		 * handle_events de-queues libinput events so by the
+		 * time we finish that, we hopefully have all evdev
+		 * events and libinput events roughly in sync.
+		 */
+		had_events = true;
+		list_for_each(d, &ctx->devices, link)
+			handle_events(ctx, d, d == first_device);
+
+		/* This shouldn't pull any events off unless caused
+		 * by libinput-internal timeouts (e.g. tapping) */
+		if (ctx->libinput && fds[1].revents) {
+			size_t count, offset;
+
+			libinput_dispatch(ctx->libinput);
+			offset = first_device->nevents;
+			count = handle_libinput_events(ctx,
+						       first_device);
+			if (count) {
+				print_cached_events(ctx,
+						    first_device,
+						    offset,
+						    count);
+			}
+			rc--;
+		}
+
+		output_flush_if_due(ctx);
+
+		if (ctx->out_fd != STDOUT_FILENO)
+			print_progress_bar();
+
+	}
+
+	return had_events;
+}
+
+static bool
+record_yaml(struct record_context *ctx,
+	    struct pollfd *fds,
+	    unsigned int nfds,
+	    bool *autorestart)
+{
+	struct record_device *d;
+	struct record_device *first_device = NULL;
+	bool had_events;
+
+	print_header(ctx);
+	if (*autorestart)
+		iprintf(ctx,
+			"# Autorestart timeout: %d\n",
+			ctx->timeout);
+
+	iprintf(ctx, "devices:\n");
+	indent_push(ctx);
+
+	/* we only print the first device's description, the
+	 * rest is assembled after CTRL+C */
+	first_device = list_first_entry(&ctx->devices,
+					first_device,
+					link);
+	print_device_description(ctx, first_device);
+
+	iprintf(ctx, "events:\n");
+	indent_push(ctx);
+
+	if (ctx->libinput) {
+		size_t count;
+		libinput_dispatch(ctx->libinput);
+		count = handle_libinput_events(ctx, first_device);
+		print_cached_events(ctx, first_device, 0, count);
+	}
+
+	had_events = record_events(ctx, fds, nfds, first_device, autorestart);
+
+	indent_pop(ctx); /* events: */
+
+	if (*autorestart) {
+		noiprintf(ctx,
+			  "# Closing after %ds inactivity",
+			  ctx->timeout/1000);
+	}
+
+	/* First device is printed, now append all the data from the
+	 * other devices, if any */
+	list_for_each(d, &ctx->devices, link) {
+		if (d == list_first_entry(&ctx->devices, d, link))
+			continue;
+
+		print_device_description(ctx, d);
+		iprintf(ctx, "events:\n");
+		indent_push(ctx);
+		print_cached_events(ctx, d, 0, -1);
+		indent_pop(ctx);
+	}
+
+	indent_pop(ctx); /* devices: */
+	assert(ctx->indent == 0);
+
+	return had_events;
+}
+
+static bool
+record_binary(struct record_context *ctx,
+	      struct pollfd *fds,
+	      unsigned int nfds,
+	      bool *autorestart)
+{
+	print_binary_header(ctx);
+
+	return record_events(ctx, fds, nfds, NULL, autorestart);
+}
+
+static inline void
+ring_trigger(struct record_context *ctx,
+	     struct record_device *d,
+	     const char *reason)
+{
+	if (ctx->ring.dump_pending)
+		return;
+
+	fprintf(stderr, "%s: %s, saving the ring buffer\n", d->devnode, reason);
+	ctx->ring.dump_pending = true;
+}
+
+static inline bool
+ring_trigger_keys_down(struct record_context *ctx, struct record_device *d)
+{
+	for (size_t i = 0; i < ctx->ring.ntrigger_keys; i++) {
+		if (!libevdev_get_event_value(d->evdev,
+					      EV_KEY,
+					      ctx->ring.trigger_keys[i]))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * The hot path for --ring: the events are copied as-is into the device's
+ * ring, any formatting is deferred until ring_dump().
+ */
+static void
+ring_handle_events(struct record_context *ctx, struct record_device *d)
+{
+	struct input_event e;
+	int rc;
+
+	while (true) {
+		rc = libevdev_next_event(d->evdev, LIBEVDEV_READ_FLAG_NORMAL, &e);
+		if (rc != LIBEVDEV_READ_STATUS_SUCCESS &&
+		    rc != LIBEVDEV_READ_STATUS_SYNC)
+			break;
+
+		*(struct input_event *)ring_next(&d->ring.evdev) = e;
+
+		/* We keep reading in normal mode after a SYN_DROPPED,
+		 * libevdev drops the sync events for us and the
+		 * recording shows what the kernel sent */
+		if (rc == LIBEVDEV_READ_STATUS_SYNC)
+			ring_trigger(ctx, d, "SYN_DROPPED");
+		else if (e.type == EV_KEY && e.value == 1 &&
+			 ctx->ring.ntrigger_keys > 0 &&
+			 ring_trigger_keys_down(ctx, d))
+			ring_trigger(ctx, d, "trigger keys pressed");
+	}
+
+	if (ctx->libinput)
+		handle_libinput_events(ctx, d);
+}
+
+/**
+ * Merge the two rings into the device's (otherwise unused) events array,
+ * dropping anything older than the ring duration.
+ */
+static void
+ring_fill_events(struct record_context *ctx,
+		 struct record_device *d,
+		 uint64_t start)
+{
+	struct ring *evdev = &d->ring.evdev,
+		    *libinput = &d->ring.libinput;
+	size_t i = 0, j = 0;
+
+	d->nevents = 0;
+	if (d->events_sz < evdev->count + libinput->count) {
+		free(d->events);
+		d->events_sz = evdev->count + libinput->count;
+		d->events = zalloc(d->events_sz * sizeof(*d->events));
+	}
+
+	while (i < evdev->count || j < libinput->count) {
+		struct input_event *ev = NULL;
+		struct event *li = NULL;
+		uint64_t evtime = UINT64_MAX;
+		struct event *event;
+
+		if (i < evdev->count) {
+			ev = ring_get(evdev, i);
+			/* events queued before we started */
+			evtime = input_event_time(ev) > ctx->offset ?
+				 input_event_time(ev) - ctx->offset : 0;
+		}
+		if (j < libinput->count)
+			li = ring_get(libinput, j);
+
+		/* libinput events come after the evdev frame that caused
+		 * them */
+		if (li == NULL || (ev && evtime <= li->time)) {
+			i++;
+			if (evtime < start)
+				continue;
+
+			event = &d->events[d->nevents++];
+			event->type = EVDEV;
+			event->time = evtime;
+			event->u.evdev = *ev;
+		} else {
+			j++;
+			if (li->time < start)
+				continue;
+
+			d->events[d->nevents++] = *li;
+		}
+	}
+}
+
+static void
+ring_dump(struct record_context *ctx)
+{
+	struct record_device *d;
+	uint64_t now = now_in_us() - ctx->offset;
+	uint64_t start = now > ctx->ring.duration ? now - ctx->ring.duration : 0;
+
+	if (!open_output_file(ctx, true)) {
+		fprintf(stderr, "Failed to open '%s'\n", ctx->output_file);
+		goto out;
+	}
+
+	print_header(ctx);
+	iprintf(ctx, "# Ring buffer of %" PRIu64 "s\n", ctx->ring.duration/1000000);
+	iprintf(ctx, "devices:\n");
+	indent_push(ctx);
+
+	list_for_each(d, &ctx->devices, link) {
+		ring_fill_events(ctx, d, start);
+		ring_clear(&d->ring.evdev);
+		ring_clear(&d->ring.libinput);
+
+		print_device_description(ctx, d);
+		iprintf(ctx, "events:\n");
+		indent_push(ctx);
+		print_cached_events(ctx, d, 0, -1);
+		indent_pop(ctx);
+		d->nevents = 0;
+	}
+
+	indent_pop(ctx); /* devices: */
+	assert(ctx->indent == 0);
+
+	output_flush(ctx);
+	fsync(ctx->out_fd);
+	close(ctx->out_fd);
+	ctx->out_fd = -1;
+
+	fprintf(stderr, "Saved to '%s'.\n", ctx->output_file);
+out:
+	free(ctx->output_file);
+	ctx->output_file = NULL;
+}
+
+/**
+ * Flight-recorder mode: keep the last few seconds of events in memory and
+ * write them out on SIGUSR1 or when a trigger event comes in.
+ */
+static void
+record_ring(struct record_context *ctx,
+	    struct pollfd *fds,
+	    unsigned int nfds)
+{
+	struct record_device *d;
+	int rc;
+
+	fprintf(stderr,
+		"Keeping the last %" PRIu64 "s of events, send SIGUSR1 to %d to save them.\n",
+		ctx->ring.duration/1000000,
+		getpid());
+
+	while (true) {
+		rc = poll(fds, nfds, -1);
+		if (rc == -1) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "Error: %m\n");
+			break;
+		}
+
+		if (fds[0].revents != 0) { /* signal */
+			struct signalfd_siginfo si;
+
+			if (read(fds[0].fd, &si, sizeof(si)) != sizeof(si) ||
+			    si.ssi_signo != SIGUSR1)
+				break;
+
+			fprintf(stderr, "SIGUSR1, saving the ring buffer\n");
+			ctx->ring.dump_pending = true;
+		}
+
+		list_for_each(d, &ctx->devices, link)
+			ring_handle_events(ctx, d);
+
+		/* libinput-internal timeouts (e.g. tapping) */
+		if (ctx->libinput && fds[1].revents) {
+			libinput_dispatch(ctx->libinput);
+			handle_libinput_events(ctx,
+					       list_first_entry(&ctx->devices,
+								d,
+								link));
+		}
+
+		if (ctx->ring.dump_pending) {
+			ring_dump(ctx);
+			ctx->ring.dump_pending = false;
+		}
+	}
+}
+
 static int
 mainloop(struct record_context *ctx)
 {
@@ -2114,7 +2812,6 @@ mainloop(struct record_context *ctx)
 	struct pollfd fds[ctx->ndevices + 2];
 	unsigned int nfds = 0;
 	struct record_device *d = NULL;
-	struct record_device *first_device = NULL;
 	struct timespec ts;
 	sigset_t mask;
 
@@ -2124,6 +2821,8 @@ mainloop(struct record_context *ctx)
 	sigemptyset(&mask);
 	sigaddset(&mask, SIGINT);
 	sigaddset(&mask, SIGQUIT);
+	if (ctx->ring.duration > 0)
+		sigaddset(&mask, SIGUSR1);
 	sigprocmask(SIG_BLOCK, &mask, NULL);
 
 	fds[0].fd = signalfd(-1, &mask, SFD_NONBLOCK);
@@ -2148,17 +2847,22 @@ mainloop(struct record_context *ctx)
 		nfds++;
 	}
 
-	/* If we have more than one device, the time starts at recording
-	 * start time. Otherwise, the first event starts the recording time.
+	/* If we have more than one device or a ring buffer, the time starts
+	 * at recording start time. Otherwise, the first event starts the
+	 * recording time.
 	 */
-	if (ctx->ndevices > 1) {
+	if (ctx->ndevices > 1 || ctx->ring.duration > 0) {
 		clock_gettime(CLOCK_MONOTONIC, &ts);
 		ctx->offset = s2us(ts.tv_sec) + ns2us(ts.tv_nsec);
 	}
 
+	if (ctx->ring.duration > 0) {
+		record_ring(ctx, fds, nfds);
+		goto out;
+	}
+
 	do {
-		int rc;
-		bool had_events = false; /* we delete files without events */
+		bool had_events; /* we delete files without events */
 
 		if (!open_output_file(ctx, autorestart)) {
 			fprintf(stderr,
@@ -2168,104 +2872,12 @@ mainloop(struct record_context *ctx)
 		}
 		fprintf(stderr, "Recording to '%s'.\n", ctx->output_file);
 
-		print_header(ctx);
-		if (autorestart)
-			iprintf(ctx,
-				"# Autorestart timeout: %d\n",
-				ctx->timeout);
-
-		iprintf(ctx, "devices:\n");
-		indent_push(ctx);
-
-		/* we only print the first device's description, the
-		 * rest is assembled after CTRL+C */
-		first_device = list_first_entry(&ctx->devices,
-						first_device,
-						link);
-		print_device_description(ctx, first_device);
-
-		iprintf(ctx, "events:\n");
-		indent_push(ctx);
-
-		if (ctx->libinput) {
-			size_t count;
-			libinput_dispatch(ctx->libinput);
-			count = handle_libinput_events(ctx, first_device);
-			print_cached_events(ctx, first_device, 0, count);
-		}
-
-		while (true) {
-			rc = poll(fds, nfds, ctx->timeout);
-			if (rc == -1) { /* error */
-				fprintf(stderr, "Error: %m\n");
-				autorestart = false;
-				break;
-			} else if (rc == 0) {
-				fprintf(stderr,
-					" ... timeout%s\n",
-					had_events ? "" : " (file is empty)");
-				break;
-			} else if (fds[0].revents != 0) { /* signal */
-				autorestart = false;
-				break;
-			}
-
-			/* Pull off the evdev events first since they cause
-			 * libinput events.
-			 * handle_events de-queues libinput events so by the
-			 * time we finish that, we hopefully have all evdev
-			 * events and libinput events roughly in sync.
-			 */
-			had_events = true;
-			list_for_each(d, &ctx->devices, link)
-				handle_events(ctx, d, d == first_device);
-
-			/* This shouldn't pull any events off unless caused
-			 * by libinput-internal timeouts (e.g. tapping) */
-			if (ctx->libinput && fds[1].revents) {
-				size_t count, offset;
-
-				libinput_dispatch(ctx->libinput);
-				offset = first_device->nevents;
-				count = handle_libinput_events(ctx,
-							       first_device);
-				if (count) {
-					print_cached_events(ctx,
-							    first_device,
-							    offset,
-							    count);
-				}
-				rc--;
-			}
-
-			if (ctx->out_fd != STDOUT_FILENO)
-				print_progress_bar();
-
-		}
-		indent_pop(ctx); /* events: */
-
-		if (autorestart) {
-			noiprintf(ctx,
-				  "# Closing after %ds inactivity",
-				  ctx->timeout/1000);
-		}
-
-		/* First device is printed, now append all the data from the
-		 * other devices, if any */
-		list_for_each(d, &ctx->devices, link) {
-			if (d == list_first_entry(&ctx->devices, d, link))
-				continue;
-
-			print_device_description(ctx, d);
-			iprintf(ctx, "events:\n");
-			indent_push(ctx);
-			print_cached_events(ctx, d, 0, -1);
-			indent_pop(ctx);
-		}
-
-		indent_pop(ctx); /* devices: */
-		assert(ctx->indent == 0);
+		if (ctx->format == FORMAT_BINARY)
+			had_events = record_binary(ctx, fds, nfds, &autorestart);
+		else
+			had_events = record_yaml(ctx, fds, nfds, &autorestart);
 
+		output_flush(ctx);
 		fsync(ctx->out_fd);
 
 		/* If we didn't have events, delete the file. */
@@ -2282,6 +2894,7 @@ mainloop(struct record_context *ctx)
 		ctx->output_file = NULL;
 	} while (autorestart);
 
+out:
 	close(fds[0].fd);
 
 	sigprocmask(SIG_UNBLOCK, &mask, NULL);
@@ -2325,6 +2938,17 @@ init_device(struct record_context *ctx, char *path)
 	if (libevdev_get_num_slots(d->evdev) > 0)
 		d->touch.is_touch_device = true;
 
+	if (ctx->ring.duration > 0) {
+		size_t secs = ctx->ring.duration/1000000;
+
+		ring_init(&d->ring.evdev,
+			  sizeof(struct input_event),
+			  secs * RING_EVDEV_EVENTS_PER_SEC);
+		ring_init(&d->ring.libinput,
+			  sizeof(struct event),
+			  secs * RING_LIBINPUT_EVENTS_PER_SEC);
+	}
+
 	list_insert(&ctx->devices, &d->link);
 	ctx->ndevices++;
 
@@ -2389,7 +3013,7 @@ init_libinput(struct record_context *ctx)
 static inline void
 usage(void)
 {
-	printf("Usage: %s [--help] [--all] [--autorestart] [--output-file filename] [/dev/input/event0] [...]\n"
+	printf("Usage: %s [--help] [--all] [--autorestart] [--format yaml|binary] [--ring seconds [--ring-trigger keys]] [--output-file filename] [/dev/input/event0] [...]\n"
 	       "Common use-cases:\n"
 	       "\n"
 	       " sudo %s -o recording.yml\n"
@@ -2403,14 +3027,53 @@ usage(void)
 	       " sudo %s -o recording.yml /dev/input/event3 /dev/input/event4\n"
 	       "    Records the two devices into the same recordings file.\n"
 	       "\n"
+	       " sudo %s -o recording.yml --ring 30 --ring-trigger KEY_LEFTCTRL+KEY_F12\n"
+	       "    Keeps the last 30s of events in memory, saves them on SIGUSR1,\n"
+	       "    a SYN_DROPPED or when Ctrl+F12 is pressed.\n"
+	       "\n"
+	       " sudo %s --format=binary -o recording.bin /dev/input/event3\n"
+	       "    Records in the compact binary format, see the man page for details.\n"
+	       "\n"
 	       "For more information, see the %s(1) man page\n",
 	       program_invocation_short_name,
 	       program_invocation_short_name,
 	       program_invocation_short_name,
 	       program_invocation_short_name,
+	       program_invocation_short_name,
+	       program_invocation_short_name,
 	       program_invocation_short_name);
 }
 
+/**
+ * Parse a list of key names like KEY_LEFTCTRL+KEY_F12.
+ */
+static inline bool
+parse_trigger_keys(struct record_context *ctx, const char *str)
+{
+	char **keys;
+	size_t nkeys = 0;
+	bool rc = false;
+
+	keys = strv_from_string(str, "+");
+	if (!keys)
+		return false;
+
+	for (char **k = keys; *k; k++) {
+		int code = libevdev_event_code_from_name(EV_KEY, *k);
+
+		if (code == -1 || nkeys >= ARRAY_LENGTH(ctx->ring.trigger_keys))
+			goto out;
+
+		ctx->ring.trigger_keys[nkeys++] = code;
+	}
+
+	ctx->ring.ntrigger_keys = nkeys;
+	rc = nkeys > 0;
+out:
+	strv_free(keys);
+	return rc;
+}
+
 enum ftype {
 	F_FILE = 8,
 	F_DEVICE,
@@ -2441,6 +3104,9 @@ enum options {
 	OPT_MULTIPLE,
 	OPT_ALL,
 	OPT_LIBINPUT,
+	OPT_FORMAT,
+	OPT_RING,
+	OPT_RING_TRIGGER,
 };
 
 int
@@ -2458,6 +3124,9 @@ main(int argc, char **argv)
 		{ "all", no_argument, 0, OPT_ALL },
 		{ "help", no_argument, 0, OPT_HELP },
 		{ "with-libinput", no_argument, 0, OPT_LIBINPUT },
+		{ "format", required_argument, 0, OPT_FORMAT },
+		{ "ring", required_argument, 0, OPT_RING },
+		{ "ring-trigger", required_argument, 0, OPT_RING_TRIGGER },
 		{ 0, 0, 0, 0 },
 	};
 	struct record_device *d, *tmp;
@@ -2506,6 +3175,37 @@ main(int argc, char **argv)
 		case OPT_LIBINPUT:
 			with_libinput = true;
 			break;
+		case OPT_FORMAT:
+			if (streq(optarg, "yaml")) {
+				ctx.format = FORMAT_YAML;
+			} else if (streq(optarg, "binary")) {
+				ctx.format = FORMAT_BINARY;
+			} else {
+				usage();
+				rc = EXIT_INVALID_USAGE;
+				goto out;
+			}
+			break;
+		case OPT_RING: {
+			int secs;
+
+			if (!safe_atoi(optarg, &secs) || secs <= 0) {
+				usage();
+				rc = EXIT_INVALID_USAGE;
+				goto out;
+			}
+			ctx.ring.duration = s2us(secs);
+			break;
+		}
+		case OPT_RING_TRIGGER:
+			if (!parse_trigger_keys(&ctx, optarg)) {
+				fprintf(stderr,
+					"Invalid trigger keys '%s'\n",
+					optarg);
+				rc = EXIT_INVALID_USAGE;
+				goto out;
+			}
+			break;
 		default:
 			usage();
 			rc = EXIT_INVALID_USAGE;
@@ -2586,6 +3286,43 @@ main(int argc, char **argv)
 		goto out;
 	}
 
+	if (ctx.ring.duration > 0) {
+		if (output_arg == NULL) {
+			fprintf(stderr,
+				"Option --ring requires --output-file\n");
+			rc = EXIT_INVALID_USAGE;
+			goto out;
+		}
+
+		if (ctx.timeout > 0 || ctx.format != FORMAT_YAML) {
+			fprintf(stderr,
+				"Option --ring cannot be combined with --autorestart or --format\n");
+			rc = EXIT_INVALID_USAGE;
+			goto out;
+		}
+	} else if (ctx.ring.ntrigger_keys > 0) {
+		fprintf(stderr,
+			"Option --ring-trigger requires --ring\n");
+		rc = EXIT_INVALID_USAGE;
+		goto out;
+	}
+
+	if (ctx.format == FORMAT_BINARY) {
+		if (with_libinput) {
+			fprintf(stderr,
+				"Option --with-libinput is not supported by the binary format\n");
+			rc = EXIT_INVALID_USAGE;
+			goto out;
+		}
+
+		if (output_arg == NULL && isatty(STDOUT_FILENO)) {
+			fprintf(stderr,
+				"Refusing to write a binary recording to a terminal\n");
+			rc = EXIT_INVALID_USAGE;
+			goto out;
+		}
+	}
+
 	ctx.outfile = safe_strdup(output_arg);
 
 	if (all) {
@@ -2647,10 +3384,13 @@ out:
 			libinput_device_unref(d->device);
 		free(d->events);
 		free(d->devnode);
+		ring_destroy(&d->ring.evdev);
+		ring_destroy(&d->ring.libinput);
 		libevdev_free(d->evdev);
 	}
 
 	libinput_unref(ctx.libinput);
+	free(ctx.outbuf.data);
 
 	return rc;
 }
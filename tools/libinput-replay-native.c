@@ -0,0 +1,399 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <libevdev/libevdev.h>
+#include <libevdev/libevdev-uinput.h>
+#include <libinput.h>
+
+#include "shared.h"
+#include "recording.h"
+#include "util-macros.h"
+#include "util-strings.h"
+#include "util-time.h"
+
+/* clock_nanosleep() wakes us up this early, the rest is spent in a busy
+ * loop to get the timing right */
+#define SPIN_TAIL_NS (200 * 1000)
+
+struct replay_context {
+	struct recording *recording;
+	struct libevdev_uinput **uinputs;
+
+	/* all devices' frames, in timestamp order */
+	struct recording_frame **timeline;
+	size_t nframes;
+
+	double speed;
+	bool verbose;
+
+	/* --in-process: events are pushed into a libinput replay context,
+	 * the uinput devices are only used to set up the libinput devices */
+	bool in_process;
+	bool fast;
+	struct libinput *libinput;
+	struct libinput_device **devices;
+	uint64_t clock; /* last replayed time in µs */
+};
+
+static inline uint64_t
+now_in_ns(void)
+{
+	struct timespec ts = { 0, 0 };
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return s2us(ts.tv_sec) * 1000 + ts.tv_nsec;
+}
+
+static void
+wait_until(uint64_t target)
+{
+	if (target > now_in_ns() + SPIN_TAIL_NS) {
+		uint64_t wakeup = target - SPIN_TAIL_NS;
+		struct timespec ts = {
+			.tv_sec = wakeup / 1000000000,
+			.tv_nsec = wakeup % 1000000000,
+		};
+
+		while (clock_nanosleep(CLOCK_MONOTONIC,
+				       TIMER_ABSTIME,
+				       &ts,
+				       NULL) == EINTR)
+			;
+	}
+
+	while (now_in_ns() < target)
+		;
+}
+
+static void
+print_frame(struct replay_context *ctx, struct recording_frame *frame)
+{
+	struct recording_device *d = &ctx->recording->devices[frame->device];
+	const char *devnode = libevdev_uinput_get_devnode(ctx->uinputs[frame->device]);
+	const char *sysname = devnode ? strrchr(devnode, '/') : NULL;
+
+	sysname = sysname ? sysname + 1 : "?";
+
+	for (size_t i = 0; i < frame->nevents; i++) {
+		struct recording_event *e = &d->events[frame->first_event + i];
+		const char *tname = libevdev_event_type_get_name(e->type),
+			   *cname = libevdev_event_code_get_name(e->type, e->code);
+
+		printf("%s: %*s%06" PRIu64 ".%06" PRIu64 " %s / %-20s %4d\n",
+		       sysname,
+		       frame->device * 8, "",
+		       frame->time / 1000000,
+		       frame->time % 1000000,
+		       tname ? tname : "?",
+		       cname ? cname : "?",
+		       e->value);
+	}
+}
+
+static void
+replay(struct replay_context *ctx)
+{
+	uint64_t start, t0, max_latency = 0, total_latency = 0;
+
+	if (ctx->nframes == 0)
+		return;
+
+	/* All devices start at the same time, the first event on any
+	 * device is replayed immediately */
+	t0 = ctx->timeline[0]->time;
+	start = now_in_ns();
+
+	for (size_t i = 0; i < ctx->nframes; i++) {
+		struct recording_frame *frame = ctx->timeline[i];
+		struct recording_device *d = &ctx->recording->devices[frame->device];
+		struct libevdev_uinput *uinput = ctx->uinputs[frame->device];
+		uint64_t target, latency;
+
+		target = start + (frame->time - t0) * 1000 / ctx->speed;
+		wait_until(target);
+
+		latency = now_in_ns() - target;
+		max_latency = max(max_latency, latency);
+		total_latency += latency;
+
+		for (size_t e = 0; e < frame->nevents; e++) {
+			struct recording_event *ev = &d->events[frame->first_event + e];
+
+			libevdev_uinput_write_event(uinput,
+						    ev->type,
+						    ev->code,
+						    ev->value);
+		}
+
+		if (ctx->verbose)
+			print_frame(ctx, frame);
+	}
+
+	fprintf(stderr,
+		"Replayed %zu frames, latency avg %" PRIu64 "us, max %" PRIu64 "us\n",
+		ctx->nframes,
+		total_latency / ctx->nframes / 1000,
+		max_latency / 1000);
+}
+
+static size_t
+drain_events(struct libinput *li)
+{
+	struct libinput_event *event;
+	size_t count = 0;
+
+	while ((event = libinput_get_event(li))) {
+		libinput_event_destroy(event);
+		count++;
+	}
+
+	return count;
+}
+
+static bool
+open_in_process(struct replay_context *ctx)
+{
+	ctx->libinput = recording_create_replay_context(ctx->recording,
+							ctx->uinputs,
+							ctx->verbose,
+							&ctx->devices);
+
+	return ctx->libinput != NULL;
+}
+
+static void
+replay_in_process(struct replay_context *ctx)
+{
+	uint64_t begin, start, t0, time = 0, elapsed;
+	size_t nevents = 0;
+
+	if (ctx->nframes == 0)
+		return;
+
+	begin = now_in_ns();
+
+	/* The context's clock must never go backwards, with --fast it
+	 * runs ahead of CLOCK_MONOTONIC */
+	t0 = ctx->timeline[0]->time;
+	start = max(begin, ctx->clock * 1000);
+
+	for (size_t i = 0; i < ctx->nframes; i++) {
+		struct recording_frame *frame = ctx->timeline[i];
+		struct recording_device *d = &ctx->recording->devices[frame->device];
+		struct libinput_device *device = ctx->devices[frame->device];
+		uint64_t offset;
+
+		if (!device)
+			continue;
+
+		offset = (frame->time - t0) * 1000 / ctx->speed;
+		if (!ctx->fast)
+			wait_until(start + offset);
+
+		time = (start + offset) / 1000;
+		for (size_t e = 0; e < frame->nevents; e++) {
+			struct recording_event *ev = &d->events[frame->first_event + e];
+
+			libinput_replay_device_push_event(device,
+							  time,
+							  ev->type,
+							  ev->code,
+							  ev->value);
+		}
+		nevents += drain_events(ctx->libinput);
+
+		if (ctx->verbose)
+			print_frame(ctx, frame);
+	}
+
+	/* Let the timeouts expire, e.g. a tap or a pending button release */
+	ctx->clock = time + s2us(5);
+	libinput_replay_advance_time(ctx->libinput, ctx->clock);
+	nevents += drain_events(ctx->libinput);
+
+	elapsed = max(now_in_ns() - begin, (uint64_t)1);
+	fprintf(stderr,
+		"Replayed %zu frames in %" PRIu64 "ms (%.0f frames/s), %zu libinput events\n",
+		ctx->nframes,
+		elapsed / 1000000,
+		ctx->nframes * 1e9 / elapsed,
+		nevents);
+}
+
+static inline void
+usage(void)
+{
+	printf("Usage: libinput replay-native [--help] [--verbose] [--once] [--speed=<factor>] [--in-process [--fast]] recording\n"
+	       "\n"
+	       "Replay a recording made by libinput record, in the YAML or binary format.\n"
+	       "\n"
+	       "Options:\n"
+	       "  --verbose ........ print the events while replaying\n"
+	       "  --once ........... replay once, without waiting for user input\n"
+	       "  --speed=<factor> . replay at factor times the recorded speed\n"
+	       "  --in-process ..... feed the events into a libinput context in this\n"
+	       "                     process instead of through the kernel\n"
+	       "  --fast ........... with --in-process, replay as fast as possible\n");
+}
+
+enum options {
+	OPT_HELP,
+	OPT_VERBOSE,
+	OPT_ONCE,
+	OPT_REPLAY_SPEED,
+	OPT_IN_PROCESS,
+	OPT_FAST,
+};
+
+int
+main(int argc, char **argv)
+{
+	struct replay_context ctx = {
+		.speed = 1.0,
+		.verbose = false,
+	};
+	struct option opts[] = {
+		{ "help", no_argument, 0, OPT_HELP },
+		{ "verbose", no_argument, 0, OPT_VERBOSE },
+		{ "once", no_argument, 0, OPT_ONCE },
+		{ "speed", required_argument, 0, OPT_REPLAY_SPEED },
+		{ "in-process", no_argument, 0, OPT_IN_PROCESS },
+		{ "fast", no_argument, 0, OPT_FAST },
+		{ 0, 0, 0, 0 },
+	};
+	bool once = false;
+	int rc = EXIT_FAILURE;
+
+	while (1) {
+		int c;
+		int option_index = 0;
+
+		c = getopt_long(argc, argv, "h", opts, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+		case OPT_HELP:
+			usage();
+			return EXIT_SUCCESS;
+		case OPT_VERBOSE:
+			ctx.verbose = true;
+			break;
+		case OPT_ONCE:
+			once = true;
+			break;
+		case OPT_REPLAY_SPEED:
+			if (!safe_atod(optarg, &ctx.speed) || ctx.speed <= 0.0) {
+				usage();
+				return EXIT_INVALID_USAGE;
+			}
+			break;
+		case OPT_IN_PROCESS:
+			ctx.in_process = true;
+			break;
+		case OPT_FAST:
+			ctx.fast = true;
+			break;
+		default:
+			usage();
+			return EXIT_INVALID_USAGE;
+		}
+	}
+
+	if (ctx.fast && !ctx.in_process) {
+		fprintf(stderr, "Option --fast requires --in-process\n");
+		return EXIT_INVALID_USAGE;
+	}
+
+	if (optind != argc - 1) {
+		usage();
+		return EXIT_INVALID_USAGE;
+	}
+
+	ctx.recording = recording_load(argv[optind]);
+	if (!ctx.recording)
+		return EXIT_FAILURE;
+
+	ctx.timeline = recording_build_timeline(ctx.recording, &ctx.nframes);
+
+	ctx.uinputs = zalloc(ctx.recording->ndevices * sizeof(*ctx.uinputs));
+	for (size_t i = 0; i < ctx.recording->ndevices; i++) {
+		ctx.uinputs[i] = recording_device_create_uinput(&ctx.recording->devices[i]);
+		if (!ctx.uinputs[i])
+			goto out;
+
+		printf("%s: %s\n",
+		       libevdev_uinput_get_devnode(ctx.uinputs[i]),
+		       ctx.recording->devices[i].name);
+	}
+
+	if (ctx.in_process && !open_in_process(&ctx))
+		goto out;
+
+	do {
+		if (!once) {
+			char buf[64];
+
+			printf("Hit enter to start replaying");
+			fflush(stdout);
+			if (!fgets(buf, sizeof(buf), stdin))
+				break;
+		}
+
+		if (ctx.in_process)
+			replay_in_process(&ctx);
+		else
+			replay(&ctx);
+	} while (!once);
+
+	rc = EXIT_SUCCESS;
+out:
+	if (ctx.devices) {
+		for (size_t i = 0; i < ctx.recording->ndevices; i++) {
+			if (ctx.devices[i])
+				libinput_device_unref(ctx.devices[i]);
+		}
+		free(ctx.devices);
+	}
+	if (ctx.libinput)
+		libinput_unref(ctx.libinput);
+	for (size_t i = 0; i < ctx.recording->ndevices; i++) {
+		if (ctx.uinputs[i])
+			libevdev_uinput_destroy(ctx.uinputs[i]);
+	}
+	free(ctx.uinputs);
+	free(ctx.timeline);
+	recording_free(ctx.recording);
+
+	return rc;
+}
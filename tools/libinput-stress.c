@@ -0,0 +1,1001 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <libevdev/libevdev-uinput.h>
+#include <libinput.h>
+
+#include "libinput-version.h"
+#include "libinput-git-version.h"
+#include "shared.h"
+#include "util-macros.h"
+#include "util-strings.h"
+#include "util-time.h"
+
+#define STRESS_MAX_DEVICES 256
+#define STRESS_MAX_RATE 10000 /* Hz */
+
+struct stress_device;
+
+/* The device descriptions follow the litest devices of the same name,
+ * trimmed to what the generated events use */
+struct stress_template {
+	const char *name;
+	const char *device_name;
+	struct input_id id;
+	const int *events; /* type/code pairs, INPUT_PROP_MAX for props */
+	const struct input_absinfo *absinfo; /* terminated by .value = -1 */
+	unsigned int slots; /* 0 if not a multitouch device */
+	bool finger_tools; /* BTN_TOOL_FINGER and friends */
+	void (*frame)(struct stress_device *d, unsigned int fingers);
+};
+
+struct stress_device {
+	const struct stress_template *template;
+	struct libevdev_uinput *uinput;
+	struct libinput_device *device; /* --in-process only */
+
+	uint64_t due; /* time of the next frame in µs */
+	uint64_t nframes;
+	unsigned int cycle; /* frames per touch or proximity sequence */
+	int tracking_id;
+
+	struct input_event events[64];
+	size_t nevents;
+};
+
+struct stress_step {
+	unsigned int ndevices;
+	unsigned int rate;
+	uint64_t wall; /* µs */
+	uint64_t cpu; /* ns of thread time in libinput */
+	uint64_t frames;
+	uint64_t frames_missed;
+	uint64_t evdev_events;
+	uint64_t libinput_events;
+	uint64_t lag_max; /* µs the generator was behind schedule */
+	size_t batch_peak; /* most events retrieved after one dispatch */
+	uint64_t queue_peak;
+
+	uint32_t *latencies; /* µs */
+	size_t nlatencies;
+	size_t latencies_size;
+};
+
+struct stress {
+	struct stress_device *devices;
+	unsigned int ndevices;
+	unsigned int fingers;
+	unsigned int duration; /* s */
+	bool in_process;
+	bool verbose;
+
+	struct libinput *libinput;
+};
+
+static inline uint64_t
+cpu_now_in_ns(void)
+{
+	struct timespec ts = { 0, 0 };
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+	return s2us(ts.tv_sec) * 1000 + ts.tv_nsec;
+}
+
+static inline void
+emit(struct stress_device *d, unsigned int type, unsigned int code, int value)
+{
+	struct input_event *ev;
+
+	assert(d->nevents < ARRAY_LENGTH(d->events));
+
+	ev = &d->events[d->nevents++];
+	ev->type = type;
+	ev->code = code;
+	ev->value = value;
+}
+
+static const struct input_absinfo *
+template_absinfo(const struct stress_template *t, unsigned int code)
+{
+	for (const struct input_absinfo *a = t->absinfo; a && a->value != -1; a++) {
+		if ((unsigned int)a->value == code)
+			return a;
+	}
+
+	abort();
+}
+
+/* A position along the axis, frac in [0, 1] */
+static inline int
+axis_position(const struct stress_template *t, unsigned int code, double frac)
+{
+	const struct input_absinfo *a = template_absinfo(t, code);
+
+	return a->minimum + (int)((a->maximum - a->minimum) * frac);
+}
+
+/* The fraction of a closed square path for frame n */
+static inline void
+square_path(uint64_t n, unsigned int cycle, double *x, double *y)
+{
+	double f = (double)(n % cycle) / cycle * 4;
+
+	if (f < 1) {
+		*x = f;
+		*y = 0;
+	} else if (f < 2) {
+		*x = 1;
+		*y = f - 1;
+	} else if (f < 3) {
+		*x = 3 - f;
+		*y = 1;
+	} else {
+		*x = 0;
+		*y = 4 - f;
+	}
+}
+
+static void
+mouse_frame(struct stress_device *d, unsigned int fingers)
+{
+	static const int dirs[][2] = {
+		{ 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 },
+	};
+	const int *dir = dirs[(d->nframes / 16) % ARRAY_LENGTH(dirs)];
+
+	emit(d, EV_REL, REL_X, 3 * dir[0]);
+	emit(d, EV_REL, REL_Y, 3 * dir[1]);
+	if (d->nframes % 32 == 31)
+		emit(d, EV_REL, REL_WHEEL, d->nframes % 64 == 63 ? 1 : -1);
+}
+
+/* Only the shift keys so the generated events don't type into whatever
+ * else listens to the device */
+static void
+keyboard_frame(struct stress_device *d, unsigned int fingers)
+{
+	unsigned int key = (d->nframes / 2) % 2 ? KEY_RIGHTSHIFT : KEY_LEFTSHIFT;
+
+	emit(d, EV_KEY, key, d->nframes % 2 == 0);
+}
+
+/* Fingers down on the first frame of the cycle, moving along a square
+ * and lifted on the last frame */
+static void
+touch_frame(struct stress_device *d, unsigned int fingers)
+{
+	const struct stress_template *t = d->template;
+	unsigned int phase = d->nframes % d->cycle;
+	bool down = phase == 0;
+	bool up = phase == d->cycle - 1;
+	int x0 = 0, y0 = 0;
+
+	fingers = min(fingers, t->slots);
+
+	for (unsigned int f = 0; f < fingers; f++) {
+		double px, py;
+		int x, y;
+
+		square_path(phase, d->cycle, &px, &py);
+		x = axis_position(t, ABS_MT_POSITION_X,
+				  0.2 + 0.6 * (f + px * 0.5) / fingers);
+		y = axis_position(t, ABS_MT_POSITION_Y, 0.3 + 0.4 * py);
+		if (f == 0) {
+			x0 = x;
+			y0 = y;
+		}
+
+		emit(d, EV_ABS, ABS_MT_SLOT, f);
+		if (up) {
+			emit(d, EV_ABS, ABS_MT_TRACKING_ID, -1);
+			continue;
+		}
+		if (down) {
+			d->tracking_id = (d->tracking_id + 1) & 0xffff;
+			emit(d, EV_ABS, ABS_MT_TRACKING_ID, d->tracking_id);
+		}
+		emit(d, EV_ABS, ABS_MT_POSITION_X, x);
+		emit(d, EV_ABS, ABS_MT_POSITION_Y, y);
+	}
+
+	if (down || up) {
+		static const unsigned int tools[] = {
+			BTN_TOOL_FINGER,
+			BTN_TOOL_DOUBLETAP,
+			BTN_TOOL_TRIPLETAP,
+			BTN_TOOL_QUADTAP,
+			BTN_TOOL_QUINTTAP,
+		};
+
+		emit(d, EV_KEY, BTN_TOUCH, down);
+		if (t->finger_tools)
+			emit(d, EV_KEY, tools[min(fingers, ARRAY_LENGTH(tools)) - 1], down);
+	}
+	if (!up) {
+		emit(d, EV_ABS, ABS_X, x0);
+		emit(d, EV_ABS, ABS_Y, y0);
+	}
+}
+
+/* A pen hovering in proximity, in on the first frame of the cycle and
+ * out on the last one */
+static void
+tablet_frame(struct stress_device *d, unsigned int fingers)
+{
+	const struct stress_template *t = d->template;
+	unsigned int phase = d->nframes % d->cycle;
+	double px, py;
+
+	if (phase == d->cycle - 1) {
+		emit(d, EV_ABS, ABS_X, 0);
+		emit(d, EV_ABS, ABS_Y, 0);
+		emit(d, EV_ABS, ABS_DISTANCE, 0);
+		emit(d, EV_ABS, ABS_MISC, 0);
+		emit(d, EV_KEY, BTN_TOOL_PEN, 0);
+		emit(d, EV_MSC, MSC_SERIAL, 0x1234);
+		return;
+	}
+
+	square_path(phase, d->cycle, &px, &py);
+	emit(d, EV_ABS, ABS_X, axis_position(t, ABS_X, 0.25 + 0.5 * px));
+	emit(d, EV_ABS, ABS_Y, axis_position(t, ABS_Y, 0.25 + 0.5 * py));
+	emit(d, EV_ABS, ABS_DISTANCE, axis_position(t, ABS_DISTANCE, 0.2 + 0.1 * px));
+	emit(d, EV_ABS, ABS_TILT_X, axis_position(t, ABS_TILT_X, 0.4 + 0.2 * py));
+	emit(d, EV_ABS, ABS_TILT_Y, axis_position(t, ABS_TILT_Y, 0.5));
+	if (phase == 0) {
+		emit(d, EV_ABS, ABS_MISC, 1050626);
+		emit(d, EV_KEY, BTN_TOOL_PEN, 1);
+	}
+	emit(d, EV_MSC, MSC_SERIAL, 0x1234);
+}
+
+static const int mouse_events[] = {
+	EV_KEY, BTN_LEFT,
+	EV_KEY, BTN_RIGHT,
+	EV_KEY, BTN_MIDDLE,
+	EV_REL, REL_X,
+	EV_REL, REL_Y,
+	EV_REL, REL_WHEEL,
+	-1, -1,
+};
+
+/* udev needs the first block of keys to tag the device as keyboard */
+static const int keyboard_events[] = {
+	EV_KEY, KEY_ESC,
+	EV_KEY, KEY_1, EV_KEY, KEY_2, EV_KEY, KEY_3, EV_KEY, KEY_4,
+	EV_KEY, KEY_5, EV_KEY, KEY_6, EV_KEY, KEY_7, EV_KEY, KEY_8,
+	EV_KEY, KEY_9, EV_KEY, KEY_0,
+	EV_KEY, KEY_MINUS, EV_KEY, KEY_EQUAL, EV_KEY, KEY_BACKSPACE,
+	EV_KEY, KEY_TAB,
+	EV_KEY, KEY_Q, EV_KEY, KEY_W, EV_KEY, KEY_E, EV_KEY, KEY_R,
+	EV_KEY, KEY_T, EV_KEY, KEY_Y, EV_KEY, KEY_U, EV_KEY, KEY_I,
+	EV_KEY, KEY_O, EV_KEY, KEY_P,
+	EV_KEY, KEY_LEFTBRACE, EV_KEY, KEY_RIGHTBRACE, EV_KEY, KEY_ENTER,
+	EV_KEY, KEY_LEFTCTRL,
+	EV_KEY, KEY_A, EV_KEY, KEY_S, EV_KEY, KEY_D,
+	EV_KEY, KEY_LEFTSHIFT,
+	EV_KEY, KEY_RIGHTSHIFT,
+	EV_KEY, KEY_SPACE,
+	-1, -1,
+};
+
+static const int touchpad_events[] = {
+	EV_KEY, BTN_LEFT,
+	EV_KEY, BTN_TOUCH,
+	EV_KEY, BTN_TOOL_FINGER,
+	EV_KEY, BTN_TOOL_DOUBLETAP,
+	EV_KEY, BTN_TOOL_TRIPLETAP,
+	EV_KEY, BTN_TOOL_QUADTAP,
+	EV_KEY, BTN_TOOL_QUINTTAP,
+	INPUT_PROP_MAX, INPUT_PROP_POINTER,
+	INPUT_PROP_MAX, INPUT_PROP_BUTTONPAD,
+	-1, -1,
+};
+
+static const struct input_absinfo touchpad_absinfo[] = {
+	{ ABS_X, 0, 1940, 0, 0, 20 },
+	{ ABS_Y, 0, 1062, 0, 0, 20 },
+	{ ABS_MT_SLOT, 0, 4, 0, 0, 0 },
+	{ ABS_MT_POSITION_X, 0, 1940, 0, 0, 20 },
+	{ ABS_MT_POSITION_Y, 0, 1062, 0, 0, 20 },
+	{ ABS_MT_TRACKING_ID, 0, 65535, 0, 0, 0 },
+	{ .value = -1 },
+};
+
+static const int touchscreen_events[] = {
+	EV_KEY, BTN_TOUCH,
+	INPUT_PROP_MAX, INPUT_PROP_DIRECT,
+	-1, -1,
+};
+
+static const struct input_absinfo touchscreen_absinfo[] = {
+	{ ABS_X, 0, 1500, 0, 0, 0 },
+	{ ABS_Y, 0, 2500, 0, 0, 0 },
+	{ ABS_MT_SLOT, 0, 9, 0, 0, 0 },
+	{ ABS_MT_POSITION_X, 0, 1500, 0, 0, 0 },
+	{ ABS_MT_POSITION_Y, 0, 2500, 0, 0, 0 },
+	{ ABS_MT_TRACKING_ID, 0, 65535, 0, 0, 0 },
+	{ .value = -1 },
+};
+
+static const int tablet_events[] = {
+	EV_KEY, BTN_TOOL_PEN,
+	EV_KEY, BTN_TOOL_RUBBER,
+	EV_KEY, BTN_TOUCH,
+	EV_KEY, BTN_STYLUS,
+	EV_KEY, BTN_STYLUS2,
+	EV_MSC, MSC_SERIAL,
+	INPUT_PROP_MAX, INPUT_PROP_POINTER,
+	-1, -1,
+};
+
+static const struct input_absinfo tablet_absinfo[] = {
+	{ ABS_X, 0, 44704, 4, 0, 200 },
+	{ ABS_Y, 0, 27940, 4, 0, 200 },
+	{ ABS_PRESSURE, 0, 2047, 0, 0, 0 },
+	{ ABS_DISTANCE, 0, 63, 0, 0, 0 },
+	{ ABS_TILT_X, 0, 127, 0, 0, 0 },
+	{ ABS_TILT_Y, 0, 127, 0, 0, 0 },
+	{ ABS_MISC, 0, 0, 0, 0, 0 },
+	{ .value = -1 },
+};
+
+static const struct stress_template templates[] = {
+	{
+		.name = "mouse",
+		.device_name = "Lenovo Optical USB Mouse",
+		.id = { .bustype = 0x3, .vendor = 0x17ef, .product = 0x6019 },
+		.events = mouse_events,
+		.frame = mouse_frame,
+	},
+	{
+		.name = "keyboard",
+		.device_name = "AT Translated Set 2 keyboard",
+		.id = { .bustype = 0x11, .vendor = 0x1, .product = 0x1 },
+		.events = keyboard_events,
+		.frame = keyboard_frame,
+	},
+	{
+		.name = "touchpad",
+		.device_name = "Synaptics TM3053-004",
+		.id = { .bustype = 0x1d, .vendor = 0x6cb, .product = 0x0 },
+		.events = touchpad_events,
+		.absinfo = touchpad_absinfo,
+		.slots = 5,
+		.finger_tools = true,
+		.frame = touch_frame,
+	},
+	{
+		.name = "touchscreen",
+		.device_name = "Generic Multitouch Touchscreen",
+		.id = { .bustype = 0x3, .vendor = 0x22, .product = 0x33 },
+		.events = touchscreen_events,
+		.absinfo = touchscreen_absinfo,
+		.slots = 10,
+		.frame = touch_frame,
+	},
+	{
+		.name = "tablet",
+		.device_name = "Wacom Intuos5 touch M Pen",
+		.id = { .bustype = 0x3, .vendor = 0x56a, .product = 0x27 },
+		.events = tablet_events,
+		.absinfo = tablet_absinfo,
+		.frame = tablet_frame,
+	},
+};
+
+static const struct stress_template *
+template_by_name(const char *name)
+{
+	for (size_t i = 0; i < ARRAY_LENGTH(templates); i++) {
+		if (streq(templates[i].name, name))
+			return &templates[i];
+	}
+
+	return NULL;
+}
+
+static struct libevdev_uinput *
+template_create_uinput(const struct stress_template *t)
+{
+	struct libevdev *dev;
+	struct libevdev_uinput *uinput = NULL;
+	int rc;
+
+	dev = libevdev_new();
+	libevdev_set_name(dev, t->device_name);
+	libevdev_set_id_bustype(dev, t->id.bustype);
+	libevdev_set_id_vendor(dev, t->id.vendor);
+	libevdev_set_id_product(dev, t->id.product);
+
+	for (const int *e = t->events; *e != -1; e += 2) {
+		if (*e == INPUT_PROP_MAX)
+			libevdev_enable_property(dev, e[1]);
+		else
+			libevdev_enable_event_code(dev, e[0], e[1], NULL);
+	}
+
+	for (const struct input_absinfo *a = t->absinfo; a && a->value != -1; a++) {
+		struct input_absinfo abs = *a;
+
+		abs.value = 0;
+		libevdev_enable_event_code(dev, EV_ABS, a->value, &abs);
+	}
+
+	rc = libevdev_uinput_create_from_device(dev,
+						LIBEVDEV_UINPUT_OPEN_MANAGED,
+						&uinput);
+	if (rc != 0)
+		fprintf(stderr,
+			"Failed to create uinput device for %s: %s\n",
+			t->name,
+			strerror(-rc));
+	libevdev_free(dev);
+
+	return rc == 0 ? uinput : NULL;
+}
+
+static uint64_t
+event_time_usec(struct libinput_event *event)
+{
+	switch (libinput_event_get_type(event)) {
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		return libinput_event_keyboard_get_time_usec(
+				libinput_event_get_keyboard_event(event));
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+	case LIBINPUT_EVENT_POINTER_AXIS:
+	case LIBINPUT_EVENT_POINTER_FRAME:
+		return libinput_event_pointer_get_time_usec(
+				libinput_event_get_pointer_event(event));
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+	case LIBINPUT_EVENT_TOUCH_UP:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		return libinput_event_touch_get_time_usec(
+				libinput_event_get_touch_event(event));
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
+	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
+	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
+	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
+		return libinput_event_tablet_tool_get_time_usec(
+				libinput_event_get_tablet_tool_event(event));
+	case LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_END:
+	case LIBINPUT_EVENT_GESTURE_PINCH_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_PINCH_END:
+		return libinput_event_gesture_get_time_usec(
+				libinput_event_get_gesture_event(event));
+	default:
+		return 0;
+	}
+}
+
+static void
+step_add_latency(struct stress_step *step, uint64_t latency)
+{
+	if (step->nlatencies == step->latencies_size) {
+		step->latencies_size = max(step->latencies_size * 2, 4096);
+		step->latencies = realloc(step->latencies,
+					  step->latencies_size * sizeof(*step->latencies));
+		if (!step->latencies)
+			abort();
+	}
+
+	step->latencies[step->nlatencies++] = min(latency, UINT32_MAX);
+}
+
+/* Retrieve all queued events, the end-to-end latency of an event is the
+ * time from its evdev timestamp until the caller gets it */
+static void
+drain_events(struct stress *s, struct stress_step *step)
+{
+	struct libinput_event *event;
+	size_t count = 0;
+
+	while ((event = libinput_get_event(s->libinput))) {
+		uint64_t time = event_time_usec(event);
+		uint64_t now = now_in_us();
+
+		if (time != 0 && time <= now)
+			step_add_latency(step, now - time);
+
+		libinput_event_destroy(event);
+		count++;
+	}
+
+	step->libinput_events += count;
+	step->batch_peak = max(step->batch_peak, count);
+}
+
+static void
+dispatch(struct stress *s, struct stress_step *step)
+{
+	uint64_t begin = cpu_now_in_ns();
+
+	libinput_dispatch(s->libinput);
+	drain_events(s, step);
+
+	step->cpu += cpu_now_in_ns() - begin;
+}
+
+static void
+send_frame(struct stress *s, struct stress_step *step, struct stress_device *d)
+{
+	d->nevents = 0;
+	d->template->frame(d, s->fingers);
+	emit(d, EV_SYN, SYN_REPORT, 0);
+	d->nframes++;
+
+	step->frames++;
+	step->evdev_events += d->nevents;
+
+	if (s->in_process) {
+		uint64_t begin = cpu_now_in_ns();
+		uint64_t time = now_in_us();
+
+		for (size_t i = 0; i < d->nevents; i++) {
+			struct input_event *ev = &d->events[i];
+
+			libinput_replay_device_push_event(d->device,
+							  time,
+							  ev->type,
+							  ev->code,
+							  ev->value);
+		}
+		drain_events(s, step);
+		step->cpu += cpu_now_in_ns() - begin;
+	} else {
+		for (size_t i = 0; i < d->nevents; i++) {
+			struct input_event *ev = &d->events[i];
+
+			libevdev_uinput_write_event(d->uinput,
+						    ev->type,
+						    ev->code,
+						    ev->value);
+		}
+	}
+}
+
+static struct libinput *
+stress_create_context(struct stress *s, unsigned int ndevices)
+{
+	struct libinput *li;
+	struct libinput_event *event;
+	const char **paths;
+
+	paths = zalloc((ndevices + 1) * sizeof(*paths));
+	for (unsigned int i = 0; i < ndevices; i++)
+		paths[i] = libevdev_uinput_get_devnode(s->devices[i].uinput);
+
+	li = tools_open_backend(s->in_process ? BACKEND_REPLAY : BACKEND_DEVICE,
+				paths,
+				s->verbose,
+				NULL);
+	free(paths);
+	if (!li)
+		return NULL;
+
+	/* With --in-process the events are pushed into the libinput devices,
+	 * map them back to our devices */
+	libinput_dispatch(li);
+	while ((event = libinput_get_event(li))) {
+		struct libinput_device *device = libinput_event_get_device(event);
+		const char *sysname = libinput_device_get_sysname(device);
+
+		for (unsigned int i = 0; s->in_process && i < ndevices; i++) {
+			struct stress_device *d = &s->devices[i];
+			const char *devnode = libevdev_uinput_get_devnode(d->uinput);
+			const char *sep = devnode ? strrchr(devnode, '/') : NULL;
+
+			if (libinput_event_get_type(event) == LIBINPUT_EVENT_DEVICE_ADDED &&
+			    sep && streq(sep + 1, sysname) && !d->device)
+				d->device = libinput_device_ref(device);
+		}
+		libinput_event_destroy(event);
+	}
+
+	return li;
+}
+
+static void
+stress_destroy_context(struct stress *s)
+{
+	for (unsigned int i = 0; i < s->ndevices; i++) {
+		struct stress_device *d = &s->devices[i];
+
+		if (d->device)
+			d->device = libinput_device_unref(d->device);
+	}
+
+	s->libinput = libinput_unref(s->libinput);
+}
+
+/* Run the first ndevices devices at the given rate for the configured
+ * duration. The devices' frames are staggered across one period */
+static bool
+run_step(struct stress *s, struct stress_step *step)
+{
+	uint64_t period = s2us(1) / step->rate;
+	uint64_t start, end, now;
+	struct pollfd fd;
+
+	s->libinput = stress_create_context(s, step->ndevices);
+	if (!s->libinput)
+		return false;
+
+	for (unsigned int i = 0; i < step->ndevices; i++) {
+		struct stress_device *d = &s->devices[i];
+
+		if (s->in_process && !d->device) {
+			fprintf(stderr, "Device %u was not added\n", i);
+			stress_destroy_context(s);
+			return false;
+		}
+
+		d->nframes = 0;
+		/* One touch or proximity sequence per second, long enough
+		 * to not be a tap at any rate */
+		d->cycle = max(step->rate, 2);
+	}
+
+	fd.fd = libinput_get_fd(s->libinput);
+	fd.events = POLLIN;
+
+	start = now_in_us();
+	end = start + s2us(s->duration);
+	for (unsigned int i = 0; i < step->ndevices; i++)
+		s->devices[i].due = start + period * i / step->ndevices;
+
+	while ((now = now_in_us()) < end) {
+		uint64_t next = end;
+		struct timespec timeout;
+
+		for (unsigned int i = 0; i < step->ndevices; i++) {
+			struct stress_device *d = &s->devices[i];
+
+			if (d->due <= now) {
+				step->lag_max = max(step->lag_max, now - d->due);
+				send_frame(s, step, d);
+				d->due += period;
+				/* Too far behind, skip the frames instead
+				 * of sending bursts */
+				while (d->due <= now) {
+					d->due += period;
+					step->frames_missed++;
+				}
+			}
+			next = min(next, d->due);
+		}
+
+		now = now_in_us();
+		timeout.tv_sec = 0;
+		timeout.tv_nsec = next > now ? (next - now) * 1000 : 0;
+		if (timeout.tv_nsec >= 1000000000)
+			timeout.tv_nsec = 999999999;
+
+		if (s->in_process) {
+			ppoll(NULL, 0, &timeout, NULL);
+			continue;
+		}
+
+		if (ppoll(&fd, 1, &timeout, NULL) > 0)
+			dispatch(s, step);
+	}
+
+	/* Pick up whatever is still on the way */
+	if (!s->in_process) {
+		while (poll(&fd, 1, 100) > 0)
+			dispatch(s, step);
+	}
+
+	step->wall = now_in_us() - start;
+	step->queue_peak = libinput_get_statistic(s->libinput,
+						  LIBINPUT_STATISTIC_EVENT_QUEUE_PEAK);
+
+	stress_destroy_context(s);
+
+	return true;
+}
+
+static int
+cmp_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a,
+		 y = *(const uint32_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static inline uint32_t
+percentile(const uint32_t *sorted, size_t n, unsigned int p)
+{
+	if (n == 0)
+		return 0;
+
+	return sorted[min((n * p) / 100, n - 1)];
+}
+
+static inline double
+ratio(uint64_t a, uint64_t b)
+{
+	return b ? (double)a / b : 0.0;
+}
+
+static void
+print_step(struct stress_step *step, bool last)
+{
+	qsort(step->latencies, step->nlatencies, sizeof(*step->latencies), cmp_u32);
+
+	printf("    {\n");
+	printf("      \"devices\": %u,\n", step->ndevices);
+	printf("      \"rate_hz\": %u,\n", step->rate);
+	printf("      \"time_us\": %" PRIu64 ",\n", step->wall);
+	printf("      \"frames\": %" PRIu64 ",\n", step->frames);
+	printf("      \"frames_missed\": %" PRIu64 ",\n", step->frames_missed);
+	printf("      \"evdev_events\": %" PRIu64 ",\n", step->evdev_events);
+	printf("      \"libinput_events\": %" PRIu64 ",\n", step->libinput_events);
+	printf("      \"libinput_events_per_sec\": %.0f,\n",
+	       ratio(step->libinput_events, step->wall) * 1e6);
+	printf("      \"cpu_ns\": %" PRIu64 ",\n", step->cpu);
+	printf("      \"cpu_percent\": %.2f,\n",
+	       ratio(step->cpu, step->wall) / 10.0);
+	printf("      \"cpu_ns_per_frame\": %.1f,\n",
+	       ratio(step->cpu, step->frames));
+	printf("      \"queue_peak\": %" PRIu64 ",\n", step->queue_peak);
+	printf("      \"batch_peak\": %zu,\n", step->batch_peak);
+	printf("      \"latency_us\": { \"p50\": %u, \"p99\": %u, \"max\": %u },\n",
+	       percentile(step->latencies, step->nlatencies, 50),
+	       percentile(step->latencies, step->nlatencies, 99),
+	       step->nlatencies ? step->latencies[step->nlatencies - 1] : 0);
+	printf("      \"generator_lag_max_us\": %" PRIu64 "\n", step->lag_max);
+	printf("    }%s\n", last ? "" : ",");
+}
+
+static inline void
+usage(void)
+{
+	printf("Usage: libinput stress [--help] [--verbose] [--in-process]\n"
+	       "                       [--template=<name>[,<name>...]] [--devices=<count>]\n"
+	       "                       [--rate=<hz>[,<hz>...]] [--fingers=<count>]\n"
+	       "                       [--duration=<seconds>]\n"
+	       "\n"
+	       "Create virtual devices, drive them at a fixed rate and print libinput's\n"
+	       "CPU usage, event queue depth and event latency as JSON, for 1, 2, 4, ...\n"
+	       "up to the given number of devices and for each rate.\n"
+	       "\n"
+	       "Options:\n"
+	       "  --verbose ................ enable libinput's debug log\n"
+	       "  --in-process ............. push the events into libinput directly instead\n"
+	       "                             of writing them to the kernel devices\n"
+	       "  --template=<names> ....... the device types, assigned to the devices in\n"
+	       "                             turn (default: mouse). Available: mouse,\n"
+	       "                             keyboard, touchpad, touchscreen, tablet\n"
+	       "  --devices=<count> ........ the maximum number of devices (default: 8)\n"
+	       "  --rate=<hz> .............. the frame rate per device (default: 125)\n"
+	       "  --fingers=<count> ........ fingers on touch devices (default: 2)\n"
+	       "  --duration=<seconds> ..... the duration of each step (default: 2)\n");
+}
+
+enum options {
+	OPT_HELP,
+	OPT_VERBOSE,
+	OPT_IN_PROCESS,
+	OPT_TEMPLATE,
+	OPT_DEVICES,
+	OPT_RATE,
+	OPT_FINGERS,
+	OPT_DURATION,
+};
+
+int
+main(int argc, char **argv)
+{
+	struct stress s = {0};
+	struct option opts[] = {
+		{ "help", no_argument, 0, OPT_HELP },
+		{ "verbose", no_argument, 0, OPT_VERBOSE },
+		{ "in-process", no_argument, 0, OPT_IN_PROCESS },
+		{ "template", required_argument, 0, OPT_TEMPLATE },
+		{ "devices", required_argument, 0, OPT_DEVICES },
+		{ "rate", required_argument, 0, OPT_RATE },
+		{ "fingers", required_argument, 0, OPT_FINGERS },
+		{ "duration", required_argument, 0, OPT_DURATION },
+		{ 0, 0, 0, 0 },
+	};
+	const struct stress_template *tmpl[ARRAY_LENGTH(templates) * 4];
+	size_t ntemplates = 0;
+	unsigned int rates[16];
+	size_t nrates = 0;
+	unsigned int ndevices = 8;
+	struct stress_step *steps = NULL;
+	size_t nsteps = 0;
+	char **strv;
+	int rc = EXIT_FAILURE;
+
+	s.fingers = 2;
+	s.duration = 2;
+
+	while (1) {
+		int c;
+		int option_index = 0;
+
+		c = getopt_long(argc, argv, "h", opts, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+		case OPT_HELP:
+			usage();
+			return EXIT_SUCCESS;
+		case OPT_VERBOSE:
+			s.verbose = true;
+			break;
+		case OPT_IN_PROCESS:
+			s.in_process = true;
+			break;
+		case OPT_TEMPLATE:
+			ntemplates = 0;
+			strv = strv_from_string(optarg, ",");
+			for (char **t = strv; t && *t; t++) {
+				const struct stress_template *template = template_by_name(*t);
+
+				if (!template || ntemplates >= ARRAY_LENGTH(tmpl)) {
+					strv_free(strv);
+					usage();
+					return EXIT_INVALID_USAGE;
+				}
+				tmpl[ntemplates++] = template;
+			}
+			strv_free(strv);
+			if (ntemplates == 0) {
+				usage();
+				return EXIT_INVALID_USAGE;
+			}
+			break;
+		case OPT_DEVICES:
+			if (!safe_atou(optarg, &ndevices) ||
+			    ndevices == 0 || ndevices > STRESS_MAX_DEVICES) {
+				usage();
+				return EXIT_INVALID_USAGE;
+			}
+			break;
+		case OPT_RATE:
+			nrates = 0;
+			strv = strv_from_string(optarg, ",");
+			for (char **r = strv; r && *r; r++) {
+				unsigned int rate;
+
+				if (!safe_atou(*r, &rate) ||
+				    rate == 0 || rate > STRESS_MAX_RATE ||
+				    nrates >= ARRAY_LENGTH(rates)) {
+					strv_free(strv);
+					usage();
+					return EXIT_INVALID_USAGE;
+				}
+				rates[nrates++] = rate;
+			}
+			strv_free(strv);
+			if (nrates == 0) {
+				usage();
+				return EXIT_INVALID_USAGE;
+			}
+			break;
+		case OPT_FINGERS:
+			if (!safe_atou(optarg, &s.fingers) ||
+			    s.fingers == 0 || s.fingers > 10) {
+				usage();
+				return EXIT_INVALID_USAGE;
+			}
+			break;
+		case OPT_DURATION:
+			if (!safe_atou(optarg, &s.duration) || s.duration == 0) {
+				usage();
+				return EXIT_INVALID_USAGE;
+			}
+			break;
+		default:
+			usage();
+			return EXIT_INVALID_USAGE;
+		}
+	}
+
+	if (optind != argc) {
+		usage();
+		return EXIT_INVALID_USAGE;
+	}
+
+	if (ntemplates == 0)
+		tmpl[ntemplates++] = template_by_name("mouse");
+	if (nrates == 0)
+		rates[nrates++] = 125;
+
+	s.devices = zalloc(ndevices * sizeof(*s.devices));
+	for (unsigned int i = 0; i < ndevices; i++) {
+		struct stress_device *d = &s.devices[i];
+
+		d->template = tmpl[i % ntemplates];
+		d->uinput = template_create_uinput(d->template);
+		if (!d->uinput)
+			goto out;
+		s.ndevices++;
+	}
+
+	/* 1, 2, 4, ... devices and always the maximum */
+	steps = zalloc(10 * nrates * sizeof(*steps));
+	for (unsigned int n = 1; ; n = min(n * 2, ndevices)) {
+		for (size_t r = 0; r < nrates; r++) {
+			struct stress_step *step = &steps[nsteps++];
+
+			step->ndevices = n;
+			step->rate = rates[r];
+			if (!run_step(&s, step))
+				goto out;
+		}
+		if (n == ndevices)
+			break;
+	}
+
+	printf("{\n");
+	printf("  \"libinput\": \"%s\",\n", LIBINPUT_VERSION);
+	printf("  \"git\": \"%s\",\n", LIBINPUT_GIT_VERSION);
+	printf("  \"mode\": \"%s\",\n", s.in_process ? "in-process" : "uinput");
+	printf("  \"templates\": [");
+	for (size_t i = 0; i < ntemplates; i++)
+		printf("%s\"%s\"", i ? ", " : " ", tmpl[i]->name);
+	printf(" ],\n");
+	printf("  \"fingers\": %u,\n", s.fingers);
+	printf("  \"duration_s\": %u,\n", s.duration);
+	printf("  \"steps\": [\n");
+	for (size_t i = 0; i < nsteps; i++)
+		print_step(&steps[i], i == nsteps - 1);
+	printf("  ]\n");
+	printf("}\n");
+
+	rc = EXIT_SUCCESS;
+out:
+	for (size_t i = 0; i < nsteps; i++)
+		free(steps[i].latencies);
+	free(steps);
+	for (unsigned int i = 0; i < s.ndevices; i++)
+		libevdev_uinput_destroy(s.devices[i].uinput);
+	free(s.devices);
+
+	return rc;
+}
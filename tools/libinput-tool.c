@@ -60,6 +60,18 @@ usage(void)
 	       "\n"
 	       "  replay\n"
 	       "	Replay a previously recorded event stream. See the man page for more info\n"
+	       "\n"
+	       "  replay-native\n"
+	       "	Replay a recording with precise timing. See the man page for more info\n"
+	       "\n"
+	       "  benchmark\n"
+	       "	Measure the processing cost of a recording. See the man page for more info\n"
+	       "\n"
+	       "  stress\n"
+	       "	Measure libinput under load from many virtual devices. See the man page for more info\n"
+	       "\n"
+	       "  convert-recording\n"
+	       "	Convert a recording between the YAML and binary format\n"
 	       "\n");
 }
 
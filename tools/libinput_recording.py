@@ -0,0 +1,173 @@
+# vim: set expandtab shiftwidth=4:
+# -*- Mode: python; coding: utf-8; indent-tabs-mode: nil -*- */
+#
+# Copyright © 2020 Red Hat, Inc.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# DEALINGS IN THE SOFTWARE.
+#
+#
+# Reader and writer for libinput record files, both the YAML and the
+# binary format. Either format is loaded into the same structure that
+# yaml.safe_load() returns for a YAML recording, so the tools don't need
+# to care which one they got.
+#
+# The binary format is the YAML header without the events, followed by
+# the evdev frames as packed little-endian structs, see
+# libinput-record.c for the authoritative description.
+
+import struct
+import yaml
+
+BINARY_MAGIC = b'LIRECBIN'
+BINARY_VERSION = 1
+
+# magic, version
+FILE_HEADER = struct.Struct('<8sI')
+# dt in µs to the previous frame on this device, device index, nevents
+FRAME = struct.Struct('<IHH')
+# type, code, value
+EVENT = struct.Struct('<HHi')
+
+MAX_DT = 0xffffffff
+
+
+class RecordingException(Exception):
+    pass
+
+
+def is_binary(path):
+    with open(path, 'rb') as f:
+        return f.read(len(BINARY_MAGIC)) == BINARY_MAGIC
+
+
+def _load_binary(data):
+    magic, version = FILE_HEADER.unpack_from(data)
+    if version != BINARY_VERSION:
+        raise RecordingException('Invalid binary format: {}, expected {}'.format(version, BINARY_VERSION))
+
+    try:
+        end = data.index(b'\0', FILE_HEADER.size)
+    except ValueError:
+        raise RecordingException('Truncated binary header')
+
+    recording = yaml.safe_load(data[FILE_HEADER.size:end].decode('utf-8'))
+    devices = recording['devices']
+    for d in devices:
+        d['events'] = []
+    times = [0] * len(devices)
+
+    view = memoryview(data)
+    offset = end + 1
+    while offset + FRAME.size <= len(data):
+        dt, index, nevents = FRAME.unpack_from(view, offset)
+        offset += FRAME.size
+
+        frame_end = offset + nevents * EVENT.size
+        if frame_end > len(data):
+            break  # recording was cut off mid-frame
+        if index >= len(devices):
+            raise RecordingException('Invalid device index {}'.format(index))
+
+        times[index] += dt
+        if nevents == 0:
+            continue
+
+        sec, usec = divmod(times[index], 1000000)
+        evdev = [[sec, usec, t, c, v] for (t, c, v) in EVENT.iter_unpack(view[offset:frame_end])]
+        devices[index]['events'].append({'evdev': evdev})
+        offset = frame_end
+
+    # Match what yaml gives us for an empty events: list
+    for d in devices:
+        if not d['events']:
+            d['events'] = None
+
+    return recording
+
+
+def load(path):
+    '''Load a recording in either the YAML or binary format'''
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    if data.startswith(BINARY_MAGIC):
+        return _load_binary(data)
+
+    return yaml.safe_load(data)
+
+
+def _header(recording):
+    header = {k: v for k, v in recording.items() if k != 'devices'}
+    devices = [{k: v for k, v in d.items() if k != 'events'}
+               for d in recording['devices']]
+    return header, devices
+
+
+def write_binary(recording, f):
+    '''Write the recording to the file object f (opened in binary mode).
+       Only evdev events can be stored, libinput events are dropped.'''
+    header, devices = _header(recording)
+    header['devices'] = devices
+
+    f.write(FILE_HEADER.pack(BINARY_MAGIC, BINARY_VERSION))
+    f.write(yaml.safe_dump(header, default_flow_style=None, sort_keys=False).encode('utf-8'))
+    f.write(b'\0')
+
+    for index, device in enumerate(recording['devices']):
+        last_time = 0
+        out = bytearray()
+        for event in device.get('events') or []:
+            evdev = event.get('evdev')
+            if not evdev:
+                continue
+
+            sec, usec = evdev[0][0:2]
+            time = sec * 1000000 + usec
+            dt = time - last_time
+            last_time = time
+
+            while dt > MAX_DT:
+                out += FRAME.pack(MAX_DT, index, 0)
+                dt -= MAX_DT
+
+            out += FRAME.pack(dt, index, len(evdev))
+            for e in evdev:
+                out += EVENT.pack(e[2], e[3], e[4])
+        f.write(out)
+
+
+def write_yaml(recording, f):
+    '''Write the recording to the file object f (opened in text mode)'''
+    header, devices = _header(recording)
+
+    f.write(yaml.safe_dump(header, default_flow_style=None, sort_keys=False))
+    f.write('devices:\n')
+    for description, device in zip(devices, recording['devices']):
+        d = yaml.safe_dump([description], default_flow_style=None, sort_keys=False)
+        f.write(''.join('  {}\n'.format(l) for l in d.splitlines()))
+
+        f.write('    events:\n')
+        for event in device.get('events') or []:
+            evdev = event.get('evdev')
+            if not evdev:
+                continue
+            lines = ['      - [{:3d}, {:6d}, {:3d}, {:3d}, {:7d}]\n'.format(*e) for e in evdev]
+            f.write('    - evdev:\n')
+            f.write(''.join(lines))
@@ -25,11 +25,13 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <getopt.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "filter.h"
@@ -141,6 +143,105 @@ print_ptraccel_sequence(struct motion_filter *filter,
 	}
 }
 
+struct trace {
+	struct device_float_coords *deltas;
+	uint64_t *times;
+	size_t nevents;
+	size_t sz;
+};
+
+static void
+trace_free(struct trace *trace)
+{
+	free(trace->deltas);
+	free(trace->times);
+	memset(trace, 0, sizeof(*trace));
+}
+
+static void
+trace_append(struct trace *trace, double dx, double dy, uint64_t time)
+{
+	if (trace->nevents == trace->sz) {
+		trace->sz = trace->sz ? trace->sz * 2 : 4096;
+		trace->deltas = realloc(trace->deltas,
+					trace->sz * sizeof(*trace->deltas));
+		trace->times = realloc(trace->times,
+				       trace->sz * sizeof(*trace->times));
+		if (!trace->deltas || !trace->times)
+			abort();
+	}
+
+	trace->deltas[trace->nevents].x = dx;
+	trace->deltas[trace->nevents].y = dy;
+	trace->times[trace->nevents] = time;
+	trace->nevents++;
+}
+
+/* Each line is "<time in us> <dx> <dy>", lines starting with # are
+ * ignored */
+static bool
+trace_read(struct trace *trace, FILE *fp)
+{
+	char *line = NULL;
+	size_t linesz = 0;
+	bool rc = true;
+
+	while (getline(&line, &linesz, fp) != -1) {
+		uint64_t t;
+		double dx, dy;
+
+		if (line[0] == '#')
+			continue;
+
+		if (sscanf(line, "%" SCNu64 " %lf %lf", &t, &dx, &dy) != 3) {
+			fprintf(stderr, "Invalid trace line: %s", line);
+			rc = false;
+			break;
+		}
+
+		trace_append(trace, dx, dy, t);
+	}
+
+	free(line);
+
+	return rc;
+}
+
+static int
+print_ptraccel_trace(struct motion_filter *filter, FILE *fp)
+{
+	struct trace trace = {0};
+	struct normalized_coords *accel;
+	size_t i;
+
+	if (!trace_read(&trace, fp)) {
+		trace_free(&trace);
+		return 1;
+	}
+
+	accel = calloc(max(trace.nevents, 1U), sizeof(*accel));
+	if (!accel)
+		abort();
+	filter_dispatch_batch(filter,
+			      trace.deltas,
+			      trace.times,
+			      accel,
+			      trace.nevents,
+			      NULL);
+
+	printf("# data: time(us) dx-in dy-in dx-out dy-out\n");
+	for (i = 0; i < trace.nevents; i++)
+		printf("%" PRIu64 "\t%.3f\t%.3f\t%.3f\t%.3f\n",
+		       trace.times[i],
+		       trace.deltas[i].x, trace.deltas[i].y,
+		       accel[i].x, accel[i].y);
+
+	free(accel);
+	trace_free(&trace);
+
+	return 0;
+}
+
 /* mm/s → units/µs */
 static inline double
 mmps_to_upus(double mmps, int dpi)
@@ -170,27 +271,268 @@ print_accel_func(struct motion_filter *filter,
 	}
 }
 
+static struct motion_filter *
+create_filter(const char *filter_type,
+	      int dpi,
+	      bool use_averaging,
+	      accel_profile_func_t *profile)
+{
+	struct motion_filter *filter = NULL;
+	double tp_multiplier = 1.0;
+
+	*profile = NULL;
+
+	if (streq(filter_type, "linear")) {
+		filter = create_pointer_accelerator_filter_linear(dpi,
+								  use_averaging);
+		*profile = pointer_accel_profile_linear;
+	} else if (streq(filter_type, "low-dpi")) {
+		filter = create_pointer_accelerator_filter_linear_low_dpi(dpi,
+									  use_averaging);
+		*profile = pointer_accel_profile_linear_low_dpi;
+	} else if (streq(filter_type, "touchpad")) {
+		filter = create_pointer_accelerator_filter_touchpad(dpi,
+								    0, 0,
+								    use_averaging);
+		*profile = touchpad_accel_profile_linear;
+	} else if (streq(filter_type, "x230")) {
+		filter = create_pointer_accelerator_filter_lenovo_x230(dpi,
+								       use_averaging);
+		*profile = touchpad_lenovo_x230_accel_profile;
+	} else if (streq(filter_type, "trackpoint")) {
+		filter = create_pointer_accelerator_filter_trackpoint(tp_multiplier,
+								      use_averaging);
+		*profile = trackpoint_accel_profile;
+	} else if (streq(filter_type, "flat")) {
+		filter = create_pointer_accelerator_filter_flat(dpi);
+	} else if (streq(filter_type, "tablet")) {
+		filter = create_pointer_accelerator_filter_tablet(dpi, dpi);
+	}
+
+	return filter;
+}
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+/* Count allocations during the benchmark runs by wrapping the glibc
+ * allocator. The filters should not allocate after creation. This
+ * doesn't work with the address sanitizer's allocator. */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static unsigned int nallocs;
+
+void *
+malloc(size_t size)
+{
+	nallocs++;
+	return __libc_malloc(size);
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+	nallocs++;
+	return __libc_calloc(nmemb, size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+	nallocs++;
+	return __libc_realloc(ptr, size);
+}
+#define HAVE_ALLOC_COUNT 1
+#else
+static unsigned int nallocs;
+#define HAVE_ALLOC_COUNT 0
+#endif
+
+enum benchmark_pattern {
+	PATTERN_STEADY,
+	PATTERN_DIRECTION_CHANGE,
+	PATTERN_PAUSE,
+	PATTERN_RANDOM,
+	PATTERN_TRACE,
+};
+
+static const char *
+benchmark_pattern_name(enum benchmark_pattern pattern)
+{
+	switch (pattern) {
+	case PATTERN_STEADY: return "steady";
+	case PATTERN_DIRECTION_CHANGE: return "dirchange";
+	case PATTERN_PAUSE: return "pause";
+	case PATTERN_RANDOM: return "random";
+	case PATTERN_TRACE: return "trace";
+	}
+
+	abort();
+}
+
+static void
+benchmark_generate(struct trace *trace,
+		   enum benchmark_pattern pattern,
+		   int nevents)
+{
+	uint64_t time = ms2us(1000);
+	uint32_t seed = 1;
+	int i;
+
+	for (i = 0; i < nevents; i++) {
+		double dx = 5, dy = 2;
+
+		switch (pattern) {
+		case PATTERN_STEADY:
+			time += ms2us(1);
+			break;
+		case PATTERN_DIRECTION_CHANGE:
+			/* Every event invalidates the trackers */
+			if (i % 2)
+				dx = -dx;
+			time += ms2us(1);
+			break;
+		case PATTERN_PAUSE:
+			/* Pauses longer than the filter motion timeout */
+			time += (i % 16) ? ms2us(1) : ms2us(1100);
+			break;
+		case PATTERN_RANDOM:
+			seed = seed * 1103515245 + 12345;
+			dx = (int)((seed >> 16) % 21) - 10;
+			seed = seed * 1103515245 + 12345;
+			dy = (int)((seed >> 16) % 21) - 10;
+			time += ms2us(1 + (seed >> 16) % 16);
+			break;
+		case PATTERN_TRACE:
+			abort();
+		}
+
+		trace_append(trace, dx, dy, time);
+	}
+}
+
+static void
+benchmark_filter(const char *filter_type,
+		 enum benchmark_pattern pattern,
+		 struct trace *trace,
+		 int dpi,
+		 double speed)
+{
+	struct motion_filter *filter;
+	accel_profile_func_t profile;
+	struct libinput_tablet_tool tool = {
+		.type = LIBINPUT_TABLET_TOOL_TYPE_PEN,
+	};
+	struct timespec start, end;
+	uint64_t ns;
+	unsigned int allocs;
+	size_t i;
+
+	filter = create_filter(filter_type, dpi, false, &profile);
+	assert(filter != NULL);
+	filter_set_speed(filter, speed);
+
+	allocs = nallocs;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < trace->nevents; i++) {
+		filter_dispatch(filter,
+				&trace->deltas[i],
+				&tool,
+				trace->times[i]);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	allocs = nallocs - allocs;
+
+	filter_destroy(filter);
+
+	ns = (end.tv_sec - start.tv_sec) * 1000000000ULL +
+		end.tv_nsec - start.tv_nsec;
+
+	printf("%-12s %-10s %10zu %10.2f ",
+	       filter_type,
+	       benchmark_pattern_name(pattern),
+	       trace->nevents,
+	       trace->nevents ? (double)ns/trace->nevents : 0.0);
+	if (HAVE_ALLOC_COUNT)
+		printf("%8u\n", allocs);
+	else
+		printf("%8s\n", "n/a");
+}
+
+static int
+run_benchmark(const char *filter_type, int dpi, double speed, int nevents)
+{
+	const char *filters[] = {
+		"linear", "low-dpi", "touchpad", "x230",
+		"trackpoint", "flat", "tablet",
+	};
+	struct trace traces[PATTERN_TRACE + 1] = {0};
+	enum benchmark_pattern pattern, last_pattern = PATTERN_RANDOM;
+	size_t i;
+
+	if (nevents == 0)
+		nevents = 1000000;
+
+	for (pattern = PATTERN_STEADY; pattern <= PATTERN_RANDOM; pattern++)
+		benchmark_generate(&traces[pattern], pattern, nevents);
+
+	if (!isatty(STDIN_FILENO)) {
+		if (!trace_read(&traces[PATTERN_TRACE], stdin))
+			return 1;
+		if (traces[PATTERN_TRACE].nevents > 0)
+			last_pattern = PATTERN_TRACE;
+	}
+
+	printf("# filter     pattern        events   ns/event   allocs\n");
+	for (i = 0; i < ARRAY_LENGTH(filters); i++) {
+		if (filter_type && !streq(filter_type, filters[i]))
+			continue;
+
+		for (pattern = PATTERN_STEADY; pattern <= last_pattern; pattern++)
+			benchmark_filter(filters[i],
+					 pattern,
+					 &traces[pattern],
+					 dpi,
+					 speed);
+	}
+
+	for (pattern = PATTERN_STEADY; pattern <= PATTERN_TRACE; pattern++)
+		trace_free(&traces[pattern]);
+
+	return 0;
+}
+
 static void
 usage(void)
 {
 	printf("Usage: %s [options] [dx1] [dx2] [...] > gnuplot.data\n", program_invocation_short_name);
 	printf("\n"
 	       "Options:\n"
-	       "--mode=<accel|motion|delta|sequence> \n"
+	       "--mode=<accel|motion|delta|sequence|trace> \n"
 	       "	accel    ... print accel factor (default)\n"
 	       "	motion   ... print motion to accelerated motion\n"
 	       "	delta    ... print delta to accelerated delta\n"
 	       "	sequence ... print motion for custom delta sequence\n"
+	       "	trace    ... print motion for a recorded trace on stdin\n"
 	       "--maxdx=<double>  ... in motion mode only. Stop increasing dx at maxdx\n"
 	       "--steps=<double>  ... in motion and delta modes only. Increase dx by step each round\n"
 	       "--speed=<double>  ... accel speed [-1, 1], default 0\n"
 	       "--dpi=<int>	... device resolution in DPI (default: 1000)\n"
-	       "--filter=<linear|low-dpi|touchpad|x230|trackpoint> \n"
+	       "--benchmark	... measure the filter cost, see below\n"
+	       "--filter=<linear|low-dpi|touchpad|x230|trackpoint|flat|tablet> \n"
 	       "	linear	  ... the default motion filter\n"
 	       "	low-dpi	  ... low-dpi filter, use --dpi with this argument\n"
 	       "	touchpad  ... the touchpad motion filter\n"
 	       "	x230  	  ... custom filter for the Lenovo x230 touchpad\n"
 	       "	trackpoint... trackpoint motion filter\n"
+	       "	flat      ... flat motion filter, not available in accel mode\n"
+	       "	tablet    ... tablet motion filter, not available in accel mode\n"
+	       "\n"
+	       "In benchmark mode, each filter (or the one given with --filter) is run\n"
+	       "over synthetic delta streams of --nevents events (default: 1000000)\n"
+	       "and the time per event and the number of allocations are printed.\n"
+	       "If stdin is a pipe, it is read as a trace (see trace mode) and\n"
+	       "benchmarked too.\n"
 	       "\n"
 	       "If extra arguments are present and mode is not given, mode defaults to 'sequence'\n"
 	       "and the arguments are interpreted as sequence of delta x coordinates\n"
@@ -198,6 +540,9 @@ usage(void)
 	       "If stdin is a pipe, mode defaults to 'sequence' and the pipe is read \n"
 	       "for delta coordinates\n"
 	       "\n"
+	       "In trace mode, each line on stdin is \"<time in us> <dx> <dy>\".\n"
+	       "The whole trace is run through the filter in one batch\n"
+	       "\n"
 	       "Delta coordinates passed into this tool must be in dpi as\n"
 	       "specified by the --dpi argument\n"
 	       "\n"
@@ -209,6 +554,7 @@ enum mode {
 	MOTION,
 	DELTA,
 	SEQUENCE,
+	TRACE,
 };
 
 int
@@ -218,14 +564,16 @@ main(int argc, char **argv)
 	double step = 0.1,
 	       max_dx = 10;
 	int nevents = 0;
+	int rc = 0;
 	enum mode mode = ACCEL;
 	double custom_deltas[1024];
 	double speed = 0.0;
 	int dpi = 1000;
 	bool use_averaging = false;
 	const char *filter_type = "linear";
+	bool filter_set = false;
+	bool benchmark = false;
 	accel_profile_func_t profile = NULL;
-	double tp_multiplier = 1.0;
 
 	enum {
 		OPT_HELP = 1,
@@ -236,6 +584,7 @@ main(int argc, char **argv)
 		OPT_SPEED,
 		OPT_DPI,
 		OPT_FILTER,
+		OPT_BENCHMARK,
 	};
 
 	while (1) {
@@ -250,6 +599,7 @@ main(int argc, char **argv)
 			{"speed", 1, 0, OPT_SPEED },
 			{"dpi", 1, 0, OPT_DPI },
 			{"filter", 1, 0, OPT_FILTER },
+			{"benchmark", 0, 0, OPT_BENCHMARK },
 			{0, 0, 0, 0}
 		};
 
@@ -272,6 +622,8 @@ main(int argc, char **argv)
 				mode = DELTA;
 			else if (streq(optarg, "sequence"))
 				mode = SEQUENCE;
+			else if (streq(optarg, "trace"))
+				mode = TRACE;
 			else {
 				usage();
 				return 1;
@@ -306,6 +658,10 @@ main(int argc, char **argv)
 			break;
 		case OPT_FILTER:
 			filter_type = optarg;
+			filter_set = true;
+			break;
+		case OPT_BENCHMARK:
+			benchmark = true;
 			break;
 		default:
 			usage();
@@ -314,36 +670,32 @@ main(int argc, char **argv)
 		}
 	}
 
-	if (streq(filter_type, "linear")) {
-		filter = create_pointer_accelerator_filter_linear(dpi,
-								  use_averaging);
-		profile = pointer_accel_profile_linear;
-	} else if (streq(filter_type, "low-dpi")) {
-		filter = create_pointer_accelerator_filter_linear_low_dpi(dpi,
-									  use_averaging);
-		profile = pointer_accel_profile_linear_low_dpi;
-	} else if (streq(filter_type, "touchpad")) {
-		filter = create_pointer_accelerator_filter_touchpad(dpi,
-								    0, 0,
-								    use_averaging);
-		profile = touchpad_accel_profile_linear;
-	} else if (streq(filter_type, "x230")) {
-		filter = create_pointer_accelerator_filter_lenovo_x230(dpi,
-								       use_averaging);
-		profile = touchpad_lenovo_x230_accel_profile;
-	} else if (streq(filter_type, "trackpoint")) {
-		filter = create_pointer_accelerator_filter_trackpoint(tp_multiplier,
-								      use_averaging);
-		profile = trackpoint_accel_profile;
-	} else {
+	filter = create_filter(filter_type, dpi, use_averaging, &profile);
+	if (!filter) {
 		fprintf(stderr, "Invalid filter type %s\n", filter_type);
 		return 1;
 	}
 
+	if (benchmark) {
+		rc = run_benchmark(filter_set ? filter_type : NULL,
+				   dpi, speed, nevents);
+		filter_destroy(filter);
+		return rc;
+	}
+
+	if (mode == ACCEL && !profile) {
+		fprintf(stderr, "Filter %s has no acceleration profile\n",
+			filter_type);
+		filter_destroy(filter);
+		return 1;
+	}
+
 	assert(filter != NULL);
 	filter_set_speed(filter, speed);
 
-	if (!isatty(STDIN_FILENO)) {
+	if (mode == TRACE) {
+		/* stdin is read by the trace mode itself */
+	} else if (!isatty(STDIN_FILENO)) {
 		char buf[12];
 		mode = SEQUENCE;
 		nevents = 0;
@@ -376,9 +728,12 @@ main(int argc, char **argv)
 	case SEQUENCE:
 		print_ptraccel_sequence(filter, nevents, custom_deltas);
 		break;
+	case TRACE:
+		rc = print_ptraccel_trace(filter, stdin);
+		break;
 	}
 
 	filter_destroy(filter);
 
-	return 0;
+	return rc;
 }
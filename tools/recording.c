@@ -0,0 +1,894 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <ctype.h>
+#include <endian.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <libevdev/libevdev.h>
+#include <libevdev/libevdev-uinput.h>
+
+#include "util-macros.h"
+#include "util-strings.h"
+#include "util-time.h"
+
+#include "recording.h"
+#include "shared.h"
+
+enum parser_state {
+	STATE_TOP,
+	STATE_DEVICE,		/* any device section we don't care about */
+	STATE_EVDEV,
+	STATE_EVDEV_CODES,
+	STATE_EVDEV_ABSINFO,
+	STATE_EVENTS,
+	STATE_EVENTS_EVDEV,
+	STATE_EVENTS_OTHER,	/* libinput events, skipped */
+};
+
+struct parser {
+	const char *path;
+	FILE *fp;
+	bool eof;
+	bool at_nul; /* the input ended at a NUL byte, not EOF */
+	unsigned int lineno;
+
+	char *line;
+	size_t line_sz;
+
+	enum parser_state state;
+	struct recording *recording;
+
+	/* The current frame, handed to the handler once complete. Only
+	 * one frame is ever kept in memory */
+	struct recording_frame frame;
+	struct recording_event *events;
+	size_t events_sz;
+
+	recording_frame_handler handler;
+	void *userdata;
+	bool stopped; /* the handler asked to stop */
+};
+
+/**
+ * Append a zeroed element to the array and return it. The array's size
+ * is implicit: n rounded up to the next power of two, at least 32.
+ */
+static void *
+append_elem(void **array, size_t *n, size_t elem_size)
+{
+	char *elem;
+
+	if (*n == 0 || (*n >= 32 && (*n & (*n - 1)) == 0)) {
+		size_t sz = *n == 0 ? 32 : *n * 2;
+
+		*array = realloc(*array, sz * elem_size);
+		if (!*array)
+			abort();
+	}
+
+	elem = (char*)*array + *n * elem_size;
+	memset(elem, 0, elem_size);
+	(*n)++;
+
+	return elem;
+}
+
+#define append(array_, n_) \
+	append_elem((void**)&(array_), &(n_), sizeof(*(array_)))
+
+static struct recording_device *
+current_device(struct parser *p)
+{
+	struct recording *r = p->recording;
+
+	return r->ndevices ? &r->devices[r->ndevices - 1] : NULL;
+}
+
+static struct recording_event *
+frame_append_event(struct parser *p)
+{
+	if (p->frame.nevents == p->events_sz) {
+		p->events_sz = max(p->events_sz * 2, (size_t)32);
+		p->events = realloc(p->events,
+				    p->events_sz * sizeof(*p->events));
+		if (!p->events)
+			abort();
+	}
+
+	return &p->events[p->frame.nevents++];
+}
+
+/**
+ * Pass the current frame, if any, to the handler.
+ *
+ * @return false if the handler asked to stop
+ */
+static bool
+flush_frame(struct parser *p)
+{
+	bool rc;
+
+	if (p->frame.nevents == 0)
+		return true;
+
+	rc = p->handler(p->recording, &p->frame, p->events, p->userdata);
+	p->frame.nevents = 0;
+	if (!rc)
+		p->stopped = true;
+
+	return rc;
+}
+
+static void
+line_append(struct parser *p, size_t *len, char c)
+{
+	if (*len + 1 >= p->line_sz) {
+		p->line_sz = max(p->line_sz * 2, (size_t)256);
+		p->line = realloc(p->line, p->line_sz);
+		if (!p->line)
+			abort();
+	}
+	p->line[(*len)++] = c;
+	p->line[*len] = '\0';
+}
+
+/**
+ * Read the next logical line into p->line: comments are stripped and a
+ * flow list spanning multiple lines is joined into one line. The input
+ * ends at EOF or at a NUL byte, the latter terminates the header of the
+ * binary format.
+ *
+ * @return false at the end of the input
+ */
+static bool
+next_line(struct parser *p)
+{
+	size_t len = 0;
+	char quote = 0;
+	bool comment = false;
+	int depth = 0;
+	char last = ' ';
+	int c;
+
+	if (p->eof)
+		return false;
+
+	c = getc_unlocked(p->fp);
+	if (c == EOF || c == '\0') {
+		p->eof = true;
+		p->at_nul = c == '\0';
+		return false;
+	}
+	ungetc(c, p->fp);
+
+	line_append(p, &len, '\0');
+	len = 0;
+
+	while (true) {
+		c = getc_unlocked(p->fp);
+		if (c == EOF || c == '\0') {
+			p->eof = true;
+			p->at_nul = c == '\0';
+			break;
+		}
+
+		if (c == '\n') {
+			p->lineno++;
+			comment = false;
+			if (depth <= 0 && quote == 0)
+				break;
+			c = ' ';
+		}
+
+		if (comment)
+			continue;
+
+		if (quote) {
+			if (c == '\\' && quote == '"') {
+				int next = getc_unlocked(p->fp);
+
+				if (next != EOF && next != '\0') {
+					line_append(p, &len, next);
+					continue;
+				}
+				if (next != EOF)
+					ungetc(next, p->fp);
+			}
+			line_append(p, &len, c);
+			if (c == quote)
+				quote = 0;
+			continue;
+		}
+
+		switch (c) {
+		case '#':
+			if (isspace(last)) {
+				comment = true;
+				continue;
+			}
+			break;
+		case '"':
+		case '\'':
+			if (strchr(" :[,-", last))
+				quote = c;
+			break;
+		case '[':
+			depth++;
+			break;
+		case ']':
+			depth--;
+			break;
+		}
+
+		line_append(p, &len, c);
+		last = c;
+	}
+
+	/* strip trailing whitespace */
+	while (len > 0 && isspace(p->line[len - 1]))
+		p->line[--len] = '\0';
+
+	return true;
+}
+
+static char *
+unquote(char *str)
+{
+	size_t len = strlen(str);
+
+	if (len >= 2 &&
+	    (str[0] == '"' || str[0] == '\'') &&
+	    str[len - 1] == str[0]) {
+		str[len - 1] = '\0';
+		return str + 1;
+	}
+
+	return str;
+}
+
+/**
+ * Parse a flow list of integers like "[1, 2, 3]".
+ *
+ * @return the number of values or -1 on error
+ */
+static int
+parse_int_list(const char *str, int *values, size_t max_values)
+{
+	size_t n = 0;
+	char *end;
+
+	while (isspace(*str))
+		str++;
+	if (*str++ != '[')
+		return -1;
+
+	while (true) {
+		long v;
+
+		while (isspace(*str))
+			str++;
+		if (*str == ']')
+			break;
+
+		errno = 0;
+		v = strtol(str, &end, 10);
+		if (errno != 0 || end == str || v > INT_MAX || v < INT_MIN)
+			return -1;
+		if (n < max_values)
+			values[n] = v;
+		n++;
+
+		str = end;
+		while (isspace(*str))
+			str++;
+		if (*str == ',')
+			str++;
+		else if (*str != ']')
+			return -1;
+	}
+
+	return n;
+}
+
+static bool
+parse_key_value(char *str, char **key, char **value)
+{
+	char *c = str;
+
+	while (isalnum(*c) || *c == '_' || *c == '-')
+		c++;
+
+	if (c == str || *c != ':' || (c[1] != '\0' && c[1] != ' '))
+		return false;
+
+	*c = '\0';
+	*key = str;
+	c++;
+	while (isspace(*c))
+		c++;
+	*value = c;
+
+	return true;
+}
+
+static bool
+parse_event(struct parser *p, const char *str)
+{
+	struct recording_event *e;
+	int v[5];
+
+	if (parse_int_list(str, v, ARRAY_LENGTH(v)) != 5)
+		return false;
+
+	if (p->frame.nevents == 0) {
+		p->frame.time = s2us(v[0]) + v[1];
+		p->frame.device = p->recording->ndevices - 1;
+		p->frame.first_event = 0;
+	}
+
+	e = frame_append_event(p);
+	e->type = v[2];
+	e->code = v[3];
+	e->value = v[4];
+
+	return true;
+}
+
+static bool
+parse_evdev_key(struct parser *p, const char *key, char *value)
+{
+	struct recording_device *d = current_device(p);
+	int v[8];
+	int n;
+
+	if (streq(key, "name")) {
+		free(d->name);
+		d->name = safe_strdup(unquote(value));
+	} else if (streq(key, "id")) {
+		if (parse_int_list(value, v, 4) != 4)
+			return false;
+		for (int i = 0; i < 4; i++)
+			d->id[i] = v[i];
+	} else if (streq(key, "codes")) {
+		p->state = STATE_EVDEV_CODES;
+	} else if (streq(key, "absinfo")) {
+		p->state = STATE_EVDEV_ABSINFO;
+	} else if (streq(key, "properties")) {
+		int props[INPUT_PROP_CNT];
+
+		n = parse_int_list(value, props, ARRAY_LENGTH(props));
+		if (n < 0 || n > INPUT_PROP_CNT)
+			return false;
+		for (int i = 0; i < n; i++) {
+			if (props[i] < 0 || props[i] >= INPUT_PROP_CNT)
+				return false;
+			d->props[props[i]] = true;
+		}
+		p->state = STATE_EVDEV;
+	}
+
+	return true;
+}
+
+static inline bool
+is_evdev_key(const char *key)
+{
+	return streq(key, "name") ||
+	       streq(key, "id") ||
+	       streq(key, "codes") ||
+	       streq(key, "absinfo") ||
+	       streq(key, "properties");
+}
+
+static bool
+parse_codes(struct parser *p, unsigned int type, const char *value)
+{
+	struct recording_device *d = current_device(p);
+	int codes[KEY_CNT];
+	int n;
+
+	if (type >= EV_CNT)
+		return false;
+
+	n = parse_int_list(value, codes, ARRAY_LENGTH(codes));
+	if (n < 0 || n > KEY_CNT)
+		return false;
+
+	for (int i = 0; i < n; i++) {
+		__typeof__(d->codes) c = append(d->codes, d->ncodes);
+
+		if (codes[i] < 0 || codes[i] > UINT16_MAX)
+			return false;
+
+		c->type = type;
+		c->code = codes[i];
+	}
+
+	return true;
+}
+
+static bool
+parse_absinfo(struct parser *p, unsigned int code, const char *value)
+{
+	struct recording_device *d = current_device(p);
+	struct input_absinfo *abs;
+	int v[5];
+
+	if (code >= ABS_CNT || parse_int_list(value, v, 5) != 5)
+		return false;
+
+	abs = &d->absinfo[code];
+	abs->minimum = v[0];
+	abs->maximum = v[1];
+	abs->fuzz = v[2];
+	abs->flat = v[3];
+	abs->resolution = v[4];
+
+	return true;
+}
+
+static bool
+parse_line(struct parser *p)
+{
+	struct recording *r = p->recording;
+	char *str = p->line;
+	size_t indent;
+	bool list_item = false;
+	char *key = NULL, *value = NULL;
+	bool have_key;
+	unsigned int number;
+
+	while (isspace(*str))
+		str++;
+	if (*str == '\0')
+		return true;
+	indent = str - p->line;
+
+	if (str[0] == '-' && (str[1] == ' ' || str[1] == '\0')) {
+		list_item = true;
+		str++;
+		while (isspace(*str))
+			str++;
+	}
+
+	if (list_item && *str == '[') {
+		if (p->state == STATE_EVENTS_EVDEV)
+			return parse_event(p, str);
+		return true;
+	}
+
+	have_key = parse_key_value(str, &key, &value);
+	if (!have_key)
+		return true;
+
+	if (list_item && streq(key, "node")) {
+		struct recording_device *d;
+
+		if (!flush_frame(p))
+			return false;
+
+		d = append(r->devices, r->ndevices);
+		d->node = safe_strdup(unquote(value));
+		p->state = STATE_DEVICE;
+		return true;
+	}
+
+	/* Any other key ends the evdev description */
+	if ((p->state == STATE_EVDEV ||
+	     p->state == STATE_EVDEV_CODES ||
+	     p->state == STATE_EVDEV_ABSINFO) &&
+	    !is_evdev_key(key) &&
+	    !safe_atou(key, &number))
+		p->state = STATE_DEVICE;
+
+	switch (p->state) {
+	case STATE_TOP:
+		if (indent == 0 && streq(key, "version")) {
+			int version;
+
+			if (!safe_atoi(value, &version) ||
+			    version != FILE_VERSION_NUMBER) {
+				fprintf(stderr,
+					"%s: invalid file version '%s', expected %d\n",
+					p->path,
+					value,
+					FILE_VERSION_NUMBER);
+				return false;
+			}
+		}
+		return true;
+	case STATE_EVDEV_CODES:
+		if (safe_atou(key, &number))
+			return parse_codes(p, number, value);
+		return parse_evdev_key(p, key, value);
+	case STATE_EVDEV_ABSINFO:
+		if (safe_atou(key, &number))
+			return parse_absinfo(p, number, value);
+		return parse_evdev_key(p, key, value);
+	case STATE_EVDEV:
+		return parse_evdev_key(p, key, value);
+	case STATE_DEVICE:
+		if (streq(key, "evdev"))
+			p->state = STATE_EVDEV;
+		else if (streq(key, "events"))
+			p->state = STATE_EVENTS;
+		return true;
+	case STATE_EVENTS:
+	case STATE_EVENTS_EVDEV:
+	case STATE_EVENTS_OTHER:
+		/* each evdev: entry is one frame */
+		if (!flush_frame(p))
+			return false;
+		if (streq(key, "evdev"))
+			p->state = STATE_EVENTS_EVDEV;
+		else
+			p->state = STATE_EVENTS_OTHER;
+		return true;
+	}
+
+	return true;
+}
+
+static bool
+parse_yaml(struct parser *p)
+{
+	struct recording *recording = p->recording;
+
+	while (next_line(p)) {
+		if (!parse_line(p)) {
+			if (p->stopped)
+				return true;
+			fprintf(stderr,
+				"%s:%u: failed to parse '%s'\n",
+				p->path,
+				p->lineno,
+				p->line);
+			return false;
+		}
+	}
+
+	if (recording->ndevices == 0) {
+		fprintf(stderr, "%s: no devices in recording\n", p->path);
+		return false;
+	}
+
+	flush_frame(p);
+
+	return true;
+}
+
+static bool
+parse_binary(struct parser *p)
+{
+	struct recording *recording = p->recording;
+	uint32_t version;
+	struct binary_frame bf;
+	uint64_t *times;
+	bool rc = false;
+
+	if (fread(&version, sizeof(version), 1, p->fp) != 1) {
+		fprintf(stderr, "%s: truncated binary header\n", p->path);
+		return false;
+	}
+
+	version = le32toh(version);
+	if (version != BINARY_VERSION_NUMBER) {
+		fprintf(stderr,
+			"%s: invalid binary format %u, expected %u\n",
+			p->path,
+			version,
+			BINARY_VERSION_NUMBER);
+		return false;
+	}
+
+	if (!parse_yaml(p))
+		return false;
+
+	if (!p->at_nul) {
+		fprintf(stderr, "%s: truncated binary header\n", p->path);
+		return false;
+	}
+
+	times = zalloc(recording->ndevices * sizeof(*times));
+	while (!p->stopped && fread(&bf, sizeof(bf), 1, p->fp) == 1) {
+		unsigned int device, nevents;
+
+		device = le16toh(bf.device);
+		nevents = le16toh(bf.nevents);
+		if (device >= recording->ndevices) {
+			fprintf(stderr,
+				"%s: invalid device index %u\n",
+				p->path,
+				device);
+			goto out;
+		}
+
+		times[device] += le32toh(bf.dt);
+		if (nevents == 0)
+			continue;
+
+		p->frame.time = times[device];
+		p->frame.device = device;
+		p->frame.first_event = 0;
+
+		for (unsigned int i = 0; i < nevents; i++) {
+			struct binary_event be;
+			struct recording_event *e;
+
+			/* A recording that was cut off mid-frame is still
+			 * useful, the partial frame is dropped */
+			if (fread(&be, sizeof(be), 1, p->fp) != 1) {
+				p->frame.nevents = 0;
+				break;
+			}
+
+			e = frame_append_event(p);
+			e->type = le16toh(be.type);
+			e->code = le16toh(be.code);
+			e->value = (int32_t)le32toh(be.value);
+		}
+
+		flush_frame(p);
+	}
+
+	rc = true;
+out:
+	free(times);
+	return rc;
+}
+
+struct recording *
+recording_stream(const char *path,
+		 recording_frame_handler handler,
+		 void *userdata)
+{
+	struct recording *recording;
+	struct parser p = {
+		.path = path,
+		.lineno = 0,
+		.state = STATE_TOP,
+		.handler = handler,
+		.userdata = userdata,
+	};
+	char magic[sizeof(BINARY_MAGIC)];
+	bool rc;
+
+	p.fp = fopen(path, "re");
+	if (!p.fp) {
+		fprintf(stderr, "Failed to open %s: %m\n", path);
+		return NULL;
+	}
+
+	recording = zalloc(sizeof(*recording));
+	p.recording = recording;
+
+	if (fread(magic, sizeof(magic), 1, p.fp) == 1 &&
+	    memcmp(magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0) {
+		rc = parse_binary(&p);
+	} else {
+		rewind(p.fp);
+		rc = parse_yaml(&p);
+	}
+
+	if (rc && ferror(p.fp)) {
+		fprintf(stderr, "Failed to read %s\n", path);
+		rc = false;
+	}
+
+	if (!rc) {
+		recording_free(recording);
+		recording = NULL;
+	}
+
+	fclose(p.fp);
+	free(p.line);
+	free(p.events);
+
+	return recording;
+}
+
+static bool
+append_frame(struct recording *recording,
+	     const struct recording_frame *f,
+	     const struct recording_event *events,
+	     void *userdata)
+{
+	struct recording_device *d = &recording->devices[f->device];
+	struct recording_frame *frame;
+
+	frame = append(d->frames, d->nframes);
+	*frame = *f;
+	frame->first_event = d->nevents;
+
+	for (size_t i = 0; i < f->nevents; i++) {
+		struct recording_event *e = append(d->events, d->nevents);
+
+		*e = events[i];
+	}
+
+	return true;
+}
+
+struct recording *
+recording_load(const char *path)
+{
+	return recording_stream(path, append_frame, NULL);
+}
+
+void
+recording_free(struct recording *recording)
+{
+	if (!recording)
+		return;
+
+	for (size_t i = 0; i < recording->ndevices; i++) {
+		struct recording_device *d = &recording->devices[i];
+
+		free(d->node);
+		free(d->name);
+		free(d->codes);
+		free(d->events);
+		free(d->frames);
+	}
+	free(recording->devices);
+	free(recording);
+}
+
+static int
+frame_cmp(const void *a, const void *b)
+{
+	const struct recording_frame *fa = *(struct recording_frame * const *)a,
+				     *fb = *(struct recording_frame * const *)b;
+
+	if (fa->time != fb->time)
+		return fa->time < fb->time ? -1 : 1;
+	if (fa->device != fb->device)
+		return fa->device < fb->device ? -1 : 1;
+	if (fa->first_event != fb->first_event)
+		return fa->first_event < fb->first_event ? -1 : 1;
+	return 0;
+}
+
+struct recording_frame **
+recording_build_timeline(struct recording *r, size_t *nframes_out)
+{
+	struct recording_frame **timeline;
+	size_t nframes = 0, n = 0;
+
+	for (size_t i = 0; i < r->ndevices; i++)
+		nframes += r->devices[i].nframes;
+
+	timeline = zalloc(max(nframes, (size_t)1) * sizeof(*timeline));
+	for (size_t i = 0; i < r->ndevices; i++) {
+		struct recording_device *d = &r->devices[i];
+
+		for (size_t f = 0; f < d->nframes; f++)
+			timeline[n++] = &d->frames[f];
+	}
+
+	qsort(timeline, nframes, sizeof(*timeline), frame_cmp);
+	*nframes_out = nframes;
+
+	return timeline;
+}
+
+struct libevdev_uinput *
+recording_device_create_uinput(struct recording_device *d)
+{
+	struct libevdev *evdev;
+	struct libevdev_uinput *uinput = NULL;
+	int rc;
+
+	evdev = libevdev_new();
+	libevdev_set_name(evdev, d->name ? d->name : "libinput replay device");
+	libevdev_set_id_bustype(evdev, d->id[0]);
+	libevdev_set_id_vendor(evdev, d->id[1]);
+	libevdev_set_id_product(evdev, d->id[2]);
+	libevdev_set_id_version(evdev, d->id[3]);
+
+	for (size_t i = 0; i < d->ncodes; i++) {
+		unsigned int type = d->codes[i].type,
+			     code = d->codes[i].code;
+		const void *data = NULL;
+		int rep[REP_CNT] = { 500, 20 };
+
+		switch (type) {
+		case EV_ABS:
+			if (code >= ABS_CNT)
+				continue;
+			data = &d->absinfo[code];
+			break;
+		case EV_REP:
+			if (code >= REP_CNT)
+				continue;
+			data = &rep[code];
+			break;
+		}
+
+		libevdev_enable_event_code(evdev, type, code, data);
+	}
+
+	for (unsigned int prop = 0; prop < INPUT_PROP_CNT; prop++) {
+		if (d->props[prop])
+			libevdev_enable_property(evdev, prop);
+	}
+
+	rc = libevdev_uinput_create_from_device(evdev,
+						LIBEVDEV_UINPUT_OPEN_MANAGED,
+						&uinput);
+	if (rc != 0)
+		fprintf(stderr,
+			"Failed to create uinput device for %s: %s\n",
+			d->node,
+			strerror(-rc));
+
+	libevdev_free(evdev);
+
+	return uinput;
+}
+
+struct libinput *
+recording_create_replay_context(struct recording *r,
+				struct libevdev_uinput **uinputs,
+				bool verbose,
+				struct libinput_device ***devices_out)
+{
+	struct libinput *li;
+	struct libinput_device **devices;
+	struct libinput_event *event;
+	const char **paths;
+
+	paths = zalloc((r->ndevices + 1) * sizeof(*paths));
+	for (size_t i = 0; i < r->ndevices; i++)
+		paths[i] = libevdev_uinput_get_devnode(uinputs[i]);
+
+	li = tools_open_backend(BACKEND_REPLAY, paths, verbose, NULL);
+	free(paths);
+	if (!li)
+		return NULL;
+
+	/* Map the libinput devices back to the recording's devices */
+	devices = zalloc(r->ndevices * sizeof(*devices));
+	while ((event = libinput_get_event(li))) {
+		struct libinput_device *device = libinput_event_get_device(event);
+		const char *sysname = libinput_device_get_sysname(device);
+
+		for (size_t i = 0; i < r->ndevices; i++) {
+			const char *devnode = libevdev_uinput_get_devnode(uinputs[i]);
+			const char *s = devnode ? strrchr(devnode, '/') : NULL;
+
+			if (libinput_event_get_type(event) == LIBINPUT_EVENT_DEVICE_ADDED &&
+			    s && streq(s + 1, sysname) && !devices[i])
+				devices[i] = libinput_device_ref(device);
+		}
+		libinput_event_destroy(event);
+	}
+
+	*devices_out = devices;
+
+	return li;
+}
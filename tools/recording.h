@@ -0,0 +1,180 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _RECORDING_H_
+#define _RECORDING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <linux/input.h>
+
+/* The file format written by libinput record, see the libinput-record(1)
+ * man page for the details. */
+static const int FILE_VERSION_NUMBER = 1;
+
+/* The binary format is the YAML header (everything but the events)
+ * followed by the evdev frames as packed little-endian structs:
+ *
+ *   char magic[8];		BINARY_MAGIC
+ *   uint32_t version;		BINARY_VERSION_NUMBER
+ *   char header[];		YAML, NUL-terminated
+ *   struct binary_frame	followed by frame.nevents binary_events
+ *   struct binary_frame	...
+ *
+ * The frame time is the delta to the previous frame of the same device,
+ * a delta that doesn't fit into the frame is stored as frames with zero
+ * events and the maximum delta.
+ */
+static const char BINARY_MAGIC[8] = { 'L', 'I', 'R', 'E', 'C', 'B', 'I', 'N' };
+static const uint32_t BINARY_VERSION_NUMBER = 1;
+
+struct binary_frame {
+	uint32_t dt; /* us */
+	uint16_t device; /* index into the header's devices */
+	uint16_t nevents;
+};
+
+struct binary_event {
+	uint16_t type;
+	uint16_t code;
+	int32_t value;
+};
+
+struct recording_event {
+	uint16_t type;
+	uint16_t code;
+	int32_t value;
+};
+
+/* One SYN_REPORT-terminated set of events */
+struct recording_frame {
+	uint64_t time; /* us since the start of the recording */
+	unsigned int device; /* index into recording.devices */
+	size_t first_event; /* index into the device's events */
+	size_t nevents;
+};
+
+struct recording_device {
+	char *node;
+	char *name;
+	unsigned int id[4]; /* bustype, vendor, product, version */
+
+	struct {
+		uint16_t type;
+		uint16_t code;
+	} *codes;
+	size_t ncodes;
+	struct input_absinfo absinfo[ABS_CNT];
+	bool props[INPUT_PROP_CNT];
+
+	struct recording_event *events;
+	size_t nevents;
+	struct recording_frame *frames;
+	size_t nframes;
+};
+
+struct recording {
+	struct recording_device *devices;
+	size_t ndevices;
+};
+
+/**
+ * Load a recording in the YAML or binary format. The YAML parser only
+ * handles the subset of YAML that libinput record writes, anything
+ * unknown is skipped.
+ *
+ * Errors are printed to stderr.
+ *
+ * @return the recording or NULL on error
+ */
+struct recording *
+recording_load(const char *path);
+
+/**
+ * Called for each frame of a streamed recording, see recording_stream().
+ * The frame's first_event is 0, its events are in events and only valid
+ * until the handler returns.
+ *
+ * @return false to stop reading the recording
+ */
+typedef bool (*recording_frame_handler)(struct recording *recording,
+					const struct recording_frame *frame,
+					const struct recording_event *events,
+					void *userdata);
+
+/**
+ * Read a recording in a single pass and pass every frame to the handler
+ * instead of keeping them, memory use is independent of the length of
+ * the recording. The frames are in file order, for a YAML recording
+ * that is all frames of the first device, then all frames of the second
+ * device, etc. When the handler is called, the header of the frame's
+ * device has been parsed, the recording's devices after that one may
+ * not be available yet.
+ *
+ * Errors are printed to stderr.
+ *
+ * @return the recording with the devices but no events or frames, or
+ * NULL on error. A handler asking to stop is not an error.
+ */
+struct recording *
+recording_stream(const char *path,
+		 recording_frame_handler handler,
+		 void *userdata);
+
+void
+recording_free(struct recording *recording);
+
+/**
+ * @return all devices' frames in timestamp order, the frames are owned
+ * by the recording. Free the array with free().
+ */
+struct recording_frame **
+recording_build_timeline(struct recording *recording, size_t *nframes);
+
+struct libevdev_uinput;
+
+/**
+ * Create a uinput device with the recorded name, id, event codes and
+ * properties. Errors are printed to stderr.
+ */
+struct libevdev_uinput *
+recording_device_create_uinput(struct recording_device *d);
+
+struct libinput;
+struct libinput_device;
+
+/**
+ * Create a libinput replay context, see libinput_replay_create_context(),
+ * with the given uinput devices, one per recording device. On success,
+ * devices_out[i] is a reference to the libinput device for the
+ * recording's device i, or NULL if there is none. Unref the devices and
+ * free() the array.
+ */
+struct libinput *
+recording_create_replay_context(struct recording *r,
+				struct libevdev_uinput **uinputs,
+				bool verbose,
+				struct libinput_device ***devices_out);
+
+#endif
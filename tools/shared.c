@@ -28,6 +28,7 @@
 #include <fcntl.h>
 #include <fnmatch.h>
 #include <getopt.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -76,10 +77,12 @@ tools_init_options(struct tools_options *options)
 	options->tap_map = -1;
 	options->drag = -1;
 	options->drag_lock = -1;
+	options->tap_early_commit = -1;
 	options->natural_scroll = -1;
 	options->left_handed = -1;
 	options->middlebutton = -1;
 	options->dwt = -1;
+	options->low_latency = -1;
 	options->click_method = -1;
 	options->scroll_method = -1;
 	options->scroll_button = -1;
@@ -124,6 +127,12 @@ tools_parse_option(int option,
 	case OPT_DRAG_LOCK_DISABLE:
 		options->drag_lock = 0;
 		break;
+	case OPT_TAP_EARLY_COMMIT_ENABLE:
+		options->tap_early_commit = 1;
+		break;
+	case OPT_TAP_EARLY_COMMIT_DISABLE:
+		options->tap_early_commit = 0;
+		break;
 	case OPT_NATURAL_SCROLL_ENABLE:
 		options->natural_scroll = 1;
 		break;
@@ -148,6 +157,12 @@ tools_parse_option(int option,
 	case OPT_DWT_DISABLE:
 		options->dwt = LIBINPUT_CONFIG_DWT_DISABLED;
 		break;
+	case OPT_LOW_LATENCY_ENABLE:
+		options->low_latency = LIBINPUT_CONFIG_LOW_LATENCY_ENABLED;
+		break;
+	case OPT_LOW_LATENCY_DISABLE:
+		options->low_latency = LIBINPUT_CONFIG_LOW_LATENCY_DISABLED;
+		break;
 	case OPT_CLICK_METHOD:
 		if (!optarg)
 			return 1;
@@ -305,13 +320,16 @@ out:
 }
 
 static struct libinput *
-tools_open_device(const char **paths, bool verbose, bool *grab)
+tools_open_device(const char **paths, bool verbose, bool *grab, bool replay)
 {
 	struct libinput_device *device;
 	struct libinput *li;
 	const char **p = paths;
 
-	li = libinput_path_create_context(&interface, grab);
+	if (replay)
+		li = libinput_replay_create_context(&interface, grab);
+	else
+		li = libinput_path_create_context(&interface, grab);
 	if (!li) {
 		fprintf(stderr, "Failed to initialize path context\n");
 		return NULL;
@@ -361,7 +379,10 @@ tools_open_backend(enum tools_backend which,
 		li = tools_open_udev(seat_or_device[0], verbose, grab);
 		break;
 	case BACKEND_DEVICE:
-		li = tools_open_device(seat_or_device, verbose, grab);
+		li = tools_open_device(seat_or_device, verbose, grab, false);
+		break;
+	case BACKEND_REPLAY:
+		li = tools_open_device(seat_or_device, verbose, grab, true);
 		break;
 	default:
 		abort();
@@ -370,6 +391,53 @@ tools_open_backend(enum tools_backend which,
 	return li;
 }
 
+static const struct startup_phase {
+	enum libinput_startup_phase phase;
+	const char *name;
+	bool per_device;
+} startup_phases[] = {
+	{ LIBINPUT_STARTUP_PHASE_QUIRKS, "quirks", false },
+	{ LIBINPUT_STARTUP_PHASE_HOST_LOOKUP, "host lookup", false },
+	{ LIBINPUT_STARTUP_PHASE_ENUMERATE, "enumerate", false },
+	{ LIBINPUT_STARTUP_PHASE_LIBWACOM, "libwacom", false },
+	{ LIBINPUT_STARTUP_PHASE_OPEN, "open", true },
+	{ LIBINPUT_STARTUP_PHASE_LIBEVDEV, "libevdev", true },
+	{ LIBINPUT_STARTUP_PHASE_CONFIGURE, "configure", true },
+	{ LIBINPUT_STARTUP_PHASE_NOTIFY, "notify", true },
+};
+
+/**
+ * @return The per-phase setup times of the device, or of the context if
+ * device is NULL, as a string of "phase 123us" pairs. The caller must
+ * free the string.
+ */
+char *
+tools_startup_time_str(struct libinput *li,
+		       struct libinput_device *device)
+{
+	const struct startup_phase *p;
+	char *str = safe_strdup("");
+
+	ARRAY_FOR_EACH(startup_phases, p) {
+		uint64_t us;
+		char *tmp;
+
+		if (device && !p->per_device)
+			continue;
+
+		us = device ?
+		     libinput_device_get_startup_time(device, p->phase) :
+		     libinput_get_startup_time(li, p->phase);
+
+		xasprintf(&tmp, "%s%s%s %" PRIu64 "us",
+			  str, *str ? ", " : "", p->name, us);
+		free(str);
+		str = tmp;
+	}
+
+	return str;
+}
+
 void
 tools_device_apply_config(struct libinput_device *device,
 			  struct tools_options *options)
@@ -398,6 +466,9 @@ tools_device_apply_config(struct libinput_device *device,
 	if (options->drag_lock != -1)
 		libinput_device_config_tap_set_drag_lock_enabled(device,
 								 options->drag_lock);
+	if (options->tap_early_commit != -1)
+		libinput_device_config_tap_set_early_commit_enabled(device,
+								    options->tap_early_commit);
 	if (options->natural_scroll != -1)
 		libinput_device_config_scroll_set_natural_scroll_enabled(device,
 									 options->natural_scroll);
@@ -409,6 +480,9 @@ tools_device_apply_config(struct libinput_device *device,
 
 	if (options->dwt != -1)
 		libinput_device_config_dwt_set_enabled(device, options->dwt);
+	if (options->low_latency != -1)
+		libinput_device_config_low_latency_set_enabled(device,
+							       options->low_latency);
 
 	if (options->click_method != (enum libinput_config_click_method)-1)
 		libinput_device_config_click_set_method(device, options->click_method);
@@ -658,6 +732,8 @@ tools_list_device_quirks(struct quirks_context *ctx,
 			case QUIRK_ATTR_PALM_PRESSURE_THRESHOLD:
 			case QUIRK_ATTR_THUMB_PRESSURE_THRESHOLD:
 			case QUIRK_ATTR_THUMB_SIZE_THRESHOLD:
+			case QUIRK_ATTR_TOUCHPAD_HISTORY_LENGTH:
+			case QUIRK_ATTR_TABLET_SMOOTHING_WINDOW:
 				quirks_get_uint32(quirks, q, &v);
 				snprintf(buf, sizeof(buf), "%s=%u", name, v);
 				callback(userdata, buf);
@@ -667,6 +743,7 @@ tools_list_device_quirks(struct quirks_context *ctx,
 			case QUIRK_ATTR_TRACKPOINT_INTEGRATION:
 			case QUIRK_ATTR_TPKBCOMBO_LAYOUT:
 			case QUIRK_ATTR_MSC_TIMESTAMP:
+			case QUIRK_ATTR_DISPATCH_PRIORITY:
 				quirks_get_string(quirks, q, &s);
 				snprintf(buf, sizeof(buf), "%s=%s", name, s);
 				callback(userdata, buf);
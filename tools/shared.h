@@ -40,6 +40,8 @@ enum configuration_options {
 	OPT_DRAG_DISABLE,
 	OPT_DRAG_LOCK_ENABLE,
 	OPT_DRAG_LOCK_DISABLE,
+	OPT_TAP_EARLY_COMMIT_ENABLE,
+	OPT_TAP_EARLY_COMMIT_DISABLE,
 	OPT_NATURAL_SCROLL_ENABLE,
 	OPT_NATURAL_SCROLL_DISABLE,
 	OPT_LEFT_HANDED_ENABLE,
@@ -48,6 +50,8 @@ enum configuration_options {
 	OPT_MIDDLEBUTTON_DISABLE,
 	OPT_DWT_ENABLE,
 	OPT_DWT_DISABLE,
+	OPT_LOW_LATENCY_ENABLE,
+	OPT_LOW_LATENCY_DISABLE,
 	OPT_CLICK_METHOD,
 	OPT_SCROLL_METHOD,
 	OPT_SCROLL_BUTTON,
@@ -67,6 +71,8 @@ enum configuration_options {
 	{ "disable-drag",              no_argument,       0, OPT_DRAG_DISABLE }, \
 	{ "enable-drag-lock",          no_argument,       0, OPT_DRAG_LOCK_ENABLE }, \
 	{ "disable-drag-lock",         no_argument,       0, OPT_DRAG_LOCK_DISABLE }, \
+	{ "enable-tap-early-commit",   no_argument,       0, OPT_TAP_EARLY_COMMIT_ENABLE }, \
+	{ "disable-tap-early-commit",  no_argument,       0, OPT_TAP_EARLY_COMMIT_DISABLE }, \
 	{ "enable-natural-scrolling",  no_argument,       0, OPT_NATURAL_SCROLL_ENABLE }, \
 	{ "disable-natural-scrolling", no_argument,       0, OPT_NATURAL_SCROLL_DISABLE }, \
 	{ "enable-left-handed",        no_argument,       0, OPT_LEFT_HANDED_ENABLE }, \
@@ -75,6 +81,8 @@ enum configuration_options {
 	{ "disable-middlebutton",      no_argument,       0, OPT_MIDDLEBUTTON_DISABLE }, \
 	{ "enable-dwt",                no_argument,       0, OPT_DWT_ENABLE }, \
 	{ "disable-dwt",               no_argument,       0, OPT_DWT_DISABLE }, \
+	{ "enable-low-latency",        no_argument,       0, OPT_LOW_LATENCY_ENABLE }, \
+	{ "disable-low-latency",       no_argument,       0, OPT_LOW_LATENCY_DISABLE }, \
 	{ "enable-scroll-button-lock", no_argument,       0, OPT_SCROLL_BUTTON_LOCK_ENABLE }, \
 	{ "disable-scroll-button-lock",no_argument,       0, OPT_SCROLL_BUTTON_LOCK_DISABLE }, \
 	{ "set-click-method",          required_argument, 0, OPT_CLICK_METHOD }, \
@@ -88,7 +96,8 @@ enum configuration_options {
 enum tools_backend {
 	BACKEND_NONE,
 	BACKEND_DEVICE,
-	BACKEND_UDEV
+	BACKEND_UDEV,
+	BACKEND_REPLAY,
 };
 
 struct tools_options {
@@ -97,6 +106,7 @@ struct tools_options {
 	int tapping;
 	int drag;
 	int drag_lock;
+	int tap_early_commit;
 	int natural_scroll;
 	int left_handed;
 	int middlebutton;
@@ -107,6 +117,7 @@ struct tools_options {
 	int scroll_button_lock;
 	double speed;
 	int dwt;
+	int low_latency;
 	enum libinput_config_accel_profile profile;
 	char disable_pattern[64];
 };
@@ -122,6 +133,8 @@ struct libinput* tools_open_backend(enum tools_backend which,
 void tools_device_apply_config(struct libinput_device *device,
 			       struct tools_options *options);
 int tools_exec_command(const char *prefix, int argc, char **argv);
+char *tools_startup_time_str(struct libinput *li,
+			     struct libinput_device *device);
 
 bool find_touchpad_device(char *path, size_t path_len);
 bool is_touchpad_device(const char *devnode);
@@ -159,6 +159,16 @@ def libinput_record():
     return get_tool('record')
 
 
+@pytest.fixture
+def libinput_replay_native():
+    return get_tool('replay-native')
+
+
+@pytest.fixture
+def libinput_benchmark():
+    return get_tool('benchmark')
+
+
 def test_help(libinput):
     stdout, stderr = libinput.run_command_success(['--help'])
     assert stdout.startswith('Usage:')
@@ -202,10 +212,12 @@ options = {
         'tap',
         'drag',
         'drag-lock',
+        'tap-early-commit',
         'middlebutton',
         'natural-scrolling',
         'left-handed',
-        'dwt'
+        'dwt',
+        'low-latency'
     ],
     # options with distinct values
     'enums': {
@@ -271,6 +283,27 @@ def test_debug_events_verbose_quiet(libinput_debug_events, args):
     libinput_debug_events.run_command_success(args)
 
 
+def test_debug_events_startup_timing(libinput_debug_events):
+    libinput_debug_events.run_command_success(['--startup-timing'])
+
+
+def test_debug_events_stats(libinput_debug_events):
+    libinput_debug_events.run_command_success(['--stats'])
+    libinput_debug_events.run_command_success(['--stats', '--quiet'])
+
+
+def test_debug_events_latency_audit(libinput_debug_events):
+    libinput_debug_events.run_command_success(['--latency-audit'])
+    libinput_debug_events.run_command_success(['--latency-audit', '--stats'])
+
+
+def test_debug_events_log_ring(libinput_debug_events):
+    libinput_debug_events.run_command_success(['--log-ring=1024'])
+    libinput_debug_events.run_command_invalid(['--log-ring=0'])
+    libinput_debug_events.run_command_invalid(['--log-ring=1000'])
+    libinput_debug_events.run_command_invalid(['--log-ring=abc'])
+
+
 @pytest.mark.parametrize('arg', ['--banana', '--foo', '--version'])
 def test_invalid_args(libinput_debug_tool, arg):
     libinput_debug_tool.run_command_unrecognized_option([arg])
@@ -343,6 +376,72 @@ def test_libinput_record_autorestart(libinput_record, recording):
     libinput_record.run_command_success(['-o', recording, '--autorestart=2'])
 
 
+def test_libinput_record_format(libinput_record, recording):
+    libinput_record.run_command_success(['-o', recording, '--format=yaml'])
+    libinput_record.run_command_success(['-o', recording, '--format=binary'])
+    libinput_record.run_command_invalid(['-o', recording, '--format=foo'])
+    libinput_record.run_command_invalid(['-o', recording, '--format=binary', '--with-libinput'])
+
+
+def test_libinput_record_ring(libinput_record, recording):
+    libinput_record.run_command_success(['-o', recording, '--ring=10'])
+    libinput_record.run_command_success(['-o', recording, '--ring=10', '--ring-trigger=KEY_LEFTCTRL+KEY_F12'])
+    libinput_record.run_command_invalid(['--ring=10'])
+    libinput_record.run_command_invalid(['-o', recording, '--ring=0'])
+    libinput_record.run_command_invalid(['-o', recording, '--ring=10', '--autorestart=2'])
+    libinput_record.run_command_invalid(['-o', recording, '--ring=10', '--ring-trigger=KEY_FOO'])
+    libinput_record.run_command_invalid(['-o', recording, '--ring-trigger=KEY_F12'])
+
+
+def test_libinput_replay_native_args(libinput_replay_native, recording):
+    libinput_replay_native.run_command_success(['--help'])
+    libinput_replay_native.run_command_success(['--once', '--speed=2.5', recording])
+    libinput_replay_native.run_command_invalid([])
+    libinput_replay_native.run_command_invalid(['--speed=0', recording])
+    libinput_replay_native.run_command_invalid(['--speed=abc', recording])
+    libinput_replay_native.run_command_success(['--once', '--in-process', '--fast', recording])
+    libinput_replay_native.run_command_invalid(['--fast', recording])
+
+
+def test_libinput_benchmark_args(libinput_benchmark, recording):
+    libinput_benchmark.run_command_success(['--help'])
+    libinput_benchmark.run_command_invalid([])
+    libinput_benchmark.run_command_invalid(['--iterations=0', recording])
+    libinput_benchmark.run_command_invalid(['--iterations=abc', recording])
+    libinput_benchmark.run_command_invalid(['--no-stages'])
+
+
+def test_libinput_stress_args():
+    libinput_stress = get_tool('stress')
+    libinput_stress.run_command_success(['--help'])
+    libinput_stress.run_command_invalid(['--devices=0'])
+    libinput_stress.run_command_invalid(['--rate=0'])
+    libinput_stress.run_command_invalid(['--rate=125,abc'])
+    libinput_stress.run_command_invalid(['--template=joystick'])
+    libinput_stress.run_command_invalid(['--fingers=0'])
+    libinput_stress.run_command_invalid(['--duration=0'])
+    libinput_stress.run_command_invalid(['extra-argument'])
+    libinput_stress.run_command_success(['--in-process', '--devices=2',
+                                         '--rate=100', '--duration=1',
+                                         '--template=mouse,keyboard'])
+
+
+def test_libinput_analyze_rates_args(recording):
+    libinput_analyze = get_tool('analyze')
+    libinput_analyze.run_command_success(['rates', '--help'])
+    libinput_analyze.run_command_invalid(['rates'])
+    libinput_analyze.run_command_invalid(['rates', '--idle-threshold=0', recording])
+    libinput_analyze.run_command_invalid(['rates', '--idle-threshold=abc', recording])
+
+
+def test_libinput_analyze_per_slot_delta_args(recording):
+    libinput_analyze = get_tool('analyze')
+    libinput_analyze.run_command_success(['per-slot-delta', '--help'])
+    libinput_analyze.run_command_invalid(['per-slot-delta'])
+    libinput_analyze.run_command_invalid(['per-slot-delta', '--threshold=abc', recording])
+    libinput_analyze.run_command_invalid(['per-slot-delta', '--ignore-below=abc', recording])
+
+
 def main():
     args = ['-m', 'pytest']
     try:
@@ -359,3 +458,4 @@ def main():
 
 if __name__ == '__main__':
     raise SystemExit(main())
+